@@ -85,6 +85,8 @@ AC_CHECK_HEADER(bstring.h,AC_DEFINE(HAVE_BSTRING_H))
 AC_CHECK_HEADER(sys/ioctl.h,AC_DEFINE(HAVE_SYS_IOCTL_H))
 AC_CHECK_HEADER(sys/param.h,AC_DEFINE(HAVE_SYS_PARAM_H))
 AC_CHECK_HEADER(sys/ucred.h,AC_DEFINE(HAVE_SYS_UCRED_H))
+AC_CHECK_HEADER(sys/sendfile.h,AC_DEFINE(HAVE_SYS_SENDFILE_H))
+AC_CHECK_HEADER(sys/sdt.h,AC_DEFINE(HAVE_SYS_SDT_H))
 
 dnl Checks for iconv.h and iconv_open
 AC_CHECK_HEADER(iconv.h,
@@ -130,11 +132,23 @@ esac
 AC_CHECK_FUNCS(sigaction)
 
 dnl Checks for wait functions.
-AC_CHECK_FUNCS(waitpid wait3)
+AC_CHECK_FUNCS(waitpid wait3 wait4)
 
 dnl Check for posix_spawn
 AC_CHECK_FUNCS(posix_spawn)
 
+dnl Check for splice (zero-copy spooling)
+AC_CHECK_FUNCS(splice)
+
+dnl Check for fallocate (spool file preallocation)
+AC_CHECK_FUNCS(fallocate)
+
+dnl Check for memfd_create (in-memory spooling)
+AC_CHECK_FUNCS(memfd_create)
+
+dnl Check for prlimit (transform resource limits)
+AC_CHECK_FUNCS(prlimit)
+
 dnl See if the tm structure has the tm_gmtoff member...
 AC_MSG_CHECKING(for tm_gmtoff member in tm structure)
 AC_TRY_COMPILE([#include <time.h>],[struct tm t;
@@ -19,6 +19,7 @@ AC_SUBST(OPTIM)
 
 AC_ARG_ENABLE(debug, [  --disable-debug         build without debugging symbols])
 AC_ARG_ENABLE(debug_guards, [  --enable-debug-guards   build with memory allocation guards])
+AC_ARG_ENABLE(debug_logging, [  --disable-debug-logging disable ippserver debug logging])
 AC_ARG_ENABLE(debug_printfs, [  --disable-debug-printfs disable CUPS_DEBUG_LOG support])
 AC_ARG_ENABLE(unit_tests, [  --enable-unit-tests     build and run unit tests])
 
@@ -35,6 +36,13 @@ if test x$enable_debug_printfs != xno; then
 	CXXFLAGS="$CXXFLAGS -DDEBUG"
 fi
 
+dnl Debug logging costs a level check per message, so allow it to be compiled
+dnl out of ippserver for production builds
+if test x$enable_debug_logging = xno; then
+	CFLAGS="$CFLAGS -DSERVER_NO_DEBUG_LOGGING"
+	CXXFLAGS="$CXXFLAGS -DSERVER_NO_DEBUG_LOGGING"
+fi
+
 dnl Debug guards use an extra 4 bytes for some structures like strings in the
 dnl string pool, so provide a separate option for that
 if test x$enable_debug_guards = xyes; then
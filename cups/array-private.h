@@ -31,6 +31,16 @@ extern "C" {
 
 extern int		_cupsArrayAddStrings(cups_array_t *a, const char *s,
 			                     char delim) _CUPS_PRIVATE;
+extern cups_array_t	*_cupsArrayNewHash(cups_array_func_t f, void *d,
+			                   cups_ahash_func_t h,
+			                   cups_acopy_func_t cf,
+			                   cups_afree_func_t ff) _CUPS_PRIVATE;
+extern cups_array_t	*_cupsArrayNewHashUnordered(cups_array_func_t f,
+			                            void *d,
+			                            cups_ahash_func_t h,
+			                            cups_acopy_func_t cf,
+			                            cups_afree_func_t ff)
+			                            _CUPS_PRIVATE;
 extern cups_array_t	*_cupsArrayNewStrings(const char *s, char delim)
 			                      _CUPS_PRIVATE;
 
@@ -22,12 +22,19 @@
  */
 
 #define _CUPS_MAXSAVE	32		/**** Maximum number of saves ****/
+#define _CUPS_MINSLOTS	16		/**** Minimum number of index slots ****/
 
 
 /*
  * Types and structures...
  */
 
+typedef struct _cups_aslot_s		/**** Hash index slot ****/
+{
+  unsigned		hash;		/* Mixed hash of element */
+  int			element;	/* Element index or -1 if empty */
+} _cups_aslot_t;
+
 struct _cups_array_s			/**** CUPS array structure ****/
 {
  /*
@@ -35,6 +42,12 @@ struct _cups_array_s			/**** CUPS array structure ****/
   * sorted pointers.  We leave the array type private/opaque so that we
   * can change the underlying implementation without affecting the users
   * of this API.
+  *
+  * Arrays created with _cupsArrayNewHash() are unsorted and keep an
+  * open-addressed (linear probing) index of element positions so that
+  * lookups and removals do not need a sorted order.  Arrays created with
+  * _cupsArrayNewHashUnordered() also fill the hole left by a removal with
+  * the last element so that removals do not renumber the index.
   */
 
   int			num_elements,	/* Number of array elements */
@@ -42,6 +55,8 @@ struct _cups_array_s			/**** CUPS array structure ****/
 			current,	/* Current element */
 			insert,		/* Last inserted element */
 			unique,		/* Are all elements unique? */
+			unsorted,	/* Do the elements need sorting? */
+			unordered,	/* Can removals reorder elements? */
 			num_saved,	/* Number of saved elements */
 			saved[_CUPS_MAXSAVE];
 					/* Saved elements */
@@ -53,6 +68,8 @@ struct _cups_array_s			/**** CUPS array structure ****/
 			*hash;		/* Hash array */
   cups_acopy_func_t	copyfunc;	/* Copy function */
   cups_afree_func_t	freefunc;	/* Free function */
+  int			num_slots;	/* Number of index slots (power of 2) */
+  _cups_aslot_t		*slots;		/* Index slots for hashed arrays */
 };
 
 
@@ -62,6 +79,11 @@ struct _cups_array_s			/**** CUPS array structure ****/
 
 static int	cups_array_add(cups_array_t *a, void *e, int insert);
 static int	cups_array_find(cups_array_t *a, void *e, int prev, int *rdiff);
+static unsigned	cups_array_hash(cups_array_t *a, void *e);
+static void	cups_array_index(cups_array_t *a, int element);
+static int	cups_array_reindex(cups_array_t *a, int num_slots);
+static void	cups_array_sort(cups_array_t *a);
+static void	cups_array_unindex(cups_array_t *a, int element);
 
 
 /*
@@ -194,6 +216,46 @@ _cupsArrayAddStrings(cups_array_t *a,	/* I - Array */
 }
 
 
+/*
+ * 'cupsArrayAddUnsorted()' - Append an element to the array without sorting.
+ *
+ * This function is used to build large sorted arrays quickly.  Elements are
+ * appended to the end of the array and the array is sorted once, either by
+ * calling @link cupsArraySort@ or automatically on the next lookup or call to
+ * @link cupsArrayFirst@, @link cupsArrayIndex@, or @link cupsArrayLast@.
+ * Arrays that are shared between threads should be sorted explicitly before
+ * other threads use them.
+ *
+ * @since CUPS 2.3@
+ */
+
+int					/* O - 1 on success, 0 on failure */
+cupsArrayAddUnsorted(cups_array_t *a,	/* I - Array */
+                     void         *e)	/* I - Element */
+{
+  DEBUG_printf(("2cupsArrayAddUnsorted(a=%p, e=%p)", (void *)a, e));
+
+ /*
+  * Range check input...
+  */
+
+  if (!a || !e)
+  {
+    DEBUG_puts("3cupsArrayAddUnsorted: returning 0");
+    return (0);
+  }
+
+ /*
+  * Append the element...
+  */
+
+  if (a->compare && !a->slots && a->num_elements > 0)
+    a->unsorted = 1;
+
+  return (cups_array_add(a, e, 0));
+}
+
+
 /*
  * 'cupsArrayClear()' - Clear the array.
  *
@@ -236,7 +298,11 @@ cupsArrayClear(cups_array_t *a)		/* I - Array */
   a->current      = -1;
   a->insert       = -1;
   a->unique       = 1;
+  a->unsorted     = 0;
   a->num_saved    = 0;
+
+  if (a->slots)
+    memset(a->slots, -1, (size_t)a->num_slots * sizeof(_cups_aslot_t));
 }
 
 
@@ -337,6 +403,8 @@ cupsArrayDelete(cups_array_t *a)	/* I - Array */
   if (a->hashsize)
     free(a->hash);
 
+  free(a->slots);
+
   free(a);
 }
 
@@ -373,10 +441,30 @@ cupsArrayDup(cups_array_t *a)		/* I - Array */
   da->current   = a->current;
   da->insert    = a->insert;
   da->unique    = a->unique;
+  da->unsorted  = a->unsorted;
+  da->unordered = a->unordered;
   da->num_saved = a->num_saved;
 
   memcpy(da->saved, a->saved, sizeof(a->saved));
 
+  if (a->slots)
+  {
+   /*
+    * Copy the hash index; copied elements hash the same as the originals...
+    */
+
+    if ((da->slots = malloc((size_t)a->num_slots * sizeof(_cups_aslot_t))) == NULL)
+    {
+      free(da);
+      return (NULL);
+    }
+
+    memcpy(da->slots, a->slots, (size_t)a->num_slots * sizeof(_cups_aslot_t));
+
+    da->hashfunc  = a->hashfunc;
+    da->num_slots = a->num_slots;
+  }
+
   if (a->num_elements)
   {
    /*
@@ -386,6 +474,7 @@ cupsArrayDup(cups_array_t *a)		/* I - Array */
     da->elements = malloc((size_t)a->num_elements * sizeof(void *));
     if (!da->elements)
     {
+      free(da->slots);
       free(da);
       return (NULL);
     }
@@ -490,7 +579,7 @@ cupsArrayFind(cups_array_t *a,		/* I - Array */
     * the first element that is the same...
     */
 
-    if (!a->unique && a->compare)
+    if (!a->unique && a->compare && !a->slots)
     {
      /*
       * The array is not unique, find the first match...
@@ -537,6 +626,9 @@ cupsArrayFirst(cups_array_t *a)		/* I - Array */
   if (!a)
     return (NULL);
 
+  if (a->unsorted)
+    cups_array_sort(a);
+
  /*
   * Return the first element...
   */
@@ -595,6 +687,9 @@ cupsArrayIndex(cups_array_t *a,		/* I - Array */
   if (!a)
     return (NULL);
 
+  if (a->unsorted)
+    cups_array_sort(a);
+
   a->current = n;
 
   return (cupsArrayCurrent(a));
@@ -635,6 +730,101 @@ cupsArrayInsert(cups_array_t *a,	/* I - Array */
 }
 
 
+/*
+ * 'cupsArrayIterDelete()' - Free an array iterator.
+ *
+ * @since CUPS 2.3@
+ */
+
+void
+cupsArrayIterDelete(
+    cups_array_iter_t *iter)		/* I - Iterator */
+{
+  free(iter);
+}
+
+
+/*
+ * 'cupsArrayIterInit()' - Initialize an iterator for an array.
+ *
+ * Iterators keep their own position so that multiple threads can walk the
+ * same array at the same time, for example while holding a shared (read) lock.
+ * The current and saved elements of the array are not changed.  The array
+ * must not be modified while the iterator is in use.
+ *
+ * The iterator is normally a local variable of the caller and does not need
+ * to be freed.  A @code NULL@ array gives an iterator with no elements.
+ *
+ * @since CUPS 2.3@
+ */
+
+void
+cupsArrayIterInit(
+    cups_array_iter_t *iter,		/* I - Iterator */
+    cups_array_t      *a)		/* I - Array */
+{
+  if (!iter)
+    return;
+
+  if (a && a->unsorted)
+    cups_array_sort(a);
+
+  iter->array   = a;
+  iter->current = -1;
+}
+
+
+/*
+ * 'cupsArrayIterNew()' - Create an iterator for an array.
+ *
+ * This allocates an iterator that must be freed with
+ * @link cupsArrayIterDelete@.  Use @link cupsArrayIterInit@ to initialize an
+ * iterator without allocating memory.
+ *
+ * @since CUPS 2.3@
+ */
+
+cups_array_iter_t *			/* O - Iterator or @code NULL@ on error */
+cupsArrayIterNew(cups_array_t *a)	/* I - Array */
+{
+  cups_array_iter_t	*iter;		/* Iterator */
+
+
+  if (!a)
+    return (NULL);
+
+  if ((iter = (cups_array_iter_t *)malloc(sizeof(cups_array_iter_t))) != NULL)
+    cupsArrayIterInit(iter, a);
+
+  return (iter);
+}
+
+
+/*
+ * 'cupsArrayIterNext()' - Get the next element from an array iterator.
+ *
+ * The first call returns the first element in the array.
+ *
+ * @since CUPS 2.3@
+ */
+
+void *					/* O - Next element or @code NULL@ */
+cupsArrayIterNext(
+    cups_array_iter_t *iter)		/* I - Iterator */
+{
+  if (!iter || !iter->array)
+    return (NULL);
+
+  if (iter->current < iter->array->num_elements)
+    iter->current ++;
+
+  if (iter->current < iter->array->num_elements)
+    return (iter->array->elements[iter->current]);
+  else
+    return (NULL);
+}
+
+
 /*
  * 'cupsArrayLast()' - Get the last element in the array.
  *
@@ -651,6 +841,9 @@ cupsArrayLast(cups_array_t *a)		/* I - Array */
   if (!a)
     return (NULL);
 
+  if (a->unsorted)
+    cups_array_sort(a);
+
  /*
   * Return the last element...
   */
@@ -772,6 +965,77 @@ cupsArrayNew3(cups_array_func_t  f,	/* I - Comparison function or @code NULL@ fo
 }
 
 
+/*
+ * '_cupsArrayNewHash()' - Create a new hash-indexed array.
+ *
+ * Hash-indexed arrays are unsorted - elements are kept in the order they are
+ * added or inserted - but @link cupsArrayFind@ and @link cupsArrayRemove@ use
+ * an open-addressed hash index instead of a linear search.  The comparison
+ * function ("f") only needs to return 0 for equal elements and the hash
+ * function ("h") must return the same value for equal elements.  All values
+ * returned by the hash function are valid.
+ *
+ * The index is grown to keep it at most 3/4 full, so a lookup usually probes
+ * only a few slots.  Elements with colliding hashes share a probe sequence,
+ * so a poor hash function makes lookups linear in the worst case.
+ */
+
+cups_array_t *				/* O - Array */
+_cupsArrayNewHash(cups_array_func_t f,	/* I - Comparison function */
+                  void              *d,	/* I - User data or @code NULL@ */
+                  cups_ahash_func_t h,	/* I - Hash function */
+		  cups_acopy_func_t cf,	/* I - Copy function */
+		  cups_afree_func_t ff)	/* I - Free function */
+{
+  cups_array_t	*a;			/* Array  */
+
+
+  if (!f || !h)
+    return (NULL);
+
+  if ((a = cupsArrayNew3(f, d, NULL, 0, cf, ff)) == NULL)
+    return (NULL);
+
+  a->hashfunc = h;
+
+  if (!cups_array_reindex(a, _CUPS_MINSLOTS))
+  {
+    free(a);
+    return (NULL);
+  }
+
+  return (a);
+}
+
+
+/*
+ * '_cupsArrayNewHashUnordered()' - Create a new hash-indexed array whose
+ *                                  removals can reorder elements.
+ *
+ * This is the same as @link _cupsArrayNewHash@ except that removing an
+ * element moves the last element into its place, so removals take constant
+ * time instead of time proportional to the number of elements.  Removing the
+ * current element while iterating is still supported.
+ */
+
+cups_array_t *				/* O - Array */
+_cupsArrayNewHashUnordered(
+    cups_array_func_t f,		/* I - Comparison function */
+    void              *d,		/* I - User data or @code NULL@ */
+    cups_ahash_func_t h,		/* I - Hash function */
+    cups_acopy_func_t cf,		/* I - Copy function */
+    cups_afree_func_t ff)		/* I - Free function */
+{
+  cups_array_t	*a;			/* Array  */
+
+
+  if ((a = _cupsArrayNewHash(f, d, h, cf, ff)) != NULL)
+    a->unordered = 1;
+
+  return (a);
+}
+
+
 /*
  * '_cupsArrayNewStrings()' - Create a new array of comma-delimited strings.
  *
@@ -905,26 +1169,58 @@ cupsArrayRemove(cups_array_t *a,	/* I - Array */
   * Yes, now remove it...
   */
 
+  if (a->slots)
+    cups_array_unindex(a, (int)current);
+
   a->num_elements --;
 
   if (a->freefunc)
     (a->freefunc)(a->elements[current], a->data);
 
-  if (current < a->num_elements)
-    memmove(a->elements + current, a->elements + current + 1,
-            (size_t)(a->num_elements - current) * sizeof(void *));
+  if (a->unordered)
+  {
+   /*
+    * Move the last element into the hole; positions other than the last
+    * one are unchanged, and the current element is moved back so that the
+    * next element is the one that was moved...
+    */
 
-  if (current <= a->current)
-    a->current --;
+    a->elements[current] = a->elements[a->num_elements];
 
-  if (current < a->insert)
-    a->insert --;
-  else if (current == a->insert)
-    a->insert = -1;
+    if (current == a->current)
+      a->current --;
+    else if (a->current == a->num_elements)
+      a->current = (int)current;
 
-  for (i = 0; i < a->num_saved; i ++)
-    if (current <= a->saved[i])
-      a->saved[i] --;
+    if (current == a->insert)
+      a->insert = -1;
+    else if (a->insert == a->num_elements)
+      a->insert = (int)current;
+
+    for (i = 0; i < a->num_saved; i ++)
+      if (current == a->saved[i])
+        a->saved[i] --;
+      else if (a->saved[i] == a->num_elements)
+        a->saved[i] = (int)current;
+  }
+  else
+  {
+    if (current < a->num_elements)
+      memmove(a->elements + current, a->elements + current + 1,
+	      (size_t)(a->num_elements - current) * sizeof(void *));
+
+    if (current <= a->current)
+      a->current --;
+
+    if (current < a->insert)
+      a->insert --;
+    else if (current == a->insert)
+      a->insert = -1;
+
+    for (i = 0; i < a->num_saved; i ++)
+      if (current <= a->saved[i])
+	a->saved[i] --;
+  }
 
   if (a->num_elements <= 1)
     a->unique = 1;
@@ -986,6 +1282,24 @@ cupsArraySave(cups_array_t *a)		/* I - Array */
 }
 
 
+/*
+ * 'cupsArraySort()' - Sort elements added with @link cupsArrayAddUnsorted@.
+ *
+ * The sort is stable, so identical elements stay in the order they were
+ * added.  The current and saved elements are reset.  This function does
+ * nothing for unsorted arrays or arrays that are already sorted.
+ *
+ * @since CUPS 2.3@
+ */
+
+void
+cupsArraySort(cups_array_t *a)		/* I - Array */
+{
+  if (a && a->unsorted)
+    cups_array_sort(a);
+}
+
+
 /*
  * 'cupsArrayUserData()' - Return the user data for an array.
  *
@@ -1063,15 +1377,38 @@ cups_array_add(cups_array_t *a,		/* I - Array */
     a->elements       = temp;
   }
 
+  if (a->slots && (a->num_elements + 1) * 4 > a->num_slots * 3)
+  {
+   /*
+    * Keep the hash index at most 3/4 full...
+    */
+
+    if (!cups_array_reindex(a, a->num_slots * 2))
+    {
+      DEBUG_puts("9cups_array_add: index allocation failed, returning 0");
+      return (0);
+    }
+  }
+
  /*
   * Find the insertion point for the new element; if there is no
   * compare function or elements, just add it to the beginning or end...
   */
 
-  if (!a->num_elements || !a->compare)
+  if (a->unsorted && !insert)
+  {
+   /*
+    * Append unsorted elements to the end; the array is sorted once on the
+    * next lookup...
+    */
+
+    current = a->num_elements;
+  }
+  else if (!a->num_elements || !a->compare || a->slots)
   {
    /*
-    * No elements or comparison function, insert/append as needed...
+    * No elements, comparison function, or sort order, insert/append as
+    * needed...
     */
 
     if (insert)
@@ -1150,6 +1487,10 @@ cups_array_add(cups_array_t *a,		/* I - Array */
       if (a->saved[i] >= current)
 	a->saved[i] ++;
 
+    for (i = 0; i < a->num_slots; i ++)
+      if (a->slots[i].element >= current)
+        a->slots[i].element ++;
+
     DEBUG_printf(("9cups_array_add: insert element at index " CUPS_LLFMT, CUPS_LLCAST current));
   }
 #ifdef DEBUG
@@ -1168,14 +1509,12 @@ cups_array_add(cups_array_t *a,		/* I - Array */
   else
     a->elements[current] = e;
 
+  if (a->slots)
+    cups_array_index(a, current);
+
   a->num_elements ++;
   a->insert = current;
 
-#ifdef DEBUG
-  for (current = 0; current < a->num_elements; current ++)
-    DEBUG_printf(("9cups_array_add: a->elements[" CUPS_LLFMT "]=%p", CUPS_LLCAST current, a->elements[current]));
-#endif /* DEBUG */
-
   DEBUG_puts("9cups_array_add: returning 1");
 
   return (1);
@@ -1200,12 +1539,41 @@ cups_array_find(cups_array_t *a,	/* I - Array */
 
   DEBUG_printf(("7cups_array_find(a=%p, e=%p, prev=%d, rdiff=%p)", (void *)a, e, prev, (void *)rdiff));
 
-  if (a->compare)
+  if (a->slots)
+  {
+   /*
+    * Probe the hash index, returning the first matching element...
+    */
+
+    unsigned	hash = cups_array_hash(a, e),
+					/* Hash of element */
+		mask = (unsigned)a->num_slots - 1,
+					/* Slot mask */
+		slot;			/* Current slot */
+
+    DEBUG_puts("9cups_array_find: hash lookup");
+
+    for (current = -1, slot = hash & mask; a->slots[slot].element >= 0; slot = (slot + 1) & mask)
+    {
+      if (a->slots[slot].hash == hash && (current < 0 || a->slots[slot].element < current) && !(*(a->compare))(e, a->elements[a->slots[slot].element], a->data))
+        current = a->slots[slot].element;
+    }
+
+    DEBUG_printf(("9cups_array_find: Returning %d, diff=%d", current < 0 ? 0 : current, current < 0));
+
+    *rdiff = current < 0;
+
+    return (current < 0 ? 0 : current);
+  }
+  else if (a->compare)
   {
    /*
     * Do a binary search for the element...
     */
 
+    if (a->unsorted)
+      cups_array_sort(a);
+
     DEBUG_puts("9cups_array_find: binary search");
 
     if (prev >= 0 && prev < a->num_elements)
@@ -1317,3 +1685,231 @@ cups_array_find(cups_array_t *a,	/* I - Array */
 
   return (current);
 }
+
+
+/*
+ * 'cups_array_hash()' - Compute the mixed hash of an element.
+ *
+ * The user hash is passed through a finalizer so that only the low bits need
+ * to be used for the slot index.
+ */
+
+static unsigned				/* O - Hash value */
+cups_array_hash(cups_array_t *a,	/* I - Array */
+                void         *e)	/* I - Element */
+{
+  unsigned	hash = (unsigned)(a->hashfunc)(e, a->data);
+					/* Hash value */
+
+
+  hash ^= hash >> 16;
+  hash *= 0x7feb352dU;
+  hash ^= hash >> 15;
+  hash *= 0x846ca68bU;
+  hash ^= hash >> 16;
+
+  return (hash);
+}
+
+
+/*
+ * 'cups_array_index()' - Add an element to the hash index.
+ */
+
+static void
+cups_array_index(cups_array_t *a,	/* I - Array */
+                 int          element)	/* I - Element index */
+{
+  unsigned	hash = cups_array_hash(a, a->elements[element]),
+					/* Hash of element */
+		mask = (unsigned)a->num_slots - 1,
+					/* Slot mask */
+		slot;			/* Current slot */
+
+
+  for (slot = hash & mask; a->slots[slot].element >= 0; slot = (slot + 1) & mask);
+
+  a->slots[slot].hash    = hash;
+  a->slots[slot].element = element;
+}
+
+
+/*
+ * 'cups_array_reindex()' - Resize and rebuild the hash index.
+ */
+
+static int				/* O - 1 on success, 0 on failure */
+cups_array_reindex(cups_array_t *a,	/* I - Array */
+                   int          num_slots)
+					/* I - New number of slots (power of 2) */
+{
+  _cups_aslot_t	*slots;			/* New slots */
+  int		i;			/* Looping var */
+
+
+  if ((slots = malloc((size_t)num_slots * sizeof(_cups_aslot_t))) == NULL)
+    return (0);
+
+  memset(slots, -1, (size_t)num_slots * sizeof(_cups_aslot_t));
+
+  free(a->slots);
+
+  a->slots     = slots;
+  a->num_slots = num_slots;
+
+  for (i = 0; i < a->num_elements; i ++)
+    cups_array_index(a, i);
+
+  return (1);
+}
+
+
+/*
+ * 'cups_array_unindex()' - Remove an element from the hash index.
+ *
+ * The slot is cleared using backward-shift deletion so no tombstones are
+ * needed, and the indices of the elements that follow are adjusted for the
+ * removal.  For unordered arrays only the index of the last element, which
+ * is moved into the hole, is changed.
+ */
+
+static void
+cups_array_unindex(cups_array_t *a,	/* I - Array */
+                   int          element)/* I - Element index */
+{
+  unsigned	mask = (unsigned)a->num_slots - 1,
+					/* Slot mask */
+		slot,			/* Slot being cleared */
+		next,			/* Next slot in cluster */
+		home;			/* Home slot of next entry */
+  int		i;			/* Looping var */
+
+
+  for (slot = cups_array_hash(a, a->elements[element]) & mask; a->slots[slot].element != element; slot = (slot + 1) & mask);
+
+  for (next = (slot + 1) & mask; a->slots[next].element >= 0; next = (next + 1) & mask)
+  {
+    home = a->slots[next].hash & mask;
+
+    if (slot <= next ? (slot < home && home <= next) : (slot < home || home <= next))
+      continue;
+
+    a->slots[slot] = a->slots[next];
+    slot           = next;
+  }
+
+  a->slots[slot].element = -1;
+
+  if (element < (a->num_elements - 1))
+  {
+    if (a->unordered)
+    {
+      int last = a->num_elements - 1;	/* Index of last element */
+
+      for (slot = cups_array_hash(a, a->elements[last]) & mask; a->slots[slot].element != last; slot = (slot + 1) & mask);
+
+      a->slots[slot].element = element;
+    }
+    else
+    {
+      for (i = 0; i < a->num_slots; i ++)
+	if (a->slots[i].element > element)
+	  a->slots[i].element --;
+    }
+  }
+}
+
+
+/*
+ * 'cups_array_sort()' - Sort the elements in the array.
+ *
+ * This is a bottom-up merge sort, which falls back on an insertion sort if
+ * the temporary buffer cannot be allocated.
+ */
+
+static void
+cups_array_sort(cups_array_t *a)	/* I - Array */
+{
+  int		i, j, k,		/* Looping vars */
+		width,			/* Width of runs being merged */
+		left,			/* Start of left run */
+		middle,			/* Start of right run */
+		right;			/* End of right run */
+  void		**src,			/* Source elements */
+		**dst,			/* Destination elements */
+		**swap,			/* Swap pointer */
+		**temp;			/* Temporary buffer */
+
+
+  DEBUG_printf(("7cups_array_sort(a=%p)", (void *)a));
+
+  a->unsorted  = 0;
+  a->current   = -1;
+  a->insert    = -1;
+  a->num_saved = 0;
+
+ /*
+  * Skip the sort if the elements were already added in order...
+  */
+
+  for (i = 1; i < a->num_elements; i ++)
+    if ((*(a->compare))(a->elements[i - 1], a->elements[i], a->data) > 0)
+      break;
+
+  if (i < a->num_elements)
+  {
+    if ((temp = malloc((size_t)a->num_elements * sizeof(void *))) != NULL)
+    {
+      for (width = 1, src = a->elements, dst = temp; width < a->num_elements; width *= 2)
+      {
+        for (left = 0; left < a->num_elements; left += 2 * width)
+        {
+          middle = left + width < a->num_elements ? left + width : a->num_elements;
+          right  = left + 2 * width < a->num_elements ? left + 2 * width : a->num_elements;
+
+          for (i = left, j = middle, k = left; k < right; k ++)
+          {
+            if (i < middle && (j >= right || (*(a->compare))(src[i], src[j], a->data) <= 0))
+              dst[k] = src[i ++];
+            else
+              dst[k] = src[j ++];
+          }
+        }
+
+        swap = src;
+        src  = dst;
+        dst  = swap;
+      }
+
+      if (src != a->elements)
+        memcpy(a->elements, src, (size_t)a->num_elements * sizeof(void *));
+
+      free(temp);
+    }
+    else
+    {
+      for (i = 1; i < a->num_elements; i ++)
+      {
+        void *e = a->elements[i];	/* Element to move */
+
+        for (j = i; j > 0 && (*(a->compare))(a->elements[j - 1], e, a->data) > 0; j --)
+          a->elements[j] = a->elements[j - 1];
+
+        a->elements[j] = e;
+      }
+    }
+  }
+
+ /*
+  * Update the uniqueness of the array...
+  */
+
+  for (a->unique = 1, i = 1; i < a->num_elements; i ++)
+  {
+    if (!(*(a->compare))(a->elements[i - 1], a->elements[i], a->data))
+    {
+      a->unique = 0;
+      break;
+    }
+  }
+}
@@ -42,12 +42,19 @@ typedef void *(*cups_acopy_func_t)(void *element, void *data);
 typedef void (*cups_afree_func_t)(void *element, void *data);
 					/**** Array element free function ****/
 
+typedef struct _cups_array_iter_s	/**** CUPS array iterator @since CUPS 2.3@ ****/
+{
+  cups_array_t		*array;		/* Array */
+  int			current;	/* Current element */
+} cups_array_iter_t;
+
 
 /*
  * Functions...
  */
 
 extern int		cupsArrayAdd(cups_array_t *a, void *e) _CUPS_API_1_2;
+extern int		cupsArrayAddUnsorted(cups_array_t *a, void *e) _CUPS_API_2_3;
 extern void		cupsArrayClear(cups_array_t *a) _CUPS_API_1_2;
 extern int		cupsArrayCount(cups_array_t *a) _CUPS_API_1_2;
 extern void		*cupsArrayCurrent(cups_array_t *a) _CUPS_API_1_2;
@@ -59,6 +66,10 @@ extern int		cupsArrayGetIndex(cups_array_t *a) _CUPS_API_1_3;
 extern int		cupsArrayGetInsert(cups_array_t *a) _CUPS_API_1_3;
 extern void		*cupsArrayIndex(cups_array_t *a, int n) _CUPS_API_1_2;
 extern int		cupsArrayInsert(cups_array_t *a, void *e) _CUPS_API_1_2;
+extern void		cupsArrayIterDelete(cups_array_iter_t *iter) _CUPS_API_2_3;
+extern void		cupsArrayIterInit(cups_array_iter_t *iter, cups_array_t *a) _CUPS_API_2_3;
+extern cups_array_iter_t	*cupsArrayIterNew(cups_array_t *a) _CUPS_API_2_3;
+extern void		*cupsArrayIterNext(cups_array_iter_t *iter) _CUPS_API_2_3;
 extern void		*cupsArrayLast(cups_array_t *a) _CUPS_API_1_2;
 extern cups_array_t	*cupsArrayNew(cups_array_func_t f, void *d) _CUPS_API_1_2;
 extern cups_array_t	*cupsArrayNew2(cups_array_func_t f, void *d,
@@ -72,6 +83,7 @@ extern void		*cupsArrayPrev(cups_array_t *a) _CUPS_API_1_2;
 extern int		cupsArrayRemove(cups_array_t *a, void *e) _CUPS_API_1_2;
 extern void		*cupsArrayRestore(cups_array_t *a) _CUPS_API_1_2;
 extern int		cupsArraySave(cups_array_t *a) _CUPS_API_1_2;
+extern void		cupsArraySort(cups_array_t *a) _CUPS_API_2_3;
 extern void		*cupsArrayUserData(cups_array_t *a) _CUPS_API_1_2;
 
 #  ifdef __cplusplus
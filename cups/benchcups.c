@@ -0,0 +1,914 @@
+/*
+ * Micro-benchmark program for CUPS.
+ *
+ * Copyright © 2014-2019 by Apple Inc.
+ *
+ * Licensed under Apache License v2.0.  See the file "LICENSE" for more
+ * information.
+ *
+ * Usage:
+ *
+ *   ./benchcups [-r REPEAT] [-t SECONDS] [BENCHMARK ...]
+ *
+ * Each benchmark is calibrated to run for at least SECONDS (default 0.2) and
+ * then timed REPEAT times (default 5).  Results are written to the standard
+ * output as CSV with one line per benchmark:
+ *
+ *   benchmark,operations,min-ns,median-ns,max-ns
+ *
+ * where "operations" is the number of operations in each timed run and the
+ * "-ns" columns are nanoseconds per operation.
+ */
+
+/*
+ * Include necessary headers...
+ */
+
+#include "string-private.h"
+#include "ipp-private.h"
+#include "array-private.h"
+#include "file.h"
+#include "raster.h"
+#ifndef _WIN32
+#  include <unistd.h>
+#endif /* !_WIN32 */
+
+
+/*
+ * Constants...
+ */
+
+#define BENCH_NUM_WORDS	1000		/* Number of words for array/string tests */
+#define BENCH_NUM_LINES	1000		/* Number of lines in test file */
+
+
+/*
+ * Local types...
+ */
+
+typedef struct bench_buffer_s		/**** Memory buffer for I/O ****/
+{
+  unsigned char	*data;			/* Buffer */
+  size_t	pos,			/* Read position */
+		used,			/* Bytes used */
+		size;			/* Size of buffer */
+} bench_buffer_t;
+
+typedef struct bench_data_s		/**** Benchmark data ****/
+{
+  ipp_t		*response;		/* Get-Printer-Attributes response */
+  bench_buffer_t ippbuf;		/* Encoded response */
+  int		num_names;		/* Number of attribute names */
+  const char	**names;		/* Attribute names in response */
+  char		*words[BENCH_NUM_WORDS];/* Words for array/string tests */
+  cups_array_t	*array;			/* Sorted array of words */
+  int		current;		/* Current word/name index */
+  cups_page_header2_t header;		/* Raster page header */
+  unsigned char	*line;			/* Raster line */
+  bench_buffer_t rasbuf;		/* Encoded raster page */
+  char		filename[1024];		/* Text file for cupsFileGets */
+} bench_data_t;
+
+typedef int (*bench_func_t)(bench_data_t *data);
+					/**** Benchmark function ****/
+
+typedef struct bench_s			/**** Benchmark ****/
+{
+  const char	*name;			/* Name of benchmark */
+  int		ops;			/* Operations per call */
+  bench_func_t	func;			/* Function to call */
+} bench_t;
+
+
+/*
+ * Local functions...
+ */
+
+static int	bench_array_add(bench_data_t *data);
+static int	bench_array_find(bench_data_t *data);
+static int	bench_file_gets(bench_data_t *data);
+static int	bench_ipp_copy(bench_data_t *data);
+static int	bench_ipp_find(bench_data_t *data);
+static int	bench_ipp_quickcopy(bench_data_t *data);
+static int	bench_ipp_read(bench_data_t *data);
+static int	bench_ipp_write(bench_data_t *data);
+static int	bench_raster_read(bench_data_t *data);
+static int	bench_raster_write(bench_data_t *data);
+static int	bench_str_alloc(bench_data_t *data);
+static int	compare_doubles(double *a, double *b);
+static double	get_seconds(void);
+static ipp_t	*make_response(void);
+static ssize_t	read_cb(bench_buffer_t *buf, unsigned char *buffer, size_t bytes);
+static int	run_bench(bench_data_t *data, const bench_t *bench, int repeat, double mintime);
+static int	setup_data(bench_data_t *data);
+static void	usage(void);
+static ssize_t	write_cb(bench_buffer_t *buf, unsigned char *buffer, size_t bytes);
+
+
+/*
+ * Local globals...
+ */
+
+static const bench_t	benchmarks[] =	/* Benchmarks */
+{
+  { "ippWriteIO",		1,		bench_ipp_write },
+  { "ippReadIO",		1,		bench_ipp_read },
+  { "ippFindAttribute",		1,		bench_ipp_find },
+  { "ippCopyAttributes",	1,		bench_ipp_copy },
+  { "ippCopyAttributes-quick",	1,		bench_ipp_quickcopy },
+  { "cupsArrayAdd",		BENCH_NUM_WORDS, bench_array_add },
+  { "cupsArrayFind",		1,		bench_array_find },
+  { "_cupsStrAlloc",		1,		bench_str_alloc },
+  { "cupsRasterWritePixels",	1,		bench_raster_write },
+  { "cupsRasterReadPixels",	1,		bench_raster_read },
+  { "cupsFileGets",		BENCH_NUM_LINES, bench_file_gets }
+};
+
+
+/*
+ * 'main()' - Run the benchmarks.
+ */
+
+int					/* O - Exit status */
+main(int  argc,				/* I - Number of command-line arguments */
+     char *argv[])			/* I - Command-line arguments */
+{
+  int		i, j;			/* Looping vars */
+  int		repeat = 5;		/* Number of timed runs */
+  double	mintime = 0.2;		/* Minimum time per run */
+  int		num_selected = 0;	/* Number of selected benchmarks */
+  const char	*selected[100];		/* Selected benchmarks */
+  int		status = 0;		/* Exit status */
+  bench_data_t	data;			/* Benchmark data */
+
+
+ /*
+  * Parse command-line...
+  */
+
+  for (i = 1; i < argc; i ++)
+  {
+    if (!strcmp(argv[i], "-r"))
+    {
+      i ++;
+      if (i >= argc || (repeat = atoi(argv[i])) < 1)
+        usage();
+    }
+    else if (!strcmp(argv[i], "-t"))
+    {
+      i ++;
+      if (i >= argc || (mintime = atof(argv[i])) <= 0.0)
+        usage();
+    }
+    else if (argv[i][0] == '-')
+    {
+      usage();
+    }
+    else if (num_selected < (int)(sizeof(selected) / sizeof(selected[0])))
+    {
+      for (j = 0; j < (int)(sizeof(benchmarks) / sizeof(benchmarks[0])); j ++)
+        if (!strcmp(argv[i], benchmarks[j].name))
+          break;
+
+      if (j >= (int)(sizeof(benchmarks) / sizeof(benchmarks[0])))
+      {
+        fprintf(stderr, "benchcups: Unknown benchmark \"%s\".\n", argv[i]);
+        return (1);
+      }
+
+      selected[num_selected ++] = argv[i];
+    }
+  }
+
+ /*
+  * Prepare the test data and run the benchmarks...
+  */
+
+  if (!setup_data(&data))
+    return (1);
+
+  puts("benchmark,operations,min-ns,median-ns,max-ns");
+
+  for (i = 0; i < (int)(sizeof(benchmarks) / sizeof(benchmarks[0])); i ++)
+  {
+    if (num_selected > 0)
+    {
+      for (j = 0; j < num_selected; j ++)
+        if (!strcmp(selected[j], benchmarks[i].name))
+          break;
+
+      if (j >= num_selected)
+        continue;
+    }
+
+    if (!run_bench(&data, benchmarks + i, repeat, mintime))
+    {
+      fprintf(stderr, "benchcups: %s failed.\n", benchmarks[i].name);
+      status = 1;
+    }
+  }
+
+ /*
+  * Clean up...
+  */
+
+  unlink(data.filename);
+
+  return (status);
+}
+
+
+/*
+ * 'bench_array_add()' - Add words to a new sorted array.
+ */
+
+static int				/* O - 1 on success, 0 on failure */
+bench_array_add(bench_data_t *data)	/* I - Benchmark data */
+{
+  int		i;			/* Looping var */
+  cups_array_t	*array;			/* Array */
+
+
+  array = cupsArrayNew((cups_array_func_t)strcmp, NULL);
+
+  for (i = 0; i < BENCH_NUM_WORDS; i ++)
+    cupsArrayAdd(array, data->words[i]);
+
+  i = cupsArrayCount(array);
+
+  cupsArrayDelete(array);
+
+  return (i == BENCH_NUM_WORDS);
+}
+
+
+/*
+ * 'bench_array_find()' - Find a word in a sorted array.
+ */
+
+static int				/* O - 1 on success, 0 on failure */
+bench_array_find(bench_data_t *data)	/* I - Benchmark data */
+{
+  const char	*word = data->words[data->current];
+					/* Word to find */
+
+
+  if (++ data->current >= BENCH_NUM_WORDS)
+    data->current = 0;
+
+  return (cupsArrayFind(data->array, (void *)word) != NULL);
+}
+
+
+/*
+ * 'bench_file_gets()' - Read all lines from a text file.
+ */
+
+static int				/* O - 1 on success, 0 on failure */
+bench_file_gets(bench_data_t *data)	/* I - Benchmark data */
+{
+  cups_file_t	*fp;			/* File */
+  char		line[1024];		/* Line from file */
+  int		count = 0;		/* Number of lines */
+
+
+  if ((fp = cupsFileOpen(data->filename, "r")) == NULL)
+    return (0);
+
+  while (cupsFileGets(fp, line, sizeof(line)))
+    count ++;
+
+  cupsFileClose(fp);
+
+  return (count == BENCH_NUM_LINES);
+}
+
+
+/*
+ * 'bench_ipp_copy()' - Copy the response attributes.
+ */
+
+static int				/* O - 1 on success, 0 on failure */
+bench_ipp_copy(bench_data_t *data)	/* I - Benchmark data */
+{
+  ipp_t	*copy = ippNew();		/* Copy of response */
+  int	ret = ippCopyAttributes(copy, data->response, 0, NULL, NULL);
+					/* Return value */
+
+
+  ippDelete(copy);
+
+  return (ret);
+}
+
+
+/*
+ * 'bench_ipp_find()' - Find an attribute in the response.
+ */
+
+static int				/* O - 1 on success, 0 on failure */
+bench_ipp_find(bench_data_t *data)	/* I - Benchmark data */
+{
+  const char	*name = data->names[data->current];
+					/* Attribute to find */
+
+
+  if (++ data->current >= data->num_names)
+    data->current = 0;
+
+  return (ippFindAttribute(data->response, name, IPP_TAG_ZERO) != NULL);
+}
+
+
+/*
+ * 'bench_ipp_quickcopy()' - Copy the response attributes by reference.
+ */
+
+static int				/* O - 1 on success, 0 on failure */
+bench_ipp_quickcopy(bench_data_t *data)	/* I - Benchmark data */
+{
+  ipp_t	*copy = ippNew();		/* Copy of response */
+  int	ret = ippCopyAttributes(copy, data->response, 1, NULL, NULL);
+					/* Return value */
+
+
+  ippDelete(copy);
+
+  return (ret);
+}
+
+
+/*
+ * 'bench_ipp_read()' - Decode the response.
+ */
+
+static int				/* O - 1 on success, 0 on failure */
+bench_ipp_read(bench_data_t *data)	/* I - Benchmark data */
+{
+  ipp_t		*ipp = ippNew();	/* Decoded response */
+  ipp_state_t	state;			/* Read state */
+
+
+  data->ippbuf.pos = 0;
+
+  while ((state = ippReadIO(&data->ippbuf, (ipp_iocb_t)read_cb, 1, NULL, ipp)) != IPP_STATE_DATA)
+    if (state == IPP_STATE_ERROR)
+      break;
+
+  ippDelete(ipp);
+
+  return (state == IPP_STATE_DATA);
+}
+
+
+/*
+ * 'bench_ipp_write()' - Encode the response.
+ */
+
+static int				/* O - 1 on success, 0 on failure */
+bench_ipp_write(bench_data_t *data)	/* I - Benchmark data */
+{
+  ipp_state_t	state;			/* Write state */
+
+
+  data->ippbuf.used = 0;
+  ippSetState(data->response, IPP_STATE_IDLE);
+
+  while ((state = ippWriteIO(&data->ippbuf, (ipp_iocb_t)write_cb, 1, NULL, data->response)) != IPP_STATE_DATA)
+    if (state == IPP_STATE_ERROR)
+      break;
+
+  return (state == IPP_STATE_DATA);
+}
+
+
+/*
+ * 'bench_raster_read()' - Decode a raster page.
+ */
+
+static int				/* O - 1 on success, 0 on failure */
+bench_raster_read(bench_data_t *data)	/* I - Benchmark data */
+{
+  cups_raster_t		*ras;		/* Raster stream */
+  cups_page_header2_t	header;		/* Page header */
+  unsigned		y;		/* Current line */
+  int			ret = 0;	/* Return value */
+
+
+  data->rasbuf.pos = 0;
+
+  if ((ras = cupsRasterOpenIO((cups_raster_iocb_t)read_cb, &data->rasbuf, CUPS_RASTER_READ)) == NULL)
+    return (0);
+
+  if (cupsRasterReadHeader2(ras, &header) && header.cupsBytesPerLine == data->header.cupsBytesPerLine)
+  {
+    for (y = 0; y < header.cupsHeight; y ++)
+      if (!cupsRasterReadPixels(ras, data->line, header.cupsBytesPerLine))
+        break;
+
+    ret = y >= header.cupsHeight;
+  }
+
+  cupsRasterClose(ras);
+
+  return (ret);
+}
+
+
+/*
+ * 'bench_raster_write()' - Encode a raster page.
+ */
+
+static int				/* O - 1 on success, 0 on failure */
+bench_raster_write(bench_data_t *data)	/* I - Benchmark data */
+{
+  cups_raster_t	*ras;			/* Raster stream */
+  unsigned	x, y;			/* Current column and line */
+  int		ret = 0;		/* Return value */
+
+
+  data->rasbuf.used = 0;
+
+  if ((ras = cupsRasterOpenIO((cups_raster_iocb_t)write_cb, &data->rasbuf, CUPS_RASTER_WRITE_PWG)) == NULL)
+    return (0);
+
+  if (cupsRasterWriteHeader2(ras, &data->header))
+  {
+   /*
+    * The top half of the page is blank, the bottom half is a gradient with
+    * some text-like noise...
+    */
+
+    for (y = 0; y < data->header.cupsHeight; y ++)
+    {
+      if (y < data->header.cupsHeight / 2)
+      {
+        memset(data->line, 255, data->header.cupsBytesPerLine);
+      }
+      else
+      {
+        for (x = 0; x < data->header.cupsBytesPerLine; x ++)
+          data->line[x] = (unsigned char)(((x / 64) & 1) ? x + y : ((x * y) & 8) ? 0 : 255);
+      }
+
+      if (!cupsRasterWritePixels(ras, data->line, data->header.cupsBytesPerLine))
+        break;
+    }
+
+    ret = y >= data->header.cupsHeight;
+  }
+
+  cupsRasterClose(ras);
+
+  return (ret);
+}
+
+
+/*
+ * 'bench_str_alloc()' - Allocate and free a pooled string.
+ */
+
+static int				/* O - 1 on success, 0 on failure */
+bench_str_alloc(bench_data_t *data)	/* I - Benchmark data */
+{
+  char	*s = _cupsStrAlloc(data->words[data->current]);
+					/* Pooled string */
+
+
+  if (++ data->current >= BENCH_NUM_WORDS)
+    data->current = 0;
+
+  if (!s)
+    return (0);
+
+  _cupsStrFree(s);
+
+  return (1);
+}
+
+
+/*
+ * 'compare_doubles()' - Compare two timings.
+ */
+
+static int				/* O - Result of comparison */
+compare_doubles(double *a,		/* I - First timing */
+                double *b)		/* I - Second timing */
+{
+  if (*a < *b)
+    return (-1);
+  else if (*a > *b)
+    return (1);
+  else
+    return (0);
+}
+
+
+/*
+ * 'get_seconds()' - Get the current time in seconds...
+ */
+
+static double				/* O - Current time in seconds */
+get_seconds(void)
+{
+  struct timeval	curtime;	/* Current time */
+
+
+  gettimeofday(&curtime, NULL);
+  return (curtime.tv_sec + 0.000001 * curtime.tv_usec);
+}
+
+
+/*
+ * 'make_response()' - Make a representative Get-Printer-Attributes response.
+ */
+
+static ipp_t *				/* O - Response */
+make_response(void)
+{
+  int		i;			/* Looping var */
+  ipp_t		*response,		/* Response */
+		*col,			/* media-col value */
+		*size;			/* media-size value */
+  ipp_attribute_t *attr;		/* media-col-database */
+  char		name[256];		/* Generated name */
+  static const char * const formats[] =	/* document-format-supported */
+  {
+    "application/octet-stream",
+    "application/pdf",
+    "image/jpeg",
+    "image/pwg-raster",
+    "image/urf"
+  };
+  static const char * const media[] =	/* media-supported */
+  {
+    "na_letter_8.5x11in",
+    "na_legal_8.5x14in",
+    "na_executive_7.25x10.5in",
+    "na_number-10_4.125x9.5in",
+    "na_index-4x6_4x6in",
+    "na_5x7_5x7in",
+    "iso_a4_210x297mm",
+    "iso_a5_148x210mm",
+    "iso_a6_105x148mm",
+    "iso_dl_110x220mm",
+    "jpn_hagaki_100x148mm",
+    "om_small-photo_100x150mm"
+  };
+  static const int media_sizes[][2] =	/* Sizes of media */
+  {
+    { 21590, 27940 },
+    { 21590, 35560 },
+    { 18415, 26670 },
+    { 10477, 24130 },
+    { 10160, 15240 },
+    { 12700, 17780 },
+    { 21000, 29700 },
+    { 14800, 21000 },
+    { 10500, 14800 },
+    { 11000, 22000 },
+    { 10000, 14800 },
+    { 10000, 15000 }
+  };
+  static const char * const media_types[] =
+  {					/* media-type-supported */
+    "stationery",
+    "stationery-letterhead",
+    "photographic-glossy",
+    "photographic-matte",
+    "envelope"
+  };
+  static const char * const operations_names[] =
+  {					/* Dummy keyword list */
+    "copies",
+    "finishings",
+    "media",
+    "media-col",
+    "multiple-document-handling",
+    "orientation-requested",
+    "output-bin",
+    "print-color-mode",
+    "print-quality",
+    "printer-resolution",
+    "sides"
+  };
+  static const int operations[] =	/* operations-supported */
+  {
+    IPP_OP_PRINT_JOB,
+    IPP_OP_VALIDATE_JOB,
+    IPP_OP_CREATE_JOB,
+    IPP_OP_SEND_DOCUMENT,
+    IPP_OP_CANCEL_JOB,
+    IPP_OP_GET_JOB_ATTRIBUTES,
+    IPP_OP_GET_JOBS,
+    IPP_OP_GET_PRINTER_ATTRIBUTES,
+    IPP_OP_CANCEL_MY_JOBS,
+    IPP_OP_CLOSE_JOB,
+    IPP_OP_IDENTIFY_PRINTER
+  };
+  static const int resolutions[] =	/* printer-resolution-supported */
+  {
+    300,
+    600
+  };
+  static const char * const supply =	/* printer-supply value */
+    "index=1;class=supplyThatIsConsumed;type=toner;maxcapacity=100;level=50;";
+
+
+  response = ippNew();
+  ippSetVersion(response, 2, 0);
+  ippSetStatusCode(response, IPP_STATUS_OK);
+  ippSetRequestId(response, 1);
+
+  ippAddString(response, IPP_TAG_OPERATION, IPP_CONST_TAG(IPP_TAG_CHARSET), "attributes-charset", NULL, "utf-8");
+  ippAddString(response, IPP_TAG_OPERATION, IPP_CONST_TAG(IPP_TAG_LANGUAGE), "attributes-natural-language", NULL, "en");
+
+  ippAddString(response, IPP_TAG_PRINTER, IPP_CONST_TAG(IPP_TAG_KEYWORD), "compression-supported", NULL, "none");
+  ippAddInteger(response, IPP_TAG_PRINTER, IPP_TAG_INTEGER, "copies-default", 1);
+  ippAddRange(response, IPP_TAG_PRINTER, "copies-supported", 1, 999);
+  ippAddString(response, IPP_TAG_PRINTER, IPP_CONST_TAG(IPP_TAG_MIMETYPE), "document-format-default", NULL, "application/octet-stream");
+  ippAddStrings(response, IPP_TAG_PRINTER, IPP_CONST_TAG(IPP_TAG_MIMETYPE), "document-format-supported", (int)(sizeof(formats) / sizeof(formats[0])), NULL, formats);
+  ippAddInteger(response, IPP_TAG_PRINTER, IPP_TAG_ENUM, "finishings-default", IPP_FINISHINGS_NONE);
+  ippAddInteger(response, IPP_TAG_PRINTER, IPP_TAG_ENUM, "finishings-supported", IPP_FINISHINGS_NONE);
+  ippAddStrings(response, IPP_TAG_PRINTER, IPP_CONST_TAG(IPP_TAG_KEYWORD), "job-creation-attributes-supported", (int)(sizeof(operations_names) / sizeof(operations_names[0])), NULL, operations_names);
+  ippAddString(response, IPP_TAG_PRINTER, IPP_CONST_TAG(IPP_TAG_KEYWORD), "media-default", NULL, media[0]);
+  ippAddStrings(response, IPP_TAG_PRINTER, IPP_CONST_TAG(IPP_TAG_KEYWORD), "media-supported", (int)(sizeof(media) / sizeof(media[0])), NULL, media);
+
+  attr = NULL;
+
+  for (i = 0; i < (int)(sizeof(media) / sizeof(media[0])) * (int)(sizeof(media_types) / sizeof(media_types[0])); i ++)
+  {
+    size = ippNew();
+    ippAddInteger(size, IPP_TAG_ZERO, IPP_TAG_INTEGER, "x-dimension", media_sizes[i % 12][0]);
+    ippAddInteger(size, IPP_TAG_ZERO, IPP_TAG_INTEGER, "y-dimension", media_sizes[i % 12][1]);
+
+    col = ippNew();
+    ippAddInteger(col, IPP_TAG_ZERO, IPP_TAG_INTEGER, "media-bottom-margin", 423);
+    ippAddInteger(col, IPP_TAG_ZERO, IPP_TAG_INTEGER, "media-left-margin", 423);
+    ippAddInteger(col, IPP_TAG_ZERO, IPP_TAG_INTEGER, "media-right-margin", 423);
+    ippAddCollection(col, IPP_TAG_ZERO, "media-size", size);
+    ippAddString(col, IPP_TAG_ZERO, IPP_CONST_TAG(IPP_TAG_KEYWORD), "media-source", NULL, "main");
+    ippAddInteger(col, IPP_TAG_ZERO, IPP_TAG_INTEGER, "media-top-margin", 423);
+    ippAddString(col, IPP_TAG_ZERO, IPP_CONST_TAG(IPP_TAG_KEYWORD), "media-type", NULL, media_types[i / 12]);
+
+    if (attr)
+      ippSetCollection(response, &attr, ippGetCount(attr), col);
+    else
+      attr = ippAddCollection(response, IPP_TAG_PRINTER, "media-col-database", col);
+
+    ippDelete(col);
+    ippDelete(size);
+  }
+
+  ippAddStrings(response, IPP_TAG_PRINTER, IPP_CONST_TAG(IPP_TAG_KEYWORD), "media-type-supported", (int)(sizeof(media_types) / sizeof(media_types[0])), NULL, media_types);
+  ippAddIntegers(response, IPP_TAG_PRINTER, IPP_TAG_ENUM, "operations-supported", (int)(sizeof(operations) / sizeof(operations[0])), operations);
+  ippAddString(response, IPP_TAG_PRINTER, IPP_CONST_TAG(IPP_TAG_KEYWORD), "print-color-mode-default", NULL, "auto");
+  ippAddString(response, IPP_TAG_PRINTER, IPP_TAG_TEXT, "printer-info", NULL, "Benchmark Printer");
+  ippAddBoolean(response, IPP_TAG_PRINTER, "printer-is-accepting-jobs", 1);
+  ippAddString(response, IPP_TAG_PRINTER, IPP_TAG_TEXT, "printer-location", NULL, "Lab");
+  ippAddString(response, IPP_TAG_PRINTER, IPP_TAG_TEXT, "printer-make-and-model", NULL, "Example Benchmark Printer");
+  ippAddString(response, IPP_TAG_PRINTER, IPP_TAG_NAME, "printer-name", NULL, "benchmark");
+  ippAddResolutions(response, IPP_TAG_PRINTER, "printer-resolution-supported", (int)(sizeof(resolutions) / sizeof(resolutions[0])), IPP_RES_PER_INCH, resolutions, resolutions);
+  ippAddInteger(response, IPP_TAG_PRINTER, IPP_TAG_ENUM, "printer-state", IPP_PSTATE_IDLE);
+  ippAddString(response, IPP_TAG_PRINTER, IPP_CONST_TAG(IPP_TAG_KEYWORD), "printer-state-reasons", NULL, "none");
+  ippAddInteger(response, IPP_TAG_PRINTER, IPP_TAG_INTEGER, "printer-up-time", 12345);
+
+  for (i = 0; i < 40; i ++)
+  {
+    snprintf(name, sizeof(name), "printer-supply-%02d", i);
+    ippAddOctetString(response, IPP_TAG_PRINTER, name, supply, (int)strlen(supply));
+  }
+
+  ippAddString(response, IPP_TAG_PRINTER, IPP_CONST_TAG(IPP_TAG_URI), "printer-uri-supported", NULL, "ipp://localhost/ipp/print");
+  ippAddString(response, IPP_TAG_PRINTER, IPP_CONST_TAG(IPP_TAG_URI), "printer-uuid", NULL, "urn:uuid:9ba4f2a4-76d9-3b8c-76b3-bcb6a8e285a5");
+  ippAddString(response, IPP_TAG_PRINTER, IPP_CONST_TAG(IPP_TAG_KEYWORD), "sides-default", NULL, "one-sided");
+  ippAddString(response, IPP_TAG_PRINTER, IPP_CONST_TAG(IPP_TAG_KEYWORD), "sides-supported", NULL, "one-sided");
+
+  return (response);
+}
+
+
+/*
+ * 'read_cb()' - Read data from a buffer.
+ */
+
+static ssize_t				/* O - Number of bytes read */
+read_cb(bench_buffer_t *buf,		/* I - Buffer */
+        unsigned char  *buffer,		/* O - Bytes */
+        size_t         bytes)		/* I - Number of bytes to read */
+{
+  size_t	count;			/* Number of bytes */
+
+
+  if ((count = buf->used - buf->pos) > bytes)
+    count = bytes;
+
+  memcpy(buffer, buf->data + buf->pos, count);
+  buf->pos += count;
+
+  return ((ssize_t)count);
+}
+
+
+/*
+ * 'run_bench()' - Calibrate and time a benchmark.
+ */
+
+static int				/* O - 1 on success, 0 on failure */
+run_bench(bench_data_t  *data,		/* I - Benchmark data */
+          const bench_t *bench,		/* I - Benchmark */
+          int           repeat,		/* I - Number of timed runs */
+          double        mintime)	/* I - Minimum time per run */
+{
+  int		i, j;			/* Looping vars */
+  int		iterations;		/* Calls per run */
+  double	start,			/* Start time */
+		elapsed,		/* Elapsed time */
+		*times;			/* Time per operation for each run */
+
+
+ /*
+  * Double the number of calls until a run takes at least "mintime"
+  * seconds...
+  */
+
+  for (iterations = 1;; iterations *= 2)
+  {
+    data->current = 0;
+    start         = get_seconds();
+
+    for (j = 0; j < iterations; j ++)
+      if (!(bench->func)(data))
+        return (0);
+
+    if ((elapsed = get_seconds() - start) >= mintime || iterations >= 0x20000000)
+      break;
+  }
+
+ /*
+  * Then do the timed runs...
+  */
+
+  if ((times = calloc((size_t)repeat, sizeof(double))) == NULL)
+    return (0);
+
+  for (i = 0; i < repeat; i ++)
+  {
+    data->current = 0;
+    start         = get_seconds();
+
+    for (j = 0; j < iterations; j ++)
+      if (!(bench->func)(data))
+      {
+        free(times);
+        return (0);
+      }
+
+    times[i] = 1000000000.0 * (get_seconds() - start) / ((double)iterations * bench->ops);
+  }
+
+  qsort(times, (size_t)repeat, sizeof(double), (int (*)(const void *, const void *))compare_doubles);
+
+  printf("%s,%d,%.1f,%.1f,%.1f\n", bench->name, iterations * bench->ops, times[0], times[repeat / 2], times[repeat - 1]);
+  fflush(stdout);
+
+  free(times);
+
+  return (1);
+}
+
+
+/*
+ * 'setup_data()' - Prepare the benchmark data.
+ */
+
+static int				/* O - 1 on success, 0 on failure */
+setup_data(bench_data_t *data)		/* I - Benchmark data */
+{
+  int			i;		/* Looping var */
+  ipp_attribute_t	*attr;		/* Current attribute */
+  cups_file_t		*fp;		/* Text file */
+  char			word[256];	/* Generated word */
+
+
+  memset(data, 0, sizeof(bench_data_t));
+
+ /*
+  * IPP response and encoded copy...
+  */
+
+  data->response = make_response();
+
+  for (attr = ippFirstAttribute(data->response); attr; attr = ippNextAttribute(data->response))
+    data->num_names ++;
+
+  if ((data->names = calloc((size_t)data->num_names, sizeof(char *))) == NULL)
+    return (0);
+
+  for (i = 0, attr = ippFirstAttribute(data->response); attr; attr = ippNextAttribute(data->response))
+    data->names[i ++] = ippGetName(attr);
+
+  data->ippbuf.size = ippLength(data->response) + 1024;
+  if ((data->ippbuf.data = malloc(data->ippbuf.size)) == NULL)
+    return (0);
+
+  if (!bench_ipp_write(data))
+  {
+    fputs("benchcups: Unable to encode IPP response.\n", stderr);
+    return (0);
+  }
+
+ /*
+  * Words for the array and string pool, in a shuffled order...
+  */
+
+  data->array = cupsArrayNew((cups_array_func_t)strcmp, NULL);
+
+  for (i = 0; i < BENCH_NUM_WORDS; i ++)
+  {
+    snprintf(word, sizeof(word), "media-%05d-%s", (i * 7919) % BENCH_NUM_WORDS, (i & 1) ? "glossy" : "matte");
+    data->words[i] = strdup(word);
+    cupsArrayAdd(data->array, data->words[i]);
+  }
+
+ /*
+  * Raster page: US Letter, 8-bit grayscale at 150dpi...
+  */
+
+  if (!cupsRasterInitPWGHeader(&data->header, pwgMediaForPWG("na_letter_8.5x11in"), "sgray_8", 150, 150, "one-sided", NULL))
+  {
+    fprintf(stderr, "benchcups: Unable to initialize raster header: %s\n", cupsLastErrorString());
+    return (0);
+  }
+
+  data->rasbuf.size = 2 * data->header.cupsBytesPerLine * data->header.cupsHeight + 4096;
+  data->line        = malloc(data->header.cupsBytesPerLine);
+  data->rasbuf.data = malloc(data->rasbuf.size);
+
+  if (!data->line || !data->rasbuf.data)
+    return (0);
+
+  if (!bench_raster_write(data))
+  {
+    fputs("benchcups: Unable to encode raster page.\n", stderr);
+    return (0);
+  }
+
+ /*
+  * Text file with configuration-style lines...
+  */
+
+  if ((fp = cupsTempFile2(data->filename, sizeof(data->filename))) == NULL)
+  {
+    fprintf(stderr, "benchcups: Unable to create temporary file: %s\n", cupsLastErrorString());
+    return (0);
+  }
+
+  for (i = 0; i < BENCH_NUM_LINES; i ++)
+    cupsFilePrintf(fp, "Attr keyword media-%05d na_letter_8.5x11in,iso_a4_210x297mm,na_legal_8.5x14in\n", i);
+
+  cupsFileClose(fp);
+
+  return (1);
+}
+
+
+/*
+ * 'usage()' - Show program usage.
+ */
+
+static void
+usage(void)
+{
+  int	i;				/* Looping var */
+
+
+  puts("Usage: ./benchcups [-r REPEAT] [-t SECONDS] [BENCHMARK ...]");
+  puts("Benchmarks:");
+  for (i = 0; i < (int)(sizeof(benchmarks) / sizeof(benchmarks[0])); i ++)
+    printf("  %s\n", benchmarks[i].name);
+
+  exit(1);
+}
+
+
+/*
+ * 'write_cb()' - Write data to a buffer.
+ */
+
+static ssize_t				/* O - Number of bytes written */
+write_cb(bench_buffer_t *buf,		/* I - Buffer */
+         unsigned char  *buffer,	/* I - Bytes */
+         size_t         bytes)		/* I - Number of bytes to write */
+{
+  size_t	count;			/* Number of bytes */
+
+
+  if ((count = buf->size - buf->used) > bytes)
+    count = bytes;
+
+  memcpy(buf->data + buf->used, buffer, count);
+  buf->used += count;
+
+  return ((ssize_t)count);
+}
@@ -0,0 +1,711 @@
+/*
+ * IPP server load generator for CUPS.
+ *
+ * Copyright © 2014-2019 by Apple Inc.
+ *
+ * Licensed under Apache License v2.0.  See the file "LICENSE" for more
+ * information.
+ *
+ * Usage:
+ *
+ *   ./benchipp [-c CLIENTS] [-d SECONDS] [-f FILENAME] [-m MIX] [-p PID]
+ *              PRINTER-URI [... PRINTER-URI]
+ *
+ * Each client thread opens its own connection and sends a weighted random mix
+ * of Get-Printer-Attributes, Print-Job, Get-Jobs, and Get-Notifications
+ * requests to the listed printers until the duration expires.  Results are
+ * written to the standard output as CSV with one line per operation and a
+ * final "total" line:
+ *
+ *   operation,requests,errors,requests-per-second,p50-ms,p90-ms,p99-ms,
+ *   max-ms,peak-rss-kb,peak-threads
+ *
+ * The last two columns are only reported with "-p" on the total line, and come
+ * from sampling /proc/PID/status while the clients run.
+ */
+
+/*
+ * Include necessary headers...
+ */
+
+#include "cups-private.h"
+#include "thread-private.h"
+#ifndef _WIN32
+#  include <unistd.h>
+#endif /* !_WIN32 */
+
+
+/*
+ * Constants...
+ */
+
+enum
+{
+  BENCH_OP_GET_PRINTER_ATTRIBUTES,	/* Get-Printer-Attributes */
+  BENCH_OP_PRINT_JOB,			/* Print-Job */
+  BENCH_OP_GET_JOBS,			/* Get-Jobs */
+  BENCH_OP_GET_NOTIFICATIONS,		/* Get-Notifications */
+  BENCH_OP_MAX
+};
+
+
+/*
+ * Local types...
+ */
+
+typedef struct bench_times_s		/**** Latencies for one operation ****/
+{
+  int		count,			/* Number of requests */
+		alloc_count,		/* Allocated latencies */
+		errors;			/* Number of errors */
+  double	*times;			/* Latencies in milliseconds */
+} bench_times_t;
+
+typedef struct bench_client_s		/**** Client thread data ****/
+{
+  int		number;			/* Client number */
+  unsigned	seed;			/* Random number seed */
+  int		*sub_ids;		/* Subscription ID for each printer */
+  bench_times_t	ops[BENCH_OP_MAX];	/* Latencies for each operation */
+} bench_client_t;
+
+
+/*
+ * Local globals...
+ */
+
+static const char * const bench_names[BENCH_OP_MAX] =
+{					/* Operation names */
+  "get-printer-attributes",
+  "print-job",
+  "get-jobs",
+  "get-notifications"
+};
+static int		bench_weights[BENCH_OP_MAX] = { 6, 2, 2, 0 };
+					/* Operation weights */
+static int		bench_total_weight = 10;
+					/* Sum of weights */
+static double		bench_end;	/* End time */
+static const char	*bench_filename = NULL;
+					/* Print file */
+static char		bench_format[256] = "application/octet-stream";
+					/* Print file format */
+static int		bench_num_uris = 0;
+					/* Number of printers */
+static char		**bench_uris = NULL;
+					/* Printer URIs */
+static char		**bench_resources = NULL;
+					/* Printer resource paths */
+static char		bench_host[256] = "";
+					/* Server hostname */
+static int		bench_port = 0;	/* Server port */
+
+
+/*
+ * Local functions...
+ */
+
+static void	add_time(bench_times_t *t, double msec, int error);
+static int	compare_doubles(double *a, double *b);
+static double	get_seconds(void);
+static int	parse_mix(const char *mix);
+static void	print_times(const char *name, bench_times_t *t, double duration, const char *ps);
+static void	*run_client(bench_client_t *client);
+static int	sample_server(int pid, long *rss, int *threads);
+static int	subscribe(http_t *http, bench_client_t *client);
+static void	usage(void);
+
+
+/*
+ * 'main()' - Run the clients and report the results.
+ */
+
+int					/* O - Exit status */
+main(int  argc,				/* I - Number of command-line arguments */
+     char *argv[])			/* I - Command-line arguments */
+{
+  int		i, j;			/* Looping vars */
+  const char	*opt;			/* Current option */
+  int		num_clients = 4;	/* Number of clients */
+  double	duration = 10.0;	/* Duration in seconds */
+  int		pid = 0;		/* Server process ID */
+  long		rss = 0;		/* Peak RSS in kilobytes */
+  int		threads = 0,		/* Current thread count */
+		peak_threads = 0;	/* Peak thread count */
+  char		scheme[32],		/* URI scheme */
+		userpass[256],		/* URI username:password */
+		host[256],		/* URI hostname */
+		resource[1024],		/* URI resource path */
+		ps[256];		/* Server statistics */
+  int		port;			/* URI port */
+  double	start;			/* Start time */
+  bench_client_t *clients;		/* Client data */
+  _cups_thread_t *tids;			/* Client threads */
+  bench_times_t	total;			/* Total latencies */
+
+
+ /*
+  * Parse command-line...
+  */
+
+  for (i = 1; i < argc; i ++)
+  {
+    if (argv[i][0] == '-')
+    {
+      for (opt = argv[i] + 1; *opt; opt ++)
+      {
+        switch (*opt)
+        {
+          case 'c' : /* -c clients */
+              i ++;
+              if (i >= argc || (num_clients = atoi(argv[i])) < 1)
+                usage();
+              break;
+
+          case 'd' : /* -d seconds */
+              i ++;
+              if (i >= argc || (duration = atof(argv[i])) <= 0.0)
+                usage();
+              break;
+
+          case 'f' : /* -f filename */
+              i ++;
+              if (i >= argc)
+                usage();
+              bench_filename = argv[i];
+              break;
+
+          case 'm' : /* -m operation=weight[,...] */
+              i ++;
+              if (i >= argc || !parse_mix(argv[i]))
+                usage();
+              break;
+
+          case 'p' : /* -p pid */
+              i ++;
+              if (i >= argc || (pid = atoi(argv[i])) < 1)
+                usage();
+              break;
+
+          default :
+              usage();
+        }
+      }
+    }
+    else
+    {
+      if (httpSeparateURI(HTTP_URI_CODING_ALL, argv[i], scheme, sizeof(scheme), userpass, sizeof(userpass), host, sizeof(host), &port, resource, sizeof(resource)) < HTTP_URI_STATUS_OK || strcmp(scheme, "ipp"))
+      {
+        fprintf(stderr, "benchipp: Bad printer URI \"%s\".\n", argv[i]);
+        return (1);
+      }
+
+      if (!bench_host[0])
+      {
+        strlcpy(bench_host, host, sizeof(bench_host));
+        bench_port = port;
+      }
+      else if (strcmp(bench_host, host) || bench_port != port)
+      {
+        fprintf(stderr, "benchipp: Printer URI \"%s\" is not on %s:%d.\n", argv[i], bench_host, bench_port);
+        return (1);
+      }
+
+      if ((bench_uris = realloc(bench_uris, (size_t)(bench_num_uris + 1) * sizeof(char *))) == NULL || (bench_resources = realloc(bench_resources, (size_t)(bench_num_uris + 1) * sizeof(char *))) == NULL)
+      {
+        perror("benchipp: Unable to allocate memory");
+        return (1);
+      }
+
+      bench_uris[bench_num_uris]        = argv[i];
+      bench_resources[bench_num_uris ++] = strdup(resource);
+    }
+  }
+
+  if (!bench_num_uris)
+    usage();
+
+  if (bench_weights[BENCH_OP_PRINT_JOB] > 0)
+  {
+    if (!bench_filename)
+    {
+      fputs("benchipp: Print-Job requests need a file (-f).\n", stderr);
+      return (1);
+    }
+    else if (access(bench_filename, R_OK))
+    {
+      fprintf(stderr, "benchipp: Unable to access \"%s\": %s\n", bench_filename, strerror(errno));
+      return (1);
+    }
+
+    if ((opt = strrchr(bench_filename, '.')) != NULL)
+    {
+      if (!_cups_strcasecmp(opt, ".pdf"))
+        strlcpy(bench_format, "application/pdf", sizeof(bench_format));
+      else if (!_cups_strcasecmp(opt, ".jpg") || !_cups_strcasecmp(opt, ".jpeg"))
+        strlcpy(bench_format, "image/jpeg", sizeof(bench_format));
+      else if (!_cups_strcasecmp(opt, ".pwg"))
+        strlcpy(bench_format, "image/pwg-raster", sizeof(bench_format));
+      else if (!_cups_strcasecmp(opt, ".urf"))
+        strlcpy(bench_format, "image/urf", sizeof(bench_format));
+    }
+  }
+
+ /*
+  * Start the clients...
+  */
+
+  clients = calloc((size_t)num_clients, sizeof(bench_client_t));
+  tids    = calloc((size_t)num_clients, sizeof(_cups_thread_t));
+
+  if (!clients || !tids)
+  {
+    perror("benchipp: Unable to allocate memory");
+    return (1);
+  }
+
+  start     = get_seconds();
+  bench_end = start + duration;
+
+  for (i = 0; i < num_clients; i ++)
+  {
+    clients[i].number = i + 1;
+    clients[i].seed   = (unsigned)(i + 1) * 2654435761U;
+
+    if ((tids[i] = _cupsThreadCreate((_cups_thread_func_t)run_client, clients + i)) == 0)
+    {
+      perror("benchipp: Unable to create client thread");
+      return (1);
+    }
+  }
+
+ /*
+  * Sample the server while the clients are running...
+  */
+
+  while (get_seconds() < bench_end)
+  {
+    if (pid && sample_server(pid, &rss, &threads) && threads > peak_threads)
+      peak_threads = threads;
+
+    usleep(100000);
+  }
+
+  for (i = 0; i < num_clients; i ++)
+    _cupsThreadWait(tids[i]);
+
+  duration = get_seconds() - start;
+
+  if (pid && sample_server(pid, &rss, &threads) && threads > peak_threads)
+    peak_threads = threads;
+
+ /*
+  * Report the results...
+  */
+
+  puts("operation,requests,errors,requests-per-second,p50-ms,p90-ms,p99-ms,max-ms,peak-rss-kb,peak-threads");
+
+  memset(&total, 0, sizeof(total));
+
+  for (j = 0; j < BENCH_OP_MAX; j ++)
+  {
+    bench_times_t	t;		/* Latencies for operation */
+
+    if (!bench_weights[j])
+      continue;
+
+    memset(&t, 0, sizeof(t));
+
+    for (i = 0; i < num_clients; i ++)
+    {
+      bench_times_t *ct = clients[i].ops + j;
+					/* Client latencies */
+      int k;				/* Looping var */
+
+      for (k = 0; k < ct->count; k ++)
+      {
+        add_time(&t, ct->times[k], 0);
+        add_time(&total, ct->times[k], 0);
+      }
+
+      t.errors     += ct->errors;
+      total.errors += ct->errors;
+    }
+
+    print_times(bench_names[j], &t, duration, ",,");
+    free(t.times);
+  }
+
+  if (pid)
+    snprintf(ps, sizeof(ps), ",%ld,%d", rss, peak_threads);
+  else
+    strlcpy(ps, ",,", sizeof(ps));
+
+  print_times("total", &total, duration, ps);
+
+  return (total.count > 0 && !total.errors ? 0 : 1);
+}
+
+
+/*
+ * 'add_time()' - Add a latency.
+ */
+
+static void
+add_time(bench_times_t *t,		/* I - Latencies */
+         double        msec,		/* I - Latency in milliseconds */
+         int           error)		/* I - 1 if the request failed */
+{
+  if (error)
+  {
+    t->errors ++;
+    return;
+  }
+
+  if (t->count >= t->alloc_count)
+  {
+    double	*temp;			/* New latencies */
+    int		alloc_count = t->alloc_count ? 2 * t->alloc_count : 1024;
+					/* New allocation */
+
+    if ((temp = realloc(t->times, (size_t)alloc_count * sizeof(double))) == NULL)
+    {
+      t->errors ++;
+      return;
+    }
+
+    t->times       = temp;
+    t->alloc_count = alloc_count;
+  }
+
+  t->times[t->count ++] = msec;
+}
+
+
+/*
+ * 'compare_doubles()' - Compare two latencies.
+ */
+
+static int				/* O - Result of comparison */
+compare_doubles(double *a,		/* I - First latency */
+                double *b)		/* I - Second latency */
+{
+  if (*a < *b)
+    return (-1);
+  else if (*a > *b)
+    return (1);
+  else
+    return (0);
+}
+
+
+/*
+ * 'get_seconds()' - Get the current time in seconds...
+ */
+
+static double				/* O - Current time in seconds */
+get_seconds(void)
+{
+  struct timeval	curtime;	/* Current time */
+
+
+  gettimeofday(&curtime, NULL);
+  return (curtime.tv_sec + 0.000001 * curtime.tv_usec);
+}
+
+
+/*
+ * 'parse_mix()' - Parse a list of operation weights.
+ */
+
+static int				/* O - 1 on success, 0 on error */
+parse_mix(const char *mix)		/* I - operation=weight[,...] */
+{
+  int		i;			/* Looping var */
+  char		temp[1024],		/* Copy of mix */
+		*start,			/* Start of current operation */
+		*ptr,			/* Pointer into mix */
+		*value;			/* Weight */
+
+
+  strlcpy(temp, mix, sizeof(temp));
+  memset(bench_weights, 0, sizeof(bench_weights));
+  bench_total_weight = 0;
+
+  for (start = temp; start && *start; start = ptr)
+  {
+    if ((ptr = strchr(start, ',')) != NULL)
+      *ptr++ = '\0';
+
+    if ((value = strchr(start, '=')) != NULL)
+      *value++ = '\0';
+
+    for (i = 0; i < BENCH_OP_MAX; i ++)
+      if (!strcmp(start, bench_names[i]))
+        break;
+
+    if (i >= BENCH_OP_MAX)
+    {
+      fprintf(stderr, "benchipp: Unknown operation \"%s\".\n", start);
+      return (0);
+    }
+
+    bench_weights[i]   = value ? atoi(value) : 1;
+    bench_total_weight += bench_weights[i];
+  }
+
+  return (bench_total_weight > 0);
+}
+
+
+/*
+ * 'print_times()' - Show the throughput and latency percentiles.
+ */
+
+static void
+print_times(const char    *name,	/* I - Operation name */
+            bench_times_t *t,		/* I - Latencies */
+            double        duration,	/* I - Duration in seconds */
+            const char    *ps)		/* I - Server statistics columns */
+{
+  if (t->count > 0)
+  {
+    qsort(t->times, (size_t)t->count, sizeof(double), (int (*)(const void *, const void *))compare_doubles);
+
+    printf("%s,%d,%d,%.1f,%.3f,%.3f,%.3f,%.3f%s\n", name, t->count, t->errors, t->count / duration, t->times[t->count / 2], t->times[t->count * 9 / 10], t->times[t->count * 99 / 100], t->times[t->count - 1], ps);
+  }
+  else
+  {
+    printf("%s,0,%d,0.0,,,,%s\n", name, t->errors, ps);
+  }
+}
+
+
+/*
+ * 'run_client()' - Send requests until the duration expires.
+ */
+
+static void *				/* O - Thread exit status */
+run_client(bench_client_t *client)	/* I - Client data */
+{
+  http_t	*http;			/* Connection to server */
+  ipp_t		*request,		/* IPP request */
+		*response;		/* IPP response */
+  int		op,			/* Current operation */
+		weight,			/* Random weight */
+		printer;		/* Current printer */
+  double	start;			/* Start of request */
+  char		username[256];		/* requesting-user-name */
+  static const char * const pattrs[] =	/* Get-Printer-Attributes requested-attributes */
+  {
+    "all",
+    "media-col-database"
+  };
+  static const char * const jattrs[] =	/* Get-Jobs requested-attributes */
+  {
+    "job-id",
+    "job-state",
+    "job-state-reasons"
+  };
+
+
+  if ((http = httpConnect2(bench_host, bench_port, NULL, AF_UNSPEC, HTTP_ENCRYPTION_IF_REQUESTED, 1, 30000, NULL)) == NULL)
+  {
+    fprintf(stderr, "benchipp: Client %d unable to connect to %s:%d: %s\n", client->number, bench_host, bench_port, cupsLastErrorString());
+    client->ops[0].errors ++;
+    return (NULL);
+  }
+
+  snprintf(username, sizeof(username), "bench%d", client->number);
+
+  if (bench_weights[BENCH_OP_GET_NOTIFICATIONS] > 0 && !subscribe(http, client))
+  {
+    httpClose(http);
+    return (NULL);
+  }
+
+  printer = client->number % bench_num_uris;
+
+  while (get_seconds() < bench_end)
+  {
+   /*
+    * Pick the next operation and printer...
+    */
+
+    weight = (int)(rand_r(&client->seed) % (unsigned)bench_total_weight);
+
+    for (op = 0; op < BENCH_OP_MAX; op ++)
+      if ((weight -= bench_weights[op]) < 0)
+        break;
+
+    if (++ printer >= bench_num_uris)
+      printer = 0;
+
+   /*
+    * Send the request...
+    */
+
+    switch (op)
+    {
+      default :
+      case BENCH_OP_GET_PRINTER_ATTRIBUTES :
+          request = ippNewRequest(IPP_OP_GET_PRINTER_ATTRIBUTES);
+          break;
+      case BENCH_OP_PRINT_JOB :
+          request = ippNewRequest(IPP_OP_PRINT_JOB);
+          break;
+      case BENCH_OP_GET_JOBS :
+          request = ippNewRequest(IPP_OP_GET_JOBS);
+          break;
+      case BENCH_OP_GET_NOTIFICATIONS :
+          request = ippNewRequest(IPP_OP_GET_NOTIFICATIONS);
+          break;
+    }
+
+    ippAddString(request, IPP_TAG_OPERATION, IPP_TAG_URI, "printer-uri", NULL, bench_uris[printer]);
+    ippAddString(request, IPP_TAG_OPERATION, IPP_TAG_NAME, "requesting-user-name", NULL, username);
+
+    start = get_seconds();
+
+    switch (op)
+    {
+      default :
+      case BENCH_OP_GET_PRINTER_ATTRIBUTES :
+          ippAddStrings(request, IPP_TAG_OPERATION, IPP_TAG_KEYWORD, "requested-attributes", (int)(sizeof(pattrs) / sizeof(pattrs[0])), NULL, pattrs);
+          response = cupsDoRequest(http, request, bench_resources[printer]);
+          break;
+
+      case BENCH_OP_PRINT_JOB :
+          ippAddString(request, IPP_TAG_OPERATION, IPP_TAG_MIMETYPE, "document-format", NULL, bench_format);
+          ippAddString(request, IPP_TAG_OPERATION, IPP_TAG_NAME, "job-name", NULL, "benchipp");
+          response = cupsDoFileRequest(http, request, bench_resources[printer], bench_filename);
+          break;
+
+      case BENCH_OP_GET_JOBS :
+          ippAddString(request, IPP_TAG_OPERATION, IPP_CONST_TAG(IPP_TAG_KEYWORD), "which-jobs", NULL, "all");
+          ippAddStrings(request, IPP_TAG_OPERATION, IPP_TAG_KEYWORD, "requested-attributes", (int)(sizeof(jattrs) / sizeof(jattrs[0])), NULL, jattrs);
+          response = cupsDoRequest(http, request, bench_resources[printer]);
+          break;
+
+      case BENCH_OP_GET_NOTIFICATIONS :
+          ippAddInteger(request, IPP_TAG_OPERATION, IPP_TAG_INTEGER, "notify-subscription-ids", client->sub_ids[printer]);
+          ippAddBoolean(request, IPP_TAG_OPERATION, "notify-wait", 0);
+          response = cupsDoRequest(http, request, bench_resources[printer]);
+          break;
+    }
+
+    add_time(client->ops + op, 1000.0 * (get_seconds() - start), cupsLastError() > IPP_STATUS_OK_EVENTS_COMPLETE);
+
+    ippDelete(response);
+  }
+
+  httpClose(http);
+
+  return (NULL);
+}
+
+
+/*
+ * 'sample_server()' - Get the peak RSS and current thread count of the server.
+ */
+
+static int				/* O - 1 on success, 0 on error */
+sample_server(int  pid,			/* I - Process ID */
+              long *rss,		/* O - Peak RSS in kilobytes */
+              int  *threads)		/* O - Number of threads */
+{
+#ifdef __linux__
+  cups_file_t	*fp;			/* /proc/PID/status file */
+  char		filename[256],		/* Filename */
+		line[256];		/* Line from file */
+
+
+  snprintf(filename, sizeof(filename), "/proc/%d/status", pid);
+  if ((fp = cupsFileOpen(filename, "r")) == NULL)
+    return (0);
+
+  while (cupsFileGets(fp, line, sizeof(line)))
+  {
+    if (!strncmp(line, "VmHWM:", 6))
+      *rss = atol(line + 6);
+    else if (!strncmp(line, "Threads:", 8))
+      *threads = atoi(line + 8);
+  }
+
+  cupsFileClose(fp);
+
+  return (1);
+
+#else
+  (void)pid;
+  (void)rss;
+  (void)threads;
+
+  return (0);
+#endif /* __linux__ */
+}
+
+
+/*
+ * 'subscribe()' - Create a pull subscription on each printer.
+ */
+
+static int				/* O - 1 on success, 0 on error */
+subscribe(http_t         *http,		/* I - Connection to server */
+          bench_client_t *client)	/* I - Client data */
+{
+  int		i;			/* Looping var */
+  ipp_t		*request,		/* IPP request */
+		*response;		/* IPP response */
+  char		username[256];		/* requesting-user-name */
+
+
+  if ((client->sub_ids = calloc((size_t)bench_num_uris, sizeof(int))) == NULL)
+    return (0);
+
+  snprintf(username, sizeof(username), "bench%d", client->number);
+
+  for (i = 0; i < bench_num_uris; i ++)
+  {
+    request = ippNewRequest(IPP_OP_CREATE_PRINTER_SUBSCRIPTIONS);
+    ippAddString(request, IPP_TAG_OPERATION, IPP_TAG_URI, "printer-uri", NULL, bench_uris[i]);
+    ippAddString(request, IPP_TAG_OPERATION, IPP_TAG_NAME, "requesting-user-name", NULL, username);
+    ippAddString(request, IPP_TAG_SUBSCRIPTION, IPP_CONST_TAG(IPP_TAG_KEYWORD), "notify-pull-method", NULL, "ippget");
+    ippAddString(request, IPP_TAG_SUBSCRIPTION, IPP_CONST_TAG(IPP_TAG_KEYWORD), "notify-events", NULL, "all");
+    ippAddInteger(request, IPP_TAG_SUBSCRIPTION, IPP_TAG_INTEGER, "notify-lease-duration", 0);
+
+    response = cupsDoRequest(http, request, bench_resources[i]);
+
+    if (cupsLastError() > IPP_STATUS_OK_EVENTS_COMPLETE || (client->sub_ids[i] = ippGetInteger(ippFindAttribute(response, "notify-subscription-id", IPP_TAG_INTEGER), 0)) <= 0)
+    {
+      fprintf(stderr, "benchipp: Client %d unable to subscribe to \"%s\": %s\n", client->number, bench_uris[i], cupsLastErrorString());
+      ippDelete(response);
+      client->ops[BENCH_OP_GET_NOTIFICATIONS].errors ++;
+      return (0);
+    }
+
+    ippDelete(response);
+  }
+
+  return (1);
+}
+
+
+/*
+ * 'usage()' - Show program usage.
+ */
+
+static void
+usage(void)
+{
+  puts("Usage: ./benchipp [options] PRINTER-URI [... PRINTER-URI]");
+  puts("Options:");
+  puts("  -c CLIENTS     Number of concurrent clients (default 4)");
+  puts("  -d SECONDS     Duration of the run (default 10)");
+  puts("  -f FILENAME    File to send with Print-Job requests");
+  puts("  -m MIX         Operation weights, e.g. \"get-printer-attributes=6,print-job=2,get-jobs=2\"");
+  puts("                 Operations: get-printer-attributes print-job get-jobs get-notifications");
+  puts("  -p PID         Server process to sample for peak RSS and thread count");
+
+  exit(1);
+}
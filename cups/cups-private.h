@@ -139,9 +139,6 @@ typedef struct _cups_globals_s		/**** CUPS global state data ****/
 #  endif /* __APPLE__ */
 
   /* pwg-media.c */
-  cups_array_t		*leg_size_lut,	/* Lookup table for legacy names */
-			*ppd_size_lut,	/* Lookup table for PPD names */
-			*pwg_size_lut;	/* Lookup table for PWG names */
   pwg_media_t		pwg_media;	/* PWG media data for custom size */
   char			pwg_name[65],	/* PWG media name for custom size */
 			ppd_name[41];	/* PPD media name for custom size */
@@ -183,6 +180,7 @@ typedef struct _cups_globals_s		/**** CUPS global state data ****/
   void			*server_cert_data;
 					/* Server certificate user data */
   int			server_version,	/* Server IPP version */
+			discovery_cache,/* Discovery cache lifetime in seconds */
 			trust_first,	/* Trust on first use? */
 			any_root,	/* Allow any (e.g., self-signed) root */
 			expired_certs,	/* Allow expired certs */
@@ -256,6 +256,10 @@ typedef struct cups_dest_s		/**** Destination ****/
   cups_option_t	*options;		/* Options */
 } cups_dest_t;
 
+typedef struct _cups_async_s cups_async_t;
+					/* Asynchronous request context
+					 * @since CUPS 2.3@ */
+
 typedef struct _cups_dinfo_s cups_dinfo_t;
 					/* Destination capability and status
 					 * information @since CUPS 1.6/macOS 10.8@ */
@@ -291,6 +295,11 @@ typedef struct cups_size_s		/**** Media Size @since CUPS 1.6/macOS 10.8@ ****/
 					 * millimeters */
 } cups_size_t;
 
+typedef void (*cups_async_cb_t)(cups_async_t *async, http_t *http,
+				ipp_t *response, void *user_data);
+					/* Asynchronous request completion
+					 * callback @since CUPS 2.3@ */
+
 typedef int (*cups_client_cert_cb_t)(http_t *http, void *tls,
 				     cups_array_t *distinguished_names,
 				     void *user_data);
@@ -602,6 +611,10 @@ extern const char	*cupsHashString(const unsigned char *hash, size_t hashsize, ch
 
 /* New in CUPS 2.3 */
 extern int		cupsAddDestMediaOptions(http_t *http, cups_dest_t *dest, cups_dinfo_t *dinfo, unsigned flags, cups_size_t *size, int num_options, cups_option_t **options) _CUPS_API_2_3;
+extern void		cupsAsyncDelete(cups_async_t *async) _CUPS_API_2_3;
+extern int		cupsAsyncDoRequest(cups_async_t *async, http_t *http, ipp_t *request, const char *resource, cups_async_cb_t cb, void *user_data) _CUPS_API_2_3;
+extern cups_async_t	*cupsAsyncNew(void) _CUPS_API_2_3;
+extern int		cupsAsyncProcess(cups_async_t *async, int msec) _CUPS_API_2_3;
 extern ipp_attribute_t	*cupsEncodeOption(ipp_t *ipp, ipp_tag_t group_tag, const char *name, const char *value) _CUPS_API_2_3;
 
 #  ifdef __cplusplus
@@ -66,6 +66,30 @@ extern "C" {
 #  endif /* DEBUG */
 
 
+/*
+ * The trace macros add static (USDT) tracepoints for SystemTap, DTrace, and
+ * bpftrace when <sys/sdt.h> is available, and otherwise compile to nothing.
+ *
+ * Usage:
+ *
+ *   _CUPS_TRACE1(name, arg)
+ *   _CUPS_TRACE2(name, arg, arg)
+ *
+ * All libcups probes use the "libcups" provider.  Double underscores in the
+ * probe name are shown as dashes by the tracing tools, so "ipp__read__start"
+ * is the "ipp-read-start" probe.
+ */
+
+#  ifdef HAVE_SYS_SDT_H
+#    include <sys/sdt.h>
+#    define _CUPS_TRACE1(name,a) DTRACE_PROBE1(libcups, name, a)
+#    define _CUPS_TRACE2(name,a,b) DTRACE_PROBE2(libcups, name, a, b)
+#  else
+#    define _CUPS_TRACE1(name,a)
+#    define _CUPS_TRACE2(name,a,b)
+#  endif /* HAVE_SYS_SDT_H */
+
+
 /*
  * Prototypes...
  */
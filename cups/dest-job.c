@@ -14,6 +14,13 @@
 #include "debug-internal.h"
 
 
+/*
+ * Local functions...
+ */
+
+static const char	*cups_compression(cups_dinfo_t *info, const char *format, int num_options, cups_option_t *options);
+
+
 /*
  * 'cupsCancelDestJob()' - Cancel a job on a destination.
  *
@@ -301,6 +308,12 @@ cupsFinishDestDocument(
  * if this is the last document to be submitted in the job.  Returns
  * @code HTTP_CONTINUE@ on success.
  *
+ * Raster, PCL, PostScript, and text documents are compressed with gzip (or
+ * deflate) while they are written when the destination lists the coding in
+ * "compression-supported".  No compression is done when the options include
+ * "compression" -- a value of "none" disables it and any other value means the
+ * document data is already compressed.
+ *
  * @since CUPS 1.6/macOS 10.8@
  */
 
@@ -318,6 +331,7 @@ cupsStartDestDocument(
 {
   ipp_t		*request;		/* Send-Document request */
   http_status_t	status;			/* HTTP status */
+  const char	*compression;		/* Content coding for document data */
 
 
   DEBUG_printf(("cupsStartDestDocument(http=%p, dest=%p(%s/%s), info=%p, job_id=%d, docname=\"%s\", format=\"%s\", num_options=%d, options=%p, last_document=%d)", (void *)http, (void *)dest, dest ? dest->name : NULL, dest ? dest->instance : NULL, (void *)info, job_id, docname, format, num_options, (void *)options, last_document));
@@ -370,13 +384,77 @@ cupsStartDestDocument(
   cupsEncodeOptions2(request, num_options, options, IPP_TAG_OPERATION);
   cupsEncodeOptions2(request, num_options, options, IPP_TAG_DOCUMENT);
 
+  if ((compression = cups_compression(info, format, num_options, options)) != NULL)
+    ippAddString(request, IPP_TAG_OPERATION, IPP_TAG_KEYWORD, "compression", NULL, compression);
+
  /*
-  * Send and delete the request, then return the status...
+  * Send and delete the request, then start compressing the document data as
+  * needed and return the status...
   */
 
   status = cupsSendRequest(http, request, info->resource, CUPS_LENGTH_VARIABLE);
 
   ippDelete(request);
 
+  if (status == HTTP_STATUS_CONTINUE && compression)
+  {
+    DEBUG_printf(("1cupsStartDestDocument: Compressing document data with %s.", compression));
+    httpSetField(http, HTTP_FIELD_CONTENT_ENCODING, compression);
+  }
+
   return (status);
 }
+
+
+/*
+ * 'cups_compression()' - Choose how to compress document data.
+ */
+
+static const char *			/* O - "gzip", "deflate", or `NULL` for none */
+cups_compression(
+    cups_dinfo_t  *info,		/* I - Destination information */
+    const char    *format,		/* I - Document format */
+    int           num_options,		/* I - Number of document options */
+    cups_option_t *options)		/* I - Document options */
+{
+#ifdef HAVE_LIBZ
+  ipp_attribute_t	*supported;	/* compression-supported */
+  static const char * const formats[] =	/* Formats that compress well */
+  {
+    "application/postscript",
+    "application/vnd.hp-pcl",
+    "application/vnd.hp-pclxl",
+    "image/pwg-raster",
+    "image/urf"
+  };
+  size_t		i;		/* Looping var */
+
+
+  if (!format || cupsGetOption("compression", num_options, options))
+    return (NULL);
+
+  for (i = 0; i < (sizeof(formats) / sizeof(formats[0])); i ++)
+    if (!_cups_strcasecmp(format, formats[i]))
+      break;
+
+  if (i >= (sizeof(formats) / sizeof(formats[0])) && _cups_strncasecmp(format, "text/", 5))
+    return (NULL);
+
+  supported = ippFindAttribute(info->attrs, "compression-supported", IPP_TAG_KEYWORD);
+
+  if (ippContainsString(supported, "gzip"))
+    return ("gzip");
+  else if (ippContainsString(supported, "deflate"))
+    return ("deflate");
+  else
+    return (NULL);
+
+#else
+  (void)info;
+  (void)format;
+  (void)num_options;
+  (void)options;
+
+  return (NULL);
+#endif /* HAVE_LIBZ */
+}
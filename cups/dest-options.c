@@ -19,9 +19,69 @@
  * Local constants...
  */
 
+#define _CUPS_DINFO_CACHE_MAX	32	/* Maximum cached destinations */
 #define _CUPS_MEDIA_READY_TTL	30	/* Life of xxx-ready values */
 
 
+/*
+ * Local types...
+ */
+
+typedef struct _cups_dcache_s		/* Cached printer attributes */
+{
+  char		*uri,			/* Printer URI */
+		*resource,		/* Resource path */
+		*user,			/* Requesting user name */
+		*auth;			/* Authentication scheme */
+  int		version;		/* IPP version */
+  ipp_t		*attrs;			/* Printer attributes */
+  time_t	validated;		/* Time attributes were last validated */
+  int		config_time;		/* printer-config-change-time value */
+  ipp_uchar_t	config_date[11];	/* printer-config-change-date-time value */
+  int		have_config;		/* Have a printer-config-change-xxx value? */
+} _cups_dcache_t;
+
+
+/*
+ * Local globals...
+ */
+
+static cups_array_t	*cups_dcache = NULL;
+					/* Cache of printer attributes */
+static _cups_mutex_t	cups_dcache_mutex = _CUPS_MUTEX_INITIALIZER;
+					/* Mutex for cache */
+static const char * const cups_dcache_volatile[] =
+{					/* Attributes that are always refetched */
+  "marker-change-time",
+  "marker-colors",
+  "marker-high-levels",
+  "marker-levels",
+  "marker-low-levels",
+  "marker-message",
+  "marker-names",
+  "marker-types",
+  "media-col-ready",
+  "media-ready",
+  "printer-alert",
+  "printer-alert-description",
+  "printer-config-change-date-time",
+  "printer-config-change-time",
+  "printer-current-time",
+  "printer-input-tray",
+  "printer-is-accepting-jobs",
+  "printer-output-tray",
+  "printer-state",
+  "printer-state-change-date-time",
+  "printer-state-change-time",
+  "printer-state-message",
+  "printer-state-reasons",
+  "printer-supply",
+  "printer-supply-description",
+  "printer-up-time",
+  "queued-job-count"
+};
+
+
 /*
  * Local functions...
  */
@@ -40,6 +100,20 @@ static void		cups_create_constraints(cups_dinfo_t *dinfo);
 static void		cups_create_defaults(cups_dinfo_t *dinfo);
 static void		cups_create_media_db(cups_dinfo_t *dinfo,
 			                     unsigned flags);
+static void		cups_dcache_add(http_t *http, const char *uri,
+			                const char *resource, int version,
+			                ipp_t *attrs);
+static int		cups_dcache_compare(_cups_dcache_t *a,
+			                    _cups_dcache_t *b);
+static ipp_t		*cups_dcache_copy(http_t *http, const char *uri,
+			                  const char *resource, int *version);
+static int		cups_dcache_copy_cb(void *context, ipp_t *dst,
+			                    ipp_attribute_t *attr);
+static void		cups_dcache_free(_cups_dcache_t *dc);
+static int		cups_dcache_get_config(ipp_t *attrs, int *config_time,
+			                       ipp_uchar_t *config_date);
+static void		cups_dcache_key(http_t *http, _cups_dcache_t *key,
+			                char *auth, size_t authsize);
 static void		cups_free_media_db(_cups_media_db_t *mdb);
 static int		cups_get_media_db(http_t *http, cups_dinfo_t *dinfo,
 			                  pwg_media_t *pwg, unsigned flags,
@@ -668,6 +742,12 @@ cupsCopyDestConflicts(
  * The caller is responsible for calling @link cupsFreeDestInfo@ on the return
  * value. @code NULL@ is returned on error.
  *
+ * The printer attributes are cached for each printer, user, and authentication
+ * scheme.  A cached copy is only used when the printer reports the same
+ * "printer-config-change-date-time" and "printer-config-change-time" values,
+ * and the printer state, marker, media ready, and other changing attributes are
+ * always requested again.
+ *
  * @since CUPS 1.6/macOS 10.8@
  */
 
@@ -743,6 +823,16 @@ cupsCopyDestInfo(
     return (NULL);
   }
 
+ /*
+  * Use the cached attributes, if still current...
+  */
+
+  if ((response = cups_dcache_copy(http, uri, resource, &version)) != NULL)
+  {
+    DEBUG_puts("1cupsCopyDestInfo: Using cached printer attributes.");
+    goto create_dinfo;
+  }
+
  /*
   * Get the supported attributes...
   */
@@ -798,10 +888,14 @@ cupsCopyDestInfo(
     return (NULL);
   }
 
+  cups_dcache_add(http, uri, resource, version, response);
+
  /*
   * Allocate a cups_dinfo_t structure and return it...
   */
 
+  create_dinfo:
+
   if ((dinfo = calloc(1, sizeof(cups_dinfo_t))) == NULL)
   {
     _cupsSetError(IPP_STATUS_ERROR_INTERNAL, strerror(errno), 0);
@@ -2247,6 +2341,326 @@ cups_create_media_db(
 }
 
 
+/*
+ * 'cups_dcache_add()' - Add printer attributes to the cache.
+ *
+ * Printers that don't report their configuration changes are not cached.
+ */
+
+static void
+cups_dcache_add(http_t     *http,	/* I - Connection to destination */
+                const char *uri,	/* I - Printer URI */
+                const char *resource,	/* I - Resource path */
+                int        version,	/* I - IPP version */
+                ipp_t      *attrs)	/* I - Printer attributes */
+{
+  _cups_dcache_t	key,		/* Search key */
+			*dc,		/* Cache entry */
+			*oldest;	/* Oldest cache entry */
+  char			auth[33];	/* Authentication scheme */
+  int			config_time;	/* printer-config-change-time value */
+  ipp_uchar_t		config_date[11];/* printer-config-change-date-time value */
+  int			have_config;	/* Have config values? */
+
+
+  if ((have_config = cups_dcache_get_config(attrs, &config_time, config_date)) == 0)
+    return;
+
+  key.uri      = (char *)uri;
+  key.resource = (char *)resource;
+
+  cups_dcache_key(http, &key, auth, sizeof(auth));
+
+  _cupsMutexLock(&cups_dcache_mutex);
+
+  if (!cups_dcache)
+    cups_dcache = cupsArrayNew3((cups_array_func_t)cups_dcache_compare, NULL, NULL, 0, NULL, (cups_afree_func_t)cups_dcache_free);
+
+  if ((dc = (_cups_dcache_t *)cupsArrayFind(cups_dcache, &key)) != NULL)
+  {
+    cupsArrayRemove(cups_dcache, dc);
+  }
+  else if (cupsArrayCount(cups_dcache) >= _CUPS_DINFO_CACHE_MAX)
+  {
+   /*
+    * Make room by removing the least recently validated entry...
+    */
+
+    for (oldest = dc = (_cups_dcache_t *)cupsArrayFirst(cups_dcache); dc; dc = (_cups_dcache_t *)cupsArrayNext(cups_dcache))
+      if (dc->validated < oldest->validated)
+        oldest = dc;
+
+    cupsArrayRemove(cups_dcache, oldest);
+  }
+
+  if ((dc = calloc(1, sizeof(_cups_dcache_t))) != NULL)
+  {
+    dc->uri         = strdup(uri);
+    dc->resource    = strdup(resource);
+    dc->user        = strdup(key.user);
+    dc->auth        = strdup(key.auth);
+    dc->version     = version;
+    dc->attrs       = ippNew();
+    dc->validated   = time(NULL);
+    dc->config_time = config_time;
+    dc->have_config = have_config;
+
+    memcpy(dc->config_date, config_date, sizeof(dc->config_date));
+
+    if (dc->uri && dc->resource && dc->user && dc->auth && dc->attrs && ippCopyAttributes(dc->attrs, attrs, 0, NULL, NULL))
+      cupsArrayAdd(cups_dcache, dc);
+    else
+      cups_dcache_free(dc);
+  }
+
+  _cupsMutexUnlock(&cups_dcache_mutex);
+}
+
+
+/*
+ * 'cups_dcache_compare()' - Compare two cache entries.
+ */
+
+static int				/* O - Result of comparison */
+cups_dcache_compare(_cups_dcache_t *a,	/* I - First cache entry */
+                    _cups_dcache_t *b)	/* I - Second cache entry */
+{
+  int	result;				/* Result of comparison */
+
+
+  if ((result = strcmp(a->uri, b->uri)) == 0)
+    if ((result = strcmp(a->resource, b->resource)) == 0)
+      if ((result = strcmp(a->user, b->user)) == 0)
+        result = strcmp(a->auth, b->auth);
+
+  return (result);
+}
+
+
+/*
+ * 'cups_dcache_copy()' - Copy cached printer attributes, refreshing the
+ *                        changing attributes.
+ *
+ * Returns @code NULL@ when the attributes are not cached or when the printer
+ * configuration has changed since they were cached.
+ */
+
+static ipp_t *				/* O - Copy of printer attributes or @code NULL@ */
+cups_dcache_copy(http_t     *http,	/* I - Connection to destination */
+                 const char *uri,	/* I - Printer URI */
+                 const char *resource,	/* I - Resource path */
+                 int        *version)	/* O - IPP version */
+{
+  _cups_dcache_t	key,		/* Search key */
+			*dc;		/* Cache entry */
+  char			auth[33];	/* Authentication scheme */
+  ipp_t			*request,	/* Get-Printer-Attributes request */
+			*current,	/* Current printer attributes */
+			*response;	/* Copy of attributes */
+  int			dc_version,	/* IPP version of cached attributes */
+			have_config,	/* Have config values? */
+			config_time,	/* Cached printer-config-change-time */
+			new_time;	/* Current printer-config-change-time */
+  ipp_uchar_t		config_date[11],/* Cached printer-config-change-date-time */
+			new_date[11];	/* Current printer-config-change-date-time */
+
+
+  key.uri      = (char *)uri;
+  key.resource = (char *)resource;
+
+  cups_dcache_key(http, &key, auth, sizeof(auth));
+
+  _cupsMutexLock(&cups_dcache_mutex);
+
+  if ((dc = (_cups_dcache_t *)cupsArrayFind(cups_dcache, &key)) == NULL)
+  {
+    _cupsMutexUnlock(&cups_dcache_mutex);
+    return (NULL);
+  }
+
+  dc_version  = dc->version;
+  have_config = dc->have_config;
+  config_time = dc->config_time;
+
+  memcpy(config_date, dc->config_date, sizeof(config_date));
+
+  _cupsMutexUnlock(&cups_dcache_mutex);
+
+ /*
+  * Ask the printer for its current configuration change values and the
+  * attributes that change without a configuration change...
+  */
+
+  DEBUG_printf(("2cups_dcache_copy: Revalidating cached attributes for \"%s\".", uri));
+
+  request = ippNewRequest(IPP_OP_GET_PRINTER_ATTRIBUTES);
+
+  ippSetVersion(request, dc_version / 10, dc_version % 10);
+  ippAddString(request, IPP_TAG_OPERATION, IPP_TAG_URI, "printer-uri", NULL, uri);
+  ippAddString(request, IPP_TAG_OPERATION, IPP_TAG_NAME, "requesting-user-name", NULL, cupsUser());
+  ippAddStrings(request, IPP_TAG_OPERATION, IPP_TAG_KEYWORD, "requested-attributes", (int)(sizeof(cups_dcache_volatile) / sizeof(cups_dcache_volatile[0])), NULL, cups_dcache_volatile);
+
+  current = cupsDoRequest(http, request, resource);
+
+  if (cupsLastError() > IPP_STATUS_OK_IGNORED_OR_SUBSTITUTED || cups_dcache_get_config(current, &new_time, new_date) != have_config || ((have_config & 1) && new_time != config_time) || ((have_config & 2) && memcmp(new_date, config_date, sizeof(new_date))))
+  {
+    DEBUG_printf(("2cups_dcache_copy: Printer configuration of \"%s\" has changed.", uri));
+
+    ippDelete(current);
+
+    _cupsMutexLock(&cups_dcache_mutex);
+    if ((dc = (_cups_dcache_t *)cupsArrayFind(cups_dcache, &key)) != NULL)
+      cupsArrayRemove(cups_dcache, dc);
+    _cupsMutexUnlock(&cups_dcache_mutex);
+
+    return (NULL);
+  }
+
+ /*
+  * Still current, look the entry up again since we gave up the lock...
+  */
+
+  _cupsMutexLock(&cups_dcache_mutex);
+
+  if ((dc = (_cups_dcache_t *)cupsArrayFind(cups_dcache, &key)) == NULL)
+  {
+    _cupsMutexUnlock(&cups_dcache_mutex);
+    ippDelete(current);
+    return (NULL);
+  }
+
+  dc->validated = time(NULL);
+
+ /*
+  * Return a copy of the cached attributes with the current values of the
+  * changing attributes...
+  */
+
+  if ((response = ippNew()) != NULL && (!ippCopyAttributes(response, dc->attrs, 0, (ipp_copycb_t)cups_dcache_copy_cb, NULL) || !ippCopyAttributes(response, current, 0, (ipp_copycb_t)cups_dcache_copy_cb, response)))
+  {
+    ippDelete(response);
+    response = NULL;
+  }
+
+  *version = dc->version;
+
+  _cupsMutexUnlock(&cups_dcache_mutex);
+
+  ippDelete(current);
+
+  return (response);
+}
+
+
+/*
+ * 'cups_dcache_copy_cb()' - Filter attributes when copying cached attributes.
+ *
+ * When "context" is @code NULL@ only the unchanging cached attributes are
+ * copied, otherwise only the printer attributes of the current response.
+ */
+
+static int				/* O - 1 to copy, 0 to skip */
+cups_dcache_copy_cb(
+    void            *context,		/* I - @code NULL@ for cached attributes */
+    ipp_t           *dst,		/* I - Destination (unused) */
+    ipp_attribute_t *attr)		/* I - Attribute */
+{
+  const char	*name = ippGetName(attr);
+					/* Attribute name */
+  size_t	i;			/* Looping var */
+
+
+  (void)dst;
+
+  if (context)
+    return (name && ippGetGroupTag(attr) == IPP_TAG_PRINTER);
+
+  for (i = 0; name && i < (sizeof(cups_dcache_volatile) / sizeof(cups_dcache_volatile[0])); i ++)
+    if (!strcmp(name, cups_dcache_volatile[i]))
+      return (0);
+
+  return (1);
+}
+
+
+/*
+ * 'cups_dcache_free()' - Free a cache entry.
+ */
+
+static void
+cups_dcache_free(_cups_dcache_t *dc)	/* I - Cache entry */
+{
+  free(dc->uri);
+  free(dc->resource);
+  free(dc->user);
+  free(dc->auth);
+  ippDelete(dc->attrs);
+  free(dc);
+}
+
+
+/*
+ * 'cups_dcache_get_config()' - Get the printer configuration change values.
+ *
+ * Returns a bitmask - 1 for "printer-config-change-time" and 2 for
+ * "printer-config-change-date-time".
+ */
+
+static int				/* O - Values found */
+cups_dcache_get_config(
+    ipp_t       *attrs,			/* I - Printer attributes */
+    int         *config_time,		/* O - printer-config-change-time value */
+    ipp_uchar_t *config_date)		/* O - printer-config-change-date-time value */
+{
+  int			found = 0;	/* Values found */
+  ipp_attribute_t	*attr;		/* Attribute */
+
+
+  *config_time = 0;
+  memset(config_date, 0, 11);
+
+  if ((attr = ippFindAttribute(attrs, "printer-config-change-time", IPP_TAG_INTEGER)) != NULL)
+  {
+    *config_time = ippGetInteger(attr, 0);
+    found        |= 1;
+  }
+
+  if ((attr = ippFindAttribute(attrs, "printer-config-change-date-time", IPP_TAG_DATE)) != NULL)
+  {
+    memcpy(config_date, ippGetDate(attr, 0), 11);
+    found |= 2;
+  }
+
+  return (found);
+}
+
+
+/*
+ * 'cups_dcache_key()' - Fill in the user and authentication scheme of a
+ *                       cache key.
+ */
+
+static void
+cups_dcache_key(http_t         *http,	/* I - Connection to destination */
+                _cups_dcache_t *key,	/* I - Cache key */
+                char           *auth,	/* I - Authentication scheme buffer */
+                size_t         authsize)/* I - Size of buffer */
+{
+  const char	*authstring = httpGetAuthString(http);
+					/* Current Authorization field */
+  char		*ptr;			/* Pointer into scheme */
+
+
+  strlcpy(auth, authstring ? authstring : "", authsize);
+
+  if ((ptr = strchr(auth, ' ')) != NULL)
+    *ptr = '\0';
+
+  key->user = (char *)cupsUser();
+  key->auth = auth;
+}
+
+
 /*
  * 'cups_free_media_cb()' - Free a media entry.
  */
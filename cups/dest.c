@@ -215,12 +215,16 @@ static void		cups_dnssd_query_cb(AvahiRecordBrowser *browser,
 					    AvahiLookupResultFlags flags,
 					    void *context);
 #  endif /* HAVE_DNSSD */
+static int		cups_dnssd_read_cache(const char *filename, int ttl,
+			                      cups_dest_t **dests);
 static const char	*cups_dnssd_resolve(cups_dest_t *dest, const char *uri,
 					    int msec, int *cancel,
 					    cups_dest_cb_t cb, void *user_data);
 static int		cups_dnssd_resolve_cb(void *context);
 static void		cups_dnssd_unquote(char *dst, const char *src,
 			                   size_t dstsize);
+static void		cups_dnssd_write_cache(const char *filename,
+			                       int num_dests, cups_dest_t *dests);
 static int		cups_elapsed(struct timeval *t);
 #endif /* HAVE_DNSSD || HAVE_AVAHI */
 static int              cups_enum_dests(http_t *http, unsigned flags, int msec, int *cancel, cups_ptype_t type, cups_ptype_t mask, cups_dest_cb_t cb, void *user_data);
@@ -955,10 +959,20 @@ _cupsCreateDest(const char *name,	/* I - Printer name */
  *
  * Enumeration happens on the current thread and does not return until all
  * destinations have been enumerated or the callback function returns 0.
+ * Destinations are delivered to the callback as soon as they are known - each
+ * discovered destination is delivered as soon as its TXT record arrives, so a
+ * callback can stop after the first match or after a number of destinations
+ * and returning 0 cancels any outstanding browses and queries immediately.
  *
  * Note: The callback function will likely receive multiple updates for the same
  * destinations - it is up to the caller to suppress any duplicate destinations.
  *
+ * When the "DiscoveryCache" directive in client.conf or the
+ * @code CUPS_DISCOVERYCACHE@ environment variable is set to a number of
+ * seconds, discovered destinations are saved in the "~/.cups/dnssd-cache" file
+ * and later enumerations within that time use the saved destinations instead
+ * of browsing again.
+ *
  * @since CUPS 1.6/macOS 10.8@
  */
 
@@ -991,7 +1005,9 @@ cupsEnumDests(
  * destinations that are available but have not yet been added locally.
  *
  * Enumeration happens on the current thread and does not return until all
- * destinations have been enumerated or the block returns 0.
+ * destinations have been enumerated or the block returns 0.  Destinations are
+ * delivered to the block as soon as they are known, so returning 0 after the
+ * first match cancels any outstanding browses and queries immediately.
  *
  * Note: The block will likely receive multiple updates for the same
  * destinations - it is up to the caller to suppress any duplicate destinations.
@@ -3207,6 +3223,65 @@ cups_dnssd_query_cb(
 }
 
 
+/*
+ * 'cups_dnssd_read_cache()' - Read discovered destinations from the cache.
+ *
+ * The cache is only used when it has been written in the last "ttl" seconds.
+ */
+
+static int				/* O - Number of destinations or -1 if stale */
+cups_dnssd_read_cache(
+    const char  *filename,		/* I - Cache file */
+    int         ttl,			/* I - Cache lifetime in seconds */
+    cups_dest_t **dests)		/* O - Destinations */
+{
+  int		num_dests = 0;		/* Number of destinations */
+  cups_dest_t	*dest;			/* Current destination */
+  cups_file_t	*fp;			/* Cache file */
+  struct stat	fileinfo;		/* Cache file information */
+  char		line[8192],		/* Line from file */
+		*name,			/* Destination name */
+		*options;		/* Destination options */
+
+
+  *dests = NULL;
+
+  if (stat(filename, &fileinfo) || (time(NULL) - fileinfo.st_mtime) > ttl || (fp = cupsFileOpen(filename, "r")) == NULL)
+  {
+    DEBUG_printf(("6cups_dnssd_read_cache: \"%s\" is missing or stale.", filename));
+    return (-1);
+  }
+
+ /*
+  * Each line looks like:
+  *
+  *    Dest name options
+  *
+  * Values can contain "#", so don't use cupsFileGetConf...
+  */
+
+  while (cupsFileGets(fp, line, sizeof(line)))
+  {
+    if (strncmp(line, "Dest ", 5))
+      continue;
+
+    name = line + 5;
+
+    if ((options = strchr(name, ' ')) != NULL)
+      *options++ = '\0';
+
+    num_dests = cupsAddDest(name, NULL, num_dests, dests);
+
+    if ((dest = cupsGetDest(name, NULL, num_dests, *dests)) != NULL && options)
+      dest->num_options = cupsParseOptions(options, dest->num_options, &(dest->options));
+  }
+
+  cupsFileClose(fp);
+
+  return (num_dests);
+}
+
+
 /*
  * 'cups_dnssd_resolve()' - Resolve a Bonjour printer URI.
  */
@@ -3335,6 +3410,68 @@ cups_dnssd_unquote(char       *dst,	/* I - Destination buffer */
 
   *dst = '\0';
 }
+
+
+/*
+ * 'cups_dnssd_write_cache()' - Write discovered destinations to the cache.
+ *
+ * The cache uses the lpoptions file format and is written to a temporary file
+ * that replaces the old cache so that concurrent readers never see a partial
+ * file.
+ */
+
+static void
+cups_dnssd_write_cache(
+    const char  *filename,		/* I - Cache file */
+    int         num_dests,		/* I - Number of destinations */
+    cups_dest_t *dests)			/* I - Destinations */
+{
+  int		i, j;			/* Looping vars */
+  cups_dest_t	*dest;			/* Current destination */
+  cups_option_t	*option;		/* Current option */
+  const char	*val;			/* Pointer into value */
+  cups_file_t	*fp;			/* Cache file */
+  char		tempfile[1024];		/* Temporary cache file */
+
+
+  snprintf(tempfile, sizeof(tempfile), "%s.%d", filename, (int)getpid());
+
+  if ((fp = cupsFileOpen(tempfile, "w")) == NULL)
+  {
+    DEBUG_printf(("6cups_dnssd_write_cache: Unable to create \"%s\": %s", tempfile, strerror(errno)));
+    return;
+  }
+
+  for (i = num_dests, dest = dests; i > 0; i --, dest ++)
+  {
+    cupsFilePrintf(fp, "Dest %s", dest->name);
+
+    for (j = dest->num_options, option = dest->options; j > 0; j --, option ++)
+    {
+      cupsFilePrintf(fp, " %s=\"", option->name);
+
+      for (val = option->value; *val; val ++)
+      {
+        if ((*val & 255) < ' ')
+          continue;
+        else if (strchr("\"\'\\", *val))
+          cupsFilePutChar(fp, '\\');
+
+        cupsFilePutChar(fp, *val);
+      }
+
+      cupsFilePutChar(fp, '\"');
+    }
+
+    cupsFilePutChar(fp, '\n');
+  }
+
+  if (cupsFileClose(fp) || rename(tempfile, filename))
+  {
+    DEBUG_printf(("6cups_dnssd_write_cache: Unable to save \"%s\": %s", filename, strerror(errno)));
+    unlink(tempfile);
+  }
+}
 #endif /* HAVE_DNSSD */
 
 
@@ -3389,6 +3526,10 @@ cups_enum_dests(
   struct timeval curtime;               /* Current time */
   _cups_dnssd_data_t data;		/* Data for callback */
   _cups_dnssd_device_t *device;         /* Current device */
+  int		num_cached = 0,		/* Number of destinations to cache */
+		complete = 0;		/* Did all queries complete? */
+  cups_dest_t	*cached = NULL;		/* Destinations to cache */
+  char		cachefile[1024] = "";	/* Discovery cache file */
 #  ifdef HAVE_DNSSD
   int           nfds,                   /* Number of files responded */
                 main_fd;                /* File descriptor for lookups */
@@ -3583,6 +3724,62 @@ cups_enum_dests(
     goto enum_finished;
 
 #if defined(HAVE_DNSSD) || defined(HAVE_AVAHI)
+ /*
+  * Use the discovery cache if it is enabled and fresh...
+  */
+
+  if (cg->discovery_cache < 0)
+    _cupsSetDefaults();
+
+  if (cg->discovery_cache > 0 && cg->home)
+  {
+    snprintf(cachefile, sizeof(cachefile), "%s/.cups/dnssd-cache", cg->home);
+
+    if ((num_dests = cups_dnssd_read_cache(cachefile, cg->discovery_cache, &dests)) >= 0)
+    {
+      DEBUG_printf(("1cups_enum_dests: Using %d cached destinations from \"%s\".", num_dests, cachefile));
+
+      for (i = num_dests, dest = dests;
+           i > 0 && (!cancel || !*cancel);
+           i --, dest ++)
+      {
+        cups_dest_t	*user_dest;	/* Destination from lpoptions */
+        const char	*printer_type;	/* printer-type value */
+        _cups_dnssd_device_t dkey;	/* Search key */
+
+        printer_type = cupsGetOption("printer-type", dest->num_options, dest->options);
+
+        if ((((cups_ptype_t)strtol(printer_type ? printer_type : "0", NULL, 10) | CUPS_PRINTER_DISCOVERED) & mask) != type)
+          continue;
+
+        dkey.dest.name = dest->name;
+
+        if (cupsArrayFind(data.devices, &dkey))
+          continue;			/* Already listed as a local queue */
+
+	if ((user_dest = cupsGetDest(dest->name, NULL, data.num_dests, data.dests)) != NULL)
+	{
+	 /*
+	  * Apply user defaults to this destination...
+	  */
+
+	  for (j = user_dest->num_options, option = user_dest->options; j > 0; j --, option ++)
+	    dest->num_options = cupsAddOption(option->name, option->value, dest->num_options, &dest->options);
+	}
+
+        if (!strcasecmp(dest->name, data.def_name) && !data.def_instance)
+          dest->is_default = 1;
+
+        if (!(*cb)(user_data, CUPS_DEST_FLAGS_NONE, dest))
+          break;
+      }
+
+      cupsFreeDests(num_dests, dests);
+
+      goto enum_finished;
+    }
+  }
+
  /*
   * Get Bonjour-shared printers...
   */
@@ -3785,6 +3982,9 @@ cups_enum_dests(
 
         DEBUG_printf(("1cups_enum_dests: Query for \"%s\" is complete.", device->fullName));
 
+        if (cachefile[0])
+          num_cached = cupsCopyDest(&device->dest, num_cached, &cached);
+
         if ((device->type & mask) == type)
         {
           cups_dest_t	*user_dest;	/* Destination from lpoptions */
@@ -3823,14 +4023,34 @@ cups_enum_dests(
     DEBUG_printf(("1cups_enum_dests: remaining=%d, browsers=%d, completed=%d, count=%d, devices count=%d", remaining, data.browsers, completed, count, cupsArrayCount(data.devices)));
 
     if (data.browsers == 0 && completed == cupsArrayCount(data.devices))
+    {
+      complete = 1;
       break;
+    }
 #  else
     DEBUG_printf(("1cups_enum_dests: remaining=%d, completed=%d, count=%d, devices count=%d", remaining, completed, count, cupsArrayCount(data.devices)));
 
     if (completed == cupsArrayCount(data.devices))
+    {
+      complete = 1;
       break;
+    }
 #  endif /* HAVE_AVAHI */
   }
+
+ /*
+  * Save what we found for the next enumeration, unless the enumeration timed
+  * out, was cancelled, or was stopped by the callback with partial results...
+  */
+
+  if (cachefile[0] && complete)
+  {
+    snprintf(filename, sizeof(filename), "%s/.cups", cg->home);
+    if (access(filename, 0))
+      mkdir(filename, 0700);
+
+    cups_dnssd_write_cache(cachefile, num_cached, cached);
+  }
 #endif /* HAVE_DNSSD || HAVE_AVAHI */
 
  /*
@@ -3843,6 +4063,7 @@ cups_enum_dests(
 
 #if defined(HAVE_DNSSD) || defined(HAVE_AVAHI)
   cupsArrayDelete(data.devices);
+  cupsFreeDests(num_cached, cached);
 
 #  ifdef HAVE_DNSSD
   if (ipp_ref)
@@ -375,6 +375,7 @@ static const _ipp_option_t ipp_options[] =
  */
 
 static int	compare_ipp_options(_ipp_option_t *a, _ipp_option_t *b);
+static void	encode_options(ipp_t *ipp, int num_options, cups_option_t *options, _ipp_option_t **matches, ipp_tag_t group_tag);
 
 
 /*
@@ -699,15 +700,34 @@ cupsEncodeOptions(ipp_t         *ipp,		/* I - IPP request/response */
         	  int           num_options,	/* I - Number of options */
 		  cups_option_t *options)	/* I - Options */
 {
+  int		i;			/* Looping var */
+  _ipp_option_t	**matches;		/* Attribute information for each option */
+
+
   DEBUG_printf(("cupsEncodeOptions(%p, %d, %p)", (void *)ipp, num_options, (void *)options));
 
+  if (!ipp || num_options < 1 || !options)
+    return;
+
+ /*
+  * Look up the attribute information once for all of the groups...
+  */
+
+  if ((matches = malloc((size_t)num_options * sizeof(_ipp_option_t *))) != NULL)
+  {
+    for (i = 0; i < num_options; i ++)
+      matches[i] = _ippFindOption(options[i].name);
+  }
+
  /*
   * Add the options in the proper groups & order...
   */
 
-  cupsEncodeOptions2(ipp, num_options, options, IPP_TAG_OPERATION);
-  cupsEncodeOptions2(ipp, num_options, options, IPP_TAG_JOB);
-  cupsEncodeOptions2(ipp, num_options, options, IPP_TAG_SUBSCRIPTION);
+  encode_options(ipp, num_options, options, matches, IPP_TAG_OPERATION);
+  encode_options(ipp, num_options, options, matches, IPP_TAG_JOB);
+  encode_options(ipp, num_options, options, matches, IPP_TAG_SUBSCRIPTION);
+
+  free(matches);
 }
 
 
@@ -727,6 +747,80 @@ cupsEncodeOptions2(
     int           num_options,		/* I - Number of options */
     cups_option_t *options,		/* I - Options */
     ipp_tag_t     group_tag)		/* I - Group to encode */
+{
+  DEBUG_printf(("cupsEncodeOptions2(ipp=%p(%s), num_options=%d, options=%p, group_tag=%x)", (void *)ipp, ipp ? ippOpString(ippGetOperation(ipp)) : "", num_options, (void *)options, group_tag));
+
+  encode_options(ipp, num_options, options, NULL, group_tag);
+}
+
+
+#ifdef DEBUG
+/*
+ * '_ippCheckOptions()' - Validate that the option array is sorted properly.
+ */
+
+const char *				/* O - First out-of-order option or NULL */
+_ippCheckOptions(void)
+{
+  int	i;				/* Looping var */
+
+
+  for (i = 0; i < (int)(sizeof(ipp_options) / sizeof(ipp_options[0]) - 1); i ++)
+    if (strcmp(ipp_options[i].name, ipp_options[i + 1].name) >= 0)
+      return (ipp_options[i + 1].name);
+
+  return (NULL);
+}
+#endif /* DEBUG */
+
+
+/*
+ * '_ippFindOption()' - Find the attribute information for an option.
+ */
+
+_ipp_option_t *				/* O - Attribute information */
+_ippFindOption(const char *name)	/* I - Option/attribute name */
+{
+  _ipp_option_t	key;			/* Search key */
+
+
+ /*
+  * Lookup the proper value and group tags for this option...
+  */
+
+  key.name = name;
+
+  return ((_ipp_option_t *)bsearch(&key, ipp_options,
+                                   sizeof(ipp_options) / sizeof(ipp_options[0]),
+				   sizeof(ipp_options[0]),
+				   (int (*)(const void *, const void *))
+				       compare_ipp_options));
+}
+
+
+/*
+ * 'compare_ipp_options()' - Compare two IPP options.
+ */
+
+static int				/* O - Result of comparison */
+compare_ipp_options(_ipp_option_t *a,	/* I - First option */
+                    _ipp_option_t *b)	/* I - Second option */
+{
+  return (strcmp(a->name, b->name));
+}
+
+
+/*
+ * 'encode_options()' - Encode printer options into IPP attributes for a group.
+ */
+
+static void
+encode_options(
+    ipp_t         *ipp,			/* I - IPP request/response */
+    int           num_options,		/* I - Number of options */
+    cups_option_t *options,		/* I - Options */
+    _ipp_option_t **matches,		/* I - Attribute information or @code NULL@ */
+    ipp_tag_t     group_tag)		/* I - Group to encode */
 {
   int			i;		/* Looping var */
   char			*val;		/* Pointer to option value */
@@ -735,8 +829,6 @@ cupsEncodeOptions2(
   const ipp_op_t	*ops;		/* List of allowed operations */
 
 
-  DEBUG_printf(("cupsEncodeOptions2(ipp=%p(%s), num_options=%d, options=%p, group_tag=%x)", (void *)ipp, ipp ? ippOpString(ippGetOperation(ipp)) : "", num_options, (void *)options, group_tag));
-
  /*
   * Range check input...
   */
@@ -783,7 +875,12 @@ cupsEncodeOptions2(
     * Figure out the proper value and group tags for this option...
     */
 
-    if ((match = _ippFindOption(option->name)) != NULL)
+    if (matches)
+      match = matches[option - options];
+    else
+      match = _ippFindOption(option->name);
+
+    if (match)
     {
       if (match->group_tag != group_tag && match->alt_group_tag != group_tag)
         continue;
@@ -800,7 +897,7 @@ cupsEncodeOptions2(
         ops = ipp_set_printer;
       else
       {
-	DEBUG_printf(("2cupsEncodeOptions2: Skipping \"%s\".", option->name));
+	DEBUG_printf(("2encode_options: Skipping \"%s\".", option->name));
         continue;
       }
     }
@@ -814,13 +911,13 @@ cupsEncodeOptions2(
       {
 	if (group_tag != IPP_TAG_JOB && group_tag != IPP_TAG_DOCUMENT)
 	{
-	  DEBUG_printf(("2cupsEncodeOptions2: Skipping \"%s\".", option->name));
+	  DEBUG_printf(("2encode_options: Skipping \"%s\".", option->name));
           continue;
         }
       }
       else if (group_tag != IPP_TAG_PRINTER)
       {
-	DEBUG_printf(("2cupsEncodeOptions2: Skipping \"%s\".", option->name));
+	DEBUG_printf(("2encode_options: Skipping \"%s\".", option->name));
         continue;
       }
 
@@ -844,66 +941,10 @@ cupsEncodeOptions2(
 
     if (*ops == IPP_OP_CUPS_NONE && op != IPP_OP_CUPS_NONE)
     {
-      DEBUG_printf(("2cupsEncodeOptions2: Skipping \"%s\".", option->name));
+      DEBUG_printf(("2encode_options: Skipping \"%s\".", option->name));
       continue;
     }
 
     _cupsEncodeOption(ipp, group_tag, match, option->name, option->value);
   }
 }
-
-
-#ifdef DEBUG
-/*
- * '_ippCheckOptions()' - Validate that the option array is sorted properly.
- */
-
-const char *				/* O - First out-of-order option or NULL */
-_ippCheckOptions(void)
-{
-  int	i;				/* Looping var */
-
-
-  for (i = 0; i < (int)(sizeof(ipp_options) / sizeof(ipp_options[0]) - 1); i ++)
-    if (strcmp(ipp_options[i].name, ipp_options[i + 1].name) >= 0)
-      return (ipp_options[i + 1].name);
-
-  return (NULL);
-}
-#endif /* DEBUG */
-
-
-/*
- * '_ippFindOption()' - Find the attribute information for an option.
- */
-
-_ipp_option_t *				/* O - Attribute information */
-_ippFindOption(const char *name)	/* I - Option/attribute name */
-{
-  _ipp_option_t	key;			/* Search key */
-
-
- /*
-  * Lookup the proper value and group tags for this option...
-  */
-
-  key.name = name;
-
-  return ((_ipp_option_t *)bsearch(&key, ipp_options,
-                                   sizeof(ipp_options) / sizeof(ipp_options[0]),
-				   sizeof(ipp_options[0]),
-				   (int (*)(const void *, const void *))
-				       compare_ipp_options));
-}
-
-
-/*
- * 'compare_ipp_options()' - Compare two IPP options.
- */
-
-static int				/* O - Result of comparison */
-compare_ipp_options(_ipp_option_t *a,	/* I - First option */
-                    _ipp_option_t *b)	/* I - Second option */
-{
-  return (strcmp(a->name, b->name));
-}
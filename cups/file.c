@@ -21,6 +21,9 @@
 #include "debug-internal.h"
 #include <sys/stat.h>
 #include <sys/types.h>
+#ifndef _WIN32
+#  include <sys/mman.h>
+#endif /* !_WIN32 */
 
 #  ifdef HAVE_LIBZ
 #    include <zlib.h>
@@ -39,6 +42,7 @@ struct _cups_file_s			/**** CUPS file structure... ****/
 		compressed,		/* Compression used? */
 		is_stdio,		/* stdin/out/err? */
 		eof,			/* End of file? */
+		mapped,			/* Tried to map the file? */
 		buf[4096],		/* Buffer */
 		*ptr,			/* Pointer into buffer */
 		*end;			/* End of buffer data */
@@ -53,6 +57,9 @@ struct _cups_file_s			/**** CUPS file structure... ****/
 
   char		*printf_buffer;		/* cupsFilePrintf buffer */
   size_t	printf_size;		/* Size of cupsFilePrintf buffer */
+
+  char		*map;			/* Memory-mapped file contents */
+  size_t	mapsize;		/* Size of mapping */
 };
 
 
@@ -64,6 +71,9 @@ struct _cups_file_s			/**** CUPS file structure... ****/
 static ssize_t	cups_compress(cups_file_t *fp, const char *buf, size_t bytes);
 #endif /* HAVE_LIBZ */
 static ssize_t	cups_fill(cups_file_t *fp);
+#ifndef _WIN32
+static ssize_t	cups_map(cups_file_t *fp);
+#endif /* !_WIN32 */
 static int	cups_open(const char *filename, int mode);
 static ssize_t	cups_read(cups_file_t *fp, char *buf, size_t bytes);
 static ssize_t	cups_write(cups_file_t *fp, const char *buf, size_t bytes);
@@ -452,6 +462,11 @@ cupsFileClose(cups_file_t *fp)		/* I - CUPS file */
   fd   = fp->fd;
   mode = fp->mode;
 
+#ifndef _WIN32
+  if (fp->map)
+    munmap(fp->map, fp->mapsize);
+#endif /* !_WIN32 */
+
   if (fp->printf_buffer)
     free(fp->printf_buffer);
 
@@ -1731,7 +1746,19 @@ cupsFileRewind(cups_file_t *fp)		/* I - CUPS file */
   * Handle special cases...
   */
 
-  if (fp->bufpos == 0)
+  if (fp->map)
+  {
+   /*
+    * Just move to the start of the mapping...
+    */
+
+    fp->pos = 0;
+    fp->ptr = fp->map;
+    fp->eof = 0;
+
+    return (0);
+  }
+  else if (fp->bufpos == 0)
   {
    /*
     * No seeking necessary...
@@ -1811,7 +1838,7 @@ cupsFileSeek(cups_file_t *fp,		/* I - CUPS file */
   if (pos == 0)
     return (cupsFileRewind(fp));
 
-  if (fp->ptr)
+  if (fp->ptr && !fp->map)
   {
     bytes = (ssize_t)(fp->end - fp->buf);
 
@@ -1843,6 +1870,36 @@ cupsFileSeek(cups_file_t *fp,		/* I - CUPS file */
   }
 #endif /* HAVE_LIBZ */
 
+#ifndef _WIN32
+  if (fp->map)
+  {
+    if (pos <= (off_t)fp->mapsize)
+    {
+     /*
+      * Seek within the mapping...
+      */
+
+      fp->pos = pos;
+      fp->ptr = fp->map + pos;
+      fp->eof = 0;
+
+      return (pos);
+    }
+
+   /*
+    * Seeking past the end of the mapping, go back to reading from the file
+    * descriptor (which has not moved from the start of the file)...
+    */
+
+    munmap(fp->map, fp->mapsize);
+
+    fp->map    = NULL;
+    fp->bufpos = 0;
+    fp->ptr    = NULL;
+    fp->end    = NULL;
+  }
+#endif /* !_WIN32 */
+
  /*
   * Seek forwards or backwards...
   */
@@ -2214,6 +2271,48 @@ cups_fill(cups_file_t *fp)		/* I - CUPS file */
   DEBUG_printf(("7cups_fill(fp=%p)", (void *)fp));
   DEBUG_printf(("9cups_fill: fp->ptr=%p, fp->end=%p, fp->buf=%p, fp->bufpos=" CUPS_LLFMT ", fp->eof=%d", (void *)fp->ptr, (void *)fp->end, (void *)fp->buf, CUPS_LLCAST fp->bufpos, fp->eof));
 
+#ifndef _WIN32
+  if (fp->map)
+  {
+    struct stat	fileinfo;		/* File information */
+
+    if (fp->ptr < fp->end)
+      return ((ssize_t)(fp->end - fp->ptr));
+
+   /*
+    * End of the mapping - if the file has grown since it was mapped, read the
+    * rest from the file descriptor...
+    */
+
+    if (fstat(fp->fd, &fileinfo) || fileinfo.st_size <= (off_t)fp->mapsize || lseek(fp->fd, (off_t)fp->mapsize, SEEK_SET) < 0)
+    {
+      DEBUG_puts("9cups_fill: End of mapping, returning 0.");
+
+      fp->eof = 1;
+
+      return (0);
+    }
+
+    munmap(fp->map, fp->mapsize);
+
+    fp->map    = NULL;
+    fp->bufpos = (off_t)fp->mapsize;
+    fp->ptr    = fp->buf;
+    fp->end    = fp->buf;
+  }
+  else if (!fp->ptr && !fp->mapped)
+  {
+   /*
+    * Try mapping the file on the first read...
+    */
+
+    fp->mapped = 1;
+
+    if ((bytes = cups_map(fp)) > 0)
+      return (bytes);
+  }
+#endif /* !_WIN32 */
+
   if (fp->ptr && fp->end)
     fp->bufpos += fp->end - fp->buf;
 
@@ -2593,6 +2692,61 @@ cups_fill(cups_file_t *fp)		/* I - CUPS file */
 }
 
 
+#ifndef _WIN32
+/*
+ * 'cups_map()' - Map a regular, uncompressed file into memory.
+ *
+ * Files that are no larger than the read buffer are not mapped.
+ */
+
+static ssize_t				/* O - Number of bytes or 0 if not mapped */
+cups_map(cups_file_t *fp)		/* I - CUPS file */
+{
+  struct stat	fileinfo;		/* File information */
+  char		*map;			/* Memory-mapped file contents */
+  size_t	mapsize;		/* Size of mapping */
+
+
+  if (fp->mode != 'r' || fp->bufpos != 0 || fstat(fp->fd, &fileinfo) || !S_ISREG(fileinfo.st_mode) || fileinfo.st_size <= (off_t)sizeof(fp->buf) || (uintmax_t)fileinfo.st_size > SIZE_MAX || lseek(fp->fd, 0, SEEK_CUR) != 0)
+    return (0);
+
+  mapsize = (size_t)fileinfo.st_size;
+
+  if ((map = mmap(NULL, mapsize, PROT_READ, MAP_PRIVATE, fp->fd, 0)) == MAP_FAILED)
+  {
+    DEBUG_printf(("9cups_map: mmap() failed: %s", strerror(errno)));
+    return (0);
+  }
+
+#ifdef HAVE_LIBZ
+  if (map[0] == 0x1f && (map[1] & 255) == 0x8b && map[2] == 8 && (map[3] & 0xe0) == 0)
+  {
+   /*
+    * Compressed files are read through the decompression buffer...
+    */
+
+    munmap(map, mapsize);
+    return (0);
+  }
+#endif /* HAVE_LIBZ */
+
+#ifdef MADV_SEQUENTIAL
+  madvise(map, mapsize, MADV_SEQUENTIAL);
+#endif /* MADV_SEQUENTIAL */
+
+  fp->map     = map;
+  fp->mapsize = mapsize;
+  fp->ptr     = map;
+  fp->end     = map + mapsize;
+  fp->eof     = 0;
+
+  DEBUG_printf(("9cups_map: Mapped " CUPS_LLFMT " bytes.", CUPS_LLCAST mapsize));
+
+  return ((ssize_t)mapsize);
+}
+#endif /* !_WIN32 */
+
+
 /*
  * 'cups_open()' - Safely open a file for writing.
  *
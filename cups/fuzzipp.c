@@ -0,0 +1,1041 @@
+/*
+ * IPP parser corpus and fuzzing program for CUPS.
+ *
+ * Copyright © 2019 by Apple Inc.
+ *
+ * Licensed under Apache License v2.0.  See the file "LICENSE" for more
+ * information.
+ *
+ * Usage:
+ *
+ *   ./fuzzipp [-v] [FILENAME ...]
+ *
+ * Without arguments, a built-in corpus of adversarial messages (many
+ * attributes, thousands of 1-byte values, large and deeply nested
+ * collections, many groups) is generated at increasing sizes and read with
+ * ippReadIO using both normal and arena memory.  Each input is checked for
+ * the expected result and for an exact copy when written back out, and the
+ * parse time and heap memory per element are compared between the smallest
+ * and largest sizes to flag super-linear behavior.  Truncated and randomly
+ * mutated messages are then read to make sure they are rejected without
+ * crashing.  The "-v" option shows the results for each input as CSV:
+ *
+ *   input,memory,elements,bytes,state,parse-us,heap-kb
+ *
+ * With filenames, each file is read as an IPP message and reported in the
+ * same CSV format.
+ */
+
+/*
+ * Include necessary headers...
+ */
+
+#include "string-private.h"
+#include "ipp-private.h"
+#include "file.h"
+#ifdef __APPLE__
+#  include <malloc/malloc.h>
+#elif defined(__GLIBC__)
+#  include <malloc.h>
+#endif /* __APPLE__ */
+
+
+/*
+ * Constants...
+ */
+
+#define FUZZ_MIN_ELEMENTS 2000		/* Smallest input size */
+#define FUZZ_MAX_ELEMENTS 32000		/* Largest input size */
+#define FUZZ_MUTATIONS	10000		/* Number of mutated inputs */
+#define FUZZ_REPEAT	3		/* Number of timed reads per input */
+#define FUZZ_MAX_TIME	4.0		/* Maximum growth in time per element */
+#define FUZZ_MAX_HEAP	3.0		/* Maximum growth in memory per element */
+
+
+/*
+ * Local types...
+ */
+
+typedef struct fuzz_buffer_s		/**** Memory buffer for I/O ****/
+{
+  unsigned char	*data;			/* Buffer */
+  size_t	pos,			/* Read position */
+		used,			/* Bytes used */
+		size;			/* Size of buffer */
+} fuzz_buffer_t;
+
+typedef void (*fuzz_gen_t)(fuzz_buffer_t *buf, int n);
+					/**** Input generator ****/
+
+typedef struct fuzz_corpus_s		/**** Corpus entry ****/
+{
+  const char	*name;			/* Name of input */
+  ipp_state_t	expected;		/* Expected state at largest size */
+  fuzz_gen_t	gen;			/* Generator function */
+} fuzz_corpus_t;
+
+typedef struct fuzz_result_s		/**** Result of reading an input ****/
+{
+  ipp_state_t	state;			/* Final state */
+  double	seconds;		/* Best parse time */
+  size_t	heap;			/* Heap memory used by message */
+  int		copy;			/* Does the message write back the same? */
+} fuzz_result_t;
+
+
+/*
+ * Local functions...
+ */
+
+static void	gen_attributes(fuzz_buffer_t *buf, int n);
+static void	gen_collections(fuzz_buffer_t *buf, int n);
+static void	gen_groups(fuzz_buffer_t *buf, int n);
+static void	gen_integers(fuzz_buffer_t *buf, int n);
+static void	gen_members(fuzz_buffer_t *buf, int n);
+static void	gen_nested(fuzz_buffer_t *buf, int n);
+static void	gen_request(fuzz_buffer_t *buf, int n);
+static void	gen_values(fuzz_buffer_t *buf, int n);
+static size_t	get_heap(void);
+static double	get_seconds(void);
+static void	put_attr(fuzz_buffer_t *buf, int tag, const char *name, const char *value, size_t valuelen);
+static void	put_byte(fuzz_buffer_t *buf, int byte);
+static void	put_header(fuzz_buffer_t *buf);
+static void	put_integer(fuzz_buffer_t *buf, const char *name, int value);
+static void	put_short(fuzz_buffer_t *buf, int value);
+static ssize_t	read_cb(fuzz_buffer_t *buf, unsigned char *buffer, size_t bytes);
+static void	read_input(fuzz_buffer_t *buf, int arena, fuzz_result_t *result);
+static int	test_corpus(const fuzz_corpus_t *corpus, int verbose);
+static int	test_file(const char *filename);
+static int	test_mutations(int verbose);
+static int	test_nesting(int verbose);
+static int	test_truncated(int verbose);
+static void	usage(void);
+static ssize_t	write_cb(fuzz_buffer_t *buf, unsigned char *buffer, size_t bytes);
+
+
+/*
+ * Local globals...
+ */
+
+static const fuzz_corpus_t corpus[] =	/* Built-in corpus */
+{
+  { "attributes",	IPP_STATE_DATA,		gen_attributes },
+  { "values",		IPP_STATE_DATA,		gen_values },
+  { "integers",		IPP_STATE_DATA,		gen_integers },
+  { "members",		IPP_STATE_DATA,		gen_members },
+  { "collections",	IPP_STATE_DATA,		gen_collections },
+  { "groups",		IPP_STATE_DATA,		gen_groups },
+  { "nested",		IPP_STATE_ERROR,	gen_nested }
+};
+static const char * const state_strings[] =
+{					/* ipp_state_t strings */
+  "idle",
+  "header",
+  "attribute",
+  "data"
+};
+
+
+/*
+ * 'main()' - Read the IPP corpus.
+ */
+
+int					/* O - Exit status */
+main(int  argc,				/* I - Number of command-line arguments */
+     char *argv[])			/* I - Command-line arguments */
+{
+  int		i;			/* Looping var */
+  int		status = 0,		/* Exit status */
+		verbose = 0,		/* Show results for each input? */
+		num_files = 0;		/* Number of files */
+
+
+  for (i = 1; i < argc; i ++)
+  {
+    if (!strcmp(argv[i], "-v"))
+      verbose = 1;
+    else if (argv[i][0] == '-')
+      usage();
+    else
+      num_files ++;
+  }
+
+  if (verbose || num_files)
+    puts("input,memory,elements,bytes,state,parse-us,heap-kb");
+
+  if (num_files)
+  {
+    for (i = 1; i < argc; i ++)
+    {
+      if (argv[i][0] != '-' && !test_file(argv[i]))
+        status = 1;
+    }
+
+    return (status);
+  }
+
+  for (i = 0; i < (int)(sizeof(corpus) / sizeof(corpus[0])); i ++)
+  {
+    if (!test_corpus(corpus + i, verbose))
+      status = 1;
+  }
+
+  if (!test_nesting(verbose))
+    status = 1;
+
+  if (!test_truncated(verbose))
+    status = 1;
+
+  if (!test_mutations(verbose))
+    status = 1;
+
+  if (!verbose)
+    puts(status ? "\nIPP corpus tests failed." : "\nIPP corpus tests passed.");
+
+  return (status);
+}
+
+
+/*
+ * 'gen_attributes()' - Generate a request with N attributes.
+ */
+
+static void
+gen_attributes(fuzz_buffer_t *buf,	/* I - Buffer */
+               int           n)		/* I - Number of attributes */
+{
+  int	i;				/* Looping var */
+  char	name[64];			/* Attribute name */
+
+
+  put_header(buf);
+
+  for (i = 0; i < n; i ++)
+  {
+    snprintf(name, sizeof(name), "attr-%06d", i);
+    put_integer(buf, name, i);
+  }
+
+  put_byte(buf, IPP_TAG_END);
+}
+
+
+/*
+ * 'gen_collections()' - Generate a request with an attribute of N collections.
+ */
+
+static void
+gen_collections(fuzz_buffer_t *buf,	/* I - Buffer */
+                int           n)	/* I - Number of collections */
+{
+  int	i;				/* Looping var */
+
+
+  put_header(buf);
+
+  for (i = 0; i < n; i ++)
+  {
+    put_attr(buf, IPP_TAG_BEGIN_COLLECTION, i ? "" : "col", NULL, 0);
+    put_attr(buf, IPP_TAG_MEMBERNAME, "", "m", 1);
+    put_integer(buf, "", i);
+    put_attr(buf, IPP_TAG_END_COLLECTION, "", NULL, 0);
+  }
+
+  put_byte(buf, IPP_TAG_END);
+}
+
+
+/*
+ * 'gen_groups()' - Generate a request with N job attribute groups.
+ */
+
+static void
+gen_groups(fuzz_buffer_t *buf,		/* I - Buffer */
+           int           n)		/* I - Number of groups */
+{
+  int	i;				/* Looping var */
+
+
+  put_header(buf);
+
+  for (i = 0; i < n; i ++)
+  {
+    put_byte(buf, IPP_TAG_JOB);
+    put_integer(buf, "job-id", i);
+  }
+
+  put_byte(buf, IPP_TAG_END);
+}
+
+
+/*
+ * 'gen_integers()' - Generate a request with an attribute of N integers.
+ */
+
+static void
+gen_integers(fuzz_buffer_t *buf,	/* I - Buffer */
+             int           n)		/* I - Number of values */
+{
+  int	i;				/* Looping var */
+
+
+  put_header(buf);
+
+  for (i = 0; i < n; i ++)
+    put_integer(buf, i ? "" : "ints", i);
+
+  put_byte(buf, IPP_TAG_END);
+}
+
+
+/*
+ * 'gen_members()' - Generate a request with a collection of N members.
+ */
+
+static void
+gen_members(fuzz_buffer_t *buf,		/* I - Buffer */
+            int           n)		/* I - Number of members */
+{
+  int	i;				/* Looping var */
+  char	name[64];			/* Member name */
+
+
+  put_header(buf);
+  put_attr(buf, IPP_TAG_BEGIN_COLLECTION, "col", NULL, 0);
+
+  for (i = 0; i < n; i ++)
+  {
+    snprintf(name, sizeof(name), "m%06d", i);
+    put_attr(buf, IPP_TAG_MEMBERNAME, "", name, strlen(name));
+    put_integer(buf, "", i);
+  }
+
+  put_attr(buf, IPP_TAG_END_COLLECTION, "", NULL, 0);
+  put_byte(buf, IPP_TAG_END);
+}
+
+
+/*
+ * 'gen_nested()' - Generate a request with collections nested N deep.
+ */
+
+static void
+gen_nested(fuzz_buffer_t *buf,		/* I - Buffer */
+           int           n)		/* I - Nesting depth */
+{
+  int	i;				/* Looping var */
+
+
+  put_header(buf);
+  put_attr(buf, IPP_TAG_BEGIN_COLLECTION, "col", NULL, 0);
+
+  for (i = 1; i < n; i ++)
+  {
+    put_attr(buf, IPP_TAG_MEMBERNAME, "", "m", 1);
+    put_attr(buf, IPP_TAG_BEGIN_COLLECTION, "", NULL, 0);
+  }
+
+  put_attr(buf, IPP_TAG_MEMBERNAME, "", "m", 1);
+  put_integer(buf, "", 1);
+
+  for (i = 0; i < n; i ++)
+    put_attr(buf, IPP_TAG_END_COLLECTION, "", NULL, 0);
+
+  put_byte(buf, IPP_TAG_END);
+}
+
+
+/*
+ * 'gen_request()' - Generate a typical Print-Job request.
+ */
+
+static void
+gen_request(fuzz_buffer_t *buf,		/* I - Buffer */
+            int           n)		/* I - Number of copies of the job template */
+{
+  int	i;				/* Looping var */
+
+
+  put_header(buf);
+  put_attr(buf, IPP_TAG_URI, "printer-uri", "ipp://localhost/ipp/print", 25);
+  put_attr(buf, IPP_TAG_NAME, "requesting-user-name", "john-doe", 8);
+  put_attr(buf, IPP_TAG_MIMETYPE, "document-format", "application/pdf", 15);
+
+  for (i = 0; i < n; i ++)
+  {
+    put_byte(buf, IPP_TAG_JOB);
+    put_integer(buf, "copies", 1);
+    put_attr(buf, IPP_TAG_KEYWORD, "sides", "two-sided-long-edge", 19);
+    put_attr(buf, IPP_TAG_BEGIN_COLLECTION, "media-col", NULL, 0);
+    put_attr(buf, IPP_TAG_MEMBERNAME, "", "media-size", 10);
+    put_attr(buf, IPP_TAG_BEGIN_COLLECTION, "", NULL, 0);
+    put_attr(buf, IPP_TAG_MEMBERNAME, "", "x-dimension", 11);
+    put_integer(buf, "", 21590);
+    put_attr(buf, IPP_TAG_MEMBERNAME, "", "y-dimension", 11);
+    put_integer(buf, "", 27940);
+    put_attr(buf, IPP_TAG_END_COLLECTION, "", NULL, 0);
+    put_attr(buf, IPP_TAG_MEMBERNAME, "", "media-type", 10);
+    put_attr(buf, IPP_TAG_KEYWORD, "", "stationery", 10);
+    put_attr(buf, IPP_TAG_END_COLLECTION, "", NULL, 0);
+    put_attr(buf, IPP_TAG_ENUM, "finishings", "\000\000\000\003", 4);
+  }
+
+  put_byte(buf, IPP_TAG_END);
+}
+
+
+/*
+ * 'gen_values()' - Generate a request with an attribute of N 1-byte values.
+ */
+
+static void
+gen_values(fuzz_buffer_t *buf,		/* I - Buffer */
+           int           n)		/* I - Number of values */
+{
+  int	i;				/* Looping var */
+
+
+  put_header(buf);
+
+  for (i = 0; i < n; i ++)
+    put_attr(buf, IPP_TAG_KEYWORD, i ? "" : "keys", "a", 1);
+
+  put_byte(buf, IPP_TAG_END);
+}
+
+
+/*
+ * 'get_heap()' - Get the amount of heap memory in use.
+ *
+ * Returns 0 when the C library does not provide heap statistics.
+ */
+
+static size_t				/* O - Bytes in use */
+get_heap(void)
+{
+#ifdef __APPLE__
+  malloc_statistics_t	stats;		/* Malloc statistics */
+
+  malloc_zone_statistics(NULL, &stats);
+  return (stats.size_in_use);
+
+#elif defined(__GLIBC__) && (__GLIBC__ > 2 || __GLIBC_MINOR__ >= 33)
+  struct mallinfo2	info = mallinfo2();
+					/* Malloc statistics */
+
+  return (info.uordblks + info.hblkhd);
+
+#else
+  return (0);
+#endif /* __APPLE__ */
+}
+
+
+/*
+ * 'get_seconds()' - Get the current time in seconds...
+ */
+
+static double				/* O - Current time in seconds */
+get_seconds(void)
+{
+  struct timeval	curtime;	/* Current time */
+
+
+  gettimeofday(&curtime, NULL);
+  return (curtime.tv_sec + 0.000001 * curtime.tv_usec);
+}
+
+
+/*
+ * 'put_attr()' - Add an attribute or additional value to a buffer.
+ */
+
+static void
+put_attr(fuzz_buffer_t *buf,		/* I - Buffer */
+         int           tag,		/* I - Value tag */
+         const char    *name,		/* I - Name ("" for additional values) */
+         const char    *value,		/* I - Value or `NULL` */
+         size_t        valuelen)	/* I - Length of value */
+{
+  size_t	namelen = strlen(name);	/* Length of name */
+
+
+  put_byte(buf, tag);
+  put_short(buf, (int)namelen);
+  memcpy(buf->data + buf->used, name, namelen);
+  buf->used += namelen;
+  put_short(buf, (int)valuelen);
+  if (valuelen > 0)
+    memcpy(buf->data + buf->used, value, valuelen);
+  buf->used += valuelen;
+}
+
+
+/*
+ * 'put_byte()' - Add a byte to a buffer.
+ */
+
+static void
+put_byte(fuzz_buffer_t *buf,		/* I - Buffer */
+         int           byte)		/* I - Byte */
+{
+  buf->data[buf->used ++] = (unsigned char)byte;
+}
+
+
+/*
+ * 'put_header()' - Add the IPP header and charset/language to a buffer.
+ */
+
+static void
+put_header(fuzz_buffer_t *buf)		/* I - Buffer */
+{
+  static const unsigned char header[] =	/* IPP/2.0 Print-Job request 1 */
+  {
+    2, 0, 0, IPP_OP_PRINT_JOB, 0, 0, 0, 1
+  };
+
+
+  buf->used = 0;
+  buf->pos  = 0;
+
+  memcpy(buf->data, header, sizeof(header));
+  buf->used = sizeof(header);
+
+  put_byte(buf, IPP_TAG_OPERATION);
+  put_attr(buf, IPP_TAG_CHARSET, "attributes-charset", "utf-8", 5);
+  put_attr(buf, IPP_TAG_LANGUAGE, "attributes-natural-language", "en", 2);
+}
+
+
+/*
+ * 'put_integer()' - Add an integer attribute or value to a buffer.
+ */
+
+static void
+put_integer(fuzz_buffer_t *buf,		/* I - Buffer */
+            const char    *name,	/* I - Name ("" for additional values) */
+            int           value)	/* I - Value */
+{
+  unsigned char	data[4];		/* Big-endian value */
+
+
+  data[0] = (unsigned char)(value >> 24);
+  data[1] = (unsigned char)(value >> 16);
+  data[2] = (unsigned char)(value >> 8);
+  data[3] = (unsigned char)value;
+
+  put_attr(buf, IPP_TAG_INTEGER, name, (char *)data, sizeof(data));
+}
+
+
+/*
+ * 'put_short()' - Add a 16-bit value to a buffer.
+ */
+
+static void
+put_short(fuzz_buffer_t *buf,		/* I - Buffer */
+          int           value)		/* I - Value */
+{
+  put_byte(buf, value >> 8);
+  put_byte(buf, value);
+}
+
+
+/*
+ * 'read_cb()' - Read data from a buffer.
+ */
+
+static ssize_t				/* O - Number of bytes read */
+read_cb(fuzz_buffer_t *buf,		/* I - Buffer */
+        unsigned char *buffer,		/* O - Bytes */
+        size_t        bytes)		/* I - Number of bytes to read */
+{
+  size_t	count;			/* Number of bytes */
+
+
+  if ((count = buf->used - buf->pos) > bytes)
+    count = bytes;
+
+  memcpy(buffer, buf->data + buf->pos, count);
+  buf->pos += count;
+
+  return ((ssize_t)count);
+}
+
+
+/*
+ * 'read_input()' - Read an input, timing it and checking the result.
+ */
+
+static void
+read_input(fuzz_buffer_t *buf,		/* I - Buffer */
+           int           arena,		/* I - Use arena memory? */
+           fuzz_result_t *result)	/* O - Result */
+{
+  int		i;			/* Looping var */
+  ipp_t		*ipp;			/* IPP message */
+  size_t	heap;			/* Heap memory before read */
+  double	start,			/* Start time */
+		seconds;		/* Parse time */
+  fuzz_buffer_t	copy;			/* Copy of message */
+
+
+  memset(result, 0, sizeof(fuzz_result_t));
+
+  for (i = 0; i < FUZZ_REPEAT; i ++)
+  {
+    heap     = get_heap();
+    ipp      = arena ? _ippNewArena() : ippNew();
+    buf->pos = 0;
+
+    start         = get_seconds();
+    result->state = ippReadIO(buf, (ipp_iocb_t)read_cb, 1, NULL, ipp);
+    seconds       = get_seconds() - start;
+
+    if (i == 0 || seconds < result->seconds)
+      result->seconds = seconds;
+
+    result->heap = get_heap() - heap;
+
+    if (i == 0 && result->state == IPP_STATE_DATA && (copy.data = malloc(buf->used + 1)) != NULL)
+    {
+     /*
+      * Write the message back out to make sure nothing was lost...
+      */
+
+      copy.pos  = 0;
+      copy.used = 0;
+      copy.size = buf->used + 1;
+
+      ipp->state = IPP_STATE_IDLE;
+
+      result->copy = ippWriteIO(&copy, (ipp_iocb_t)write_cb, 1, NULL, ipp) == IPP_STATE_DATA && copy.used == buf->used && !memcmp(copy.data, buf->data, buf->used);
+
+      free(copy.data);
+    }
+
+    ippDelete(ipp);
+  }
+}
+
+
+/*
+ * 'test_corpus()' - Read a corpus entry at increasing sizes.
+ */
+
+static int				/* O - 1 on success, 0 on failure */
+test_corpus(const fuzz_corpus_t *entry,	/* I - Corpus entry */
+            int                 verbose)/* I - Show results for each input? */
+{
+  int		status = 1;		/* Return value */
+  int		arena,			/* Use arena memory? */
+		n;			/* Number of elements */
+  fuzz_buffer_t	buf;			/* Input buffer */
+  fuzz_result_t	result,			/* Result of current read */
+		first;			/* Result of smallest read */
+  double	time_growth,		/* Growth of time per element */
+		heap_growth = 0.0;	/* Growth of memory per element */
+  char		name[256];		/* Test name */
+
+
+  buf.size = 64 * FUZZ_MAX_ELEMENTS + 1024;
+  if ((buf.data = malloc(buf.size)) == NULL)
+  {
+    printf("ippReadIO(%s): FAIL (unable to allocate buffer)\n", entry->name);
+    return (0);
+  }
+
+  for (arena = 0; arena < 2; arena ++)
+  {
+    snprintf(name, sizeof(name), "ippReadIO(%s%s)", entry->name, arena ? ",arena" : "");
+
+    if (!verbose)
+    {
+      printf("%s: ", name);
+      fflush(stdout);
+    }
+
+    memset(&first, 0, sizeof(first));
+    time_growth = 0.0;
+    heap_growth = 0.0;
+
+    for (n = FUZZ_MIN_ELEMENTS; n <= FUZZ_MAX_ELEMENTS; n *= 2)
+    {
+      (entry->gen)(&buf, n);
+      read_input(&buf, arena, &result);
+
+      if (verbose)
+        printf("%s,%s,%d,%u,%s,%.0f,%.1f\n", entry->name, arena ? "arena" : "heap", n, (unsigned)buf.used, result.state == IPP_STATE_ERROR ? "error" : state_strings[result.state], 1000000.0 * result.seconds, result.heap / 1024.0);
+
+      if (result.state != entry->expected)
+      {
+        if (verbose)
+          printf("%s: FAIL (state %d for %d elements, expected %d)\n", name, result.state, n, entry->expected);
+        else
+          printf("FAIL (state %d for %d elements, expected %d)\n", result.state, n, entry->expected);
+
+        status = 0;
+        break;
+      }
+      else if (result.state == IPP_STATE_DATA && !result.copy)
+      {
+        if (verbose)
+          printf("%s: FAIL (message for %d elements not written back the same)\n", name, n);
+        else
+          printf("FAIL (message for %d elements not written back the same)\n", n);
+
+        status = 0;
+        break;
+      }
+
+      if (n == FUZZ_MIN_ELEMENTS)
+      {
+        first = result;
+      }
+      else
+      {
+       /*
+        * Compare the cost per element with the smallest input, ignoring
+        * times and sizes that are too small to measure...
+        */
+
+        double scale = (double)n / FUZZ_MIN_ELEMENTS;
+					/* Growth in elements */
+
+        if (first.seconds >= 0.0001)
+          time_growth = result.seconds / first.seconds / scale;
+
+	if (first.heap >= 4096)
+	  heap_growth = (double)result.heap / first.heap / scale;
+      }
+    }
+
+    if (n <= FUZZ_MAX_ELEMENTS)
+      continue;
+
+    if (time_growth > FUZZ_MAX_TIME)
+    {
+      if (verbose)
+        printf("%s: FAIL (parse time per element grows %.1fx)\n", name, time_growth);
+      else
+        printf("FAIL (parse time per element grows %.1fx)\n", time_growth);
+
+      status = 0;
+    }
+    else if (heap_growth > FUZZ_MAX_HEAP)
+    {
+      if (verbose)
+        printf("%s: FAIL (memory per element grows %.1fx)\n", name, heap_growth);
+      else
+        printf("FAIL (memory per element grows %.1fx)\n", heap_growth);
+
+      status = 0;
+    }
+    else if (!verbose)
+      printf("PASS (%.1fx time, %.1fx memory per element)\n", time_growth, heap_growth);
+  }
+
+  free(buf.data);
+
+  return (status);
+}
+
+
+/*
+ * 'test_file()' - Read a file from the command-line.
+ */
+
+static int				/* O - 1 on success, 0 on failure */
+test_file(const char *filename)		/* I - File to read */
+{
+  cups_file_t	*fp;			/* File */
+  fuzz_buffer_t	buf;			/* Input buffer */
+  fuzz_result_t	result;			/* Result of read */
+  ssize_t	bytes;			/* Bytes read */
+
+
+  if ((fp = cupsFileOpen(filename, "r")) == NULL)
+  {
+    fprintf(stderr, "fuzzipp: Unable to open \"%s\": %s\n", filename, strerror(errno));
+    return (0);
+  }
+
+  buf.pos  = 0;
+  buf.used = 0;
+  buf.size = 65536;
+  buf.data = malloc(buf.size);
+
+  while (buf.data && (bytes = cupsFileRead(fp, (char *)buf.data + buf.used, buf.size - buf.used)) > 0)
+  {
+    if ((buf.used += (size_t)bytes) == buf.size)
+    {
+      unsigned char *temp;		/* New buffer */
+
+      if ((temp = realloc(buf.data, 2 * buf.size)) == NULL)
+      {
+        free(buf.data);
+        buf.data = NULL;
+        break;
+      }
+
+      buf.data = temp;
+      buf.size *= 2;
+    }
+  }
+
+  cupsFileClose(fp);
+
+  if (!buf.data)
+  {
+    fprintf(stderr, "fuzzipp: Unable to allocate memory for \"%s\".\n", filename);
+    return (0);
+  }
+
+  read_input(&buf, 1, &result);
+
+  printf("%s,arena,,%u,%s,%.0f,%.1f\n", filename, (unsigned)buf.used, result.state == IPP_STATE_ERROR ? "error" : state_strings[result.state], 1000000.0 * result.seconds, result.heap / 1024.0);
+
+  free(buf.data);
+
+  return (1);
+}
+
+
+/*
+ * 'test_mutations()' - Read randomly mutated requests.
+ *
+ * The mutated requests can be valid or invalid, so this only checks that
+ * they can be read without crashing and are written back the same.
+ */
+
+static int				/* O - 1 on success, 0 on failure */
+test_mutations(int verbose)		/* I - Show results? */
+{
+  int		i, j;			/* Looping vars */
+  unsigned	seed = 1;		/* Random number state */
+  fuzz_buffer_t	request,		/* Original request */
+		buf;			/* Mutated request */
+  fuzz_result_t	result;			/* Result of read */
+  int		accepted = 0,		/* Number of accepted requests */
+		mismatched = 0;		/* Number not written back the same */
+  double	start,			/* Start time */
+		maxtime = 0.0;		/* Longest parse time */
+
+
+  if (!verbose)
+  {
+    fputs("ippReadIO(mutations): ", stdout);
+    fflush(stdout);
+  }
+
+  request.size = 4096;
+  request.data = malloc(request.size);
+  buf.size     = request.size;
+  buf.data     = malloc(buf.size);
+
+  if (!request.data || !buf.data)
+  {
+    puts("FAIL (unable to allocate buffers)");
+    free(request.data);
+    free(buf.data);
+    return (0);
+  }
+
+  gen_request(&request, 2);
+
+  for (i = 0; i < FUZZ_MUTATIONS; i ++)
+  {
+    memcpy(buf.data, request.data, request.used);
+    buf.used = request.used;
+
+   /*
+    * Change 1 to 4 bytes, favoring the tag and length bytes that direct
+    * the parser...
+    */
+
+    for (j = (int)((seed >> 16) & 3); j >= 0; j --)
+    {
+      size_t	pos;			/* Position to change */
+
+      seed = seed * 1103515245 + 12345;
+      pos  = 8 + (seed >> 8) % (buf.used - 8);
+
+      seed = seed * 1103515245 + 12345;
+      switch ((seed >> 16) & 3)
+      {
+        case 0 :
+            buf.data[pos] = 0x00;
+            break;
+        case 1 :
+            buf.data[pos] = 0xff;
+            break;
+        default :
+            buf.data[pos] = (unsigned char)(seed >> 24);
+            break;
+      }
+    }
+
+    start = get_seconds();
+    read_input(&buf, i & 1, &result);
+    if ((get_seconds() - start) > maxtime)
+      maxtime = get_seconds() - start;
+
+    if (result.state == IPP_STATE_DATA)
+    {
+      accepted ++;
+
+      if (!result.copy)
+        mismatched ++;
+    }
+  }
+
+  free(request.data);
+  free(buf.data);
+
+  if (verbose)
+    printf("mutations,mixed,%d,,%d-accepted,%.0f,\n", FUZZ_MUTATIONS, accepted, 1000000.0 * maxtime);
+  else
+    printf("PASS (%d of %d accepted, %d rewritten differently, %.0fus max)\n", accepted, FUZZ_MUTATIONS, mismatched, 1000000.0 * maxtime);
+
+  return (1);
+}
+
+
+/*
+ * 'test_nesting()' - Read collections nested up to and past the limit.
+ */
+
+static int				/* O - 1 on success, 0 on failure */
+test_nesting(int verbose)		/* I - Show results? */
+{
+  fuzz_buffer_t	request;		/* Request */
+  fuzz_result_t	result;			/* Result of read */
+  int		status = 1;		/* Return value */
+
+
+  if (!verbose)
+  {
+    fputs("ippReadIO(nesting): ", stdout);
+    fflush(stdout);
+  }
+
+  request.size = 4096;
+  if ((request.data = malloc(request.size)) == NULL)
+  {
+    puts("FAIL (unable to allocate buffer)");
+    return (0);
+  }
+
+  gen_nested(&request, IPP_MAX_DEPTH);
+  read_input(&request, 0, &result);
+
+  if (result.state != IPP_STATE_DATA || !result.copy)
+  {
+    printf("%sFAIL (collections nested %d deep not read)\n", verbose ? "ippReadIO(nesting): " : "", IPP_MAX_DEPTH);
+    status = 0;
+  }
+  else
+  {
+    gen_nested(&request, IPP_MAX_DEPTH + 1);
+    read_input(&request, 0, &result);
+
+    if (result.state != IPP_STATE_ERROR)
+    {
+      printf("%sFAIL (collections nested %d deep not rejected)\n", verbose ? "ippReadIO(nesting): " : "", IPP_MAX_DEPTH + 1);
+      status = 0;
+    }
+    else if (!verbose)
+      printf("PASS (%d levels)\n", IPP_MAX_DEPTH);
+  }
+
+  free(request.data);
+
+  return (status);
+}
+
+
+/*
+ * 'test_truncated()' - Read a request truncated at every byte.
+ */
+
+static int				/* O - 1 on success, 0 on failure */
+test_truncated(int verbose)		/* I - Show results? */
+{
+  fuzz_buffer_t	request;		/* Request */
+  fuzz_result_t	result;			/* Result of read */
+  size_t	length;			/* Full length of request */
+
+
+  if (!verbose)
+  {
+    fputs("ippReadIO(truncated): ", stdout);
+    fflush(stdout);
+  }
+
+  request.size = 4096;
+  if ((request.data = malloc(request.size)) == NULL)
+  {
+    puts("FAIL (unable to allocate buffer)");
+    return (0);
+  }
+
+  gen_request(&request, 2);
+
+  for (length = request.used, request.used --; request.used > 0; request.used --)
+  {
+    read_input(&request, 0, &result);
+
+    if (result.state != IPP_STATE_ERROR)
+    {
+      if (verbose)
+        printf("ippReadIO(truncated): FAIL (state %d for %u of %u bytes)\n", result.state, (unsigned)request.used, (unsigned)length);
+      else
+        printf("FAIL (state %d for %u of %u bytes)\n", result.state, (unsigned)request.used, (unsigned)length);
+
+      free(request.data);
+      return (0);
+    }
+  }
+
+  free(request.data);
+
+  if (!verbose)
+    printf("PASS (%u lengths)\n", (unsigned)length);
+
+  return (1);
+}
+
+
+/*
+ * 'usage()' - Show program usage.
+ */
+
+static void
+usage(void)
+{
+  puts("Usage: ./fuzzipp [-v] [FILENAME ...]");
+  exit(1);
+}
+
+
+/*
+ * 'write_cb()' - Write data to a buffer.
+ */
+
+static ssize_t				/* O - Number of bytes written */
+write_cb(fuzz_buffer_t *buf,		/* I - Buffer */
+         unsigned char *buffer,		/* I - Bytes */
+         size_t        bytes)		/* I - Number of bytes to write */
+{
+  size_t	count;			/* Number of bytes */
+
+
+  if ((count = buf->size - buf->used) > bytes)
+    count = bytes;
+
+  memcpy(buf->data + buf->used, buffer, count);
+  buf->used += count;
+
+  return ((ssize_t)count);
+}
@@ -200,6 +200,7 @@ cups_globals_alloc(void)
   memset(cg, 0, sizeof(_cups_globals_t));
   cg->encryption     = (http_encryption_t)-1;
   cg->password_cb    = (cups_password_cb2_t)_cupsGetPassword;
+  cg->discovery_cache = -1;
   cg->trust_first    = -1;
   cg->any_root       = -1;
   cg->expired_certs  = -1;
@@ -356,10 +357,6 @@ cups_globals_free(_cups_globals_t *cg)	/* I - Pointer to global data */
     free(buffer);
   }
 
-  cupsArrayDelete(cg->leg_size_lut);
-  cupsArrayDelete(cg->ppd_size_lut);
-  cupsArrayDelete(cg->pwg_size_lut);
-
   httpClose(cg->http);
 
 #ifdef HAVE_SSL
@@ -156,6 +156,25 @@ httpAddrLength(const http_addr_t *addr)	/* I - Address */
 int					/* O - Socket or -1 on error */
 httpAddrListen(http_addr_t *addr,	/* I - Address to bind to */
                int         port)	/* I - Port number to bind to */
+{
+  return (_httpAddrListen(addr, port, 5, 0));
+}
+
+
+/*
+ * '_httpAddrListen()' - Create a listening socket with the specified backlog,
+ *                       optionally sharing the address with other sockets.
+ *
+ * When "shared" is non-zero the SO_REUSEPORT option is set (where available)
+ * so that several sockets can be bound to the same address and port, with the
+ * kernel distributing new connections between them.
+ */
+
+int					/* O - Socket or -1 on error */
+_httpAddrListen(http_addr_t *addr,	/* I - Address to bind to */
+                int         port,	/* I - Port number to bind to */
+                int         backlog,	/* I - Maximum pending connections */
+                int         shared)	/* I - Share the address with other sockets? */
 {
   int		fd = -1,		/* Socket */
 		val,			/* Socket value */
@@ -182,6 +201,13 @@ httpAddrListen(http_addr_t *addr,	/* I - Address to bind to */
   val = 1;
   setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, CUPS_SOCAST &val, sizeof(val));
 
+#ifdef SO_REUSEPORT
+  if (shared)
+    setsockopt(fd, SOL_SOCKET, SO_REUSEPORT, CUPS_SOCAST &val, sizeof(val));
+#else
+  (void)shared;
+#endif /* SO_REUSEPORT */
+
 #ifdef IPV6_V6ONLY
   if (addr->addr.sa_family == AF_INET6)
     setsockopt(fd, IPPROTO_IPV6, IPV6_V6ONLY, CUPS_SOCAST &val, sizeof(val));
@@ -243,7 +269,7 @@ httpAddrListen(http_addr_t *addr,	/* I - Address to bind to */
   * Listen...
   */
 
-  if (listen(fd, 5))
+  if (listen(fd, backlog))
   {
     _cupsSetHTTPError(HTTP_STATUS_ERROR);
 
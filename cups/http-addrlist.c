@@ -25,6 +25,59 @@
 #endif /* _WIN32 */
 
 
+/*
+ * Local constants...
+ */
+
+#define _HTTP_ADDR_CACHE_MAX	16	/* Maximum cached hostname lookups */
+#define _HTTP_ADDR_CACHE_TTL	60	/* Life of cached lookups in seconds */
+#define _HTTP_ADDR_FAIL_MAX	32	/* Maximum remembered connect failures */
+#define _HTTP_ADDR_FAIL_TTL	120	/* Life of connect failures in seconds */
+#define _HTTP_ADDR_ORDER_MAX	100	/* Maximum addresses tried per connect */
+
+
+/*
+ * Local types...
+ */
+
+typedef struct _http_addrcache_s	/* Cached hostname lookup */
+{
+  char		hostname[256],		/* Hostname */
+		service[32];		/* Service name or port number */
+  int		family;			/* Address family */
+  time_t	expires;		/* Time lookup expires */
+  http_addrlist_t *addrlist;		/* Address list */
+} _http_addrcache_t;
+
+typedef struct _http_addrfail_s		/* Failed connection address */
+{
+  http_addr_t	addr;			/* Address and port */
+  time_t	expires;		/* Time failure is forgotten */
+} _http_addrfail_t;
+
+
+/*
+ * Local globals...
+ */
+
+static _http_addrcache_t http_addrcache[_HTTP_ADDR_CACHE_MAX];
+					/* Cache of hostname lookups */
+static _http_addrfail_t	http_addrfail[_HTTP_ADDR_FAIL_MAX];
+					/* Recent connect failures */
+static _cups_mutex_t	http_addr_mutex = _CUPS_MUTEX_INITIALIZER;
+					/* Mutex for cache and failures */
+
+
+/*
+ * Local functions...
+ */
+
+static http_addrlist_t	*http_addr_cache_get(const char *hostname, int family, const char *service);
+static void		http_addr_cache_put(const char *hostname, int family, const char *service, http_addrlist_t *addrlist);
+static void		http_addr_failed(const http_addr_t *addr, int failed);
+static int		http_addr_order(http_addrlist_t *addrlist, http_addrlist_t **order, int max_order);
+
+
 /*
  * 'httpAddrConnect()' - Connect to any of the addresses in the list.
  *
@@ -46,6 +99,11 @@ httpAddrConnect(
  * 'httpAddrConnect2()' - Connect to any of the addresses in the list with a
  *                        timeout and optional cancel.
  *
+ * Addresses are tried in RFC 8305 order, alternating between address families
+ * starting with the first family in the list, with a new connection attempt
+ * started every 100 milliseconds until one succeeds.  Addresses that recently
+ * failed to connect are tried last.
+ *
  * @since CUPS 1.7/macOS 10.9@
  */
 
@@ -62,7 +120,11 @@ httpAddrConnect2(
 			flags,		/* Socket flags */
 			result;		/* Result from select() or poll() */
 #endif /* !_WIN32 */
-  int			remaining;	/* Remaining timeout */
+  int			remaining,	/* Remaining timeout */
+			next,		/* Next address to try */
+			norder;		/* Number of addresses to try */
+  http_addrlist_t	*order[_HTTP_ADDR_ORDER_MAX];
+					/* Addresses in connection order */
   int			nfds,		/* Number of file descriptors */
 			fds[100];	/* Socket file descriptors */
   http_addrlist_t	*addrs[100];	/* Addresses */
@@ -109,6 +171,9 @@ httpAddrConnect2(
 
   nfds      = 0;
   remaining = msec;
+  norder    = http_addr_order(addrlist, order, (int)(sizeof(order) / sizeof(order[0])));
+  next      = 0;
+  addrlist  = next < norder ? order[next ++] : NULL;
 
   while (remaining > 0)
   {
@@ -140,7 +205,7 @@ httpAddrConnect2(
 	* Just skip this address...
 	*/
 
-        addrlist = addrlist->next;
+        addrlist = next < norder ? order[next ++] : NULL;
 	continue;
       }
 
@@ -200,6 +265,8 @@ httpAddrConnect2(
 	fcntl(fds[nfds], F_SETFL, flags);
 #endif /* O_NONBLOCK */
 
+	http_addr_failed(&(addrlist->addr), 0);
+
 	*sock = fds[nfds];
 
 	while (nfds > 0)
@@ -218,8 +285,9 @@ httpAddrConnect2(
 #endif /* _WIN32 */
       {
 	DEBUG_printf(("1httpAddrConnect2: Unable to connect to %s:%d: %s", httpAddrString(&(addrlist->addr), temp, sizeof(temp)), httpAddrPort(&(addrlist->addr)), strerror(errno)));
+	http_addr_failed(&(addrlist->addr), 1);
 	httpAddrClose(NULL, fds[nfds]);
-	addrlist = addrlist->next;
+	addrlist = next < norder ? order[next ++] : NULL;
 	continue;
       }
 
@@ -234,7 +302,7 @@ httpAddrConnect2(
 
       addrs[nfds] = addrlist;
       nfds ++;
-      addrlist = addrlist->next;
+      addrlist = next < norder ? order[next ++] : NULL;
     }
 
     if (!addrlist && nfds == 0)
@@ -331,9 +399,11 @@ httpAddrConnect2(
 #  endif /* HAVE_POLL */
         {
          /*
-          * Error on socket, remove from the "pool"...
+          * Error on socket, remember the failure and remove from the
+          * "pool"...
           */
 
+	  http_addr_failed(&(addrs[i]->addr), 1);
 	  httpAddrClose(NULL, fds[i]);
           nfds --;
           if (i < nfds)
@@ -358,6 +428,8 @@ httpAddrConnect2(
         for (j ++; j < nfds; j ++)
           httpAddrClose(NULL, fds[j]);
 
+        http_addr_failed(&(connaddr->addr), 0);
+
         return (connaddr);
       }
     }
@@ -369,9 +441,14 @@ httpAddrConnect2(
       remaining -= 250;
   }
 
+ /*
+  * Out of time or addresses, remember any addresses that never answered...
+  */
+
   while (nfds > 0)
   {
     nfds --;
+    http_addr_failed(&(addrs[nfds]->addr), 1);
     httpAddrClose(NULL, fds[nfds]);
   }
 
@@ -478,6 +555,8 @@ httpAddrGetList(const char *hostname,	/* I - Hostname, IP address, or NULL for p
 			*temp;		/* New address */
   _cups_globals_t	*cg = _cupsGlobals();
 					/* Global data */
+  const char		*cachename = NULL;
+					/* Hostname for lookup cache */
 
 
 #ifdef DEBUG
@@ -515,6 +594,18 @@ httpAddrGetList(const char *hostname,	/* I - Hostname, IP address, or NULL for p
   }
 #endif /* HAVE_RES_INIT */
 
+ /*
+  * Use a cached lookup of a (non-numeric) hostname if we have one...
+  */
+
+  if (hostname && hostname[0] != '/' && hostname[0] != '[' && !isdigit(hostname[0] & 255) && _cups_strcasecmp(hostname, "localhost"))
+  {
+    cachename = hostname;
+
+    if ((first = http_addr_cache_get(cachename, family, service)) != NULL)
+      return (first);
+  }
+
  /*
   * Lookup the address the best way we can...
   */
@@ -947,8 +1038,241 @@ httpAddrGetList(const char *hostname,	/* I - Hostname, IP address, or NULL for p
   }
 
  /*
-  * Return the address list...
+  * Cache and return the address list...
   */
 
+  if (first && cachename)
+    http_addr_cache_put(cachename, family, service, first);
+
   return (first);
 }
+
+
+/*
+ * 'http_addr_cache_get()' - Get a copy of a cached hostname lookup.
+ */
+
+static http_addrlist_t *		/* O - Copy of address list or NULL */
+http_addr_cache_get(
+    const char *hostname,		/* I - Hostname */
+    int        family,			/* I - Address family */
+    const char *service)		/* I - Service name or port number */
+{
+  int			i;		/* Looping var */
+  _http_addrcache_t	*cache;		/* Current cache entry */
+  http_addrlist_t	*addrlist = NULL;
+					/* Copy of address list */
+  time_t		curtime = time(NULL);
+					/* Current time */
+
+
+  if (!service)
+    service = "";
+
+  _cupsMutexLock(&http_addr_mutex);
+
+  for (i = _HTTP_ADDR_CACHE_MAX, cache = http_addrcache; i > 0; i --, cache ++)
+  {
+    if (cache->addrlist && cache->family == family && cache->expires > curtime && !_cups_strcasecmp(cache->hostname, hostname) && !strcmp(cache->service, service))
+    {
+      DEBUG_printf(("4http_addr_cache_get: Using cached addresses for \"%s\".", hostname));
+      addrlist = httpAddrCopyList(cache->addrlist);
+      break;
+    }
+  }
+
+  _cupsMutexUnlock(&http_addr_mutex);
+
+  return (addrlist);
+}
+
+
+/*
+ * 'http_addr_cache_put()' - Cache a hostname lookup.
+ *
+ * The oldest (or an expired) entry is replaced when the cache is full.
+ */
+
+static void
+http_addr_cache_put(
+    const char      *hostname,		/* I - Hostname */
+    int             family,		/* I - Address family */
+    const char      *service,		/* I - Service name or port number */
+    http_addrlist_t *addrlist)		/* I - Address list */
+{
+  int			i;		/* Looping var */
+  _http_addrcache_t	*cache,		/* Current cache entry */
+			*oldest;	/* Entry to replace */
+  http_addrlist_t	*copy;		/* Copy of address list */
+
+
+  if (!service)
+    service = "";
+
+  if (strlen(hostname) >= sizeof(oldest->hostname) || strlen(service) >= sizeof(oldest->service))
+    return;
+
+  if ((copy = httpAddrCopyList(addrlist)) == NULL)
+    return;
+
+  _cupsMutexLock(&http_addr_mutex);
+
+  for (i = _HTTP_ADDR_CACHE_MAX, cache = http_addrcache, oldest = cache; i > 0; i --, cache ++)
+  {
+    if (cache->addrlist && cache->family == family && !_cups_strcasecmp(cache->hostname, hostname) && !strcmp(cache->service, service))
+    {
+      oldest = cache;
+      break;
+    }
+    else if (cache->expires < oldest->expires)
+      oldest = cache;
+  }
+
+  httpAddrFreeList(oldest->addrlist);
+
+  strlcpy(oldest->hostname, hostname, sizeof(oldest->hostname));
+  strlcpy(oldest->service, service, sizeof(oldest->service));
+  oldest->family   = family;
+  oldest->expires  = time(NULL) + _HTTP_ADDR_CACHE_TTL;
+  oldest->addrlist = copy;
+
+  _cupsMutexUnlock(&http_addr_mutex);
+}
+
+
+/*
+ * 'http_addr_failed()' - Remember or forget a connection failure for an
+ *                        address.
+ */
+
+static void
+http_addr_failed(
+    const http_addr_t *addr,		/* I - Address */
+    int               failed)		/* I - 1 if the connection failed, 0 if it succeeded */
+{
+  int			i;		/* Looping var */
+  _http_addrfail_t	*fail,		/* Current failure */
+			*oldest;	/* Entry to replace */
+  time_t		curtime = time(NULL);
+					/* Current time */
+
+
+  _cupsMutexLock(&http_addr_mutex);
+
+  for (i = _HTTP_ADDR_FAIL_MAX, fail = http_addrfail, oldest = fail; i > 0; i --, fail ++)
+  {
+    if (fail->expires > curtime && httpAddrEqual(&(fail->addr), addr) && httpAddrPort(&(fail->addr)) == httpAddrPort((http_addr_t *)addr))
+    {
+      oldest = fail;
+      break;
+    }
+    else if (fail->expires < oldest->expires)
+      oldest = fail;
+  }
+
+  if (failed)
+  {
+    memcpy(&(oldest->addr), addr, sizeof(oldest->addr));
+    oldest->expires = curtime + _HTTP_ADDR_FAIL_TTL;
+  }
+  else if (i > 0)
+  {
+    oldest->expires = 0;
+  }
+
+  _cupsMutexUnlock(&http_addr_mutex);
+}
+
+
+/*
+ * 'http_addr_order()' - Order addresses for connection attempts.
+ *
+ * Addresses are interleaved by family, starting with the family of the first
+ * address, as described in RFC 8305 section 4.  Addresses with a recent
+ * connection failure are moved to the end.
+ */
+
+static int				/* O - Number of addresses */
+http_addr_order(
+    http_addrlist_t *addrlist,		/* I - Address list */
+    http_addrlist_t **order,		/* I - Ordered address array */
+    int             max_order)		/* I - Size of ordered address array */
+{
+  int			i,		/* Looping var */
+			pass,		/* Current pass (0 = good, 1 = failed) */
+			count,		/* Number of ordered addresses */
+			first_count,	/* Number of addresses in first family */
+			other_count;	/* Number of addresses in other families */
+  int			failed[_HTTP_ADDR_ORDER_MAX];
+					/* Did the address fail recently? */
+  http_addrlist_t	*all[_HTTP_ADDR_ORDER_MAX],
+					/* Addresses in list order */
+			*first[_HTTP_ADDR_ORDER_MAX],
+					/* Addresses in first family */
+			*other[_HTTP_ADDR_ORDER_MAX];
+					/* Addresses in other families */
+  int			num_all,	/* Number of addresses */
+			first_family = AF_UNSPEC;
+					/* First address family */
+  _http_addrfail_t	*fail;		/* Current failure */
+  time_t		curtime = time(NULL);
+					/* Current time */
+
+
+  if (max_order > _HTTP_ADDR_ORDER_MAX)
+    max_order = _HTTP_ADDR_ORDER_MAX;
+
+ /*
+  * Copy the list and look up recent failures...
+  */
+
+  _cupsMutexLock(&http_addr_mutex);
+
+  for (num_all = 0; addrlist && num_all < max_order; addrlist = addrlist->next, num_all ++)
+  {
+    all[num_all]    = addrlist;
+    failed[num_all] = 0;
+
+    for (i = _HTTP_ADDR_FAIL_MAX, fail = http_addrfail; i > 0; i --, fail ++)
+    {
+      if (fail->expires > curtime && httpAddrEqual(&(fail->addr), &(addrlist->addr)) && httpAddrPort(&(fail->addr)) == httpAddrPort(&(addrlist->addr)))
+      {
+        failed[num_all] = 1;
+        break;
+      }
+    }
+  }
+
+  _cupsMutexUnlock(&http_addr_mutex);
+
+ /*
+  * Interleave the good addresses and then the failed ones...
+  */
+
+  for (pass = 0, count = 0; pass < 2; pass ++)
+  {
+    for (i = 0, first_count = 0, other_count = 0; i < num_all; i ++)
+    {
+      if (failed[i] != pass)
+        continue;
+
+      if (first_family == AF_UNSPEC)
+        first_family = httpAddrFamily(&(all[i]->addr));
+
+      if (httpAddrFamily(&(all[i]->addr)) == first_family)
+        first[first_count ++] = all[i];
+      else
+        other[other_count ++] = all[i];
+    }
+
+    for (i = 0; i < first_count || i < other_count; i ++)
+    {
+      if (i < first_count)
+        order[count ++] = first[i];
+      if (i < other_count)
+        order[count ++] = other[i];
+    }
+  }
+
+  return (count);
+}
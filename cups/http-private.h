@@ -117,6 +117,7 @@ extern "C" {
  */
 
 #  define _HTTP_MAX_SBUFFER	65536	/* Size of (de)compression buffer */
+#  define _HTTP_SERVER_BUFFER	32768	/* Default buffer size for server connections */
 #  define _HTTP_RESOLVE_DEFAULT	0	/* Just resolve with default options */
 #  define _HTTP_RESOLVE_STDERR	1	/* Log resolve progress to stderr */
 #  define _HTTP_RESOLVE_FQDN	2	/* Resolve to a FQDN */
@@ -227,8 +228,7 @@ struct _http_s				/**** HTTP connection structure ****/
   http_encoding_t	data_encoding;	/* Chunked or not */
   int			_data_remaining;/* Number of bytes left (deprecated) */
   int			used;		/* Number of bytes used in buffer */
-  char			buffer[HTTP_MAX_BUFFER];
-					/* Buffer for incoming data */
+  char			*buffer;	/* Buffer for incoming data */
   int			_auth_type;	/* Authentication in use (deprecated) */
   unsigned char		_md5_state[88];	/* MD5 state (deprecated) */
   char			nonce[HTTP_MAX_VALUE];
@@ -253,8 +253,7 @@ struct _http_s				/**** HTTP connection structure ****/
   off_t			data_remaining;	/* Number of bytes left */
   http_addr_t		*hostaddr;	/* Current host address and port */
   http_addrlist_t	*addrlist;	/* List of valid addresses */
-  char			wbuffer[HTTP_MAX_BUFFER];
-					/* Buffer for outgoing data */
+  char			*wbuffer;	/* Buffer for outgoing data */
   int			wused;		/* Write buffer bytes used */
 
   /**** New in CUPS 1.3 ****/
@@ -302,6 +301,16 @@ struct _http_s				/**** HTTP connection structure ****/
 					/* Allocated field values */
   			*default_fields[HTTP_FIELD_MAX];
 					/* Default field values, if any */
+  size_t		fields_used;	/* Bytes used in fields_arena */
+  char			fields_arena[HTTP_MAX_BUFFER];
+					/* Storage for field values until httpClearFields */
+#  ifdef HAVE_GNUTLS
+  gnutls_datum_t	tls_session;	/* Saved TLS session for resumption */
+#  endif /* HAVE_GNUTLS */
+  size_t		bufsize,	/* Size of input buffer */
+			wbufsize;	/* Size of output buffer */
+  int			compression_level;
+					/* Content coding compression level */
 };
 #  endif /* !_HTTP_NO_PRIVATE */
 
@@ -320,6 +329,7 @@ extern const char *_cups_hstrerror(int error);
  * Prototypes...
  */
 
+extern int		_httpAddrListen(http_addr_t *addr, int port, int backlog, int shared) _CUPS_PRIVATE;
 extern void		_httpAddrSetPort(http_addr_t *addr, int port) _CUPS_PRIVATE;
 extern http_tls_credentials_t
 			_httpCreateCredentials(cups_array_t *credentials) _CUPS_PRIVATE;
@@ -329,10 +339,14 @@ extern void		_httpDisconnect(http_t *http) _CUPS_PRIVATE;
 extern char		*_httpEncodeURI(char *dst, const char *src,
 			                size_t dstsize) _CUPS_PRIVATE;
 extern void		_httpFreeCredentials(http_tls_credentials_t credentials) _CUPS_PRIVATE;
+extern int		_httpPipelineReady(http_t *http) _CUPS_PRIVATE;
+extern ssize_t		_httpReadFile(http_t *http, int fd) _CUPS_PRIVATE;
 extern const char	*_httpResolveURI(const char *uri, char *resolved_uri,
 			                 size_t resolved_size, int options,
 					 int (*cb)(void *context),
 					 void *context) _CUPS_PRIVATE;
+extern http_uri_status_t
+			_httpSeparateResource(const char *uri, char *resource, size_t resourcesize) _CUPS_PRIVATE;
 extern int		_httpSetDigestAuthString(http_t *http, const char *nonce, const char *method, const char *resource) _CUPS_PRIVATE;
 extern const char	*_httpStatus(cups_lang_t *lang, http_status_t status) _CUPS_PRIVATE;
 extern void		_httpTLSInitialize(void) _CUPS_PRIVATE;
@@ -344,6 +358,7 @@ extern void		_httpTLSStop(http_t *http) _CUPS_PRIVATE;
 extern int		_httpTLSWrite(http_t *http, const char *buf, int len) _CUPS_PRIVATE;
 extern int		_httpUpdate(http_t *http, http_status_t *status) _CUPS_PRIVATE;
 extern int		_httpWait(http_t *http, int msec, int usessl) _CUPS_PRIVATE;
+extern ssize_t		_httpWriteFile(http_t *http, int fd, size_t length) _CUPS_PRIVATE;
 
 
 /*
@@ -1296,6 +1296,112 @@ httpSeparateURI(
 }
 
 
+/*
+ * '_httpSeparateResource()' - Separate the resource path from a URI.
+ *
+ * Well-formed URIs ("scheme://host[:port]/path" without userinfo, query,
+ * fragment, or percent-encoding) are split without decoding or copying the
+ * other components.  Anything else is handed to @link httpSeparateURI@ with
+ * full decoding so the results and status codes match.
+ */
+
+http_uri_status_t			/* O - Result of separation */
+_httpSeparateResource(
+    const char *uri,			/* I - Universal Resource Identifier */
+    char       *resource,		/* O - Resource/filename */
+    size_t     resourcesize)		/* I - Size of resource buffer */
+{
+  const char	*ptr,			/* Pointer into URI */
+		*host,			/* Start of hostname */
+		*path;			/* Start of resource */
+  long		port;			/* Port number */
+  size_t	pathlen;		/* Length of resource */
+  char		scheme[32],		/* Scheme (ignored) */
+		userpass[256],		/* Username:password (ignored) */
+		hostname[256];		/* Hostname (ignored) */
+  int		portnum;		/* Port number (ignored) */
+
+
+  if (!uri || !resource || resourcesize == 0)
+    return (HTTP_URI_STATUS_BAD_ARGUMENTS);
+
+ /*
+  * Scheme...
+  */
+
+  ptr = uri;
+
+  if (!isalpha(*ptr & 255))
+    goto slow_path;
+
+  for (ptr ++; isalnum(*ptr & 255) || *ptr == '+' || *ptr == '-' || *ptr == '.'; ptr ++);
+
+  if ((ptr - uri) >= (ptrdiff_t)sizeof(scheme) || strncmp(ptr, "://", 3))
+    goto slow_path;
+
+ /*
+  * Hostname and optional port...
+  */
+
+  host = ptr + 3;
+
+  if (*host == '[')
+  {
+    for (ptr = host + 1; isxdigit(*ptr & 255) || *ptr == ':' || *ptr == '.'; ptr ++);
+
+    if (*ptr != ']')
+      goto slow_path;
+
+    ptr ++;
+  }
+  else
+  {
+    for (ptr = host; isalnum(*ptr & 255) || *ptr == '-' || *ptr == '.' || *ptr == '_'; ptr ++);
+
+    if (ptr == host)
+      goto slow_path;
+  }
+
+  if ((ptr - host) >= (ptrdiff_t)sizeof(hostname))
+    goto slow_path;
+
+  if (*ptr == ':')
+  {
+    if (!isdigit(ptr[1] & 255))
+      goto slow_path;
+
+    port = strtol(ptr + 1, (char **)&ptr, 10);
+
+    if (port <= 0 || port > 65535)
+      goto slow_path;
+  }
+
+  if (*ptr != '/')
+    goto slow_path;
+
+ /*
+  * Resource path, which must not need decoding...
+  */
+
+  for (path = ptr; *ptr > ' ' && *ptr < 0x7f && *ptr != '%' && *ptr != '?' && *ptr != '#'; ptr ++);
+
+  if (*ptr || (pathlen = (size_t)(ptr - path)) >= resourcesize)
+    goto slow_path;
+
+  memcpy(resource, path, pathlen + 1);
+
+  return (HTTP_URI_STATUS_OK);
+
+ /*
+  * Fall back to the full parser...
+  */
+
+  slow_path:
+
+  return (httpSeparateURI(HTTP_URI_CODING_ALL, uri, scheme, sizeof(scheme), userpass, sizeof(userpass), hostname, sizeof(hostname), &portnum, resource, (int)resourcesize));
+}
+
+
 /*
  * '_httpSetDigestAuthString()' - Calculate a Digest authentication response
  *                                using the appropriate RFC 2068/2617/7616
@@ -29,6 +29,9 @@
 #ifdef HAVE_POLL
 #  include <poll.h>
 #endif /* HAVE_POLL */
+#ifdef HAVE_SYS_SENDFILE_H
+#  include <sys/sendfile.h>
+#endif /* HAVE_SYS_SENDFILE_H */
 #  ifdef HAVE_LIBZ
 #    include <zlib.h>
 #  endif /* HAVE_LIBZ */
@@ -39,6 +42,7 @@
  */
 
 static void		http_add_field(http_t *http, http_field_t field, const char *value, int append);
+static char		*http_alloc_field(http_t *http, size_t bytes);
 #ifdef HAVE_LIBZ
 static void		http_content_coding_finish(http_t *http);
 static void		http_content_coding_start(http_t *http,
@@ -52,6 +56,8 @@ static http_t		*http_create(const char *host, int port,
 static void		http_debug_hex(const char *prefix, const char *buffer,
 			               int bytes);
 #endif /* DEBUG */
+static int		http_field_allocated(http_t *http, http_field_t field);
+static void		http_free_field(http_t *http, http_field_t field);
 static ssize_t		http_read(http_t *http, char *buffer, size_t length);
 static ssize_t		http_read_buffered(http_t *http, char *buffer, size_t length);
 static ssize_t		http_read_chunk(http_t *http, char *buffer, size_t length);
@@ -106,7 +112,21 @@ static const char * const http_fields[] =
 			  "Accept-Encoding",
 			  "Allow",
 			  "Server",
-			  "Authentication-Info"
+			  "Authentication-Info",
+			  "ETag",
+			  "If-None-Match",
+			  "Cache-Control"
+			};
+static const signed char http_field_hash[128] =
+			{		/* Perfect hash of http_fields, see httpFieldValue */
+			  -1, 16,  8, -1, 14, -1, 15, -1, -1, 31, 20, -1, 27, -1, -1, -1,
+			  -1,  4, 24, -1, -1, -1, -1, -1, -1, -1, -1, -1,  6, -1, -1, 26,
+			  -1, -1, -1, -1, -1, -1,  1, 32, -1, -1, -1, -1, -1, -1, -1, -1,
+			  -1, -1, -1, -1, 23, 21, 29, -1, 13, 22, -1, -1, -1, -1, -1, -1,
+			  -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, 18, -1, -1, -1, 33,
+			  -1, -1, 28, -1, -1, -1, -1, -1, 25, -1, -1, -1, -1, -1, -1, -1,
+			  -1, -1, -1, -1, -1,  2,  3, -1, -1, -1, -1, 11,  7, 12, -1, -1,
+			  -1, -1,  0, 10,  9, -1, 19,  5, 30, 17, -1, -1, -1, -1, -1, -1
 			};
 
 
@@ -298,12 +318,9 @@ httpClearFields(http_t *http)		/* I - HTTP connection */
     memset(http->_fields, 0, sizeof(http->fields));
 
     for (field = HTTP_FIELD_ACCEPT_LANGUAGE; field < HTTP_FIELD_MAX; field ++)
-    {
-      if (http->fields[field] && http->fields[field] != http->_fields[field])
-        free(http->fields[field]);
+      http_free_field(http, field);
 
-      http->fields[field] = NULL;
-    }
+    http->fields_used = 0;
 
     if (http->mode == _HTTP_MODE_CLIENT)
     {
@@ -372,6 +389,13 @@ httpClose(http_t *http)			/* I - HTTP connection */
   if (http->authstring && http->authstring != http->_authstring)
     free(http->authstring);
 
+#ifdef HAVE_GNUTLS
+  if (http->tls_session.data)
+    gnutls_free(http->tls_session.data);
+#endif /* HAVE_GNUTLS */
+
+  free(http->buffer);
+  free(http->wbuffer);
   free(http);
 }
 
@@ -585,14 +609,24 @@ httpError(http_t *http)			/* I - HTTP connection */
 http_field_t				/* O - Field index */
 httpFieldValue(const char *name)	/* I - String name */
 {
-  int	i;				/* Looping var */
+  size_t	len;			/* Length of name */
+  int		field;			/* Field index */
 
 
-  for (i = 0; i < HTTP_FIELD_MAX; i ++)
-    if (!_cups_strcasecmp(name, http_fields[i]))
-      return ((http_field_t)i);
+  if (!name || (len = strlen(name)) == 0)
+    return (HTTP_FIELD_UNKNOWN);
 
-  return (HTTP_FIELD_UNKNOWN);
+ /*
+  * The length and the lowercase first and last characters form a perfect
+  * hash of the known field names, so only one comparison is needed...
+  */
+
+  field = http_field_hash[(len + 2 * (size_t)_cups_tolower(name[0] & 255) + 13 * (size_t)_cups_tolower(name[len - 1] & 255)) & 127];
+
+  if (field >= 0 && !_cups_strcasecmp(name, http_fields[field]))
+    return ((http_field_t)field);
+  else
+    return (HTTP_FIELD_UNKNOWN);
 }
 
 
@@ -1175,7 +1209,7 @@ httpGets(char   *line,			/* I - Line to read into */
         return (NULL);
       }
 
-      bytes = http_read(http, http->buffer + http->used, (size_t)(HTTP_MAX_BUFFER - http->used));
+      bytes = http_read(http, http->buffer + http->used, http->bufsize - (size_t)http->used);
 
       DEBUG_printf(("4httpGets: read " CUPS_LLFMT " bytes.", CUPS_LLCAST bytes));
 
@@ -1704,8 +1738,8 @@ httpPeek(http_t *http,			/* I - HTTP connection */
       }
     }
 
-    if ((size_t)http->data_remaining > sizeof(http->buffer))
-      buflen = sizeof(http->buffer);
+    if ((size_t)http->data_remaining > http->bufsize)
+      buflen = (ssize_t)http->bufsize;
     else
       buflen = (ssize_t)http->data_remaining;
 
@@ -1836,6 +1870,34 @@ httpPeek(http_t *http,			/* I - HTTP connection */
 }
 
 
+/*
+ * '_httpPipelineReady()' - Determine whether a complete request header is
+ *                          already buffered.
+ *
+ * Servers use this to defer flushing a response while the client has already
+ * pipelined another request, so that several responses share one write.
+ */
+
+int					/* O - 1 if a request is buffered, 0 otherwise */
+_httpPipelineReady(http_t *http)	/* I - HTTP connection */
+{
+  const char	*bufptr,		/* Pointer into buffer */
+		*bufend;		/* End of buffer */
+
+
+  if (!http || http->used <= 0 || http->state != HTTP_STATE_WAITING)
+    return (0);
+
+  for (bufptr = http->buffer, bufend = http->buffer + http->used - 1; bufptr < bufend; bufptr ++)
+  {
+    if (*bufptr == '\n' && (bufptr[1] == '\n' || (bufptr[1] == '\r' && bufptr + 2 <= bufend && bufptr[2] == '\n')))
+      return (1);
+  }
+
+  return (0);
+}
+
+
 /*
  * 'httpPost()' - Send a POST request to the server.
  */
@@ -2132,6 +2194,187 @@ httpRead2(http_t *http,			/* I - HTTP connection */
 }
 
 
+/*
+ * '_httpReadFile()' - Copy the rest of the message body to a file.
+ *
+ * Unencrypted, uncompressed, fixed-length message bodies are moved from the
+ * socket to the file using splice() when available.  Everything else is
+ * copied using @link httpRead2@.
+ *
+ * -1 is returned on error.  @link httpError@ returns the error for read
+ * errors, otherwise errno contains the write error.
+ */
+
+ssize_t					/* O - Number of bytes copied or -1 on error */
+_httpReadFile(http_t *http,		/* I - HTTP connection */
+              int    fd)		/* I - File descriptor */
+{
+  ssize_t	bytes,			/* Bytes read */
+		total = 0;		/* Total bytes copied */
+  char		buffer[32768];		/* Copy buffer */
+
+
+  DEBUG_printf(("_httpReadFile(http=%p, fd=%d)", (void *)http, fd));
+
+  if (!http || fd < 0)
+    return (-1);
+
+  http->error = 0;
+
+#ifdef HAVE_SPLICE
+  if (http->data_encoding == HTTP_ENCODING_LENGTH && http->data_remaining > 0 && http->blocking &&
+#  ifdef HAVE_LIBZ
+      http->coding == _HTTP_CODING_IDENTITY &&
+#  endif /* HAVE_LIBZ */
+#  ifdef HAVE_SSL
+      !http->tls &&
+#  endif /* HAVE_SSL */
+      1)
+  {
+    int		pipefd[2];		/* Pipe for splice() */
+    ssize_t	outbytes;		/* Bytes written */
+
+    if (!pipe(pipefd))
+    {
+      http->activity = time(NULL);
+
+     /*
+      * Write any data that has already been buffered...
+      */
+
+      if (http->used > 0)
+      {
+        bytes = http->used;
+        if (bytes > http->data_remaining)
+          bytes = (ssize_t)http->data_remaining;
+
+        for (outbytes = 0; outbytes < bytes;)
+        {
+          ssize_t temp = write(fd, http->buffer + outbytes, (size_t)(bytes - outbytes));
+					/* Bytes written */
+
+          if (temp < 0)
+          {
+            if (errno == EINTR)
+              continue;
+
+            close(pipefd[0]);
+            close(pipefd[1]);
+            return (-1);
+          }
+
+          outbytes += temp;
+        }
+
+        http->used           -= (int)bytes;
+        http->data_remaining -= bytes;
+        total                += bytes;
+
+        if (http->used > 0)
+          memmove(http->buffer, http->buffer + bytes, (size_t)http->used);
+      }
+
+     /*
+      * Then move the rest from the socket to the file...
+      */
+
+      while (http->data_remaining > 0)
+      {
+        if (http->timeout_value > 0.0)
+        {
+          while (!httpWait(http, http->wait_value))
+          {
+	    if (http->timeout_cb && (*http->timeout_cb)(http, http->timeout_data))
+	      continue;
+
+            http->error = ETIMEDOUT;
+            break;
+          }
+
+          if (http->error)
+            break;
+        }
+
+        bytes = http->data_remaining > 1048576 ? 1048576 : (ssize_t)http->data_remaining;
+
+        if ((bytes = splice(http->fd, NULL, pipefd[1], NULL, (size_t)bytes, SPLICE_F_MOVE | SPLICE_F_MORE)) <= 0)
+        {
+          if (bytes < 0 && errno == EINTR)
+            continue;
+
+          http->error = bytes < 0 ? errno : EPIPE;
+          break;
+        }
+
+        http->activity        = time(NULL);
+        http->data_remaining -= bytes;
+
+        while (bytes > 0)
+        {
+          if ((outbytes = splice(pipefd[0], NULL, fd, NULL, (size_t)bytes, SPLICE_F_MOVE | SPLICE_F_MORE)) < 0)
+          {
+            if (errno == EINTR)
+              continue;
+
+            close(pipefd[0]);
+            close(pipefd[1]);
+            return (-1);
+          }
+
+          bytes -= outbytes;
+          total += outbytes;
+        }
+      }
+
+      close(pipefd[0]);
+      close(pipefd[1]);
+
+      if (http->error)
+        return (-1);
+
+     /*
+      * End of content, update the state as httpRead2 does...
+      */
+
+      if (http->state == HTTP_STATE_POST_RECV)
+	http->state ++;
+      else if (http->state == HTTP_STATE_GET_SEND || http->state == HTTP_STATE_POST_SEND)
+	http->state = HTTP_STATE_WAITING;
+      else
+	http->state = HTTP_STATE_STATUS;
+
+      DEBUG_printf(("1_httpReadFile: Spliced " CUPS_LLFMT " bytes, set state to %s.", CUPS_LLCAST total, httpStateString(http->state)));
+
+      return (total);
+    }
+  }
+#endif /* HAVE_SPLICE */
+
+  while ((bytes = httpRead2(http, buffer, sizeof(buffer))) > 0)
+  {
+    if (write(fd, buffer, (size_t)bytes) < bytes)
+      return (-1);
+
+    total += bytes;
+  }
+
+  if (bytes < 0)
+  {
+   /*
+    * Not every httpRead2 error path sets http->error, so make sure that
+    * callers can tell a read error from a write error...
+    */
+
+    if (!http->error)
+      http->error = EIO;
+
+    return (-1);
+  }
+
+  return (total);
+}
+
+
 /*
  * 'httpReadRequest()' - Read a HTTP request from a connection.
  *
@@ -2499,6 +2742,97 @@ httpSetAuthString(http_t     *http,	/* I - HTTP connection */
 }
 
 
+/*
+ * 'httpSetBufferSize()' - Set the sizes of the input and output buffers.
+ *
+ * Larger buffers reduce the number of system calls needed to transfer large
+ * documents.  Pass 0 to keep the current size of a buffer.  Sizes smaller
+ * than @code HTTP_MAX_BUFFER@ are increased to @code HTTP_MAX_BUFFER@.
+ *
+ * Server connections default to 32k buffers, client connections to
+ * @code HTTP_MAX_BUFFER@ bytes.  Any pending output is flushed before the
+ * output buffer is resized.
+ *
+ * @since CUPS 2.3@
+ */
+
+int					/* O - 0 on success, -1 on error */
+httpSetBufferSize(http_t *http,		/* I - HTTP connection */
+                  size_t bufsize,	/* I - Input buffer size or 0 */
+                  size_t wbufsize)	/* I - Output buffer size or 0 */
+{
+  char	*buffer;			/* New buffer */
+
+
+  DEBUG_printf(("httpSetBufferSize(http=%p, bufsize=" CUPS_LLFMT ", wbufsize=" CUPS_LLFMT ")", (void *)http, CUPS_LLCAST bufsize, CUPS_LLCAST wbufsize));
+
+  if (!http || bufsize > INT_MAX || wbufsize > INT_MAX)
+    return (-1);
+
+  if (bufsize > 0 && bufsize < HTTP_MAX_BUFFER)
+    bufsize = HTTP_MAX_BUFFER;
+
+  if (wbufsize > 0 && wbufsize < HTTP_MAX_BUFFER)
+    wbufsize = HTTP_MAX_BUFFER;
+
+  if (bufsize > 0 && bufsize != http->bufsize)
+  {
+    if ((size_t)http->used > bufsize)
+    {
+      DEBUG_puts("1httpSetBufferSize: Too much buffered input.");
+      return (-1);
+    }
+
+    if ((buffer = realloc(http->buffer, bufsize)) == NULL)
+    {
+      _cupsSetError(IPP_STATUS_ERROR_INTERNAL, strerror(errno), 0);
+      return (-1);
+    }
+
+    http->buffer  = buffer;
+    http->bufsize = bufsize;
+  }
+
+  if (wbufsize > 0 && wbufsize != http->wbufsize)
+  {
+    if (http->wused && httpFlushWrite(http) < 0)
+      return (-1);
+
+    if ((buffer = realloc(http->wbuffer, wbufsize)) == NULL)
+    {
+      _cupsSetError(IPP_STATUS_ERROR_INTERNAL, strerror(errno), 0);
+      return (-1);
+    }
+
+    http->wbuffer  = buffer;
+    http->wbufsize = wbufsize;
+  }
+
+  return (0);
+}
+
+
+/*
+ * 'httpSetCompressionLevel()' - Set the compression level for content coding.
+ *
+ * The level applies to the next "deflate" or "gzip" content coding that is
+ * started on the connection.  Levels range from 1 (fastest) to 9 (smallest
+ * output).  Pass 0 to use the zlib default level.
+ *
+ * @since CUPS 2.3@
+ */
+
+void
+httpSetCompressionLevel(http_t *http,	/* I - HTTP connection */
+                        int    level)	/* I - Compression level (0 for default, 1-9) */
+{
+  DEBUG_printf(("httpSetCompressionLevel(http=%p, level=%d)", (void *)http, level));
+
+  if (http && level >= 0 && level <= 9)
+    http->compression_level = level;
+}
+
+
 /*
  * 'httpSetCredentials()' - Set the credentials associated with an encrypted
  *			    connection.
@@ -3220,7 +3554,7 @@ httpWrite2(http_t     *http,		/* I - HTTP connection */
 #endif /* HAVE_LIBZ */
   if (length > 0)
   {
-    if (http->wused && (length + (size_t)http->wused) > sizeof(http->wbuffer))
+    if (http->wused && (length + (size_t)http->wused) > http->wbufsize)
     {
       DEBUG_printf(("2httpWrite2: Flushing buffer (wused=%d, length="
                     CUPS_LLFMT ")", http->wused, CUPS_LLCAST length));
@@ -3228,7 +3562,7 @@ httpWrite2(http_t     *http,		/* I - HTTP connection */
       httpFlushWrite(http);
     }
 
-    if ((length + (size_t)http->wused) <= sizeof(http->wbuffer) && length < sizeof(http->wbuffer))
+    if ((length + (size_t)http->wused) <= http->wbufsize && length < http->wbufsize)
     {
      /*
       * Write to buffer...
@@ -3322,6 +3656,94 @@ httpWrite2(http_t     *http,		/* I - HTTP connection */
 }
 
 
+/*
+ * '_httpWriteFile()' - Copy data from a file to the message body.
+ *
+ * Up to "length" bytes are copied from the current offset of the file.
+ * Unencrypted, uncompressed, fixed-length message bodies are sent using
+ * sendfile() when available so the data is not copied through user space.
+ * Everything else is copied using @link httpWrite2@.
+ */
+
+ssize_t					/* O - Number of bytes copied or -1 on error */
+_httpWriteFile(http_t *http,		/* I - HTTP connection */
+               int    fd,		/* I - File descriptor */
+               size_t length)		/* I - Maximum number of bytes to copy */
+{
+  ssize_t	bytes = 0,		/* Bytes read */
+		total = 0;		/* Total bytes copied */
+  char		buffer[32768];		/* Copy buffer */
+
+
+  DEBUG_printf(("_httpWriteFile(http=%p, fd=%d, length=" CUPS_LLFMT ")", (void *)http, fd, CUPS_LLCAST length));
+
+  if (!http || fd < 0)
+    return (-1);
+
+#ifdef HAVE_SYS_SENDFILE_H
+  if (http->data_encoding == HTTP_ENCODING_LENGTH && (off_t)length <= http->data_remaining && http->blocking &&
+#  ifdef HAVE_LIBZ
+      http->coding == _HTTP_CODING_IDENTITY &&
+#  endif /* HAVE_LIBZ */
+#  ifdef HAVE_SSL
+      !http->tls &&
+#  endif /* HAVE_SSL */
+      1)
+  {
+   /*
+    * Send anything that has been buffered, then let the kernel copy the file
+    * to the socket...
+    */
+
+    if (http->wused && httpFlushWrite(http) < 0)
+      return (-1);
+
+    while ((size_t)total < length)
+    {
+      http->activity = time(NULL);
+
+      bytes = (length - (size_t)total) > 1048576 ? 1048576 : (ssize_t)(length - (size_t)total);
+
+      if ((bytes = sendfile(http->fd, fd, NULL, (size_t)bytes)) <= 0)
+      {
+        if (bytes < 0 && errno == EINTR)
+          continue;
+
+        http->error  = bytes < 0 ? errno : EIO;
+        http->status = HTTP_STATUS_ERROR;
+
+        return (-1);
+      }
+
+      http->data_remaining -= bytes;
+      total                += bytes;
+    }
+
+   /*
+    * Finish the message as httpWrite2 does...
+    */
+
+    if (http->data_remaining == 0 && httpWrite2(http, "", 0) < 0)
+      return (-1);
+
+    DEBUG_printf(("1_httpWriteFile: Sent " CUPS_LLFMT " bytes, state is %s.", CUPS_LLCAST total, httpStateString(http->state)));
+
+    return (total);
+  }
+#endif /* HAVE_SYS_SENDFILE_H */
+
+  while ((size_t)total < length && (bytes = read(fd, buffer, (length - (size_t)total) > sizeof(buffer) ? sizeof(buffer) : length - (size_t)total)) > 0)
+  {
+    if (httpWrite2(http, buffer, (size_t)bytes) < 0)
+      return (-1);
+
+    total += bytes;
+  }
+
+  return (bytes < 0 ? -1 : total);
+}
+
+
 /*
  * 'httpWriteResponse()' - Write a HTTP response to a client connection.
  *
@@ -3595,22 +4017,18 @@ http_add_field(http_t       *http,	/* I - HTTP connection */
     }
   }
 
-  if (append && field != HTTP_FIELD_ACCEPT_ENCODING && field != HTTP_FIELD_ACCEPT_LANGUAGE && field != HTTP_FIELD_ACCEPT_RANGES && field != HTTP_FIELD_ALLOW && field != HTTP_FIELD_LINK && field != HTTP_FIELD_TRANSFER_ENCODING && field != HTTP_FIELD_UPGRADE && field != HTTP_FIELD_WWW_AUTHENTICATE)
+  if (append && field != HTTP_FIELD_ACCEPT_ENCODING && field != HTTP_FIELD_ACCEPT_LANGUAGE && field != HTTP_FIELD_ACCEPT_RANGES && field != HTTP_FIELD_ALLOW && field != HTTP_FIELD_IF_NONE_MATCH && field != HTTP_FIELD_LINK && field != HTTP_FIELD_TRANSFER_ENCODING && field != HTTP_FIELD_UPGRADE && field != HTTP_FIELD_WWW_AUTHENTICATE)
     append = 0;
 
   if (!append && http->fields[field])
-  {
-    if (http->fields[field] != http->_fields[field])
-      free(http->fields[field]);
-
-    http->fields[field] = NULL;
-  }
+    http_free_field(http, field);
 
   valuelen = strlen(value);
 
   if (!valuelen)
   {
-    http->_fields[field][0] = '\0';
+    if (field < HTTP_FIELD_ACCEPT_ENCODING)
+      http->_fields[field][0] = '\0';
     return;
   }
 
@@ -3652,12 +4070,12 @@ http_add_field(http_t       *http,	/* I - HTTP connection */
 
     char	*combined;		/* New value string */
 
-    if (http->fields[field] == http->_fields[field])
+    if (!http_field_allocated(http, field))
     {
-      if ((combined = malloc(total + 1)) != NULL)
+      if ((combined = http_alloc_field(http, total + 1)) != NULL)
       {
+	snprintf(combined, total + 1, "%s, %s", http->fields[field], value);
 	http->fields[field] = combined;
-	snprintf(combined, total + 1, "%s, %s", http->_fields[field], value);
       }
     }
     else if ((combined = realloc(http->fields[field], total + 1)) != NULL)
@@ -3667,13 +4085,13 @@ http_add_field(http_t       *http,	/* I - HTTP connection */
       strlcat(combined, value, total + 1);
     }
   }
-  else
+  else if ((http->fields[field] = http_alloc_field(http, valuelen + 1)) != NULL)
   {
    /*
-    * Allocate the field value...
+    * Copy the field value...
     */
 
-    http->fields[field] = strdup(value);
+    memcpy(http->fields[field], value, valuelen + 1);
   }
 
 #ifdef HAVE_LIBZ
@@ -3686,6 +4104,32 @@ http_add_field(http_t       *http,	/* I - HTTP connection */
 }
 
 
+/*
+ * 'http_alloc_field()' - Allocate memory for a field value.
+ *
+ * Values are carved out of the connection's field arena, which is reset by
+ * httpClearFields, and only fall back to the heap when the arena is full.
+ */
+
+static char *				/* O - Field storage or @code NULL@ */
+http_alloc_field(http_t *http,		/* I - HTTP connection */
+                 size_t bytes)		/* I - Number of bytes */
+{
+  char	*ptr;				/* Field storage */
+
+
+  if (bytes <= (sizeof(http->fields_arena) - http->fields_used))
+  {
+    ptr = http->fields_arena + http->fields_used;
+    http->fields_used += bytes;
+  }
+  else
+    ptr = malloc(bytes);
+
+  return (ptr);
+}
+
+
 #ifdef HAVE_LIBZ
 /*
  * 'http_content_coding_finish()' - Finish doing any content encoding.
@@ -3850,7 +4294,7 @@ http_content_coding_start(
           return;
 	}
 
-        if ((zerr = deflateInit2((z_stream *)http->stream, Z_DEFAULT_COMPRESSION, Z_DEFLATED, coding == _HTTP_CODING_DEFLATE ? -11 : 27, 7, Z_DEFAULT_STRATEGY)) < Z_OK)
+        if ((zerr = deflateInit2((z_stream *)http->stream, http->compression_level > 0 ? http->compression_level : Z_DEFAULT_COMPRESSION, Z_DEFLATED, coding == _HTTP_CODING_DEFLATE ? -11 : 27, 7, Z_DEFAULT_STRATEGY)) < Z_OK)
         {
           free(http->sbuffer);
           free(http->stream);
@@ -3973,6 +4417,25 @@ http_create(
     return (NULL);
   }
 
+ /*
+  * Server connections get larger buffers since they mostly receive and send
+  * documents...
+  */
+
+  http->bufsize  = http->wbufsize = mode == _HTTP_MODE_SERVER ? _HTTP_SERVER_BUFFER : HTTP_MAX_BUFFER;
+  http->buffer   = malloc(http->bufsize);
+  http->wbuffer  = malloc(http->wbufsize);
+
+  if (!http->buffer || !http->wbuffer)
+  {
+    _cupsSetError(IPP_STATUS_ERROR_INTERNAL, strerror(errno), 0);
+    free(http->buffer);
+    free(http->wbuffer);
+    free(http);
+    httpAddrFreeList(myaddrlist);
+    return (NULL);
+  }
+
  /*
   * Initialize the HTTP data...
   */
@@ -4064,6 +4527,40 @@ http_debug_hex(const char *prefix,	/* I - Prefix for line */
 #endif /* DEBUG */
 
 
+/*
+ * 'http_field_allocated()' - Determine whether a field value is on the heap.
+ */
+
+static int				/* O - 1 if allocated with malloc, 0 otherwise */
+http_field_allocated(
+    http_t       *http,			/* I - HTTP connection */
+    http_field_t field)			/* I - HTTP field */
+{
+  char	*value = http->fields[field];	/* Field value */
+
+
+  if (!value || (field < HTTP_FIELD_ACCEPT_ENCODING && value == http->_fields[field]))
+    return (0);
+
+  return (value < http->fields_arena || value >= (http->fields_arena + sizeof(http->fields_arena)));
+}
+
+
+/*
+ * 'http_free_field()' - Free a field value.
+ */
+
+static void
+http_free_field(http_t       *http,	/* I - HTTP connection */
+                http_field_t field)	/* I - HTTP field */
+{
+  if (http_field_allocated(http, field))
+    free(http->fields[field]);
+
+  http->fields[field] = NULL;
+}
+
+
 /*
  * 'http_read()' - Read a buffer from a HTTP connection.
  *
@@ -4826,6 +5323,76 @@ http_write_chunk(http_t     *http,	/* I - HTTP connection */
   */
 
   snprintf(header, sizeof(header), "%x\r\n", (unsigned)length);
+
+#if !defined(_WIN32) && defined(MSG_DONTWAIT)
+  if (!http->tls)
+  {
+   /*
+    * Try sending the header, data, and trailer with a single sendmsg() call.
+    * Anything that cannot be sent right away is written normally so that the
+    * usual timeout handling applies...
+    */
+
+    struct msghdr	msg;		/* Message header */
+    struct iovec	iov[3];		/* Header, data, and trailer */
+    size_t		hlength = strlen(header);
+					/* Length of header */
+    ssize_t		sent;		/* Bytes sent */
+
+    iov[0].iov_base = header;
+    iov[0].iov_len  = hlength;
+    iov[1].iov_base = (void *)buffer;
+    iov[1].iov_len  = length;
+    iov[2].iov_base = (void *)"\r\n";
+    iov[2].iov_len  = 2;
+
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov    = iov;
+    msg.msg_iovlen = 3;
+
+    while ((sent = sendmsg(http->fd, &msg, MSG_DONTWAIT)) < 0 && errno == EINTR);
+
+    if (sent < 0)
+      sent = 0;
+
+    DEBUG_printf(("8http_write_chunk: sendmsg sent " CUPS_LLFMT " of " CUPS_LLFMT " bytes.", CUPS_LLCAST sent, CUPS_LLCAST (hlength + length + 2)));
+
+    if ((size_t)sent < hlength)
+    {
+      if (http_write(http, header + sent, hlength - (size_t)sent) < 0)
+      {
+	DEBUG_puts("8http_write_chunk: http_write of length failed.");
+	return (-1);
+      }
+
+      sent = 0;
+    }
+    else
+      sent -= (ssize_t)hlength;
+
+    if ((size_t)sent < length)
+    {
+      if (http_write(http, buffer + sent, length - (size_t)sent) < 0)
+      {
+	DEBUG_puts("8http_write_chunk: http_write of buffer failed.");
+	return (-1);
+      }
+
+      sent = 0;
+    }
+    else
+      sent -= (ssize_t)length;
+
+    if (sent < 2 && http_write(http, sent ? "\n" : "\r\n", (size_t)(2 - sent)) < 0)
+    {
+      DEBUG_puts("8http_write_chunk: http_write of CR LF failed.");
+      return (-1);
+    }
+
+    return ((ssize_t)length);
+  }
+#endif /* !_WIN32 && MSG_DONTWAIT */
+
   if (http_write(http, header, strlen(header)) < 0)
   {
     DEBUG_puts("8http_write_chunk: http_write of length failed.");
@@ -177,6 +177,9 @@ typedef enum http_field_e		/**** HTTP field names ****/
   HTTP_FIELD_ALLOW,			/* Allow field @since CUPS 1.7/macOS 10.9@ */
   HTTP_FIELD_SERVER,			/* Server field @since CUPS 1.7/macOS 10.9@ */
   HTTP_FIELD_AUTHENTICATION_INFO,	/* Authentication-Info field (@since CUPS 2.2.9) */
+  HTTP_FIELD_ETAG,			/* ETag field @since CUPS 2.3@ */
+  HTTP_FIELD_IF_NONE_MATCH,		/* If-None-Match field @since CUPS 2.3@ */
+  HTTP_FIELD_CACHE_CONTROL,		/* Cache-Control field @since CUPS 2.3@ */
   HTTP_FIELD_MAX			/* Maximum field index */
 } http_field_t;
 
@@ -583,6 +586,10 @@ extern void		httpShutdown(http_t *http) _CUPS_API_2_0;
 extern const char	*httpStateString(http_state_t state) _CUPS_API_2_0;
 extern const char	*httpURIStatusString(http_uri_status_t status) _CUPS_API_2_0;
 
+/* New in CUPS 2.3 */
+extern int		httpSetBufferSize(http_t *http, size_t bufsize, size_t wbufsize) _CUPS_API_2_3;
+extern void		httpSetCompressionLevel(http_t *http, int level) _CUPS_API_2_3;
+
 /*
  * C++ magic...
  */
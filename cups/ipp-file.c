@@ -15,19 +15,53 @@
 #include "ipp-private.h"
 #include "string-private.h"
 #include "debug-internal.h"
+#include <sys/stat.h>
+#ifdef _WIN32
+#  include <process.h>
+#else
+#  include <unistd.h>
+#endif /* _WIN32 */
+
+
+/*
+ * Local constants...
+ *
+ * Compiled files start with a header containing the magic string, version,
+ * final line number, source modification time and size, and the absolute
+ * source filename.
+ * Each token follows as a record containing the line number after the token,
+ * the token length, and the nul-terminated token string.  All numbers are
+ * 32-bit big-endian integers.
+ */
+
+#define _IPP_COMPILED_MAGIC	"IPPTOKEN"
+#define _IPP_COMPILED_VERSION	2
+#define _IPP_COMPILED_HEADER	28	/* Header length before filename */
 
 
 /*
  * Local functions...
  */
 
+static char	*absolute_filename(const char *filename);
+static int	compile_file(_ipp_file_t *f, const char *abspath, const char *cachefile, struct stat *fileinfo);
+static char	*compiled_filename(const char *cachedir, const char *abspath, char *buffer, size_t bufsize);
+static unsigned	get_uint32(const char *ptr);
+static int	load_compiled(_ipp_file_t *f, const char *abspath, const char *cachefile, struct stat *fileinfo);
+static int	load_file(_ipp_file_t *f);
 static ipp_t	*parse_collection(_ipp_file_t *f, _ipp_vars_t *v, void *user_data);
 static int	parse_value(_ipp_file_t *f, _ipp_vars_t *v, void *user_data, ipp_t *ipp, ipp_attribute_t **attr, int element);
+static void	put_uint32(char *ptr, unsigned value);
 static void	report_error(_ipp_file_t *f, _ipp_vars_t *v, void *user_data, const char *message, ...) _CUPS_FORMAT(4, 5);
 
 
 /*
  * '_ippFileParse()' - Parse an IPP data file.
+ *
+ * When a cache directory is set in the variables, the tokens of the file are
+ * compiled and saved to the cache directory, and later calls load the
+ * compiled tokens as long as the file has not been modified.  Variables are
+ * still expanded as the file is parsed.
  */
 
 ipp_t *					/* O - IPP attributes or @code NULL@ on failure */
@@ -41,6 +75,9 @@ _ippFileParse(
   ipp_attribute_t *attr = NULL;		/* Current attribute */
   char		token[1024];		/* Token string */
   ipp_t		*ignored = NULL;	/* Ignored attributes */
+  struct stat	fileinfo;		/* File information */
+  char		*abspath = NULL,	/* Absolute filename */
+		cachefile[1024];	/* Compiled filename */
 
 
   DEBUG_printf(("_ippFileParse(v=%p, filename=\"%s\", user_data=%p)", (void *)v, filename, user_data));
@@ -53,12 +90,33 @@ _ippFileParse(
   f.filename = filename;
   f.linenum  = 1;
 
-  if ((f.fp = cupsFileOpen(filename, "r")) == NULL)
+  if (v->cachedir && !stat(filename, &fileinfo) && (abspath = absolute_filename(filename)) != NULL && compiled_filename(v->cachedir, abspath, cachefile, sizeof(cachefile)))
   {
-    DEBUG_printf(("1_ippFileParse: Unable to open \"%s\": %s", filename, strerror(errno)));
+   /*
+    * Use the compiled tokens if they are current, otherwise compile them...
+    */
+
+    if (!load_compiled(&f, abspath, cachefile, &fileinfo))
+    {
+      if (!load_file(&f))
+      {
+	DEBUG_printf(("1_ippFileParse: Unable to read \"%s\": %s", filename, strerror(errno)));
+	free(abspath);
+	return (0);
+      }
+
+      compile_file(&f, abspath, cachefile, &fileinfo);
+    }
+  }
+  else if (!load_file(&f))
+  {
+    DEBUG_printf(("1_ippFileParse: Unable to read \"%s\": %s", filename, strerror(errno)));
+    free(abspath);
     return (0);
   }
 
+  free(abspath);
+
  /*
   * Do the callback with a NULL token to setup any initial state...
   */
@@ -191,7 +249,7 @@ _ippFileParse(
   * kept...
   */
 
-  cupsFileClose(f.fp);
+  free(f.buffer);
   ippDelete(ignored);
 
   return (f.attrs);
@@ -200,6 +258,10 @@ _ippFileParse(
 
 /*
  * '_ippFileReadToken()' - Read a token from an IPP data file.
+ *
+ * The file contents are scanned in memory.  Runs of ordinary characters are
+ * copied in one step and quoted strings and comments are found using memchr().
+ * Compiled tokens are copied as-is.
  */
 
 int					/* O - 1 on success, 0 on failure */
@@ -207,61 +269,91 @@ _ippFileReadToken(_ipp_file_t *f,	/* I - File to read from */
                   char        *token,	/* I - Token string buffer */
                   size_t      tokensize)/* I - Size of token string buffer */
 {
-  int	ch,				/* Character from file */
-	quote = 0;			/* Quoting character */
-  char	*tokptr = token,		/* Pointer into token buffer */
-	*tokend = token + tokensize - 1;/* End of token buffer */
+  int		ch,			/* Character from file */
+		quote = 0;		/* Quoting character */
+  const char	*ptr = f->bufptr,	/* Pointer into file contents */
+		*end = f->bufend,	/* End of file contents */
+		*start,			/* Start of run */
+		*stop,			/* End of run */
+		*temp;			/* Temporary pointer */
+  char		*tokptr = token,	/* Pointer into token buffer */
+		*tokend = token + tokensize - 1;
+					/* End of token buffer */
+  size_t	len;			/* Length of run */
+
+
+  if (f->compiled)
+  {
+   /*
+    * Return the next compiled token...
+    */
+
+    if ((end - ptr) < 9)
+    {
+      DEBUG_puts("1_ippFileReadToken: EOF");
+      f->linenum = f->endline;
+      f->bufptr  = end;
+      return (0);
+    }
+
+    f->linenum = (int)get_uint32(ptr);
+    len        = get_uint32(ptr + 4);
+    ptr        += 8;
+    f->bufptr  = ptr + len + 1;
+
+    if (len >= tokensize)
+    {
+      memcpy(token, ptr, tokensize - 1);
+      token[tokensize - 1] = '\0';
+      DEBUG_printf(("1_ippFileReadToken: Too long: \"%s\".", token));
+      return (0);
+    }
 
+    memcpy(token, ptr, len + 1);
+    DEBUG_printf(("1_ippFileReadToken: Returning \"%s\".", token));
+    return (1);
+  }
 
  /*
   * Skip whitespace and comments...
   */
 
-  DEBUG_printf(("1_ippFileReadToken: linenum=%d, pos=%ld", f->linenum, (long)cupsFileTell(f->fp)));
+  DEBUG_printf(("1_ippFileReadToken: linenum=%d, pos=%ld", f->linenum, (long)(ptr - f->buffer)));
 
-  while ((ch = cupsFileGetChar(f->fp)) != EOF)
+  while (ptr < end)
   {
-    if (_cups_isspace(ch))
+    if (*ptr == '\n')
     {
-     /*
-      * Whitespace...
-      */
-
-      if (ch == '\n')
-      {
-        f->linenum ++;
-        DEBUG_printf(("1_ippFileReadToken: LF in leading whitespace, linenum=%d, pos=%ld", f->linenum, (long)cupsFileTell(f->fp)));
-      }
+      f->linenum ++;
+      ptr ++;
+    }
+    else if (_cups_isspace(*ptr))
+    {
+      ptr ++;
     }
-    else if (ch == '#')
+    else if (*ptr == '#')
     {
      /*
       * Comment...
       */
 
-      DEBUG_puts("1_ippFileReadToken: Skipping comment in leading whitespace...");
-
-      while ((ch = cupsFileGetChar(f->fp)) != EOF)
+      if ((temp = memchr(ptr, '\n', (size_t)(end - ptr))) == NULL)
       {
-        if (ch == '\n')
-          break;
+        ptr = end;
+        break;
       }
 
-      if (ch == '\n')
-      {
-        f->linenum ++;
-        DEBUG_printf(("1_ippFileReadToken: LF at end of comment, linenum=%d, pos=%ld", f->linenum, (long)cupsFileTell(f->fp)));
-      }
-      else
-        break;
+      f->linenum ++;
+      ptr = temp + 1;
     }
     else
       break;
   }
 
-  if (ch == EOF)
+  if (ptr >= end)
   {
     DEBUG_puts("1_ippFileReadToken: EOF");
+    f->bufptr = end;
     return (0);
   }
 
@@ -269,12 +361,71 @@ _ippFileReadToken(_ipp_file_t *f,	/* I - File to read from */
   * Read a token...
   */
 
-  while (ch != EOF)
+  while (ptr < end)
   {
+   /*
+    * Find the next run of ordinary characters...
+    */
+
+    start = ptr;
+
+    if (quote)
+    {
+      if ((stop = memchr(ptr, quote, (size_t)(end - ptr))) == NULL)
+        stop = end;
+      if ((temp = memchr(ptr, '\\', (size_t)(stop - ptr))) != NULL)
+        stop = temp;
+
+      for (temp = ptr; (temp = memchr(temp, '\n', (size_t)(stop - temp))) != NULL; temp ++)
+        f->linenum ++;
+    }
+    else
+    {
+      for (stop = ptr; stop < end; stop ++)
+      {
+        ch = *stop;
+
+        if (_cups_isspace(ch) || ch == '\'' || ch == '\"' || ch == '#' || ch == '{' || ch == '}' || ch == ',' || ch == '\\')
+          break;
+      }
+    }
+
+    if ((len = (size_t)(stop - start)) > 0)
+    {
+      if (len > (size_t)(tokend - tokptr))
+      {
+       /*
+	* Token too long...
+	*/
+
+        len = (size_t)(tokend - tokptr);
+
+        memcpy(tokptr, start, len);
+        tokptr    += len;
+	*tokptr   = '\0';
+	f->bufptr = start + len + 1;
+	DEBUG_printf(("1_ippFileReadToken: Too long: \"%s\".", token));
+	return (0);
+      }
+
+      memcpy(tokptr, start, len);
+      tokptr += len;
+      ptr    = stop;
+    }
+
+    if (ptr >= end)
+      break;
+
+   /*
+    * Handle the character that ended the run...
+    */
+
+    ch = *ptr++;
+
     if (ch == '\n')
     {
       f->linenum ++;
-      DEBUG_printf(("1_ippFileReadToken: LF in token, linenum=%d, pos=%ld", f->linenum, (long)cupsFileTell(f->fp)));
+      DEBUG_printf(("1_ippFileReadToken: LF in token, linenum=%d, pos=%ld", f->linenum, (long)(ptr - f->buffer)));
     }
 
     if (ch == quote)
@@ -283,7 +434,8 @@ _ippFileReadToken(_ipp_file_t *f,	/* I - File to read from */
       * End of quoted text...
       */
 
-      *tokptr = '\0';
+      *tokptr   = '\0';
+      f->bufptr = ptr;
       DEBUG_printf(("1_ippFileReadToken: Returning \"%s\" at closing quote.", token));
       return (1);
     }
@@ -293,22 +445,20 @@ _ippFileReadToken(_ipp_file_t *f,	/* I - File to read from */
       * End of unquoted text...
       */
 
-      *tokptr = '\0';
+      *tokptr   = '\0';
+      f->bufptr = ptr;
       DEBUG_printf(("1_ippFileReadToken: Returning \"%s\" before whitespace.", token));
       return (1);
     }
     else if (!quote && (ch == '\'' || ch == '\"'))
     {
      /*
-      * Start of quoted text or regular expression...
+      * Start of quoted text...
       */
 
-      if (ch == '<')
-        quote = '>';
-      else
-        quote = ch;
+      quote = ch;
 
-      DEBUG_printf(("1_ippFileReadToken: Start of quoted string, quote=%c, pos=%ld", quote, (long)cupsFileTell(f->fp)));
+      DEBUG_printf(("1_ippFileReadToken: Start of quoted string, quote=%c, pos=%ld", quote, (long)(ptr - f->buffer)));
     }
     else if (!quote && ch == '#')
     {
@@ -316,8 +466,8 @@ _ippFileReadToken(_ipp_file_t *f,	/* I - File to read from */
       * Start of comment...
       */
 
-      cupsFileSeek(f->fp, cupsFileTell(f->fp) - 1);
-      *tokptr = '\0';
+      *tokptr   = '\0';
+      f->bufptr = ptr - 1;
       DEBUG_printf(("1_ippFileReadToken: Returning \"%s\" before comment.", token));
       return (1);
     }
@@ -333,7 +483,7 @@ _ippFileReadToken(_ipp_file_t *f,	/* I - File to read from */
         * Return the preceding token first...
         */
 
-	cupsFileSeek(f->fp, cupsFileTell(f->fp) - 1);
+        ptr --;
       }
       else
       {
@@ -344,46 +494,48 @@ _ippFileReadToken(_ipp_file_t *f,	/* I - File to read from */
         *tokptr++ = (char)ch;
       }
 
-      *tokptr = '\0';
+      *tokptr   = '\0';
+      f->bufptr = ptr;
       DEBUG_printf(("1_ippFileReadToken: Returning \"%s\".", token));
       return (1);
     }
     else
     {
-      if (ch == '\\')
+     /*
+      * Quoted character...
+      */
+
+      DEBUG_printf(("1_ippFileReadToken: Quoted character at pos=%ld", (long)(ptr - f->buffer)));
+
+      if (ptr >= end)
       {
-       /*
-        * Quoted character...
-        */
+	*token    = '\0';
+	f->bufptr = end;
+	DEBUG_puts("1_ippFileReadToken: EOF");
+	return (0);
+      }
 
-        DEBUG_printf(("1_ippFileReadToken: Quoted character at pos=%ld", (long)cupsFileTell(f->fp)));
+      ch = *ptr++;
 
-        if ((ch = cupsFileGetChar(f->fp)) == EOF)
-        {
-	  *token = '\0';
-	  DEBUG_puts("1_ippFileReadToken: EOF");
-	  return (0);
-	}
-	else if (ch == '\n')
-	{
-	  f->linenum ++;
-	  DEBUG_printf(("1_ippFileReadToken: quoted LF, linenum=%d, pos=%ld", f->linenum, (long)cupsFileTell(f->fp)));
-	}
-	else if (ch == 'a')
-	  ch = '\a';
-	else if (ch == 'b')
-	  ch = '\b';
-	else if (ch == 'f')
-	  ch = '\f';
-	else if (ch == 'n')
-	  ch = '\n';
-	else if (ch == 'r')
-	  ch = '\r';
-	else if (ch == 't')
-	  ch = '\t';
-	else if (ch == 'v')
-	  ch = '\v';
+      if (ch == '\n')
+      {
+	f->linenum ++;
+	DEBUG_printf(("1_ippFileReadToken: quoted LF, linenum=%d, pos=%ld", f->linenum, (long)(ptr - f->buffer)));
       }
+      else if (ch == 'a')
+	ch = '\a';
+      else if (ch == 'b')
+	ch = '\b';
+      else if (ch == 'f')
+	ch = '\f';
+      else if (ch == 'n')
+	ch = '\n';
+      else if (ch == 'r')
+	ch = '\r';
+      else if (ch == 't')
+	ch = '\t';
+      else if (ch == 'v')
+	ch = '\v';
 
       if (tokptr < tokend)
       {
@@ -399,26 +551,327 @@ _ippFileReadToken(_ipp_file_t *f,	/* I - File to read from */
 	* Token too long...
 	*/
 
-	*tokptr = '\0';
+	*tokptr   = '\0';
+	f->bufptr = ptr;
 	DEBUG_printf(("1_ippFileReadToken: Too long: \"%s\".", token));
 	return (0);
       }
     }
-
-   /*
-    * Get the next character...
-    */
-
-    ch = cupsFileGetChar(f->fp);
   }
 
-  *tokptr = '\0';
+  *tokptr   = '\0';
+  f->bufptr = end;
   DEBUG_printf(("1_ippFileReadToken: Returning \"%s\" at EOF.", token));
 
   return (tokptr > token);
 }
 
 
+/*
+ * 'absolute_filename()' - Get the absolute filename of an IPP data file.
+ *
+ * Compiled files are keyed by the absolute filename so that the same file
+ * opened using different relative paths (or from a different working
+ * directory) uses the same compiled file, and different files with the same
+ * relative path do not.  The returned string must be freed.
+ */
+
+static char *				/* O - Absolute filename or @code NULL@ on error */
+absolute_filename(const char *filename)	/* I - IPP data filename */
+{
+#ifdef _WIN32
+  return (_fullpath(NULL, filename, 0));
+#else
+  return (realpath(filename, NULL));
+#endif /* _WIN32 */
+}
+
+
+/*
+ * 'compile_file()' - Compile the tokens of an IPP data file.
+ *
+ * The compiled tokens replace the file contents and are written to the cache
+ * file.  If the cache file cannot be written, the compiled tokens are still
+ * used for the current parse.
+ */
+
+static int				/* O - 1 on success, 0 on failure */
+compile_file(_ipp_file_t *f,		/* I - IPP data file */
+             const char  *abspath,	/* I - Absolute filename */
+             const char  *cachefile,	/* I - Compiled filename */
+             struct stat *fileinfo)	/* I - File information */
+{
+  _ipp_file_t	source;			/* Source file */
+  char		*token,			/* Token string */
+		*buffer,		/* Compiled tokens */
+		*temp,			/* New buffer */
+		tempfile[1024];		/* Temporary filename */
+  size_t	namelen,		/* Length of filename */
+		len,			/* Length of token */
+		alloc,			/* Allocated bytes */
+		used;			/* Used bytes */
+  cups_file_t	*fp;			/* Compiled file */
+
+
+ /*
+  * Tokenize the entire file - no token can be longer than the file itself...
+  */
+
+  source  = *f;
+  namelen = strlen(abspath);
+  alloc   = _IPP_COMPILED_HEADER + namelen + 1 + 2 * (size_t)(f->bufend - f->buffer);
+
+  if ((token = malloc((size_t)(f->bufend - f->buffer) + 1)) == NULL)
+    return (0);
+
+  if ((buffer = malloc(alloc)) == NULL)
+  {
+    free(token);
+    return (0);
+  }
+
+  memcpy(buffer + _IPP_COMPILED_HEADER, abspath, namelen + 1);
+  used = _IPP_COMPILED_HEADER + namelen + 1;
+
+  while (_ippFileReadToken(&source, token, (size_t)(f->bufend - f->buffer) + 1))
+  {
+    len = strlen(token);
+
+    if ((used + len + 9) > alloc)
+    {
+      if ((temp = realloc(buffer, 2 * alloc + len + 9)) == NULL)
+      {
+        free(token);
+        free(buffer);
+        return (0);
+      }
+
+      buffer = temp;
+      alloc  = 2 * alloc + len + 9;
+    }
+
+    put_uint32(buffer + used, (unsigned)source.linenum);
+    put_uint32(buffer + used + 4, (unsigned)len);
+    memcpy(buffer + used + 8, token, len + 1);
+    used += len + 9;
+  }
+
+  free(token);
+
+  memcpy(buffer, _IPP_COMPILED_MAGIC, 8);
+  put_uint32(buffer + 8, _IPP_COMPILED_VERSION);
+  put_uint32(buffer + 12, (unsigned)source.linenum);
+  put_uint32(buffer + 16, (unsigned)fileinfo->st_mtime);
+  put_uint32(buffer + 20, (unsigned)fileinfo->st_size);
+  put_uint32(buffer + 24, (unsigned)namelen);
+
+ /*
+  * Save the compiled tokens, replacing any existing compiled file...
+  */
+
+  snprintf(tempfile, sizeof(tempfile), "%s.%d", cachefile, (int)getpid());
+
+  if ((fp = cupsFileOpen(tempfile, "w")) != NULL)
+  {
+    if (cupsFileWrite(fp, buffer, used) < 0)
+    {
+      cupsFileClose(fp);
+      unlink(tempfile);
+    }
+    else if (cupsFileClose(fp) || rename(tempfile, cachefile))
+    {
+      DEBUG_printf(("2compile_file: Unable to save \"%s\": %s", cachefile, strerror(errno)));
+      unlink(tempfile);
+    }
+  }
+
+ /*
+  * Use the compiled tokens...
+  */
+
+  free(f->buffer);
+
+  f->buffer   = buffer;
+  f->bufptr   = buffer + _IPP_COMPILED_HEADER + namelen + 1;
+  f->bufend   = buffer + used;
+  f->compiled = 1;
+  f->endline  = source.linenum;
+
+  return (1);
+}
+
+
+/*
+ * 'compiled_filename()' - Make the compiled filename for an IPP data file.
+ */
+
+static char *				/* O - Compiled filename or @code NULL@ if too long */
+compiled_filename(
+    const char *cachedir,		/* I - Cache directory */
+    const char *abspath,		/* I - Absolute IPP data filename */
+    char       *buffer,			/* I - Filename buffer */
+    size_t     bufsize)			/* I - Size of filename buffer */
+{
+  char	*bufptr;			/* Pointer into buffer */
+
+
+  if ((size_t)snprintf(buffer, bufsize, "%s/", cachedir) >= bufsize)
+    return (NULL);
+
+  for (bufptr = buffer + strlen(buffer); *abspath && bufptr < (buffer + bufsize - 6); abspath ++)
+  {
+    if (*abspath == '/' || *abspath == '\\' || *abspath == ':')
+      *bufptr++ = '_';
+    else
+      *bufptr++ = *abspath;
+  }
+
+  if (*abspath)
+    return (NULL);
+
+  memcpy(bufptr, ".ippc", 6);
+
+  return (buffer);
+}
+
+
+/*
+ * 'get_uint32()' - Get a 32-bit big-endian integer.
+ */
+
+static unsigned				/* O - Integer value */
+get_uint32(const char *ptr)		/* I - Pointer to integer */
+{
+  const unsigned char *uptr = (const unsigned char *)ptr;
+					/* Unsigned pointer */
+
+
+  return ((unsigned)((uptr[0] << 24) | (uptr[1] << 16) | (uptr[2] << 8) | uptr[3]));
+}
+
+
+/*
+ * 'load_compiled()' - Load the compiled tokens of an IPP data file.
+ *
+ * The compiled file is only used if it was made from the same file with the
+ * same modification time and size, and all of its tokens are intact.
+ */
+
+static int				/* O - 1 on success, 0 on failure */
+load_compiled(_ipp_file_t *f,		/* I - IPP data file */
+              const char  *abspath,	/* I - Absolute filename */
+              const char  *cachefile,	/* I - Compiled filename */
+              struct stat *fileinfo)	/* I - File information */
+{
+  _ipp_file_t	compiled;		/* Compiled file */
+  const char	*ptr;			/* Pointer into tokens */
+  size_t	namelen,		/* Length of filename */
+		len;			/* Length of token */
+
+
+ /*
+  * Read the compiled file and validate the header...
+  */
+
+  memset(&compiled, 0, sizeof(compiled));
+  compiled.filename = cachefile;
+
+  if (!load_file(&compiled))
+    return (0);
+
+  namelen = strlen(abspath);
+
+  if ((compiled.bufend - compiled.buffer) < (ptrdiff_t)(_IPP_COMPILED_HEADER + namelen + 1) || memcmp(compiled.buffer, _IPP_COMPILED_MAGIC, 8) || get_uint32(compiled.buffer + 8) != _IPP_COMPILED_VERSION || get_uint32(compiled.buffer + 16) != (unsigned)fileinfo->st_mtime || get_uint32(compiled.buffer + 20) != (unsigned)fileinfo->st_size || get_uint32(compiled.buffer + 24) != namelen || memcmp(compiled.buffer + _IPP_COMPILED_HEADER, abspath, namelen + 1))
+  {
+    DEBUG_printf(("2load_compiled: \"%s\" is out of date.", cachefile));
+    free(compiled.buffer);
+    return (0);
+  }
+
+ /*
+  * Validate the tokens...
+  */
+
+  for (ptr = compiled.buffer + _IPP_COMPILED_HEADER + namelen + 1; ptr < compiled.bufend; ptr += len + 9)
+  {
+    if ((compiled.bufend - ptr) < 9 || (len = get_uint32(ptr + 4)) > (size_t)(compiled.bufend - ptr - 9) || ptr[len + 8] || strlen(ptr + 8) != len)
+    {
+      DEBUG_printf(("2load_compiled: \"%s\" is damaged.", cachefile));
+      free(compiled.buffer);
+      return (0);
+    }
+  }
+
+  f->buffer   = compiled.buffer;
+  f->bufptr   = compiled.buffer + _IPP_COMPILED_HEADER + namelen + 1;
+  f->bufend   = compiled.bufend;
+  f->compiled = 1;
+  f->endline  = (int)get_uint32(compiled.buffer + 12);
+
+  return (1);
+}
+
+
+/*
+ * 'load_file()' - Read the contents of an IPP data file into memory.
+ */
+
+static int				/* O - 1 on success, 0 on failure */
+load_file(_ipp_file_t *f)		/* I - IPP data file */
+{
+  cups_file_t	*fp;			/* File pointer */
+  struct stat	fileinfo;		/* File information */
+  char		*buffer,		/* File contents */
+		*temp;			/* New buffer */
+  size_t	alloc,			/* Allocated bytes */
+		used = 0;		/* Used bytes */
+  ssize_t	bytes;			/* Bytes read */
+
+
+  if ((fp = cupsFileOpen(f->filename, "r")) == NULL)
+    return (0);
+
+ /*
+  * Size the buffer so that uncompressed files are read in one pass...
+  */
+
+  if (!cupsFileCompression(fp) && !fstat(cupsFileNumber(fp), &fileinfo) && fileinfo.st_size > 0)
+    alloc = (size_t)fileinfo.st_size + 1;
+  else
+    alloc = 65536;
+
+  if ((buffer = malloc(alloc)) == NULL)
+  {
+    cupsFileClose(fp);
+    return (0);
+  }
+
+  while ((bytes = cupsFileRead(fp, buffer + used, alloc - used)) > 0)
+  {
+    if ((used += (size_t)bytes) < alloc)
+      continue;
+
+    if ((temp = realloc(buffer, 2 * alloc)) == NULL)
+    {
+      free(buffer);
+      cupsFileClose(fp);
+      return (0);
+    }
+
+    buffer = temp;
+    alloc  *= 2;
+  }
+
+  cupsFileClose(fp);
+
+  f->buffer = buffer;
+  f->bufptr = buffer;
+  f->bufend = buffer + used;
+
+  return (1);
+}
+
+
 /*
  * 'parse_collection()' - Parse an IPP collection value.
  */
@@ -819,6 +1272,25 @@ parse_value(_ipp_file_t      *f,	/* I  - IPP data file */
 }
 
 
+/*
+ * 'put_uint32()' - Put a 32-bit big-endian integer.
+ */
+
+static void
+put_uint32(char     *ptr,		/* I - Pointer to integer */
+           unsigned value)		/* I - Integer value */
+{
+  unsigned char *uptr = (unsigned char *)ptr;
+					/* Unsigned pointer */
+
+
+  uptr[0] = (unsigned char)(value >> 24);
+  uptr[1] = (unsigned char)(value >> 16);
+  uptr[2] = (unsigned char)(value >> 8);
+  uptr[3] = (unsigned char)value;
+}
+
+
 /*
  * 'report_error()' - Report an error.
  */
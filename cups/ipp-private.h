@@ -33,6 +33,9 @@ extern "C" {
 
 #  define IPP_BUF_SIZE	(IPP_MAX_LENGTH + 2)
 					/* Size of buffer */
+#  define IPP_INDEX_MIN	16		/* Minimum attributes for name index */
+#  define IPP_MAX_DEPTH	10		/* Maximum nesting of collections */
+#  define IPP_ARENA_SIZE	16384		/* Size of arena blocks */
 
 
 /*
@@ -114,10 +117,47 @@ struct _ipp_attribute_s			/**** IPP attribute ****/
   ipp_tag_t	group_tag,		/* Job/Printer/Operation group tag */
 		value_tag;		/* What type of value is it? */
   char		*name;			/* Name of attribute */
-  int		num_values;		/* Number of values */
+  int		num_values,		/* Number of values */
+		alloc_values;		/* Number of values allocated */
   _ipp_value_t	values[1];		/* Values */
 };
 
+typedef struct _ipp_arena_s		/**** Attribute memory block ****/
+{
+  struct _ipp_arena_s	*next;		/* Next (older) block */
+  size_t		used,		/* Bytes used */
+			size;		/* Bytes available */
+  double		data[1];	/* Attribute memory (aligned) */
+} _ipp_arena_t;
+
+typedef struct _ipp_islot_s		/**** Attribute name index slot ****/
+{
+  ipp_attribute_t	*attr,		/* First attribute with this name */
+			*prev;		/* Attribute before it or NULL */
+} _ipp_islot_t;
+
+typedef struct _ipp_index_s		/**** Attribute name index ****/
+{
+  size_t		mask;		/* Number of slots - 1 */
+  _ipp_islot_t		slots[1];	/* Hash slots (open addressing) */
+} _ipp_index_t;
+
+typedef struct _ipp_cfilter_s		/**** Compiled attribute filter ****/
+{
+  ipp_tag_t		group_tag;	/* Group to copy */
+  int			all;		/* Copy all attributes not excluded? */
+  size_t		mask;		/* Number of slots - 1 */
+  const char		**names;	/* Pooled attribute names (open addressing) */
+  unsigned char		*flags;		/* Copy/skip flags for each slot */
+} _ipp_cfilter_t;
+
+typedef struct _ipp_wbuffer_s		/**** Growable write buffer ****/
+{
+  ipp_uchar_t		**buffer;	/* Pointer to buffer */
+  size_t		*bufsize,	/* Pointer to size of buffer */
+			used;		/* Bytes used */
+} _ipp_wbuffer_t;
+
 struct _ipp_s				/**** IPP Request/Response/Notification ****/
 {
   ipp_state_t		state;		/* State of request */
@@ -135,6 +175,11 @@ struct _ipp_s				/**** IPP Request/Response/Notification ****/
 /**** New in CUPS 2.0 ****/
   int			atend,		/* At end of list? */
 			curindex;	/* Current attribute index for hierarchical search */
+/**** New in IPP Sample ****/
+  _ipp_index_t		*index;		/* Attribute name index or NULL */
+  int			index_finds;	/* Unindexed lookups since last change */
+  _ipp_arena_t		*arena;		/* Attribute memory blocks or NULL */
+  int			use_arena;	/* Allocate attributes from arena? */
 };
 
 typedef struct _ipp_option_s		/**** Attribute mapping data ****/
@@ -174,13 +219,18 @@ struct _ipp_vars_s			/**** Variables ****/
   _ipp_fattr_cb_t attrcb;		/* Attribute (filter) callback */
   _ipp_ferror_cb_t errorcb;		/* Error callback */
   _ipp_ftoken_cb_t tokencb;		/* Token callback */
+  const char	*cachedir;		/* Directory for compiled files, if any */
 };
 
 struct _ipp_file_s			/**** File Parser */
 {
   const char		*filename;	/* Filename */
-  cups_file_t		*fp;		/* File pointer */
-  int			linenum;	/* Current line number */
+  char			*buffer;	/* File contents */
+  const char		*bufptr,	/* Current position in file contents */
+			*bufend;	/* End of file contents */
+  int			compiled;	/* Contents are compiled tokens? */
+  int			linenum,	/* Current line number */
+			endline;	/* Line number at end of compiled tokens */
   ipp_t			*attrs;		/* Attributes */
   ipp_tag_t		group_tag;	/* Current group for new attributes */
 };
@@ -196,10 +246,23 @@ extern const char	*_ippCheckOptions(void) _CUPS_PRIVATE;
 #endif /* DEBUG */
 extern _ipp_option_t	*_ippFindOption(const char *name) _CUPS_PRIVATE;
 
+/* ipp.c */
+extern size_t		_ippMemoryUsed(ipp_t *ipp) _CUPS_PRIVATE;
+extern ipp_t		*_ippNewArena(void) _CUPS_PRIVATE;
+
 /* ipp-file.c */
 extern ipp_t		*_ippFileParse(_ipp_vars_t *v, const char *filename, void *user_data) _CUPS_PRIVATE;
 extern int		_ippFileReadToken(_ipp_file_t *f, char *token, size_t tokensize) _CUPS_PRIVATE;
 
+/* ipp-server.c */
+extern void		_ippServerCopyAttributes(ipp_t *to, ipp_t *from, cups_array_t *ra, cups_array_t *pa, ipp_tag_t group_tag, int quickcopy) _CUPS_PRIVATE;
+extern void		_ippServerCopyFilteredAttributes(ipp_t *to, ipp_t *from, _ipp_cfilter_t *filter, int quickcopy) _CUPS_PRIVATE;
+extern _ipp_cfilter_t	*_ippServerCreateFilter(cups_array_t *ra, cups_array_t *pa, ipp_tag_t group_tag) _CUPS_PRIVATE;
+extern int		_ippServerCreateJobFile(int job_id, ipp_t *job_attrs, const char *format, char *fname, size_t fnamesize, const char *directory, const char *ext) _CUPS_PRIVATE;
+extern void		_ippServerDeleteFilter(_ipp_cfilter_t *filter) _CUPS_PRIVATE;
+extern void		_ippServerRespondUnsupported(ipp_t *response, ipp_attribute_t *attr) _CUPS_PRIVATE;
+extern int		_ippServerValidJobAttributes(ipp_t *request, ipp_t *printer_attrs, ipp_t *response) _CUPS_PRIVATE;
+
 /* ipp-vars.c */
 extern void		_ippVarsDeinit(_ipp_vars_t *v) _CUPS_PRIVATE;
 extern void		_ippVarsExpand(_ipp_vars_t *v, char *dst, const char *src, size_t dstsize) _CUPS_NONNULL(1,2,3) _CUPS_PRIVATE;
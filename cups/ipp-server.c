@@ -0,0 +1,710 @@
+/*
+ * IPP request support functions shared by ippserver, ippeveprinter, and
+ * ipp3dprinter.
+ *
+ * Copyright © 2014-2019 by Apple Inc.
+ *
+ * Licensed under Apache License v2.0.  See the file "LICENSE" for more
+ * information.
+ */
+
+/*
+ * Include necessary headers...
+ */
+
+#include "cups-private.h"
+#include "debug-internal.h"
+#include <fcntl.h>
+#ifdef _WIN32
+#  include <io.h>
+#endif /* _WIN32 */
+
+
+/*
+ * Local constants...
+ */
+
+#define IPP_CFILTER_COPY	1	/* Attribute is requested */
+#define IPP_CFILTER_SKIP	2	/* Attribute is private or not copied by default */
+
+
+/*
+ * Local types...
+ */
+
+typedef struct _ipp_filter_s		/**** Attribute filter ****/
+{
+  cups_array_t		*ra,		/* Requested attributes */
+			*pa;		/* Private attributes */
+  ipp_tag_t		group_tag;	/* Group to copy */
+} _ipp_filter_t;
+
+
+/*
+ * Local functions...
+ */
+
+static void	ipp_cfilter_add(_ipp_cfilter_t *filter, const char *name, unsigned char flag);
+static size_t	ipp_cfilter_slot(_ipp_cfilter_t *filter, const char *name);
+static int	ipp_filter_cb(_ipp_filter_t *filter, ipp_t *dst, ipp_attribute_t *attr);
+
+
+/*
+ * '_ippServerCopyAttributes()' - Copy the requested attributes from one
+ *                                message to another.
+ *
+ * Only attributes in the named group (or all groups for `IPP_TAG_ZERO`) are
+ * copied.  When "ra" is `NULL` all attributes are copied, except that
+ * "media-col-database" is only copied when explicitly requested.  Attributes
+ * in the "pa" array are never copied.
+ */
+
+void
+_ippServerCopyAttributes(
+    ipp_t        *to,			/* I - Destination message */
+    ipp_t        *from,			/* I - Source message */
+    cups_array_t *ra,			/* I - Requested attributes or `NULL` for all */
+    cups_array_t *pa,			/* I - Private attributes or `NULL` for none */
+    ipp_tag_t    group_tag,		/* I - Group to copy */
+    int          quickcopy)		/* I - Do a quick copy? */
+{
+  _ipp_filter_t	filter;			/* Filter data */
+
+
+  filter.ra        = ra;
+  filter.pa        = pa;
+  filter.group_tag = group_tag;
+
+  ippCopyAttributes(to, from, quickcopy, (ipp_copycb_t)ipp_filter_cb, &filter);
+}
+
+
+/*
+ * '_ippServerCopyFilteredAttributes()' - Copy attributes using a compiled
+ *                                        filter.
+ *
+ * This is the same as `_ippServerCopyAttributes` using the requested and
+ * private attributes of the filter, but each attribute is checked with a
+ * single hash lookup of its (pooled) name.
+ */
+
+void
+_ippServerCopyFilteredAttributes(
+    ipp_t          *to,			/* I - Destination message */
+    ipp_t          *from,		/* I - Source message */
+    _ipp_cfilter_t *filter,		/* I - Compiled filter */
+    int            quickcopy)		/* I - Do a quick copy? */
+{
+  ipp_attribute_t	*attr;		/* Current attribute */
+  unsigned char		flags;		/* Flags for attribute */
+
+
+  if (!to || !from || !filter)
+    return;
+
+  for (attr = from->attrs; attr; attr = attr->next)
+  {
+    if (!attr->name || (filter->group_tag != IPP_TAG_ZERO && attr->group_tag != filter->group_tag && attr->group_tag != IPP_TAG_ZERO))
+      continue;
+
+    flags = filter->flags[ipp_cfilter_slot(filter, attr->name)];
+
+    if ((flags & IPP_CFILTER_SKIP) || (!filter->all && !(flags & IPP_CFILTER_COPY)))
+      continue;
+
+    ippCopyAttribute(to, attr, quickcopy);
+  }
+}
+
+
+/*
+ * '_ippServerCreateFilter()' - Compile requested and private attributes into
+ *                              a filter.
+ *
+ * The filter holds a reference to each name in the string pool, so that the
+ * names of attributes can be looked up by pointer rather than compared.  The
+ * arrays are read using iterators, so shared privacy arrays can be used from
+ * multiple threads.  Use `_ippServerDeleteFilter` to free the filter.
+ */
+
+_ipp_cfilter_t *			/* O - Filter or `NULL` on error */
+_ippServerCreateFilter(
+    cups_array_t *ra,			/* I - Requested attributes or `NULL` for all */
+    cups_array_t *pa,			/* I - Private attributes or `NULL` for none */
+    ipp_tag_t    group_tag)		/* I - Group to copy */
+{
+  _ipp_cfilter_t	*filter;	/* Filter */
+  size_t		count,		/* Number of names */
+			size;		/* Number of slots */
+  cups_array_iter_t	iter;		/* Array iterator */
+  const char		*name;		/* Current name */
+
+
+  if ((filter = calloc(1, sizeof(_ipp_cfilter_t))) == NULL)
+    return (NULL);
+
+  count = (size_t)cupsArrayCount(ra) + (size_t)cupsArrayCount(pa) + 1;
+
+  for (size = 16; size < 2 * count; size *= 2);
+
+  filter->group_tag = group_tag;
+  filter->all       = ra == NULL;
+  filter->mask      = size - 1;
+  filter->names     = calloc(size, sizeof(char *));
+  filter->flags     = calloc(size, 1);
+
+  if (!filter->names || !filter->flags)
+  {
+    _ippServerDeleteFilter(filter);
+    return (NULL);
+  }
+
+  cupsArrayIterInit(&iter, ra);
+  while ((name = (const char *)cupsArrayIterNext(&iter)) != NULL)
+    ipp_cfilter_add(filter, name, IPP_CFILTER_COPY);
+
+  cupsArrayIterInit(&iter, pa);
+  while ((name = (const char *)cupsArrayIterNext(&iter)) != NULL)
+    ipp_cfilter_add(filter, name, IPP_CFILTER_SKIP);
+
+  if (!ra)
+    ipp_cfilter_add(filter, "media-col-database", IPP_CFILTER_SKIP);
+
+  return (filter);
+}
+
+
+/*
+ * '_ippServerCreateJobFile()' - Create a spool file for a job.
+ *
+ * The filename is "directory/job-id-job-name.ext" where the job name is made
+ * safe for the filesystem and the extension is derived from the document
+ * format when "ext" is `NULL`.
+ */
+
+int					/* O - File descriptor or -1 on error */
+_ippServerCreateJobFile(
+    int          job_id,		/* I - Job ID */
+    ipp_t        *job_attrs,		/* I - Job attributes */
+    const char   *format,		/* I - Document format */
+    char         *fname,		/* I - Filename buffer */
+    size_t       fnamesize,		/* I - Size of filename buffer */
+    const char   *directory,		/* I - Directory to store in */
+    const char   *ext)			/* I - Extension (`NULL` for default) */
+{
+  char			name[256],	/* "Safe" filename */
+			*nameptr;	/* Pointer into filename */
+  const char		*job_name;	/* job-name value */
+
+
+ /*
+  * Make a name from the job-name attribute...
+  */
+
+  if ((job_name = ippGetString(ippFindAttribute(job_attrs, "job-name", IPP_TAG_NAME), 0, NULL)) == NULL)
+    job_name = "untitled";
+
+  for (nameptr = name; *job_name && nameptr < (name + sizeof(name) - 1); job_name ++)
+  {
+    if (isalnum(*job_name & 255) || *job_name == '-')
+    {
+      *nameptr++ = (char)tolower(*job_name & 255);
+    }
+    else
+    {
+      *nameptr++ = '_';
+
+      while (job_name[1] && !isalnum(job_name[1] & 255) && job_name[1] != '-')
+        job_name ++;
+    }
+  }
+
+  *nameptr = '\0';
+
+ /*
+  * Figure out the extension...
+  */
+
+  if (!ext)
+  {
+    if (!format)
+      ext = "dat";
+    else if (!strcasecmp(format, "image/jpeg"))
+      ext = "jpg";
+    else if (!strcasecmp(format, "image/png"))
+      ext = "png";
+    else if (!strcasecmp(format, "image/pwg-raster"))
+      ext = "pwg";
+    else if (!strcasecmp(format, "image/urf"))
+      ext = "urf";
+    else if (!strcasecmp(format, "application/pdf"))
+      ext = "pdf";
+    else if (!strcasecmp(format, "application/postscript"))
+      ext = "ps";
+    else if (!strcasecmp(format, "application/vnd.hp-pcl"))
+      ext = "pcl";
+    else
+      ext = "dat";
+  }
+
+ /*
+  * Create a filename with the job-id, job-name, and document-format (extension)...
+  */
+
+  snprintf(fname, fnamesize, "%s/%d-%s.%s", directory, job_id, name, ext);
+
+  return (open(fname, O_WRONLY | O_CREAT | O_TRUNC, 0666));
+}
+
+
+
+/*
+ * '_ippServerDeleteFilter()' - Free a compiled filter.
+ */
+
+void
+_ippServerDeleteFilter(
+    _ipp_cfilter_t *filter)		/* I - Filter */
+{
+  size_t	i;			/* Looping var */
+
+
+  if (!filter)
+    return;
+
+  if (filter->names)
+  {
+    for (i = 0; i <= filter->mask; i ++)
+      _cupsStrFree(filter->names[i]);
+
+    free(filter->names);
+  }
+
+  free(filter->flags);
+  free(filter);
+}
+
+
+/*
+ * '_ippServerRespondUnsupported()' - Add an unsupported attribute to a
+ *                                    response.
+ *
+ * The status is set to client-error-attributes-or-values-not-supported and a
+ * copy of the attribute is added to the unsupported group.
+ */
+
+void
+_ippServerRespondUnsupported(
+    ipp_t           *response,		/* I - Response message */
+    ipp_attribute_t *attr)		/* I - Unsupported attribute */
+{
+  ipp_attribute_t	*temp;		/* Copy of attribute */
+
+
+  ippSetStatusCode(response, IPP_STATUS_ERROR_ATTRIBUTES_OR_VALUES);
+
+  if ((temp = ippFindAttribute(response, "status-message", IPP_TAG_TEXT)) != NULL)
+    ippSetStringf(response, &temp, 0, "Unsupported %s %s%s value.", ippGetName(attr), ippGetCount(attr) > 1 ? "1setOf " : "", ippTagString(ippGetValueTag(attr)));
+  else
+    ippAddStringf(response, IPP_TAG_OPERATION, IPP_TAG_TEXT, "status-message", NULL, "Unsupported %s %s%s value.", ippGetName(attr), ippGetCount(attr) > 1 ? "1setOf " : "", ippTagString(ippGetValueTag(attr)));
+
+  temp = ippCopyAttribute(response, attr, 0);
+  ippSetGroupTag(response, &temp, IPP_TAG_UNSUPPORTED_GROUP);
+}
+
+
+/*
+ * '_ippServerValidJobAttributes()' - Determine whether the job template
+ *                                    attributes in a request are valid.
+ *
+ * Values are checked against the corresponding "xxx-supported" attributes of
+ * the printer.  When one or more job attributes are invalid, this function
+ * adds a suitable status and attributes to the unsupported group of the
+ * response.
+ */
+
+int					/* O - 1 if valid, 0 if not */
+_ippServerValidJobAttributes(
+    ipp_t *request,			/* I - Request message */
+    ipp_t *printer_attrs,		/* I - Printer attributes */
+    ipp_t *response)			/* I - Response message */
+{
+  int			i,		/* Looping var */
+			count,		/* Number of values */
+			valid = 1;	/* Valid attributes? */
+  ipp_attribute_t	*attr,		/* Current attribute */
+			*supported;	/* xxx-supported attribute */
+
+
+ /*
+  * Check the various job template attributes...
+  */
+
+  if ((attr = ippFindAttribute(request, "copies", IPP_TAG_ZERO)) != NULL)
+  {
+    if (ippGetCount(attr) != 1 || ippGetValueTag(attr) != IPP_TAG_INTEGER ||
+        ippGetInteger(attr, 0) < 1 || ippGetInteger(attr, 0) > 999)
+    {
+      _ippServerRespondUnsupported(response, attr);
+      valid = 0;
+    }
+  }
+
+  if ((attr = ippFindAttribute(request, "ipp-attribute-fidelity", IPP_TAG_ZERO)) != NULL)
+  {
+    if (ippGetCount(attr) != 1 || ippGetValueTag(attr) != IPP_TAG_BOOLEAN)
+    {
+      _ippServerRespondUnsupported(response, attr);
+      valid = 0;
+    }
+  }
+
+  if ((attr = ippFindAttribute(request, "job-hold-until", IPP_TAG_ZERO)) != NULL)
+  {
+    if (ippGetCount(attr) != 1 ||
+        (ippGetValueTag(attr) != IPP_TAG_NAME &&
+	 ippGetValueTag(attr) != IPP_TAG_NAMELANG &&
+	 ippGetValueTag(attr) != IPP_TAG_KEYWORD) ||
+	strcmp(ippGetString(attr, 0, NULL), "no-hold"))
+    {
+      _ippServerRespondUnsupported(response, attr);
+      valid = 0;
+    }
+  }
+
+  if ((attr = ippFindAttribute(request, "job-impressions", IPP_TAG_ZERO)) != NULL)
+  {
+    if (ippGetCount(attr) != 1 || ippGetValueTag(attr) != IPP_TAG_INTEGER || ippGetInteger(attr, 0) < 0)
+    {
+      _ippServerRespondUnsupported(response, attr);
+      valid = 0;
+    }
+  }
+
+  if ((attr = ippFindAttribute(request, "job-name", IPP_TAG_ZERO)) != NULL)
+  {
+    if (ippGetCount(attr) != 1 ||
+        (ippGetValueTag(attr) != IPP_TAG_NAME &&
+	 ippGetValueTag(attr) != IPP_TAG_NAMELANG))
+    {
+      _ippServerRespondUnsupported(response, attr);
+      valid = 0;
+    }
+
+    ippSetGroupTag(request, &attr, IPP_TAG_JOB);
+  }
+  else
+    ippAddString(request, IPP_TAG_JOB, IPP_TAG_NAME, "job-name", NULL, "Untitled");
+
+  if ((attr = ippFindAttribute(request, "job-priority", IPP_TAG_ZERO)) != NULL)
+  {
+    if (ippGetCount(attr) != 1 || ippGetValueTag(attr) != IPP_TAG_INTEGER ||
+        ippGetInteger(attr, 0) < 1 || ippGetInteger(attr, 0) > 100)
+    {
+      _ippServerRespondUnsupported(response, attr);
+      valid = 0;
+    }
+  }
+
+  if ((attr = ippFindAttribute(request, "job-sheets", IPP_TAG_ZERO)) != NULL)
+  {
+    if (ippGetCount(attr) != 1 ||
+        (ippGetValueTag(attr) != IPP_TAG_NAME &&
+	 ippGetValueTag(attr) != IPP_TAG_NAMELANG &&
+	 ippGetValueTag(attr) != IPP_TAG_KEYWORD) ||
+	strcmp(ippGetString(attr, 0, NULL), "none"))
+    {
+      _ippServerRespondUnsupported(response, attr);
+      valid = 0;
+    }
+  }
+
+  if ((attr = ippFindAttribute(request, "media", IPP_TAG_ZERO)) != NULL)
+  {
+    if (ippGetCount(attr) != 1 ||
+        (ippGetValueTag(attr) != IPP_TAG_NAME &&
+	 ippGetValueTag(attr) != IPP_TAG_NAMELANG &&
+	 ippGetValueTag(attr) != IPP_TAG_KEYWORD))
+    {
+      _ippServerRespondUnsupported(response, attr);
+      valid = 0;
+    }
+    else
+    {
+      supported = ippFindAttribute(printer_attrs, "media-supported", IPP_TAG_KEYWORD);
+
+      if (!ippContainsString(supported, ippGetString(attr, 0, NULL)))
+      {
+	_ippServerRespondUnsupported(response, attr);
+	valid = 0;
+      }
+    }
+  }
+
+  if ((attr = ippFindAttribute(request, "media-col", IPP_TAG_ZERO)) != NULL)
+  {
+    ipp_t		*col,		/* media-col collection */
+			*size;		/* media-size collection */
+    ipp_attribute_t	*member,	/* Member attribute */
+			*x_dim,		/* x-dimension */
+			*y_dim;		/* y-dimension */
+    int			x_value,	/* y-dimension value */
+			y_value;	/* x-dimension value */
+
+    if (ippGetCount(attr) != 1 ||
+        ippGetValueTag(attr) != IPP_TAG_BEGIN_COLLECTION)
+    {
+      _ippServerRespondUnsupported(response, attr);
+      valid = 0;
+    }
+
+    col = ippGetCollection(attr, 0);
+
+    if ((member = ippFindAttribute(col, "media-size-name", IPP_TAG_ZERO)) != NULL)
+    {
+      if (ippGetCount(member) != 1 ||
+	  (ippGetValueTag(member) != IPP_TAG_NAME &&
+	   ippGetValueTag(member) != IPP_TAG_NAMELANG &&
+	   ippGetValueTag(member) != IPP_TAG_KEYWORD))
+      {
+	_ippServerRespondUnsupported(response, attr);
+	valid = 0;
+      }
+      else
+      {
+	supported = ippFindAttribute(printer_attrs, "media-supported", IPP_TAG_KEYWORD);
+
+	if (!ippContainsString(supported, ippGetString(member, 0, NULL)))
+	{
+	  _ippServerRespondUnsupported(response, attr);
+	  valid = 0;
+	}
+      }
+    }
+    else if ((member = ippFindAttribute(col, "media-size", IPP_TAG_BEGIN_COLLECTION)) != NULL)
+    {
+      if (ippGetCount(member) != 1)
+      {
+	_ippServerRespondUnsupported(response, attr);
+	valid = 0;
+      }
+      else
+      {
+	size = ippGetCollection(member, 0);
+
+	if ((x_dim = ippFindAttribute(size, "x-dimension", IPP_TAG_INTEGER)) == NULL || ippGetCount(x_dim) != 1 ||
+	    (y_dim = ippFindAttribute(size, "y-dimension", IPP_TAG_INTEGER)) == NULL || ippGetCount(y_dim) != 1)
+	{
+	  _ippServerRespondUnsupported(response, attr);
+	  valid = 0;
+	}
+	else
+	{
+	  x_value   = ippGetInteger(x_dim, 0);
+	  y_value   = ippGetInteger(y_dim, 0);
+	  supported = ippFindAttribute(printer_attrs, "media-size-supported", IPP_TAG_BEGIN_COLLECTION);
+	  count     = ippGetCount(supported);
+
+	  for (i = 0; i < count ; i ++)
+	  {
+	    size  = ippGetCollection(supported, i);
+	    x_dim = ippFindAttribute(size, "x-dimension", IPP_TAG_ZERO);
+	    y_dim = ippFindAttribute(size, "y-dimension", IPP_TAG_ZERO);
+
+	    if (ippContainsInteger(x_dim, x_value) && ippContainsInteger(y_dim, y_value))
+	      break;
+	  }
+
+	  if (i >= count)
+	  {
+	    _ippServerRespondUnsupported(response, attr);
+	    valid = 0;
+	  }
+	}
+      }
+    }
+  }
+
+  if ((attr = ippFindAttribute(request, "multiple-document-handling", IPP_TAG_ZERO)) != NULL)
+  {
+    if (ippGetCount(attr) != 1 || ippGetValueTag(attr) != IPP_TAG_KEYWORD ||
+        (strcmp(ippGetString(attr, 0, NULL),
+		"separate-documents-uncollated-copies") &&
+	 strcmp(ippGetString(attr, 0, NULL),
+		"separate-documents-collated-copies")))
+    {
+      _ippServerRespondUnsupported(response, attr);
+      valid = 0;
+    }
+  }
+
+  if ((attr = ippFindAttribute(request, "orientation-requested", IPP_TAG_ZERO)) != NULL)
+  {
+    if (ippGetCount(attr) != 1 || ippGetValueTag(attr) != IPP_TAG_ENUM ||
+        ippGetInteger(attr, 0) < IPP_ORIENT_PORTRAIT ||
+        ippGetInteger(attr, 0) > IPP_ORIENT_REVERSE_PORTRAIT)
+    {
+      _ippServerRespondUnsupported(response, attr);
+      valid = 0;
+    }
+  }
+
+  if ((attr = ippFindAttribute(request, "page-ranges", IPP_TAG_ZERO)) != NULL)
+  {
+    if (ippGetValueTag(attr) != IPP_TAG_RANGE)
+    {
+      _ippServerRespondUnsupported(response, attr);
+      valid = 0;
+    }
+  }
+
+  if ((attr = ippFindAttribute(request, "print-quality", IPP_TAG_ZERO)) != NULL)
+  {
+    if (ippGetCount(attr) != 1 || ippGetValueTag(attr) != IPP_TAG_ENUM ||
+        ippGetInteger(attr, 0) < IPP_QUALITY_DRAFT ||
+        ippGetInteger(attr, 0) > IPP_QUALITY_HIGH)
+    {
+      _ippServerRespondUnsupported(response, attr);
+      valid = 0;
+    }
+  }
+
+  if ((attr = ippFindAttribute(request, "printer-resolution", IPP_TAG_ZERO)) != NULL)
+  {
+    supported = ippFindAttribute(printer_attrs, "printer-resolution-supported", IPP_TAG_RESOLUTION);
+
+    if (ippGetCount(attr) != 1 || ippGetValueTag(attr) != IPP_TAG_RESOLUTION ||
+        !supported)
+    {
+      _ippServerRespondUnsupported(response, attr);
+      valid = 0;
+    }
+    else
+    {
+      int	xdpi,			/* Horizontal resolution for job template attribute */
+		ydpi,			/* Vertical resolution for job template attribute */
+		sydpi;			/* Vertical resolution for supported value */
+      ipp_res_t	units,			/* Units for job template attribute */
+		sunits;			/* Units for supported value */
+
+      xdpi  = ippGetResolution(attr, 0, &ydpi, &units);
+      count = ippGetCount(supported);
+
+      for (i = 0; i < count; i ++)
+      {
+        if (xdpi == ippGetResolution(supported, i, &sydpi, &sunits) && ydpi == sydpi && units == sunits)
+          break;
+      }
+
+      if (i >= count)
+      {
+	_ippServerRespondUnsupported(response, attr);
+	valid = 0;
+      }
+    }
+  }
+
+  if ((attr = ippFindAttribute(request, "sides", IPP_TAG_ZERO)) != NULL)
+  {
+    const char *sides = ippGetString(attr, 0, NULL);
+					/* "sides" value... */
+
+    if (ippGetCount(attr) != 1 || ippGetValueTag(attr) != IPP_TAG_KEYWORD)
+    {
+      _ippServerRespondUnsupported(response, attr);
+      valid = 0;
+    }
+    else if ((supported = ippFindAttribute(printer_attrs, "sides-supported", IPP_TAG_KEYWORD)) != NULL)
+    {
+      if (!ippContainsString(supported, sides))
+      {
+	_ippServerRespondUnsupported(response, attr);
+	valid = 0;
+      }
+    }
+    else if (strcmp(sides, "one-sided"))
+    {
+      _ippServerRespondUnsupported(response, attr);
+      valid = 0;
+    }
+  }
+
+  return (valid);
+}
+
+
+
+/*
+ * 'ipp_cfilter_add()' - Add a name to a compiled filter.
+ */
+
+static void
+ipp_cfilter_add(_ipp_cfilter_t *filter,	/* I - Filter */
+                const char     *name,	/* I - Attribute name */
+                unsigned char  flag)	/* I - IPP_CFILTER_COPY or IPP_CFILTER_SKIP */
+{
+  char		*pooled;		/* Pooled name */
+  size_t	slot;			/* Slot for name */
+
+
+  if ((pooled = _cupsStrAlloc(name)) == NULL)
+    return;
+
+  slot = ipp_cfilter_slot(filter, pooled);
+
+  if (filter->names[slot])
+    _cupsStrFree(pooled);		/* Already have a reference */
+  else
+    filter->names[slot] = pooled;
+
+  filter->flags[slot] |= flag;
+}
+
+
+/*
+ * 'ipp_cfilter_slot()' - Find the slot for a pooled name in a compiled filter.
+ *
+ * Attribute names are always in the string pool and the filter holds a
+ * reference to its names, so equal names have the same pointer.  An empty
+ * slot with no flags is returned for names that are not in the filter.
+ */
+
+static size_t				/* O - Slot number */
+ipp_cfilter_slot(_ipp_cfilter_t *filter,/* I - Filter */
+                 const char     *name)	/* I - Pooled attribute name */
+{
+  size_t	hash;			/* Hash value */
+
+
+  for (hash = ((size_t)name >> 4) * 2654435761U; filter->names[hash & filter->mask] && filter->names[hash & filter->mask] != name; hash ++);
+
+  return (hash & filter->mask);
+}
+
+
+/*
+ * 'ipp_filter_cb()' - Filter attributes based on the requested and private
+ *                     arrays.
+ */
+
+static int				/* O - 1 to copy, 0 to ignore */
+ipp_filter_cb(_ipp_filter_t   *filter,	/* I - Filter parameters */
+              ipp_t           *dst,	/* I - Destination (unused) */
+	      ipp_attribute_t *attr)	/* I - Source attribute */
+{
+  ipp_tag_t	group = ippGetGroupTag(attr);
+					/* Group of attribute */
+  const char	*name = ippGetName(attr);
+					/* Name of attribute */
+
+
+  (void)dst;
+
+  if ((filter->group_tag != IPP_TAG_ZERO && group != filter->group_tag && group != IPP_TAG_ZERO) || !name || (!strcmp(name, "media-col-database") && !cupsArrayFind(filter->ra, (void *)name)))
+    return (0);
+
+  if (filter->pa && cupsArrayFind(filter->pa, (void *)name))
+    return (0);
+
+  return (!filter->ra || cupsArrayFind(filter->ra, (void *)name) != NULL);
+}
@@ -16,6 +16,18 @@
 #include "debug-internal.h"
 
 
+/*
+ * Local types...
+ */
+
+typedef struct ipp_lookup_s		/**** Sorted name lookup entry ****/
+{
+  const char	*name;			/* String */
+  int		value;			/* Value */
+  int		order;			/* Original table order */
+} ipp_lookup_t;
+
+
 /*
  * Local globals...
  */
@@ -635,12 +647,136 @@ static const char * const ipp_document_states[] =
 		  "stopped"
 		};
 
+static const char * const ipp_names[] =
+		{			/* Well-known attribute names, sorted */
+		  "attributes-charset",
+		  "attributes-natural-language",
+		  "compression",
+		  "copies",
+		  "copies-default",
+		  "copies-supported",
+		  "document-format",
+		  "document-format-default",
+		  "document-format-supported",
+		  "document-name",
+		  "document-number",
+		  "document-state",
+		  "document-state-reasons",
+		  "finishings",
+		  "finishings-actual",
+		  "finishings-col",
+		  "finishings-default",
+		  "finishings-ready",
+		  "finishings-supported",
+		  "first-index",
+		  "ipp-attribute-fidelity",
+		  "job-collation-type",
+		  "job-collation-type-actual",
+		  "job-finishings",
+		  "job-finishings-default",
+		  "job-finishings-supported",
+		  "job-hold-until",
+		  "job-id",
+		  "job-ids",
+		  "job-impressions",
+		  "job-impressions-completed",
+		  "job-k-octets",
+		  "job-name",
+		  "job-originating-user-name",
+		  "job-printer-uri",
+		  "job-priority",
+		  "job-state",
+		  "job-state-message",
+		  "job-state-reasons",
+		  "job-uri",
+		  "job-uuid",
+		  "last-document",
+		  "limit",
+		  "media",
+		  "media-col",
+		  "media-col-database",
+		  "media-col-default",
+		  "media-col-ready",
+		  "media-default",
+		  "media-ready",
+		  "media-supported",
+		  "multiple-document-handling",
+		  "my-jobs",
+		  "notify-events",
+		  "notify-job-id",
+		  "notify-subscription-id",
+		  "notify-subscription-ids",
+		  "operations-supported",
+		  "orientation-requested",
+		  "orientation-requested-actual",
+		  "orientation-requested-default",
+		  "orientation-requested-supported",
+		  "output-bin",
+		  "page-ranges",
+		  "print-color-mode",
+		  "print-quality",
+		  "print-quality-actual",
+		  "print-quality-default",
+		  "print-quality-supported",
+		  "printer-resolution",
+		  "printer-state",
+		  "printer-state-message",
+		  "printer-state-reasons",
+		  "printer-uri",
+		  "requested-attributes",
+		  "requesting-user-name",
+		  "resource-id",
+		  "resource-state",
+		  "sides",
+		  "system-state",
+		  "system-uri",
+		  "which-jobs"
+		};
+
+static const ipp_lookup_t ipp_op_aliases[] =
+		{			/* Legacy operation names */
+		  { "Create-Job-Subscription", IPP_OP_CREATE_JOB_SUBSCRIPTIONS, 0 },
+		  { "Create-Printer-Subscription", IPP_OP_CREATE_PRINTER_SUBSCRIPTIONS, 0 },
+		  { "CUPS-Add-Class", IPP_OP_CUPS_ADD_MODIFY_CLASS, 0 },
+		  { "CUPS-Add-Printer", IPP_OP_CUPS_ADD_MODIFY_PRINTER, 0 }
+		},
+		ipp_tag_aliases[] =
+		{			/* Short tag names */
+		  { "operation", IPP_TAG_OPERATION, 0 },
+		  { "job", IPP_TAG_JOB, 0 },
+		  { "printer", IPP_TAG_PRINTER, 0 },
+		  { "unsupported", IPP_TAG_UNSUPPORTED_GROUP, 0 },
+		  { "subscription", IPP_TAG_SUBSCRIPTION, 0 },
+		  { "event", IPP_TAG_EVENT_NOTIFICATION, 0 },
+		  { "language", IPP_TAG_LANGUAGE, 0 },
+		  { "mimetype", IPP_TAG_MIMETYPE, 0 },
+		  { "name", IPP_TAG_NAME, 0 },
+		  { "text", IPP_TAG_TEXT, 0 },
+		  { "begCollection", IPP_TAG_BEGIN_COLLECTION, 0 }
+		};
+static _cups_mutex_t	ipp_lookup_mutex = _CUPS_MUTEX_INITIALIZER;
+					/* Mutex for sorted lookup tables */
+static int		ipp_lookup_ready = 0;
+					/* Sorted lookup tables initialized? */
+static ipp_lookup_t	ipp_finishings_lookup[sizeof(ipp_finishings_vendor) / sizeof(ipp_finishings_vendor[0]) + sizeof(ipp_finishings) / sizeof(ipp_finishings[0])],
+					/* Sorted finishings enums */
+			ipp_op_lookup[sizeof(ipp_std_ops) / sizeof(ipp_std_ops[0]) + 1 + sizeof(ipp_cups_ops) / sizeof(ipp_cups_ops[0]) + sizeof(ipp_cups_ops2) / sizeof(ipp_cups_ops2[0]) + sizeof(ipp_op_aliases) / sizeof(ipp_op_aliases[0])],
+					/* Sorted operation names */
+			ipp_tag_lookup[sizeof(ipp_tag_names) / sizeof(ipp_tag_names[0]) + sizeof(ipp_tag_aliases) / sizeof(ipp_tag_aliases[0])];
+					/* Sorted tag names */
+
 
 /*
  * Local functions...
  */
 
 static size_t	ipp_col_string(ipp_t *col, char *buffer, size_t bufsize);
+static int	ipp_compare_lookup(ipp_lookup_t *a, ipp_lookup_t *b);
+static int	ipp_compare_lookup_case(ipp_lookup_t *a, ipp_lookup_t *b);
+static int	ipp_compare_names(const char *a, const char * const *b);
+static const char *ipp_enum_string(ipp_name_t name, int enumvalue);
+static int	ipp_find_lookup(ipp_lookup_t *table, size_t num_table, const char *name, int case_sensitive);
+static void	ipp_init_lookups(void);
 
 
 /*
@@ -695,7 +831,7 @@ ippAttributeString(
     switch (attr->value_tag & ~IPP_TAG_CUPS_CONST)
     {
       case IPP_TAG_ENUM :
-          ptr = ippEnumString(attr->name, val->integer);
+          ptr = ipp_enum_string(ippGetNameId(attr), val->integer);
 
           if (buffer && bufptr < bufend)
             strlcpy(bufptr, ptr, (size_t)(bufend - bufptr + 1));
@@ -2080,45 +2216,7 @@ const char *				/* O - Enum string */
 ippEnumString(const char *attrname,	/* I - Attribute name */
               int        enumvalue)	/* I - Enum value */
 {
-  _cups_globals_t *cg = _cupsGlobals();	/* Pointer to library globals */
-
-
- /*
-  * Check for standard enum values...
-  */
-
-  if (!strcmp(attrname, "document-state") && enumvalue >= 3 && enumvalue < (3 + (int)(sizeof(ipp_document_states) / sizeof(ipp_document_states[0]))))
-    return (ipp_document_states[enumvalue - 3]);
-  else if (!strcmp(attrname, "finishings") || !strcmp(attrname, "finishings-actual") || !strcmp(attrname, "finishings-default") || !strcmp(attrname, "finishings-ready") || !strcmp(attrname, "finishings-supported") || !strcmp(attrname, "job-finishings") || !strcmp(attrname, "job-finishings-default") || !strcmp(attrname, "job-finishings-supported"))
-  {
-    if (enumvalue >= 3 && enumvalue < (3 + (int)(sizeof(ipp_finishings) / sizeof(ipp_finishings[0]))))
-      return (ipp_finishings[enumvalue - 3]);
-    else if (enumvalue >= 0x40000000 && enumvalue < (0x40000000 + (int)(sizeof(ipp_finishings_vendor) / sizeof(ipp_finishings_vendor[0]))))
-      return (ipp_finishings_vendor[enumvalue - 0x40000000]);
-  }
-  else if ((!strcmp(attrname, "job-collation-type") || !strcmp(attrname, "job-collation-type-actual")) && enumvalue >= 3 && enumvalue < (3 + (int)(sizeof(ipp_job_collation_types) / sizeof(ipp_job_collation_types[0]))))
-    return (ipp_job_collation_types[enumvalue - 3]);
-  else if (!strcmp(attrname, "job-state") && enumvalue >= IPP_JSTATE_PENDING && enumvalue <= IPP_JSTATE_COMPLETED)
-    return (ipp_job_states[enumvalue - IPP_JSTATE_PENDING]);
-  else if (!strcmp(attrname, "operations-supported"))
-    return (ippOpString((ipp_op_t)enumvalue));
-  else if ((!strcmp(attrname, "orientation-requested") || !strcmp(attrname, "orientation-requested-actual") || !strcmp(attrname, "orientation-requested-default") || !strcmp(attrname, "orientation-requested-supported")) && enumvalue >= 3 && enumvalue < (3 + (int)(sizeof(ipp_orientation_requesteds) / sizeof(ipp_orientation_requesteds[0]))))
-    return (ipp_orientation_requesteds[enumvalue - 3]);
-  else if ((!strcmp(attrname, "print-quality") || !strcmp(attrname, "print-quality-actual") || !strcmp(attrname, "print-quality-default") || !strcmp(attrname, "print-quality-supported")) && enumvalue >= 3 && enumvalue < (3 + (int)(sizeof(ipp_print_qualities) / sizeof(ipp_print_qualities[0]))))
-    return (ipp_print_qualities[enumvalue - 3]);
-  else if (!strcmp(attrname, "printer-state") && enumvalue >= IPP_PSTATE_IDLE && enumvalue <= IPP_PSTATE_STOPPED)
-    return (ipp_printer_states[enumvalue - IPP_PSTATE_IDLE]);
-  else if (!strcmp(attrname, "resource-state") && enumvalue >= IPP_RSTATE_PENDING && enumvalue <= IPP_RSTATE_ABORTED)
-    return (ipp_resource_states[enumvalue - IPP_RSTATE_PENDING]);
-  else if (!strcmp(attrname, "system-state") && enumvalue >= IPP_SSTATE_IDLE && enumvalue <= IPP_SSTATE_STOPPED)
-    return (ipp_system_states[enumvalue - IPP_SSTATE_IDLE]);
-
- /*
-  * Not a standard enum value, just return the decimal equivalent...
-  */
-
-  snprintf(cg->ipp_unknown, sizeof(cg->ipp_unknown), "%d", enumvalue);
-  return (cg->ipp_unknown);
+  return (ipp_enum_string(ippNameValue(attrname), enumvalue));
 }
 
 
@@ -2146,75 +2244,70 @@ ippEnumValue(const char *attrname,	/* I - Attribute name */
   * Otherwise look up the string...
   */
 
-  if (!strcmp(attrname, "document-state"))
-  {
-    num_strings = (int)(sizeof(ipp_document_states) / sizeof(ipp_document_states[0]));
-    strings     = ipp_document_states;
-  }
-  else if (!strcmp(attrname, "finishings") ||
-	   !strcmp(attrname, "finishings-actual") ||
-	   !strcmp(attrname, "finishings-default") ||
-	   !strcmp(attrname, "finishings-ready") ||
-	   !strcmp(attrname, "finishings-supported"))
+  switch (ippNameValue(attrname))
   {
-    for (i = 0;
-         i < (int)(sizeof(ipp_finishings_vendor) /
-                   sizeof(ipp_finishings_vendor[0]));
-         i ++)
-      if (!strcmp(enumstring, ipp_finishings_vendor[i]))
-	return (i + 0x40000000);
-
-    num_strings = (int)(sizeof(ipp_finishings) / sizeof(ipp_finishings[0]));
-    strings     = ipp_finishings;
+    case IPP_NAME_DOCUMENT_STATE :
+	num_strings = (int)(sizeof(ipp_document_states) / sizeof(ipp_document_states[0]));
+	strings     = ipp_document_states;
+	break;
+
+    case IPP_NAME_FINISHINGS :
+    case IPP_NAME_FINISHINGS_ACTUAL :
+    case IPP_NAME_FINISHINGS_DEFAULT :
+    case IPP_NAME_FINISHINGS_READY :
+    case IPP_NAME_FINISHINGS_SUPPORTED :
+	return (ipp_find_lookup(ipp_finishings_lookup, sizeof(ipp_finishings_lookup) / sizeof(ipp_finishings_lookup[0]), enumstring, 1));
+
+    case IPP_NAME_JOB_COLLATION_TYPE :
+    case IPP_NAME_JOB_COLLATION_TYPE_ACTUAL :
+	num_strings = (int)(sizeof(ipp_job_collation_types) /
+			    sizeof(ipp_job_collation_types[0]));
+	strings     = ipp_job_collation_types;
+	break;
+
+    case IPP_NAME_JOB_STATE :
+	num_strings = (int)(sizeof(ipp_job_states) / sizeof(ipp_job_states[0]));
+	strings     = ipp_job_states;
+	break;
+
+    case IPP_NAME_OPERATIONS_SUPPORTED :
+	return (ippOpValue(enumstring));
+
+    case IPP_NAME_ORIENTATION_REQUESTED :
+    case IPP_NAME_ORIENTATION_REQUESTED_ACTUAL :
+    case IPP_NAME_ORIENTATION_REQUESTED_DEFAULT :
+    case IPP_NAME_ORIENTATION_REQUESTED_SUPPORTED :
+	num_strings = (int)(sizeof(ipp_orientation_requesteds) /
+			    sizeof(ipp_orientation_requesteds[0]));
+	strings     = ipp_orientation_requesteds;
+	break;
+
+    case IPP_NAME_PRINT_QUALITY :
+    case IPP_NAME_PRINT_QUALITY_ACTUAL :
+    case IPP_NAME_PRINT_QUALITY_DEFAULT :
+    case IPP_NAME_PRINT_QUALITY_SUPPORTED :
+	num_strings = (int)(sizeof(ipp_print_qualities) / sizeof(ipp_print_qualities[0]));
+	strings     = ipp_print_qualities;
+	break;
+
+    case IPP_NAME_PRINTER_STATE :
+	num_strings = (int)(sizeof(ipp_printer_states) / sizeof(ipp_printer_states[0]));
+	strings     = ipp_printer_states;
+	break;
+
+    case IPP_NAME_RESOURCE_STATE :
+	num_strings = (int)(sizeof(ipp_resource_states) / sizeof(ipp_resource_states[0]));
+	strings     = ipp_resource_states;
+	break;
+
+    case IPP_NAME_SYSTEM_STATE :
+	num_strings = (int)(sizeof(ipp_system_states) / sizeof(ipp_system_states[0]));
+	strings     = ipp_system_states;
+	break;
+
+    default :
+	return (-1);
   }
-  else if (!strcmp(attrname, "job-collation-type") ||
-           !strcmp(attrname, "job-collation-type-actual"))
-  {
-    num_strings = (int)(sizeof(ipp_job_collation_types) /
-                        sizeof(ipp_job_collation_types[0]));
-    strings     = ipp_job_collation_types;
-  }
-  else if (!strcmp(attrname, "job-state"))
-  {
-    num_strings = (int)(sizeof(ipp_job_states) / sizeof(ipp_job_states[0]));
-    strings     = ipp_job_states;
-  }
-  else if (!strcmp(attrname, "operations-supported"))
-    return (ippOpValue(enumstring));
-  else if (!strcmp(attrname, "orientation-requested") ||
-           !strcmp(attrname, "orientation-requested-actual") ||
-           !strcmp(attrname, "orientation-requested-default") ||
-           !strcmp(attrname, "orientation-requested-supported"))
-  {
-    num_strings = (int)(sizeof(ipp_orientation_requesteds) /
-                        sizeof(ipp_orientation_requesteds[0]));
-    strings     = ipp_orientation_requesteds;
-  }
-  else if (!strcmp(attrname, "print-quality") ||
-           !strcmp(attrname, "print-quality-actual") ||
-           !strcmp(attrname, "print-quality-default") ||
-           !strcmp(attrname, "print-quality-supported"))
-  {
-    num_strings = (int)(sizeof(ipp_print_qualities) / sizeof(ipp_print_qualities[0]));
-    strings     = ipp_print_qualities;
-  }
-  else if (!strcmp(attrname, "printer-state"))
-  {
-    num_strings = (int)(sizeof(ipp_printer_states) / sizeof(ipp_printer_states[0]));
-    strings     = ipp_printer_states;
-  }
-  else if (!strcmp(attrname, "resource-state"))
-  {
-    num_strings = (int)(sizeof(ipp_resource_states) / sizeof(ipp_resource_states[0]));
-    strings     = ipp_resource_states;
-  }
-  else if (!strcmp(attrname, "system-state"))
-  {
-    num_strings = (int)(sizeof(ipp_system_states) / sizeof(ipp_system_states[0]));
-    strings     = ipp_system_states;
-  }
-  else
-    return (-1);
 
   for (i = 0; i < num_strings; i ++)
     if (!strcmp(enumstring, strings[i]))
@@ -2310,6 +2403,47 @@ ippErrorValue(const char *name)		/* I - Name */
 }
 
 
+/*
+ * 'ippNameString()' - Return the string for a well-known attribute name ID.
+ *
+ * @since CUPS 2.3@
+ */
+
+const char *				/* O - Attribute name or @code NULL@ */
+ippNameString(ipp_name_t name)		/* I - Name ID */
+{
+  if (name > IPP_NAME_UNKNOWN && name <= (ipp_name_t)(sizeof(ipp_names) / sizeof(ipp_names[0])))
+    return (ipp_names[name - 1]);
+  else
+    return (NULL);
+}
+
+
+/*
+ * 'ippNameValue()' - Return the ID for a well-known attribute name.
+ *
+ * Only the attribute names listed in @code ipp_name_t@ have IDs - all other
+ * names return @code IPP_NAME_UNKNOWN@.
+ *
+ * @since CUPS 2.3@
+ */
+
+ipp_name_t				/* O - Name ID or @code IPP_NAME_UNKNOWN@ */
+ippNameValue(const char *name)		/* I - Attribute name */
+{
+  const char * const	*match;		/* Matching name */
+
+
+  if (!name)
+    return (IPP_NAME_UNKNOWN);
+
+  if ((match = (const char * const *)bsearch(name, ipp_names, sizeof(ipp_names) / sizeof(ipp_names[0]), sizeof(ipp_names[0]), (int (*)(const void *, const void *))ipp_compare_names)) != NULL)
+    return ((ipp_name_t)(match - ipp_names + 1));
+  else
+    return (IPP_NAME_UNKNOWN);
+}
+
+
 /*
  * 'ippOpString()' - Return a name for the given operation id.
  *
@@ -2354,40 +2488,16 @@ ippOpString(ipp_op_t op)		/* I - Operation ID */
 ipp_op_t				/* O - Operation ID */
 ippOpValue(const char *name)		/* I - Textual name */
 {
-  size_t	i;			/* Looping var */
+  int	op;				/* Operation ID */
 
 
   if (!strncmp(name, "0x", 2))
     return ((ipp_op_t)strtol(name + 2, NULL, 16));
 
-  for (i = 0; i < (sizeof(ipp_std_ops) / sizeof(ipp_std_ops[0])); i ++)
-    if (!_cups_strcasecmp(name, ipp_std_ops[i]))
-      return ((ipp_op_t)i);
-
-  if (!_cups_strcasecmp(name, "windows-ext"))
-    return (IPP_OP_PRIVATE);
-
-  for (i = 0; i < (sizeof(ipp_cups_ops) / sizeof(ipp_cups_ops[0])); i ++)
-    if (!_cups_strcasecmp(name, ipp_cups_ops[i]))
-      return ((ipp_op_t)(i + 0x4001));
-
-  for (i = 0; i < (sizeof(ipp_cups_ops2) / sizeof(ipp_cups_ops2[0])); i ++)
-    if (!_cups_strcasecmp(name, ipp_cups_ops2[i]))
-      return ((ipp_op_t)(i + 0x4027));
-
-  if (!_cups_strcasecmp(name, "Create-Job-Subscription"))
-    return (IPP_OP_CREATE_JOB_SUBSCRIPTIONS);
-
-  if (!_cups_strcasecmp(name, "Create-Printer-Subscription"))
-    return (IPP_OP_CREATE_PRINTER_SUBSCRIPTIONS);
-
-  if (!_cups_strcasecmp(name, "CUPS-Add-Class"))
-    return (IPP_OP_CUPS_ADD_MODIFY_CLASS);
-
-  if (!_cups_strcasecmp(name, "CUPS-Add-Printer"))
-    return (IPP_OP_CUPS_ADD_MODIFY_PRINTER);
-
-  return (IPP_OP_CUPS_INVALID);
+  if ((op = ipp_find_lookup(ipp_op_lookup, sizeof(ipp_op_lookup) / sizeof(ipp_op_lookup[0]), name, 0)) < 0)
+    return (IPP_OP_CUPS_INVALID);
+  else
+    return ((ipp_op_t)op);
 }
 
 
@@ -2472,37 +2582,13 @@ ippTagString(ipp_tag_t tag)		/* I - Tag value */
 ipp_tag_t				/* O - Tag value */
 ippTagValue(const char *name)		/* I - Tag name */
 {
-  size_t	i;			/* Looping var */
+  int	tag;				/* Tag value */
 
 
-  for (i = 0; i < (sizeof(ipp_tag_names) / sizeof(ipp_tag_names[0])); i ++)
-    if (!_cups_strcasecmp(name, ipp_tag_names[i]))
-      return ((ipp_tag_t)i);
-
-  if (!_cups_strcasecmp(name, "operation"))
-    return (IPP_TAG_OPERATION);
-  else if (!_cups_strcasecmp(name, "job"))
-    return (IPP_TAG_JOB);
-  else if (!_cups_strcasecmp(name, "printer"))
-    return (IPP_TAG_PRINTER);
-  else if (!_cups_strcasecmp(name, "unsupported"))
-    return (IPP_TAG_UNSUPPORTED_GROUP);
-  else if (!_cups_strcasecmp(name, "subscription"))
-    return (IPP_TAG_SUBSCRIPTION);
-  else if (!_cups_strcasecmp(name, "event"))
-    return (IPP_TAG_EVENT_NOTIFICATION);
-  else if (!_cups_strcasecmp(name, "language"))
-    return (IPP_TAG_LANGUAGE);
-  else if (!_cups_strcasecmp(name, "mimetype"))
-    return (IPP_TAG_MIMETYPE);
-  else if (!_cups_strcasecmp(name, "name"))
-    return (IPP_TAG_NAME);
-  else if (!_cups_strcasecmp(name, "text"))
-    return (IPP_TAG_TEXT);
-  else if (!_cups_strcasecmp(name, "begCollection"))
-    return (IPP_TAG_BEGIN_COLLECTION);
-  else
+  if ((tag = ipp_find_lookup(ipp_tag_lookup, sizeof(ipp_tag_lookup) / sizeof(ipp_tag_lookup[0]), name, 0)) < 0)
     return (IPP_TAG_ZERO);
+  else
+    return ((ipp_tag_t)tag);
 }
 
 
@@ -2567,3 +2653,293 @@ ipp_col_string(ipp_t  *col,		/* I - Collection attribute */
 
   return ((size_t)(bufptr - buffer));
 }
+
+
+/*
+ * 'ipp_compare_lookup()' - Compare two lookup entries.
+ */
+
+static int				/* O - Result of comparison */
+ipp_compare_lookup(ipp_lookup_t *a,	/* I - First entry */
+                   ipp_lookup_t *b)	/* I - Second entry */
+{
+  int	result;				/* Result of comparison */
+
+
+  if ((result = strcmp(a->name, b->name)) == 0)
+    result = a->order - b->order;
+
+  return (result);
+}
+
+
+/*
+ * 'ipp_compare_lookup_case()' - Compare two lookup entries, ignoring case.
+ */
+
+static int				/* O - Result of comparison */
+ipp_compare_lookup_case(
+    ipp_lookup_t *a,			/* I - First entry */
+    ipp_lookup_t *b)			/* I - Second entry */
+{
+  int	result;				/* Result of comparison */
+
+
+  if ((result = _cups_strcasecmp(a->name, b->name)) == 0)
+    result = a->order - b->order;
+
+  return (result);
+}
+
+
+/*
+ * 'ipp_compare_names()' - Compare an attribute name with a table entry.
+ */
+
+static int				/* O - Result of comparison */
+ipp_compare_names(const char         *a,/* I - Attribute name */
+                  const char * const *b)/* I - Table entry */
+{
+  return (strcmp(a, *b));
+}
+
+
+/*
+ * 'ipp_enum_string()' - Return a string corresponding to the enum value.
+ */
+
+static const char *			/* O - Enum string */
+ipp_enum_string(ipp_name_t name,	/* I - Attribute name ID */
+                int        enumvalue)	/* I - Enum value */
+{
+  _cups_globals_t *cg = _cupsGlobals();	/* Pointer to library globals */
+
+
+ /*
+  * Check for standard enum values...
+  */
+
+  switch (name)
+  {
+    case IPP_NAME_DOCUMENT_STATE :
+        if (enumvalue >= 3 && enumvalue < (3 + (int)(sizeof(ipp_document_states) / sizeof(ipp_document_states[0]))))
+	  return (ipp_document_states[enumvalue - 3]);
+        break;
+
+    case IPP_NAME_FINISHINGS :
+    case IPP_NAME_FINISHINGS_ACTUAL :
+    case IPP_NAME_FINISHINGS_DEFAULT :
+    case IPP_NAME_FINISHINGS_READY :
+    case IPP_NAME_FINISHINGS_SUPPORTED :
+    case IPP_NAME_JOB_FINISHINGS :
+    case IPP_NAME_JOB_FINISHINGS_DEFAULT :
+    case IPP_NAME_JOB_FINISHINGS_SUPPORTED :
+	if (enumvalue >= 3 && enumvalue < (3 + (int)(sizeof(ipp_finishings) / sizeof(ipp_finishings[0]))))
+	  return (ipp_finishings[enumvalue - 3]);
+	else if (enumvalue >= 0x40000000 && enumvalue < (0x40000000 + (int)(sizeof(ipp_finishings_vendor) / sizeof(ipp_finishings_vendor[0]))))
+	  return (ipp_finishings_vendor[enumvalue - 0x40000000]);
+        break;
+
+    case IPP_NAME_JOB_COLLATION_TYPE :
+    case IPP_NAME_JOB_COLLATION_TYPE_ACTUAL :
+        if (enumvalue >= 3 && enumvalue < (3 + (int)(sizeof(ipp_job_collation_types) / sizeof(ipp_job_collation_types[0]))))
+	  return (ipp_job_collation_types[enumvalue - 3]);
+        break;
+
+    case IPP_NAME_JOB_STATE :
+        if (enumvalue >= IPP_JSTATE_PENDING && enumvalue <= IPP_JSTATE_COMPLETED)
+	  return (ipp_job_states[enumvalue - IPP_JSTATE_PENDING]);
+        break;
+
+    case IPP_NAME_OPERATIONS_SUPPORTED :
+        return (ippOpString((ipp_op_t)enumvalue));
+
+    case IPP_NAME_ORIENTATION_REQUESTED :
+    case IPP_NAME_ORIENTATION_REQUESTED_ACTUAL :
+    case IPP_NAME_ORIENTATION_REQUESTED_DEFAULT :
+    case IPP_NAME_ORIENTATION_REQUESTED_SUPPORTED :
+        if (enumvalue >= 3 && enumvalue < (3 + (int)(sizeof(ipp_orientation_requesteds) / sizeof(ipp_orientation_requesteds[0]))))
+	  return (ipp_orientation_requesteds[enumvalue - 3]);
+        break;
+
+    case IPP_NAME_PRINT_QUALITY :
+    case IPP_NAME_PRINT_QUALITY_ACTUAL :
+    case IPP_NAME_PRINT_QUALITY_DEFAULT :
+    case IPP_NAME_PRINT_QUALITY_SUPPORTED :
+        if (enumvalue >= 3 && enumvalue < (3 + (int)(sizeof(ipp_print_qualities) / sizeof(ipp_print_qualities[0]))))
+	  return (ipp_print_qualities[enumvalue - 3]);
+        break;
+
+    case IPP_NAME_PRINTER_STATE :
+        if (enumvalue >= IPP_PSTATE_IDLE && enumvalue <= IPP_PSTATE_STOPPED)
+	  return (ipp_printer_states[enumvalue - IPP_PSTATE_IDLE]);
+        break;
+
+    case IPP_NAME_RESOURCE_STATE :
+        if (enumvalue >= IPP_RSTATE_PENDING && enumvalue <= IPP_RSTATE_ABORTED)
+	  return (ipp_resource_states[enumvalue - IPP_RSTATE_PENDING]);
+        break;
+
+    case IPP_NAME_SYSTEM_STATE :
+        if (enumvalue >= IPP_SSTATE_IDLE && enumvalue <= IPP_SSTATE_STOPPED)
+	  return (ipp_system_states[enumvalue - IPP_SSTATE_IDLE]);
+        break;
+
+    default :
+        break;
+  }
+
+ /*
+  * Not a standard enum value, just return the decimal equivalent...
+  */
+
+  snprintf(cg->ipp_unknown, sizeof(cg->ipp_unknown), "%d", enumvalue);
+  return (cg->ipp_unknown);
+}
+
+
+/*
+ * 'ipp_find_lookup()' - Find a string in a sorted lookup table.
+ *
+ * When a string appears more than once, the value that came first in the
+ * original table is returned, matching the old linear searches.
+ */
+
+static int				/* O - Value or -1 if not found */
+ipp_find_lookup(
+    ipp_lookup_t *table,		/* I - Sorted lookup table */
+    size_t       num_table,		/* I - Number of entries */
+    const char   *name,			/* I - String to find */
+    int          case_sensitive)	/* I - Compare case? */
+{
+  size_t	left,			/* Left side of search */
+		right,			/* Right side of search */
+		current;		/* Current entry */
+  int		result;			/* Result of comparison */
+
+
+  _cupsMutexLock(&ipp_lookup_mutex);
+  if (!ipp_lookup_ready)
+    ipp_init_lookups();
+  _cupsMutexUnlock(&ipp_lookup_mutex);
+
+ /*
+  * Binary search for the leftmost match...
+  */
+
+  left  = 0;
+  right = num_table;
+
+  while (left < right)
+  {
+    current = (left + right) / 2;
+    result  = case_sensitive ? strcmp(table[current].name, name) : _cups_strcasecmp(table[current].name, name);
+
+    if (result < 0)
+      left = current + 1;
+    else
+      right = current;
+  }
+
+  if (left < num_table && !(case_sensitive ? strcmp(table[left].name, name) : _cups_strcasecmp(table[left].name, name)))
+    return (table[left].value);
+  else
+    return (-1);
+}
+
+
+/*
+ * 'ipp_init_lookups()' - Build the sorted lookup tables.
+ *
+ * The order values reproduce the precedence of the old linear searches.
+ * Called with ipp_lookup_mutex held.
+ */
+
+static void
+ipp_init_lookups(void)
+{
+  size_t	i,			/* Looping var */
+		count;			/* Number of entries */
+
+
+ /*
+  * Finishings: vendor values first, then standard values...
+  */
+
+  for (i = 0, count = 0; i < (sizeof(ipp_finishings_vendor) / sizeof(ipp_finishings_vendor[0])); i ++, count ++)
+  {
+    ipp_finishings_lookup[count].name  = ipp_finishings_vendor[i];
+    ipp_finishings_lookup[count].value = (int)i + 0x40000000;
+    ipp_finishings_lookup[count].order = (int)count;
+  }
+
+  for (i = 0; i < (sizeof(ipp_finishings) / sizeof(ipp_finishings[0])); i ++, count ++)
+  {
+    ipp_finishings_lookup[count].name  = ipp_finishings[i];
+    ipp_finishings_lookup[count].value = (int)i + 3;
+    ipp_finishings_lookup[count].order = (int)count;
+  }
+
+  qsort(ipp_finishings_lookup, count, sizeof(ipp_lookup_t), (int (*)(const void *, const void *))ipp_compare_lookup);
+
+ /*
+  * Operations: standard, Microsoft, CUPS, then legacy aliases...
+  */
+
+  for (i = 0, count = 0; i < (sizeof(ipp_std_ops) / sizeof(ipp_std_ops[0])); i ++, count ++)
+  {
+    ipp_op_lookup[count].name  = ipp_std_ops[i];
+    ipp_op_lookup[count].value = (int)i;
+    ipp_op_lookup[count].order = (int)count;
+  }
+
+  ipp_op_lookup[count].name  = "windows-ext";
+  ipp_op_lookup[count].value = IPP_OP_PRIVATE;
+  ipp_op_lookup[count].order = (int)count;
+  count ++;
+
+  for (i = 0; i < (sizeof(ipp_cups_ops) / sizeof(ipp_cups_ops[0])); i ++, count ++)
+  {
+    ipp_op_lookup[count].name  = ipp_cups_ops[i];
+    ipp_op_lookup[count].value = (int)i + IPP_OP_CUPS_GET_DEFAULT;
+    ipp_op_lookup[count].order = (int)count;
+  }
+
+  for (i = 0; i < (sizeof(ipp_cups_ops2) / sizeof(ipp_cups_ops2[0])); i ++, count ++)
+  {
+    ipp_op_lookup[count].name  = ipp_cups_ops2[i];
+    ipp_op_lookup[count].value = (int)i + IPP_OP_CUPS_GET_DOCUMENT;
+    ipp_op_lookup[count].order = (int)count;
+  }
+
+  for (i = 0; i < (sizeof(ipp_op_aliases) / sizeof(ipp_op_aliases[0])); i ++, count ++)
+  {
+    ipp_op_lookup[count].name  = ipp_op_aliases[i].name;
+    ipp_op_lookup[count].value = ipp_op_aliases[i].value;
+    ipp_op_lookup[count].order = (int)count;
+  }
+
+  qsort(ipp_op_lookup, count, sizeof(ipp_lookup_t), (int (*)(const void *, const void *))ipp_compare_lookup_case);
+
+ /*
+  * Tags: standard names, then short aliases...
+  */
+
+  for (i = 0, count = 0; i < (sizeof(ipp_tag_names) / sizeof(ipp_tag_names[0])); i ++, count ++)
+  {
+    ipp_tag_lookup[count].name  = ipp_tag_names[i];
+    ipp_tag_lookup[count].value = (int)i;
+    ipp_tag_lookup[count].order = (int)count;
+  }
+
+  for (i = 0; i < (sizeof(ipp_tag_aliases) / sizeof(ipp_tag_aliases[0])); i ++, count ++)
+  {
+    ipp_tag_lookup[count].name  = ipp_tag_aliases[i].name;
+    ipp_tag_lookup[count].value = ipp_tag_aliases[i].value;
+    ipp_tag_lookup[count].order = (int)count;
+  }
+
+  qsort(ipp_tag_lookup, count, sizeof(ipp_lookup_t), (int (*)(const void *, const void *))ipp_compare_lookup_case);
+
+  ipp_lookup_ready = 1;
+}
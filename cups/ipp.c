@@ -27,21 +27,28 @@
 static ipp_attribute_t	*ipp_add_attr(ipp_t *ipp, const char *name,
 			              ipp_tag_t  group_tag, ipp_tag_t value_tag,
 			              int num_values);
+static int		ipp_alloc_values(int num_values);
+static void		*ipp_arena_alloc(ipp_t *ipp, size_t bytes);
 static void		ipp_free_values(ipp_attribute_t *attr, int element,
 			                int count);
 static char		*ipp_get_code(const char *locale, char *buffer, size_t bufsize) _CUPS_NONNULL(1,2);
+static void		ipp_index_clear(ipp_t *ipp);
+static _ipp_islot_t	*ipp_index_find(ipp_t *ipp, const char *name);
 static char		*ipp_lang_code(const char *locale, char *buffer, size_t bufsize) _CUPS_NONNULL(1,2);
 static size_t		ipp_length(ipp_t *ipp, int collection);
 static ssize_t		ipp_read_http(http_t *http, ipp_uchar_t *buffer,
 			              size_t length);
 static ssize_t		ipp_read_file(int *fd, ipp_uchar_t *buffer,
 			              size_t length);
+static ipp_state_t	ipp_read_io(void *src, ipp_iocb_t cb, int blocking, ipp_t *parent, ipp_t *ipp, int depth);
 static void		ipp_set_error(ipp_status_t status, const char *format,
 			              ...);
 static _ipp_value_t	*ipp_set_value(ipp_t *ipp, ipp_attribute_t **attr,
 			               int element);
+static ssize_t		ipp_write_buffer(_ipp_wbuffer_t *wbuffer, ipp_uchar_t *buffer, size_t length);
 static ssize_t		ipp_write_file(int *fd, ipp_uchar_t *buffer,
 			               size_t length);
+static ipp_state_t	ipp_write_io(void *dst, ipp_iocb_t cb, int blocking, ipp_t *parent, ipp_t *ipp);
 
 
 /*
@@ -95,6 +102,117 @@ _cupsBufferRelease(char *b)		/* I - Buffer to release */
 }
 
 
+/*
+ * '_ippMemoryUsed()' - Return the number of bytes allocated for an IPP message.
+ *
+ * The count includes the message, its attributes and values, collections,
+ * octetString data, and the attribute name index.  Strings are stored in the
+ * shared string pool and are not included.  Collections shared with other
+ * messages are divided between their references.
+ */
+
+size_t					/* O - Number of bytes */
+_ippMemoryUsed(ipp_t *ipp)		/* I - IPP message */
+{
+  size_t		bytes;		/* Number of bytes */
+  ipp_attribute_t	*attr;		/* Current attribute */
+  _ipp_value_t		*value;		/* Current value */
+  _ipp_arena_t		*arena;		/* Current arena block */
+  int			i;		/* Looping var */
+
+
+  if (!ipp)
+    return (0);
+
+  bytes = sizeof(ipp_t);
+
+  for (arena = ipp->arena; arena; arena = arena->next)
+    bytes += sizeof(_ipp_arena_t) - sizeof(double) + arena->size;
+
+  if (ipp->index)
+    bytes += sizeof(_ipp_index_t) + ipp->index->mask * sizeof(_ipp_islot_t);
+
+  for (attr = ipp->attrs; attr; attr = attr->next)
+  {
+    if (!ipp->use_arena)
+      bytes += sizeof(ipp_attribute_t) + (size_t)(attr->alloc_values - 1) * sizeof(_ipp_value_t);
+
+    if (attr->value_tag & IPP_TAG_CUPS_CONST)
+      continue;
+
+    switch (attr->value_tag)
+    {
+      case IPP_TAG_TEXTLANG :
+      case IPP_TAG_NAMELANG :
+      case IPP_TAG_TEXT :
+      case IPP_TAG_NAME :
+      case IPP_TAG_RESERVED_STRING :
+      case IPP_TAG_KEYWORD :
+      case IPP_TAG_URI :
+      case IPP_TAG_URISCHEME :
+      case IPP_TAG_CHARSET :
+      case IPP_TAG_LANGUAGE :
+      case IPP_TAG_MIMETYPE :
+      case IPP_TAG_UNSUPPORTED_VALUE :
+      case IPP_TAG_DEFAULT :
+      case IPP_TAG_UNKNOWN :
+      case IPP_TAG_NOVALUE :
+      case IPP_TAG_NOTSETTABLE :
+      case IPP_TAG_DELETEATTR :
+      case IPP_TAG_ADMINDEFINE :
+      case IPP_TAG_INTEGER :
+      case IPP_TAG_ENUM :
+      case IPP_TAG_BOOLEAN :
+      case IPP_TAG_DATE :
+      case IPP_TAG_RESOLUTION :
+      case IPP_TAG_RANGE :
+	  break;
+
+      case IPP_TAG_BEGIN_COLLECTION :
+	  for (i = attr->num_values, value = attr->values; i > 0; i --, value ++)
+	  {
+	    if (value->collection)
+	      bytes += _ippMemoryUsed(value->collection) / (size_t)(value->collection->use > 1 ? value->collection->use : 1);
+	  }
+	  break;
+
+      case IPP_TAG_STRING :
+      default :
+	  for (i = attr->num_values, value = attr->values; i > 0; i --, value ++)
+	  {
+	    if (value->unknown.data)
+	      bytes += (size_t)value->unknown.length;
+	  }
+	  break;
+    }
+  }
+
+  return (bytes);
+}
+
+
+/*
+ * '_ippNewArena()' - Allocate a new IPP message using arena memory.
+ *
+ * Attributes in the message are allocated from large blocks that are only
+ * freed by @link ippDelete@, which saves many small allocations for messages
+ * with a short lifetime such as server requests and responses.  Strings and
+ * collection values are allocated normally.
+ */
+
+ipp_t *					/* O - New IPP message */
+_ippNewArena(void)
+{
+  ipp_t	*temp;				/* New IPP message */
+
+
+  if ((temp = ippNew()) != NULL)
+    temp->use_arena = 1;
+
+  return (temp);
+}
+
+
 /*
  * 'ippAddBoolean()' - Add a boolean attribute to an IPP message.
  *
@@ -1464,6 +1582,11 @@ ippContainsString(
  * created - this should only be done as long as the original source IPP message will
  * not be freed for the life of the destination.
  *
+ * Otherwise string and collection values are shared with the source using
+ * reference counts, so the copy remains valid after the source is freed.
+ * Strings are never modified in place since setting a value replaces the
+ * reference, however a shared collection must not be changed.
+ *
  * @since CUPS 1.6/macOS 10.8@
  */
 
@@ -1543,15 +1666,24 @@ ippCopyAttribute(
 
 	  memcpy(dstattr->values, srcattr->values, (size_t)srcattr->num_values * sizeof(_ipp_value_t));
         }
-	else
+	else if (srcattr->value_tag & IPP_TAG_CUPS_CONST)
 	{
 	 /*
-	  * Otherwise do a normal reference counted copy...
+	  * Constant strings need to be added to the string pool...
 	  */
 
 	  for (i = srcattr->num_values, srcval = srcattr->values, dstval = dstattr->values; i > 0; i --, srcval ++, dstval ++)
 	    dstval->string.text = _cupsStrAlloc(srcval->string.text);
 	}
+	else
+	{
+	 /*
+	  * Otherwise share the pooled strings by reference...
+	  */
+
+	  for (i = srcattr->num_values, srcval = srcattr->values, dstval = dstattr->values; i > 0; i --, srcval ++, dstval ++)
+	    dstval->string.text = _cupsStrRetain(srcval->string.text);
+	}
         break;
 
     case IPP_TAG_TEXTLANG :
@@ -1570,7 +1702,7 @@ ippCopyAttribute(
 	else if (srcattr->value_tag & IPP_TAG_CUPS_CONST)
 	{
 	 /*
-	  * Otherwise do a normal reference counted copy...
+	  * Constant strings need to be added to the string pool...
 	  */
 
 	  for (i = srcattr->num_values, srcval = srcattr->values, dstval = dstattr->values; i > 0; i --, srcval ++, dstval ++)
@@ -1583,6 +1715,22 @@ ippCopyAttribute(
 	    dstval->string.text = _cupsStrAlloc(srcval->string.text);
           }
         }
+	else
+	{
+	 /*
+	  * Otherwise share the pooled strings by reference...
+	  */
+
+	  for (i = srcattr->num_values, srcval = srcattr->values, dstval = dstattr->values; i > 0; i --, srcval ++, dstval ++)
+	  {
+	    if (srcval == srcattr->values)
+              dstval->string.language = _cupsStrRetain(srcval->string.language);
+	    else
+              dstval->string.language = dstattr->values[0].string.language;
+
+	    dstval->string.text = _cupsStrRetain(srcval->string.text);
+          }
+	}
         break;
 
     case IPP_TAG_BEGIN_COLLECTION :
@@ -1757,9 +1905,20 @@ ippDelete(ipp_t *ipp)			/* I - IPP message */
     if (attr->name)
       _cupsStrFree(attr->name);
 
-    free(attr);
+    if (!ipp->use_arena)
+      free(attr);
+  }
+
+  while (ipp->arena)
+  {
+    _ipp_arena_t *arena = ipp->arena;	/* Current block */
+
+    ipp->arena = arena->next;
+    free(arena);
   }
 
+  ipp_index_clear(ipp);
+
   free(ipp);
 }
 
@@ -1813,6 +1972,7 @@ ippDeleteAttribute(
 	if (current == ipp->last)
 	  ipp->last = prev;
 
+        ipp_index_clear(ipp);
         break;
       }
 
@@ -1829,7 +1989,8 @@ ippDeleteAttribute(
   if (attr->name)
     _cupsStrFree(attr->name);
 
-  free(attr);
+  if (!ipp || !ipp->use_arena)
+    free(attr);
 }
 
 
@@ -1896,6 +2057,12 @@ ippFindAttribute(ipp_t      *ipp,	/* I - IPP message */
                  const char *name,	/* I - Name of attribute */
 		 ipp_tag_t  type)	/* I - Type of attribute */
 {
+  _ipp_islot_t		*slot;		/* Name index slot */
+  ipp_attribute_t	*attr,		/* Current attribute */
+			*prev;		/* Previous attribute */
+  ipp_tag_t		value_tag;	/* Value tag */
+
+
   DEBUG_printf(("2ippFindAttribute(ipp=%p, name=\"%s\", type=%02x(%s))", (void *)ipp, name, type, ippTagString(type)));
 
   if (!ipp || !name)
@@ -1908,6 +2075,35 @@ ippFindAttribute(ipp_t      *ipp,	/* I - IPP message */
   ipp->current = NULL;
   ipp->atend   = 0;
 
+ /*
+  * Use the name index for simple names, starting the search at the first
+  * attribute with that name...
+  */
+
+  if (!strchr(name, '/') && (slot = ipp_index_find(ipp, name)) != NULL)
+  {
+    for (attr = slot->attr, prev = slot->prev; attr; prev = attr, attr = attr->next)
+    {
+      value_tag = (ipp_tag_t)(attr->value_tag & IPP_TAG_CUPS_MASK);
+
+      if (attr->name != NULL && _cups_strcasecmp(attr->name, name) == 0 &&
+          (value_tag == type || type == IPP_TAG_ZERO ||
+	   (value_tag == IPP_TAG_TEXTLANG && type == IPP_TAG_TEXT) ||
+	   (value_tag == IPP_TAG_NAMELANG && type == IPP_TAG_NAME)))
+      {
+        ipp->current = attr;
+        ipp->prev    = prev;
+
+        return (attr);
+      }
+    }
+
+    ipp->prev  = NULL;
+    ipp->atend = 1;
+
+    return (NULL);
+  }
+
  /*
   * Search for the attribute...
   */
@@ -2257,6 +2453,35 @@ ippGetName(ipp_attribute_t *attr)	/* I - IPP attribute */
 }
 
 
+/*
+ * 'ippGetNameId()' - Get the well-known name ID of an attribute.
+ *
+ * The ID is assigned once when the name is first added to the string pool, so
+ * this is a constant-time alternative to comparing the attribute name against
+ * a list of strings.  Attribute names that are not listed in @code ipp_name_t@
+ * return @code IPP_NAME_UNKNOWN@.
+ *
+ * @since CUPS 2.3@
+ */
+
+ipp_name_t				/* O - Name ID or @code IPP_NAME_UNKNOWN@ */
+ippGetNameId(ipp_attribute_t *attr)	/* I - IPP attribute */
+{
+ /*
+  * Range check input...
+  */
+
+  if (!attr || !attr->name)
+    return (IPP_NAME_UNKNOWN);
+
+ /*
+  * Return the name ID...
+  */
+
+  return ((ipp_name_t)_cupsStrId(attr->name));
+}
+
+
 /*
  * 'ippGetOctetString()' - Get an octetString value from an IPP attribute.
  *
@@ -2713,7 +2938,7 @@ ippNewRequest(ipp_op_t op)		/* I - Operation code */
  * provided request message.  If the "attributes-charset" or
  * "attributes-natural-language" attributes are missing from the request,
  * 'utf-8' and a value derived from the current locale are substituted,
- * respectively.
+ * respectively.  The response uses arena memory if the request does.
  *
  * @since CUPS 1.7/macOS 10.9@
  */
@@ -2736,7 +2961,7 @@ ippNewResponse(ipp_t *request)		/* I - IPP request message */
   * Create a new IPP message...
   */
 
-  if ((response = ippNew()) == NULL)
+  if ((response = request->use_arena ? _ippNewArena() : ippNew()) == NULL)
     return (NULL);
 
  /*
@@ -2862,824 +3087,524 @@ ippReadIO(void       *src,		/* I - Data source */
 	  ipp_t      *parent,		/* I - Parent request, if any */
           ipp_t      *ipp)		/* I - IPP data */
 {
-  int			n;		/* Length of data */
-  unsigned char		*buffer,	/* Data buffer */
-			string[IPP_MAX_TEXT],
-					/* Small string buffer */
-			*bufptr;	/* Pointer into buffer */
-  ipp_attribute_t	*attr;		/* Current attribute */
-  ipp_tag_t		tag;		/* Current tag */
-  ipp_tag_t		value_tag;	/* Current value tag */
-  _ipp_value_t		*value;		/* Current value */
+  ipp_state_t	state;			/* Current state */
 
 
   DEBUG_printf(("ippReadIO(src=%p, cb=%p, blocking=%d, parent=%p, ipp=%p)", (void *)src, (void *)cb, blocking, (void *)parent, (void *)ipp));
   DEBUG_printf(("2ippReadIO: ipp->state=%d", ipp ? ipp->state : IPP_STATE_ERROR));
 
-  if (!src || !ipp)
-    return (IPP_STATE_ERROR);
+  _CUPS_TRACE2(ipp__read__start, ipp, ipp ? ipp->state : IPP_STATE_ERROR);
 
-  if ((buffer = (unsigned char *)_cupsBufferGet(IPP_BUF_SIZE)) == NULL)
-  {
-    DEBUG_puts("1ippReadIO: Unable to get read buffer.");
-    return (IPP_STATE_ERROR);
-  }
+  state = ipp_read_io(src, cb, blocking, parent, ipp, 0);
 
-  switch (ipp->state)
-  {
-    case IPP_STATE_IDLE :
-        ipp->state ++; /* Avoid common problem... */
+  _CUPS_TRACE2(ipp__read__end, ipp, state);
 
-    case IPP_STATE_HEADER :
-        if (parent == NULL)
-	{
-	 /*
-          * Get the request header...
-	  */
+  return (state);
+}
 
-          if ((*cb)(src, buffer, 8) < 8)
-	  {
-	    DEBUG_puts("1ippReadIO: Unable to read header.");
-	    _cupsBufferRelease((char *)buffer);
-	    return (IPP_STATE_ERROR);
-	  }
 
-	 /*
-          * Then copy the request header over...
-	  */
+/*
+ * 'ippReadNext()' - Read the next attribute value for an IPP message from a
+ *                   HTTP connection.
+ *
+ * This function reads one attribute value at a time so that callers can
+ * examine the request as it is decoded, for example to reject a request once
+ * the operation attributes have been read.  The state is
+ * @code IPP_STATE_ATTRIBUTE@ while attributes remain to be read,
+ * @code IPP_STATE_DATA@ once the message has been read, and
+ * @code IPP_STATE_ERROR@ on error.  The "attr" parameter is set to the
+ * attribute that was just read or @code NULL@ if no attribute was read.
+ *
+ * @since CUPS 2.3@
+ */
 
-          ipp->request.any.version[0]  = buffer[0];
-          ipp->request.any.version[1]  = buffer[1];
-          ipp->request.any.op_status   = (buffer[2] << 8) | buffer[3];
-          ipp->request.any.request_id  = (((((buffer[4] << 8) | buffer[5]) << 8) |
-	                        	 buffer[6]) << 8) | buffer[7];
+ipp_state_t				/* O - Current state */
+ippReadNext(http_t          *http,	/* I - HTTP connection */
+            ipp_t           *ipp,	/* I - IPP data */
+            ipp_attribute_t **attr)	/* O - Attribute read or @code NULL@ */
+{
+  ipp_state_t	state;			/* Current state */
 
-          DEBUG_printf(("2ippReadIO: version=%d.%d", buffer[0], buffer[1]));
-	  DEBUG_printf(("2ippReadIO: op_status=%04x",
-	                ipp->request.any.op_status));
-	  DEBUG_printf(("2ippReadIO: request_id=%d",
-	                ipp->request.any.request_id));
-        }
 
-        ipp->state   = IPP_STATE_ATTRIBUTE;
-	ipp->current = NULL;
-	ipp->curtag  = IPP_TAG_ZERO;
-	ipp->prev    = ipp->last;
+  DEBUG_printf(("ippReadNext(http=%p, ipp=%p, attr=%p)", (void *)http, (void *)ipp, (void *)attr));
 
-       /*
-        * If blocking is disabled, stop here...
-	*/
+  if (attr)
+    *attr = NULL;
 
-        if (!blocking)
-	  break;
+  if (!http || !ipp)
+    return (IPP_STATE_ERROR);
 
-    case IPP_STATE_ATTRIBUTE :
-        for (;;)
-	{
-	  if ((*cb)(src, buffer, 1) < 1)
-	  {
-	    DEBUG_puts("1ippReadIO: Callback returned EOF/error");
-	    _cupsBufferRelease((char *)buffer);
-	    return (IPP_STATE_ERROR);
-	  }
+  if ((state = ippReadIO(http, (ipp_iocb_t)ipp_read_http, 0, NULL, ipp)) == IPP_STATE_ATTRIBUTE && attr)
+    *attr = ipp->current;
 
-	  DEBUG_printf(("2ippReadIO: ipp->current=%p, ipp->prev=%p", (void *)ipp->current, (void *)ipp->prev));
+  return (state);
+}
 
-	 /*
-	  * Read this attribute...
-	  */
 
-          tag = (ipp_tag_t)buffer[0];
-          if (tag == IPP_TAG_EXTENSION)
-          {
-           /*
-            * Read 32-bit "extension" tag...
-            */
+/*
+ * 'ippSetBoolean()' - Set a boolean value in an attribute.
+ *
+ * The @code ipp@ parameter refers to an IPP message previously created using
+ * the @link ippNew@, @link ippNewRequest@, or  @link ippNewResponse@ functions.
+ *
+ * The @code attr@ parameter may be modified as a result of setting the value.
+ *
+ * The @code element@ parameter specifies which value to set from 0 to
+ * @code ippGetCount(attr)@.
+ *
+ * @since CUPS 1.6/macOS 10.8@
+ */
 
-	    if ((*cb)(src, buffer, 4) < 1)
-	    {
-	      DEBUG_puts("1ippReadIO: Callback returned EOF/error");
-	      _cupsBufferRelease((char *)buffer);
-	      return (IPP_STATE_ERROR);
-	    }
+int					/* O  - 1 on success, 0 on failure */
+ippSetBoolean(ipp_t           *ipp,	/* I  - IPP message */
+              ipp_attribute_t **attr,	/* IO - IPP attribute */
+              int             element,	/* I  - Value number (0-based) */
+              int             boolvalue)/* I  - Boolean value */
+{
+  _ipp_value_t	*value;			/* Current value */
 
-	    tag = (ipp_tag_t)((((((buffer[0] << 8) | buffer[1]) << 8) |
-	                        buffer[2]) << 8) | buffer[3]);
 
-            if (tag & IPP_TAG_CUPS_CONST)
-            {
-             /*
-              * Fail if the high bit is set in the tag...
-              */
+ /*
+  * Range check input...
+  */
 
-	      _cupsSetError(IPP_STATUS_ERROR_INTERNAL, _("IPP extension tag larger than 0x7FFFFFFF."), 1);
-	      DEBUG_printf(("1ippReadIO: bad tag 0x%x.", tag));
-	      _cupsBufferRelease((char *)buffer);
-	      return (IPP_STATE_ERROR);
-            }
-          }
+  if (!ipp || !attr || !*attr || (*attr)->value_tag != IPP_TAG_BOOLEAN ||
+      element < 0 || element > (*attr)->num_values)
+    return (0);
 
-	  if (tag == IPP_TAG_END)
-	  {
-	   /*
-	    * No more attributes left...
-	    */
+ /*
+  * Set the value and return...
+  */
 
-            DEBUG_puts("2ippReadIO: IPP_TAG_END.");
+  if ((value = ipp_set_value(ipp, attr, element)) != NULL)
+    value->boolean = (char)boolvalue;
 
-	    ipp->state = IPP_STATE_DATA;
-	    break;
-	  }
-	  else if (tag == IPP_TAG_ZERO || (tag == IPP_TAG_OPERATION && ipp->curtag != IPP_TAG_ZERO))
-	  {
-	    _cupsSetError(IPP_STATUS_ERROR_INTERNAL, _("Invalid group tag."), 1);
-	    DEBUG_printf(("1ippReadIO: bad tag 0x%02x.", tag));
-	    _cupsBufferRelease((char *)buffer);
-	    return (IPP_STATE_ERROR);
-	  }
-          else if (tag < IPP_TAG_UNSUPPORTED_VALUE)
-	  {
-	   /*
-	    * Group tag...  Set the current group and continue...
-	    */
+  return (value != NULL);
+}
 
-            if (ipp->curtag == tag)
-	      ipp->prev = ippAddSeparator(ipp);
-            else if (ipp->current)
-	      ipp->prev = ipp->current;
 
-	    ipp->curtag  = tag;
-	    ipp->current = NULL;
-	    DEBUG_printf(("2ippReadIO: group tag=%x(%s), ipp->prev=%p", tag, ippTagString(tag), (void *)ipp->prev));
-	    continue;
-	  }
+/*
+ * 'ippSetCollection()' - Set a collection value in an attribute.
+ *
+ * The @code ipp@ parameter refers to an IPP message previously created using
+ * the @link ippNew@, @link ippNewRequest@, or  @link ippNewResponse@ functions.
+ *
+ * The @code attr@ parameter may be modified as a result of setting the value.
+ *
+ * The @code element@ parameter specifies which value to set from 0 to
+ * @code ippGetCount(attr)@.
+ *
+ * @since CUPS 1.6/macOS 10.8@
+ */
 
-          DEBUG_printf(("2ippReadIO: value tag=%x(%s)", tag,
-	                ippTagString(tag)));
+int					/* O  - 1 on success, 0 on failure */
+ippSetCollection(
+    ipp_t           *ipp,		/* I  - IPP message */
+    ipp_attribute_t **attr,		/* IO - IPP attribute */
+    int             element,		/* I  - Value number (0-based) */
+    ipp_t           *colvalue)		/* I  - Collection value */
+{
+  _ipp_value_t	*value;			/* Current value */
 
-         /*
-	  * Get the name...
-	  */
 
-          if ((*cb)(src, buffer, 2) < 2)
-	  {
-	    DEBUG_puts("1ippReadIO: unable to read name length.");
-	    _cupsBufferRelease((char *)buffer);
-	    return (IPP_STATE_ERROR);
-	  }
+ /*
+  * Range check input...
+  */
 
-          n = (buffer[0] << 8) | buffer[1];
+  if (!ipp || !attr || !*attr || (*attr)->value_tag != IPP_TAG_BEGIN_COLLECTION ||
+      element < 0 || element > (*attr)->num_values || !colvalue)
+    return (0);
 
-          if (n >= IPP_BUF_SIZE)
-	  {
-	    _cupsSetError(IPP_STATUS_ERROR_INTERNAL, _("IPP name larger than 32767 bytes."), 1);
-	    DEBUG_printf(("1ippReadIO: bad name length %d.", n));
-	    _cupsBufferRelease((char *)buffer);
-	    return (IPP_STATE_ERROR);
-	  }
+ /*
+  * Set the value and return...
+  */
 
-          DEBUG_printf(("2ippReadIO: name length=%d", n));
+  if ((value = ipp_set_value(ipp, attr, element)) != NULL)
+  {
+    if (value->collection)
+      ippDelete(value->collection);
 
-          if (n && parent)
-          {
-            _cupsSetError(IPP_STATUS_ERROR_INTERNAL, _("Invalid named IPP attribute in collection."), 1);
-            DEBUG_puts("1ippReadIO: bad attribute name in collection.");
-            return (IPP_STATE_ERROR);
-          }
-          else if (n == 0 && tag != IPP_TAG_MEMBERNAME && tag != IPP_TAG_END_COLLECTION)
-	  {
-	   /*
-	    * More values for current attribute...
-	    */
+    value->collection = colvalue;
+    colvalue->use ++;
+  }
 
-            if (ipp->current == NULL)
-	    {
-	      _cupsSetError(IPP_STATUS_ERROR_INTERNAL, _("IPP attribute has no name."), 1);
-	      DEBUG_puts("1ippReadIO: Attribute without name and no current.");
-	      _cupsBufferRelease((char *)buffer);
-	      return (IPP_STATE_ERROR);
-	    }
+  return (value != NULL);
+}
 
-            attr      = ipp->current;
-	    value_tag = (ipp_tag_t)(attr->value_tag & IPP_TAG_CUPS_MASK);
 
-	   /*
-	    * Make sure we aren't adding a new value of a different
-	    * type...
-	    */
+/*
+ * 'ippSetDate()' - Set a dateTime value in an attribute.
+ *
+ * The @code ipp@ parameter refers to an IPP message previously created using
+ * the @link ippNew@, @link ippNewRequest@, or  @link ippNewResponse@ functions.
+ *
+ * The @code attr@ parameter may be modified as a result of setting the value.
+ *
+ * The @code element@ parameter specifies which value to set from 0 to
+ * @code ippGetCount(attr)@.
+ *
+ * @since CUPS 1.6/macOS 10.8@
+ */
 
-	    if (value_tag == IPP_TAG_ZERO)
-	    {
-	     /*
-	      * Setting the value of a collection member...
-	      */
+int					/* O  - 1 on success, 0 on failure */
+ippSetDate(ipp_t             *ipp,	/* I  - IPP message */
+           ipp_attribute_t   **attr,	/* IO - IPP attribute */
+           int               element,	/* I  - Value number (0-based) */
+           const ipp_uchar_t *datevalue)/* I  - dateTime value */
+{
+  _ipp_value_t	*value;			/* Current value */
 
-	      attr->value_tag = tag;
-	    }
-	    else if (value_tag == IPP_TAG_TEXTLANG ||
-	             value_tag == IPP_TAG_NAMELANG ||
-		     (value_tag >= IPP_TAG_TEXT &&
-		      value_tag <= IPP_TAG_MIMETYPE))
-            {
-	     /*
-	      * String values can sometimes come across in different
-	      * forms; accept sets of differing values...
-	      */
 
-	      if (tag != IPP_TAG_TEXTLANG && tag != IPP_TAG_NAMELANG &&
-	          (tag < IPP_TAG_TEXT || tag > IPP_TAG_MIMETYPE) &&
-		  tag != IPP_TAG_NOVALUE)
-	      {
-		_cupsSetError(IPP_STATUS_ERROR_INTERNAL,
-		              _("IPP 1setOf attribute with incompatible value "
-		                "tags."), 1);
-		DEBUG_printf(("1ippReadIO: 1setOf value tag %x(%s) != %x(%s)",
-			      value_tag, ippTagString(value_tag), tag,
-			      ippTagString(tag)));
-		_cupsBufferRelease((char *)buffer);
-	        return (IPP_STATE_ERROR);
-	      }
+ /*
+  * Range check input...
+  */
 
-              if (value_tag != tag)
-              {
-                DEBUG_printf(("1ippReadIO: Converting %s attribute from %s to %s.",
-                              attr->name, ippTagString(value_tag), ippTagString(tag)));
-		ippSetValueTag(ipp, &attr, tag);
-	      }
-            }
-	    else if (value_tag == IPP_TAG_INTEGER ||
-	             value_tag == IPP_TAG_RANGE)
-            {
-	     /*
-	      * Integer and rangeOfInteger values can sometimes be mixed; accept
-	      * sets of differing values...
-	      */
+  if (!ipp || !attr || !*attr || ((*attr)->value_tag != IPP_TAG_DATE && (*attr)->value_tag != IPP_TAG_NOVALUE && (*attr)->value_tag != IPP_TAG_UNKNOWN) || element < 0 || element > (*attr)->num_values || !datevalue)
+    return (0);
 
-	      if (tag != IPP_TAG_INTEGER && tag != IPP_TAG_RANGE)
-	      {
-		_cupsSetError(IPP_STATUS_ERROR_INTERNAL,
-		              _("IPP 1setOf attribute with incompatible value "
-		                "tags."), 1);
-		DEBUG_printf(("1ippReadIO: 1setOf value tag %x(%s) != %x(%s)",
-			      value_tag, ippTagString(value_tag), tag,
-			      ippTagString(tag)));
-		_cupsBufferRelease((char *)buffer);
-	        return (IPP_STATE_ERROR);
-	      }
+ /*
+  * Set the value and return...
+  */
 
-              if (value_tag == IPP_TAG_INTEGER && tag == IPP_TAG_RANGE)
-              {
-               /*
-                * Convert integer values to rangeOfInteger values...
-                */
+  if ((value = ipp_set_value(ipp, attr, element)) != NULL)
+    memcpy(value->date, datevalue, sizeof(value->date));
 
-		DEBUG_printf(("1ippReadIO: Converting %s attribute to "
-		              "rangeOfInteger.", attr->name));
-                ippSetValueTag(ipp, &attr, IPP_TAG_RANGE);
-              }
-            }
-	    else if (value_tag != tag)
-	    {
-	      _cupsSetError(IPP_STATUS_ERROR_INTERNAL,
-			    _("IPP 1setOf attribute with incompatible value "
-			      "tags."), 1);
-	      DEBUG_printf(("1ippReadIO: value tag %x(%s) != %x(%s)",
-	                    value_tag, ippTagString(value_tag), tag,
-			    ippTagString(tag)));
-	      _cupsBufferRelease((char *)buffer);
-	      return (IPP_STATE_ERROR);
-            }
+  return (value != NULL);
+}
 
-           /*
-	    * Finally, reallocate the attribute array as needed...
-	    */
 
-	    if ((value = ipp_set_value(ipp, &attr, attr->num_values)) == NULL)
-	    {
-	      _cupsBufferRelease((char *)buffer);
-	      return (IPP_STATE_ERROR);
-	    }
-	  }
-	  else if (tag == IPP_TAG_MEMBERNAME)
-	  {
-	   /*
-	    * Name must be length 0!
-	    */
+/*
+ * 'ippSetGroupTag()' - Set the group tag of an attribute.
+ *
+ * The @code ipp@ parameter refers to an IPP message previously created using
+ * the @link ippNew@, @link ippNewRequest@, or  @link ippNewResponse@ functions.
+ *
+ * The @code attr@ parameter may be modified as a result of setting the value.
+ *
+ * The @code group@ parameter specifies the IPP attribute group tag: none
+ * (@code IPP_TAG_ZERO@, for member attributes), document (@code IPP_TAG_DOCUMENT@),
+ * event notification (@code IPP_TAG_EVENT_NOTIFICATION@), operation
+ * (@code IPP_TAG_OPERATION@), printer (@code IPP_TAG_PRINTER@), subscription
+ * (@code IPP_TAG_SUBSCRIPTION@), or unsupported (@code IPP_TAG_UNSUPPORTED_GROUP@).
+ *
+ * @since CUPS 1.6/macOS 10.8@
+ */
 
-	    if (n)
-	    {
-	      _cupsSetError(IPP_STATUS_ERROR_INTERNAL, _("IPP member name is not empty."), 1);
-	      DEBUG_puts("1ippReadIO: member name not empty.");
-	      _cupsBufferRelease((char *)buffer);
-	      return (IPP_STATE_ERROR);
-	    }
+int					/* O  - 1 on success, 0 on failure */
+ippSetGroupTag(
+    ipp_t           *ipp,		/* I  - IPP message */
+    ipp_attribute_t **attr,		/* IO - Attribute */
+    ipp_tag_t       group_tag)		/* I  - Group tag */
+{
+ /*
+  * Range check input - group tag must be 0x01 to 0x0F, per RFC 8011...
+  */
 
-            if (ipp->current)
-	      ipp->prev = ipp->current;
+  if (!ipp || !attr || !*attr ||
+      group_tag < IPP_TAG_ZERO || group_tag == IPP_TAG_END ||
+      group_tag >= IPP_TAG_UNSUPPORTED_VALUE)
+    return (0);
 
-	    attr = ipp->current = ipp_add_attr(ipp, NULL, ipp->curtag, IPP_TAG_ZERO, 1);
-	    if (!attr)
-	    {
-	      _cupsSetHTTPError(HTTP_STATUS_ERROR);
-	      DEBUG_puts("1ippReadIO: unable to allocate attribute.");
-	      _cupsBufferRelease((char *)buffer);
-	      return (IPP_STATE_ERROR);
-	    }
+ /*
+  * Set the group tag and return...
+  */
 
-	    DEBUG_printf(("2ippReadIO: membername, ipp->current=%p, ipp->prev=%p", (void *)ipp->current, (void *)ipp->prev));
+  (*attr)->group_tag = group_tag;
 
-	    value = attr->values;
-	  }
-	  else if (tag != IPP_TAG_END_COLLECTION)
-	  {
-	   /*
-	    * New attribute; read the name and add it...
-	    */
+  return (1);
+}
 
-	    if ((*cb)(src, buffer, (size_t)n) < n)
-	    {
-	      DEBUG_puts("1ippReadIO: unable to read name.");
-	      _cupsBufferRelease((char *)buffer);
-	      return (IPP_STATE_ERROR);
-	    }
 
-	    buffer[n] = '\0';
+/*
+ * 'ippSetInteger()' - Set an integer or enum value in an attribute.
+ *
+ * The @code ipp@ parameter refers to an IPP message previously created using
+ * the @link ippNew@, @link ippNewRequest@, or  @link ippNewResponse@ functions.
+ *
+ * The @code attr@ parameter may be modified as a result of setting the value.
+ *
+ * The @code element@ parameter specifies which value to set from 0 to
+ * @code ippGetCount(attr)@.
+ *
+ * @since CUPS 1.6/macOS 10.8@
+ */
 
-            if (ipp->current)
-	      ipp->prev = ipp->current;
+int					/* O  - 1 on success, 0 on failure */
+ippSetInteger(ipp_t           *ipp,	/* I  - IPP message */
+              ipp_attribute_t **attr,	/* IO - IPP attribute */
+              int             element,	/* I  - Value number (0-based) */
+              int             intvalue)	/* I  - Integer/enum value */
+{
+  _ipp_value_t	*value;			/* Current value */
 
-	    if ((attr = ipp->current = ipp_add_attr(ipp, (char *)buffer, ipp->curtag, tag,
-	                                            1)) == NULL)
-	    {
-	      _cupsSetHTTPError(HTTP_STATUS_ERROR);
-	      DEBUG_puts("1ippReadIO: unable to allocate attribute.");
-	      _cupsBufferRelease((char *)buffer);
-	      return (IPP_STATE_ERROR);
-	    }
 
-	    DEBUG_printf(("2ippReadIO: name=\"%s\", ipp->current=%p, ipp->prev=%p", buffer, (void *)ipp->current, (void *)ipp->prev));
+ /*
+  * Range check input...
+  */
 
-	    value = attr->values;
-	  }
-	  else
-	  {
-	    attr  = NULL;
-	    value = NULL;
-	  }
+  if (!ipp || !attr || !*attr || ((*attr)->value_tag != IPP_TAG_INTEGER && (*attr)->value_tag != IPP_TAG_ENUM && (*attr)->value_tag != IPP_TAG_NOVALUE && (*attr)->value_tag != IPP_TAG_UNKNOWN) || element < 0 || element > (*attr)->num_values)
+    return (0);
 
-	  if ((*cb)(src, buffer, 2) < 2)
-	  {
-	    DEBUG_puts("1ippReadIO: unable to read value length.");
-	    _cupsBufferRelease((char *)buffer);
-	    return (IPP_STATE_ERROR);
-	  }
+ /*
+  * Set the value and return...
+  */
 
-	  n = (buffer[0] << 8) | buffer[1];
-          DEBUG_printf(("2ippReadIO: value length=%d", n));
+  if ((value = ipp_set_value(ipp, attr, element)) != NULL)
+  {
+    if ((*attr)->value_tag != IPP_TAG_ENUM)
+      (*attr)->value_tag = IPP_TAG_INTEGER;
 
-	  if (n >= IPP_BUF_SIZE)
-	  {
-	    _cupsSetError(IPP_STATUS_ERROR_INTERNAL,
-			  _("IPP value larger than 32767 bytes."), 1);
-	    DEBUG_printf(("1ippReadIO: bad value length %d.", n));
-	    _cupsBufferRelease((char *)buffer);
-	    return (IPP_STATE_ERROR);
-	  }
+    value->integer = intvalue;
+  }
 
-	  switch (tag)
-	  {
-	    case IPP_TAG_INTEGER :
-	    case IPP_TAG_ENUM :
-		if (n != 4)
-		{
-		  if (tag == IPP_TAG_INTEGER)
-		    _cupsSetError(IPP_STATUS_ERROR_INTERNAL,
-				  _("IPP integer value not 4 bytes."), 1);
-		  else
-		    _cupsSetError(IPP_STATUS_ERROR_INTERNAL,
-				  _("IPP enum value not 4 bytes."), 1);
-		  DEBUG_printf(("1ippReadIO: bad integer value length %d.", n));
-		  _cupsBufferRelease((char *)buffer);
-		  return (IPP_STATE_ERROR);
-		}
+  return (value != NULL);
+}
 
-	        if ((*cb)(src, buffer, 4) < 4)
-		{
-	          DEBUG_puts("1ippReadIO: Unable to read integer value.");
-		  _cupsBufferRelease((char *)buffer);
-		  return (IPP_STATE_ERROR);
-		}
 
-		n = (((((buffer[0] << 8) | buffer[1]) << 8) | buffer[2]) << 8) |
-		    buffer[3];
+/*
+ * 'ippSetName()' - Set the name of an attribute.
+ *
+ * The @code ipp@ parameter refers to an IPP message previously created using
+ * the @link ippNew@, @link ippNewRequest@, or  @link ippNewResponse@ functions.
+ *
+ * The @code attr@ parameter may be modified as a result of setting the value.
+ *
+ * @since CUPS 1.6/macOS 10.8@
+ */
 
-                if (attr->value_tag == IPP_TAG_RANGE)
-                  value->range.lower = value->range.upper = n;
-                else
-		  value->integer = n;
-	        break;
+int					/* O  - 1 on success, 0 on failure */
+ippSetName(ipp_t           *ipp,	/* I  - IPP message */
+	   ipp_attribute_t **attr,	/* IO - IPP attribute */
+	   const char      *name)	/* I  - Attribute name */
+{
+  char	*temp;				/* Temporary name value */
 
-	    case IPP_TAG_BOOLEAN :
-		if (n != 1)
-		{
-		  _cupsSetError(IPP_STATUS_ERROR_INTERNAL, _("IPP boolean value not 1 byte."),
-		                1);
-		  DEBUG_printf(("1ippReadIO: bad boolean value length %d.", n));
-		  _cupsBufferRelease((char *)buffer);
-		  return (IPP_STATE_ERROR);
-		}
 
-	        if ((*cb)(src, buffer, 1) < 1)
-		{
-	          DEBUG_puts("1ippReadIO: Unable to read boolean value.");
-		  _cupsBufferRelease((char *)buffer);
-		  return (IPP_STATE_ERROR);
-		}
+ /*
+  * Range check input...
+  */
 
-                value->boolean = (char)buffer[0];
-	        break;
+  if (!ipp || !attr || !*attr)
+    return (0);
 
-	    case IPP_TAG_UNSUPPORTED_VALUE :
-	    case IPP_TAG_DEFAULT :
-	    case IPP_TAG_UNKNOWN :
-	    case IPP_TAG_NOVALUE :
-	    case IPP_TAG_NOTSETTABLE :
-	    case IPP_TAG_DELETEATTR :
-	    case IPP_TAG_ADMINDEFINE :
-	       /*
-	        * These value types are not supposed to have values, however
-		* some vendors (Brother) do not implement IPP correctly and so
-		* we need to map non-empty values to text...
-		*/
+ /*
+  * Set the value and return...
+  */
 
-	        if (attr->value_tag == tag)
-		{
-		  if (n == 0)
-		    break;
+  if ((temp = _cupsStrAlloc(name)) != NULL)
+  {
+    if ((*attr)->name)
+      _cupsStrFree((*attr)->name);
 
-		  attr->value_tag = IPP_TAG_TEXT;
-		}
+    (*attr)->name = temp;
 
-	    case IPP_TAG_TEXT :
-	    case IPP_TAG_NAME :
-	    case IPP_TAG_RESERVED_STRING :
-	    case IPP_TAG_KEYWORD :
-	    case IPP_TAG_URI :
-	    case IPP_TAG_URISCHEME :
-	    case IPP_TAG_CHARSET :
-	    case IPP_TAG_LANGUAGE :
-	    case IPP_TAG_MIMETYPE :
-	        if (n > 0)
-	        {
-		  if ((*cb)(src, buffer, (size_t)n) < n)
-		  {
-		    DEBUG_puts("1ippReadIO: unable to read string value.");
-		    _cupsBufferRelease((char *)buffer);
-		    return (IPP_STATE_ERROR);
-		  }
-		}
+    ipp_index_clear(ipp);
+  }
 
-		buffer[n] = '\0';
-		value->string.text = _cupsStrAlloc((char *)buffer);
-		DEBUG_printf(("2ippReadIO: value=\"%s\"", value->string.text));
-	        break;
+  return (temp != NULL);
+}
 
-	    case IPP_TAG_DATE :
-		if (n != 11)
-		{
-		  _cupsSetError(IPP_STATUS_ERROR_INTERNAL, _("IPP date value not 11 bytes."), 1);
-		  DEBUG_printf(("1ippReadIO: bad date value length %d.", n));
-		  _cupsBufferRelease((char *)buffer);
-		  return (IPP_STATE_ERROR);
-		}
 
-	        if ((*cb)(src, value->date, 11) < 11)
-		{
-	          DEBUG_puts("1ippReadIO: Unable to read date value.");
-		  _cupsBufferRelease((char *)buffer);
-		  return (IPP_STATE_ERROR);
-		}
-	        break;
+/*
+ * 'ippSetOctetString()' - Set an octetString value in an IPP attribute.
+ *
+ * The @code ipp@ parameter refers to an IPP message previously created using
+ * the @link ippNew@, @link ippNewRequest@, or  @link ippNewResponse@ functions.
+ *
+ * The @code attr@ parameter may be modified as a result of setting the value.
+ *
+ * The @code element@ parameter specifies which value to set from 0 to
+ * @code ippGetCount(attr)@.
+ *
+ * @since CUPS 1.7/macOS 10.9@
+ */
 
-	    case IPP_TAG_RESOLUTION :
-		if (n != 9)
-		{
-		  _cupsSetError(IPP_STATUS_ERROR_INTERNAL,
-		                _("IPP resolution value not 9 bytes."), 1);
-		  DEBUG_printf(("1ippReadIO: bad resolution value length %d.", n));
-		  _cupsBufferRelease((char *)buffer);
-		  return (IPP_STATE_ERROR);
-		}
+int					/* O  - 1 on success, 0 on failure */
+ippSetOctetString(
+    ipp_t           *ipp,		/* I  - IPP message */
+    ipp_attribute_t **attr,		/* IO - IPP attribute */
+    int             element,		/* I  - Value number (0-based) */
+    const void      *data,		/* I  - Pointer to octetString data */
+    int             datalen)		/* I  - Length of octetString data */
+{
+  _ipp_value_t	*value;			/* Current value */
 
-	        if ((*cb)(src, buffer, 9) < 9)
-		{
-	          DEBUG_puts("1ippReadIO: Unable to read resolution value.");
-		  _cupsBufferRelease((char *)buffer);
-		  return (IPP_STATE_ERROR);
-		}
 
-                value->resolution.xres =
-		    (((((buffer[0] << 8) | buffer[1]) << 8) | buffer[2]) << 8) |
-		    buffer[3];
-                value->resolution.yres =
-		    (((((buffer[4] << 8) | buffer[5]) << 8) | buffer[6]) << 8) |
-		    buffer[7];
-                value->resolution.units =
-		    (ipp_res_t)buffer[8];
-	        break;
+ /*
+  * Range check input...
+  */
 
-	    case IPP_TAG_RANGE :
-		if (n != 8)
-		{
-		  _cupsSetError(IPP_STATUS_ERROR_INTERNAL,
-		                _("IPP rangeOfInteger value not 8 bytes."), 1);
-		  DEBUG_printf(("1ippReadIO: bad rangeOfInteger value length "
-		                "%d.", n));
-		  _cupsBufferRelease((char *)buffer);
-		  return (IPP_STATE_ERROR);
-		}
+  if (!ipp || !attr || !*attr || ((*attr)->value_tag != IPP_TAG_STRING && (*attr)->value_tag != IPP_TAG_NOVALUE && (*attr)->value_tag != IPP_TAG_UNKNOWN) || element < 0 || element > (*attr)->num_values || datalen < 0 || datalen > IPP_MAX_LENGTH)
+    return (0);
 
-	        if ((*cb)(src, buffer, 8) < 8)
-		{
-	          DEBUG_puts("1ippReadIO: Unable to read range value.");
-		  _cupsBufferRelease((char *)buffer);
-		  return (IPP_STATE_ERROR);
-		}
+ /*
+  * Set the value and return...
+  */
 
-                value->range.lower =
-		    (((((buffer[0] << 8) | buffer[1]) << 8) | buffer[2]) << 8) |
-		    buffer[3];
-                value->range.upper =
-		    (((((buffer[4] << 8) | buffer[5]) << 8) | buffer[6]) << 8) |
-		    buffer[7];
-	        break;
+  if ((value = ipp_set_value(ipp, attr, element)) != NULL)
+  {
+    if ((int)((*attr)->value_tag) & IPP_TAG_CUPS_CONST)
+    {
+     /*
+      * Just copy the pointer...
+      */
 
-	    case IPP_TAG_TEXTLANG :
-	    case IPP_TAG_NAMELANG :
-	        if (n < 4)
-		{
-		  if (tag == IPP_TAG_TEXTLANG)
-		    _cupsSetError(IPP_STATUS_ERROR_INTERNAL,
-		                  _("IPP textWithLanguage value less than "
-		                    "minimum 4 bytes."), 1);
-		  else
-		    _cupsSetError(IPP_STATUS_ERROR_INTERNAL,
-		                  _("IPP nameWithLanguage value less than "
-		                    "minimum 4 bytes."), 1);
-		  DEBUG_printf(("1ippReadIO: bad stringWithLanguage value "
-		                "length %d.", n));
-		  _cupsBufferRelease((char *)buffer);
-		  return (IPP_STATE_ERROR);
-		}
+      value->unknown.data   = (void *)data;
+      value->unknown.length = datalen;
+    }
+    else
+    {
+     /*
+      * Copy the data...
+      */
 
-	        if ((*cb)(src, buffer, (size_t)n) < n)
-		{
-	          DEBUG_puts("1ippReadIO: Unable to read string w/language "
-		             "value.");
-		  _cupsBufferRelease((char *)buffer);
-		  return (IPP_STATE_ERROR);
-		}
+      (*attr)->value_tag = IPP_TAG_STRING;
 
-                bufptr = buffer;
+      if (value->unknown.data)
+      {
+       /*
+	* Free previous data...
+	*/
 
-	       /*
-	        * text-with-language and name-with-language are composite
-		* values:
-		*
-		*    language-length
-		*    language
-		*    text-length
-		*    text
-		*/
+	free(value->unknown.data);
 
-		n = (bufptr[0] << 8) | bufptr[1];
+	value->unknown.data   = NULL;
+        value->unknown.length = 0;
+      }
 
-		if ((bufptr + 2 + n) >= (buffer + IPP_BUF_SIZE) || n >= (int)sizeof(string))
-		{
-		  _cupsSetError(IPP_STATUS_ERROR_INTERNAL,
-		                _("IPP language length overflows value."), 1);
-		  DEBUG_printf(("1ippReadIO: bad language value length %d.",
-		                n));
-		  _cupsBufferRelease((char *)buffer);
-		  return (IPP_STATE_ERROR);
-		}
-		else if (n >= IPP_MAX_LANGUAGE)
-		{
-		  _cupsSetError(IPP_STATUS_ERROR_INTERNAL,
-		                _("IPP language length too large."), 1);
-		  DEBUG_printf(("1ippReadIO: bad language value length %d.",
-		                n));
-		  _cupsBufferRelease((char *)buffer);
-		  return (IPP_STATE_ERROR);
-		}
+      if (datalen > 0)
+      {
+	void	*temp;			/* Temporary data pointer */
 
-		memcpy(string, bufptr + 2, (size_t)n);
-		string[n] = '\0';
+	if ((temp = malloc((size_t)datalen)) != NULL)
+	{
+	  memcpy(temp, data, (size_t)datalen);
 
-		value->string.language = _cupsStrAlloc((char *)string);
+	  value->unknown.data   = temp;
+	  value->unknown.length = datalen;
+	}
+	else
+	  return (0);
+      }
+    }
+  }
 
-                bufptr += 2 + n;
-		n = (bufptr[0] << 8) | bufptr[1];
+  return (value != NULL);
+}
 
-		if ((bufptr + 2 + n) >= (buffer + IPP_BUF_SIZE))
-		{
-		  _cupsSetError(IPP_STATUS_ERROR_INTERNAL,
-		                _("IPP string length overflows value."), 1);
-		  DEBUG_printf(("1ippReadIO: bad string value length %d.", n));
-		  _cupsBufferRelease((char *)buffer);
-		  return (IPP_STATE_ERROR);
-		}
 
-		bufptr[2 + n] = '\0';
-                value->string.text = _cupsStrAlloc((char *)bufptr + 2);
-	        break;
+/*
+ * 'ippSetOperation()' - Set the operation ID in an IPP request message.
+ *
+ * The @code ipp@ parameter refers to an IPP message previously created using
+ * the @link ippNew@, @link ippNewRequest@, or  @link ippNewResponse@ functions.
+ *
+ * @since CUPS 1.6/macOS 10.8@
+ */
 
-            case IPP_TAG_BEGIN_COLLECTION :
-	       /*
-	        * Oh, boy, here comes a collection value, so read it...
-		*/
+int					/* O - 1 on success, 0 on failure */
+ippSetOperation(ipp_t    *ipp,		/* I - IPP request message */
+                ipp_op_t op)		/* I - Operation ID */
+{
+ /*
+  * Range check input...
+  */
 
-                value->collection = ippNew();
+  if (!ipp)
+    return (0);
 
-                if (n > 0)
-		{
-		  _cupsSetError(IPP_STATUS_ERROR_INTERNAL,
-		                _("IPP begCollection value not 0 bytes."), 1);
-	          DEBUG_puts("1ippReadIO: begCollection tag with value length "
-		             "> 0.");
-		  _cupsBufferRelease((char *)buffer);
-		  return (IPP_STATE_ERROR);
-		}
+ /*
+  * Set the operation and return...
+  */
 
-		if (ippReadIO(src, cb, 1, ipp, value->collection) == IPP_STATE_ERROR)
-		{
-	          DEBUG_puts("1ippReadIO: Unable to read collection value.");
-		  _cupsBufferRelease((char *)buffer);
-		  return (IPP_STATE_ERROR);
-		}
-                break;
+  ipp->request.op.operation_id = op;
 
-            case IPP_TAG_END_COLLECTION :
-		_cupsBufferRelease((char *)buffer);
+  return (1);
+}
 
-                if (n > 0)
-		{
-		  _cupsSetError(IPP_STATUS_ERROR_INTERNAL,
-		                _("IPP endCollection value not 0 bytes."), 1);
-	          DEBUG_puts("1ippReadIO: endCollection tag with value length "
-		             "> 0.");
-		  return (IPP_STATE_ERROR);
-		}
 
-	        DEBUG_puts("1ippReadIO: endCollection tag...");
-		return (ipp->state = IPP_STATE_DATA);
+/*
+ * 'ippSetRange()' - Set a rangeOfInteger value in an attribute.
+ *
+ * The @code ipp@ parameter refers to an IPP message previously created using
+ * the @link ippNew@, @link ippNewRequest@, or  @link ippNewResponse@ functions.
+ *
+ * The @code attr@ parameter may be modified as a result of setting the value.
+ *
+ * The @code element@ parameter specifies which value to set from 0 to
+ * @code ippGetCount(attr)@.
+ *
+ * @since CUPS 1.6/macOS 10.8@
+ */
 
-            case IPP_TAG_MEMBERNAME :
-	       /*
-	        * The value the name of the member in the collection, which
-		* we need to carry over...
-		*/
+int					/* O  - 1 on success, 0 on failure */
+ippSetRange(ipp_t           *ipp,	/* I  - IPP message */
+            ipp_attribute_t **attr,	/* IO - IPP attribute */
+            int             element,	/* I  - Value number (0-based) */
+	    int             lowervalue,	/* I  - Lower bound for range */
+	    int             uppervalue)	/* I  - Upper bound for range */
+{
+  _ipp_value_t	*value;			/* Current value */
 
-                if (!attr)
-                {
-		  _cupsSetError(IPP_STATUS_ERROR_INTERNAL,
-		                _("IPP memberName with no attribute."), 1);
-	          DEBUG_puts("1ippReadIO: Member name without attribute.");
-		  _cupsBufferRelease((char *)buffer);
-		  return (IPP_STATE_ERROR);
-                }
-		else if (n == 0)
-		{
-		  _cupsSetError(IPP_STATUS_ERROR_INTERNAL,
-		                _("IPP memberName value is empty."), 1);
-	          DEBUG_puts("1ippReadIO: Empty member name value.");
-		  _cupsBufferRelease((char *)buffer);
-		  return (IPP_STATE_ERROR);
-		}
-		else if ((*cb)(src, buffer, (size_t)n) < n)
-		{
-	          DEBUG_puts("1ippReadIO: Unable to read member name value.");
-		  _cupsBufferRelease((char *)buffer);
-		  return (IPP_STATE_ERROR);
-		}
 
-		buffer[n] = '\0';
-		attr->name = _cupsStrAlloc((char *)buffer);
-
-               /*
-	        * Since collection members are encoded differently than
-		* regular attributes, make sure we don't start with an
-		* empty value...
-		*/
-
-                attr->num_values --;
-
-		DEBUG_printf(("2ippReadIO: member name=\"%s\"", attr->name));
-		break;
-
-            case IPP_TAG_STRING :
-            default : /* Other unsupported values */
-                if (tag == IPP_TAG_STRING && n > IPP_MAX_LENGTH)
-		{
-		  _cupsSetError(IPP_STATUS_ERROR_INTERNAL,
-		                _("IPP octetString length too large."), 1);
-		  DEBUG_printf(("1ippReadIO: bad octetString value length %d.",
-		                n));
-		  _cupsBufferRelease((char *)buffer);
-		  return (IPP_STATE_ERROR);
-		}
-
-                value->unknown.length = n;
-
-	        if (n > 0)
-		{
-		  if ((value->unknown.data = malloc((size_t)n)) == NULL)
-		  {
-		    _cupsSetHTTPError(HTTP_STATUS_ERROR);
-		    DEBUG_puts("1ippReadIO: Unable to allocate value");
-		    _cupsBufferRelease((char *)buffer);
-		    return (IPP_STATE_ERROR);
-		  }
-
-	          if ((*cb)(src, value->unknown.data, (size_t)n) < n)
-		  {
-	            DEBUG_puts("1ippReadIO: Unable to read unsupported value.");
-		    _cupsBufferRelease((char *)buffer);
-		    return (IPP_STATE_ERROR);
-		  }
-		}
-		else
-		  value->unknown.data = NULL;
-	        break;
-	  }
-
-	 /*
-          * If blocking is disabled, stop here...
-	  */
+ /*
+  * Range check input...
+  */
 
-          if (!blocking)
-	    break;
-	}
-        break;
+  if (!ipp || !attr || !*attr || ((*attr)->value_tag != IPP_TAG_RANGE && (*attr)->value_tag != IPP_TAG_NOVALUE && (*attr)->value_tag != IPP_TAG_UNKNOWN) || element < 0 || element > (*attr)->num_values || lowervalue > uppervalue)
+    return (0);
 
-    case IPP_STATE_DATA :
-        break;
+ /*
+  * Set the value and return...
+  */
 
-    default :
-        break; /* anti-compiler-warning-code */
+  if ((value = ipp_set_value(ipp, attr, element)) != NULL)
+  {
+    (*attr)->value_tag = IPP_TAG_RANGE;
+    value->range.lower = lowervalue;
+    value->range.upper = uppervalue;
   }
 
-  DEBUG_printf(("1ippReadIO: returning ipp->state=%d.", ipp->state));
-  _cupsBufferRelease((char *)buffer);
-
-  return (ipp->state);
+  return (value != NULL);
 }
 
 
 /*
- * 'ippSetBoolean()' - Set a boolean value in an attribute.
+ * 'ippSetRequestId()' - Set the request ID in an IPP message.
  *
  * The @code ipp@ parameter refers to an IPP message previously created using
  * the @link ippNew@, @link ippNewRequest@, or  @link ippNewResponse@ functions.
  *
- * The @code attr@ parameter may be modified as a result of setting the value.
- *
- * The @code element@ parameter specifies which value to set from 0 to
- * @code ippGetCount(attr)@.
+ * The @code request_id@ parameter must be greater than 0.
  *
  * @since CUPS 1.6/macOS 10.8@
  */
 
-int					/* O  - 1 on success, 0 on failure */
-ippSetBoolean(ipp_t           *ipp,	/* I  - IPP message */
-              ipp_attribute_t **attr,	/* IO - IPP attribute */
-              int             element,	/* I  - Value number (0-based) */
-              int             boolvalue)/* I  - Boolean value */
+int					/* O - 1 on success, 0 on failure */
+ippSetRequestId(ipp_t *ipp,		/* I - IPP message */
+                int   request_id)	/* I - Request ID */
 {
-  _ipp_value_t	*value;			/* Current value */
-
-
  /*
-  * Range check input...
+  * Range check input; not checking request_id values since ipptool wants to send
+  * invalid values for conformance testing and a bad request_id does not affect the
+  * encoding of a message...
   */
 
-  if (!ipp || !attr || !*attr || (*attr)->value_tag != IPP_TAG_BOOLEAN ||
-      element < 0 || element > (*attr)->num_values)
+  if (!ipp)
     return (0);
 
  /*
-  * Set the value and return...
+  * Set the request ID and return...
   */
 
-  if ((value = ipp_set_value(ipp, attr, element)) != NULL)
-    value->boolean = (char)boolvalue;
+  ipp->request.any.request_id = request_id;
 
-  return (value != NULL);
+  return (1);
 }
 
 
 /*
- * 'ippSetCollection()' - Set a collection value in an attribute.
+ * 'ippSetResolution()' - Set a resolution value in an attribute.
  *
  * The @code ipp@ parameter refers to an IPP message previously created using
  * the @link ippNew@, @link ippNewRequest@, or  @link ippNewResponse@ functions.
@@ -3693,11 +3618,13 @@ ippSetBoolean(ipp_t           *ipp,	/* I  - IPP message */
  */
 
 int					/* O  - 1 on success, 0 on failure */
-ippSetCollection(
+ippSetResolution(
     ipp_t           *ipp,		/* I  - IPP message */
     ipp_attribute_t **attr,		/* IO - IPP attribute */
     int             element,		/* I  - Value number (0-based) */
-    ipp_t           *colvalue)		/* I  - Collection value */
+    ipp_res_t       unitsvalue,		/* I  - Resolution units */
+    int             xresvalue,		/* I  - Horizontal/cross feed resolution */
+    int             yresvalue)		/* I  - Vertical/feed resolution */
 {
   _ipp_value_t	*value;			/* Current value */
 
@@ -3706,8 +3633,7 @@ ippSetCollection(
   * Range check input...
   */
 
-  if (!ipp || !attr || !*attr || (*attr)->value_tag != IPP_TAG_BEGIN_COLLECTION ||
-      element < 0 || element > (*attr)->num_values || !colvalue)
+  if (!ipp || !attr || !*attr || ((*attr)->value_tag != IPP_TAG_RESOLUTION && (*attr)->value_tag != IPP_TAG_NOVALUE && (*attr)->value_tag != IPP_TAG_UNKNOWN) || element < 0 || element > (*attr)->num_values || xresvalue <= 0 || yresvalue <= 0 || unitsvalue < IPP_RES_PER_INCH || unitsvalue > IPP_RES_PER_CM)
     return (0);
 
  /*
@@ -3716,11 +3642,10 @@ ippSetCollection(
 
   if ((value = ipp_set_value(ipp, attr, element)) != NULL)
   {
-    if (value->collection)
-      ippDelete(value->collection);
-
-    value->collection = colvalue;
-    colvalue->use ++;
+    (*attr)->value_tag      = IPP_TAG_RESOLUTION;
+    value->resolution.units = unitsvalue;
+    value->resolution.xres  = xresvalue;
+    value->resolution.yres  = yresvalue;
   }
 
   return (value != NULL);
@@ -3728,90 +3653,65 @@ ippSetCollection(
 
 
 /*
- * 'ippSetDate()' - Set a dateTime value in an attribute.
- *
- * The @code ipp@ parameter refers to an IPP message previously created using
- * the @link ippNew@, @link ippNewRequest@, or  @link ippNewResponse@ functions.
- *
- * The @code attr@ parameter may be modified as a result of setting the value.
- *
- * The @code element@ parameter specifies which value to set from 0 to
- * @code ippGetCount(attr)@.
+ * 'ippSetState()' - Set the current state of the IPP message.
  *
  * @since CUPS 1.6/macOS 10.8@
  */
 
-int					/* O  - 1 on success, 0 on failure */
-ippSetDate(ipp_t             *ipp,	/* I  - IPP message */
-           ipp_attribute_t   **attr,	/* IO - IPP attribute */
-           int               element,	/* I  - Value number (0-based) */
-           const ipp_uchar_t *datevalue)/* I  - dateTime value */
+int					/* O - 1 on success, 0 on failure */
+ippSetState(ipp_t       *ipp,		/* I - IPP message */
+            ipp_state_t state)		/* I - IPP state value */
 {
-  _ipp_value_t	*value;			/* Current value */
-
-
  /*
   * Range check input...
   */
 
-  if (!ipp || !attr || !*attr || ((*attr)->value_tag != IPP_TAG_DATE && (*attr)->value_tag != IPP_TAG_NOVALUE && (*attr)->value_tag != IPP_TAG_UNKNOWN) || element < 0 || element > (*attr)->num_values || !datevalue)
+  if (!ipp)
     return (0);
 
  /*
-  * Set the value and return...
+  * Set the state and return...
   */
 
-  if ((value = ipp_set_value(ipp, attr, element)) != NULL)
-    memcpy(value->date, datevalue, sizeof(value->date));
+  ipp->state   = state;
+  ipp->current = NULL;
 
-  return (value != NULL);
+  return (1);
 }
 
 
 /*
- * 'ippSetGroupTag()' - Set the group tag of an attribute.
+ * 'ippSetStatusCode()' - Set the status code in an IPP response or event message.
  *
  * The @code ipp@ parameter refers to an IPP message previously created using
  * the @link ippNew@, @link ippNewRequest@, or  @link ippNewResponse@ functions.
  *
- * The @code attr@ parameter may be modified as a result of setting the value.
- *
- * The @code group@ parameter specifies the IPP attribute group tag: none
- * (@code IPP_TAG_ZERO@, for member attributes), document (@code IPP_TAG_DOCUMENT@),
- * event notification (@code IPP_TAG_EVENT_NOTIFICATION@), operation
- * (@code IPP_TAG_OPERATION@), printer (@code IPP_TAG_PRINTER@), subscription
- * (@code IPP_TAG_SUBSCRIPTION@), or unsupported (@code IPP_TAG_UNSUPPORTED_GROUP@).
- *
  * @since CUPS 1.6/macOS 10.8@
  */
 
-int					/* O  - 1 on success, 0 on failure */
-ippSetGroupTag(
-    ipp_t           *ipp,		/* I  - IPP message */
-    ipp_attribute_t **attr,		/* IO - Attribute */
-    ipp_tag_t       group_tag)		/* I  - Group tag */
+int					/* O - 1 on success, 0 on failure */
+ippSetStatusCode(ipp_t        *ipp,	/* I - IPP response or event message */
+                 ipp_status_t status)	/* I - Status code */
 {
  /*
-  * Range check input - group tag must be 0x01 to 0x0F, per RFC 8011...
+  * Range check input...
   */
 
-  if (!ipp || !attr || !*attr ||
-      group_tag < IPP_TAG_ZERO || group_tag == IPP_TAG_END ||
-      group_tag >= IPP_TAG_UNSUPPORTED_VALUE)
+  if (!ipp)
     return (0);
 
  /*
-  * Set the group tag and return...
+  * Set the status code and return...
   */
 
-  (*attr)->group_tag = group_tag;
+  ipp->request.status.status_code = status;
 
   return (1);
 }
 
 
 /*
- * 'ippSetInteger()' - Set an integer or enum value in an attribute.
+ * 'ippSetString()' - Set a string value in an attribute.
  *
  * The @code ipp@ parameter refers to an IPP message previously created using
  * the @link ippNew@, @link ippNewRequest@, or  @link ippNewResponse@ functions.
@@ -3825,19 +3725,26 @@ ippSetGroupTag(
  */
 
 int					/* O  - 1 on success, 0 on failure */
-ippSetInteger(ipp_t           *ipp,	/* I  - IPP message */
-              ipp_attribute_t **attr,	/* IO - IPP attribute */
-              int             element,	/* I  - Value number (0-based) */
-              int             intvalue)	/* I  - Integer/enum value */
+ippSetString(ipp_t           *ipp,	/* I  - IPP message */
+             ipp_attribute_t **attr,	/* IO - IPP attribute */
+             int             element,	/* I  - Value number (0-based) */
+	     const char      *strvalue)	/* I  - String value */
 {
+  char		*temp;			/* Temporary string */
   _ipp_value_t	*value;			/* Current value */
+  ipp_tag_t	value_tag;		/* Value tag */
 
 
  /*
   * Range check input...
   */
 
-  if (!ipp || !attr || !*attr || ((*attr)->value_tag != IPP_TAG_INTEGER && (*attr)->value_tag != IPP_TAG_ENUM && (*attr)->value_tag != IPP_TAG_NOVALUE && (*attr)->value_tag != IPP_TAG_UNKNOWN) || element < 0 || element > (*attr)->num_values)
+  if (attr && *attr)
+    value_tag = (*attr)->value_tag & IPP_TAG_CUPS_MASK;
+  else
+    value_tag = IPP_TAG_ZERO;
+
+  if (!ipp || !attr || !*attr || (value_tag < IPP_TAG_TEXT && value_tag != IPP_TAG_TEXTLANG && value_tag != IPP_TAG_NAMELANG && value_tag != IPP_TAG_NOVALUE && value_tag != IPP_TAG_UNKNOWN) || value_tag > IPP_TAG_MIMETYPE || element < 0 || element > (*attr)->num_values || !strvalue)
     return (0);
 
  /*
@@ -3846,10 +3753,23 @@ ippSetInteger(ipp_t           *ipp,	/* I  - IPP message */
 
   if ((value = ipp_set_value(ipp, attr, element)) != NULL)
   {
-    if ((*attr)->value_tag != IPP_TAG_ENUM)
-      (*attr)->value_tag = IPP_TAG_INTEGER;
+    if (value_tag == IPP_TAG_NOVALUE || value_tag == IPP_TAG_UNKNOWN)
+      (*attr)->value_tag = IPP_TAG_KEYWORD;
 
-    value->integer = intvalue;
+    if (element > 0)
+      value->string.language = (*attr)->values[0].string.language;
+
+    if ((int)((*attr)->value_tag) & IPP_TAG_CUPS_CONST)
+      value->string.text = (char *)strvalue;
+    else if ((temp = _cupsStrAlloc(strvalue)) != NULL)
+    {
+      if (value->string.text)
+        _cupsStrFree(value->string.text);
+
+      value->string.text = temp;
+    }
+    else
+      return (0);
   }
 
   return (value != NULL);
@@ -3857,49 +3777,45 @@ ippSetInteger(ipp_t           *ipp,	/* I  - IPP message */
 
 
 /*
- * 'ippSetName()' - Set the name of an attribute.
+ * 'ippSetStringf()' - Set a formatted string value of an attribute.
  *
  * The @code ipp@ parameter refers to an IPP message previously created using
  * the @link ippNew@, @link ippNewRequest@, or  @link ippNewResponse@ functions.
  *
  * The @code attr@ parameter may be modified as a result of setting the value.
  *
- * @since CUPS 1.6/macOS 10.8@
+ * The @code element@ parameter specifies which value to set from 0 to
+ * @code ippGetCount(attr)@.
+ *
+ * The @code format@ parameter uses formatting characters compatible with the
+ * printf family of standard functions.  Additional arguments follow it as
+ * needed.  The formatted string is truncated as needed to the maximum length of
+ * the corresponding value type.
+ *
+ * @since CUPS 1.7/macOS 10.9@
  */
 
 int					/* O  - 1 on success, 0 on failure */
-ippSetName(ipp_t           *ipp,	/* I  - IPP message */
-	   ipp_attribute_t **attr,	/* IO - IPP attribute */
-	   const char      *name)	/* I  - Attribute name */
+ippSetStringf(ipp_t           *ipp,	/* I  - IPP message */
+              ipp_attribute_t **attr,	/* IO - IPP attribute */
+              int             element,	/* I  - Value number (0-based) */
+	      const char      *format,	/* I  - Printf-style format string */
+	      ...)			/* I  - Additional arguments as needed */
 {
-  char	*temp;				/* Temporary name value */
+  int		ret;			/* Return value */
+  va_list	ap;			/* Pointer to additional arguments */
 
 
- /*
-  * Range check input...
-  */
+  va_start(ap, format);
+  ret = ippSetStringfv(ipp, attr, element, format, ap);
+  va_end(ap);
 
-  if (!ipp || !attr || !*attr)
-    return (0);
-
- /*
-  * Set the value and return...
-  */
-
-  if ((temp = _cupsStrAlloc(name)) != NULL)
-  {
-    if ((*attr)->name)
-      _cupsStrFree((*attr)->name);
-
-    (*attr)->name = temp;
-  }
-
-  return (temp != NULL);
-}
+  return (ret);
+}
 
 
 /*
- * 'ippSetOctetString()' - Set an octetString value in an IPP attribute.
+ * 'ippSetStringf()' - Set a formatted string value of an attribute.
  *
  * The @code ipp@ parameter refers to an IPP message previously created using
  * the @link ippNew@, @link ippNewRequest@, or  @link ippNewResponse@ functions.
@@ -3909,709 +3825,896 @@ ippSetName(ipp_t           *ipp,	/* I  - IPP message */
  * The @code element@ parameter specifies which value to set from 0 to
  * @code ippGetCount(attr)@.
  *
+ * The @code format@ parameter uses formatting characters compatible with the
+ * printf family of standard functions.  Additional arguments follow it as
+ * needed.  The formatted string is truncated as needed to the maximum length of
+ * the corresponding value type.
+ *
  * @since CUPS 1.7/macOS 10.9@
  */
 
 int					/* O  - 1 on success, 0 on failure */
-ippSetOctetString(
-    ipp_t           *ipp,		/* I  - IPP message */
-    ipp_attribute_t **attr,		/* IO - IPP attribute */
-    int             element,		/* I  - Value number (0-based) */
-    const void      *data,		/* I  - Pointer to octetString data */
-    int             datalen)		/* I  - Length of octetString data */
+ippSetStringfv(ipp_t           *ipp,	/* I  - IPP message */
+               ipp_attribute_t **attr,	/* IO - IPP attribute */
+               int             element,	/* I  - Value number (0-based) */
+	       const char      *format,	/* I  - Printf-style format string */
+	       va_list         ap)	/* I  - Pointer to additional arguments */
 {
-  _ipp_value_t	*value;			/* Current value */
+  ipp_tag_t	value_tag;		/* Value tag */
+  char		buffer[IPP_MAX_TEXT + 4];
+					/* Formatted text string */
+  ssize_t	bytes,			/* Length of formatted value */
+		max_bytes;		/* Maximum number of bytes for value */
 
 
  /*
   * Range check input...
   */
 
-  if (!ipp || !attr || !*attr || ((*attr)->value_tag != IPP_TAG_STRING && (*attr)->value_tag != IPP_TAG_NOVALUE && (*attr)->value_tag != IPP_TAG_UNKNOWN) || element < 0 || element > (*attr)->num_values || datalen < 0 || datalen > IPP_MAX_LENGTH)
+  if (attr && *attr)
+    value_tag = (*attr)->value_tag & IPP_TAG_CUPS_MASK;
+  else
+    value_tag = IPP_TAG_ZERO;
+
+  if (!ipp || !attr || !*attr || (value_tag < IPP_TAG_TEXT && value_tag != IPP_TAG_TEXTLANG && value_tag != IPP_TAG_NAMELANG && value_tag != IPP_TAG_NOVALUE && value_tag != IPP_TAG_UNKNOWN) || value_tag > IPP_TAG_MIMETYPE || !format)
     return (0);
 
  /*
-  * Set the value and return...
+  * Format the string...
   */
 
-  if ((value = ipp_set_value(ipp, attr, element)) != NULL)
+  if (!strcmp(format, "%s"))
   {
-    if ((int)((*attr)->value_tag) & IPP_TAG_CUPS_CONST)
-    {
-     /*
-      * Just copy the pointer...
-      */
+   /*
+    * Optimize the simple case...
+    */
 
-      value->unknown.data   = (void *)data;
-      value->unknown.length = datalen;
-    }
-    else
-    {
-     /*
-      * Copy the data...
-      */
+    const char *s = va_arg(ap, char *);
 
-      (*attr)->value_tag = IPP_TAG_STRING;
+    if (!s)
+      s = "(null)";
 
-      if (value->unknown.data)
-      {
-       /*
-	* Free previous data...
-	*/
+    bytes = (ssize_t)strlen(s);
+    strlcpy(buffer, s, sizeof(buffer));
+  }
+  else
+  {
+   /*
+    * Do a full formatting of the message...
+    */
 
-	free(value->unknown.data);
+    if ((bytes = vsnprintf(buffer, sizeof(buffer), format, ap)) < 0)
+      return (0);
+  }
 
-	value->unknown.data   = NULL;
-        value->unknown.length = 0;
-      }
+ /*
+  * Limit the length of the string...
+  */
 
-      if (datalen > 0)
-      {
-	void	*temp;			/* Temporary data pointer */
+  switch (value_tag)
+  {
+    default :
+    case IPP_TAG_TEXT :
+    case IPP_TAG_TEXTLANG :
+        max_bytes = IPP_MAX_TEXT;
+        break;
 
-	if ((temp = malloc((size_t)datalen)) != NULL)
-	{
-	  memcpy(temp, data, (size_t)datalen);
+    case IPP_TAG_NAME :
+    case IPP_TAG_NAMELANG :
+        max_bytes = IPP_MAX_NAME;
+        break;
 
-	  value->unknown.data   = temp;
-	  value->unknown.length = datalen;
-	}
-	else
-	  return (0);
-      }
-    }
+    case IPP_TAG_CHARSET :
+        max_bytes = IPP_MAX_CHARSET;
+        break;
+
+    case IPP_TAG_NOVALUE :
+    case IPP_TAG_UNKNOWN :
+    case IPP_TAG_KEYWORD :
+        max_bytes = IPP_MAX_KEYWORD;
+        break;
+
+    case IPP_TAG_LANGUAGE :
+        max_bytes = IPP_MAX_LANGUAGE;
+        break;
+
+    case IPP_TAG_MIMETYPE :
+        max_bytes = IPP_MAX_MIMETYPE;
+        break;
+
+    case IPP_TAG_URI :
+        max_bytes = IPP_MAX_URI;
+        break;
+
+    case IPP_TAG_URISCHEME :
+        max_bytes = IPP_MAX_URISCHEME;
+        break;
   }
 
-  return (value != NULL);
-}
+  if (bytes >= max_bytes)
+  {
+    char	*bufmax,		/* Buffer at max_bytes */
+		*bufptr;		/* Pointer into buffer */
 
+    bufptr = buffer + strlen(buffer) - 1;
+    bufmax = buffer + max_bytes - 1;
 
-/*
- * 'ippSetOperation()' - Set the operation ID in an IPP request message.
- *
- * The @code ipp@ parameter refers to an IPP message previously created using
- * the @link ippNew@, @link ippNewRequest@, or  @link ippNewResponse@ functions.
- *
- * @since CUPS 1.6/macOS 10.8@
- */
+    while (bufptr > bufmax)
+    {
+      if (*bufptr & 0x80)
+      {
+        while ((*bufptr & 0xc0) == 0x80 && bufptr > buffer)
+          bufptr --;
+      }
 
-int					/* O - 1 on success, 0 on failure */
-ippSetOperation(ipp_t    *ipp,		/* I - IPP request message */
-                ipp_op_t op)		/* I - Operation ID */
-{
- /*
-  * Range check input...
-  */
+      bufptr --;
+    }
 
-  if (!ipp)
-    return (0);
+    *bufptr = '\0';
+  }
 
  /*
-  * Set the operation and return...
+  * Set the formatted string and return...
   */
 
-  ipp->request.op.operation_id = op;
-
-  return (1);
+  return (ippSetString(ipp, attr, element, buffer));
 }
 
 
 /*
- * 'ippSetRange()' - Set a rangeOfInteger value in an attribute.
+ * 'ippSetValueTag()' - Set the value tag of an attribute.
  *
  * The @code ipp@ parameter refers to an IPP message previously created using
  * the @link ippNew@, @link ippNewRequest@, or  @link ippNewResponse@ functions.
  *
  * The @code attr@ parameter may be modified as a result of setting the value.
  *
- * The @code element@ parameter specifies which value to set from 0 to
- * @code ippGetCount(attr)@.
+ * Integer (@code IPP_TAG_INTEGER@) values can be promoted to rangeOfInteger
+ * (@code IPP_TAG_RANGE@) values, the various string tags can be promoted to name
+ * (@code IPP_TAG_NAME@) or nameWithLanguage (@code IPP_TAG_NAMELANG@) values, text
+ * (@code IPP_TAG_TEXT@) values can be promoted to textWithLanguage
+ * (@code IPP_TAG_TEXTLANG@) values, and all values can be demoted to the various
+ * out-of-band value tags such as no-value (@code IPP_TAG_NOVALUE@). All other changes
+ * will be rejected.
+ *
+ * Promoting a string attribute to nameWithLanguage or textWithLanguage adds the language
+ * code in the "attributes-natural-language" attribute or, if not present, the language
+ * code for the current locale.
  *
  * @since CUPS 1.6/macOS 10.8@
  */
 
 int					/* O  - 1 on success, 0 on failure */
-ippSetRange(ipp_t           *ipp,	/* I  - IPP message */
-            ipp_attribute_t **attr,	/* IO - IPP attribute */
-            int             element,	/* I  - Value number (0-based) */
-	    int             lowervalue,	/* I  - Lower bound for range */
-	    int             uppervalue)	/* I  - Upper bound for range */
+ippSetValueTag(
+    ipp_t          *ipp,		/* I  - IPP message */
+    ipp_attribute_t **attr,		/* IO - IPP attribute */
+    ipp_tag_t       value_tag)		/* I  - Value tag */
 {
+  int		i;			/* Looping var */
   _ipp_value_t	*value;			/* Current value */
+  int		integer;		/* Current integer value */
+  cups_lang_t	*language;		/* Current language */
+  char		code[32];		/* Language code */
+  ipp_tag_t	temp_tag;		/* Temporary value tag */
 
 
  /*
   * Range check input...
   */
 
-  if (!ipp || !attr || !*attr || ((*attr)->value_tag != IPP_TAG_RANGE && (*attr)->value_tag != IPP_TAG_NOVALUE && (*attr)->value_tag != IPP_TAG_UNKNOWN) || element < 0 || element > (*attr)->num_values || lowervalue > uppervalue)
+  if (!ipp || !attr || !*attr)
     return (0);
 
  /*
-  * Set the value and return...
-  */
-
-  if ((value = ipp_set_value(ipp, attr, element)) != NULL)
-  {
-    (*attr)->value_tag = IPP_TAG_RANGE;
-    value->range.lower = lowervalue;
-    value->range.upper = uppervalue;
-  }
-
-  return (value != NULL);
-}
-
-
-/*
- * 'ippSetRequestId()' - Set the request ID in an IPP message.
- *
- * The @code ipp@ parameter refers to an IPP message previously created using
- * the @link ippNew@, @link ippNewRequest@, or  @link ippNewResponse@ functions.
- *
- * The @code request_id@ parameter must be greater than 0.
- *
- * @since CUPS 1.6/macOS 10.8@
- */
-
-int					/* O - 1 on success, 0 on failure */
-ippSetRequestId(ipp_t *ipp,		/* I - IPP message */
-                int   request_id)	/* I - Request ID */
-{
- /*
-  * Range check input; not checking request_id values since ipptool wants to send
-  * invalid values for conformance testing and a bad request_id does not affect the
-  * encoding of a message...
+  * If there is no change, return immediately...
   */
 
-  if (!ipp)
-    return (0);
+  if (value_tag == (*attr)->value_tag)
+    return (1);
 
  /*
-  * Set the request ID and return...
+  * Otherwise implement changes as needed...
   */
 
-  ipp->request.any.request_id = request_id;
+  temp_tag = (ipp_tag_t)((int)((*attr)->value_tag) & IPP_TAG_CUPS_MASK);
 
-  return (1);
-}
+  switch (value_tag)
+  {
+    case IPP_TAG_UNSUPPORTED_VALUE :
+    case IPP_TAG_DEFAULT :
+    case IPP_TAG_UNKNOWN :
+    case IPP_TAG_NOVALUE :
+    case IPP_TAG_NOTSETTABLE :
+    case IPP_TAG_DELETEATTR :
+    case IPP_TAG_ADMINDEFINE :
+       /*
+        * Free any existing values...
+        */
 
+        if ((*attr)->num_values > 0)
+          ipp_free_values(*attr, 0, (*attr)->num_values);
 
-/*
- * 'ippSetResolution()' - Set a resolution value in an attribute.
- *
- * The @code ipp@ parameter refers to an IPP message previously created using
- * the @link ippNew@, @link ippNewRequest@, or  @link ippNewResponse@ functions.
- *
- * The @code attr@ parameter may be modified as a result of setting the value.
- *
- * The @code element@ parameter specifies which value to set from 0 to
- * @code ippGetCount(attr)@.
- *
- * @since CUPS 1.6/macOS 10.8@
- */
+       /*
+        * Set out-of-band value...
+        */
 
-int					/* O  - 1 on success, 0 on failure */
-ippSetResolution(
-    ipp_t           *ipp,		/* I  - IPP message */
-    ipp_attribute_t **attr,		/* IO - IPP attribute */
-    int             element,		/* I  - Value number (0-based) */
-    ipp_res_t       unitsvalue,		/* I  - Resolution units */
-    int             xresvalue,		/* I  - Horizontal/cross feed resolution */
-    int             yresvalue)		/* I  - Vertical/feed resolution */
-{
-  _ipp_value_t	*value;			/* Current value */
+        (*attr)->value_tag = value_tag;
+        break;
 
+    case IPP_TAG_RANGE :
+        if (temp_tag != IPP_TAG_INTEGER)
+          return (0);
 
- /*
-  * Range check input...
-  */
+        for (i = (*attr)->num_values, value = (*attr)->values;
+             i > 0;
+             i --, value ++)
+        {
+          integer            = value->integer;
+          value->range.lower = value->range.upper = integer;
+        }
 
-  if (!ipp || !attr || !*attr || ((*attr)->value_tag != IPP_TAG_RESOLUTION && (*attr)->value_tag != IPP_TAG_NOVALUE && (*attr)->value_tag != IPP_TAG_UNKNOWN) || element < 0 || element > (*attr)->num_values || xresvalue <= 0 || yresvalue <= 0 || unitsvalue < IPP_RES_PER_INCH || unitsvalue > IPP_RES_PER_CM)
-    return (0);
+        (*attr)->value_tag = IPP_TAG_RANGE;
+        break;
 
- /*
-  * Set the value and return...
-  */
+    case IPP_TAG_NAME :
+        if (temp_tag != IPP_TAG_KEYWORD)
+          return (0);
 
-  if ((value = ipp_set_value(ipp, attr, element)) != NULL)
-  {
-    (*attr)->value_tag      = IPP_TAG_RESOLUTION;
-    value->resolution.units = unitsvalue;
-    value->resolution.xres  = xresvalue;
-    value->resolution.yres  = yresvalue;
+        (*attr)->value_tag = (ipp_tag_t)(IPP_TAG_NAME | ((*attr)->value_tag & IPP_TAG_CUPS_CONST));
+        break;
+
+    case IPP_TAG_NAMELANG :
+    case IPP_TAG_TEXTLANG :
+        if (value_tag == IPP_TAG_NAMELANG && (temp_tag != IPP_TAG_NAME && temp_tag != IPP_TAG_KEYWORD))
+          return (0);
+
+        if (value_tag == IPP_TAG_TEXTLANG && temp_tag != IPP_TAG_TEXT)
+          return (0);
+
+        if (ipp->attrs && ipp->attrs->next && ipp->attrs->next->name &&
+            !strcmp(ipp->attrs->next->name, "attributes-natural-language") && (ipp->attrs->next->value_tag & IPP_TAG_CUPS_MASK) == IPP_TAG_LANGUAGE)
+        {
+         /*
+          * Use the language code from the IPP message...
+          */
+
+	  (*attr)->values[0].string.language =
+	      _cupsStrAlloc(ipp->attrs->next->values[0].string.text);
+        }
+        else
+        {
+         /*
+          * Otherwise, use the language code corresponding to the locale...
+          */
+
+	  language = cupsLangDefault();
+	  (*attr)->values[0].string.language = _cupsStrAlloc(ipp_lang_code(language->language,
+									code,
+									sizeof(code)));
+        }
+
+        for (i = (*attr)->num_values - 1, value = (*attr)->values + 1;
+             i > 0;
+             i --, value ++)
+          value->string.language = (*attr)->values[0].string.language;
+
+        if ((int)(*attr)->value_tag & IPP_TAG_CUPS_CONST)
+        {
+         /*
+          * Make copies of all values...
+          */
+
+	  for (i = (*attr)->num_values, value = (*attr)->values;
+	       i > 0;
+	       i --, value ++)
+	    value->string.text = _cupsStrAlloc(value->string.text);
+        }
+
+        (*attr)->value_tag = IPP_TAG_NAMELANG;
+        break;
+
+    case IPP_TAG_KEYWORD :
+        if (temp_tag == IPP_TAG_NAME || temp_tag == IPP_TAG_NAMELANG)
+          break;			/* Silently "allow" name -> keyword */
+
+    default :
+        return (0);
   }
 
-  return (value != NULL);
+  return (1);
 }
 
 
 /*
- * 'ippSetState()' - Set the current state of the IPP message.
+ * 'ippSetVersion()' - Set the version number in an IPP message.
+ *
+ * The @code ipp@ parameter refers to an IPP message previously created using
+ * the @link ippNew@, @link ippNewRequest@, or  @link ippNewResponse@ functions.
+ *
+ * The valid version numbers are currently 1.0, 1.1, 2.0, 2.1, and 2.2.
  *
  * @since CUPS 1.6/macOS 10.8@
  */
 
 int					/* O - 1 on success, 0 on failure */
-ippSetState(ipp_t       *ipp,		/* I - IPP message */
-            ipp_state_t state)		/* I - IPP state value */
+ippSetVersion(ipp_t *ipp,		/* I - IPP message */
+              int   major,		/* I - Major version number (major.minor) */
+              int   minor)		/* I - Minor version number (major.minor) */
 {
  /*
   * Range check input...
   */
 
-  if (!ipp)
+  if (!ipp || major < 0 || minor < 0)
     return (0);
 
  /*
-  * Set the state and return...
+  * Set the version number...
   */
 
-  ipp->state   = state;
-  ipp->current = NULL;
+  ipp->request.any.version[0] = (ipp_uchar_t)major;
+  ipp->request.any.version[1] = (ipp_uchar_t)minor;
 
   return (1);
 }
 
 
 /*
- * 'ippSetStatusCode()' - Set the status code in an IPP response or event message.
- *
- * The @code ipp@ parameter refers to an IPP message previously created using
- * the @link ippNew@, @link ippNewRequest@, or  @link ippNewResponse@ functions.
- *
- * @since CUPS 1.6/macOS 10.8@
+ * 'ippTimeToDate()' - Convert from time in seconds to RFC 2579 format.
  */
 
-int					/* O - 1 on success, 0 on failure */
-ippSetStatusCode(ipp_t        *ipp,	/* I - IPP response or event message */
-                 ipp_status_t status)	/* I - Status code */
+const ipp_uchar_t *			/* O - RFC-2579 date/time data */
+ippTimeToDate(time_t t)			/* I - Time in seconds */
 {
- /*
-  * Range check input...
-  */
+  struct tm	unixdate;		/* UNIX unixdate/time info */
+  ipp_uchar_t	*date = _cupsGlobals()->ipp_date;
+					/* RFC-2579 date/time data */
 
-  if (!ipp)
-    return (0);
 
  /*
-  * Set the status code and return...
+  * RFC-2579 date/time format is:
+  *
+  *    Byte(s)  Description
+  *    -------  -----------
+  *    0-1      Year (0 to 65535)
+  *    2        Month (1 to 12)
+  *    3        Day (1 to 31)
+  *    4        Hours (0 to 23)
+  *    5        Minutes (0 to 59)
+  *    6        Seconds (0 to 60, 60 = "leap second")
+  *    7        Deciseconds (0 to 9)
+  *    8        +/- UTC
+  *    9        UTC hours (0 to 11)
+  *    10       UTC minutes (0 to 59)
   */
 
-  ipp->request.status.status_code = status;
+  gmtime_r(&t, &unixdate);
+  unixdate.tm_year += 1900;
 
-  return (1);
+  date[0]  = (ipp_uchar_t)(unixdate.tm_year >> 8);
+  date[1]  = (ipp_uchar_t)(unixdate.tm_year);
+  date[2]  = (ipp_uchar_t)(unixdate.tm_mon + 1);
+  date[3]  = (ipp_uchar_t)unixdate.tm_mday;
+  date[4]  = (ipp_uchar_t)unixdate.tm_hour;
+  date[5]  = (ipp_uchar_t)unixdate.tm_min;
+  date[6]  = (ipp_uchar_t)unixdate.tm_sec;
+  date[7]  = 0;
+  date[8]  = '+';
+  date[9]  = 0;
+  date[10] = 0;
+
+  return (date);
 }
 
 
 /*
- * 'ippSetString()' - Set a string value in an attribute.
- *
- * The @code ipp@ parameter refers to an IPP message previously created using
- * the @link ippNew@, @link ippNewRequest@, or  @link ippNewResponse@ functions.
- *
- * The @code attr@ parameter may be modified as a result of setting the value.
+ * 'ippValidateAttribute()' - Validate the contents of an attribute.
  *
- * The @code element@ parameter specifies which value to set from 0 to
- * @code ippGetCount(attr)@.
+ * This function validates the contents of an attribute based on the name and
+ * value tag.  1 is returned if the attribute is valid, 0 otherwise.  On
+ * failure, @link cupsLastErrorString@ is set to a human-readable message.
  *
- * @since CUPS 1.6/macOS 10.8@
+ * @since CUPS 1.7/macOS 10.9@
  */
 
-int					/* O  - 1 on success, 0 on failure */
-ippSetString(ipp_t           *ipp,	/* I  - IPP message */
-             ipp_attribute_t **attr,	/* IO - IPP attribute */
-             int             element,	/* I  - Value number (0-based) */
-	     const char      *strvalue)	/* I  - String value */
+int					/* O - 1 if valid, 0 otherwise */
+ippValidateAttribute(
+    ipp_attribute_t *attr)		/* I - Attribute */
 {
-  char		*temp;			/* Temporary string */
-  _ipp_value_t	*value;			/* Current value */
-  ipp_tag_t	value_tag;		/* Value tag */
+  int		i;			/* Looping var */
+  char		scheme[64],		/* Scheme from URI */
+		userpass[256],		/* Username/password from URI */
+		hostname[256],		/* Hostname from URI */
+		resource[1024];		/* Resource from URI */
+  int		port,			/* Port number from URI */
+		uri_status;		/* URI separation status */
+  const char	*ptr;			/* Pointer into string */
+  ipp_attribute_t *colattr;		/* Collection attribute */
+  regex_t	re;			/* Regular expression */
+  ipp_uchar_t	*date;			/* Current date value */
 
 
  /*
-  * Range check input...
+  * Skip separators.
   */
 
-  if (attr && *attr)
-    value_tag = (*attr)->value_tag & IPP_TAG_CUPS_MASK;
-  else
-    value_tag = IPP_TAG_ZERO;
-
-  if (!ipp || !attr || !*attr || (value_tag < IPP_TAG_TEXT && value_tag != IPP_TAG_TEXTLANG && value_tag != IPP_TAG_NAMELANG && value_tag != IPP_TAG_NOVALUE && value_tag != IPP_TAG_UNKNOWN) || value_tag > IPP_TAG_MIMETYPE || element < 0 || element > (*attr)->num_values || !strvalue)
-    return (0);
+  if (!attr->name)
+    return (1);
 
  /*
-  * Set the value and return...
+  * Validate the attribute name.
   */
 
-  if ((value = ipp_set_value(ipp, attr, element)) != NULL)
-  {
-    if (value_tag == IPP_TAG_NOVALUE || value_tag == IPP_TAG_UNKNOWN)
-      (*attr)->value_tag = IPP_TAG_KEYWORD;
-
-    if (element > 0)
-      value->string.language = (*attr)->values[0].string.language;
-
-    if ((int)((*attr)->value_tag) & IPP_TAG_CUPS_CONST)
-      value->string.text = (char *)strvalue;
-    else if ((temp = _cupsStrAlloc(strvalue)) != NULL)
-    {
-      if (value->string.text)
-        _cupsStrFree(value->string.text);
+  for (ptr = attr->name; *ptr; ptr ++)
+    if (!isalnum(*ptr & 255) && *ptr != '-' && *ptr != '.' && *ptr != '_')
+      break;
 
-      value->string.text = temp;
-    }
-    else
-      return (0);
+  if (*ptr || ptr == attr->name)
+  {
+    ipp_set_error(IPP_STATUS_ERROR_BAD_REQUEST, _("\"%s\": Bad attribute name - invalid character (RFC 8011 section 5.1.4)."), attr->name);
+    return (0);
   }
 
-  return (value != NULL);
-}
-
-
-/*
- * 'ippSetStringf()' - Set a formatted string value of an attribute.
- *
- * The @code ipp@ parameter refers to an IPP message previously created using
- * the @link ippNew@, @link ippNewRequest@, or  @link ippNewResponse@ functions.
- *
- * The @code attr@ parameter may be modified as a result of setting the value.
- *
- * The @code element@ parameter specifies which value to set from 0 to
- * @code ippGetCount(attr)@.
- *
- * The @code format@ parameter uses formatting characters compatible with the
- * printf family of standard functions.  Additional arguments follow it as
- * needed.  The formatted string is truncated as needed to the maximum length of
- * the corresponding value type.
- *
- * @since CUPS 1.7/macOS 10.9@
- */
-
-int					/* O  - 1 on success, 0 on failure */
-ippSetStringf(ipp_t           *ipp,	/* I  - IPP message */
-              ipp_attribute_t **attr,	/* IO - IPP attribute */
-              int             element,	/* I  - Value number (0-based) */
-	      const char      *format,	/* I  - Printf-style format string */
-	      ...)			/* I  - Additional arguments as needed */
-{
-  int		ret;			/* Return value */
-  va_list	ap;			/* Pointer to additional arguments */
-
+  if ((ptr - attr->name) > 255)
+  {
+    ipp_set_error(IPP_STATUS_ERROR_BAD_REQUEST, _("\"%s\": Bad attribute name - bad length %d (RFC 8011 section 5.1.4)."), attr->name, (int)(ptr - attr->name));
+    return (0);
+  }
 
-  va_start(ap, format);
-  ret = ippSetStringfv(ipp, attr, element, format, ap);
-  va_end(ap);
+  switch (attr->value_tag)
+  {
+    case IPP_TAG_INTEGER :
+        break;
 
-  return (ret);
-}
+    case IPP_TAG_BOOLEAN :
+        for (i = 0; i < attr->num_values; i ++)
+	{
+	  if (attr->values[i].boolean != 0 &&
+	      attr->values[i].boolean != 1)
+	  {
+	    ipp_set_error(IPP_STATUS_ERROR_BAD_REQUEST, _("\"%s\": Bad boolean value %d (RFC 8011 section 5.1.21)."), attr->name, attr->values[i].boolean);
+	    return (0);
+	  }
+	}
+        break;
 
+    case IPP_TAG_ENUM :
+        for (i = 0; i < attr->num_values; i ++)
+	{
+	  if (attr->values[i].integer < 1)
+	  {
+	    ipp_set_error(IPP_STATUS_ERROR_BAD_REQUEST, _("\"%s\": Bad enum value %d - out of range (RFC 8011 section 5.1.5)."), attr->name, attr->values[i].integer);
+            return (0);
+	  }
+	}
+        break;
 
-/*
- * 'ippSetStringf()' - Set a formatted string value of an attribute.
- *
- * The @code ipp@ parameter refers to an IPP message previously created using
- * the @link ippNew@, @link ippNewRequest@, or  @link ippNewResponse@ functions.
- *
- * The @code attr@ parameter may be modified as a result of setting the value.
- *
- * The @code element@ parameter specifies which value to set from 0 to
- * @code ippGetCount(attr)@.
- *
- * The @code format@ parameter uses formatting characters compatible with the
- * printf family of standard functions.  Additional arguments follow it as
- * needed.  The formatted string is truncated as needed to the maximum length of
- * the corresponding value type.
- *
- * @since CUPS 1.7/macOS 10.9@
- */
+    case IPP_TAG_STRING :
+        for (i = 0; i < attr->num_values; i ++)
+	{
+	  if (attr->values[i].unknown.length > IPP_MAX_OCTETSTRING)
+	  {
+	    ipp_set_error(IPP_STATUS_ERROR_BAD_REQUEST, _("\"%s\": Bad octetString value - bad length %d (RFC 8011 section 5.1.20)."), attr->name, attr->values[i].unknown.length);
+	    return (0);
+	  }
+	}
+        break;
 
-int					/* O  - 1 on success, 0 on failure */
-ippSetStringfv(ipp_t           *ipp,	/* I  - IPP message */
-               ipp_attribute_t **attr,	/* IO - IPP attribute */
-               int             element,	/* I  - Value number (0-based) */
-	       const char      *format,	/* I  - Printf-style format string */
-	       va_list         ap)	/* I  - Pointer to additional arguments */
-{
-  ipp_tag_t	value_tag;		/* Value tag */
-  char		buffer[IPP_MAX_TEXT + 4];
-					/* Formatted text string */
-  ssize_t	bytes,			/* Length of formatted value */
-		max_bytes;		/* Maximum number of bytes for value */
+    case IPP_TAG_DATE :
+        for (i = 0; i < attr->num_values; i ++)
+	{
+	  date = attr->values[i].date;
 
+          if (date[2] < 1 || date[2] > 12)
+	  {
+	    ipp_set_error(IPP_STATUS_ERROR_BAD_REQUEST, _("\"%s\": Bad dateTime month %u (RFC 8011 section 5.1.15)."), attr->name, date[2]);
+	    return (0);
+	  }
 
- /*
-  * Range check input...
-  */
+          if (date[3] < 1 || date[3] > 31)
+	  {
+	    ipp_set_error(IPP_STATUS_ERROR_BAD_REQUEST, _("\"%s\": Bad dateTime day %u (RFC 8011 section 5.1.15)."), attr->name, date[3]);
+	    return (0);
+	  }
 
-  if (attr && *attr)
-    value_tag = (*attr)->value_tag & IPP_TAG_CUPS_MASK;
-  else
-    value_tag = IPP_TAG_ZERO;
+          if (date[4] > 23)
+	  {
+	    ipp_set_error(IPP_STATUS_ERROR_BAD_REQUEST, _("\"%s\": Bad dateTime hours %u (RFC 8011 section 5.1.15)."), attr->name, date[4]);
+	    return (0);
+	  }
 
-  if (!ipp || !attr || !*attr || (value_tag < IPP_TAG_TEXT && value_tag != IPP_TAG_TEXTLANG && value_tag != IPP_TAG_NAMELANG && value_tag != IPP_TAG_NOVALUE && value_tag != IPP_TAG_UNKNOWN) || value_tag > IPP_TAG_MIMETYPE || !format)
-    return (0);
+          if (date[5] > 59)
+	  {
+	    ipp_set_error(IPP_STATUS_ERROR_BAD_REQUEST, _("\"%s\": Bad dateTime minutes %u (RFC 8011 section 5.1.15)."), attr->name, date[5]);
+	    return (0);
+	  }
 
- /*
-  * Format the string...
-  */
+          if (date[6] > 60)
+	  {
+	    ipp_set_error(IPP_STATUS_ERROR_BAD_REQUEST, _("\"%s\": Bad dateTime seconds %u (RFC 8011 section 5.1.15)."), attr->name, date[6]);
+	    return (0);
+	  }
 
-  if (!strcmp(format, "%s"))
-  {
-   /*
-    * Optimize the simple case...
-    */
+          if (date[7] > 9)
+	  {
+	    ipp_set_error(IPP_STATUS_ERROR_BAD_REQUEST, _("\"%s\": Bad dateTime deciseconds %u (RFC 8011 section 5.1.15)."), attr->name, date[7]);
+	    return (0);
+	  }
 
-    const char *s = va_arg(ap, char *);
+          if (date[8] != '-' && date[8] != '+')
+	  {
+	    ipp_set_error(IPP_STATUS_ERROR_BAD_REQUEST, _("\"%s\": Bad dateTime UTC sign '%c' (RFC 8011 section 5.1.15)."), attr->name, date[8]);
+	    return (0);
+	  }
 
-    if (!s)
-      s = "(null)";
+          if (date[9] > 11)
+	  {
+	    ipp_set_error(IPP_STATUS_ERROR_BAD_REQUEST, _("\"%s\": Bad dateTime UTC hours %u (RFC 8011 section 5.1.15)."), attr->name, date[9]);
+	    return (0);
+	  }
 
-    bytes = (ssize_t)strlen(s);
-    strlcpy(buffer, s, sizeof(buffer));
-  }
-  else
-  {
-   /*
-    * Do a full formatting of the message...
-    */
+          if (date[10] > 59)
+	  {
+	    ipp_set_error(IPP_STATUS_ERROR_BAD_REQUEST, _("\"%s\": Bad dateTime UTC minutes %u (RFC 8011 section 5.1.15)."), attr->name, date[10]);
+	    return (0);
+	  }
+	}
+        break;
 
-    if ((bytes = vsnprintf(buffer, sizeof(buffer), format, ap)) < 0)
-      return (0);
-  }
+    case IPP_TAG_RESOLUTION :
+        for (i = 0; i < attr->num_values; i ++)
+	{
+	  if (attr->values[i].resolution.xres <= 0)
+	  {
+	    ipp_set_error(IPP_STATUS_ERROR_BAD_REQUEST, _("\"%s\": Bad resolution value %dx%d%s - cross feed resolution must be positive (RFC 8011 section 5.1.16)."), attr->name, attr->values[i].resolution.xres, attr->values[i].resolution.yres, attr->values[i].resolution.units == IPP_RES_PER_INCH ? "dpi" : attr->values[i].resolution.units == IPP_RES_PER_CM ? "dpcm" : "unknown");
+	    return (0);
+	  }
 
- /*
-  * Limit the length of the string...
-  */
+	  if (attr->values[i].resolution.yres <= 0)
+	  {
+	    ipp_set_error(IPP_STATUS_ERROR_BAD_REQUEST, _("\"%s\": Bad resolution value %dx%d%s - feed resolution must be positive (RFC 8011 section 5.1.16)."), attr->name, attr->values[i].resolution.xres, attr->values[i].resolution.yres, attr->values[i].resolution.units == IPP_RES_PER_INCH ? "dpi" : attr->values[i].resolution.units == IPP_RES_PER_CM ? "dpcm" : "unknown");
+            return (0);
+	  }
 
-  switch (value_tag)
-  {
-    default :
-    case IPP_TAG_TEXT :
-    case IPP_TAG_TEXTLANG :
-        max_bytes = IPP_MAX_TEXT;
+	  if (attr->values[i].resolution.units != IPP_RES_PER_INCH && attr->values[i].resolution.units != IPP_RES_PER_CM)
+	  {
+	    ipp_set_error(IPP_STATUS_ERROR_BAD_REQUEST, _("\"%s\": Bad resolution value %dx%d%s - bad units value (RFC 8011 section 5.1.16)."), attr->name, attr->values[i].resolution.xres, attr->values[i].resolution.yres, attr->values[i].resolution.units == IPP_RES_PER_INCH ? "dpi" : attr->values[i].resolution.units == IPP_RES_PER_CM ? "dpcm" : "unknown");
+	    return (0);
+	  }
+	}
         break;
 
-    case IPP_TAG_NAME :
-    case IPP_TAG_NAMELANG :
-        max_bytes = IPP_MAX_NAME;
+    case IPP_TAG_RANGE :
+        for (i = 0; i < attr->num_values; i ++)
+	{
+	  if (attr->values[i].range.lower > attr->values[i].range.upper)
+	  {
+	    ipp_set_error(IPP_STATUS_ERROR_BAD_REQUEST, _("\"%s\": Bad rangeOfInteger value %d-%d - lower greater than upper (RFC 8011 section 5.1.14)."), attr->name, attr->values[i].range.lower, attr->values[i].range.upper);
+	    return (0);
+	  }
+	}
         break;
 
-    case IPP_TAG_CHARSET :
-        max_bytes = IPP_MAX_CHARSET;
-        break;
-
-    case IPP_TAG_NOVALUE :
-    case IPP_TAG_UNKNOWN :
-    case IPP_TAG_KEYWORD :
-        max_bytes = IPP_MAX_KEYWORD;
-        break;
-
-    case IPP_TAG_LANGUAGE :
-        max_bytes = IPP_MAX_LANGUAGE;
-        break;
-
-    case IPP_TAG_MIMETYPE :
-        max_bytes = IPP_MAX_MIMETYPE;
-        break;
-
-    case IPP_TAG_URI :
-        max_bytes = IPP_MAX_URI;
-        break;
-
-    case IPP_TAG_URISCHEME :
-        max_bytes = IPP_MAX_URISCHEME;
+    case IPP_TAG_BEGIN_COLLECTION :
+        for (i = 0; i < attr->num_values; i ++)
+	{
+	  for (colattr = attr->values[i].collection->attrs;
+	       colattr;
+	       colattr = colattr->next)
+	  {
+	    if (!ippValidateAttribute(colattr))
+	      return (0);
+	  }
+	}
         break;
-  }
-
-  if (bytes >= max_bytes)
-  {
-    char	*bufmax,		/* Buffer at max_bytes */
-		*bufptr;		/* Pointer into buffer */
 
-    bufptr = buffer + strlen(buffer) - 1;
-    bufmax = buffer + max_bytes - 1;
+    case IPP_TAG_TEXT :
+    case IPP_TAG_TEXTLANG :
+        for (i = 0; i < attr->num_values; i ++)
+	{
+	  ptr = attr->values[i].string.text;
+	  ptr += _cupsStrASCIISpan(ptr, strlen(ptr), 1);
 
-    while (bufptr > bufmax)
-    {
-      if (*bufptr & 0x80)
-      {
-        while ((*bufptr & 0xc0) == 0x80 && bufptr > buffer)
-          bufptr --;
-      }
+	  for (; *ptr; ptr ++)
+	  {
+	    if ((*ptr & 0xe0) == 0xc0)
+	    {
+	      if ((ptr[1] & 0xc0) != 0x80)
+	        break;
 
-      bufptr --;
-    }
+	      ptr ++;
+	    }
+	    else if ((*ptr & 0xf0) == 0xe0)
+	    {
+	      if ((ptr[1] & 0xc0) != 0x80 || (ptr[2] & 0xc0) != 0x80)
+	        break;
 
-    *bufptr = '\0';
-  }
+	      ptr += 2;
+	    }
+	    else if ((*ptr & 0xf8) == 0xf0)
+	    {
+	      if ((ptr[1] & 0xc0) != 0x80 || (ptr[2] & 0xc0) != 0x80 || (ptr[3] & 0xc0) != 0x80)
+	        break;
 
- /*
-  * Set the formatted string and return...
-  */
+	      ptr += 3;
+	    }
+	    else if (*ptr & 0x80)
+	      break;
+	    else if ((*ptr < ' ' && *ptr != '\n' && *ptr != '\r' && *ptr != '\t') || *ptr == 0x7f)
+	      break;
+	  }
 
-  return (ippSetString(ipp, attr, element, buffer));
-}
+          if (*ptr)
+          {
+	    if (*ptr < ' ' || *ptr == 0x7f)
+	    {
+	      ipp_set_error(IPP_STATUS_ERROR_BAD_REQUEST, _("\"%s\": Bad text value \"%s\" - bad control character (PWG 5100.14 section 8.3)."), attr->name, attr->values[i].string.text);
+	      return (0);
+	    }
+	    else
+	    {
+	      ipp_set_error(IPP_STATUS_ERROR_BAD_REQUEST, _("\"%s\": Bad text value \"%s\" - bad UTF-8 sequence (RFC 8011 section 5.1.2)."), attr->name, attr->values[i].string.text);
+	      return (0);
+	    }
+          }
 
+	  if ((ptr - attr->values[i].string.text) > (IPP_MAX_TEXT - 1))
+	  {
+	    ipp_set_error(IPP_STATUS_ERROR_BAD_REQUEST, _("\"%s\": Bad text value \"%s\" - bad length %d (RFC 8011 section 5.1.2)."), attr->name, attr->values[i].string.text, (int)(ptr - attr->values[i].string.text));
+	    return (0);
+	  }
+	}
+        break;
 
-/*
- * 'ippSetValueTag()' - Set the value tag of an attribute.
- *
- * The @code ipp@ parameter refers to an IPP message previously created using
- * the @link ippNew@, @link ippNewRequest@, or  @link ippNewResponse@ functions.
- *
- * The @code attr@ parameter may be modified as a result of setting the value.
- *
- * Integer (@code IPP_TAG_INTEGER@) values can be promoted to rangeOfInteger
- * (@code IPP_TAG_RANGE@) values, the various string tags can be promoted to name
- * (@code IPP_TAG_NAME@) or nameWithLanguage (@code IPP_TAG_NAMELANG@) values, text
- * (@code IPP_TAG_TEXT@) values can be promoted to textWithLanguage
- * (@code IPP_TAG_TEXTLANG@) values, and all values can be demoted to the various
- * out-of-band value tags such as no-value (@code IPP_TAG_NOVALUE@). All other changes
- * will be rejected.
- *
- * Promoting a string attribute to nameWithLanguage or textWithLanguage adds the language
- * code in the "attributes-natural-language" attribute or, if not present, the language
- * code for the current locale.
- *
- * @since CUPS 1.6/macOS 10.8@
- */
+    case IPP_TAG_NAME :
+    case IPP_TAG_NAMELANG :
+        for (i = 0; i < attr->num_values; i ++)
+	{
+	  ptr = attr->values[i].string.text;
+	  ptr += _cupsStrASCIISpan(ptr, strlen(ptr), 1);
 
-int					/* O  - 1 on success, 0 on failure */
-ippSetValueTag(
-    ipp_t          *ipp,		/* I  - IPP message */
-    ipp_attribute_t **attr,		/* IO - IPP attribute */
-    ipp_tag_t       value_tag)		/* I  - Value tag */
-{
-  int		i;			/* Looping var */
-  _ipp_value_t	*value;			/* Current value */
-  int		integer;		/* Current integer value */
-  cups_lang_t	*language;		/* Current language */
-  char		code[32];		/* Language code */
-  ipp_tag_t	temp_tag;		/* Temporary value tag */
+	  for (; *ptr; ptr ++)
+	  {
+	    if ((*ptr & 0xe0) == 0xc0)
+	    {
+	      if ((ptr[1] & 0xc0) != 0x80)
+	        break;
 
+	      ptr ++;
+	    }
+	    else if ((*ptr & 0xf0) == 0xe0)
+	    {
+	      if ((ptr[1] & 0xc0) != 0x80 || (ptr[2] & 0xc0) != 0x80)
+	        break;
 
- /*
-  * Range check input...
-  */
+	      ptr += 2;
+	    }
+	    else if ((*ptr & 0xf8) == 0xf0)
+	    {
+	      if ((ptr[1] & 0xc0) != 0x80 || (ptr[2] & 0xc0) != 0x80 || (ptr[3] & 0xc0) != 0x80)
+	        break;
 
-  if (!ipp || !attr || !*attr)
-    return (0);
+	      ptr += 3;
+	    }
+	    else if (*ptr & 0x80)
+	      break;
+	    else if (*ptr < ' ' || *ptr == 0x7f)
+	      break;
+	  }
 
- /*
-  * If there is no change, return immediately...
-  */
+	  if (*ptr)
+	  {
+	    if (*ptr < ' ' || *ptr == 0x7f)
+	    {
+	      ipp_set_error(IPP_STATUS_ERROR_BAD_REQUEST, _("\"%s\": Bad name value \"%s\" - bad control character (PWG 5100.14 section 8.1)."), attr->name, attr->values[i].string.text);
+	      return (0);
+	    }
+	    else
+	    {
+	      ipp_set_error(IPP_STATUS_ERROR_BAD_REQUEST, _("\"%s\": Bad name value \"%s\" - bad UTF-8 sequence (RFC 8011 section 5.1.3)."), attr->name, attr->values[i].string.text);
+	      return (0);
+	    }
+          }
 
-  if (value_tag == (*attr)->value_tag)
-    return (1);
+	  if ((ptr - attr->values[i].string.text) > (IPP_MAX_NAME - 1))
+	  {
+	    ipp_set_error(IPP_STATUS_ERROR_BAD_REQUEST, _("\"%s\": Bad name value \"%s\" - bad length %d (RFC 8011 section 5.1.3)."), attr->name, attr->values[i].string.text, (int)(ptr - attr->values[i].string.text));
+	    return (0);
+	  }
+	}
+        break;
 
- /*
-  * Otherwise implement changes as needed...
-  */
+    case IPP_TAG_KEYWORD :
+        for (i = 0; i < attr->num_values; i ++)
+	{
+	  for (ptr = attr->values[i].string.text; *ptr; ptr ++)
+	  {
+	    if (!isalnum(*ptr & 255) && *ptr != '-' && *ptr != '.' &&
+	        *ptr != '_')
+	      break;
+	  }
 
-  temp_tag = (ipp_tag_t)((int)((*attr)->value_tag) & IPP_TAG_CUPS_MASK);
+	  if (*ptr || ptr == attr->values[i].string.text)
+	  {
+	    ipp_set_error(IPP_STATUS_ERROR_BAD_REQUEST, _("\"%s\": Bad keyword value \"%s\" - invalid character (RFC 8011 section 5.1.4)."), attr->name, attr->values[i].string.text);
+	    return (0);
+	  }
 
-  switch (value_tag)
-  {
-    case IPP_TAG_UNSUPPORTED_VALUE :
-    case IPP_TAG_DEFAULT :
-    case IPP_TAG_UNKNOWN :
-    case IPP_TAG_NOVALUE :
-    case IPP_TAG_NOTSETTABLE :
-    case IPP_TAG_DELETEATTR :
-    case IPP_TAG_ADMINDEFINE :
-       /*
-        * Free any existing values...
-        */
+	  if ((ptr - attr->values[i].string.text) > (IPP_MAX_KEYWORD - 1))
+	  {
+	    ipp_set_error(IPP_STATUS_ERROR_BAD_REQUEST, _("\"%s\": Bad keyword value \"%s\" - bad length %d (RFC 8011 section 5.1.4)."), attr->name, attr->values[i].string.text, (int)(ptr - attr->values[i].string.text));
+	    return (0);
+	  }
+	}
+        break;
 
-        if ((*attr)->num_values > 0)
-          ipp_free_values(*attr, 0, (*attr)->num_values);
+    case IPP_TAG_URI :
+        for (i = 0; i < attr->num_values; i ++)
+	{
+	  uri_status = httpSeparateURI(HTTP_URI_CODING_ALL, attr->values[i].string.text, scheme, sizeof(scheme), userpass, sizeof(userpass), hostname, sizeof(hostname), &port, resource, sizeof(resource));
 
-       /*
-        * Set out-of-band value...
-        */
+	  if (uri_status < HTTP_URI_STATUS_OK)
+	  {
+	    ipp_set_error(IPP_STATUS_ERROR_BAD_REQUEST, _("\"%s\": Bad URI value \"%s\" - %s (RFC 8011 section 5.1.6)."), attr->name, attr->values[i].string.text, httpURIStatusString(uri_status));
+	    return (0);
+	  }
 
-        (*attr)->value_tag = value_tag;
+	  if (strlen(attr->values[i].string.text) > (IPP_MAX_URI - 1))
+	  {
+	    ipp_set_error(IPP_STATUS_ERROR_BAD_REQUEST, _("\"%s\": Bad URI value \"%s\" - bad length %d (RFC 8011 section 5.1.6)."), attr->name, attr->values[i].string.text, (int)strlen(attr->values[i].string.text));
+	  }
+	}
         break;
 
-    case IPP_TAG_RANGE :
-        if (temp_tag != IPP_TAG_INTEGER)
-          return (0);
+    case IPP_TAG_URISCHEME :
+        for (i = 0; i < attr->num_values; i ++)
+	{
+	  ptr = attr->values[i].string.text;
+	  if (islower(*ptr & 255))
+	  {
+	    for (ptr ++; *ptr; ptr ++)
+	    {
+	      if (!islower(*ptr & 255) && !isdigit(*ptr & 255) &&
+	          *ptr != '+' && *ptr != '-' && *ptr != '.')
+                break;
+	    }
+	  }
 
-        for (i = (*attr)->num_values, value = (*attr)->values;
-             i > 0;
-             i --, value ++)
-        {
-          integer            = value->integer;
-          value->range.lower = value->range.upper = integer;
-        }
+	  if (*ptr || ptr == attr->values[i].string.text)
+	  {
+	    ipp_set_error(IPP_STATUS_ERROR_BAD_REQUEST, _("\"%s\": Bad uriScheme value \"%s\" - bad characters (RFC 8011 section 5.1.7)."), attr->name, attr->values[i].string.text);
+	    return (0);
+	  }
 
-        (*attr)->value_tag = IPP_TAG_RANGE;
+	  if ((ptr - attr->values[i].string.text) > (IPP_MAX_URISCHEME - 1))
+	  {
+	    ipp_set_error(IPP_STATUS_ERROR_BAD_REQUEST, _("\"%s\": Bad uriScheme value \"%s\" - bad length %d (RFC 8011 section 5.1.7)."), attr->name, attr->values[i].string.text, (int)(ptr - attr->values[i].string.text));
+	    return (0);
+	  }
+	}
         break;
 
-    case IPP_TAG_NAME :
-        if (temp_tag != IPP_TAG_KEYWORD)
-          return (0);
+    case IPP_TAG_CHARSET :
+        for (i = 0; i < attr->num_values; i ++)
+	{
+	  for (ptr = attr->values[i].string.text; *ptr; ptr ++)
+	  {
+	    if (!isprint(*ptr & 255) || isupper(*ptr & 255) ||
+	        isspace(*ptr & 255))
+	      break;
+	  }
 
-        (*attr)->value_tag = (ipp_tag_t)(IPP_TAG_NAME | ((*attr)->value_tag & IPP_TAG_CUPS_CONST));
-        break;
+	  if (*ptr || ptr == attr->values[i].string.text)
+	  {
+	    ipp_set_error(IPP_STATUS_ERROR_BAD_REQUEST, _("\"%s\": Bad charset value \"%s\" - bad characters (RFC 8011 section 5.1.8)."), attr->name, attr->values[i].string.text);
+	    return (0);
+	  }
 
-    case IPP_TAG_NAMELANG :
-    case IPP_TAG_TEXTLANG :
-        if (value_tag == IPP_TAG_NAMELANG && (temp_tag != IPP_TAG_NAME && temp_tag != IPP_TAG_KEYWORD))
-          return (0);
+	  if ((ptr - attr->values[i].string.text) > (IPP_MAX_CHARSET - 1))
+	  {
+	    ipp_set_error(IPP_STATUS_ERROR_BAD_REQUEST, _("\"%s\": Bad charset value \"%s\" - bad length %d (RFC 8011 section 5.1.8)."), attr->name, attr->values[i].string.text, (int)(ptr - attr->values[i].string.text));
+	    return (0);
+	  }
+	}
+        break;
 
-        if (value_tag == IPP_TAG_TEXTLANG && temp_tag != IPP_TAG_TEXT)
-          return (0);
+    case IPP_TAG_LANGUAGE :
+       /*
+        * The following regular expression is derived from the ABNF for
+	* language tags in RFC 4646.  All I can say is that this is the
+	* easiest way to check the values...
+	*/
 
-        if (ipp->attrs && ipp->attrs->next && ipp->attrs->next->name &&
-            !strcmp(ipp->attrs->next->name, "attributes-natural-language") && (ipp->attrs->next->value_tag & IPP_TAG_CUPS_MASK) == IPP_TAG_LANGUAGE)
+        if ((i = regcomp(&re,
+			 "^("
+			 "(([a-z]{2,3}(-[a-z][a-z][a-z]){0,3})|[a-z]{4,8})"
+								/* language */
+			 "(-[a-z][a-z][a-z][a-z]){0,1}"		/* script */
+			 "(-([a-z][a-z]|[0-9][0-9][0-9])){0,1}"	/* region */
+			 "(-([a-z]{5,8}|[0-9][0-9][0-9]))*"	/* variant */
+			 "(-[a-wy-z](-[a-z0-9]{2,8})+)*"	/* extension */
+			 "(-x(-[a-z0-9]{1,8})+)*"		/* privateuse */
+			 "|"
+			 "x(-[a-z0-9]{1,8})+"			/* privateuse */
+			 "|"
+			 "[a-z]{1,3}(-[a-z][0-9]{2,8}){1,2}"	/* grandfathered */
+			 ")$",
+			 REG_NOSUB | REG_EXTENDED)) != 0)
         {
-         /*
-          * Use the language code from the IPP message...
-          */
+          char	temp[256];		/* Temporary error string */
 
-	  (*attr)->values[0].string.language =
-	      _cupsStrAlloc(ipp->attrs->next->values[0].string.text);
+          regerror(i, &re, temp, sizeof(temp));
+	  ipp_set_error(IPP_STATUS_ERROR_INTERNAL, _("Unable to compile naturalLanguage regular expression: %s."), temp);
+	  return (0);
         }
-        else
-        {
-         /*
-          * Otherwise, use the language code corresponding to the locale...
-          */
 
-	  language = cupsLangDefault();
-	  (*attr)->values[0].string.language = _cupsStrAlloc(ipp_lang_code(language->language,
-									code,
-									sizeof(code)));
-        }
+        for (i = 0; i < attr->num_values; i ++)
+	{
+	  if (regexec(&re, attr->values[i].string.text, 0, NULL, 0))
+	  {
+	    ipp_set_error(IPP_STATUS_ERROR_BAD_REQUEST, _("\"%s\": Bad naturalLanguage value \"%s\" - bad characters (RFC 8011 section 5.1.9)."), attr->name, attr->values[i].string.text);
+	    regfree(&re);
+	    return (0);
+	  }
 
-        for (i = (*attr)->num_values - 1, value = (*attr)->values + 1;
-             i > 0;
-             i --, value ++)
-          value->string.language = (*attr)->values[0].string.language;
+	  if (strlen(attr->values[i].string.text) > (IPP_MAX_LANGUAGE - 1))
+	  {
+	    ipp_set_error(IPP_STATUS_ERROR_BAD_REQUEST, _("\"%s\": Bad naturalLanguage value \"%s\" - bad length %d (RFC 8011 section 5.1.9)."), attr->name, attr->values[i].string.text, (int)strlen(attr->values[i].string.text));
+	    regfree(&re);
+	    return (0);
+	  }
+	}
 
-        if ((int)(*attr)->value_tag & IPP_TAG_CUPS_CONST)
+	regfree(&re);
+        break;
+
+    case IPP_TAG_MIMETYPE :
+       /*
+        * The following regular expression is derived from the ABNF for
+	* MIME media types in RFC 2045 and 4288.  All I can say is that this is
+	* the easiest way to check the values...
+	*/
+
+        if ((i = regcomp(&re,
+			 "^"
+			 "[-a-zA-Z0-9!#$&.+^_]{1,127}"		/* type-name */
+			 "/"
+			 "[-a-zA-Z0-9!#$&.+^_]{1,127}"		/* subtype-name */
+			 "(;[-a-zA-Z0-9!#$&.+^_]{1,127}="	/* parameter= */
+			 "([-a-zA-Z0-9!#$&.+^_]{1,127}|\"[^\"]*\"))*"
+			 					/* value */
+			 "$",
+			 REG_NOSUB | REG_EXTENDED)) != 0)
         {
-         /*
-          * Make copies of all values...
-          */
+          char	temp[256];		/* Temporary error string */
 
-	  for (i = (*attr)->num_values, value = (*attr)->values;
-	       i > 0;
-	       i --, value ++)
-	    value->string.text = _cupsStrAlloc(value->string.text);
+          regerror(i, &re, temp, sizeof(temp));
+	  ipp_set_error(IPP_STATUS_ERROR_BAD_REQUEST, _("Unable to compile mimeMediaType regular expression: %s."), temp);
+	  return (0);
         }
 
-        (*attr)->value_tag = IPP_TAG_NAMELANG;
-        break;
+        for (i = 0; i < attr->num_values; i ++)
+	{
+	  if (regexec(&re, attr->values[i].string.text, 0, NULL, 0))
+	  {
+	    ipp_set_error(IPP_STATUS_ERROR_BAD_REQUEST, _("\"%s\": Bad mimeMediaType value \"%s\" - bad characters (RFC 8011 section 5.1.10)."), attr->name, attr->values[i].string.text);
+	    regfree(&re);
+	    return (0);
+	  }
 
-    case IPP_TAG_KEYWORD :
-        if (temp_tag == IPP_TAG_NAME || temp_tag == IPP_TAG_NAMELANG)
-          break;			/* Silently "allow" name -> keyword */
+	  if (strlen(attr->values[i].string.text) > (IPP_MAX_MIMETYPE - 1))
+	  {
+	    ipp_set_error(IPP_STATUS_ERROR_BAD_REQUEST, _("\"%s\": Bad mimeMediaType value \"%s\" - bad length %d (RFC 8011 section 5.1.10)."), attr->name, attr->values[i].string.text, (int)strlen(attr->values[i].string.text));
+	    regfree(&re);
+	    return (0);
+	  }
+	}
+
+	regfree(&re);
+        break;
 
     default :
-        return (0);
+        break;
   }
 
   return (1);
@@ -4619,1539 +4722,1632 @@ ippSetValueTag(
 
 
 /*
- * 'ippSetVersion()' - Set the version number in an IPP message.
- *
- * The @code ipp@ parameter refers to an IPP message previously created using
- * the @link ippNew@, @link ippNewRequest@, or  @link ippNewResponse@ functions.
+ * 'ippValidateAttributes()' - Validate all attributes in an IPP message.
  *
- * The valid version numbers are currently 1.0, 1.1, 2.0, 2.1, and 2.2.
+ * This function validates the contents of the IPP message, including each
+ * attribute.  Like @link ippValidateAttribute@, @link cupsLastErrorString@ is
+ * set to a human-readable message on failure.
  *
- * @since CUPS 1.6/macOS 10.8@
+ * @since CUPS 1.7/macOS 10.9@
  */
 
-int					/* O - 1 on success, 0 on failure */
-ippSetVersion(ipp_t *ipp,		/* I - IPP message */
-              int   major,		/* I - Major version number (major.minor) */
-              int   minor)		/* I - Minor version number (major.minor) */
+int					/* O - 1 if valid, 0 otherwise */
+ippValidateAttributes(ipp_t *ipp)	/* I - IPP message */
 {
- /*
-  * Range check input...
-  */
+  ipp_attribute_t	*attr;		/* Current attribute */
 
-  if (!ipp || major < 0 || minor < 0)
-    return (0);
 
- /*
-  * Set the version number...
-  */
+  if (!ipp)
+    return (1);
 
-  ipp->request.any.version[0] = (ipp_uchar_t)major;
-  ipp->request.any.version[1] = (ipp_uchar_t)minor;
+  for (attr = ipp->attrs; attr; attr = attr->next)
+    if (!ippValidateAttribute(attr))
+      return (0);
 
   return (1);
 }
 
 
 /*
- * 'ippTimeToDate()' - Convert from time in seconds to RFC 2579 format.
+ * 'ippWrite()' - Write data for an IPP message to a HTTP connection.
  */
 
-const ipp_uchar_t *			/* O - RFC-2579 date/time data */
-ippTimeToDate(time_t t)			/* I - Time in seconds */
+ipp_state_t				/* O - Current state */
+ippWrite(http_t *http,			/* I - HTTP connection */
+         ipp_t  *ipp)			/* I - IPP data */
 {
-  struct tm	unixdate;		/* UNIX unixdate/time info */
-  ipp_uchar_t	*date = _cupsGlobals()->ipp_date;
-					/* RFC-2579 date/time data */
+  DEBUG_printf(("ippWrite(http=%p, ipp=%p)", (void *)http, (void *)ipp));
 
+  if (!http)
+    return (IPP_STATE_ERROR);
 
- /*
-  * RFC-2579 date/time format is:
-  *
-  *    Byte(s)  Description
-  *    -------  -----------
-  *    0-1      Year (0 to 65535)
-  *    2        Month (1 to 12)
-  *    3        Day (1 to 31)
-  *    4        Hours (0 to 23)
-  *    5        Minutes (0 to 59)
-  *    6        Seconds (0 to 60, 60 = "leap second")
-  *    7        Deciseconds (0 to 9)
-  *    8        +/- UTC
-  *    9        UTC hours (0 to 11)
-  *    10       UTC minutes (0 to 59)
-  */
+  return (ippWriteIO(http, (ipp_iocb_t)httpWrite2, http->blocking, NULL, ipp));
+}
 
-  gmtime_r(&t, &unixdate);
-  unixdate.tm_year += 1900;
 
-  date[0]  = (ipp_uchar_t)(unixdate.tm_year >> 8);
-  date[1]  = (ipp_uchar_t)(unixdate.tm_year);
-  date[2]  = (ipp_uchar_t)(unixdate.tm_mon + 1);
-  date[3]  = (ipp_uchar_t)unixdate.tm_mday;
-  date[4]  = (ipp_uchar_t)unixdate.tm_hour;
-  date[5]  = (ipp_uchar_t)unixdate.tm_min;
-  date[6]  = (ipp_uchar_t)unixdate.tm_sec;
-  date[7]  = 0;
-  date[8]  = '+';
-  date[9]  = 0;
-  date[10] = 0;
+/*
+ * 'ippWriteBuffer()' - Write an IPP message to a memory buffer.
+ *
+ * The message is encoded in a single pass, so the return value can be used as
+ * the Content-Length of a request or response without calling @link ippLength@.
+ * "buffer" and "bufsize" describe a buffer allocated with malloc, which is
+ * grown as needed - pass a @code NULL@ buffer and a size of 0 to allocate a
+ * new one.  The buffer can be reused for other messages and must be freed by
+ * the caller.
+ *
+ * @since CUPS 2.3@
+ */
 
-  return (date);
+ssize_t					/* O  - Number of bytes written or -1 on error */
+ippWriteBuffer(ipp_t       *ipp,	/* I  - IPP data */
+               ipp_uchar_t **buffer,	/* IO - Buffer */
+               size_t      *bufsize)	/* IO - Size of buffer */
+{
+  _ipp_wbuffer_t	wbuffer;	/* Write buffer */
+
+
+  DEBUG_printf(("ippWriteBuffer(ipp=%p, buffer=%p, bufsize=%p)", (void *)ipp, (void *)buffer, (void *)bufsize));
+
+  if (!ipp || !buffer || !bufsize)
+    return (-1);
+
+  if (!*buffer)
+    *bufsize = 0;
+
+  wbuffer.buffer  = buffer;
+  wbuffer.bufsize = bufsize;
+  wbuffer.used    = 0;
+
+  ipp->state = IPP_STATE_IDLE;
+
+  if (ippWriteIO(&wbuffer, (ipp_iocb_t)ipp_write_buffer, 1, NULL, ipp) != IPP_STATE_DATA)
+    return (-1);
+
+  return ((ssize_t)wbuffer.used);
 }
 
 
 /*
- * 'ippValidateAttribute()' - Validate the contents of an attribute.
+ * 'ippWriteFile()' - Write data for an IPP message to a file.
  *
- * This function validates the contents of an attribute based on the name and
- * value tag.  1 is returned if the attribute is valid, 0 otherwise.  On
- * failure, @link cupsLastErrorString@ is set to a human-readable message.
+ * @since CUPS 1.1.19/macOS 10.3@
+ */
+
+ipp_state_t				/* O - Current state */
+ippWriteFile(int   fd,			/* I - HTTP data */
+             ipp_t *ipp)		/* I - IPP data */
+{
+  DEBUG_printf(("ippWriteFile(fd=%d, ipp=%p)", fd, (void *)ipp));
+
+  ipp->state = IPP_STATE_IDLE;
+
+  return (ippWriteIO(&fd, (ipp_iocb_t)ipp_write_file, 1, NULL, ipp));
+}
+
+
+/*
+ * 'ippWriteIO()' - Write data for an IPP message.
  *
- * @since CUPS 1.7/macOS 10.9@
+ * @since CUPS 1.2/macOS 10.5@
  */
 
-int					/* O - 1 if valid, 0 otherwise */
-ippValidateAttribute(
-    ipp_attribute_t *attr)		/* I - Attribute */
+ipp_state_t				/* O - Current state */
+ippWriteIO(void       *dst,		/* I - Destination */
+           ipp_iocb_t cb,		/* I - Write callback function */
+	   int        blocking,		/* I - Use blocking IO? */
+	   ipp_t      *parent,		/* I - Parent IPP message */
+           ipp_t      *ipp)		/* I - IPP data */
 {
-  int		i;			/* Looping var */
-  char		scheme[64],		/* Scheme from URI */
-		userpass[256],		/* Username/password from URI */
-		hostname[256],		/* Hostname from URI */
-		resource[1024];		/* Resource from URI */
-  int		port,			/* Port number from URI */
-		uri_status;		/* URI separation status */
-  const char	*ptr;			/* Pointer into string */
-  ipp_attribute_t *colattr;		/* Collection attribute */
-  regex_t	re;			/* Regular expression */
-  ipp_uchar_t	*date;			/* Current date value */
+  ipp_state_t	state;			/* Current state */
 
 
+  _CUPS_TRACE2(ipp__write__start, ipp, ipp ? ipp->state : IPP_STATE_ERROR);
+
+  state = ipp_write_io(dst, cb, blocking, parent, ipp);
+
+  _CUPS_TRACE2(ipp__write__end, ipp, state);
+
+  return (state);
+}
+
+
+/*
+ * 'ipp_add_attr()' - Add a new attribute to the message.
+ */
+
+static ipp_attribute_t *		/* O - New attribute */
+ipp_add_attr(ipp_t      *ipp,		/* I - IPP message */
+             const char *name,		/* I - Attribute name or NULL */
+             ipp_tag_t  group_tag,	/* I - Group tag or IPP_TAG_ZERO */
+             ipp_tag_t  value_tag,	/* I - Value tag or IPP_TAG_ZERO */
+             int        num_values)	/* I - Number of values */
+{
+  int			alloc_values;	/* Number of values to allocate */
+  ipp_attribute_t	*attr;		/* New attribute */
+
+
+  DEBUG_printf(("4ipp_add_attr(ipp=%p, name=\"%s\", group_tag=0x%x, value_tag=0x%x, num_values=%d)", (void *)ipp, name, group_tag, value_tag, num_values));
+
  /*
-  * Skip separators.
+  * Range check input...
   */
 
-  if (!attr->name)
-    return (1);
+  if (!ipp || num_values < 0)
+    return (NULL);
 
  /*
-  * Validate the attribute name.
+  * Allocate memory for exactly the number of values requested - attributes
+  * that grow one value at a time are resized by ipp_set_value()...
   */
 
-  for (ptr = attr->name; *ptr; ptr ++)
-    if (!isalnum(*ptr & 255) && *ptr != '-' && *ptr != '.' && *ptr != '_')
-      break;
+  alloc_values = num_values > 1 ? num_values : 1;
 
-  if (*ptr || ptr == attr->name)
-  {
-    ipp_set_error(IPP_STATUS_ERROR_BAD_REQUEST, _("\"%s\": Bad attribute name - invalid character (RFC 8011 section 5.1.4)."), attr->name);
-    return (0);
-  }
+  if (ipp->use_arena)
+    attr = ipp_arena_alloc(ipp, sizeof(ipp_attribute_t) + (size_t)(alloc_values - 1) * sizeof(_ipp_value_t));
+  else
+    attr = calloc(sizeof(ipp_attribute_t) +
+                  (size_t)(alloc_values - 1) * sizeof(_ipp_value_t), 1);
 
-  if ((ptr - attr->name) > 255)
+  if (attr)
   {
-    ipp_set_error(IPP_STATUS_ERROR_BAD_REQUEST, _("\"%s\": Bad attribute name - bad length %d (RFC 8011 section 5.1.4)."), attr->name, (int)(ptr - attr->name));
-    return (0);
-  }
+   /*
+    * Initialize attribute...
+    */
 
-  switch (attr->value_tag)
-  {
-    case IPP_TAG_INTEGER :
-        break;
+    DEBUG_printf(("4debug_alloc: %p %s %s%s (%d values)", (void *)attr, name, num_values > 1 ? "1setOf " : "", ippTagString(value_tag), num_values));
 
-    case IPP_TAG_BOOLEAN :
-        for (i = 0; i < attr->num_values; i ++)
-	{
-	  if (attr->values[i].boolean != 0 &&
-	      attr->values[i].boolean != 1)
-	  {
-	    ipp_set_error(IPP_STATUS_ERROR_BAD_REQUEST, _("\"%s\": Bad boolean value %d (RFC 8011 section 5.1.21)."), attr->name, attr->values[i].boolean);
-	    return (0);
-	  }
-	}
-        break;
+    if (name)
+      attr->name = _cupsStrAlloc(name);
 
-    case IPP_TAG_ENUM :
-        for (i = 0; i < attr->num_values; i ++)
-	{
-	  if (attr->values[i].integer < 1)
-	  {
-	    ipp_set_error(IPP_STATUS_ERROR_BAD_REQUEST, _("\"%s\": Bad enum value %d - out of range (RFC 8011 section 5.1.5)."), attr->name, attr->values[i].integer);
-            return (0);
-	  }
-	}
-        break;
+    attr->group_tag  = group_tag;
+    attr->value_tag  = value_tag;
+    attr->num_values   = num_values;
+    attr->alloc_values = alloc_values;
 
-    case IPP_TAG_STRING :
-        for (i = 0; i < attr->num_values; i ++)
-	{
-	  if (attr->values[i].unknown.length > IPP_MAX_OCTETSTRING)
-	  {
-	    ipp_set_error(IPP_STATUS_ERROR_BAD_REQUEST, _("\"%s\": Bad octetString value - bad length %d (RFC 8011 section 5.1.20)."), attr->name, attr->values[i].unknown.length);
-	    return (0);
-	  }
-	}
-        break;
+   /*
+    * Add it to the end of the linked list...
+    */
 
-    case IPP_TAG_DATE :
-        for (i = 0; i < attr->num_values; i ++)
-	{
-	  date = attr->values[i].date;
+    if (ipp->last)
+      ipp->last->next = attr;
+    else
+      ipp->attrs = attr;
 
-          if (date[2] < 1 || date[2] > 12)
-	  {
-	    ipp_set_error(IPP_STATUS_ERROR_BAD_REQUEST, _("\"%s\": Bad dateTime month %u (RFC 8011 section 5.1.15)."), attr->name, date[2]);
-	    return (0);
-	  }
+    ipp->prev = ipp->last;
+    ipp->last = ipp->current = attr;
 
-          if (date[3] < 1 || date[3] > 31)
-	  {
-	    ipp_set_error(IPP_STATUS_ERROR_BAD_REQUEST, _("\"%s\": Bad dateTime day %u (RFC 8011 section 5.1.15)."), attr->name, date[3]);
-	    return (0);
-	  }
+    ipp_index_clear(ipp);
+  }
 
-          if (date[4] > 23)
-	  {
-	    ipp_set_error(IPP_STATUS_ERROR_BAD_REQUEST, _("\"%s\": Bad dateTime hours %u (RFC 8011 section 5.1.15)."), attr->name, date[4]);
-	    return (0);
-	  }
+  DEBUG_printf(("5ipp_add_attr: Returning %p", (void *)attr));
 
-          if (date[5] > 59)
-	  {
-	    ipp_set_error(IPP_STATUS_ERROR_BAD_REQUEST, _("\"%s\": Bad dateTime minutes %u (RFC 8011 section 5.1.15)."), attr->name, date[5]);
-	    return (0);
-	  }
+  return (attr);
+}
 
-          if (date[6] > 60)
-	  {
-	    ipp_set_error(IPP_STATUS_ERROR_BAD_REQUEST, _("\"%s\": Bad dateTime seconds %u (RFC 8011 section 5.1.15)."), attr->name, date[6]);
-	    return (0);
-	  }
 
-          if (date[7] > 9)
-	  {
-	    ipp_set_error(IPP_STATUS_ERROR_BAD_REQUEST, _("\"%s\": Bad dateTime deciseconds %u (RFC 8011 section 5.1.15)."), attr->name, date[7]);
-	    return (0);
-	  }
+/*
+ * 'ipp_alloc_values()' - Get the number of values to allocate for an attribute.
+ *
+ * Attributes with more than one value are allocated in groups of
+ * IPP_MAX_VALUES values and then in powers of 2 so that adding N values one
+ * at a time only needs O(log N) reallocations.  The result is only used when
+ * growing an attribute - new attributes are allocated with exactly the number
+ * of values they are created with.
+ */
 
-          if (date[8] != '-' && date[8] != '+')
-	  {
-	    ipp_set_error(IPP_STATUS_ERROR_BAD_REQUEST, _("\"%s\": Bad dateTime UTC sign '%c' (RFC 8011 section 5.1.15)."), attr->name, date[8]);
-	    return (0);
-	  }
+static int				/* O - Number of values to allocate */
+ipp_alloc_values(int num_values)	/* I - Number of values */
+{
+  int	alloc_values;			/* Number of values to allocate */
 
-          if (date[9] > 11)
-	  {
-	    ipp_set_error(IPP_STATUS_ERROR_BAD_REQUEST, _("\"%s\": Bad dateTime UTC hours %u (RFC 8011 section 5.1.15)."), attr->name, date[9]);
-	    return (0);
-	  }
 
-          if (date[10] > 59)
-	  {
-	    ipp_set_error(IPP_STATUS_ERROR_BAD_REQUEST, _("\"%s\": Bad dateTime UTC minutes %u (RFC 8011 section 5.1.15)."), attr->name, date[10]);
-	    return (0);
-	  }
-	}
-        break;
+  if (num_values <= 1)
+    return (1);
+  else if (num_values > INT_MAX / 2)
+    return (num_values);
 
-    case IPP_TAG_RESOLUTION :
-        for (i = 0; i < attr->num_values; i ++)
-	{
-	  if (attr->values[i].resolution.xres <= 0)
-	  {
-	    ipp_set_error(IPP_STATUS_ERROR_BAD_REQUEST, _("\"%s\": Bad resolution value %dx%d%s - cross feed resolution must be positive (RFC 8011 section 5.1.16)."), attr->name, attr->values[i].resolution.xres, attr->values[i].resolution.yres, attr->values[i].resolution.units == IPP_RES_PER_INCH ? "dpi" : attr->values[i].resolution.units == IPP_RES_PER_CM ? "dpcm" : "unknown");
-	    return (0);
-	  }
+  for (alloc_values = IPP_MAX_VALUES; alloc_values < num_values; alloc_values *= 2);
 
-	  if (attr->values[i].resolution.yres <= 0)
-	  {
-	    ipp_set_error(IPP_STATUS_ERROR_BAD_REQUEST, _("\"%s\": Bad resolution value %dx%d%s - feed resolution must be positive (RFC 8011 section 5.1.16)."), attr->name, attr->values[i].resolution.xres, attr->values[i].resolution.yres, attr->values[i].resolution.units == IPP_RES_PER_INCH ? "dpi" : attr->values[i].resolution.units == IPP_RES_PER_CM ? "dpcm" : "unknown");
-            return (0);
-	  }
+  return (alloc_values);
+}
 
-	  if (attr->values[i].resolution.units != IPP_RES_PER_INCH && attr->values[i].resolution.units != IPP_RES_PER_CM)
-	  {
-	    ipp_set_error(IPP_STATUS_ERROR_BAD_REQUEST, _("\"%s\": Bad resolution value %dx%d%s - bad units value (RFC 8011 section 5.1.16)."), attr->name, attr->values[i].resolution.xres, attr->values[i].resolution.yres, attr->values[i].resolution.units == IPP_RES_PER_INCH ? "dpi" : attr->values[i].resolution.units == IPP_RES_PER_CM ? "dpcm" : "unknown");
-	    return (0);
-	  }
-	}
-        break;
 
-    case IPP_TAG_RANGE :
-        for (i = 0; i < attr->num_values; i ++)
-	{
-	  if (attr->values[i].range.lower > attr->values[i].range.upper)
-	  {
-	    ipp_set_error(IPP_STATUS_ERROR_BAD_REQUEST, _("\"%s\": Bad rangeOfInteger value %d-%d - lower greater than upper (RFC 8011 section 5.1.14)."), attr->name, attr->values[i].range.lower, attr->values[i].range.upper);
-	    return (0);
-	  }
-	}
-        break;
+/*
+ * 'ipp_arena_alloc()' - Allocate zeroed memory from the message arena.
+ */
 
-    case IPP_TAG_BEGIN_COLLECTION :
-        for (i = 0; i < attr->num_values; i ++)
-	{
-	  for (colattr = attr->values[i].collection->attrs;
-	       colattr;
-	       colattr = colattr->next)
-	  {
-	    if (!ippValidateAttribute(colattr))
-	      return (0);
-	  }
-	}
-        break;
+static void *				/* O - Memory or NULL on error */
+ipp_arena_alloc(ipp_t  *ipp,		/* I - IPP message */
+                size_t bytes)		/* I - Number of bytes */
+{
+  _ipp_arena_t	*arena;			/* Current block */
+  void		*ptr;			/* Allocated memory */
+  size_t	size;			/* Size of new block */
 
-    case IPP_TAG_TEXT :
-    case IPP_TAG_TEXTLANG :
-        for (i = 0; i < attr->num_values; i ++)
-	{
-	  for (ptr = attr->values[i].string.text; *ptr; ptr ++)
-	  {
-	    if ((*ptr & 0xe0) == 0xc0)
-	    {
-	      if ((ptr[1] & 0xc0) != 0x80)
-	        break;
 
-	      ptr ++;
-	    }
-	    else if ((*ptr & 0xf0) == 0xe0)
-	    {
-	      if ((ptr[1] & 0xc0) != 0x80 || (ptr[2] & 0xc0) != 0x80)
-	        break;
+  bytes = (bytes + sizeof(double) - 1) & ~(sizeof(double) - 1);
 
-	      ptr += 2;
-	    }
-	    else if ((*ptr & 0xf8) == 0xf0)
-	    {
-	      if ((ptr[1] & 0xc0) != 0x80 || (ptr[2] & 0xc0) != 0x80 || (ptr[3] & 0xc0) != 0x80)
-	        break;
+  if ((arena = ipp->arena) == NULL || (arena->size - arena->used) < bytes)
+  {
+   /*
+    * Add a new block, using a dedicated block for large attributes...
+    */
 
-	      ptr += 3;
-	    }
-	    else if (*ptr & 0x80)
-	      break;
-	    else if ((*ptr < ' ' && *ptr != '\n' && *ptr != '\r' && *ptr != '\t') || *ptr == 0x7f)
-	      break;
-	  }
+    if ((size = IPP_ARENA_SIZE) < bytes)
+      size = bytes;
 
-          if (*ptr)
-          {
-	    if (*ptr < ' ' || *ptr == 0x7f)
-	    {
-	      ipp_set_error(IPP_STATUS_ERROR_BAD_REQUEST, _("\"%s\": Bad text value \"%s\" - bad control character (PWG 5100.14 section 8.3)."), attr->name, attr->values[i].string.text);
-	      return (0);
-	    }
-	    else
-	    {
-	      ipp_set_error(IPP_STATUS_ERROR_BAD_REQUEST, _("\"%s\": Bad text value \"%s\" - bad UTF-8 sequence (RFC 8011 section 5.1.2)."), attr->name, attr->values[i].string.text);
-	      return (0);
-	    }
-          }
+    if ((arena = calloc(1, sizeof(_ipp_arena_t) - sizeof(double) + size)) == NULL)
+      return (NULL);
 
-	  if ((ptr - attr->values[i].string.text) > (IPP_MAX_TEXT - 1))
-	  {
-	    ipp_set_error(IPP_STATUS_ERROR_BAD_REQUEST, _("\"%s\": Bad text value \"%s\" - bad length %d (RFC 8011 section 5.1.2)."), attr->name, attr->values[i].string.text, (int)(ptr - attr->values[i].string.text));
-	    return (0);
-	  }
-	}
-        break;
+    arena->size = size;
 
-    case IPP_TAG_NAME :
-    case IPP_TAG_NAMELANG :
-        for (i = 0; i < attr->num_values; i ++)
-	{
-	  for (ptr = attr->values[i].string.text; *ptr; ptr ++)
-	  {
-	    if ((*ptr & 0xe0) == 0xc0)
-	    {
-	      if ((ptr[1] & 0xc0) != 0x80)
-	        break;
+    if (ipp->arena && bytes < IPP_ARENA_SIZE)
+    {
+      arena->next = ipp->arena;
+      ipp->arena  = arena;
+    }
+    else if (ipp->arena)
+    {
+      arena->next      = ipp->arena->next;
+      ipp->arena->next = arena;
+    }
+    else
+      ipp->arena = arena;
+  }
 
-	      ptr ++;
-	    }
-	    else if ((*ptr & 0xf0) == 0xe0)
-	    {
-	      if ((ptr[1] & 0xc0) != 0x80 || (ptr[2] & 0xc0) != 0x80)
-	        break;
+  ptr = (char *)arena->data + arena->used;
+  arena->used += bytes;
 
-	      ptr += 2;
-	    }
-	    else if ((*ptr & 0xf8) == 0xf0)
-	    {
-	      if ((ptr[1] & 0xc0) != 0x80 || (ptr[2] & 0xc0) != 0x80 || (ptr[3] & 0xc0) != 0x80)
-	        break;
+  return (ptr);
+}
 
-	      ptr += 3;
-	    }
-	    else if (*ptr & 0x80)
-	      break;
-	    else if (*ptr < ' ' || *ptr == 0x7f)
-	      break;
-	  }
 
-	  if (*ptr)
-	  {
-	    if (*ptr < ' ' || *ptr == 0x7f)
-	    {
-	      ipp_set_error(IPP_STATUS_ERROR_BAD_REQUEST, _("\"%s\": Bad name value \"%s\" - bad control character (PWG 5100.14 section 8.1)."), attr->name, attr->values[i].string.text);
-	      return (0);
-	    }
-	    else
-	    {
-	      ipp_set_error(IPP_STATUS_ERROR_BAD_REQUEST, _("\"%s\": Bad name value \"%s\" - bad UTF-8 sequence (RFC 8011 section 5.1.3)."), attr->name, attr->values[i].string.text);
-	      return (0);
-	    }
-          }
+/*
+ * 'ipp_free_values()' - Free attribute values.
+ */
 
-	  if ((ptr - attr->values[i].string.text) > (IPP_MAX_NAME - 1))
-	  {
-	    ipp_set_error(IPP_STATUS_ERROR_BAD_REQUEST, _("\"%s\": Bad name value \"%s\" - bad length %d (RFC 8011 section 5.1.3)."), attr->name, attr->values[i].string.text, (int)(ptr - attr->values[i].string.text));
-	    return (0);
-	  }
-	}
-        break;
+static void
+ipp_free_values(ipp_attribute_t *attr,	/* I - Attribute to free values from */
+                int             element,/* I - First value to free */
+                int             count)	/* I - Number of values to free */
+{
+  int		i;			/* Looping var */
+  _ipp_value_t	*value;			/* Current value */
 
-    case IPP_TAG_KEYWORD :
-        for (i = 0; i < attr->num_values; i ++)
-	{
-	  for (ptr = attr->values[i].string.text; *ptr; ptr ++)
-	  {
-	    if (!isalnum(*ptr & 255) && *ptr != '-' && *ptr != '.' &&
-	        *ptr != '_')
-	      break;
-	  }
 
-	  if (*ptr || ptr == attr->values[i].string.text)
-	  {
-	    ipp_set_error(IPP_STATUS_ERROR_BAD_REQUEST, _("\"%s\": Bad keyword value \"%s\" - invalid character (RFC 8011 section 5.1.4)."), attr->name, attr->values[i].string.text);
-	    return (0);
-	  }
+  DEBUG_printf(("4ipp_free_values(attr=%p, element=%d, count=%d)", (void *)attr, element, count));
 
-	  if ((ptr - attr->values[i].string.text) > (IPP_MAX_KEYWORD - 1))
+  if (!(attr->value_tag & IPP_TAG_CUPS_CONST))
+  {
+   /*
+    * Free values as needed...
+    */
+
+    switch (attr->value_tag)
+    {
+      case IPP_TAG_TEXTLANG :
+      case IPP_TAG_NAMELANG :
+	  if (element == 0 && count == attr->num_values &&
+	      attr->values[0].string.language)
 	  {
-	    ipp_set_error(IPP_STATUS_ERROR_BAD_REQUEST, _("\"%s\": Bad keyword value \"%s\" - bad length %d (RFC 8011 section 5.1.4)."), attr->name, attr->values[i].string.text, (int)(ptr - attr->values[i].string.text));
-	    return (0);
+	    _cupsStrFree(attr->values[0].string.language);
+	    attr->values[0].string.language = NULL;
 	  }
-	}
-        break;
-
-    case IPP_TAG_URI :
-        for (i = 0; i < attr->num_values; i ++)
-	{
-	  uri_status = httpSeparateURI(HTTP_URI_CODING_ALL, attr->values[i].string.text, scheme, sizeof(scheme), userpass, sizeof(userpass), hostname, sizeof(hostname), &port, resource, sizeof(resource));
+	  /* Fall through to other string values */
 
-	  if (uri_status < HTTP_URI_STATUS_OK)
+      case IPP_TAG_TEXT :
+      case IPP_TAG_NAME :
+      case IPP_TAG_RESERVED_STRING :
+      case IPP_TAG_KEYWORD :
+      case IPP_TAG_URI :
+      case IPP_TAG_URISCHEME :
+      case IPP_TAG_CHARSET :
+      case IPP_TAG_LANGUAGE :
+      case IPP_TAG_MIMETYPE :
+	  for (i = count, value = attr->values + element;
+	       i > 0;
+	       i --, value ++)
 	  {
-	    ipp_set_error(IPP_STATUS_ERROR_BAD_REQUEST, _("\"%s\": Bad URI value \"%s\" - %s (RFC 8011 section 5.1.6)."), attr->name, attr->values[i].string.text, httpURIStatusString(uri_status));
-	    return (0);
+	    _cupsStrFree(value->string.text);
+	    value->string.text = NULL;
 	  }
+	  break;
 
-	  if (strlen(attr->values[i].string.text) > (IPP_MAX_URI - 1))
+      case IPP_TAG_UNSUPPORTED_VALUE :
+      case IPP_TAG_DEFAULT :
+      case IPP_TAG_UNKNOWN :
+      case IPP_TAG_NOVALUE :
+      case IPP_TAG_NOTSETTABLE :
+      case IPP_TAG_DELETEATTR :
+      case IPP_TAG_ADMINDEFINE :
+      case IPP_TAG_INTEGER :
+      case IPP_TAG_ENUM :
+      case IPP_TAG_BOOLEAN :
+      case IPP_TAG_DATE :
+      case IPP_TAG_RESOLUTION :
+      case IPP_TAG_RANGE :
+	  break;
+
+      case IPP_TAG_BEGIN_COLLECTION :
+	  for (i = count, value = attr->values + element;
+	       i > 0;
+	       i --, value ++)
 	  {
-	    ipp_set_error(IPP_STATUS_ERROR_BAD_REQUEST, _("\"%s\": Bad URI value \"%s\" - bad length %d (RFC 8011 section 5.1.6)."), attr->name, attr->values[i].string.text, (int)strlen(attr->values[i].string.text));
+	    ippDelete(value->collection);
+	    value->collection = NULL;
 	  }
-	}
-        break;
+	  break;
 
-    case IPP_TAG_URISCHEME :
-        for (i = 0; i < attr->num_values; i ++)
-	{
-	  ptr = attr->values[i].string.text;
-	  if (islower(*ptr & 255))
+      case IPP_TAG_STRING :
+      default :
+	  for (i = count, value = attr->values + element;
+	       i > 0;
+	       i --, value ++)
 	  {
-	    for (ptr ++; *ptr; ptr ++)
+	    if (value->unknown.data)
 	    {
-	      if (!islower(*ptr & 255) && !isdigit(*ptr & 255) &&
-	          *ptr != '+' && *ptr != '-' && *ptr != '.')
-                break;
+	      free(value->unknown.data);
+	      value->unknown.data = NULL;
 	    }
 	  }
+	  break;
+    }
+  }
 
-	  if (*ptr || ptr == attr->values[i].string.text)
-	  {
-	    ipp_set_error(IPP_STATUS_ERROR_BAD_REQUEST, _("\"%s\": Bad uriScheme value \"%s\" - bad characters (RFC 8011 section 5.1.7)."), attr->name, attr->values[i].string.text);
-	    return (0);
-	  }
+ /*
+  * If we are not freeing values from the end, move the remaining values up...
+  */
 
-	  if ((ptr - attr->values[i].string.text) > (IPP_MAX_URISCHEME - 1))
-	  {
-	    ipp_set_error(IPP_STATUS_ERROR_BAD_REQUEST, _("\"%s\": Bad uriScheme value \"%s\" - bad length %d (RFC 8011 section 5.1.7)."), attr->name, attr->values[i].string.text, (int)(ptr - attr->values[i].string.text));
-	    return (0);
-	  }
-	}
-        break;
+  if ((element + count) < attr->num_values)
+    memmove(attr->values + element, attr->values + element + count,
+            (size_t)(attr->num_values - count - element) * sizeof(_ipp_value_t));
 
-    case IPP_TAG_CHARSET :
-        for (i = 0; i < attr->num_values; i ++)
-	{
-	  for (ptr = attr->values[i].string.text; *ptr; ptr ++)
-	  {
-	    if (!isprint(*ptr & 255) || isupper(*ptr & 255) ||
-	        isspace(*ptr & 255))
-	      break;
-	  }
-
-	  if (*ptr || ptr == attr->values[i].string.text)
-	  {
-	    ipp_set_error(IPP_STATUS_ERROR_BAD_REQUEST, _("\"%s\": Bad charset value \"%s\" - bad characters (RFC 8011 section 5.1.8)."), attr->name, attr->values[i].string.text);
-	    return (0);
-	  }
-
-	  if ((ptr - attr->values[i].string.text) > (IPP_MAX_CHARSET - 1))
-	  {
-	    ipp_set_error(IPP_STATUS_ERROR_BAD_REQUEST, _("\"%s\": Bad charset value \"%s\" - bad length %d (RFC 8011 section 5.1.8)."), attr->name, attr->values[i].string.text, (int)(ptr - attr->values[i].string.text));
-	    return (0);
-	  }
-	}
-        break;
-
-    case IPP_TAG_LANGUAGE :
-       /*
-        * The following regular expression is derived from the ABNF for
-	* language tags in RFC 4646.  All I can say is that this is the
-	* easiest way to check the values...
-	*/
+  attr->num_values -= count;
+}
 
-        if ((i = regcomp(&re,
-			 "^("
-			 "(([a-z]{2,3}(-[a-z][a-z][a-z]){0,3})|[a-z]{4,8})"
-								/* language */
-			 "(-[a-z][a-z][a-z][a-z]){0,1}"		/* script */
-			 "(-([a-z][a-z]|[0-9][0-9][0-9])){0,1}"	/* region */
-			 "(-([a-z]{5,8}|[0-9][0-9][0-9]))*"	/* variant */
-			 "(-[a-wy-z](-[a-z0-9]{2,8})+)*"	/* extension */
-			 "(-x(-[a-z0-9]{1,8})+)*"		/* privateuse */
-			 "|"
-			 "x(-[a-z0-9]{1,8})+"			/* privateuse */
-			 "|"
-			 "[a-z]{1,3}(-[a-z][0-9]{2,8}){1,2}"	/* grandfathered */
-			 ")$",
-			 REG_NOSUB | REG_EXTENDED)) != 0)
-        {
-          char	temp[256];		/* Temporary error string */
 
-          regerror(i, &re, temp, sizeof(temp));
-	  ipp_set_error(IPP_STATUS_ERROR_INTERNAL, _("Unable to compile naturalLanguage regular expression: %s."), temp);
-	  return (0);
-        }
+/*
+ * 'ipp_get_code()' - Convert a C locale/charset name into an IPP language/charset code.
+ *
+ * This typically converts strings of the form "ll_CC", "ll-REGION", and "CHARSET_NUMBER"
+ * to "ll-cc", "ll-region", and "charset-number", respectively.
+ */
 
-        for (i = 0; i < attr->num_values; i ++)
-	{
-	  if (regexec(&re, attr->values[i].string.text, 0, NULL, 0))
-	  {
-	    ipp_set_error(IPP_STATUS_ERROR_BAD_REQUEST, _("\"%s\": Bad naturalLanguage value \"%s\" - bad characters (RFC 8011 section 5.1.9)."), attr->name, attr->values[i].string.text);
-	    regfree(&re);
-	    return (0);
-	  }
+static char *				/* O - Language code string */
+ipp_get_code(const char *value,		/* I - Locale/charset string */
+             char       *buffer,	/* I - String buffer */
+             size_t     bufsize)	/* I - Size of string buffer */
+{
+  char	*bufptr,			/* Pointer into buffer */
+	*bufend;			/* End of buffer */
 
-	  if (strlen(attr->values[i].string.text) > (IPP_MAX_LANGUAGE - 1))
-	  {
-	    ipp_set_error(IPP_STATUS_ERROR_BAD_REQUEST, _("\"%s\": Bad naturalLanguage value \"%s\" - bad length %d (RFC 8011 section 5.1.9)."), attr->name, attr->values[i].string.text, (int)strlen(attr->values[i].string.text));
-	    regfree(&re);
-	    return (0);
-	  }
-	}
 
-	regfree(&re);
-        break;
+ /*
+  * Convert values to lowercase and change _ to - as needed...
+  */
 
-    case IPP_TAG_MIMETYPE :
-       /*
-        * The following regular expression is derived from the ABNF for
-	* MIME media types in RFC 2045 and 4288.  All I can say is that this is
-	* the easiest way to check the values...
-	*/
+  for (bufptr = buffer, bufend = buffer + bufsize - 1;
+       *value && bufptr < bufend;
+       value ++)
+    if (*value == '_')
+      *bufptr++ = '-';
+    else
+      *bufptr++ = (char)_cups_tolower(*value);
 
-        if ((i = regcomp(&re,
-			 "^"
-			 "[-a-zA-Z0-9!#$&.+^_]{1,127}"		/* type-name */
-			 "/"
-			 "[-a-zA-Z0-9!#$&.+^_]{1,127}"		/* subtype-name */
-			 "(;[-a-zA-Z0-9!#$&.+^_]{1,127}="	/* parameter= */
-			 "([-a-zA-Z0-9!#$&.+^_]{1,127}|\"[^\"]*\"))*"
-			 					/* value */
-			 "$",
-			 REG_NOSUB | REG_EXTENDED)) != 0)
-        {
-          char	temp[256];		/* Temporary error string */
+  *bufptr = '\0';
 
-          regerror(i, &re, temp, sizeof(temp));
-	  ipp_set_error(IPP_STATUS_ERROR_BAD_REQUEST, _("Unable to compile mimeMediaType regular expression: %s."), temp);
-	  return (0);
-        }
+ /*
+  * Return the converted string...
+  */
 
-        for (i = 0; i < attr->num_values; i ++)
-	{
-	  if (regexec(&re, attr->values[i].string.text, 0, NULL, 0))
-	  {
-	    ipp_set_error(IPP_STATUS_ERROR_BAD_REQUEST, _("\"%s\": Bad mimeMediaType value \"%s\" - bad characters (RFC 8011 section 5.1.10)."), attr->name, attr->values[i].string.text);
-	    regfree(&re);
-	    return (0);
-	  }
+  return (buffer);
+}
 
-	  if (strlen(attr->values[i].string.text) > (IPP_MAX_MIMETYPE - 1))
-	  {
-	    ipp_set_error(IPP_STATUS_ERROR_BAD_REQUEST, _("\"%s\": Bad mimeMediaType value \"%s\" - bad length %d (RFC 8011 section 5.1.10)."), attr->name, attr->values[i].string.text, (int)strlen(attr->values[i].string.text));
-	    regfree(&re);
-	    return (0);
-	  }
-	}
 
-	regfree(&re);
-        break;
+/*
+ * 'ipp_index_clear()' - Discard the attribute name index after a change.
+ */
 
-    default :
-        break;
+static void
+ipp_index_clear(ipp_t *ipp)		/* I - IPP message */
+{
+  if (ipp->index)
+  {
+    free(ipp->index);
+    ipp->index = NULL;
   }
 
-  return (1);
+  ipp->index_finds = 0;
 }
 
 
 /*
- * 'ippValidateAttributes()' - Validate all attributes in an IPP message.
- *
- * This function validates the contents of the IPP message, including each
- * attribute.  Like @link ippValidateAttribute@, @link cupsLastErrorString@ is
- * set to a human-readable message on failure.
+ * 'ipp_index_find()' - Find the name index slot for an attribute name.
  *
- * @since CUPS 1.7/macOS 10.9@
+ * The index is built lazily on the second lookup after a change, and only for
+ * messages with at least IPP_INDEX_MIN attributes.  NULL is returned when the
+ * message is not indexed, otherwise the returned slot's "attr" member is NULL
+ * when no attribute has the given name.
  */
 
-int					/* O - 1 if valid, 0 otherwise */
-ippValidateAttributes(ipp_t *ipp)	/* I - IPP message */
+static _ipp_islot_t *			/* O - Index slot or NULL if not indexed */
+ipp_index_find(ipp_t      *ipp,		/* I - IPP message */
+               const char *name)	/* I - Attribute name */
 {
-  ipp_attribute_t	*attr;		/* Current attribute */
+  _ipp_index_t		*index;		/* Name index */
+  _ipp_islot_t		*slot;		/* Current slot */
+  ipp_attribute_t	*attr,		/* Current attribute */
+			*prev;		/* Previous attribute */
+  size_t		count,		/* Number of attributes */
+			size,		/* Number of slots */
+			hash;		/* Hash value */
+  const char		*nameptr;	/* Pointer into name */
+  static _cups_mutex_t	index_mutex = _CUPS_MUTEX_INITIALIZER;
+					/* Mutex for building indices */
 
 
-  if (!ipp)
-    return (1);
+  if ((index = ipp->index) == NULL)
+  {
+   /*
+    * Don't index messages that are still being built or are only searched
+    * once...
+    */
 
-  for (attr = ipp->attrs; attr; attr = attr->next)
-    if (!ippValidateAttribute(attr))
-      return (0);
+    if (ipp->index_finds < 1)
+    {
+      ipp->index_finds ++;
+      return (NULL);
+    }
 
-  return (1);
-}
+    for (count = 0, attr = ipp->attrs; attr; attr = attr->next)
+      count ++;
 
+    if (count < IPP_INDEX_MIN)
+      return (NULL);
 
-/*
- * 'ippWrite()' - Write data for an IPP message to a HTTP connection.
- */
+   /*
+    * Build the index, keeping the first attribute for each name...
+    */
 
-ipp_state_t				/* O - Current state */
-ippWrite(http_t *http,			/* I - HTTP connection */
-         ipp_t  *ipp)			/* I - IPP data */
-{
-  DEBUG_printf(("ippWrite(http=%p, ipp=%p)", (void *)http, (void *)ipp));
+    _cupsMutexLock(&index_mutex);
 
-  if (!http)
-    return (IPP_STATE_ERROR);
+    if ((index = ipp->index) == NULL)
+    {
+      for (size = 32; size < 2 * count; size *= 2);
 
-  return (ippWriteIO(http, (ipp_iocb_t)httpWrite2, http->blocking, NULL, ipp));
+      if ((index = calloc(1, sizeof(_ipp_index_t) + (size - 1) * sizeof(_ipp_islot_t))) == NULL)
+      {
+        _cupsMutexUnlock(&index_mutex);
+        return (NULL);
+      }
+
+      index->mask = size - 1;
+
+      for (attr = ipp->attrs, prev = NULL; attr; prev = attr, attr = attr->next)
+      {
+        if (!attr->name)
+          continue;
+
+        for (hash = 0, nameptr = attr->name; *nameptr; nameptr ++)
+          hash = 31 * hash + (size_t)_cups_tolower(*nameptr);
+
+        for (slot = index->slots + (hash & index->mask); slot->attr; slot = index->slots + (hash & index->mask))
+        {
+          if (!_cups_strcasecmp(slot->attr->name, attr->name))
+            break;
+
+          hash ++;
+        }
+
+        if (!slot->attr)
+        {
+          slot->attr = attr;
+          slot->prev = prev;
+        }
+      }
+
+      ipp->index = index;
+    }
+
+    _cupsMutexUnlock(&index_mutex);
+  }
+
+ /*
+  * Look up the name...
+  */
+
+  for (hash = 0, nameptr = name; *nameptr; nameptr ++)
+    hash = 31 * hash + (size_t)_cups_tolower(*nameptr);
+
+  for (slot = index->slots + (hash & index->mask); slot->attr; slot = index->slots + (hash & index->mask))
+  {
+    if (!_cups_strcasecmp(slot->attr->name, name))
+      break;
+
+    hash ++;
+  }
+
+  return (slot);
 }
 
 
 /*
- * 'ippWriteFile()' - Write data for an IPP message to a file.
+ * 'ipp_lang_code()' - Convert a C locale name into an IPP language code.
  *
- * @since CUPS 1.1.19/macOS 10.3@
+ * This typically converts strings of the form "ll_CC" and "ll-REGION" to "ll-cc" and
+ * "ll-region", respectively.  It also converts the "C" (POSIX) locale to "en".
  */
 
-ipp_state_t				/* O - Current state */
-ippWriteFile(int   fd,			/* I - HTTP data */
-             ipp_t *ipp)		/* I - IPP data */
+static char *				/* O - Language code string */
+ipp_lang_code(const char *locale,	/* I - Locale string */
+              char       *buffer,	/* I - String buffer */
+              size_t     bufsize)	/* I - Size of string buffer */
 {
-  DEBUG_printf(("ippWriteFile(fd=%d, ipp=%p)", fd, (void *)ipp));
-
-  ipp->state = IPP_STATE_IDLE;
+ /*
+  * Map POSIX ("C") locale to generic English, otherwise convert the locale string as-is.
+  */
 
-  return (ippWriteIO(&fd, (ipp_iocb_t)ipp_write_file, 1, NULL, ipp));
+  if (!_cups_strcasecmp(locale, "c"))
+  {
+    strlcpy(buffer, "en", bufsize);
+    return (buffer);
+  }
+  else
+    return (ipp_get_code(locale, buffer, bufsize));
 }
 
 
 /*
- * 'ippWriteIO()' - Write data for an IPP message.
- *
- * @since CUPS 1.2/macOS 10.5@
+ * 'ipp_length()' - Compute the length of an IPP message or collection value.
  */
 
-ipp_state_t				/* O - Current state */
-ippWriteIO(void       *dst,		/* I - Destination */
-           ipp_iocb_t cb,		/* I - Write callback function */
-	   int        blocking,		/* I - Use blocking IO? */
-	   ipp_t      *parent,		/* I - Parent IPP message */
-           ipp_t      *ipp)		/* I - IPP data */
+static size_t				/* O - Size of IPP message */
+ipp_length(ipp_t *ipp,			/* I - IPP message or collection */
+           int   collection)		/* I - 1 if a collection, 0 otherwise */
 {
   int			i;		/* Looping var */
-  int			n;		/* Length of data */
-  unsigned char		*buffer,	/* Data buffer */
-			*bufptr;	/* Pointer into buffer */
+  size_t		bytes;		/* Number of bytes */
   ipp_attribute_t	*attr;		/* Current attribute */
+  ipp_tag_t		group;		/* Current group */
   _ipp_value_t		*value;		/* Current value */
 
 
-  DEBUG_printf(("ippWriteIO(dst=%p, cb=%p, blocking=%d, parent=%p, ipp=%p)", (void *)dst, (void *)cb, blocking, (void *)parent, (void *)ipp));
+  DEBUG_printf(("3ipp_length(ipp=%p, collection=%d)", (void *)ipp, collection));
 
-  if (!dst || !ipp)
-    return (IPP_STATE_ERROR);
-
-  if ((buffer = (unsigned char *)_cupsBufferGet(IPP_BUF_SIZE)) == NULL)
+  if (!ipp)
   {
-    DEBUG_puts("1ippWriteIO: Unable to get write buffer");
-    return (IPP_STATE_ERROR);
+    DEBUG_puts("4ipp_length: Returning 0 bytes");
+    return (0);
   }
 
-  switch (ipp->state)
+ /*
+  * Start with 8 bytes for the IPP message header...
+  */
+
+  bytes = collection ? 0 : 8;
+
+ /*
+  * Then add the lengths of each attribute...
+  */
+
+  group = IPP_TAG_ZERO;
+
+  for (attr = ipp->attrs; attr != NULL; attr = attr->next)
   {
-    case IPP_STATE_IDLE :
-        ipp->state ++; /* Avoid common problem... */
+    if (attr->group_tag != group && !collection)
+    {
+      group = attr->group_tag;
+      if (group == IPP_TAG_ZERO)
+	continue;
 
-    case IPP_STATE_HEADER :
-        if (parent == NULL)
-	{
-	 /*
-	  * Send the request header:
-	  *
-	  *                 Version = 2 bytes
-	  *   Operation/Status Code = 2 bytes
-	  *              Request ID = 4 bytes
-	  *                   Total = 8 bytes
-	  */
+      bytes ++;	/* Group tag */
+    }
 
-          bufptr = buffer;
+    if (!attr->name)
+      continue;
 
-	  *bufptr++ = ipp->request.any.version[0];
-	  *bufptr++ = ipp->request.any.version[1];
-	  *bufptr++ = (ipp_uchar_t)(ipp->request.any.op_status >> 8);
-	  *bufptr++ = (ipp_uchar_t)ipp->request.any.op_status;
-	  *bufptr++ = (ipp_uchar_t)(ipp->request.any.request_id >> 24);
-	  *bufptr++ = (ipp_uchar_t)(ipp->request.any.request_id >> 16);
-	  *bufptr++ = (ipp_uchar_t)(ipp->request.any.request_id >> 8);
-	  *bufptr++ = (ipp_uchar_t)ipp->request.any.request_id;
+    DEBUG_printf(("5ipp_length: attr->name=\"%s\", attr->num_values=%d, "
+                  "bytes=" CUPS_LLFMT, attr->name, attr->num_values, CUPS_LLCAST bytes));
 
-	  DEBUG_printf(("2ippWriteIO: version=%d.%d", buffer[0], buffer[1]));
-	  DEBUG_printf(("2ippWriteIO: op_status=%04x",
-			ipp->request.any.op_status));
-	  DEBUG_printf(("2ippWriteIO: request_id=%d",
-			ipp->request.any.request_id));
+    if ((attr->value_tag & ~IPP_TAG_CUPS_CONST) < IPP_TAG_EXTENSION)
+      bytes += (size_t)attr->num_values;/* Value tag for each value */
+    else
+      bytes += (size_t)(5 * attr->num_values);
+					/* Value tag for each value */
+    bytes += (size_t)(2 * attr->num_values);
+					/* Name lengths */
+    bytes += strlen(attr->name);	/* Name */
+    bytes += (size_t)(2 * attr->num_values);
+					/* Value lengths */
 
-          if ((*cb)(dst, buffer, (size_t)(bufptr - buffer)) < 0)
-	  {
-	    DEBUG_puts("1ippWriteIO: Could not write IPP header...");
-	    _cupsBufferRelease((char *)buffer);
-	    return (IPP_STATE_ERROR);
-	  }
-	}
+    if (collection)
+      bytes += 5;			/* Add membername overhead */
 
-       /*
-	* Reset the state engine to point to the first attribute
-	* in the request/response, with no current group.
-	*/
+    switch (attr->value_tag & ~IPP_TAG_CUPS_CONST)
+    {
+      case IPP_TAG_UNSUPPORTED_VALUE :
+      case IPP_TAG_DEFAULT :
+      case IPP_TAG_UNKNOWN :
+      case IPP_TAG_NOVALUE :
+      case IPP_TAG_NOTSETTABLE :
+      case IPP_TAG_DELETEATTR :
+      case IPP_TAG_ADMINDEFINE :
+          break;
 
-        ipp->state   = IPP_STATE_ATTRIBUTE;
-	ipp->current = ipp->attrs;
-	ipp->curtag  = IPP_TAG_ZERO;
+      case IPP_TAG_INTEGER :
+      case IPP_TAG_ENUM :
+          bytes += (size_t)(4 * attr->num_values);
+	  break;
 
-	DEBUG_printf(("1ippWriteIO: ipp->current=%p", (void *)ipp->current));
+      case IPP_TAG_BOOLEAN :
+          bytes += (size_t)attr->num_values;
+	  break;
 
-       /*
-        * If blocking is disabled, stop here...
-	*/
+      case IPP_TAG_TEXT :
+      case IPP_TAG_NAME :
+      case IPP_TAG_KEYWORD :
+      case IPP_TAG_URI :
+      case IPP_TAG_URISCHEME :
+      case IPP_TAG_CHARSET :
+      case IPP_TAG_LANGUAGE :
+      case IPP_TAG_MIMETYPE :
+	  for (i = 0, value = attr->values;
+	       i < attr->num_values;
+	       i ++, value ++)
+	    if (value->string.text)
+	      bytes += strlen(value->string.text);
+	  break;
 
-        if (!blocking)
+      case IPP_TAG_DATE :
+          bytes += (size_t)(11 * attr->num_values);
 	  break;
 
-    case IPP_STATE_ATTRIBUTE :
-        while (ipp->current != NULL)
-	{
-	 /*
-	  * Write this attribute...
-	  */
+      case IPP_TAG_RESOLUTION :
+          bytes += (size_t)(9 * attr->num_values);
+	  break;
 
-	  bufptr = buffer;
-	  attr   = ipp->current;
+      case IPP_TAG_RANGE :
+          bytes += (size_t)(8 * attr->num_values);
+	  break;
 
-	  ipp->current = ipp->current->next;
+      case IPP_TAG_TEXTLANG :
+      case IPP_TAG_NAMELANG :
+          bytes += (size_t)(4 * attr->num_values);
+					/* Charset + text length */
 
-          if (!parent)
+	  for (i = 0, value = attr->values;
+	       i < attr->num_values;
+	       i ++, value ++)
 	  {
-	    if (ipp->curtag != attr->group_tag)
-	    {
-	     /*
-	      * Send a group tag byte...
-	      */
+	    if (value->string.language)
+	      bytes += strlen(value->string.language);
 
-	      ipp->curtag = attr->group_tag;
+	    if (value->string.text)
+	      bytes += strlen(value->string.text);
+	  }
+	  break;
 
-	      if (attr->group_tag == IPP_TAG_ZERO)
-		continue;
+      case IPP_TAG_BEGIN_COLLECTION :
+	  for (i = 0, value = attr->values;
+	       i < attr->num_values;
+	       i ++, value ++)
+            bytes += ipp_length(value->collection, 1);
+	  break;
 
-	      DEBUG_printf(("2ippWriteIO: wrote group tag=%x(%s)",
-			    attr->group_tag, ippTagString(attr->group_tag)));
-	      *bufptr++ = (ipp_uchar_t)attr->group_tag;
-	    }
-	    else if (attr->group_tag == IPP_TAG_ZERO)
-	      continue;
-	  }
+      default :
+	  for (i = 0, value = attr->values;
+	       i < attr->num_values;
+	       i ++, value ++)
+            bytes += (size_t)value->unknown.length;
+	  break;
+    }
+  }
 
-	  DEBUG_printf(("1ippWriteIO: %s (%s%s)", attr->name,
-	                attr->num_values > 1 ? "1setOf " : "",
-			ippTagString(attr->value_tag)));
+ /*
+  * Finally, add 1 byte for the "end of attributes" tag or 5 bytes
+  * for the "end of collection" tag and return...
+  */
 
-         /*
-	  * Write the attribute tag and name.
-	  *
-	  * The attribute name length does not include the trailing nul
-	  * character in the source string.
-	  *
-	  * Collection values (parent != NULL) are written differently...
-	  */
+  if (collection)
+    bytes += 5;
+  else
+    bytes ++;
 
-          if (parent == NULL)
-	  {
-           /*
-	    * Get the length of the attribute name, and make sure it won't
-	    * overflow the buffer...
-	    */
+  DEBUG_printf(("4ipp_length: Returning " CUPS_LLFMT " bytes", CUPS_LLCAST bytes));
 
-            if ((n = (int)strlen(attr->name)) > (IPP_BUF_SIZE - 8))
-	    {
-	      DEBUG_printf(("1ippWriteIO: Attribute name too long (%d)", n));
-	      _cupsBufferRelease((char *)buffer);
-	      return (IPP_STATE_ERROR);
-	    }
+  return (bytes);
+}
 
-           /*
-	    * Write the value tag, name length, and name string...
-	    */
 
-            DEBUG_printf(("2ippWriteIO: writing value tag=%x(%s)",
-	                  attr->value_tag, ippTagString(attr->value_tag)));
-            DEBUG_printf(("2ippWriteIO: writing name=%d,\"%s\"", n,
-	                  attr->name));
+/*
+ * 'ipp_read_http()' - Semi-blocking read on a HTTP connection...
+ */
 
-            if (attr->value_tag > 0xff)
-            {
-              *bufptr++ = IPP_TAG_EXTENSION;
-	      *bufptr++ = (ipp_uchar_t)(attr->value_tag >> 24);
-	      *bufptr++ = (ipp_uchar_t)(attr->value_tag >> 16);
-	      *bufptr++ = (ipp_uchar_t)(attr->value_tag >> 8);
-	      *bufptr++ = (ipp_uchar_t)attr->value_tag;
-            }
-            else
-	      *bufptr++ = (ipp_uchar_t)attr->value_tag;
+static ssize_t				/* O - Number of bytes read */
+ipp_read_http(http_t      *http,	/* I - Client connection */
+              ipp_uchar_t *buffer,	/* O - Buffer for data */
+	      size_t      length)	/* I - Total length */
+{
+  ssize_t	tbytes,			/* Total bytes read */
+		bytes;			/* Bytes read this pass */
 
-	    *bufptr++ = (ipp_uchar_t)(n >> 8);
-	    *bufptr++ = (ipp_uchar_t)n;
-	    memcpy(bufptr, attr->name, (size_t)n);
-	    bufptr += n;
-          }
-	  else
-	  {
-           /*
-	    * Get the length of the attribute name, and make sure it won't
-	    * overflow the buffer...
-	    */
 
-            if ((n = (int)strlen(attr->name)) > (IPP_BUF_SIZE - 12))
-	    {
-	      DEBUG_printf(("1ippWriteIO: Attribute name too long (%d)", n));
-	      _cupsBufferRelease((char *)buffer);
-	      return (IPP_STATE_ERROR);
-	    }
+  DEBUG_printf(("7ipp_read_http(http=%p, buffer=%p, length=%d)", (void *)http, (void *)buffer, (int)length));
 
-           /*
-	    * Write the member name tag, name length, name string, value tag,
-	    * and empty name for the collection member attribute...
-	    */
+ /*
+  * Loop until all bytes are read...
+  */
 
-            DEBUG_printf(("2ippWriteIO: writing value tag=%x(memberName)",
-	                  IPP_TAG_MEMBERNAME));
-            DEBUG_printf(("2ippWriteIO: writing name=%d,\"%s\"", n,
-	                  attr->name));
-            DEBUG_printf(("2ippWriteIO: writing value tag=%x(%s)",
-	                  attr->value_tag, ippTagString(attr->value_tag)));
-            DEBUG_puts("2ippWriteIO: writing name=0,\"\"");
+  for (tbytes = 0, bytes = 0;
+       tbytes < (int)length;
+       tbytes += bytes, buffer += bytes)
+  {
+    DEBUG_printf(("9ipp_read_http: tbytes=" CUPS_LLFMT ", http->state=%d", CUPS_LLCAST tbytes, http->state));
 
-            *bufptr++ = IPP_TAG_MEMBERNAME;
-	    *bufptr++ = 0;
-	    *bufptr++ = 0;
-	    *bufptr++ = (ipp_uchar_t)(n >> 8);
-	    *bufptr++ = (ipp_uchar_t)n;
-	    memcpy(bufptr, attr->name, (size_t)n);
-	    bufptr += n;
+    if (http->state == HTTP_STATE_WAITING)
+      break;
 
-            if (attr->value_tag > 0xff)
-            {
-              *bufptr++ = IPP_TAG_EXTENSION;
-	      *bufptr++ = (ipp_uchar_t)(attr->value_tag >> 24);
-	      *bufptr++ = (ipp_uchar_t)(attr->value_tag >> 16);
-	      *bufptr++ = (ipp_uchar_t)(attr->value_tag >> 8);
-	      *bufptr++ = (ipp_uchar_t)attr->value_tag;
-            }
-            else
-	      *bufptr++ = (ipp_uchar_t)attr->value_tag;
+    if (http->used == 0 && !http->blocking)
+    {
+     /*
+      * Wait up to 10 seconds for more data on non-blocking sockets...
+      */
 
-            *bufptr++ = 0;
-            *bufptr++ = 0;
-	  }
+      if (!httpWait(http, 10000))
+      {
+       /*
+	* Signal no data...
+	*/
 
-         /*
-	  * Now write the attribute value(s)...
-	  */
+	bytes = -1;
+	break;
+      }
+    }
+    else if (http->used == 0 && http->timeout_value > 0)
+    {
+     /*
+      * Wait up to timeout seconds for more data on blocking sockets...
+      */
 
-	  switch (attr->value_tag & ~IPP_TAG_CUPS_CONST)
-	  {
-	    case IPP_TAG_UNSUPPORTED_VALUE :
-	    case IPP_TAG_DEFAULT :
-	    case IPP_TAG_UNKNOWN :
-	    case IPP_TAG_NOVALUE :
-	    case IPP_TAG_NOTSETTABLE :
-	    case IPP_TAG_DELETEATTR :
-	    case IPP_TAG_ADMINDEFINE :
-		*bufptr++ = 0;
-		*bufptr++ = 0;
-	        break;
+      if (!httpWait(http, (int)(1000 * http->timeout_value)))
+      {
+       /*
+	* Signal no data...
+	*/
 
-	    case IPP_TAG_INTEGER :
-	    case IPP_TAG_ENUM :
-	        for (i = 0, value = attr->values;
-		     i < attr->num_values;
-		     i ++, value ++)
-		{
-                  if ((IPP_BUF_SIZE - (bufptr - buffer)) < 9)
-		  {
-                    if ((*cb)(dst, buffer, (size_t)(bufptr - buffer)) < 0)
-	            {
-	              DEBUG_puts("1ippWriteIO: Could not write IPP "
-		                 "attribute...");
-		      _cupsBufferRelease((char *)buffer);
-	              return (IPP_STATE_ERROR);
-	            }
+	bytes = -1;
+	break;
+      }
+    }
 
-		    bufptr = buffer;
-		  }
+    if ((bytes = httpRead2(http, (char *)buffer, length - (size_t)tbytes)) < 0)
+    {
+#ifdef _WIN32
+      break;
+#else
+      if (errno != EAGAIN && errno != EINTR)
+	break;
 
-		  if (i)
-		  {
-		   /*
-		    * Arrays and sets are done by sending additional
-		    * values with a zero-length name...
-		    */
+      bytes = 0;
+#endif /* _WIN32 */
+    }
+    else if (bytes == 0)
+      break;
+  }
 
-                    *bufptr++ = (ipp_uchar_t)attr->value_tag;
-		    *bufptr++ = 0;
-		    *bufptr++ = 0;
-		  }
+ /*
+  * Return the number of bytes read...
+  */
 
-		 /*
-	          * Integers and enumerations are both 4-byte signed
-		  * (twos-complement) values.
-		  *
-		  * Put the 2-byte length and 4-byte value into the buffer...
-		  */
+  if (tbytes == 0 && bytes < 0)
+    tbytes = -1;
 
-	          *bufptr++ = 0;
-		  *bufptr++ = 4;
-		  *bufptr++ = (ipp_uchar_t)(value->integer >> 24);
-		  *bufptr++ = (ipp_uchar_t)(value->integer >> 16);
-		  *bufptr++ = (ipp_uchar_t)(value->integer >> 8);
-		  *bufptr++ = (ipp_uchar_t)value->integer;
-		}
-		break;
+  DEBUG_printf(("8ipp_read_http: Returning " CUPS_LLFMT " bytes", CUPS_LLCAST tbytes));
 
-	    case IPP_TAG_BOOLEAN :
-	        for (i = 0, value = attr->values;
-		     i < attr->num_values;
-		     i ++, value ++)
-		{
-                  if ((IPP_BUF_SIZE - (bufptr - buffer)) < 6)
-		  {
-                    if ((*cb)(dst, buffer, (size_t)(bufptr - buffer)) < 0)
-	            {
-	              DEBUG_puts("1ippWriteIO: Could not write IPP "
-		                 "attribute...");
-		      _cupsBufferRelease((char *)buffer);
-	              return (IPP_STATE_ERROR);
-	            }
+  return (tbytes);
+}
 
-		    bufptr = buffer;
-		  }
 
-		  if (i)
-		  {
-		   /*
-		    * Arrays and sets are done by sending additional
-		    * values with a zero-length name...
-		    */
+/*
+ * 'ipp_read_file()' - Read IPP data from a file.
+ */
 
-                    *bufptr++ = (ipp_uchar_t)attr->value_tag;
-		    *bufptr++ = 0;
-		    *bufptr++ = 0;
-		  }
+static ssize_t				/* O - Number of bytes read */
+ipp_read_file(int         *fd,		/* I - File descriptor */
+              ipp_uchar_t *buffer,	/* O - Read buffer */
+	      size_t      length)	/* I - Number of bytes to read */
+{
+#ifdef _WIN32
+  return ((ssize_t)read(*fd, buffer, (unsigned)length));
+#else
+  return (read(*fd, buffer, length));
+#endif /* _WIN32 */
+}
 
-                 /*
-		  * Boolean values are 1-byte; 0 = false, 1 = true.
-		  *
-		  * Put the 2-byte length and 1-byte value into the buffer...
-		  */
 
-	          *bufptr++ = 0;
-		  *bufptr++ = 1;
-		  *bufptr++ = (ipp_uchar_t)value->boolean;
-		}
-		break;
+/*
+ * 'ipp_read_io()' - Read data for an IPP message.
+ */
 
-	    case IPP_TAG_TEXT :
-	    case IPP_TAG_NAME :
-	    case IPP_TAG_KEYWORD :
-	    case IPP_TAG_URI :
-	    case IPP_TAG_URISCHEME :
-	    case IPP_TAG_CHARSET :
-	    case IPP_TAG_LANGUAGE :
-	    case IPP_TAG_MIMETYPE :
-	        for (i = 0, value = attr->values;
-		     i < attr->num_values;
-		     i ++, value ++)
-		{
-		  if (i)
-		  {
-		   /*
-		    * Arrays and sets are done by sending additional
-		    * values with a zero-length name...
-		    */
+static ipp_state_t			/* O - Current state */
+ipp_read_io(void       *src,		/* I - Data source */
+            ipp_iocb_t cb,		/* I - Read callback function */
+	    int        blocking,	/* I - Use blocking IO? */
+	    ipp_t      *parent,		/* I - Parent request, if any */
+            ipp_t      *ipp,		/* I - IPP data */
+            int        depth)		/* I - Depth of collection */
+{
+  int			n;		/* Length of data */
+  unsigned char		*buffer,	/* Data buffer */
+			string[IPP_MAX_TEXT],
+					/* Small string buffer */
+			*bufptr;	/* Pointer into buffer */
+  ipp_attribute_t	*attr;		/* Current attribute */
+  ipp_tag_t		tag;		/* Current tag */
+  ipp_tag_t		value_tag;	/* Current value tag */
+  _ipp_value_t		*value;		/* Current value */
 
-        	    DEBUG_printf(("2ippWriteIO: writing value tag=%x(%s)",
-		                  attr->value_tag,
-				  ippTagString(attr->value_tag)));
-        	    DEBUG_printf(("2ippWriteIO: writing name=0,\"\""));
 
-                    if ((IPP_BUF_SIZE - (bufptr - buffer)) < 3)
-		    {
-                      if ((*cb)(dst, buffer, (size_t)(bufptr - buffer)) < 0)
-	              {
-	        	DEBUG_puts("1ippWriteIO: Could not write IPP "
-			           "attribute...");
-			_cupsBufferRelease((char *)buffer);
-	        	return (IPP_STATE_ERROR);
-	              }
+  DEBUG_printf(("4ipp_read_io(src=%p, cb=%p, blocking=%d, parent=%p, ipp=%p, depth=%d)", (void *)src, (void *)cb, blocking, (void *)parent, (void *)ipp, depth));
+  DEBUG_printf(("2ipp_read_io: ipp->state=%d", ipp ? ipp->state : IPP_STATE_ERROR));
 
-		      bufptr = buffer;
-		    }
+  if (!src || !ipp)
+    return (IPP_STATE_ERROR);
 
-                    *bufptr++ = (ipp_uchar_t)attr->value_tag;
-		    *bufptr++ = 0;
-		    *bufptr++ = 0;
-		  }
+  if (depth > IPP_MAX_DEPTH)
+  {
+   /*
+    * Limit the nesting of collections so that a request cannot use an
+    * unbounded amount of stack and buffer memory...
+    */
 
-                  if (value->string.text != NULL)
-                    n = (int)strlen(value->string.text);
-		  else
-		    n = 0;
+    _cupsSetError(IPP_STATUS_ERROR_INTERNAL, _("IPP collections nested too deeply."), 1);
+    DEBUG_printf(("1ipp_read_io: collection depth %d exceeds %d.", depth, IPP_MAX_DEPTH));
+    return (IPP_STATE_ERROR);
+  }
 
-                  if (n > (IPP_BUF_SIZE - 2))
-		  {
-		    DEBUG_printf(("1ippWriteIO: String too long (%d)", n));
-		    _cupsBufferRelease((char *)buffer);
-		    return (IPP_STATE_ERROR);
-		  }
+  if ((buffer = (unsigned char *)_cupsBufferGet(IPP_BUF_SIZE)) == NULL)
+  {
+    DEBUG_puts("1ipp_read_io: Unable to get read buffer.");
+    return (IPP_STATE_ERROR);
+  }
 
-                  DEBUG_printf(("2ippWriteIO: writing string=%d,\"%s\"", n,
-		                value->string.text));
+  switch (ipp->state)
+  {
+    case IPP_STATE_IDLE :
+        ipp->state ++; /* Avoid common problem... */
 
-                  if ((int)(IPP_BUF_SIZE - (bufptr - buffer)) < (n + 2))
-		  {
-                    if ((*cb)(dst, buffer, (size_t)(bufptr - buffer)) < 0)
-	            {
-	              DEBUG_puts("1ippWriteIO: Could not write IPP "
-		                 "attribute...");
-		      _cupsBufferRelease((char *)buffer);
-	              return (IPP_STATE_ERROR);
-	            }
+    case IPP_STATE_HEADER :
+        if (parent == NULL)
+	{
+	 /*
+          * Get the request header...
+	  */
 
-		    bufptr = buffer;
-		  }
+          if ((*cb)(src, buffer, 8) < 8)
+	  {
+	    DEBUG_puts("1ipp_read_io: Unable to read header.");
+	    _cupsBufferRelease((char *)buffer);
+	    return (IPP_STATE_ERROR);
+	  }
 
-		 /*
-		  * All simple strings consist of the 2-byte length and
-		  * character data without the trailing nul normally found
-		  * in C strings.  Also, strings cannot be longer than IPP_MAX_LENGTH
-		  * bytes since the 2-byte length is a signed (twos-complement)
-		  * value.
-		  *
-		  * Put the 2-byte length and string characters in the buffer.
-		  */
+	 /*
+          * Then copy the request header over...
+	  */
 
-	          *bufptr++ = (ipp_uchar_t)(n >> 8);
-		  *bufptr++ = (ipp_uchar_t)n;
+          ipp->request.any.version[0]  = buffer[0];
+          ipp->request.any.version[1]  = buffer[1];
+          ipp->request.any.op_status   = (buffer[2] << 8) | buffer[3];
+          ipp->request.any.request_id  = (((((buffer[4] << 8) | buffer[5]) << 8) |
+	                        	 buffer[6]) << 8) | buffer[7];
 
-		  if (n > 0)
-		  {
-		    memcpy(bufptr, value->string.text, (size_t)n);
-		    bufptr += n;
-		  }
-		}
-		break;
+          DEBUG_printf(("2ipp_read_io: version=%d.%d", buffer[0], buffer[1]));
+	  DEBUG_printf(("2ipp_read_io: op_status=%04x",
+	                ipp->request.any.op_status));
+	  DEBUG_printf(("2ipp_read_io: request_id=%d",
+	                ipp->request.any.request_id));
+        }
 
-	    case IPP_TAG_DATE :
-	        for (i = 0, value = attr->values;
-		     i < attr->num_values;
-		     i ++, value ++)
-		{
-                  if ((IPP_BUF_SIZE - (bufptr - buffer)) < 16)
-		  {
-                    if ((*cb)(dst, buffer, (size_t)(bufptr - buffer)) < 0)
-	            {
-	              DEBUG_puts("1ippWriteIO: Could not write IPP "
-		                 "attribute...");
-		      _cupsBufferRelease((char *)buffer);
-	              return (IPP_STATE_ERROR);
-	            }
+        ipp->state   = IPP_STATE_ATTRIBUTE;
+	ipp->current = NULL;
+	ipp->curtag  = IPP_TAG_ZERO;
+	ipp->prev    = ipp->last;
 
-		    bufptr = buffer;
-		  }
+       /*
+        * If blocking is disabled, stop here...
+	*/
 
-		  if (i)
-		  {
-		   /*
-		    * Arrays and sets are done by sending additional
-		    * values with a zero-length name...
-		    */
+        if (!blocking)
+	  break;
 
-                    *bufptr++ = (ipp_uchar_t)attr->value_tag;
-		    *bufptr++ = 0;
-		    *bufptr++ = 0;
-		  }
+    case IPP_STATE_ATTRIBUTE :
+        for (;;)
+	{
+	  if ((*cb)(src, buffer, 1) < 1)
+	  {
+	    DEBUG_puts("1ipp_read_io: Callback returned EOF/error");
+	    _cupsBufferRelease((char *)buffer);
+	    return (IPP_STATE_ERROR);
+	  }
 
-                 /*
-		  * Date values consist of a 2-byte length and an
-		  * 11-byte date/time structure defined by RFC 1903.
-		  *
-		  * Put the 2-byte length and 11-byte date/time
-		  * structure in the buffer.
-		  */
+	  DEBUG_printf(("2ipp_read_io: ipp->current=%p, ipp->prev=%p", (void *)ipp->current, (void *)ipp->prev));
 
-	          *bufptr++ = 0;
-		  *bufptr++ = 11;
-		  memcpy(bufptr, value->date, 11);
-		  bufptr += 11;
-		}
-		break;
+	 /*
+	  * Read this attribute...
+	  */
 
-	    case IPP_TAG_RESOLUTION :
-	        for (i = 0, value = attr->values;
-		     i < attr->num_values;
-		     i ++, value ++)
-		{
-                  if ((IPP_BUF_SIZE - (bufptr - buffer)) < 14)
-		  {
-                    if ((*cb)(dst, buffer, (size_t)(bufptr - buffer)) < 0)
-	            {
-	              DEBUG_puts("1ippWriteIO: Could not write IPP "
-		                 "attribute...");
-		      _cupsBufferRelease((char *)buffer);
-		      return (IPP_STATE_ERROR);
-	            }
+          tag = (ipp_tag_t)buffer[0];
+          if (tag == IPP_TAG_EXTENSION)
+          {
+           /*
+            * Read 32-bit "extension" tag...
+            */
 
-		    bufptr = buffer;
-		  }
+	    if ((*cb)(src, buffer, 4) < 1)
+	    {
+	      DEBUG_puts("1ipp_read_io: Callback returned EOF/error");
+	      _cupsBufferRelease((char *)buffer);
+	      return (IPP_STATE_ERROR);
+	    }
 
-		  if (i)
-		  {
-		   /*
-		    * Arrays and sets are done by sending additional
-		    * values with a zero-length name...
-		    */
+	    tag = (ipp_tag_t)((((((buffer[0] << 8) | buffer[1]) << 8) |
+	                        buffer[2]) << 8) | buffer[3]);
+
+            if (tag & IPP_TAG_CUPS_CONST)
+            {
+             /*
+              * Fail if the high bit is set in the tag...
+              */
+
+	      _cupsSetError(IPP_STATUS_ERROR_INTERNAL, _("IPP extension tag larger than 0x7FFFFFFF."), 1);
+	      DEBUG_printf(("1ipp_read_io: bad tag 0x%x.", tag));
+	      _cupsBufferRelease((char *)buffer);
+	      return (IPP_STATE_ERROR);
+            }
+          }
+
+	  if (tag == IPP_TAG_END)
+	  {
+	   /*
+	    * No more attributes left...
+	    */
+
+            DEBUG_puts("2ipp_read_io: IPP_TAG_END.");
+
+	    ipp->state = IPP_STATE_DATA;
+	    break;
+	  }
+	  else if (tag == IPP_TAG_ZERO || (tag == IPP_TAG_OPERATION && ipp->curtag != IPP_TAG_ZERO))
+	  {
+	    _cupsSetError(IPP_STATUS_ERROR_INTERNAL, _("Invalid group tag."), 1);
+	    DEBUG_printf(("1ipp_read_io: bad tag 0x%02x.", tag));
+	    _cupsBufferRelease((char *)buffer);
+	    return (IPP_STATE_ERROR);
+	  }
+          else if (tag < IPP_TAG_UNSUPPORTED_VALUE)
+	  {
+	   /*
+	    * Group tag...  Set the current group and continue...
+	    */
+
+            if (ipp->curtag == tag)
+	      ipp->prev = ippAddSeparator(ipp);
+            else if (ipp->current)
+	      ipp->prev = ipp->current;
+
+	    ipp->curtag  = tag;
+	    ipp->current = NULL;
+	    DEBUG_printf(("2ipp_read_io: group tag=%x(%s), ipp->prev=%p", tag, ippTagString(tag), (void *)ipp->prev));
+	    continue;
+	  }
+
+          DEBUG_printf(("2ipp_read_io: value tag=%x(%s)", tag,
+	                ippTagString(tag)));
+
+         /*
+	  * Get the name...
+	  */
+
+          if ((*cb)(src, buffer, 2) < 2)
+	  {
+	    DEBUG_puts("1ipp_read_io: unable to read name length.");
+	    _cupsBufferRelease((char *)buffer);
+	    return (IPP_STATE_ERROR);
+	  }
+
+          n = (buffer[0] << 8) | buffer[1];
+
+          if (n >= IPP_BUF_SIZE)
+	  {
+	    _cupsSetError(IPP_STATUS_ERROR_INTERNAL, _("IPP name larger than 32767 bytes."), 1);
+	    DEBUG_printf(("1ipp_read_io: bad name length %d.", n));
+	    _cupsBufferRelease((char *)buffer);
+	    return (IPP_STATE_ERROR);
+	  }
+
+          DEBUG_printf(("2ipp_read_io: name length=%d", n));
+
+          if (n && parent)
+          {
+            _cupsSetError(IPP_STATUS_ERROR_INTERNAL, _("Invalid named IPP attribute in collection."), 1);
+            DEBUG_puts("1ipp_read_io: bad attribute name in collection.");
+	    _cupsBufferRelease((char *)buffer);
+            return (IPP_STATE_ERROR);
+          }
+          else if (n == 0 && tag != IPP_TAG_MEMBERNAME && tag != IPP_TAG_END_COLLECTION)
+	  {
+	   /*
+	    * More values for current attribute...
+	    */
+
+            if (ipp->current == NULL)
+	    {
+	      _cupsSetError(IPP_STATUS_ERROR_INTERNAL, _("IPP attribute has no name."), 1);
+	      DEBUG_puts("1ipp_read_io: Attribute without name and no current.");
+	      _cupsBufferRelease((char *)buffer);
+	      return (IPP_STATE_ERROR);
+	    }
+
+            attr      = ipp->current;
+	    value_tag = (ipp_tag_t)(attr->value_tag & IPP_TAG_CUPS_MASK);
+
+	   /*
+	    * Make sure we aren't adding a new value of a different
+	    * type...
+	    */
+
+	    if (value_tag == IPP_TAG_ZERO)
+	    {
+	     /*
+	      * Setting the value of a collection member...
+	      */
+
+	      attr->value_tag = tag;
+	    }
+	    else if (value_tag == IPP_TAG_TEXTLANG ||
+	             value_tag == IPP_TAG_NAMELANG ||
+		     (value_tag >= IPP_TAG_TEXT &&
+		      value_tag <= IPP_TAG_MIMETYPE))
+            {
+	     /*
+	      * String values can sometimes come across in different
+	      * forms; accept sets of differing values...
+	      */
+
+	      if (tag != IPP_TAG_TEXTLANG && tag != IPP_TAG_NAMELANG &&
+	          (tag < IPP_TAG_TEXT || tag > IPP_TAG_MIMETYPE) &&
+		  tag != IPP_TAG_NOVALUE)
+	      {
+		_cupsSetError(IPP_STATUS_ERROR_INTERNAL,
+		              _("IPP 1setOf attribute with incompatible value "
+		                "tags."), 1);
+		DEBUG_printf(("1ipp_read_io: 1setOf value tag %x(%s) != %x(%s)",
+			      value_tag, ippTagString(value_tag), tag,
+			      ippTagString(tag)));
+		_cupsBufferRelease((char *)buffer);
+	        return (IPP_STATE_ERROR);
+	      }
+
+              if (value_tag != tag)
+              {
+                DEBUG_printf(("1ipp_read_io: Converting %s attribute from %s to %s.",
+                              attr->name, ippTagString(value_tag), ippTagString(tag)));
+		ippSetValueTag(ipp, &attr, tag);
+	      }
+            }
+	    else if (value_tag == IPP_TAG_INTEGER ||
+	             value_tag == IPP_TAG_RANGE)
+            {
+	     /*
+	      * Integer and rangeOfInteger values can sometimes be mixed; accept
+	      * sets of differing values...
+	      */
+
+	      if (tag != IPP_TAG_INTEGER && tag != IPP_TAG_RANGE)
+	      {
+		_cupsSetError(IPP_STATUS_ERROR_INTERNAL,
+		              _("IPP 1setOf attribute with incompatible value "
+		                "tags."), 1);
+		DEBUG_printf(("1ipp_read_io: 1setOf value tag %x(%s) != %x(%s)",
+			      value_tag, ippTagString(value_tag), tag,
+			      ippTagString(tag)));
+		_cupsBufferRelease((char *)buffer);
+	        return (IPP_STATE_ERROR);
+	      }
+
+              if (value_tag == IPP_TAG_INTEGER && tag == IPP_TAG_RANGE)
+              {
+               /*
+                * Convert integer values to rangeOfInteger values...
+                */
+
+		DEBUG_printf(("1ipp_read_io: Converting %s attribute to "
+		              "rangeOfInteger.", attr->name));
+                ippSetValueTag(ipp, &attr, IPP_TAG_RANGE);
+              }
+            }
+	    else if (value_tag != tag)
+	    {
+	      _cupsSetError(IPP_STATUS_ERROR_INTERNAL,
+			    _("IPP 1setOf attribute with incompatible value "
+			      "tags."), 1);
+	      DEBUG_printf(("1ipp_read_io: value tag %x(%s) != %x(%s)",
+	                    value_tag, ippTagString(value_tag), tag,
+			    ippTagString(tag)));
+	      _cupsBufferRelease((char *)buffer);
+	      return (IPP_STATE_ERROR);
+            }
+
+           /*
+	    * Finally, reallocate the attribute array as needed...
+	    */
+
+	    if ((value = ipp_set_value(ipp, &attr, attr->num_values)) == NULL)
+	    {
+	      _cupsBufferRelease((char *)buffer);
+	      return (IPP_STATE_ERROR);
+	    }
+	  }
+	  else if (tag == IPP_TAG_MEMBERNAME)
+	  {
+	   /*
+	    * Name must be length 0!
+	    */
+
+	    if (n)
+	    {
+	      _cupsSetError(IPP_STATUS_ERROR_INTERNAL, _("IPP member name is not empty."), 1);
+	      DEBUG_puts("1ipp_read_io: member name not empty.");
+	      _cupsBufferRelease((char *)buffer);
+	      return (IPP_STATE_ERROR);
+	    }
+
+            if (ipp->current)
+	      ipp->prev = ipp->current;
+
+	    attr = ipp->current = ipp_add_attr(ipp, NULL, ipp->curtag, IPP_TAG_ZERO, 1);
+	    if (!attr)
+	    {
+	      _cupsSetHTTPError(HTTP_STATUS_ERROR);
+	      DEBUG_puts("1ipp_read_io: unable to allocate attribute.");
+	      _cupsBufferRelease((char *)buffer);
+	      return (IPP_STATE_ERROR);
+	    }
+
+	    DEBUG_printf(("2ipp_read_io: membername, ipp->current=%p, ipp->prev=%p", (void *)ipp->current, (void *)ipp->prev));
+
+	    value = attr->values;
+	  }
+	  else if (tag != IPP_TAG_END_COLLECTION)
+	  {
+	   /*
+	    * New attribute; read the name and add it...
+	    */
+
+	    if ((*cb)(src, buffer, (size_t)n) < n)
+	    {
+	      DEBUG_puts("1ipp_read_io: unable to read name.");
+	      _cupsBufferRelease((char *)buffer);
+	      return (IPP_STATE_ERROR);
+	    }
 
-                    *bufptr++ = (ipp_uchar_t)attr->value_tag;
-		    *bufptr++ = 0;
-		    *bufptr++ = 0;
-		  }
+	    buffer[n] = '\0';
 
-                 /*
-		  * Resolution values consist of a 2-byte length,
-		  * 4-byte horizontal resolution value, 4-byte vertical
-		  * resolution value, and a 1-byte units value.
-		  *
-		  * Put the 2-byte length and resolution value data
-		  * into the buffer.
-		  */
+            if (ipp->current)
+	      ipp->prev = ipp->current;
 
-	          *bufptr++ = 0;
-		  *bufptr++ = 9;
-		  *bufptr++ = (ipp_uchar_t)(value->resolution.xres >> 24);
-		  *bufptr++ = (ipp_uchar_t)(value->resolution.xres >> 16);
-		  *bufptr++ = (ipp_uchar_t)(value->resolution.xres >> 8);
-		  *bufptr++ = (ipp_uchar_t)value->resolution.xres;
-		  *bufptr++ = (ipp_uchar_t)(value->resolution.yres >> 24);
-		  *bufptr++ = (ipp_uchar_t)(value->resolution.yres >> 16);
-		  *bufptr++ = (ipp_uchar_t)(value->resolution.yres >> 8);
-		  *bufptr++ = (ipp_uchar_t)value->resolution.yres;
-		  *bufptr++ = (ipp_uchar_t)value->resolution.units;
-		}
-		break;
+	    if ((attr = ipp->current = ipp_add_attr(ipp, (char *)buffer, ipp->curtag, tag,
+	                                            1)) == NULL)
+	    {
+	      _cupsSetHTTPError(HTTP_STATUS_ERROR);
+	      DEBUG_puts("1ipp_read_io: unable to allocate attribute.");
+	      _cupsBufferRelease((char *)buffer);
+	      return (IPP_STATE_ERROR);
+	    }
 
-	    case IPP_TAG_RANGE :
-	        for (i = 0, value = attr->values;
-		     i < attr->num_values;
-		     i ++, value ++)
-		{
-                  if ((IPP_BUF_SIZE - (bufptr - buffer)) < 13)
-		  {
-                    if ((*cb)(dst, buffer, (size_t)(bufptr - buffer)) < 0)
-	            {
-	              DEBUG_puts("1ippWriteIO: Could not write IPP "
-		                 "attribute...");
-		      _cupsBufferRelease((char *)buffer);
-	              return (IPP_STATE_ERROR);
-	            }
+	    DEBUG_printf(("2ipp_read_io: name=\"%s\", ipp->current=%p, ipp->prev=%p", buffer, (void *)ipp->current, (void *)ipp->prev));
 
-		    bufptr = buffer;
-		  }
+	    value = attr->values;
+	  }
+	  else
+	  {
+	    attr  = NULL;
+	    value = NULL;
+	  }
 
-		  if (i)
-		  {
-		   /*
-		    * Arrays and sets are done by sending additional
-		    * values with a zero-length name...
-		    */
+	  if ((*cb)(src, buffer, 2) < 2)
+	  {
+	    DEBUG_puts("1ipp_read_io: unable to read value length.");
+	    _cupsBufferRelease((char *)buffer);
+	    return (IPP_STATE_ERROR);
+	  }
 
-                    *bufptr++ = (ipp_uchar_t)attr->value_tag;
-		    *bufptr++ = 0;
-		    *bufptr++ = 0;
-		  }
+	  n = (buffer[0] << 8) | buffer[1];
+          DEBUG_printf(("2ipp_read_io: value length=%d", n));
 
-                 /*
-		  * Range values consist of a 2-byte length,
-		  * 4-byte lower value, and 4-byte upper value.
-		  *
-		  * Put the 2-byte length and range value data
-		  * into the buffer.
-		  */
+	  if (n >= IPP_BUF_SIZE)
+	  {
+	    _cupsSetError(IPP_STATUS_ERROR_INTERNAL,
+			  _("IPP value larger than 32767 bytes."), 1);
+	    DEBUG_printf(("1ipp_read_io: bad value length %d.", n));
+	    _cupsBufferRelease((char *)buffer);
+	    return (IPP_STATE_ERROR);
+	  }
 
-	          *bufptr++ = 0;
-		  *bufptr++ = 8;
-		  *bufptr++ = (ipp_uchar_t)(value->range.lower >> 24);
-		  *bufptr++ = (ipp_uchar_t)(value->range.lower >> 16);
-		  *bufptr++ = (ipp_uchar_t)(value->range.lower >> 8);
-		  *bufptr++ = (ipp_uchar_t)value->range.lower;
-		  *bufptr++ = (ipp_uchar_t)(value->range.upper >> 24);
-		  *bufptr++ = (ipp_uchar_t)(value->range.upper >> 16);
-		  *bufptr++ = (ipp_uchar_t)(value->range.upper >> 8);
-		  *bufptr++ = (ipp_uchar_t)value->range.upper;
+	  switch (tag)
+	  {
+	    case IPP_TAG_INTEGER :
+	    case IPP_TAG_ENUM :
+		if (n != 4)
+		{
+		  if (tag == IPP_TAG_INTEGER)
+		    _cupsSetError(IPP_STATUS_ERROR_INTERNAL,
+				  _("IPP integer value not 4 bytes."), 1);
+		  else
+		    _cupsSetError(IPP_STATUS_ERROR_INTERNAL,
+				  _("IPP enum value not 4 bytes."), 1);
+		  DEBUG_printf(("1ipp_read_io: bad integer value length %d.", n));
+		  _cupsBufferRelease((char *)buffer);
+		  return (IPP_STATE_ERROR);
 		}
-		break;
 
-	    case IPP_TAG_TEXTLANG :
-	    case IPP_TAG_NAMELANG :
-	        for (i = 0, value = attr->values;
-		     i < attr->num_values;
-		     i ++, value ++)
+	        if ((*cb)(src, buffer, 4) < 4)
 		{
-		  if (i)
-		  {
-		   /*
-		    * Arrays and sets are done by sending additional
-		    * values with a zero-length name...
-		    */
+	          DEBUG_puts("1ipp_read_io: Unable to read integer value.");
+		  _cupsBufferRelease((char *)buffer);
+		  return (IPP_STATE_ERROR);
+		}
 
-                    if ((IPP_BUF_SIZE - (bufptr - buffer)) < 3)
-		    {
-                      if ((*cb)(dst, buffer, (size_t)(bufptr - buffer)) < 0)
-	              {
-	        	DEBUG_puts("1ippWriteIO: Could not write IPP "
-		                   "attribute...");
-			_cupsBufferRelease((char *)buffer);
-	        	return (IPP_STATE_ERROR);
-	              }
+		n = (((((buffer[0] << 8) | buffer[1]) << 8) | buffer[2]) << 8) |
+		    buffer[3];
 
-		      bufptr = buffer;
-		    }
+                if (attr->value_tag == IPP_TAG_RANGE)
+                  value->range.lower = value->range.upper = n;
+                else
+		  value->integer = n;
+	        break;
 
-                    *bufptr++ = (ipp_uchar_t)attr->value_tag;
-		    *bufptr++ = 0;
-		    *bufptr++ = 0;
-		  }
+	    case IPP_TAG_BOOLEAN :
+		if (n != 1)
+		{
+		  _cupsSetError(IPP_STATUS_ERROR_INTERNAL, _("IPP boolean value not 1 byte."),
+		                1);
+		  DEBUG_printf(("1ipp_read_io: bad boolean value length %d.", n));
+		  _cupsBufferRelease((char *)buffer);
+		  return (IPP_STATE_ERROR);
+		}
 
-                 /*
-		  * textWithLanguage and nameWithLanguage values consist
-		  * of a 2-byte length for both strings and their
-		  * individual lengths, a 2-byte length for the
-		  * character string, the character string without the
-		  * trailing nul, a 2-byte length for the character
-		  * set string, and the character set string without
-		  * the trailing nul.
-		  */
+	        if ((*cb)(src, buffer, 1) < 1)
+		{
+	          DEBUG_puts("1ipp_read_io: Unable to read boolean value.");
+		  _cupsBufferRelease((char *)buffer);
+		  return (IPP_STATE_ERROR);
+		}
 
-                  n = 4;
+                value->boolean = (char)buffer[0];
+	        break;
 
-		  if (value->string.language != NULL)
-                    n += (int)strlen(value->string.language);
+	    case IPP_TAG_UNSUPPORTED_VALUE :
+	    case IPP_TAG_DEFAULT :
+	    case IPP_TAG_UNKNOWN :
+	    case IPP_TAG_NOVALUE :
+	    case IPP_TAG_NOTSETTABLE :
+	    case IPP_TAG_DELETEATTR :
+	    case IPP_TAG_ADMINDEFINE :
+	       /*
+	        * These value types are not supposed to have values, however
+		* some vendors (Brother) do not implement IPP correctly and so
+		* we need to map non-empty values to text...
+		*/
 
-		  if (value->string.text != NULL)
-                    n += (int)strlen(value->string.text);
+	        if (attr->value_tag == tag)
+		{
+		  if (n == 0)
+		    break;
 
-                  if (n > (IPP_BUF_SIZE - 2))
+		  attr->value_tag = IPP_TAG_TEXT;
+		}
+
+	    case IPP_TAG_TEXT :
+	    case IPP_TAG_NAME :
+	    case IPP_TAG_RESERVED_STRING :
+	    case IPP_TAG_KEYWORD :
+	    case IPP_TAG_URI :
+	    case IPP_TAG_URISCHEME :
+	    case IPP_TAG_CHARSET :
+	    case IPP_TAG_LANGUAGE :
+	    case IPP_TAG_MIMETYPE :
+	        if (n > 0)
+	        {
+		  if ((*cb)(src, buffer, (size_t)n) < n)
 		  {
-		    DEBUG_printf(("1ippWriteIO: text/nameWithLanguage value "
-		                  "too long (%d)", n));
+		    DEBUG_puts("1ipp_read_io: unable to read string value.");
 		    _cupsBufferRelease((char *)buffer);
 		    return (IPP_STATE_ERROR);
-                  }
+		  }
+		}
+
+		buffer[n] = '\0';
+		value->string.text = _cupsStrAlloc((char *)buffer);
+		DEBUG_printf(("2ipp_read_io: value=\"%s\"", value->string.text));
+	        break;
+
+	    case IPP_TAG_DATE :
+		if (n != 11)
+		{
+		  _cupsSetError(IPP_STATUS_ERROR_INTERNAL, _("IPP date value not 11 bytes."), 1);
+		  DEBUG_printf(("1ipp_read_io: bad date value length %d.", n));
+		  _cupsBufferRelease((char *)buffer);
+		  return (IPP_STATE_ERROR);
+		}
+
+	        if ((*cb)(src, value->date, 11) < 11)
+		{
+	          DEBUG_puts("1ipp_read_io: Unable to read date value.");
+		  _cupsBufferRelease((char *)buffer);
+		  return (IPP_STATE_ERROR);
+		}
+	        break;
+
+	    case IPP_TAG_RESOLUTION :
+		if (n != 9)
+		{
+		  _cupsSetError(IPP_STATUS_ERROR_INTERNAL,
+		                _("IPP resolution value not 9 bytes."), 1);
+		  DEBUG_printf(("1ipp_read_io: bad resolution value length %d.", n));
+		  _cupsBufferRelease((char *)buffer);
+		  return (IPP_STATE_ERROR);
+		}
+
+	        if ((*cb)(src, buffer, 9) < 9)
+		{
+	          DEBUG_puts("1ipp_read_io: Unable to read resolution value.");
+		  _cupsBufferRelease((char *)buffer);
+		  return (IPP_STATE_ERROR);
+		}
+
+                value->resolution.xres =
+		    (((((buffer[0] << 8) | buffer[1]) << 8) | buffer[2]) << 8) |
+		    buffer[3];
+                value->resolution.yres =
+		    (((((buffer[4] << 8) | buffer[5]) << 8) | buffer[6]) << 8) |
+		    buffer[7];
+                value->resolution.units =
+		    (ipp_res_t)buffer[8];
+	        break;
 
-                  if ((int)(IPP_BUF_SIZE - (bufptr - buffer)) < (n + 2))
-		  {
-                    if ((*cb)(dst, buffer, (size_t)(bufptr - buffer)) < 0)
-	            {
-	              DEBUG_puts("1ippWriteIO: Could not write IPP "
-		                 "attribute...");
-		      _cupsBufferRelease((char *)buffer);
-	              return (IPP_STATE_ERROR);
-	            }
+	    case IPP_TAG_RANGE :
+		if (n != 8)
+		{
+		  _cupsSetError(IPP_STATUS_ERROR_INTERNAL,
+		                _("IPP rangeOfInteger value not 8 bytes."), 1);
+		  DEBUG_printf(("1ipp_read_io: bad rangeOfInteger value length "
+		                "%d.", n));
+		  _cupsBufferRelease((char *)buffer);
+		  return (IPP_STATE_ERROR);
+		}
 
-		    bufptr = buffer;
-		  }
+	        if ((*cb)(src, buffer, 8) < 8)
+		{
+	          DEBUG_puts("1ipp_read_io: Unable to read range value.");
+		  _cupsBufferRelease((char *)buffer);
+		  return (IPP_STATE_ERROR);
+		}
 
-                 /* Length of entire value */
-	          *bufptr++ = (ipp_uchar_t)(n >> 8);
-		  *bufptr++ = (ipp_uchar_t)n;
+                value->range.lower =
+		    (((((buffer[0] << 8) | buffer[1]) << 8) | buffer[2]) << 8) |
+		    buffer[3];
+                value->range.upper =
+		    (((((buffer[4] << 8) | buffer[5]) << 8) | buffer[6]) << 8) |
+		    buffer[7];
+	        break;
 
-                 /* Length of language */
-		  if (value->string.language != NULL)
-		    n = (int)strlen(value->string.language);
+	    case IPP_TAG_TEXTLANG :
+	    case IPP_TAG_NAMELANG :
+	        if (n < 4)
+		{
+		  if (tag == IPP_TAG_TEXTLANG)
+		    _cupsSetError(IPP_STATUS_ERROR_INTERNAL,
+		                  _("IPP textWithLanguage value less than "
+		                    "minimum 4 bytes."), 1);
 		  else
-		    n = 0;
+		    _cupsSetError(IPP_STATUS_ERROR_INTERNAL,
+		                  _("IPP nameWithLanguage value less than "
+		                    "minimum 4 bytes."), 1);
+		  DEBUG_printf(("1ipp_read_io: bad stringWithLanguage value "
+		                "length %d.", n));
+		  _cupsBufferRelease((char *)buffer);
+		  return (IPP_STATE_ERROR);
+		}
 
-	          *bufptr++ = (ipp_uchar_t)(n >> 8);
-		  *bufptr++ = (ipp_uchar_t)n;
+	        if ((*cb)(src, buffer, (size_t)n) < n)
+		{
+	          DEBUG_puts("1ipp_read_io: Unable to read string w/language "
+		             "value.");
+		  _cupsBufferRelease((char *)buffer);
+		  return (IPP_STATE_ERROR);
+		}
 
-                 /* Language */
-		  if (n > 0)
-		  {
-		    memcpy(bufptr, value->string.language, (size_t)n);
-		    bufptr += n;
-		  }
+                bufptr = buffer;
 
-                 /* Length of text */
-                  if (value->string.text != NULL)
-		    n = (int)strlen(value->string.text);
-		  else
-		    n = 0;
+	       /*
+	        * text-with-language and name-with-language are composite
+		* values:
+		*
+		*    language-length
+		*    language
+		*    text-length
+		*    text
+		*/
 
-	          *bufptr++ = (ipp_uchar_t)(n >> 8);
-		  *bufptr++ = (ipp_uchar_t)n;
+		n = (bufptr[0] << 8) | bufptr[1];
 
-                 /* Text */
-		  if (n > 0)
-		  {
-		    memcpy(bufptr, value->string.text, (size_t)n);
-		    bufptr += n;
-		  }
+		if ((bufptr + 2 + n) >= (buffer + IPP_BUF_SIZE) || n >= (int)sizeof(string))
+		{
+		  _cupsSetError(IPP_STATUS_ERROR_INTERNAL,
+		                _("IPP language length overflows value."), 1);
+		  DEBUG_printf(("1ipp_read_io: bad language value length %d.",
+		                n));
+		  _cupsBufferRelease((char *)buffer);
+		  return (IPP_STATE_ERROR);
 		}
-		break;
-
-            case IPP_TAG_BEGIN_COLLECTION :
-	        for (i = 0, value = attr->values;
-		     i < attr->num_values;
-		     i ++, value ++)
+		else if (n >= IPP_MAX_LANGUAGE)
 		{
-		 /*
-		  * Collections are written with the begin-collection
-		  * tag first with a value of 0 length, followed by the
-		  * attributes in the collection, then the end-collection
-		  * value...
-		  */
+		  _cupsSetError(IPP_STATUS_ERROR_INTERNAL,
+		                _("IPP language length too large."), 1);
+		  DEBUG_printf(("1ipp_read_io: bad language value length %d.",
+		                n));
+		  _cupsBufferRelease((char *)buffer);
+		  return (IPP_STATE_ERROR);
+		}
 
-                  if ((IPP_BUF_SIZE - (bufptr - buffer)) < 5)
-		  {
-                    if ((*cb)(dst, buffer, (size_t)(bufptr - buffer)) < 0)
-	            {
-	              DEBUG_puts("1ippWriteIO: Could not write IPP "
-		                 "attribute...");
-		      _cupsBufferRelease((char *)buffer);
-	              return (IPP_STATE_ERROR);
-	            }
+		memcpy(string, bufptr + 2, (size_t)n);
+		string[n] = '\0';
 
-		    bufptr = buffer;
-		  }
+		value->string.language = _cupsStrAlloc((char *)string);
 
-		  if (i)
-		  {
-		   /*
-		    * Arrays and sets are done by sending additional
-		    * values with a zero-length name...
-		    */
+                bufptr += 2 + n;
+		n = (bufptr[0] << 8) | bufptr[1];
 
-                    *bufptr++ = (ipp_uchar_t)attr->value_tag;
-		    *bufptr++ = 0;
-		    *bufptr++ = 0;
-		  }
+		if ((bufptr + 2 + n) >= (buffer + IPP_BUF_SIZE))
+		{
+		  _cupsSetError(IPP_STATUS_ERROR_INTERNAL,
+		                _("IPP string length overflows value."), 1);
+		  DEBUG_printf(("1ipp_read_io: bad string value length %d.", n));
+		  _cupsBufferRelease((char *)buffer);
+		  return (IPP_STATE_ERROR);
+		}
 
-                 /*
-		  * Write a data length of 0 and flush the buffer...
-		  */
+		bufptr[2 + n] = '\0';
+                value->string.text = _cupsStrAlloc((char *)bufptr + 2);
+	        break;
 
-	          *bufptr++ = 0;
-		  *bufptr++ = 0;
+            case IPP_TAG_BEGIN_COLLECTION :
+	       /*
+	        * Oh, boy, here comes a collection value, so read it...
+		*/
 
-                  if ((*cb)(dst, buffer, (size_t)(bufptr - buffer)) < 0)
-	          {
-	            DEBUG_puts("1ippWriteIO: Could not write IPP "
-		               "attribute...");
-		    _cupsBufferRelease((char *)buffer);
-	            return (IPP_STATE_ERROR);
-	          }
+                value->collection = ippNew();
 
-		  bufptr = buffer;
+                if (n > 0)
+		{
+		  _cupsSetError(IPP_STATUS_ERROR_INTERNAL,
+		                _("IPP begCollection value not 0 bytes."), 1);
+	          DEBUG_puts("1ipp_read_io: begCollection tag with value length "
+		             "> 0.");
+		  _cupsBufferRelease((char *)buffer);
+		  return (IPP_STATE_ERROR);
+		}
 
-                 /*
-		  * Then write the collection attribute...
-		  */
+		if (ipp_read_io(src, cb, 1, ipp, value->collection, depth + 1) == IPP_STATE_ERROR)
+		{
+	          DEBUG_puts("1ipp_read_io: Unable to read collection value.");
+		  _cupsBufferRelease((char *)buffer);
+		  return (IPP_STATE_ERROR);
+		}
+                break;
 
-                  value->collection->state = IPP_STATE_IDLE;
+            case IPP_TAG_END_COLLECTION :
+		_cupsBufferRelease((char *)buffer);
 
-		  if (ippWriteIO(dst, cb, 1, ipp,
-		                 value->collection) == IPP_STATE_ERROR)
-		  {
-		    DEBUG_puts("1ippWriteIO: Unable to write collection value");
-		    _cupsBufferRelease((char *)buffer);
-		    return (IPP_STATE_ERROR);
-		  }
+                if (n > 0)
+		{
+		  _cupsSetError(IPP_STATUS_ERROR_INTERNAL,
+		                _("IPP endCollection value not 0 bytes."), 1);
+	          DEBUG_puts("1ipp_read_io: endCollection tag with value length "
+		             "> 0.");
+		  return (IPP_STATE_ERROR);
 		}
-		break;
 
-            default :
-	        for (i = 0, value = attr->values;
-		     i < attr->num_values;
-		     i ++, value ++)
+	        DEBUG_puts("1ipp_read_io: endCollection tag...");
+		return (ipp->state = IPP_STATE_DATA);
+
+            case IPP_TAG_MEMBERNAME :
+	       /*
+	        * The value the name of the member in the collection, which
+		* we need to carry over...
+		*/
+
+                if (!attr)
+                {
+		  _cupsSetError(IPP_STATUS_ERROR_INTERNAL,
+		                _("IPP memberName with no attribute."), 1);
+	          DEBUG_puts("1ipp_read_io: Member name without attribute.");
+		  _cupsBufferRelease((char *)buffer);
+		  return (IPP_STATE_ERROR);
+                }
+		else if (n == 0)
 		{
-		  if (i)
-		  {
-		   /*
-		    * Arrays and sets are done by sending additional
-		    * values with a zero-length name...
-		    */
+		  _cupsSetError(IPP_STATUS_ERROR_INTERNAL,
+		                _("IPP memberName value is empty."), 1);
+	          DEBUG_puts("1ipp_read_io: Empty member name value.");
+		  _cupsBufferRelease((char *)buffer);
+		  return (IPP_STATE_ERROR);
+		}
+		else if ((*cb)(src, buffer, (size_t)n) < n)
+		{
+	          DEBUG_puts("1ipp_read_io: Unable to read member name value.");
+		  _cupsBufferRelease((char *)buffer);
+		  return (IPP_STATE_ERROR);
+		}
 
-                    if ((IPP_BUF_SIZE - (bufptr - buffer)) < 3)
-		    {
-                      if ((*cb)(dst, buffer, (size_t)(bufptr - buffer)) < 0)
-	              {
-	        	DEBUG_puts("1ippWriteIO: Could not write IPP "
-		                   "attribute...");
-			_cupsBufferRelease((char *)buffer);
-	        	return (IPP_STATE_ERROR);
-	              }
+		buffer[n] = '\0';
+		attr->name = _cupsStrAlloc((char *)buffer);
 
-		      bufptr = buffer;
-		    }
+               /*
+	        * Since collection members are encoded differently than
+		* regular attributes, make sure we don't start with an
+		* empty value...
+		*/
 
-                    *bufptr++ = (ipp_uchar_t)attr->value_tag;
-		    *bufptr++ = 0;
-		    *bufptr++ = 0;
-		  }
+                attr->num_values --;
 
-                 /*
-		  * An unknown value might some new value that a
-		  * vendor has come up with. It consists of a
-		  * 2-byte length and the bytes in the unknown
-		  * value buffer.
-		  */
+		DEBUG_printf(("2ipp_read_io: member name=\"%s\"", attr->name));
+		break;
 
-                  n = value->unknown.length;
+            case IPP_TAG_STRING :
+            default : /* Other unsupported values */
+                if (tag == IPP_TAG_STRING && n > IPP_MAX_LENGTH)
+		{
+		  _cupsSetError(IPP_STATUS_ERROR_INTERNAL,
+		                _("IPP octetString length too large."), 1);
+		  DEBUG_printf(("1ipp_read_io: bad octetString value length %d.",
+		                n));
+		  _cupsBufferRelease((char *)buffer);
+		  return (IPP_STATE_ERROR);
+		}
 
-                  if (n > (IPP_BUF_SIZE - 2))
+                value->unknown.length = n;
+
+	        if (n > 0)
+		{
+		  if ((value->unknown.data = malloc((size_t)n)) == NULL)
 		  {
-		    DEBUG_printf(("1ippWriteIO: Data length too long (%d)",
-		                  n));
+		    _cupsSetHTTPError(HTTP_STATUS_ERROR);
+		    DEBUG_puts("1ipp_read_io: Unable to allocate value");
 		    _cupsBufferRelease((char *)buffer);
 		    return (IPP_STATE_ERROR);
 		  }
 
-                  if ((int)(IPP_BUF_SIZE - (bufptr - buffer)) < (n + 2))
-		  {
-                    if ((*cb)(dst, buffer, (size_t)(bufptr - buffer)) < 0)
-	            {
-	              DEBUG_puts("1ippWriteIO: Could not write IPP "
-		                 "attribute...");
-		      _cupsBufferRelease((char *)buffer);
-	              return (IPP_STATE_ERROR);
-	            }
-
-		    bufptr = buffer;
-		  }
-
-                 /* Length of unknown value */
-	          *bufptr++ = (ipp_uchar_t)(n >> 8);
-		  *bufptr++ = (ipp_uchar_t)n;
-
-                 /* Value */
-		  if (n > 0)
+	          if ((*cb)(src, value->unknown.data, (size_t)n) < n)
 		  {
-		    memcpy(bufptr, value->unknown.data, (size_t)n);
-		    bufptr += n;
+	            DEBUG_puts("1ipp_read_io: Unable to read unsupported value.");
+		    _cupsBufferRelease((char *)buffer);
+		    return (IPP_STATE_ERROR);
 		  }
 		}
-		break;
-	  }
-
-         /*
-	  * Write the data out...
-	  */
-
-	  if (bufptr > buffer)
-	  {
-	    if ((*cb)(dst, buffer, (size_t)(bufptr - buffer)) < 0)
-	    {
-	      DEBUG_puts("1ippWriteIO: Could not write IPP attribute...");
-	      _cupsBufferRelease((char *)buffer);
-	      return (IPP_STATE_ERROR);
-	    }
-
-	    DEBUG_printf(("2ippWriteIO: wrote %d bytes",
-			  (int)(bufptr - buffer)));
+		else
+		  value->unknown.data = NULL;
+	        break;
 	  }
 
 	 /*
-          * If blocking is disabled and we aren't at the end of the attribute
-          * list, stop here...
+          * If blocking is disabled, stop here...
 	  */
 
-          if (!blocking && ipp->current)
+          if (!blocking)
 	    break;
 	}
-
-	if (ipp->current == NULL)
-	{
-         /*
-	  * Done with all of the attributes; add the end-of-attributes
-	  * tag or end-collection attribute...
-	  */
-
-          if (parent == NULL)
-	  {
-            buffer[0] = IPP_TAG_END;
-	    n         = 1;
-	  }
-	  else
-	  {
-            buffer[0] = IPP_TAG_END_COLLECTION;
-	    buffer[1] = 0; /* empty name */
-	    buffer[2] = 0;
-	    buffer[3] = 0; /* empty value */
-	    buffer[4] = 0;
-	    n         = 5;
-	  }
-
-	  if ((*cb)(dst, buffer, (size_t)n) < 0)
-	  {
-	    DEBUG_puts("1ippWriteIO: Could not write IPP end-tag...");
-	    _cupsBufferRelease((char *)buffer);
-	    return (IPP_STATE_ERROR);
-	  }
-
-	  ipp->state = IPP_STATE_DATA;
-	}
         break;
 
     case IPP_STATE_DATA :
@@ -6161,6 +6357,7 @@ ippWriteIO(void       *dst,		/* I - Destination */
         break; /* anti-compiler-warning-code */
   }
 
+  DEBUG_printf(("1ipp_read_io: returning ipp->state=%d.", ipp->state));
   _cupsBufferRelease((char *)buffer);
 
   return (ipp->state);
@@ -6168,680 +6365,1113 @@ ippWriteIO(void       *dst,		/* I - Destination */
 
 
 /*
- * 'ipp_add_attr()' - Add a new attribute to the message.
+ * 'ipp_set_error()' - Set a formatted, localized error string.
  */
 
-static ipp_attribute_t *		/* O - New attribute */
-ipp_add_attr(ipp_t      *ipp,		/* I - IPP message */
-             const char *name,		/* I - Attribute name or NULL */
-             ipp_tag_t  group_tag,	/* I - Group tag or IPP_TAG_ZERO */
-             ipp_tag_t  value_tag,	/* I - Value tag or IPP_TAG_ZERO */
-             int        num_values)	/* I - Number of values */
+static void
+ipp_set_error(ipp_status_t status,	/* I - Status code */
+              const char   *format,	/* I - Printf-style error string */
+	      ...)			/* I - Additional arguments as needed */
 {
-  int			alloc_values;	/* Number of values to allocate */
-  ipp_attribute_t	*attr;		/* New attribute */
+  va_list	ap;			/* Pointer to additional args */
+  char		buffer[2048];		/* Message buffer */
+  cups_lang_t	*lang = cupsLangDefault();
+					/* Current language */
+
+
+  va_start(ap, format);
+  vsnprintf(buffer, sizeof(buffer), _cupsLangString(lang, format), ap);
+  va_end(ap);
+
+  _cupsSetError(status, buffer, 0);
+}
+
+
+/*
+ * 'ipp_set_value()' - Get the value element from an attribute, expanding it as
+ *                     needed.
+ */
+
+static _ipp_value_t *			/* O  - IPP value element or NULL on error */
+ipp_set_value(ipp_t           *ipp,	/* IO - IPP message */
+              ipp_attribute_t **attr,	/* IO - IPP attribute */
+              int             element)	/* I  - Value number (0-based) */
+{
+  ipp_attribute_t	*temp,		/* New attribute pointer */
+			*current,	/* Current attribute in list */
+			*prev;		/* Previous attribute in list */
+  int			alloc_values;	/* Allocated values */
+
+
+ /*
+  * If we are setting an existing value element, return it...
+  */
+
+  temp = *attr;
+
+  if (element < temp->alloc_values)
+  {
+    if (element >= temp->num_values)
+      temp->num_values = element + 1;
+
+    return (temp->values + element);
+  }
+
+ /*
+  * Otherwise re-allocate the attribute...
+  */
+
+  alloc_values = ipp_alloc_values(element + 1);
+
+  DEBUG_printf(("4ipp_set_value: Reallocating for up to %d values.",
+                alloc_values));
+
+ /*
+  * Reallocate memory...
+  */
+
+  if (ipp->use_arena)
+  {
+   /*
+    * Arena memory is not freed individually, so just copy to a larger
+    * block...
+    */
+
+    if ((temp = ipp_arena_alloc(ipp, sizeof(ipp_attribute_t) + (size_t)(alloc_values - 1) * sizeof(_ipp_value_t))) != NULL)
+      memcpy(temp, *attr, sizeof(ipp_attribute_t) + (size_t)((*attr)->num_values > 1 ? (*attr)->num_values - 1 : 0) * sizeof(_ipp_value_t));
+  }
+  else
+    temp = realloc(temp, sizeof(ipp_attribute_t) + (size_t)(alloc_values - 1) * sizeof(_ipp_value_t));
+
+  if (!temp)
+  {
+    _cupsSetHTTPError(HTTP_STATUS_ERROR);
+    DEBUG_puts("4ipp_set_value: Unable to resize attribute.");
+    return (NULL);
+  }
+
+ /*
+  * Zero the new memory...
+  */
+
+  memset(temp->values + temp->num_values, 0, (size_t)(alloc_values - temp->num_values) * sizeof(_ipp_value_t));
+
+  temp->alloc_values = alloc_values;
+
+  if (temp != *attr)
+  {
+   /*
+    * Reset pointers in the list...
+    */
+
+#ifndef __clang_analyzer__
+    DEBUG_printf(("4debug_free: %p %s", (void *)*attr, temp->name));
+#endif /* !__clang_analyzer__ */
+    DEBUG_printf(("4debug_alloc: %p %s %s%s (%d)", (void *)temp, temp->name, temp->num_values > 1 ? "1setOf " : "", ippTagString(temp->value_tag), temp->num_values));
+
+    if (ipp->current == *attr && ipp->prev)
+    {
+     /*
+      * Use current "previous" pointer...
+      */
+
+      prev = ipp->prev;
+    }
+    else
+    {
+     /*
+      * Find this attribute in the linked list...
+      */
+
+      for (prev = NULL, current = ipp->attrs;
+	   current && current != *attr;
+	   prev = current, current = current->next);
+
+      if (!current)
+      {
+       /*
+	* This is a serious error!
+	*/
+
+	*attr = temp;
+	_cupsSetError(IPP_STATUS_ERROR_INTERNAL,
+	              _("IPP attribute is not a member of the message."), 1);
+	DEBUG_puts("4ipp_set_value: Unable to find attribute in message.");
+	return (NULL);
+      }
+    }
+
+    if (prev)
+      prev->next = temp;
+    else
+      ipp->attrs = temp;
 
+    ipp->current = temp;
+    ipp->prev    = prev;
 
-  DEBUG_printf(("4ipp_add_attr(ipp=%p, name=\"%s\", group_tag=0x%x, value_tag=0x%x, num_values=%d)", (void *)ipp, name, group_tag, value_tag, num_values));
+    if (ipp->last == *attr)
+      ipp->last = temp;
 
- /*
-  * Range check input...
-  */
+    ipp_index_clear(ipp);
 
-  if (!ipp || num_values < 0)
-    return (NULL);
+    *attr = temp;
+  }
 
  /*
-  * Allocate memory, rounding the allocation up as needed...
+  * Return the value element...
   */
 
-  if (num_values <= 1)
-    alloc_values = 1;
-  else
-    alloc_values = (num_values + IPP_MAX_VALUES - 1) & ~(IPP_MAX_VALUES - 1);
+  if (element >= temp->num_values)
+    temp->num_values = element + 1;
+
+  return (temp->values + element);
+}
 
-  attr = calloc(sizeof(ipp_attribute_t) +
-                (size_t)(alloc_values - 1) * sizeof(_ipp_value_t), 1);
 
-  if (attr)
+/*
+ * 'ipp_write_buffer()' - Write IPP data to a growable memory buffer.
+ */
+
+static ssize_t				/* O - Number of bytes written */
+ipp_write_buffer(
+    _ipp_wbuffer_t *wbuffer,		/* I - Write buffer */
+    ipp_uchar_t    *buffer,		/* I - Data to write */
+    size_t         length)		/* I - Number of bytes to write */
+{
+  if ((wbuffer->used + length) > *(wbuffer->bufsize))
   {
    /*
-    * Initialize attribute...
+    * Grow the buffer, doubling its size to limit the number of copies...
     */
 
-    DEBUG_printf(("4debug_alloc: %p %s %s%s (%d values)", (void *)attr, name, num_values > 1 ? "1setOf " : "", ippTagString(value_tag), num_values));
+    size_t	newsize = *(wbuffer->bufsize) ? *(wbuffer->bufsize) : IPP_BUF_SIZE;
+					/* New size of buffer */
+    ipp_uchar_t	*newbuffer;		/* New buffer */
 
-    if (name)
-      attr->name = _cupsStrAlloc(name);
+    while (newsize < (wbuffer->used + length))
+      newsize *= 2;
 
-    attr->group_tag  = group_tag;
-    attr->value_tag  = value_tag;
-    attr->num_values = num_values;
+    if ((newbuffer = realloc(*(wbuffer->buffer), newsize)) == NULL)
+      return (-1);
 
-   /*
-    * Add it to the end of the linked list...
-    */
+    *(wbuffer->buffer)  = newbuffer;
+    *(wbuffer->bufsize) = newsize;
+  }
 
-    if (ipp->last)
-      ipp->last->next = attr;
-    else
-      ipp->attrs = attr;
+  memcpy(*(wbuffer->buffer) + wbuffer->used, buffer, length);
+  wbuffer->used += length;
 
-    ipp->prev = ipp->last;
-    ipp->last = ipp->current = attr;
-  }
+  return ((ssize_t)length);
+}
 
-  DEBUG_printf(("5ipp_add_attr: Returning %p", (void *)attr));
 
-  return (attr);
+/*
+ * 'ipp_write_file()' - Write IPP data to a file.
+ */
+
+static ssize_t				/* O - Number of bytes written */
+ipp_write_file(int         *fd,		/* I - File descriptor */
+               ipp_uchar_t *buffer,	/* I - Data to write */
+               size_t      length)	/* I - Number of bytes to write */
+{
+#ifdef _WIN32
+  return ((ssize_t)write(*fd, buffer, (unsigned)length));
+#else
+  return (write(*fd, buffer, length));
+#endif /* _WIN32 */
 }
 
 
 /*
- * 'ipp_free_values()' - Free attribute values.
+ * 'ipp_write_io()' - Write data for an IPP message.
  */
 
-static void
-ipp_free_values(ipp_attribute_t *attr,	/* I - Attribute to free values from */
-                int             element,/* I - First value to free */
-                int             count)	/* I - Number of values to free */
+static ipp_state_t			/* O - Current state */
+ipp_write_io(void       *dst,		/* I - Destination */
+             ipp_iocb_t cb,		/* I - Write callback function */
+	     int        blocking,	/* I - Use blocking IO? */
+	     ipp_t      *parent,	/* I - Parent IPP message */
+             ipp_t      *ipp)		/* I - IPP data */
 {
-  int		i;			/* Looping var */
-  _ipp_value_t	*value;			/* Current value */
+  int			i;		/* Looping var */
+  int			n;		/* Length of data */
+  unsigned char		*buffer,	/* Data buffer */
+			*bufptr;	/* Pointer into buffer */
+  ipp_attribute_t	*attr;		/* Current attribute */
+  _ipp_value_t		*value;		/* Current value */
 
 
-  DEBUG_printf(("4ipp_free_values(attr=%p, element=%d, count=%d)", (void *)attr, element, count));
+  DEBUG_printf(("ippWriteIO(dst=%p, cb=%p, blocking=%d, parent=%p, ipp=%p)", (void *)dst, (void *)cb, blocking, (void *)parent, (void *)ipp));
 
-  if (!(attr->value_tag & IPP_TAG_CUPS_CONST))
+  if (!dst || !ipp)
+    return (IPP_STATE_ERROR);
+
+  if ((buffer = (unsigned char *)_cupsBufferGet(IPP_BUF_SIZE)) == NULL)
   {
-   /*
-    * Free values as needed...
-    */
+    DEBUG_puts("1ippWriteIO: Unable to get write buffer");
+    return (IPP_STATE_ERROR);
+  }
 
-    switch (attr->value_tag)
-    {
-      case IPP_TAG_TEXTLANG :
-      case IPP_TAG_NAMELANG :
-	  if (element == 0 && count == attr->num_values &&
-	      attr->values[0].string.language)
-	  {
-	    _cupsStrFree(attr->values[0].string.language);
-	    attr->values[0].string.language = NULL;
-	  }
-	  /* Fall through to other string values */
+  switch (ipp->state)
+  {
+    case IPP_STATE_IDLE :
+        ipp->state ++; /* Avoid common problem... */
 
-      case IPP_TAG_TEXT :
-      case IPP_TAG_NAME :
-      case IPP_TAG_RESERVED_STRING :
-      case IPP_TAG_KEYWORD :
-      case IPP_TAG_URI :
-      case IPP_TAG_URISCHEME :
-      case IPP_TAG_CHARSET :
-      case IPP_TAG_LANGUAGE :
-      case IPP_TAG_MIMETYPE :
-	  for (i = count, value = attr->values + element;
-	       i > 0;
-	       i --, value ++)
+    case IPP_STATE_HEADER :
+        if (parent == NULL)
+	{
+	 /*
+	  * Send the request header:
+	  *
+	  *                 Version = 2 bytes
+	  *   Operation/Status Code = 2 bytes
+	  *              Request ID = 4 bytes
+	  *                   Total = 8 bytes
+	  */
+
+          bufptr = buffer;
+
+	  *bufptr++ = ipp->request.any.version[0];
+	  *bufptr++ = ipp->request.any.version[1];
+	  *bufptr++ = (ipp_uchar_t)(ipp->request.any.op_status >> 8);
+	  *bufptr++ = (ipp_uchar_t)ipp->request.any.op_status;
+	  *bufptr++ = (ipp_uchar_t)(ipp->request.any.request_id >> 24);
+	  *bufptr++ = (ipp_uchar_t)(ipp->request.any.request_id >> 16);
+	  *bufptr++ = (ipp_uchar_t)(ipp->request.any.request_id >> 8);
+	  *bufptr++ = (ipp_uchar_t)ipp->request.any.request_id;
+
+	  DEBUG_printf(("2ippWriteIO: version=%d.%d", buffer[0], buffer[1]));
+	  DEBUG_printf(("2ippWriteIO: op_status=%04x",
+			ipp->request.any.op_status));
+	  DEBUG_printf(("2ippWriteIO: request_id=%d",
+			ipp->request.any.request_id));
+
+          if ((*cb)(dst, buffer, (size_t)(bufptr - buffer)) < 0)
 	  {
-	    _cupsStrFree(value->string.text);
-	    value->string.text = NULL;
+	    DEBUG_puts("1ippWriteIO: Could not write IPP header...");
+	    _cupsBufferRelease((char *)buffer);
+	    return (IPP_STATE_ERROR);
 	  }
-	  break;
+	}
 
-      case IPP_TAG_UNSUPPORTED_VALUE :
-      case IPP_TAG_DEFAULT :
-      case IPP_TAG_UNKNOWN :
-      case IPP_TAG_NOVALUE :
-      case IPP_TAG_NOTSETTABLE :
-      case IPP_TAG_DELETEATTR :
-      case IPP_TAG_ADMINDEFINE :
-      case IPP_TAG_INTEGER :
-      case IPP_TAG_ENUM :
-      case IPP_TAG_BOOLEAN :
-      case IPP_TAG_DATE :
-      case IPP_TAG_RESOLUTION :
-      case IPP_TAG_RANGE :
+       /*
+	* Reset the state engine to point to the first attribute
+	* in the request/response, with no current group.
+	*/
+
+        ipp->state   = IPP_STATE_ATTRIBUTE;
+	ipp->current = ipp->attrs;
+	ipp->curtag  = IPP_TAG_ZERO;
+
+	DEBUG_printf(("1ippWriteIO: ipp->current=%p", (void *)ipp->current));
+
+       /*
+        * If blocking is disabled, stop here...
+	*/
+
+        if (!blocking)
 	  break;
 
-      case IPP_TAG_BEGIN_COLLECTION :
-	  for (i = count, value = attr->values + element;
-	       i > 0;
-	       i --, value ++)
+    case IPP_STATE_ATTRIBUTE :
+        while (ipp->current != NULL)
+	{
+	 /*
+	  * Write this attribute...
+	  */
+
+	  bufptr = buffer;
+	  attr   = ipp->current;
+
+	  ipp->current = ipp->current->next;
+
+          if (!parent)
 	  {
-	    ippDelete(value->collection);
-	    value->collection = NULL;
+	    if (ipp->curtag != attr->group_tag)
+	    {
+	     /*
+	      * Send a group tag byte...
+	      */
+
+	      ipp->curtag = attr->group_tag;
+
+	      if (attr->group_tag == IPP_TAG_ZERO)
+		continue;
+
+	      DEBUG_printf(("2ippWriteIO: wrote group tag=%x(%s)",
+			    attr->group_tag, ippTagString(attr->group_tag)));
+	      *bufptr++ = (ipp_uchar_t)attr->group_tag;
+	    }
+	    else if (attr->group_tag == IPP_TAG_ZERO)
+	      continue;
 	  }
-	  break;
 
-      case IPP_TAG_STRING :
-      default :
-	  for (i = count, value = attr->values + element;
-	       i > 0;
-	       i --, value ++)
+	  DEBUG_printf(("1ippWriteIO: %s (%s%s)", attr->name,
+	                attr->num_values > 1 ? "1setOf " : "",
+			ippTagString(attr->value_tag)));
+
+         /*
+	  * Write the attribute tag and name.
+	  *
+	  * The attribute name length does not include the trailing nul
+	  * character in the source string.
+	  *
+	  * Collection values (parent != NULL) are written differently...
+	  */
+
+          if (parent == NULL)
 	  {
-	    if (value->unknown.data)
+           /*
+	    * Get the length of the attribute name, and make sure it won't
+	    * overflow the buffer...
+	    */
+
+            if ((n = (int)strlen(attr->name)) > (IPP_BUF_SIZE - 8))
 	    {
-	      free(value->unknown.data);
-	      value->unknown.data = NULL;
+	      DEBUG_printf(("1ippWriteIO: Attribute name too long (%d)", n));
+	      _cupsBufferRelease((char *)buffer);
+	      return (IPP_STATE_ERROR);
 	    }
-	  }
-	  break;
-    }
-  }
 
- /*
-  * If we are not freeing values from the end, move the remaining values up...
-  */
+           /*
+	    * Write the value tag, name length, and name string...
+	    */
 
-  if ((element + count) < attr->num_values)
-    memmove(attr->values + element, attr->values + element + count,
-            (size_t)(attr->num_values - count - element) * sizeof(_ipp_value_t));
+            DEBUG_printf(("2ippWriteIO: writing value tag=%x(%s)",
+	                  attr->value_tag, ippTagString(attr->value_tag)));
+            DEBUG_printf(("2ippWriteIO: writing name=%d,\"%s\"", n,
+	                  attr->name));
 
-  attr->num_values -= count;
-}
+            if (attr->value_tag > 0xff)
+            {
+              *bufptr++ = IPP_TAG_EXTENSION;
+	      *bufptr++ = (ipp_uchar_t)(attr->value_tag >> 24);
+	      *bufptr++ = (ipp_uchar_t)(attr->value_tag >> 16);
+	      *bufptr++ = (ipp_uchar_t)(attr->value_tag >> 8);
+	      *bufptr++ = (ipp_uchar_t)attr->value_tag;
+            }
+            else
+	      *bufptr++ = (ipp_uchar_t)attr->value_tag;
 
+	    *bufptr++ = (ipp_uchar_t)(n >> 8);
+	    *bufptr++ = (ipp_uchar_t)n;
+	    memcpy(bufptr, attr->name, (size_t)n);
+	    bufptr += n;
+          }
+	  else
+	  {
+           /*
+	    * Get the length of the attribute name, and make sure it won't
+	    * overflow the buffer...
+	    */
 
-/*
- * 'ipp_get_code()' - Convert a C locale/charset name into an IPP language/charset code.
- *
- * This typically converts strings of the form "ll_CC", "ll-REGION", and "CHARSET_NUMBER"
- * to "ll-cc", "ll-region", and "charset-number", respectively.
- */
+            if ((n = (int)strlen(attr->name)) > (IPP_BUF_SIZE - 12))
+	    {
+	      DEBUG_printf(("1ippWriteIO: Attribute name too long (%d)", n));
+	      _cupsBufferRelease((char *)buffer);
+	      return (IPP_STATE_ERROR);
+	    }
 
-static char *				/* O - Language code string */
-ipp_get_code(const char *value,		/* I - Locale/charset string */
-             char       *buffer,	/* I - String buffer */
-             size_t     bufsize)	/* I - Size of string buffer */
-{
-  char	*bufptr,			/* Pointer into buffer */
-	*bufend;			/* End of buffer */
+           /*
+	    * Write the member name tag, name length, name string, value tag,
+	    * and empty name for the collection member attribute...
+	    */
 
+            DEBUG_printf(("2ippWriteIO: writing value tag=%x(memberName)",
+	                  IPP_TAG_MEMBERNAME));
+            DEBUG_printf(("2ippWriteIO: writing name=%d,\"%s\"", n,
+	                  attr->name));
+            DEBUG_printf(("2ippWriteIO: writing value tag=%x(%s)",
+	                  attr->value_tag, ippTagString(attr->value_tag)));
+            DEBUG_puts("2ippWriteIO: writing name=0,\"\"");
 
- /*
-  * Convert values to lowercase and change _ to - as needed...
-  */
+            *bufptr++ = IPP_TAG_MEMBERNAME;
+	    *bufptr++ = 0;
+	    *bufptr++ = 0;
+	    *bufptr++ = (ipp_uchar_t)(n >> 8);
+	    *bufptr++ = (ipp_uchar_t)n;
+	    memcpy(bufptr, attr->name, (size_t)n);
+	    bufptr += n;
 
-  for (bufptr = buffer, bufend = buffer + bufsize - 1;
-       *value && bufptr < bufend;
-       value ++)
-    if (*value == '_')
-      *bufptr++ = '-';
-    else
-      *bufptr++ = (char)_cups_tolower(*value);
+            if (attr->value_tag > 0xff)
+            {
+              *bufptr++ = IPP_TAG_EXTENSION;
+	      *bufptr++ = (ipp_uchar_t)(attr->value_tag >> 24);
+	      *bufptr++ = (ipp_uchar_t)(attr->value_tag >> 16);
+	      *bufptr++ = (ipp_uchar_t)(attr->value_tag >> 8);
+	      *bufptr++ = (ipp_uchar_t)attr->value_tag;
+            }
+            else
+	      *bufptr++ = (ipp_uchar_t)attr->value_tag;
 
-  *bufptr = '\0';
+            *bufptr++ = 0;
+            *bufptr++ = 0;
+	  }
 
- /*
-  * Return the converted string...
-  */
+         /*
+	  * Now write the attribute value(s)...
+	  */
 
-  return (buffer);
-}
+	  switch (attr->value_tag & ~IPP_TAG_CUPS_CONST)
+	  {
+	    case IPP_TAG_UNSUPPORTED_VALUE :
+	    case IPP_TAG_DEFAULT :
+	    case IPP_TAG_UNKNOWN :
+	    case IPP_TAG_NOVALUE :
+	    case IPP_TAG_NOTSETTABLE :
+	    case IPP_TAG_DELETEATTR :
+	    case IPP_TAG_ADMINDEFINE :
+		*bufptr++ = 0;
+		*bufptr++ = 0;
+	        break;
 
+	    case IPP_TAG_INTEGER :
+	    case IPP_TAG_ENUM :
+	        for (i = 0, value = attr->values;
+		     i < attr->num_values;
+		     i ++, value ++)
+		{
+                  if ((IPP_BUF_SIZE - (bufptr - buffer)) < 9)
+		  {
+                    if ((*cb)(dst, buffer, (size_t)(bufptr - buffer)) < 0)
+	            {
+	              DEBUG_puts("1ippWriteIO: Could not write IPP "
+		                 "attribute...");
+		      _cupsBufferRelease((char *)buffer);
+	              return (IPP_STATE_ERROR);
+	            }
 
-/*
- * 'ipp_lang_code()' - Convert a C locale name into an IPP language code.
- *
- * This typically converts strings of the form "ll_CC" and "ll-REGION" to "ll-cc" and
- * "ll-region", respectively.  It also converts the "C" (POSIX) locale to "en".
- */
+		    bufptr = buffer;
+		  }
 
-static char *				/* O - Language code string */
-ipp_lang_code(const char *locale,	/* I - Locale string */
-              char       *buffer,	/* I - String buffer */
-              size_t     bufsize)	/* I - Size of string buffer */
-{
- /*
-  * Map POSIX ("C") locale to generic English, otherwise convert the locale string as-is.
-  */
+		  if (i)
+		  {
+		   /*
+		    * Arrays and sets are done by sending additional
+		    * values with a zero-length name...
+		    */
 
-  if (!_cups_strcasecmp(locale, "c"))
-  {
-    strlcpy(buffer, "en", bufsize);
-    return (buffer);
-  }
-  else
-    return (ipp_get_code(locale, buffer, bufsize));
-}
+                    *bufptr++ = (ipp_uchar_t)attr->value_tag;
+		    *bufptr++ = 0;
+		    *bufptr++ = 0;
+		  }
 
+		 /*
+	          * Integers and enumerations are both 4-byte signed
+		  * (twos-complement) values.
+		  *
+		  * Put the 2-byte length and 4-byte value into the buffer...
+		  */
 
-/*
- * 'ipp_length()' - Compute the length of an IPP message or collection value.
- */
+	          *bufptr++ = 0;
+		  *bufptr++ = 4;
+		  *bufptr++ = (ipp_uchar_t)(value->integer >> 24);
+		  *bufptr++ = (ipp_uchar_t)(value->integer >> 16);
+		  *bufptr++ = (ipp_uchar_t)(value->integer >> 8);
+		  *bufptr++ = (ipp_uchar_t)value->integer;
+		}
+		break;
 
-static size_t				/* O - Size of IPP message */
-ipp_length(ipp_t *ipp,			/* I - IPP message or collection */
-           int   collection)		/* I - 1 if a collection, 0 otherwise */
-{
-  int			i;		/* Looping var */
-  size_t		bytes;		/* Number of bytes */
-  ipp_attribute_t	*attr;		/* Current attribute */
-  ipp_tag_t		group;		/* Current group */
-  _ipp_value_t		*value;		/* Current value */
+	    case IPP_TAG_BOOLEAN :
+	        for (i = 0, value = attr->values;
+		     i < attr->num_values;
+		     i ++, value ++)
+		{
+                  if ((IPP_BUF_SIZE - (bufptr - buffer)) < 6)
+		  {
+                    if ((*cb)(dst, buffer, (size_t)(bufptr - buffer)) < 0)
+	            {
+	              DEBUG_puts("1ippWriteIO: Could not write IPP "
+		                 "attribute...");
+		      _cupsBufferRelease((char *)buffer);
+	              return (IPP_STATE_ERROR);
+	            }
 
+		    bufptr = buffer;
+		  }
 
-  DEBUG_printf(("3ipp_length(ipp=%p, collection=%d)", (void *)ipp, collection));
+		  if (i)
+		  {
+		   /*
+		    * Arrays and sets are done by sending additional
+		    * values with a zero-length name...
+		    */
 
-  if (!ipp)
-  {
-    DEBUG_puts("4ipp_length: Returning 0 bytes");
-    return (0);
-  }
+                    *bufptr++ = (ipp_uchar_t)attr->value_tag;
+		    *bufptr++ = 0;
+		    *bufptr++ = 0;
+		  }
 
- /*
-  * Start with 8 bytes for the IPP message header...
-  */
+                 /*
+		  * Boolean values are 1-byte; 0 = false, 1 = true.
+		  *
+		  * Put the 2-byte length and 1-byte value into the buffer...
+		  */
 
-  bytes = collection ? 0 : 8;
+	          *bufptr++ = 0;
+		  *bufptr++ = 1;
+		  *bufptr++ = (ipp_uchar_t)value->boolean;
+		}
+		break;
 
- /*
-  * Then add the lengths of each attribute...
-  */
+	    case IPP_TAG_TEXT :
+	    case IPP_TAG_NAME :
+	    case IPP_TAG_KEYWORD :
+	    case IPP_TAG_URI :
+	    case IPP_TAG_URISCHEME :
+	    case IPP_TAG_CHARSET :
+	    case IPP_TAG_LANGUAGE :
+	    case IPP_TAG_MIMETYPE :
+	        for (i = 0, value = attr->values;
+		     i < attr->num_values;
+		     i ++, value ++)
+		{
+		  if (i)
+		  {
+		   /*
+		    * Arrays and sets are done by sending additional
+		    * values with a zero-length name...
+		    */
 
-  group = IPP_TAG_ZERO;
+        	    DEBUG_printf(("2ippWriteIO: writing value tag=%x(%s)",
+		                  attr->value_tag,
+				  ippTagString(attr->value_tag)));
+        	    DEBUG_printf(("2ippWriteIO: writing name=0,\"\""));
 
-  for (attr = ipp->attrs; attr != NULL; attr = attr->next)
-  {
-    if (attr->group_tag != group && !collection)
-    {
-      group = attr->group_tag;
-      if (group == IPP_TAG_ZERO)
-	continue;
+                    if ((IPP_BUF_SIZE - (bufptr - buffer)) < 3)
+		    {
+                      if ((*cb)(dst, buffer, (size_t)(bufptr - buffer)) < 0)
+	              {
+	        	DEBUG_puts("1ippWriteIO: Could not write IPP "
+			           "attribute...");
+			_cupsBufferRelease((char *)buffer);
+	        	return (IPP_STATE_ERROR);
+	              }
 
-      bytes ++;	/* Group tag */
-    }
+		      bufptr = buffer;
+		    }
 
-    if (!attr->name)
-      continue;
+                    *bufptr++ = (ipp_uchar_t)attr->value_tag;
+		    *bufptr++ = 0;
+		    *bufptr++ = 0;
+		  }
 
-    DEBUG_printf(("5ipp_length: attr->name=\"%s\", attr->num_values=%d, "
-                  "bytes=" CUPS_LLFMT, attr->name, attr->num_values, CUPS_LLCAST bytes));
+                  if (value->string.text != NULL)
+                    n = (int)strlen(value->string.text);
+		  else
+		    n = 0;
 
-    if ((attr->value_tag & ~IPP_TAG_CUPS_CONST) < IPP_TAG_EXTENSION)
-      bytes += (size_t)attr->num_values;/* Value tag for each value */
-    else
-      bytes += (size_t)(5 * attr->num_values);
-					/* Value tag for each value */
-    bytes += (size_t)(2 * attr->num_values);
-					/* Name lengths */
-    bytes += strlen(attr->name);	/* Name */
-    bytes += (size_t)(2 * attr->num_values);
-					/* Value lengths */
+                  if (n > (IPP_BUF_SIZE - 2))
+		  {
+		    DEBUG_printf(("1ippWriteIO: String too long (%d)", n));
+		    _cupsBufferRelease((char *)buffer);
+		    return (IPP_STATE_ERROR);
+		  }
 
-    if (collection)
-      bytes += 5;			/* Add membername overhead */
+                  DEBUG_printf(("2ippWriteIO: writing string=%d,\"%s\"", n,
+		                value->string.text));
 
-    switch (attr->value_tag & ~IPP_TAG_CUPS_CONST)
-    {
-      case IPP_TAG_UNSUPPORTED_VALUE :
-      case IPP_TAG_DEFAULT :
-      case IPP_TAG_UNKNOWN :
-      case IPP_TAG_NOVALUE :
-      case IPP_TAG_NOTSETTABLE :
-      case IPP_TAG_DELETEATTR :
-      case IPP_TAG_ADMINDEFINE :
-          break;
+                  if ((int)(IPP_BUF_SIZE - (bufptr - buffer)) < (n + 2))
+		  {
+                    if ((*cb)(dst, buffer, (size_t)(bufptr - buffer)) < 0)
+	            {
+	              DEBUG_puts("1ippWriteIO: Could not write IPP "
+		                 "attribute...");
+		      _cupsBufferRelease((char *)buffer);
+	              return (IPP_STATE_ERROR);
+	            }
 
-      case IPP_TAG_INTEGER :
-      case IPP_TAG_ENUM :
-          bytes += (size_t)(4 * attr->num_values);
-	  break;
+		    bufptr = buffer;
+		  }
 
-      case IPP_TAG_BOOLEAN :
-          bytes += (size_t)attr->num_values;
-	  break;
+		 /*
+		  * All simple strings consist of the 2-byte length and
+		  * character data without the trailing nul normally found
+		  * in C strings.  Also, strings cannot be longer than IPP_MAX_LENGTH
+		  * bytes since the 2-byte length is a signed (twos-complement)
+		  * value.
+		  *
+		  * Put the 2-byte length and string characters in the buffer.
+		  */
 
-      case IPP_TAG_TEXT :
-      case IPP_TAG_NAME :
-      case IPP_TAG_KEYWORD :
-      case IPP_TAG_URI :
-      case IPP_TAG_URISCHEME :
-      case IPP_TAG_CHARSET :
-      case IPP_TAG_LANGUAGE :
-      case IPP_TAG_MIMETYPE :
-	  for (i = 0, value = attr->values;
-	       i < attr->num_values;
-	       i ++, value ++)
-	    if (value->string.text)
-	      bytes += strlen(value->string.text);
-	  break;
+	          *bufptr++ = (ipp_uchar_t)(n >> 8);
+		  *bufptr++ = (ipp_uchar_t)n;
 
-      case IPP_TAG_DATE :
-          bytes += (size_t)(11 * attr->num_values);
-	  break;
+		  if (n > 0)
+		  {
+		    memcpy(bufptr, value->string.text, (size_t)n);
+		    bufptr += n;
+		  }
+		}
+		break;
 
-      case IPP_TAG_RESOLUTION :
-          bytes += (size_t)(9 * attr->num_values);
-	  break;
+	    case IPP_TAG_DATE :
+	        for (i = 0, value = attr->values;
+		     i < attr->num_values;
+		     i ++, value ++)
+		{
+                  if ((IPP_BUF_SIZE - (bufptr - buffer)) < 16)
+		  {
+                    if ((*cb)(dst, buffer, (size_t)(bufptr - buffer)) < 0)
+	            {
+	              DEBUG_puts("1ippWriteIO: Could not write IPP "
+		                 "attribute...");
+		      _cupsBufferRelease((char *)buffer);
+	              return (IPP_STATE_ERROR);
+	            }
 
-      case IPP_TAG_RANGE :
-          bytes += (size_t)(8 * attr->num_values);
-	  break;
+		    bufptr = buffer;
+		  }
 
-      case IPP_TAG_TEXTLANG :
-      case IPP_TAG_NAMELANG :
-          bytes += (size_t)(4 * attr->num_values);
-					/* Charset + text length */
+		  if (i)
+		  {
+		   /*
+		    * Arrays and sets are done by sending additional
+		    * values with a zero-length name...
+		    */
 
-	  for (i = 0, value = attr->values;
-	       i < attr->num_values;
-	       i ++, value ++)
-	  {
-	    if (value->string.language)
-	      bytes += strlen(value->string.language);
+                    *bufptr++ = (ipp_uchar_t)attr->value_tag;
+		    *bufptr++ = 0;
+		    *bufptr++ = 0;
+		  }
 
-	    if (value->string.text)
-	      bytes += strlen(value->string.text);
-	  }
-	  break;
+                 /*
+		  * Date values consist of a 2-byte length and an
+		  * 11-byte date/time structure defined by RFC 1903.
+		  *
+		  * Put the 2-byte length and 11-byte date/time
+		  * structure in the buffer.
+		  */
 
-      case IPP_TAG_BEGIN_COLLECTION :
-	  for (i = 0, value = attr->values;
-	       i < attr->num_values;
-	       i ++, value ++)
-            bytes += ipp_length(value->collection, 1);
-	  break;
+	          *bufptr++ = 0;
+		  *bufptr++ = 11;
+		  memcpy(bufptr, value->date, 11);
+		  bufptr += 11;
+		}
+		break;
 
-      default :
-	  for (i = 0, value = attr->values;
-	       i < attr->num_values;
-	       i ++, value ++)
-            bytes += (size_t)value->unknown.length;
-	  break;
-    }
-  }
+	    case IPP_TAG_RESOLUTION :
+	        for (i = 0, value = attr->values;
+		     i < attr->num_values;
+		     i ++, value ++)
+		{
+                  if ((IPP_BUF_SIZE - (bufptr - buffer)) < 14)
+		  {
+                    if ((*cb)(dst, buffer, (size_t)(bufptr - buffer)) < 0)
+	            {
+	              DEBUG_puts("1ippWriteIO: Could not write IPP "
+		                 "attribute...");
+		      _cupsBufferRelease((char *)buffer);
+		      return (IPP_STATE_ERROR);
+	            }
 
- /*
-  * Finally, add 1 byte for the "end of attributes" tag or 5 bytes
-  * for the "end of collection" tag and return...
-  */
+		    bufptr = buffer;
+		  }
 
-  if (collection)
-    bytes += 5;
-  else
-    bytes ++;
+		  if (i)
+		  {
+		   /*
+		    * Arrays and sets are done by sending additional
+		    * values with a zero-length name...
+		    */
 
-  DEBUG_printf(("4ipp_length: Returning " CUPS_LLFMT " bytes", CUPS_LLCAST bytes));
+                    *bufptr++ = (ipp_uchar_t)attr->value_tag;
+		    *bufptr++ = 0;
+		    *bufptr++ = 0;
+		  }
 
-  return (bytes);
-}
+                 /*
+		  * Resolution values consist of a 2-byte length,
+		  * 4-byte horizontal resolution value, 4-byte vertical
+		  * resolution value, and a 1-byte units value.
+		  *
+		  * Put the 2-byte length and resolution value data
+		  * into the buffer.
+		  */
 
+	          *bufptr++ = 0;
+		  *bufptr++ = 9;
+		  *bufptr++ = (ipp_uchar_t)(value->resolution.xres >> 24);
+		  *bufptr++ = (ipp_uchar_t)(value->resolution.xres >> 16);
+		  *bufptr++ = (ipp_uchar_t)(value->resolution.xres >> 8);
+		  *bufptr++ = (ipp_uchar_t)value->resolution.xres;
+		  *bufptr++ = (ipp_uchar_t)(value->resolution.yres >> 24);
+		  *bufptr++ = (ipp_uchar_t)(value->resolution.yres >> 16);
+		  *bufptr++ = (ipp_uchar_t)(value->resolution.yres >> 8);
+		  *bufptr++ = (ipp_uchar_t)value->resolution.yres;
+		  *bufptr++ = (ipp_uchar_t)value->resolution.units;
+		}
+		break;
 
-/*
- * 'ipp_read_http()' - Semi-blocking read on a HTTP connection...
- */
+	    case IPP_TAG_RANGE :
+	        for (i = 0, value = attr->values;
+		     i < attr->num_values;
+		     i ++, value ++)
+		{
+                  if ((IPP_BUF_SIZE - (bufptr - buffer)) < 13)
+		  {
+                    if ((*cb)(dst, buffer, (size_t)(bufptr - buffer)) < 0)
+	            {
+	              DEBUG_puts("1ippWriteIO: Could not write IPP "
+		                 "attribute...");
+		      _cupsBufferRelease((char *)buffer);
+	              return (IPP_STATE_ERROR);
+	            }
 
-static ssize_t				/* O - Number of bytes read */
-ipp_read_http(http_t      *http,	/* I - Client connection */
-              ipp_uchar_t *buffer,	/* O - Buffer for data */
-	      size_t      length)	/* I - Total length */
-{
-  ssize_t	tbytes,			/* Total bytes read */
-		bytes;			/* Bytes read this pass */
+		    bufptr = buffer;
+		  }
 
+		  if (i)
+		  {
+		   /*
+		    * Arrays and sets are done by sending additional
+		    * values with a zero-length name...
+		    */
 
-  DEBUG_printf(("7ipp_read_http(http=%p, buffer=%p, length=%d)", (void *)http, (void *)buffer, (int)length));
+                    *bufptr++ = (ipp_uchar_t)attr->value_tag;
+		    *bufptr++ = 0;
+		    *bufptr++ = 0;
+		  }
 
- /*
-  * Loop until all bytes are read...
-  */
+                 /*
+		  * Range values consist of a 2-byte length,
+		  * 4-byte lower value, and 4-byte upper value.
+		  *
+		  * Put the 2-byte length and range value data
+		  * into the buffer.
+		  */
 
-  for (tbytes = 0, bytes = 0;
-       tbytes < (int)length;
-       tbytes += bytes, buffer += bytes)
-  {
-    DEBUG_printf(("9ipp_read_http: tbytes=" CUPS_LLFMT ", http->state=%d", CUPS_LLCAST tbytes, http->state));
+	          *bufptr++ = 0;
+		  *bufptr++ = 8;
+		  *bufptr++ = (ipp_uchar_t)(value->range.lower >> 24);
+		  *bufptr++ = (ipp_uchar_t)(value->range.lower >> 16);
+		  *bufptr++ = (ipp_uchar_t)(value->range.lower >> 8);
+		  *bufptr++ = (ipp_uchar_t)value->range.lower;
+		  *bufptr++ = (ipp_uchar_t)(value->range.upper >> 24);
+		  *bufptr++ = (ipp_uchar_t)(value->range.upper >> 16);
+		  *bufptr++ = (ipp_uchar_t)(value->range.upper >> 8);
+		  *bufptr++ = (ipp_uchar_t)value->range.upper;
+		}
+		break;
 
-    if (http->state == HTTP_STATE_WAITING)
-      break;
+	    case IPP_TAG_TEXTLANG :
+	    case IPP_TAG_NAMELANG :
+	        for (i = 0, value = attr->values;
+		     i < attr->num_values;
+		     i ++, value ++)
+		{
+		  if (i)
+		  {
+		   /*
+		    * Arrays and sets are done by sending additional
+		    * values with a zero-length name...
+		    */
 
-    if (http->used == 0 && !http->blocking)
-    {
-     /*
-      * Wait up to 10 seconds for more data on non-blocking sockets...
-      */
+                    if ((IPP_BUF_SIZE - (bufptr - buffer)) < 3)
+		    {
+                      if ((*cb)(dst, buffer, (size_t)(bufptr - buffer)) < 0)
+	              {
+	        	DEBUG_puts("1ippWriteIO: Could not write IPP "
+		                   "attribute...");
+			_cupsBufferRelease((char *)buffer);
+	        	return (IPP_STATE_ERROR);
+	              }
 
-      if (!httpWait(http, 10000))
-      {
-       /*
-	* Signal no data...
-	*/
+		      bufptr = buffer;
+		    }
 
-	bytes = -1;
-	break;
-      }
-    }
-    else if (http->used == 0 && http->timeout_value > 0)
-    {
-     /*
-      * Wait up to timeout seconds for more data on blocking sockets...
-      */
+                    *bufptr++ = (ipp_uchar_t)attr->value_tag;
+		    *bufptr++ = 0;
+		    *bufptr++ = 0;
+		  }
 
-      if (!httpWait(http, (int)(1000 * http->timeout_value)))
-      {
-       /*
-	* Signal no data...
-	*/
+                 /*
+		  * textWithLanguage and nameWithLanguage values consist
+		  * of a 2-byte length for both strings and their
+		  * individual lengths, a 2-byte length for the
+		  * character string, the character string without the
+		  * trailing nul, a 2-byte length for the character
+		  * set string, and the character set string without
+		  * the trailing nul.
+		  */
 
-	bytes = -1;
-	break;
-      }
-    }
+                  n = 4;
 
-    if ((bytes = httpRead2(http, (char *)buffer, length - (size_t)tbytes)) < 0)
-    {
-#ifdef _WIN32
-      break;
-#else
-      if (errno != EAGAIN && errno != EINTR)
-	break;
+		  if (value->string.language != NULL)
+                    n += (int)strlen(value->string.language);
 
-      bytes = 0;
-#endif /* _WIN32 */
-    }
-    else if (bytes == 0)
-      break;
-  }
+		  if (value->string.text != NULL)
+                    n += (int)strlen(value->string.text);
 
- /*
-  * Return the number of bytes read...
-  */
+                  if (n > (IPP_BUF_SIZE - 2))
+		  {
+		    DEBUG_printf(("1ippWriteIO: text/nameWithLanguage value "
+		                  "too long (%d)", n));
+		    _cupsBufferRelease((char *)buffer);
+		    return (IPP_STATE_ERROR);
+                  }
 
-  if (tbytes == 0 && bytes < 0)
-    tbytes = -1;
+                  if ((int)(IPP_BUF_SIZE - (bufptr - buffer)) < (n + 2))
+		  {
+                    if ((*cb)(dst, buffer, (size_t)(bufptr - buffer)) < 0)
+	            {
+	              DEBUG_puts("1ippWriteIO: Could not write IPP "
+		                 "attribute...");
+		      _cupsBufferRelease((char *)buffer);
+	              return (IPP_STATE_ERROR);
+	            }
 
-  DEBUG_printf(("8ipp_read_http: Returning " CUPS_LLFMT " bytes", CUPS_LLCAST tbytes));
+		    bufptr = buffer;
+		  }
 
-  return (tbytes);
-}
+                 /* Length of entire value */
+	          *bufptr++ = (ipp_uchar_t)(n >> 8);
+		  *bufptr++ = (ipp_uchar_t)n;
 
+                 /* Length of language */
+		  if (value->string.language != NULL)
+		    n = (int)strlen(value->string.language);
+		  else
+		    n = 0;
 
-/*
- * 'ipp_read_file()' - Read IPP data from a file.
- */
+	          *bufptr++ = (ipp_uchar_t)(n >> 8);
+		  *bufptr++ = (ipp_uchar_t)n;
 
-static ssize_t				/* O - Number of bytes read */
-ipp_read_file(int         *fd,		/* I - File descriptor */
-              ipp_uchar_t *buffer,	/* O - Read buffer */
-	      size_t      length)	/* I - Number of bytes to read */
-{
-#ifdef _WIN32
-  return ((ssize_t)read(*fd, buffer, (unsigned)length));
-#else
-  return (read(*fd, buffer, length));
-#endif /* _WIN32 */
-}
+                 /* Language */
+		  if (n > 0)
+		  {
+		    memcpy(bufptr, value->string.language, (size_t)n);
+		    bufptr += n;
+		  }
 
+                 /* Length of text */
+                  if (value->string.text != NULL)
+		    n = (int)strlen(value->string.text);
+		  else
+		    n = 0;
 
-/*
- * 'ipp_set_error()' - Set a formatted, localized error string.
- */
+	          *bufptr++ = (ipp_uchar_t)(n >> 8);
+		  *bufptr++ = (ipp_uchar_t)n;
 
-static void
-ipp_set_error(ipp_status_t status,	/* I - Status code */
-              const char   *format,	/* I - Printf-style error string */
-	      ...)			/* I - Additional arguments as needed */
-{
-  va_list	ap;			/* Pointer to additional args */
-  char		buffer[2048];		/* Message buffer */
-  cups_lang_t	*lang = cupsLangDefault();
-					/* Current language */
+                 /* Text */
+		  if (n > 0)
+		  {
+		    memcpy(bufptr, value->string.text, (size_t)n);
+		    bufptr += n;
+		  }
+		}
+		break;
 
+            case IPP_TAG_BEGIN_COLLECTION :
+	        for (i = 0, value = attr->values;
+		     i < attr->num_values;
+		     i ++, value ++)
+		{
+		 /*
+		  * Collections are written with the begin-collection
+		  * tag first with a value of 0 length, followed by the
+		  * attributes in the collection, then the end-collection
+		  * value...
+		  */
 
-  va_start(ap, format);
-  vsnprintf(buffer, sizeof(buffer), _cupsLangString(lang, format), ap);
-  va_end(ap);
+                  if ((IPP_BUF_SIZE - (bufptr - buffer)) < 5)
+		  {
+                    if ((*cb)(dst, buffer, (size_t)(bufptr - buffer)) < 0)
+	            {
+	              DEBUG_puts("1ippWriteIO: Could not write IPP "
+		                 "attribute...");
+		      _cupsBufferRelease((char *)buffer);
+	              return (IPP_STATE_ERROR);
+	            }
 
-  _cupsSetError(status, buffer, 0);
-}
+		    bufptr = buffer;
+		  }
 
+		  if (i)
+		  {
+		   /*
+		    * Arrays and sets are done by sending additional
+		    * values with a zero-length name...
+		    */
 
-/*
- * 'ipp_set_value()' - Get the value element from an attribute, expanding it as
- *                     needed.
- */
+                    *bufptr++ = (ipp_uchar_t)attr->value_tag;
+		    *bufptr++ = 0;
+		    *bufptr++ = 0;
+		  }
 
-static _ipp_value_t *			/* O  - IPP value element or NULL on error */
-ipp_set_value(ipp_t           *ipp,	/* IO - IPP message */
-              ipp_attribute_t **attr,	/* IO - IPP attribute */
-              int             element)	/* I  - Value number (0-based) */
-{
-  ipp_attribute_t	*temp,		/* New attribute pointer */
-			*current,	/* Current attribute in list */
-			*prev;		/* Previous attribute in list */
-  int			alloc_values;	/* Allocated values */
+                 /*
+		  * Write a data length of 0 and flush the buffer...
+		  */
 
+	          *bufptr++ = 0;
+		  *bufptr++ = 0;
 
- /*
-  * If we are setting an existing value element, return it...
-  */
+                  if ((*cb)(dst, buffer, (size_t)(bufptr - buffer)) < 0)
+	          {
+	            DEBUG_puts("1ippWriteIO: Could not write IPP "
+		               "attribute...");
+		    _cupsBufferRelease((char *)buffer);
+	            return (IPP_STATE_ERROR);
+	          }
 
-  temp = *attr;
+		  bufptr = buffer;
 
-  if (temp->num_values <= 1)
-    alloc_values = 1;
-  else
-    alloc_values = (temp->num_values + IPP_MAX_VALUES - 1) &
-                   ~(IPP_MAX_VALUES - 1);
+                 /*
+		  * Then write the collection attribute...
+		  */
 
-  if (element < alloc_values)
-  {
-    if (element >= temp->num_values)
-      temp->num_values = element + 1;
+                  value->collection->state = IPP_STATE_IDLE;
 
-    return (temp->values + element);
-  }
+		  if (ipp_write_io(dst, cb, 1, ipp,
+		                   value->collection) == IPP_STATE_ERROR)
+		  {
+		    DEBUG_puts("1ippWriteIO: Unable to write collection value");
+		    _cupsBufferRelease((char *)buffer);
+		    return (IPP_STATE_ERROR);
+		  }
+		}
+		break;
 
- /*
-  * Otherwise re-allocate the attribute - we allocate in groups of IPP_MAX_VALUE
-  * values when num_values > 1.
-  */
+            default :
+	        for (i = 0, value = attr->values;
+		     i < attr->num_values;
+		     i ++, value ++)
+		{
+		  if (i)
+		  {
+		   /*
+		    * Arrays and sets are done by sending additional
+		    * values with a zero-length name...
+		    */
 
-  if (alloc_values < IPP_MAX_VALUES)
-    alloc_values = IPP_MAX_VALUES;
-  else
-    alloc_values += IPP_MAX_VALUES;
+                    if ((IPP_BUF_SIZE - (bufptr - buffer)) < 3)
+		    {
+                      if ((*cb)(dst, buffer, (size_t)(bufptr - buffer)) < 0)
+	              {
+	        	DEBUG_puts("1ippWriteIO: Could not write IPP "
+		                   "attribute...");
+			_cupsBufferRelease((char *)buffer);
+	        	return (IPP_STATE_ERROR);
+	              }
 
-  DEBUG_printf(("4ipp_set_value: Reallocating for up to %d values.",
-                alloc_values));
+		      bufptr = buffer;
+		    }
 
- /*
-  * Reallocate memory...
-  */
+                    *bufptr++ = (ipp_uchar_t)attr->value_tag;
+		    *bufptr++ = 0;
+		    *bufptr++ = 0;
+		  }
 
-  if ((temp = realloc(temp, sizeof(ipp_attribute_t) + (size_t)(alloc_values - 1) * sizeof(_ipp_value_t))) == NULL)
-  {
-    _cupsSetHTTPError(HTTP_STATUS_ERROR);
-    DEBUG_puts("4ipp_set_value: Unable to resize attribute.");
-    return (NULL);
-  }
+                 /*
+		  * An unknown value might some new value that a
+		  * vendor has come up with. It consists of a
+		  * 2-byte length and the bytes in the unknown
+		  * value buffer.
+		  */
 
- /*
-  * Zero the new memory...
-  */
+                  n = value->unknown.length;
 
-  memset(temp->values + temp->num_values, 0, (size_t)(alloc_values - temp->num_values) * sizeof(_ipp_value_t));
+                  if (n > (IPP_BUF_SIZE - 2))
+		  {
+		    DEBUG_printf(("1ippWriteIO: Data length too long (%d)",
+		                  n));
+		    _cupsBufferRelease((char *)buffer);
+		    return (IPP_STATE_ERROR);
+		  }
 
-  if (temp != *attr)
-  {
-   /*
-    * Reset pointers in the list...
-    */
+                  if ((int)(IPP_BUF_SIZE - (bufptr - buffer)) < (n + 2))
+		  {
+                    if ((*cb)(dst, buffer, (size_t)(bufptr - buffer)) < 0)
+	            {
+	              DEBUG_puts("1ippWriteIO: Could not write IPP "
+		                 "attribute...");
+		      _cupsBufferRelease((char *)buffer);
+	              return (IPP_STATE_ERROR);
+	            }
 
-#ifndef __clang_analyzer__
-    DEBUG_printf(("4debug_free: %p %s", (void *)*attr, temp->name));
-#endif /* !__clang_analyzer__ */
-    DEBUG_printf(("4debug_alloc: %p %s %s%s (%d)", (void *)temp, temp->name, temp->num_values > 1 ? "1setOf " : "", ippTagString(temp->value_tag), temp->num_values));
+		    bufptr = buffer;
+		  }
 
-    if (ipp->current == *attr && ipp->prev)
-    {
-     /*
-      * Use current "previous" pointer...
-      */
+                 /* Length of unknown value */
+	          *bufptr++ = (ipp_uchar_t)(n >> 8);
+		  *bufptr++ = (ipp_uchar_t)n;
 
-      prev = ipp->prev;
-    }
-    else
-    {
-     /*
-      * Find this attribute in the linked list...
-      */
+                 /* Value */
+		  if (n > 0)
+		  {
+		    memcpy(bufptr, value->unknown.data, (size_t)n);
+		    bufptr += n;
+		  }
+		}
+		break;
+	  }
 
-      for (prev = NULL, current = ipp->attrs;
-	   current && current != *attr;
-	   prev = current, current = current->next);
+         /*
+	  * Write the data out...
+	  */
 
-      if (!current)
-      {
-       /*
-	* This is a serious error!
-	*/
+	  if (bufptr > buffer)
+	  {
+	    if ((*cb)(dst, buffer, (size_t)(bufptr - buffer)) < 0)
+	    {
+	      DEBUG_puts("1ippWriteIO: Could not write IPP attribute...");
+	      _cupsBufferRelease((char *)buffer);
+	      return (IPP_STATE_ERROR);
+	    }
 
-	*attr = temp;
-	_cupsSetError(IPP_STATUS_ERROR_INTERNAL,
-	              _("IPP attribute is not a member of the message."), 1);
-	DEBUG_puts("4ipp_set_value: Unable to find attribute in message.");
-	return (NULL);
-      }
-    }
+	    DEBUG_printf(("2ippWriteIO: wrote %d bytes",
+			  (int)(bufptr - buffer)));
+	  }
 
-    if (prev)
-      prev->next = temp;
-    else
-      ipp->attrs = temp;
+	 /*
+          * If blocking is disabled and we aren't at the end of the attribute
+          * list, stop here...
+	  */
 
-    ipp->current = temp;
-    ipp->prev    = prev;
+          if (!blocking && ipp->current)
+	    break;
+	}
 
-    if (ipp->last == *attr)
-      ipp->last = temp;
+	if (ipp->current == NULL)
+	{
+         /*
+	  * Done with all of the attributes; add the end-of-attributes
+	  * tag or end-collection attribute...
+	  */
 
-    *attr = temp;
-  }
+          if (parent == NULL)
+	  {
+            buffer[0] = IPP_TAG_END;
+	    n         = 1;
+	  }
+	  else
+	  {
+            buffer[0] = IPP_TAG_END_COLLECTION;
+	    buffer[1] = 0; /* empty name */
+	    buffer[2] = 0;
+	    buffer[3] = 0; /* empty value */
+	    buffer[4] = 0;
+	    n         = 5;
+	  }
 
- /*
-  * Return the value element...
-  */
+	  if ((*cb)(dst, buffer, (size_t)n) < 0)
+	  {
+	    DEBUG_puts("1ippWriteIO: Could not write IPP end-tag...");
+	    _cupsBufferRelease((char *)buffer);
+	    return (IPP_STATE_ERROR);
+	  }
 
-  if (element >= temp->num_values)
-    temp->num_values = element + 1;
+	  ipp->state = IPP_STATE_DATA;
+	}
+        break;
 
-  return (temp->values + element);
-}
+    case IPP_STATE_DATA :
+        break;
 
+    default :
+        break; /* anti-compiler-warning-code */
+  }
 
-/*
- * 'ipp_write_file()' - Write IPP data to a file.
- */
+  _cupsBufferRelease((char *)buffer);
 
-static ssize_t				/* O - Number of bytes written */
-ipp_write_file(int         *fd,		/* I - File descriptor */
-               ipp_uchar_t *buffer,	/* I - Data to write */
-               size_t      length)	/* I - Number of bytes to write */
-{
-#ifdef _WIN32
-  return ((ssize_t)write(*fd, buffer, (unsigned)length));
-#else
-  return (write(*fd, buffer, length));
-#endif /* _WIN32 */
+  return (ipp->state);
 }
@@ -241,6 +241,93 @@ typedef enum ipp_jstate_e		/**** Job states ****/
 #  endif /* !_CUPS_NO_DEPRECATED */
 } ipp_jstate_t;
 
+typedef enum ipp_name_e			/**** Well-known attribute names @since CUPS 2.3@ ****/
+{
+  IPP_NAME_UNKNOWN,			/* Not a well-known attribute name */
+  IPP_NAME_ATTRIBUTES_CHARSET,		/* attributes-charset */
+  IPP_NAME_ATTRIBUTES_NATURAL_LANGUAGE,	/* attributes-natural-language */
+  IPP_NAME_COMPRESSION,			/* compression */
+  IPP_NAME_COPIES,			/* copies */
+  IPP_NAME_COPIES_DEFAULT,		/* copies-default */
+  IPP_NAME_COPIES_SUPPORTED,		/* copies-supported */
+  IPP_NAME_DOCUMENT_FORMAT,		/* document-format */
+  IPP_NAME_DOCUMENT_FORMAT_DEFAULT,	/* document-format-default */
+  IPP_NAME_DOCUMENT_FORMAT_SUPPORTED,	/* document-format-supported */
+  IPP_NAME_DOCUMENT_NAME,		/* document-name */
+  IPP_NAME_DOCUMENT_NUMBER,		/* document-number */
+  IPP_NAME_DOCUMENT_STATE,		/* document-state */
+  IPP_NAME_DOCUMENT_STATE_REASONS,	/* document-state-reasons */
+  IPP_NAME_FINISHINGS,			/* finishings */
+  IPP_NAME_FINISHINGS_ACTUAL,		/* finishings-actual */
+  IPP_NAME_FINISHINGS_COL,		/* finishings-col */
+  IPP_NAME_FINISHINGS_DEFAULT,		/* finishings-default */
+  IPP_NAME_FINISHINGS_READY,		/* finishings-ready */
+  IPP_NAME_FINISHINGS_SUPPORTED,	/* finishings-supported */
+  IPP_NAME_FIRST_INDEX,			/* first-index */
+  IPP_NAME_IPP_ATTRIBUTE_FIDELITY,	/* ipp-attribute-fidelity */
+  IPP_NAME_JOB_COLLATION_TYPE,		/* job-collation-type */
+  IPP_NAME_JOB_COLLATION_TYPE_ACTUAL,	/* job-collation-type-actual */
+  IPP_NAME_JOB_FINISHINGS,		/* job-finishings */
+  IPP_NAME_JOB_FINISHINGS_DEFAULT,	/* job-finishings-default */
+  IPP_NAME_JOB_FINISHINGS_SUPPORTED,	/* job-finishings-supported */
+  IPP_NAME_JOB_HOLD_UNTIL,		/* job-hold-until */
+  IPP_NAME_JOB_ID,			/* job-id */
+  IPP_NAME_JOB_IDS,			/* job-ids */
+  IPP_NAME_JOB_IMPRESSIONS,		/* job-impressions */
+  IPP_NAME_JOB_IMPRESSIONS_COMPLETED,	/* job-impressions-completed */
+  IPP_NAME_JOB_K_OCTETS,		/* job-k-octets */
+  IPP_NAME_JOB_NAME,			/* job-name */
+  IPP_NAME_JOB_ORIGINATING_USER_NAME,	/* job-originating-user-name */
+  IPP_NAME_JOB_PRINTER_URI,		/* job-printer-uri */
+  IPP_NAME_JOB_PRIORITY,		/* job-priority */
+  IPP_NAME_JOB_STATE,			/* job-state */
+  IPP_NAME_JOB_STATE_MESSAGE,		/* job-state-message */
+  IPP_NAME_JOB_STATE_REASONS,		/* job-state-reasons */
+  IPP_NAME_JOB_URI,			/* job-uri */
+  IPP_NAME_JOB_UUID,			/* job-uuid */
+  IPP_NAME_LAST_DOCUMENT,		/* last-document */
+  IPP_NAME_LIMIT,			/* limit */
+  IPP_NAME_MEDIA,			/* media */
+  IPP_NAME_MEDIA_COL,			/* media-col */
+  IPP_NAME_MEDIA_COL_DATABASE,		/* media-col-database */
+  IPP_NAME_MEDIA_COL_DEFAULT,		/* media-col-default */
+  IPP_NAME_MEDIA_COL_READY,		/* media-col-ready */
+  IPP_NAME_MEDIA_DEFAULT,		/* media-default */
+  IPP_NAME_MEDIA_READY,			/* media-ready */
+  IPP_NAME_MEDIA_SUPPORTED,		/* media-supported */
+  IPP_NAME_MULTIPLE_DOCUMENT_HANDLING,	/* multiple-document-handling */
+  IPP_NAME_MY_JOBS,			/* my-jobs */
+  IPP_NAME_NOTIFY_EVENTS,		/* notify-events */
+  IPP_NAME_NOTIFY_JOB_ID,		/* notify-job-id */
+  IPP_NAME_NOTIFY_SUBSCRIPTION_ID,	/* notify-subscription-id */
+  IPP_NAME_NOTIFY_SUBSCRIPTION_IDS,	/* notify-subscription-ids */
+  IPP_NAME_OPERATIONS_SUPPORTED,	/* operations-supported */
+  IPP_NAME_ORIENTATION_REQUESTED,	/* orientation-requested */
+  IPP_NAME_ORIENTATION_REQUESTED_ACTUAL,	/* orientation-requested-actual */
+  IPP_NAME_ORIENTATION_REQUESTED_DEFAULT,	/* orientation-requested-default */
+  IPP_NAME_ORIENTATION_REQUESTED_SUPPORTED,	/* orientation-requested-supported */
+  IPP_NAME_OUTPUT_BIN,			/* output-bin */
+  IPP_NAME_PAGE_RANGES,			/* page-ranges */
+  IPP_NAME_PRINT_COLOR_MODE,		/* print-color-mode */
+  IPP_NAME_PRINT_QUALITY,		/* print-quality */
+  IPP_NAME_PRINT_QUALITY_ACTUAL,	/* print-quality-actual */
+  IPP_NAME_PRINT_QUALITY_DEFAULT,	/* print-quality-default */
+  IPP_NAME_PRINT_QUALITY_SUPPORTED,	/* print-quality-supported */
+  IPP_NAME_PRINTER_RESOLUTION,		/* printer-resolution */
+  IPP_NAME_PRINTER_STATE,		/* printer-state */
+  IPP_NAME_PRINTER_STATE_MESSAGE,	/* printer-state-message */
+  IPP_NAME_PRINTER_STATE_REASONS,	/* printer-state-reasons */
+  IPP_NAME_PRINTER_URI,			/* printer-uri */
+  IPP_NAME_REQUESTED_ATTRIBUTES,	/* requested-attributes */
+  IPP_NAME_REQUESTING_USER_NAME,	/* requesting-user-name */
+  IPP_NAME_RESOURCE_ID,			/* resource-id */
+  IPP_NAME_RESOURCE_STATE,		/* resource-state */
+  IPP_NAME_SIDES,			/* sides */
+  IPP_NAME_SYSTEM_STATE,		/* system-state */
+  IPP_NAME_SYSTEM_URI,			/* system-uri */
+  IPP_NAME_WHICH_JOBS			/* which-jobs */
+} ipp_name_t;
+
 typedef enum ipp_op_e			/**** IPP operations ****/
 {
   IPP_OP_CUPS_INVALID = -1,		/* Invalid operation name for @link ippOpValue@ */
@@ -937,6 +1024,14 @@ extern int		ippValidateAttributes(ipp_t *ipp) _CUPS_API_1_7;
 extern const char	*ippStateString(ipp_state_t state) _CUPS_API_2_0;
 
 
+/**** New in CUPS 2.3 ****/
+extern ipp_state_t	ippReadNext(http_t *http, ipp_t *ipp, ipp_attribute_t **attr) _CUPS_API_2_3;
+extern ssize_t		ippWriteBuffer(ipp_t *ipp, ipp_uchar_t **buffer, size_t *bufsize) _CUPS_API_2_3;
+extern ipp_name_t	ippGetNameId(ipp_attribute_t *attr) _CUPS_API_2_3;
+extern const char	*ippNameString(ipp_name_t name) _CUPS_API_2_3;
+extern ipp_name_t	ippNameValue(const char *name) _CUPS_API_2_3;
+
+
 /*
  * C++ magic...
  */
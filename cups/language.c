@@ -16,20 +16,57 @@
 #ifdef HAVE_LANGINFO_H
 #  include <langinfo.h>
 #endif /* HAVE_LANGINFO_H */
+#include <sys/stat.h>
 #ifdef _WIN32
 #  include <io.h>
 #else
 #  include <unistd.h>
+#  include <sys/mman.h>
 #endif /* _WIN32 */
 #ifdef HAVE_COREFOUNDATION_H
 #  include <CoreFoundation/CoreFoundation.h>
 #endif /* HAVE_COREFOUNDATION_H */
 
 
+/*
+ * Local constants...
+ */
+
+#define CUPS_CATALOG_MAGIC	"CUPSCAT1"
+					/* Compiled catalog magic string */
+#define CUPS_CATALOG_ORDER	0x01020304
+					/* Compiled catalog byte order marker */
+#define CUPS_CATALOG_HEADER	20	/* Size of compiled catalog header */
+
+
+/*
+ * Local types...
+ */
+
+typedef struct _cups_catalog_s		/**** Compiled message catalog ****/
+{
+  char		*filename;		/* Catalog filename */
+  time_t	mtime;			/* Modification time of file */
+  off_t		size;			/* Size of file */
+  int		ref_count;		/* Number of message arrays using it */
+  char		*data;			/* Catalog data */
+  size_t	datalen;		/* Length of catalog data */
+  int		mapped;			/* Is the data memory-mapped? */
+  uint32_t	num_entries,		/* Number of messages */
+		num_buckets;		/* Number of hash buckets (power of 2) */
+  const uint32_t *buckets,		/* Hash buckets (message index + 1) */
+		*entries;		/* Messages (hash, msg, str, next + 1) */
+} _cups_catalog_t;
+
+
 /*
  * Local globals...
  */
 
+static cups_array_t	*catalog_cache = NULL;
+					/* Process-wide compiled catalog cache */
+static _cups_mutex_t	catalog_mutex = _CUPS_MUTEX_INITIALIZER;
+					/* Mutex to control access to catalogs */
 static _cups_mutex_t	lang_mutex = _CUPS_MUTEX_INITIALIZER;
 					/* Mutex to control access to cache */
 static cups_lang_t	*lang_cache = NULL;
@@ -145,6 +182,15 @@ static cups_array_t	*appleMessageLoad(const char *locale) CF_RETURNS_RETAINED;
 #  endif /* CUPS_BUNDLEDIR */
 #endif /* __APPLE__ */
 static cups_lang_t	*cups_cache_lookup(const char *name, cups_encoding_t encoding);
+#if !defined(__APPLE__) || !defined(CUPS_BUNDLEDIR)
+static int		cups_catalog_compare(_cups_catalog_t *a, _cups_catalog_t *b);
+#endif /* !__APPLE__ || !CUPS_BUNDLEDIR */
+#if !defined(__APPLE__) || !defined(CUPS_BUNDLEDIR)
+static const char	*cups_catalog_lookup(_cups_catalog_t *catalog, const char *m);
+static _cups_catalog_t	*cups_catalog_open(const char *filename);
+static void		cups_catalog_release(_cups_catalog_t *catalog);
+#endif /* !__APPLE__ || !CUPS_BUNDLEDIR */
+static int		cups_catalog_save(cups_file_t *fp, cups_array_t *a);
 static int		cups_message_compare(_cups_message_t *m1, _cups_message_t *m2);
 static void		cups_message_free(_cups_message_t *m);
 static void		cups_message_load(cups_lang_t *lang);
@@ -895,6 +941,14 @@ _cupsMessageFree(cups_array_t *a)	/* I - Message array */
 
   if (cupsArrayUserData(a))
     CFRelease((CFDictionaryRef)cupsArrayUserData(a));
+
+#else
+ /*
+  * Release the compiled catalog as needed...
+  */
+
+  if (cupsArrayUserData(a))
+    cups_catalog_release((_cups_catalog_t *)cupsArrayUserData(a));
 #endif /* __APPLE__ && CUPS_BUNDLEDIR */
 
  /*
@@ -907,6 +961,11 @@ _cupsMessageFree(cups_array_t *a)	/* I - Message array */
 
 /*
  * '_cupsMessageLoad()' - Load a .po or .strings file into a messages array.
+ *
+ * Compiled catalogs written by @link _cupsMessageSave@ are detected
+ * automatically and memory-mapped; lookups then use the catalog's hash index
+ * and the array itself is empty.  Compiled catalogs are shared by all arrays
+ * that load the same unchanged file.
  */
 
 cups_array_t *				/* O - New message array */
@@ -925,6 +984,26 @@ _cupsMessageLoad(const char *filename,	/* I - Message catalog to load */
 
   DEBUG_printf(("4_cupsMessageLoad(filename=\"%s\")", filename));
 
+#if !defined(__APPLE__) || !defined(CUPS_BUNDLEDIR)
+ /*
+  * Use a compiled catalog as needed...
+  */
+
+  {
+    _cups_catalog_t	*catalog;	/* Compiled catalog */
+
+    if ((catalog = cups_catalog_open(filename)) != NULL)
+    {
+      DEBUG_printf(("5_cupsMessageLoad: Returning compiled catalog with %u messages...", catalog->num_entries));
+
+      if ((a = _cupsMessageNew(catalog)) == NULL)
+        cups_catalog_release(catalog);
+
+      return (a);
+    }
+  }
+#endif /* !__APPLE__ || !CUPS_BUNDLEDIR */
+
  /*
   * Create an array to hold the messages...
   */
@@ -1204,6 +1283,19 @@ _cupsMessageLookup(cups_array_t *a,	/* I - Message array */
     if (cfm)
       CFRelease(cfm);
   }
+
+#else
+  if (!match && cupsArrayUserData(a))
+  {
+   /*
+    * Try looking the string up in the compiled catalog...
+    */
+
+    const char	*s;			/* Localized text */
+
+    if ((s = cups_catalog_lookup((_cups_catalog_t *)cupsArrayUserData(a), m)) != NULL)
+      return (s);
+  }
 #endif /* __APPLE__ && CUPS_BUNDLEDIR */
 
   if (match && match->str)
@@ -1229,6 +1321,10 @@ _cupsMessageNew(void *context)		/* I - User data */
 
 /*
  * '_cupsMessageSave()' - Save a message catalog array.
+ *
+ * The `_CUPS_MESSAGE_COMPILED` flag writes a compiled catalog with a hash
+ * index that @link _cupsMessageLoad@ can memory-map.  Only the messages in the
+ * array are saved, so arrays loaded from a compiled catalog cannot be saved.
  */
 
 int					/* O - 0 on success, -1 on failure */
@@ -1251,7 +1347,15 @@ _cupsMessageSave(const char   *filename,/* I - Output filename */
   * Write each message...
   */
 
-  if (flags & _CUPS_MESSAGE_STRINGS)
+  if (flags & _CUPS_MESSAGE_COMPILED)
+  {
+    if (cups_catalog_save(fp, a))
+    {
+      cupsFileClose(fp);
+      return (-1);
+    }
+  }
+  else if (flags & _CUPS_MESSAGE_STRINGS)
   {
     for (m = (_cups_message_t *)cupsArrayFirst(a); m; m = (_cups_message_t *)cupsArrayNext(a))
     {
@@ -1642,6 +1746,354 @@ cups_cache_lookup(
 }
 
 
+#if !defined(__APPLE__) || !defined(CUPS_BUNDLEDIR)
+/*
+ * 'cups_catalog_compare()' - Compare two compiled catalogs.
+ */
+
+static int				/* O - Result of comparison */
+cups_catalog_compare(
+    _cups_catalog_t *a,			/* I - First catalog */
+    _cups_catalog_t *b)			/* I - Second catalog */
+{
+  int	result;				/* Result of comparison */
+
+
+  if ((result = strcmp(a->filename, b->filename)) != 0)
+    return (result);
+  else if (a->mtime != b->mtime)
+    return (a->mtime < b->mtime ? -1 : 1);
+  else if (a->size != b->size)
+    return (a->size < b->size ? -1 : 1);
+  else
+    return (0);
+}
+#endif /* !__APPLE__ || !CUPS_BUNDLEDIR */
+
+
+#if !defined(__APPLE__) || !defined(CUPS_BUNDLEDIR)
+/*
+ * 'cups_catalog_lookup()' - Lookup a message in a compiled catalog.
+ */
+
+static const char *			/* O - Localized text or `NULL` */
+cups_catalog_lookup(
+    _cups_catalog_t *catalog,		/* I - Compiled catalog */
+    const char      *m)			/* I - Message */
+{
+  unsigned		hash;		/* Hash of message */
+  uint32_t		i,		/* Current message (index + 1) */
+			count;		/* Number of messages checked */
+  const uint32_t	*entry;		/* Current message entry */
+
+
+  hash = _cupsStrHash(m);
+
+  for (i = catalog->buckets[hash & (catalog->num_buckets - 1)], count = 0; i > 0 && count < catalog->num_entries; i = entry[3], count ++)
+  {
+    entry = catalog->entries + 4 * (i - 1);
+
+    if (entry[0] == hash && !strcmp(catalog->data + entry[1], m))
+      return (catalog->data + entry[2]);
+  }
+
+  return (NULL);
+}
+
+
+/*
+ * 'cups_catalog_open()' - Open a compiled catalog.
+ *
+ * Catalogs are shared through a process-wide cache that is keyed by the
+ * filename, modification time, and size.
+ */
+
+static _cups_catalog_t *		/* O - Compiled catalog or `NULL` if not a compiled catalog */
+cups_catalog_open(const char *filename)	/* I - Catalog filename */
+{
+  struct stat		fileinfo;	/* File information */
+  _cups_catalog_t	key,		/* Search key */
+			*catalog;	/* Compiled catalog */
+  cups_file_t		*fp;		/* Catalog file */
+  char			header[CUPS_CATALOG_HEADER];
+					/* Catalog header */
+  uint32_t		order,		/* Byte order marker */
+			i;		/* Looping var */
+  const uint32_t	*entry;		/* Current message entry */
+
+
+  if (stat(filename, &fileinfo) || !S_ISREG(fileinfo.st_mode) || fileinfo.st_size < CUPS_CATALOG_HEADER || (uintmax_t)fileinfo.st_size > SIZE_MAX)
+    return (NULL);
+
+  _cupsMutexLock(&catalog_mutex);
+
+ /*
+  * See if we already have this catalog...
+  */
+
+  key.filename = (char *)filename;
+  key.mtime    = fileinfo.st_mtime;
+  key.size     = fileinfo.st_size;
+
+  if ((catalog = (_cups_catalog_t *)cupsArrayFind(catalog_cache, &key)) != NULL)
+  {
+    catalog->ref_count ++;
+    _cupsMutexUnlock(&catalog_mutex);
+
+    return (catalog);
+  }
+
+ /*
+  * Check the header...
+  */
+
+  if ((fp = cupsFileOpen(filename, "r")) == NULL)
+  {
+    _cupsMutexUnlock(&catalog_mutex);
+    return (NULL);
+  }
+
+  if (cupsFileCompression(fp) != CUPS_FILE_NONE || cupsFileRead(fp, header, sizeof(header)) != (ssize_t)sizeof(header) || memcmp(header, CUPS_CATALOG_MAGIC, 8))
+  {
+    cupsFileClose(fp);
+    _cupsMutexUnlock(&catalog_mutex);
+    return (NULL);
+  }
+
+  if ((catalog = calloc(1, sizeof(_cups_catalog_t))) == NULL)
+  {
+    cupsFileClose(fp);
+    _cupsMutexUnlock(&catalog_mutex);
+    return (NULL);
+  }
+
+ /*
+  * Map or read the catalog...
+  */
+
+  catalog->datalen = (size_t)fileinfo.st_size;
+
+#ifndef _WIN32
+  if ((catalog->data = mmap(NULL, catalog->datalen, PROT_READ, MAP_PRIVATE, cupsFileNumber(fp), 0)) != MAP_FAILED)
+    catalog->mapped = 1;
+  else
+    catalog->data = NULL;
+#endif /* !_WIN32 */
+
+  if (!catalog->data && (catalog->data = malloc(catalog->datalen)) != NULL)
+  {
+    memcpy(catalog->data, header, sizeof(header));
+
+    if (cupsFileRead(fp, catalog->data + sizeof(header), catalog->datalen - sizeof(header)) != (ssize_t)(catalog->datalen - sizeof(header)))
+    {
+      free(catalog->data);
+      catalog->data = NULL;
+    }
+  }
+
+  cupsFileClose(fp);
+
+  if (!catalog->data)
+    goto invalid;
+
+ /*
+  * Validate the header, hash buckets, and message entries...
+  */
+
+  memcpy(&order, catalog->data + 8, sizeof(order));
+  memcpy(&catalog->num_entries, catalog->data + 12, sizeof(catalog->num_entries));
+  memcpy(&catalog->num_buckets, catalog->data + 16, sizeof(catalog->num_buckets));
+
+  if (order != CUPS_CATALOG_ORDER || catalog->num_buckets == 0 || (catalog->num_buckets & (catalog->num_buckets - 1)) || catalog->num_buckets > catalog->datalen / 4 || catalog->num_entries > catalog->datalen / 16 || (CUPS_CATALOG_HEADER + 4 * (size_t)catalog->num_buckets + 16 * (size_t)catalog->num_entries) > catalog->datalen || catalog->data[catalog->datalen - 1])
+    goto invalid;
+
+  catalog->buckets = (const uint32_t *)(catalog->data + CUPS_CATALOG_HEADER);
+  catalog->entries = catalog->buckets + catalog->num_buckets;
+
+  for (i = 0; i < catalog->num_buckets; i ++)
+    if (catalog->buckets[i] > catalog->num_entries)
+      goto invalid;
+
+  for (i = 0, entry = catalog->entries; i < catalog->num_entries; i ++, entry += 4)
+    if (entry[1] >= catalog->datalen || entry[2] >= catalog->datalen || entry[3] > catalog->num_entries)
+      goto invalid;
+
+ /*
+  * Add it to the cache...
+  */
+
+  if (!catalog_cache)
+    catalog_cache = cupsArrayNew((cups_array_func_t)cups_catalog_compare, NULL);
+
+  if ((catalog->filename = strdup(filename)) == NULL)
+    goto invalid;
+
+  catalog->mtime     = fileinfo.st_mtime;
+  catalog->size      = fileinfo.st_size;
+  catalog->ref_count = 1;
+
+  cupsArrayAdd(catalog_cache, catalog);
+
+  _cupsMutexUnlock(&catalog_mutex);
+
+  DEBUG_printf(("9cups_catalog_open: Loaded %u messages from \"%s\".", catalog->num_entries, filename));
+
+  return (catalog);
+
+ /*
+  * If we get here the catalog is bad...
+  */
+
+  invalid:
+
+  DEBUG_printf(("9cups_catalog_open: Bad compiled catalog \"%s\".", filename));
+
+  _cupsMutexUnlock(&catalog_mutex);
+
+#ifndef _WIN32
+  if (catalog->mapped)
+    munmap(catalog->data, catalog->datalen);
+  else
+#endif /* !_WIN32 */
+  free(catalog->data);
+
+  free(catalog);
+
+  return (NULL);
+}
+
+
+/*
+ * 'cups_catalog_release()' - Release a compiled catalog.
+ */
+
+static void
+cups_catalog_release(
+    _cups_catalog_t *catalog)		/* I - Compiled catalog */
+{
+  _cupsMutexLock(&catalog_mutex);
+
+  if (-- catalog->ref_count > 0)
+  {
+    _cupsMutexUnlock(&catalog_mutex);
+    return;
+  }
+
+  cupsArrayRemove(catalog_cache, catalog);
+
+  _cupsMutexUnlock(&catalog_mutex);
+
+#ifndef _WIN32
+  if (catalog->mapped)
+    munmap(catalog->data, catalog->datalen);
+  else
+#endif /* !_WIN32 */
+  free(catalog->data);
+
+  free(catalog->filename);
+  free(catalog);
+}
+#endif /* !__APPLE__ || !CUPS_BUNDLEDIR */
+
+
+/*
+ * 'cups_catalog_save()' - Write a compiled catalog.
+ *
+ * Compiled catalogs start with the magic string followed by the byte order
+ * marker, number of messages, and number of hash buckets as 32-bit integers
+ * in native byte order.  Then come the hash buckets, four 32-bit integers for
+ * each message (hash, message offset, localized text offset, and next message
+ * in the bucket), and the nul-terminated strings.
+ */
+
+static int				/* O - 0 on success, -1 on failure */
+cups_catalog_save(cups_file_t  *fp,	/* I - File to write to */
+                  cups_array_t *a)	/* I - Message array */
+{
+  _cups_message_t	*m;		/* Current message */
+  const char		*str;		/* Localized text */
+  uint32_t		header[3],	/* Byte order, messages, and buckets */
+			num_entries,	/* Number of messages */
+			num_buckets,	/* Number of hash buckets */
+			*buckets,	/* Hash buckets */
+			*entries,	/* Message entries */
+			*entry,		/* Current message entry */
+			bucket,		/* Current hash bucket */
+			i;		/* Looping var */
+  size_t		offset,		/* Offset of next string */
+			msglen,		/* Length of message */
+			textlen;	/* Length of localized text */
+  int			status = 0;	/* Return status */
+
+
+  num_entries = (uint32_t)cupsArrayCount(a);
+
+  for (num_buckets = 16; num_buckets < num_entries; num_buckets *= 2);
+
+  buckets = calloc(num_buckets, sizeof(uint32_t));
+  entries = calloc(num_entries > 0 ? num_entries : 1, 4 * sizeof(uint32_t));
+
+  if (!buckets || !entries)
+  {
+    free(buckets);
+    free(entries);
+    return (-1);
+  }
+
+ /*
+  * Build the hash index...
+  */
+
+  offset = CUPS_CATALOG_HEADER + 4 * (size_t)num_buckets + 16 * (size_t)num_entries;
+
+  for (m = (_cups_message_t *)cupsArrayFirst(a), i = 0, entry = entries; m && i < num_entries; m = (_cups_message_t *)cupsArrayNext(a), i ++, entry += 4)
+  {
+    str     = m->str ? m->str : m->msg;
+    msglen  = strlen(m->msg) + 1;
+    textlen = strlen(str) + 1;
+
+    if ((offset + msglen + textlen) > UINT32_MAX)
+    {
+      status = -1;
+      break;
+    }
+
+    entry[0] = _cupsStrHash(m->msg);
+    bucket   = entry[0] & (num_buckets - 1);
+    entry[1] = (uint32_t)offset;
+    entry[2] = (uint32_t)(offset + msglen);
+    entry[3] = buckets[bucket];
+
+    buckets[bucket] = i + 1;
+    offset          += msglen + textlen;
+  }
+
+ /*
+  * Write the header, index, and strings...
+  */
+
+  header[0] = CUPS_CATALOG_ORDER;
+  header[1] = num_entries;
+  header[2] = num_buckets;
+
+  if (!status && (cupsFileWrite(fp, CUPS_CATALOG_MAGIC, 8) < 0 || cupsFileWrite(fp, (char *)header, sizeof(header)) < 0 || cupsFileWrite(fp, (char *)buckets, num_buckets * sizeof(uint32_t)) < 0 || (num_entries > 0 && cupsFileWrite(fp, (char *)entries, 4 * (size_t)num_entries * sizeof(uint32_t)) < 0)))
+    status = -1;
+
+  for (m = (_cups_message_t *)cupsArrayFirst(a); m && !status; m = (_cups_message_t *)cupsArrayNext(a))
+  {
+    str = m->str ? m->str : m->msg;
+
+    if (cupsFileWrite(fp, m->msg, strlen(m->msg) + 1) < 0 || cupsFileWrite(fp, str, strlen(str) + 1) < 0)
+      status = -1;
+  }
+
+  free(buckets);
+  free(entries);
+
+  return (status);
+}
+
+
 /*
  * 'cups_message_compare()' - Compare two messages.
  */
@@ -1683,7 +2135,13 @@ cups_message_load(cups_lang_t *lang)	/* I - Language */
   lang->strings = appleMessageLoad(lang->language);
 
 #else
-  char			filename[1024];	/* Filename for language locale file */
+  char			filename[1024],	/* Filename for language locale file */
+			catfile[1024],	/* Filename for compiled catalog */
+			tempfile[1024],	/* Temporary compiled catalog */
+			*ptr;		/* Pointer into filename */
+  struct stat		poinfo,		/* Locale file information */
+			catinfo;	/* Compiled catalog information */
+  _cups_catalog_t	*catalog;	/* Compiled catalog */
   _cups_globals_t	*cg = _cupsGlobals();
   					/* Pointer to library globals */
 
@@ -1714,10 +2172,35 @@ cups_message_load(cups_lang_t *lang)	/* I - Language */
   }
 
  /*
-  * Read the strings from the file...
+  * Use the compiled catalog next to the locale file if it is up-to-date...
+  */
+
+  strlcpy(catfile, filename, sizeof(catfile));
+  if ((ptr = strrchr(catfile, '.')) != NULL)
+    strlcpy(ptr, ".cat", sizeof(catfile) - (size_t)(ptr - catfile));
+
+  if (!stat(filename, &poinfo) && !stat(catfile, &catinfo) && catinfo.st_mtime >= poinfo.st_mtime && (catalog = cups_catalog_open(catfile)) != NULL)
+  {
+    if ((lang->strings = _cupsMessageNew(catalog)) != NULL)
+      return;
+
+    cups_catalog_release(catalog);
+  }
+
+ /*
+  * Otherwise read the strings from the file and try to cache a compiled
+  * catalog for next time...
   */
 
   lang->strings = _cupsMessageLoad(filename, _CUPS_MESSAGE_UNQUOTE);
+
+  if (cupsArrayCount(lang->strings) > 0)
+  {
+    snprintf(tempfile, sizeof(tempfile), "%s.%d", catfile, (int)getpid());
+
+    if (_cupsMessageSave(tempfile, _CUPS_MESSAGE_COMPILED, lang->strings) || rename(tempfile, catfile))
+      unlink(tempfile);
+  }
 #endif /* __APPLE__ && CUPS_BUNDLEDIR */
 }
 
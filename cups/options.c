@@ -19,9 +19,12 @@
  * Local functions...
  */
 
+static int	cups_add_parsed(const char *name, const char *value, int num_parsed, int *alloc_parsed, cups_option_t **parsed);
 static int	cups_compare_options(cups_option_t *a, cups_option_t *b);
+static int	cups_compare_parsed(cups_option_t **a, cups_option_t **b);
 static int	cups_find_option(const char *name, int num_options,
 	                         cups_option_t *option, int prev, int *rdiff);
+static int	cups_merge_options(int num_parsed, cups_option_t *parsed, int num_options, cups_option_t **options);
 
 
 /*
@@ -267,6 +270,9 @@ cupsParseOptions(
 	*value,				/* Pointer to value */
 	sep,				/* Separator character */
 	quote;				/* Quote character */
+  int	num_parsed = 0,			/* Number of parsed options */
+	alloc_parsed = 0;		/* Allocated parsed options */
+  cups_option_t	*parsed = NULL;		/* Parsed options */
 
 
   DEBUG_printf(("cupsParseOptions(arg=\"%s\", num_options=%d, options=%p)", arg, num_options, (void *)options));
@@ -362,10 +368,9 @@ cupsParseOptions(
       */
 
       if (!_cups_strncasecmp(name, "no", 2))
-        num_options = cupsAddOption(name + 2, "false", num_options,
-	                            options);
+        num_parsed = cups_add_parsed(name + 2, "false", num_parsed, &alloc_parsed, &parsed);
       else
-        num_options = cupsAddOption(name, "true", num_options, options);
+        num_parsed = cups_add_parsed(name, "true", num_parsed, &alloc_parsed, &parsed);
 
       continue;
     }
@@ -457,14 +462,17 @@ cupsParseOptions(
     * Add the string value...
     */
 
-    num_options = cupsAddOption(name, value, num_options, options);
+    num_parsed = cups_add_parsed(name, value, num_parsed, &alloc_parsed, &parsed);
   }
 
  /*
-  * Free the copy of the argument we made and return the number of options
-  * found.
+  * Merge the parsed options into the option array all at once, then free the
+  * copy of the argument we made and return the number of options found.
   */
 
+  num_options = cups_merge_options(num_parsed, parsed, num_options, options);
+
+  free(parsed);
   free(copyarg);
 
   DEBUG_printf(("1cupsParseOptions: Returning %d", num_options));
@@ -619,6 +627,42 @@ _cupsGet1284Values(
 }
 
 
+/*
+ * 'cups_add_parsed()' - Add a parsed option to the list of parsed options.
+ *
+ * The name and value strings are not copied.
+ */
+
+static int				/* O  - Number of parsed options */
+cups_add_parsed(
+    const char    *name,		/* I  - Name of option */
+    const char    *value,		/* I  - Value of option */
+    int           num_parsed,		/* I  - Number of parsed options */
+    int           *alloc_parsed,	/* IO - Allocated parsed options */
+    cups_option_t **parsed)		/* IO - Parsed options */
+{
+  cups_option_t	*temp;			/* New parsed options */
+
+
+  if (!*name)
+    return (num_parsed);
+
+  if (num_parsed >= *alloc_parsed)
+  {
+    if ((temp = realloc(*parsed, (size_t)(*alloc_parsed + 16) * sizeof(cups_option_t))) == NULL)
+      return (num_parsed);
+
+    *parsed       = temp;
+    *alloc_parsed += 16;
+  }
+
+  (*parsed)[num_parsed].name  = (char *)name;
+  (*parsed)[num_parsed].value = (char *)value;
+
+  return (num_parsed + 1);
+}
+
+
 /*
  * 'cups_compare_options()' - Compare two options.
  */
@@ -631,6 +675,24 @@ cups_compare_options(cups_option_t *a,	/* I - First option */
 }
 
 
+/*
+ * 'cups_compare_parsed()' - Compare two parsed options by name and position.
+ */
+
+static int				/* O - Result of comparison */
+cups_compare_parsed(cups_option_t **a,	/* I - First option */
+                    cups_option_t **b)	/* I - Second option */
+{
+  int	result;				/* Result of comparison */
+
+
+  if ((result = _cups_strcasecmp((*a)->name, (*b)->name)) == 0)
+    result = (*a > *b) - (*a < *b);
+
+  return (result);
+}
+
+
 /*
  * 'cups_find_option()' - Find an option using a binary search.
  */
@@ -739,3 +801,147 @@ cups_find_option(
 
   return (current);
 }
+
+
+/*
+ * 'cups_merge_options()' - Merge parsed options into an option array.
+ *
+ * The result is the same as calling @code cupsAddOption@ for each parsed
+ * option in order, but sorts once and merges in a single pass instead of
+ * shifting the array for every option.
+ */
+
+static int				/* O  - Number of options */
+cups_merge_options(
+    int           num_parsed,		/* I  - Number of parsed options */
+    cups_option_t *parsed,		/* I  - Parsed options */
+    int           num_options,		/* I  - Number of options */
+    cups_option_t **options)		/* IO - Options */
+{
+  int		i,			/* Looping var */
+		num_sorted,		/* Number of unique parsed options */
+		num_merged;		/* Number of merged options */
+  cups_option_t	**sorted,		/* Parsed options sorted by name */
+		*quality,		/* Last print quality option */
+		*other_last = NULL,	/* Last option for the other quality name */
+		*merged,		/* Merged options */
+		*option,		/* Current existing option */
+		*end;			/* End of existing options */
+  int		diff;			/* Result of comparison */
+  const char	*other = NULL;		/* Other print quality name */
+
+
+  if (num_parsed == 0)
+    return (num_options);
+
+  if ((sorted = malloc((size_t)num_parsed * sizeof(cups_option_t *))) == NULL)
+    return (num_options);
+
+ /*
+  * Adding either "print-quality" or "cupsPrintQuality" removes the other, so
+  * only the last one of them survives along with any earlier values for the
+  * same name that follow the last value for the other name...
+  */
+
+  for (i = 0, quality = NULL; i < num_parsed; i ++)
+    if (!_cups_strcasecmp(parsed[i].name, "cupsPrintQuality") || !_cups_strcasecmp(parsed[i].name, "print-quality"))
+      quality = parsed + i;
+
+  if (quality)
+  {
+    other = _cups_strcasecmp(quality->name, "cupsPrintQuality") ? "cupsPrintQuality" : "print-quality";
+
+    for (i = 0, other_last = NULL; i < num_parsed; i ++)
+      if (!_cups_strcasecmp(parsed[i].name, other))
+        other_last = parsed + i;
+
+    num_options = cupsRemoveOption(other, num_options, options);
+
+    if (other_last)
+      num_options = cupsRemoveOption(quality->name, num_options, options);
+  }
+
+  for (i = 0, num_sorted = 0; i < num_parsed; i ++)
+  {
+    if (quality && !_cups_strcasecmp(parsed[i].name, other))
+      continue;
+    else if (quality && other_last && parsed + i < other_last && !_cups_strcasecmp(parsed[i].name, quality->name))
+      continue;
+
+    sorted[num_sorted ++] = parsed + i;
+  }
+
+ /*
+  * Sort by name, keeping the original order of duplicates, and then keep the
+  * first name and last value for each name, just like repeated calls to
+  * cupsAddOption...
+  */
+
+  qsort(sorted, (size_t)num_sorted, sizeof(cups_option_t *), (int (*)(const void *, const void *))cups_compare_parsed);
+
+  for (i = 0, num_merged = 0; i < num_sorted; i ++)
+  {
+    if (num_merged > 0 && !_cups_strcasecmp(sorted[num_merged - 1]->name, sorted[i]->name))
+      sorted[num_merged - 1]->value = sorted[i]->value;
+    else
+      sorted[num_merged ++] = sorted[i];
+  }
+
+  num_sorted = num_merged;
+
+ /*
+  * Merge the two sorted lists...
+  */
+
+  if ((merged = malloc((size_t)(num_options + num_sorted) * sizeof(cups_option_t))) == NULL)
+  {
+    free(sorted);
+    return (num_options);
+  }
+
+  if (num_options > 0)
+  {
+    option = *options;
+    end    = option + num_options;
+  }
+  else
+    option = end = NULL;
+
+  for (i = 0, num_merged = 0; i < num_sorted || option < end; num_merged ++)
+  {
+    if (i >= num_sorted)
+      diff = 1;
+    else if (option >= end)
+      diff = -1;
+    else
+      diff = _cups_strcasecmp(sorted[i]->name, option->name);
+
+    if (diff > 0)
+    {
+      merged[num_merged] = *option++;
+    }
+    else if (diff < 0)
+    {
+      merged[num_merged].name  = _cupsStrAlloc(sorted[i]->name);
+      merged[num_merged].value = _cupsStrAlloc(sorted[i]->value);
+      i ++;
+    }
+    else
+    {
+      merged[num_merged].name  = option->name;
+      merged[num_merged].value = _cupsStrAlloc(sorted[i]->value);
+      _cupsStrFree(option->value);
+      option ++;
+      i ++;
+    }
+  }
+
+  if (num_options > 0)
+    free(*options);
+
+  *options = merged;
+
+  free(sorted);
+
+  return (num_merged);
+}
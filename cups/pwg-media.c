@@ -14,6 +14,7 @@
 #include "cups-private.h"
 #include "debug-internal.h"
 #include <math.h>
+#include <limits.h>
 
 
 /*
@@ -23,17 +24,35 @@
 #define _PWG_MEDIA_IN(p,l,a,x,y) {p, l, a, (int)(x * 2540), (int)(y * 2540)}
 #define _PWG_MEDIA_MM(p,l,a,x,y) {p, l, a, (int)(x * 100), (int)(y * 100)}
 #define _PWG_EPSILON	50		/* Matching tolerance */
+#define _PWG_HASH_SIZE	512		/* Size of name hash tables (power of 2) */
+#define _PWG_NUM_MEDIA	(sizeof(cups_pwg_media) / sizeof(cups_pwg_media[0]))
+					/* Number of standard sizes */
+
+
+/*
+ * Local types...
+ */
+
+typedef struct _pwg_hash_s		/* Name hash table entry */
+{
+  const char		*name;		/* Media name */
+  const pwg_media_t	*media;		/* Media size */
+} _pwg_hash_t;
 
 
 /*
  * Local functions...
  */
 
-static int	pwg_compare_legacy(pwg_media_t *a, pwg_media_t *b);
-static int	pwg_compare_pwg(pwg_media_t *a, pwg_media_t *b);
-static int	pwg_compare_ppd(pwg_media_t *a, pwg_media_t *b);
+static int	pwg_compare_size(const pwg_media_t **a, const pwg_media_t **b);
+static int	pwg_dimension_delta(ipp_attribute_t *attr, int value);
+static int	pwg_find_size(int first, int width, int length);
 static char	*pwg_format_inches(char *buf, size_t bufsize, int val);
 static char	*pwg_format_millimeters(char *buf, size_t bufsize, int val);
+static void	pwg_hash_add(_pwg_hash_t *table, const char *name, const pwg_media_t *media);
+static pwg_media_t *pwg_hash_find(const _pwg_hash_t *table, const char *name);
+static unsigned	pwg_hash_name(const char *name);
+static void	pwg_init_index(void);
 static int	pwg_scan_measurement(const char *buf, char **bufptr, int numer, int denom);
 
 
@@ -236,6 +255,19 @@ static pwg_media_t const cups_pwg_media[] =
   _PWG_MEDIA_MM("disc_standard_40x118mm", NULL, "Disc", 118, 118)
 };
 
+static const pwg_media_t *pwg_by_size[_PWG_NUM_MEDIA];
+					/* Media sizes sorted by width */
+static _pwg_hash_t	pwg_legacy_hash[_PWG_HASH_SIZE],
+					/* Legacy name hash table */
+			pwg_ppd_hash[_PWG_HASH_SIZE],
+					/* PPD name hash table */
+			pwg_pwg_hash[_PWG_HASH_SIZE];
+					/* PWG name hash table */
+static int		pwg_index_ready = 0;
+					/* Are the indices initialized? */
+static _cups_mutex_t	pwg_index_mutex = _CUPS_MUTEX_INITIALIZER;
+					/* Mutex for index initialization */
+
 
 /*
  * 'pwgFormatSizeName()' - Generate a PWG self-describing media size name.
@@ -565,10 +597,6 @@ pwgInitSize(pwg_size_t *size,		/* I - Size to initialize */
 pwg_media_t *				/* O - Matching size or NULL */
 pwgMediaForLegacy(const char *legacy)	/* I - Legacy size name */
 {
-  pwg_media_t	key;			/* Search key */
-  _cups_globals_t *cg = _cupsGlobals();	/* Global data */
-
-
  /*
   * Range check input...
   */
@@ -576,32 +604,14 @@ pwgMediaForLegacy(const char *legacy)	/* I - Legacy size name */
   if (!legacy)
     return (NULL);
 
- /*
-  * Build the lookup table for PWG names as needed...
-  */
-
-  if (!cg->leg_size_lut)
-  {
-    int			i;		/* Looping var */
-    pwg_media_t	*size;		/* Current size */
-
-    cg->leg_size_lut = cupsArrayNew((cups_array_func_t)pwg_compare_legacy,
-                                    NULL);
-
-    for (i = (int)(sizeof(cups_pwg_media) / sizeof(cups_pwg_media[0])),
-             size = (pwg_media_t *)cups_pwg_media;
-	 i > 0;
-	 i --, size ++)
-      if (size->legacy)
-	cupsArrayAdd(cg->leg_size_lut, size);
-  }
-
  /*
   * Lookup the name...
   */
 
-  key.legacy = legacy;
-  return ((pwg_media_t *)cupsArrayFind(cg->leg_size_lut, &key));
+  if (!pwg_index_ready)
+    pwg_init_index();
+
+  return (pwg_hash_find(pwg_legacy_hash, legacy));
 }
 
 
@@ -623,8 +633,7 @@ pwgMediaForLegacy(const char *legacy)	/* I - Legacy size name */
 pwg_media_t *				/* O - Matching size or NULL */
 pwgMediaForPPD(const char *ppd)		/* I - PPD size name */
 {
-  pwg_media_t	key,			/* Search key */
-		*size;			/* Matching size */
+  pwg_media_t	*size;			/* Matching size */
   _cups_globals_t *cg = _cupsGlobals();	/* Global data */
 
 
@@ -636,29 +645,17 @@ pwgMediaForPPD(const char *ppd)		/* I - PPD size name */
     return (NULL);
 
  /*
-  * Build the lookup table for PWG names as needed...
+  * Build the lookup tables as needed...
   */
 
-  if (!cg->ppd_size_lut)
-  {
-    int	i;				/* Looping var */
-
-    cg->ppd_size_lut = cupsArrayNew((cups_array_func_t)pwg_compare_ppd, NULL);
-
-    for (i = (int)(sizeof(cups_pwg_media) / sizeof(cups_pwg_media[0])),
-             size = (pwg_media_t *)cups_pwg_media;
-	 i > 0;
-	 i --, size ++)
-      if (size->ppd)
-        cupsArrayAdd(cg->ppd_size_lut, size);
-  }
+  if (!pwg_index_ready)
+    pwg_init_index();
 
  /*
   * Lookup the name...
   */
 
-  key.ppd = ppd;
-  if ((size = (pwg_media_t *)cupsArrayFind(cg->ppd_size_lut, &key)) == NULL)
+  if ((size = pwg_hash_find(pwg_ppd_hash, ppd)) == NULL)
   {
    /*
     * See if the name is of the form:
@@ -800,8 +797,7 @@ pwg_media_t *				/* O - Matching size or NULL */
 pwgMediaForPWG(const char *pwg)		/* I - PWG size name */
 {
   char		*ptr;			/* Pointer into name */
-  pwg_media_t	key,			/* Search key */
-		*size;			/* Matching size */
+  pwg_media_t	*size;			/* Matching size */
   _cups_globals_t *cg = _cupsGlobals();	/* Global data */
 
 
@@ -813,28 +809,17 @@ pwgMediaForPWG(const char *pwg)		/* I - PWG size name */
     return (NULL);
 
  /*
-  * Build the lookup table for PWG names as needed...
+  * Build the lookup tables as needed...
   */
 
-  if (!cg->pwg_size_lut)
-  {
-    int	i;				/* Looping var */
-
-    cg->pwg_size_lut = cupsArrayNew((cups_array_func_t)pwg_compare_pwg, NULL);
-
-    for (i = (int)(sizeof(cups_pwg_media) / sizeof(cups_pwg_media[0])),
-             size = (pwg_media_t *)cups_pwg_media;
-	 i > 0;
-	 i --, size ++)
-      cupsArrayAdd(cg->pwg_size_lut, size);
-  }
+  if (!pwg_index_ready)
+    pwg_init_index();
 
  /*
   * Lookup the name...
   */
 
-  key.pwg = pwg;
-  if ((size = (pwg_media_t *)cupsArrayFind(cg->pwg_size_lut, &key)) == NULL &&
+  if ((size = pwg_hash_find(pwg_pwg_hash, pwg)) == NULL &&
       (ptr = (char *)strchr(pwg, '_')) != NULL &&
       (ptr = (char *)strchr(ptr + 1, '_')) != NULL)
   {
@@ -921,6 +906,62 @@ pwgMediaForSize(int width,		/* I - Width in hundredths of millimeters */
 }
 
 
+/*
+ * '_pwgMediaColNearSize()' - Find the supported size within the given
+ *                            tolerance.
+ *
+ * The "sizes" argument is a printer's "media-col-database", "media-col-ready",
+ * "media-size-supported", or "media-size-ready" attribute.  Ranges of
+ * dimensions (custom sizes) match any size they contain.  Exact matches are
+ * preferred, otherwise the closest size within "epsilon" in both dimensions is
+ * chosen.
+ */
+
+int					/* O - Index of matching value or -1 */
+_pwgMediaColNearSize(
+    ipp_attribute_t *sizes,		/* I - Supported sizes */
+    int             width,		/* I - Width in hundredths of millimeters */
+    int             length,		/* I - Length in hundredths of millimeters */
+    int             epsilon)		/* I - Match within this tolerance. PWG units */
+{
+  int		i,			/* Looping var */
+		count,			/* Number of values */
+		best = -1,		/* Best match */
+		dw, dl,			/* Difference in width and length */
+		best_dw = INT_MAX,	/* Best difference in width and length */
+		best_dl = INT_MAX;
+  ipp_t		*col,			/* Current collection value */
+		*size;			/* media-size collection */
+  ipp_attribute_t *member;		/* media-size member */
+
+
+  for (i = 0, count = ippGetCount(sizes); i < count; i ++)
+  {
+    if ((col = ippGetCollection(sizes, i)) == NULL)
+      continue;
+
+    if ((member = ippFindAttribute(col, "media-size", IPP_TAG_BEGIN_COLLECTION)) != NULL)
+      size = ippGetCollection(member, 0);
+    else
+      size = col;
+
+    dw = pwg_dimension_delta(ippFindAttribute(size, "x-dimension", IPP_TAG_ZERO), width);
+    dl = pwg_dimension_delta(ippFindAttribute(size, "y-dimension", IPP_TAG_ZERO), length);
+
+    if (!dw && !dl)
+      return (i);
+    else if (dw <= epsilon && dl <= epsilon && dw <= best_dw && dl <= best_dl)
+    {
+      best    = i;
+      best_dw = dw;
+      best_dl = dl;
+    }
+  }
+
+  return (best);
+}
+
+
 /*
  * '_pwgMediaNearSize()' - Get the PWG media size within the given tolerance.
  */
@@ -930,9 +971,14 @@ _pwgMediaNearSize(int width,	        /* I - Width in hundredths of millimeters *
 		  int length,		/* I - Length in hundredths of millimeters */
 		  int epsilon)		/* I - Match within this tolernace. PWG units */
 {
-  int		i;			/* Looping var */
-  pwg_media_t	*media,			/* Current media */
-		*best_media = NULL;	/* Best match */
+  int		i,			/* Looping var */
+		left,			/* Current index */
+		cur_width,		/* Current width */
+		num_candidates = 0;	/* Number of candidate sizes */
+  const pwg_media_t *media,		/* Current media */
+		*candidates[_PWG_NUM_MEDIA];
+					/* Candidate sizes in table order */
+  pwg_media_t	*best_media = NULL;	/* Best match */
   int		dw, dl,			/* Difference in width and length */
 		best_dw = 999,		/* Best difference in width and length */
 		best_dl = 999;
@@ -948,28 +994,49 @@ _pwgMediaNearSize(int width,	        /* I - Width in hundredths of millimeters *
     return (NULL);
 
  /*
-  * Look for a standard size...
+  * Walk the widths within the tolerance, bisecting each run of equal widths
+  * for the lengths within the tolerance.  The candidates are kept in table
+  * order so that ties resolve the same way they always have...
   */
 
-  for (i = (int)(sizeof(cups_pwg_media) / sizeof(cups_pwg_media[0])),
-	   media = (pwg_media_t *)cups_pwg_media;
-       i > 0;
-       i --, media ++)
+  if (!pwg_index_ready)
+    pwg_init_index();
+
+  for (left = pwg_find_size(0, width - epsilon, INT_MIN); left < (int)_PWG_NUM_MEDIA && pwg_by_size[left]->width <= (width + epsilon);)
   {
+    cur_width = pwg_by_size[left]->width;
+
+    for (left = pwg_find_size(left, cur_width, length - epsilon); left < (int)_PWG_NUM_MEDIA && pwg_by_size[left]->width == cur_width && pwg_by_size[left]->length <= (length + epsilon); left ++)
+    {
+      media = pwg_by_size[left];
+
+      for (i = num_candidates; i > 0 && candidates[i - 1] > media; i --)
+	candidates[i] = candidates[i - 1];
+
+      candidates[i] = media;
+      num_candidates ++;
+    }
+
+    left = pwg_find_size(left, cur_width + 1, INT_MIN);
+  }
+
+ /*
+  * Look for a standard size...
+  */
 
-    dw = abs(media->width - width);
-    dl = abs(media->length - length);
+  for (i = 0; i < num_candidates; i ++)
+  {
+    media = candidates[i];
+    dw    = abs(media->width - width);
+    dl    = abs(media->length - length);
 
     if (!dw && !dl)
-      return (media);
-    else if (dw <= epsilon && dl <= epsilon)
+      return ((pwg_media_t *)media);
+    else if (dw <= best_dw && dl <= best_dl)
     {
-      if (dw <= best_dw && dl <= best_dl)
-      {
-        best_media = media;
-        best_dw    = dw;
-        best_dl    = dl;
-      }
+      best_media = (pwg_media_t *)media;
+      best_dw    = dw;
+      best_dl    = dl;
     }
   }
 
@@ -1013,38 +1080,93 @@ _pwgMediaTable(size_t *num_media)	/* O - Number of entries */
 
 
 /*
- * 'pwg_compare_legacy()' - Compare two sizes using the legacy names.
+ * 'pwg_compare_size()' - Compare two sizes by width, length, and table order.
  */
 
 static int				/* O - Result of comparison */
-pwg_compare_legacy(pwg_media_t *a,	/* I - First size */
-                   pwg_media_t *b)	/* I - Second size */
+pwg_compare_size(const pwg_media_t **a,	/* I - First size */
+                 const pwg_media_t **b)	/* I - Second size */
 {
-  return (strcmp(a->legacy, b->legacy));
+  if ((*a)->width != (*b)->width)
+    return ((*a)->width - (*b)->width);
+  else if ((*a)->length != (*b)->length)
+    return ((*a)->length - (*b)->length);
+  else if (*a < *b)
+    return (-1);
+  else
+    return (*a > *b);
 }
 
 
 /*
- * 'pwg_compare_ppd()' - Compare two sizes using the PPD names.
+ * 'pwg_dimension_delta()' - Get the distance from a value to a supported
+ *                           dimension.
  */
 
-static int				/* O - Result of comparison */
-pwg_compare_ppd(pwg_media_t *a,	/* I - First size */
-                pwg_media_t *b)	/* I - Second size */
+static int				/* O - Distance or INT_MAX if none */
+pwg_dimension_delta(
+    ipp_attribute_t *attr,		/* I - x-dimension or y-dimension */
+    int             value)		/* I - Value */
 {
-  return (strcmp(a->ppd, b->ppd));
+  int	i,				/* Looping var */
+	count,				/* Number of values */
+	lower, upper,			/* Range of values */
+	delta,				/* Current distance */
+	best = INT_MAX;			/* Best distance */
+
+
+  for (i = 0, count = ippGetCount(attr); i < count; i ++)
+  {
+    if (ippGetValueTag(attr) == IPP_TAG_RANGE)
+    {
+      lower = ippGetRange(attr, i, &upper);
+
+      if (value < lower)
+        delta = lower - value;
+      else if (value > upper)
+        delta = value - upper;
+      else
+        delta = 0;
+    }
+    else if (ippGetValueTag(attr) == IPP_TAG_INTEGER)
+      delta = abs(ippGetInteger(attr, i) - value);
+    else
+      continue;
+
+    if (delta < best)
+      best = delta;
+  }
+
+  return (best);
 }
 
 
 /*
- * 'pwg_compare_pwg()' - Compare two sizes using the PWG names.
+ * 'pwg_find_size()' - Find the first indexed size at or after the given
+ *                     width and length.
  */
 
-static int				/* O - Result of comparison */
-pwg_compare_pwg(pwg_media_t *a,	/* I - First size */
-                pwg_media_t *b)	/* I - Second size */
+static int				/* O - Index into pwg_by_size */
+pwg_find_size(int first,		/* I - First index to search */
+              int width,		/* I - Width in hundredths of millimeters */
+              int length)		/* I - Length in hundredths of millimeters */
 {
-  return (strcmp(a->pwg, b->pwg));
+  int	left,				/* Left side of binary search */
+	right,				/* Right side of binary search */
+	i;				/* Current index */
+
+
+  for (left = first, right = (int)_PWG_NUM_MEDIA; left < right;)
+  {
+    i = (left + right) / 2;
+
+    if (pwg_by_size[i]->width < width || (pwg_by_size[i]->width == width && pwg_by_size[i]->length < length))
+      left = i + 1;
+    else
+      right = i;
+  }
+
+  return (left);
 }
 
 
@@ -1125,6 +1247,99 @@ pwg_format_millimeters(char   *buf,	/* I - Buffer */
 }
 
 
+/*
+ * 'pwg_hash_add()' - Add a name to a hash table.
+ *
+ * The first size with a given name wins, matching the table order.
+ */
+
+static void
+pwg_hash_add(_pwg_hash_t       *table,	/* I - Hash table */
+             const char        *name,	/* I - Media name */
+             const pwg_media_t *media)	/* I - Media size */
+{
+  unsigned	i;			/* Current bucket */
+
+
+  for (i = pwg_hash_name(name); table[i].name; i = (i + 1) & (_PWG_HASH_SIZE - 1))
+    if (!strcmp(table[i].name, name))
+      return;
+
+  table[i].name  = name;
+  table[i].media = media;
+}
+
+
+/*
+ * 'pwg_hash_find()' - Find a name in a hash table.
+ */
+
+static pwg_media_t *			/* O - Matching size or NULL */
+pwg_hash_find(const _pwg_hash_t *table,	/* I - Hash table */
+              const char        *name)	/* I - Media name */
+{
+  unsigned	i;			/* Current bucket */
+
+
+  for (i = pwg_hash_name(name); table[i].name; i = (i + 1) & (_PWG_HASH_SIZE - 1))
+    if (!strcmp(table[i].name, name))
+      return ((pwg_media_t *)table[i].media);
+
+  return (NULL);
+}
+
+
+/*
+ * 'pwg_hash_name()' - Compute the hash bucket for a name (FNV-1a).
+ */
+
+static unsigned				/* O - Hash bucket */
+pwg_hash_name(const char *name)		/* I - Media name */
+{
+  return (_cupsStrHash(name) & (_PWG_HASH_SIZE - 1));
+}
+
+
+/*
+ * 'pwg_init_index()' - Initialize the name hash tables and size index.
+ *
+ * The tables are built once per process from the constant media table and
+ * never change afterwards, so lookups do not need a lock.
+ */
+
+static void
+pwg_init_index(void)
+{
+  size_t		i;		/* Looping var */
+  const pwg_media_t	*media;		/* Current media */
+
+
+  _cupsMutexLock(&pwg_index_mutex);
+
+  if (!pwg_index_ready)
+  {
+    for (i = 0, media = cups_pwg_media; i < _PWG_NUM_MEDIA; i ++, media ++)
+    {
+      pwg_hash_add(pwg_pwg_hash, media->pwg, media);
+
+      if (media->legacy)
+        pwg_hash_add(pwg_legacy_hash, media->legacy, media);
+
+      if (media->ppd)
+        pwg_hash_add(pwg_ppd_hash, media->ppd, media);
+
+      pwg_by_size[i] = media;
+    }
+
+    qsort(pwg_by_size, _PWG_NUM_MEDIA, sizeof(pwg_by_size[0]), (int (*)(const void *, const void *))pwg_compare_size);
+
+    pwg_index_ready = 1;
+  }
+
+  _cupsMutexUnlock(&pwg_index_mutex);
+}
+
+
 /*
  * 'pwg_scan_measurement()' - Scan a measurement in inches or millimeters.
  *
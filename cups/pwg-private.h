@@ -38,6 +38,9 @@ extern void		_pwgGenerateSize(char *keyword, size_t keysize,
 extern int		_pwgInitSize(pwg_size_t *size, ipp_t *job,
 				     int *margins_set)
 				     _CUPS_INTERNAL_MSG("Use pwgInitSize instead.");
+extern int		_pwgMediaColNearSize(ipp_attribute_t *sizes,
+					     int width, int length,
+					     int epsilon) _CUPS_PRIVATE;
 extern const pwg_media_t *_pwgMediaTable(size_t *num_media) _CUPS_PRIVATE;
 extern pwg_media_t *_pwgMediaNearSize(int width, int length, int epsilon) _CUPS_PRIVATE;
 
@@ -19,6 +19,7 @@
 #  include <cups/cups.h>
 #  include <cups/debug-private.h>
 #  include <cups/string-private.h>
+#  include <cups/thread-private.h>
 #  ifdef _WIN32
 #    include <io.h>
 #    include <winsock2.h>		/* for htonl() definition */
@@ -32,10 +33,23 @@ extern "C" {
 #  endif /* __cplusplus */
 
 
+/*
+ * Constants...
+ */
+
+#  define _CUPS_RASTER_MAX_THREADS 16	/* Maximum number of compression threads */
+
+
 /*
  * Structure...
  */
 
+typedef struct _cups_raster_run_s	/**** Run of identical lines ****/
+{
+  const unsigned char	*pixels;	/* Line data */
+  unsigned		count;		/* Line repeat count */
+} _cups_raster_run_t;
+
 struct _cups_raster_s			/**** Raster stream data ****/
 {
   unsigned		sync;		/* Sync word from start of stream */
@@ -61,6 +75,15 @@ struct _cups_raster_s			/**** Raster stream data ****/
 			iocount;	/* Number of bytes read/written */
 #  endif /* DEBUG */
   unsigned		apple_page_count;/* Apple raster page count */
+  unsigned char		*band;		/* Decoded band for _cupsRasterReadLines */
+  size_t		bandsize;	/* Size of band buffer */
+  int			threads;	/* Number of compression threads */
+  _cups_raster_run_t	*runs;		/* Runs for _cupsRasterWriteLines */
+  unsigned		runsize;	/* Number of allocated runs */
+  unsigned char		*tbuffers[_CUPS_RASTER_MAX_THREADS];
+					/* Per-thread compression buffers */
+  size_t		tbufsizes[_CUPS_RASTER_MAX_THREADS];
+					/* Sizes of per-thread buffers */
 };
 
 
@@ -83,15 +106,23 @@ struct _cups_raster_s			/**** Raster stream data ****/
  */
 
 extern void		_cupsRasterAddError(const char *f, ...) _CUPS_FORMAT(1,2) _CUPS_PRIVATE;
+extern void		_cupsRasterBandedToChunky(unsigned char *dst, const unsigned char *src, unsigned width, unsigned colors, unsigned bpc) _CUPS_PRIVATE;
+extern void		_cupsRasterChunkyToBanded(unsigned char *dst, const unsigned char *src, unsigned width, unsigned colors, unsigned bpc) _CUPS_PRIVATE;
 extern void		_cupsRasterClearError(void) _CUPS_PRIVATE;
 extern const char	*_cupsRasterColorSpaceString(cups_cspace_t cspace) _CUPS_PRIVATE;
+extern void		_cupsRasterConvert16To8(unsigned char *dst, const unsigned char *src, size_t count) _CUPS_PRIVATE;
+extern void		_cupsRasterConvert8To16(unsigned char *dst, const unsigned char *src, size_t count) _CUPS_PRIVATE;
 extern void		_cupsRasterDelete(cups_raster_t *r) _CUPS_PRIVATE;
 extern const char	*_cupsRasterErrorString(void) _CUPS_PRIVATE;
 extern int		_cupsRasterInitPWGHeader(cups_page_header2_t *h, pwg_media_t *media, const char *type, int xdpi, int ydpi, const char *sides, const char *sheet_back) _CUPS_PRIVATE;
 extern cups_raster_t	*_cupsRasterNew(cups_raster_iocb_t iocb, void *ctx, cups_mode_t mode) _CUPS_PRIVATE;
 extern unsigned		_cupsRasterReadHeader(cups_raster_t *r) _CUPS_PRIVATE;
+extern const unsigned char *_cupsRasterReadLines(cups_raster_t *r, unsigned maxlines, unsigned *numlines) _CUPS_PRIVATE;
 extern unsigned		_cupsRasterReadPixels(cups_raster_t *r, unsigned char *p, unsigned len) _CUPS_PRIVATE;
+extern int		_cupsRasterSetThreads(cups_raster_t *r, int threads) _CUPS_PRIVATE;
+extern void		_cupsRasterSwap16(unsigned char *dst, const unsigned char *src, size_t bytes) _CUPS_PRIVATE;
 extern unsigned		_cupsRasterWriteHeader(cups_raster_t *r) _CUPS_PRIVATE;
+extern unsigned		_cupsRasterWriteLines(cups_raster_t *r, const unsigned char *lines, unsigned numlines) _CUPS_PRIVATE;
 extern unsigned		_cupsRasterWritePixels(cups_raster_t *r, unsigned char *p, unsigned len) _CUPS_PRIVATE;
 
 #  ifdef __cplusplus
@@ -21,12 +21,28 @@
 #endif /* HAVE_STDINT_H */
 
 
+/*
+ * Constants...
+ */
+
+#define _CUPS_RASTER_BAND_SIZE	262144	/* Target size of decoded bands */
+
+
 /*
  * Private structures...
  */
 
 typedef void (*_cups_copyfunc_t)(void *dst, const void *src, size_t bytes);
 
+typedef struct _cups_raster_task_s	/**** Compression task ****/
+{
+  cups_raster_t		*r;		/* Raster stream */
+  const _cups_raster_run_t *runs;	/* Runs to encode */
+  unsigned		numruns;	/* Number of runs */
+  unsigned char		*buffer;	/* Output buffer */
+  size_t		length;		/* Length of encoded data */
+} _cups_raster_task_t;
+
 
 /*
  * Local globals...
@@ -67,13 +83,106 @@ static const char * const cups_modes[] =
  */
 
 static ssize_t	cups_raster_io(cups_raster_t *r, unsigned char *buf, size_t bytes);
+static unsigned char *cups_raster_pack(cups_raster_t *r, const unsigned char *pixels, unsigned count, unsigned char *wptr);
+static void	*cups_raster_pack_runs(_cups_raster_task_t *task);
 static ssize_t	cups_raster_read(cups_raster_t *r, unsigned char *buf, size_t bytes);
+static unsigned	cups_raster_scan(const unsigned char *ptr, const unsigned char *plast, unsigned bpp, unsigned max, int same);
+static int	cups_raster_unpack(cups_raster_t *r, unsigned char *ptr);
 static int	cups_raster_update(cups_raster_t *r);
 static ssize_t	cups_raster_write(cups_raster_t *r, const unsigned char *pixels);
+static int	cups_raster_write_runs(cups_raster_t *r, const _cups_raster_run_t *runs, unsigned numruns);
 static void	cups_swap(unsigned char *buf, size_t bytes);
 static void	cups_swap_copy(unsigned char *dst, const unsigned char *src, size_t bytes);
 
 
+/*
+ * '_cupsRasterBandedToChunky()' - Interleave a banded line into chunky pixels.
+ *
+ * The source contains "colors" bands of "width" samples, each sample being
+ * "bpc" bytes (1 or 2).  The destination receives "width" pixels of
+ * "colors" samples each.
+ */
+
+void
+_cupsRasterBandedToChunky(
+    unsigned char       *dst,		/* I - Chunky pixels */
+    const unsigned char *src,		/* I - Banded samples */
+    unsigned            width,		/* I - Width in pixels */
+    unsigned            colors,		/* I - Number of colors */
+    unsigned            bpc)		/* I - Bytes per color (1 or 2) */
+{
+  unsigned		x,		/* Current pixel */
+			c;		/* Current color */
+  size_t		bandsize;	/* Size of a band */
+  unsigned char		*dptr;		/* Pointer into pixels */
+  const unsigned char	*sptr;		/* Pointer into band */
+
+
+  bandsize = (size_t)width * bpc;
+
+  for (c = 0; c < colors; c ++, src += bandsize)
+  {
+    if (bpc == 1)
+    {
+      for (x = width, sptr = src, dptr = dst + c; x > 0; x --, dptr += colors)
+        *dptr = *sptr++;
+    }
+    else
+    {
+      for (x = width, sptr = src, dptr = dst + 2 * c; x > 0; x --, sptr += 2, dptr += 2 * colors)
+      {
+        dptr[0] = sptr[0];
+        dptr[1] = sptr[1];
+      }
+    }
+  }
+}
+
+
+/*
+ * '_cupsRasterChunkyToBanded()' - Separate chunky pixels into banded samples.
+ *
+ * The source contains "width" pixels of "colors" samples, each sample being
+ * "bpc" bytes (1 or 2).  The destination receives "colors" bands of "width"
+ * samples each.
+ */
+
+void
+_cupsRasterChunkyToBanded(
+    unsigned char       *dst,		/* I - Banded samples */
+    const unsigned char *src,		/* I - Chunky pixels */
+    unsigned            width,		/* I - Width in pixels */
+    unsigned            colors,		/* I - Number of colors */
+    unsigned            bpc)		/* I - Bytes per color (1 or 2) */
+{
+  unsigned		x,		/* Current pixel */
+			c;		/* Current color */
+  size_t		bandsize;	/* Size of a band */
+  unsigned char		*dptr;		/* Pointer into band */
+  const unsigned char	*sptr;		/* Pointer into pixels */
+
+
+  bandsize = (size_t)width * bpc;
+
+  for (c = 0; c < colors; c ++, dst += bandsize)
+  {
+    if (bpc == 1)
+    {
+      for (x = width, sptr = src + c, dptr = dst; x > 0; x --, sptr += colors)
+        *dptr++ = *sptr;
+    }
+    else
+    {
+      for (x = width, sptr = src + 2 * c, dptr = dst; x > 0; x --, sptr += 2 * colors, dptr += 2)
+      {
+        dptr[0] = sptr[0];
+        dptr[1] = sptr[1];
+      }
+    }
+  }
+}
+
+
 /*
  * '_cupsRasterColorSpaceString()' - Return the colorspace name for a
  *                                   cupsColorSpace value.
@@ -157,6 +266,42 @@ _cupsRasterColorSpaceString(
 }
 
 
+/*
+ * '_cupsRasterConvert16To8()' - Convert 16-bit samples to 8-bit samples.
+ *
+ * The 16-bit samples are in raster (big-endian) byte order.  Values are
+ * rounded to the nearest 8-bit value.
+ */
+
+void
+_cupsRasterConvert16To8(
+    unsigned char       *dst,		/* I - 8-bit samples */
+    const unsigned char *src,		/* I - 16-bit samples */
+    size_t              count)		/* I - Number of samples */
+{
+  for (; count > 0; count --, src += 2)
+    *dst++ = (unsigned char)((((unsigned)src[0] << 8 | src[1]) * 255U + 32895U) >> 16);
+}
+
+
+/*
+ * '_cupsRasterConvert8To16()' - Convert 8-bit samples to 16-bit samples.
+ *
+ * The 16-bit samples are written in raster (big-endian) byte order, with
+ * 0xFF mapping to 0xFFFF.  The source and destination may not overlap.
+ */
+
+void
+_cupsRasterConvert8To16(
+    unsigned char       *dst,		/* I - 16-bit samples */
+    const unsigned char *src,		/* I - 8-bit samples */
+    size_t              count)		/* I - Number of samples */
+{
+  for (; count > 0; count --, dst += 2)
+    dst[0] = dst[1] = *src++;
+}
+
+
 /*
  * '_cupsRasterDelete()' - Free a raster stream.
  *
@@ -167,6 +312,9 @@ _cupsRasterColorSpaceString(
 void
 _cupsRasterDelete(cups_raster_t *r)	/* I - Stream to free */
 {
+  int	i;				/* Looping var */
+
+
   if (r != NULL)
   {
     if (r->buffer)
@@ -175,6 +323,16 @@ _cupsRasterDelete(cups_raster_t *r)	/* I - Stream to free */
     if (r->pixels)
       free(r->pixels);
 
+    if (r->band)
+      free(r->band);
+
+    if (r->runs)
+      free(r->runs);
+
+    for (i = 0; i < _CUPS_RASTER_MAX_THREADS; i ++)
+      if (r->tbuffers[i])
+        free(r->tbuffers[i]);
+
     free(r);
   }
 }
@@ -737,6 +895,135 @@ _cupsRasterReadHeader(
 }
 
 
+/*
+ * '_cupsRasterReadLines()' - Read a band of whole lines.
+ *
+ * Lines are decoded directly into a band buffer of up to
+ * _CUPS_RASTER_BAND_SIZE bytes (at least one line) owned by the stream, so
+ * callers can process them in place.  Repeated lines are expanded in the
+ * band.  Partial lines from _cupsRasterReadPixels() must be finished before
+ * calling this function.
+ */
+
+const unsigned char *			/* O - First line or `NULL` */
+_cupsRasterReadLines(
+    cups_raster_t *r,			/* I - Raster stream */
+    unsigned      maxlines,		/* I - Maximum number of lines or 0 */
+    unsigned      *numlines)		/* O - Number of lines returned */
+{
+  unsigned	lines,			/* Lines in band */
+		line;			/* Current line */
+  size_t	cupsBytesPerLine,	/* cupsBytesPerLine value */
+		bandsize;		/* Bytes in band */
+  unsigned char	*ptr,			/* Pointer into band */
+		byte;			/* Byte from file */
+
+
+  DEBUG_printf(("_cupsRasterReadLines(r=%p, maxlines=%u, numlines=%p)", (void *)r, maxlines, (void *)numlines));
+
+  if (numlines)
+    *numlines = 0;
+
+  if (r == NULL || numlines == NULL || r->mode != CUPS_RASTER_READ || r->remaining == 0 || r->header.cupsBytesPerLine == 0)
+  {
+    DEBUG_puts("1_cupsRasterReadLines: Returning NULL.");
+    return (NULL);
+  }
+
+  if (r->compressed && r->count > 0 && r->pcurrent != r->pixels)
+  {
+    DEBUG_puts("1_cupsRasterReadLines: Partial line pending, returning NULL.");
+    return (NULL);
+  }
+
+ /*
+  * Figure out how many lines to decode and make sure the band is big
+  * enough...
+  */
+
+  cupsBytesPerLine = r->header.cupsBytesPerLine;
+
+  if ((lines = (unsigned)(_CUPS_RASTER_BAND_SIZE / cupsBytesPerLine)) == 0)
+    lines = 1;
+  if (maxlines > 0 && lines > maxlines)
+    lines = maxlines;
+  if (lines > r->remaining)
+    lines = r->remaining;
+
+  bandsize = lines * cupsBytesPerLine;
+
+  if (bandsize > r->bandsize)
+  {
+    if ((ptr = realloc(r->band, bandsize)) == NULL)
+    {
+      _cupsRasterAddError("Unable to allocate %u bytes for raster band: %s\n", (unsigned)bandsize, strerror(errno));
+      return (NULL);
+    }
+
+    r->band     = ptr;
+    r->bandsize = bandsize;
+  }
+
+  if (!r->compressed)
+  {
+   /*
+    * Read without compression...
+    */
+
+    if (cups_raster_io(r, r->band, bandsize) < (ssize_t)bandsize)
+    {
+      DEBUG_puts("1_cupsRasterReadLines: Read error, returning NULL.");
+      return (NULL);
+    }
+
+    if (r->swapped && (r->header.cupsBitsPerColor == 16 || r->header.cupsBitsPerPixel == 12 || r->header.cupsBitsPerPixel == 16))
+      cups_swap(r->band, bandsize);
+
+    r->remaining -= lines;
+  }
+  else
+  {
+   /*
+    * Decode compressed lines, copying repeated lines from the pixel buffer...
+    */
+
+    for (line = 0, ptr = r->band; line < lines; line ++, ptr += cupsBytesPerLine)
+    {
+      if (r->count == 0)
+      {
+        if (!cups_raster_read(r, &byte, 1))
+        {
+	  DEBUG_puts("1_cupsRasterReadLines: Read error, returning NULL.");
+	  return (NULL);
+        }
+
+        r->count = (unsigned)byte + 1;
+
+        if (!cups_raster_unpack(r, ptr))
+          return (NULL);
+
+        if (r->count > 1)
+        {
+          memcpy(r->pixels, ptr, cupsBytesPerLine);
+          r->pcurrent = r->pixels;
+        }
+      }
+      else
+        memcpy(ptr, r->pixels, cupsBytesPerLine);
+
+      r->count --;
+      r->remaining --;
+    }
+  }
+
+  *numlines = lines;
+
+  DEBUG_printf(("1_cupsRasterReadLines: Returning %u lines.", lines));
+
+  return (r->band);
+}
+
+
 /*
  * '_cupsRasterReadPixels()' - Read raster pixels.
  *
@@ -755,9 +1042,7 @@ _cupsRasterReadPixels(
   unsigned	cupsBytesPerLine;	/* cupsBytesPerLine value */
   unsigned	remaining;		/* Bytes remaining */
   unsigned char	*ptr,			/* Pointer to read buffer */
-		byte,			/* Byte from file */
-		*temp;			/* Pointer into buffer */
-  unsigned	count;			/* Repetition count */
+		byte;			/* Byte from file */
 
 
   DEBUG_printf(("_cupsRasterReadPixels(r=%p, p=%p, len=%u)", (void *)r, (void *)p, len));
@@ -839,110 +1124,8 @@ _cupsRasterReadPixels(
       if (r->count > 1)
 	ptr = r->pixels;
 
-      temp  = ptr;
-      bytes = (ssize_t)cupsBytesPerLine;
-
-      while (bytes > 0)
-      {
-       /*
-	* Get a new repeat count...
-	*/
-
-        if (!cups_raster_read(r, &byte, 1))
-	{
-	  DEBUG_puts("1_cupsRasterReadPixels: Read error, returning 0.");
-	  return (0);
-	}
-
-        if (byte == 128)
-        {
-         /*
-          * Clear to end of line...
-          */
-
-          switch (r->header.cupsColorSpace)
-          {
-            case CUPS_CSPACE_W :
-            case CUPS_CSPACE_RGB :
-            case CUPS_CSPACE_SW :
-            case CUPS_CSPACE_SRGB :
-            case CUPS_CSPACE_RGBW :
-            case CUPS_CSPACE_ADOBERGB :
-                memset(temp, 0xff, (size_t)bytes);
-                break;
-            default :
-                memset(temp, 0x00, (size_t)bytes);
-                break;
-          }
-
-          temp += bytes;
-          bytes = 0;
-        }
-	else if (byte & 128)
-	{
-	 /*
-	  * Copy N literal pixels...
-	  */
-
-	  count = (unsigned)(257 - byte) * r->bpp;
-
-          if (count > (unsigned)bytes)
-	    count = (unsigned)bytes;
-
-          if (!cups_raster_read(r, temp, count))
-	  {
-	    DEBUG_puts("1_cupsRasterReadPixels: Read error, returning 0.");
-	    return (0);
-	  }
-
-	  temp  += count;
-	  bytes -= (ssize_t)count;
-	}
-	else
-	{
-	 /*
-	  * Repeat the next N bytes...
-	  */
-
-          count = ((unsigned)byte + 1) * r->bpp;
-          if (count > (unsigned)bytes)
-	    count = (unsigned)bytes;
-
-          if (count < r->bpp)
-	    break;
-
-	  bytes -= (ssize_t)count;
-
-          if (!cups_raster_read(r, temp, r->bpp))
-	  {
-	    DEBUG_puts("1_cupsRasterReadPixels: Read error, returning 0.");
-	    return (0);
-	  }
-
-	  temp  += r->bpp;
-	  count -= r->bpp;
-
-	  while (count > 0)
-	  {
-	    memcpy(temp, temp - r->bpp, r->bpp);
-	    temp  += r->bpp;
-	    count -= r->bpp;
-          }
-	}
-      }
-
-     /*
-      * Swap bytes as needed...
-      */
-
-      if ((r->header.cupsBitsPerColor == 16 ||
-           r->header.cupsBitsPerPixel == 12 ||
-           r->header.cupsBitsPerPixel == 16) &&
-          r->swapped)
-      {
-        DEBUG_puts("1_cupsRasterReadPixels: Swapping bytes.");
-        cups_swap(ptr, (size_t)cupsBytesPerLine);
-      }
+      if (!cups_raster_unpack(r, ptr))
+	return (0);
 
      /*
       * Update pointers...
@@ -998,6 +1181,68 @@ _cupsRasterReadPixels(
 }
 
 
+/*
+ * '_cupsRasterSetThreads()' - Set the number of compression threads.
+ *
+ * Values less than 1 are treated as 1 and values greater than
+ * _CUPS_RASTER_MAX_THREADS are limited to that value.
+ */
+
+int					/* O - 1 on success, 0 on failure */
+_cupsRasterSetThreads(
+    cups_raster_t *r,			/* I - Raster stream */
+    int           threads)		/* I - Number of threads */
+{
+  if (!r || r->mode == CUPS_RASTER_READ)
+    return (0);
+
+  if (threads < 1)
+    threads = 1;
+  else if (threads > _CUPS_RASTER_MAX_THREADS)
+    threads = _CUPS_RASTER_MAX_THREADS;
+
+  r->threads = threads;
+
+  return (1);
+}
+
+
+/*
+ * '_cupsRasterSwap16()' - Copy 16-bit samples and swap their bytes.
+ *
+ * The source and destination may be the same buffer.  Eight bytes are swapped
+ * at a time, which compilers turn into vector instructions where available.
+ */
+
+void
+_cupsRasterSwap16(
+    unsigned char       *dst,		/* I - Destination */
+    const unsigned char *src,		/* I - Source */
+    size_t              bytes)		/* I - Number of bytes to swap */
+{
+  unsigned char	temp;			/* Temporary byte */
+
+
+#ifdef HAVE_STDINT_H
+  for (; bytes >= 8; bytes -= 8, src += 8, dst += 8)
+  {
+    uint64_t	w;			/* Four samples */
+
+    memcpy(&w, src, sizeof(w));
+    w = ((w & 0x00ff00ff00ff00ffULL) << 8) | ((w >> 8) & 0x00ff00ff00ff00ffULL);
+    memcpy(dst, &w, sizeof(w));
+  }
+#endif /* HAVE_STDINT_H */
+
+  for (; bytes >= 2; bytes -= 2, src += 2, dst += 2)
+  {
+    temp   = src[0];
+    dst[0] = src[1];
+    dst[1] = temp;
+  }
+}
+
+
 /*
  * '_cupsRasterWriteHeader()' - Write a raster page header.
  */
@@ -1172,38 +1417,166 @@ _cupsRasterWriteHeader(
 
 
 /*
- * '_cupsRasterWritePixels()' - Write raster pixels.
+ * '_cupsRasterWriteLines()' - Write a band of whole lines.
  *
- * For best performance, filters should write one or more whole lines.
- * The "cupsBytesPerLine" value from the page header can be used to allocate
- * the line buffer and as the number of bytes to write.
+ * Repeated lines are detected across the whole band and then the runs of
+ * lines are encoded, using multiple threads if enabled with
+ * _cupsRasterSetThreads().  Partial lines from _cupsRasterWritePixels() must
+ * be finished before calling this function.
  */
 
-unsigned				/* O - Number of bytes written */
-_cupsRasterWritePixels(
-    cups_raster_t *r,			/* I - Raster stream */
-    unsigned char *p,			/* I - Bytes to write */
-    unsigned      len)			/* I - Number of bytes to write */
+unsigned				/* O - Number of lines written */
+_cupsRasterWriteLines(
+    cups_raster_t       *r,		/* I - Raster stream */
+    const unsigned char *lines,		/* I - First line */
+    unsigned            numlines)	/* I - Number of lines */
 {
-  ssize_t	bytes;			/* Bytes read */
-  unsigned	remaining;		/* Bytes remaining */
+  unsigned		line,		/* Current line */
+			numruns;	/* Number of runs */
+  size_t		cupsBytesPerLine;
+					/* cupsBytesPerLine value */
+  const unsigned char	*ptr,		/* Current line */
+			*prev;		/* Line being repeated */
 
 
-  DEBUG_printf(("_cupsRasterWritePixels(r=%p, p=%p, len=%u), remaining=%u", (void *)r, (void *)p, len, r->remaining));
+  DEBUG_printf(("_cupsRasterWriteLines(r=%p, lines=%p, numlines=%u)", (void *)r, (void *)lines, numlines));
 
-  if (r == NULL || r->mode == CUPS_RASTER_READ || r->remaining == 0)
+  if (r == NULL || r->mode == CUPS_RASTER_READ || r->remaining == 0 || !lines || numlines == 0 || r->header.cupsBytesPerLine == 0)
     return (0);
 
+  if (numlines > r->remaining)
+    numlines = r->remaining;
+
+  cupsBytesPerLine = r->header.cupsBytesPerLine;
+
   if (!r->compressed)
   {
    /*
-    * Without compression, just write the raster data raw unless the data needs
+    * Without compression, write the whole band at once unless the data needs
     * to be swapped...
     */
 
-    r->remaining -= len / r->header.cupsBytesPerLine;
+    if (r->swapped && (r->header.cupsBitsPerColor == 16 || r->header.cupsBitsPerPixel == 12 || r->header.cupsBitsPerPixel == 16))
+    {
+      for (line = 0; line < numlines; line ++, lines += cupsBytesPerLine)
+      {
+        if (!_cupsRasterWritePixels(r, (unsigned char *)lines, (unsigned)cupsBytesPerLine))
+          return (line);
+      }
 
-    if (r->swapped &&
+      return (numlines);
+    }
+
+    r->remaining -= numlines;
+
+    if (cups_raster_io(r, (unsigned char *)lines, numlines * cupsBytesPerLine) < (ssize_t)(numlines * cupsBytesPerLine))
+      return (0);
+
+    return (numlines);
+  }
+
+  if (r->pcurrent != r->pixels)
+  {
+    DEBUG_puts("1_cupsRasterWriteLines: Partial line pending, returning 0.");
+    return (0);
+  }
+
+ /*
+  * Find each run of identical lines...
+  */
+
+  if (numlines + 1 > r->runsize)
+  {
+    _cups_raster_run_t	*runs;		/* New runs */
+
+    if ((runs = realloc(r->runs, (numlines + 1) * sizeof(_cups_raster_run_t))) == NULL)
+      return (0);
+
+    r->runs    = runs;
+    r->runsize = numlines + 1;
+  }
+
+  prev    = r->count > 0 ? r->pixels : NULL;
+  numruns = 0;
+
+  for (line = 0, ptr = lines; line < numlines; line ++, ptr += cupsBytesPerLine)
+  {
+    if (prev && !memcmp(ptr, prev, cupsBytesPerLine))
+    {
+      r->count += r->rowheight;
+    }
+    else
+    {
+      if (prev)
+      {
+        r->runs[numruns].pixels  = prev;
+        r->runs[numruns ++].count = r->count;
+      }
+
+      prev     = ptr;
+      r->count = r->rowheight;
+    }
+
+    r->remaining --;
+
+    if (r->remaining == 0 || r->count > (256 - r->rowheight))
+    {
+      r->runs[numruns].pixels  = prev;
+      r->runs[numruns ++].count = r->count;
+
+      prev     = NULL;
+      r->count = 0;
+    }
+  }
+
+ /*
+  * Encode and write the runs, then save any line that is still being
+  * repeated for the next call...
+  */
+
+  if (!cups_raster_write_runs(r, r->runs, numruns))
+    return (0);
+
+  if (prev && prev != r->pixels)
+    memcpy(r->pixels, prev, cupsBytesPerLine);
+
+  return (numlines);
+}
+
+
+/*
+ * '_cupsRasterWritePixels()' - Write raster pixels.
+ *
+ * For best performance, filters should write one or more whole lines.
+ * The "cupsBytesPerLine" value from the page header can be used to allocate
+ * the line buffer and as the number of bytes to write.
+ */
+
+unsigned				/* O - Number of bytes written */
+_cupsRasterWritePixels(
+    cups_raster_t *r,			/* I - Raster stream */
+    unsigned char *p,			/* I - Bytes to write */
+    unsigned      len)			/* I - Number of bytes to write */
+{
+  ssize_t	bytes;			/* Bytes read */
+  unsigned	remaining;		/* Bytes remaining */
+
+
+  DEBUG_printf(("_cupsRasterWritePixels(r=%p, p=%p, len=%u), remaining=%u", (void *)r, (void *)p, len, r->remaining));
+
+  if (r == NULL || r->mode == CUPS_RASTER_READ || r->remaining == 0)
+    return (0);
+
+  if (!r->compressed)
+  {
+   /*
+    * Without compression, just write the raster data raw unless the data needs
+    * to be swapped...
+    */
+
+    r->remaining -= len / r->header.cupsBytesPerLine;
+
+    if (r->swapped &&
         (r->header.cupsBitsPerColor == 16 ||
          r->header.cupsBitsPerPixel == 12 ||
          r->header.cupsBitsPerPixel == 16))
@@ -1396,6 +1769,28 @@ cups_raster_io(cups_raster_t *r,	/* I - Raster stream */
 }
 
 
+/*
+ * 'cups_raster_pack_runs()' - Encode a list of line runs into a buffer.
+ */
+
+static void *				/* O - Thread exit status (unused) */
+cups_raster_pack_runs(
+    _cups_raster_task_t *task)		/* I - Compression task */
+{
+  unsigned		i;		/* Looping var */
+  const _cups_raster_run_t *run;	/* Current run */
+  unsigned char		*wptr;		/* Pointer into buffer */
+
+
+  for (i = task->numruns, run = task->runs, wptr = task->buffer; i > 0; i --, run ++)
+    wptr = cups_raster_pack(task->r, run->pixels, run->count, wptr);
+
+  task->length = (size_t)(wptr - task->buffer);
+
+  return (NULL);
+}
+
+
 /*
  * 'cups_raster_read()' - Read through the raster buffer.
  */
@@ -1550,6 +1945,213 @@ cups_raster_read(cups_raster_t *r,	/* I - Raster stream */
 }
 
 
+/*
+ * 'cups_raster_scan()' - Count repeating or non-repeating pixels.
+ *
+ * Returns the number of pixels starting at "ptr" (up to "max") that are the
+ * same as ("same" = 1) or different from ("same" = 0) the pixel that follows
+ * them.  Single byte pixels are compared 8 at a time, other common pixel
+ * sizes are compared inline instead of calling memcmp() for every pixel.
+ */
+
+static unsigned				/* O - Number of pixels */
+cups_raster_scan(
+    const unsigned char *ptr,		/* I - First pixel to compare */
+    const unsigned char *plast,		/* I - Pointer to last pixel */
+    unsigned            bpp,		/* I - Bytes per pixel */
+    unsigned            max,		/* I - Maximum number of pixels */
+    int                 same)		/* I - 1 = repeating, 0 = non-repeating */
+{
+  unsigned	count,			/* Number of pixels */
+		avail;			/* Number of pixels before the last one */
+
+
+  avail = (unsigned)((size_t)(plast - ptr) / bpp);
+  if (max > avail)
+    max = avail;
+
+  count = 0;
+
+  switch (bpp)
+  {
+    case 1 :
+#ifdef HAVE_STDINT_H
+       /*
+        * Compare 8 pixels at a time, finishing the run one pixel at a time
+	* once a word contains a match (or mismatch)...
+	*/
+
+        while ((count + 8) <= max)
+	{
+	  uint64_t	a, b, x;	/* Current/next pixels and difference */
+
+	  memcpy(&a, ptr + count, sizeof(a));
+	  memcpy(&b, ptr + count + 1, sizeof(b));
+
+	  x = a ^ b;
+
+	  if (same ? x != 0 : ((x - 0x0101010101010101ULL) & ~x & 0x8080808080808080ULL) != 0)
+	    break;
+
+	  count += 8;
+	}
+#endif /* HAVE_STDINT_H */
+
+        while (count < max && (ptr[count] == ptr[count + 1]) == same)
+	  count ++;
+        break;
+
+    case 3 :
+        for (ptr += 3 * count; count < max; count ++, ptr += 3)
+	  if ((ptr[0] == ptr[3] && ptr[1] == ptr[4] && ptr[2] == ptr[5]) != same)
+	    break;
+        break;
+
+    case 4 :
+        for (ptr += 4 * count; count < max; count ++, ptr += 4)
+	  if ((ptr[0] == ptr[4] && ptr[1] == ptr[5] && ptr[2] == ptr[6] && ptr[3] == ptr[7]) != same)
+	    break;
+        break;
+
+    default :
+        for (; count < max; count ++, ptr += bpp)
+	  if (!memcmp(ptr, ptr + bpp, bpp) != same)
+	    break;
+        break;
+  }
+
+  return (count);
+}
+
+
+/*
+ * 'cups_raster_unpack()' - Decode the compressed data for one line.
+ *
+ * The line repeat count must already have been read.
+ */
+
+static int				/* O - 1 on success, 0 on failure */
+cups_raster_unpack(
+    cups_raster_t *r,			/* I - Raster stream */
+    unsigned char *ptr)			/* I - Line buffer */
+{
+  ssize_t	bytes;			/* Bytes remaining in line */
+  unsigned char	byte,			/* Byte from file */
+		*temp;			/* Pointer into line */
+  unsigned	count;			/* Repetition count */
+
+
+  temp  = ptr;
+  bytes = (ssize_t)r->header.cupsBytesPerLine;
+
+  while (bytes > 0)
+  {
+   /*
+    * Get a new repeat count...
+    */
+
+    if (!cups_raster_read(r, &byte, 1))
+    {
+      DEBUG_puts("1cups_raster_unpack: Read error, returning 0.");
+      return (0);
+    }
+
+    if (byte == 128)
+    {
+     /*
+      * Clear to end of line...
+      */
+
+      switch (r->header.cupsColorSpace)
+      {
+        case CUPS_CSPACE_W :
+        case CUPS_CSPACE_RGB :
+        case CUPS_CSPACE_SW :
+        case CUPS_CSPACE_SRGB :
+        case CUPS_CSPACE_RGBW :
+        case CUPS_CSPACE_ADOBERGB :
+            memset(temp, 0xff, (size_t)bytes);
+            break;
+        default :
+            memset(temp, 0x00, (size_t)bytes);
+            break;
+      }
+
+      temp += bytes;
+      bytes = 0;
+    }
+    else if (byte & 128)
+    {
+     /*
+      * Copy N literal pixels...
+      */
+
+      count = (unsigned)(257 - byte) * r->bpp;
+
+      if (count > (unsigned)bytes)
+        count = (unsigned)bytes;
+
+      if (!cups_raster_read(r, temp, count))
+      {
+        DEBUG_puts("1cups_raster_unpack: Read error, returning 0.");
+        return (0);
+      }
+
+      temp  += count;
+      bytes -= (ssize_t)count;
+    }
+    else
+    {
+     /*
+      * Repeat the next N bytes...
+      */
+
+      count = ((unsigned)byte + 1) * r->bpp;
+      if (count > (unsigned)bytes)
+        count = (unsigned)bytes;
+
+      if (count < r->bpp)
+        break;
+
+      bytes -= (ssize_t)count;
+
+      if (!cups_raster_read(r, temp, r->bpp))
+      {
+        DEBUG_puts("1cups_raster_unpack: Read error, returning 0.");
+        return (0);
+      }
+
+      temp  += r->bpp;
+      count -= r->bpp;
+
+      while (count > 0)
+      {
+        memcpy(temp, temp - r->bpp, r->bpp);
+        temp  += r->bpp;
+        count -= r->bpp;
+      }
+    }
+  }
+
+ /*
+  * Swap bytes as needed...
+  */
+
+  if ((r->header.cupsBitsPerColor == 16 ||
+       r->header.cupsBitsPerPixel == 12 ||
+       r->header.cupsBitsPerPixel == 16) &&
+      r->swapped)
+  {
+    DEBUG_puts("1cups_raster_unpack: Swapping bytes.");
+    cups_swap(ptr, (size_t)r->header.cupsBytesPerLine);
+  }
+
+
+
+  return (1);
+}
+
+
 /*
  * 'cups_raster_update()' - Update the raster header and row count for the
  *                          current page.
@@ -1700,31 +2302,13 @@ cups_raster_write(
     cups_raster_t       *r,		/* I - Raster stream */
     const unsigned char *pixels)	/* I - Pixel data to write */
 {
-  const unsigned char	*start,		/* Start of sequence */
-			*ptr,		/* Current pointer in sequence */
-			*pend,		/* End of raster buffer */
-			*plast;		/* Pointer to last pixel */
   unsigned char		*wptr;		/* Pointer into write buffer */
-  unsigned		bpp,		/* Bytes per pixel */
-			count;		/* Count */
-  _cups_copyfunc_t	cf;		/* Copy function */
+  unsigned		count;		/* Count */
 
 
   DEBUG_printf(("3cups_raster_write(r=%p, pixels=%p)", (void *)r, (void *)pixels));
 
  /*
-  * Determine whether we need to swap bytes...
-  */
-
-  if (r->swapped && (r->header.cupsBitsPerColor == 16 || r->header.cupsBitsPerPixel == 12 || r->header.cupsBitsPerPixel == 16))
-  {
-    DEBUG_puts("4cups_raster_write: Swapping bytes when writing.");
-    cf = (_cups_copyfunc_t)cups_swap_copy;
-  }
-  else
-    cf = (_cups_copyfunc_t)memcpy;
-
-  /*
   * Allocate a write buffer as needed...
   */
 
@@ -1749,6 +2333,51 @@ cups_raster_write(
     r->bufsize = count;
   }
 
+ /*
+  * Encode and write the line...
+  */
+
+  wptr = cups_raster_pack(r, pixels, r->count, r->buffer);
+
+  DEBUG_printf(("4cups_raster_write: Writing " CUPS_LLFMT " bytes.", CUPS_LLCAST (wptr - r->buffer)));
+
+  return (cups_raster_io(r, r->buffer, (size_t)(wptr - r->buffer)));
+}
+
+
+/*
+ * 'cups_raster_pack()' - Encode a line with a repeat count.
+ *
+ * The output buffer must have room for at least "cupsBytesPerLine * 2 + 2"
+ * bytes.  This function only reads the stream and can be called from
+ * multiple threads.
+ */
+
+static unsigned char *			/* O - End of encoded data */
+cups_raster_pack(
+    cups_raster_t       *r,		/* I - Raster stream */
+    const unsigned char *pixels,	/* I - Pixel data to encode */
+    unsigned            repeat,		/* I - Line repeat count */
+    unsigned char       *wptr)		/* I - Output buffer */
+{
+  const unsigned char	*start,		/* Start of sequence */
+			*ptr,		/* Current pointer in sequence */
+			*pend,		/* End of raster buffer */
+			*plast;		/* Pointer to last pixel */
+  unsigned		bpp,		/* Bytes per pixel */
+			count;		/* Count */
+  _cups_copyfunc_t	cf;		/* Copy function */
+
+
+ /*
+  * Determine whether we need to swap bytes...
+  */
+
+  if (r->swapped && (r->header.cupsBitsPerColor == 16 || r->header.cupsBitsPerPixel == 12 || r->header.cupsBitsPerPixel == 16))
+    cf = (_cups_copyfunc_t)cups_swap_copy;
+  else
+    cf = (_cups_copyfunc_t)memcpy;
+
  /*
   * Write the row repeat count...
   */
@@ -1756,8 +2385,7 @@ cups_raster_write(
   bpp     = r->bpp;
   pend    = pixels + r->header.cupsBytesPerLine;
   plast   = pend - bpp;
-  wptr    = r->buffer;
-  *wptr++ = (unsigned char)(r->count - 1);
+  *wptr++ = (unsigned char)(repeat - 1);
 
  /*
   * Write using a modified PackBits compression...
@@ -1784,9 +2412,9 @@ cups_raster_write(
       * Encode a sequence of repeating pixels...
       */
 
-      for (count = 2; count < 128 && ptr < plast; count ++, ptr += bpp)
-        if (memcmp(ptr, ptr + bpp, bpp))
-	  break;
+      count = cups_raster_scan(ptr, plast, bpp, 126, 1);
+      ptr   += count * bpp;
+      count += 2;
 
       *wptr++ = (unsigned char)(count - 1);
       (*cf)(wptr, ptr, bpp);
@@ -1799,9 +2427,9 @@ cups_raster_write(
       * Encode a sequence of non-repeating pixels...
       */
 
-      for (count = 1; count < 128 && ptr < plast; count ++, ptr += bpp)
-        if (!memcmp(ptr, ptr + bpp, bpp))
-	  break;
+      count = cups_raster_scan(ptr, plast, bpp, 127, 0);
+      ptr   += count * bpp;
+      count ++;
 
       if (ptr >= plast && count < 128)
       {
@@ -1817,35 +2445,150 @@ cups_raster_write(
     }
   }
 
-  DEBUG_printf(("4cups_raster_write: Writing " CUPS_LLFMT " bytes.", CUPS_LLCAST (wptr - r->buffer)));
-
-  return (cups_raster_io(r, r->buffer, (size_t)(wptr - r->buffer)));
+  return (wptr);
 }
 
 
 /*
- * 'cups_swap()' - Swap bytes in raster data...
+ * 'cups_raster_write_runs()' - Encode and write runs of lines.
+ *
+ * Large bands are split into groups of runs that are encoded by separate
+ * threads into their own buffers and then written in order.  Otherwise the
+ * runs are encoded into the write buffer, which is written as it fills up.
  */
 
-static void
-cups_swap(unsigned char *buf,		/* I - Buffer to swap */
-          size_t        bytes)		/* I - Number of bytes to swap */
+static int				/* O - 1 on success, 0 on failure */
+cups_raster_write_runs(
+    cups_raster_t            *r,	/* I - Raster stream */
+    const _cups_raster_run_t *runs,	/* I - Runs of lines */
+    unsigned                 numruns)	/* I - Number of runs */
 {
-  unsigned char	even, odd;		/* Temporary variables */
+  unsigned		i,		/* Looping var */
+			threads,	/* Number of threads to use */
+			first;		/* First run for current thread */
+  size_t		linemax,	/* Maximum size of an encoded line */
+			bufsize;	/* Size of buffer */
+  unsigned char		*wptr;		/* Pointer into write buffer */
+  _cups_raster_task_t	tasks[_CUPS_RASTER_MAX_THREADS];
+					/* Compression tasks */
+  _cups_thread_t	tids[_CUPS_RASTER_MAX_THREADS];
+					/* Compression threads */
 
 
-  bytes /= 2;
+  if (numruns == 0)
+    return (1);
 
-  while (bytes > 0)
+  linemax = 2 * (size_t)r->header.cupsBytesPerLine + 2;
+
+ /*
+  * Give each thread at least a band's worth of lines to encode...
+  */
+
+  threads = (unsigned)((size_t)numruns * r->header.cupsBytesPerLine / _CUPS_RASTER_BAND_SIZE);
+
+  if (threads > (unsigned)r->threads)
+    threads = (unsigned)r->threads;
+  if (threads > numruns)
+    threads = numruns;
+
+  if (threads > 1)
+  {
+    for (i = 0, first = 0; i < threads; i ++)
+    {
+      tasks[i].r       = r;
+      tasks[i].runs    = runs + first;
+      tasks[i].numruns = (numruns - first) / (threads - i);
+      tasks[i].length  = 0;
+
+      first += tasks[i].numruns;
+
+      if ((bufsize = tasks[i].numruns * linemax) > r->tbufsizes[i])
+      {
+        if ((wptr = realloc(r->tbuffers[i], bufsize)) == NULL)
+          break;
+
+        r->tbuffers[i]  = wptr;
+        r->tbufsizes[i] = bufsize;
+      }
+
+      tasks[i].buffer = r->tbuffers[i];
+    }
+
+    if (i == threads)
+    {
+      for (i = 1; i < threads; i ++)
+        tids[i] = _cupsThreadCreate((_cups_thread_func_t)cups_raster_pack_runs, tasks + i);
+
+      cups_raster_pack_runs(tasks);
+
+      for (i = 1; i < threads; i ++)
+      {
+        if (tids[i])
+          _cupsThreadWait(tids[i]);
+        else
+          cups_raster_pack_runs(tasks + i);
+      }
+
+      for (i = 0; i < threads; i ++)
+      {
+        if (cups_raster_io(r, tasks[i].buffer, tasks[i].length) < (ssize_t)tasks[i].length)
+          return (0);
+      }
+
+      return (1);
+    }
+
+    DEBUG_puts("4cups_raster_write_runs: Unable to allocate thread buffers, encoding on one thread.");
+  }
+
+ /*
+  * Encode on the current thread using a band-sized write buffer...
+  */
+
+  if ((bufsize = _CUPS_RASTER_BAND_SIZE) < 2 * linemax)
+    bufsize = 2 * linemax;
+
+  if (bufsize > r->bufsize)
   {
-    even   = buf[0];
-    odd    = buf[1];
-    buf[0] = odd;
-    buf[1] = even;
+    if ((wptr = realloc(r->buffer, bufsize)) == NULL)
+    {
+      DEBUG_printf(("4cups_raster_write_runs: Unable to allocate " CUPS_LLFMT " bytes for raster buffer: %s", CUPS_LLCAST bufsize, strerror(errno)));
+      return (0);
+    }
 
-    buf += 2;
-    bytes --;
+    r->buffer  = wptr;
+    r->bufsize = bufsize;
+  }
+
+  for (i = numruns, wptr = r->buffer; i > 0; i --, runs ++)
+  {
+    if ((size_t)(wptr - r->buffer) > r->bufsize - linemax)
+    {
+      if (cups_raster_io(r, r->buffer, (size_t)(wptr - r->buffer)) < (ssize_t)(wptr - r->buffer))
+        return (0);
+
+      wptr = r->buffer;
+    }
+
+    wptr = cups_raster_pack(r, runs->pixels, runs->count, wptr);
   }
+
+  if (wptr > r->buffer && cups_raster_io(r, r->buffer, (size_t)(wptr - r->buffer)) < (ssize_t)(wptr - r->buffer))
+    return (0);
+
+  return (1);
+}
+
+
+/*
+ * 'cups_swap()' - Swap bytes in raster data...
+ */
+
+static void
+cups_swap(unsigned char *buf,		/* I - Buffer to swap */
+          size_t        bytes)		/* I - Number of bytes to swap */
+{
+  _cupsRasterSwap16(buf, buf, bytes);
 }
 
 
@@ -1859,15 +2602,5 @@ cups_swap_copy(
     const unsigned char *src,		/* I - Source */
     size_t              bytes)		/* I - Number of bytes to swap */
 {
-  bytes /= 2;
-
-  while (bytes > 0)
-  {
-    dst[0] = src[1];
-    dst[1] = src[0];
-
-    dst += 2;
-    src += 2;
-    bytes --;
-  }
+  _cupsRasterSwap16(dst, src, bytes);
 }
@@ -211,6 +211,33 @@ cupsRasterReadHeader2(
 }
 
 
+/*
+ * 'cupsRasterReadLines()' - Read one or more whole lines of raster pixels.
+ *
+ * This function decodes a band of lines into a buffer owned by the raster
+ * stream and returns a pointer to it, avoiding a copy into the caller's
+ * buffer.  The "numlines" argument receives the number of lines in the band,
+ * which is at most "maxlines" (0 for no limit).  Each line is
+ * "cupsBytesPerLine" bytes long.
+ *
+ * The returned pointer is only valid until the next call to
+ * @link cupsRasterReadHeader2@, @link cupsRasterReadLines@,
+ * @link cupsRasterReadPixels@, or @link cupsRasterClose@.  @code NULL@ is
+ * returned at the end of the page or on error.
+ *
+ * @since CUPS 2.3@
+ */
+
+const unsigned char *			/* O - First line or @code NULL@ */
+cupsRasterReadLines(
+    cups_raster_t *r,			/* I - Raster stream */
+    unsigned      maxlines,		/* I - Maximum number of lines or 0 */
+    unsigned      *numlines)		/* O - Number of lines returned */
+{
+  return (_cupsRasterReadLines(r, maxlines, numlines));
+}
+
+
 /*
  * 'cupsRasterReadPixels()' - Read raster pixels.
  *
@@ -229,6 +256,27 @@ cupsRasterReadPixels(
 }
 
 
+/*
+ * 'cupsRasterSetThreads()' - Set the number of threads used for compression.
+ *
+ * When more than one thread is enabled, large bands of lines written with
+ * @link cupsRasterWriteLines@ are split into groups of lines that are
+ * compressed in parallel and then written in order.  The output is identical
+ * to the single-threaded output.  Lines written with
+ * @link cupsRasterWritePixels@ are always compressed on the calling thread.
+ *
+ * @since CUPS 2.3@
+ */
+
+int					/* O - 1 on success, 0 on failure */
+cupsRasterSetThreads(
+    cups_raster_t *r,			/* I - Raster stream */
+    int           threads)		/* I - Number of threads (1 to 16) */
+{
+  return (_cupsRasterSetThreads(r, threads));
+}
+
+
 /*
  * 'cupsRasterWriteHeader()' - Write a raster page header from a version 1 page
  *                             header structure.
@@ -285,6 +333,26 @@ cupsRasterWriteHeader2(
 }
 
 
+/*
+ * 'cupsRasterWriteLines()' - Write one or more whole lines of raster pixels.
+ *
+ * This function writes "numlines" consecutive lines of "cupsBytesPerLine"
+ * bytes each.  Repeated lines are detected across the whole band and the
+ * encoded data is written using as few writes as possible.
+ *
+ * @since CUPS 2.3@
+ */
+
+unsigned				/* O - Number of lines written */
+cupsRasterWriteLines(
+    cups_raster_t       *r,		/* I - Raster stream */
+    const unsigned char *lines,		/* I - First line */
+    unsigned            numlines)	/* I - Number of lines */
+{
+  return (_cupsRasterWriteLines(r, lines, numlines));
+}
+
+
 /*
  * 'cupsRasterWritePixels()' - Write raster pixels.
  *
@@ -392,6 +392,11 @@ extern cups_raster_t	*cupsRasterOpenIO(cups_raster_iocb_t iocb, void *ctx, cups_
 /**** New in CUPS 2.2/macOS 10.12 ****/
 extern int		cupsRasterInitPWGHeader(cups_page_header2_t *h, pwg_media_t *media, const char *type, int xdpi, int ydpi, const char *sides, const char *sheet_back) _CUPS_API_2_2;
 
+/**** New in CUPS 2.3 ****/
+extern const unsigned char *cupsRasterReadLines(cups_raster_t *r, unsigned maxlines, unsigned *numlines) _CUPS_API_2_3;
+extern int		cupsRasterSetThreads(cups_raster_t *r, int threads) _CUPS_API_2_3;
+extern unsigned		cupsRasterWriteLines(cups_raster_t *r, const unsigned char *lines, unsigned numlines) _CUPS_API_2_3;
+
 #  ifdef __cplusplus
 }
 #  endif /* __cplusplus */
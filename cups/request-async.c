@@ -0,0 +1,772 @@
+/*
+ * Asynchronous IPP request functions for CUPS.
+ *
+ * Copyright © 2007-2018 by Apple Inc.
+ * Copyright © 1997-2007 by Easy Software Products.
+ *
+ * Licensed under Apache License v2.0.  See the file "LICENSE" for more information.
+ */
+
+/*
+ * Include necessary headers...
+ */
+
+#include "cups-private.h"
+#include "debug-internal.h"
+#ifdef HAVE_POLL
+#  include <poll.h>
+#endif /* HAVE_POLL */
+
+
+/*
+ * Local types...
+ */
+
+typedef enum _cups_astate_e		/**** Connection state ****/
+{
+  _CUPS_ASTATE_IDLE,			/* No request on the wire */
+  _CUPS_ASTATE_STATUS,			/* Waiting for the HTTP status */
+  _CUPS_ASTATE_BODY			/* Reading the response body */
+} _cups_astate_t;
+
+typedef struct _cups_areq_s		/**** Queued request ****/
+{
+  ipp_t			*request;	/* IPP request */
+  char			*resource;	/* Resource path */
+  cups_async_cb_t	cb;		/* Completion callback */
+  void			*user_data;	/* User data pointer */
+} _cups_areq_t;
+
+typedef struct _cups_aconn_s		/**** Connection ****/
+{
+  http_t		*http;		/* HTTP connection */
+  cups_array_t		*queue;		/* Requests, first is on the wire */
+  _cups_astate_t	state;		/* Current state */
+  time_t		deadline;	/* Time when the response is overdue or 0 */
+  ipp_uchar_t		*buffer;	/* Request/response buffer */
+  size_t		bufsize,	/* Size of buffer */
+			buflen,		/* Bytes in buffer */
+			bufpos;		/* Current read position in buffer */
+} _cups_aconn_t;
+
+struct _cups_async_s			/**** Asynchronous request context ****/
+{
+  cups_array_t		*conns;		/* Connections with queued requests */
+  int			pending;	/* Number of queued requests */
+};
+
+
+/*
+ * Local functions...
+ */
+
+static int	cups_async_compare(_cups_aconn_t *a, _cups_aconn_t *b);
+static void	cups_async_finish(cups_async_t *async, _cups_aconn_t *conn, ipp_t *response);
+static void	cups_async_free(_cups_aconn_t *conn);
+static ssize_t	cups_async_io(_cups_aconn_t *conn, ipp_uchar_t *buffer, size_t bytes);
+static void	cups_async_read(cups_async_t *async, _cups_aconn_t *conn);
+static void	cups_async_start(cups_async_t *async, _cups_aconn_t *conn);
+
+
+/*
+ * 'cupsAsyncDelete()' - Free an asynchronous request context.
+ *
+ * Requests that have not completed are freed without calling their callbacks.
+ * Connections with a request on the wire are shut down, since the response can
+ * no longer be read.  The connections themselves are not closed.
+ *
+ * @since CUPS 2.3@
+ */
+
+void
+cupsAsyncDelete(cups_async_t *async)	/* I - Asynchronous request context */
+{
+  _cups_aconn_t	*conn;			/* Current connection */
+
+
+  DEBUG_printf(("cupsAsyncDelete(async=%p)", (void *)async));
+
+  if (!async)
+    return;
+
+  for (conn = (_cups_aconn_t *)cupsArrayFirst(async->conns); conn; conn = (_cups_aconn_t *)cupsArrayNext(async->conns))
+  {
+    if (conn->state != _CUPS_ASTATE_IDLE)
+    {
+      httpShutdown(conn->http);
+      conn->http->state = HTTP_STATE_ERROR;
+    }
+
+    cups_async_free(conn);
+  }
+
+  cupsArrayDelete(async->conns);
+  free(async);
+}
+
+
+/*
+ * 'cupsAsyncDoRequest()' - Queue an IPP request for asynchronous processing.
+ *
+ * The request is sent and its response read by @link cupsAsyncProcess@, which
+ * calls "cb" with the response, or @code NULL@ on error.  The callback owns
+ * the response and must free it with @link ippDelete@.  @link cupsLastError@
+ * and @link cupsLastErrorString@ report the status of the request while the
+ * callback runs.
+ *
+ * Requests on the same connection are sent one at a time in the order they
+ * were queued, while requests on different connections are in flight at the
+ * same time.  The request is freed with @link ippDelete@ once it completes,
+ * just like @link cupsDoRequest@.
+ *
+ * @since CUPS 2.3@
+ */
+
+int					/* O - 1 on success, 0 on error */
+cupsAsyncDoRequest(
+    cups_async_t    *async,		/* I - Asynchronous request context */
+    http_t          *http,		/* I - Connection to server */
+    ipp_t           *request,		/* I - IPP request */
+    const char      *resource,		/* I - HTTP resource for POST */
+    cups_async_cb_t cb,			/* I - Completion callback */
+    void            *user_data)		/* I - User data pointer */
+{
+  _cups_aconn_t	key,			/* Search key */
+		*conn;			/* Connection */
+  _cups_areq_t	*req;			/* Queued request */
+
+
+  DEBUG_printf(("cupsAsyncDoRequest(async=%p, http=%p, request=%p(%s), resource=\"%s\", cb=%p, user_data=%p)", (void *)async, (void *)http, (void *)request, request ? ippOpString(request->request.op.operation_id) : "?", resource, (void *)cb, user_data));
+
+  if (!async || !http || !request || !resource || !cb)
+  {
+    ippDelete(request);
+    _cupsSetError(IPP_STATUS_ERROR_INTERNAL, strerror(EINVAL), 0);
+    return (0);
+  }
+
+  key.http = http;
+
+  if ((conn = (_cups_aconn_t *)cupsArrayFind(async->conns, &key)) == NULL)
+  {
+    if ((conn = calloc(1, sizeof(_cups_aconn_t))) == NULL || (conn->queue = cupsArrayNew(NULL, NULL)) == NULL)
+    {
+      free(conn);
+      ippDelete(request);
+      _cupsSetError(IPP_STATUS_ERROR_INTERNAL, strerror(errno), 0);
+      return (0);
+    }
+
+    conn->http = http;
+    cupsArrayAdd(async->conns, conn);
+  }
+
+  if ((req = calloc(1, sizeof(_cups_areq_t))) == NULL || (req->resource = strdup(resource)) == NULL)
+  {
+    free(req);
+    ippDelete(request);
+    _cupsSetError(IPP_STATUS_ERROR_INTERNAL, strerror(errno), 0);
+
+    if (cupsArrayCount(conn->queue) == 0)
+    {
+      cupsArrayRemove(async->conns, conn);
+      cups_async_free(conn);
+    }
+
+    return (0);
+  }
+
+  req->request   = request;
+  req->cb        = cb;
+  req->user_data = user_data;
+
+  cupsArrayAdd(conn->queue, req);
+  async->pending ++;
+
+  return (1);
+}
+
+
+/*
+ * 'cupsAsyncNew()' - Create an asynchronous request context.
+ *
+ * A context drives any number of connections from a single thread.  It must
+ * not be used from more than one thread at a time.
+ *
+ * @since CUPS 2.3@
+ */
+
+cups_async_t *				/* O - Asynchronous request context or @code NULL@ on error */
+cupsAsyncNew(void)
+{
+  cups_async_t	*async;			/* Asynchronous request context */
+
+
+  if ((async = calloc(1, sizeof(cups_async_t))) == NULL)
+    return (NULL);
+
+  if ((async->conns = cupsArrayNew((cups_array_func_t)cups_async_compare, NULL)) == NULL)
+  {
+    free(async);
+    return (NULL);
+  }
+
+  return (async);
+}
+
+
+/*
+ * 'cupsAsyncProcess()' - Send queued requests and read their responses.
+ *
+ * This function sends the next queued request on each idle connection, then
+ * waits up to "msec" milliseconds for response data on all connections and
+ * processes whatever has arrived, calling the completion callback of each
+ * finished request.  Callbacks may queue new requests.
+ *
+ * Requests are written in full when they are sent, and a response is only
+ * read once data is available on its connection.  Connections that use a
+ * timeout set with @link httpSetTimeout@ fail requests whose response does not
+ * arrive in time.
+ *
+ * @since CUPS 2.3@
+ */
+
+int					/* O - Number of pending requests or -1 on error */
+cupsAsyncProcess(cups_async_t *async,	/* I - Asynchronous request context */
+                 int          msec)	/* I - Maximum time to wait in milliseconds or -1 for no limit */
+{
+  int		i,			/* Looping var */
+		num_conns,		/* Number of busy connections */
+		nfds;			/* Result from select()/poll() */
+  _cups_aconn_t	*conn,			/* Current connection */
+		**conns;		/* Busy connections */
+  time_t	curtime;		/* Current time */
+#ifdef HAVE_POLL
+  struct pollfd	*pfds;			/* Polled file descriptors */
+#else
+  fd_set	input_set;		/* select() input set */
+  int		maxfd = -1;		/* Highest file descriptor */
+  struct timeval timeout;		/* Timeout for select() */
+#endif /* HAVE_POLL */
+
+
+  DEBUG_printf(("cupsAsyncProcess(async=%p, msec=%d)", (void *)async, msec));
+
+  if (!async)
+    return (-1);
+
+ /*
+  * Send the next request on idle connections.  Take a snapshot first, since
+  * failed requests call their callbacks, which may queue new requests...
+  */
+
+  if ((num_conns = cupsArrayCount(async->conns)) == 0)
+    return (0);
+
+  if ((conns = calloc((size_t)num_conns, sizeof(_cups_aconn_t *))) == NULL)
+    return (-1);
+
+  for (i = 0, conn = (_cups_aconn_t *)cupsArrayFirst(async->conns); conn; conn = (_cups_aconn_t *)cupsArrayNext(async->conns))
+    if (conn->state == _CUPS_ASTATE_IDLE)
+      conns[i ++] = conn;
+
+  while (i > 0)
+    cups_async_start(async, conns[-- i]);
+
+ /*
+  * Then wait for response data on busy connections...
+  */
+
+  if ((num_conns = cupsArrayCount(async->conns)) > 0 && (conns = realloc(conns, (size_t)num_conns * sizeof(_cups_aconn_t *))) == NULL)
+    return (-1);
+
+  curtime = time(NULL);
+
+  for (num_conns = 0, conn = (_cups_aconn_t *)cupsArrayFirst(async->conns); conn; conn = (_cups_aconn_t *)cupsArrayNext(async->conns))
+  {
+    if (conn->state == _CUPS_ASTATE_IDLE)
+      continue;
+
+    conns[num_conns ++] = conn;
+
+    if (httpGetReady(conn->http))
+      msec = 0;
+    else if (conn->deadline && (msec < 0 || (conn->deadline - curtime) * 1000 < msec))
+      msec = conn->deadline > curtime ? (int)(conn->deadline - curtime) * 1000 : 0;
+  }
+
+  if (num_conns == 0)
+  {
+    free(conns);
+    return (async->pending);
+  }
+
+#ifdef HAVE_POLL
+  if ((pfds = calloc((size_t)num_conns, sizeof(struct pollfd))) == NULL)
+  {
+    free(conns);
+    return (-1);
+  }
+
+  for (i = 0; i < num_conns; i ++)
+  {
+    pfds[i].fd     = conns[i]->http->fd;
+    pfds[i].events = POLLIN;
+  }
+
+  while ((nfds = poll(pfds, (nfds_t)num_conns, msec)) < 0 && (errno == EINTR || errno == EAGAIN));
+
+#else
+  FD_ZERO(&input_set);
+
+  for (i = 0; i < num_conns; i ++)
+  {
+    if (conns[i]->http->fd < 0)
+      continue;
+
+    FD_SET(conns[i]->http->fd, &input_set);
+
+    if (conns[i]->http->fd > maxfd)
+      maxfd = conns[i]->http->fd;
+  }
+
+  do
+  {
+    timeout.tv_sec  = msec / 1000;
+    timeout.tv_usec = (msec % 1000) * 1000;
+
+    nfds = select(maxfd + 1, &input_set, NULL, NULL, msec < 0 ? NULL : &timeout);
+  }
+#  ifdef _WIN32
+  while (nfds < 0 && (WSAGetLastError() == WSAEINTR || WSAGetLastError() == WSAEWOULDBLOCK));
+#  else
+  while (nfds < 0 && (errno == EINTR || errno == EAGAIN));
+#  endif /* _WIN32 */
+#endif /* HAVE_POLL */
+
+  if (nfds < 0)
+  {
+    DEBUG_printf(("1cupsAsyncProcess: Wait failed: %s", strerror(errno)));
+#ifdef HAVE_POLL
+    free(pfds);
+#endif /* HAVE_POLL */
+    free(conns);
+    return (-1);
+  }
+
+ /*
+  * Read from connections with data and fail overdue requests...
+  */
+
+  curtime = time(NULL);
+
+  for (i = 0; i < num_conns; i ++)
+  {
+    conn = conns[i];
+
+#ifdef HAVE_POLL
+    if (pfds[i].revents || httpGetReady(conn->http) || conn->http->fd < 0)
+#else
+    if ((conn->http->fd >= 0 && FD_ISSET(conn->http->fd, &input_set)) || httpGetReady(conn->http) || conn->http->fd < 0)
+#endif /* HAVE_POLL */
+    {
+      cups_async_read(async, conn);
+    }
+    else if (conn->deadline && curtime >= conn->deadline)
+    {
+      DEBUG_printf(("2cupsAsyncProcess: Request on %p timed out.", (void *)conn->http));
+
+      httpShutdown(conn->http);
+      conn->http->state  = HTTP_STATE_ERROR;
+      conn->http->status = HTTP_STATUS_ERROR;
+      conn->http->error  = ETIMEDOUT;
+
+      _cupsSetError(IPP_STATUS_ERROR_SERVICE_UNAVAILABLE, strerror(ETIMEDOUT), 0);
+      cups_async_finish(async, conn, NULL);
+    }
+  }
+
+#ifdef HAVE_POLL
+  free(pfds);
+#endif /* HAVE_POLL */
+  free(conns);
+
+  return (async->pending);
+}
+
+
+/*
+ * 'cups_async_compare()' - Compare two connections.
+ */
+
+static int				/* O - Result of comparison */
+cups_async_compare(_cups_aconn_t *a,	/* I - First connection */
+                   _cups_aconn_t *b)	/* I - Second connection */
+{
+  if (a->http < b->http)
+    return (-1);
+  else if (a->http > b->http)
+    return (1);
+  else
+    return (0);
+}
+
+
+/*
+ * 'cups_async_finish()' - Complete the current request on a connection.
+ *
+ * The callback is called with the response and the next request on the
+ * connection is sent.  "conn" must not be used after this function returns.
+ */
+
+static void
+cups_async_finish(cups_async_t  *async,	/* I - Asynchronous request context */
+                  _cups_aconn_t *conn,	/* I - Connection */
+                  ipp_t         *response)
+					/* I - Response or `NULL` on error */
+{
+  _cups_areq_t	*req;			/* Completed request */
+
+
+  req = (_cups_areq_t *)cupsArrayFirst(conn->queue);
+
+  cupsArrayRemove(conn->queue, req);
+  async->pending --;
+
+  conn->state    = _CUPS_ASTATE_IDLE;
+  conn->deadline = 0;
+
+ /*
+  * The callback may queue another request on this connection, so keep the
+  * connection in the array while it runs...
+  */
+
+  (req->cb)(async, conn->http, response, req->user_data);
+
+  ippDelete(req->request);
+  free(req->resource);
+  free(req);
+
+  cups_async_start(async, conn);
+}
+
+
+/*
+ * 'cups_async_free()' - Free a connection and its queued requests.
+ */
+
+static void
+cups_async_free(_cups_aconn_t *conn)	/* I - Connection */
+{
+  _cups_areq_t	*req;			/* Current request */
+
+
+  for (req = (_cups_areq_t *)cupsArrayFirst(conn->queue); req; req = (_cups_areq_t *)cupsArrayNext(conn->queue))
+  {
+    ippDelete(req->request);
+    free(req->resource);
+    free(req);
+  }
+
+  cupsArrayDelete(conn->queue);
+  free(conn->buffer);
+  free(conn);
+}
+
+
+/*
+ * 'cups_async_io()' - Read IPP data from the response buffer.
+ */
+
+static ssize_t				/* O - Number of bytes read */
+cups_async_io(_cups_aconn_t *conn,	/* I - Connection */
+              ipp_uchar_t   *buffer,	/* I - Buffer */
+              size_t        bytes)	/* I - Number of bytes to read */
+{
+  if (bytes > (conn->buflen - conn->bufpos))
+    bytes = conn->buflen - conn->bufpos;
+
+  memcpy(buffer, conn->buffer + conn->bufpos, bytes);
+  conn->bufpos += bytes;
+
+  return ((ssize_t)bytes);
+}
+
+
+/*
+ * 'cups_async_read()' - Read available response data on a connection.
+ */
+
+static void
+cups_async_read(cups_async_t  *async,	/* I - Asynchronous request context */
+                _cups_aconn_t *conn)	/* I - Connection */
+{
+  http_t	*http = conn->http;	/* HTTP connection */
+  http_status_t	status;			/* HTTP status */
+  ssize_t	bytes;			/* Bytes read */
+  ipp_t		*response;		/* IPP response */
+  ipp_state_t	state;			/* IPP read state */
+  ipp_attribute_t *attr;		/* status-message attribute */
+
+
+  if (http->fd < 0)
+  {
+    _cupsSetHTTPError(HTTP_STATUS_ERROR);
+    cups_async_finish(async, conn, NULL);
+    return;
+  }
+
+  if (conn->state == _CUPS_ASTATE_STATUS)
+  {
+    if ((status = httpUpdate(http)) == HTTP_STATUS_CONTINUE)
+      return;
+
+    DEBUG_printf(("2cups_async_read: status=%d", status));
+
+    if (status == HTTP_STATUS_OK)
+    {
+      conn->state  = _CUPS_ASTATE_BODY;
+      conn->buflen = 0;
+
+      if (!httpGetReady(http) && http->state != HTTP_STATE_WAITING)
+        return;
+    }
+    else
+    {
+      _cups_areq_t *req = (_cups_areq_t *)cupsArrayFirst(conn->queue);
+					/* Current request */
+
+      if (status != HTTP_STATUS_ERROR)
+        httpFlush(http);
+
+      if (status == HTTP_STATUS_UNAUTHORIZED)
+      {
+        if (!cupsDoAuthentication(http, "POST", req->resource) && !httpReconnect2(http, 30000, NULL))
+        {
+         /*
+          * Send the request again with the new credentials...
+          */
+
+          conn->state = _CUPS_ASTATE_IDLE;
+          return;
+        }
+
+        status = HTTP_STATUS_CUPS_AUTHORIZATION_CANCELED;
+      }
+#ifdef HAVE_SSL
+      else if (status == HTTP_STATUS_UPGRADE_REQUIRED)
+      {
+        if (!httpReconnect2(http, 30000, NULL) && !httpEncryption(http, HTTP_ENCRYPTION_REQUIRED))
+        {
+          conn->state = _CUPS_ASTATE_IDLE;
+          return;
+        }
+      }
+#endif /* HAVE_SSL */
+
+      _cupsSetHTTPError(status);
+      cups_async_finish(async, conn, NULL);
+      return;
+    }
+  }
+
+ /*
+  * Read the response body into the buffer, only going to the socket when
+  * poll() says there is data or TLS has some buffered...
+  */
+
+  do
+  {
+    if ((conn->bufsize - conn->buflen) < 32768)
+    {
+      ipp_uchar_t *temp;		/* New buffer */
+      size_t	tempsize = conn->bufsize ? 2 * conn->bufsize : 65536;
+					/* New size */
+
+      if ((temp = realloc(conn->buffer, tempsize)) == NULL)
+      {
+        _cupsSetError(IPP_STATUS_ERROR_INTERNAL, strerror(errno), 0);
+        httpShutdown(http);
+        http->state = HTTP_STATE_ERROR;
+        cups_async_finish(async, conn, NULL);
+        return;
+      }
+
+      conn->buffer  = temp;
+      conn->bufsize = tempsize;
+    }
+
+    if ((bytes = httpRead2(http, (char *)conn->buffer + conn->buflen, conn->bufsize - conn->buflen)) < 0)
+    {
+#ifndef _WIN32
+      if (errno == EAGAIN || errno == EINTR)
+        return;
+#endif /* !_WIN32 */
+
+      DEBUG_puts("2cups_async_read: Read error.");
+      _cupsSetHTTPError(HTTP_STATUS_ERROR);
+      http->state = HTTP_STATE_ERROR;
+      cups_async_finish(async, conn, NULL);
+      return;
+    }
+
+    conn->buflen += (size_t)bytes;
+  }
+  while (bytes > 0 && http->state != HTTP_STATE_WAITING && httpGetReady(http));
+
+  if (bytes > 0 && http->state != HTTP_STATE_WAITING)
+    return;
+
+ /*
+  * Got the whole response, decode it...
+  */
+
+  DEBUG_printf(("2cups_async_read: Decoding %u byte response.", (unsigned)conn->buflen));
+
+  response     = ippNew();
+  conn->bufpos = 0;
+
+  while ((state = ippReadIO(conn, (ipp_iocb_t)cups_async_io, 1, NULL, response)) != IPP_STATE_DATA)
+    if (state == IPP_STATE_ERROR)
+      break;
+
+  if (state == IPP_STATE_ERROR)
+  {
+    DEBUG_puts("2cups_async_read: IPP read error!");
+
+    ippDelete(response);
+    response = NULL;
+
+    http->status = HTTP_STATUS_ERROR;
+    http->error  = EINVAL;
+
+    _cupsSetError(IPP_STATUS_ERROR_INTERNAL, strerror(EINVAL), 0);
+  }
+  else
+  {
+    attr = ippFindAttribute(response, "status-message", IPP_TAG_TEXT);
+
+    _cupsSetError(response->request.status.status_code, attr ? attr->values[0].string.text : ippErrorString(response->request.status.status_code), 0);
+  }
+
+  if (conn->bufsize > 262144)
+  {
+   /*
+    * Don't hold on to large buffers...
+    */
+
+    free(conn->buffer);
+    conn->buffer  = NULL;
+    conn->bufsize = 0;
+  }
+
+  cups_async_finish(async, conn, response);
+}
+
+
+/*
+ * 'cups_async_start()' - Send the next request on an idle connection.
+ *
+ * Connections without queued requests are removed and freed.  Requests that
+ * cannot be sent are completed with an error.  "conn" must not be used after
+ * this function returns.
+ */
+
+static void
+cups_async_start(cups_async_t  *async,	/* I - Asynchronous request context */
+                 _cups_aconn_t *conn)	/* I - Connection */
+{
+  _cups_areq_t	*req;			/* Request to send */
+  http_t	*http = conn->http;	/* HTTP connection */
+  ssize_t	length;			/* Length of encoded request */
+  char		date[256];		/* Date: header value */
+  int		tries;			/* Number of POST attempts */
+
+
+  if ((req = (_cups_areq_t *)cupsArrayFirst(conn->queue)) == NULL)
+  {
+    cupsArrayRemove(async->conns, conn);
+    cups_async_free(conn);
+    return;
+  }
+
+  DEBUG_printf(("2cups_async_start: Sending %s request on %p.", ippOpString(req->request->request.op.operation_id), (void *)http));
+
+ /*
+  * Make sure the connection is ready for a new request...
+  */
+
+  if (http->state == HTTP_STATE_GET_SEND || http->state == HTTP_STATE_POST_SEND)
+    httpFlush(http);
+
+  if (http->state != HTTP_STATE_WAITING || !_cups_strcasecmp(httpGetField(http, HTTP_FIELD_CONNECTION), "close"))
+  {
+    httpClearFields(http);
+
+    if (httpReconnect2(http, 30000, NULL))
+    {
+      _cupsSetError(IPP_STATUS_ERROR_SERVICE_UNAVAILABLE, httpStatus(HTTP_STATUS_SERVICE_UNAVAILABLE), 0);
+      cups_async_finish(async, conn, NULL);
+      return;
+    }
+  }
+
+#ifdef HAVE_SSL
+  if (ippFindAttribute(req->request, "auth-info", IPP_TAG_TEXT) && !httpAddrLocalhost(http->hostaddr) && !http->tls && httpEncryption(http, HTTP_ENCRYPTION_REQUIRED))
+  {
+    _cupsSetError(IPP_STATUS_ERROR_SERVICE_UNAVAILABLE, httpStatus(HTTP_STATUS_SERVICE_UNAVAILABLE), 0);
+    cups_async_finish(async, conn, NULL);
+    return;
+  }
+#endif /* HAVE_SSL */
+
+ /*
+  * Encode the request so it can be sent with a Content-Length...
+  */
+
+  if ((length = ippWriteBuffer(req->request, &conn->buffer, &conn->bufsize)) < 0)
+  {
+    _cupsSetError(IPP_STATUS_ERROR_INTERNAL, strerror(errno), 0);
+    cups_async_finish(async, conn, NULL);
+    return;
+  }
+
+  for (tries = 0; tries < 2; tries ++)
+  {
+    httpClearFields(http);
+    httpSetField(http, HTTP_FIELD_CONTENT_TYPE, "application/ipp");
+    httpSetField(http, HTTP_FIELD_DATE, httpGetDateString2(time(NULL), date, (int)sizeof(date)));
+    httpSetLength(http, (size_t)length);
+
+    if (http->authstring && !strncmp(http->authstring, "Digest ", 7))
+      _httpSetDigestAuthString(http, http->nextnonce, "POST", req->resource);
+
+#ifdef HAVE_GSSAPI
+    if (http->authstring && !strncmp(http->authstring, "Negotiate", 9))
+      _cupsSetNegotiateAuthString(http, "POST", req->resource);
+#endif /* HAVE_GSSAPI */
+
+    httpSetField(http, HTTP_FIELD_AUTHORIZATION, http->authstring);
+
+    if (!httpPost(http, req->resource) && httpWrite2(http, (char *)conn->buffer, (size_t)length) == length)
+      break;
+
+    DEBUG_puts("2cups_async_start: POST failed, reconnecting.");
+
+    if (httpReconnect2(http, 30000, NULL))
+      tries = 2;
+  }
+
+  if (tries >= 2)
+  {
+    http->status = HTTP_STATUS_ERROR;
+    http->state  = HTTP_STATE_ERROR;
+
+    _cupsSetHTTPError(HTTP_STATUS_ERROR);
+    cups_async_finish(async, conn, NULL);
+    return;
+  }
+
+  conn->state    = _CUPS_ASTATE_STATUS;
+  conn->deadline = http->timeout_value > 0.0 ? time(NULL) + (time_t)http->timeout_value + 1 : 0;
+}
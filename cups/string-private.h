@@ -67,6 +67,7 @@ typedef struct _cups_sp_item_s		/**** String Pool Item ****/
   unsigned int	guard;			/* Guard word */
 #  endif /* DEBUG_GUARDS */
   unsigned int	ref_count;		/* Reference count */
+  int		id;			/* Well-known attribute name ID */
   char		str[1];			/* String */
 } _cups_sp_item_t;
 
@@ -180,13 +181,29 @@ extern int	_cups_vsnprintf(char *, size_t, const char *, va_list) _CUPS_PRIVATE;
 #    define vsnprintf _cups_vsnprintf
 #  endif /* !HAVE_VSNPRINTF */
 
+/*
+ * String scanning function...
+ */
+
+extern size_t	_cupsStrASCIISpan(const char *s, size_t len, int printable) _CUPS_PRIVATE;
+
+
+/*
+ * String hashing function...
+ */
+
+extern unsigned	_cupsStrHash(const char *s) _CUPS_PRIVATE;
+
+
 /*
  * String pool functions...
  */
 
 extern char	*_cupsStrAlloc(const char *s) _CUPS_PRIVATE;
+extern size_t	_cupsStrCounters(size_t *hits, size_t *misses) _CUPS_PRIVATE;
 extern void	_cupsStrFlush(void) _CUPS_PRIVATE;
 extern void	_cupsStrFree(const char *s) _CUPS_PRIVATE;
+extern int	_cupsStrId(const char *s) _CUPS_PRIVATE;
 extern char	*_cupsStrRetain(const char *s) _CUPS_PRIVATE;
 extern size_t	_cupsStrStatistics(size_t *alloc_bytes, size_t *total_bytes) _CUPS_PRIVATE;
 
@@ -16,17 +16,37 @@
 #include "cups-private.h"
 #include "debug-internal.h"
 #include <stddef.h>
+#include <stdint.h>
 #include <limits.h>
 
 
+/*
+ * Local types...
+ */
+
+typedef struct _cups_sp_shard_s		/**** String Pool Shard ****/
+{
+  _cups_mutex_t	mutex;			/* Mutex to control access to shard */
+  cups_array_t	*pool;			/* Strings in this shard */
+  size_t	hits,			/* Number of reused strings */
+		misses;			/* Number of new strings */
+} _cups_sp_shard_t;
+
+
 /*
  * Local globals...
  */
 
-static _cups_mutex_t	sp_mutex = _CUPS_MUTEX_INITIALIZER;
-					/* Mutex to control access to pool */
-static cups_array_t	*stringpool = NULL;
-					/* Global string pool */
+#define SP_SHARD { _CUPS_MUTEX_INITIALIZER, NULL, 0, 0 }
+#define SP_NUM_SHARDS 16		/* Number of shards (power of 2) */
+
+static _cups_sp_shard_t	sp_shards[SP_NUM_SHARDS] =
+{
+  SP_SHARD, SP_SHARD, SP_SHARD, SP_SHARD,
+  SP_SHARD, SP_SHARD, SP_SHARD, SP_SHARD,
+  SP_SHARD, SP_SHARD, SP_SHARD, SP_SHARD,
+  SP_SHARD, SP_SHARD, SP_SHARD, SP_SHARD
+};					/* Global string pool, partitioned by hash */
 
 
 /*
@@ -34,6 +54,63 @@ static cups_array_t	*stringpool = NULL;
  */
 
 static int	compare_sp_items(_cups_sp_item_t *a, _cups_sp_item_t *b);
+static _cups_sp_shard_t *get_sp_shard(const char *s);
+static int	hash_sp_item(_cups_sp_item_t *item);
+
+
+/*
+ * '_cupsStrASCIISpan()' - Get the length of the leading run of ASCII
+ *                         characters in a string.
+ *
+ * When "printable" is non-zero the run also stops at control characters and
+ * DEL.  The string is scanned 16 bytes at a time using 64-bit word operations
+ * and no bytes past "len" are read.
+ */
+
+size_t					/* O - Number of ASCII bytes */
+_cupsStrASCIISpan(const char *s,	/* I - String */
+                  size_t     len,	/* I - Length of string */
+                  int        printable)	/* I - Stop at control characters? */
+{
+  const char	*start = s,		/* Start of string */
+		*end = s + len;		/* End of string */
+  uint64_t	a, b,			/* Current words */
+		bad;			/* Non-ASCII/control bytes */
+  static const uint64_t	ones  = 0x0101010101010101ULL,
+			highs = 0x8080808080808080ULL;
+					/* Byte masks */
+
+
+  while ((end - s) >= 16)
+  {
+    memcpy(&a, s, sizeof(a));
+    memcpy(&b, s + 8, sizeof(b));
+
+    bad = a | b;
+
+    if (printable)
+    {
+     /*
+      * Flag bytes < 0x20 and bytes == 0x7f; the subtraction tricks are exact
+      * when no byte has the high bit set, and any such byte is flagged
+      * anyway...
+      */
+
+      bad |= ((a - 0x20 * ones) & ~a) | ((b - 0x20 * ones) & ~b);
+      bad |= (((a ^ (0x7f * ones)) - ones) & ~(a ^ (0x7f * ones))) | (((b ^ (0x7f * ones)) - ones) & ~(b ^ (0x7f * ones)));
+    }
+
+    if (bad & highs)
+      break;
+
+    s += 16;
+  }
+
+  while (s < end && !(*s & 0x80) && (!printable || (*s >= ' ' && *s != 0x7f)))
+    s ++;
+
+  return ((size_t)(s - start));
+}
 
 
 /*
@@ -44,6 +121,7 @@ char *					/* O - String pointer */
 _cupsStrAlloc(const char *s)		/* I - String */
 {
   size_t		slen;		/* Length of string */
+  _cups_sp_shard_t	*shard;		/* String pool shard */
   _cups_sp_item_t	*item,		/* String pool item */
 			*key;		/* Search key */
 
@@ -59,14 +137,16 @@ _cupsStrAlloc(const char *s)		/* I - String */
   * Get the string pool...
   */
 
-  _cupsMutexLock(&sp_mutex);
+  shard = get_sp_shard(s);
+
+  _cupsMutexLock(&shard->mutex);
 
-  if (!stringpool)
-    stringpool = cupsArrayNew((cups_array_func_t)compare_sp_items, NULL);
+  if (!shard->pool)
+    shard->pool = _cupsArrayNewHashUnordered((cups_array_func_t)compare_sp_items, NULL, (cups_ahash_func_t)hash_sp_item, NULL, NULL);
 
-  if (!stringpool)
+  if (!shard->pool)
   {
-    _cupsMutexUnlock(&sp_mutex);
+    _cupsMutexUnlock(&shard->mutex);
 
     return (NULL);
   }
@@ -77,13 +157,14 @@ _cupsStrAlloc(const char *s)		/* I - String */
 
   key = (_cups_sp_item_t *)(s - offsetof(_cups_sp_item_t, str));
 
-  if ((item = (_cups_sp_item_t *)cupsArrayFind(stringpool, key)) != NULL)
+  if ((item = (_cups_sp_item_t *)cupsArrayFind(shard->pool, key)) != NULL)
   {
    /*
     * Found it, return the cached string...
     */
 
     item->ref_count ++;
+    shard->hits ++;
 
 #ifdef DEBUG_GUARDS
     DEBUG_printf(("5_cupsStrAlloc: Using string %p(%s) for \"%s\", guard=%08x, "
@@ -94,7 +175,7 @@ _cupsStrAlloc(const char *s)		/* I - String */
       abort();
 #endif /* DEBUG_GUARDS */
 
-    _cupsMutexUnlock(&sp_mutex);
+    _cupsMutexUnlock(&shard->mutex);
 
     return (item->str);
   }
@@ -107,12 +188,15 @@ _cupsStrAlloc(const char *s)		/* I - String */
   item = (_cups_sp_item_t *)calloc(1, sizeof(_cups_sp_item_t) + slen);
   if (!item)
   {
-    _cupsMutexUnlock(&sp_mutex);
+    _cupsMutexUnlock(&shard->mutex);
 
     return (NULL);
   }
 
+  shard->misses ++;
+
   item->ref_count = 1;
+  item->id        = (int)ippNameValue(s);
   memcpy(item->str, s, slen + 1);
 
 #ifdef DEBUG_GUARDS
@@ -127,14 +211,50 @@ _cupsStrAlloc(const char *s)		/* I - String */
   * Add the string to the pool and return it...
   */
 
-  cupsArrayAdd(stringpool, item);
+  cupsArrayAdd(shard->pool, item);
 
-  _cupsMutexUnlock(&sp_mutex);
+  _cupsMutexUnlock(&shard->mutex);
 
   return (item->str);
 }
 
 
+/*
+ * '_cupsStrCounters()' - Return usage counters for the string pool.
+ */
+
+size_t					/* O - Number of unique strings */
+_cupsStrCounters(size_t *hits,		/* O - Number of reused strings */
+                 size_t *misses)	/* O - Number of new strings */
+{
+  int			i;		/* Looping var */
+  size_t		count,		/* Number of unique strings */
+			h,		/* Hits */
+			m;		/* Misses */
+  _cups_sp_shard_t	*shard;		/* Current shard */
+
+
+  for (i = 0, count = 0, h = 0, m = 0, shard = sp_shards; i < SP_NUM_SHARDS; i ++, shard ++)
+  {
+    _cupsMutexLock(&shard->mutex);
+
+    count += (size_t)cupsArrayCount(shard->pool);
+    h     += shard->hits;
+    m     += shard->misses;
+
+    _cupsMutexUnlock(&shard->mutex);
+  }
+
+  if (hits)
+    *hits = h;
+
+  if (misses)
+    *misses = m;
+
+  return (count);
+}
+
+
 /*
  * '_cupsStrDate()' - Return a localized date for a given time value.
  *
@@ -175,23 +295,28 @@ _cupsStrDate(char   *buf,		/* I - Buffer */
 void
 _cupsStrFlush(void)
 {
+  int			i;		/* Looping var */
+  _cups_sp_shard_t	*shard;		/* Current shard */
   _cups_sp_item_t	*item;		/* Current item */
 
 
-  DEBUG_printf(("4_cupsStrFlush: %d strings in array",
-                cupsArrayCount(stringpool)));
+  for (i = 0, shard = sp_shards; i < SP_NUM_SHARDS; i ++, shard ++)
+  {
+    DEBUG_printf(("4_cupsStrFlush: %d strings in shard %d",
+		  cupsArrayCount(shard->pool), i));
 
-  _cupsMutexLock(&sp_mutex);
+    _cupsMutexLock(&shard->mutex);
 
-  for (item = (_cups_sp_item_t *)cupsArrayFirst(stringpool);
-       item;
-       item = (_cups_sp_item_t *)cupsArrayNext(stringpool))
-    free(item);
+    for (item = (_cups_sp_item_t *)cupsArrayFirst(shard->pool);
+	 item;
+	 item = (_cups_sp_item_t *)cupsArrayNext(shard->pool))
+      free(item);
 
-  cupsArrayDelete(stringpool);
-  stringpool = NULL;
+    cupsArrayDelete(shard->pool);
+    shard->pool = NULL;
 
-  _cupsMutexUnlock(&sp_mutex);
+    _cupsMutexUnlock(&shard->mutex);
+  }
 }
 
 
@@ -282,6 +407,7 @@ _cupsStrFormatd(char         *buf,	/* I - String */
 void
 _cupsStrFree(const char *s)		/* I - String to free */
 {
+  _cups_sp_shard_t	*shard;		/* String pool shard */
   _cups_sp_item_t	*item,		/* String pool item */
 			*key;		/* Search key */
 
@@ -297,22 +423,24 @@ _cupsStrFree(const char *s)		/* I - String to free */
   * Check the string pool...
   *
   * We don't need to lock the mutex yet, as we only want to know if
-  * the stringpool is initialized.  The rest of the code will still
+  * the shard is initialized.  The rest of the code will still
   * work if it is initialized before we lock...
   */
 
-  if (!stringpool)
+  shard = get_sp_shard(s);
+
+  if (!shard->pool)
     return;
 
  /*
   * See if the string is already in the pool...
   */
 
-  _cupsMutexLock(&sp_mutex);
+  _cupsMutexLock(&shard->mutex);
 
   key = (_cups_sp_item_t *)(s - offsetof(_cups_sp_item_t, str));
 
-  if ((item = (_cups_sp_item_t *)cupsArrayFind(stringpool, key)) != NULL &&
+  if ((item = (_cups_sp_item_t *)cupsArrayFind(shard->pool, key)) != NULL &&
       item == key)
   {
    /*
@@ -335,13 +463,66 @@ _cupsStrFree(const char *s)		/* I - String to free */
       * Remove and free...
       */
 
-      cupsArrayRemove(stringpool, item);
+      cupsArrayRemove(shard->pool, item);
 
       free(item);
     }
   }
 
-  _cupsMutexUnlock(&sp_mutex);
+  _cupsMutexUnlock(&shard->mutex);
+}
+
+
+/*
+ * '_cupsStrHash()' - Compute the FNV-1a hash of a string.
+ */
+
+unsigned				/* O - Hash value */
+_cupsStrHash(const char *s)		/* I - String */
+{
+  unsigned	hash;			/* Hash value */
+
+
+  for (hash = 2166136261U; *s; s ++)
+    hash = (hash ^ (unsigned char)*s) * 16777619U;
+
+  return (hash);
+}
+
+
+/*
+ * '_cupsStrId()' - Get the well-known attribute name ID of a pooled string.
+ *
+ * Note: This function does not verify that the passed pointer is in the
+ *       string pool, so any calls to it MUST know they are passing in a
+ *       good pointer.
+ */
+
+int					/* O - Name ID or 0 if not well-known */
+_cupsStrId(const char *s)		/* I - String */
+{
+  _cups_sp_item_t	*item;		/* Pointer to string pool item */
+
+
+  if (!s)
+    return (0);
+
+  item = (_cups_sp_item_t *)(s - offsetof(_cups_sp_item_t, str));
+
+#ifdef DEBUG_GUARDS
+  if (item->guard != _CUPS_STR_GUARD)
+  {
+    DEBUG_printf(("5_cupsStrId: Bad string %p(%s), guard=%08x, ref_count=%d", item, s, item->guard, item->ref_count));
+    abort();
+  }
+#endif /* DEBUG_GUARDS */
+
+ /*
+  * The ID is set once when the string is added to the pool and never
+  * changes, so no lock is needed...
+  */
+
+  return (item->id);
 }
 
 
@@ -356,6 +537,7 @@ _cupsStrFree(const char *s)		/* I - String to free */
 char *					/* O - Pointer to string */
 _cupsStrRetain(const char *s)		/* I - String to retain */
 {
+  _cups_sp_shard_t	*shard;		/* String pool shard */
   _cups_sp_item_t	*item;		/* Pointer to string pool item */
 
 
@@ -372,11 +554,13 @@ _cupsStrRetain(const char *s)		/* I - String to retain */
     }
 #endif /* DEBUG_GUARDS */
 
-    _cupsMutexLock(&sp_mutex);
+    shard = get_sp_shard(s);
+
+    _cupsMutexLock(&shard->mutex);
 
     item->ref_count ++;
 
-    _cupsMutexUnlock(&sp_mutex);
+    _cupsMutexUnlock(&shard->mutex);
   }
 
   return ((char *)s);
@@ -529,10 +713,12 @@ size_t					/* O - Number of strings */
 _cupsStrStatistics(size_t *alloc_bytes,	/* O - Allocated bytes */
                    size_t *total_bytes)	/* O - Total string bytes */
 {
+  int			i;		/* Looping var */
   size_t		count,		/* Number of strings */
 			abytes,		/* Allocated string bytes */
 			tbytes,		/* Total string bytes */
 			len;		/* Length of string */
+  _cups_sp_shard_t	*shard;		/* Current shard */
   _cups_sp_item_t	*item;		/* Current item */
 
 
@@ -540,24 +726,26 @@ _cupsStrStatistics(size_t *alloc_bytes,	/* O - Allocated bytes */
   * Loop through strings in pool, counting everything up...
   */
 
-  _cupsMutexLock(&sp_mutex);
-
-  for (count = 0, abytes = 0, tbytes = 0,
-           item = (_cups_sp_item_t *)cupsArrayFirst(stringpool);
-       item;
-       item = (_cups_sp_item_t *)cupsArrayNext(stringpool))
+  for (i = 0, count = 0, abytes = 0, tbytes = 0, shard = sp_shards; i < SP_NUM_SHARDS; i ++, shard ++)
   {
-   /*
-    * Count allocated memory, using a 64-bit aligned buffer as a basis.
-    */
+    _cupsMutexLock(&shard->mutex);
 
-    count  += item->ref_count;
-    len    = (strlen(item->str) + 8) & (size_t)~7;
-    abytes += sizeof(_cups_sp_item_t) + len;
-    tbytes += item->ref_count * len;
-  }
+    for (item = (_cups_sp_item_t *)cupsArrayFirst(shard->pool);
+	 item;
+	 item = (_cups_sp_item_t *)cupsArrayNext(shard->pool))
+    {
+     /*
+      * Count allocated memory, using a 64-bit aligned buffer as a basis.
+      */
 
-  _cupsMutexUnlock(&sp_mutex);
+      count  += item->ref_count;
+      len    = (strlen(item->str) + 8) & (size_t)~7;
+      abytes += sizeof(_cups_sp_item_t) + len;
+      tbytes += item->ref_count * len;
+    }
+
+    _cupsMutexUnlock(&shard->mutex);
+  }
 
  /*
   * Return values...
@@ -763,3 +951,25 @@ compare_sp_items(_cups_sp_item_t *a,	/* I - First item */
 {
   return (strcmp(a->str, b->str));
 }
+
+
+/*
+ * 'get_sp_shard()' - Get the string pool shard for a string.
+ */
+
+static _cups_sp_shard_t *		/* O - Shard */
+get_sp_shard(const char *s)		/* I - String */
+{
+  return (sp_shards + (_cupsStrHash(s) & (SP_NUM_SHARDS - 1)));
+}
+
+
+/*
+ * 'hash_sp_item()' - Hash a string pool item.
+ */
+
+static int				/* O - Hash value */
+hash_sp_item(_cups_sp_item_t *item)	/* I - Item */
+{
+  return ((int)_cupsStrHash(item->str));
+}
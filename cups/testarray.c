@@ -22,6 +22,7 @@
  */
 
 static double	get_seconds(void);
+static int	hash_word(const char *s, void *data);
 static int	load_words(const char *filename, cups_array_t *array);
 
 
@@ -35,6 +36,10 @@ main(void)
   int		i;			/* Looping var */
   cups_array_t	*array,			/* Test array */
 		*dup_array;		/* Duplicate array */
+  cups_array_iter_t *iter = NULL,	/* Test iterator */
+		*dup_iter = NULL,	/* Second iterator */
+		local_iter;		/* Initialized iterator */
+  char		*iter_text;		/* Text from iterator */
   int		status;			/* Exit status */
   char		*text;			/* Text from array */
   char		word[256];		/* Word from file */
@@ -381,6 +386,82 @@ main(void)
   else
     puts("PASS");
 
+ /*
+  * Test iterators...
+  */
+
+  fputs("cupsArrayIterNew/Next: ", stdout);
+
+  text = (char *)cupsArrayIndex(array, 10);
+
+  if ((iter = cupsArrayIterNew(array)) == NULL || (dup_iter = cupsArrayIterNew(array)) == NULL)
+  {
+    puts("FAIL (returned NULL, expected pointer)");
+    status ++;
+  }
+  else
+  {
+    for (i = 0, iter_text = (char *)cupsArrayIterNext(iter); iter_text; i ++, iter_text = (char *)cupsArrayIterNext(iter))
+    {
+      if (iter_text != cupsArrayIterNext(dup_iter))
+        break;
+    }
+
+    if (iter_text)
+    {
+      printf("FAIL (mismatch at index %d)\n", i);
+      status ++;
+    }
+    else if (i != cupsArrayCount(array) || cupsArrayIterNext(dup_iter) || cupsArrayIterNext(iter))
+    {
+      printf("FAIL (got %d elements, expected %d)\n", i, cupsArrayCount(array));
+      status ++;
+    }
+    else if (cupsArrayCurrent(array) != text)
+    {
+      puts("FAIL (current element changed)");
+      status ++;
+    }
+    else
+      puts("PASS");
+  }
+
+  cupsArrayIterDelete(iter);
+  cupsArrayIterDelete(dup_iter);
+
+  fputs("cupsArrayIterInit: ", stdout);
+
+  cupsArrayIterInit(&local_iter, array);
+
+  for (i = 0, iter_text = (char *)cupsArrayIterNext(&local_iter); iter_text; i ++, iter_text = (char *)cupsArrayIterNext(&local_iter))
+  {
+    if (iter_text != cupsArrayIndex(array, i))
+      break;
+  }
+
+  if (iter_text)
+  {
+    printf("FAIL (mismatch at index %d)\n", i);
+    status ++;
+  }
+  else if (i != cupsArrayCount(array))
+  {
+    printf("FAIL (got %d elements, expected %d)\n", i, cupsArrayCount(array));
+    status ++;
+  }
+  else
+  {
+    cupsArrayIterInit(&local_iter, NULL);
+
+    if (cupsArrayIterNext(&local_iter))
+    {
+      puts("FAIL (got element from NULL array)");
+      status ++;
+    }
+    else
+      puts("PASS");
+  }
+
  /*
   * Delete the arrays...
   */
@@ -470,6 +551,309 @@ main(void)
 
   cupsArrayDelete(array);
 
+ /*
+  * Test hash-indexed arrays...
+  */
+
+  fputs("_cupsArrayNewHash: ", stdout);
+
+  if ((array = _cupsArrayNewHash((cups_array_func_t)strcmp, NULL, (cups_ahash_func_t)hash_word, (cups_acopy_func_t)strdup, (cups_afree_func_t)free)) == NULL)
+  {
+    puts("FAIL (returned NULL, expected pointer)");
+    status ++;
+  }
+  else
+  {
+    puts("PASS");
+
+    fputs("_cupsArrayNewHash cupsArrayAdd/Insert: ", stdout);
+
+    cupsArrayAdd(array, "foo");
+    cupsArrayAdd(array, "bar");
+    cupsArrayAdd(array, "boo");
+    cupsArrayInsert(array, "far");
+
+    if (cupsArrayCount(array) != 4)
+    {
+      printf("FAIL (got %d elements, expected 4)\n", cupsArrayCount(array));
+      status ++;
+    }
+    else if (strcmp(text = (char *)cupsArrayFirst(array), "far") ||
+             strcmp(text = (char *)cupsArrayNext(array), "foo") ||
+             strcmp(text = (char *)cupsArrayNext(array), "bar") ||
+             strcmp(text = (char *)cupsArrayNext(array), "boo"))
+    {
+      printf("FAIL (unexpected element \"%s\")\n", text);
+      status ++;
+    }
+    else
+      puts("PASS");
+
+    fputs("_cupsArrayNewHash cupsArrayFind: ", stdout);
+
+    if ((text = (char *)cupsArrayFind(array, "bar")) == NULL || strcmp(text, "bar"))
+    {
+      puts("FAIL (\"bar\" not found)");
+      status ++;
+    }
+    else if ((text = (char *)cupsArrayNext(array)) == NULL || strcmp(text, "boo"))
+    {
+      puts("FAIL (cupsArrayNext after cupsArrayFind)");
+      status ++;
+    }
+    else if (cupsArrayFind(array, "baz"))
+    {
+      puts("FAIL (\"baz\" found)");
+      status ++;
+    }
+    else
+      puts("PASS");
+
+    fputs("_cupsArrayNewHash Delete While Iterating: ", stdout);
+
+    for (text = (char *)cupsArrayFirst(array); text; text = (char *)cupsArrayNext(array))
+      if (text[0] == 'f')
+        cupsArrayRemove(array, text);
+
+    if (cupsArrayCount(array) != 2 || cupsArrayFind(array, "far") || cupsArrayFind(array, "foo") || !cupsArrayFind(array, "bar") || !cupsArrayFind(array, "boo"))
+    {
+      printf("FAIL (got %d elements, expected 2)\n", cupsArrayCount(array));
+      status ++;
+    }
+    else
+      puts("PASS");
+
+    fputs("_cupsArrayNewHash 10000 elements: ", stdout);
+
+    for (i = 0; i < 10000; i ++)
+    {
+      snprintf(word, sizeof(word), "word%d", i);
+      cupsArrayAdd(array, word);
+    }
+
+    for (i = 0; i < 10000; i += 2)
+    {
+      snprintf(word, sizeof(word), "word%d", i);
+      cupsArrayRemove(array, word);
+    }
+
+    for (i = 0; i < 10000; i ++)
+    {
+      snprintf(word, sizeof(word), "word%d", i);
+      if ((cupsArrayFind(array, word) != NULL) != (i & 1))
+        break;
+    }
+
+    if (i < 10000)
+    {
+      printf("FAIL (\"%s\" %s)\n", word, (i & 1) ? "not found" : "found");
+      status ++;
+    }
+    else if (cupsArrayCount(array) != 5002)
+    {
+      printf("FAIL (got %d elements, expected 5002)\n", cupsArrayCount(array));
+      status ++;
+    }
+    else if (strcmp(text = (char *)cupsArrayIndex(array, 2), "word1"))
+    {
+      printf("FAIL (element 2 is \"%s\", expected \"word1\")\n", text);
+      status ++;
+    }
+    else
+      puts("PASS");
+
+    fputs("_cupsArrayNewHash cupsArrayDup: ", stdout);
+
+    if ((dup_array = cupsArrayDup(array)) == NULL)
+    {
+      puts("FAIL (returned NULL, expected pointer)");
+      status ++;
+    }
+    else
+    {
+      if (cupsArrayCount(dup_array) != cupsArrayCount(array) || !cupsArrayFind(dup_array, "word9999") || cupsArrayFind(dup_array, "word9998"))
+      {
+        puts("FAIL");
+        status ++;
+      }
+      else
+        puts("PASS");
+
+      cupsArrayDelete(dup_array);
+    }
+
+    cupsArrayDelete(array);
+  }
+
+ /*
+  * Test unordered hash-indexed arrays...
+  */
+
+  fputs("_cupsArrayNewHashUnordered: ", stdout);
+
+  if ((array = _cupsArrayNewHashUnordered((cups_array_func_t)strcmp, NULL, (cups_ahash_func_t)hash_word, (cups_acopy_func_t)strdup, (cups_afree_func_t)free)) == NULL)
+  {
+    puts("FAIL (returned NULL, expected pointer)");
+    status ++;
+  }
+  else
+  {
+    puts("PASS");
+
+    fputs("_cupsArrayNewHashUnordered cupsArrayRemove: ", stdout);
+
+    for (i = 0; i < 10000; i ++)
+    {
+      snprintf(word, sizeof(word), "word%d", i);
+      cupsArrayAdd(array, word);
+    }
+
+    for (i = 0; i < 10000; i += 2)
+    {
+      snprintf(word, sizeof(word), "word%d", i);
+      cupsArrayRemove(array, word);
+    }
+
+    for (i = 0; i < 10000; i ++)
+    {
+      snprintf(word, sizeof(word), "word%d", i);
+      if ((cupsArrayFind(array, word) != NULL) != (i & 1))
+        break;
+    }
+
+    if (i < 10000)
+    {
+      printf("FAIL (\"%s\" %s)\n", word, (i & 1) ? "not found" : "found");
+      status ++;
+    }
+    else if (cupsArrayCount(array) != 5000)
+    {
+      printf("FAIL (got %d elements, expected 5000)\n", cupsArrayCount(array));
+      status ++;
+    }
+    else
+      puts("PASS");
+
+    fputs("_cupsArrayNewHashUnordered Delete While Iterating: ", stdout);
+
+    for (i = 0, text = (char *)cupsArrayFirst(array); text; i ++, text = (char *)cupsArrayNext(array))
+      cupsArrayRemove(array, text);
+
+    if (i != 5000 || cupsArrayCount(array) != 0)
+    {
+      printf("FAIL (visited %d elements, %d remaining)\n", i, cupsArrayCount(array));
+      status ++;
+    }
+    else
+      puts("PASS");
+
+    cupsArrayDelete(array);
+  }
+
+ /*
+  * Test bulk loading...
+  */
+
+  fputs("cupsArrayAddUnsorted: ", stdout);
+
+  array = cupsArrayNew3((cups_array_func_t)strcmp, NULL, NULL, 0, (cups_acopy_func_t)strdup, (cups_afree_func_t)free);
+
+  for (i = 9999; i >= 0; i --)
+  {
+    snprintf(word, sizeof(word), "word%05d", i);
+    if (!cupsArrayAddUnsorted(array, word))
+      break;
+  }
+
+  if (i >= 0)
+  {
+    printf("FAIL (unable to add \"%s\")\n", word);
+    status ++;
+  }
+  else if ((text = (char *)cupsArrayFind(array, "word01234")) == NULL || strcmp(text, "word01234"))
+  {
+    puts("FAIL (\"word01234\" not found)");
+    status ++;
+  }
+  else
+    puts("PASS");
+
+  fputs("cupsArraySort: ", stdout);
+
+  cupsArrayAddUnsorted(array, "word00000");
+  cupsArrayAddUnsorted(array, "word10000");
+  cupsArraySort(array);
+
+  for (i = 0, text = (char *)cupsArrayFirst(array); text;)
+  {
+    strlcpy(word, text, sizeof(word));
+
+    if ((text = (char *)cupsArrayNext(array)) != NULL && strcmp(word, text) > 0)
+      break;
+
+    i ++;
+  }
+
+  if (text)
+  {
+    printf("FAIL (\"%s\" > \"%s\")\n", word, text);
+    status ++;
+  }
+  else if (i != 10002)
+  {
+    printf("FAIL (got %d elements, expected 10002)\n", i);
+    status ++;
+  }
+  else if (!cupsArrayRemove(array, "word10000") || cupsArrayFind(array, "word10000"))
+  {
+    puts("FAIL (cupsArrayRemove after sort)");
+    status ++;
+  }
+  else
+    puts("PASS");
+
+  cupsArrayDelete(array);
+
+ /*
+  * Make sure bulk loading doesn't degrade into an insertion sort...
+  */
+
+  fputs("cupsArrayAddUnsorted (100000 elements): ", stdout);
+  fflush(stdout);
+
+  array = cupsArrayNew3((cups_array_func_t)strcmp, NULL, NULL, 0, (cups_acopy_func_t)strdup, (cups_afree_func_t)free);
+  start = get_seconds();
+
+  for (i = 0; i < 100000; i ++)
+  {
+    snprintf(word, sizeof(word), "word%05d", (i * 7919) % 100000);
+    if (!cupsArrayAddUnsorted(array, word))
+      break;
+  }
+
+  text = (char *)cupsArrayFind(array, "word54321");
+  end  = get_seconds();
+
+  if (i < 100000)
+  {
+    printf("FAIL (unable to add \"%s\")\n", word);
+    status ++;
+  }
+  else if (!text || cupsArrayCount(array) != 100000)
+  {
+    printf("FAIL (got %d elements, \"word54321\" %s)\n", cupsArrayCount(array), text ? "found" : "not found");
+    status ++;
+  }
+  else if ((end - start) > 2.0)
+  {
+    printf("FAIL (took %.3f seconds)\n", end - start);
+    status ++;
+  }
+  else
+    printf("PASS (%.3f seconds)\n", end - start);
+
+  cupsArrayDelete(array);
+
  /*
   * Summarize the results and return...
   */
@@ -511,6 +895,20 @@ get_seconds(void)
 #endif /* _WIN32 */
 
 
+/*
+ * 'hash_word()' - Compute a FNV-1a hash of a word.
+ */
+
+static int				/* O - Hash value */
+hash_word(const char *s,		/* I - Word */
+          void       *data)		/* I - User data (unused) */
+{
+  (void)data;
+
+  return ((int)_cupsStrHash(s));
+}
+
+
 /*
  * 'load_words()' - Load words from a file.
  */
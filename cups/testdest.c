@@ -64,11 +64,18 @@ main(int  argc,				/* I - Number of command-line arguments */
   {
     cups_ptype_t	type = 0,	/* Printer type filter */
 			mask = 0;	/* Printer type mask */
+    int			count = 0;	/* Number of destinations to enumerate */
 
 
     for (i = 2; i < argc; i ++)
     {
-      if (!strcmp(argv[i], "grayscale"))
+      if (!strcmp(argv[i], "--count"))
+      {
+        i ++;
+        if (i >= argc || (count = atoi(argv[i])) < 1)
+          usage("--count");
+      }
+      else if (!strcmp(argv[i], "grayscale"))
       {
         type |= CUPS_PRINTER_BW;
 	mask |= CUPS_PRINTER_BW;
@@ -107,7 +114,7 @@ main(int  argc,				/* I - Number of command-line arguments */
         usage(argv[i]);
     }
 
-    cupsEnumDests(CUPS_DEST_FLAGS_NONE, 5000, NULL, type, mask, enum_cb, NULL);
+    cupsEnumDests(CUPS_DEST_FLAGS_NONE, 5000, NULL, type, mask, enum_cb, count ? &count : NULL);
 
     return (0);
   }
@@ -236,16 +243,14 @@ main(int  argc,				/* I - Number of command-line arguments */
  */
 
 static int				/* O - 1 to continue */
-enum_cb(void        *user_data,		/* I - User data (unused) */
+enum_cb(void        *user_data,		/* I - Remaining count, if any */
         unsigned    flags,		/* I - Flags */
 	cups_dest_t *dest)		/* I - Destination */
 {
   int	i;				/* Looping var */
+  int	*count = (int *)user_data;	/* Remaining count */
 
 
-  (void)user_data;
-  (void)flags;
-
   if (dest->instance)
     printf("%s%s/%s%s:\n", (flags & CUPS_DEST_FLAGS_REMOVED) ? "REMOVE " : "", dest->name, dest->instance, dest->is_default ? " (Default)" : "");
   else
@@ -256,6 +261,13 @@ enum_cb(void        *user_data,		/* I - User data (unused) */
 
   puts("");
 
+ /*
+  * Stop once we have enumerated the requested number of destinations...
+  */
+
+  if (count && !(flags & CUPS_DEST_FLAGS_REMOVED) && -- *count <= 0)
+    return (0);
+
   return (1);
 }
 
@@ -767,8 +779,8 @@ usage(const char *arg)			/* I - Argument for usage message */
   puts("  ./testdest [--device] ipp://... [operation ...]");
   puts("  ./testdest [--device] ipps://... [operation ...]");
   puts("  ./testdest --get");
-  puts("  ./testdest --enum [grayscale] [color] [duplex] [staple] [small]\n"
-       "                    [medium] [large]");
+  puts("  ./testdest --enum [--count N] [grayscale] [color] [duplex] [staple]\n"
+       "                    [small] [medium] [large]");
   puts("");
   puts("Operations:");
   puts("  conflicts options");
@@ -161,6 +161,63 @@ main(int  argc,				/* I - Number of command-line arguments */
       cupsFileClose(fp);
     }
 
+   /*
+    * Read a file, append to it, and then read the new data...
+    */
+
+    fputs("\ncupsFileRead(appended file): ", stdout);
+
+    if ((fp = cupsFileOpen("testfile.tmp", "w")) != NULL)
+    {
+      memset(filename, 'a', sizeof(filename));
+      for (count = 0; count < 16; count ++)
+        cupsFileWrite(fp, filename, sizeof(filename));
+      cupsFileClose(fp);
+    }
+
+    if ((fp = cupsFileOpen("testfile.tmp", "r")) == NULL)
+    {
+      puts("FAIL (open)");
+      status ++;
+    }
+    else
+    {
+      cups_file_t	*appfp;		/* File opened for appending */
+      ssize_t		bytes,		/* Bytes read */
+			total = 0;	/* Total bytes read */
+
+      while ((bytes = cupsFileRead(fp, filename, sizeof(filename))) > 0)
+        total += bytes;
+
+      if ((appfp = cupsFileOpen("testfile.tmp", "a")) != NULL)
+      {
+        cupsFilePuts(appfp, "appended\n");
+        cupsFileClose(appfp);
+      }
+
+      if (total != 16 * (ssize_t)sizeof(filename))
+      {
+        printf("FAIL (got %d bytes, expected %d)\n", (int)total, 16 * (int)sizeof(filename));
+        status ++;
+      }
+      else if (!cupsFileGets(fp, filename, sizeof(filename)) || strcmp(filename, "appended"))
+      {
+        puts("FAIL (appended line not read)");
+        status ++;
+      }
+      else if (cupsFileSeek(fp, 1000) != 1000 || cupsFileGetChar(fp) != 'a' || cupsFileTell(fp) != 1001)
+      {
+        puts("FAIL (seek after append)");
+        status ++;
+      }
+      else
+        puts("PASS");
+
+      cupsFileClose(fp);
+    }
+
+    unlink("testfile.tmp");
+
    /*
     * Test path functions...
     */
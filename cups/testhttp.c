@@ -13,6 +13,15 @@
  */
 
 #include "cups-private.h"
+#include "thread-private.h"
+
+
+/*
+ * Local constants...
+ */
+
+#define ASYNC_CONNS	8		/* Connections for cupsAsync tests */
+#define ASYNC_REQUESTS	6		/* Requests per connection for cupsAsync tests */
 
 
 /*
@@ -206,6 +215,23 @@ static const char * const base64_tests[][2] =
 			  { "ABCDEF", "QUJDREVG" },
 			  /* 010000 010100 001001 000011 010001 000100 010101 000110 */
 			};
+static int		async_done = 0,	/* Completed requests */
+			async_errors = 0,
+					/* Failed requests */
+			async_next[ASYNC_CONNS];
+					/* Next expected request on each connection */
+static int		async_ids[ASYNC_CONNS * ASYNC_REQUESTS];
+					/* Request numbers */
+
+
+/*
+ * Local functions...
+ */
+
+static void	async_cb(cups_async_t *async, http_t *http, ipp_t *response, int *id);
+static int	async_queue(cups_async_t *async, http_t *http, int id);
+static void	*async_server(int *fd);
+static void	*async_service(http_t *http);
 
 
 /*
@@ -234,7 +260,9 @@ main(int  argc,				/* I - Number of command-line arguments */
   int		port;			/* Port number from URI */
   http_uri_status_t uri_status;		/* Status of URI separation */
   http_addrlist_t *addrlist,		/* Address list */
-		*addr;			/* Current address */
+		*cached,		/* Cached address list */
+		*addr,			/* Current address */
+		*temp;			/* Current cached address */
   off_t		length, total;		/* Length and total bytes */
   time_t	start, current;		/* Start and end time */
   const char	*encoding;		/* Negotiated Content-Encoding */
@@ -420,6 +448,36 @@ main(int  argc,				/* I - Number of command-line arguments */
       puts("FAIL");
     }
 
+   /*
+    * httpAddrGetList() using the lookup cache...
+    */
+
+    printf("httpAddrGetList(%s) cached: ", hostname);
+
+    addrlist = httpAddrGetList(hostname, AF_UNSPEC, "631");
+    cached   = httpAddrGetList(hostname, AF_UNSPEC, "631");
+
+    for (i = 0, addr = addrlist, temp = cached; addr && temp; i ++, addr = addr->next, temp = temp->next)
+    {
+      if (!httpAddrEqual(&(addr->addr), &(temp->addr)) || httpAddrPort(&(addr->addr)) != httpAddrPort(&(temp->addr)))
+        break;
+    }
+
+    if (!addrlist && isdigit(hostname[0] & 255))
+    {
+      puts("FAIL (ignored because hostname is numeric)");
+    }
+    else if (!addrlist || addr || temp)
+    {
+      failures ++;
+      puts("FAIL");
+    }
+    else
+      printf("PASS (%d address(es) for %s)\n", i, hostname);
+
+    httpAddrFreeList(addrlist);
+    httpAddrFreeList(cached);
+
    /*
     * Test httpSeparateURI()...
     */
@@ -480,6 +538,44 @@ main(int  argc,				/* I - Number of command-line arguments */
       printf("PASS (%d URIs tested)\n",
              (int)(sizeof(uri_tests) / sizeof(uri_tests[0])));
 
+   /*
+    * Test _httpSeparateResource()...
+    */
+
+    fputs("_httpSeparateResource(): ", stdout);
+    for (i = 0, j = 0; i < (int)(sizeof(uri_tests) / sizeof(uri_tests[0])); i ++)
+    {
+      char		fast[1024];	/* Resource from _httpSeparateResource */
+      http_uri_status_t	fast_status;	/* Status from _httpSeparateResource */
+
+      uri_status  = httpSeparateURI(HTTP_URI_CODING_ALL,
+				    uri_tests[i].uri, scheme, sizeof(scheme),
+				    username, sizeof(username),
+				    hostname, sizeof(hostname), &port,
+				    resource, sizeof(resource));
+      fast_status = _httpSeparateResource(uri_tests[i].uri, fast, sizeof(fast));
+
+      if ((uri_status >= HTTP_URI_STATUS_OK) != (fast_status >= HTTP_URI_STATUS_OK) ||
+          (uri_status >= HTTP_URI_STATUS_OK && strcmp(resource, fast)))
+      {
+        failures ++;
+
+	if (!j)
+	{
+	  puts("FAIL");
+	  j = 1;
+	}
+
+        printf("    \"%s\": Returned %s and \"%s\" instead of %s and \"%s\"\n",
+               uri_tests[i].uri, uri_status_strings[fast_status + 8], fast,
+	       uri_status_strings[uri_status + 8], resource);
+      }
+    }
+
+    if (!j)
+      printf("PASS (%d URIs tested)\n",
+             (int)(sizeof(uri_tests) / sizeof(uri_tests[0])));
+
    /*
     * Test httpAssembleURI()...
     */
@@ -547,6 +643,158 @@ main(int  argc,				/* I - Number of command-line arguments */
     else
       printf("PASS (%s)\n", buffer);
 
+   /*
+    * httpFieldValue
+    */
+
+    fputs("httpFieldValue: ", stdout);
+    {
+      static const char * const fields[] =
+      {					/* Field names, in enum order */
+	"accept-language",
+	"Accept-Ranges",
+	"AUTHORIZATION",
+	"Connection",
+	"Content-Encoding",
+	"Content-Language",
+	"Content-Length",
+	"Content-Location",
+	"Content-MD5",
+	"Content-Range",
+	"Content-Type",
+	"Content-Version",
+	"Date",
+	"Host",
+	"If-Modified-Since",
+	"If-Unmodified-Since",
+	"Keep-Alive",
+	"Last-Modified",
+	"Link",
+	"Location",
+	"Range",
+	"Referer",
+	"Retry-After",
+	"Transfer-Encoding",
+	"Upgrade",
+	"User-Agent",
+	"WWW-Authenticate",
+	"Accept-Encoding",
+	"Allow",
+	"Server",
+	"Authentication-Info",
+	"ETag",
+	"If-None-Match",
+	"Cache-Control"
+      };
+      static const char * const unknowns[] =
+      {					/* Unknown field names */
+	"",
+	"Cookie",
+	"Content",
+	"Hosts",
+	"X-Host"
+      };
+
+      for (i = 0; i < (int)(sizeof(fields) / sizeof(fields[0])); i ++)
+	if (httpFieldValue(fields[i]) != (http_field_t)i)
+	  break;
+
+      for (j = 0; j < (int)(sizeof(unknowns) / sizeof(unknowns[0])); j ++)
+	if (httpFieldValue(unknowns[j]) != HTTP_FIELD_UNKNOWN)
+	  break;
+
+      if (i < (int)(sizeof(fields) / sizeof(fields[0])))
+      {
+	printf("FAIL (%s)\n", fields[i]);
+	failures ++;
+      }
+      else if (j < (int)(sizeof(unknowns) / sizeof(unknowns[0])))
+      {
+	printf("FAIL (\"%s\" matched)\n", unknowns[j]);
+	failures ++;
+      }
+      else
+	puts("PASS");
+    }
+
+   /*
+    * cupsAsyncDoRequest/cupsAsyncProcess
+    */
+
+    fputs("cupsAsyncProcess: ", stdout);
+    {
+      int		fd;		/* Listening socket */
+      http_addr_t	sockaddr;	/* Bound address */
+      socklen_t		addrlen = sizeof(sockaddr);
+					/* Length of address */
+      http_t		*conns[ASYNC_CONNS];
+					/* Client connections */
+      cups_async_t	*async;		/* Asynchronous request context */
+      int		pending = 0;	/* Pending requests */
+
+      memset(conns, 0, sizeof(conns));
+
+      addrlist = httpAddrGetList("127.0.0.1", AF_INET, "0");
+
+      if (!addrlist || (fd = httpAddrListen(&addrlist->addr, 0)) < 0 || getsockname(fd, (struct sockaddr *)&sockaddr, &addrlen))
+      {
+        printf("FAIL (unable to listen: %s)\n", strerror(errno));
+        failures ++;
+      }
+      else
+      {
+        _cupsThreadDetach(_cupsThreadCreate((_cups_thread_func_t)async_server, &fd));
+
+        async = cupsAsyncNew();
+        start = time(NULL);
+
+        for (i = 0; i < ASYNC_CONNS; i ++)
+        {
+          if ((conns[i] = httpConnect2("127.0.0.1", httpAddrPort(&sockaddr), NULL, AF_INET, HTTP_ENCRYPTION_NEVER, 1, 30000, NULL)) == NULL)
+            break;
+
+          httpSetTimeout(conns[i], 10.0, NULL, NULL);
+
+         /*
+          * Queue the first two requests, the callback queues the rest...
+          */
+
+          async_queue(async, conns[i], i * ASYNC_REQUESTS);
+          async_queue(async, conns[i], i * ASYNC_REQUESTS + 1);
+        }
+
+        if (i < ASYNC_CONNS)
+        {
+          printf("FAIL (unable to connect: %s)\n", cupsLastErrorString());
+          failures ++;
+        }
+        else
+        {
+          while ((pending = cupsAsyncProcess(async, 1000)) > 0 && (time(NULL) - start) < 30);
+
+          if (pending)
+          {
+            printf("FAIL (%d requests still pending)\n", pending);
+            failures ++;
+          }
+          else if (async_done != (ASYNC_CONNS * ASYNC_REQUESTS) || async_errors)
+          {
+            printf("FAIL (%d of %d requests completed, %d errors)\n", async_done, ASYNC_CONNS * ASYNC_REQUESTS, async_errors);
+            failures ++;
+          }
+          else
+            printf("PASS (%d requests on %d connections)\n", async_done, ASYNC_CONNS);
+        }
+
+        cupsAsyncDelete(async);
+
+        for (i = 0; i < ASYNC_CONNS; i ++)
+          httpClose(conns[i]);
+      }
+
+      httpAddrFreeList(addrlist);
+    }
+
    /*
     * Show a summary and return...
     */
@@ -943,3 +1191,124 @@ main(int  argc,				/* I - Number of command-line arguments */
 
   return (0);
 }
+
+
+/*
+ * 'async_cb()' - Check the response to an asynchronous request.
+ */
+
+static void
+async_cb(cups_async_t *async,		/* I - Asynchronous request context */
+         http_t       *http,		/* I - HTTP connection */
+         ipp_t        *response,	/* I - IPP response */
+         int          *id)		/* I - Request number */
+{
+  int	conn = *id / ASYNC_REQUESTS,	/* Connection number */
+	num = *id % ASYNC_REQUESTS;	/* Request number on connection */
+
+
+  async_done ++;
+
+  if (!response || ippGetStatusCode(response) != IPP_STATUS_OK || ippGetRequestId(response) != (*id + 1) || num != async_next[conn])
+    async_errors ++;
+
+  async_next[conn] = num + 1;
+
+  if ((num + 2) < ASYNC_REQUESTS && !async_queue(async, http, *id + 2))
+    async_errors ++;
+
+  ippDelete(response);
+}
+
+
+/*
+ * 'async_queue()' - Queue an asynchronous Get-Printer-Attributes request.
+ */
+
+static int				/* O - 1 on success, 0 on error */
+async_queue(cups_async_t *async,	/* I - Asynchronous request context */
+            http_t       *http,		/* I - HTTP connection */
+            int          id)		/* I - Request number */
+{
+  ipp_t	*request;			/* IPP request */
+
+
+  async_ids[id] = id;
+
+  request = ippNewRequest(IPP_OP_GET_PRINTER_ATTRIBUTES);
+  ippSetRequestId(request, id + 1);
+  ippAddString(request, IPP_TAG_OPERATION, IPP_TAG_URI, "printer-uri", NULL, "ipp://localhost/ipp/print");
+
+  return (cupsAsyncDoRequest(async, http, request, "/ipp/print", (cups_async_cb_t)async_cb, async_ids + id));
+}
+
+
+/*
+ * 'async_server()' - Accept connections for the asynchronous request tests.
+ */
+
+static void *				/* O - Thread exit status */
+async_server(int *fd)			/* I - Listening socket */
+{
+  int		i;			/* Looping var */
+  http_t	*http;			/* Client connection */
+
+
+  for (i = 0; i < ASYNC_CONNS; i ++)
+  {
+    if ((http = httpAcceptConnection(*fd, 1)) == NULL)
+      break;
+
+    _cupsThreadDetach(_cupsThreadCreate((_cups_thread_func_t)async_service, http));
+  }
+
+  httpAddrClose(NULL, *fd);
+
+  return (NULL);
+}
+
+
+/*
+ * 'async_service()' - Answer IPP requests on a connection.
+ */
+
+static void *				/* O - Thread exit status */
+async_service(http_t *http)		/* I - Client connection */
+{
+  char		uri[1024];		/* Request URI */
+  ipp_t		*request,		/* IPP request */
+		*response;		/* IPP response */
+  ipp_state_t	state;			/* IPP read state */
+
+
+  while (httpReadRequest(http, uri, sizeof(uri)) == HTTP_STATE_POST)
+  {
+    while (httpUpdate(http) == HTTP_STATUS_CONTINUE);
+
+    request = ippNew();
+
+    while ((state = ippRead(http, request)) != IPP_STATE_DATA && state != IPP_STATE_ERROR);
+
+    response = ippNewResponse(request);
+    ippAddInteger(response, IPP_TAG_PRINTER, IPP_TAG_ENUM, "printer-state", IPP_PSTATE_IDLE);
+
+    httpClearFields(http);
+    httpSetField(http, HTTP_FIELD_CONTENT_TYPE, "application/ipp");
+    httpSetLength(http, ippLength(response));
+
+    if (state != IPP_STATE_ERROR && !httpWriteResponse(http, HTTP_STATUS_OK))
+      while ((state = ippWrite(http, response)) != IPP_STATE_DATA && state != IPP_STATE_ERROR);
+    else
+      state = IPP_STATE_ERROR;
+
+    ippDelete(request);
+    ippDelete(response);
+
+    if (state == IPP_STATE_ERROR)
+      break;
+  }
+
+  httpClose(http);
+
+  return (NULL);
+}
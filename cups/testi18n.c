@@ -115,6 +115,9 @@ main(int  argc,				/* I - Argument Count */
 		errors;			/* Error count */
   char		line[1024];		/* File line source string */
   int		len;			/* Length (count) of string */
+  int		msgnum;			/* Message number */
+  const char	*unknown = "unknown message";
+					/* Message not in catalog */
   char		legsrc[1024],		/* Legacy source string */
 		legdest[1024],		/* Legacy destination string */
 		*legptr;		/* Pointer into legacy string */
@@ -135,6 +138,9 @@ main(int  argc,				/* I - Argument Count */
     /* "A != <CJK U+4E42>." - use Windows 950 (Big5) or EUC-TW */
   cups_utf8_t	utf8dest[1024];		/* UTF-8 destination string */
   cups_utf32_t	utf32dest[1024];	/* UTF-32 destination string */
+  cups_array_t	*messages,		/* Message array */
+		*catalog,		/* Compiled message catalog */
+		*catalog2;		/* Second load of catalog */
 
 
   if (argc > 1)
@@ -526,6 +532,148 @@ main(int  argc,				/* I - Argument Count */
   else
     puts("PASS");
 
+ /*
+  * Test ASCII runs...
+  */
+
+  fputs("_cupsStrASCIISpan: ", stdout);
+
+  for (msgnum = 0, status = 0; msgnum < 40 && !status; msgnum ++)
+  {
+    static const char bytes[] = "\001\t\177\200\303";
+					/* Bytes that end a run */
+    const char	*byte;			/* Current byte */
+
+    for (byte = bytes; *byte && !status; byte ++)
+    {
+      memset(legsrc, 'a', 40);
+      legsrc[40]     = '\0';
+      legsrc[msgnum] = *byte;
+
+      if (_cupsStrASCIISpan(legsrc, 40, 1) != (size_t)msgnum)
+      {
+        printf("FAIL (printable run with 0x%02X at %d is %d bytes)\n", *byte & 255, msgnum, (int)_cupsStrASCIISpan(legsrc, 40, 1));
+        status = 1;
+      }
+      else if (_cupsStrASCIISpan(legsrc, 40, 0) != ((*byte & 0x80) ? (size_t)msgnum : 40))
+      {
+        printf("FAIL (ASCII run with 0x%02X at %d is %d bytes)\n", *byte & 255, msgnum, (int)_cupsStrASCIISpan(legsrc, 40, 0));
+        status = 1;
+      }
+    }
+  }
+
+  if (status)
+    errors ++;
+  else
+    puts("PASS");
+
+  fputs("cupsUTF8ToCharset(CUPS_ISO8859_1) of long string: ", stdout);
+
+  memset(utf8dest, 'a', 40);
+  utf8dest[40] = 0xc3;
+  utf8dest[41] = 0x84;
+  memset(utf8dest + 42, 'b', 40);
+  utf8dest[82] = 0;
+
+  if ((len = cupsUTF8ToCharset(legdest, utf8dest, 1024, CUPS_ISO8859_1)) != 81 || (legdest[40] & 255) != 0xc4 || legdest[0] != 'a' || legdest[80] != 'b')
+  {
+    printf("FAIL (len=%d)\n", len);
+    errors ++;
+  }
+  else if ((len = cupsCharsetToUTF8(utf8dest + 100, legdest, 900, CUPS_ISO8859_1)) != 82 || memcmp(utf8dest, utf8dest + 100, 83))
+  {
+    printf("FAIL (round trip len=%d)\n", len);
+    errors ++;
+  }
+  else
+    puts("PASS");
+
+ /*
+  * Test compiled message catalogs...
+  */
+
+  fputs("_cupsMessageSave(_CUPS_MESSAGE_COMPILED): ", stdout);
+
+  if ((messages = _cupsMessageNew(NULL)) == NULL)
+  {
+    puts("FAIL (unable to create message array)");
+    return (1);
+  }
+
+  for (msgnum = 0; msgnum < 1000; msgnum ++)
+  {
+    _cups_message_t	*m;		/* New message */
+
+    snprintf(legsrc, sizeof(legsrc), "message %d", msgnum);
+    snprintf(legdest, sizeof(legdest), "localized text %d", msgnum);
+
+    if ((m = (_cups_message_t *)calloc(1, sizeof(_cups_message_t))) == NULL)
+      break;
+
+    m->msg = strdup(legsrc);
+    m->str = strdup(legdest);
+
+    cupsArrayAdd(messages, m);
+  }
+
+  if (_cupsMessageSave("testi18n.cat", _CUPS_MESSAGE_COMPILED, messages))
+  {
+    printf("FAIL (%s)\n", strerror(errno));
+    errors ++;
+  }
+  else
+    puts("PASS");
+
+  fputs("_cupsMessageLoad(compiled): ", stdout);
+
+  catalog  = _cupsMessageLoad("testi18n.cat", _CUPS_MESSAGE_PO);
+  catalog2 = _cupsMessageLoad("testi18n.cat", _CUPS_MESSAGE_PO);
+
+  if (!catalog || !cupsArrayUserData(catalog))
+  {
+    puts("FAIL (not loaded as a compiled catalog)");
+    errors ++;
+  }
+  else if (!catalog2 || cupsArrayUserData(catalog2) != cupsArrayUserData(catalog))
+  {
+    puts("FAIL (compiled catalog not shared)");
+    errors ++;
+  }
+  else
+    puts("PASS");
+
+  fputs("_cupsMessageLookup(compiled): ", stdout);
+
+  for (msgnum = 0, status = 0; msgnum < 1000 && catalog; msgnum ++)
+  {
+    snprintf(legsrc, sizeof(legsrc), "message %d", msgnum);
+    snprintf(legdest, sizeof(legdest), "localized text %d", msgnum);
+
+    if (strcmp(_cupsMessageLookup(catalog, legsrc), legdest))
+    {
+      printf("FAIL (got \"%s\" for \"%s\")\n", _cupsMessageLookup(catalog, legsrc), legsrc);
+      status = 1;
+      break;
+    }
+  }
+
+  if (!status && catalog && _cupsMessageLookup(catalog, unknown) != unknown)
+  {
+    puts("FAIL (unknown message not returned)");
+    status = 1;
+  }
+
+  if (status || !catalog)
+    errors ++;
+  else
+    puts("PASS");
+
+  _cupsMessageFree(catalog);
+  _cupsMessageFree(catalog2);
+  _cupsMessageFree(messages);
+  unlink("testi18n.cat");
+
 #if 0
  /*
   * Test UTF-8 (16-bit) to UTF-32 (w/ BOM)...
@@ -15,6 +15,7 @@
 #include "file.h"
 #include "string-private.h"
 #include "ipp-private.h"
+#include "array-private.h"
 #ifdef _WIN32
 #  include <io.h>
 #else
@@ -304,6 +305,9 @@ main(int  argc,			/* I - Number of command-line arguments */
 {
   _ippdata_t	data;		/* IPP buffer */
   ipp_uchar_t	buffer[8192];	/* Write buffer data */
+  ipp_uchar_t	*wbuffer;	/* Growable write buffer */
+  size_t	wbufsize;	/* Size of growable write buffer */
+  ssize_t	wbytes;		/* Bytes written to growable buffer */
   ipp_t		*cols[2],	/* Collections */
 		*size;		/* media-size collection */
   ipp_t		*request;	/* Request */
@@ -314,6 +318,7 @@ main(int  argc,			/* I - Number of command-line arguments */
   size_t	length;		/* Length of data */
   cups_file_t	*fp;		/* File pointer */
   size_t	i;		/* Looping var */
+  char		attrname[256];	/* Attribute name */
   int		status;		/* Status of tests (0 = success, 1 = fail) */
 #ifdef DEBUG
   const char	*name;		/* Option name */
@@ -422,6 +427,38 @@ main(int  argc,			/* I - Number of command-line arguments */
     else
       puts("PASS");
 
+   /*
+    * Write test #2...
+    */
+
+    printf("ippWriteBuffer: ");
+
+    wbuffer = NULL;
+    wbufsize = 0;
+
+    if ((wbytes = ippWriteBuffer(request, &wbuffer, &wbufsize)) < 0)
+    {
+      puts("FAIL - unable to write buffer.");
+      status = 1;
+    }
+    else if ((size_t)wbytes != sizeof(collection) || wbufsize < (size_t)wbytes)
+    {
+      printf("FAIL - wrote %d bytes, expected %d bytes!\n", (int)wbytes,
+             (int)sizeof(collection));
+      status = 1;
+    }
+    else if (memcmp(wbuffer, collection, (size_t)wbytes))
+    {
+      puts("FAIL - output does not match baseline!");
+      hex_dump("Bytes Written", wbuffer, (size_t)wbytes);
+      hex_dump("Baseline", collection, sizeof(collection));
+      status = 1;
+    }
+    else
+      puts("PASS");
+
+    free(wbuffer);
+
     ippDelete(request);
 
    /*
@@ -748,6 +785,600 @@ main(int  argc,			/* I - Number of command-line arguments */
 
     ippDelete(request);
 
+   /*
+    * Test indexed lookups in a large message...
+    */
+
+    fputs("ippFindAttribute(indexed): ", stdout);
+
+    request = ippNew();
+    for (i = 0; i < 64; i ++)
+    {
+      snprintf(attrname, sizeof(attrname), "attr-%d", (int)i);
+      ippAddInteger(request, IPP_TAG_PRINTER, IPP_TAG_INTEGER, attrname, (int)i);
+    }
+    ippAddString(request, IPP_TAG_PRINTER, IPP_TAG_KEYWORD, "attr-32", NULL, "keyword");
+
+    for (i = 0; i < 3; i ++)
+    {
+      if ((attr = ippFindAttribute(request, "ATTR-32", IPP_TAG_KEYWORD)) == NULL || strcmp(ippGetString(attr, 0, NULL), "keyword"))
+        break;
+      if ((attr = ippFindAttribute(request, "attr-32", IPP_TAG_ZERO)) == NULL || ippGetInteger(attr, 0) != 32)
+        break;
+      if ((attr = ippFindNextAttribute(request, "attr-32", IPP_TAG_ZERO)) == NULL || ippGetValueTag(attr) != IPP_TAG_KEYWORD)
+        break;
+      if (ippFindAttribute(request, "attr-64", IPP_TAG_ZERO))
+        break;
+    }
+
+    if (i < 3)
+    {
+      printf("FAIL (pass %d)\n", (int)i + 1);
+      status = 1;
+    }
+    else
+    {
+      ippDeleteAttribute(request, ippFindAttribute(request, "attr-32", IPP_TAG_INTEGER));
+      attr = ippFindAttribute(request, "attr-1", IPP_TAG_INTEGER);
+      ippSetName(request, &attr, "attr-64");
+
+      if ((attr = ippFindAttribute(request, "attr-32", IPP_TAG_ZERO)) == NULL || ippGetValueTag(attr) != IPP_TAG_KEYWORD)
+      {
+        puts("FAIL (after delete)");
+        status = 1;
+      }
+      else if ((attr = ippFindAttribute(request, "attr-64", IPP_TAG_INTEGER)) == NULL || ippGetInteger(attr, 0) != 1 || ippFindAttribute(request, "attr-1", IPP_TAG_ZERO))
+      {
+        puts("FAIL (after rename)");
+        status = 1;
+      }
+      else
+        puts("PASS");
+    }
+
+    ippDelete(request);
+
+   /*
+    * Test arena messages...
+    */
+
+    fputs("_ippNewArena: ", stdout);
+
+    request = _ippNewArena();
+    for (i = 0; i < 1000; i ++)
+    {
+      snprintf(attrname, sizeof(attrname), "attr-%d", (int)i);
+      ippAddInteger(request, IPP_TAG_PRINTER, IPP_TAG_INTEGER, attrname, (int)i);
+    }
+
+    attr = ippAddString(request, IPP_TAG_PRINTER, IPP_TAG_KEYWORD, "grow", NULL, "0");
+    for (i = 1; i < 100; i ++)
+    {
+      snprintf(attrname, sizeof(attrname), "%d", (int)i);
+      ippSetString(request, &attr, (int)i, attrname);
+    }
+
+    attr = ippFindAttribute(request, "attr-500", IPP_TAG_INTEGER);
+    ippDeleteAttribute(request, attr);
+
+    if ((attr = ippFindAttribute(request, "grow", IPP_TAG_KEYWORD)) == NULL || ippGetCount(attr) != 100 || strcmp(ippGetString(attr, 99, NULL), "99") || strcmp(ippGetString(attr, 0, NULL), "0"))
+    {
+      puts("FAIL (grow)");
+      status = 1;
+    }
+    else if ((attr = ippFindAttribute(request, "attr-999", IPP_TAG_INTEGER)) == NULL || ippGetInteger(attr, 0) != 999 || ippFindAttribute(request, "attr-500", IPP_TAG_ZERO))
+    {
+      puts("FAIL (find)");
+      status = 1;
+    }
+    else
+    {
+      ipp_t *response = ippNewResponse(request);
+					/* Response */
+
+      if (!response->use_arena)
+      {
+        puts("FAIL (response not using arena)");
+        status = 1;
+      }
+      else
+        puts("PASS");
+
+      ippDelete(response);
+    }
+
+    ippDelete(request);
+
+   /*
+    * Test memory accounting...
+    */
+
+    fputs("_ippMemoryUsed: ", stdout);
+
+    {
+      size_t	empty,			/* Bytes for empty message */
+		ints,			/* Bytes with integer values */
+		octets,			/* Bytes with octetString value */
+		colbytes;		/* Bytes for collection */
+      ipp_t	*col;			/* Collection value */
+
+      request = ippNew();
+      empty   = _ippMemoryUsed(request);
+
+      ippAddIntegers(request, IPP_TAG_PRINTER, IPP_TAG_INTEGER, "ints", 100, NULL);
+      ints = _ippMemoryUsed(request);
+
+      ippAddOctetString(request, IPP_TAG_PRINTER, "octets", "0123456789012345678901234567890123456789", 40);
+      octets = _ippMemoryUsed(request);
+
+      col = ippNew();
+      ippAddInteger(col, IPP_TAG_ZERO, IPP_TAG_INTEGER, "member", 1);
+      colbytes = _ippMemoryUsed(col);
+      ippAddCollection(request, IPP_TAG_PRINTER, "col", col);
+      ippDelete(col);
+
+      if (empty != sizeof(ipp_t) || ints < (empty + 100 * sizeof(int)) || octets < (ints + 40))
+      {
+        printf("FAIL (empty=%u, ints=%u, octets=%u)\n", (unsigned)empty, (unsigned)ints, (unsigned)octets);
+        status = 1;
+      }
+      else if (_ippMemoryUsed(request) < (octets + colbytes))
+      {
+        puts("FAIL (collection)");
+        status = 1;
+      }
+      else
+      {
+        ippDelete(request);
+
+        request = _ippNewArena();
+        ippAddInteger(request, IPP_TAG_PRINTER, IPP_TAG_INTEGER, "int", 1);
+
+        if (_ippMemoryUsed(request) < IPP_ARENA_SIZE)
+        {
+          puts("FAIL (arena)");
+          status = 1;
+        }
+        else
+          puts("PASS");
+      }
+
+      ippDelete(request);
+    }
+
+   /*
+    * Test exact value allocation...
+    */
+
+    fputs("ippAddStrings(exact): ", stdout);
+
+    {
+      static const char * const sides[] =	/* sides-supported values */
+      {
+        "one-sided",
+        "two-sided-long-edge",
+        "two-sided-short-edge"
+      };
+
+      request = ippNew();
+      attr    = ippAddStrings(request, IPP_TAG_PRINTER, IPP_TAG_KEYWORD, "sides-supported", 3, NULL, sides);
+
+      if (attr->alloc_values != 3)
+      {
+        printf("FAIL (allocated %d values)\n", attr->alloc_values);
+        status = 1;
+      }
+      else if (!ippSetString(request, &attr, 3, "grow") || ippGetCount(attr) != 4 || attr->alloc_values < 4 || strcmp(ippGetString(attr, 0, NULL), "one-sided") || strcmp(ippGetString(attr, 3, NULL), "grow"))
+      {
+        puts("FAIL (grow)");
+        status = 1;
+      }
+      else if ((attr = ippAddInteger(request, IPP_TAG_PRINTER, IPP_TAG_INTEGER, "copies-default", 1)) == NULL || attr->alloc_values != 1)
+      {
+        puts("FAIL (single value)");
+        status = 1;
+      }
+      else
+        puts("PASS");
+
+      ippDelete(request);
+    }
+
+   /*
+    * Test shared attribute copies...
+    */
+
+    fputs("ippCopyAttribute(shared): ", stdout);
+
+    {
+      static const char * const names[] =	/* job-name values */
+      {
+        "One",
+        "Two"
+      };
+      ipp_t		*copy;			/* Copied attributes */
+      ipp_attribute_t	*keyword,		/* Copied keyword attribute */
+			*namelang;		/* Copied nameWithLanguage attribute */
+      const char	*value;			/* Original keyword value */
+      const char	*lang;			/* Language of copied value */
+
+      request  = ippNew();
+      copy     = ippNew();
+      attr     = ippAddString(request, IPP_TAG_JOB, IPP_TAG_KEYWORD, "sides", NULL, "two-sided-long-edge");
+      value    = ippGetString(attr, 0, NULL);
+      keyword  = ippCopyAttribute(copy, attr, 0);
+      attr     = ippAddStrings(request, IPP_TAG_JOB, IPP_TAG_NAMELANG, "job-name", 2, "fr-ca", names);
+      namelang = ippCopyAttribute(copy, attr, 0);
+
+      ippDelete(request);
+
+      if (!keyword || ippGetString(keyword, 0, NULL) != value)
+      {
+        puts("FAIL (keyword not shared)");
+        status = 1;
+      }
+      else if (!namelang || ippGetCount(namelang) != 2 || !ippGetString(namelang, 1, &lang) || strcmp(ippGetString(namelang, 0, NULL), "One") || strcmp(ippGetString(namelang, 1, NULL), "Two") || !lang || strcmp(lang, "fr-ca"))
+      {
+        puts("FAIL (nameWithLanguage not copied)");
+        status = 1;
+      }
+      else
+        puts("PASS");
+
+      ippDelete(copy);
+    }
+
+   /*
+    * Test validation of long text and name values...
+    */
+
+    fputs("ippValidateAttribute(text/name): ", stdout);
+
+    {
+      static const struct
+      {
+        ipp_tag_t	value_tag;		/* Value tag */
+        const char	*value;			/* Value */
+        int		valid;			/* Expected result */
+      } tests[] =
+      {
+        { IPP_TAG_TEXT, "A long job description that is plain ASCII", 1 },
+        { IPP_TAG_TEXT, "A long job description\twith a tab character", 1 },
+        { IPP_TAG_TEXT, "A long job description with UTF-8 \303\251", 1 },
+        { IPP_TAG_TEXT, "A long job description with a bell \007", 0 },
+        { IPP_TAG_TEXT, "A long job description with a DEL \177", 0 },
+        { IPP_TAG_TEXT, "A long job description with bad UTF-8 \377", 0 },
+        { IPP_TAG_NAME, "A long job name that is plain ASCII text", 1 },
+        { IPP_TAG_NAME, "A long job name with UTF-8 \303\251 in the middle", 1 },
+        { IPP_TAG_NAME, "A long job name\twith a tab character", 0 },
+        { IPP_TAG_NAME, "A long job name with bad UTF-8 \300 in it", 0 }
+      };
+
+      request = ippNew();
+
+      for (i = 0; i < (sizeof(tests) / sizeof(tests[0])); i ++)
+      {
+        attr = ippAddString(request, IPP_TAG_JOB, tests[i].value_tag, "job-name", NULL, tests[i].value);
+
+        if (ippValidateAttribute(attr) != tests[i].valid)
+        {
+          printf("FAIL (\"%s\" %s)\n", tests[i].value, tests[i].valid ? "rejected" : "accepted");
+          status = 1;
+          break;
+        }
+
+        ippDeleteAttribute(request, attr);
+      }
+
+      if (i >= (sizeof(tests) / sizeof(tests[0])))
+        puts("PASS");
+
+      ippDelete(request);
+    }
+
+   /*
+    * Test compiled attribute filters...
+    */
+
+    fputs("_ippServerCreateFilter: ", stdout);
+
+    {
+      ipp_t		*copy;			/* Filtered attributes */
+      cups_array_t	*ra,			/* Requested attributes */
+			*pa;			/* Private attributes */
+      _ipp_cfilter_t	*filter;		/* Compiled filter */
+
+      request = ippNew();
+      ippAddString(request, IPP_TAG_OPERATION, IPP_CONST_TAG(IPP_TAG_CHARSET), "attributes-charset", NULL, "utf-8");
+      ippAddInteger(request, IPP_TAG_JOB, IPP_TAG_INTEGER, "job-id", 42);
+      ippAddString(request, IPP_TAG_JOB, IPP_TAG_NAME, "job-name", NULL, "Filtered");
+      ippAddString(request, IPP_TAG_JOB, IPP_TAG_NAME, "job-originating-user-name", NULL, "user");
+      ippAddString(request, IPP_TAG_JOB, IPP_TAG_KEYWORD, "media-col-database", NULL, "none");
+
+      ra = cupsArrayNew((cups_array_func_t)strcmp, NULL);
+      cupsArrayAdd(ra, "job-id");
+      cupsArrayAdd(ra, "job-name");
+      cupsArrayAdd(ra, "job-originating-user-name");
+      cupsArrayAdd(ra, "attributes-charset");
+
+      pa = cupsArrayNew((cups_array_func_t)strcmp, NULL);
+      cupsArrayAdd(pa, "job-originating-user-name");
+
+      copy   = ippNew();
+      filter = _ippServerCreateFilter(ra, pa, IPP_TAG_JOB);
+      _ippServerCopyFilteredAttributes(copy, request, filter, 0);
+
+      if (!filter || !ippFindAttribute(copy, "job-id", IPP_TAG_INTEGER) || !ippFindAttribute(copy, "job-name", IPP_TAG_NAME) || ippFindAttribute(copy, "job-originating-user-name", IPP_TAG_ZERO) || ippFindAttribute(copy, "attributes-charset", IPP_TAG_ZERO) || ippFindAttribute(copy, "media-col-database", IPP_TAG_ZERO))
+      {
+        puts("FAIL (requested attributes)");
+        status = 1;
+      }
+      else
+      {
+        _ippServerDeleteFilter(filter);
+        ippDelete(copy);
+
+        copy   = ippNew();
+        filter = _ippServerCreateFilter(NULL, NULL, IPP_TAG_ZERO);
+        _ippServerCopyFilteredAttributes(copy, request, filter, 0);
+
+        if (!filter || !ippFindAttribute(copy, "attributes-charset", IPP_TAG_CHARSET) || !ippFindAttribute(copy, "job-originating-user-name", IPP_TAG_NAME) || ippFindAttribute(copy, "media-col-database", IPP_TAG_ZERO))
+        {
+          puts("FAIL (all attributes)");
+          status = 1;
+        }
+        else
+          puts("PASS");
+      }
+
+      _ippServerDeleteFilter(filter);
+      ippDelete(copy);
+      ippDelete(request);
+      cupsArrayDelete(ra);
+      cupsArrayDelete(pa);
+    }
+
+   /*
+    * Test well-known attribute name IDs...
+    */
+
+    fputs("ippGetNameId: ", stdout);
+
+    {
+      ipp_name_t	id;			/* Current name ID */
+      const char	*name,			/* Current name */
+			*prev = NULL;		/* Previous name */
+
+      for (id = IPP_NAME_UNKNOWN + 1; (name = ippNameString(id)) != NULL; id ++)
+      {
+        if ((prev && strcmp(prev, name) >= 0) || ippNameValue(name) != id)
+          break;
+
+        prev = name;
+      }
+
+      request = ippNew();
+      attr    = ippAddInteger(request, IPP_TAG_JOB, IPP_TAG_ENUM, "job-state", IPP_JSTATE_COMPLETED);
+
+      if (name)
+      {
+        printf("FAIL (\"%s\" not sorted)\n", name);
+        status = 1;
+      }
+      else if (id != IPP_NAME_WHICH_JOBS + 1)
+      {
+        printf("FAIL (%d names)\n", (int)id - 1);
+        status = 1;
+      }
+      else if (ippGetNameId(attr) != IPP_NAME_JOB_STATE || ippNameValue("x-job-state") != IPP_NAME_UNKNOWN || ippNameString(IPP_NAME_UNKNOWN))
+      {
+        puts("FAIL (bad name ID)");
+        status = 1;
+      }
+      else if (!ippSetName(request, &attr, "printer-state") || ippGetNameId(attr) != IPP_NAME_PRINTER_STATE)
+      {
+        puts("FAIL (ippSetName)");
+        status = 1;
+      }
+      else if (strcmp(ippEnumString("printer-state", IPP_PSTATE_STOPPED), "stopped") || strcmp(ippEnumString("finishings-ready", IPP_FINISHINGS_STAPLE), "staple") || strcmp(ippEnumString("x-printer-state", IPP_PSTATE_STOPPED), "5") || ippEnumValue("job-state", "processing-stopped") != IPP_JSTATE_STOPPED || ippEnumValue("x-job-state", "processing-stopped") != -1)
+      {
+        puts("FAIL (ippEnumString/ippEnumValue)");
+        status = 1;
+      }
+      else
+        puts("PASS");
+
+      ippDelete(request);
+    }
+
+   /*
+    * Test the sorted lookup tables...
+    */
+
+    fputs("ippOpValue/ippTagValue: ", stdout);
+
+    {
+      int		i;			/* Looping var */
+      const char	*str;			/* String value */
+
+
+      for (i = IPP_OP_PRINT_JOB; i < 0x4100; i ++)
+      {
+        str = ippOpString((ipp_op_t)i);
+
+        if (strncmp(str, "0x", 2) && ippOpValue(str) != (ipp_op_t)i)
+          break;
+      }
+
+      if (i < 0x4100)
+      {
+        printf("FAIL (ippOpValue(\"%s\") != 0x%04x)\n", str, i);
+        status = 1;
+      }
+      else if (ippOpValue("get-printer-attributes") != IPP_OP_GET_PRINTER_ATTRIBUTES || ippOpValue("CUPS-Add-Class") != IPP_OP_CUPS_ADD_MODIFY_CLASS || ippOpValue("Not-An-Operation") != IPP_OP_CUPS_INVALID)
+      {
+        puts("FAIL (ippOpValue aliases)");
+        status = 1;
+      }
+      else
+      {
+        for (i = IPP_TAG_ZERO; i <= IPP_TAG_EXTENSION; i ++)
+        {
+          str = ippTagString((ipp_tag_t)i);
+
+          if (strcmp(str, "UNKNOWN") && ippTagValue(str) != (ipp_tag_t)i)
+            break;
+        }
+
+        if (i <= IPP_TAG_EXTENSION)
+        {
+          printf("FAIL (ippTagValue(\"%s\") != 0x%02x)\n", str, i);
+          status = 1;
+        }
+        else if (ippTagValue("KEYWORD") != IPP_TAG_KEYWORD || ippTagValue("printer") != IPP_TAG_PRINTER || ippTagValue("not-a-tag") != IPP_TAG_ZERO)
+        {
+          puts("FAIL (ippTagValue aliases)");
+          status = 1;
+        }
+        else
+        {
+          for (i = IPP_FINISHINGS_NONE; i <= IPP_FINISHINGS_CUPS_FOLD_Z; i = i == 0x200 ? 0x40000000 : i + 1)
+          {
+            str = ippEnumString("finishings", i);
+
+            if (!isdigit(*str & 255) && ippEnumValue("finishings", str) != i)
+              break;
+          }
+
+          if (i <= IPP_FINISHINGS_CUPS_FOLD_Z)
+          {
+            printf("FAIL (ippEnumValue(\"finishings\", \"%s\") != %d)\n", str, i);
+            status = 1;
+          }
+          else
+            puts("PASS");
+        }
+      }
+    }
+
+   /*
+    * Test the string pool...
+    */
+
+    fputs("_cupsStrAlloc: ", stdout);
+
+    {
+      char	*str1, *str2;		/* Pooled strings */
+      size_t	hits, misses,		/* Before counters */
+		hits2, misses2;		/* After counters */
+
+      _cupsStrCounters(&hits, &misses);
+
+      str1 = _cupsStrAlloc("testipp-string-pool");
+      str2 = _cupsStrAlloc("testipp-string-pool");
+
+      _cupsStrCounters(&hits2, &misses2);
+
+      if (str1 != str2 || strcmp(str1, "testipp-string-pool"))
+      {
+        puts("FAIL (different strings)");
+        status = 1;
+      }
+      else if (hits2 != hits + 1 || misses2 != misses + 1)
+      {
+        printf("FAIL (hits %d, misses %d)\n", (int)(hits2 - hits), (int)(misses2 - misses));
+        status = 1;
+      }
+      else
+        puts("PASS");
+
+      _cupsStrFree(str1);
+      _cupsStrFree(str2);
+    }
+
+   /*
+    * Test the shared request support functions...
+    */
+
+    fputs("_ippServerCopyAttributes: ", stdout);
+
+    {
+      ipp_t		*from,		/* Source message */
+			*to;		/* Destination message */
+      cups_array_t	*ra,		/* Requested attributes */
+			*pa;		/* Private attributes */
+
+      from = ippNew();
+      ippAddString(from, IPP_TAG_PRINTER, IPP_TAG_KEYWORD, "media-default", NULL, "na_letter_8.5x11in");
+      ippAddString(from, IPP_TAG_PRINTER, IPP_TAG_KEYWORD, "media-col-database", NULL, "na_letter_8.5x11in");
+      ippAddString(from, IPP_TAG_PRINTER, IPP_TAG_KEYWORD, "printer-private", NULL, "secret");
+      ippAddString(from, IPP_TAG_JOB, IPP_TAG_KEYWORD, "sides", NULL, "one-sided");
+
+      ra = _cupsArrayNewStrings("media-default,printer-private", ',');
+      pa = _cupsArrayNewStrings("printer-private", ',');
+
+      to = ippNew();
+      _ippServerCopyAttributes(to, from, NULL, NULL, IPP_TAG_PRINTER, 0);
+
+      if (!ippFindAttribute(to, "media-default", IPP_TAG_KEYWORD) || ippFindAttribute(to, "media-col-database", IPP_TAG_ZERO) || ippFindAttribute(to, "sides", IPP_TAG_ZERO) || ippGetCount(ippFindAttribute(to, "printer-private", IPP_TAG_KEYWORD)) != 1)
+      {
+        puts("FAIL (all printer attributes)");
+        status = 1;
+      }
+      else
+      {
+        ippDelete(to);
+        to = ippNew();
+        _ippServerCopyAttributes(to, from, ra, pa, IPP_TAG_ZERO, 0);
+
+        if (!ippFindAttribute(to, "media-default", IPP_TAG_KEYWORD) || ippFindAttribute(to, "printer-private", IPP_TAG_ZERO) || ippFindAttribute(to, "sides", IPP_TAG_ZERO))
+        {
+          puts("FAIL (requested attributes)");
+          status = 1;
+        }
+        else
+          puts("PASS");
+      }
+
+      ippDelete(to);
+      cupsArrayDelete(ra);
+      cupsArrayDelete(pa);
+
+      fputs("_ippServerValidJobAttributes: ", stdout);
+
+      request = ippNewRequest(IPP_OP_PRINT_JOB);
+      ippAddInteger(request, IPP_TAG_JOB, IPP_TAG_INTEGER, "copies", 2);
+      ippAddString(request, IPP_TAG_JOB, IPP_TAG_KEYWORD, "sides", NULL, "one-sided");
+
+      to = ippNewResponse(request);
+
+      if (!_ippServerValidJobAttributes(request, from, to) || ippGetStatusCode(to) != IPP_STATUS_OK)
+      {
+        printf("FAIL (valid request: %s)\n", ippErrorString(ippGetStatusCode(to)));
+        status = 1;
+      }
+      else
+      {
+        ippDelete(to);
+        attr = ippFindAttribute(request, "sides", IPP_TAG_KEYWORD);
+        ippSetString(request, &attr, 0, "two-sided-long-edge");
+
+        to = ippNewResponse(request);
+
+        if (_ippServerValidJobAttributes(request, from, to) || ippGetStatusCode(to) != IPP_STATUS_ERROR_ATTRIBUTES_OR_VALUES || ippGetGroupTag(ippFindAttribute(to, "sides", IPP_TAG_KEYWORD)) != IPP_TAG_UNSUPPORTED_GROUP)
+        {
+          printf("FAIL (unsupported sides: %s)\n", ippErrorString(ippGetStatusCode(to)));
+          status = 1;
+        }
+        else
+          puts("PASS");
+      }
+
+      ippDelete(to);
+      ippDelete(request);
+      ippDelete(from);
+    }
+
 #ifdef DEBUG
    /*
     * Test that private option array is sorted...
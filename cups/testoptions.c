@@ -150,6 +150,56 @@ main(int  argc,				/* I - Number of command-line arguments */
     }
     else
       puts("PASS");
+
+    ippDelete(request);
+
+   /*
+    * cupsParseOptions() merging into existing options...
+    */
+
+    fputs("cupsParseOptions(merge): ", stdout);
+
+    num_options = cupsParseOptions("FOO=5678 cupsPrintQuality=Draft zzz=1 "
+                                   "print-quality=5 aaa=1 aaa=2 nozzz", num_options, &options);
+
+    if (num_options != 9)
+    {
+      printf("FAIL (num_options=%d, expected 9)\n", num_options);
+      status ++;
+    }
+    else if ((value = cupsGetOption("foo", num_options, options)) == NULL ||
+	     strcmp(value, "5678"))
+    {
+      printf("FAIL (foo=\"%s\", expected \"5678\")\n", value);
+      status ++;
+    }
+    else if ((value = cupsGetOption("print-quality", num_options, options)) == NULL ||
+	     strcmp(value, "5"))
+    {
+      printf("FAIL (print-quality=\"%s\", expected \"5\")\n", value);
+      status ++;
+    }
+    else if (cupsGetOption("cupsPrintQuality", num_options, options))
+    {
+      puts("FAIL (cupsPrintQuality not removed)");
+      status ++;
+    }
+    else if ((value = cupsGetOption("aaa", num_options, options)) == NULL ||
+	     strcmp(value, "2"))
+    {
+      printf("FAIL (aaa=\"%s\", expected \"2\")\n", value);
+      status ++;
+    }
+    else if ((value = cupsGetOption("zzz", num_options, options)) == NULL ||
+	     strcmp(value, "false"))
+    {
+      printf("FAIL (zzz=\"%s\", expected \"false\")\n", value);
+      status ++;
+    }
+    else
+      puts("PASS");
+
+    cupsFreeOptions(num_options, options);
   }
   else
   {
@@ -20,8 +20,12 @@
  * Local functions...
  */
 
+static int	do_convert_tests(void);
 static int	do_ras_file(const char *filename);
+static int	do_raster_benchmark(cups_mode_t mode, unsigned bpp, int threads);
 static int	do_raster_tests(cups_mode_t mode);
+static double	get_seconds(void);
+static void	make_line(unsigned char *line, unsigned y, unsigned width, unsigned bpp);
 static void	print_changes(cups_page_header2_t *header, cups_page_header2_t *expected);
 
 
@@ -38,10 +42,16 @@ main(int  argc,				/* I - Number of command-line args */
 
   if (argc == 1)
   {
+    errors += do_convert_tests();
     errors += do_raster_tests(CUPS_RASTER_WRITE);
     errors += do_raster_tests(CUPS_RASTER_WRITE_COMPRESSED);
     errors += do_raster_tests(CUPS_RASTER_WRITE_PWG);
     errors += do_raster_tests(CUPS_RASTER_WRITE_APPLE);
+    errors += do_raster_benchmark(CUPS_RASTER_WRITE_PWG, 1, 0);
+    errors += do_raster_benchmark(CUPS_RASTER_WRITE_PWG, 3, 0);
+    errors += do_raster_benchmark(CUPS_RASTER_WRITE_APPLE, 3, 0);
+    errors += do_raster_benchmark(CUPS_RASTER_WRITE_PWG, 3, 1);
+    errors += do_raster_benchmark(CUPS_RASTER_WRITE_PWG, 3, 4);
   }
   else
   {
@@ -55,6 +65,102 @@ main(int  argc,				/* I - Number of command-line args */
 }
 
 
+/*
+ * 'do_convert_tests()' - Test the sample conversion functions.
+ */
+
+static int				/* O - Number of errors */
+do_convert_tests(void)
+{
+  unsigned	i;			/* Looping var */
+  unsigned char	src[303],		/* Source samples */
+		dst[606],		/* Destination samples */
+		back[303];		/* Converted back */
+  int		errors = 0;		/* Number of errors */
+
+
+  for (i = 0; i < sizeof(src); i ++)
+    src[i] = (unsigned char)(i * 7);
+
+  fputs("_cupsRasterSwap16: ", stdout);
+
+  _cupsRasterSwap16(dst, src, sizeof(src));
+
+  for (i = 0; i < (sizeof(src) & ~1U); i += 2)
+    if (dst[i] != src[i + 1] || dst[i + 1] != src[i])
+      break;
+
+  memcpy(back, dst, sizeof(src));
+  _cupsRasterSwap16(back, back, sizeof(src));
+
+  if (i < (sizeof(src) & ~1U))
+  {
+    printf("FAIL (byte %u not swapped)\n", i);
+    errors ++;
+  }
+  else if (memcmp(back, src, sizeof(src) & ~1U))
+  {
+    puts("FAIL (in-place swap does not restore samples)");
+    errors ++;
+  }
+  else
+    puts("PASS");
+
+  fputs("_cupsRasterConvert8To16/16To8: ", stdout);
+
+  _cupsRasterConvert8To16(dst, src, sizeof(src));
+  _cupsRasterConvert16To8(back, dst, sizeof(src));
+
+  if (dst[0] != src[0] || dst[1] != src[0] || dst[2 * 301] != src[301] || dst[2 * 301 + 1] != src[301])
+  {
+    puts("FAIL (bad 16-bit samples)");
+    errors ++;
+  }
+  else if (memcmp(back, src, sizeof(src)))
+  {
+    puts("FAIL (round trip does not restore samples)");
+    errors ++;
+  }
+  else
+    puts("PASS");
+
+  fputs("_cupsRasterChunkyToBanded/BandedToChunky: ", stdout);
+
+  _cupsRasterChunkyToBanded(dst, src, 101, 3, 1);
+
+  if (dst[0] != src[0] || dst[101] != src[1] || dst[202] != src[2] || dst[100] != src[300])
+  {
+    puts("FAIL (bad 8-bit bands)");
+    errors ++;
+  }
+  else
+  {
+    _cupsRasterBandedToChunky(back, dst, 101, 3, 1);
+
+    if (memcmp(back, src, sizeof(src)))
+    {
+      puts("FAIL (8-bit round trip does not restore pixels)");
+      errors ++;
+    }
+    else
+    {
+      _cupsRasterChunkyToBanded(dst, src, 50, 3, 2);
+      _cupsRasterBandedToChunky(back, dst, 50, 3, 2);
+
+      if (dst[0] != src[0] || dst[1] != src[1] || dst[100] != src[2] || dst[101] != src[3] || memcmp(back, src, 300))
+      {
+        puts("FAIL (bad 16-bit bands)");
+        errors ++;
+      }
+      else
+        puts("PASS");
+    }
+  }
+
+  return (errors);
+}
+
+
 /*
  * 'do_ras_file()' - Test reading of a raster file.
  */
@@ -118,6 +224,183 @@ do_ras_file(const char *filename)	/* I - Filename */
 }
 
 
+/*
+ * 'do_raster_benchmark()' - Time writing and verify reading of a 600dpi page.
+ *
+ * When "threads" is 0 the page is written one line at a time, otherwise it is
+ * written in 256-line bands using the specified number of threads.
+ */
+
+static int				/* O - Number of errors */
+do_raster_benchmark(cups_mode_t mode,	/* I - Write mode */
+                    unsigned    bpp,	/* I - Bytes per pixel */
+                    int         threads)/* I - Compression threads or 0 */
+{
+  unsigned		y,		/* Looping var */
+			bandlines;	/* Lines per band */
+  FILE			*fp;		/* Raster file */
+  cups_raster_t		*r;		/* Raster stream */
+  cups_page_header2_t	header;		/* Page header */
+  unsigned char		*data,		/* Raster data */
+			*line;		/* Expected raster data */
+  double		start,		/* Start time */
+			end;		/* End time */
+  int			errors = 0;	/* Number of errors */
+
+
+  if (threads)
+    printf("cupsRasterWriteLines(%s, 600dpi %s, %d thread%s): ", mode == CUPS_RASTER_WRITE_PWG ? "CUPS_RASTER_WRITE_PWG" : "CUPS_RASTER_WRITE_APPLE", bpp == 1 ? "sgray_8" : "srgb_8", threads, threads == 1 ? "" : "s");
+  else
+    printf("cupsRasterWritePixels(%s, 600dpi %s): ", mode == CUPS_RASTER_WRITE_PWG ? "CUPS_RASTER_WRITE_PWG" : "CUPS_RASTER_WRITE_APPLE", bpp == 1 ? "sgray_8" : "srgb_8");
+  fflush(stdout);
+
+  memset(&header, 0, sizeof(header));
+  header.cupsWidth        = 5100;
+  header.cupsHeight       = 6600;
+  header.cupsBitsPerColor = 8;
+  header.cupsBitsPerPixel = 8 * bpp;
+  header.cupsBytesPerLine = header.cupsWidth * bpp;
+  header.cupsColorOrder   = CUPS_ORDER_CHUNKED;
+  header.cupsColorSpace   = bpp == 1 ? CUPS_CSPACE_SW : CUPS_CSPACE_SRGB;
+  header.cupsNumColors    = bpp;
+  header.HWResolution[0]  = 600;
+  header.HWResolution[1]  = 600;
+  header.PageSize[0]      = 612;
+  header.PageSize[1]      = 792;
+  header.cupsPageSize[0]  = 612.0f;
+  header.cupsPageSize[1]  = 792.0f;
+
+  bandlines = threads ? 256 : 1;
+  data      = malloc(bandlines * header.cupsBytesPerLine);
+  line      = malloc(header.cupsBytesPerLine);
+
+  if (!data || !line)
+  {
+    printf("FAIL (%s)\n", strerror(errno));
+    free(data);
+    free(line);
+    return (1);
+  }
+
+  if ((fp = fopen("test.raster", "wb")) == NULL)
+  {
+    printf("FAIL (%s)\n", strerror(errno));
+    free(data);
+    free(line);
+    return (1);
+  }
+
+  if ((r = cupsRasterOpen(fileno(fp), mode)) == NULL || !cupsRasterWriteHeader2(r, &header))
+  {
+    printf("FAIL (%s)\n", strerror(errno));
+    cupsRasterClose(r);
+    fclose(fp);
+    free(data);
+    free(line);
+    return (1);
+  }
+
+  if (threads)
+    cupsRasterSetThreads(r, threads);
+
+  start = get_seconds();
+
+  if (threads)
+  {
+    for (y = 0; y < header.cupsHeight; y += bandlines)
+    {
+      unsigned	i,			/* Looping var */
+		numlines = header.cupsHeight - y > bandlines ? bandlines : header.cupsHeight - y;
+					/* Lines in this band */
+
+      for (i = 0; i < numlines; i ++)
+        make_line(data + i * header.cupsBytesPerLine, y + i, header.cupsWidth, bpp);
+
+      if (cupsRasterWriteLines(r, data, numlines) != numlines)
+        break;
+    }
+
+    if (y > header.cupsHeight)
+      y = header.cupsHeight;
+  }
+  else
+  {
+    for (y = 0; y < header.cupsHeight; y ++)
+    {
+      make_line(data, y, header.cupsWidth, bpp);
+
+      if (!cupsRasterWritePixels(r, data, header.cupsBytesPerLine))
+        break;
+    }
+  }
+
+  end = get_seconds();
+
+  cupsRasterClose(r);
+  fclose(fp);
+
+  if (y < header.cupsHeight)
+  {
+    printf("FAIL (unable to write line %u)\n", y);
+    free(data);
+    free(line);
+    return (1);
+  }
+
+  printf("%u lines in %.3f seconds (%.0f lines/sec), ", header.cupsHeight, end - start, header.cupsHeight / (end - start));
+  fflush(stdout);
+
+ /*
+  * Read the page back and compare it to what we wrote...
+  */
+
+  if ((fp = fopen("test.raster", "rb")) == NULL)
+  {
+    printf("FAIL (%s)\n", strerror(errno));
+    free(data);
+    free(line);
+    return (1);
+  }
+
+  if ((r = cupsRasterOpen(fileno(fp), CUPS_RASTER_READ)) == NULL || !cupsRasterReadHeader2(r, &header) || header.cupsBytesPerLine != 5100 * bpp)
+  {
+    puts("FAIL (unable to read header)");
+    errors ++;
+  }
+  else
+  {
+    for (y = 0; y < header.cupsHeight; y ++)
+    {
+      if (!cupsRasterReadPixels(r, data, header.cupsBytesPerLine))
+      {
+        printf("FAIL (unable to read line %u)\n", y);
+        errors ++;
+        break;
+      }
+
+      make_line(line, y, header.cupsWidth, bpp);
+
+      if (memcmp(data, line, header.cupsBytesPerLine))
+      {
+        printf("FAIL (line %u does not match)\n", y);
+        errors ++;
+        break;
+      }
+    }
+
+    if (!errors)
+      puts("PASS");
+  }
+
+  cupsRasterClose(r);
+  fclose(fp);
+  free(data);
+  free(line);
+
+  return (errors);
+}
+
+
 /*
  * 'do_raster_tests()' - Test reading and writing of raster data.
  */
@@ -518,10 +801,347 @@ do_raster_tests(cups_mode_t mode)	/* O - Write mode */
   cupsRasterClose(r);
   fclose(fp);
 
+ /*
+  * Test reading bands of lines, using a band height that doesn't line up
+  * with the 64-line groups in the test pages...
+  */
+
+  if ((fp = fopen("test.raster", "rb")) == NULL || (r = cupsRasterOpen(fileno(fp), CUPS_RASTER_READ)) == NULL)
+  {
+    printf("cupsRasterReadLines: FAIL (%s)\n", strerror(errno));
+
+    if (fp)
+      fclose(fp);
+
+    return (errors + 1);
+  }
+
+  fputs("cupsRasterReadLines: ", stdout);
+  fflush(stdout);
+
+  for (page = 0, count = 0; page < 4 && !count; page ++)
+  {
+    const unsigned char	*lines;		/* Band of lines */
+    unsigned		numlines,	/* Number of lines in band */
+			expect;		/* Expected pixel value */
+
+    if (!cupsRasterReadHeader2(r, &header))
+    {
+      printf("FAIL (page %u header read error)\n", page + 1);
+      count ++;
+      break;
+    }
+
+    for (y = 0; y < header.cupsHeight && !count; y += numlines)
+    {
+      if ((lines = cupsRasterReadLines(r, 50, &numlines)) == NULL || numlines == 0 || numlines > 50)
+      {
+        printf("FAIL (page %u line %u read error)\n", page + 1, y);
+        count ++;
+        break;
+      }
+
+      for (x = 0; x < numlines * header.cupsBytesPerLine; x ++)
+      {
+        switch ((y + x / header.cupsBytesPerLine) / 64)
+        {
+          case 0 :
+              expect = 0;
+              break;
+          case 1 :
+              expect = (x % header.cupsBytesPerLine) & 255;
+              break;
+          case 2 :
+              expect = 255;
+              break;
+          default :
+              expect = ((x % header.cupsBytesPerLine) / 4) & 255;
+              break;
+        }
+
+        if (lines[x] != expect)
+        {
+          printf("FAIL (page %u raster line %u corrupt)\n", page + 1, y + x / header.cupsBytesPerLine);
+          count ++;
+          break;
+        }
+      }
+    }
+
+    if (!count && cupsRasterReadLines(r, 0, &numlines) != NULL)
+    {
+      printf("FAIL (page %u has extra lines)\n", page + 1);
+      count ++;
+    }
+  }
+
+  if (count)
+    errors ++;
+  else
+    puts("PASS");
+
+  cupsRasterClose(r);
+  fclose(fp);
+
+ /*
+  * Test writing bands of lines, which must produce the same file as
+  * cupsRasterWritePixels...
+  */
+
+  fputs("cupsRasterWriteLines: ", stdout);
+  fflush(stdout);
+
+  if ((fp = fopen("test-lines.raster", "w+b")) == NULL || (r = cupsRasterOpen(fileno(fp), mode)) == NULL)
+  {
+    printf("FAIL (%s)\n", strerror(errno));
+
+    if (fp)
+      fclose(fp);
+
+    return (errors + 1);
+  }
+
+  for (page = 0, count = 0; page < 4 && !count; page ++)
+  {
+    unsigned char	*band,		/* Page image */
+			*bandptr;	/* Pointer into page image */
+
+    memset(&header, 0, sizeof(header));
+    header.cupsWidth        = 256;
+    header.cupsHeight       = 256;
+    header.cupsBytesPerLine = (page & 1) ? 1024 : 256;
+    header.HWResolution[0]  = 64;
+    header.HWResolution[1]  = 64;
+    header.PageSize[0]      = 288;
+    header.PageSize[1]      = 288;
+    header.cupsPageSize[0]  = 288.0f;
+    header.cupsPageSize[1]  = 288.0f;
+    header.cupsColorSpace   = (page & 1) ? CUPS_CSPACE_CMYK : CUPS_CSPACE_W;
+    header.cupsColorOrder   = CUPS_ORDER_CHUNKED;
+    header.cupsNumColors    = (page & 1) ? 4 : 1;
+    header.cupsBitsPerColor = 8;
+    header.cupsBitsPerPixel = (page & 1) ? 32 : 8;
+
+    strlcpy(header.MediaType, "auto", sizeof(header.MediaType));
+
+    if (page & 2)
+    {
+      header.cupsBytesPerLine *= 2;
+      header.cupsBitsPerColor = 16;
+      header.cupsBitsPerPixel *= 2;
+    }
+
+    if ((band = malloc(header.cupsHeight * header.cupsBytesPerLine)) == NULL)
+    {
+      puts("FAIL (out of memory)");
+      count ++;
+      break;
+    }
+
+    for (y = 0, bandptr = band; y < header.cupsHeight; y ++, bandptr += header.cupsBytesPerLine)
+    {
+      for (x = 0; x < header.cupsBytesPerLine; x ++)
+      {
+        switch (y / 64)
+        {
+          case 0 :
+              bandptr[x] = 0;
+              break;
+          case 1 :
+              bandptr[x] = (unsigned char)x;
+              break;
+          case 2 :
+              bandptr[x] = 255;
+              break;
+          default :
+              bandptr[x] = (unsigned char)(x / 4);
+              break;
+        }
+      }
+    }
+
+    if (!cupsRasterWriteHeader2(r, &header))
+    {
+      printf("FAIL (page %u header write error)\n", page + 1);
+      count ++;
+    }
+    else
+    {
+      for (y = 0, bandptr = band; y < header.cupsHeight; y += 100, bandptr += 100 * header.cupsBytesPerLine)
+      {
+        unsigned numlines = header.cupsHeight - y > 100 ? 100 : header.cupsHeight - y;
+					/* Lines in band */
+
+        if (cupsRasterWriteLines(r, bandptr, numlines) != numlines)
+        {
+          printf("FAIL (page %u line %u write error)\n", page + 1, y);
+          count ++;
+          break;
+        }
+      }
+    }
+
+    free(band);
+  }
+
+  cupsRasterClose(r);
+
+  if (!count)
+  {
+    FILE	*pfp;			/* File written by cupsRasterWritePixels */
+    int		ch;			/* Character from file */
+
+    rewind(fp);
+
+    if ((pfp = fopen("test.raster", "rb")) == NULL)
+    {
+      printf("FAIL (%s)\n", strerror(errno));
+      count ++;
+    }
+    else
+    {
+      while ((ch = getc(pfp)) == getc(fp) && ch != EOF);
+
+      if (ch != EOF || getc(fp) != EOF)
+      {
+        printf("FAIL (differs from cupsRasterWritePixels output at offset %ld)\n", ftell(pfp));
+        count ++;
+      }
+
+      fclose(pfp);
+    }
+  }
+
+  fclose(fp);
+  unlink("test-lines.raster");
+
+  if (count)
+    errors ++;
+  else
+    puts("PASS");
+
   return (errors);
 }
 
 
+/*
+ * 'get_seconds()' - Get the current time in seconds...
+ */
+
+#ifdef _WIN32
+#  include <windows.h>
+
+
+static double
+get_seconds(void)
+{
+  return (GetTickCount() * 0.001);
+}
+#else
+#  include <sys/time.h>
+
+
+static double
+get_seconds(void)
+{
+  struct timeval	curtime;	/* Current time */
+
+
+  gettimeofday(&curtime, NULL);
+  return (curtime.tv_sec + 0.000001 * curtime.tv_usec);
+}
+#endif /* _WIN32 */
+
+
+/*
+ * 'make_line()' - Generate a line of page content.
+ *
+ * The page is mostly white with lines of "text" (short dark runs with
+ * antialiased edges), a color rule, and a photo with fine detail.
+ */
+
+static void
+make_line(unsigned char *line,		/* I - Line buffer */
+          unsigned      y,		/* I - Line number */
+          unsigned      width,		/* I - Width in pixels */
+          unsigned      bpp)		/* I - Bytes per pixel */
+{
+  unsigned	x,			/* Current column */
+		seed;			/* Pseudo-random number */
+  unsigned char	*ptr;			/* Pointer into line */
+
+
+  memset(line, 255, width * bpp);
+
+  if (y >= 3000 && y < 4800)
+  {
+   /*
+    * Photo from 1" to 7.5"...
+    */
+
+    seed = y * 2654435761U;
+
+    for (x = 600, ptr = line + 600 * bpp; x < 4500; x ++)
+    {
+      seed = seed * 1103515245 + 12345;
+
+      *ptr++ = (unsigned char)((x + y) / 32 + ((seed >> 16) & 7));
+      if (bpp == 3)
+      {
+        *ptr++ = (unsigned char)(y / 8);
+        *ptr++ = (unsigned char)(x / 20 + ((seed >> 20) & 3));
+      }
+    }
+  }
+  else if (y >= 600 && y < 6000 && (y % 100) < 60)
+  {
+   /*
+    * Text with 10 characters per inch...
+    */
+
+    seed = (y / 100) * 2654435761U;
+
+    for (x = 600; x < 4500; x += 60)
+    {
+      unsigned	i,			/* Looping var */
+		len;			/* Length of stroke */
+
+      seed = seed * 1103515245 + 12345;
+
+      if (((seed >> 16) & 7) == 0)
+        continue;			/* Space */
+
+      len = 6 + (((seed >> 20) + y) % 12);
+
+      for (i = 0, ptr = line + (x + ((seed >> 24) & 15)) * bpp; i < len; i ++)
+      {
+        unsigned char v = (unsigned char)(i == 0 || i == (len - 1) ? 128 : 0);
+
+        *ptr++ = v;
+        if (bpp == 3)
+        {
+          *ptr++ = v;
+          *ptr++ = v;
+        }
+      }
+    }
+  }
+  else if (bpp == 3 && y >= 500 && y < 510)
+  {
+   /*
+    * Blue rule...
+    */
+
+    for (x = 600, ptr = line + 600 * bpp; x < 4500; x ++)
+    {
+      *ptr++ = 0;
+      *ptr++ = 0;
+      *ptr++ = 192;
+    }
+  }
+}
+
+
 /*
  * 'print_changes()' - Print differences in the page header.
  */
@@ -1620,6 +1620,8 @@ _httpTLSStart(http_t *http)		/* I - HTTP connection */
     * Do the TLS handshake...
     */
 
+    _CUPS_TRACE1(tls__handshake__start, http);
+
     while (!error && !done)
     {
       error = SSLHandshake(http->tls);
@@ -1740,6 +1742,8 @@ _httpTLSStart(http_t *http)		/* I - HTTP connection */
       }
     }
 
+    _CUPS_TRACE2(tls__handshake__end, http, (int)error);
+
    /*
     * Restore the previous timeout settings...
     */
@@ -17,6 +17,24 @@
 #include <sys/stat.h>
 
 
+/*
+ * Local types...
+ */
+
+typedef struct _http_gnutls_server_s	/**** Cached server credentials ****/
+{
+  gnutls_certificate_credentials_t credentials;
+					/* Credentials (must be first) */
+  char			*common_name,	/* Common name */
+			crtfile[1024],	/* Certificate file */
+			keyfile[1024];	/* Private key file */
+  time_t		crtmtime,	/* Modification time of certificate */
+			keymtime;	/* Modification time of private key */
+  int			refcount,	/* Number of connections using it */
+			stale;		/* Removed from cache? */
+} _http_gnutls_server_t;
+
+
 /*
  * Local globals...
  */
@@ -33,17 +51,29 @@ static _cups_mutex_t	tls_mutex = _CUPS_MUTEX_INITIALIZER;
 static int		tls_options = -1,/* Options for TLS connections */
 			tls_min_version = _HTTP_TLS_1_0,
 			tls_max_version = _HTTP_TLS_MAX;
+static gnutls_priority_t tls_priority = NULL;
+					/* Cached priorities */
+static cups_array_t	*tls_servers = NULL;
+					/* Cached server credentials */
+static gnutls_datum_t	tls_ticket_key = { NULL, 0 };
+					/* Server session ticket key */
 
 
 /*
  * Local functions...
  */
 
+static gnutls_certificate_credentials_t *http_gnutls_add_server(const char *common_name, const char *crtfile, const char *keyfile, int *status);
+static gnutls_certificate_credentials_t *http_gnutls_copy_server(const char *common_name);
 static gnutls_x509_crt_t http_gnutls_create_credential(http_credential_t *credential);
 static const char	*http_gnutls_default_path(char *buffer, size_t bufsize);
+static void		http_gnutls_free_credentials(http_t *http, gnutls_certificate_credentials_t *credentials);
+static void		http_gnutls_free_server(_http_gnutls_server_t *server);
+static gnutls_priority_t http_gnutls_get_priority(void);
 static void		http_gnutls_load_crl(void);
 static const char	*http_gnutls_make_path(char *buffer, size_t bufsize, const char *dirname, const char *filename, const char *ext);
 static ssize_t		http_gnutls_read(gnutls_transport_ptr_t ptr, void *data, size_t length);
+static int		http_gnutls_server_compare(_http_gnutls_server_t *a, _http_gnutls_server_t *b, void *data);
 static ssize_t		http_gnutls_write(gnutls_transport_ptr_t ptr, const void *data, size_t length);
 
 
@@ -301,6 +331,23 @@ cupsSetServerCredentials(
   tls_auto_create = auto_create;
   tls_common_name = _cupsStrAlloc(common_name);
 
+ /*
+  * Flush cached credentials from the old keychain...
+  */
+
+  if (tls_servers)
+  {
+    _http_gnutls_server_t *server;	/* Cached credentials */
+
+    for (server = (_http_gnutls_server_t *)cupsArrayFirst(tls_servers); server; server = (_http_gnutls_server_t *)cupsArrayNext(tls_servers))
+    {
+      cupsArrayRemove(tls_servers, server);
+      server->stale = 1;
+      if (server->refcount == 0)
+        http_gnutls_free_server(server);
+    }
+  }
+
   _cupsMutexUnlock(&tls_mutex);
 
   return (1);
@@ -888,6 +935,142 @@ httpSaveCredentials(
 }
 
 
+/*
+ * 'http_gnutls_add_server()' - Load server credentials and add them to the cache.
+ */
+
+static gnutls_certificate_credentials_t *	/* O - Credentials or NULL on error */
+http_gnutls_add_server(
+    const char *common_name,		/* I - Common name */
+    const char *crtfile,		/* I - Certificate file */
+    const char *keyfile,		/* I - Private key file */
+    int        *status)			/* O - GNU TLS status */
+{
+  _http_gnutls_server_t	*server,	/* New credentials */
+			*current;	/* Current credentials */
+  struct stat		fileinfo;	/* File information */
+
+
+  if ((server = (_http_gnutls_server_t *)calloc(1, sizeof(_http_gnutls_server_t))) == NULL || (server->common_name = strdup(common_name)) == NULL)
+  {
+    free(server);
+    *status = GNUTLS_E_MEMORY_ERROR;
+    return (NULL);
+  }
+
+  strlcpy(server->crtfile, crtfile, sizeof(server->crtfile));
+  strlcpy(server->keyfile, keyfile, sizeof(server->keyfile));
+
+  if (!stat(crtfile, &fileinfo))
+    server->crtmtime = fileinfo.st_mtime;
+  if (!stat(keyfile, &fileinfo))
+    server->keymtime = fileinfo.st_mtime;
+
+  if ((*status = gnutls_certificate_allocate_credentials(&server->credentials)) == 0)
+  {
+    if ((*status = gnutls_certificate_set_x509_key_file(server->credentials, crtfile, keyfile, GNUTLS_X509_FMT_PEM)) != 0)
+      gnutls_certificate_free_credentials(server->credentials);
+  }
+
+  if (*status)
+  {
+    free(server->common_name);
+    free(server);
+    return (NULL);
+  }
+
+  server->refcount = 1;
+
+  _cupsMutexLock(&tls_mutex);
+
+  if (!tls_servers)
+    tls_servers = cupsArrayNew((cups_array_func_t)http_gnutls_server_compare, NULL);
+
+  if ((current = (_http_gnutls_server_t *)cupsArrayFind(tls_servers, server)) != NULL)
+  {
+   /*
+    * Another connection loaded the same name, replace it...
+    */
+
+    cupsArrayRemove(tls_servers, current);
+    current->stale = 1;
+    if (current->refcount == 0)
+      http_gnutls_free_server(current);
+  }
+
+  if (cupsArrayCount(tls_servers) >= 64)
+  {
+   /*
+    * Too many names, purge credentials that are not in use...
+    */
+
+    for (current = (_http_gnutls_server_t *)cupsArrayFirst(tls_servers); current; current = (_http_gnutls_server_t *)cupsArrayNext(tls_servers))
+    {
+      if (current->refcount == 0)
+      {
+        cupsArrayRemove(tls_servers, current);
+        http_gnutls_free_server(current);
+      }
+    }
+  }
+
+  if (!cupsArrayAdd(tls_servers, server))
+    server->stale = 1;
+
+  _cupsMutexUnlock(&tls_mutex);
+
+  DEBUG_printf(("4http_gnutls_add_server: Loaded credentials for \"%s\".", common_name));
+
+  return (&server->credentials);
+}
+
+
+/*
+ * 'http_gnutls_copy_server()' - Copy cached server credentials for a common name.
+ *
+ * Returns NULL if the credentials are not cached or the certificate or private
+ * key file has changed since they were loaded.
+ */
+
+static gnutls_certificate_credentials_t *	/* O - Credentials or NULL */
+http_gnutls_copy_server(
+    const char *common_name)		/* I - Common name */
+{
+  _http_gnutls_server_t	key,		/* Search key */
+			*server;	/* Cached credentials */
+  struct stat		crtinfo,	/* Certificate file information */
+			keyinfo;	/* Private key file information */
+
+
+  key.common_name = (char *)common_name;
+
+  _cupsMutexLock(&tls_mutex);
+
+  if ((server = (_http_gnutls_server_t *)cupsArrayFind(tls_servers, &key)) != NULL)
+  {
+    if (!stat(server->crtfile, &crtinfo) && crtinfo.st_mtime == server->crtmtime && !stat(server->keyfile, &keyinfo) && keyinfo.st_mtime == server->keymtime)
+    {
+      server->refcount ++;
+
+      _cupsMutexUnlock(&tls_mutex);
+
+      return (&server->credentials);
+    }
+
+    DEBUG_printf(("4http_gnutls_copy_server: Credentials for \"%s\" have changed.", common_name));
+
+    cupsArrayRemove(tls_servers, server);
+    server->stale = 1;
+    if (server->refcount == 0)
+      http_gnutls_free_server(server);
+  }
+
+  _cupsMutexUnlock(&tls_mutex);
+
+  return (NULL);
+}
+
+
 /*
  * 'http_gnutls_create_credential()' - Create a single credential in the internal format.
  */
@@ -972,6 +1155,139 @@ http_gnutls_default_path(char   *buffer,/* I - Path buffer */
 }
 
 
+/*
+ * 'http_gnutls_free_credentials()' - Free or release the credentials for a connection.
+ */
+
+static void
+http_gnutls_free_credentials(
+    http_t                           *http,	/* I - Connection */
+    gnutls_certificate_credentials_t *credentials)
+					/* I - Credentials */
+{
+  if (!credentials)
+    return;
+
+  if (http->mode == _HTTP_MODE_SERVER)
+  {
+   /*
+    * Server credentials are cached, release the reference...
+    */
+
+    _http_gnutls_server_t *server = (_http_gnutls_server_t *)credentials;
+					/* Cached credentials */
+
+    _cupsMutexLock(&tls_mutex);
+
+    server->refcount --;
+    if (server->refcount == 0 && server->stale)
+      http_gnutls_free_server(server);
+
+    _cupsMutexUnlock(&tls_mutex);
+  }
+  else
+  {
+    gnutls_certificate_free_credentials(*credentials);
+    free(credentials);
+  }
+}
+
+
+/*
+ * 'http_gnutls_free_server()' - Free cached server credentials.
+ */
+
+static void
+http_gnutls_free_server(
+    _http_gnutls_server_t *server)	/* I - Cached credentials */
+{
+  gnutls_certificate_free_credentials(server->credentials);
+  free(server->common_name);
+  free(server);
+}
+
+
+/*
+ * 'http_gnutls_get_priority()' - Get the cached priorities for the current TLS options.
+ *
+ * The caller must hold the TLS mutex.
+ */
+
+static gnutls_priority_t		/* O - Priorities */
+http_gnutls_get_priority(void)
+{
+  char		priority_string[2048];	/* Priority string */
+  int		version;		/* Current version */
+  static const char * const versions[] =/* SSL/TLS versions */
+  {
+    "VERS-SSL3.0",
+    "VERS-TLS1.0",
+    "VERS-TLS1.1",
+    "VERS-TLS1.2",
+    "VERS-TLS1.3",
+    "VERS-TLS-ALL"
+  };
+
+
+  if (tls_priority)
+    return (tls_priority);
+
+  strlcpy(priority_string, "NORMAL", sizeof(priority_string));
+
+  if (tls_max_version < _HTTP_TLS_MAX)
+  {
+   /*
+    * Require specific TLS versions...
+    */
+
+    strlcat(priority_string, ":-VERS-TLS-ALL", sizeof(priority_string));
+    for (version = tls_min_version; version <= tls_max_version; version ++)
+    {
+      strlcat(priority_string, ":+", sizeof(priority_string));
+      strlcat(priority_string, versions[version], sizeof(priority_string));
+    }
+  }
+  else if (tls_min_version == _HTTP_TLS_SSL3)
+  {
+   /*
+    * Allow all versions of TLS and SSL/3.0...
+    */
+
+    strlcat(priority_string, ":+VERS-TLS-ALL:+VERS-SSL3.0", sizeof(priority_string));
+  }
+  else
+  {
+   /*
+    * Require a minimum version...
+    */
+
+    strlcat(priority_string, ":+VERS-TLS-ALL", sizeof(priority_string));
+    for (version = 0; version < tls_min_version; version ++)
+    {
+      strlcat(priority_string, ":-", sizeof(priority_string));
+      strlcat(priority_string, versions[version], sizeof(priority_string));
+    }
+  }
+
+  if (tls_options & _HTTP_TLS_ALLOW_RC4)
+    strlcat(priority_string, ":+ARCFOUR-128", sizeof(priority_string));
+  else
+    strlcat(priority_string, ":!ARCFOUR-128", sizeof(priority_string));
+
+  strlcat(priority_string, ":!ANON-DH", sizeof(priority_string));
+
+  if (tls_options & _HTTP_TLS_DENY_CBC)
+    strlcat(priority_string, ":!AES-128-CBC:!AES-256-CBC:!CAMELLIA-128-CBC:!CAMELLIA-256-CBC:!3DES-CBC", sizeof(priority_string));
+
+  DEBUG_printf(("4http_gnutls_get_priority: priority_string=\"%s\"", priority_string));
+
+  if (gnutls_priority_init(&tls_priority, priority_string, NULL))
+    tls_priority = NULL;
+
+  return (tls_priority);
+}
+
+
 /*
  * 'http_gnutls_load_crl()' - Load the certificate revocation list, if any.
  */
@@ -1145,6 +1461,22 @@ http_gnutls_read(
 }
 
 
+/*
+ * 'http_gnutls_server_compare()' - Compare two cached server credentials.
+ */
+
+static int				/* O - Result of comparison */
+http_gnutls_server_compare(
+    _http_gnutls_server_t *a,		/* I - First credentials */
+    _http_gnutls_server_t *b,		/* I - Second credentials */
+    void                  *data)	/* I - Callback data (unused) */
+{
+  (void)data;
+
+  return (_cups_strcasecmp(a->common_name, b->common_name));
+}
+
+
 /*
  * 'http_gnutls_write()' - Write function for the GNU TLS library.
  */
@@ -1205,9 +1537,18 @@ _httpTLSRead(http_t *http,		/* I - Connection to server */
   ssize_t	result;			/* Return value */
 
 
-  result = gnutls_record_recv(http->tls, buf, (size_t)len);
+  do
+  {
+   /*
+    * Post-handshake messages such as TLS 1.3 session tickets are consumed
+    * without returning any data, so retry blocking reads...
+    */
 
-  if (result < 0 && !errno)
+    result = gnutls_record_recv(http->tls, buf, (size_t)len);
+  }
+  while (http->blocking && (result == GNUTLS_E_AGAIN || result == GNUTLS_E_INTERRUPTED));
+
+  if (result < 0)
   {
    /*
     * Convert GNU TLS error to errno value...
@@ -1246,9 +1587,19 @@ _httpTLSSetOptions(int options,		/* I - Options */
 {
   if (!(options & _HTTP_TLS_SET_DEFAULT) || tls_options < 0)
   {
+    _cupsMutexLock(&tls_mutex);
+
     tls_options     = options;
     tls_min_version = min_version;
     tls_max_version = max_version;
+
+    if (tls_priority)
+    {
+      gnutls_priority_deinit(tls_priority);
+      tls_priority = NULL;
+    }
+
+    _cupsMutexUnlock(&tls_mutex);
   }
 }
 
@@ -1263,23 +1614,12 @@ _httpTLSStart(http_t *http)		/* I - Connection to server */
   char			hostname[256],	/* Hostname */
 			*hostptr;	/* Pointer into hostname */
   int			status;		/* Status of handshake */
-  gnutls_certificate_credentials_t *credentials;
+  gnutls_certificate_credentials_t *credentials = NULL;
 					/* TLS credentials */
-  char			priority_string[2048];
-					/* Priority string */
-  int			version;	/* Current version */
+  gnutls_priority_t	priority;	/* Priorities */
   double		old_timeout;	/* Old timeout value */
   http_timeout_cb_t	old_cb;		/* Old timeout callback */
   void			*old_data;	/* Old timeout data */
-  static const char * const versions[] =/* SSL/TLS versions */
-  {
-    "VERS-SSL3.0",
-    "VERS-TLS1.0",
-    "VERS-TLS1.1",
-    "VERS-TLS1.2",
-    "VERS-TLS1.3",
-    "VERS-TLS-ALL"
-  };
 
 
   DEBUG_printf(("3_httpTLSStart(http=%p)", http));
@@ -1301,20 +1641,6 @@ _httpTLSStart(http_t *http)		/* I - Connection to server */
     return (-1);
   }
 
-  credentials = (gnutls_certificate_credentials_t *)
-                    malloc(sizeof(gnutls_certificate_credentials_t));
-  if (credentials == NULL)
-  {
-    DEBUG_printf(("8_httpStartTLS: Unable to allocate credentials: %s",
-                  strerror(errno)));
-    http->error  = errno;
-    http->status = HTTP_STATUS_ERROR;
-    _cupsSetHTTPError(HTTP_STATUS_ERROR);
-
-    return (-1);
-  }
-
-  gnutls_certificate_allocate_credentials(credentials);
   status = gnutls_init(&http->tls, http->mode == _HTTP_MODE_CLIENT ? GNUTLS_CLIENT : GNUTLS_SERVER);
   if (!status)
     status = gnutls_set_default_priority(http->tls);
@@ -1328,8 +1654,6 @@ _httpTLSStart(http_t *http)		/* I - Connection to server */
     _cupsSetError(IPP_STATUS_ERROR_CUPS_PKI, gnutls_strerror(status), 0);
 
     gnutls_deinit(http->tls);
-    gnutls_certificate_free_credentials(*credentials);
-    free(credentials);
     http->tls = NULL;
 
     return (-1);
@@ -1338,7 +1662,29 @@ _httpTLSStart(http_t *http)		/* I - Connection to server */
   if (http->mode == _HTTP_MODE_CLIENT)
   {
    /*
-    * Client: get the hostname to use for TLS...
+    * Client: allocate credentials...
+    */
+
+    credentials = (gnutls_certificate_credentials_t *)
+                      malloc(sizeof(gnutls_certificate_credentials_t));
+    if (credentials == NULL)
+    {
+      DEBUG_printf(("8_httpStartTLS: Unable to allocate credentials: %s",
+                    strerror(errno)));
+      http->error  = errno;
+      http->status = HTTP_STATUS_ERROR;
+      _cupsSetHTTPError(HTTP_STATUS_ERROR);
+
+      gnutls_deinit(http->tls);
+      http->tls = NULL;
+
+      return (-1);
+    }
+
+    gnutls_certificate_allocate_credentials(credentials);
+
+   /*
+    * Get the hostname to use for TLS...
     */
 
     if (httpAddrLocalhost(http->hostaddr))
@@ -1358,6 +1704,13 @@ _httpTLSStart(http_t *http)		/* I - Connection to server */
     }
 
     status = gnutls_server_name_set(http->tls, GNUTLS_NAME_DNS, hostname, strlen(hostname));
+
+   /*
+    * Resume the previous session, if any...
+    */
+
+    if (!status && http->tls_session.data)
+      gnutls_session_set_data(http->tls, http->tls_session.data, http->tls_session.size);
   }
   else
   {
@@ -1365,9 +1718,7 @@ _httpTLSStart(http_t *http)		/* I - Connection to server */
     * Server: get certificate and private key...
     */
 
-    char	crtfile[1024],		/* Certificate file */
-		keyfile[1024];		/* Private key file */
-    int		have_creds = 0;		/* Have credentials? */
+    const char	*cn;			/* Common name */
 
     if (http->fields[HTTP_FIELD_HOST])
     {
@@ -1404,14 +1755,24 @@ _httpTLSStart(http_t *http)		/* I - Connection to server */
     if (isdigit(hostname[0] & 255) || hostname[0] == '[')
       hostname[0] = '\0';		/* Don't allow numeric addresses */
 
-    if (hostname[0])
+    cn = hostname[0] ? hostname : tls_common_name;
+
+    if (!cn)
+    {
+      DEBUG_puts("4_httpTLSStart: No common name for server credentials.");
+      status = GNUTLS_E_INVALID_REQUEST;
+    }
+    else if ((credentials = http_gnutls_copy_server(cn)) == NULL)
     {
      /*
-      * First look in the CUPS keystore...
+      * Not cached, first look in the CUPS keystore...
       */
 
-      http_gnutls_make_path(crtfile, sizeof(crtfile), tls_keypath, hostname, "crt");
-      http_gnutls_make_path(keyfile, sizeof(keyfile), tls_keypath, hostname, "key");
+      char	crtfile[1024],		/* Certificate file */
+		keyfile[1024];		/* Private key file */
+
+      http_gnutls_make_path(crtfile, sizeof(crtfile), tls_keypath, cn, "crt");
+      http_gnutls_make_path(keyfile, sizeof(keyfile), tls_keypath, cn, "key");
 
       if (access(crtfile, R_OK) || access(keyfile, R_OK))
       {
@@ -1421,10 +1782,10 @@ _httpTLSStart(http_t *http)		/* I - Connection to server */
 
         char cacrtfile[1024], cakeyfile[1024];	/* CA cert files */
 
-        snprintf(cacrtfile, sizeof(cacrtfile), "/etc/letsencrypt/live/%s/fullchain.pem", hostname);
-        snprintf(cakeyfile, sizeof(cakeyfile), "/etc/letsencrypt/live/%s/privkey.pem", hostname);
+        snprintf(cacrtfile, sizeof(cacrtfile), "/etc/letsencrypt/live/%s/fullchain.pem", cn);
+        snprintf(cakeyfile, sizeof(cakeyfile), "/etc/letsencrypt/live/%s/privkey.pem", cn);
 
-        if ((access(cacrtfile, R_OK) || access(cakeyfile, R_OK)) && (hostptr = strchr(hostname, '.')) != NULL)
+        if ((access(cacrtfile, R_OK) || access(cakeyfile, R_OK)) && (hostptr = strchr(cn, '.')) != NULL)
         {
          /*
           * Try just domain name...
@@ -1449,80 +1810,67 @@ _httpTLSStart(http_t *http)		/* I - Connection to server */
         }
       }
 
-      have_creds = !access(crtfile, R_OK) && !access(keyfile, R_OK);
-    }
-    else if (tls_common_name)
-    {
-     /*
-      * First look in the CUPS keystore...
-      */
-
-      http_gnutls_make_path(crtfile, sizeof(crtfile), tls_keypath, tls_common_name, "crt");
-      http_gnutls_make_path(keyfile, sizeof(keyfile), tls_keypath, tls_common_name, "key");
-
-      if (access(crtfile, R_OK) || access(keyfile, R_OK))
+      if ((access(crtfile, R_OK) || access(keyfile, R_OK)) && tls_auto_create)
       {
-       /*
-        * No CUPS-managed certs, look for CA certs...
-        */
-
-        char cacrtfile[1024], cakeyfile[1024];	/* CA cert files */
+	DEBUG_printf(("4_httpTLSStart: Auto-create credentials for \"%s\".", cn));
 
-        snprintf(cacrtfile, sizeof(cacrtfile), "/etc/letsencrypt/live/%s/fullchain.pem", tls_common_name);
-        snprintf(cakeyfile, sizeof(cakeyfile), "/etc/letsencrypt/live/%s/privkey.pem", tls_common_name);
-
-        if ((access(cacrtfile, R_OK) || access(cakeyfile, R_OK)) && (hostptr = strchr(tls_common_name, '.')) != NULL)
-        {
-         /*
-          * Try just domain name...
-          */
-
-          hostptr ++;
-          if (strchr(hostptr, '.'))
-          {
-            snprintf(cacrtfile, sizeof(cacrtfile), "/etc/letsencrypt/live/%s/fullchain.pem", hostptr);
-            snprintf(cakeyfile, sizeof(cakeyfile), "/etc/letsencrypt/live/%s/privkey.pem", hostptr);
-          }
-        }
+	if (!cupsMakeServerCredentials(tls_keypath, cn, 0, NULL, time(NULL) + 365 * 86400))
+	{
+	  DEBUG_puts("4_httpTLSStart: cupsMakeServerCredentials failed.");
+	  http->error  = errno = EINVAL;
+	  http->status = HTTP_STATUS_ERROR;
+	  _cupsSetError(IPP_STATUS_ERROR_INTERNAL, _("Unable to create server credentials."), 1);
 
-        if (!access(cacrtfile, R_OK) && !access(cakeyfile, R_OK))
-        {
-         /*
-          * Use the CA certs...
-          */
+	  gnutls_deinit(http->tls);
+	  http->tls = NULL;
 
-          strlcpy(crtfile, cacrtfile, sizeof(crtfile));
-          strlcpy(keyfile, cakeyfile, sizeof(keyfile));
-        }
+	  return (-1);
+	}
       }
 
-      have_creds = !access(crtfile, R_OK) && !access(keyfile, R_OK);
+      DEBUG_printf(("4_httpTLSStart: Using certificate \"%s\" and private key \"%s\".", crtfile, keyfile));
+
+      credentials = http_gnutls_add_server(cn, crtfile, keyfile, &status);
     }
 
-    if (!have_creds && tls_auto_create && (hostname[0] || tls_common_name))
-    {
-      DEBUG_printf(("4_httpTLSStart: Auto-create credentials for \"%s\".", hostname[0] ? hostname : tls_common_name));
+   /*
+    * Issue session tickets so that clients can resume sessions without a
+    * full handshake.  The ticket key is shared by all connections...
+    */
 
-      if (!cupsMakeServerCredentials(tls_keypath, hostname[0] ? hostname : tls_common_name, 0, NULL, time(NULL) + 365 * 86400))
-      {
-	DEBUG_puts("4_httpTLSStart: cupsMakeServerCredentials failed.");
-	http->error  = errno = EINVAL;
-	http->status = HTTP_STATUS_ERROR;
-	_cupsSetError(IPP_STATUS_ERROR_INTERNAL, _("Unable to create server credentials."), 1);
+    if (!status)
+    {
+      _cupsMutexLock(&tls_mutex);
 
-	return (-1);
-      }
-    }
+      if (!tls_ticket_key.data && gnutls_session_ticket_key_generate(&tls_ticket_key))
+        DEBUG_puts("4_httpTLSStart: Unable to generate session ticket key.");
 
-    DEBUG_printf(("4_httpTLSStart: Using certificate \"%s\" and private key \"%s\".", crtfile, keyfile));
+      _cupsMutexUnlock(&tls_mutex);
 
-    if (!status)
-      status = gnutls_certificate_set_x509_key_file(*credentials, crtfile, keyfile, GNUTLS_X509_FMT_PEM);
+      if (tls_ticket_key.data)
+        gnutls_session_ticket_enable_server(http->tls, &tls_ticket_key);
+    }
   }
 
   if (!status)
     status = gnutls_credentials_set(http->tls, GNUTLS_CRD_CERTIFICATE, *credentials);
 
+ /*
+  * Use the cached priorities for the current TLS options...
+  */
+
+  if (!status)
+  {
+    _cupsMutexLock(&tls_mutex);
+
+    if ((priority = http_gnutls_get_priority()) != NULL)
+      status = gnutls_priority_set(http->tls, priority);
+    else
+      status = GNUTLS_E_INVALID_REQUEST;
+
+    _cupsMutexUnlock(&tls_mutex);
+  }
+
   if (status)
   {
     http->error  = EIO;
@@ -1532,71 +1880,12 @@ _httpTLSStart(http_t *http)		/* I - Connection to server */
     _cupsSetError(IPP_STATUS_ERROR_CUPS_PKI, gnutls_strerror(status), 0);
 
     gnutls_deinit(http->tls);
-    gnutls_certificate_free_credentials(*credentials);
-    free(credentials);
+    http_gnutls_free_credentials(http, credentials);
     http->tls = NULL;
 
     return (-1);
   }
 
-  strlcpy(priority_string, "NORMAL", sizeof(priority_string));
-
-  if (tls_max_version < _HTTP_TLS_MAX)
-  {
-   /*
-    * Require specific TLS versions...
-    */
-
-    strlcat(priority_string, ":-VERS-TLS-ALL", sizeof(priority_string));
-    for (version = tls_min_version; version <= tls_max_version; version ++)
-    {
-      strlcat(priority_string, ":+", sizeof(priority_string));
-      strlcat(priority_string, versions[version], sizeof(priority_string));
-    }
-  }
-  else if (tls_min_version == _HTTP_TLS_SSL3)
-  {
-   /*
-    * Allow all versions of TLS and SSL/3.0...
-    */
-
-    strlcat(priority_string, ":+VERS-TLS-ALL:+VERS-SSL3.0", sizeof(priority_string));
-  }
-  else
-  {
-   /*
-    * Require a minimum version...
-    */
-
-    strlcat(priority_string, ":+VERS-TLS-ALL", sizeof(priority_string));
-    for (version = 0; version < tls_min_version; version ++)
-    {
-      strlcat(priority_string, ":-", sizeof(priority_string));
-      strlcat(priority_string, versions[version], sizeof(priority_string));
-    }
-  }
-
-  if (tls_options & _HTTP_TLS_ALLOW_RC4)
-    strlcat(priority_string, ":+ARCFOUR-128", sizeof(priority_string));
-  else
-    strlcat(priority_string, ":!ARCFOUR-128", sizeof(priority_string));
-
-  strlcat(priority_string, ":!ANON-DH", sizeof(priority_string));
-
-  if (tls_options & _HTTP_TLS_DENY_CBC)
-    strlcat(priority_string, ":!AES-128-CBC:!AES-256-CBC:!CAMELLIA-128-CBC:!CAMELLIA-256-CBC:!3DES-CBC", sizeof(priority_string));
-
-#ifdef HAVE_GNUTLS_PRIORITY_SET_DIRECT
-  gnutls_priority_set_direct(http->tls, priority_string, NULL);
-
-#else
-  gnutls_priority_t priority;		/* Priority */
-
-  gnutls_priority_init(&priority, priority_string, NULL);
-  gnutls_priority_set(http->tls, priority);
-  gnutls_priority_deinit(priority);
-#endif /* HAVE_GNUTLS_PRIORITY_SET_DIRECT */
-
   gnutls_transport_set_ptr(http->tls, (gnutls_transport_ptr_t)http);
   gnutls_transport_set_pull_function(http->tls, http_gnutls_read);
 #ifdef HAVE_GNUTLS_TRANSPORT_SET_PULL_TIMEOUT_FUNCTION
@@ -1622,6 +1911,8 @@ _httpTLSStart(http_t *http)		/* I - Connection to server */
   * Do the TLS handshake...
   */
 
+  _CUPS_TRACE1(tls__handshake__start, http);
+
   while ((status = gnutls_handshake(http->tls)) != GNUTLS_E_SUCCESS)
   {
     DEBUG_printf(("5_httpStartTLS: gnutls_handshake returned %d (%s)",
@@ -1629,14 +1920,15 @@ _httpTLSStart(http_t *http)		/* I - Connection to server */
 
     if (gnutls_error_is_fatal(status))
     {
+      _CUPS_TRACE2(tls__handshake__end, http, status);
+
       http->error  = EIO;
       http->status = HTTP_STATUS_ERROR;
 
       _cupsSetError(IPP_STATUS_ERROR_CUPS_PKI, gnutls_strerror(status), 0);
 
       gnutls_deinit(http->tls);
-      gnutls_certificate_free_credentials(*credentials);
-      free(credentials);
+      http_gnutls_free_credentials(http, credentials);
       http->tls = NULL;
 
       httpSetTimeout(http, old_timeout, old_cb, old_data);
@@ -1645,6 +1937,8 @@ _httpTLSStart(http_t *http)		/* I - Connection to server */
     }
   }
 
+  _CUPS_TRACE2(tls__handshake__end, http, status);
+
  /*
   * Restore the previous timeout settings...
   */
@@ -1653,6 +1947,8 @@ _httpTLSStart(http_t *http)		/* I - Connection to server */
 
   http->tls_credentials = credentials;
 
+  DEBUG_printf(("4_httpTLSStart: Session %s.", gnutls_session_is_resumed(http->tls) ? "resumed" : "created"));
+
   return (0);
 }
 
@@ -1667,6 +1963,27 @@ _httpTLSStop(http_t *http)		/* I - Connection to server */
   int	error;				/* Error code */
 
 
+  if (http->mode == _HTTP_MODE_CLIENT)
+  {
+   /*
+    * Save the session so that the next connection (httpReconnect) can
+    * resume it...
+    */
+
+    if (http->tls_session.data)
+    {
+      gnutls_free(http->tls_session.data);
+      http->tls_session.data = NULL;
+      http->tls_session.size = 0;
+    }
+
+    if (gnutls_session_get_data2(http->tls, &http->tls_session))
+    {
+      http->tls_session.data = NULL;
+      http->tls_session.size = 0;
+    }
+  }
+
   error = gnutls_bye(http->tls, http->mode == _HTTP_MODE_CLIENT ? GNUTLS_SHUT_RDWR : GNUTLS_SHUT_WR);
   if (error != GNUTLS_E_SUCCESS)
     _cupsSetError(IPP_STATUS_ERROR_INTERNAL, gnutls_strerror(errno), 0);
@@ -1674,12 +1991,8 @@ _httpTLSStop(http_t *http)		/* I - Connection to server */
   gnutls_deinit(http->tls);
   http->tls = NULL;
 
-  if (http->tls_credentials)
-  {
-    gnutls_certificate_free_credentials(*(http->tls_credentials));
-    free(http->tls_credentials);
-    http->tls_credentials = NULL;
-  }
+  http_gnutls_free_credentials(http, http->tls_credentials);
+  http->tls_credentials = NULL;
 }
 
 
@@ -114,13 +114,28 @@ cupsCharsetToUTF8(
   if (encoding == CUPS_ISO8859_1)
   {
     int		ch;			/* Character from string */
+    const char	*srcend;		/* End of source string */
     cups_utf8_t	*destend;		/* End of UTF-8 buffer */
+    size_t	count;			/* Number of ASCII characters */
 
 
+    srcend  = src + strlen(src);
     destend = dest + maxout - 2;
 
-    while (*src && destptr < destend)
+    while (src < srcend && destptr < destend)
     {
+     /*
+      * Copy runs of ASCII in bulk...
+      */
+
+      if ((count = _cupsStrASCIISpan(src, (size_t)(srcend - src) < (size_t)(destend - destptr) ? (size_t)(srcend - src) : (size_t)(destend - destptr), 0)) > 0)
+      {
+        memcpy(destptr, src, count);
+        src     += count;
+        destptr += count;
+        continue;
+      }
+
       ch = *src++ & 255;
 
       if (ch & 128)
@@ -236,13 +251,28 @@ cupsUTF8ToCharset(
   {
     int		ch,			/* Character from string */
 		maxch;			/* Maximum character for charset */
+    const cups_utf8_t *srcend;		/* End of source string */
     char	*destend;		/* End of ISO-8859-1 buffer */
+    size_t	count;			/* Number of ASCII characters */
 
     maxch   = encoding == CUPS_ISO8859_1 ? 256 : 128;
+    srcend  = src + strlen((char *)src);
     destend = dest + maxout - 1;
 
-    while (*src && destptr < destend)
+    while (src < srcend && destptr < destend)
     {
+     /*
+      * Copy runs of ASCII in bulk...
+      */
+
+      if ((count = _cupsStrASCIISpan((char *)src, (size_t)(srcend - src) < (size_t)(destend - destptr) ? (size_t)(srcend - src) : (size_t)(destend - destptr), 0)) > 0)
+      {
+        memcpy(destptr, src, count);
+        src     += count;
+        destptr += count;
+        continue;
+      }
+
       ch = *src++;
 
       if ((ch & 0xe0) == 0xc0)
@@ -72,7 +72,8 @@ typedef struct _cups_client_conf_s	/**** client.conf config data ****/
 			ssl_min_version,/* Minimum SSL/TLS version */
 			ssl_max_version;/* Maximum SSL/TLS version */
 #endif /* HAVE_SSL */
-  int			trust_first,	/* Trust on first use? */
+  int			discovery_cache,/* Discovery cache lifetime in seconds */
+			trust_first,	/* Trust on first use? */
 			any_root,	/* Allow any (e.g., self-signed) root */
 			expired_certs,	/* Allow expired certs */
 			validate_certs;	/* Validate certificates */
@@ -1035,6 +1036,9 @@ _cupsSetDefaults(void)
     strlcpy(cg->gss_service_name, cc.gss_service_name, sizeof(cg->gss_service_name));
 #endif /* HAVE_GSSAPI */
 
+  if (cg->discovery_cache < 0)
+    cg->discovery_cache = cc.discovery_cache;
+
   if (cg->trust_first < 0)
     cg->trust_first = cc.trust_first;
 
@@ -1132,6 +1136,9 @@ cups_finalize_client_conf(
   if ((value = getenv("CUPS_ANYROOT")) != NULL)
     cc->any_root = cups_boolean_value(value);
 
+  if ((value = getenv("CUPS_DISCOVERYCACHE")) != NULL)
+    cc->discovery_cache = atoi(value);
+
   if ((value = getenv("CUPS_ENCRYPTION")) != NULL)
     cups_set_encryption(cc, value);
 
@@ -1159,6 +1166,9 @@ cups_finalize_client_conf(
   if (cc->trust_first < 0)
     cc->trust_first = 1;
 
+  if (cc->discovery_cache < 0)
+    cc->discovery_cache = 0;
+
   if (cc->any_root < 0)
     cc->any_root = 1;
 
@@ -1271,6 +1281,7 @@ cups_init_client_conf(
   cc->ssl_max_version = _HTTP_TLS_MAX;
 #endif /* HAVE_SSL */
   cc->encryption      = (http_encryption_t)-1;
+  cc->discovery_cache = -1;
   cc->trust_first     = -1;
   cc->any_root        = -1;
   cc->expired_certs   = -1;
@@ -1356,6 +1367,8 @@ cups_read_client_conf(
   {
     if (!_cups_strcasecmp(line, "DigestOptions") && value)
       cups_set_digestoptions(cc, value);
+    else if (!_cups_strcasecmp(line, "DiscoveryCache") && value)
+      cc->discovery_cache = atoi(value);
     else if (!_cups_strcasecmp(line, "Encryption") && value)
       cups_set_encryption(cc, value);
 #ifndef __APPLE__
@@ -25,6 +25,9 @@
 #    include <security/pam_appl.h>
 #  endif /* HAVE_PAM_PAM_APPL_H */
 #endif /* HAVE_LIBPAM */
+#ifdef HAVE_GNUTLS
+#  include <gnutls/crypto.h>
+#endif /* HAVE_GNUTLS */
 
 
 /*
@@ -37,11 +40,65 @@ typedef struct server_authdata_s	/* Authentication data */
 	*password;			/* Password string */
 } server_authdata_t;
 
+#define SERVER_AUTHCACHE_MAX	256	/* Maximum number of cached authentications */
+
+typedef struct server_authcache_s	/* Cached authentication */
+{
+  unsigned char	hash[32];		/* Salted SHA2-256 hash of credentials */
+  char		username[256];		/* Username string */
+  time_t	expire;			/* Expiration time */
+} server_authcache_t;
+
+#ifndef _WIN32
+#  define SERVER_GROUPCACHE_MAX	256	/* Maximum number of cached group lists */
+
+#  ifdef __APPLE__
+typedef int server_groupid_t;		/* getgrouplist group ID */
+#  else
+typedef gid_t server_groupid_t;		/* getgrouplist group ID */
+#  endif /* __APPLE__ */
+
+typedef struct server_groupcache_s	/* Cached group membership */
+{
+  char			username[256];	/* Username string */
+  int			ngroups;	/* Number of groups or -1 if unknown user/groups */
+  server_groupid_t	*groups;	/* Group list */
+  time_t		expire;		/* Expiration time */
+} server_groupcache_t;
+#endif /* !_WIN32 */
+
+
+/*
+ * Local globals...
+ */
+
+static _cups_mutex_t	authcache_mutex = _CUPS_MUTEX_INITIALIZER;
+					/* Mutex for authentication cache */
+static cups_array_t	*authcache = NULL;
+					/* Cached authentications */
+static unsigned char	authcache_salt[16];
+					/* Salt for credential hashes */
+#ifndef _WIN32
+static cups_array_t	*groupcache = NULL;
+					/* Cached group memberships */
+#endif /* !_WIN32 */
+
 
 /*
  * Local functions...
  */
 
+#ifdef HAVE_LIBPAM
+static void	authcache_add(const char *username, const char *password);
+#endif /* HAVE_LIBPAM */
+static int	authcache_compare(server_authcache_t *a, server_authcache_t *b);
+static int	authcache_find(const char *username, const char *password);
+static int	authcache_hash(const char *username, const char *password, unsigned char *hash);
+#ifndef _WIN32
+static int	get_groups(server_client_t *client, server_groupid_t *groups, int ngroups);
+static int	groupcache_compare(server_groupcache_t *a, server_groupcache_t *b);
+static void	groupcache_free(server_groupcache_t *entry);
+#endif /* !_WIN32 */
 #ifdef HAVE_LIBPAM
 static int	pam_func(int num_msg, const struct pam_message **msg, struct pam_response **resp, server_authdata_t *data);
 #endif /* HAVE_LIBPAM */
@@ -72,7 +129,7 @@ serverAuthenticateClient(
 
   authorization = httpGetField(client->http, HTTP_FIELD_AUTHORIZATION);
 
-//  serverLogClient(SERVER_LOGLEVEL_DEBUG, client, "Authorization: %s", authorization);
+//  SERVER_LOG_CLIENT_DEBUG(client, "Authorization: %s", authorization);
 
   if (!*authorization)
   {
@@ -114,7 +171,7 @@ serverAuthenticateClient(
       *password++ = '\0';
       data.password = password;
 
-//      serverLogClient(SERVER_LOGLEVEL_DEBUG, client, "username='%s', password='%s'", data.username, data.password);
+//      SERVER_LOG_CLIENT_DEBUG(client, "username='%s', password='%s'", data.username, data.password);
 
       if (!data.username[0])
       {
@@ -126,6 +183,14 @@ serverAuthenticateClient(
 	serverLogClient(SERVER_LOGLEVEL_ERROR, client, "Empty password.");
 	status = HTTP_STATUS_UNAUTHORIZED;
       }
+      else if (AuthService && authcache_find(data.username, data.password))
+      {
+       /*
+        * Same credentials were recently authenticated...
+        */
+
+        SERVER_LOG_CLIENT_DEBUG(client, "Using cached authentication.");
+      }
       else if (!AuthService)
       {
 	if (strcmp(data.password, AuthTestPassword))
@@ -151,42 +216,49 @@ serverAuthenticateClient(
 
 	if ((pamerr = pam_start(AuthService, data.username, &pamdata, &pamh)) != PAM_SUCCESS)
 	{
-	  serverLogClient(SERVER_LOGLEVEL_DEBUG, client, "pam_start() returned %d (%s)", pamerr, pam_strerror(pamh, pamerr));
+	  SERVER_LOG_CLIENT_DEBUG(client, "pam_start() returned %d (%s)", pamerr, pam_strerror(pamh, pamerr));
 	}
 
 #  ifdef PAM_RHOST
 	else if ((pamerr = pam_set_item(pamh, PAM_RHOST, client->hostname)) != PAM_SUCCESS)
 	{
-	  serverLogClient(SERVER_LOGLEVEL_DEBUG, client, "pam_set_item(PAM_RHOST) returned %d (%s)", pamerr, pam_strerror(pamh, pamerr));
+	  SERVER_LOG_CLIENT_DEBUG(client, "pam_set_item(PAM_RHOST) returned %d (%s)", pamerr, pam_strerror(pamh, pamerr));
 	}
 #  endif /* PAM_RHOST */
 
 #  ifdef PAM_TTY
 	else if ((pamerr = pam_set_item(pamh, PAM_TTY, "ippserver")) != PAM_SUCCESS)
 	{
-	  serverLogClient(SERVER_LOGLEVEL_DEBUG, client, "pam_set_item(PAM_TTY) returned %d (%s)", pamerr, pam_strerror(pamh, pamerr));
+	  SERVER_LOG_CLIENT_DEBUG(client, "pam_set_item(PAM_TTY) returned %d (%s)", pamerr, pam_strerror(pamh, pamerr));
 	}
 #  endif /* PAM_TTY */
 
 	else if ((pamerr = pam_authenticate(pamh, PAM_SILENT)) != PAM_SUCCESS)
 	{
-	  serverLogClient(SERVER_LOGLEVEL_DEBUG, client, "pam_authenticate() returned %d (%s)", pamerr, pam_strerror(pamh, pamerr));
+	  SERVER_LOG_CLIENT_DEBUG(client, "pam_authenticate() returned %d (%s)", pamerr, pam_strerror(pamh, pamerr));
 	}
 	else if ((pamerr = pam_setcred(pamh, PAM_ESTABLISH_CRED | PAM_SILENT)) != PAM_SUCCESS)
 	{
-	  serverLogClient(SERVER_LOGLEVEL_DEBUG, client, "pam_setcred() returned %d (%s)", pamerr, pam_strerror(pamh, pamerr));
+	  SERVER_LOG_CLIENT_DEBUG(client, "pam_setcred() returned %d (%s)", pamerr, pam_strerror(pamh, pamerr));
 	}
 	else if ((pamerr = pam_acct_mgmt(pamh, PAM_SILENT)) != PAM_SUCCESS)
 	{
-	  serverLogClient(SERVER_LOGLEVEL_DEBUG, client, "pam_acct_mgmt() returned %d (%s)", pamerr, pam_strerror(pamh, pamerr));
+	  SERVER_LOG_CLIENT_DEBUG(client, "pam_acct_mgmt() returned %d (%s)", pamerr, pam_strerror(pamh, pamerr));
 	}
 
 	if (pamh)
 	  pam_end(pamh, PAM_SUCCESS);
 
-	if (pamerr == PAM_AUTH_ERR)
+	if (pamerr == PAM_SUCCESS)
+	{
+	  authcache_add(data.username, data.password);
+	}
+	else if (pamerr == PAM_AUTH_ERR)
+	{
+	  serverClearAuthCache(data.username);
 	  status = HTTP_STATUS_UNAUTHORIZED;
-	else if (pamerr != PAM_SUCCESS)
+	}
+	else
 	  status = HTTP_STATUS_SERVER_ERROR;
       }
 
@@ -231,14 +303,9 @@ serverAuthorizeUser(
     const char      *scope)		/* I - Access scope */
 {
 #ifndef _WIN32
-  struct passwd	*pw;			/* User account information */
   int		i,			/* Looping var */
 		ngroups;		/* Number of groups for user */
-#  ifdef __APPLE__
-  int		groups[2048];		/* Group list */
-#  else
-  gid_t		groups[2048];		/* Group list */
-#  endif /* __APPLE__ */
+  server_groupid_t groups[2048];	/* Group list */
 #endif /* !_WIN32 */
 
 
@@ -249,12 +316,12 @@ serverAuthorizeUser(
 
   if (!strcmp(scope, SERVER_SCOPE_ALL))
   {
-    serverLogClient(SERVER_LOGLEVEL_DEBUG, client, "User \"%s\" is authorized because scope is \"all\".", client->username);
+    SERVER_LOG_CLIENT_DEBUG(client, "User \"%s\" is authorized because scope is \"all\".", client->username);
     return (1);
   }
   else if (!strcmp(scope, SERVER_SCOPE_NONE))
   {
-    serverLogClient(SERVER_LOGLEVEL_DEBUG, client, "User \"%s\" not authorized because scope is \"none\".", client->username);
+    SERVER_LOG_CLIENT_DEBUG(client, "User \"%s\" not authorized because scope is \"none\".", client->username);
     return (0);
   }
 
@@ -265,7 +332,7 @@ serverAuthorizeUser(
 
   if (!client->username[0])
   {
-    serverLogClient(SERVER_LOGLEVEL_DEBUG, client, "No authenticated user name, not authorized.");
+    SERVER_LOG_CLIENT_DEBUG(client, "No authenticated user name, not authorized.");
     return (0);
   }
 
@@ -275,7 +342,7 @@ serverAuthorizeUser(
 
   if (owner && !strcmp(client->username, owner) && strcmp(scope, SERVER_SCOPE_ADMIN))
   {
-    serverLogClient(SERVER_LOGLEVEL_DEBUG, client, "User \"%s\" is authorized because they are the owner.", client->username);
+    SERVER_LOG_CLIENT_DEBUG(client, "User \"%s\" is authorized because they are the owner.", client->username);
     return (1);
   }
 
@@ -284,36 +351,17 @@ serverAuthorizeUser(
   * Currently Windows does not support group tests, so everything matches...
   */
 
-  serverLogClient(SERVER_LOGLEVEL_DEBUG, client, "User \"%s\" is authorized because groups are currently not validated on Windows.", client->username);
+  SERVER_LOG_CLIENT_DEBUG(client, "User \"%s\" is authorized because groups are currently not validated on Windows.", client->username);
 
   return (1);
 
 #else
- /*
-  * If the user does not exist, it cannot be authorized against a group...
-  */
-
-  if ((pw = getpwnam(client->username)) == NULL)
-  {
-    serverLogClient(SERVER_LOGLEVEL_DEBUG, client, "User \"%s\" does not have a local account.", client->username);
-    return (0);
-  }
-
  /*
   * Check group membership...
   */
 
-  ngroups = (int)(sizeof(groups) / sizeof(groups[0]));
-
-#  ifdef __APPLE__
-  if (getgrouplist(client->username, (int)pw->pw_gid, groups, &ngroups))
-#  else
-  if (getgrouplist(client->username, pw->pw_gid, groups, &ngroups))
-#  endif /* __APPLE__ */
-  {
-    serverLogClient(SERVER_LOGLEVEL_DEBUG, client, "User \"%s\" not authorized because the group list could not be retrieved: %s", client->username, strerror(errno));
+  if ((ngroups = get_groups(client, groups, (int)(sizeof(groups) / sizeof(groups[0])))) < 0)
     return (0);
-  }
 
   if (group != SERVER_GROUP_NONE)
   {
@@ -323,7 +371,7 @@ serverAuthorizeUser(
 
     if (i < ngroups)
     {
-      serverLogClient(SERVER_LOGLEVEL_DEBUG, client, "User \"%s\" is authorized because they are a group member.", client->username);
+      SERVER_LOG_CLIENT_DEBUG(client, "User \"%s\" is authorized because they are a group member.", client->username);
       return (1);
     }
   }
@@ -352,21 +400,58 @@ serverAuthorizeUser(
   if (i < ngroups)
   {
     if ((gid_t)groups[i] == AuthAdminGroup)
-      serverLogClient(SERVER_LOGLEVEL_DEBUG, client, "User \"%s\" is authorized because they are an administrator.", client->username);
+      SERVER_LOG_CLIENT_DEBUG(client, "User \"%s\" is authorized because they are an administrator.", client->username);
     else
-      serverLogClient(SERVER_LOGLEVEL_DEBUG, client, "User \"%s\" is authorized because they are an operator.", client->username);
+      SERVER_LOG_CLIENT_DEBUG(client, "User \"%s\" is authorized because they are an operator.", client->username);
 
     return (1);
   }
   else
   {
-    serverLogClient(SERVER_LOGLEVEL_DEBUG, client, "User \"%s\" not authorized because they failed the group test.", client->username);
+    SERVER_LOG_CLIENT_DEBUG(client, "User \"%s\" not authorized because they failed the group test.", client->username);
     return (0);
   }
 #endif /* _WIN32 */
 }
 
 
+/*
+ * 'serverClearAuthCache()' - Forget cached authentications and group
+ *                            memberships.
+ */
+
+void
+serverClearAuthCache(
+    const char *username)		/* I - Username or `NULL` for all users */
+{
+  server_authcache_t	*entry;		/* Current entry */
+
+
+#ifndef _WIN32
+  server_groupcache_t	*gentry;	/* Current group entry */
+#endif /* !_WIN32 */
+
+
+  _cupsMutexLock(&authcache_mutex);
+
+  for (entry = (server_authcache_t *)cupsArrayFirst(authcache); entry; entry = (server_authcache_t *)cupsArrayNext(authcache))
+  {
+    if (!username || !strcmp(entry->username, username))
+      cupsArrayRemove(authcache, entry);
+  }
+
+#ifndef _WIN32
+  for (gentry = (server_groupcache_t *)cupsArrayFirst(groupcache); gentry; gentry = (server_groupcache_t *)cupsArrayNext(groupcache))
+  {
+    if (!username || !strcmp(gentry->username, username))
+      cupsArrayRemove(groupcache, gentry);
+  }
+#endif /* !_WIN32 */
+
+  _cupsMutexUnlock(&authcache_mutex);
+}
+
+
 /*
  * 'serverMakeVCARD()' - Make a VCARD for the named user.
  */
@@ -468,6 +553,353 @@ serverMakeVCARD(const char *user,	/* I - User name or `NULL` for current user */
 }
 
 
+#ifdef HAVE_LIBPAM
+/*
+ * 'authcache_add()' - Remember a successful authentication.
+ */
+
+static void
+authcache_add(const char *username,	/* I - Username */
+              const char *password)	/* I - Password */
+{
+  server_authcache_t	key,		/* Search key */
+			*entry,		/* Current entry */
+			*oldest;	/* Entry that expires first */
+  time_t		curtime;	/* Current time */
+
+
+  if (AuthCacheLifetime <= 0)
+    return;
+
+  curtime = time(NULL);
+
+  _cupsMutexLock(&authcache_mutex);
+
+  if (!authcache)
+    authcache = cupsArrayNew3((cups_array_func_t)authcache_compare, NULL, NULL, 0, NULL, (cups_afree_func_t)free);
+
+  if (!authcache_hash(username, password, key.hash))
+  {
+    _cupsMutexUnlock(&authcache_mutex);
+    return;
+  }
+
+  if ((entry = (server_authcache_t *)cupsArrayFind(authcache, &key)) == NULL)
+  {
+   /*
+    * Make room for the new entry, first by removing expired entries and then
+    * the entry that expires first...
+    */
+
+    if (cupsArrayCount(authcache) >= SERVER_AUTHCACHE_MAX)
+    {
+      for (entry = (server_authcache_t *)cupsArrayFirst(authcache), oldest = NULL; entry; entry = (server_authcache_t *)cupsArrayNext(authcache))
+      {
+        if (entry->expire <= curtime)
+          cupsArrayRemove(authcache, entry);
+        else if (!oldest || entry->expire < oldest->expire)
+          oldest = entry;
+      }
+
+      if (oldest && cupsArrayCount(authcache) >= SERVER_AUTHCACHE_MAX)
+        cupsArrayRemove(authcache, oldest);
+    }
+
+    if ((entry = (server_authcache_t *)calloc(1, sizeof(server_authcache_t))) != NULL)
+    {
+      memcpy(entry->hash, key.hash, sizeof(entry->hash));
+      strlcpy(entry->username, username, sizeof(entry->username));
+      cupsArrayAdd(authcache, entry);
+    }
+  }
+
+  if (entry)
+    entry->expire = curtime + AuthCacheLifetime;
+
+  _cupsMutexUnlock(&authcache_mutex);
+}
+#endif /* HAVE_LIBPAM */
+
+
+/*
+ * 'authcache_compare()' - Compare two cached authentications.
+ */
+
+static int				/* O - Result of comparison */
+authcache_compare(
+    server_authcache_t *a,		/* I - First entry */
+    server_authcache_t *b)		/* I - Second entry */
+{
+  return (memcmp(a->hash, b->hash, sizeof(a->hash)));
+}
+
+
+/*
+ * 'authcache_find()' - See if the credentials were recently authenticated.
+ */
+
+static int				/* O - 1 if cached, 0 otherwise */
+authcache_find(const char *username,	/* I - Username */
+               const char *password)	/* I - Password */
+{
+  server_authcache_t	key,		/* Search key */
+			*entry;		/* Matching entry */
+  int			ret = 0;	/* Return value */
+
+
+  if (AuthCacheLifetime <= 0 || !authcache)
+    return (0);
+
+  _cupsMutexLock(&authcache_mutex);
+
+  if (authcache_hash(username, password, key.hash) && (entry = (server_authcache_t *)cupsArrayFind(authcache, &key)) != NULL)
+  {
+    if (entry->expire > time(NULL))
+      ret = 1;
+    else
+      cupsArrayRemove(authcache, entry);
+  }
+
+  _cupsMutexUnlock(&authcache_mutex);
+
+  return (ret);
+}
+
+
+/*
+ * 'authcache_hash()' - Compute the salted hash of a username and password.
+ *
+ * The authentication cache mutex must be held.
+ */
+
+static int				/* O - 1 on success, 0 on failure */
+authcache_hash(const char    *username,	/* I - Username */
+               const char    *password,	/* I - Password */
+               unsigned char *hash)	/* O - Hash (32 bytes) */
+{
+  unsigned char		data[sizeof(authcache_salt) + 512],
+					/* Data to hash */
+			digest[64];	/* Hash buffer */
+  size_t		userlen,	/* Length of username */
+			passlen;	/* Length of password */
+  ssize_t		hashlen;	/* Length of hash */
+  static int		salted = 0;	/* Salt initialized? */
+
+
+  if (!salted)
+  {
+   /*
+    * Get the salt from the TLS library's random number generator, falling
+    * back on the system's cryptographic generator.  Nothing is cached if
+    * no strong random data is available...
+    */
+
+#ifdef HAVE_GNUTLS
+    if (gnutls_rnd(GNUTLS_RND_KEY, authcache_salt, sizeof(authcache_salt)))
+      return (0);
+
+#elif defined(HAVE_ARC4RANDOM)
+    arc4random_buf(authcache_salt, sizeof(authcache_salt));
+
+#else
+    int		fd;			/* /dev/urandom file */
+    ssize_t	bytes = -1;		/* Bytes read */
+
+    if ((fd = open("/dev/urandom", O_RDONLY | O_BINARY)) >= 0)
+    {
+      bytes = read(fd, authcache_salt, sizeof(authcache_salt));
+      close(fd);
+    }
+
+    if (bytes != (ssize_t)sizeof(authcache_salt))
+      return (0);
+#endif /* HAVE_GNUTLS */
+
+    salted = 1;
+  }
+
+  userlen = strlen(username) + 1;
+  passlen = strlen(password);
+
+  if ((sizeof(authcache_salt) + userlen + passlen) > sizeof(data))
+    return (0);
+
+  memcpy(data, authcache_salt, sizeof(authcache_salt));
+  memcpy(data + sizeof(authcache_salt), username, userlen);
+  memcpy(data + sizeof(authcache_salt) + userlen, password, passlen);
+
+  hashlen = cupsHashData("sha2-256", data, sizeof(authcache_salt) + userlen + passlen, digest, sizeof(digest));
+
+  memset(data, 0, sizeof(data));
+
+  if (hashlen != 32)
+    return (0);
+
+  memcpy(hash, digest, 32);
+
+  return (1);
+}
+
+
+#ifndef _WIN32
+/*
+ * 'get_groups()' - Get the group list for the authenticated user.
+ *
+ * Group lists are cached for AuthGroupCacheLifetime seconds, including the
+ * failure to find a user or their groups.
+ */
+
+static int				/* O - Number of groups or -1 on error */
+get_groups(server_client_t  *client,	/* I - Client connection */
+           server_groupid_t *groups,	/* I - Group list buffer */
+           int              ngroups)	/* I - Size of group list buffer */
+{
+  struct passwd		*pw;		/* User account information */
+  server_groupcache_t	key,		/* Search key */
+			*entry,		/* Cached entry */
+			*oldest;	/* Entry that expires first */
+  time_t		curtime;	/* Current time */
+
+
+  curtime = time(NULL);
+
+  if (AuthGroupCacheLifetime > 0)
+  {
+   /*
+    * Use the cached group list, if any...
+    */
+
+    strlcpy(key.username, client->username, sizeof(key.username));
+
+    _cupsMutexLock(&authcache_mutex);
+
+    if ((entry = (server_groupcache_t *)cupsArrayFind(groupcache, &key)) != NULL)
+    {
+      if (entry->expire > curtime)
+      {
+        if ((ngroups = entry->ngroups) > 0)
+          memcpy(groups, entry->groups, (size_t)ngroups * sizeof(server_groupid_t));
+
+        _cupsMutexUnlock(&authcache_mutex);
+
+        if (ngroups < 0)
+          SERVER_LOG_CLIENT_DEBUG(client, "User \"%s\" not authorized because the local account or group list was not found (cached).", client->username);
+
+        return (ngroups);
+      }
+
+      cupsArrayRemove(groupcache, entry);
+    }
+
+    _cupsMutexUnlock(&authcache_mutex);
+  }
+
+ /*
+  * If the user does not exist, it cannot be authorized against a group...
+  */
+
+  if ((pw = getpwnam(client->username)) == NULL)
+  {
+    SERVER_LOG_CLIENT_DEBUG(client, "User \"%s\" does not have a local account.", client->username);
+    ngroups = -1;
+  }
+#  ifdef __APPLE__
+  else if (getgrouplist(client->username, (int)pw->pw_gid, groups, &ngroups) < 0)
+#  else
+  else if (getgrouplist(client->username, pw->pw_gid, groups, &ngroups) < 0)
+#  endif /* __APPLE__ */
+  {
+    SERVER_LOG_CLIENT_DEBUG(client, "User \"%s\" not authorized because the group list could not be retrieved: %s", client->username, strerror(errno));
+    ngroups = -1;
+  }
+
+  if (AuthGroupCacheLifetime <= 0)
+    return (ngroups);
+
+ /*
+  * Cache the result...
+  */
+
+  if ((entry = (server_groupcache_t *)calloc(1, sizeof(server_groupcache_t))) == NULL)
+    return (ngroups);
+
+  if (ngroups > 0 && (entry->groups = (server_groupid_t *)malloc((size_t)ngroups * sizeof(server_groupid_t))) == NULL)
+  {
+    free(entry);
+    return (ngroups);
+  }
+
+  strlcpy(entry->username, client->username, sizeof(entry->username));
+  entry->ngroups = ngroups;
+  entry->expire  = curtime + AuthGroupCacheLifetime;
+
+  if (ngroups > 0)
+    memcpy(entry->groups, groups, (size_t)ngroups * sizeof(server_groupid_t));
+
+  _cupsMutexLock(&authcache_mutex);
+
+  if (!groupcache)
+    groupcache = cupsArrayNew3((cups_array_func_t)groupcache_compare, NULL, NULL, 0, NULL, (cups_afree_func_t)groupcache_free);
+
+  if ((oldest = (server_groupcache_t *)cupsArrayFind(groupcache, entry)) != NULL)
+  {
+   /*
+    * Another thread cached this user in the meantime...
+    */
+
+    cupsArrayRemove(groupcache, oldest);
+  }
+  else if (cupsArrayCount(groupcache) >= SERVER_GROUPCACHE_MAX)
+  {
+    server_groupcache_t	*current;	/* Current entry */
+
+    for (current = (server_groupcache_t *)cupsArrayFirst(groupcache), oldest = NULL; current; current = (server_groupcache_t *)cupsArrayNext(groupcache))
+    {
+      if (current->expire <= curtime)
+        cupsArrayRemove(groupcache, current);
+      else if (!oldest || current->expire < oldest->expire)
+        oldest = current;
+    }
+
+    if (oldest && cupsArrayCount(groupcache) >= SERVER_GROUPCACHE_MAX)
+      cupsArrayRemove(groupcache, oldest);
+  }
+
+  cupsArrayAdd(groupcache, entry);
+
+  _cupsMutexUnlock(&authcache_mutex);
+
+  return (ngroups);
+}
+
+
+/*
+ * 'groupcache_compare()' - Compare two cached group memberships.
+ */
+
+static int				/* O - Result of comparison */
+groupcache_compare(
+    server_groupcache_t *a,		/* I - First entry */
+    server_groupcache_t *b)		/* I - Second entry */
+{
+  return (strcmp(a->username, b->username));
+}
+
+
+/*
+ * 'groupcache_free()' - Free a cached group membership.
+ */
+
+static void
+groupcache_free(
+    server_groupcache_t *entry)		/* I - Entry */
+{
+  free(entry->groups);
+  free(entry);
+}
+#endif /* !_WIN32 */
+
+
 #ifdef HAVE_LIBPAM
 /*
  * 'pam_func()' - PAM conversation function.
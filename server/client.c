@@ -13,21 +13,143 @@
 #include "printer3d-png.h"
 
 
+/*
+ * Local types...
+ */
+
+typedef struct server_splice_s		/**** Cached response writer ****/
+{
+  http_t		*http;		/* HTTP connection */
+  int			pending;	/* Have a held back byte? */
+  ipp_uchar_t		last;		/* Last byte written by ippWriteIO */
+} server_splice_t;
+
+typedef struct server_timer_s		/**** Timer data ****/
+{
+  time_t		when;		/* Time to run callback */
+  int			number;		/* Timer number, for ordering */
+  server_timer_cb_t	cb;		/* Callback function */
+  void			*data;		/* Callback data */
+} server_timer_t;
+
+
+/*
+ * Local globals...
+ */
+
+#if defined(HAVE_EPOLL) || defined(HAVE_KQUEUE)
+static _cups_mutex_t	client_mutex = _CUPS_MUTEX_INITIALIZER;
+					/* Mutex for event loop data */
+static _cups_cond_t	client_cond = _CUPS_COND_INITIALIZER;
+					/* Condition for ready clients */
+static cups_array_t	*client_idle = NULL,
+					/* Idle (keep-alive) clients */
+			*client_ready = NULL;
+					/* Clients with a pending request */
+#endif /* HAVE_EPOLL || HAVE_KQUEUE */
+static int		client_evfd = -1;
+					/* epoll/kqueue descriptor for idle clients */
+static _cups_mutex_t	client_number_mutex = _CUPS_MUTEX_INITIALIZER;
+					/* Mutex for client numbers */
+static int		listeners_changed = 1;
+					/* Listeners added since last poll setup? */
+static _cups_mutex_t	timer_mutex = _CUPS_MUTEX_INITIALIZER;
+					/* Mutex for timers */
+static cups_array_t	*timers = NULL;	/* Pending timers, sorted by time */
+static int		timer_number = 0,
+					/* Next timer number */
+			timer_pipe[2] = { -1, -1 };
+					/* Pipe for waking up the main loop */
+
+
 /*
  * Local functions...
  */
 
+static void		clean_jobs(void *data);
+#if defined(HAVE_EPOLL) || defined(HAVE_KQUEUE)
+static int		compare_clients(server_client_t *a, server_client_t *b);
+#endif /* HAVE_EPOLL || HAVE_KQUEUE */
+static int		compare_timers(server_timer_t *a, server_timer_t *b);
+static void		cork_client(server_client_t *client, int cork);
+static void		dispatch_client(server_client_t *client);
 static void		html_escape(server_client_t *client, const char *s, size_t slen);
 static void		html_footer(server_client_t *client);
 static void		html_header(server_client_t *client, const char *title, int refresh);
 static void		html_printf(server_client_t *client, const char *format, ...) _CUPS_FORMAT(2, 3);
+static void		html_write(server_client_t *client, const char *s, size_t slen);
+static void		log_slow_request(server_client_t *client);
 static int		parse_options(server_client_t *client, cups_option_t **options);
+static int		process_request(server_client_t *client);
+static http_status_t	respond_cached(server_client_t *client, const char *content_encoding, const char *type, size_t length, const char *etag, time_t mtime, const char *cache_control);
+#if defined(HAVE_EPOLL) || defined(HAVE_KQUEUE)
+static void		*run_accept_worker(cups_array_t *listeners);
+static void		*run_client_events(void *data);
+static void		*run_client_worker(void *data);
+#endif /* HAVE_EPOLL || HAVE_KQUEUE */
+static int		run_timers(void);
+static int		send_data(server_client_t *client, const char *type, const void *data, size_t datalen, const char *etag, time_t mtime);
 static int		send_mobile_config(server_client_t *client, server_printer_t *printer);
 static void		send_printer_payload(server_client_t *client, server_printer_t *printer);
+static int		send_resource(server_client_t *client, server_resource_t *res);
 static int		show_materials(server_client_t *client, server_printer_t *printer, const char *encoding);
 static int		show_media(server_client_t *client, server_printer_t *printer, const char *encoding);
 static int		show_status(server_client_t *client, server_printer_t *printer, const char *encoding);
 static int		show_supplies(server_client_t *client, server_printer_t *printer, const char *encoding);
+static int		start_accept_workers(void);
+static int		start_client_workers(void);
+static void		watch_client(server_client_t *client);
+static ssize_t		write_splice_cb(server_splice_t *splice, ipp_uchar_t *buffer, size_t bytes);
+
+
+/*
+ * 'serverAddTimer()' - Schedule a callback to run on the main loop.
+ *
+ * The callback runs once at or shortly after the given time.  Periodic work
+ * is done by adding a new timer from the callback.
+ */
+
+void
+serverAddTimer(time_t            when,	/* I - Time to run callback */
+               server_timer_cb_t cb,	/* I - Callback function */
+               void              *data)	/* I - Callback data */
+{
+  server_timer_t	*timer;		/* New timer */
+
+
+  if ((timer = calloc(1, sizeof(server_timer_t))) == NULL)
+  {
+    serverLog(SERVER_LOGLEVEL_ERROR, "Unable to allocate memory for timer.");
+    return;
+  }
+
+  timer->when = when;
+  timer->cb   = cb;
+  timer->data = data;
+
+  _cupsMutexLock(&timer_mutex);
+
+  if (!timers)
+    timers = cupsArrayNew((cups_array_func_t)compare_timers, NULL);
+
+  timer->number = timer_number ++;
+
+  cupsArrayAdd(timers, timer);
+
+ /*
+  * Wake up the main loop if this is now the first timer...
+  */
+
+  if (timer == (server_timer_t *)cupsArrayFirst(timers) && timer_pipe[1] >= 0)
+  {
+    char	ch = 0;			/* Wakeup byte */
+
+    if (write(timer_pipe[1], &ch, 1) < 0 && errno != EAGAIN)
+      serverLog(SERVER_LOGLEVEL_ERROR, "Unable to wake up main loop: %s", strerror(errno));
+  }
+
+  _cupsMutexUnlock(&timer_mutex);
+}
 
 
 /*
@@ -48,7 +170,9 @@ serverCreateClient(int sock)		/* I - Listen socket */
     return (NULL);
   }
 
+  _cupsMutexLock(&client_number_mutex);
   client->number     = next_client_number ++;
+  _cupsMutexUnlock(&client_number_mutex);
   client->fetch_file = -1;
 
  /*
@@ -68,6 +192,10 @@ serverCreateClient(int sock)		/* I - Listen socket */
 
   serverLogClient(SERVER_LOGLEVEL_INFO, client, "Accepted connection from \"%s\".", client->hostname);
 
+  serverAdmitClient(client);
+
+  serverMetricsAdjust(SERVER_METRIC_CLIENTS, 1);
+
   return (client);
 }
 
@@ -106,7 +234,7 @@ serverCreateListeners(const char *host,	/* I - Hostname, IP address, or NULL for
 
   for (addr = addrlist; addr; addr = addr->next)
   {
-    if ((sock = httpAddrListen(&(addr->addr), port)) < 0)
+    if ((sock = _httpAddrListen(&(addr->addr), port, SOMAXCONN, 0)) < 0)
     {
       char temp[256];			/* Numeric address */
 
@@ -115,7 +243,8 @@ serverCreateListeners(const char *host,	/* I - Hostname, IP address, or NULL for
     }
 
     lis = calloc(1, sizeof(server_listener_t));
-    lis->fd = sock;
+    lis->fd   = sock;
+    lis->addr = addr->addr;
     strlcpy(lis->host, host, sizeof(lis->host));
     lis->port = port;
 
@@ -123,6 +252,8 @@ serverCreateListeners(const char *host,	/* I - Hostname, IP address, or NULL for
       Listeners = cupsArrayNew(NULL, NULL);
 
     cupsArrayAdd(Listeners, lis);
+
+    listeners_changed = 1;
   }
 
   httpAddrFreeList(addrlist);
@@ -146,6 +277,8 @@ serverDeleteClient(server_client_t *client)	/* I - Client */
 
   httpFlushWrite(client->http);
 
+  serverReleaseClient(client);
+
  /*
   * Free memory...
   */
@@ -155,59 +288,105 @@ serverDeleteClient(server_client_t *client)	/* I - Client */
   ippDelete(client->request);
   ippDelete(client->response);
 
+  if (client->cached_attrs)
+    free(client->cached_attrs);
+
+  if (client->encoded)
+    free(client->encoded);
+
+  if (client->html)
+    free(client->html);
+
   free(client);
+
+  serverMetricsAdjust(SERVER_METRIC_CLIENTS, -1);
 }
 
 
 /*
- * 'serverProcessClient()' - Process client requests on a thread.
+ * 'serverEncodeResponse()' - Encode the IPP response for serverRespondHTTP.
+ *
+ * The response and any cached printer attributes are encoded into a single
+ * buffer that is reused by the connection, so the response is only walked
+ * once and can be sent with a single write.  Returns 0 if the response could
+ * not be encoded, in which case serverRespondHTTP writes it directly using
+ * chunking.
  */
 
-void *					/* O - Exit status */
-serverProcessClient(
+size_t					/* O - Length of response or 0 on error */
+serverEncodeResponse(
     server_client_t *client)		/* I - Client */
 {
- /*
-  * Loop until we are out of requests or timeout (30 seconds)...
-  */
+  ssize_t	bytes;			/* Bytes encoded */
 
-#ifdef HAVE_SSL
-  int first_time = 1;			/* First time request? */
-#endif /* HAVE_SSL */
 
-  while (httpWait(client->http, 30000))
+  client->encoded_length = 0;
+
+  if (!client->response || (bytes = ippWriteBuffer(client->response, &client->encoded, &client->encoded_size)) <= 0)
   {
-#ifdef HAVE_SSL
-    if (first_time && Encryption != HTTP_ENCRYPTION_NEVER)
-    {
-     /*
-      * See if we need to negotiate a TLS connection...
-      */
+    serverLogClient(SERVER_LOGLEVEL_ERROR, client, "Unable to encode IPP response.");
+    return (0);
+  }
 
-      char buf[1];			/* First byte from client */
+  if (client->cached_attrs)
+  {
+   /*
+    * Insert the cached attributes before the end tag...
+    */
 
-      if (Encryption == HTTP_ENCRYPTION_ALWAYS ||
-          (recv(httpGetFd(client->http), buf, 1, MSG_PEEK) == 1 && (!buf[0] || !strchr("DGHOPT", buf[0]))))
-      {
-        serverLogClient(SERVER_LOGLEVEL_INFO, client, "Starting HTTPS session.");
+    size_t	length = (size_t)bytes + client->cached_length;
+					/* Total length */
+    ipp_uchar_t	end = client->encoded[bytes - 1];
+					/* End tag */
 
-	if (httpEncryption(client->http, HTTP_ENCRYPTION_ALWAYS))
-	{
-	  serverLogClient(SERVER_LOGLEVEL_ERROR, client, "Unable to encrypt connection: %s", cupsLastErrorString());
-	  break;
-        }
+    if (length > client->encoded_size)
+    {
+      ipp_uchar_t *encoded;		/* New buffer */
 
-        serverLogClient(SERVER_LOGLEVEL_INFO, client, "Connection now encrypted.");
+      if ((encoded = realloc(client->encoded, length)) == NULL)
+      {
+	serverLogClient(SERVER_LOGLEVEL_ERROR, client, "Unable to encode IPP response.");
+	return (0);
       }
 
-      first_time = 0;
+      client->encoded      = encoded;
+      client->encoded_size = length;
     }
-#endif /* HAVE_SSL */
 
-    if (!serverProcessHTTP(client))
+    memcpy(client->encoded + bytes - 1, client->cached_attrs, client->cached_length);
+    client->encoded[length - 1] = end;
+
+    bytes = (ssize_t)length;
+  }
+
+  client->encoded_length = (size_t)bytes;
+
+  return (client->encoded_length);
+}
+
+
+/*
+ * 'serverProcessClient()' - Process client requests on a thread.
+ */
+
+void *					/* O - Exit status */
+serverProcessClient(
+    server_client_t *client)		/* I - Client */
+{
+ /*
+  * Loop until we are out of requests or timeout (30 seconds)...
+  */
+
+  serverMetricsAdjust(SERVER_METRIC_THREADS, 1);
+
+  while (httpWait(client->http, SERVER_CLIENT_TIMEOUT * 1000))
+  {
+    if (!process_request(client))
       break;
   }
 
+  serverMetricsAdjust(SERVER_METRIC_THREADS, -1);
+
  /*
   * Close the conection to the client and return...
   */
@@ -231,6 +410,8 @@ serverProcessHTTP(
   http_state_t		http_state;	/* HTTP state */
   http_status_t		http_status;	/* HTTP status */
   ipp_state_t		ipp_state;	/* State of IPP transfer */
+  ipp_attribute_t	*attr;		/* Attribute read from request */
+  int			preflight;	/* Have we preflighted the request? */
   char			scheme[32],	/* Method/scheme */
 			userpass[128],	/* Username:password */
 			hostname[HTTP_MAX_HOST];
@@ -267,9 +448,29 @@ serverProcessHTTP(
   ippDelete(client->request);
   ippDelete(client->response);
 
-  client->request   = NULL;
-  client->response  = NULL;
-  client->operation = HTTP_STATE_WAITING;
+  if (client->cached_attrs)
+    free(client->cached_attrs);
+
+  if (client->encoded_size > SERVER_ENCODED_MAX)
+  {
+   /*
+    * Don't hang on to the buffer from an unusually large response...
+    */
+
+    free(client->encoded);
+
+    client->encoded      = NULL;
+    client->encoded_size = 0;
+  }
+
+  client->request        = NULL;
+  client->response       = NULL;
+  client->cached_attrs   = NULL;
+  client->cached_length  = 0;
+  client->encoded_length = 0;
+  client->operation     = HTTP_STATE_WAITING;
+
+  memset(client->phases, 0, sizeof(client->phases));
 
  /*
   * Read a request from the connection...
@@ -279,6 +480,8 @@ serverProcessHTTP(
                                        sizeof(uri))) == HTTP_STATE_WAITING)
     usleep(1);
 
+  SERVER_CLIENT_PHASE(client, SERVER_PHASE_START);
+
  /*
   * Parse the request line...
   */
@@ -339,6 +542,8 @@ serverProcessHTTP(
 
   while ((http_status = httpUpdate(client->http)) == HTTP_STATUS_CONTINUE);
 
+  SERVER_CLIENT_PHASE(client, SERVER_PHASE_HEADERS);
+
   if (http_status != HTTP_STATUS_OK)
   {
     serverRespondHTTP(client, HTTP_STATUS_BAD_REQUEST, NULL, NULL, 0);
@@ -434,6 +639,8 @@ serverProcessHTTP(
     return (0);
   }
 
+  SERVER_CLIENT_PHASE(client, SERVER_PHASE_AUTH);
+
  /*
   * Handle new transfers...
   */
@@ -492,6 +699,8 @@ serverProcessHTTP(
           return (serverRespondHTTP(client, HTTP_STATUS_OK, NULL, res->format, 0));
 	else if (!strcmp(client->uri, "/"))
 	  return (serverRespondHTTP(client, HTTP_STATUS_OK, NULL, "text/html", 0));
+	else if (!strcmp(client->uri, "/metrics"))
+	  return (serverRespondHTTP(client, HTTP_STATUS_OK, NULL, "text/plain; version=0.0.4; charset=utf-8", 0));
 
         return (serverRespondHTTP(client, HTTP_STATUS_NOT_FOUND, NULL, NULL, 0));
 
@@ -534,53 +743,30 @@ serverProcessHTTP(
               * Send PNG icon file.
               */
 
-              int		fd;		/* Icon file */
-              struct stat	fileinfo;	/* Icon file information */
-              char		buffer[4096];	/* Copy buffer */
-              ssize_t		bytes;		/* Bytes */
-
               if (printer->icon_resource)
               {
-                serverLogClient(SERVER_LOGLEVEL_DEBUG, client, "Icon file is \"%s\".", printer->icon_resource->filename);
-
-                if (!stat(printer->icon_resource->filename, &fileinfo) && (fd = open(printer->icon_resource->filename, O_RDONLY | O_BINARY)) >= 0)
-                {
-                  if (!serverRespondHTTP(client, HTTP_STATUS_OK, NULL, "image/png", (size_t)fileinfo.st_size))
-                  {
-                    close(fd);
-                    return (0);
-                  }
-
-                  while ((bytes = read(fd, buffer, sizeof(buffer))) > 0)
-                    httpWrite2(client->http, buffer, (size_t)bytes);
-
-                  httpFlushWrite(client->http);
+                SERVER_LOG_CLIENT_DEBUG(client, "Icon file is \"%s\".", printer->icon_resource->filename);
 
-                  close(fd);
-                  return (1);
-                }
+                return (send_resource(client, printer->icon_resource));
               }
               else if (printer)
               {
-                serverLogClient(SERVER_LOGLEVEL_DEBUG, client, "Icon file is internal.");
+                char	etag[64];	/* ETag value */
+
+                SERVER_LOG_CLIENT_DEBUG(client, "Icon file is internal.");
 
                 if (!strncmp(printer->resource, "/ipp/print3d", 12))
                 {
-                  if (!serverRespondHTTP(client, HTTP_STATUS_OK, NULL, "image/png", sizeof(printer3d_png)))
-                    return (0);
+                  snprintf(etag, sizeof(etag), "\"printer3d-png-%x\"", (unsigned)sizeof(printer3d_png));
 
-                  httpWrite2(client->http, (void *)printer3d_png, sizeof(printer3d_png));
+                  return (send_data(client, "image/png", printer3d_png, sizeof(printer3d_png), etag, 0));
                 }
                 else
                 {
-                  if (!serverRespondHTTP(client, HTTP_STATUS_OK, NULL, "image/png", sizeof(printer_png)))
-                    return (0);
+                  snprintf(etag, sizeof(etag), "\"printer-png-%x\"", (unsigned)sizeof(printer_png));
 
-                  httpWrite2(client->http, (void *)printer_png, sizeof(printer_png));
+                  return (send_data(client, "image/png", printer_png, sizeof(printer_png), etag, 0));
                 }
-                httpFlushWrite(client->http);
-
-                return (1);
               }
             }
             else if (!*uriptr)
@@ -607,34 +793,18 @@ serverProcessHTTP(
 	}
         else if ((res = serverFindResourceByPath(client->uri)) != NULL && res->state == IPP_RSTATE_INSTALLED)
         {
-	  int		fd;		/* Icon file */
-	  struct stat	fileinfo;	/* Icon file information */
-	  char		buffer[4096];	/* Copy buffer */
-	  ssize_t	bytes;		/* Bytes */
-
-	  serverLogClient(SERVER_LOGLEVEL_DEBUG, client, "Resource \"%s\" maps to \"%s\".", res->resource, res->filename);
-
-	  if (!stat(res->filename, &fileinfo) && (fd = open(res->filename, O_RDONLY | O_BINARY)) >= 0)
-	  {
-	    if (!serverRespondHTTP(client, HTTP_STATUS_OK, NULL, res->format, (size_t)fileinfo.st_size))
-	    {
-	      close(fd);
-	      return (0);
-	    }
-
-	    while ((bytes = read(fd, buffer, sizeof(buffer))) > 0)
-	      httpWrite2(client->http, buffer, (size_t)bytes);
+	  SERVER_LOG_CLIENT_DEBUG(client, "Resource \"%s\" maps to \"%s\".", res->resource, res->filename);
 
-	    httpFlushWrite(client->http);
-
-	    close(fd);
-	    return (1);
-	  }
+	  return (send_resource(client, res));
 	}
 	else if (!strcmp(client->uri, "/"))
 	{
           return (show_status(client, NULL, encoding));
 	}
+	else if (!strcmp(client->uri, "/metrics"))
+	{
+	  return (serverRespondMetrics(client));
+	}
 
         return (serverRespondHTTP(client, HTTP_STATUS_NOT_FOUND, NULL, NULL, 0));
 
@@ -652,10 +822,11 @@ serverProcessHTTP(
         * Read the IPP request...
 	*/
 
-	client->request = ippNew();
+	client->request = _ippNewArena();
 
-        while ((ipp_state = ippRead(client->http,
-                                    client->request)) != IPP_STATE_DATA)
+        preflight = 0;
+
+        while ((ipp_state = ippReadNext(client->http, client->request, &attr)) != IPP_STATE_DATA)
 	{
 	  if (ipp_state == IPP_STATE_ERROR)
 	  {
@@ -663,8 +834,22 @@ serverProcessHTTP(
 	    serverRespondHTTP(client, HTTP_STATUS_BAD_REQUEST, NULL, NULL, 0);
 	    return (0);
 	  }
+	  else if (attr && !preflight && ippGetGroupTag(attr) != IPP_TAG_OPERATION)
+	  {
+	   /*
+	    * Validate the operation attributes before reading the rest of the
+	    * request...
+	    */
+
+	    preflight = 1;
+
+	    if (!serverPreflightIPP(client))
+	      return (0);
+	  }
 	}
 
+        SERVER_CLIENT_PHASE(client, SERVER_PHASE_READ);
+
        /*
         * Now that we have the IPP request, process the request...
 	*/
@@ -745,11 +930,20 @@ serverRespondHTTP(
       httpSetField(client->http, HTTP_FIELD_CONTENT_TYPE, type);
 
     if (content_encoding)
+    {
+      httpSetCompressionLevel(client->http, client->printer ? client->printer->pinfo.compression_level : 0);
       httpSetField(client->http, HTTP_FIELD_CONTENT_ENCODING, content_encoding);
+    }
   }
 
   httpSetLength(client->http, length);
 
+ /*
+  * Cork the socket so the header and body go out in the same segments...
+  */
+
+  cork_client(client, 1);
+
   if (httpWriteResponse(client->http, code) < 0)
     return (0);
 
@@ -772,47 +966,115 @@ serverRespondHTTP(
     * Send an IPP response...
     */
 
-    serverLogClient(SERVER_LOGLEVEL_DEBUG, client, "serverRespondHTTP: Sending %d bytes of IPP response (Content-Length=%d)", (int)ippLength(client->response), (int)length);
+    if (client->encoded_length > 0)
+    {
+     /*
+      * Send the response encoded by serverEncodeResponse...
+      */
+
+      SERVER_LOG_CLIENT_DEBUG(client, "serverRespondHTTP: Sending %d bytes of encoded IPP response (Content-Length=%d)", (int)client->encoded_length, (int)length);
+
+      if (httpWrite2(client->http, (char *)client->encoded, client->encoded_length) < 0)
+      {
+	serverLogClient(SERVER_LOGLEVEL_ERROR, client, "Unable to write IPP response.");
+	return (0);
+      }
+
+      client->encoded_length = 0;
+    }
+    else if (client->cached_attrs)
+    {
+     /*
+      * Write the response minus its end tag, then the cached attributes and
+      * the end tag...
+      */
+
+      server_splice_t	splice;		/* Cached response writer */
+
+      SERVER_LOG_CLIENT_DEBUG(client, "serverRespondHTTP: Sending %d bytes of IPP response (Content-Length=%d)", (int)(ippLength(client->response) + client->cached_length), (int)length);
 
-    ippSetState(client->response, IPP_STATE_IDLE);
+      ippSetState(client->response, IPP_STATE_IDLE);
 
-    if (ippWrite(client->http, client->response) != IPP_STATE_DATA)
+      splice.http    = client->http;
+      splice.pending = 0;
+
+      if (ippWriteIO(&splice, (ipp_iocb_t)write_splice_cb, 1, NULL, client->response) != IPP_STATE_DATA || httpWrite2(client->http, (char *)client->cached_attrs, client->cached_length) < 0 || httpWrite2(client->http, (char *)&splice.last, 1) < 0)
+      {
+	serverLogClient(SERVER_LOGLEVEL_ERROR, client, "Unable to write IPP response.");
+	return (0);
+      }
+    }
+    else
     {
-      serverLogClient(SERVER_LOGLEVEL_ERROR, client, "Unable to write IPP response.");
-      return (0);
+      SERVER_LOG_CLIENT_DEBUG(client, "serverRespondHTTP: Sending %d bytes of IPP response (Content-Length=%d)", (int)ippLength(client->response), (int)length);
+
+      ippSetState(client->response, IPP_STATE_IDLE);
+
+      if (ippWrite(client->http, client->response) != IPP_STATE_DATA)
+      {
+	serverLogClient(SERVER_LOGLEVEL_ERROR, client, "Unable to write IPP response.");
+	return (0);
+      }
     }
 
-    serverLogClient(SERVER_LOGLEVEL_DEBUG, client, "serverRespondHTTP: Sent IPP response.");
+    SERVER_LOG_CLIENT_DEBUG(client, "serverRespondHTTP: Sent IPP response.");
 
     if (client->fetch_file >= 0)
     {
       ssize_t	bytes;			/* Bytes read */
       char	buffer[32768];		/* Buffer */
 
-      serverLogClient(SERVER_LOGLEVEL_DEBUG, client, "serverRespondHTTP: Sending file.");
+      SERVER_LOG_CLIENT_DEBUG(client, "serverRespondHTTP: Sending file.");
 
       if (client->fetch_compression)
+      {
+        httpSetCompressionLevel(client->http, client->printer ? client->printer->pinfo.compression_level : 0);
         httpSetField(client->http, HTTP_FIELD_CONTENT_ENCODING, "gzip");
+      }
+
+      if (length > 0)
+      {
+       /*
+        * The Content-Length covers the file, so it can be sent directly...
+        */
 
-      while ((bytes = read(client->fetch_file, buffer, sizeof(buffer))) > 0)
-        httpWrite2(client->http, buffer, (size_t)bytes);
+        if (_httpWriteFile(client->http, client->fetch_file, client->fetch_length) < (ssize_t)client->fetch_length)
+          serverLogClient(SERVER_LOGLEVEL_ERROR, client, "Unable to send document: %s", strerror(httpError(client->http) ? httpError(client->http) : errno));
+      }
+      else
+      {
+	while ((bytes = read(client->fetch_file, buffer, sizeof(buffer))) > 0)
+	  httpWrite2(client->http, buffer, (size_t)bytes);
+      }
 
-      serverLogClient(SERVER_LOGLEVEL_DEBUG, client, "serverRespondHTTP: Sent file.");
+      SERVER_LOG_CLIENT_DEBUG(client, "serverRespondHTTP: Sent file.");
 
       close(client->fetch_file);
-      client->fetch_file = -1;
+      client->fetch_file        = -1;
+      client->fetch_compression = 0;
+      client->fetch_length      = 0;
     }
 
     if (length == 0)
     {
-      serverLogClient(SERVER_LOGLEVEL_DEBUG, client, "serverRespondHTTP: Sending 0-length chunk.");
+      SERVER_LOG_CLIENT_DEBUG(client, "serverRespondHTTP: Sending 0-length chunk.");
       httpWrite2(client->http, "", 0);
     }
   }
 
-  serverLogClient(SERVER_LOGLEVEL_DEBUG, client, "serverRespondHTTP: Flushing write buffer.");
+  SERVER_LOG_CLIENT_DEBUG(client, "serverRespondHTTP: Flushing write buffer.");
   httpFlushWrite(client->http);
 
+ /*
+  * Keep the socket corked while the client has pipelined another request so
+  * that the responses are coalesced, otherwise send everything now...
+  */
+
+  if (_httpPipelineReady(client->http))
+    SERVER_LOG_CLIENT_DEBUG(client, "serverRespondHTTP: Pipelined request pending.");
+  else
+    cork_client(client, 0);
+
   return (1);
 }
 
@@ -824,19 +1086,46 @@ serverRespondHTTP(
 void
 serverRun(void)
 {
-#ifdef HAVE_DNSSD
-  int			fd;		/* File descriptor */
-#endif /* HAVE_DNSSD */
-  int			max_fd;		/* Number of file descriptors */
-  fd_set		input;		/* select() input set */
-  struct timeval	timeout;	/* Timeout for poll() */
+  int			i,		/* Looping var */
+			num_fds = 0,	/* Number of file descriptors */
+			alloc_fds = 0,	/* Allocated file descriptors */
+			timeout;	/* Timeout for poll() */
+  struct pollfd		*fds = NULL;	/* poll() data */
   server_listener_t	*lis;		/* Listener */
   server_client_t	*client;	/* New client */
-  time_t                next_clean = 0; /* Next time to clean old jobs */
 
 
-  serverLog(SERVER_LOGLEVEL_DEBUG, "serverRun: %d printers configured.", cupsArrayCount(Printers));
-  serverLog(SERVER_LOGLEVEL_DEBUG, "serverRun: %d listeners configured.", cupsArrayCount(Listeners));
+  SERVER_LOG_DEBUG("serverRun: %d printers configured.", cupsArrayCount(Printers));
+  SERVER_LOG_DEBUG("serverRun: %d listeners configured.", cupsArrayCount(Listeners));
+
+  if (ClientWorkers > 0 && !start_client_workers())
+    serverLog(SERVER_LOGLEVEL_ERROR, "Unable to start client workers, using one thread per client.");
+
+  if (AcceptWorkers > 0 && !start_accept_workers())
+    serverLog(SERVER_LOGLEVEL_ERROR, "Unable to start accept workers, accepting connections in the main loop.");
+
+#ifndef _WIN32
+ /*
+  * Create the wakeup pipe for timers...
+  */
+
+  if (pipe(timer_pipe))
+  {
+    serverLog(SERVER_LOGLEVEL_ERROR, "Unable to create timer pipe: %s", strerror(errno));
+    timer_pipe[0] = timer_pipe[1] = -1;
+  }
+  else
+  {
+    fcntl(timer_pipe[0], F_SETFL, fcntl(timer_pipe[0], F_GETFL) | O_NONBLOCK);
+    fcntl(timer_pipe[1], F_SETFL, fcntl(timer_pipe[1], F_GETFL) | O_NONBLOCK);
+  }
+#endif /* !_WIN32 */
+
+ /*
+  * Clean old jobs now and every 30 seconds after that...
+  */
+
+  serverAddTimer(time(NULL), clean_jobs, NULL);
 
  /*
   * Loop until we are killed or have a hard error...
@@ -844,107 +1133,221 @@ serverRun(void)
 
   for (;;)
   {
-   /*
-    * Setup select() data for the Bonjour service socket and listeners...
-    */
+    if (listeners_changed)
+    {
+     /*
+      * Setup poll() data for the listeners, timer pipe, and DNS-SD service
+      * socket...
+      */
 
-    FD_ZERO(&input);
-    max_fd = 0;
+      if (alloc_fds < (cupsArrayCount(Listeners) + 2))
+      {
+        struct pollfd	*temp;		/* New poll() data */
 
-    for (lis = (server_listener_t *)cupsArrayFirst(Listeners); lis; lis = (server_listener_t *)cupsArrayNext(Listeners))
-    {
-      FD_SET(lis->fd, &input);
-      if (max_fd < lis->fd)
-        max_fd = lis->fd;
-    }
+        if ((temp = realloc(fds, (size_t)(cupsArrayCount(Listeners) + 2) * sizeof(struct pollfd))) == NULL)
+        {
+          serverLog(SERVER_LOGLEVEL_ERROR, "Unable to allocate memory for main loop.");
+          break;
+        }
+
+        fds       = temp;
+        alloc_fds = cupsArrayCount(Listeners) + 2;
+      }
+
+      num_fds = 0;
+
+      for (lis = (server_listener_t *)cupsArrayFirst(Listeners); lis; lis = (server_listener_t *)cupsArrayNext(Listeners))
+      {
+        fds[num_fds].fd     = lis->fd;
+        fds[num_fds].events = POLLIN;
+        num_fds ++;
+      }
+
+      if (timer_pipe[0] >= 0)
+      {
+        fds[num_fds].fd     = timer_pipe[0];
+        fds[num_fds].events = POLLIN;
+        num_fds ++;
+      }
 
 #ifdef HAVE_DNSSD
-    if (DNSSDEnabled)
-    {
-      fd = DNSServiceRefSockFD(DNSSDMaster);
-      FD_SET(fd, &input);
-      if (max_fd < fd)
-        max_fd = fd;
-    }
+      if (DNSSDEnabled)
+      {
+        fds[num_fds].fd     = DNSServiceRefSockFD(DNSSDMaster);
+        fds[num_fds].events = POLLIN;
+        num_fds ++;
+      }
 #endif /* HAVE_DNSSD */
 
-    timeout.tv_sec  = 86400;
-    timeout.tv_usec = 0;
+      listeners_changed = 0;
+    }
+
+   /*
+    * Run any pending timers and then wait for the next timer or input...
+    */
+
+    timeout = run_timers();
 
-    if (select(max_fd + 1, &input, NULL, NULL, &timeout) < 0 && errno != EINTR)
+    if (poll(fds, (nfds_t)num_fds, timeout) < 0 && errno != EINTR)
     {
       serverLog(SERVER_LOGLEVEL_ERROR, "Main loop failed (%s)", strerror(errno));
       break;
     }
 
-    for (lis = (server_listener_t *)cupsArrayFirst(Listeners); lis; lis = (server_listener_t *)cupsArrayNext(Listeners))
+    for (i = 0, lis = (server_listener_t *)cupsArrayFirst(Listeners); lis; i ++, lis = (server_listener_t *)cupsArrayNext(Listeners))
     {
-      if (FD_ISSET(lis->fd, &input))
+      if (fds[i].revents & POLLIN)
       {
-        serverLog(SERVER_LOGLEVEL_DEBUG, "serverRun: Incoming connection on listener %s:%d.", lis->host, lis->port);
+        SERVER_LOG_DEBUG("serverRun: Incoming connection on listener %s:%d.", lis->host, lis->port);
 
         if ((client = serverCreateClient(lis->fd)) != NULL)
-        {
-          _cups_thread_t t = _cupsThreadCreate((_cups_thread_func_t)serverProcessClient, client);
-
-          if (t)
-          {
-            _cupsThreadDetach(t);
-          }
-          else
-          {
-            serverLog(SERVER_LOGLEVEL_ERROR, "Unable to create client thread (%s)", strerror(errno));
-            serverDeleteClient(client);
-          }
-        }
+          dispatch_client(client);
       }
     }
 
-#ifdef HAVE_DNSSD
-    if (DNSSDEnabled && FD_ISSET(DNSServiceRefSockFD(DNSSDMaster), &input))
+    if (timer_pipe[0] >= 0 && (fds[i].revents & POLLIN))
     {
-      serverLog(SERVER_LOGLEVEL_DEBUG, "serverRun: Input on DNS-SD socket.");
-      DNSServiceProcessResult(DNSSDMaster);
+      char	buffer[256];		/* Wakeup bytes */
+
+      while (read(timer_pipe[0], buffer, sizeof(buffer)) > 0);
     }
-#endif /* HAVE_DNSSD */
 
-    if (time(NULL) >= next_clean)
+#ifdef HAVE_DNSSD
+    if (DNSSDEnabled && (fds[num_fds - 1].revents & POLLIN))
     {
-      serverCleanAllJobs();
-
-      next_clean = time(NULL) + 30;
+      SERVER_LOG_DEBUG("serverRun: Input on DNS-SD socket.");
+      DNSServiceProcessResult(DNSSDMaster);
     }
+#endif /* HAVE_DNSSD */
   }
+
+  free(fds);
 }
 
 
 /*
- * 'html_escape()' - Write a HTML-safe string.
+ * 'clean_jobs()' - Clean old jobs and schedule the next cleaning.
  */
 
 static void
-html_escape(server_client_t *client,	/* I - Client */
-	    const char    *s,		/* I - String to write */
-	    size_t        slen)		/* I - Number of characters to write */
+clean_jobs(void *data)			/* I - Callback data (unused) */
 {
-  const char	*start,			/* Start of segment */
-		*end;			/* End of string */
+  (void)data;
 
+  serverCleanAllJobs();
 
-  start = s;
-  end   = s + (slen > 0 ? slen : strlen(s));
+  serverAddTimer(time(NULL) + 30, clean_jobs, NULL);
+}
 
-  while (*s && s < end)
-  {
-    if (*s == '&' || *s == '<')
-    {
-      if (s > start)
-        httpWrite2(client->http, start, (size_t)(s - start));
 
-      if (*s == '&')
-        httpWrite2(client->http, "&amp;", 5);
+#if defined(HAVE_EPOLL) || defined(HAVE_KQUEUE)
+/*
+ * 'compare_clients()' - Compare two clients by number.
+ */
+
+static int				/* O - Result of comparison */
+compare_clients(server_client_t *a,	/* I - First client */
+                server_client_t *b)	/* I - Second client */
+{
+  return (a->number - b->number);
+}
+#endif /* HAVE_EPOLL || HAVE_KQUEUE */
+
+
+/*
+ * 'compare_timers()' - Compare two timers by time.
+ */
+
+static int				/* O - Result of comparison */
+compare_timers(server_timer_t *a,	/* I - First timer */
+               server_timer_t *b)	/* I - Second timer */
+{
+  if (a->when < b->when)
+    return (-1);
+  else if (a->when > b->when)
+    return (1);
+  else
+    return (a->number - b->number);
+}
+
+
+/*
+ * 'cork_client()' - Cork or uncork writes to a client socket.
+ *
+ * TCP_NODELAY is already set by httpAcceptConnection, so corking is what lets
+ * a response header, its body, and any responses to pipelined requests share
+ * segments.  Uncorking sends everything that is queued.
+ */
+
+static void
+cork_client(server_client_t *client,	/* I - Client */
+            int             cork)	/* I - 1 to cork, 0 to uncork */
+{
+  if (client->corked == cork)
+    return;
+
+  client->corked = cork;
+
+#ifdef TCP_CORK
+  setsockopt(httpGetFd(client->http), IPPROTO_TCP, TCP_CORK, CUPS_SOCAST &cork, sizeof(cork));
+#endif /* TCP_CORK */
+}
+
+
+/*
+ * 'dispatch_client()' - Hand a new client to the client workers or its own
+ *                       thread.
+ */
+
+static void
+dispatch_client(server_client_t *client)/* I - Client */
+{
+  _cups_thread_t	t;		/* Client thread */
+
+
+  if (client_evfd >= 0)
+  {
+    watch_client(client);
+  }
+  else if ((t = _cupsThreadCreate((_cups_thread_func_t)serverProcessClient, client)) != 0)
+  {
+    _cupsThreadDetach(t);
+  }
+  else
+  {
+    serverLog(SERVER_LOGLEVEL_ERROR, "Unable to create client thread (%s)", strerror(errno));
+    serverDeleteClient(client);
+  }
+}
+
+
+/*
+ * 'html_escape()' - Write a HTML-safe string.
+ */
+
+static void
+html_escape(server_client_t *client,	/* I - Client */
+	    const char    *s,		/* I - String to write */
+	    size_t        slen)		/* I - Number of characters to write */
+{
+  const char	*start,			/* Start of segment */
+		*end;			/* End of string */
+
+
+  start = s;
+  end   = s + (slen > 0 ? slen : strlen(s));
+
+  while (*s && s < end)
+  {
+    if (*s == '&' || *s == '<')
+    {
+      if (s > start)
+        html_write(client, start, (size_t)(s - start));
+
+      if (*s == '&')
+        html_write(client, "&amp;", 5);
       else
-        httpWrite2(client->http, "&lt;", 4);
+        html_write(client, "&lt;", 4);
 
       start = s + 1;
     }
@@ -953,14 +1356,15 @@ html_escape(server_client_t *client,	/* I - Client */
   }
 
   if (s > start)
-    httpWrite2(client->http, start, (size_t)(s - start));
+    html_write(client, start, (size_t)(s - start));
 }
 
 
 /*
  * 'html_footer()' - Show the web interface footer.
  *
- * This function also writes the trailing 0-length chunk.
+ * This function also writes the buffered page and the trailing 0-length
+ * chunk.
  */
 
 static void
@@ -970,6 +1374,12 @@ html_footer(server_client_t *client)	/* I - Client */
 	      "</div>\n"
 	      "</body>\n"
 	      "</html>\n");
+  if (client->html_length > 0)
+  {
+    httpWrite2(client->http, client->html, client->html_length);
+    client->html_length = 0;
+  }
+
   httpWrite2(client->http, "", 0);
 }
 
@@ -983,6 +1393,8 @@ html_header(server_client_t *client,	/* I - Client */
             const char      *title,	/* I - Title */
             int             refresh)	/* I - Refresh timer, if any */
 {
+  client->html_length = 0;
+
   html_printf(client,
 	      "<!doctype html>\n"
 	      "<html>\n"
@@ -1057,14 +1469,14 @@ html_printf(server_client_t *client,	/* I - Client */
     if (*format == '%')
     {
       if (format > start)
-        httpWrite2(client->http, start, (size_t)(format - start));
+        html_write(client, start, (size_t)(format - start));
 
       tptr    = tformat;
       *tptr++ = *format++;
 
       if (*format == '%')
       {
-        httpWrite2(client->http, "%", 1);
+        html_write(client, "%", 1);
         format ++;
 	start = format;
 	continue;
@@ -1178,7 +1590,7 @@ html_printf(server_client_t *client,	/* I - Client */
 
 	    sprintf(temp, tformat, va_arg(ap, double));
 
-            httpWrite2(client->http, temp, strlen(temp));
+            html_write(client, temp, strlen(temp));
 	    break;
 
         case 'B' : /* Integer formats */
@@ -1202,7 +1614,7 @@ html_printf(server_client_t *client,	/* I - Client */
 	    else
 	      sprintf(temp, tformat, va_arg(ap, int));
 
-            httpWrite2(client->http, temp, strlen(temp));
+            html_write(client, temp, strlen(temp));
 	    break;
 
 	case 'p' : /* Pointer value */
@@ -1211,7 +1623,7 @@ html_printf(server_client_t *client,	/* I - Client */
 
 	    sprintf(temp, tformat, va_arg(ap, void *));
 
-            httpWrite2(client->http, temp, strlen(temp));
+            html_write(client, temp, strlen(temp));
 	    break;
 
         case 'c' : /* Character or character array */
@@ -1229,86 +1641,586 @@ html_printf(server_client_t *client,	/* I - Client */
 	    if ((s = va_arg(ap, char *)) == NULL)
 	      s = "(null)";
 
-            html_escape(client, s, strlen(s));
-	    break;
+            html_escape(client, s, strlen(s));
+	    break;
+      }
+    }
+    else
+      format ++;
+  }
+
+  if (format > start)
+    html_write(client, start, (size_t)(format - start));
+
+  va_end(ap);
+}
+
+
+/*
+ * 'html_write()' - Add text to the buffered web interface page.
+ *
+ * Pages are accumulated in memory and written by html_footer() in a single
+ * chunk.  If the buffer cannot be grown, the buffered text and new text are
+ * written directly instead.
+ */
+
+static void
+html_write(server_client_t *client,	/* I - Client */
+           const char      *s,		/* I - Text to write */
+           size_t          slen)	/* I - Number of characters to write */
+{
+  if (client->html_length + slen > client->html_size)
+  {
+    size_t	size;			/* New size of buffer */
+    char	*html;			/* New buffer */
+
+    for (size = client->html_size ? 2 * client->html_size : 16384; size < client->html_length + slen; size *= 2);
+
+    if ((html = realloc(client->html, size)) == NULL)
+    {
+      if (client->html_length > 0)
+      {
+        httpWrite2(client->http, client->html, client->html_length);
+        client->html_length = 0;
+      }
+
+      httpWrite2(client->http, s, slen);
+      return;
+    }
+
+    client->html      = html;
+    client->html_size = size;
+  }
+
+  memcpy(client->html + client->html_length, s, slen);
+  client->html_length += slen;
+}
+
+
+/*
+ * 'log_slow_request()' - Log the processing phases of a slow request.
+ */
+
+static void
+log_slow_request(
+    server_client_t *client)		/* I - Client */
+{
+  int		i;			/* Looping var */
+  double	last;			/* End of previous phase */
+  char		buffer[1024],		/* Phase times */
+		*bufptr;		/* Pointer into buffer */
+  static const char * const phases[] =	/* Phase names */
+  {
+    "start",
+    "headers",
+    "auth",
+    "read",
+    "validate",
+    "spool",
+    "operation",
+    "response"
+  };
+
+
+  if (client->phases[SERVER_PHASE_START] <= 0.0 || (client->phases[SERVER_PHASE_RESPONSE] - client->phases[SERVER_PHASE_START]) * 1000.0 < LogSlowRequests)
+    return;
+
+ /*
+  * Report the time spent in each phase that was reached, in milliseconds...
+  */
+
+  buffer[0] = '\0';
+
+  for (i = SERVER_PHASE_HEADERS, bufptr = buffer, last = client->phases[SERVER_PHASE_START]; i < SERVER_PHASE_MAX; i ++)
+  {
+    if (client->phases[i] <= 0.0)
+      continue;
+
+    snprintf(bufptr, sizeof(buffer) - (size_t)(bufptr - buffer), " %s=%.3f", phases[i], (client->phases[i] - last) * 1000.0);
+    bufptr += strlen(bufptr);
+    last   = client->phases[i];
+  }
+
+  serverLogClient(SERVER_LOGLEVEL_INFO, client, "Slow request: uri=\"%s\" operation=%s total=%.3f%s", client->uri, client->request ? ippOpString(client->operation_id) : "none", (client->phases[SERVER_PHASE_RESPONSE] - client->phases[SERVER_PHASE_START]) * 1000.0, buffer);
+}
+
+
+/*
+ * 'parse_options()' - Parse URL options into CUPS options.
+ *
+ * The client->options string is destroyed by this function.
+ */
+
+static int				/* O - Number of options */
+parse_options(server_client_t *client,	/* I - Client */
+              cups_option_t   **options)/* O - Options */
+{
+  char	*post_data = NULL,		/* POST form data */
+	*name,				/* Name */
+      	*value,				/* Value */
+	*next;				/* Next name=value pair */
+  int	num_options = 0;		/* Number of options */
+
+
+  *options = NULL;
+
+  if (httpGetState(client->http) == HTTP_STATE_POST_RECV)
+  {
+    off_t	post_len = httpGetLength2(client->http);
+					/* Length of POST form data */
+
+    if (post_len == 0 || post_len > 65535)
+      post_len = 65535;
+
+    if ((post_data = calloc(1, (size_t)post_len + 1)) != NULL)
+    {
+      char	*post_ptr = post_data,	/* Pointer into POST form data */
+		*post_end = post_data + post_len;
+					/* Pointer to end of POST form data */
+      ssize_t	post_bytes;		/* Number of bytes read... */
+
+
+      while ((post_bytes = httpRead2(client->http, post_ptr, (size_t)(post_end - post_ptr))) > 0)
+      {
+        post_ptr += post_bytes;
+      }
+
+      *post_ptr = '\0';
+    }
+
+    name = post_data;
+  }
+  else
+    name = client->options;
+
+  while (name && *name)
+  {
+    if ((value = strchr(name, '=')) == NULL)
+      break;
+
+    *value++ = '\0';
+    if ((next = strchr(value, '&')) != NULL)
+      *next++ = '\0';
+
+    num_options = cupsAddOption(name, value, num_options, options);
+    name        = next;
+  }
+
+  if (post_data)
+    free(post_data);
+
+  return (num_options);
+}
+
+
+/*
+ * 'process_request()' - Process a single HTTP request from a client.
+ */
+
+static int				/* O - 1 to keep the connection, 0 to close it */
+process_request(server_client_t *client)/* I - Client */
+{
+  int	status;				/* Return status */
+
+
+#ifdef HAVE_SSL
+  if (!client->tls_checked && Encryption != HTTP_ENCRYPTION_NEVER)
+  {
+   /*
+    * See if we need to negotiate a TLS connection...
+    */
+
+    char buf[1];			/* First byte from client */
+
+    if (Encryption == HTTP_ENCRYPTION_ALWAYS ||
+        (recv(httpGetFd(client->http), buf, 1, MSG_PEEK) == 1 && (!buf[0] || !strchr("DGHOPT", buf[0]))))
+    {
+      serverLogClient(SERVER_LOGLEVEL_INFO, client, "Starting HTTPS session.");
+
+      if (httpEncryption(client->http, HTTP_ENCRYPTION_ALWAYS))
+      {
+	serverLogClient(SERVER_LOGLEVEL_ERROR, client, "Unable to encrypt connection: %s", cupsLastErrorString());
+	return (0);
+      }
+
+      serverLogClient(SERVER_LOGLEVEL_INFO, client, "Connection now encrypted.");
+    }
+  }
+
+  client->tls_checked = 1;
+#endif /* HAVE_SSL */
+
+  status = serverProcessHTTP(client);
+
+  serverReleaseRequest(client);
+
+  if (client->corked && !_httpPipelineReady(client->http))
+    cork_client(client, 0);
+
+  if (LogSlowRequests > 0)
+  {
+    SERVER_CLIENT_PHASE(client, SERVER_PHASE_RESPONSE);
+    log_slow_request(client);
+  }
+
+  return (status);
+}
+
+
+/*
+ * 'respond_cached()' - Send a HTTP response header with cache validators.
+ *
+ * If the client's If-None-Match or If-Modified-Since values match the current
+ * content, a "304 Not Modified" response is sent instead and the caller must
+ * not send any content.
+ */
+
+static http_status_t			/* O - HTTP status sent or `HTTP_STATUS_ERROR` on failure */
+respond_cached(
+    server_client_t *client,		/* I - Client */
+    const char      *content_encoding,	/* I - Content-Encoding of response */
+    const char      *type,		/* I - MIME media type of response */
+    size_t          length,		/* I - Length of response */
+    const char      *etag,		/* I - ETag value */
+    time_t          mtime,		/* I - Modification time or 0 */
+    const char      *cache_control)	/* I - Cache-Control value */
+{
+  http_status_t	code = HTTP_STATUS_OK;	/* HTTP status */
+  const char	*match,			/* If-None-Match value */
+		*since;			/* If-Modified-Since value */
+  char		date[256];		/* Last-Modified value */
+
+
+ /*
+  * If-None-Match takes precedence over If-Modified-Since (RFC 7232)...
+  */
+
+  match = httpGetField(client->http, HTTP_FIELD_IF_NONE_MATCH);
+  since = httpGetField(client->http, HTTP_FIELD_IF_MODIFIED_SINCE);
+
+  if (*match)
+  {
+    if (!strcmp(match, "*") || strstr(match, etag))
+      code = HTTP_STATUS_NOT_MODIFIED;
+  }
+  else if (*since && mtime > 0 && httpGetDateTime(since) >= mtime)
+    code = HTTP_STATUS_NOT_MODIFIED;
+
+  serverLogClient(SERVER_LOGLEVEL_INFO, client, "%s", httpStatus(code));
+
+  httpClearFields(client->http);
+  httpSetField(client->http, HTTP_FIELD_ETAG, etag);
+  httpSetField(client->http, HTTP_FIELD_CACHE_CONTROL, cache_control);
+
+  if (mtime > 0)
+    httpSetField(client->http, HTTP_FIELD_LAST_MODIFIED, httpGetDateString2(mtime, date, sizeof(date)));
+
+  if (code == HTTP_STATUS_OK)
+  {
+    if (!strcmp(type, "text/html"))
+      httpSetField(client->http, HTTP_FIELD_CONTENT_TYPE, "text/html; charset=utf-8");
+    else
+      httpSetField(client->http, HTTP_FIELD_CONTENT_TYPE, type);
+
+    if (content_encoding)
+    {
+      httpSetCompressionLevel(client->http, client->printer ? client->printer->pinfo.compression_level : 0);
+      httpSetField(client->http, HTTP_FIELD_CONTENT_ENCODING, content_encoding);
+    }
+
+    httpSetLength(client->http, length);
+  }
+  else
+  {
+   /*
+    * A 304 response has no content...
+    */
+
+    httpSetField(client->http, HTTP_FIELD_CONTENT_LENGTH, "0");
+  }
+
+  if (httpWriteResponse(client->http, code) < 0)
+    return (HTTP_STATUS_ERROR);
+
+  return (code);
+}
+
+
+#if defined(HAVE_EPOLL) || defined(HAVE_KQUEUE)
+/*
+ * 'run_accept_worker()' - Accept connections on a set of shared listeners.
+ */
+
+static void *				/* O - Thread exit status */
+run_accept_worker(
+    cups_array_t *listeners)		/* I - Listeners for this worker */
+{
+  int			i,		/* Looping var */
+			num_fds;	/* Number of file descriptors */
+  struct pollfd		*fds;		/* poll() data */
+  server_listener_t	*lis;		/* Listener */
+  server_client_t	*client;	/* New client */
+
+
+  num_fds = cupsArrayCount(listeners);
+
+  if ((fds = calloc((size_t)num_fds, sizeof(struct pollfd))) == NULL)
+  {
+    serverLog(SERVER_LOGLEVEL_ERROR, "Unable to allocate memory for accept worker.");
+    return (NULL);
+  }
+
+  for (i = 0, lis = (server_listener_t *)cupsArrayFirst(listeners); lis; i ++, lis = (server_listener_t *)cupsArrayNext(listeners))
+  {
+    fds[i].fd     = lis->fd;
+    fds[i].events = POLLIN;
+  }
+
+  for (;;)
+  {
+    if (poll(fds, (nfds_t)num_fds, -1) < 0 && errno != EINTR)
+    {
+      serverLog(SERVER_LOGLEVEL_ERROR, "Accept worker failed (%s)", strerror(errno));
+      break;
+    }
+
+    for (i = 0, lis = (server_listener_t *)cupsArrayFirst(listeners); lis; i ++, lis = (server_listener_t *)cupsArrayNext(listeners))
+    {
+      if ((fds[i].revents & POLLIN) && (client = serverCreateClient(lis->fd)) != NULL)
+        dispatch_client(client);
+    }
+  }
+
+  free(fds);
+
+  return (NULL);
+}
+
+
+/*
+ * 'run_client_events()' - Wait for requests on idle client connections.
+ *
+ * This thread owns the epoll/kqueue descriptor.  Clients with a pending
+ * request are moved to the ready queue for the worker threads, and idle
+ * clients are closed after SERVER_CLIENT_TIMEOUT seconds.
+ */
+
+static void *				/* O - Thread exit status */
+run_client_events(void *data)		/* I - Thread data (unused) */
+{
+  int			i,		/* Looping var */
+			nevents;	/* Number of events */
+  server_client_t	*client;	/* Current client */
+  cups_array_t		*expired;	/* Expired clients */
+  time_t		curtime,	/* Current time */
+			next_sweep = 0;	/* Next time to close idle clients */
+#  ifdef HAVE_EPOLL
+  struct epoll_event	events[256];	/* Events */
+#  else
+  struct kevent		event,		/* Delete event */
+			events[256];	/* Events */
+  struct timespec	timeout;	/* Timeout */
+#  endif /* HAVE_EPOLL */
+
+
+  (void)data;
+
+  expired = cupsArrayNew(NULL, NULL);
+
+  for (;;)
+  {
+#  ifdef HAVE_EPOLL
+    nevents = epoll_wait(client_evfd, events, (int)(sizeof(events) / sizeof(events[0])), 1000);
+#  else
+    timeout.tv_sec  = 1;
+    timeout.tv_nsec = 0;
+
+    nevents = kevent(client_evfd, NULL, 0, events, (int)(sizeof(events) / sizeof(events[0])), &timeout);
+#  endif /* HAVE_EPOLL */
+
+    if (nevents < 0 && errno != EINTR)
+    {
+      serverLog(SERVER_LOGLEVEL_ERROR, "Client event loop failed (%s)", strerror(errno));
+      break;
+    }
+
+    _cupsMutexLock(&client_mutex);
+
+    for (i = 0; i < nevents; i ++)
+    {
+#  ifdef HAVE_EPOLL
+      client = (server_client_t *)events[i].data.ptr;
+#  else
+      client = (server_client_t *)events[i].udata;
+#  endif /* HAVE_EPOLL */
+
+      cupsArrayRemove(client_idle, client);
+      cupsArrayAdd(client_ready, client);
+    }
+
+    if (nevents > 0)
+      _cupsCondBroadcast(&client_cond);
+
+    if ((curtime = time(NULL)) >= next_sweep)
+    {
+     /*
+      * Collect clients that have been idle too long...
+      */
+
+      for (client = (server_client_t *)cupsArrayFirst(client_idle); client; client = (server_client_t *)cupsArrayNext(client_idle))
+      {
+        if ((curtime - client->idle) >= SERVER_CLIENT_TIMEOUT)
+        {
+	  cupsArrayRemove(client_idle, client);
+	  cupsArrayAdd(expired, client);
+
+#  ifdef HAVE_EPOLL
+          epoll_ctl(client_evfd, EPOLL_CTL_DEL, httpGetFd(client->http), NULL);
+#  else
+	  EV_SET(&event, httpGetFd(client->http), EVFILT_READ, EV_DELETE, 0, 0, client);
+	  kevent(client_evfd, &event, 1, NULL, 0, NULL);
+#  endif /* HAVE_EPOLL */
+        }
       }
+
+      next_sweep = curtime + 1;
     }
-    else
-      format ++;
+
+    _cupsMutexUnlock(&client_mutex);
+
+   /*
+    * Close expired clients outside the lock...
+    */
+
+    for (client = (server_client_t *)cupsArrayFirst(expired); client; client = (server_client_t *)cupsArrayNext(expired))
+      serverDeleteClient(client);
+
+    cupsArrayClear(expired);
   }
 
-  if (format > start)
-    httpWrite2(client->http, start, (size_t)(format - start));
+  cupsArrayDelete(expired);
 
-  va_end(ap);
+  return (NULL);
 }
 
 
 /*
- * 'parse_options()' - Parse URL options into CUPS options.
- *
- * The client->options string is destroyed by this function.
+ * 'run_client_worker()' - Process requests from ready clients.
  */
 
-static int				/* O - Number of options */
-parse_options(server_client_t *client,	/* I - Client */
-              cups_option_t   **options)/* O - Options */
+static void *				/* O - Thread exit status */
+run_client_worker(void *data)		/* I - Thread data (unused) */
 {
-  char	*post_data = NULL,		/* POST form data */
-	*name,				/* Name */
-      	*value,				/* Value */
-	*next;				/* Next name=value pair */
-  int	num_options = 0;		/* Number of options */
+  server_client_t	*client;	/* Current client */
+  int			keep_alive;	/* Keep the connection open? */
 
 
-  *options = NULL;
+  (void)data;
 
-  if (httpGetState(client->http) == HTTP_STATE_POST_RECV)
+  for (;;)
   {
-    off_t	post_len = httpGetLength2(client->http);
-					/* Length of POST form data */
+    _cupsMutexLock(&client_mutex);
 
-    if (post_len == 0 || post_len > 65535)
-      post_len = 65535;
+    while ((client = (server_client_t *)cupsArrayFirst(client_ready)) == NULL)
+      _cupsCondWait(&client_cond, &client_mutex, 0.0);
 
-    if ((post_data = calloc(1, (size_t)post_len + 1)) != NULL)
-    {
-      char	*post_ptr = post_data,	/* Pointer into POST form data */
-		*post_end = post_data + post_len;
-					/* Pointer to end of POST form data */
-      ssize_t	post_bytes;		/* Number of bytes read... */
+    cupsArrayRemove(client_ready, client);
 
+    _cupsMutexUnlock(&client_mutex);
 
-      while ((post_bytes = httpRead2(client->http, post_ptr, (size_t)(post_end - post_ptr))) > 0)
-      {
-        post_ptr += post_bytes;
-      }
+   /*
+    * Process requests until the client has no more buffered input, then return
+    * the connection to the idle set...
+    */
 
-      *post_ptr = '\0';
+    do
+    {
+      keep_alive = process_request(client);
     }
+    while (keep_alive && httpWait(client->http, 0));
 
-    name = post_data;
+    if (keep_alive)
+      watch_client(client);
+    else
+      serverDeleteClient(client);
   }
-  else
-    name = client->options;
 
-  while (name && *name)
+  return (NULL);
+}
+#endif /* HAVE_EPOLL || HAVE_KQUEUE */
+
+
+/*
+ * 'run_timers()' - Run pending timers.
+ */
+
+static int				/* O - Milliseconds until next timer */
+run_timers(void)
+{
+  server_timer_t	*timer;		/* Current timer */
+  time_t		curtime;	/* Current time */
+  int			timeout = 86400000;
+					/* Timeout in milliseconds */
+
+
+  _cupsMutexLock(&timer_mutex);
+
+  while ((timer = (server_timer_t *)cupsArrayFirst(timers)) != NULL)
   {
-    if ((value = strchr(name, '=')) == NULL)
+    if (timer->when > (curtime = time(NULL)))
+    {
+      if ((timer->when - curtime) < 86400)
+        timeout = (int)(timer->when - curtime) * 1000;
       break;
+    }
 
-    *value++ = '\0';
-    if ((next = strchr(value, '&')) != NULL)
-      *next++ = '\0';
+    cupsArrayRemove(timers, timer);
 
-    num_options = cupsAddOption(name, value, num_options, options);
-    name        = next;
+   /*
+    * Callbacks may add timers, so don't hold the lock while running them...
+    */
+
+    _cupsMutexUnlock(&timer_mutex);
+
+    (timer->cb)(timer->data);
+    free(timer);
+
+    _cupsMutexLock(&timer_mutex);
   }
 
-  if (post_data)
-    free(post_data);
+  _cupsMutexUnlock(&timer_mutex);
 
-  return (num_options);
+  return (timeout);
+}
+
+
+/*
+ * 'send_data()' - Send a static file or in-memory object.
+ *
+ * Static objects may be cached by the client for a minute and are revalidated
+ * using the ETag and Last-Modified values after that.
+ */
+
+static int				/* O - 1 on success, 0 on failure */
+send_data(server_client_t *client,	/* I - Client */
+          const char      *type,	/* I - MIME media type */
+          const void      *data,	/* I - Data */
+          size_t          datalen,	/* I - Length of data */
+          const char      *etag,	/* I - ETag value */
+          time_t          mtime)	/* I - Modification time or 0 */
+{
+  http_status_t	code;			/* HTTP status */
+
+
+  if ((code = respond_cached(client, NULL, type, datalen, etag, mtime, "max-age=60")) == HTTP_STATUS_ERROR)
+    return (0);
+
+  if (code == HTTP_STATUS_OK && datalen > 0 && httpWrite2(client->http, (const char *)data, datalen) < 0)
+    return (0);
+
+  httpFlushWrite(client->http);
+
+  return (1);
 }
 
 
@@ -1427,6 +2339,29 @@ send_printer_payload(
 }
 
 
+/*
+ * 'send_resource()' - Send the contents of a resource file.
+ *
+ * The cached resource data is sent with an ETag so that clients can
+ * revalidate with "If-None-Match" and get a "304 Not Modified" response.
+ */
+
+static int				/* O - 1 on success, 0 on failure */
+send_resource(server_client_t   *client,/* I - Client */
+              server_resource_t *res)	/* I - Resource */
+{
+  const unsigned char	*data;		/* Resource data */
+  size_t		datalen;	/* Length of data */
+  char			etag[64];	/* ETag value */
+
+
+  if ((data = serverGetResourceData(res, &datalen, etag, sizeof(etag))) == NULL)
+    return (serverRespondHTTP(client, HTTP_STATUS_NOT_FOUND, NULL, NULL, 0));
+
+  return (send_data(client, res->format, data, datalen, etag, res->mtime));
+}
+
+
 /*
  * 'show_materials()' - Show material load state.
  */
@@ -1537,6 +2472,8 @@ show_materials(
     if (!materials_ready)
       materials_ready = ippAddOutOfBand(printer->pinfo.attrs, IPP_TAG_PRINTER, IPP_TAG_NOVALUE, "materials-col-ready");
 
+    serverClearPrinterCacheNoLock(printer);
+
     _cupsRWUnlock(&printer->rwlock);
   }
 
@@ -1821,7 +2758,16 @@ show_media(server_client_t  *client,	/* I - Client connection */
     if (!media_ready)
       media_ready = ippAddOutOfBand(printer->pinfo.attrs, IPP_TAG_PRINTER, IPP_TAG_NOVALUE, "media-ready");
 
+    serverClearPrinterCacheNoLock(printer);
+
     _cupsRWUnlock(&printer->rwlock);
+
+   /*
+    * Start any jobs that were waiting for media...
+    */
+
+    if (!(printer->state_reasons & SERVER_PREASON_MEDIA_EMPTY))
+      serverCheckJobs(printer);
   }
 
   if (printer->pinfo.web_forms)
@@ -1951,9 +2897,12 @@ show_status(server_client_t  *client,	/* I - Client connection */
             const char       *encoding)	/* I - Content-Encoding to use */
 {
   server_job_t		*job;		/* Current job */
+  cups_array_iter_t	iter;		/* Job iterator */
   int			i, j;		/* Looping vars */
   server_preason_t	reason;		/* Current reason */
   int			apple_client;	/* Is the client running an Apple OS? */
+  char			etag[64];	/* ETag value */
+  http_status_t		code;		/* HTTP status */
   static const char * const reasons[] =	/* Reason strings */
   {
     "Other",
@@ -1977,8 +2926,19 @@ show_status(server_client_t  *client,	/* I - Client connection */
 
   apple_client = strstr(httpGetField(client->http, HTTP_FIELD_USER_AGENT), "Mac OS X") != NULL;
 
-  if (!serverRespondHTTP(client, HTTP_STATUS_OK, encoding, "text/html", 0))
-    return (0);
+ /*
+  * The page content only changes when the web generation counter is bumped by
+  * a new event or job purge, so clients that poll the page using the refresh
+  * timer can revalidate their copy...
+  */
+
+  if (printer)
+    snprintf(etag, sizeof(etag), "W/\"p%d-%lx-%x%s%s\"", printer->id, (unsigned long)printer->start_time, SERVER_GEN_READ(printer->web_gen), apple_client ? "-a" : "", encoding ? "-z" : "");
+  else
+    snprintf(etag, sizeof(etag), "W/\"s-%lx-%x%s%s\"", (unsigned long)SystemStartTime, SERVER_GEN_READ(SystemWebGen), apple_client ? "-a" : "", encoding ? "-z" : "");
+
+  if ((code = respond_cached(client, encoding, "text/html", 0, etag, 0, "no-cache")) != HTTP_STATUS_OK)
+    return (code != HTTP_STATUS_ERROR);
 
   if (printer)
   {
@@ -2006,7 +2966,9 @@ show_status(server_client_t  *client,	/* I - Client connection */
       _cupsRWLockRead(&(printer->rwlock));
 
       html_printf(client, "<table class=\"striped\" summary=\"Jobs\"><thead><tr><th>Job #</th><th>Name</th><th>Owner</th><th>When</th></tr></thead><tbody>\n");
-      for (job = (server_job_t *)cupsArrayFirst(printer->jobs); job; job = (server_job_t *)cupsArrayNext(printer->jobs))
+      cupsArrayIterInit(&iter, printer->jobs);
+
+      for (job = (server_job_t *)cupsArrayIterNext(&iter); job; job = (server_job_t *)cupsArrayIterNext(&iter))
       {
         char	when[256],		/* When job queued/started/finished */
                 hhmmss[64];		/* Time HH:MM:SS */
@@ -2207,6 +3169,8 @@ show_supplies(
       }
     }
 
+    serverClearPrinterCacheNoLock(printer);
+
     _cupsRWUnlock(&printer->rwlock);
   }
 
@@ -2262,3 +3226,264 @@ show_supplies(
 
   return (1);
 }
+
+
+/*
+ * 'start_accept_workers()' - Start the accept worker threads.
+ *
+ * Each network listener is reopened with SO_REUSEPORT and every worker gets
+ * its own socket bound to the same address, so the kernel spreads incoming
+ * connections over the workers' accept queues.  The main loop keeps the
+ * original sockets and accepts on them as its share of the load.  Domain
+ * socket listeners are left alone.
+ */
+
+static int				/* O - 1 on success, 0 on failure */
+start_accept_workers(void)
+{
+#ifdef SO_REUSEPORT
+  int			i,		/* Looping var */
+			started = 0;	/* Number of threads started */
+  server_listener_t	*lis,		/* Current listener */
+			*wlis;		/* Worker listener */
+  cups_array_t		**workers;	/* Listeners for each worker */
+  _cups_thread_t	t;		/* Worker thread */
+  char			temp[256];	/* Numeric address */
+
+
+  if ((workers = calloc((size_t)AcceptWorkers, sizeof(cups_array_t *))) == NULL)
+    return (0);
+
+  for (i = 0; i < AcceptWorkers; i ++)
+    workers[i] = cupsArrayNew(NULL, NULL);
+
+  for (lis = (server_listener_t *)cupsArrayFirst(Listeners); lis; lis = (server_listener_t *)cupsArrayNext(Listeners))
+  {
+#  ifdef AF_LOCAL
+    if (httpAddrFamily(&(lis->addr)) == AF_LOCAL)
+      continue;
+#  endif /* AF_LOCAL */
+
+   /*
+    * SO_REUSEPORT must be set on every socket in the group, including the
+    * first, so replace the main loop's socket before adding more...
+    */
+
+    httpAddrClose(NULL, lis->fd);
+
+    if ((lis->fd = _httpAddrListen(&(lis->addr), lis->port, SOMAXCONN, 1)) < 0)
+    {
+      serverLog(SERVER_LOGLEVEL_ERROR, "Unable to listen on address \"%s\": %s", httpAddrString(&(lis->addr), temp, sizeof(temp)), cupsLastErrorString());
+      continue;
+    }
+
+    for (i = 0; i < AcceptWorkers; i ++)
+    {
+      if ((wlis = calloc(1, sizeof(server_listener_t))) == NULL)
+        break;
+
+      *wlis = *lis;
+
+      if ((wlis->fd = _httpAddrListen(&(lis->addr), lis->port, SOMAXCONN, 1)) < 0)
+      {
+        serverLog(SERVER_LOGLEVEL_ERROR, "Unable to listen on address \"%s\": %s", httpAddrString(&(lis->addr), temp, sizeof(temp)), cupsLastErrorString());
+        free(wlis);
+        break;
+      }
+
+      cupsArrayAdd(workers[i], wlis);
+    }
+  }
+
+  for (i = 0; i < AcceptWorkers; i ++)
+  {
+    if (cupsArrayCount(workers[i]) > 0 && (t = _cupsThreadCreate((_cups_thread_func_t)run_accept_worker, workers[i])) != 0)
+    {
+      _cupsThreadDetach(t);
+      serverMetricsAdjust(SERVER_METRIC_THREADS, 1);
+      started ++;
+      continue;
+    }
+
+    if (cupsArrayCount(workers[i]) > 0)
+      serverLog(SERVER_LOGLEVEL_ERROR, "Unable to create accept worker thread (%s)", strerror(errno));
+
+   /*
+    * Close the sockets for this worker so the kernel does not queue
+    * connections that nobody will accept...
+    */
+
+    for (wlis = (server_listener_t *)cupsArrayFirst(workers[i]); wlis; wlis = (server_listener_t *)cupsArrayNext(workers[i]))
+    {
+      httpAddrClose(NULL, wlis->fd);
+      free(wlis);
+    }
+
+    cupsArrayDelete(workers[i]);
+  }
+
+  free(workers);
+
+  listeners_changed = 1;
+
+  if (started > 0)
+    serverLog(SERVER_LOGLEVEL_INFO, "Using %d accept worker threads.", started);
+
+  return (started > 0);
+
+#else
+  serverLog(SERVER_LOGLEVEL_ERROR, "AcceptWorkers requires SO_REUSEPORT support.");
+
+  return (0);
+#endif /* SO_REUSEPORT */
+}
+
+
+/*
+ * 'start_client_workers()' - Start the client event loop and worker threads.
+ */
+
+static int				/* O - 1 on success, 0 on failure */
+start_client_workers(void)
+{
+#if defined(HAVE_EPOLL) || defined(HAVE_KQUEUE)
+  int			i;		/* Looping var */
+  _cups_thread_t	t;		/* Thread */
+
+
+#  ifdef HAVE_EPOLL
+  if ((client_evfd = epoll_create(1024)) < 0)
+#  else
+  if ((client_evfd = kqueue()) < 0)
+#  endif /* HAVE_EPOLL */
+  {
+    serverLog(SERVER_LOGLEVEL_ERROR, "Unable to create client event descriptor: %s", strerror(errno));
+    return (0);
+  }
+
+  client_idle  = cupsArrayNew((cups_array_func_t)compare_clients, NULL);
+  client_ready = cupsArrayNew(NULL, NULL);
+
+  for (i = 0; i < ClientWorkers; i ++)
+  {
+    if ((t = _cupsThreadCreate((_cups_thread_func_t)run_client_worker, NULL)) == 0)
+    {
+      serverLog(SERVER_LOGLEVEL_ERROR, "Unable to create client worker thread (%s)", strerror(errno));
+      break;
+    }
+
+    _cupsThreadDetach(t);
+    serverMetricsAdjust(SERVER_METRIC_THREADS, 1);
+  }
+
+  if (i == 0 || (t = _cupsThreadCreate((_cups_thread_func_t)run_client_events, NULL)) == 0)
+  {
+   /*
+    * Worker threads stay blocked on an empty queue, which is harmless...
+    */
+
+    close(client_evfd);
+    client_evfd = -1;
+
+    return (0);
+  }
+
+  _cupsThreadDetach(t);
+  serverMetricsAdjust(SERVER_METRIC_THREADS, 1);
+
+  serverLog(SERVER_LOGLEVEL_INFO, "Using %d client worker threads.", i);
+
+  return (1);
+
+#else
+  serverLog(SERVER_LOGLEVEL_ERROR, "ClientWorkers requires epoll or kqueue support.");
+
+  return (0);
+#endif /* HAVE_EPOLL || HAVE_KQUEUE */
+}
+
+
+/*
+ * 'watch_client()' - Add a client to the idle set and wait for its next request.
+ */
+
+static void
+watch_client(server_client_t *client)	/* I - Client */
+{
+#if defined(HAVE_EPOLL) || defined(HAVE_KQUEUE)
+  int	fd = httpGetFd(client->http);	/* Client socket */
+  int	status;				/* Status of epoll/kqueue call */
+#  ifdef HAVE_EPOLL
+  struct epoll_event	event;		/* Event */
+#  else
+  struct kevent		event;		/* Event */
+#  endif /* HAVE_EPOLL */
+
+
+  client->idle = time(NULL);
+
+ /*
+  * Add the client to the idle set before arming the descriptor so that the
+  * event thread always finds it there...
+  */
+
+  _cupsMutexLock(&client_mutex);
+
+  cupsArrayAdd(client_idle, client);
+
+#  ifdef HAVE_EPOLL
+  memset(&event, 0, sizeof(event));
+  event.events   = EPOLLIN | EPOLLONESHOT;
+  event.data.ptr = client;
+
+  if ((status = epoll_ctl(client_evfd, EPOLL_CTL_MOD, fd, &event)) < 0 && errno == ENOENT)
+    status = epoll_ctl(client_evfd, EPOLL_CTL_ADD, fd, &event);
+#  else
+  EV_SET(&event, fd, EVFILT_READ, EV_ADD | EV_ENABLE | EV_DISPATCH, 0, 0, client);
+
+  status = kevent(client_evfd, &event, 1, NULL, 0, NULL);
+#  endif /* HAVE_EPOLL */
+
+  if (status < 0)
+    cupsArrayRemove(client_idle, client);
+
+  _cupsMutexUnlock(&client_mutex);
+
+  if (status < 0)
+  {
+    serverLogClient(SERVER_LOGLEVEL_ERROR, client, "Unable to watch client connection: %s", strerror(errno));
+    serverDeleteClient(client);
+  }
+
+#else
+  (void)client;
+#endif /* HAVE_EPOLL || HAVE_KQUEUE */
+}
+
+
+/*
+ * 'write_splice_cb()' - Write IPP data to the client, holding back the last
+ *                       byte (the end tag) so cached attributes can be
+ *                       inserted before it.
+ */
+
+static ssize_t				/* O - Number of bytes written */
+write_splice_cb(
+    server_splice_t *splice,		/* I - Cached response writer */
+    ipp_uchar_t     *buffer,		/* I - Data to write */
+    size_t          bytes)		/* I - Number of bytes to write */
+{
+  if (bytes == 0)
+    return (0);
+
+  if (splice->pending && httpWrite2(splice->http, (char *)&splice->last, 1) < 0)
+    return (-1);
+
+  if (bytes > 1 && httpWrite2(splice->http, (char *)buffer, bytes - 1) < 0)
+    return (-1);
+
+  splice->pending = 1;
+  splice->last    = buffer[bytes - 1];
+
+  return ((ssize_t)bytes);
+}
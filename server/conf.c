@@ -15,15 +15,89 @@
 #  include <fnmatch.h>
 #  include <pwd.h>
 #  include <grp.h>
+#  include <sys/mman.h>
 #endif /* !_WIN32 */
 #include <cups/ipp-private.h>
 
 
+/*
+ * Local constants...
+ */
+
+#define SERVER_LOAD_WORKERS	8	/* Maximum number of printer loading threads */
+#define SERVER_SAVE_DELAY	2	/* Seconds to coalesce state changes */
+#define SERVER_SNAPSHOT_MAGIC	"IPPSNAP\n"
+					/* Snapshot file magic */
+#define SERVER_SNAPSHOT_VERSION	1	/* Snapshot file version */
+
+
+/*
+ * Local types...
+ */
+
+typedef struct server_pload_s		/**** Printer to load ****/
+{
+  char			*filename,	/* Attribute file */
+			*icon,		/* Icon file, if any */
+			*name,		/* Printer name */
+			*resource,	/* Resource path */
+			*snapshot;	/* Snapshot file, if any */
+  int			dirty;		/* Save printer state after loading? */
+  server_printer_t	*printer;	/* Loaded printer, if any */
+} server_pload_t;
+
+typedef struct server_ploader_s		/**** Printer loader ****/
+{
+  _cups_mutex_t		mutex;		/* Mutex for next and next_id */
+  _cups_cond_t		cond;		/* Condition for next_id */
+  int			num_loads,	/* Number of printers to load */
+			alloc_loads,	/* Allocated printers to load */
+			next,		/* Next printer to load */
+			next_id;	/* Next printer to assign a printer-id */
+  server_pload_t	*loads;		/* Printers to load */
+} server_ploader_t;
+
+typedef struct server_psnap_s		/**** Published printer lookup table ****/
+{
+  int			count;		/* Number of printers */
+  server_printer_t	*first;		/* First printer by resource path */
+  unsigned		mask;		/* Size of hash table - 1 */
+  server_printer_t	*table[1];	/* Hash table of printers */
+} server_psnap_t;
+
+typedef struct server_snapbuf_s		/**** Snapshot read buffer ****/
+{
+  const ipp_uchar_t	*ptr,		/* Current position */
+			*end;		/* End of buffer */
+} server_snapbuf_t;
+
+
 /*
  * Local globals...
  */
 
 static char		*default_printer = NULL;
+static server_psnap_t	*printers_snap = NULL;
+					/* Published printer lookup table */
+static _cups_mutex_t	resource_mutex = _CUPS_MUTEX_INITIALIZER;
+					/* Mutex for shared resource files */
+static unsigned		snap_epoch = 0,	/* Current reader epoch */
+			snap_readers[2] = { 0, 0 };
+					/* Readers in each epoch */
+static _cups_mutex_t	snap_mutex = _CUPS_MUTEX_INITIALIZER;
+					/* Mutex for publishing snapshots */
+static _cups_cond_t	state_cond = _CUPS_COND_INITIALIZER;
+					/* Condition for state changes */
+static cups_array_t	*state_deleted = NULL;
+					/* State files to remove */
+static _cups_mutex_t	state_mutex = _CUPS_MUTEX_INITIALIZER;
+					/* Mutex for state changes */
+static int		state_pending = 0,
+					/* Are state changes pending? */
+			state_thread = 0;
+					/* Has the state thread been started? */
+static ipp_t		*system_snap = NULL;
+					/* Published system attributes */
 
 
 /*
@@ -32,6 +106,9 @@ static char		*default_printer = NULL;
 
 static void		add_document_privacy(void);
 static void		add_job_privacy(void);
+static void		add_printer_unsorted(server_printer_t *printer);
+static void		add_profile(server_pinfo_t *pinfo, const char *name, const char *filename, ipp_t *attrs);
+static void		add_strings(server_pinfo_t *pinfo, const char *language, const char *filename);
 static void		add_subscription_privacy(void);
 static int		attr_cb(_ipp_file_t *f, server_pinfo_t *pinfo, const char *attr);
 static int		compare_lang(server_lang_t *a, server_lang_t *b);
@@ -45,14 +122,30 @@ static void		dnssd_client_cb(AvahiClient *c, AvahiClientState state, void *userd
 static void		dnssd_init(void);
 static int		error_cb(_ipp_file_t *f, server_pinfo_t *pinfo, const char *error);
 static int		finalize_system(void);
+#ifndef _WIN32
+static int		find_group(const char *name, gid_t *gid);
+#endif /* !_WIN32 */
 static void		free_icc(server_icc_t *a);
 static void		free_lang(server_lang_t *a);
+static void		*load_printers(server_ploader_t *loader);
+static int		load_snapshot(const char *filename, server_pinfo_t *pinfo);
 static int		load_system(const char *conf);
 static ipp_t		*parse_collection(_ipp_file_t *f, _ipp_vars_t *v, void *user_data);
 static int		parse_value(_ipp_file_t *f, _ipp_vars_t *v, void *user_data, ipp_t *ipp, ipp_attribute_t **attr, int element);
 static void		print_escaped_string(cups_file_t *fp, const char *s, size_t len);
 static void		print_ipp_attr(cups_file_t *fp, ipp_attribute_t *attr, int indent);
+static void		queue_printers(server_ploader_t *loader, const char *directory, const char *type);
+static ssize_t		read_snapshot(server_snapbuf_t *buf, ipp_uchar_t *buffer, size_t bytes);
 static void		save_printer(server_printer_t *printer, const char *directory);
+static void		save_snapshot(server_printer_t *printer, const char *directory);
+static void		*save_system(void *data);
+static unsigned		snap_enter(void);
+static void		snap_leave(unsigned epoch);
+static void		snap_synchronize(void);
+static int		snapshot_attr_cb(void *context, ipp_t *dst, ipp_attribute_t *attr);
+static int		snapshot_profile_cb(void *context, ipp_t *dst, ipp_attribute_t *attr);
+static void		state_changed(void);
+static void		state_directory(server_printer_t *printer, char *buffer, size_t bufsize);
 static int		token_cb(_ipp_file_t *f, _ipp_vars_t *vars, server_pinfo_t *pinfo, const char *token);
 
 
@@ -64,14 +157,18 @@ void
 serverAddPrinter(
     server_printer_t *printer)		/* I - Printer to add */
 {
-  _cupsRWLockWrite(&SystemRWLock);
+  _cupsRWLockWrite(&PrintersRWLock);
 
   if (!Printers)
     Printers = cupsArrayNew((cups_array_func_t)compare_printers, NULL);
 
   cupsArrayAdd(Printers, printer);
 
-  _cupsRWUnlock(&SystemRWLock);
+  serverPublishPrinters();
+
+  _cupsRWUnlock(&PrintersRWLock);
+
+  serverMarkPrinterDirty(printer);
 }
 
 
@@ -112,7 +209,7 @@ serverCleanAllJobs(void)
   server_printer_t  *printer;             /* Current printer */
 
 
-  serverLog(SERVER_LOGLEVEL_DEBUG, "Cleaning old jobs.");
+  SERVER_LOG_DEBUG("Cleaning old jobs.");
 
   _cupsRWLockRead(&PrintersRWLock);
 
@@ -132,15 +229,15 @@ int					/* O - 1 if successful, 0 on error */
 serverCreateSystem(
     const char *directory)		/* I - Configuration directory */
 {
-  cups_dir_t	*dir;			/* Directory pointer */
-  cups_dentry_t	*dent;			/* Directory entry */
-  char		confdir[1024],		/* Configuration directory */
-  		filename[1024],		/* Configuration file */
-                iconname[1024],		/* Icon file */
-		resource[1024],		/* Resource path */
-                *ptr;			/* Pointer into filename */
+  int		i;			/* Looping var */
+  char		filename[1024];		/* Configuration file */
   server_printer_t *printer;		/* Printer */
-  server_pinfo_t pinfo;			/* Printer information */
+  server_ploader_t loader;		/* Printer loader */
+  server_pload_t *load;			/* Current printer load */
+  server_printer_t **registered;	/* Printers registered with DNS-SD */
+  _cups_thread_t threads[SERVER_LOAD_WORKERS];
+					/* Printer loading threads */
+  int		num_threads;		/* Number of loading threads */
 
 
   SystemStartTime = SystemConfigChangeTime = time(NULL);
@@ -169,162 +266,68 @@ serverCreateSystem(
   * Then see if there are any print queues...
   */
 
-  if (StateDirectory)
-  {
-   /*
-    * See if we have saved printer state information...
-    */
+  memset(&loader, 0, sizeof(loader));
+  _cupsMutexInit(&loader.mutex);
+  _cupsCondInit(&loader.cond);
 
-    snprintf(confdir, sizeof(confdir), "%s/print", StateDirectory);
+  queue_printers(&loader, directory, "print");
+  queue_printers(&loader, directory, "print3d");
 
-    if (access(confdir, 0))
-      snprintf(confdir, sizeof(confdir), "%s/print", directory);
-  }
-  else
-    snprintf(confdir, sizeof(confdir), "%s/print", directory);
+ /*
+  * Load the printers using a pool of threads, with this thread helping...
+  */
 
-  if ((dir = cupsDirOpen(confdir)) != NULL)
+  for (num_threads = 0; num_threads < (SERVER_LOAD_WORKERS - 1) && num_threads < (loader.num_loads - 1); num_threads ++)
   {
-    serverLog(SERVER_LOGLEVEL_INFO, "Loading printers from \"%s\".", filename);
-
-    while ((dent = cupsDirRead(dir)) != NULL)
+    if ((threads[num_threads] = _cupsThreadCreate((_cups_thread_func_t)load_printers, &loader)) == 0)
     {
-      if ((ptr = strrchr(dent->filename, '.')) == NULL)
-        ptr = "";
-
-      if (!strcmp(ptr, ".conf"))
-      {
-       /*
-        * Load the conf file, with any associated icon image.
-        */
-
-        serverLog(SERVER_LOGLEVEL_INFO, "Loading printer from \"%s\".", dent->filename);
-
-        snprintf(filename, sizeof(filename), "%s/%s", confdir, dent->filename);
-        *ptr = '\0';
-
-        memset(&pinfo, 0, sizeof(pinfo));
-
-        pinfo.print_group       = SERVER_GROUP_NONE;
-	pinfo.proxy_group       = SERVER_GROUP_NONE;
-	pinfo.initial_accepting = 1;
-	pinfo.initial_state     = IPP_PSTATE_IDLE;
-	pinfo.initial_reasons   = SERVER_PREASON_NONE;
-        pinfo.web_forms         = 1;
-
-        snprintf(iconname, sizeof(iconname), "%s/%s.png", confdir, dent->filename);
-        if (!access(iconname, R_OK))
-        {
-          pinfo.icon = strdup(iconname);
-	}
-	else if (StateDirectory)
-	{
-	  snprintf(iconname, sizeof(iconname), "%s/print/%s.png", directory, dent->filename);
-	  if (!access(iconname, R_OK))
-	    pinfo.icon = strdup(iconname);
-	}
-
-        if (serverLoadAttributes(filename, &pinfo))
-	{
-          snprintf(resource, sizeof(resource), "/ipp/print/%s", dent->filename);
-
-	  if ((printer = serverCreatePrinter(resource, dent->filename, dent->filename, &pinfo, 0)) == NULL)
-            continue;
-
-          printer->state         = pinfo.initial_state;
-          printer->state_reasons = pinfo.initial_reasons;
-          printer->is_accepting  = pinfo.initial_accepting;
-
-          serverAddPrinter(printer);
-	}
-      }
-      else if (strcmp(ptr, ".png") && strcmp(ptr, ".strings"))
-        serverLog(SERVER_LOGLEVEL_INFO, "Skipping \"%s\".", dent->filename);
+      serverLog(SERVER_LOGLEVEL_ERROR, "Unable to create printer loading thread (%s)", strerror(errno));
+      break;
     }
-
-    cupsDirClose(dir);
   }
 
+  load_printers(&loader);
+
+  while (num_threads > 0)
+    _cupsThreadWait(threads[-- num_threads]);
+
  /*
-  * Finally, see if there are any 3D print queues...
+  * Then register and add the printers in the order they were found...
   */
 
-  if (StateDirectory)
+  if ((registered = calloc((size_t)loader.num_loads + 1, sizeof(server_printer_t *))) != NULL)
   {
-   /*
-    * See if we have saved printer state information...
-    */
-
-    snprintf(confdir, sizeof(confdir), "%s/print3d", StateDirectory);
+    for (i = 0, load = loader.loads; i < loader.num_loads; i ++, load ++)
+      registered[i] = load->printer;
 
-    if (access(confdir, 0))
-      snprintf(confdir, sizeof(confdir), "%s/print3d", directory);
+    serverRegisterPrinters(loader.num_loads, registered);
   }
-  else
-    snprintf(confdir, sizeof(confdir), "%s/print3d", directory);
 
-  if ((dir = cupsDirOpen(confdir)) != NULL)
+  for (i = 0, load = loader.loads; i < loader.num_loads; i ++, load ++)
   {
-    serverLog(SERVER_LOGLEVEL_INFO, "Loading 3D printers from \"%s\".", filename);
-
-    while ((dent = cupsDirRead(dir)) != NULL)
+    if (load->printer)
     {
-      if ((ptr = strrchr(dent->filename, '.')) == NULL)
-        ptr = "";
-
-      if (!strcmp(ptr, ".conf"))
-      {
-       /*
-        * Load the conf file, with any associated icon image.
-        */
-
-        serverLog(SERVER_LOGLEVEL_INFO, "Loading 3D printer from \"%s\".", dent->filename);
-
-        snprintf(filename, sizeof(filename), "%s/%s", confdir, dent->filename);
-        *ptr = '\0';
-
-        memset(&pinfo, 0, sizeof(pinfo));
-
-        pinfo.print_group       = SERVER_GROUP_NONE;
-	pinfo.proxy_group       = SERVER_GROUP_NONE;
-	pinfo.initial_accepting = 1;
-	pinfo.initial_state     = IPP_PSTATE_IDLE;
-	pinfo.initial_reasons   = SERVER_PREASON_NONE;
-        pinfo.web_forms         = 1;
-
-        snprintf(iconname, sizeof(iconname), "%s/%s.png", confdir, dent->filename);
-        if (!access(iconname, R_OK))
-        {
-          pinfo.icon = strdup(iconname);
-	}
-	else if (StateDirectory)
-	{
-	  snprintf(iconname, sizeof(iconname), "%s/print3d/%s.png", directory, dent->filename);
-	  if (!access(iconname, R_OK))
-	    pinfo.icon = strdup(iconname);
-	}
-
-        if (serverLoadAttributes(filename, &pinfo))
-	{
-          snprintf(resource, sizeof(resource), "/ipp/print3d/%s", dent->filename);
-
-	  if ((printer = serverCreatePrinter(resource, dent->filename, dent->filename, &pinfo, 0)) == NULL)
-          continue;
-
-          printer->state         = pinfo.initial_state;
-          printer->state_reasons = pinfo.initial_reasons;
-          printer->is_accepting  = pinfo.initial_accepting;
-
-          serverAddPrinter(printer);
-	}
-      }
-      else if (strcmp(ptr, ".png") && strcmp(ptr, ".strings"))
-        serverLog(SERVER_LOGLEVEL_INFO, "Skipping \"%s\".", dent->filename);
+      if (registered ? registered[i] != NULL : serverRegisterPrinter(load->printer))
+        add_printer_unsorted(load->printer);
+      else
+        serverDeletePrinter(load->printer);
     }
 
-    cupsDirClose(dir);
+    free(load->filename);
+    free(load->icon);
+    free(load->name);
+    free(load->resource);
+    free(load->snapshot);
   }
 
+  free(loader.loads);
+  free(registered);
+
+  _cupsRWLockWrite(&PrintersRWLock);
+  cupsArraySort(Printers);
+  serverPublishPrinters();
+  _cupsRWUnlock(&PrintersRWLock);
+
   if (default_printer)
   {
     for (printer = (server_printer_t *)cupsArrayFirst(Printers); printer; printer = (server_printer_t *)cupsArrayNext(Printers))
@@ -344,37 +347,73 @@ serverCreateSystem(
 
 /*
  * 'serverFindPrinter()' - Find a printer by resource...
+ *
+ * Printers are looked up in the table published by serverPublishPrinters(),
+ * so no lock is needed.
  */
 
 server_printer_t *			/* O - Printer or NULL */
 serverFindPrinter(const char *resource)	/* I - Resource path */
 {
-  server_printer_t	key,		/* Search key */
-			*match = NULL;	/* Matching printer */
+  server_psnap_t	*snap;		/* Printer lookup table */
+  server_printer_t	*match = NULL;	/* Matching printer */
+  unsigned		epoch,		/* Reader epoch */
+			i;		/* Looping var */
 
 
-  _cupsRWLockRead(&PrintersRWLock);
-  if (cupsArrayCount(Printers) == 1 || !strcmp(resource, "/ipp/print"))
+  epoch = snap_enter();
+
+  if ((snap = SERVER_ATOMIC_GET(printers_snap)) == NULL || snap->count == 0)
+  {
+   /*
+    * No printers...
+    */
+  }
+  else if (snap->count == 1 || !strcmp(resource, "/ipp/print"))
   {
    /*
     * Just use the first printer...
     */
 
-    match = cupsArrayFirst(Printers);
+    match = snap->first;
     if (strcmp(match->resource, resource) && strcmp(resource, "/ipp/print"))
       match = NULL;
   }
   else
   {
-    key.resource = (char *)resource;
-    match        = (server_printer_t *)cupsArrayFind(Printers, &key);
+    for (i = _cupsStrHash(resource) & snap->mask; snap->table[i]; i = (i + 1) & snap->mask)
+    {
+      if (!strcmp(snap->table[i]->resource, resource))
+      {
+        match = snap->table[i];
+        break;
+      }
+    }
   }
-  _cupsRWUnlock(&PrintersRWLock);
+
+  snap_leave(epoch);
 
   return (match);
 }
 
 
+/*
+ * 'serverGetSystemAttributes()' - Get the published system attributes.
+ *
+ * The attributes must not be changed and the caller must not wait for any
+ * lock before calling serverReleaseSystemAttributes().
+ */
+
+ipp_t *					/* O - System attributes */
+serverGetSystemAttributes(
+    unsigned *epoch)			/* O - Reader epoch */
+{
+  *epoch = snap_enter();
+
+  return (SERVER_ATOMIC_GET(system_snap));
+}
+
+
 /*
  * 'serverLoadAttributes()' - Load printer attributes from a file.
  *
@@ -435,8 +474,164 @@ serverLoadAttributes(
 }
 
 
+/*
+ * 'serverMarkPrinterDeleted()' - Remove a printer's saved state.
+ *
+ * The state files are removed by the next save of the system state.
+ */
+
+void
+serverMarkPrinterDeleted(
+    server_printer_t *printer)		/* I - Printer */
+{
+  char	filename[1024];			/* State file base name */
+  size_t len;				/* Length of directory */
+
+
+  if (!StateDirectory)
+    return;
+
+  state_directory(printer, filename, sizeof(filename));
+  len = strlen(filename);
+  snprintf(filename + len, sizeof(filename) - len, "/%s", printer->name);
+
+  _cupsMutexLock(&state_mutex);
+
+  if (!state_deleted)
+    state_deleted = cupsArrayNew3(NULL, NULL, NULL, 0, NULL, (cups_afree_func_t)free);
+
+  cupsArrayAdd(state_deleted, strdup(filename));
+
+  state_changed();
+
+  _cupsMutexUnlock(&state_mutex);
+}
+
+
+/*
+ * 'serverMarkPrinterDirty()' - Mark a printer's state as needing to be saved.
+ *
+ * Changes are coalesced and written by a background thread.
+ */
+
+void
+serverMarkPrinterDirty(
+    server_printer_t *printer)		/* I - Printer */
+{
+  if (!StateDirectory)
+    return;
+
+  _cupsMutexLock(&state_mutex);
+
+  printer->is_dirty = 1;
+
+  state_changed();
+
+  _cupsMutexUnlock(&state_mutex);
+}
+
+
+/*
+ * 'serverPublishPrinters()' - Publish the printer lookup table.
+ *
+ * The caller must hold a write lock on PrintersRWLock.  The old table is freed
+ * once no thread is still looking up printers in it.
+ */
+
+void
+serverPublishPrinters(void)
+{
+  server_psnap_t	*snap,		/* New lookup table */
+			*old;		/* Old lookup table */
+  server_printer_t	*printer;	/* Current printer */
+  int			count;		/* Number of printers */
+  unsigned		mask,		/* Size of hash table - 1 */
+			i;		/* Looping var */
+
+
+  count = cupsArrayCount(Printers);
+
+  for (mask = 1; mask < 2 * (unsigned)count; mask <<= 1);
+  mask --;
+
+  if ((snap = calloc(1, sizeof(server_psnap_t) + mask * sizeof(server_printer_t *))) != NULL)
+  {
+    snap->count = count;
+    snap->first = (server_printer_t *)cupsArrayFirst(Printers);
+    snap->mask  = mask;
+
+    for (printer = snap->first; printer; printer = (server_printer_t *)cupsArrayNext(Printers))
+    {
+      for (i = _cupsStrHash(printer->resource) & mask; snap->table[i]; i = (i + 1) & mask);
+
+      snap->table[i] = printer;
+    }
+  }
+  else
+    serverLog(SERVER_LOGLEVEL_ERROR, "Unable to allocate memory for printer lookup table.");
+
+  _cupsMutexLock(&snap_mutex);
+
+  old = printers_snap;
+  SERVER_ATOMIC_SET(printers_snap, snap);
+  snap_synchronize();
+
+  _cupsMutexUnlock(&snap_mutex);
+
+  free(old);
+}
+
+
+/*
+ * 'serverPublishSystem()' - Publish a copy of the system attributes.
+ *
+ * The caller must hold a lock on SystemRWLock.  The copy includes the
+ * configuration change attributes so that Get-System-Attributes does not need
+ * the lock.
+ */
+
+void
+serverPublishSystem(void)
+{
+  ipp_t	*snap,				/* New system attributes */
+	*old;				/* Old system attributes */
+
+
+  snap = ippNew();
+
+  ippCopyAttributes(snap, SystemAttributes, 0, NULL, NULL);
+  ippAddDate(snap, IPP_TAG_SYSTEM, "system-config-change-date-time", ippTimeToDate(SystemConfigChangeTime));
+  ippAddInteger(snap, IPP_TAG_SYSTEM, IPP_TAG_INTEGER, "system-config-change-time", (int)(SystemConfigChangeTime - SystemStartTime));
+  ippAddInteger(snap, IPP_TAG_SYSTEM, IPP_TAG_INTEGER, "system-config-changes", SystemConfigChanges);
+
+  _cupsMutexLock(&snap_mutex);
+
+  old = system_snap;
+  SERVER_ATOMIC_SET(system_snap, snap);
+  snap_synchronize();
+
+  _cupsMutexUnlock(&snap_mutex);
+
+  ippDelete(old);
+}
+
+
+/*
+ * 'serverReleaseSystemAttributes()' - Release the published system attributes.
+ */
+
+void
+serverReleaseSystemAttributes(
+    unsigned epoch)			/* I - Reader epoch */
+{
+  snap_leave(epoch);
+}
+
+
 /*
  * 'serverSaveSystem()' - Save the state of the system.
+ *
+ * Only printers that have changed since the last save are written.
  */
 
 void
@@ -444,25 +639,52 @@ serverSaveSystem(void)
 {
   server_printer_t	*printer;	/* Current printer */
   char			filename[1024];	/* Output file/directory */
+  cups_array_t		*deleted;	/* State files to remove */
+  char			*base;		/* Current state file base name */
+  int			dirty;		/* Save this printer? */
 
 
   if (!StateDirectory)
     return;
 
-  serverLog(SERVER_LOGLEVEL_INFO, "Saving system state to \"%s\".", StateDirectory);
+  _cupsMutexLock(&state_mutex);
+  deleted       = state_deleted;
+  state_deleted = NULL;
+  _cupsMutexUnlock(&state_mutex);
+
+  for (base = (char *)cupsArrayFirst(deleted); base; base = (char *)cupsArrayNext(deleted))
+  {
+    serverLog(SERVER_LOGLEVEL_INFO, "Removing printer state \"%s.conf\".", base);
+
+    snprintf(filename, sizeof(filename), "%s.conf", base);
+    unlink(filename);
+    snprintf(filename, sizeof(filename), "%s.snap", base);
+    unlink(filename);
+    snprintf(filename, sizeof(filename), "%s.history", base);
+    unlink(filename);
+  }
+
+  cupsArrayDelete(deleted);
 
   _cupsRWLockRead(&PrintersRWLock);
 
   for (printer = (server_printer_t *)cupsArrayFirst(Printers); printer; printer = (server_printer_t *)cupsArrayNext(Printers))
   {
-    if (!strncmp(printer->resource, "/ipp/print/", 11))
-      snprintf(filename, sizeof(filename), "%s/print", StateDirectory);
-    else
-      snprintf(filename, sizeof(filename), "%s/print3d", StateDirectory);
+    _cupsMutexLock(&state_mutex);
+    dirty             = printer->is_dirty;
+    printer->is_dirty = 0;
+    _cupsMutexUnlock(&state_mutex);
+
+    if (!dirty)
+      continue;
+
+    state_directory(printer, filename, sizeof(filename));
 
     if (access(filename, 0))
       mkdir(filename, 0777);
 
+    serverLogPrinter(SERVER_LOGLEVEL_INFO, printer, "Saving printer state to \"%s\".", filename);
+
     save_printer(printer, filename);
   }
 
@@ -637,9 +859,9 @@ add_document_privacy(void)
 
     DocumentPrivacyArray = cupsArrayNew3((cups_array_func_t)strcmp, NULL, NULL, 0, (cups_acopy_func_t)strdup, (cups_afree_func_t)free);
     for (i = 0; i < (int)(sizeof(description) / sizeof(description[0])); i ++)
-      cupsArrayAdd(DocumentPrivacyArray, (void *)description[i]);
+      cupsArrayAddUnsorted(DocumentPrivacyArray, (void *)description[i]);
     for (i = 0; i < (int)(sizeof(template) / sizeof(template[0])); i ++)
-      cupsArrayAdd(DocumentPrivacyArray, (void *)template[i]);
+      cupsArrayAddUnsorted(DocumentPrivacyArray, (void *)template[i]);
   }
   else
   {
@@ -667,27 +889,29 @@ add_document_privacy(void)
       if (!strcmp(start, "default"))
       {
 	for (i = 0; i < (int)(sizeof(description) / sizeof(description[0])); i ++)
-	  cupsArrayAdd(DocumentPrivacyArray, (void *)description[i]);
+	  cupsArrayAddUnsorted(DocumentPrivacyArray, (void *)description[i]);
 	for (i = 0; i < (int)(sizeof(template) / sizeof(template[0])); i ++)
-	  cupsArrayAdd(DocumentPrivacyArray, (void *)template[i]);
+	  cupsArrayAddUnsorted(DocumentPrivacyArray, (void *)template[i]);
       }
       else if (!strcmp(start, "document-description"))
       {
 	for (i = 0; i < (int)(sizeof(description) / sizeof(description[0])); i ++)
-	  cupsArrayAdd(DocumentPrivacyArray, (void *)description[i]);
+	  cupsArrayAddUnsorted(DocumentPrivacyArray, (void *)description[i]);
       }
       else if (!strcmp(start, "document-template"))
       {
 	for (i = 0; i < (int)(sizeof(template) / sizeof(template[0])); i ++)
-	  cupsArrayAdd(DocumentPrivacyArray, (void *)template[i]);
+	  cupsArrayAddUnsorted(DocumentPrivacyArray, (void *)template[i]);
       }
       else
       {
-	cupsArrayAdd(DocumentPrivacyArray, (void *)start);
+	cupsArrayAddUnsorted(DocumentPrivacyArray, (void *)start);
       }
     }
   }
 
+  cupsArraySort(DocumentPrivacyArray);
+
   ippAddString(PrivacyAttributes, IPP_TAG_PRINTER, IPP_CONST_TAG(IPP_TAG_KEYWORD), "document-privacy-scope", NULL, DocumentPrivacyScope);
 }
 
@@ -915,9 +1139,9 @@ add_job_privacy(void)
 
     JobPrivacyArray = cupsArrayNew3((cups_array_func_t)strcmp, NULL, NULL, 0, (cups_acopy_func_t)strdup, (cups_afree_func_t)free);
     for (i = 0; i < (int)(sizeof(description) / sizeof(description[0])); i ++)
-      cupsArrayAdd(JobPrivacyArray, (void *)description[i]);
+      cupsArrayAddUnsorted(JobPrivacyArray, (void *)description[i]);
     for (i = 0; i < (int)(sizeof(template) / sizeof(template[0])); i ++)
-      cupsArrayAdd(JobPrivacyArray, (void *)template[i]);
+      cupsArrayAddUnsorted(JobPrivacyArray, (void *)template[i]);
   }
   else
   {
@@ -945,80 +1169,173 @@ add_job_privacy(void)
       if (!strcmp(start, "default"))
       {
 	for (i = 0; i < (int)(sizeof(description) / sizeof(description[0])); i ++)
-	  cupsArrayAdd(JobPrivacyArray, (void *)description[i]);
+	  cupsArrayAddUnsorted(JobPrivacyArray, (void *)description[i]);
 	for (i = 0; i < (int)(sizeof(template) / sizeof(template[0])); i ++)
-	  cupsArrayAdd(JobPrivacyArray, (void *)template[i]);
+	  cupsArrayAddUnsorted(JobPrivacyArray, (void *)template[i]);
       }
       else if (!strcmp(start, "job-description"))
       {
 	for (i = 0; i < (int)(sizeof(description) / sizeof(description[0])); i ++)
-	  cupsArrayAdd(JobPrivacyArray, (void *)description[i]);
+	  cupsArrayAddUnsorted(JobPrivacyArray, (void *)description[i]);
       }
       else if (!strcmp(start, "job-template"))
       {
 	for (i = 0; i < (int)(sizeof(template) / sizeof(template[0])); i ++)
-	  cupsArrayAdd(JobPrivacyArray, (void *)template[i]);
+	  cupsArrayAddUnsorted(JobPrivacyArray, (void *)template[i]);
       }
       else
       {
-	cupsArrayAdd(JobPrivacyArray, (void *)start);
+	cupsArrayAddUnsorted(JobPrivacyArray, (void *)start);
       }
     }
   }
 
+  cupsArraySort(JobPrivacyArray);
+
   ippAddString(PrivacyAttributes, IPP_TAG_PRINTER, IPP_CONST_TAG(IPP_TAG_KEYWORD), "job-privacy-scope", NULL, JobPrivacyScope);
 }
 
 
 /*
- * 'add_subscription_privacy()' - Add subscription privacy attributes.
+ * 'add_printer_unsorted()' - Add a printer while loading the configuration.
+ *
+ * The printers array is sorted once all of the printers have been loaded.
  */
 
 static void
-add_subscription_privacy(void)
+add_printer_unsorted(
+    server_printer_t *printer)		/* I - Printer to add */
 {
-  int		i;			/* Looping var */
-  char		temp[1024],		/* Temporary copy of value */
-		*start,			/* Start of value */
-		*ptr;			/* Pointer into value */
-  ipp_attribute_t *privattrs = NULL;	/* job-privacy-attributes */
-  static const char * const description[] =
-  {					/* subscription-description attributes */
-    "notify-lease-expiration-time",
-    "notify-sequence-number",
-    "notify-subscriber-user-name"
-  };
-  static const char * const template[] =
-  {					/* subscription-template attributes */
-    "notify-attributes",
-    "notify-charset",
-    "notify-events",
-    "notify-lease-duration",
-    "notify-natural-language",
-    "notify-pull-method",
-    "notify-recipient-uri",
-    "notify-time-interval",
-    "notify-user-data"
-  };
+  _cupsRWLockWrite(&PrintersRWLock);
 
+  if (!Printers)
+    Printers = cupsArrayNew((cups_array_func_t)compare_printers, NULL);
 
-  if (!strcmp(SubscriptionPrivacyAttributes, "none"))
-  {
-    ippAddString(PrivacyAttributes, IPP_TAG_PRINTER, IPP_CONST_TAG(IPP_TAG_KEYWORD), "subscription-privacy-attributes", NULL, "none");
-  }
-  else if (!strcmp(SubscriptionPrivacyAttributes, "all"))
-  {
-    ippAddString(PrivacyAttributes, IPP_TAG_PRINTER, IPP_CONST_TAG(IPP_TAG_KEYWORD), "subscription-privacy-attributes", NULL, "all");
+  cupsArrayAddUnsorted(Printers, printer);
 
-    SubscriptionPrivacyArray = cupsArrayNew3((cups_array_func_t)strcmp, NULL, NULL, 0, (cups_acopy_func_t)strdup, (cups_afree_func_t)free);
-    for (i = 0; i < (int)(sizeof(description) / sizeof(description[0])); i ++)
-      cupsArrayAdd(SubscriptionPrivacyArray, (void *)description[i]);
-    for (i = 0; i < (int)(sizeof(template) / sizeof(template[0])); i ++)
-      cupsArrayAdd(SubscriptionPrivacyArray, (void *)template[i]);
-  }
-  else
-  {
-    SubscriptionPrivacyArray = cupsArrayNew3((cups_array_func_t)strcmp, NULL, NULL, 0, (cups_acopy_func_t)strdup, (cups_afree_func_t)free);
+  _cupsRWUnlock(&PrintersRWLock);
+}
+
+
+/*
+ * 'add_profile()' - Add an ICC profile to a printer configuration.
+ *
+ * The profile takes ownership of the "attrs" IPP message.
+ */
+
+static void
+add_profile(server_pinfo_t *pinfo,	/* I - Printer information */
+            const char     *name,	/* I - Profile name */
+            const char     *filename,	/* I - ICC file */
+            ipp_t          *attrs)	/* I - Profile attributes */
+{
+  server_icc_t	icc;			/* ICC profile data */
+  char		uri[1024];		/* Profile URI */
+
+
+  icc.attrs = attrs;
+
+  _cupsMutexLock(&resource_mutex);
+  if ((icc.resource = serverFindResourceByFilename(filename)) == NULL)
+    icc.resource = serverCreateResource(NULL, filename, "application/icc", name, name, "static-icc-profile", NULL);
+  _cupsMutexUnlock(&resource_mutex);
+
+  ippAddString(icc.attrs, IPP_TAG_PRINTER, IPP_TAG_NAME, "profile-name", NULL, name);
+  httpAssembleURI(HTTP_URI_CODING_ALL, uri, sizeof(uri),
+#ifdef HAVE_SSL
+                  Encryption != HTTP_ENCRYPTION_NEVER ? SERVER_HTTPS_SCHEME : SERVER_HTTP_SCHEME,
+#else
+                  SERVER_HTTP_SCHEME,
+#endif /* HAVE_SSL */
+                  NULL, ServerName, DefaultPort, icc.resource->resource);
+  ippAddString(icc.attrs, IPP_TAG_PRINTER, IPP_TAG_URI, "profile-uri", NULL, uri);
+
+  if (!pinfo->profiles)
+    pinfo->profiles = cupsArrayNew3(NULL, NULL, NULL, 0, (cups_acopy_func_t)copy_icc, (cups_afree_func_t)free_icc);
+
+  cupsArrayAdd(pinfo->profiles, &icc);
+
+  SERVER_LOG_DEBUG("Added ICC profile \"%s\".", filename);
+}
+
+
+/*
+ * 'add_strings()' - Add a strings file to a printer configuration.
+ */
+
+static void
+add_strings(server_pinfo_t *pinfo,	/* I - Printer information */
+            const char     *language,	/* I - Language */
+            const char     *filename)	/* I - Strings file */
+{
+  server_lang_t	lang;			/* New localization */
+
+
+  lang.lang = (char *)language;
+
+  _cupsMutexLock(&resource_mutex);
+  if ((lang.resource = serverFindResourceByFilename(filename)) == NULL)
+    lang.resource = serverCreateResource(NULL, filename, "text/strings", language, language, "static-strings", language);
+  _cupsMutexUnlock(&resource_mutex);
+
+  if (!pinfo->strings)
+    pinfo->strings = cupsArrayNew3((cups_array_func_t)compare_lang, NULL, NULL, 0, (cups_acopy_func_t)copy_lang, (cups_afree_func_t)free_lang);
+
+  cupsArrayAdd(pinfo->strings, &lang);
+
+  SERVER_LOG_DEBUG("Added strings file \"%s\" for language \"%s\".", filename, language);
+}
+
+
+/*
+ * 'add_subscription_privacy()' - Add subscription privacy attributes.
+ */
+
+static void
+add_subscription_privacy(void)
+{
+  int		i;			/* Looping var */
+  char		temp[1024],		/* Temporary copy of value */
+		*start,			/* Start of value */
+		*ptr;			/* Pointer into value */
+  ipp_attribute_t *privattrs = NULL;	/* job-privacy-attributes */
+  static const char * const description[] =
+  {					/* subscription-description attributes */
+    "notify-lease-expiration-time",
+    "notify-sequence-number",
+    "notify-subscriber-user-name"
+  };
+  static const char * const template[] =
+  {					/* subscription-template attributes */
+    "notify-attributes",
+    "notify-charset",
+    "notify-events",
+    "notify-lease-duration",
+    "notify-natural-language",
+    "notify-pull-method",
+    "notify-recipient-uri",
+    "notify-time-interval",
+    "notify-user-data"
+  };
+
+
+  if (!strcmp(SubscriptionPrivacyAttributes, "none"))
+  {
+    ippAddString(PrivacyAttributes, IPP_TAG_PRINTER, IPP_CONST_TAG(IPP_TAG_KEYWORD), "subscription-privacy-attributes", NULL, "none");
+  }
+  else if (!strcmp(SubscriptionPrivacyAttributes, "all"))
+  {
+    ippAddString(PrivacyAttributes, IPP_TAG_PRINTER, IPP_CONST_TAG(IPP_TAG_KEYWORD), "subscription-privacy-attributes", NULL, "all");
+
+    SubscriptionPrivacyArray = cupsArrayNew3((cups_array_func_t)strcmp, NULL, NULL, 0, (cups_acopy_func_t)strdup, (cups_afree_func_t)free);
+    for (i = 0; i < (int)(sizeof(description) / sizeof(description[0])); i ++)
+      cupsArrayAddUnsorted(SubscriptionPrivacyArray, (void *)description[i]);
+    for (i = 0; i < (int)(sizeof(template) / sizeof(template[0])); i ++)
+      cupsArrayAddUnsorted(SubscriptionPrivacyArray, (void *)template[i]);
+  }
+  else
+  {
+    SubscriptionPrivacyArray = cupsArrayNew3((cups_array_func_t)strcmp, NULL, NULL, 0, (cups_acopy_func_t)strdup, (cups_afree_func_t)free);
 
     strlcpy(temp, SubscriptionPrivacyAttributes, sizeof(temp));
 
@@ -1042,27 +1359,29 @@ add_subscription_privacy(void)
       if (!strcmp(start, "default"))
       {
 	for (i = 0; i < (int)(sizeof(description) / sizeof(description[0])); i ++)
-	  cupsArrayAdd(SubscriptionPrivacyArray, (void *)description[i]);
+	  cupsArrayAddUnsorted(SubscriptionPrivacyArray, (void *)description[i]);
 	for (i = 0; i < (int)(sizeof(template) / sizeof(template[0])); i ++)
-	  cupsArrayAdd(SubscriptionPrivacyArray, (void *)template[i]);
+	  cupsArrayAddUnsorted(SubscriptionPrivacyArray, (void *)template[i]);
       }
       else if (!strcmp(start, "subscription-description"))
       {
 	for (i = 0; i < (int)(sizeof(description) / sizeof(description[0])); i ++)
-	  cupsArrayAdd(SubscriptionPrivacyArray, (void *)description[i]);
+	  cupsArrayAddUnsorted(SubscriptionPrivacyArray, (void *)description[i]);
       }
       else if (!strcmp(start, "subscription-template"))
       {
 	for (i = 0; i < (int)(sizeof(template) / sizeof(template[0])); i ++)
-	  cupsArrayAdd(SubscriptionPrivacyArray, (void *)template[i]);
+	  cupsArrayAddUnsorted(SubscriptionPrivacyArray, (void *)template[i]);
       }
       else
       {
-	cupsArrayAdd(SubscriptionPrivacyArray, (void *)start);
+	cupsArrayAddUnsorted(SubscriptionPrivacyArray, (void *)start);
       }
     }
   }
 
+  cupsArraySort(SubscriptionPrivacyArray);
+
   ippAddString(PrivacyAttributes, IPP_TAG_PRINTER, IPP_CONST_TAG(IPP_TAG_KEYWORD), "subscription-privacy-scope", NULL, SubscriptionPrivacyScope);
 }
 
@@ -1141,6 +1460,7 @@ attr_cb(_ipp_file_t    *f,		/* I - IPP file */
     "printer-xri-supported",
     "queued-job-count",
     "reference-uri-scheme-supported",
+    "reference-uri-schemes-supported",
     "uri-authentication-supported",
     "uri-security-supported",
     "which-jobs-supported",
@@ -2215,9 +2535,36 @@ finalize_system(void)
   }
 
   create_system_attributes();
+  serverPublishSystem();
+
+  return (1);
+}
+
+
+#ifndef _WIN32
+/*
+ * 'find_group()' - Look up a group ID by name.
+ *
+ * This uses getgrnam_r() since printers are loaded on several threads.
+ */
+
+static int				/* O - 1 on success, 0 if not found */
+find_group(const char *name,		/* I - Group name */
+           gid_t      *gid)		/* O - Group ID */
+{
+  struct group	grbuf,			/* Group buffer */
+		*group = NULL;		/* Group information */
+  char		buffer[16384];		/* String buffer */
+
+
+  if (getgrnam_r(name, &grbuf, buffer, sizeof(buffer), &group) || !group)
+    return (0);
+
+  *gid = group->gr_gid;
 
   return (1);
 }
+#endif /* !_WIN32 */
 
 
 /*
@@ -2244,6 +2591,325 @@ free_lang(server_lang_t *a)		/* I - Localization */
 }
 
 
+/*
+ * 'load_printers()' - Load queued printers.
+ *
+ * This function runs on each of the printer loading threads.  Printers are
+ * created without DNS-SD registration, which is done by the main thread
+ * afterwards.  Attribute files are parsed in parallel but printer-id values
+ * are assigned in queue order, so the ids do not depend on thread timing.
+ */
+
+static void *				/* O - Thread exit status */
+load_printers(
+    server_ploader_t *loader)		/* I - Printer loader */
+{
+  int			i;		/* Index of current printer load */
+  server_pload_t	*load;		/* Current printer load */
+  server_pinfo_t	pinfo;		/* Printer information */
+  int			loaded;		/* Loaded printer information? */
+  server_printer_t	*printer;	/* Printer */
+
+
+  for (;;)
+  {
+    _cupsMutexLock(&loader->mutex);
+    if (loader->next < loader->num_loads)
+      load = loader->loads + loader->next ++;
+    else
+      load = NULL;
+    _cupsMutexUnlock(&loader->mutex);
+
+    if (!load)
+      break;
+
+    memset(&pinfo, 0, sizeof(pinfo));
+
+    pinfo.print_group       = SERVER_GROUP_NONE;
+    pinfo.proxy_group       = SERVER_GROUP_NONE;
+    pinfo.initial_accepting = 1;
+    pinfo.initial_state     = IPP_PSTATE_IDLE;
+    pinfo.initial_reasons   = SERVER_PREASON_NONE;
+    pinfo.web_forms         = 1;
+    pinfo.icon              = load->icon;
+    load->icon              = NULL;
+
+    if (load->snapshot)
+    {
+      serverLog(SERVER_LOGLEVEL_INFO, "Loading printer from \"%s\".", load->snapshot);
+
+      if (!load_snapshot(load->snapshot, &pinfo))
+      {
+        serverLog(SERVER_LOGLEVEL_INFO, "Unable to use snapshot, loading printer from \"%s\".", load->filename);
+        free(load->snapshot);
+        load->snapshot = NULL;
+        load->dirty    = 1;
+      }
+    }
+    else
+      serverLog(SERVER_LOGLEVEL_INFO, "Loading printer from \"%s\".", load->filename);
+
+    loaded = load->snapshot || serverLoadAttributes(load->filename, &pinfo);
+
+   /*
+    * Wait for the printers queued before this one, then assign the next
+    * printer-id if the configuration does not provide one...
+    */
+
+    i = (int)(load - loader->loads);
+
+    _cupsMutexLock(&loader->mutex);
+    while (loader->next_id < i)
+      _cupsCondWait(&loader->cond, &loader->mutex, 0.0);
+
+    if (loaded && !ippFindAttribute(pinfo.attrs, "printer-id", IPP_TAG_INTEGER))
+      ippAddInteger(pinfo.attrs, IPP_TAG_PRINTER, IPP_TAG_INTEGER, "printer-id", NextPrinterId ++);
+
+    loader->next_id ++;
+    _cupsCondBroadcast(&loader->cond);
+    _cupsMutexUnlock(&loader->mutex);
+
+    if (loaded)
+    {
+      if ((printer = serverCreatePrinter(load->resource, load->name, load->name, &pinfo, 0, 0)) == NULL)
+        continue;
+
+      printer->state         = pinfo.initial_state;
+      printer->state_reasons = pinfo.initial_reasons;
+      printer->is_accepting  = pinfo.initial_accepting;
+      printer->is_dirty      = (char)load->dirty;
+
+      load->printer = printer;
+    }
+  }
+
+  return (NULL);
+}
+
+
+/*
+ * 'load_snapshot()' - Load printer information from a binary snapshot.
+ *
+ * A snapshot consists of the SERVER_SNAPSHOT_MAGIC string and a 32-bit
+ * big-endian version number, followed by two length-prefixed IPP messages:
+ * the ippserver-specific settings and the printer attributes.  Nothing is
+ * changed in "pinfo" unless the whole snapshot is valid.
+ */
+
+static int				/* O - 1 on success, 0 on failure */
+load_snapshot(
+    const char     *filename,		/* I - Snapshot file */
+    server_pinfo_t *pinfo)		/* I - Printer information */
+{
+  int			fd;		/* File descriptor */
+  struct stat		fileinfo;	/* File information */
+  ipp_uchar_t		*data,		/* Snapshot data */
+			*dataptr,	/* Pointer into data */
+			*dataend;	/* End of data */
+  size_t		datalen,	/* Length of data */
+			length;		/* Length of block */
+  unsigned		version;	/* Snapshot version */
+  server_snapbuf_t	buf;		/* Block read buffer */
+  ipp_t			*blocks[2];	/* Settings and printer attributes */
+  int			i,		/* Looping var */
+			count,		/* Number of values */
+			status = 0;	/* Return value */
+  ipp_t			*settings;	/* Settings */
+  ipp_attribute_t	*attr;		/* Current attribute */
+  const char		*value;		/* String value */
+  gid_t			print_group = SERVER_GROUP_NONE,
+					/* Print group */
+			proxy_group = SERVER_GROUP_NONE;
+					/* Proxy group */
+
+
+  if ((fd = open(filename, O_RDONLY | O_BINARY)) < 0)
+    return (0);
+
+  if (fstat(fd, &fileinfo) || fileinfo.st_size < 12)
+  {
+    close(fd);
+    return (0);
+  }
+
+  datalen = (size_t)fileinfo.st_size;
+
+#ifdef _WIN32
+  if ((data = malloc(datalen)) != NULL && read(fd, data, (unsigned)datalen) != (int)datalen)
+  {
+    free(data);
+    data = NULL;
+  }
+
+  close(fd);
+
+  if (!data)
+    return (0);
+
+#else
+  data = mmap(NULL, datalen, PROT_READ, MAP_PRIVATE, fd, 0);
+
+  close(fd);
+
+  if (data == MAP_FAILED)
+    return (0);
+#endif /* _WIN32 */
+
+  dataptr   = data;
+  dataend   = data + datalen;
+  blocks[0] = NULL;
+  blocks[1] = NULL;
+
+  if (memcmp(dataptr, SERVER_SNAPSHOT_MAGIC, 8))
+  {
+    serverLog(SERVER_LOGLEVEL_ERROR, "Bad snapshot file \"%s\".", filename);
+    goto finish;
+  }
+
+  dataptr += 8;
+  version = ((unsigned)dataptr[0] << 24) | ((unsigned)dataptr[1] << 16) | ((unsigned)dataptr[2] << 8) | dataptr[3];
+  dataptr += 4;
+
+  if (version != SERVER_SNAPSHOT_VERSION)
+  {
+    serverLog(SERVER_LOGLEVEL_INFO, "Unsupported snapshot version %u in \"%s\".", version, filename);
+    goto finish;
+  }
+
+  for (i = 0; i < 2; i ++)
+  {
+    if ((dataend - dataptr) < 4)
+      break;
+
+    length  = ((size_t)dataptr[0] << 24) | ((size_t)dataptr[1] << 16) | ((size_t)dataptr[2] << 8) | dataptr[3];
+    dataptr += 4;
+
+    if (length > (size_t)(dataend - dataptr))
+      break;
+
+    buf.ptr   = dataptr;
+    buf.end   = dataptr + length;
+    blocks[i] = ippNew();
+
+    if (ippReadIO(&buf, (ipp_iocb_t)read_snapshot, 1, NULL, blocks[i]) != IPP_STATE_DATA)
+      break;
+
+    dataptr += length;
+  }
+
+  if (i < 2)
+  {
+    serverLog(SERVER_LOGLEVEL_ERROR, "Truncated or corrupt snapshot file \"%s\".", filename);
+    goto finish;
+  }
+
+  settings = blocks[0];
+
+#ifndef _WIN32
+  if ((value = ippGetString(ippFindAttribute(settings, "print-group", IPP_TAG_NAME), 0, NULL)) != NULL && !find_group(value, &print_group))
+  {
+    serverLog(SERVER_LOGLEVEL_ERROR, "Unknown AuthPrintGroup \"%s\" in \"%s\".", value, filename);
+    goto finish;
+  }
+
+  if ((value = ippGetString(ippFindAttribute(settings, "proxy-group", IPP_TAG_NAME), 0, NULL)) != NULL && !find_group(value, &proxy_group))
+  {
+    serverLog(SERVER_LOGLEVEL_ERROR, "Unknown AuthProxyGroup \"%s\" in \"%s\".", value, filename);
+    goto finish;
+  }
+#endif /* !_WIN32 */
+
+ /*
+  * The snapshot is valid, apply the settings...
+  */
+
+  pinfo->print_group = print_group;
+  pinfo->proxy_group = proxy_group;
+
+  if ((value = ippGetString(ippFindAttribute(settings, "command", IPP_TAG_TEXT), 0, NULL)) != NULL)
+    pinfo->command = strdup(value);
+
+  pinfo->compression_level = ippGetInteger(ippFindAttribute(settings, "compression-level", IPP_TAG_INTEGER), 0);
+
+  if ((value = ippGetString(ippFindAttribute(settings, "device-uri", IPP_TAG_URI), 0, NULL)) != NULL)
+    pinfo->device_uri = strdup(value);
+  if ((value = ippGetString(ippFindAttribute(settings, "output-format", IPP_TAG_MIMETYPE), 0, NULL)) != NULL)
+    pinfo->output_format = strdup(value);
+  if ((value = ippGetString(ippFindAttribute(settings, "stream-formats", IPP_TAG_TEXT), 0, NULL)) != NULL)
+    pinfo->stream_formats = strdup(value);
+
+  if ((attr = ippFindAttribute(settings, "initial-accepting", IPP_TAG_BOOLEAN)) != NULL)
+    pinfo->initial_accepting = (char)ippGetBoolean(attr, 0);
+  if ((attr = ippFindAttribute(settings, "initial-state", IPP_TAG_ENUM)) != NULL)
+    pinfo->initial_state = (ipp_pstate_t)ippGetInteger(attr, 0);
+  if ((attr = ippFindAttribute(settings, "initial-reasons", IPP_TAG_INTEGER)) != NULL)
+    pinfo->initial_reasons = (server_preason_t)ippGetInteger(attr, 0);
+
+  pinfo->max_devices    = ippGetInteger(ippFindAttribute(settings, "max-output-devices", IPP_TAG_INTEGER), 0);
+  pinfo->max_processing = ippGetInteger(ippFindAttribute(settings, "max-processing-jobs", IPP_TAG_INTEGER), 0);
+
+  if ((attr = ippFindAttribute(settings, "web-forms", IPP_TAG_BOOLEAN)) != NULL)
+    pinfo->web_forms = (char)ippGetBoolean(attr, 0);
+
+  attr = ippFindAttribute(settings, "output-device-uuid", IPP_TAG_URI);
+  for (i = 0, count = ippGetCount(attr); i < count; i ++)
+    serverCreateDevicePinfo(pinfo, ippGetString(attr, i, NULL));
+
+  attr = ippFindAttribute(settings, "strings", IPP_TAG_BEGIN_COLLECTION);
+  for (i = 0, count = ippGetCount(attr); i < count; i ++)
+  {
+    ipp_t	*col = ippGetCollection(attr, i);
+					/* Strings value */
+    const char	*language = ippGetString(ippFindAttribute(col, "language", IPP_TAG_LANGUAGE), 0, NULL),
+		*file = ippGetString(ippFindAttribute(col, "file", IPP_TAG_NAME), 0, NULL);
+					/* Strings language and file */
+
+    if (language && file)
+      add_strings(pinfo, language, file);
+  }
+
+  attr = ippFindAttribute(settings, "profiles", IPP_TAG_BEGIN_COLLECTION);
+  for (i = 0, count = ippGetCount(attr); i < count; i ++)
+  {
+    ipp_t	*col = ippGetCollection(attr, i);
+					/* Profile value */
+    const char	*name = ippGetString(ippFindAttribute(col, "profile-name", IPP_TAG_NAME), 0, NULL),
+		*file = ippGetString(ippFindAttribute(col, "profile-file", IPP_TAG_NAME), 0, NULL);
+					/* Profile name and file */
+    ipp_t	*attrs;			/* Profile attributes */
+
+    if (!name || !file)
+      continue;
+
+    attrs = ippNew();
+    ippCopyAttributes(attrs, col, 0, (ipp_copycb_t)snapshot_profile_cb, NULL);
+
+    add_profile(pinfo, name, file, attrs);
+  }
+
+  pinfo->attrs = blocks[1];
+  blocks[1]    = NULL;
+  status       = 1;
+
+ /*
+  * Free memory and return...
+  */
+
+  finish:
+
+  ippDelete(blocks[0]);
+  ippDelete(blocks[1]);
+
+#ifdef _WIN32
+  free(data);
+#else
+  munmap(data, datalen);
+#endif /* _WIN32 */
+
+  return (status);
+}
+
+
 /*
  * 'load_system()' - Load the system configuration file.
  */
@@ -2264,8 +2930,11 @@ load_system(const char *conf)		/* I - Configuration file */
   int		i;			/* Looping var */
   static const char * const settings[] =/* List of directives */
   {
+    "AcceptWorkers",
     "Authentication",
     "AuthAdminGroup",
+    "AuthCacheLifetime",
+    "AuthGroupCacheLifetime",
     "AuthGroups",
     "AuthName",
     "AuthOperatorGroup",
@@ -2274,6 +2943,7 @@ load_system(const char *conf)		/* I - Configuration file */
     "AuthTestPassword",
     "AuthType",
     "BinDir",
+    "ClientWorkers",
     "DataDir",
     "DefaultPrinter",
     "DocumentPrivacyAttributes",
@@ -2282,25 +2952,42 @@ load_system(const char *conf)		/* I - Configuration file */
     "FileDirectory",
     "GeoLocation",
     "Info",
+    "JobHistory",
+    "JobPriorityAging",
     "JobPrivacyAttributes",
     "JobPrivacyScope",
+    "JobProgressInterval",
+    "JobScheduler",
+    "JobWorkers",
     "KeepFiles",
     "Listen",
     "Location",
+    "LogAsync",
     "LogFile",
     "LogLevel",
+    "LogSlowRequests",
     "MakeAndModel",
+    "MaxActiveRequests",
+    "MaxClientsPerHost",
     "MaxCompletedJobs",
     "MaxJobs",
+    "MaxRequestsPerUser",
+    "MaxSubscriptionEvents",
     "Name",
     "OwnerEmail",
     "OwnerLocation",
     "OwnerName",
     "OwnerPhone",
+    "RateLimit",
     "SpoolDir",
+    "SpoolMemoryLimit",
+    "SpoolSync",
     "StateDir",
+    "StateSnapshots",
     "SubscriptionPrivacyAttributes",
     "SubscriptionPrivacyScope",
+    "TransformCacheSize",
+    "TransformWorkers",
     "UUID"
   };
 
@@ -2333,10 +3020,11 @@ load_system(const char *conf)		/* I - Configuration file */
       * Already have this setting, check whether this is OK...
       */
 
-      if (!_cups_strcasecmp(line, "FileDirectory") || !_cups_strcasecmp(line, "Listen"))
+      if (!_cups_strcasecmp(line, "FileDirectory") || !_cups_strcasecmp(line, "Listen") || !_cups_strcasecmp(line, "RateLimit"))
       {
        /*
-        * Listen allows multiple values, others do not...
+        * FileDirectory, Listen, and RateLimit allow multiple values, others do
+        * not...
         */
 
 	snprintf(temp, sizeof(temp), "%s %s", setting, value);
@@ -2357,7 +3045,18 @@ load_system(const char *conf)		/* I - Configuration file */
       SystemNumSettings = cupsAddOption(line, value, SystemNumSettings, &SystemSettings);
     }
 
-    if (!_cups_strcasecmp(line, "Authentication"))
+    if (!_cups_strcasecmp(line, "AcceptWorkers"))
+    {
+      if (!isdigit(*value & 255))
+      {
+        fprintf(stderr, "ippserver: Bad AcceptWorkers value \"%s\" on line %d of \"%s\".\n", value, linenum, conf);
+        status = 0;
+        break;
+      }
+
+      AcceptWorkers = atoi(value);
+    }
+    else if (!_cups_strcasecmp(line, "Authentication"))
     {
       if (!_cups_strcasecmp(value, "on") || !_cups_strcasecmp(value, "yes"))
       {
@@ -2387,21 +3086,43 @@ load_system(const char *conf)		/* I - Configuration file */
       AuthAdminGroup = group->gr_gid;
     }
 #endif /* !_WIN32 */
-    else if (!_cups_strcasecmp(line, "AuthName"))
-    {
-      AuthName = strdup(value);
-    }
-#ifndef _WIN32
-    else if (!_cups_strcasecmp(line, "AuthOperatorGroup"))
+    else if (!_cups_strcasecmp(line, "AuthCacheLifetime"))
     {
-      if ((group = getgrnam(value)) == NULL)
+      if (!isdigit(*value & 255))
       {
-        fprintf(stderr, "ippserver: Unable to find AuthOperatorGroup \"%s\" on line %d of \"%s\".\n", value, linenum, conf);
+        fprintf(stderr, "ippserver: Bad AuthCacheLifetime value \"%s\" on line %d of \"%s\".\n", value, linenum, conf);
         status = 0;
         break;
       }
 
-      AuthOperatorGroup = group->gr_gid;
+      AuthCacheLifetime = atoi(value);
+    }
+    else if (!_cups_strcasecmp(line, "AuthGroupCacheLifetime"))
+    {
+      if (!isdigit(*value & 255))
+      {
+        fprintf(stderr, "ippserver: Bad AuthGroupCacheLifetime value \"%s\" on line %d of \"%s\".\n", value, linenum, conf);
+        status = 0;
+        break;
+      }
+
+      AuthGroupCacheLifetime = atoi(value);
+    }
+    else if (!_cups_strcasecmp(line, "AuthName"))
+    {
+      AuthName = strdup(value);
+    }
+#ifndef _WIN32
+    else if (!_cups_strcasecmp(line, "AuthOperatorGroup"))
+    {
+      if ((group = getgrnam(value)) == NULL)
+      {
+        fprintf(stderr, "ippserver: Unable to find AuthOperatorGroup \"%s\" on line %d of \"%s\".\n", value, linenum, conf);
+        status = 0;
+        break;
+      }
+
+      AuthOperatorGroup = group->gr_gid;
     }
     else if (!_cups_strcasecmp(line, "AuthProxyGroup"))
     {
@@ -2438,6 +3159,17 @@ load_system(const char *conf)		/* I - Configuration file */
 
       BinDir = strdup(value);
     }
+    else if (!_cups_strcasecmp(line, "ClientWorkers"))
+    {
+      if (!isdigit(*value & 255))
+      {
+        fprintf(stderr, "ippserver: Bad ClientWorkers value \"%s\" on line %d of \"%s\".\n", value, linenum, conf);
+        status = 0;
+        break;
+      }
+
+      ClientWorkers = atoi(value);
+    }
     else if (!_cups_strcasecmp(line, "DataDir"))
     {
       if (access(value, R_OK))
@@ -2579,6 +3311,65 @@ load_system(const char *conf)		/* I - Configuration file */
 
       JobPrivacyScope = strdup(value);
     }
+    else if (!_cups_strcasecmp(line, "JobHistory"))
+    {
+      if (!isdigit(*value & 255))
+      {
+        fprintf(stderr, "ippserver: Bad JobHistory value \"%s\" on line %d of \"%s\".\n", value, linenum, conf);
+        status = 0;
+        break;
+      }
+
+      JobHistory = atoi(value);
+    }
+    else if (!_cups_strcasecmp(line, "JobPriorityAging"))
+    {
+      if (!isdigit(*value & 255))
+      {
+        fprintf(stderr, "ippserver: Bad JobPriorityAging value \"%s\" on line %d of \"%s\".\n", value, linenum, conf);
+        status = 0;
+        break;
+      }
+
+      JobPriorityAging = atoi(value);
+    }
+    else if (!_cups_strcasecmp(line, "JobProgressInterval"))
+    {
+      if (!isdigit(*value & 255))
+      {
+        fprintf(stderr, "ippserver: Bad JobProgressInterval value \"%s\" on line %d of \"%s\".\n", value, linenum, conf);
+        status = 0;
+        break;
+      }
+
+      JobProgressInterval = atoi(value);
+    }
+    else if (!_cups_strcasecmp(line, "JobScheduler"))
+    {
+      if (!_cups_strcasecmp(value, "priority"))
+        JobScheduler = SERVER_SCHEDULER_PRIORITY;
+      else if (!_cups_strcasecmp(value, "size"))
+        JobScheduler = SERVER_SCHEDULER_SIZE;
+      else if (!_cups_strcasecmp(value, "fairshare"))
+        JobScheduler = SERVER_SCHEDULER_FAIRSHARE;
+      else
+      {
+        fprintf(stderr, "ippserver: Bad JobScheduler value \"%s\" on line %d of \"%s\".\n", value, linenum, conf);
+        status = 0;
+        break;
+      }
+    }
+    else if (!_cups_strcasecmp(line, "JobWorkers"))
+    {
+      if (!isdigit(*value & 255))
+      {
+        fprintf(stderr, "ippserver: Bad JobWorkers value \"%s\" on line %d of \"%s\".\n", value, linenum, conf);
+        status = 0;
+        break;
+      }
+
+      JobWorkers = atoi(value);
+    }
     else if (!_cups_strcasecmp(line, "KeepFiles"))
     {
       KeepFiles = !strcasecmp(value, "yes") || !strcasecmp(value, "true") || !strcasecmp(value, "on");
@@ -2639,6 +3430,23 @@ load_system(const char *conf)		/* I - Configuration file */
       if (!status)
         break;
     }
+    else if (!_cups_strcasecmp(line, "LogAsync"))
+    {
+      if (!_cups_strcasecmp(value, "on") || !_cups_strcasecmp(value, "yes"))
+      {
+        LogAsync = 1;
+      }
+      else if (!_cups_strcasecmp(value, "off") || !_cups_strcasecmp(value, "no"))
+      {
+        LogAsync = 0;
+      }
+      else
+      {
+        fprintf(stderr, "ippserver: Unknown LogAsync \"%s\" on line %d of \"%s\".\n", value, linenum, conf);
+        status = 0;
+        break;
+      }
+    }
     else if (!_cups_strcasecmp(line, "LogFile"))
     {
       if (!_cups_strcasecmp(value, "stderr"))
@@ -2661,6 +3469,39 @@ load_system(const char *conf)		/* I - Configuration file */
         break;
       }
     }
+    else if (!_cups_strcasecmp(line, "LogSlowRequests"))
+    {
+      if (!isdigit(*value & 255))
+      {
+        fprintf(stderr, "ippserver: Bad LogSlowRequests value \"%s\" on line %d of \"%s\".\n", value, linenum, conf);
+        status = 0;
+        break;
+      }
+
+      LogSlowRequests = atoi(value);
+    }
+    else if (!_cups_strcasecmp(line, "MaxActiveRequests"))
+    {
+      if (!isdigit(*value & 255))
+      {
+        fprintf(stderr, "ippserver: Bad MaxActiveRequests value \"%s\" on line %d of \"%s\".\n", value, linenum, conf);
+        status = 0;
+        break;
+      }
+
+      MaxActiveRequests = atoi(value);
+    }
+    else if (!_cups_strcasecmp(line, "MaxClientsPerHost"))
+    {
+      if (!isdigit(*value & 255))
+      {
+        fprintf(stderr, "ippserver: Bad MaxClientsPerHost value \"%s\" on line %d of \"%s\".\n", value, linenum, conf);
+        status = 0;
+        break;
+      }
+
+      MaxClientsPerHost = atoi(value);
+    }
     else if (!_cups_strcasecmp(line, "MaxCompletedJobs"))
     {
       if (!isdigit(*value & 255))
@@ -2683,6 +3524,65 @@ load_system(const char *conf)		/* I - Configuration file */
 
       MaxJobs = atoi(value);
     }
+    else if (!_cups_strcasecmp(line, "MaxRequestsPerUser"))
+    {
+      if (!isdigit(*value & 255))
+      {
+        fprintf(stderr, "ippserver: Bad MaxRequestsPerUser value \"%s\" on line %d of \"%s\".\n", value, linenum, conf);
+        status = 0;
+        break;
+      }
+
+      MaxRequestsPerUser = atoi(value);
+    }
+    else if (!_cups_strcasecmp(line, "MaxSubscriptionEvents"))
+    {
+      if (!isdigit(*value & 255) || atoi(value) < 1)
+      {
+        fprintf(stderr, "ippserver: Bad MaxSubscriptionEvents value \"%s\" on line %d of \"%s\".\n", value, linenum, conf);
+        status = 0;
+        break;
+      }
+
+      MaxSubscriptionEvents = atoi(value);
+    }
+    else if (!_cups_strcasecmp(line, "RateLimit"))
+    {
+      char		opclass[32];	/* Operation class */
+      double		rate,		/* Requests per second */
+			burst = 0.0;	/* Requests in a burst */
+      server_opclass_t	i;		/* Operation class index */
+      static const char * const opclasses[] =
+      {					/* Operation class names */
+        "Job",
+	"Query",
+	"Other"
+      };
+
+      if (sscanf(value, "%31s%lf%lf", opclass, &rate, &burst) < 2 || rate < 0.0 || burst < 0.0)
+      {
+        fprintf(stderr, "ippserver: Bad RateLimit value \"%s\" on line %d of \"%s\".\n", value, linenum, conf);
+        status = 0;
+        break;
+      }
+
+      for (i = SERVER_OPCLASS_JOB; i < SERVER_OPCLASS_MAX; i ++)
+        if (!_cups_strcasecmp(opclass, opclasses[i]))
+          break;
+
+      if (i >= SERVER_OPCLASS_MAX)
+      {
+        fprintf(stderr, "ippserver: Bad RateLimit value \"%s\" on line %d of \"%s\".\n", value, linenum, conf);
+        status = 0;
+        break;
+      }
+
+      if (burst < 1.0)
+        burst = rate < 1.0 ? 1.0 : rate;
+
+      RateLimits[i].rate  = rate;
+      RateLimits[i].burst = burst;
+    }
     else if (!_cups_strcasecmp(line, "SpoolDir"))
     {
       if (access(value, R_OK))
@@ -2694,6 +3594,47 @@ load_system(const char *conf)		/* I - Configuration file */
 
       SpoolDirectory = strdup(value);
     }
+    else if (!_cups_strcasecmp(line, "SpoolMemoryLimit"))
+    {
+      char	*units;			/* Units after number */
+      double	size = strtod(value, &units);
+					/* Size limit */
+
+      if (size < 0.0)
+        units = NULL;
+      else if (!_cups_strcasecmp(units, "k"))
+        size *= 1024.0;
+      else if (!_cups_strcasecmp(units, "m"))
+        size *= 1048576.0;
+      else if (!_cups_strcasecmp(units, "g"))
+        size *= 1073741824.0;
+      else if (*units)
+        units = NULL;
+
+      if (!units || units == value)
+      {
+        fprintf(stderr, "ippserver: Bad SpoolMemoryLimit value \"%s\" on line %d of \"%s\".\n", value, linenum, conf);
+        status = 0;
+        break;
+      }
+
+      SpoolMemoryLimit = (off_t)size;
+    }
+    else if (!_cups_strcasecmp(line, "SpoolSync"))
+    {
+      if (!_cups_strcasecmp(value, "none"))
+        SpoolSync = SERVER_SPOOLSYNC_NONE;
+      else if (!_cups_strcasecmp(value, "close"))
+        SpoolSync = SERVER_SPOOLSYNC_CLOSE;
+      else if (!_cups_strcasecmp(value, "job"))
+        SpoolSync = SERVER_SPOOLSYNC_JOB;
+      else
+      {
+        fprintf(stderr, "ippserver: Bad SpoolSync value \"%s\" on line %d of \"%s\".\n", value, linenum, conf);
+        status = 0;
+        break;
+      }
+    }
     else if (!_cups_strcasecmp(line, "StateDir"))
     {
       if (access(value, R_OK) && mkdir(value, 0700))
@@ -2705,6 +3646,10 @@ load_system(const char *conf)		/* I - Configuration file */
 
       StateDirectory = strdup(value);
     }
+    else if (!_cups_strcasecmp(line, "StateSnapshots"))
+    {
+      StateSnapshots = !strcasecmp(value, "yes") || !strcasecmp(value, "true") || !strcasecmp(value, "on");
+    }
     else if (!_cups_strcasecmp(line, "SubscriptionPrivacyAttributes"))
     {
       if (SubscriptionPrivacyAttributes)
@@ -2727,6 +3672,43 @@ load_system(const char *conf)		/* I - Configuration file */
 
       SubscriptionPrivacyScope = strdup(value);
     }
+    else if (!_cups_strcasecmp(line, "TransformCacheSize"))
+    {
+      char	*units;			/* Units after number */
+      double	size = strtod(value, &units);
+					/* Size of cache */
+
+      if (size < 0.0)
+        units = NULL;
+      else if (!_cups_strcasecmp(units, "k"))
+        size *= 1024.0;
+      else if (!_cups_strcasecmp(units, "m"))
+        size *= 1048576.0;
+      else if (!_cups_strcasecmp(units, "g"))
+        size *= 1073741824.0;
+      else if (*units)
+        units = NULL;
+
+      if (!units || units == value)
+      {
+        fprintf(stderr, "ippserver: Bad TransformCacheSize value \"%s\" on line %d of \"%s\".\n", value, linenum, conf);
+        status = 0;
+        break;
+      }
+
+      TransformCacheSize = (off_t)size;
+    }
+    else if (!_cups_strcasecmp(line, "TransformWorkers"))
+    {
+      if (!isdigit(*value & 255))
+      {
+        fprintf(stderr, "ippserver: Bad TransformWorkers value \"%s\" on line %d of \"%s\".\n", value, linenum, conf);
+        status = 0;
+        break;
+      }
+
+      TransformWorkers = atoi(value);
+    }
   }
 
   cupsFileClose(fp);
@@ -3293,6 +4275,148 @@ print_ipp_attr(
 }
 
 
+/*
+ * 'queue_printers()' - Queue the printers in a configuration directory.
+ */
+
+static void
+queue_printers(
+    server_ploader_t *loader,		/* I - Printer loader */
+    const char       *directory,	/* I - Configuration directory */
+    const char       *type)		/* I - Printer type ("print" or "print3d") */
+{
+  cups_dir_t	*dir;			/* Directory pointer */
+  cups_dentry_t	*dent;			/* Directory entry */
+  char		confdir[1024],		/* Configuration directory */
+  		filename[1024],		/* Configuration file */
+                iconname[1024],		/* Icon file */
+		resource[1024],		/* Resource path */
+                *ptr;			/* Pointer into filename */
+  server_pload_t *load;			/* New printer load */
+  int		is_state = 0;		/* Loading saved printer state? */
+
+
+  if (StateDirectory)
+  {
+   /*
+    * See if we have saved printer state information...
+    */
+
+    snprintf(confdir, sizeof(confdir), "%s/%s", StateDirectory, type);
+
+    if (access(confdir, 0))
+    {
+      snprintf(confdir, sizeof(confdir), "%s/%s", directory, type);
+      is_state = 0;
+    }
+    else
+      is_state = 1;
+  }
+  else
+    snprintf(confdir, sizeof(confdir), "%s/%s", directory, type);
+
+  if ((dir = cupsDirOpen(confdir)) == NULL)
+    return;
+
+  serverLog(SERVER_LOGLEVEL_INFO, "Loading %sprinters from \"%s\".", strcmp(type, "print3d") ? "" : "3D ", confdir);
+
+  while ((dent = cupsDirRead(dir)) != NULL)
+  {
+    if ((ptr = strrchr(dent->filename, '.')) == NULL)
+      ptr = "";
+
+    if (!strcmp(ptr, ".conf"))
+    {
+     /*
+      * Queue the conf file, with any associated icon image.
+      */
+
+      if (loader->num_loads >= loader->alloc_loads)
+      {
+        server_pload_t *temp = realloc(loader->loads, (size_t)(loader->alloc_loads + 16) * sizeof(server_pload_t));
+					/* New printer loads */
+
+        if (!temp)
+        {
+          serverLog(SERVER_LOGLEVEL_ERROR, "Unable to allocate memory for printers: %s", strerror(errno));
+          break;
+        }
+
+        loader->loads       = temp;
+        loader->alloc_loads += 16;
+      }
+
+      snprintf(filename, sizeof(filename), "%s/%s", confdir, dent->filename);
+      *ptr = '\0';
+
+      load = loader->loads + loader->num_loads ++;
+      memset(load, 0, sizeof(server_pload_t));
+
+      snprintf(iconname, sizeof(iconname), "%s/%s.png", confdir, dent->filename);
+      if (!access(iconname, R_OK))
+      {
+        load->icon = strdup(iconname);
+      }
+      else if (StateDirectory)
+      {
+	snprintf(iconname, sizeof(iconname), "%s/%s/%s.png", directory, type, dent->filename);
+	if (!access(iconname, R_OK))
+	  load->icon = strdup(iconname);
+      }
+
+      snprintf(resource, sizeof(resource), "/ipp/%s/%s", type, dent->filename);
+
+      if (StateSnapshots)
+      {
+       /*
+        * Use a binary snapshot that is at least as new as the conf file...
+        */
+
+        char		snapname[1024];	/* Snapshot file */
+        struct stat	confinfo,	/* Conf file information */
+			snapinfo;	/* Snapshot file information */
+
+        snprintf(snapname, sizeof(snapname), "%s/%s.snap", confdir, dent->filename);
+        if (!stat(snapname, &snapinfo) && !stat(filename, &confinfo) && snapinfo.st_mtime >= confinfo.st_mtime)
+          load->snapshot = strdup(snapname);
+      }
+
+      load->filename = strdup(filename);
+      load->name     = strdup(dent->filename);
+      load->resource = strdup(resource);
+      load->dirty    = StateDirectory && (!is_state || (StateSnapshots && !load->snapshot));
+    }
+    else if (strcmp(ptr, ".history") && strcmp(ptr, ".png") && strcmp(ptr, ".snap") && strcmp(ptr, ".strings") && strcmp(ptr, ".tmp"))
+      serverLog(SERVER_LOGLEVEL_INFO, "Skipping \"%s\".", dent->filename);
+  }
+
+  cupsDirClose(dir);
+}
+
+
+/*
+ * 'read_snapshot()' - Read IPP data from a snapshot block.
+ */
+
+static ssize_t				/* O - Number of bytes read */
+read_snapshot(server_snapbuf_t *buf,	/* I - Snapshot buffer */
+              ipp_uchar_t      *buffer,	/* I - Read buffer */
+              size_t           bytes)	/* I - Number of bytes to read */
+{
+  size_t	count = (size_t)(buf->end - buf->ptr);
+					/* Bytes remaining */
+
+
+  if (bytes > count)
+    bytes = count;
+
+  memcpy(buffer, buf->ptr, bytes);
+  buf->ptr += bytes;
+
+  return ((ssize_t)bytes);
+}
+
+
 /*
  * 'save_printer()' - Save printer configuration information to disk.
  */
@@ -3332,10 +4456,16 @@ save_printer(
     if (printer->pinfo.command)
       cupsFilePutConf(fp, "Command", printer->pinfo.command);
 
+    if (printer->pinfo.compression_level)
+      cupsFilePrintf(fp, "CompressionLevel %d\n", printer->pinfo.compression_level);
+
+    if (printer->pinfo.cpu_limit)
+      cupsFilePrintf(fp, "CPULimit %d\n", printer->pinfo.cpu_limit);
+
     if (printer->pinfo.device_uri)
       cupsFilePutConf(fp, "DeviceURI", printer->pinfo.device_uri);
 
-    cupsFilePrintf(fp, "InitialState %d %d %u", printer->is_accepting, (int)printer->state, printer->state_reasons);
+    cupsFilePrintf(fp, "InitialState %d %d %u\n", printer->is_accepting, (int)printer->state, printer->state_reasons);
 
     if (printer->pinfo.output_format)
       cupsFilePutConf(fp, "OutputFormat", printer->pinfo.output_format);
@@ -3361,11 +4491,18 @@ save_printer(
       cupsFilePuts(fp, "}\n");
     }
 
+    if (printer->pinfo.stream_formats)
+      cupsFilePutConf(fp, "StreamFormats", printer->pinfo.stream_formats);
+
     for (lang = (server_lang_t *)cupsArrayFirst(printer->pinfo.strings); lang; lang = (server_lang_t *)cupsArrayNext(printer->pinfo.strings))
       cupsFilePrintf(fp, "Strings %s %s\n", lang->lang, lang->resource->filename);
 
     if (printer->pinfo.max_devices)
       cupsFilePrintf(fp, "MaxOutputDevices %d\n", printer->pinfo.max_devices);
+    if (printer->pinfo.max_processing)
+      cupsFilePrintf(fp, "MaxProcessingJobs %d\n", printer->pinfo.max_processing);
+    if (printer->pinfo.memory_limit)
+      cupsFilePrintf(fp, "MemoryLimit %.0fk\n", printer->pinfo.memory_limit / 1024.0);
     for (device = (server_device_t *)cupsArrayFirst(printer->pinfo.devices); device; device = (server_device_t *)cupsArrayNext(printer->pinfo.devices))
       cupsFilePutConf(fp, "OutputDevice", device->uuid);
 
@@ -3382,10 +4519,360 @@ save_printer(
     cupsFileClose(fp);
   }
 
+  if (StateSnapshots)
+    save_snapshot(printer, directory);
+
   _cupsRWUnlock(&printer->rwlock);
 }
 
 
+/*
+ * 'save_snapshot()' - Save a binary snapshot of a printer configuration.
+ *
+ * The snapshot is written to a temporary file and renamed so that a partial
+ * snapshot is never loaded.  See load_snapshot() for the file format.
+ *
+ * Note: Caller is responsible for locking the printer object.
+ */
+
+static void
+save_snapshot(
+    server_printer_t *printer,		/* I - Printer */
+    const char       *directory)	/* I - Directory for snapshot files */
+{
+  char		filename[1024],		/* Snapshot file */
+		tempfile[1024];		/* Temporary file */
+  cups_file_t	*fp;			/* File pointer */
+  ipp_t		*blocks[2];		/* Settings and printer attributes */
+  ipp_attribute_t *attr;		/* Current attribute */
+  int		i,			/* Looping var */
+		status = 0;		/* Write status */
+  size_t	length;			/* Length of block */
+  ipp_uchar_t	header[12];		/* Header/length bytes */
+#ifndef _WIN32
+  struct group	*grp;			/* Group information */
+#endif /* !_WIN32 */
+  server_icc_t	*icc;			/* Current ICC profile */
+  server_lang_t	*lang;			/* Current language */
+  server_device_t *device;		/* Current device */
+
+
+ /*
+  * Build the settings block...
+  */
+
+  blocks[0] = ippNew();
+
+#ifndef _WIN32
+  if (printer->pinfo.print_group != SERVER_GROUP_NONE && (grp = getgrgid(printer->pinfo.print_group)) != NULL)
+    ippAddString(blocks[0], IPP_TAG_PRINTER, IPP_TAG_NAME, "print-group", NULL, grp->gr_name);
+
+  if (printer->pinfo.proxy_group != SERVER_GROUP_NONE && (grp = getgrgid(printer->pinfo.proxy_group)) != NULL)
+    ippAddString(blocks[0], IPP_TAG_PRINTER, IPP_TAG_NAME, "proxy-group", NULL, grp->gr_name);
+#endif /* !_WIN32 */
+
+  if (printer->pinfo.command)
+    ippAddString(blocks[0], IPP_TAG_PRINTER, IPP_TAG_TEXT, "command", NULL, printer->pinfo.command);
+  if (printer->pinfo.compression_level)
+    ippAddInteger(blocks[0], IPP_TAG_PRINTER, IPP_TAG_INTEGER, "compression-level", printer->pinfo.compression_level);
+  if (printer->pinfo.device_uri)
+    ippAddString(blocks[0], IPP_TAG_PRINTER, IPP_TAG_URI, "device-uri", NULL, printer->pinfo.device_uri);
+  if (printer->pinfo.output_format)
+    ippAddString(blocks[0], IPP_TAG_PRINTER, IPP_TAG_MIMETYPE, "output-format", NULL, printer->pinfo.output_format);
+  if (printer->pinfo.stream_formats)
+    ippAddString(blocks[0], IPP_TAG_PRINTER, IPP_TAG_TEXT, "stream-formats", NULL, printer->pinfo.stream_formats);
+
+  ippAddBoolean(blocks[0], IPP_TAG_PRINTER, "initial-accepting", (char)printer->is_accepting);
+  ippAddInteger(blocks[0], IPP_TAG_PRINTER, IPP_TAG_ENUM, "initial-state", (int)printer->state);
+  ippAddInteger(blocks[0], IPP_TAG_PRINTER, IPP_TAG_INTEGER, "initial-reasons", (int)printer->state_reasons);
+
+  if (printer->pinfo.max_devices)
+    ippAddInteger(blocks[0], IPP_TAG_PRINTER, IPP_TAG_INTEGER, "max-output-devices", printer->pinfo.max_devices);
+  if (printer->pinfo.max_processing)
+    ippAddInteger(blocks[0], IPP_TAG_PRINTER, IPP_TAG_INTEGER, "max-processing-jobs", printer->pinfo.max_processing);
+
+  for (attr = NULL, device = (server_device_t *)cupsArrayFirst(printer->pinfo.devices); device; device = (server_device_t *)cupsArrayNext(printer->pinfo.devices))
+  {
+    if (attr)
+      ippSetString(blocks[0], &attr, ippGetCount(attr), device->uuid);
+    else
+      attr = ippAddString(blocks[0], IPP_TAG_PRINTER, IPP_TAG_URI, "output-device-uuid", NULL, device->uuid);
+  }
+
+  ippAddBoolean(blocks[0], IPP_TAG_PRINTER, "web-forms", printer->pinfo.web_forms);
+
+  for (attr = NULL, lang = (server_lang_t *)cupsArrayFirst(printer->pinfo.strings); lang; lang = (server_lang_t *)cupsArrayNext(printer->pinfo.strings))
+  {
+    ipp_t *col = ippNew();		/* Strings value */
+
+    ippAddString(col, IPP_TAG_ZERO, IPP_TAG_LANGUAGE, "language", NULL, lang->lang);
+    ippAddString(col, IPP_TAG_ZERO, IPP_TAG_NAME, "file", NULL, lang->resource->filename);
+
+    if (attr)
+      ippSetCollection(blocks[0], &attr, ippGetCount(attr), col);
+    else
+      attr = ippAddCollection(blocks[0], IPP_TAG_PRINTER, "strings", col);
+
+    ippDelete(col);
+  }
+
+  for (attr = NULL, icc = (server_icc_t *)cupsArrayFirst(printer->pinfo.profiles); icc; icc = (server_icc_t *)cupsArrayNext(printer->pinfo.profiles))
+  {
+    ipp_t *col = ippNew();		/* Profile value */
+
+    ippCopyAttribute(col, ippFindAttribute(icc->attrs, "profile-name", IPP_TAG_NAME), 0);
+    ippAddString(col, IPP_TAG_ZERO, IPP_TAG_NAME, "profile-file", NULL, icc->resource->filename);
+    ippCopyAttributes(col, icc->attrs, 0, (ipp_copycb_t)snapshot_profile_cb, NULL);
+
+    if (attr)
+      ippSetCollection(blocks[0], &attr, ippGetCount(attr), col);
+    else
+      attr = ippAddCollection(blocks[0], IPP_TAG_PRINTER, "profiles", col);
+
+    ippDelete(col);
+  }
+
+ /*
+  * Then the printer attributes...
+  */
+
+  blocks[1] = ippNew();
+  ippCopyAttributes(blocks[1], printer->pinfo.attrs, 0, (ipp_copycb_t)snapshot_attr_cb, NULL);
+
+ /*
+  * Write the snapshot...
+  */
+
+  snprintf(filename, sizeof(filename), "%s/%s.snap", directory, printer->name);
+  snprintf(tempfile, sizeof(tempfile), "%s/%s.snap.tmp", directory, printer->name);
+
+  if ((fp = cupsFileOpen(tempfile, "w")) != NULL)
+  {
+    memcpy(header, SERVER_SNAPSHOT_MAGIC, 8);
+    header[8]  = (ipp_uchar_t)(SERVER_SNAPSHOT_VERSION >> 24);
+    header[9]  = (ipp_uchar_t)(SERVER_SNAPSHOT_VERSION >> 16);
+    header[10] = (ipp_uchar_t)(SERVER_SNAPSHOT_VERSION >> 8);
+    header[11] = (ipp_uchar_t)SERVER_SNAPSHOT_VERSION;
+
+    status = cupsFileWrite(fp, (char *)header, sizeof(header)) == sizeof(header);
+
+    for (i = 0; i < 2 && status; i ++)
+    {
+      length    = ippLength(blocks[i]);
+      header[0] = (ipp_uchar_t)(length >> 24);
+      header[1] = (ipp_uchar_t)(length >> 16);
+      header[2] = (ipp_uchar_t)(length >> 8);
+      header[3] = (ipp_uchar_t)length;
+
+      status = cupsFileWrite(fp, (char *)header, 4) == 4 && ippWriteIO(fp, (ipp_iocb_t)cupsFileWrite, 1, NULL, blocks[i]) == IPP_STATE_DATA;
+    }
+
+    if (cupsFileClose(fp))
+      status = 0;
+
+    if (status && rename(tempfile, filename))
+      status = 0;
+
+    if (!status)
+      unlink(tempfile);
+  }
+
+  if (!status)
+    serverLog(SERVER_LOGLEVEL_ERROR, "Unable to save snapshot \"%s\": %s", filename, strerror(errno));
+
+  ippDelete(blocks[0]);
+  ippDelete(blocks[1]);
+}
+
+
+/*
+ * 'save_system()' - Save changed printers in the background.
+ *
+ * Changes are coalesced for SERVER_SAVE_DELAY seconds so that a burst of
+ * administrative operations results in a single save.
+ */
+
+static void *				/* O - Thread exit status (not used) */
+save_system(void *data)			/* I - Thread data (not used) */
+{
+  time_t	deadline,		/* Time to save */
+		curtime;		/* Current time */
+
+
+  (void)data;
+
+  _cupsMutexLock(&state_mutex);
+
+  for (;;)
+  {
+    while (!state_pending)
+      _cupsCondWait(&state_cond, &state_mutex, 0.0);
+
+    deadline = time(NULL) + SERVER_SAVE_DELAY;
+
+    while ((curtime = time(NULL)) < deadline)
+      _cupsCondWait(&state_cond, &state_mutex, (double)(deadline - curtime));
+
+    state_pending = 0;
+
+    _cupsMutexUnlock(&state_mutex);
+
+    serverSaveSystem();
+
+    _cupsMutexLock(&state_mutex);
+  }
+
+  return (NULL);
+}
+
+
+/*
+ * 'snap_enter()' - Start reading the published snapshots.
+ */
+
+static unsigned				/* O - Reader epoch */
+snap_enter(void)
+{
+  unsigned	epoch = SERVER_ATOMIC_GET(snap_epoch) & 1;
+					/* Reader epoch */
+
+
+  SERVER_ATOMIC_INC(snap_readers[epoch]);
+
+  return (epoch);
+}
+
+
+/*
+ * 'snap_leave()' - Stop reading the published snapshots.
+ */
+
+static void
+snap_leave(unsigned epoch)		/* I - Reader epoch */
+{
+  SERVER_ATOMIC_DEC(snap_readers[epoch]);
+}
+
+
+/*
+ * 'snap_synchronize()' - Wait for readers of the old snapshots to finish.
+ *
+ * New readers count themselves in the other epoch, so both epochs are drained
+ * in turn to account for readers that saw the epoch before it was flipped.
+ * The snap_mutex must be held.
+ */
+
+static void
+snap_synchronize(void)
+{
+  int		phase;			/* Current phase */
+  unsigned	epoch;			/* Epoch to drain */
+
+
+  for (phase = 0; phase < 2; phase ++)
+  {
+    epoch = snap_epoch & 1;
+
+    SERVER_ATOMIC_SET(snap_epoch, snap_epoch + 1);
+
+    while (SERVER_ATOMIC_GET(snap_readers[epoch]) > 0)
+      usleep(100);
+  }
+}
+
+
+/*
+ * 'snapshot_attr_cb()' - Filter the printer attributes saved in a snapshot.
+ */
+
+static int				/* O - 1 to copy, 0 to skip */
+snapshot_attr_cb(
+    void            *context,		/* I - Context (unused) */
+    ipp_t           *dst,		/* I - Destination (unused) */
+    ipp_attribute_t *attr)		/* I - Source attribute */
+{
+  const char	*name = ippGetName(attr);
+					/* Attribute name */
+
+
+  (void)context;
+  (void)dst;
+
+  return (ippGetGroupTag(attr) == IPP_TAG_PRINTER && name && attr_cb(NULL, NULL, name));
+}
+
+
+/*
+ * 'snapshot_profile_cb()' - Filter the ICC profile attributes saved in a
+ *                           snapshot.
+ */
+
+static int				/* O - 1 to copy, 0 to skip */
+snapshot_profile_cb(
+    void            *context,		/* I - Context (unused) */
+    ipp_t           *dst,		/* I - Destination (unused) */
+    ipp_attribute_t *attr)		/* I - Source attribute */
+{
+  const char	*name = ippGetName(attr);
+					/* Attribute name */
+
+
+  (void)context;
+  (void)dst;
+
+  return (name && strcmp(name, "profile-name") && strcmp(name, "profile-file") && strcmp(name, "profile-uri"));
+}
+
+
+/*
+ * 'state_changed()' - Wake up the state thread, starting it as needed.
+ *
+ * Note: Caller must hold the state mutex.
+ */
+
+static void
+state_changed(void)
+{
+  _cups_thread_t	t;		/* State thread */
+
+
+  state_pending = 1;
+
+  if (!state_thread)
+  {
+    if ((t = _cupsThreadCreate((_cups_thread_func_t)save_system, NULL)) == 0)
+    {
+      serverLog(SERVER_LOGLEVEL_ERROR, "Unable to create state thread (%s)", strerror(errno));
+      return;
+    }
+
+    _cupsThreadDetach(t);
+    serverMetricsAdjust(SERVER_METRIC_THREADS, 1);
+
+    state_thread = 1;
+  }
+
+  _cupsCondBroadcast(&state_cond);
+}
+
+
+/*
+ * 'state_directory()' - Get the state directory for a printer.
+ */
+
+static void
+state_directory(
+    server_printer_t *printer,		/* I - Printer */
+    char             *buffer,		/* I - Directory buffer */
+    size_t           bufsize)		/* I - Size of buffer */
+{
+  if (!strncmp(printer->resource, "/ipp/print/", 11))
+    snprintf(buffer, bufsize, "%s/print", StateDirectory);
+  else
+    snprintf(buffer, bufsize, "%s/print3d", StateDirectory);
+}
+
+
 /*
  * 'token_cb()' - Process ippserver-specific config file tokens.
  */
@@ -3415,8 +4902,6 @@ token_cb(_ipp_file_t    *f,		/* I - IPP file data */
 #ifndef _WIN32
   else if (!_cups_strcasecmp(token, "AuthPrintGroup"))
   {
-    struct group	*group;		/* Group information */
-
     if (!_ippFileReadToken(f, temp, sizeof(temp)))
     {
       serverLog(SERVER_LOGLEVEL_ERROR, "Missing AuthPrintGroup value on line %d of \"%s\".", f->linenum, f->filename);
@@ -3425,18 +4910,14 @@ token_cb(_ipp_file_t    *f,		/* I - IPP file data */
 
     _ippVarsExpand(vars, value, temp, sizeof(value));
 
-    if ((group = getgrnam(value)) == NULL)
+    if (!find_group(value, &pinfo->print_group))
     {
       serverLog(SERVER_LOGLEVEL_ERROR, "Unknown AuthPrintGroup \"%s\" on line %d of \"%s\".", value, f->linenum, f->filename);
       return (0);
     }
-
-    pinfo->print_group = group->gr_gid;
   }
   else if (!_cups_strcasecmp(token, "AuthProxyGroup"))
   {
-    struct group	*group;		/* Group information */
-
     if (!_ippFileReadToken(f, temp, sizeof(temp)))
     {
       serverLog(SERVER_LOGLEVEL_ERROR, "Missing AuthProxyGroup value on line %d of \"%s\".", f->linenum, f->filename);
@@ -3445,13 +4926,11 @@ token_cb(_ipp_file_t    *f,		/* I - IPP file data */
 
     _ippVarsExpand(vars, value, temp, sizeof(value));
 
-    if ((group = getgrnam(value)) == NULL)
+    if (!find_group(value, &pinfo->proxy_group))
     {
       serverLog(SERVER_LOGLEVEL_ERROR, "Unknown AuthProxyGroup \"%s\" on line %d of \"%s\".", value, f->linenum, f->filename);
       return (0);
     }
-
-    pinfo->proxy_group = group->gr_gid;
   }
 #endif /* !_WIN32 */
   else if (!_cups_strcasecmp(token, "Command"))
@@ -3466,6 +4945,36 @@ token_cb(_ipp_file_t    *f,		/* I - IPP file data */
 
     pinfo->command = strdup(value);
   }
+  else if (!_cups_strcasecmp(token, "CompressionLevel"))
+  {
+    if (!_ippFileReadToken(f, temp, sizeof(temp)))
+    {
+      serverLog(SERVER_LOGLEVEL_ERROR, "Missing CompressionLevel value on line %d of \"%s\".", f->linenum, f->filename);
+      return (0);
+    }
+
+    if ((pinfo->compression_level = atoi(temp)) < 1 || pinfo->compression_level > 9)
+    {
+      serverLog(SERVER_LOGLEVEL_ERROR, "Bad CompressionLevel value \"%s\" on line %d of \"%s\".", temp, f->linenum, f->filename);
+      return (0);
+    }
+  }
+  else if (!_cups_strcasecmp(token, "CPULimit"))
+  {
+    if (!_ippFileReadToken(f, temp, sizeof(temp)))
+    {
+      serverLog(SERVER_LOGLEVEL_ERROR, "Missing CPULimit value on line %d of \"%s\".", f->linenum, f->filename);
+      return (0);
+    }
+
+    if (!isdigit(temp[0] & 255))
+    {
+      serverLog(SERVER_LOGLEVEL_ERROR, "Bad CPULimit value \"%s\" on line %d of \"%s\".", temp, f->linenum, f->filename);
+      return (0);
+    }
+
+    pinfo->cpu_limit = atoi(temp);
+  }
   else if (!_cups_strcasecmp(token, "DeviceURI"))
   {
     if (!_ippFileReadToken(f, temp, sizeof(temp)))
@@ -3526,6 +5035,46 @@ token_cb(_ipp_file_t    *f,		/* I - IPP file data */
 
     pinfo->max_devices = atoi(temp);
   }
+  else if (!_cups_strcasecmp(token, "MaxProcessingJobs"))
+  {
+    if (!_ippFileReadToken(f, temp, sizeof(temp)))
+    {
+      serverLog(SERVER_LOGLEVEL_ERROR, "Missing MaxProcessingJobs value on line %d of \"%s\".", f->linenum, f->filename);
+      return (0);
+    }
+
+    pinfo->max_processing = atoi(temp);
+  }
+  else if (!_cups_strcasecmp(token, "MemoryLimit"))
+  {
+    char	*units;			/* Units after number */
+    double	size;			/* Memory limit */
+
+    if (!_ippFileReadToken(f, temp, sizeof(temp)))
+    {
+      serverLog(SERVER_LOGLEVEL_ERROR, "Missing MemoryLimit value on line %d of \"%s\".", f->linenum, f->filename);
+      return (0);
+    }
+
+    if ((size = strtod(temp, &units)) < 0.0)
+      units = NULL;
+    else if (!_cups_strcasecmp(units, "k"))
+      size *= 1024.0;
+    else if (!_cups_strcasecmp(units, "m"))
+      size *= 1048576.0;
+    else if (!_cups_strcasecmp(units, "g"))
+      size *= 1073741824.0;
+    else if (*units)
+      units = NULL;
+
+    if (!units || units == temp)
+    {
+      serverLog(SERVER_LOGLEVEL_ERROR, "Bad MemoryLimit value \"%s\" on line %d of \"%s\".", temp, f->linenum, f->filename);
+      return (0);
+    }
+
+    pinfo->memory_limit = (off_t)size;
+  }
   else if (!_cups_strcasecmp(token, "Model"))
   {
     if (!_ippFileReadToken(f, temp, sizeof(temp)))
@@ -3562,7 +5111,7 @@ token_cb(_ipp_file_t    *f,		/* I - IPP file data */
   }
   else if (!_cups_strcasecmp(token, "Profile"))
   {
-    server_icc_t	icc;		/* ICC profile data */
+    ipp_t		*attrs;		/* ICC profile attributes */
     char		filename[1024];	/* ICC file */
 
     if (!_ippFileReadToken(f, temp, sizeof(temp)))
@@ -3587,32 +5136,43 @@ token_cb(_ipp_file_t    *f,		/* I - IPP file data */
       return (0);
     }
 
-    if ((icc.attrs = parse_collection(f, vars, pinfo)) == NULL)
+    if ((attrs = parse_collection(f, vars, pinfo)) == NULL)
       return (0);
 
-    if ((icc.resource = serverFindResourceByFilename(filename)) == NULL)
-      icc.resource = serverCreateResource(NULL, filename, "application/icc", value, value, "static-icc-profile", NULL);
+    add_profile(pinfo, value, filename, attrs);
+  }
+  else if (!_cups_strcasecmp(token, "StreamFormats"))
+  {
+    if (!_ippFileReadToken(f, temp, sizeof(temp)))
+    {
+      serverLog(SERVER_LOGLEVEL_ERROR, "Missing StreamFormats value on line %d of \"%s\".", f->linenum, f->filename);
+      return (0);
+    }
 
-    ippAddString(icc.attrs, IPP_TAG_PRINTER, IPP_TAG_NAME, "profile-name", NULL, value);
-    httpAssembleURI(HTTP_URI_CODING_ALL, temp, sizeof(temp),
-#ifdef HAVE_SSL
-                    Encryption != HTTP_ENCRYPTION_NEVER ? SERVER_HTTPS_SCHEME : SERVER_HTTP_SCHEME,
-#else
-                    SERVER_HTTP_SCHEME,
-#endif /* HAVE_SSL */
-                    NULL, ServerName, DefaultPort, icc.resource->resource);
-    ippAddString(icc.attrs, IPP_TAG_PRINTER, IPP_TAG_URI, "profile-uri", NULL, temp);
+    _ippVarsExpand(vars, value, temp, sizeof(value));
 
-    if (!pinfo->profiles)
-      pinfo->profiles = cupsArrayNew3(NULL, NULL, NULL, 0, (cups_acopy_func_t)copy_icc, (cups_afree_func_t)free_icc);
+    while (f->bufptr < f->bufend && *f->bufptr == ',' && _ippFileReadToken(f, temp, sizeof(temp)))
+    {
+     /*
+      * Append the next MIME media type in a comma-delimited list...
+      */
 
-    cupsArrayAdd(pinfo->profiles, &icc);
+      size_t valuelen = strlen(value);	/* Length of value */
 
-    serverLog(SERVER_LOGLEVEL_DEBUG, "Added ICC profile \"%s\".", filename);
+      if (!_ippFileReadToken(f, temp, sizeof(temp)))
+      {
+        serverLog(SERVER_LOGLEVEL_ERROR, "Missing StreamFormats value on line %d of \"%s\".", f->linenum, f->filename);
+        return (0);
+      }
+
+      value[valuelen++] = ',';
+      _ippVarsExpand(vars, value + valuelen, temp, sizeof(value) - valuelen);
+    }
+
+    pinfo->stream_formats = strdup(value);
   }
   else if (!_cups_strcasecmp(token, "Strings"))
   {
-    server_lang_t lang;			/* New localization */
     char	stringsfile[1024];	/* Strings filename */
 
     if (!_ippFileReadToken(f, temp, sizeof(temp)))
@@ -3631,16 +5191,7 @@ token_cb(_ipp_file_t    *f,		/* I - IPP file data */
 
     _ippVarsExpand(vars, stringsfile, temp, sizeof(stringsfile));
 
-    lang.lang = value;
-    if ((lang.resource = serverFindResourceByFilename(stringsfile)) == NULL)
-      lang.resource = serverCreateResource(NULL, stringsfile, "text/strings", value, value, "static-strings", value);
-
-    if (!pinfo->strings)
-      pinfo->strings = cupsArrayNew3((cups_array_func_t)compare_lang, NULL, NULL, 0, (cups_acopy_func_t)copy_lang, (cups_afree_func_t)free_lang);
-
-    cupsArrayAdd(pinfo->strings, &lang);
-
-    serverLog(SERVER_LOGLEVEL_DEBUG, "Added strings file \"%s\" for language \"%s\".", stringsfile, value);
+    add_strings(pinfo, value, stringsfile);
   }
   else if (!_cups_strcasecmp(token, "WebForms"))
   {
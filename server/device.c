@@ -16,6 +16,103 @@
  */
 
 static int	compare_devices(server_device_t *a, server_device_t *b);
+static int	compare_jobs(server_job_t *a, server_job_t *b);
+static server_device_t *find_device_no_lock(server_printer_t *printer, const char *uuid);
+
+
+/*
+ * 'serverAssignJobNoLock()' - Assign a fetchable job to an output device.
+ *
+ * The job goes to the ready device with the shortest expected wait, which is
+ * the number of jobs already queued on the device divided by its reported
+ * speed.  The job is left unassigned when no device is ready, and is assigned
+ * later by serverAssignJobsNoLock().
+ *
+ * Note: Caller MUST lock the printer object for writing before using.
+ */
+
+server_device_t *			/* O - Assigned device or `NULL` */
+serverAssignJobNoLock(
+    server_job_t *job)			/* I - Job */
+{
+  server_device_t	*device,	/* Current device */
+			*best = NULL;	/* Best device */
+  double		wait,		/* Expected wait for device */
+			best_wait = 0.0;/* Expected wait for best device */
+
+
+  if (job->dev_uuid)
+    return (find_device_no_lock(job->printer, job->dev_uuid));
+
+  for (device = (server_device_t *)cupsArrayFirst(job->printer->pinfo.devices); device; device = (server_device_t *)cupsArrayNext(job->printer->pinfo.devices))
+  {
+    if (device->state == IPP_PSTATE_STOPPED)
+      continue;
+
+    wait = (cupsArrayCount(device->jobs) + 1) / (double)(device->ppm > 0 ? device->ppm : 1);
+
+    if (!best || wait < best_wait)
+    {
+      best      = device;
+      best_wait = wait;
+    }
+  }
+
+  if (best && (job->dev_uuid = strdup(best->uuid)) != NULL)
+  {
+    cupsArrayAdd(best->jobs, job);
+
+    SERVER_LOG_JOB_DEBUG(job, "Assigned to output device \"%s\" with %d queued job(s).", best->uuid, cupsArrayCount(best->jobs));
+  }
+
+  return (best);
+}
+
+
+/*
+ * 'serverAssignJobsNoLock()' - Rebuild the device job indices and assign any
+ *                              waiting fetchable jobs.
+ *
+ * This is called when output devices are added, removed, or change state.
+ * Fetchable jobs that have not been acknowledged by a missing or stopped
+ * device are moved to another device.
+ *
+ * Note: Caller MUST lock the printer object for writing before using.
+ */
+
+void
+serverAssignJobsNoLock(
+    server_printer_t *printer)		/* I - Printer */
+{
+  server_device_t	*device;	/* Current device */
+  server_job_t		*job;		/* Current job */
+
+
+  for (device = (server_device_t *)cupsArrayFirst(printer->pinfo.devices); device; device = (server_device_t *)cupsArrayNext(printer->pinfo.devices))
+    cupsArrayClear(device->jobs);
+
+  for (job = (server_job_t *)cupsArrayFirst(printer->active_jobs); job; job = (server_job_t *)cupsArrayNext(printer->active_jobs))
+  {
+    if (!job->dev_uuid)
+      continue;
+
+    device = find_device_no_lock(printer, job->dev_uuid);
+
+    if ((job->state_reasons & SERVER_JREASON_JOB_FETCHABLE) && (!device || device->state == IPP_PSTATE_STOPPED))
+    {
+      free(job->dev_uuid);
+      job->dev_uuid = NULL;
+    }
+    else if (device && job->dev_state < IPP_JSTATE_CANCELED)
+      cupsArrayAdd(device->jobs, job);
+  }
+
+  for (job = (server_job_t *)cupsArrayFirst(printer->active_jobs); job; job = (server_job_t *)cupsArrayNext(printer->active_jobs))
+  {
+    if (!job->dev_uuid && (job->state_reasons & SERVER_JREASON_JOB_FETCHABLE))
+      serverAssignJobNoLock(job);
+  }
+}
 
 
 /*
@@ -30,16 +127,20 @@ serverCreateDevice(
   ipp_attribute_t	*uuid;		/* output-device-uuid */
 
 
-  serverLogClient(SERVER_LOGLEVEL_DEBUG, client, "serverCreateDevice: Finding output-device-uuid.");
+  SERVER_LOG_CLIENT_DEBUG(client, "serverCreateDevice: Finding output-device-uuid.");
 
   if ((uuid = ippFindAttribute(client->request, "output-device-uuid", IPP_TAG_URI)) == NULL)
     return (NULL);
 
   _cupsRWLockWrite(&client->printer->rwlock);
-  device = serverCreateDevicePinfo(&client->printer->pinfo, ippGetString(uuid, 0, NULL));
+  if ((device = serverCreateDevicePinfo(&client->printer->pinfo, ippGetString(uuid, 0, NULL))) != NULL)
+    serverAssignJobsNoLock(client->printer);
   _cupsRWUnlock(&client->printer->rwlock);
 
-  serverLogClient(SERVER_LOGLEVEL_DEBUG, client, "serverCreateDevice: Created device object for \"%s\".", device->uuid);
+  if (!device)
+    return (NULL);
+
+  SERVER_LOG_CLIENT_DEBUG(client, "serverCreateDevice: Created device object for \"%s\".", device->uuid);
 
   return (device);
 }
@@ -63,8 +164,9 @@ serverCreateDevicePinfo(
   _cupsRWInit(&device->rwlock);
 
   device->uuid  = strdup(uuid);
-  device->state = IPP_PSTATE_STOPPED;
+  device->state = IPP_PSTATE_IDLE;
   device->attrs = ippNew();
+  device->jobs  = cupsArrayNew((cups_array_func_t)compare_jobs, NULL);
 
   if (!pinfo->devices)
     pinfo->devices = cupsArrayNew((cups_array_func_t)compare_devices, NULL);
@@ -89,7 +191,7 @@ serverDeleteDevice(
   * Free memory used for the device...
   */
 
-  serverLog(SERVER_LOGLEVEL_DEBUG, "Deleting device object for \"%s\".", device->uuid);
+  SERVER_LOG_DEBUG("Deleting device object for \"%s\".", device->uuid);
 
   _cupsRWDeinit(&device->rwlock);
 
@@ -99,6 +201,7 @@ serverDeleteDevice(
   free(device->uuid);
 
   ippDelete(device->attrs);
+  cupsArrayDelete(device->jobs);
 
   free(device);
 }
@@ -117,25 +220,43 @@ serverFindDevice(
 			*device;	/* Matching device */
 
 
-  serverLogClient(SERVER_LOGLEVEL_DEBUG, client, "serverFindDevice: Looking for output-device-uuid.");
+  SERVER_LOG_CLIENT_DEBUG(client, "serverFindDevice: Looking for output-device-uuid.");
 
   if ((uuid = ippFindAttribute(client->request, "output-device-uuid", IPP_TAG_URI)) == NULL)
     return (NULL);
 
   key.uuid = (char *)ippGetString(uuid, 0, NULL);
 
-  serverLogClient(SERVER_LOGLEVEL_DEBUG, client, "serverFindDevice: Looking for \"%s\".", key.uuid);
+  SERVER_LOG_CLIENT_DEBUG(client, "serverFindDevice: Looking for \"%s\".", key.uuid);
 
   _cupsRWLockRead(&client->printer->rwlock);
   device = (server_device_t *)cupsArrayFind(client->printer->pinfo.devices, &key);
   _cupsRWUnlock(&client->printer->rwlock);
 
-  serverLogClient(SERVER_LOGLEVEL_DEBUG, client, "serverFindDevice: Returning device=%p", (void *)device);
+  SERVER_LOG_CLIENT_DEBUG(client, "serverFindDevice: Returning device=%p", (void *)device);
 
   return (device);
 }
 
 
+/*
+ * 'serverReleaseDeviceJobNoLock()' - Remove a job from its device's queue.
+ *
+ * Note: Caller MUST lock the printer object for writing before using.
+ */
+
+void
+serverReleaseDeviceJobNoLock(
+    server_job_t *job)			/* I - Job */
+{
+  server_device_t	*device;	/* Assigned device */
+
+
+  if (job->dev_uuid && (device = find_device_no_lock(job->printer, job->dev_uuid)) != NULL)
+    cupsArrayRemove(device->jobs, job);
+}
+
+
 /*
  * 'serverUpdateDeviceAttributesNoLock()' - Update the composite device attributes.
  *
@@ -160,6 +281,9 @@ serverUpdateDeviceAttributesNoLock(
   ippDelete(printer->dev_attrs);
   printer->dev_attrs   = dev_attrs;
   printer->config_time = time(NULL);
+
+  serverClearPrinterCacheNoLock(printer);
+  serverMarkPrinterDirty(printer);
 }
 
 
@@ -204,3 +328,33 @@ compare_devices(server_device_t *a,	/* I - First device */
 {
   return (strcmp(a->uuid, b->uuid));
 }
+
+
+/*
+ * 'compare_jobs()' - Compare two jobs by job-id.
+ */
+
+static int				/* O - Result of comparison */
+compare_jobs(server_job_t *a,		/* I - First job */
+             server_job_t *b)		/* I - Second job */
+{
+  return (a->id - b->id);
+}
+
+
+/*
+ * 'find_device_no_lock()' - Find a printer's output device by UUID.
+ */
+
+static server_device_t *		/* O - Device or `NULL` */
+find_device_no_lock(
+    server_printer_t *printer,		/* I - Printer */
+    const char       *uuid)		/* I - output-device-uuid value */
+{
+  server_device_t	key;		/* Search key */
+
+
+  key.uuid = (char *)uuid;
+
+  return ((server_device_t *)cupsArrayFind(printer->pinfo.devices, &key));
+}
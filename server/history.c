@@ -0,0 +1,704 @@
+/*
+ * Job history functions for sample IPP server implementation.
+ *
+ * Copyright © 2014-2018 by the IEEE-ISTO Printer Working Group
+ * Copyright © 2010-2018 by Apple Inc.
+ *
+ * Licensed under Apache License v2.0.  See the file "LICENSE" for more
+ * information.
+ */
+
+#include "ippserver.h"
+
+
+/*
+ * Local constants...
+ */
+
+#define SERVER_HISTORY_MAGIC	"IPPHIST\n"
+					/* Job history file magic */
+#define SERVER_HISTORY_VERSION	1	/* Job history file version */
+#define SERVER_HISTORY_HEADER	12	/* Length of file header */
+#define SERVER_HISTORY_RECORD	62	/* Length of record header */
+
+
+/*
+ * Local functions...
+ */
+
+static int	compare_entries(server_hentry_t *a, server_hentry_t *b);
+static void	copy_string(const ipp_uchar_t *data, size_t length, char *buffer, size_t bufsize);
+static void	free_entry(server_hentry_t *entry);
+static unsigned long long get_value(const ipp_uchar_t *data, int bytes);
+static void	history_filename(server_printer_t *printer, char *buffer, size_t bufsize);
+static ssize_t	pread_history(int fd, void *buffer, size_t bytes, off_t offset);
+static void	put_value(ipp_uchar_t *data, unsigned long long value, int bytes);
+static void	rewrite_history(server_printer_t *printer);
+
+
+/*
+ * 'serverAddJobHistoryNoLock()' - Append a completed job to the job history.
+ *
+ * A job history file starts with the SERVER_HISTORY_MAGIC string and a 32-bit
+ * version number.  Each job is then appended as a record that starts with a
+ * 32-bit length of the rest of the record, followed by:
+ *
+ *   job-id, job-state, job-state-reasons bits, job-impressions, and
+ *   job-impressions-completed (32 bits each)
+ *   time-at-creation, time-at-processing, and time-at-completed (64 bits each)
+ *   length of the job and document attributes (32 bits each)
+ *   length of the username, document format, and filename (16 bits each)
+ *   the username, document format, and filename strings
+ *   the compact job and document attributes
+ *
+ * All values are stored in network byte order.
+ *
+ * Note: Caller MUST lock the printer and job objects for writing before using.
+ */
+
+int					/* O - 1 on success, 0 on failure */
+serverAddJobHistoryNoLock(
+    server_job_t *job)			/* I - Job */
+{
+  server_printer_t	*printer = job->printer;
+					/* Printer */
+  server_hentry_t	*entry;		/* Index entry */
+  ipp_uchar_t		*record,	/* Record data */
+			*ptr;		/* Pointer into record */
+  size_t		length,		/* Length of record */
+			ulen,		/* Length of username */
+			flen,		/* Length of document format */
+			fnlen;		/* Length of filename */
+
+
+  if (!printer->history || !job->compact)
+    return (0);
+
+  ulen  = job->username ? strlen(job->username) : 0;
+  flen  = job->format ? strlen(job->format) : 0;
+  fnlen = job->filename ? strlen(job->filename) : 0;
+
+  if (ulen > 65535 || flen > 65535 || fnlen > 65535)
+    return (0);
+
+  length = SERVER_HISTORY_RECORD + ulen + flen + fnlen + job->compact_attrs + job->compact_doc_attrs;
+
+  if ((record = malloc(length)) == NULL)
+    return (0);
+
+  put_value(record, length - 4, 4);
+  put_value(record + 4, (unsigned)job->id, 4);
+  put_value(record + 8, (unsigned)job->state, 4);
+  put_value(record + 12, (unsigned)(job->state_reasons | job->dev_state_reasons), 4);
+  put_value(record + 16, (unsigned)job->impressions, 4);
+  put_value(record + 20, (unsigned)job->impcompleted, 4);
+  put_value(record + 24, (unsigned long long)job->created, 8);
+  put_value(record + 32, (unsigned long long)job->processing, 8);
+  put_value(record + 40, (unsigned long long)job->completed, 8);
+  put_value(record + 48, job->compact_attrs, 4);
+  put_value(record + 52, job->compact_doc_attrs, 4);
+  put_value(record + 56, ulen, 2);
+  put_value(record + 58, flen, 2);
+  put_value(record + 60, fnlen, 2);
+
+  ptr = record + SERVER_HISTORY_RECORD;
+
+  memcpy(ptr, job->username, ulen);
+  ptr += ulen;
+  memcpy(ptr, job->format, flen);
+  ptr += flen;
+  memcpy(ptr, job->filename, fnlen);
+  ptr += fnlen;
+  memcpy(ptr, job->compact, job->compact_attrs + job->compact_doc_attrs);
+
+  if ((entry = calloc(1, sizeof(server_hentry_t))) == NULL || write(printer->history_fd, record, length) != (ssize_t)length)
+  {
+    serverLogJob(SERVER_LOGLEVEL_ERROR, job, "Unable to add job to history: %s", strerror(errno));
+
+    if (entry && ftruncate(printer->history_fd, printer->history_size))
+      serverLogPrinter(SERVER_LOGLEVEL_ERROR, printer, "Unable to truncate job history: %s", strerror(errno));
+
+    free(entry);
+    free(record);
+    return (0);
+  }
+
+  free(record);
+
+  entry->id        = job->id;
+  entry->state     = job->state;
+  entry->completed = job->completed;
+  entry->username  = _cupsStrAlloc(job->username ? job->username : "");
+  entry->offset    = printer->history_size;
+  entry->length    = length;
+
+  printer->history_size += (off_t)length;
+
+  cupsArrayAdd(printer->history, entry);
+
+  return (1);
+}
+
+
+/*
+ * 'serverCleanJobHistoryNoLock()' - Remove expired jobs from the job history.
+ *
+ * Expired records stay in the history file until they make up half of it, at
+ * which point the file is rewritten with the remaining records.
+ *
+ * Note: Caller MUST lock the printer object for writing before using.
+ */
+
+void
+serverCleanJobHistoryNoLock(
+    server_printer_t *printer)		/* I - Printer */
+{
+  server_hentry_t	*entry;		/* Current entry */
+  time_t		expire;		/* Expiration time */
+
+
+  if (!printer->history)
+    return;
+
+ /*
+  * Jobs are numbered in the order they are created, so the oldest entries
+  * are always at the end of the index...
+  */
+
+  expire = time(NULL) - 86400 * JobHistory;
+
+  while ((entry = (server_hentry_t *)cupsArrayLast(printer->history)) != NULL && entry->completed < expire)
+  {
+    printer->history_expired += (off_t)entry->length;
+
+    cupsArrayRemove(printer->history, entry);
+  }
+
+  if (printer->history_expired > 0 && printer->history_expired >= (printer->history_size / 2))
+    rewrite_history(printer);
+}
+
+
+/*
+ * 'serverCloseJobHistory()' - Close the job history for a printer.
+ */
+
+void
+serverCloseJobHistory(
+    server_printer_t *printer)		/* I - Printer */
+{
+  if (!printer->history)
+    return;
+
+  close(printer->history_fd);
+  cupsArrayDelete(printer->history);
+
+  printer->history_fd = -1;
+  printer->history    = NULL;
+}
+
+
+/*
+ * 'serverDeleteHistoryJob()' - Free a job that was read from the job history.
+ */
+
+void
+serverDeleteHistoryJob(
+    server_job_t *job)			/* I - Job */
+{
+  if (!job)
+    return;
+
+  _cupsStrFree(job->username);
+  _cupsStrFree(job->format);
+
+  free(job->filename);
+  free(job->compact);
+
+  _cupsRWDeinit(&(job->rwlock));
+
+  free(job);
+}
+
+
+/*
+ * 'serverOpenJobHistory()' - Open the job history for a printer.
+ *
+ * The history index is loaded from the file and next_job_id is advanced past
+ * the jobs in the history so that job-id values are not reused.
+ */
+
+void
+serverOpenJobHistory(
+    server_printer_t *printer)		/* I - Printer */
+{
+  char			filename[1024],	/* Job history file */
+			username[256];	/* Username */
+  struct stat		fileinfo;	/* File information */
+  ipp_uchar_t		header[SERVER_HISTORY_RECORD];
+					/* File or record header */
+  off_t			offset;		/* Offset in file */
+  size_t		length,		/* Length of record */
+			ulen;		/* Length of username */
+  int			id;		/* job-id */
+  time_t		completed,	/* time-at-completed */
+			expire;		/* Expiration time */
+  server_hentry_t	*entry;		/* Index entry */
+
+
+  if (!StateDirectory || JobHistory <= 0)
+    return;
+
+  history_filename(printer, filename, sizeof(filename));
+
+  if ((printer->history_fd = open(filename, O_RDWR | O_CREAT | O_APPEND | O_BINARY, 0600)) < 0)
+  {
+    serverLogPrinter(SERVER_LOGLEVEL_ERROR, printer, "Unable to open job history \"%s\": %s", filename, strerror(errno));
+    return;
+  }
+
+  if (fstat(printer->history_fd, &fileinfo))
+  {
+    serverLogPrinter(SERVER_LOGLEVEL_ERROR, printer, "Unable to open job history \"%s\": %s", filename, strerror(errno));
+    close(printer->history_fd);
+    return;
+  }
+
+  if (fileinfo.st_size == 0)
+  {
+   /*
+    * New history file, write the header...
+    */
+
+    memcpy(header, SERVER_HISTORY_MAGIC, 8);
+    put_value(header + 8, SERVER_HISTORY_VERSION, 4);
+
+    if (write(printer->history_fd, header, SERVER_HISTORY_HEADER) != SERVER_HISTORY_HEADER)
+    {
+      serverLogPrinter(SERVER_LOGLEVEL_ERROR, printer, "Unable to write job history \"%s\": %s", filename, strerror(errno));
+      close(printer->history_fd);
+      return;
+    }
+
+    fileinfo.st_size = SERVER_HISTORY_HEADER;
+  }
+  else if (pread_history(printer->history_fd, header, SERVER_HISTORY_HEADER, 0) != SERVER_HISTORY_HEADER || memcmp(header, SERVER_HISTORY_MAGIC, 8) || get_value(header + 8, 4) != SERVER_HISTORY_VERSION)
+  {
+    serverLogPrinter(SERVER_LOGLEVEL_ERROR, printer, "Bad job history file \"%s\".", filename);
+    close(printer->history_fd);
+    return;
+  }
+
+  printer->history         = cupsArrayNew3((cups_array_func_t)compare_entries, NULL, NULL, 0, NULL, (cups_afree_func_t)free_entry);
+  printer->history_expired = 0;
+
+ /*
+  * Load the index...
+  */
+
+  expire = time(NULL) - 86400 * JobHistory;
+
+  for (offset = SERVER_HISTORY_HEADER; pread_history(printer->history_fd, header, SERVER_HISTORY_RECORD, offset) == SERVER_HISTORY_RECORD; offset += (off_t)length)
+  {
+    length    = (size_t)get_value(header, 4) + 4;
+    id        = (int)get_value(header + 4, 4);
+    completed = (time_t)get_value(header + 40, 8);
+    ulen      = (size_t)get_value(header + 56, 2);
+
+    if (length < (SERVER_HISTORY_RECORD + ulen) || (offset + (off_t)length) > fileinfo.st_size || ulen >= sizeof(username))
+      break;
+
+    if (id >= printer->next_job_id)
+      printer->next_job_id = id + 1;
+
+    if (completed < expire)
+    {
+      printer->history_expired += (off_t)length;
+      continue;
+    }
+
+    if (pread_history(printer->history_fd, username, ulen, offset + SERVER_HISTORY_RECORD) != (ssize_t)ulen)
+      break;
+
+    username[ulen] = '\0';
+
+    if ((entry = calloc(1, sizeof(server_hentry_t))) == NULL)
+      break;
+
+    entry->id        = id;
+    entry->state     = (ipp_jstate_t)get_value(header + 8, 4);
+    entry->completed = completed;
+    entry->username  = _cupsStrAlloc(username);
+    entry->offset    = offset;
+    entry->length    = length;
+
+    cupsArrayAdd(printer->history, entry);
+  }
+
+  if (offset < fileinfo.st_size)
+  {
+   /*
+    * Drop a partial record from a crash while writing...
+    */
+
+    serverLogPrinter(SERVER_LOGLEVEL_ERROR, printer, "Truncating corrupt job history \"%s\" at offset %ld.", filename, (long)offset);
+
+    if (ftruncate(printer->history_fd, offset))
+      serverLogPrinter(SERVER_LOGLEVEL_ERROR, printer, "Unable to truncate job history: %s", strerror(errno));
+  }
+
+  printer->history_size = offset;
+
+  serverLogPrinter(SERVER_LOGLEVEL_INFO, printer, "Loaded %d jobs from job history \"%s\".", cupsArrayCount(printer->history), filename);
+
+  serverCleanJobHistoryNoLock(printer);
+}
+
+
+/*
+ * 'serverReadJobHistoryNoLock()' - Read a job from the job history.
+ *
+ * The returned job only contains the values needed to report its attributes
+ * and must be freed using serverDeleteHistoryJob().
+ *
+ * Note: Caller MUST lock the printer object before using.
+ */
+
+server_job_t *				/* O - Job or `NULL` on error */
+serverReadJobHistoryNoLock(
+    server_printer_t *printer,		/* I - Printer */
+    server_hentry_t  *entry)		/* I - Index entry */
+{
+  server_job_t	*job;			/* Job */
+  ipp_uchar_t	*record;		/* Record data */
+  size_t	ulen,			/* Length of username */
+		flen,			/* Length of document format */
+		fnlen,			/* Length of filename */
+		alen,			/* Length of job attributes */
+		dlen;			/* Length of document attributes */
+  char		buffer[1024];		/* String buffer */
+
+
+  if (!printer->history || !entry)
+    return (NULL);
+
+  if ((record = malloc(entry->length)) == NULL)
+    return (NULL);
+
+  if (pread_history(printer->history_fd, record, entry->length, entry->offset) != (ssize_t)entry->length || (int)get_value(record + 4, 4) != entry->id)
+  {
+    serverLogPrinter(SERVER_LOGLEVEL_ERROR, printer, "Unable to read job #%d from history.", entry->id);
+    free(record);
+    return (NULL);
+  }
+
+  alen  = (size_t)get_value(record + 48, 4);
+  dlen  = (size_t)get_value(record + 52, 4);
+  ulen  = (size_t)get_value(record + 56, 2);
+  flen  = (size_t)get_value(record + 58, 2);
+  fnlen = (size_t)get_value(record + 60, 2);
+
+  if ((SERVER_HISTORY_RECORD + ulen + flen + fnlen + alen + dlen) != entry->length || (job = calloc(1, sizeof(server_job_t))) == NULL)
+  {
+    free(record);
+    return (NULL);
+  }
+
+  job->id            = entry->id;
+  job->printer       = printer;
+  job->state         = (ipp_jstate_t)get_value(record + 8, 4);
+  job->state_reasons = (server_jreason_t)get_value(record + 12, 4);
+  job->impressions   = (int)get_value(record + 16, 4);
+  job->impcompleted  = (int)get_value(record + 20, 4);
+  job->created       = (time_t)get_value(record + 24, 8);
+  job->processing    = (time_t)get_value(record + 32, 8);
+  job->completed     = (time_t)get_value(record + 40, 8);
+  job->fd            = -1;
+  job->memfd         = -1;
+  job->stream_fd     = -1;
+  job->stream_in     = -1;
+
+  _cupsRWInit(&(job->rwlock));
+
+  copy_string(record + SERVER_HISTORY_RECORD, ulen, buffer, sizeof(buffer));
+  job->username = _cupsStrAlloc(buffer);
+
+  copy_string(record + SERVER_HISTORY_RECORD + ulen, flen, buffer, sizeof(buffer));
+  job->format = _cupsStrAlloc(buffer);
+
+  if (fnlen > 0)
+  {
+    copy_string(record + SERVER_HISTORY_RECORD + ulen + flen, fnlen, buffer, sizeof(buffer));
+    job->filename = strdup(buffer);
+  }
+
+ /*
+  * Reuse the record buffer for the compact attributes...
+  */
+
+  memmove(record, record + SERVER_HISTORY_RECORD + ulen + flen + fnlen, alen + dlen);
+
+  job->compact           = record;
+  job->compact_attrs     = alen;
+  job->compact_doc_attrs = dlen;
+
+  return (job);
+}
+
+
+/*
+ * 'compare_entries()' - Compare two job history entries.
+ */
+
+static int				/* O - Result of comparison */
+compare_entries(server_hentry_t *a,	/* I - First entry */
+                server_hentry_t *b)	/* I - Second entry */
+{
+  return (b->id - a->id);
+}
+
+
+/*
+ * 'copy_string()' - Copy a string from a record.
+ */
+
+static void
+copy_string(const ipp_uchar_t *data,	/* I - String data */
+            size_t            length,	/* I - Length of string */
+            char              *buffer,	/* I - String buffer */
+            size_t            bufsize)	/* I - Size of string buffer */
+{
+  if (length >= bufsize)
+    length = bufsize - 1;
+
+  memcpy(buffer, data, length);
+  buffer[length] = '\0';
+}
+
+
+/*
+ * 'free_entry()' - Free a job history entry.
+ */
+
+static void
+free_entry(server_hentry_t *entry)	/* I - Entry */
+{
+  _cupsStrFree(entry->username);
+  free(entry);
+}
+
+
+/*
+ * 'get_value()' - Get an unsigned value in network byte order.
+ */
+
+static unsigned long long		/* O - Value */
+get_value(const ipp_uchar_t *data,	/* I - Value data */
+          int               bytes)	/* I - Number of bytes */
+{
+  unsigned long long	value = 0;	/* Value */
+
+
+  while (bytes > 0)
+  {
+    value = (value << 8) | *data++;
+    bytes --;
+  }
+
+  return (value);
+}
+
+
+/*
+ * 'history_filename()' - Get the job history filename for a printer.
+ */
+
+static void
+history_filename(
+    server_printer_t *printer,		/* I - Printer */
+    char             *buffer,		/* I - Filename buffer */
+    size_t           bufsize)		/* I - Size of buffer */
+{
+  snprintf(buffer, bufsize, "%s/%s", StateDirectory, strncmp(printer->resource, "/ipp/print/", 11) ? "print3d" : "print");
+
+  if (access(buffer, 0))
+    mkdir(buffer, 0777);
+
+  snprintf(buffer, bufsize, "%s/%s/%s.history", StateDirectory, strncmp(printer->resource, "/ipp/print/", 11) ? "print3d" : "print", printer->name);
+}
+
+
+/*
+ * 'pread_history()' - Read data from a job history file.
+ */
+
+static ssize_t				/* O - Number of bytes read */
+pread_history(int    fd,		/* I - File descriptor */
+              void   *buffer,		/* I - Read buffer */
+              size_t bytes,		/* I - Number of bytes to read */
+              off_t  offset)		/* I - Offset in file */
+{
+#ifdef _WIN32
+  static _cups_mutex_t	mutex = _CUPS_MUTEX_INITIALIZER;
+					/* Mutex for seek and read */
+  ssize_t		count;		/* Bytes read */
+
+
+  _cupsMutexLock(&mutex);
+
+  if (lseek(fd, offset, SEEK_SET) == offset)
+    count = read(fd, buffer, (unsigned)bytes);
+  else
+    count = -1;
+
+  _cupsMutexUnlock(&mutex);
+
+  return (count);
+
+#else
+  return (pread(fd, buffer, bytes, offset));
+#endif /* _WIN32 */
+}
+
+
+/*
+ * 'put_value()' - Put an unsigned value in network byte order.
+ */
+
+static void
+put_value(ipp_uchar_t        *data,	/* I - Value data */
+          unsigned long long value,	/* I - Value */
+          int                bytes)	/* I - Number of bytes */
+{
+  while (bytes > 0)
+  {
+    bytes --;
+    data[bytes] = (ipp_uchar_t)value;
+    value >>= 8;
+  }
+}
+
+
+/*
+ * 'rewrite_history()' - Rewrite the job history file without expired records.
+ */
+
+static void
+rewrite_history(
+    server_printer_t *printer)		/* I - Printer */
+{
+  char			filename[1024],	/* Job history file */
+			tempfile[1024];	/* Temporary file */
+  int			fd;		/* Temporary file descriptor */
+  ipp_uchar_t		*record = NULL;	/* Record buffer */
+  size_t		recsize = 0;	/* Size of record buffer */
+  off_t			*offsets,	/* New record offsets */
+			offset;		/* Current offset */
+  int			i,		/* Looping var */
+			count;		/* Number of entries */
+  server_hentry_t	*entry;		/* Current entry */
+
+
+  history_filename(printer, filename, sizeof(filename));
+  snprintf(tempfile, sizeof(tempfile), "%s.tmp", filename);
+
+  count = cupsArrayCount(printer->history);
+
+  if ((offsets = calloc((size_t)count + 1, sizeof(off_t))) == NULL)
+    return;
+
+  if ((fd = open(tempfile, O_WRONLY | O_CREAT | O_TRUNC | O_BINARY, 0600)) < 0)
+  {
+    serverLogPrinter(SERVER_LOGLEVEL_ERROR, printer, "Unable to create job history \"%s\": %s", tempfile, strerror(errno));
+    free(offsets);
+    return;
+  }
+
+ /*
+  * Copy the header and the remaining records, oldest first...
+  */
+
+  if ((record = malloc(SERVER_HISTORY_HEADER)) != NULL)
+    recsize = SERVER_HISTORY_HEADER;
+
+  if (!record || pread_history(printer->history_fd, record, SERVER_HISTORY_HEADER, 0) != SERVER_HISTORY_HEADER || write(fd, record, SERVER_HISTORY_HEADER) != SERVER_HISTORY_HEADER)
+    goto error;
+
+  for (i = count - 1, offset = SERVER_HISTORY_HEADER; i >= 0; i --)
+  {
+    entry = (server_hentry_t *)cupsArrayIndex(printer->history, i);
+
+    if (entry->length > recsize)
+    {
+      ipp_uchar_t *temp = realloc(record, entry->length);
+					/* New record buffer */
+
+      if (!temp)
+        goto error;
+
+      record  = temp;
+      recsize = entry->length;
+    }
+
+    if (pread_history(printer->history_fd, record, entry->length, entry->offset) != (ssize_t)entry->length || write(fd, record, entry->length) != (ssize_t)entry->length)
+      goto error;
+
+    offsets[i] = offset;
+    offset     += (off_t)entry->length;
+  }
+
+  if (close(fd))
+  {
+    fd = -1;
+    goto error;
+  }
+
+  if (rename(tempfile, filename))
+  {
+    fd = -1;
+    goto error;
+  }
+
+ /*
+  * Switch to the new file...
+  */
+
+  close(printer->history_fd);
+
+  if ((printer->history_fd = open(filename, O_RDWR | O_APPEND | O_BINARY)) < 0)
+  {
+    serverLogPrinter(SERVER_LOGLEVEL_ERROR, printer, "Unable to open job history \"%s\": %s", filename, strerror(errno));
+    cupsArrayDelete(printer->history);
+    printer->history = NULL;
+  }
+  else
+  {
+    for (i = 0; i < count; i ++)
+      ((server_hentry_t *)cupsArrayIndex(printer->history, i))->offset = offsets[i];
+
+    serverLogPrinter(SERVER_LOGLEVEL_INFO, printer, "Removed %ld bytes of expired jobs from the job history.", (long)printer->history_expired);
+
+    printer->history_size    = offset;
+    printer->history_expired = 0;
+  }
+
+  free(record);
+  free(offsets);
+  return;
+
+ /*
+  * If we get here there was an error writing the new file...
+  */
+
+  error:
+
+  serverLogPrinter(SERVER_LOGLEVEL_ERROR, printer, "Unable to rewrite job history \"%s\": %s", filename, strerror(errno));
+
+  if (fd >= 0)
+    close(fd);
+
+  unlink(tempfile);
+
+  free(record);
+  free(offsets);
+}
@@ -19,6 +19,12 @@
  * Local types...
  */
 
+typedef struct server_wbuffer_s		/**** Memory Write Buffer ****/
+{
+  ipp_uchar_t	*ptr,			/* Current position in buffer */
+		*end;			/* End of buffer */
+} server_wbuffer_t;
+
 typedef struct server_value_s		/**** Value Validation ****/
 {
   const char	*name;			/* Attribute name */
@@ -31,11 +37,49 @@ typedef struct server_value_s		/**** Value Validation ****/
 #define VALUE_1SETOF	1		/* 1setOf syntax */
 #define VALUE_CREATEOP	2		/* Operation attribute for Create-Xxx */
 
+typedef struct server_sniff_s		/**** Incremental Document Analyzer ****/
+{
+  int		type,			/* Document type */
+		state;			/* Raster parser state */
+  unsigned char	header[1796];		/* Raster file/page header */
+  size_t	used,			/* Bytes in header */
+		skip;			/* Bytes of pixel data to skip */
+  unsigned	bpp,			/* Bytes per compressed pixel */
+		width,			/* Pixels per line */
+		x,			/* Current pixel in line */
+		lines;			/* Lines remaining on page */
+  int		pages,			/* Number of pages seen */
+		total;			/* Total number of pages, 0 if unknown */
+  char		token[32];		/* Current PDF token */
+  size_t	toklen;			/* Length of PDF token */
+  int		in_comment,		/* In a PDF comment? */
+		in_stream,		/* In a PDF stream? */
+		match,			/* Characters of "endstream" matched */
+		in_pages,		/* In a /Type /Pages object? */
+		want_count,		/* Last token was /Count? */
+		want_type,		/* Last token was /Type? */
+		count;			/* /Count value in current object */
+} server_sniff_t;
+
+#define SNIFF_NONE	0		/* Unknown document type */
+#define SNIFF_PDF	1		/* PDF document */
+#define SNIFF_PWG	2		/* PWG raster document */
+#define SNIFF_URF	3		/* Apple raster document */
+
+#define SNIFF_FILE	0		/* Reading raster file header */
+#define SNIFF_PAGE	1		/* Reading raster page header */
+#define SNIFF_LINE	2		/* Reading line repeat count */
+#define SNIFF_PACKET	3		/* Reading pixel repeat count */
+#define SNIFF_SKIP	4		/* Skipping pixel data */
+
+#define SNIFF_BE32(p)	((((((unsigned)(p)[0] << 8) | (unsigned)(p)[1]) << 8 | (unsigned)(p)[2]) << 8) | (unsigned)(p)[3])
+
 
 /*
  * Local functions...
  */
 
+static int		append_printer_cache(server_client_t *client, server_printer_t *printer, cups_array_t *ra, const char *key);
 static int		apply_template_attributes(ipp_t *to, ipp_tag_t to_group_tag, server_resource_t *resource, ipp_attribute_t *supported, size_t num_values, server_value_t *values);
 static inline int	check_attribute(const char *name, cups_array_t *ra, cups_array_t *pa)
 {
@@ -43,14 +87,20 @@ static inline int	check_attribute(const char *name, cups_array_t *ra, cups_array
 }
 static void		copy_doc_attributes(server_client_t *client, server_job_t *job, cups_array_t *ra, cups_array_t *pa);
 static int		copy_document_uri(server_client_t *client, server_job_t *job, const char *uri);
-static void		copy_job_attributes(server_client_t *client, server_job_t *job, cups_array_t *ra, cups_array_t *pa);
+static void		copy_job_attributes(server_client_t *client, server_job_t *job, cups_array_t *ra, cups_array_t *pa, _ipp_cfilter_t *filter);
 static void		copy_printer_attributes(server_client_t *client, server_printer_t *printer, cups_array_t *ra);
+static void		copy_printer_cache(server_client_t *client, server_printer_t *printer, cups_array_t *ra);
+static void		copy_printer_values(server_client_t *client, ipp_t *ipp, server_printer_t *printer, cups_array_t *ra);
 static void		copy_printer_state(ipp_t *ipp, server_printer_t *printer, cups_array_t *ra);
+static void		copy_printer_static(ipp_t *ipp, server_printer_t *printer, cups_array_t *ra);
 static void		copy_resource_attributes(server_client_t *client, server_resource_t *resource, cups_array_t *ra);
-static void		copy_subscription_attributes(server_client_t *client, server_subscription_t *sub, cups_array_t *ra, cups_array_t *pa);
+static void		copy_subscription_attributes(server_client_t *client, server_subscription_t *sub, cups_array_t *ra, cups_array_t *pa, _ipp_cfilter_t *filter);
 static void		copy_system_state(ipp_t *ipp, cups_array_t *ra);
+static char		*create_cache_key(cups_array_t *ra);
+static server_pcache_t	*create_printer_cache(server_printer_t *printer, cups_array_t *ra);
 static const char	*detect_format(const unsigned char *header);
-static int		filter_cb(server_filter_t *filter, ipp_t *dst, ipp_attribute_t *attr);
+static server_pcache_t	*find_printer_cache(server_printer_t *printer, cups_array_t *ra, const char *key);
+static off_t		get_document_length(server_client_t *client);
 static const char	*get_document_uri(server_client_t *client);
 static void		ipp_acknowledge_document(server_client_t *client);
 static void		ipp_acknowledge_identify_printer(server_client_t *client);
@@ -126,10 +176,18 @@ static void		ipp_update_output_device_attributes(server_client_t *client);
 static void		ipp_validate_document(server_client_t *client);
 static void		ipp_validate_job(server_client_t *client);
 static void		respond_unsettable(server_client_t *client, ipp_attribute_t *attr);
+static int		sniff_data(server_sniff_t *sniff, const unsigned char *buffer, size_t bytes);
+static int		sniff_init(server_sniff_t *sniff, const char *format);
+static void		sniff_pdf_token(server_sniff_t *sniff);
+static ssize_t		stream_job_data(server_client_t *client, server_job_t *job);
+static void		update_job_size(server_job_t *job, off_t bytes, int impressions);
 static int		valid_doc_attributes(server_client_t *client);
 static int		valid_filename(const char *filename);
+static int		valid_groups(server_client_t *client);
 static int		valid_job_attributes(server_client_t *client);
+static int		valid_request(server_client_t *client);
 static int		valid_values(server_client_t *client, ipp_tag_t group_tag, ipp_attribute_t *supported, size_t num_values, server_value_t *values);
+static ssize_t		write_buffer_cb(server_wbuffer_t *wbuffer, ipp_uchar_t *buffer, size_t bytes);
 static float		wgs84_distance(const char *a, const char *b);
 
 
@@ -433,14 +491,89 @@ serverCopyAttributes(
     ipp_tag_t    group_tag,		/* I - Group to copy */
     int          quickcopy)		/* I - Do a quick copy? */
 {
-  server_filter_t	filter;		/* Filter data */
+  _ippServerCopyAttributes(to, from, ra, pa, group_tag, quickcopy);
+}
+
+
+/*
+ * 'append_printer_cache()' - Append a printer group to the pre-encoded
+ *                            response attributes.
+ *
+ * The dynamic printer attributes are encoded for each call and followed by the
+ * cached static attributes.  Responses with multiple printer groups must use
+ * this function for every group so that the groups stay in order.
+ *
+ * Note: Caller MUST lock the printer object for reading before using.
+ */
+
+static int				/* O - 1 on success, 0 on error */
+append_printer_cache(
+    server_client_t  *client,		/* I - Client */
+    server_printer_t *printer,		/* I - Printer */
+    cups_array_t     *ra,		/* I - Requested attributes */
+    const char       *key)		/* I - Cache key */
+{
+  ipp_t			*ipp;		/* Dynamic attributes */
+  server_pcache_t	*pc;		/* Cache entry */
+  ipp_uchar_t		*data = NULL,	/* Encoded attributes */
+			*cached;	/* New pre-encoded attributes */
+  size_t		length,		/* Length of encoded attributes */
+			pclength;	/* Length of cached attributes */
+  server_wbuffer_t	wbuffer;	/* Write buffer */
+  int			ret = 0;	/* Return value */
+
+
+  ipp = ippNew();
+
+  copy_printer_values(client, ipp, printer, ra);
+
+  _cupsMutexLock(&printer->cache_mutex);
+
+  if ((pc = find_printer_cache(printer, ra, key)) == NULL)
+    copy_printer_static(ipp, printer, ra);
+
+  pclength = pc ? pc->length : 0;
+  length   = ippLength(ipp);
+
+  if ((data = malloc(length)) == NULL)
+    goto finish;
+
+  wbuffer.ptr = data;
+  wbuffer.end = data + length;
+
+  if (ippWriteIO(&wbuffer, (ipp_iocb_t)write_buffer_cb, 1, NULL, ipp) != IPP_STATE_DATA || (length > 9 && data[8] != IPP_TAG_PRINTER))
+    goto finish;
+
+ /*
+  * Skip the message header, leading group tag, and end tag...
+  */
+
+  length = length > 9 ? length - 10 : 0;
+
+  if ((cached = realloc(client->cached_attrs, client->cached_length + length + pclength + 1)) == NULL)
+    goto finish;
+
+  client->cached_attrs = cached;
+  cached += client->cached_length;
+
+  *cached++ = IPP_TAG_PRINTER;
+
+  memcpy(cached, data + 9, length);
 
+  if (pclength > 0)
+    memcpy(cached + length, pc->data, pclength);
 
-  filter.ra        = ra;
-  filter.pa        = pa;
-  filter.group_tag = group_tag;
+  client->cached_length += length + pclength + 1;
+  ret                   = 1;
 
-  ippCopyAttributes(to, from, quickcopy, (ipp_copycb_t)filter_cb, &filter);
+  finish:
+
+  _cupsMutexUnlock(&printer->cache_mutex);
+
+  free(data);
+  ippDelete(ipp);
+
+  return (ret);
 }
 
 
@@ -457,7 +590,6 @@ apply_template_attributes(
     size_t            num_values,	/* I - Number of value definitions */
     server_value_t    *values)		/* I - Value definitions */
 {
-  int			fd;		/* Resource file descriptor */
   ipp_t			*from;		/* Resource attributes */
   ipp_attribute_t	*fromattr,	/* Source attribute */
 			*toattr;	/* Destination attribute */
@@ -468,32 +600,19 @@ apply_template_attributes(
 
 
  /*
-  * Load the resource attributes...
+  * Get the (cached) resource attributes...
   */
 
-  if ((fd = open(template->filename, O_RDONLY | O_BINARY)) < 0)
-  {
-    serverLog(SERVER_LOGLEVEL_ERROR, "Unable to open resource %d file \"%s\": %s", template->id, template->filename, strerror(errno));
-    return (0);
-  }
-
-  from = ippNew();
-
-  if (ippReadFile(fd, from) != IPP_STATE_DATA)
-  {
-    serverLog(SERVER_LOGLEVEL_ERROR, "Unable to read resource %d file \"%s\": %s", template->id, template->filename, cupsLastErrorString());
-    close(fd);
-    ippDelete(from);
+  if ((from = serverGetResourceTemplate(template)) == NULL)
     return (0);
-  }
-
-  close(fd);
 
  /*
-  * Loop through the attributes, validate, and copy as needed...
+  * Loop through the attributes, validate, and copy as needed.  The template
+  * attributes are shared between threads, so walk the list directly rather
+  * than using the ippFirst/NextAttribute iterator...
   */
 
-  for (fromattr = ippFirstAttribute(from); fromattr; fromattr = ippNextAttribute(from))
+  for (fromattr = from->attrs; fromattr; fromattr = fromattr->next)
   {
     name      = ippGetName(fromattr);
     value_tag = ippGetValueTag(fromattr);
@@ -512,18 +631,14 @@ apply_template_attributes(
     }
   }
 
- /*
-  * Clean up...
-  */
-
-  ippDelete(from);
-
   return (1);
 }
 
 
 /*
  * 'copy_doc_attrs()' - Copy document attributes to the response.
+ *
+ * Note: Caller MUST lock the printer object before using.
  */
 
 static void
@@ -535,6 +650,9 @@ copy_doc_attributes(
 {
   const char		*name;		/* Attribute name */
   ipp_attribute_t	*srcattr;	/* Source attribute */
+  ipp_t			*attrs,		/* Job attributes */
+			*doc_attrs;	/* Document attributes */
+  int			temp;		/* Free the attributes? */
 
 
  /*
@@ -568,9 +686,11 @@ copy_doc_attributes(
   *   time-at-xxx
   */
 
-  serverCopyAttributes(client->response, job->doc_attrs, ra, pa, IPP_TAG_DOCUMENT, 0);
+  temp = serverGetJobAttributes(job, &attrs, &doc_attrs);
 
-  for (srcattr = ippFirstAttribute(job->attrs); srcattr; srcattr = ippNextAttribute(job->attrs))
+  serverCopyAttributes(client->response, doc_attrs, ra, pa, IPP_TAG_DOCUMENT, 0);
+
+  for (srcattr = ippFirstAttribute(attrs); srcattr; srcattr = ippNextAttribute(attrs))
   {
     if (ippGetGroupTag(srcattr) != IPP_TAG_JOB || (name = ippGetName(srcattr)) == NULL)
       continue;
@@ -594,6 +714,12 @@ copy_doc_attributes(
       ippAddString(client->response, IPP_TAG_DOCUMENT, IPP_TAG_URI, "document-uuid", NULL, ippGetString(srcattr, 0, NULL));
   }
 
+  if (temp)
+  {
+    ippDelete(attrs);
+    ippDelete(doc_attrs);
+  }
+
   if (check_attribute("date-time-at-completed", ra, pa))
   {
     if (job->completed)
@@ -688,11 +814,14 @@ copy_document_uri(
 
   if (!strcmp(scheme, "file"))
   {
-    int infile;			/* Input file for local file URIs */
+    int		infile;			/* Input file for local file URIs */
+    struct stat	fileinfo;		/* Input file information */
 
     if ((infile = open(resource, O_RDONLY | O_NOFOLLOW | O_BINARY)) < 0)
     {
+      SERVER_SEQ_BEGIN(job->status_seq);
       job->state = IPP_JSTATE_ABORTED;
+      SERVER_SEQ_END(job->status_seq);
 
       serverRespondIPP(client, IPP_STATUS_ERROR_DOCUMENT_ACCESS, "Unable to access URI: %s", strerror(errno));
       return (0);
@@ -720,13 +849,13 @@ copy_document_uri(
     * Create a file for the request data...
     */
 
-    serverCreateJobFilename(job, job->format, filename, sizeof(filename));
-
-    if ((job->fd = open(filename, O_WRONLY | O_CREAT | O_TRUNC | O_BINARY, 0600)) < 0)
+    if ((job->fd = serverCreateJobFile(job, job->format, fstat(infile, &fileinfo) ? 0 : fileinfo.st_size, filename, sizeof(filename))) < 0)
     {
       close(infile);
 
+      SERVER_SEQ_BEGIN(job->status_seq);
       job->state = IPP_JSTATE_ABORTED;
+      SERVER_SEQ_END(job->status_seq);
 
       serverRespondIPP(client, IPP_STATUS_ERROR_INTERNAL, "Unable to create print file: %s", strerror(errno));
       return (0);
@@ -750,7 +879,9 @@ copy_document_uri(
       {
 	int error = errno;		/* Write error */
 
+	SERVER_SEQ_BEGIN(job->status_seq);
 	job->state = IPP_JSTATE_ABORTED;
+	SERVER_SEQ_END(job->status_seq);
 
 	close(job->fd);
 	job->fd = -1;
@@ -775,7 +906,7 @@ copy_document_uri(
 
   for (;;)
   {
-    serverLogJob(SERVER_LOGLEVEL_DEBUG, job, "GET %s", uri);
+    SERVER_LOG_JOB_DEBUG(job, "GET %s", uri);
 
 #ifdef HAVE_SSL
     if (port == 443 || !strcmp(scheme, "https"))
@@ -787,7 +918,9 @@ copy_document_uri(
     if ((http = httpConnect2(hostname, port, NULL, AF_UNSPEC, encryption, 1, 30000, NULL)) == NULL)
     {
       serverRespondIPP(client, IPP_STATUS_ERROR_DOCUMENT_ACCESS, "Unable to connect to %s: %s", hostname, cupsLastErrorString());
+      SERVER_SEQ_BEGIN(job->status_seq);
       job->state = IPP_JSTATE_ABORTED;
+      SERVER_SEQ_END(job->status_seq);
 
       return (0);
     }
@@ -798,7 +931,9 @@ copy_document_uri(
     {
       serverRespondIPP(client, IPP_STATUS_ERROR_DOCUMENT_ACCESS, "Unable to GET URI: %s", strerror(errno));
 
+      SERVER_SEQ_BEGIN(job->status_seq);
       job->state = IPP_JSTATE_ABORTED;
+      SERVER_SEQ_END(job->status_seq);
 
       httpClose(http);
       return (0);
@@ -806,7 +941,7 @@ copy_document_uri(
 
     while ((status = httpUpdate(http)) == HTTP_STATUS_CONTINUE);
 
-    serverLogJob(SERVER_LOGLEVEL_DEBUG, job, "GET returned status %d", status);
+    SERVER_LOG_JOB_DEBUG(job, "GET returned status %d", status);
 
     if (status == HTTP_STATUS_MOVED_PERMANENTLY || status == HTTP_STATUS_FOUND || status == HTTP_STATUS_SEE_OTHER)
     {
@@ -822,7 +957,9 @@ copy_document_uri(
       {
 	serverRespondIPP(client, IPP_STATUS_ERROR_DOCUMENT_ACCESS, "Redirected to bad URI \"%s\": %s", redirect, httpURIStatusString(uri_status));
 
+	SERVER_SEQ_BEGIN(job->status_seq);
 	job->state = IPP_JSTATE_ABORTED;
+	SERVER_SEQ_END(job->status_seq);
 
 	return (0);
       }
@@ -835,7 +972,9 @@ copy_document_uri(
       {
 	serverRespondIPP(client, IPP_STATUS_ERROR_DOCUMENT_ACCESS, "Redirected to unsupported URI scheme \"%s\".", scheme);
 
+	SERVER_SEQ_BEGIN(job->status_seq);
 	job->state = IPP_JSTATE_ABORTED;
+	SERVER_SEQ_END(job->status_seq);
 
 	return (0);
       }
@@ -848,7 +987,9 @@ copy_document_uri(
     {
       serverRespondIPP(client, IPP_STATUS_ERROR_DOCUMENT_ACCESS, "Unable to GET URI: %s", httpStatus(status));
 
+      SERVER_SEQ_BEGIN(job->status_seq);
       job->state = IPP_JSTATE_ABORTED;
+      SERVER_SEQ_END(job->status_seq);
 
       httpClose(http);
 
@@ -875,11 +1016,11 @@ copy_document_uri(
     else
       content_type = job->format;
 
-    serverCreateJobFilename(job, content_type, filename, sizeof(filename));
-
-    if ((job->fd = open(filename, O_WRONLY | O_CREAT | O_TRUNC | O_BINARY, 0600)) < 0)
+    if ((job->fd = serverCreateJobFile(job, content_type, httpGetField(http, HTTP_FIELD_CONTENT_LENGTH)[0] ? httpGetLength2(http) : 0, filename, sizeof(filename))) < 0)
     {
+      SERVER_SEQ_BEGIN(job->status_seq);
       job->state = IPP_JSTATE_ABORTED;
+      SERVER_SEQ_END(job->status_seq);
 
       httpClose(http);
 
@@ -894,7 +1035,9 @@ copy_document_uri(
       {
 	int error = errno;		/* Write error */
 
+	SERVER_SEQ_BEGIN(job->status_seq);
 	job->state = IPP_JSTATE_ABORTED;
+	SERVER_SEQ_END(job->status_seq);
 
 	close(job->fd);
 	job->fd = -1;
@@ -917,12 +1060,15 @@ copy_document_uri(
 
   finalize_copy:
 
-  if (close(job->fd))
+  if (serverCloseSpoolFile(job->fd, filename))
   {
     serverRespondIPP(client, IPP_STATUS_ERROR_INTERNAL, "Unable to write print file: %s", strerror(errno));
 
+    SERVER_SEQ_BEGIN(job->status_seq);
     job->state = IPP_JSTATE_ABORTED;
-    job->fd    = -1;
+    SERVER_SEQ_END(job->status_seq);
+
+    job->fd = -1;
 
     unlink(filename);
 
@@ -938,6 +1084,8 @@ copy_document_uri(
 
 /*
  * 'copy_job_attrs()' - Copy job attributes to the response.
+ *
+ * Note: Caller MUST lock the printer object before using.
  */
 
 static void
@@ -945,9 +1093,25 @@ copy_job_attributes(
     server_client_t *client,		/* I - Client */
     server_job_t    *job,		/* I - Job */
     cups_array_t    *ra,		/* I - requested-attributes */
-    cups_array_t    *pa)		/* I - Private attributes */
+    cups_array_t    *pa,		/* I - Private attributes */
+    _ipp_cfilter_t  *filter)		/* I - Compiled "ra" and "pa" filter or `NULL` */
 {
-  serverCopyAttributes(client->response, job->attrs, ra, pa, IPP_TAG_JOB, 0);
+  server_jstatus_t	status;		/* Job status */
+  ipp_t			*attrs;		/* Job attributes */
+  int			temp;		/* Free the attributes? */
+
+
+  temp = serverGetJobAttributes(job, &attrs, NULL);
+
+  if (filter)
+    _ippServerCopyFilteredAttributes(client->response, attrs, filter, 0);
+  else
+    serverCopyAttributes(client->response, attrs, ra, pa, IPP_TAG_JOB, 0);
+
+  if (temp)
+    ippDelete(attrs);
+
+  serverGetJobStatus(job, &status);
 
   if (check_attribute("date-time-at-completed", ra, pa))
   {
@@ -969,13 +1133,13 @@ copy_job_attributes(
     ippAddInteger(client->response, IPP_TAG_JOB, IPP_TAG_INTEGER, "job-impressions", job->impressions);
 
   if (check_attribute("job-impressions-completed", ra, pa))
-    ippAddInteger(client->response, IPP_TAG_JOB, IPP_TAG_INTEGER, "job-impressions-completed", job->impcompleted);
+    ippAddInteger(client->response, IPP_TAG_JOB, IPP_TAG_INTEGER, "job-impressions-completed", status.impcompleted);
 
   if (check_attribute("job-printer-up-time", ra, pa))
     ippAddInteger(client->response, IPP_TAG_JOB, IPP_TAG_INTEGER, "job-printer-up-time", (int)(time(NULL) - client->printer->start_time));
 
   if (check_attribute("job-state", ra, pa))
-    ippAddInteger(client->response, IPP_TAG_JOB, IPP_TAG_ENUM, "job-state", job->state);
+    ippAddInteger(client->response, IPP_TAG_JOB, IPP_TAG_ENUM, "job-state", status.state);
 
   if (check_attribute("job-state-message", ra, pa))
   {
@@ -987,14 +1151,14 @@ copy_job_attributes(
     {
       const char *message = "";		/* Message string */
 
-      switch (job->state)
+      switch (status.state)
       {
 	case IPP_JSTATE_PENDING :
 	    message = "Job pending.";
 	    break;
 
 	case IPP_JSTATE_HELD :
-	    if (job->state_reasons & SERVER_JREASON_JOB_INCOMING)
+	    if (status.state_reasons & SERVER_JREASON_JOB_INCOMING)
 	      message = "Job incoming.";
 	    else if (ippFindAttribute(job->attrs, "job-hold-until", IPP_TAG_ZERO))
 	      message = "Job held.";
@@ -1003,9 +1167,9 @@ copy_job_attributes(
 	    break;
 
 	case IPP_JSTATE_PROCESSING :
-	    if (job->state_reasons & SERVER_JREASON_PROCESSING_TO_STOP_POINT)
+	    if (status.state_reasons & SERVER_JREASON_PROCESSING_TO_STOP_POINT)
 	    {
-	      if (job->cancel)
+	      if (status.cancel)
 		message = "Cancel in progress.";
 	      else
 	        message = "Abort in progress.";
@@ -1059,31 +1223,120 @@ copy_printer_attributes(
     server_printer_t *printer,		/* I - Printer */
     cups_array_t     *ra)		/* I - Requested attributes */
 {
-  serverCopyAttributes(client->response, printer->pinfo.attrs, ra, NULL, IPP_TAG_ZERO, IPP_TAG_ZERO);
-  serverCopyAttributes(client->response, printer->dev_attrs, ra, NULL, IPP_TAG_ZERO, IPP_TAG_ZERO);
-  serverCopyAttributes(client->response, PrivacyAttributes, ra, NULL, IPP_TAG_ZERO, IPP_TAG_CUPS_CONST);
+  copy_printer_static(client->response, printer, ra);
+  copy_printer_values(client, client->response, printer, ra);
+}
+
+
+/*
+ * 'copy_printer_cache()' - Copy cached printer attributes.
+ *
+ * The static printer, device, and privacy attributes are encoded once per
+ * requested-attributes set and appended to the response by
+ * serverRespondHTTP().  The cache is cleared whenever those attributes change.
+ *
+ * Note: Caller MUST lock the printer object for reading before using.
+ */
+
+static void
+copy_printer_cache(
+    server_client_t  *client,		/* I - Client */
+    server_printer_t *printer,		/* I - Printer */
+    cups_array_t     *ra)		/* I - Requested attributes */
+{
+  char			*key;		/* Cache key */
+  server_pcache_t	*pc = NULL;	/* Cache entry */
+  ipp_attribute_t	*attr;		/* Current response attribute */
+  ipp_tag_t		group_tag;	/* Last group in response */
+
+
+ /*
+  * Find or create the cache entry...
+  */
+
+  key = create_cache_key(ra);
+
+  _cupsMutexLock(&printer->cache_mutex);
+
+  if (key)
+  {
+    pc = find_printer_cache(printer, ra, key);
+    free(key);
+  }
+
+  if (!pc)
+  {
+   /*
+    * Unable to cache, copy the attributes directly...
+    */
+
+    _cupsMutexUnlock(&printer->cache_mutex);
+
+    copy_printer_static(client->response, printer, ra);
+    return;
+  }
+
+ /*
+  * Copy the encoded attributes for the response, starting a new printer group
+  * as needed...
+  */
+
+  if (pc->length > 0)
+  {
+    for (group_tag = IPP_TAG_ZERO, attr = ippFirstAttribute(client->response); attr; attr = ippNextAttribute(client->response))
+      group_tag = ippGetGroupTag(attr);
+
+    if ((client->cached_attrs = malloc(pc->length + 1)) == NULL)
+    {
+      _cupsMutexUnlock(&printer->cache_mutex);
+
+      copy_printer_static(client->response, printer, ra);
+      return;
+    }
+
+    if (group_tag != IPP_TAG_PRINTER)
+      client->cached_attrs[client->cached_length ++] = IPP_TAG_PRINTER;
+
+    memcpy(client->cached_attrs + client->cached_length, pc->data, pc->length);
+    client->cached_length += pc->length;
+  }
+
+  _cupsMutexUnlock(&printer->cache_mutex);
+}
+
+
+/*
+ * 'copy_printer_values()' - Copy the dynamic printer attributes.
+ */
 
+static void
+copy_printer_values(
+    server_client_t  *client,		/* I - Client */
+    ipp_t            *ipp,		/* I - Response attributes */
+    server_printer_t *printer,		/* I - Printer */
+    cups_array_t     *ra)		/* I - Requested attributes */
+{
   if (!ra || cupsArrayFind(ra, "printer-config-change-date-time"))
-    ippAddDate(client->response, IPP_TAG_PRINTER, "printer-config-change-date-time", ippTimeToDate(printer->config_time));
+    ippAddDate(ipp, IPP_TAG_PRINTER, "printer-config-change-date-time", ippTimeToDate(printer->config_time));
 
   if (!ra || cupsArrayFind(ra, "printer-config-change-time"))
-    ippAddInteger(client->response, IPP_TAG_PRINTER, IPP_TAG_INTEGER, "printer-config-change-time", (int)(printer->config_time - printer->start_time));
+    ippAddInteger(ipp, IPP_TAG_PRINTER, IPP_TAG_INTEGER, "printer-config-change-time", (int)(printer->config_time - printer->start_time));
 
   if (!ra || cupsArrayFind(ra, "printer-current-time"))
-    ippAddDate(client->response, IPP_TAG_PRINTER, "printer-current-time", ippTimeToDate(time(NULL)));
+    ippAddDate(ipp, IPP_TAG_PRINTER, "printer-current-time", ippTimeToDate(time(NULL)));
 
   if (!ra || cupsArrayFind(ra, "printer-dns-sd-name"))
   {
     if (printer->dns_sd_name)
-      ippAddString(client->response, IPP_TAG_PRINTER, IPP_TAG_NAME, "printer-dns-sd-name", NULL, printer->dns_sd_name);
+      ippAddString(ipp, IPP_TAG_PRINTER, IPP_TAG_NAME, "printer-dns-sd-name", NULL, printer->dns_sd_name);
     else
-      ippAddOutOfBand(client->response, IPP_TAG_PRINTER, IPP_TAG_NOVALUE, "printer-dns-sd-name");
+      ippAddOutOfBand(ipp, IPP_TAG_PRINTER, IPP_TAG_NOVALUE, "printer-dns-sd-name");
   }
 
-  copy_printer_state(client->response, printer, ra);
+  copy_printer_state(ipp, printer, ra);
 
-  if (printer->num_resources && (!ra || cupsArrayFind(ra, "printer-resource-ids")))
-    ippAddIntegers(client->response, IPP_TAG_PRINTER, IPP_TAG_INTEGER, "printer-resource-ids", printer->num_resources, printer->resources);
+  if (printer->resources.num_ids && (!ra || cupsArrayFind(ra, "printer-resource-ids")))
+    ippAddIntegers(ipp, IPP_TAG_PRINTER, IPP_TAG_INTEGER, "printer-resource-ids", printer->resources.num_ids, printer->resources.ids);
 
   if (printer->pinfo.strings && (!ra || cupsArrayFind(ra, "printer-strings-uri")))
   {
@@ -1123,15 +1376,15 @@ copy_printer_attributes(
 #endif /* HAVE_SSL */
 
       httpAssembleURI(HTTP_URI_CODING_ALL, uri, sizeof(uri), scheme, NULL, lis->host, lis->port, match->resource->resource);
-      ippAddString(client->response, IPP_TAG_PRINTER, IPP_TAG_URI, "printer-strings-uri", NULL, uri);
+      ippAddString(ipp, IPP_TAG_PRINTER, IPP_TAG_URI, "printer-strings-uri", NULL, uri);
     }
   }
 
   if (!ra || cupsArrayFind(ra, "printer-up-time"))
-    ippAddInteger(client->response, IPP_TAG_PRINTER, IPP_TAG_INTEGER, "printer-up-time", (int)(time(NULL) - printer->start_time));
+    ippAddInteger(ipp, IPP_TAG_PRINTER, IPP_TAG_INTEGER, "printer-up-time", (int)(time(NULL) - printer->start_time));
 
   if (!ra || cupsArrayFind(ra, "queued-job-count"))
-    ippAddInteger(client->response, IPP_TAG_PRINTER, IPP_TAG_INTEGER, "queued-job-count", cupsArrayCount(printer->active_jobs));
+    ippAddInteger(ipp, IPP_TAG_PRINTER, IPP_TAG_INTEGER, "queued-job-count", cupsArrayCount(printer->active_jobs));
 }
 
 
@@ -1172,6 +1425,22 @@ copy_printer_state(
 }
 
 
+/*
+ * 'copy_printer_static()' - Copy the static printer attributes.
+ */
+
+static void
+copy_printer_static(
+    ipp_t            *ipp,		/* I - Destination IPP message */
+    server_printer_t *printer,		/* I - Printer */
+    cups_array_t     *ra)		/* I - Requested attributes */
+{
+  serverCopyAttributes(ipp, printer->pinfo.attrs, ra, NULL, IPP_TAG_ZERO, IPP_TAG_ZERO);
+  serverCopyAttributes(ipp, printer->dev_attrs, ra, NULL, IPP_TAG_ZERO, IPP_TAG_ZERO);
+  serverCopyAttributes(ipp, PrivacyAttributes, ra, NULL, IPP_TAG_ZERO, IPP_TAG_CUPS_CONST);
+}
+
+
 /*
  * 'copy_resource_attributes()' - Copy the attributes for a resource.
  */
@@ -1213,9 +1482,13 @@ copy_subscription_attributes(
     server_client_t       *client,	/* I - Client */
     server_subscription_t *sub,		/* I - Subscription */
     cups_array_t          *ra,		/* I - requested-attributes */
-    cups_array_t          *pa)		/* I - Private attributes */
+    cups_array_t          *pa,		/* I - Private attributes */
+    _ipp_cfilter_t        *filter)	/* I - Compiled "ra" and "pa" filter or `NULL` */
 {
-  serverCopyAttributes(client->response, sub->attrs, ra, pa, IPP_TAG_SUBSCRIPTION, 0);
+  if (filter)
+    _ippServerCopyFilteredAttributes(client->response, sub->attrs, filter, 0);
+  else
+    serverCopyAttributes(client->response, sub->attrs, ra, pa, IPP_TAG_SUBSCRIPTION, 0);
 
   if (!sub->job && check_attribute("notify-lease-expiration-time", ra, pa))
     ippAddInteger(client->response, IPP_TAG_SUBSCRIPTION, IPP_TAG_INTEGER, "notify-lease-expiration-time", (int)(sub->expire - client->printer->start_time));
@@ -1308,6 +1581,107 @@ copy_system_state(ipp_t        *ipp,	/* I - IPP message */
 }
 
 
+/*
+ * 'create_cache_key()' - Create a printer cache key for the requested
+ *                        attributes.
+ */
+
+static char *				/* O - Cache key or `NULL` on error */
+create_cache_key(cups_array_t *ra)	/* I - Requested attributes */
+{
+  char			*key,		/* Cache key */
+			*keyptr;	/* Pointer into key */
+  size_t		keysize,	/* Size of key */
+			namelen;	/* Length of name */
+  const char		*name;		/* Current requested attribute */
+
+
+  if (!ra)
+    return (strdup("all"));
+
+ /*
+  * Build the cache key from the (sorted) requested attributes...
+  */
+
+  for (keysize = 1, name = (const char *)cupsArrayFirst(ra); name; name = (const char *)cupsArrayNext(ra))
+    keysize += strlen(name) + 1;
+
+  if ((key = malloc(keysize)) == NULL)
+    return (NULL);
+
+  for (keyptr = key, name = (const char *)cupsArrayFirst(ra); name; name = (const char *)cupsArrayNext(ra))
+  {
+    namelen = strlen(name);
+    memcpy(keyptr, name, namelen);
+    keyptr += namelen;
+    *keyptr++ = ',';
+  }
+
+  *keyptr = '\0';
+
+  return (key);
+}
+
+
+/*
+ * 'create_printer_cache()' - Encode the static printer attributes for the
+ *                            cache.
+ */
+
+static server_pcache_t *		/* O - New cache entry or NULL on error */
+create_printer_cache(
+    server_printer_t *printer,		/* I - Printer */
+    cups_array_t     *ra)		/* I - Requested attributes */
+{
+  server_pcache_t	*pc;		/* Cache entry */
+  ipp_t			*ipp;		/* Attributes to encode */
+  size_t		length;		/* Length of encoded attributes */
+  server_wbuffer_t	wbuffer;	/* Write buffer */
+
+
+  if ((pc = calloc(1, sizeof(server_pcache_t))) == NULL)
+    return (NULL);
+
+  ipp = ippNew();
+
+  copy_printer_static(ipp, printer, ra);
+
+  length = ippLength(ipp);
+
+  if ((pc->data = malloc(length)) == NULL)
+  {
+    ippDelete(ipp);
+    free(pc);
+    return (NULL);
+  }
+
+  wbuffer.ptr = pc->data;
+  wbuffer.end = pc->data + length;
+
+  if (ippWriteIO(&wbuffer, (ipp_iocb_t)write_buffer_cb, 1, NULL, ipp) != IPP_STATE_DATA || (length > 9 && pc->data[8] != IPP_TAG_PRINTER))
+  {
+    ippDelete(ipp);
+    free(pc->data);
+    free(pc);
+    return (NULL);
+  }
+
+  ippDelete(ipp);
+
+ /*
+  * Strip the message header, leading group tag, and end tag...
+  */
+
+  if (length > 9)
+  {
+    pc->length = length - 10;
+    memmove(pc->data, pc->data + 9, pc->length);
+  }
+
+  return (pc);
+}
+
+
 /*
  * 'detect_format()' - Auto-detect the file format from the initial header
  *                     bytes.
@@ -1335,32 +1709,79 @@ detect_format(
 
 
 /*
- * 'filter_cb()' - Filter printer attributes based on the requested array.
+ * 'find_printer_cache()' - Find or create the cache entry for a set of
+ *                          requested attributes.
+ *
+ * The oldest entry is discarded when the cache is full.  The printer's cache
+ * mutex must be held.
  */
 
-static int				/* O - 1 to copy, 0 to ignore */
-filter_cb(server_filter_t   *filter,	/* I - Filter parameters */
-          ipp_t           *dst,		/* I - Destination (unused) */
-	  ipp_attribute_t *attr)	/* I - Source attribute */
+static server_pcache_t *		/* O - Cache entry or `NULL` on error */
+find_printer_cache(
+    server_printer_t *printer,		/* I - Printer */
+    cups_array_t     *ra,		/* I - Requested attributes */
+    const char       *key)		/* I - Cache key */
 {
- /*
-  * Filter attributes as needed...
-  */
+  server_pcache_t	*pc;		/* Cache entry */
 
-#ifndef _WIN32 /* Avoid MS compiler bug */
-  (void)dst;
-#endif /* !_WIN32 */
 
-  ipp_tag_t group = ippGetGroupTag(attr);
-  const char *name = ippGetName(attr);
+  for (pc = (server_pcache_t *)cupsArrayFirst(printer->cache); pc; pc = (server_pcache_t *)cupsArrayNext(printer->cache))
+    if (!strcmp(pc->key, key))
+      return (pc);
 
-  if ((filter->group_tag != IPP_TAG_ZERO && group != filter->group_tag && group != IPP_TAG_ZERO) || !name || (!strcmp(name, "media-col-database") && !cupsArrayFind(filter->ra, (void *)name)))
-    return (0);
+  if ((pc = create_printer_cache(printer, ra)) == NULL)
+    return (NULL);
+
+  if ((pc->key = strdup(key)) == NULL)
+  {
+    free(pc->data);
+    free(pc);
+    return (NULL);
+  }
+
+  if (!printer->cache)
+    printer->cache = cupsArrayNew(NULL, NULL);
+
+  if (cupsArrayCount(printer->cache) >= SERVER_PCACHE_MAX)
+  {
+    server_pcache_t *oldest = (server_pcache_t *)cupsArrayFirst(printer->cache);
+					/* Oldest cache entry */
+
+    cupsArrayRemove(printer->cache, oldest);
+    free(oldest->key);
+    free(oldest->data);
+    free(oldest);
+  }
+
+  cupsArrayAdd(printer->cache, pc);
+
+  SERVER_LOG_PRINTER_DEBUG(printer, "Cached %d bytes of printer attributes for \"%s\".", (int)pc->length, pc->key);
+
+  return (pc);
+}
+
+
+/*
+ * 'get_document_length()' - Get the expected length of the document data in a
+ *                           request.
+ *
+ * The Content-Length is used when known, otherwise the client-supplied
+ * "job-k-octets" value.
+ */
+
+static off_t				/* O - Length in bytes or 0 if unknown */
+get_document_length(
+    server_client_t *client)		/* I - Client */
+{
+  ipp_attribute_t	*attr;		/* job-k-octets attribute */
 
-  if (filter->pa && cupsArrayFind(filter->pa, (void *)name))
-    return (0);
 
-  return (!filter->ra || cupsArrayFind(filter->ra, (void *)name) != NULL);
+  if (!httpIsChunked(client->http))
+    return ((off_t)httpGetRemaining(client->http));
+  else if ((attr = ippFindAttribute(client->request, "job-k-octets", IPP_TAG_INTEGER)) != NULL)
+    return ((off_t)ippGetInteger(attr, 0) * 1024);
+  else
+    return (0);
 }
 
 
@@ -1611,9 +2032,16 @@ ipp_acknowledge_job(
   }
 
   if (!job->dev_uuid)
-    job->dev_uuid = strdup(device->uuid);
+  {
+    _cupsRWLockWrite(&client->printer->rwlock);
+    if ((job->dev_uuid = strdup(device->uuid)) != NULL)
+      cupsArrayAdd(device->jobs, job);
+    _cupsRWUnlock(&client->printer->rwlock);
+  }
 
+  SERVER_SEQ_BEGIN(job->status_seq);
   job->state_reasons &= (server_jreason_t)~SERVER_JREASON_JOB_FETCHABLE;
+  SERVER_SEQ_END(job->status_seq);
 
   serverAddEventNoLock(client->printer, job, NULL, SERVER_EVENT_JOB_STATE_CHANGED, "Job acknowledged.");
 
@@ -1769,15 +2197,18 @@ ipp_cancel_current_job(
 
   if (job->state == IPP_JSTATE_PROCESSING || (job->state == IPP_JSTATE_HELD && job->fd >= 0))
   {
+    SERVER_SEQ_BEGIN(job->status_seq);
     job->cancel = 1;
+    SERVER_SEQ_END(job->status_seq);
 
     if (job->state == IPP_JSTATE_PROCESSING)
       serverStopJob(job);
   }
   else
   {
-    job->state     = IPP_JSTATE_CANCELED;
-    job->completed = time(NULL);
+    _cupsRWLockWrite(&job->rwlock);
+    serverCompleteJobNoLock(job, IPP_JSTATE_CANCELED);
+    _cupsRWUnlock(&job->rwlock);
   }
 
   _cupsRWUnlock(&(client->printer->rwlock));
@@ -1867,15 +2298,18 @@ ipp_cancel_document(
 	if (job->state == IPP_JSTATE_PROCESSING ||
 	    (job->state == IPP_JSTATE_HELD && job->fd >= 0))
         {
+          SERVER_SEQ_BEGIN(job->status_seq);
           job->cancel = 1;
+          SERVER_SEQ_END(job->status_seq);
 
           if (job->state == IPP_JSTATE_PROCESSING)
 	    serverStopJob(job);
 	}
 	else
 	{
-	  job->state     = IPP_JSTATE_CANCELED;
-	  job->completed = time(NULL);
+	  _cupsRWLockWrite(&job->rwlock);
+	  serverCompleteJobNoLock(job, IPP_JSTATE_CANCELED);
+	  _cupsRWUnlock(&job->rwlock);
 	}
 
 	_cupsRWUnlock(&(client->printer->rwlock));
@@ -1952,15 +2386,18 @@ ipp_cancel_job(server_client_t *client)	/* I - Client */
 	if (job->state == IPP_JSTATE_PROCESSING ||
 	    (job->state == IPP_JSTATE_HELD && job->fd >= 0))
         {
+          SERVER_SEQ_BEGIN(job->status_seq);
           job->cancel = 1;
+          SERVER_SEQ_END(job->status_seq);
 
           if (job->state == IPP_JSTATE_PROCESSING)
 	    serverStopJob(job);
 	}
 	else
 	{
-	  job->state     = IPP_JSTATE_CANCELED;
-	  job->completed = time(NULL);
+	  _cupsRWLockWrite(&job->rwlock);
+	  serverCompleteJobNoLock(job, IPP_JSTATE_CANCELED);
+	  _cupsRWUnlock(&job->rwlock);
 	}
 
 	_cupsRWUnlock(&(client->printer->rwlock));
@@ -2039,7 +2476,7 @@ ipp_cancel_jobs(
   }
   else
   {
-    serverLogClient(SERVER_LOGLEVEL_DEBUG, client, "Cancel-My-Jobs username='%s'", username);
+    SERVER_LOG_CLIENT_DEBUG(client, "Cancel-My-Jobs username='%s'", username);
   }
 
  /*
@@ -2052,7 +2489,7 @@ ipp_cancel_jobs(
   * OK, cancel jobs on this printer...
   */
 
-  _cupsRWLockRead(&(client->printer->rwlock));
+  _cupsRWLockWrite(&(client->printer->rwlock));
 
   to_cancel = cupsArrayNew(NULL, NULL);
 
@@ -2134,14 +2571,17 @@ ipp_cancel_jobs(
     {
       if (job->state == IPP_JSTATE_PROCESSING || (job->state == IPP_JSTATE_HELD && job->fd >= 0))
       {
+	SERVER_SEQ_BEGIN(job->status_seq);
 	job->cancel = 1;
+	SERVER_SEQ_END(job->status_seq);
 
 	serverStopJob(job);
       }
       else
       {
-	job->state     = IPP_JSTATE_CANCELED;
-	job->completed = time(NULL);
+	_cupsRWLockWrite(&job->rwlock);
+	serverCompleteJobNoLock(job, IPP_JSTATE_CANCELED);
+	_cupsRWUnlock(&job->rwlock);
       }
 
       serverAddEventNoLock(client->printer, job, NULL, SERVER_EVENT_JOB_COMPLETED, NULL);
@@ -2425,7 +2865,9 @@ ipp_create_job(server_client_t *client)	/* I - Client */
   cupsArrayAdd(ra, "job-state-reasons");
   cupsArrayAdd(ra, "job-uri");
 
-  copy_job_attributes(client, job, ra, NULL);
+  _cupsRWLockRead(&(job->printer->rwlock));
+  copy_job_attributes(client, job, ra, NULL, NULL);
+  _cupsRWUnlock(&(job->printer->rwlock));
   cupsArrayDelete(ra);
 
  /*
@@ -2691,7 +3133,7 @@ ipp_create_printer(
     }
   }
 
-  if ((client->printer = serverCreatePrinter(path, name, printer_name, &pinfo, 1)) == NULL)
+  if ((client->printer = serverCreatePrinter(path, name, printer_name, &pinfo, 1, 1)) == NULL)
   {
     serverRespondIPP(client, IPP_STATUS_ERROR_INTERNAL, "Unable to create printer.");
     return;
@@ -3159,7 +3601,7 @@ ipp_deallocate_printer_resources(
   server_printer_t	*printer = client->printer;
 					/* Printer */
   ipp_attribute_t	*resource_ids;	/* resource-ids attribute */
-  int			i, j,		/* Looping vars */
+  int			i,		/* Looping var */
 			count,		/* Number of values */
 			resource_id;	/* Current resource ID */
   server_resource_t	*resource;	/* Current resource */
@@ -3212,13 +3654,7 @@ ipp_deallocate_printer_resources(
     resource_id = ippGetInteger(resource_ids, i);
     resource    = serverFindResourceById(resource_id);
 
-    for (j = 0; j < printer->num_resources; j ++)
-    {
-      if (printer->resources[j] == resource_id)
-	break;
-    }
-
-    if (!resource || j >= printer->num_resources)
+    if (!resource || !serverHasResourceId(&printer->resources, resource_id))
     {
       serverRespondIPP(client, IPP_STATUS_ERROR_ATTRIBUTES_OR_VALUES, "Resource #%d is not allocated to the printer.", resource_id);
       serverRespondUnsupported(client, resource_ids);
@@ -3255,6 +3691,8 @@ ipp_delete_printer(
 {
   server_job_t		*job;		/* Current job */
   server_subscription_t	*sub;		/* Current subscription */
+  cups_array_iter_t	iter;		/* Subscription iterator */
+  int			delete_now;	/* Free the printer now? */
 
 
   if (Authentication)
@@ -3278,16 +3716,22 @@ ipp_delete_printer(
 
   _cupsRWLockWrite(&PrintersRWLock);
 
-  serverLogPrinter(SERVER_LOGLEVEL_DEBUG, client->printer, "Removing printer %d from printers list.", client->printer->id);
+  SERVER_LOG_PRINTER_DEBUG(client->printer, "Removing printer %d from printers list.", client->printer->id);
 
   cupsArrayRemove(Printers, client->printer);
 
+  serverPublishPrinters();
+
   client->printer->is_deleted = 1;
 
-  if (client->printer->processing_job)
+  serverMarkPrinterDeleted(client->printer);
+
+  delete_now = client->printer->processing_job == NULL;
+
+  if (!delete_now)
   {
     client->printer->state_reasons |= SERVER_PREASON_MOVING_TO_PAUSED | SERVER_PREASON_DELETING;
-    serverStopJob(client->printer->processing_job);
+    serverStopPrinterJobs(client->printer);
 
     serverAddEventNoLock(client->printer, NULL, NULL, SERVER_EVENT_PRINTER_STATE_CHANGED, "Printer being deleted.");
   }
@@ -3297,8 +3741,6 @@ ipp_delete_printer(
     client->printer->state_reasons |= SERVER_PREASON_DELETING;
 
     serverAddEventNoLock(client->printer, NULL, NULL, SERVER_EVENT_PRINTER_DELETED, "Printer deleted.");
-
-    serverDeletePrinter(client->printer);
   }
 
  /*
@@ -3311,7 +3753,10 @@ ipp_delete_printer(
   {
     if (job->state == IPP_JSTATE_PENDING || job->state == IPP_JSTATE_HELD)
     {
+      SERVER_SEQ_BEGIN(job->status_seq);
       job->state = IPP_JSTATE_ABORTED;
+      SERVER_SEQ_END(job->status_seq);
+
       serverAddEventNoLock(job->printer, job, NULL, SERVER_EVENT_JOB_COMPLETED, "Job aborted because printer has been deleted.");
     }
   }
@@ -3324,7 +3769,9 @@ ipp_delete_printer(
 
   _cupsRWLockRead(&SubscriptionsRWLock);
 
-  for (sub = (server_subscription_t *)cupsArrayFirst(Subscriptions); sub; sub = (server_subscription_t *)cupsArrayNext(Subscriptions))
+  cupsArrayIterInit(&iter, Subscriptions);
+
+  for (sub = (server_subscription_t *)cupsArrayIterNext(&iter); sub; sub = (server_subscription_t *)cupsArrayIterNext(&iter))
   {
     if (sub->printer == client->printer || (sub->job && sub->job->printer == client->printer))
     {
@@ -3336,6 +3783,16 @@ ipp_delete_printer(
 
   _cupsRWUnlock(&SubscriptionsRWLock);
 
+ /*
+  * Free the printer now if it isn't processing a job...
+  */
+
+  if (delete_now)
+  {
+    serverDeletePrinter(client->printer);
+    client->printer = NULL;
+  }
+
   serverRespondIPP(client, IPP_STATUS_OK, NULL);
 
   _cupsRWUnlock(&PrintersRWLock);
@@ -3390,6 +3847,7 @@ ipp_deregister_output_device(
 
   cupsArrayRemove(client->printer->pinfo.devices, device);
 
+  serverAssignJobsNoLock(client->printer);
   serverUpdateDeviceAttributesNoLock(client->printer);
   serverUpdateDeviceStateNoLock(client->printer);
 
@@ -3435,12 +3893,12 @@ ipp_disable_all_printers(
     }
   }
 
-  _cupsRWLockRead(&SystemRWLock);
+  _cupsRWLockRead(&PrintersRWLock);
 
   for (printer = (server_printer_t *)cupsArrayFirst(Printers); printer; printer = (server_printer_t *)cupsArrayNext(Printers))
     serverDisablePrinter(printer);
 
-  _cupsRWUnlock(&SystemRWLock);
+  _cupsRWUnlock(&PrintersRWLock);
 
   serverRespondIPP(client, IPP_STATUS_OK, NULL);
 }
@@ -3509,12 +3967,12 @@ ipp_enable_all_printers(
     }
   }
 
-  _cupsRWLockRead(&SystemRWLock);
+  _cupsRWLockRead(&PrintersRWLock);
 
   for (printer = (server_printer_t *)cupsArrayFirst(Printers); printer; printer = (server_printer_t *)cupsArrayNext(Printers))
     serverEnablePrinter(printer);
 
-  _cupsRWUnlock(&SystemRWLock);
+  _cupsRWUnlock(&PrintersRWLock);
 
   serverRespondIPP(client, IPP_STATUS_OK, NULL);
 }
@@ -3567,6 +4025,7 @@ ipp_fetch_document(
   int			compression;	/* compression */
   char			filename[1024];	/* Job filename */
   const char		*format = NULL;	/* document-format */
+  struct stat		fileinfo;	/* Document file information */
 
 
   if (Authentication)
@@ -3655,7 +4114,7 @@ ipp_fetch_document(
       if (httpWriteResponse(client->http, HTTP_STATUS_OK) < 0)
 	return;
 
-      serverLogClient(SERVER_LOGLEVEL_DEBUG, client, "ipp_fetch_document: Sending %d bytes of IPP response.", (int)ippLength(client->response));
+      SERVER_LOG_CLIENT_DEBUG(client, "ipp_fetch_document: Sending %d bytes of IPP response.", (int)ippLength(client->response));
 
       ippSetState(client->response, IPP_STATE_IDLE);
 
@@ -3665,18 +4124,24 @@ ipp_fetch_document(
 	return;
       }
 
-      serverLogClient(SERVER_LOGLEVEL_DEBUG, client, "ipp_fetch_document: Sent IPP response.");
+      SERVER_LOG_CLIENT_DEBUG(client, "ipp_fetch_document: Sent IPP response.");
 
       if (compression)
+      {
+        httpSetCompressionLevel(client->http, client->printer->pinfo.compression_level);
 	httpSetField(client->http, HTTP_FIELD_CONTENT_ENCODING, "gzip");
+      }
 
+      SERVER_SEQ_BEGIN(job->status_seq);
       job->state = IPP_JSTATE_PROCESSING;
+      SERVER_SEQ_END(job->status_seq);
+
       serverTransformJob(client, job, "ipptransform", format, SERVER_TRANSFORM_TO_CLIENT);
 
-      serverLogClient(SERVER_LOGLEVEL_DEBUG, client, "ipp_fetch_document: Sending 0-length chunk.");
+      SERVER_LOG_CLIENT_DEBUG(client, "ipp_fetch_document: Sending 0-length chunk.");
       httpWrite2(client->http, "", 0);
 
-      serverLogClient(SERVER_LOGLEVEL_DEBUG, client, "ipp_fetch_document: Flushing write buffer.");
+      SERVER_LOG_CLIENT_DEBUG(client, "ipp_fetch_document: Flushing write buffer.");
       httpFlushWrite(client->http);
       return;
     }
@@ -3689,7 +4154,10 @@ ipp_fetch_document(
 
   if (job->format)
   {
-    serverCreateJobFilename(job, job->format, filename, sizeof(filename));
+    if (job->memfd >= 0 && job->filename)
+      strlcpy(filename, job->filename, sizeof(filename));
+    else
+      serverCreateJobFilename(job, job->format, filename, sizeof(filename));
 
     if (access(filename, R_OK))
     {
@@ -3709,7 +4177,12 @@ ipp_fetch_document(
   ippAddString(client->response, IPP_TAG_OPERATION, IPP_TAG_MIMETYPE, "document-format", NULL, format);
   ippAddString(client->response, IPP_TAG_OPERATION, IPP_TAG_KEYWORD, "compression", NULL, compression ? "gzip" : "none");
 
-  client->fetch_file = open(filename, O_RDONLY | O_BINARY);
+  client->fetch_file        = open(filename, O_RDONLY | O_BINARY);
+  client->fetch_compression = compression;
+  client->fetch_length      = 0;
+
+  if (client->fetch_file >= 0 && !fstat(client->fetch_file, &fileinfo))
+    client->fetch_length = (size_t)fileinfo.st_size;
 }
 
 
@@ -3768,7 +4241,10 @@ ipp_fetch_job(server_client_t *client)	/* I - Client */
   }
 
   serverRespondIPP(client, IPP_STATUS_OK, NULL);
-  copy_job_attributes(client, job, NULL, NULL);
+
+  _cupsRWLockRead(&(job->printer->rwlock));
+  copy_job_attributes(client, job, NULL, NULL, NULL);
+  _cupsRWUnlock(&(job->printer->rwlock));
 }
 
 
@@ -3783,7 +4259,8 @@ static void
 ipp_get_document_attributes(
     server_client_t *client)		/* I - Client */
 {
-  server_job_t	*job;			/* Job */
+  server_job_t	*job,			/* Job */
+		*hjob = NULL;		/* Job from history, if any */
   ipp_attribute_t *number;		/* document-number attribute */
   cups_array_t	*ra;			/* requested-attributes */
 
@@ -3798,7 +4275,7 @@ ipp_get_document_attributes(
     return;
   }
 
-  if ((job = serverFindJob(client, 0)) == NULL)
+  if ((job = serverFindJob(client, 0)) == NULL && (job = hjob = serverFindHistoryJob(client, 0)) == NULL)
   {
     serverRespondIPP(client, IPP_STATUS_ERROR_NOT_FOUND, "Job not found.");
     return;
@@ -3807,20 +4284,27 @@ ipp_get_document_attributes(
   if (Authentication && !serverAuthorizeUser(client, job->username, SERVER_GROUP_NONE, JobPrivacyScope))
   {
     serverRespondIPP(client, IPP_STATUS_ERROR_NOT_AUTHORIZED, "Not authorized to access this job.");
+    serverDeleteHistoryJob(hjob);
     return;
   }
 
   if ((number = ippFindAttribute(client->request, "document-number", IPP_TAG_INTEGER)) == NULL || ippGetInteger(number, 0) != 1)
   {
     serverRespondIPP(client, IPP_STATUS_ERROR_NOT_FOUND, "Document #%d not found.", ippGetInteger(number, 0));
+    serverDeleteHistoryJob(hjob);
     return;
   }
 
   serverRespondIPP(client, IPP_STATUS_OK, NULL);
 
   ra = ippCreateRequestedArray(client->request);
+
+  _cupsRWLockRead(&(job->printer->rwlock));
   copy_doc_attributes(client, job, ra, serverAuthorizeUser(client, job->username, SERVER_GROUP_NONE, DocumentPrivacyScope) ? NULL : DocumentPrivacyArray);
+  _cupsRWUnlock(&(job->printer->rwlock));
   cupsArrayDelete(ra);
+
+  serverDeleteHistoryJob(hjob);
 }
 
 
@@ -3834,7 +4318,8 @@ ipp_get_document_attributes(
 static void
 ipp_get_documents(server_client_t *client)/* I - Client */
 {
-  server_job_t	*job;			/* Job */
+  server_job_t	*job,			/* Job */
+		*hjob = NULL;		/* Job from history, if any */
   cups_array_t	*ra;			/* requested-attributes */
 
 
@@ -3848,7 +4333,7 @@ ipp_get_documents(server_client_t *client)/* I - Client */
     return;
   }
 
-  if ((job = serverFindJob(client, 0)) == NULL)
+  if ((job = serverFindJob(client, 0)) == NULL && (job = hjob = serverFindHistoryJob(client, 0)) == NULL)
   {
     serverRespondIPP(client, IPP_STATUS_ERROR_NOT_FOUND, "Job not found.");
     return;
@@ -3857,14 +4342,20 @@ ipp_get_documents(server_client_t *client)/* I - Client */
   if (Authentication && !serverAuthorizeUser(client, job->username, SERVER_GROUP_NONE, JobPrivacyScope))
   {
     serverRespondIPP(client, IPP_STATUS_ERROR_NOT_AUTHORIZED, "Not authorized to access this job.");
+    serverDeleteHistoryJob(hjob);
     return;
   }
 
   serverRespondIPP(client, IPP_STATUS_OK, NULL);
 
   ra = ippCreateRequestedArray(client->request);
+
+  _cupsRWLockRead(&(job->printer->rwlock));
   copy_doc_attributes(client, job, ra, serverAuthorizeUser(client, job->username, SERVER_GROUP_NONE, DocumentPrivacyScope) ? NULL : DocumentPrivacyArray);
+  _cupsRWUnlock(&(job->printer->rwlock));
   cupsArrayDelete(ra);
+
+  serverDeleteHistoryJob(hjob);
 }
 
 
@@ -3876,7 +4367,8 @@ static void
 ipp_get_job_attributes(
     server_client_t *client)		/* I - Client */
 {
-  server_job_t	*job;			/* Job */
+  server_job_t	*job,			/* Job */
+		*hjob = NULL;		/* Job from history, if any */
   cups_array_t	*ra,			/* requested-attributes */
 		*pa = NULL;		/* job-privacy-attributes */
 
@@ -3897,7 +4389,7 @@ ipp_get_job_attributes(
     return;
   }
 
-  if ((job = serverFindJob(client, 0)) == NULL)
+  if ((job = serverFindJob(client, 0)) == NULL && (job = hjob = serverFindHistoryJob(client, 0)) == NULL)
   {
     serverRespondIPP(client, IPP_STATUS_ERROR_NOT_FOUND, "Job not found.");
     return;
@@ -3911,8 +4403,12 @@ ipp_get_job_attributes(
   else
     pa = JobPrivacyArray;
 
-  copy_job_attributes(client, job, ra, pa);
+  _cupsRWLockRead(&(job->printer->rwlock));
+  copy_job_attributes(client, job, ra, pa, NULL);
+  _cupsRWUnlock(&(job->printer->rwlock));
   cupsArrayDelete(ra);
+
+  serverDeleteHistoryJob(hjob);
 }
 
 
@@ -3929,13 +4425,28 @@ ipp_get_jobs(server_client_t *client)	/* I - Client */
   int			job_comparison;	/* Job comparison */
   ipp_jstate_t		job_state;	/* job-state value */
   server_jreason_t	job_reasons;	/* job-state-reasons values */
-  int			first_job_id,	/* First job ID */
+  int			first_index,	/* First index */
+			first_job_id,	/* First job ID */
 			limit,		/* Maximum number of jobs to return */
-			count;		/* Number of jobs that match */
+			count,		/* Number of jobs returned */
+			idx,		/* Number of jobs that match */
+			by_id,		/* Are jobs sorted by job-id? */
+			from_history,	/* Is the current job from the history? */
+			priv;		/* Use private filter? */
   const char		*username;	/* Username */
-  server_job_t		*job;		/* Current job pointer */
-  cups_array_t		*ra,		/* Requested attributes array */
+  server_job_t		*job,		/* Next job pointer */
+			*current;	/* Current job pointer */
+  server_hentry_t	*entry,		/* Next history entry */
+			*hentry;	/* Current history entry */
+  server_userjobs_t	*ujobs;		/* Jobs for user */
+  server_device_t	*device = NULL;	/* Output device for fetchable jobs */
+  cups_array_t		*jobs,		/* Jobs to search */
+			*ra,		/* Requested attributes array */
 			*pa;		/* Privacy attributes array */
+  _ipp_cfilter_t	*filters[2] = { NULL, NULL };
+					/* Compiled public and private filters */
+  cups_array_iter_t	iter,		/* Job iterator */
+			hiter;		/* Job history iterator */
 
 
   if (Authentication && !client->username[0])
@@ -3961,7 +4472,7 @@ ipp_get_jobs(server_client_t *client)	/* I - Client */
   if ((attr = ippFindAttribute(client->request, "which-jobs", IPP_TAG_KEYWORD)) != NULL)
   {
     which_jobs = ippGetString(attr, 0, NULL);
-    serverLogClient(SERVER_LOGLEVEL_DEBUG, client, "Get-Jobs which-jobs='%s'", which_jobs);
+    SERVER_LOG_CLIENT_DEBUG(client, "Get-Jobs which-jobs='%s'", which_jobs);
   }
 
   job_reasons = SERVER_JREASON_NONE;
@@ -4016,6 +4527,7 @@ ipp_get_jobs(server_client_t *client)	/* I - Client */
     job_comparison = -1;
     job_state      = IPP_JSTATE_STOPPED;
     job_reasons    = SERVER_JREASON_JOB_FETCHABLE;
+    device         = serverFindDevice(client);
   }
   else
   {
@@ -4032,17 +4544,26 @@ ipp_get_jobs(server_client_t *client)	/* I - Client */
   {
     limit = ippGetInteger(attr, 0);
 
-    serverLogClient(SERVER_LOGLEVEL_DEBUG, client, "Get-Jobs limit=%d", limit);
+    SERVER_LOG_CLIENT_DEBUG(client, "Get-Jobs limit=%d", limit);
   }
   else
     limit = 0;
 
+  if ((attr = ippFindAttribute(client->request, "first-index", IPP_TAG_INTEGER)) != NULL)
+  {
+    first_index = ippGetInteger(attr, 0);
+
+    SERVER_LOG_CLIENT_DEBUG(client, "Get-Jobs first-index=%d", first_index);
+  }
+  else
+    first_index = 1;
+
   if ((attr = ippFindAttribute(client->request, "first-job-id",
                                IPP_TAG_INTEGER)) != NULL)
   {
     first_job_id = ippGetInteger(attr, 0);
 
-    serverLogClient(SERVER_LOGLEVEL_DEBUG, client, "Get-Jobs first-job-id=%d", first_job_id);
+    SERVER_LOG_CLIENT_DEBUG(client, "Get-Jobs first-job-id=%d", first_job_id);
   }
   else
     first_job_id = 1;
@@ -4058,7 +4579,7 @@ ipp_get_jobs(server_client_t *client)	/* I - Client */
   {
     int my_jobs = ippGetBoolean(attr, 0);
 
-    serverLogClient(SERVER_LOGLEVEL_DEBUG, client, "Get-Jobs my-jobs=%s", my_jobs ? "true" : "false");
+    SERVER_LOG_CLIENT_DEBUG(client, "Get-Jobs my-jobs=%s", my_jobs ? "true" : "false");
 
     if (my_jobs)
     {
@@ -4072,7 +4593,7 @@ ipp_get_jobs(server_client_t *client)	/* I - Client */
 
       username = ippGetString(attr, 0, NULL);
 
-      serverLogClient(SERVER_LOGLEVEL_DEBUG, client, "Get-Jobs requesting-user-name='%s'", username);
+      SERVER_LOG_CLIENT_DEBUG(client, "Get-Jobs requesting-user-name='%s'", username);
     }
   }
 
@@ -4086,47 +4607,155 @@ ipp_get_jobs(server_client_t *client)	/* I - Client */
 
   _cupsRWLockRead(&(client->printer->rwlock));
 
-  for (count = 0, job = (server_job_t *)cupsArrayFirst(client->printer->jobs);
-       (limit <= 0 || count < limit) && job;
-       job = (server_job_t *)cupsArrayNext(client->printer->jobs))
+ /*
+  * Pick the smallest index that holds all of the requested jobs: the
+  * per-user index for my-jobs, the active jobs for queries that only match
+  * jobs that are not completed, and otherwise all jobs.  The per-user and
+  * all jobs arrays are sorted newest first so we can stop at first-job-id,
+  * while active jobs are listed in priority order.  Fetchable jobs for an
+  * output device come from the jobs assigned to that device...
+  */
+
+  if (username)
   {
-   /*
-    * Filter out jobs that don't match...
-    */
+    ujobs = serverFindUserJobs(client->printer, username);
+    jobs  = ujobs ? ujobs->jobs : NULL;
+    by_id = 1;
+  }
+  else if (device)
+  {
+    jobs  = device->jobs;
+    by_id = 0;
+  }
+  else if (job_reasons != SERVER_JREASON_NONE || job_comparison < 0 || (job_comparison == 0 && job_state < IPP_JSTATE_CANCELED))
+  {
+    jobs  = client->printer->active_jobs;
+    by_id = 0;
+  }
+  else
+  {
+    jobs  = client->printer->jobs;
+    by_id = 1;
+  }
 
-    if (job->id < first_job_id || (username && job->username && strcasecmp(username, job->username)))
-      continue;
+  cupsArrayIterInit(&iter, jobs);
+  job  = (server_job_t *)cupsArrayIterNext(&iter);
+
+ /*
+  * Older completed jobs may only be in the job history, which is also sorted
+  * newest first and merged with the in-memory jobs by job-id...
+  */
+
+  if (by_id && client->printer->history && job_reasons == SERVER_JREASON_NONE && job_comparison >= 0)
+    cupsArrayIterInit(&hiter, client->printer->history);
+  else
+    cupsArrayIterInit(&hiter, NULL);
+
+  entry = (server_hentry_t *)cupsArrayIterNext(&hiter);
 
-    if (job_reasons != SERVER_JREASON_NONE)
+  for (count = 0, idx = 0; limit <= 0 || count < limit;)
+  {
+    if (entry && (!job || entry->id > job->id))
     {
-      if (!(job->state_reasons & job_reasons))
+     /*
+      * Filter out history entries that don't match before reading them...
+      */
+
+      hentry = entry;
+      entry  = (server_hentry_t *)cupsArrayIterNext(&hiter);
+
+      if (hentry->id < first_job_id)
+      {
+        entry = NULL;
+        continue;
+      }
+
+      if ((job_comparison == 0 && hentry->state != job_state) || (job_comparison > 0 && hentry->state < job_state))
+        continue;
+
+      if (username && _cups_strcasecmp(username, hentry->username))
+        continue;
+
+      if (++ idx < first_index)
+        continue;
+
+      if ((current = serverReadJobHistoryNoLock(client->printer, hentry)) == NULL)
         continue;
+
+      from_history = 1;
     }
-    else if ((job_comparison < 0 && job->state > job_state) ||
-             (job_comparison == 0 && job->state != job_state) ||
-             (job_comparison > 0 && job->state < job_state))
+    else if (job)
     {
-      continue;
+      current      = job;
+      job          = (server_job_t *)cupsArrayIterNext(&iter);
+      from_history = 0;
+
+      if (entry && entry->id == current->id)
+        entry = (server_hentry_t *)cupsArrayIterNext(&hiter);
+
+     /*
+      * Filter out jobs that don't match...
+      */
+
+      if (current->id < first_job_id)
+      {
+        if (by_id)
+          job = NULL;
+
+        continue;
+      }
+
+      if (job_reasons != SERVER_JREASON_NONE)
+      {
+        if (!(current->state_reasons & job_reasons))
+          continue;
+      }
+      else if ((job_comparison < 0 && current->state > job_state) ||
+               (job_comparison == 0 && current->state != job_state) ||
+               (job_comparison > 0 && current->state < job_state))
+      {
+        continue;
+      }
+
+      if (++ idx < first_index)
+        continue;
     }
+    else
+      break;
 
     if (count > 0)
       ippAddSeparator(client->response);
 
     count ++;
 
-    if (serverAuthorizeUser(client, job->username, job->printer->pinfo.proxy_group, JobPrivacyScope))
+    if (serverAuthorizeUser(client, current->username, current->printer->pinfo.proxy_group, JobPrivacyScope))
     {
-      pa = NULL;
-      serverLogClient(SERVER_LOGLEVEL_INFO, client, "%s Job #%d attributes accessed by \"%s\".", job->printer->name, job->id, client->username);
+      pa   = NULL;
+      priv = 0;
+      serverLogClient(SERVER_LOGLEVEL_INFO, client, "%s Job #%d attributes accessed by \"%s\".", current->printer->name, current->id, client->username);
     }
     else
     {
-      pa = JobPrivacyArray;
+      pa   = JobPrivacyArray;
+      priv = 1;
     }
 
-    copy_job_attributes(client, job, ra, pa);
+   /*
+    * Compile the requested and privacy attributes on first use since each
+    * job is filtered the same way...
+    */
+
+    if (!filters[priv])
+      filters[priv] = _ippServerCreateFilter(ra, pa, IPP_TAG_JOB);
+
+    copy_job_attributes(client, current, ra, pa, filters[priv]);
+
+    if (from_history)
+      serverDeleteHistoryJob(current);
   }
 
+  _ippServerDeleteFilter(filters[0]);
+  _ippServerDeleteFilter(filters[1]);
   cupsArrayDelete(ra);
 
   _cupsRWUnlock(&(client->printer->rwlock));
@@ -4148,7 +4777,7 @@ ipp_get_notifications(
 			count,		/* Number of IDs */
 			seq_num;	/* Sequence number */
   server_subscription_t	*sub;		/* Current subscription */
-  ipp_t			*event;		/* Current event */
+  server_sevent_t	*event;		/* Current event */
   int			num_events = 0;	/* Number of events returned */
 
 
@@ -4208,10 +4837,10 @@ ipp_get_notifications(
 	continue;
       }
 
-      for (event = (ipp_t *)cupsArrayIndex(sub->events, seq_num - sub->first_sequence);
-	   event;
-	   event = (ipp_t *)cupsArrayNext(sub->events))
+      for (; seq_num <= sub->last_sequence; seq_num ++)
       {
+        event = sub->events + seq_num % sub->max_events;
+
 	if (num_events == 0)
 	{
 	  serverRespondIPP(client, IPP_STATUS_OK, NULL);
@@ -4224,7 +4853,7 @@ ipp_get_notifications(
 	else
 	  ippAddSeparator(client->response);
 
-	ippCopyAttributes(client->response, event, 0, NULL, NULL);
+	serverCopySubscriptionEvent(client->response, sub, event);
 	num_events ++;
       }
 
@@ -4241,13 +4870,11 @@ ipp_get_notifications(
 	* Wait for more events...
 	*/
 
-        serverLogClient(SERVER_LOGLEVEL_DEBUG, client, "Waiting for events.");
+        SERVER_LOG_CLIENT_DEBUG(client, "Waiting for events.");
 
-	_cupsMutexLock(&NotificationMutex);
-	_cupsCondWait(&NotificationCondition, &NotificationMutex, 30.0);
-	_cupsMutexUnlock(&NotificationMutex);
+	serverWaitSubscriptionEvents(sub_ids, seq_nums, 30.0);
 
-        serverLogClient(SERVER_LOGLEVEL_DEBUG, client, "Done waiting for events.");
+        SERVER_LOG_CLIENT_DEBUG(client, "Done waiting for events.");
 
         notify_wait = -1;
       }
@@ -4329,7 +4956,8 @@ ipp_get_printer_attributes(
 
   _cupsRWLockRead(&(printer->rwlock));
 
-  copy_printer_attributes(client, printer, ra);
+  copy_printer_values(client, client->response, printer, ra);
+  copy_printer_cache(client, printer, ra);
 
   _cupsRWUnlock(&(printer->rwlock));
 
@@ -4396,7 +5024,8 @@ ipp_get_printers(
     server_client_t *client)		/* I - Client */
 {
   int			i,		/* Looping var */
-			count;		/* Number of printers returned */
+			count,		/* Number of printers returned */
+			copied;		/* Number of printers copied */
   server_printer_t	*printer;	/* Current printer */
   ipp_attribute_t	*printer_ids;	/* printer-ids operation attribute, if any */
   int			first_index,	/* first-index operation attribute value, if any */
@@ -4409,6 +5038,7 @@ ipp_get_printers(
   float			geo_distance = 30.0;
 					/* Distance for geographic filter */
   cups_array_t		*ra;		/* requested-attributes */
+  char			*key;		/* Printer cache key */
 
 
   if (Authentication && !client->username[0])
@@ -4459,19 +5089,20 @@ ipp_get_printers(
     }
   }
 
-  ra = ippCreateRequestedArray(client->request);
+  ra  = ippCreateRequestedArray(client->request);
+  key = create_cache_key(ra);
 
   serverRespondIPP(client, IPP_STATUS_OK, NULL);
 
   _cupsRWLockRead(&PrintersRWLock);
 
-  for (i = 0, count = 0, printer = (server_printer_t *)cupsArrayFirst(Printers); printer; printer = (server_printer_t *)cupsArrayNext(Printers))
+  for (i = 0, count = 0, copied = 0, printer = (server_printer_t *)cupsArrayFirst(Printers); printer; printer = (server_printer_t *)cupsArrayNext(Printers))
   {
     const char	*printer_geo_location;	/* Printer's geo-location value */
 
     _cupsRWLockRead(&printer->rwlock);
 
-    if (Authentication && client->printer->pinfo.print_group != SERVER_GROUP_NONE && !serverAuthorizeUser(client, NULL, client->printer->pinfo.print_group, SERVER_SCOPE_DEFAULT))
+    if (Authentication && printer->pinfo.print_group != SERVER_GROUP_NONE && !serverAuthorizeUser(client, NULL, printer->pinfo.print_group, SERVER_SCOPE_DEFAULT))
     {
       _cupsRWUnlock(&printer->rwlock);
       continue;
@@ -4535,12 +5166,23 @@ ipp_get_printers(
 
     i ++;
     if (i < first_index)
+    {
+      _cupsRWUnlock(&printer->rwlock);
       continue;
+    }
 
-    if (count)
-      ippAddSeparator(client->response);
+   /*
+    * Append the pre-encoded attributes, falling back on a copy if the cache
+    * cannot be used...
+    */
+
+    if (!key || !append_printer_cache(client, printer, ra, key))
+    {
+      if (copied ++)
+	ippAddSeparator(client->response);
 
-    copy_printer_attributes(client, printer, ra);
+      copy_printer_attributes(client, printer, ra);
+    }
 
     count ++;
 
@@ -4553,6 +5195,7 @@ ipp_get_printers(
   _cupsRWUnlock(&PrintersRWLock);
 
   cupsArrayDelete(ra);
+  free(key);
 }
 
 
@@ -4675,7 +5318,7 @@ ipp_get_resources(
   {
     first_index = ippGetInteger(attr, 0);
 
-    serverLogClient(SERVER_LOGLEVEL_DEBUG, client, "Get-Resources first-index=%d", first_index);
+    SERVER_LOG_CLIENT_DEBUG(client, "Get-Resources first-index=%d", first_index);
   }
   else
     first_index = 1;
@@ -4684,7 +5327,7 @@ ipp_get_resources(
   {
     limit = ippGetInteger(attr, 0);
 
-    serverLogClient(SERVER_LOGLEVEL_DEBUG, client, "Get-Resources limit=%d", limit);
+    SERVER_LOG_CLIENT_DEBUG(client, "Get-Resources limit=%d", limit);
   }
   else
     limit = 0;
@@ -4813,7 +5456,7 @@ ipp_get_subscription_attributes(
     else
       pa = SubscriptionPrivacyArray;
 
-    copy_subscription_attributes(client, sub, ra, pa);
+    copy_subscription_attributes(client, sub, ra, pa, NULL);
   }
 
   cupsArrayDelete(ra);
@@ -4829,12 +5472,16 @@ ipp_get_subscriptions(
     server_client_t *client)		/* I - Client */
 {
   server_subscription_t	*sub;		/* Current subscription */
+  cups_array_iter_t	iter;		/* Subscription iterator */
   cups_array_t		*ra = ippCreateRequestedArray(client->request),
 					/* Requested attributes */
 			*pa;		/* Privacy attributes */
+  _ipp_cfilter_t	*filters[2] = { NULL, NULL };
+					/* Compiled public and private filters */
   int			job_id,		/* notify-job-id value */
 			limit,		/* limit value, if any */
 			my_subs,	/* my-subscriptions value */
+			priv,		/* Use private filter? */
 			count = 0;	/* Number of subscriptions reported */
   const char		*username;	/* Most authenticated user name */
 
@@ -4871,7 +5518,8 @@ ipp_get_subscriptions(
 
   serverRespondIPP(client, IPP_STATUS_OK, NULL);
   _cupsRWLockRead(&SubscriptionsRWLock);
-  for (sub = (server_subscription_t *)cupsArrayFirst(Subscriptions); sub; sub = (server_subscription_t *)cupsArrayNext(Subscriptions))
+  cupsArrayIterInit(&iter, Subscriptions);
+  for (sub = (server_subscription_t *)cupsArrayIterNext(&iter); sub; sub = (server_subscription_t *)cupsArrayIterNext(&iter))
   {
     if ((job_id > 0 && (!sub->job || sub->job->id != job_id)) || (job_id <= 0 && sub->job))
       continue;
@@ -4884,13 +5532,20 @@ ipp_get_subscriptions(
 
     if (serverAuthorizeUser(client, sub->username, SERVER_GROUP_NONE, SubscriptionPrivacyScope))
     {
-      pa = NULL;
+      pa   = NULL;
+      priv = 0;
       serverLogClient(SERVER_LOGLEVEL_INFO, client, "Subscription #%d attributes accessed by \"%s\".", sub->id, client->username);
     }
     else
-      pa = SubscriptionPrivacyArray;
+    {
+      pa   = SubscriptionPrivacyArray;
+      priv = 1;
+    }
+
+    if (!filters[priv])
+      filters[priv] = _ippServerCreateFilter(ra, pa, IPP_TAG_SUBSCRIPTION);
 
-    copy_subscription_attributes(client, sub, ra, pa);
+    copy_subscription_attributes(client, sub, ra, pa, filters[priv]);
 
     count ++;
     if (limit > 0 && count >= limit)
@@ -4898,6 +5553,8 @@ ipp_get_subscriptions(
   }
   _cupsRWUnlock(&SubscriptionsRWLock);
 
+  _ippServerDeleteFilter(filters[0]);
+  _ippServerDeleteFilter(filters[1]);
   cupsArrayDelete(ra);
 }
 
@@ -4912,6 +5569,8 @@ ipp_get_system_attributes(
 {
   cups_array_t		*ra;		/* Requested attributes array */
   server_printer_t	*printer;	/* Current printer */
+  ipp_t			*sysattrs;	/* Published system attributes */
+  unsigned		epoch;		/* Reader epoch */
 
 
   if (Authentication)
@@ -4941,20 +5600,17 @@ ipp_get_system_attributes(
 
   serverRespondIPP(client, IPP_STATUS_OK, NULL);
 
-  _cupsRWLockRead(&SystemRWLock);
+ /*
+  * Copy from the published system attributes, which include the
+  * system-config-change-xxx values.  This is a full copy since the published
+  * attributes are freed once Set-System-Attributes replaces them...
+  */
 
-  serverCopyAttributes(client->response, SystemAttributes, ra, NULL, IPP_TAG_ZERO, IPP_TAG_CUPS_CONST);
+  sysattrs = serverGetSystemAttributes(&epoch);
+  serverCopyAttributes(client->response, sysattrs, ra, NULL, IPP_TAG_ZERO, 0);
+  serverReleaseSystemAttributes(epoch);
 //  serverCopyAttributes(client->response, PrivacyAttributes, ra, NULL, IPP_TAG_ZERO, IPP_TAG_CUPS_CONST);
 
-  if (!ra || cupsArrayFind(ra, "system-config-change-date-time"))
-    ippAddDate(client->response, IPP_TAG_SYSTEM, "system-config-change-date-time", ippTimeToDate(SystemConfigChangeTime));
-
-  if (!ra || cupsArrayFind(ra, "system-config-change-time"))
-    ippAddInteger(client->response, IPP_TAG_SYSTEM, IPP_TAG_INTEGER, "system-config-change-time", (int)(SystemConfigChangeTime - SystemStartTime));
-
-  if (!ra || cupsArrayFind(ra, "system-config-changes"))
-    ippAddInteger(client->response, IPP_TAG_SYSTEM, IPP_TAG_INTEGER, "system-config-changes", SystemConfigChanges);
-
   if (!ra || cupsArrayFind(ra, "system-configured-printers"))
   {
     int			i,		/* Looping var */
@@ -5066,8 +5722,6 @@ ipp_get_system_attributes(
 #endif /* 0 */
 
   cupsArrayDelete(ra);
-
-  _cupsRWUnlock(&SystemRWLock);
 }
 
 
@@ -5415,12 +6069,12 @@ ipp_pause_all_printers(
     }
   }
 
-  _cupsRWLockRead(&SystemRWLock);
+  _cupsRWLockRead(&PrintersRWLock);
 
   for (printer = (server_printer_t *)cupsArrayFirst(Printers); printer; printer = (server_printer_t *)cupsArrayNext(Printers))
     serverPausePrinter(printer, ippGetOperation(client->request) == IPP_OP_PAUSE_ALL_PRINTERS);
 
-  _cupsRWUnlock(&SystemRWLock);
+  _cupsRWUnlock(&PrintersRWLock);
 
   serverRespondIPP(client, IPP_STATUS_OK, NULL);
 }
@@ -5467,9 +6121,10 @@ static void
 ipp_print_job(server_client_t *client)	/* I - Client */
 {
   server_job_t		*job;		/* New job */
-  char			filename[1024],	/* Filename buffer */
-			buffer[4096];	/* Copy buffer */
-  ssize_t		bytes;		/* Bytes read */
+  char			filename[1024];	/* Filename buffer */
+  int			streaming;	/* Streaming to the command? */
+  ssize_t		bytes;		/* Bytes copied */
+  server_sniff_t	sniff;		/* Document analyzer */
   cups_array_t		*ra;		/* Attributes to send in response */
   ipp_attribute_t	*hold_until,	/* job-hold-until-xxx attribute, if any */
 			*doc_name;	/* document-name attribute, if any */
@@ -5544,45 +6199,67 @@ ipp_print_job(server_client_t *client)	/* I - Client */
   * Create a file for the request data...
   */
 
-  serverCreateJobFilename(job, NULL, filename, sizeof(filename));
-
-  serverLogJob(SERVER_LOGLEVEL_INFO, job, "Creating job file \"%s\", format \"%s\".", filename, job->format);
-
-  if ((job->fd = open(filename, O_WRONLY | O_CREAT | O_TRUNC | O_BINARY, 0600)) < 0)
+  if ((job->fd = serverCreateJobFile(job, NULL, httpIsChunked(client->http) ? 0 : (off_t)httpGetRemaining(client->http), filename, sizeof(filename))) < 0)
   {
+    SERVER_SEQ_BEGIN(job->status_seq);
     job->state = IPP_JSTATE_ABORTED;
+    SERVER_SEQ_END(job->status_seq);
 
     serverRespondIPP(client, IPP_STATUS_ERROR_INTERNAL,
                 "Unable to create print file: %s", strerror(errno));
     return;
   }
 
-  while ((bytes = httpRead2(client->http, buffer, sizeof(buffer))) > 0)
+  serverLogJob(SERVER_LOGLEVEL_INFO, job, "Created job file \"%s\", format \"%s\".", filename, job->format);
+
+ /*
+  * Copy the document data, starting the job right away if it can be
+  * streamed to the printer's command.  Documents we can count pages in are
+  * copied through stream_job_data so the counts are updated as they arrive...
+  */
+
+  if (httpIsChunked(client->http))
+    serverPreallocateSpoolFile(job->fd, get_document_length(client));
+
+  job->doc_k_octets    = 0;
+  job->doc_impressions = 0;
+
+  update_job_size(job, httpIsChunked(client->http) ? 0 : (off_t)httpGetRemaining(client->http), 0);
+
+  if ((streaming = serverStreamJob(job, filename)) != 0 || sniff_init(&sniff, job->format))
+    bytes = stream_job_data(client, job);
+  else if ((bytes = _httpReadFile(client->http, job->fd)) > 0)
+    update_job_size(job, (off_t)bytes, 0);
+
+  SERVER_CLIENT_PHASE(client, SERVER_PHASE_SPOOL);
+
+  if (bytes < 0 && !httpError(client->http))
   {
-    if (write(job->fd, buffer, (size_t)bytes) < bytes)
-    {
-      int error = errno;		/* Write error */
+    int error = errno;			/* Write error */
 
-      job->state = IPP_JSTATE_ABORTED;
+    SERVER_SEQ_BEGIN(job->status_seq);
+    job->state = IPP_JSTATE_ABORTED;
+    SERVER_SEQ_END(job->status_seq);
 
-      close(job->fd);
-      job->fd = -1;
+    close(job->fd);
+    job->fd = -1;
 
-      unlink(filename);
+    unlink(filename);
 
-      serverRespondIPP(client, IPP_STATUS_ERROR_INTERNAL,
-                  "Unable to write print file: %s", strerror(error));
-      return;
-    }
+    serverRespondIPP(client, IPP_STATUS_ERROR_INTERNAL,
+                "Unable to write print file: %s", strerror(error));
+    return;
   }
 
-  if (bytes < 0)
+  if (httpError(client->http))
   {
    /*
     * Got an error while reading the print data, so abort this job.
     */
 
+    SERVER_SEQ_BEGIN(job->status_seq);
     job->state = IPP_JSTATE_ABORTED;
+    SERVER_SEQ_END(job->status_seq);
 
     close(job->fd);
     job->fd = -1;
@@ -5594,12 +6271,15 @@ ipp_print_job(server_client_t *client)	/* I - Client */
     return;
   }
 
-  if (close(job->fd))
+  if (serverCloseSpoolFile(job->fd, filename))
   {
     int error = errno;		/* Write error */
 
+    SERVER_SEQ_BEGIN(job->status_seq);
     job->state = IPP_JSTATE_ABORTED;
-    job->fd    = -1;
+    SERVER_SEQ_END(job->status_seq);
+
+    job->fd = -1;
 
     unlink(filename);
 
@@ -5608,15 +6288,25 @@ ipp_print_job(server_client_t *client)	/* I - Client */
     return;
   }
 
-  job->fd       = -1;
-  job->filename = strdup(filename);
-  job->state    = IPP_JSTATE_PENDING;
+  job->fd = -1;
 
- /*
-  * Process the job, if possible...
-  */
+  if (!streaming)
+  {
+    job->filename = strdup(filename);
 
-  serverCheckJobs(client->printer);
+    if (job->hold_until == 0)
+    {
+      SERVER_SEQ_BEGIN(job->status_seq);
+      job->state = IPP_JSTATE_PENDING;
+      SERVER_SEQ_END(job->status_seq);
+    }
+
+   /*
+    * Process the job, if possible...
+    */
+
+    serverCheckJobs(client->printer);
+  }
 
  /*
   * Return the job info...
@@ -5631,7 +6321,9 @@ ipp_print_job(server_client_t *client)	/* I - Client */
   cupsArrayAdd(ra, "job-state-reasons");
   cupsArrayAdd(ra, "job-uri");
 
-  copy_job_attributes(client, job, ra, NULL);
+  _cupsRWLockRead(&(job->printer->rwlock));
+  copy_job_attributes(client, job, ra, NULL, NULL);
+  _cupsRWUnlock(&(job->printer->rwlock));
   cupsArrayDelete(ra);
 
  /*
@@ -5731,7 +6423,11 @@ ipp_print_uri(server_client_t *client)	/* I - Client */
     serverHoldJob(job, hold_until);
 
   if (copy_document_uri(client, job, uri) && job->hold_until == 0)
+  {
+    SERVER_SEQ_BEGIN(job->status_seq);
     job->state = IPP_JSTATE_PENDING;
+    SERVER_SEQ_END(job->status_seq);
+  }
 
  /*
   * Process the job...
@@ -5752,7 +6448,9 @@ ipp_print_uri(server_client_t *client)	/* I - Client */
   cupsArrayAdd(ra, "job-state-reasons");
   cupsArrayAdd(ra, "job-uri");
 
-  copy_job_attributes(client, job, ra, NULL);
+  _cupsRWLockRead(&(job->printer->rwlock));
+  copy_job_attributes(client, job, ra, NULL, NULL);
+  _cupsRWUnlock(&(job->printer->rwlock));
   cupsArrayDelete(ra);
 
  /*
@@ -5872,7 +6570,7 @@ ipp_register_output_device(
       pinfo.max_devices = 1;
 
       snprintf(path, sizeof(path), "/ipp/print/%s", uuid + 9);
-      printer = client->printer = serverCreatePrinter(path, uuid + 9, uuid + 9, &pinfo, 0);
+      printer = client->printer = serverCreatePrinter(path, uuid + 9, uuid + 9, &pinfo, 0, 1);
 
       serverAddPrinter(printer);
     }
@@ -6137,12 +6835,12 @@ ipp_restart_system(
   /* TODO: Actually do a full restart of the system... */
   serverSaveSystem();
 
-  _cupsRWLockRead(&SystemRWLock);
+  _cupsRWLockRead(&PrintersRWLock);
 
   for (printer = (server_printer_t *)cupsArrayFirst(Printers); printer; printer = (server_printer_t *)cupsArrayNext(Printers))
     serverRestartPrinter(printer);
 
-  _cupsRWUnlock(&SystemRWLock);
+  _cupsRWUnlock(&PrintersRWLock);
 
   serverRespondIPP(client, IPP_STATUS_OK, NULL);
 }
@@ -6178,12 +6876,12 @@ ipp_resume_all_printers(
     }
   }
 
-  _cupsRWLockRead(&SystemRWLock);
+  _cupsRWLockRead(&PrintersRWLock);
 
   for (printer = (server_printer_t *)cupsArrayFirst(Printers); printer; printer = (server_printer_t *)cupsArrayNext(Printers))
     serverResumePrinter(printer);
 
-  _cupsRWUnlock(&SystemRWLock);
+  _cupsRWUnlock(&PrintersRWLock);
 
   serverRespondIPP(client, IPP_STATUS_OK, NULL);
 }
@@ -6231,11 +6929,11 @@ static void
 ipp_send_document(server_client_t *client)/* I - Client */
 {
   server_job_t		*job;		/* Job information */
-  char			filename[1024],	/* Filename buffer */
-			buffer[4096];	/* Copy buffer */
-  ssize_t		bytes;		/* Bytes read */
+  ssize_t		bytes;		/* Bytes spooled */
+  char			filename[1024];	/* Filename buffer */
   ipp_attribute_t	*attr;		/* Current attribute */
   cups_array_t		*ra;		/* Attributes to send in response */
+  server_sniff_t	sniff;		/* Document analyzer */
 
 
   if (Authentication && !client->username[0])
@@ -6334,49 +7032,65 @@ ipp_send_document(server_client_t *client)/* I - Client */
   * Create a file for the request data...
   */
 
-  serverCreateJobFilename(job, NULL, filename, sizeof(filename));
-
-  serverLogJob(SERVER_LOGLEVEL_INFO, job, "Creating job file \"%s\", format \"%s\".", filename, job->format);
-
-  job->fd = open(filename, O_WRONLY | O_CREAT | O_TRUNC | O_BINARY, 0600);
+  job->fd = serverCreateJobFile(job, NULL, httpIsChunked(client->http) ? 0 : (off_t)httpGetRemaining(client->http), filename, sizeof(filename));
 
   _cupsRWUnlock(&(client->printer->rwlock));
 
   if (job->fd < 0)
   {
+    SERVER_SEQ_BEGIN(job->status_seq);
     job->state = IPP_JSTATE_ABORTED;
+    SERVER_SEQ_END(job->status_seq);
 
     serverRespondIPP(client, IPP_STATUS_ERROR_INTERNAL,
                 "Unable to create print file: %s", strerror(errno));
     return;
   }
 
-  while ((bytes = httpRead2(client->http, buffer, sizeof(buffer))) > 0)
+  serverLogJob(SERVER_LOGLEVEL_INFO, job, "Created job file \"%s\", format \"%s\".", filename, job->format);
+
+  if (httpIsChunked(client->http))
+    serverPreallocateSpoolFile(job->fd, get_document_length(client));
+
+  job->doc_k_octets    = 0;
+  job->doc_impressions = 0;
+
+  update_job_size(job, httpIsChunked(client->http) ? 0 : (off_t)httpGetRemaining(client->http), 0);
+
+  if (sniff_init(&sniff, job->format))
+    bytes = stream_job_data(client, job);
+  else if ((bytes = _httpReadFile(client->http, job->fd)) > 0)
+    update_job_size(job, (off_t)bytes, 0);
+
+  SERVER_CLIENT_PHASE(client, SERVER_PHASE_SPOOL);
+
+  if (bytes < 0 && !httpError(client->http))
   {
-    if (write(job->fd, buffer, (size_t)bytes) < bytes)
-    {
-      int error = errno;		/* Write error */
+    int error = errno;			/* Write error */
 
-      job->state = IPP_JSTATE_ABORTED;
+    SERVER_SEQ_BEGIN(job->status_seq);
+    job->state = IPP_JSTATE_ABORTED;
+    SERVER_SEQ_END(job->status_seq);
 
-      close(job->fd);
-      job->fd = -1;
+    close(job->fd);
+    job->fd = -1;
 
-      unlink(filename);
+    unlink(filename);
 
-      serverRespondIPP(client, IPP_STATUS_ERROR_INTERNAL,
-                  "Unable to write print file: %s", strerror(error));
-      return;
-    }
+    serverRespondIPP(client, IPP_STATUS_ERROR_INTERNAL,
+                "Unable to write print file: %s", strerror(error));
+    return;
   }
 
-  if (bytes < 0)
+  if (httpError(client->http))
   {
    /*
     * Got an error while reading the print data, so abort this job.
     */
 
+    SERVER_SEQ_BEGIN(job->status_seq);
     job->state = IPP_JSTATE_ABORTED;
+    SERVER_SEQ_END(job->status_seq);
 
     close(job->fd);
     job->fd = -1;
@@ -6388,12 +7102,15 @@ ipp_send_document(server_client_t *client)/* I - Client */
     return;
   }
 
-  if (close(job->fd))
+  if (serverCloseSpoolFile(job->fd, filename))
   {
     int error = errno;			/* Write error */
 
+    SERVER_SEQ_BEGIN(job->status_seq);
     job->state = IPP_JSTATE_ABORTED;
-    job->fd    = -1;
+    SERVER_SEQ_END(job->status_seq);
+
+    job->fd = -1;
 
     unlink(filename);
 
@@ -6408,7 +7125,11 @@ ipp_send_document(server_client_t *client)/* I - Client */
   job->filename = strdup(filename);
 
   if (job->hold_until == 0)
+  {
+    SERVER_SEQ_BEGIN(job->status_seq);
     job->state = IPP_JSTATE_PENDING;
+    SERVER_SEQ_END(job->status_seq);
+  }
 
   _cupsRWUnlock(&(client->printer->rwlock));
 
@@ -6430,7 +7151,9 @@ ipp_send_document(server_client_t *client)/* I - Client */
   cupsArrayAdd(ra, "job-state-reasons");
   cupsArrayAdd(ra, "job-uri");
 
-  copy_job_attributes(client, job, ra, NULL);
+  _cupsRWLockRead(&(job->printer->rwlock));
+  copy_job_attributes(client, job, ra, NULL, NULL);
+  _cupsRWUnlock(&(job->printer->rwlock));
   cupsArrayDelete(ra);
 }
 
@@ -6446,12 +7169,13 @@ ipp_send_resource_data(
   server_resource_t	*resource;	/* New resource */
   cups_array_t		*ra;		/* Attributes to send in response */
   ipp_attribute_t	*attr;		/* Request attribute */
+  ssize_t		bytes;		/* Bytes spooled */
   int			resource_id;	/* resource-id value */
   const char		*format;	/* resource-format value */
   ipp_attribute_t	*signature;	/* resource-signature value */
   char			filename[1024],	/* Filename buffer */
-			buffer[4096];	/* Copy buffer */
-  ssize_t		bytes;		/* Bytes read */
+			resdir[1024],	/* Resource spool directory */
+			sharddir[1024];	/* Shard directory */
 
 
   if (Authentication)
@@ -6532,7 +7256,9 @@ ipp_send_resource_data(
   * Copy the remaining message body to the resource file...
   */
 
-  serverCreateResourceFilename(resource, format, SpoolDirectory, filename, sizeof(filename));
+  snprintf(resdir, sizeof(resdir), "%s/resources", SpoolDirectory);
+  serverCreateSpoolDirectory(resdir, resource->id, sharddir, sizeof(sharddir));
+  serverCreateResourceFilename(resource, format, sharddir, filename, sizeof(filename));
 
   serverLogClient(SERVER_LOGLEVEL_INFO, client, "Creating resource file \"%s\", format \"%s\".", filename, format);
 
@@ -6546,24 +7272,28 @@ ipp_send_resource_data(
     return;
   }
 
-  while ((bytes = httpRead2(client->http, buffer, sizeof(buffer))) > 0)
+  if (!httpIsChunked(client->http))
+    serverPreallocateSpoolFile(resource->fd, (off_t)httpGetRemaining(client->http));
+
+  bytes = _httpReadFile(client->http, resource->fd);
+
+  SERVER_CLIENT_PHASE(client, SERVER_PHASE_SPOOL);
+
+  if (bytes < 0 && !httpError(client->http))
   {
-    if (write(resource->fd, buffer, (size_t)bytes) < bytes)
-    {
-      int error = errno;		/* Write error */
+    int error = errno;			/* Write error */
 
-      close(resource->fd);
-      resource->fd = -1;
-      unlink(filename);
+    close(resource->fd);
+    resource->fd = -1;
+    unlink(filename);
 
-      serverSetResourceState(resource, IPP_RSTATE_ABORTED, "Unable to write resource file: %s", strerror(error));
-      serverRespondIPP(client, IPP_STATUS_ERROR_INTERNAL, "Unable to write resource file: %s", strerror(error));
-      httpFlush(client->http);
-      return;
-    }
+    serverSetResourceState(resource, IPP_RSTATE_ABORTED, "Unable to write resource file: %s", strerror(error));
+    serverRespondIPP(client, IPP_STATUS_ERROR_INTERNAL, "Unable to write resource file: %s", strerror(error));
+    httpFlush(client->http);
+    return;
   }
 
-  if (bytes < 0)
+  if (httpError(client->http))
   {
    /*
     * Got an error while reading the resource data, so abort this resource.
@@ -6578,7 +7308,7 @@ ipp_send_resource_data(
     return;
   }
 
-  if (close(resource->fd))
+  if (serverCloseSpoolFile(resource->fd, filename))
   {
     int error = errno;			/* Write error */
 
@@ -6749,7 +7479,11 @@ ipp_send_uri(server_client_t *client)	/* I - Client */
     job->format = "application/octet-stream";
 
   if (copy_document_uri(client, job, uri) && job->hold_until == 0)
+  {
+    SERVER_SEQ_BEGIN(job->status_seq);
     job->state = IPP_JSTATE_PENDING;
+    SERVER_SEQ_END(job->status_seq);
+  }
 
  /*
   * Process the job, if possible...
@@ -6770,7 +7504,9 @@ ipp_send_uri(server_client_t *client)	/* I - Client */
   cupsArrayAdd(ra, "job-state-reasons");
   cupsArrayAdd(ra, "job-uri");
 
-  copy_job_attributes(client, job, ra, NULL);
+  _cupsRWLockRead(&(job->printer->rwlock));
+  copy_job_attributes(client, job, ra, NULL, NULL);
+  _cupsRWUnlock(&(job->printer->rwlock));
   cupsArrayDelete(ra);
 }
 
@@ -6950,11 +7686,14 @@ ipp_set_job_attributes(
     {
       _cupsRWLockWrite(&job->printer->rwlock);
 
-      cupsArrayRemove(job->printer->active_jobs, job);
-
-      job->priority = ippGetInteger(attr, 0);
+      if (cupsArrayRemove(job->printer->active_jobs, job))
+      {
+        job->priority = ippGetInteger(attr, 0);
 
-      cupsArrayAdd(job->printer->active_jobs, job);
+        cupsArrayAdd(job->printer->active_jobs, job);
+      }
+      else
+        job->priority = ippGetInteger(attr, 0);
 
       _cupsRWUnlock(&job->printer->rwlock);
     }
@@ -7132,6 +7871,8 @@ ipp_set_printer_attributes(
     }
     else if (!strcmp(name, "printer-name"))
     {
+      serverMarkPrinterDeleted(printer);
+
       if (printer->name)
         free(printer->name);
 
@@ -7151,6 +7892,12 @@ ipp_set_printer_attributes(
     }
   }
 
+  printer->config_time = time(NULL);
+
+  serverClearPrinterCacheNoLock(printer);
+  serverMarkPrinterDirty(printer);
+  serverUpdatePrinterTXT(printer);
+
   _cupsRWUnlock(&printer->rwlock);
 
   serverRespondIPP(client, IPP_STATUS_OK, NULL);
@@ -7299,6 +8046,8 @@ ipp_set_system_attributes(
   SystemConfigChangeTime = time(NULL);
   SystemConfigChanges ++;
 
+  serverPublishSystem();
+
   serverRespondIPP(client, IPP_STATUS_OK, NULL);
 
   unlock_system:
@@ -7347,7 +8096,7 @@ ipp_shutdown_all_printers(
     printer->state_reasons |= SERVER_PREASON_PRINTER_SHUTDOWN;
 
     if (printer->processing_job)
-      serverStopJob(printer->processing_job);
+      serverStopPrinterJobs(printer);
     else
       printer->state = IPP_PSTATE_STOPPED;
 
@@ -7393,7 +8142,7 @@ ipp_shutdown_printer(
   client->printer->state_reasons |= SERVER_PREASON_PRINTER_SHUTDOWN;
 
   if (client->printer->processing_job)
-    serverStopJob(client->printer->processing_job);
+    serverStopPrinterJobs(client->printer);
   else
     client->printer->state = IPP_PSTATE_STOPPED;
 
@@ -7450,7 +8199,7 @@ ipp_startup_all_printers(
 
       if (printer->processing_job)
       {
-	serverStopJob(printer->processing_job);
+	serverStopPrinterJobs(printer);
       }
       else if (printer->state == IPP_PSTATE_STOPPED)
       {
@@ -7510,7 +8259,7 @@ ipp_startup_printer(
 
     if (client->printer->processing_job)
     {
-      serverStopJob(client->printer->processing_job);
+      serverStopPrinterJobs(client->printer);
     }
     else if (client->printer->state == IPP_PSTATE_STOPPED)
     {
@@ -7537,6 +8286,7 @@ ipp_update_active_jobs(
 {
   server_device_t	*device;	/* Output device */
   server_job_t		*job;		/* Job */
+  cups_array_iter_t	iter;		/* Job iterator */
   ipp_attribute_t	*job_ids,	/* job-ids */
 			*job_states;	/* output-device-job-states */
   int			i,		/* Looping var */
@@ -7619,7 +8369,16 @@ ipp_update_active_jobs(
 	}
       }
       else
+      {
         job->dev_state = state;
+
+        if (state >= IPP_JSTATE_CANCELED)
+        {
+          _cupsRWLockWrite(&client->printer->rwlock);
+          serverReleaseDeviceJobNoLock(job);
+          _cupsRWUnlock(&client->printer->rwlock);
+        }
+      }
     }
   }
 
@@ -7627,9 +8386,13 @@ ipp_update_active_jobs(
   * Then look for jobs assigned to the device but not listed...
   */
 
-  for (job = (server_job_t *)cupsArrayFirst(client->printer->jobs);
+  _cupsRWLockRead(&client->printer->rwlock);
+
+  cupsArrayIterInit(&iter, client->printer->jobs);
+
+  for (job = (server_job_t *)cupsArrayIterNext(&iter);
        job && num_different < 1000;
-       job = (server_job_t *)cupsArrayNext(client->printer->jobs))
+       job = (server_job_t *)cupsArrayIterNext(&iter))
   {
     if (job->dev_uuid && !strcmp(job->dev_uuid, device->uuid) && !ippContainsInteger(job_ids, job->id))
     {
@@ -7638,6 +8401,8 @@ ipp_update_active_jobs(
     }
   }
 
+  _cupsRWUnlock(&client->printer->rwlock);
+
   serverRespondIPP(client, IPP_STATUS_OK, NULL);
 
   if (num_different > 0)
@@ -7711,7 +8476,10 @@ ipp_update_document_status(
 
   if ((attr = ippFindAttribute(client->request, "impressions-completed", IPP_TAG_INTEGER)) != NULL)
   {
+    SERVER_SEQ_BEGIN(job->status_seq);
     job->impcompleted = ippGetInteger(attr, 0);
+    SERVER_SEQ_END(job->status_seq);
+
     serverAddEventNoLock(client->printer, job, NULL, SERVER_EVENT_JOB_PROGRESS, NULL);
   }
 
@@ -7773,7 +8541,10 @@ ipp_update_job_status(
 
   if ((attr = ippFindAttribute(client->request, "job-impressions-completed", IPP_TAG_INTEGER)) != NULL)
   {
+    SERVER_SEQ_BEGIN(job->status_seq);
     job->impcompleted = ippGetInteger(attr, 0);
+    SERVER_SEQ_END(job->status_seq);
+
     events |= SERVER_EVENT_JOB_PROGRESS;
   }
 
@@ -7781,11 +8552,21 @@ ipp_update_job_status(
   {
     job->dev_state = (ipp_jstate_t)ippGetInteger(attr, 0);
     events |= SERVER_EVENT_JOB_STATE_CHANGED;
+
+    if (job->dev_state >= IPP_JSTATE_CANCELED)
+    {
+      _cupsRWLockWrite(&client->printer->rwlock);
+      serverReleaseDeviceJobNoLock(job);
+      _cupsRWUnlock(&client->printer->rwlock);
+    }
   }
 
   if ((attr = ippFindAttribute(client->request, "output-device-job-state-reasons", IPP_TAG_KEYWORD)) != NULL)
   {
+    SERVER_SEQ_BEGIN(job->status_seq);
     job->dev_state_reasons = serverGetJobStateReasonsBits(attr);
+    SERVER_SEQ_END(job->status_seq);
+
     events |= SERVER_EVENT_JOB_STATE_CHANGED;
   }
 
@@ -7809,6 +8590,7 @@ ipp_update_output_device_attributes(
 			*dev_attr;	/* Device attribute */
   server_event_t	events = SERVER_EVENT_NONE;
 					/* Config/state changed? */
+  int			assign = 0;	/* Device state or speed changed? */
 
 
   if (Authentication)
@@ -7858,6 +8640,29 @@ ipp_update_output_device_attributes(
     if (!attrname)
       continue;
 
+   /*
+    * The device state and speed are used to assign jobs to devices and are
+    * not part of the composite printer attributes...
+    */
+
+    if (!strcmp(attrname, "pages-per-minute") && ippGetValueTag(attr) == IPP_TAG_INTEGER)
+    {
+      device->ppm = ippGetInteger(attr, 0);
+      assign      = 1;
+      continue;
+    }
+    else if (!strcmp(attrname, "printer-state") && ippGetValueTag(attr) == IPP_TAG_ENUM)
+    {
+      device->state = (ipp_pstate_t)ippGetInteger(attr, 0);
+      assign        = 1;
+      continue;
+    }
+    else if (!strcmp(attrname, "printer-state-reasons") && ippGetValueTag(attr) == IPP_TAG_KEYWORD)
+    {
+      device->reasons = serverGetPrinterStateReasonsBits(attr);
+      continue;
+    }
+
     if (strncmp(attrname, "copies", 6) && strncmp(attrname, "document-format", 15) && strncmp(attrname, "finishings", 10) && strncmp(attrname, "media", 5) && strncmp(attrname, "print-", 6) && strncmp(attrname, "sides", 5) && strncmp(attrname, "printer-alert", 13) && strncmp(attrname, "printer-input", 13) && strncmp(attrname, "printer-output", 14) && strncmp(attrname, "printer-resolution", 18) && strncmp(attrname, "pwg-raster", 10) && strncmp(attrname, "urf-", 4))
       continue;
 
@@ -8105,6 +8910,13 @@ ipp_update_output_device_attributes(
 
   _cupsRWUnlock(&device->rwlock);
 
+  if (assign)
+  {
+    _cupsRWLockWrite(&client->printer->rwlock);
+    serverAssignJobsNoLock(client->printer);
+    _cupsRWUnlock(&client->printer->rwlock);
+  }
+
   if (events)
   {
     _cupsRWLockWrite(&client->printer->rwlock);
@@ -8177,722 +8989,1168 @@ ipp_validate_job(server_client_t *client)	/* I - Client */
 
 
 /*
- * 'serverProcessIPP()' - Process an IPP request.
+ * 'serverPreflightIPP()' - Validate an IPP request once the operation
+ *                          attributes have been read.
+ *
+ * Invalid and unauthorized requests are rejected here so that the rest of the
+ * request and any document data need not be read.  The connection is closed
+ * after the error response has been sent.
  */
 
-int					/* O - 1 on success, 0 on error */
-serverProcessIPP(
+int					/* O - 1 to continue reading, 0 on error */
+serverPreflightIPP(
     server_client_t *client)		/* I - Client */
 {
-  ipp_tag_t		group;		/* Current group tag */
-  ipp_attribute_t	*attr;		/* Current attribute */
-  ipp_attribute_t	*charset;	/* Character set attribute */
-  ipp_attribute_t	*language;	/* Language attribute */
-  ipp_attribute_t	*uri;		/* Printer URI attribute */
-  int			major, minor;	/* Version number */
-  const char		*name;		/* Name of attribute */
+  ipp_t			*request = client->request;
+					/* Partially read request */
+  ipp_attribute_t	*current = request->current,
+			*prev = request->prev;
+					/* Read position in request */
+  int			valid = 0;	/* Is the request valid? */
+
+
+  client->operation_id = ippGetOperation(request);
+  client->response     = ippNewResponse(request);
+
+  if (valid_request(client) && serverAdmitRequest(client))
+  {
+    valid = 1;
+
+    if (Authentication && client->printer)
+    {
+      switch (client->operation_id)
+      {
+	case IPP_OP_PRINT_JOB :
+	case IPP_OP_PRINT_URI :
+	case IPP_OP_VALIDATE_JOB :
+	case IPP_OP_CREATE_JOB :
+	    if (!client->username[0])
+	    {
+	     /*
+	      * Require authenticated username...
+	      */
+
+	      httpSetKeepAlive(client->http, HTTP_KEEPALIVE_OFF);
+	      serverRespondHTTP(client, HTTP_STATUS_UNAUTHORIZED, NULL, NULL, 0);
+	      return (0);
+	    }
+
+	    if (client->printer->pinfo.print_group != SERVER_GROUP_NONE && !serverAuthorizeUser(client, NULL, client->printer->pinfo.print_group, SERVER_SCOPE_DEFAULT))
+	    {
+	      serverRespondIPP(client, IPP_STATUS_ERROR_NOT_AUTHORIZED, "Not authorized to access this printer.");
+	      valid = 0;
+	    }
+	    break;
+
+	default :
+	    break;
+      }
+    }
+  }
+
+  if (valid)
+  {
+   /*
+    * Looking up attributes moves the current attribute, which ippReadNext()
+    * needs to add any remaining values to the attribute being read...
+    */
+
+    request->current = current;
+    request->prev    = prev;
+
+    return (1);
+  }
+
+ /*
+  * Send the error response without reading the rest of the request...
+  */
 
+  serverLogClient(SERVER_LOGLEVEL_INFO, client, "Rejecting %s request before reading it.", ippOpString(client->operation_id));
+  serverLogAttributes(client, "Response:", client->response, 2);
+
+  httpSetKeepAlive(client->http, HTTP_KEEPALIVE_OFF);
+  serverRespondHTTP(client, HTTP_STATUS_OK, NULL, "application/ipp", serverEncodeResponse(client));
+  serverMetricsRequest(client->operation_id, 0.0);
+
+  return (0);
+}
+
+
+/*
+ * 'serverProcessIPP()' - Process an IPP request.
+ */
+
+int					/* O - 1 on success, 0 on error */
+serverProcessIPP(
+    server_client_t *client)		/* I - Client */
+{
+  ipp_attribute_t	*attr;		/* Current attribute */
+  double		start;		/* Start time */
+  int			ret,		/* Return value */
+			preflighted;	/* Was the request preflighted? */
+  size_t		length;		/* Length of encoded response */
+
+
+  start = serverGetTime();
 
   serverLogAttributes(client, "Request:", client->request, 1);
 
  /*
-  * First build an empty response message for this request...
+  * First build an empty response message for this request, unless
+  * serverPreflightIPP already did...
   */
 
   client->operation_id = ippGetOperation(client->request);
-  client->response     = ippNewResponse(client->request);
+
+  SERVER_TRACE3(request__start, client->number, client->operation_id, ippGetRequestId(client->request));
+
+  if ((preflighted = client->response != NULL) == 0)
+    client->response = ippNewResponse(client->request);
 
  /*
-  * Then validate the request header and required attributes...
+  * Then validate the request header and required attributes - a preflighted
+  * request only needs the groups read after the operation attributes
+  * checked...
   */
 
-  major = ippGetVersion(client->request, &minor);
+  if ((preflighted ? !valid_groups(client) : !valid_request(client)) || !serverAdmitRequest(client))
+    goto send_response;
 
-  if (major < 1 || major > 2)
-  {
-   /*
-    * Return an error, since we only support IPP 1.x and 2.x.
-    */
+  SERVER_CLIENT_PHASE(client, SERVER_PHASE_VALIDATE);
 
-    serverRespondIPP(client, IPP_STATUS_ERROR_VERSION_NOT_SUPPORTED, "Bad request version number %d.%d.", major, minor);
-    goto send_response;
-  }
-  else if (ippGetRequestId(client->request) <= 0)
+  if (client->printer && client->printer->is_shutdown && ippGetOperation(client->request) != IPP_OP_STARTUP_PRINTER)
   {
-    serverRespondIPP(client, IPP_STATUS_ERROR_BAD_REQUEST, "Bad request-id %d.", ippGetRequestId(client->request));
+    serverRespondIPP(client, IPP_STATUS_ERROR_SERVICE_UNAVAILABLE, "\"%s\" is shutdown.", client->printer->name);
     goto send_response;
   }
-  else if (!ippFirstAttribute(client->request))
-  {
-    serverRespondIPP(client, IPP_STATUS_ERROR_BAD_REQUEST, "No attributes in request.");
-    goto send_response;
-  }
-  else
+  else if (client->printer)
   {
    /*
-    * Make sure that the attributes are provided in the correct order and
-    * don't repeat groups...
+    * Try processing the Printer operation...
     */
 
-    for (attr = ippFirstAttribute(client->request), group = ippGetGroupTag(attr); attr; attr = ippNextAttribute(client->request))
+    switch ((int)ippGetOperation(client->request))
     {
-      if (ippGetGroupTag(attr) < group && ippGetGroupTag(attr) != IPP_TAG_ZERO)
-      {
-       /*
-	* Out of order; return an error...
-	*/
+      case IPP_OP_PRINT_JOB :
+	  ipp_print_job(client);
+	  break;
 
-	serverRespondIPP(client, IPP_STATUS_ERROR_BAD_REQUEST, "Attribute groups are out of order (%x < %x).", ippGetGroupTag(attr), group);
-	goto send_response;
-      }
-      else
-	group = ippGetGroupTag(attr);
-    }
+      case IPP_OP_PRINT_URI :
+	  ipp_print_uri(client);
+	  break;
 
-   /*
-    * Then make sure that the first three attributes are:
-    *
-    *     attributes-charset
-    *     attributes-natural-language
-    *     printer-uri/job-uri
-    */
+      case IPP_OP_VALIDATE_JOB :
+	  ipp_validate_job(client);
+	  break;
 
-    attr = ippFirstAttribute(client->request);
-    name = ippGetName(attr);
-    if (attr && name && !strcmp(name, "attributes-charset") && ippGetGroupTag(attr) == IPP_TAG_OPERATION && ippGetValueTag(attr) == IPP_TAG_CHARSET)
-      charset = attr;
-    else
-      charset = NULL;
+      case IPP_OP_CREATE_JOB :
+	  ipp_create_job(client);
+	  break;
 
-    attr = ippNextAttribute(client->request);
-    name = ippGetName(attr);
+      case IPP_OP_SEND_DOCUMENT :
+	  ipp_send_document(client);
+	  break;
 
-    if (attr && name && !strcmp(name, "attributes-natural-language") && ippGetGroupTag(attr) == IPP_TAG_OPERATION && ippGetValueTag(attr) == IPP_TAG_LANGUAGE)
-      language = attr;
-    else
-      language = NULL;
+      case IPP_OP_SEND_URI :
+	  ipp_send_uri(client);
+	  break;
 
-    attr = ippNextAttribute(client->request);
-    name = ippGetName(attr);
+      case IPP_OP_CANCEL_JOB :
+	  ipp_cancel_job(client);
+	  break;
 
-    if (attr && name && (!strcmp(name, "system-uri") || !strcmp(name, "printer-uri") || !strcmp(name, "job-uri")) && ippGetGroupTag(attr) == IPP_TAG_OPERATION && ippGetValueTag(attr) == IPP_TAG_URI)
-      uri = attr;
-    else
-      uri = NULL;
+      case IPP_OP_CANCEL_CURRENT_JOB :
+	  ipp_cancel_current_job(client);
+	  break;
 
-    if (!uri && RelaxedConformance)
-    {
-     /*
-      * The target URI isn't where it is supposed to be.  See if it is
-      * elsewhere in the request...
-      */
+      case IPP_OP_CANCEL_JOBS :
+	  ipp_cancel_jobs(client);
+	  break;
 
-      if ((attr = ippFindAttribute(client->request, "system-uri", IPP_TAG_URI)) != NULL && ippGetGroupTag(attr) == IPP_TAG_OPERATION)
-	uri = attr;
-      else if ((attr = ippFindAttribute(client->request, "printer-uri", IPP_TAG_URI)) != NULL && ippGetGroupTag(attr) == IPP_TAG_OPERATION)
-	uri = attr;
-      else if ((attr = ippFindAttribute(client->request, "job-uri", IPP_TAG_URI)) != NULL && ippGetGroupTag(attr) == IPP_TAG_OPERATION)
-	uri = attr;
+      case IPP_OP_CANCEL_MY_JOBS :
+	  ipp_cancel_jobs(client);
+	  break;
 
-      if (uri)
-	serverLogClient(SERVER_LOGLEVEL_ERROR, client, "Target URI not the third attribute in the request (section 4.1.5 of RFC 8011).");
-    }
+      case IPP_OP_GET_JOB_ATTRIBUTES :
+	  ipp_get_job_attributes(client);
+	  break;
 
-    if (charset && strcasecmp(ippGetString(charset, 0, NULL), "us-ascii") && strcasecmp(ippGetString(charset, 0, NULL), "utf-8"))
-    {
-     /*
-      * Bad character set...
-      */
+      case IPP_OP_SET_JOB_ATTRIBUTES :
+	  ipp_set_job_attributes(client);
+	  break;
 
-      serverRespondIPP(client, IPP_STATUS_ERROR_BAD_REQUEST, "Unsupported character set \"%s\".", ippGetString(charset, 0, NULL));
-      goto send_response;
-    }
-    else if (!charset || !language || !uri)
-    {
-     /*
-      * Return an error, since attributes-charset,
-      * attributes-natural-language, and printer-uri/job-uri are required
-      * for all operations.
-      */
+      case IPP_OP_GET_JOBS :
+	  ipp_get_jobs(client);
+	  break;
 
-      serverRespondIPP(client, IPP_STATUS_ERROR_BAD_REQUEST, "Missing required attributes in request.");
-      goto send_response;
+      case IPP_OP_GET_PRINTER_ATTRIBUTES :
+	  ipp_get_printer_attributes(client);
+	  break;
+
+      case IPP_OP_GET_PRINTER_SUPPORTED_VALUES :
+	  ipp_get_printer_supported_values(client);
+	  break;
+
+      case IPP_OP_SET_PRINTER_ATTRIBUTES :
+	  ipp_set_printer_attributes(client);
+	  break;
+
+      case IPP_OP_CLOSE_JOB :
+	  ipp_close_job(client);
+	  break;
+
+      case IPP_OP_HOLD_JOB :
+	  ipp_hold_job(client);
+	  break;
+
+      case IPP_OP_HOLD_NEW_JOBS :
+	  ipp_hold_new_jobs(client);
+	  break;
+
+      case IPP_OP_RELEASE_JOB :
+	  ipp_release_job(client);
+	  break;
+
+      case IPP_OP_RELEASE_HELD_NEW_JOBS :
+	  ipp_release_held_new_jobs(client);
+	  break;
+
+      case IPP_OP_IDENTIFY_PRINTER :
+	  ipp_identify_printer(client);
+	  break;
+
+      case IPP_OP_CANCEL_SUBSCRIPTION :
+	  ipp_cancel_subscription(client);
+	  break;
+
+      case IPP_OP_CREATE_JOB_SUBSCRIPTIONS :
+      case IPP_OP_CREATE_PRINTER_SUBSCRIPTIONS :
+	  ipp_create_xxx_subscriptions(client);
+	  break;
+
+      case IPP_OP_GET_NOTIFICATIONS :
+	  ipp_get_notifications(client);
+	  break;
+
+      case IPP_OP_GET_SUBSCRIPTION_ATTRIBUTES :
+	  ipp_get_subscription_attributes(client);
+	  break;
+
+      case IPP_OP_GET_SUBSCRIPTIONS :
+	  ipp_get_subscriptions(client);
+	  break;
+
+      case IPP_OP_RENEW_SUBSCRIPTION :
+	  ipp_renew_subscription(client);
+	  break;
+
+      case IPP_OP_CANCEL_DOCUMENT :
+	  ipp_cancel_document(client);
+	  break;
+
+      case IPP_OP_GET_DOCUMENT_ATTRIBUTES :
+	  ipp_get_document_attributes(client);
+	  break;
+
+      case IPP_OP_GET_DOCUMENTS :
+	  ipp_get_documents(client);
+	  break;
+
+      case IPP_OP_SET_DOCUMENT_ATTRIBUTES :
+	  ipp_set_document_attributes(client);
+	  break;
+
+      case IPP_OP_VALIDATE_DOCUMENT :
+	  ipp_validate_document(client);
+	  break;
+
+      case IPP_OP_ACKNOWLEDGE_DOCUMENT :
+	  ipp_acknowledge_document(client);
+	  break;
+
+      case IPP_OP_ACKNOWLEDGE_IDENTIFY_PRINTER :
+	  ipp_acknowledge_identify_printer(client);
+	  break;
+
+      case IPP_OP_ACKNOWLEDGE_JOB :
+	  ipp_acknowledge_job(client);
+	  break;
+
+      case IPP_OP_FETCH_DOCUMENT :
+	  ipp_fetch_document(client);
+	  break;
+
+      case IPP_OP_FETCH_JOB :
+	  ipp_fetch_job(client);
+	  break;
+
+      case IPP_OP_GET_OUTPUT_DEVICE_ATTRIBUTES :
+	  ipp_get_output_device_attributes(client);
+	  break;
+
+      case IPP_OP_UPDATE_ACTIVE_JOBS :
+	  ipp_update_active_jobs(client);
+	  break;
+
+      case IPP_OP_UPDATE_DOCUMENT_STATUS :
+	  ipp_update_document_status(client);
+	  break;
+
+      case IPP_OP_UPDATE_JOB_STATUS :
+	  ipp_update_job_status(client);
+	  break;
+
+      case IPP_OP_UPDATE_OUTPUT_DEVICE_ATTRIBUTES :
+	  ipp_update_output_device_attributes(client);
+	  break;
+
+      case IPP_OP_DEREGISTER_OUTPUT_DEVICE :
+	  ipp_deregister_output_device(client);
+	  break;
+
+      case IPP_OP_SHUTDOWN_PRINTER :
+	  ipp_shutdown_printer(client);
+	  break;
+
+      case IPP_OP_STARTUP_PRINTER :
+	  ipp_startup_printer(client);
+	  break;
+
+      case IPP_OP_RESTART_PRINTER :
+	  ipp_restart_printer(client);
+	  break;
+
+      case IPP_OP_DISABLE_PRINTER :
+	  ipp_disable_printer(client);
+	  break;
+
+      case IPP_OP_ENABLE_PRINTER :
+	  ipp_enable_printer(client);
+	  break;
+
+      case IPP_OP_PAUSE_PRINTER :
+      case IPP_OP_PAUSE_PRINTER_AFTER_CURRENT_JOB :
+	  ipp_pause_printer(client);
+	  break;
+
+      case IPP_OP_RESUME_PRINTER :
+	  ipp_resume_printer(client);
+	  break;
+
+      case IPP_OP_ALLOCATE_PRINTER_RESOURCES :
+	  ipp_allocate_printer_resources(client);
+	  break;
+
+      case IPP_OP_DEALLOCATE_PRINTER_RESOURCES :
+	  ipp_deallocate_printer_resources(client);
+	  break;
+
+      default :
+	  serverRespondIPP(client, IPP_STATUS_ERROR_OPERATION_NOT_SUPPORTED, "Operation not supported.");
+	  break;
     }
-    else
+  }
+  else
+  {
+   /*
+    * Try processing the System operation...
+    */
+
+    if ((attr = ippFindAttribute(client->request, "printer-id", IPP_TAG_INTEGER)) != NULL)
     {
-      char	scheme[32],		/* URI scheme */
-		userpass[32],		/* Username/password in URI */
-		host[256],		/* Host name in URI */
-		resource[256],		/* Resource path in URI */
-		*resptr;		/* Pointer into resource path */
-      int	port;			/* Port number in URI */
+      int			printer_id = ippGetInteger(attr, 0);
+				    /* printer-id value */
+      server_printer_t	*printer;
+				    /* Current printer */
 
-      name            = ippGetName(uri);
-      client->printer = NULL;
 
-      if (httpSeparateURI(HTTP_URI_CODING_ALL, ippGetString(uri, 0, NULL), scheme, sizeof(scheme), userpass, sizeof(userpass), host, sizeof(host), &port, resource, sizeof(resource)) < HTTP_URI_STATUS_OK)
+      if (ippGetCount(attr) != 1 || ippGetGroupTag(attr) != IPP_TAG_OPERATION || printer_id <= 0)
       {
-	serverRespondIPP(client, IPP_STATUS_ERROR_ATTRIBUTES_OR_VALUES, "Bad \"%s\" value '%s'.", name, ippGetString(uri, 0, NULL));
+	serverRespondIPP(client, IPP_STATUS_ERROR_BAD_REQUEST, "Bad printer-id attribute.");
+	serverRespondUnsupported(client, attr);
 	goto send_response;
       }
-      else if (!strcmp(name, "job-uri"))
-      {
-       /*
-	* Validate job-uri...
-	*/
 
-	if (strncmp(resource, "/ipp/print/", 11))
-	{
-	  serverRespondIPP(client, IPP_STATUS_ERROR_NOT_FOUND, "\"%s\" '%s' not found.", name, ippGetString(uri, 0, NULL));
-	  goto send_response;
-	}
-	else
-	{
-	 /*
-	  * Strip job-id from resource...
-	  */
-
-	  if ((resptr = strchr(resource + 11, '/')) != NULL)
-	    *resptr = '\0';
-	  else
-	    resource[10] = '\0';
-
-	  if ((client->printer = serverFindPrinter(resource)) == NULL)
-	  {
-	    serverRespondIPP(client, IPP_STATUS_ERROR_NOT_FOUND, "\"%s\" '%s' not found.", name, ippGetString(uri, 0, NULL));
-	    goto send_response;
-	  }
-	}
-      }
-      else if ((client->printer = serverFindPrinter(resource)) == NULL)
+      _cupsRWLockRead(&PrintersRWLock);
+      for (printer = (server_printer_t *)cupsArrayFirst(Printers); printer; printer = (server_printer_t *)cupsArrayNext(Printers))
       {
-	if (strcmp(resource, "/ipp/system"))
+	if (printer->id == printer_id)
 	{
-	  serverRespondIPP(client, IPP_STATUS_ERROR_NOT_FOUND, "\"%s\" '%s' not found.", name, ippGetString(uri, 0, NULL));
-	  goto send_response;
+	  client->printer = printer;
+	  break;
 	}
       }
+      _cupsRWUnlock(&PrintersRWLock);
 
-      if (client->printer && client->printer->is_shutdown && ippGetOperation(client->request) != IPP_OP_STARTUP_PRINTER)
+      if (!client->printer)
       {
-	serverRespondIPP(client, IPP_STATUS_ERROR_SERVICE_UNAVAILABLE, "\"%s\" is shutdown.", client->printer->name);
+	serverRespondIPP(client, IPP_STATUS_ERROR_NOT_FOUND, "Unknown printer-id.");
+	serverRespondUnsupported(client, attr);
 	goto send_response;
       }
-      else if (client->printer)
+    }
+
+    if (ippGetStatusCode(client->response) == IPP_STATUS_OK)
+    {
+      switch ((int)ippGetOperation(client->request))
       {
-       /*
-	* Try processing the Printer operation...
-	*/
+	case IPP_OP_GET_PRINTER_ATTRIBUTES :
+	    if (DefaultPrinter)
+	    {
+	      client->printer = DefaultPrinter;
+	      ipp_get_printer_attributes(client);
+	    }
+	    else
+	    {
+	      serverRespondIPP(client, IPP_STATUS_ERROR_NOT_FOUND, "No default printer.");
+	    }
+	    break;
+
+	case IPP_OP_CANCEL_RESOURCE :
+	    ipp_cancel_resource(client);
+	    break;
+
+	case IPP_OP_CANCEL_SUBSCRIPTION :
+	    ipp_cancel_subscription(client);
+	    break;
+
+	case IPP_OP_CREATE_RESOURCE :
+	    ipp_create_resource(client);
+	    break;
+
+	case IPP_OP_CREATE_SYSTEM_SUBSCRIPTIONS :
+	    ipp_create_xxx_subscriptions(client);
+	    break;
+
+	case IPP_OP_GET_NOTIFICATIONS :
+	    ipp_get_notifications(client);
+	    break;
+
+	case IPP_OP_GET_RESOURCE_ATTRIBUTES :
+	    ipp_get_resource_attributes(client);
+	    break;
+
+	case IPP_OP_GET_RESOURCES :
+	    ipp_get_resources(client);
+	    break;
+
+	case IPP_OP_GET_SUBSCRIPTION_ATTRIBUTES :
+	    ipp_get_subscription_attributes(client);
+	    break;
+
+	case IPP_OP_GET_SUBSCRIPTIONS :
+	    ipp_get_subscriptions(client);
+	    break;
+
+	case IPP_OP_INSTALL_RESOURCE :
+	    ipp_install_resource(client);
+	    break;
+
+	case IPP_OP_RENEW_SUBSCRIPTION :
+	    ipp_renew_subscription(client);
+	    break;
+
+	case IPP_OP_SEND_RESOURCE_DATA :
+	    ipp_send_resource_data(client);
+	    break;
+
+	case IPP_OP_SET_RESOURCE_ATTRIBUTES :
+	    ipp_set_resource_attributes(client);
+	    break;
+
+	case IPP_OP_GET_SYSTEM_ATTRIBUTES :
+	    ipp_get_system_attributes(client);
+	    break;
+
+	case IPP_OP_GET_SYSTEM_SUPPORTED_VALUES :
+	    ipp_get_system_supported_values(client);
+	    break;
+
+	case IPP_OP_SET_SYSTEM_ATTRIBUTES :
+	    ipp_set_system_attributes(client);
+	    break;
+
+	case IPP_OP_CREATE_PRINTER :
+	    ipp_create_printer(client);
+	    break;
+
+	case IPP_OP_GET_PRINTERS :
+	    ipp_get_printers(client);
+	    break;
+
+	case IPP_OP_DELETE_PRINTER :
+	    if (client->printer)
+	      ipp_delete_printer(client);
+	    else
+	      serverRespondIPP(client, IPP_STATUS_ERROR_BAD_REQUEST, "Missing printer-id.");
+	    break;
+
+	case IPP_OP_DISABLE_ALL_PRINTERS :
+	    ipp_disable_all_printers(client);
+	    break;
+
+	case IPP_OP_ENABLE_ALL_PRINTERS :
+	    ipp_enable_all_printers(client);
+	    break;
+
+	case IPP_OP_PAUSE_ALL_PRINTERS :
+	case IPP_OP_PAUSE_ALL_PRINTERS_AFTER_CURRENT_JOB :
+	    ipp_pause_all_printers(client);
+	    break;
+
+	case IPP_OP_REGISTER_OUTPUT_DEVICE :
+	    ipp_register_output_device(client);
+	    break;
+
+	case IPP_OP_RESUME_ALL_PRINTERS :
+	    ipp_resume_all_printers(client);
+	    break;
+
+	case IPP_OP_SHUTDOWN_ALL_PRINTERS :
+	    ipp_shutdown_all_printers(client);
+	    break;
+
+	case IPP_OP_SHUTDOWN_ONE_PRINTER :
+	    if (client->printer)
+	      ipp_shutdown_printer(client);
+	    else
+	      serverRespondIPP(client, IPP_STATUS_ERROR_BAD_REQUEST, "Missing printer-id.");
+	    break;
+
+	case IPP_OP_RESTART_SYSTEM :
+	    ipp_restart_system(client);
+	    break;
+
+	case IPP_OP_STARTUP_ALL_PRINTERS :
+	    ipp_startup_all_printers(client);
+	    break;
+
+	case IPP_OP_STARTUP_ONE_PRINTER :
+	    if (client->printer)
+	      ipp_startup_printer(client);
+	    else
+	      serverRespondIPP(client, IPP_STATUS_ERROR_BAD_REQUEST, "Missing printer-id.");
+	    break;
+
+	default :
+	    serverRespondIPP(client, IPP_STATUS_ERROR_OPERATION_NOT_SUPPORTED, "Operation not supported.");
+	    break;
+      }
+    }
+  }
+
+ /*
+  * Send the HTTP header and return...
+  */
+
+  send_response:
+
+  SERVER_CLIENT_PHASE(client, SERVER_PHASE_OPERATION);
+
+  if (httpGetState(client->http) != HTTP_STATE_WAITING)
+  {
+    if (httpGetState(client->http) != HTTP_STATE_POST_SEND)
+      httpFlush(client->http);		/* Flush trailing (junk) data */
+
+    serverLogAttributes(client, "Response:", client->response, 2);
+
+    if (client->fetch_file < 0)
+      ret = serverRespondHTTP(client, HTTP_STATUS_OK, NULL, "application/ipp", serverEncodeResponse(client));
+    else if (!client->fetch_compression && (length = serverEncodeResponse(client)) > 0)
+      ret = serverRespondHTTP(client, HTTP_STATUS_OK, NULL, "application/ipp", length + client->fetch_length);
+    else
+      ret = serverRespondHTTP(client, HTTP_STATUS_OK, NULL, "application/ipp", 0);
+  }
+  else
+    ret = 1;
+
+  serverMetricsRequest(client->operation_id, serverGetTime() - start);
+
+  SERVER_TRACE3(request__end, client->number, client->operation_id, ippGetStatusCode(client->response));
+
+  return (ret);
+}
+
+
+/*
+ * 'serverRespondIPP()' - Send an IPP response.
+ */
+
+void
+serverRespondIPP(
+    server_client_t *client,		/* I - Client */
+    ipp_status_t    status,		/* I - status-code */
+    const char      *message,		/* I - printf-style status-message */
+    ...)				/* I - Additional args as needed */
+{
+  const char	*formatted = NULL;	/* Formatted message */
+
+
+  ippSetStatusCode(client->response, status);
+
+  if (message)
+  {
+    va_list		ap;		/* Pointer to additional args */
+    ipp_attribute_t	*attr;		/* New status-message attribute */
+
+    va_start(ap, message);
+    if ((attr = ippFindAttribute(client->response, "status-message",
+				 IPP_TAG_TEXT)) != NULL)
+      ippSetStringfv(client->response, &attr, 0, message, ap);
+    else
+      attr = ippAddStringfv(client->response, IPP_TAG_OPERATION, IPP_TAG_TEXT,
+			    "status-message", NULL, message, ap);
+    va_end(ap);
+
+    formatted = ippGetString(attr, 0, NULL);
+  }
+
+  if (formatted)
+    serverLogClient(SERVER_LOGLEVEL_INFO, client, "%s %s (%s)", ippOpString(client->operation_id), ippErrorString(status), formatted);
+  else
+    serverLogClient(SERVER_LOGLEVEL_INFO, client, "%s %s", ippOpString(client->operation_id), ippErrorString(status));
+}
+
+
+/*
+ * 'serverRespondUnsupported()' - Respond with an unsupported attribute.
+ */
+
+void
+serverRespondUnsupported(
+    server_client_t *client,		/* I - Client */
+    ipp_attribute_t *attr)		/* I - Atribute */
+{
+  ipp_attribute_t	*temp;		/* Copy of attribute */
 
-	switch ((int)ippGetOperation(client->request))
-	{
-	  case IPP_OP_PRINT_JOB :
-	      ipp_print_job(client);
-	      break;
 
-	  case IPP_OP_PRINT_URI :
-	      ipp_print_uri(client);
-	      break;
+  if (ippGetStatusCode(client->response) == IPP_STATUS_OK)
+    serverRespondIPP(client, IPP_STATUS_ERROR_ATTRIBUTES_OR_VALUES, "Unsupported %s %s%s value.", ippGetName(attr), ippGetCount(attr) > 1 ? "1setOf " : "", ippTagString(ippGetValueTag(attr)));
 
-	  case IPP_OP_VALIDATE_JOB :
-	      ipp_validate_job(client);
-	      break;
+  temp = ippCopyAttribute(client->response, attr, 0);
+  ippSetGroupTag(client->response, &temp, IPP_TAG_UNSUPPORTED_GROUP);
+}
 
-	  case IPP_OP_CREATE_JOB :
-	      ipp_create_job(client);
-	      break;
 
-	  case IPP_OP_SEND_DOCUMENT :
-	      ipp_send_document(client);
-	      break;
+/*
+ * 'respond_unsettable()' - Respond with an unsettable attribute.
+ */
 
-	  case IPP_OP_SEND_URI :
-	      ipp_send_uri(client);
-	      break;
+static void
+respond_unsettable(
+    server_client_t *client,		/* I - Client */
+    ipp_attribute_t *attr)		/* I - Unsettable attribute */
+{
+  const char	*name = ippGetName(attr);
+					/* Attribute name */
 
-	  case IPP_OP_CANCEL_JOB :
-	      ipp_cancel_job(client);
-	      break;
 
-	  case IPP_OP_CANCEL_CURRENT_JOB :
-	      ipp_cancel_current_job(client);
-	      break;
+  if (ippGetStatusCode(client->response) != IPP_STATUS_OK)
+    serverRespondIPP(client, IPP_STATUS_ERROR_ATTRIBUTES_NOT_SETTABLE, "Unsettable %s attribute.", name);
 
-	  case IPP_OP_CANCEL_JOBS :
-	      ipp_cancel_jobs(client);
-	      break;
+  ippAddOutOfBand(client->response, IPP_TAG_UNSUPPORTED_GROUP, IPP_TAG_NOTSETTABLE, name);
+}
 
-	  case IPP_OP_CANCEL_MY_JOBS :
-	      ipp_cancel_jobs(client);
-	      break;
 
-	  case IPP_OP_GET_JOB_ATTRIBUTES :
-	      ipp_get_job_attributes(client);
-	      break;
+/*
+ * 'sniff_data()' - Analyze the next block of document data.
+ *
+ * PWG and Apple raster pages are counted as their headers arrive by walking
+ * the compressed lines, and the page count of a PDF file is taken from its
+ * page tree once the cross-reference table is reached.
+ */
 
-	  case IPP_OP_SET_JOB_ATTRIBUTES :
-	      ipp_set_job_attributes(client);
-	      break;
+static int				/* O - Number of pages or 0 if not known */
+sniff_data(server_sniff_t      *sniff,	/* I - Document analyzer */
+           const unsigned char *buffer,	/* I - Document data */
+           size_t              bytes)	/* I - Number of bytes */
+{
+  const unsigned char	*bufptr,	/* Pointer into buffer */
+			*bufend;	/* End of buffer */
+  size_t		count,		/* Number of bytes to copy or skip */
+			size;		/* Size of header */
+  unsigned		pixels;		/* Number of pixels */
 
-	  case IPP_OP_GET_JOBS :
-	      ipp_get_jobs(client);
-	      break;
 
-	  case IPP_OP_GET_PRINTER_ATTRIBUTES :
-	      ipp_get_printer_attributes(client);
-	      break;
+  bufend = buffer + bytes;
 
-	  case IPP_OP_GET_PRINTER_SUPPORTED_VALUES :
-	      ipp_get_printer_supported_values(client);
-	      break;
+  if (sniff->type == SNIFF_PDF)
+  {
+    for (bufptr = buffer; bufptr < bufend; bufptr ++)
+    {
+      if (sniff->in_comment)
+      {
+        if (*bufptr == '\n' || *bufptr == '\r')
+          sniff->in_comment = 0;
+        continue;
+      }
+      else if (sniff->in_stream)
+      {
+       /*
+        * Skip stream data up to the "endstream" keyword...
+        */
 
-	  case IPP_OP_SET_PRINTER_ATTRIBUTES :
-	      ipp_set_printer_attributes(client);
-	      break;
+        if (*bufptr == "endstream"[sniff->match])
+        {
+          if (++ sniff->match == 9)
+            sniff->in_stream = 0;
+        }
+        else
+          sniff->match = *bufptr == 'e';
+        continue;
+      }
 
-	  case IPP_OP_CLOSE_JOB :
-	      ipp_close_job(client);
-	      break;
+      switch (*bufptr)
+      {
+        case '\0' :
+        case '\t' :
+        case '\n' :
+        case '\f' :
+        case '\r' :
+        case ' ' :
+        case '(' :
+        case ')' :
+        case '<' :
+        case '>' :
+        case '[' :
+        case ']' :
+        case '{' :
+        case '}' :
+            if (sniff->toklen > 0)
+              sniff_pdf_token(sniff);
+            break;
 
-	  case IPP_OP_HOLD_JOB :
-	      ipp_hold_job(client);
-	      break;
+        case '/' :
+            if (sniff->toklen > 0)
+              sniff_pdf_token(sniff);
 
-	  case IPP_OP_HOLD_NEW_JOBS :
-	      ipp_hold_new_jobs(client);
-	      break;
+            sniff->token[sniff->toklen ++] = '/';
+            break;
 
-	  case IPP_OP_RELEASE_JOB :
-	      ipp_release_job(client);
-	      break;
+        case '%' :
+            if (sniff->toklen > 0)
+              sniff_pdf_token(sniff);
 
-	  case IPP_OP_RELEASE_HELD_NEW_JOBS :
-	      ipp_release_held_new_jobs(client);
-	      break;
+            sniff->in_comment = 1;
+            break;
 
-	  case IPP_OP_IDENTIFY_PRINTER :
-	      ipp_identify_printer(client);
-	      break;
+        default :
+            if (sniff->toklen < (sizeof(sniff->token) - 1))
+              sniff->token[sniff->toklen ++] = (char)*bufptr;
+            else
+              sniff->toklen = sizeof(sniff->token);
+            break;
+      }
+    }
 
-	  case IPP_OP_CANCEL_SUBSCRIPTION :
-	      ipp_cancel_subscription(client);
-	      break;
+    return (sniff->total);
+  }
 
-	  case IPP_OP_CREATE_JOB_SUBSCRIPTIONS :
-	  case IPP_OP_CREATE_PRINTER_SUBSCRIPTIONS :
-	      ipp_create_xxx_subscriptions(client);
-	      break;
+  for (bufptr = buffer; bufptr < bufend && sniff->type != SNIFF_NONE;)
+  {
+    switch (sniff->state)
+    {
+      case SNIFF_FILE :
+      case SNIFF_PAGE :
+         /*
+          * Collect the file or page header...
+          */
 
-	  case IPP_OP_GET_NOTIFICATIONS :
-	      ipp_get_notifications(client);
-	      break;
+          if (sniff->state == SNIFF_FILE)
+            size = sniff->type == SNIFF_PWG ? 4 : 12;
+          else
+            size = sniff->type == SNIFF_PWG ? 1796 : 32;
 
-	  case IPP_OP_GET_SUBSCRIPTION_ATTRIBUTES :
-	      ipp_get_subscription_attributes(client);
-	      break;
+          count = size - sniff->used;
+          if (count > (size_t)(bufend - bufptr))
+            count = (size_t)(bufend - bufptr);
 
-	  case IPP_OP_GET_SUBSCRIPTIONS :
-	      ipp_get_subscriptions(client);
-	      break;
+          memcpy(sniff->header + sniff->used, bufptr, count);
+          sniff->used += count;
+          bufptr      += count;
 
-	  case IPP_OP_RENEW_SUBSCRIPTION :
-	      ipp_renew_subscription(client);
-	      break;
+          if (sniff->used < size)
+            break;
 
-	  case IPP_OP_CANCEL_DOCUMENT :
-	      ipp_cancel_document(client);
-	      break;
+          sniff->used = 0;
 
-	  case IPP_OP_GET_DOCUMENT_ATTRIBUTES :
-	      ipp_get_document_attributes(client);
-	      break;
+          if (sniff->state == SNIFF_FILE)
+          {
+           /*
+            * Check the sync word; Apple raster files also have the total
+            * number of pages...
+            */
 
-	  case IPP_OP_GET_DOCUMENTS :
-	      ipp_get_documents(client);
-	      break;
+            if (memcmp(sniff->header, sniff->type == SNIFF_PWG ? "RaS2" : "UNIRAST", sniff->type == SNIFF_PWG ? 4 : 8))
+              sniff->type = SNIFF_NONE;
+            else if (sniff->type == SNIFF_URF && SNIFF_BE32(sniff->header + 8) <= INT_MAX)
+              sniff->total = (int)SNIFF_BE32(sniff->header + 8);
 
-	  case IPP_OP_SET_DOCUMENT_ATTRIBUTES :
-	      ipp_set_document_attributes(client);
-	      break;
+            sniff->state = SNIFF_PAGE;
+            break;
+          }
 
-	  case IPP_OP_VALIDATE_DOCUMENT :
-	      ipp_validate_document(client);
-	      break;
+          if (sniff->type == SNIFF_PWG)
+          {
+           /*
+            * PWG raster page header; the first one may have the total number
+            * of pages (TotalPageCount)...
+            */
 
-	  case IPP_OP_ACKNOWLEDGE_DOCUMENT :
-	      ipp_acknowledge_document(client);
-	      break;
+            unsigned bits = SNIFF_BE32(sniff->header + 388),
+					/* cupsBitsPerPixel */
+		order = SNIFF_BE32(sniff->header + 396),
+					/* cupsColorOrder */
+		bpl = SNIFF_BE32(sniff->header + 392);
+					/* cupsBytesPerLine */
 
-	  case IPP_OP_ACKNOWLEDGE_IDENTIFY_PRINTER :
-	      ipp_acknowledge_identify_printer(client);
-	      break;
+            if (order != 0)
+              bits = SNIFF_BE32(sniff->header + 384);
 
-	  case IPP_OP_ACKNOWLEDGE_JOB :
-	      ipp_acknowledge_job(client);
-	      break;
+            sniff->bpp   = bits > 8 ? (bits + 7) / 8 : 1;
+            sniff->width = bpl / sniff->bpp;
+            sniff->lines = SNIFF_BE32(sniff->header + 376);
 
-	  case IPP_OP_FETCH_DOCUMENT :
-	      ipp_fetch_document(client);
-	      break;
+            if (order == 2)
+              sniff->lines *= SNIFF_BE32(sniff->header + 420);
 
-	  case IPP_OP_FETCH_JOB :
-	      ipp_fetch_job(client);
-	      break;
+            if (sniff->pages == 0 && SNIFF_BE32(sniff->header + 452) <= INT_MAX)
+              sniff->total = (int)SNIFF_BE32(sniff->header + 452);
 
-	  case IPP_OP_GET_OUTPUT_DEVICE_ATTRIBUTES :
-	      ipp_get_output_device_attributes(client);
-	      break;
+            if ((bpl % sniff->bpp) != 0)
+              sniff->width = 0;
+          }
+          else
+          {
+           /*
+            * Apple raster page header...
+            */
 
-	  case IPP_OP_UPDATE_ACTIVE_JOBS :
-	      ipp_update_active_jobs(client);
-	      break;
+            sniff->bpp   = sniff->header[0] > 8 ? (sniff->header[0] + 7U) / 8 : 1;
+            sniff->width = SNIFF_BE32(sniff->header + 12) * sniff->header[0] / 8 / sniff->bpp;
+            sniff->lines = SNIFF_BE32(sniff->header + 16);
+          }
 
-	  case IPP_OP_UPDATE_DOCUMENT_STATUS :
-	      ipp_update_document_status(client);
-	      break;
+          if (sniff->width == 0 || sniff->lines == 0 || sniff->bpp > 30)
+          {
+           /*
+            * Bad header, stop counting pages...
+            */
 
-	  case IPP_OP_UPDATE_JOB_STATUS :
-	      ipp_update_job_status(client);
-	      break;
+            sniff->type = SNIFF_NONE;
+            break;
+          }
 
-	  case IPP_OP_UPDATE_OUTPUT_DEVICE_ATTRIBUTES :
-	      ipp_update_output_device_attributes(client);
-	      break;
+          sniff->pages ++;
+          sniff->state = SNIFF_LINE;
+          break;
 
-	  case IPP_OP_DEREGISTER_OUTPUT_DEVICE :
-	      ipp_deregister_output_device(client);
-	      break;
+      case SNIFF_LINE :
+         /*
+          * Start a line (or a run of identical lines)...
+          */
 
-	  case IPP_OP_SHUTDOWN_PRINTER :
-	      ipp_shutdown_printer(client);
-	      break;
+          if ((unsigned)*bufptr + 1 < sniff->lines)
+            sniff->lines -= (unsigned)*bufptr + 1;
+          else
+            sniff->lines = 0;
 
-	  case IPP_OP_STARTUP_PRINTER :
-	      ipp_startup_printer(client);
-	      break;
+          bufptr ++;
 
-	  case IPP_OP_RESTART_PRINTER :
-	      ipp_restart_printer(client);
-	      break;
+          sniff->x     = 0;
+          sniff->state = SNIFF_PACKET;
+          break;
 
-	  case IPP_OP_DISABLE_PRINTER :
-	      ipp_disable_printer(client);
-	      break;
+      case SNIFF_PACKET :
+         /*
+          * Skip a run of repeated or literal pixels...
+          */
+
+          if (*bufptr == 128)
+          {
+            sniff->x    = sniff->width;
+            sniff->skip = 0;
+          }
+          else
+          {
+            if (*bufptr & 128)
+              pixels = 257 - (unsigned)*bufptr;
+            else
+              pixels = (unsigned)*bufptr + 1;
+
+            if (pixels > (sniff->width - sniff->x))
+              pixels = sniff->width - sniff->x;
+
+            sniff->skip = (*bufptr & 128) ? pixels * sniff->bpp : sniff->bpp;
+            sniff->x    += pixels;
+          }
+
+          bufptr ++;
+
+          sniff->state = SNIFF_SKIP;
+          break;
 
-	  case IPP_OP_ENABLE_PRINTER :
-	      ipp_enable_printer(client);
-	      break;
+      case SNIFF_SKIP :
+          count = sniff->skip;
+          if (count > (size_t)(bufend - bufptr))
+            count = (size_t)(bufend - bufptr);
 
-	  case IPP_OP_PAUSE_PRINTER :
-	  case IPP_OP_PAUSE_PRINTER_AFTER_CURRENT_JOB :
-	      ipp_pause_printer(client);
-	      break;
+          bufptr      += count;
+          sniff->skip -= count;
 
-	  case IPP_OP_RESUME_PRINTER :
-	      ipp_resume_printer(client);
-	      break;
+          if (sniff->skip > 0)
+            break;
+          else if (sniff->x < sniff->width)
+            sniff->state = SNIFF_PACKET;
+          else if (sniff->lines > 0)
+            sniff->state = SNIFF_LINE;
+          else
+            sniff->state = SNIFF_PAGE;
+          break;
+    }
+  }
 
-	  case IPP_OP_ALLOCATE_PRINTER_RESOURCES :
-	      ipp_allocate_printer_resources(client);
-	      break;
+  return (sniff->total > sniff->pages ? sniff->total : sniff->pages);
+}
 
-	  case IPP_OP_DEALLOCATE_PRINTER_RESOURCES :
-	      ipp_deallocate_printer_resources(client);
-	      break;
 
-	  default :
-	      serverRespondIPP(client, IPP_STATUS_ERROR_OPERATION_NOT_SUPPORTED, "Operation not supported.");
-	      break;
-	}
-      }
-      else if (!strcmp(resource, "/ipp/system"))
-      {
-       /*
-	* Try processing the System operation...
-	*/
+/*
+ * 'sniff_init()' - Initialize a document analyzer for the given format.
+ */
 
-	if ((attr = ippFindAttribute(client->request, "printer-id", IPP_TAG_INTEGER)) != NULL)
-	{
-	  int			printer_id = ippGetInteger(attr, 0);
-					/* printer-id value */
-	  server_printer_t	*printer;
-					/* Current printer */
+static int				/* O - 1 if the format is supported, 0 otherwise */
+sniff_init(server_sniff_t *sniff,	/* I - Document analyzer */
+           const char     *format)	/* I - MIME media type */
+{
+  memset(sniff, 0, sizeof(server_sniff_t));
+
+  if (!format)
+    sniff->type = SNIFF_NONE;
+  else if (!strcmp(format, "application/pdf"))
+    sniff->type = SNIFF_PDF;
+  else if (!strcmp(format, "image/pwg-raster"))
+    sniff->type = SNIFF_PWG;
+  else if (!strcmp(format, "image/urf"))
+    sniff->type = SNIFF_URF;
+
+  return (sniff->type != SNIFF_NONE);
+}
 
 
-	  if (ippGetCount(attr) != 1 || ippGetGroupTag(attr) != IPP_TAG_OPERATION || printer_id <= 0)
-	  {
-	    serverRespondIPP(client, IPP_STATUS_ERROR_BAD_REQUEST, "Bad printer-id attribute.");
-	    serverRespondUnsupported(client, attr);
-	    goto send_response;
-	  }
+/*
+ * 'sniff_pdf_token()' - Process a PDF token.
+ *
+ * The page count is the largest /Count of the /Type /Pages objects that have
+ * been seen, and it is only reported once a "startxref" is found since the
+ * page tree of an updated file can follow the first cross-reference table.
+ */
 
-	  _cupsRWLockRead(&PrintersRWLock);
-	  for (printer = (server_printer_t *)cupsArrayFirst(Printers); printer; printer = (server_printer_t *)cupsArrayNext(Printers))
-	  {
-	    if (printer->id == printer_id)
-	    {
-	      client->printer = printer;
-	      break;
-	    }
-	  }
-	  _cupsRWUnlock(&PrintersRWLock);
+static void
+sniff_pdf_token(server_sniff_t *sniff)	/* I - Document analyzer */
+{
+  const char	*token = sniff->token;	/* Current token */
 
-	  if (!client->printer)
-	  {
-	    serverRespondIPP(client, IPP_STATUS_ERROR_NOT_FOUND, "Unknown printer-id.");
-	    serverRespondUnsupported(client, attr);
-	    goto send_response;
-	  }
-	}
 
-	if (ippGetStatusCode(client->response) == IPP_STATUS_OK)
-	{
-	  switch ((int)ippGetOperation(client->request))
-	  {
-	    case IPP_OP_GET_PRINTER_ATTRIBUTES :
-		if (DefaultPrinter)
-		{
-		  client->printer = DefaultPrinter;
-		  ipp_get_printer_attributes(client);
-		}
-		else
-		{
-		  serverRespondIPP(client, IPP_STATUS_ERROR_NOT_FOUND, "No default printer.");
-		}
-		break;
-
-	    case IPP_OP_CANCEL_RESOURCE :
-		ipp_cancel_resource(client);
-		break;
-
-	    case IPP_OP_CANCEL_SUBSCRIPTION :
-		ipp_cancel_subscription(client);
-		break;
-
-	    case IPP_OP_CREATE_RESOURCE :
-		ipp_create_resource(client);
-		break;
-
-	    case IPP_OP_CREATE_SYSTEM_SUBSCRIPTIONS :
-		ipp_create_xxx_subscriptions(client);
-		break;
-
-	    case IPP_OP_GET_NOTIFICATIONS :
-		ipp_get_notifications(client);
-		break;
-
-	    case IPP_OP_GET_RESOURCE_ATTRIBUTES :
-		ipp_get_resource_attributes(client);
-		break;
-
-	    case IPP_OP_GET_RESOURCES :
-		ipp_get_resources(client);
-		break;
-
-	    case IPP_OP_GET_SUBSCRIPTION_ATTRIBUTES :
-		ipp_get_subscription_attributes(client);
-		break;
-
-	    case IPP_OP_GET_SUBSCRIPTIONS :
-		ipp_get_subscriptions(client);
-		break;
-
-	    case IPP_OP_INSTALL_RESOURCE :
-		ipp_install_resource(client);
-		break;
-
-	    case IPP_OP_RENEW_SUBSCRIPTION :
-		ipp_renew_subscription(client);
-		break;
-
-	    case IPP_OP_SEND_RESOURCE_DATA :
-		ipp_send_resource_data(client);
-		break;
-
-	    case IPP_OP_SET_RESOURCE_ATTRIBUTES :
-		ipp_set_resource_attributes(client);
-		break;
-
-	    case IPP_OP_GET_SYSTEM_ATTRIBUTES :
-		ipp_get_system_attributes(client);
-		break;
-
-	    case IPP_OP_GET_SYSTEM_SUPPORTED_VALUES :
-		ipp_get_system_supported_values(client);
-		break;
-
-	    case IPP_OP_SET_SYSTEM_ATTRIBUTES :
-		ipp_set_system_attributes(client);
-		break;
-
-	    case IPP_OP_CREATE_PRINTER :
-		ipp_create_printer(client);
-		break;
-
-	    case IPP_OP_GET_PRINTERS :
-		ipp_get_printers(client);
-		break;
-
-	    case IPP_OP_DELETE_PRINTER :
-		if (client->printer)
-		  ipp_delete_printer(client);
-		else
-		  serverRespondIPP(client, IPP_STATUS_ERROR_BAD_REQUEST, "Missing printer-id.");
-		break;
-
-	    case IPP_OP_DISABLE_ALL_PRINTERS :
-		ipp_disable_all_printers(client);
-		break;
-
-	    case IPP_OP_ENABLE_ALL_PRINTERS :
-		ipp_enable_all_printers(client);
-		break;
-
-	    case IPP_OP_PAUSE_ALL_PRINTERS :
-	    case IPP_OP_PAUSE_ALL_PRINTERS_AFTER_CURRENT_JOB :
-		ipp_pause_all_printers(client);
-		break;
-
-	    case IPP_OP_REGISTER_OUTPUT_DEVICE :
-		ipp_register_output_device(client);
-		break;
-
-	    case IPP_OP_RESUME_ALL_PRINTERS :
-		ipp_resume_all_printers(client);
-		break;
-
-	    case IPP_OP_SHUTDOWN_ALL_PRINTERS :
-		ipp_shutdown_all_printers(client);
-		break;
-
-	    case IPP_OP_SHUTDOWN_ONE_PRINTER :
-	        if (client->printer)
-		  ipp_shutdown_printer(client);
-		else
-		  serverRespondIPP(client, IPP_STATUS_ERROR_BAD_REQUEST, "Missing printer-id.");
-		break;
-
-	    case IPP_OP_RESTART_SYSTEM :
-		ipp_restart_system(client);
-		break;
-
-	    case IPP_OP_STARTUP_ALL_PRINTERS :
-		ipp_startup_all_printers(client);
-		break;
-
-	    case IPP_OP_STARTUP_ONE_PRINTER :
-	        if (client->printer)
-		  ipp_startup_printer(client);
-		else
-		  serverRespondIPP(client, IPP_STATUS_ERROR_BAD_REQUEST, "Missing printer-id.");
-		break;
-
-	    default :
-		serverRespondIPP(client, IPP_STATUS_ERROR_OPERATION_NOT_SUPPORTED, "Operation not supported.");
-		break;
-	  }
-	}
-      }
-    }
-  }
+  if (sniff->toklen >= sizeof(sniff->token))
+  {
+   /*
+    * Ignore long tokens...
+    */
 
- /*
-  * Send the HTTP header and return...
-  */
+    sniff->toklen = 0;
+    return;
+  }
 
-  send_response:
+  sniff->token[sniff->toklen] = '\0';
+  sniff->toklen               = 0;
 
-  if (httpGetState(client->http) != HTTP_STATE_WAITING)
+  if (!strcmp(token, "stream"))
   {
-    if (httpGetState(client->http) != HTTP_STATE_POST_SEND)
-      httpFlush(client->http);		/* Flush trailing (junk) data */
-
-    serverLogAttributes(client, "Response:", client->response, 2);
+    sniff->in_stream = 1;
+    sniff->match     = 0;
+  }
+  else if (!strcmp(token, "obj") || !strcmp(token, "endobj"))
+  {
+    if (sniff->in_pages && sniff->count > sniff->pages)
+      sniff->pages = sniff->count;
 
-    return (serverRespondHTTP(client, HTTP_STATUS_OK, NULL, "application/ipp", client->fetch_file >= 0 ? 0 : ippLength(client->response)));
+    sniff->in_pages   = 0;
+    sniff->count      = 0;
+    sniff->want_count = 0;
+    sniff->want_type  = 0;
+  }
+  else if (!strcmp(token, "startxref"))
+  {
+    sniff->total = sniff->pages;
+  }
+  else if (!strcmp(token, "/Type"))
+  {
+    sniff->want_type = 1;
+  }
+  else if (!strcmp(token, "/Count"))
+  {
+    sniff->want_count = 1;
   }
   else
-    return (1);
+  {
+    if (sniff->want_type && !strcmp(token, "/Pages"))
+      sniff->in_pages = 1;
+    else if (sniff->want_count && isdigit(*token & 255))
+      sniff->count = atoi(token);
+
+    sniff->want_count = 0;
+    sniff->want_type  = 0;
+  }
 }
 
 
 /*
- * 'serverRespondIPP()' - Send an IPP response.
+ * 'stream_job_data()' - Copy document data to the spool file and the job's
+ *                       transform command, if any.
+ *
+ * Like _httpReadFile, -1 is returned on error with httpError() set for read
+ * errors and errno set for spool file write errors.  The stream pipe is always
+ * closed, and on error the job is aborted.
+ *
+ * The "job-k-octets" and "job-impressions" values are updated as the data
+ * arrives so they are available before the job is processed.
  */
 
-void
-serverRespondIPP(
+static ssize_t				/* O - Number of bytes copied or -1 on error */
+stream_job_data(
     server_client_t *client,		/* I - Client */
-    ipp_status_t    status,		/* I - status-code */
-    const char      *message,		/* I - printf-style status-message */
-    ...)				/* I - Additional args as needed */
+    server_job_t    *job)		/* I - Job */
 {
-  const char	*formatted = NULL;	/* Formatted message */
+  ssize_t	bytes,			/* Bytes read */
+		written,		/* Bytes written to pipe */
+		total = 0;		/* Total bytes copied */
+  char		buffer[32768];		/* Copy buffer */
+  int		error = 0;		/* Write error */
+  server_sniff_t sniff;			/* Document analyzer */
+  int		pages = 0,		/* Number of pages */
+		temp_pages;		/* New number of pages */
+  off_t		length;			/* Size reported in job-k-octets */
 
 
-  ippSetStatusCode(client->response, status);
+  sniff_init(&sniff, job->format);
 
-  if (message)
+  length = httpIsChunked(client->http) ? 0 : (off_t)httpGetRemaining(client->http);
+
+  while ((bytes = httpRead2(client->http, buffer, sizeof(buffer))) > 0)
   {
-    va_list		ap;		/* Pointer to additional args */
-    ipp_attribute_t	*attr;		/* New status-message attribute */
+    if (write(job->fd, buffer, (size_t)bytes) < bytes)
+    {
+      error = errno;
+      break;
+    }
 
-    va_start(ap, message);
-    if ((attr = ippFindAttribute(client->response, "status-message",
-				 IPP_TAG_TEXT)) != NULL)
-      ippSetStringfv(client->response, &attr, 0, message, ap);
-    else
-      attr = ippAddStringfv(client->response, IPP_TAG_OPERATION, IPP_TAG_TEXT,
-			    "status-message", NULL, message, ap);
-    va_end(ap);
+    total += bytes;
 
-    formatted = ippGetString(attr, 0, NULL);
+    temp_pages = sniff.type != SNIFF_NONE ? sniff_data(&sniff, (unsigned char *)buffer, (size_t)bytes) : 0;
+
+    if (temp_pages != pages || ((total + 1023) / 1024) > ((length + 1023) / 1024))
+    {
+      pages = temp_pages;
+
+      if (total > length)
+        length = total;
+
+      update_job_size(job, length, pages);
+    }
+
+    for (written = 0; job->stream_fd >= 0 && written < bytes;)
+    {
+      ssize_t temp = write(job->stream_fd, buffer + written, (size_t)(bytes - written));
+					/* Bytes written */
+
+      if (temp < 0)
+      {
+        if (errno == EINTR)
+          continue;
+
+       /*
+        * The command stopped reading, keep spooling the rest so the job
+        * file is complete...
+        */
+
+        serverLogJob(SERVER_LOGLEVEL_ERROR, job, "Unable to stream document data: %s", strerror(errno));
+        close(job->stream_fd);
+        job->stream_fd = -1;
+      }
+      else
+        written += temp;
+    }
   }
 
-  if (formatted)
-    serverLogClient(SERVER_LOGLEVEL_INFO, client, "%s %s (%s)", ippOpString(client->operation_id), ippErrorString(status), formatted);
-  else
-    serverLogClient(SERVER_LOGLEVEL_INFO, client, "%s %s", ippOpString(client->operation_id), ippErrorString(status));
-}
+  if (job->stream_fd >= 0)
+  {
+    close(job->stream_fd);
+    job->stream_fd = -1;
+  }
 
+  if (!error && bytes == 0)
+  {
+    SERVER_LOG_JOB_DEBUG(job, "Copied %ld bytes of document data, %d pages.", (long)total, pages);
+    return (total);
+  }
 
-/*
- * 'serverRespondUnsupported()' - Respond with an unsupported attribute.
- */
+ /*
+  * Abort the job and stop the command...
+  */
 
-void
-serverRespondUnsupported(
-    server_client_t *client,		/* I - Client */
-    ipp_attribute_t *attr)		/* I - Atribute */
-{
-  ipp_attribute_t	*temp;		/* Copy of attribute */
+  _cupsRWLockWrite(&job->rwlock);
 
+  SERVER_SEQ_BEGIN(job->status_seq);
+  job->state = IPP_JSTATE_ABORTED;
+  SERVER_SEQ_END(job->status_seq);
 
-  if (ippGetStatusCode(client->response) == IPP_STATUS_OK)
-    serverRespondIPP(client, IPP_STATUS_ERROR_ATTRIBUTES_OR_VALUES, "Unsupported %s %s%s value.", ippGetName(attr), ippGetCount(attr) > 1 ? "1setOf " : "", ippTagString(ippGetValueTag(attr)));
+#ifndef _WIN32
+  if (job->transform_pid)
+    kill(job->transform_pid, SIGTERM);
+#endif /* !_WIN32 */
+
+  _cupsRWUnlock(&job->rwlock);
 
-  temp = ippCopyAttribute(client->response, attr, 0);
-  ippSetGroupTag(client->response, &temp, IPP_TAG_UNSUPPORTED_GROUP);
+  errno = error;
+
+  return (-1);
 }
 
 
 /*
- * 'respond_unsettable()' - Respond with an unsettable attribute.
+ * 'update_job_size()' - Update the size and impression count of a job.
+ *
+ * The size and impressions are for the current document and replace its
+ * earlier values in the job totals.
  */
 
 static void
-respond_unsettable(
-    server_client_t *client,		/* I - Client */
-    ipp_attribute_t *attr)		/* I - Unsettable attribute */
+update_job_size(server_job_t *job,	/* I - Job */
+                off_t        bytes,	/* I - Size of document data */
+                int          impressions)
+					/* I - Number of impressions or 0 if not known */
 {
-  const char	*name = ippGetName(attr);
-					/* Attribute name */
+  ipp_attribute_t	*attr;		/* job-k-octets attribute */
+  int			k_octets = (int)((bytes + 1023) / 1024);
+					/* Size in kilobytes */
 
 
-  if (ippGetStatusCode(client->response) != IPP_STATUS_OK)
-    serverRespondIPP(client, IPP_STATUS_ERROR_ATTRIBUTES_NOT_SETTABLE, "Unsettable %s attribute.", name);
+  _cupsRWLockWrite(&job->rwlock);
 
-  ippAddOutOfBand(client->response, IPP_TAG_UNSUPPORTED_GROUP, IPP_TAG_NOTSETTABLE, name);
+  if ((attr = ippFindAttribute(job->attrs, "job-k-octets", IPP_TAG_ZERO)) != NULL && ippGetValueTag(attr) == IPP_TAG_INTEGER)
+    ippSetInteger(job->attrs, &attr, 0, ippGetInteger(attr, 0) - job->doc_k_octets + k_octets);
+  else if (!attr)
+    ippAddInteger(job->attrs, IPP_TAG_JOB, IPP_TAG_INTEGER, "job-k-octets", k_octets);
+
+  job->doc_k_octets = k_octets;
+
+  if (impressions > 0)
+  {
+    job->impressions     += impressions - job->doc_impressions;
+    job->doc_impressions = impressions;
+  }
+
+  _cupsRWUnlock(&job->rwlock);
 }
 
 
@@ -8913,13 +10171,26 @@ valid_doc_attributes(
 					/* IPP operation */
   const char		*op_name = ippOpString(op);
 					/* IPP operation name */
-  ipp_attribute_t	*attr,		/* Current attribute */
-			*supported;	/* xxx-supported attribute */
+  ipp_attribute_t	*attr;		/* Current attribute */
+  server_vcache_t	*vcache;	/* Validation values */
   const char		*compression = NULL,
 					/* compression value */
 			*format = NULL;	/* document-format value */
 
 
+ /*
+  * Get the supported values...
+  */
+
+  _cupsRWLockRead(&client->printer->rwlock);
+
+  if ((vcache = serverGetPrinterValidationNoLock(client->printer)) == NULL)
+  {
+    _cupsRWUnlock(&client->printer->rwlock);
+    serverRespondIPP(client, IPP_STATUS_ERROR_INTERNAL, "Unable to allocate memory.");
+    return (0);
+  }
+
  /*
   * Check operation attributes...
   */
@@ -8932,21 +10203,19 @@ valid_doc_attributes(
     */
 
     compression = ippGetString(attr, 0, NULL);
-    supported   = ippFindAttribute(client->printer->pinfo.attrs,
-                                   "compression-supported", IPP_TAG_KEYWORD);
 
     if (ippGetCount(attr) != 1 || ippGetValueTag(attr) != IPP_TAG_KEYWORD ||
         ippGetGroupTag(attr) != IPP_TAG_OPERATION ||
         (op != IPP_OP_PRINT_JOB && op != IPP_OP_SEND_DOCUMENT &&
          op != IPP_OP_VALIDATE_JOB) ||
-        !ippContainsString(supported, compression))
+        !cupsArrayFind(vcache->compression, (void *)compression))
     {
       serverRespondUnsupported(client, attr);
       valid = 0;
     }
     else
     {
-      serverLogClient(SERVER_LOGLEVEL_DEBUG, client, "%s compression='%s'", op_name, compression);
+      SERVER_LOG_CLIENT_DEBUG(client, "%s compression='%s'", op_name, compression);
 
       ippAddString(client->request, IPP_TAG_JOB, IPP_TAG_KEYWORD, "compression-supplied", NULL, compression);
 
@@ -8971,7 +10240,7 @@ valid_doc_attributes(
     {
       format = ippGetString(attr, 0, NULL);
 
-      serverLogClient(SERVER_LOGLEVEL_DEBUG, client, "%s document-format='%s'", op_name, format);
+      SERVER_LOG_CLIENT_DEBUG(client, "%s document-format='%s'", op_name, format);
 
       ippAddString(client->request, IPP_TAG_JOB, IPP_TAG_MIMETYPE, "document-format-supplied", NULL, format);
     }
@@ -8998,18 +10267,20 @@ valid_doc_attributes(
 
     if ((format = detect_format(header)) != NULL)
     {
-      serverLogClient(SERVER_LOGLEVEL_DEBUG, client, "%s Auto-typed document-format='%s'", op_name, format);
+      SERVER_LOG_CLIENT_DEBUG(client, "%s Auto-typed document-format='%s'", op_name, format);
 
       ippAddString(client->request, IPP_TAG_JOB, IPP_TAG_MIMETYPE, "document-format-detected", NULL, format);
     }
   }
 
-  if ((op == IPP_OP_PRINT_JOB || op == IPP_OP_SEND_DOCUMENT) && (supported = ippFindAttribute(client->printer->pinfo.attrs, "document-format-supported", IPP_TAG_MIMETYPE)) != NULL && !ippContainsString(supported, format) && attr && ippGetGroupTag(attr) == IPP_TAG_OPERATION)
+  if ((op == IPP_OP_PRINT_JOB || op == IPP_OP_SEND_DOCUMENT) && vcache->document_format && (!format || !cupsArrayFind(vcache->document_format, (void *)format)) && attr && ippGetGroupTag(attr) == IPP_TAG_OPERATION)
   {
     serverRespondUnsupported(client, attr);
     valid = 0;
   }
 
+  _cupsRWUnlock(&client->printer->rwlock);
+
   return (valid);
 }
 
@@ -9055,6 +10326,38 @@ valid_filename(const char *filename)	/* I - Filename to validate */
 }
 
 
+/*
+ * 'valid_groups()' - Make sure that the attribute groups are provided in the
+ *                    correct order and are not repeated.
+ */
+
+static int				/* O - 1 if valid, 0 if not */
+valid_groups(
+    server_client_t *client)		/* I - Client */
+{
+  ipp_tag_t		group;		/* Current group tag */
+  ipp_attribute_t	*attr;		/* Current attribute */
+
+
+  for (attr = ippFirstAttribute(client->request), group = ippGetGroupTag(attr); attr; attr = ippNextAttribute(client->request))
+  {
+    if (ippGetGroupTag(attr) < group && ippGetGroupTag(attr) != IPP_TAG_ZERO)
+    {
+     /*
+      * Out of order; return an error...
+      */
+
+      serverRespondIPP(client, IPP_STATUS_ERROR_BAD_REQUEST, "Attribute groups are out of order (%x < %x).", ippGetGroupTag(attr), group);
+      return (0);
+    }
+    else
+      group = ippGetGroupTag(attr);
+  }
+
+  return (1);
+}
+
+
 /*
  * 'valid_job_attributes()' - Determine whether the job attributes are valid.
  *
@@ -9074,6 +10377,7 @@ valid_job_attributes(
 			*supported;	/* Supported attribute */
   int			resource_id;	/* Resource ID value */
   server_resource_t	*resource;	/* Resource */
+  server_vcache_t	*vcache;	/* Validation values */
   ipp_op_t		op = ippGetOperation(client->request);
 					/* Current operation */
 
@@ -9158,6 +10462,15 @@ valid_job_attributes(
   * Check the various job template attributes...
   */
 
+  _cupsRWLockRead(&client->printer->rwlock);
+
+  if ((vcache = serverGetPrinterValidationNoLock(client->printer)) == NULL)
+  {
+    _cupsRWUnlock(&client->printer->rwlock);
+    serverRespondIPP(client, IPP_STATUS_ERROR_INTERNAL, "Unable to allocate memory.");
+    return (0);
+  }
+
   if ((attr = ippFindAttribute(client->request, "copies", IPP_TAG_ZERO)) != NULL)
   {
     if (ippGetCount(attr) != 1 || ippGetValueTag(attr) != IPP_TAG_INTEGER ||
@@ -9179,9 +10492,7 @@ valid_job_attributes(
 
   if ((attr = ippFindAttribute(client->request, "job-hold-until", IPP_TAG_ZERO)) != NULL)
   {
-    supported = ippFindAttribute(client->printer->pinfo.attrs, "job-hold-until-supported", IPP_TAG_ZERO);
-
-    if (!ippContainsString(supported, ippGetString(attr, 0, NULL)))
+    if (!cupsArrayFind(vcache->job_hold_until, (void *)ippGetString(attr, 0, NULL)))
     {
       serverRespondUnsupported(client, attr);
       valid = 0;
@@ -9224,9 +10535,7 @@ valid_job_attributes(
 
   if ((attr = ippFindAttribute(client->request, "job-sheets", IPP_TAG_ZERO)) != NULL)
   {
-    supported = ippFindAttribute(client->printer->pinfo.attrs, "job-sheets-supported", IPP_TAG_ZERO);
-
-    if (!ippContainsString(supported, ippGetString(attr, 0, NULL)))
+    if (!cupsArrayFind(vcache->job_sheets, (void *)ippGetString(attr, 0, NULL)))
     {
       serverRespondUnsupported(client, attr);
       valid = 0;
@@ -9235,10 +10544,7 @@ valid_job_attributes(
 
   if ((attr = ippFindAttribute(client->request, "media", IPP_TAG_ZERO)) != NULL)
   {
-    if ((supported = ippFindAttribute(client->printer->dev_attrs, "media-supported", IPP_TAG_KEYWORD)) == NULL)
-      supported = ippFindAttribute(client->printer->pinfo.attrs, "media-supported", IPP_TAG_KEYWORD);
-
-    if (!ippContainsString(supported, ippGetString(attr, 0, NULL)))
+    if (!cupsArrayFind(vcache->media, (void *)ippGetString(attr, 0, NULL)))
     {
       serverRespondUnsupported(client, attr);
       valid = 0;
@@ -9269,10 +10575,7 @@ valid_job_attributes(
       }
       else
       {
-        if ((supported = ippFindAttribute(client->printer->dev_attrs, "media-supported", IPP_TAG_KEYWORD)) == NULL)
-	  supported = ippFindAttribute(client->printer->pinfo.attrs, "media-supported", IPP_TAG_KEYWORD);
-
-	if (!ippContainsString(supported, ippGetString(member, 0, NULL)))
+	if (!cupsArrayFind(vcache->media, (void *)ippGetString(member, 0, NULL)))
 	{
 	  serverRespondUnsupported(client, attr);
 	  valid = 0;
@@ -9301,21 +10604,10 @@ valid_job_attributes(
 	}
 	else if (supported)
 	{
-	  x_value   = ippGetInteger(x_dim, 0);
-	  y_value   = ippGetInteger(y_dim, 0);
-	  count     = ippGetCount(supported);
+	  x_value = ippGetInteger(x_dim, 0);
+	  y_value = ippGetInteger(y_dim, 0);
 
-	  for (i = 0; i < count ; i ++)
-	  {
-	    size  = ippGetCollection(supported, i);
-	    x_dim = ippFindAttribute(size, "x-dimension", IPP_TAG_ZERO);
-	    y_dim = ippFindAttribute(size, "y-dimension", IPP_TAG_ZERO);
-
-	    if (ippContainsInteger(x_dim, x_value) && ippContainsInteger(y_dim, y_value))
-	      break;
-	  }
-
-	  if (i >= count)
+	  if (_pwgMediaColNearSize(supported, x_value, y_value, 0) < 0)
 	  {
 	    serverRespondUnsupported(client, attr);
 	    valid = 0;
@@ -9327,9 +10619,7 @@ valid_job_attributes(
 
   if ((attr = ippFindAttribute(client->request, "multiple-document-handling", IPP_TAG_ZERO)) != NULL)
   {
-    supported = ippFindAttribute(client->printer->pinfo.attrs, "multiple-document-handling-supported", IPP_TAG_KEYWORD);
-
-    if (!ippContainsString(supported, ippGetString(attr, 0, NULL)))
+    if (!cupsArrayFind(vcache->multiple_document_handling, (void *)ippGetString(attr, 0, NULL)))
     {
       serverRespondUnsupported(client, attr);
       valid = 0;
@@ -9338,9 +10628,10 @@ valid_job_attributes(
 
   if ((attr = ippFindAttribute(client->request, "orientation-requested", IPP_TAG_ZERO)) != NULL)
   {
-    supported = ippFindAttribute(client->printer->pinfo.attrs, "orientation-requested-supported", IPP_TAG_ENUM);
+    int orient = ippGetInteger(attr, 0);
+					/* orientation-requested value */
 
-    if (!ippContainsInteger(supported, ippGetInteger(attr, 0)))
+    if (orient >= 0 && orient < 32 ? !(vcache->orientation_requested & (1U << orient)) : !ippContainsInteger(ippFindAttribute(client->printer->pinfo.attrs, "orientation-requested-supported", IPP_TAG_ENUM), orient))
     {
       serverRespondUnsupported(client, attr);
       valid = 0;
@@ -9396,20 +10687,189 @@ valid_job_attributes(
     const char *sides = ippGetString(attr, 0, NULL);
 					/* "sides" value... */
 
-    if ((supported = ippFindAttribute(client->printer->dev_attrs, "sides-supported", IPP_TAG_KEYWORD)) == NULL)
-      supported = ippFindAttribute(client->printer->pinfo.attrs, "sides-supported", IPP_TAG_KEYWORD);
+    if (!cupsArrayFind(vcache->sides, (void *)sides) && (!sides || strcmp(sides, "one-sided")))
+    {
+      serverRespondUnsupported(client, attr);
+      valid = 0;
+    }
+  }
+
+  _cupsRWUnlock(&client->printer->rwlock);
+
+  return (valid);
+}
+
+
+/*
+ * 'valid_request()' - Validate the request header and required operation
+ *                     attributes, and find the target printer.
+ *
+ * Only the operation attributes need to have been read.  Returns 0 with an
+ * error status in the response if the request is not valid.
+ */
+
+static int				/* O - 1 if valid, 0 if not */
+valid_request(
+    server_client_t *client)		/* I - Client */
+{
+  ipp_attribute_t	*attr;		/* Current attribute */
+  ipp_attribute_t	*charset;	/* Character set attribute */
+  ipp_attribute_t	*language;	/* Language attribute */
+  ipp_attribute_t	*uri;		/* Printer URI attribute */
+  int			major, minor;	/* Version number */
+  const char		*name;		/* Name of attribute */
+
+
+  major = ippGetVersion(client->request, &minor);
+
+  if (major < 1 || major > 2)
+  {
+   /*
+    * Return an error, since we only support IPP 1.x and 2.x.
+    */
+
+    serverRespondIPP(client, IPP_STATUS_ERROR_VERSION_NOT_SUPPORTED, "Bad request version number %d.%d.", major, minor);
+    return (0);
+  }
+  else if (ippGetRequestId(client->request) <= 0)
+  {
+    serverRespondIPP(client, IPP_STATUS_ERROR_BAD_REQUEST, "Bad request-id %d.", ippGetRequestId(client->request));
+    return (0);
+  }
+  else if (!ippFirstAttribute(client->request))
+  {
+    serverRespondIPP(client, IPP_STATUS_ERROR_BAD_REQUEST, "No attributes in request.");
+    return (0);
+  }
+  else if (!valid_groups(client))
+  {
+    return (0);
+  }
+  else
+  {
+   /*
+    * Make sure that the first three attributes are:
+    *
+    *     attributes-charset
+    *     attributes-natural-language
+    *     printer-uri/job-uri
+    */
+
+    attr = ippFirstAttribute(client->request);
+    name = ippGetName(attr);
+    if (attr && name && !strcmp(name, "attributes-charset") && ippGetGroupTag(attr) == IPP_TAG_OPERATION && ippGetValueTag(attr) == IPP_TAG_CHARSET)
+      charset = attr;
+    else
+      charset = NULL;
+
+    attr = ippNextAttribute(client->request);
+    name = ippGetName(attr);
+
+    if (attr && name && !strcmp(name, "attributes-natural-language") && ippGetGroupTag(attr) == IPP_TAG_OPERATION && ippGetValueTag(attr) == IPP_TAG_LANGUAGE)
+      language = attr;
+    else
+      language = NULL;
+
+    attr = ippNextAttribute(client->request);
+    name = ippGetName(attr);
+
+    if (attr && name && (!strcmp(name, "system-uri") || !strcmp(name, "printer-uri") || !strcmp(name, "job-uri")) && ippGetGroupTag(attr) == IPP_TAG_OPERATION && ippGetValueTag(attr) == IPP_TAG_URI)
+      uri = attr;
+    else
+      uri = NULL;
+
+    if (!uri && RelaxedConformance)
+    {
+     /*
+      * The target URI isn't where it is supposed to be.  See if it is
+      * elsewhere in the request...
+      */
+
+      if ((attr = ippFindAttribute(client->request, "system-uri", IPP_TAG_URI)) != NULL && ippGetGroupTag(attr) == IPP_TAG_OPERATION)
+	uri = attr;
+      else if ((attr = ippFindAttribute(client->request, "printer-uri", IPP_TAG_URI)) != NULL && ippGetGroupTag(attr) == IPP_TAG_OPERATION)
+	uri = attr;
+      else if ((attr = ippFindAttribute(client->request, "job-uri", IPP_TAG_URI)) != NULL && ippGetGroupTag(attr) == IPP_TAG_OPERATION)
+	uri = attr;
+
+      if (uri)
+	serverLogClient(SERVER_LOGLEVEL_ERROR, client, "Target URI not the third attribute in the request (section 4.1.5 of RFC 8011).");
+    }
+
+    if (charset && strcasecmp(ippGetString(charset, 0, NULL), "us-ascii") && strcasecmp(ippGetString(charset, 0, NULL), "utf-8"))
+    {
+     /*
+      * Bad character set...
+      */
+
+      serverRespondIPP(client, IPP_STATUS_ERROR_BAD_REQUEST, "Unsupported character set \"%s\".", ippGetString(charset, 0, NULL));
+      return (0);
+    }
+    else if (!charset || !language || !uri)
+    {
+     /*
+      * Return an error, since attributes-charset,
+      * attributes-natural-language, and printer-uri/job-uri are required
+      * for all operations.
+      */
 
-    if (!ippContainsString(supported, sides) && strcmp(sides, "one-sided"))
+      serverRespondIPP(client, IPP_STATUS_ERROR_BAD_REQUEST, "Missing required attributes in request.");
+      return (0);
+    }
+    else
     {
-      if (!ippContainsString(supported, sides))
+      char	resource[256],		/* Resource path in URI */
+		*resptr;		/* Pointer into resource path */
+
+      name            = ippGetName(uri);
+      client->printer = NULL;
+
+      if (_httpSeparateResource(ippGetString(uri, 0, NULL), resource, sizeof(resource)) < HTTP_URI_STATUS_OK)
       {
-	serverRespondUnsupported(client, attr);
-	valid = 0;
+	serverRespondIPP(client, IPP_STATUS_ERROR_ATTRIBUTES_OR_VALUES, "Bad \"%s\" value '%s'.", name, ippGetString(uri, 0, NULL));
+	return (0);
+      }
+      else if (!strcmp(name, "job-uri"))
+      {
+       /*
+	* Validate job-uri...
+	*/
+
+	if (strncmp(resource, "/ipp/print/", 11))
+	{
+	  serverRespondIPP(client, IPP_STATUS_ERROR_NOT_FOUND, "\"%s\" '%s' not found.", name, ippGetString(uri, 0, NULL));
+	  return (0);
+	}
+	else
+	{
+	 /*
+	  * Strip job-id from resource...
+	  */
+
+	  if ((resptr = strchr(resource + 11, '/')) != NULL)
+	    *resptr = '\0';
+	  else
+	    resource[10] = '\0';
+
+	  if ((client->printer = serverFindPrinter(resource)) == NULL)
+	  {
+	    serverRespondIPP(client, IPP_STATUS_ERROR_NOT_FOUND, "\"%s\" '%s' not found.", name, ippGetString(uri, 0, NULL));
+	    return (0);
+	  }
+	}
+      }
+      else if ((client->printer = serverFindPrinter(resource)) == NULL)
+      {
+	if (strcmp(resource, "/ipp/system"))
+	{
+	  serverRespondIPP(client, IPP_STATUS_ERROR_NOT_FOUND, "\"%s\" '%s' not found.", name, ippGetString(uri, 0, NULL));
+	  return (0);
+	}
       }
     }
   }
 
-  return (valid);
+  return (1);
 }
 
 
@@ -9549,3 +11009,23 @@ wgs84_distance(const char *a,		/* I - First geo: value */
 
   return ((float)sqrt(d_lat * d_lat + d_lon * d_lon + d_alt * d_alt));
 }
+
+
+/*
+ * 'write_buffer_cb()' - Write IPP data to a memory buffer.
+ */
+
+static ssize_t				/* O - Number of bytes written */
+write_buffer_cb(
+    server_wbuffer_t *wbuffer,		/* I - Write buffer */
+    ipp_uchar_t      *buffer,		/* I - Data to write */
+    size_t           bytes)		/* I - Number of bytes to write */
+{
+  if (bytes > (size_t)(wbuffer->end - wbuffer->ptr))
+    return (-1);
+
+  memcpy(wbuffer->ptr, buffer, bytes);
+  wbuffer->ptr += bytes;
+
+  return ((ssize_t)bytes);
+}
@@ -22,6 +22,10 @@
 
 #include <config.h>			/* CUPS configuration header */
 #include <cups/cups.h>			/* Public API */
+#include <cups/array-private.h>		/* For hash-indexed arrays */
+#include <cups/http-private.h>		/* For _httpReadFile, _httpSeparateResource */
+#include <cups/ipp-private.h>		/* For arena IPP messages */
+#include <cups/pwg-private.h>		/* For media size matching */
 #include <cups/string-private.h>	/* CUPS string functions */
 #include <cups/thread-private.h>	/* For multithreading functions */
 #include <stdio.h>
@@ -49,6 +53,12 @@ extern char **environ;
 #  include <poll.h>
 #endif /* _WIN32 */
 
+#ifdef HAVE_EPOLL
+#  include <sys/epoll.h>
+#elif defined(HAVE_KQUEUE)
+#  include <sys/event.h>
+#endif /* HAVE_EPOLL */
+
 #ifdef HAVE_DNSSD
 #  include <dns_sd.h>
 #elif defined(HAVE_AVAHI)
@@ -81,6 +91,46 @@ extern char **environ;
 #  define _cupsRWDeinit(rw)
 #endif /* HAVE_PTHREAD_H */
 
+/*
+ * Sequence counters for lock-free status reads.  Writers bracket every
+ * update with SERVER_SEQ_BEGIN/END, and readers copy the values again until
+ * SERVER_SEQ_RETRY returns false.  SERVER_SEQ_BEGIN waits for any other
+ * writer to finish, so writers holding different locks (or none) cannot
+ * interleave their updates; brackets must not nest...
+ *
+ * Generation counters (SERVER_GEN_BUMP/READ) are bumped without a lock
+ * whenever something shown in the web interface changes, and are used to
+ * validate cached status pages...
+ *
+ * Published snapshots are read and replaced with SERVER_ATOMIC_GET/SET, and
+ * readers are counted with SERVER_ATOMIC_INC/DEC so that writers know when an
+ * old snapshot can be freed...
+ */
+
+#if defined(__GNUC__) || defined(__clang__)
+#  define SERVER_SEQ_BEGIN(s)	do { unsigned _seq; do { _seq = __atomic_load_n(&(s), __ATOMIC_RELAXED) & ~1U; } while (!__atomic_compare_exchange_n(&(s), &_seq, _seq + 1, 0, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)); __atomic_thread_fence(__ATOMIC_RELEASE); } while (0)
+#  define SERVER_SEQ_END(s)	__atomic_add_fetch(&(s), 1, __ATOMIC_RELEASE)
+#  define SERVER_SEQ_READ(s)	__atomic_load_n(&(s), __ATOMIC_ACQUIRE)
+#  define SERVER_SEQ_RETRY(s,v)	(__atomic_thread_fence(__ATOMIC_ACQUIRE), __atomic_load_n(&(s), __ATOMIC_RELAXED) != (v))
+#  define SERVER_GEN_BUMP(g)	__atomic_add_fetch(&(g), 1, __ATOMIC_RELAXED)
+#  define SERVER_GEN_READ(g)	__atomic_load_n(&(g), __ATOMIC_RELAXED)
+#  define SERVER_ATOMIC_DEC(c)	__atomic_sub_fetch(&(c), 1, __ATOMIC_SEQ_CST)
+#  define SERVER_ATOMIC_GET(v)	__atomic_load_n(&(v), __ATOMIC_SEQ_CST)
+#  define SERVER_ATOMIC_INC(c)	__atomic_add_fetch(&(c), 1, __ATOMIC_SEQ_CST)
+#  define SERVER_ATOMIC_SET(v,n)	__atomic_store_n(&(v), (n), __ATOMIC_SEQ_CST)
+#else
+#  define SERVER_SEQ_BEGIN(s)	(*(volatile unsigned *)&(s) = (s) + 1)
+#  define SERVER_SEQ_END(s)	(*(volatile unsigned *)&(s) = (s) + 1)
+#  define SERVER_SEQ_READ(s)	(*(volatile unsigned *)&(s))
+#  define SERVER_SEQ_RETRY(s,v)	(*(volatile unsigned *)&(s) != (v))
+#  define SERVER_GEN_BUMP(g)	(*(volatile unsigned *)&(g) = (g) + 1)
+#  define SERVER_GEN_READ(g)	(*(volatile unsigned *)&(g))
+#  define SERVER_ATOMIC_DEC(c)	(-- *(volatile unsigned *)&(c))
+#  define SERVER_ATOMIC_GET(v)	(v)
+#  define SERVER_ATOMIC_INC(c)	(++ *(volatile unsigned *)&(c))
+#  define SERVER_ATOMIC_SET(v,n)	((v) = (n))
+#endif /* __GNUC__ || __clang__ */
+
 #  ifndef O_BINARY			/* Windows "binary file" nonsense */
 #    define O_BINARY 0
 #  endif /* !O_BINARY */
@@ -98,9 +148,21 @@ extern char **environ;
  * Constants...
  */
 
-/* Maximum number of resources per job/printer */
+/* Maximum number of resource-ids values in a request */
 #  define SERVER_RESOURCES_MAX				100
 
+/* Resource ID sets are hashed once they have more than 8 IDs */
+#  define SERVER_RSET_LINEAR				8
+
+/* Idle (keep-alive) client connections are closed after 30 seconds */
+#  define SERVER_CLIENT_TIMEOUT				30
+
+/* Maximum number of cached Get-Printer-Attributes responses per printer */
+#  define SERVER_PCACHE_MAX				8
+
+/* Encoded response buffers larger than 256k are not kept between requests */
+#  define SERVER_ENCODED_MAX				262144
+
 /* Maximum lease duration value from RFC 3995 - 2^26-1 seconds or ~2 years */
 #  define SERVER_NOTIFY_LEASE_DURATION_MAX		67108863
 /* But a value of 0 means "never expires"... */
@@ -144,6 +206,68 @@ typedef enum server_loglevel_e
   SERVER_LOGLEVEL_DEBUG
 } server_loglevel_t;
 
+/*
+ * Debug logging macros - the log level is checked before the arguments are
+ * evaluated, and configuring with --disable-debug-logging compiles debug
+ * messages out entirely...
+ */
+
+#  ifdef SERVER_NO_DEBUG_LOGGING
+#    define SERVER_LOG_DEBUG_ENABLED	0
+#  else
+#    define SERVER_LOG_DEBUG_ENABLED	(LogLevel >= SERVER_LOGLEVEL_DEBUG)
+#  endif /* SERVER_NO_DEBUG_LOGGING */
+
+#  define SERVER_LOG_DEBUG(...) do { if (SERVER_LOG_DEBUG_ENABLED) serverLog(SERVER_LOGLEVEL_DEBUG, __VA_ARGS__); } while (0)
+#  define SERVER_LOG_CLIENT_DEBUG(client, ...) do { if (SERVER_LOG_DEBUG_ENABLED) serverLogClient(SERVER_LOGLEVEL_DEBUG, client, __VA_ARGS__); } while (0)
+#  define SERVER_LOG_JOB_DEBUG(job, ...) do { if (SERVER_LOG_DEBUG_ENABLED) serverLogJob(SERVER_LOGLEVEL_DEBUG, job, __VA_ARGS__); } while (0)
+#  define SERVER_LOG_PRINTER_DEBUG(printer, ...) do { if (SERVER_LOG_DEBUG_ENABLED) serverLogPrinter(SERVER_LOGLEVEL_DEBUG, printer, __VA_ARGS__); } while (0)
+
+/*
+ * Static tracepoint macros - "ippserver" USDT probes for SystemTap, DTrace,
+ * and bpftrace are added when <sys/sdt.h> is available and compiled out
+ * otherwise...
+ */
+
+#  ifdef HAVE_SYS_SDT_H
+#    include <sys/sdt.h>
+#    define SERVER_TRACE2(name,a,b) DTRACE_PROBE2(ippserver, name, a, b)
+#    define SERVER_TRACE3(name,a,b,c) DTRACE_PROBE3(ippserver, name, a, b, c)
+#  else
+#    define SERVER_TRACE2(name,a,b)
+#    define SERVER_TRACE3(name,a,b,c)
+#  endif /* HAVE_SYS_SDT_H */
+
+/*
+ * Request processing phases, each recorded when the phase ends...
+ */
+
+typedef enum server_phase_e
+{
+  SERVER_PHASE_START,			/* Request line read */
+  SERVER_PHASE_HEADERS,			/* HTTP header fields read */
+  SERVER_PHASE_AUTH,			/* Authentication checked */
+  SERVER_PHASE_READ,			/* IPP message read */
+  SERVER_PHASE_VALIDATE,		/* Request attributes validated */
+  SERVER_PHASE_SPOOL,			/* Document data spooled */
+  SERVER_PHASE_OPERATION,		/* Operation processed */
+  SERVER_PHASE_RESPONSE,		/* Response sent */
+  SERVER_PHASE_MAX
+} server_phase_t;
+
+#  define SERVER_CLIENT_PHASE(client, phase) do { if (LogSlowRequests > 0) (client)->phases[phase] = serverGetTime(); } while (0)
+
+/*
+ * Gauge metrics...
+ */
+
+typedef enum server_metric_e
+{
+  SERVER_METRIC_CLIENTS,		/* Connected clients */
+  SERVER_METRIC_THREADS,		/* Client and job threads */
+  SERVER_METRIC_MAX
+} server_metric_t;
+
 /*
  * Event mask enumeration...
  */
@@ -381,6 +505,34 @@ VALUE({					/* Strings for bits */
   "hold-new-jobs"
 });
 
+typedef enum server_opclass_e		/* Operation classes for rate limits */
+{
+  SERVER_OPCLASS_JOB,			/* Job creation operations */
+  SERVER_OPCLASS_QUERY,			/* Get-xxx operations */
+  SERVER_OPCLASS_OTHER,			/* All other operations */
+  SERVER_OPCLASS_MAX
+} server_opclass_t;
+
+typedef struct server_rate_s		/* Token bucket rate limit */
+{
+  double	rate,			/* Requests per second, 0 for no limit */
+		burst;			/* Maximum requests in a burst */
+} server_rate_t;
+
+typedef enum server_scheduler_e		/* Job scheduling policies */
+{
+  SERVER_SCHEDULER_PRIORITY,		/* Highest job-priority first */
+  SERVER_SCHEDULER_SIZE,		/* Smallest job first */
+  SERVER_SCHEDULER_FAIRSHARE		/* Least recently served user first */
+} server_scheduler_t;
+
+typedef enum server_spoolsync_e		/* Spool file sync policies */
+{
+  SERVER_SPOOLSYNC_NONE,		/* Leave it to the operating system */
+  SERVER_SPOOLSYNC_CLOSE,		/* Sync file data when closed */
+  SERVER_SPOOLSYNC_JOB			/* Sync file data and directory entry */
+} server_spoolsync_t;
+
 typedef enum server_transform_e		/* Transform modes for server */
 {
   SERVER_TRANSFORM_COMMAND,		/* Run command for print job processing */
@@ -422,14 +574,24 @@ typedef void *server_loc_t;		/* LOC record */
  * Structures...
  */
 
-typedef struct server_filter_s		/**** Attribute filter ****/
+typedef struct server_job_s server_job_t;
+
+typedef struct server_jstatus_s		/**** Job status snapshot ****/
 {
-  cups_array_t		*ra;		/* Requested attributes */
-  cups_array_t		*pa;		/* Private attributes */
-  ipp_tag_t		group_tag;	/* Group to copy */
-} server_filter_t;
+  ipp_jstate_t		state;		/* job-state value */
+  server_jreason_t	state_reasons;	/* Combined job-state-reasons values */
+  int			impcompleted,	/* job-impressions-completed value */
+			cancel;		/* Non-zero when job canceled */
+} server_jstatus_t;
 
-typedef struct server_job_s server_job_t;
+typedef struct server_usage_s		/**** Transform resource usage ****/
+{
+  double		user_time,	/* User CPU time in seconds */
+			system_time;	/* System CPU time in seconds */
+  long			max_rss,	/* Maximum resident set size in kilobytes */
+			in_blocks,	/* Block input operations */
+			out_blocks;	/* Block output operations */
+} server_usage_t;
 
 typedef struct server_device_s		/**** Output Device data ****/
 {
@@ -439,6 +601,8 @@ typedef struct server_device_s		/**** Output Device data ****/
   ipp_t			*attrs;		/* All printer attributes */
   ipp_pstate_t		state;		/* printer-state value */
   server_preason_t	reasons;	/* printer-state-reasons values */
+  int			ppm;		/* pages-per-minute value */
+  cups_array_t		*jobs;		/* Jobs assigned to device */
 } server_device_t;
 
 typedef struct server_resource_s server_resource_t;
@@ -449,6 +613,15 @@ typedef struct server_lang_s		/**** Localization data ****/
   server_resource_t	*resource;	/* Strings resource file */
 } server_lang_t;
 
+typedef struct server_rset_s		/**** Set of resource IDs ****/
+{
+  int			num_ids,	/* Number of IDs */
+			alloc_ids;	/* Allocated IDs */
+  int			*ids;		/* IDs in order of allocation */
+  unsigned		mask;		/* Size of hash table - 1 */
+  int			*table;		/* Hash table of IDs, if any */
+} server_rset_t;
+
 typedef struct server_icc_s		/**** ICC color profile data ****/
 {
   server_resource_t	*resource;	/* ICC resource file */
@@ -464,7 +637,8 @@ typedef struct server_pinfo_s		/**** Printer information ****/
 		*document_formats,	/* Supported input formats */
 		*command,		/* Command to run with job files */
 		*device_uri,		/* Device URI */
-		*output_format;		/* Output format */
+		*output_format,		/* Output format */
+		*stream_formats;	/* Formats that are streamed to command */
   gid_t		print_group,		/* Print group, if any */
 		proxy_group;		/* Proxy group, if any */
   char		duplex,			/* Duplex mode */
@@ -476,12 +650,55 @@ typedef struct server_pinfo_s		/**** Printer information ****/
   cups_array_t	*strings;		/* Strings files */
   cups_array_t	*profiles;		/* ICC color profiles */
   int		max_devices;		/* Maximum number of devices */
+  int		max_processing;		/* Maximum number of processing jobs */
+  int		compression_level;	/* Compression level for sent documents */
+  int		cpu_limit;		/* CPU time limit for commands in seconds */
+  off_t		memory_limit;		/* Memory limit for commands in bytes */
   cups_array_t	*devices;		/* Associated devices */
   char		initial_accepting;	/* Initial printer-is-accepting-jobs */
   ipp_pstate_t	initial_state;		/* Initial printer-state */
   server_preason_t initial_reasons;	/* Initial printer-state-reasons */
 } server_pinfo_t;
 
+typedef struct server_pcache_s		/**** Cached printer attributes ****/
+{
+  char			*key;		/* requested-attributes key */
+  size_t		length;		/* Length of encoded attributes */
+  ipp_uchar_t		*data;		/* Encoded attributes without group tag */
+} server_pcache_t;
+
+typedef struct server_userjobs_s	/**** Jobs for a user ****/
+{
+  char			*username;	/* requesting-user-name value */
+  cups_array_t		*jobs;		/* Jobs, newest first */
+  time_t		served;		/* Last time a job for the user was started */
+} server_userjobs_t;
+
+typedef struct server_hentry_s		/**** Job history index entry ****/
+{
+  int			id;		/* job-id */
+  ipp_jstate_t		state;		/* job-state value */
+  time_t		completed;	/* time-at-completed value */
+  const char		*username;	/* job-originating-user-name value */
+  off_t			offset;		/* Offset of record in history file */
+  size_t		length;		/* Length of record */
+} server_hentry_t;
+
+typedef struct server_vcache_s		/**** Precompiled validation values ****/
+{
+  cups_array_t		*compression,	/* compression-supported values */
+			*document_format,
+					/* document-format-supported values */
+			*job_hold_until,/* job-hold-until-supported values */
+			*job_sheets,	/* job-sheets-supported values */
+			*media,		/* media-supported values */
+			*multiple_document_handling,
+					/* multiple-document-handling-supported values */
+			*sides;		/* sides-supported values */
+  unsigned		orientation_requested;
+					/* orientation-requested-supported bits */
+} server_vcache_t;
+
 typedef struct server_printer_s		/**** Printer data ****/
 {
   int			id;		/* Printer ID */
@@ -498,6 +715,8 @@ typedef struct server_printer_s		/**** Printer data ****/
 			printer_ref;	/* DNS-SD LPD service */
 #endif /* HAVE_AVAHI */
   server_loc_t		geo_ref;	/* DNS-SD geo-location */
+  unsigned char		*dnssd_txt;	/* Cached IPP TXT record data */
+  size_t		dnssd_txtlen;	/* Length of cached TXT record data */
   char			*default_uri,	/* Default/first URI */
 			*dns_sd_name,	/* printer-dns-sd-name */
 			*name,		/* printer-name */
@@ -506,10 +725,19 @@ typedef struct server_printer_s		/**** Printer data ****/
   server_pinfo_t	pinfo;		/* Printer information */
   server_resource_t	*icon_resource;	/* Printer icon resource */
   ipp_t			*dev_attrs;	/* Current device attributes */
+  _cups_mutex_t		cache_mutex;	/* Mutex for attribute cache */
+  cups_array_t		*cache;		/* Cached Get-Printer-Attributes data */
+  char			*transform_env;	/* Cached transform environment strings */
+  size_t		transform_envlen;
+					/* Length of transform environment */
+  int			transform_envc;	/* Number of transform environment strings */
+  server_vcache_t	*vcache;	/* Cached validation values */
+  unsigned		web_gen;	/* Web interface generation */
   time_t		start_time;	/* Startup time */
   time_t		config_time;	/* printer-config-change-time */
   char			is_accepting,	/* printer-is-accepting-jobs value */
 			is_deleted,	/* Is the printer being deleted? */
+			is_dirty,	/* Does the printer state need saving? */
 			is_shutdown;	/* Is the printer shutdown? */
   ipp_pstate_t		state,		/* printer-state value */
 			dev_state;	/* Current device printer-state value */
@@ -518,16 +746,21 @@ typedef struct server_printer_s		/**** Printer data ****/
   time_t		state_time;	/* printer-state-change-time */
   cups_array_t		*jobs,		/* Jobs */
 			*active_jobs,	/* Active jobs */
-			*completed_jobs;/* Completed jobs */
+			*completed_jobs,/* Completed jobs */
+			*user_jobs,	/* Jobs by user */
+			*history;	/* Job history index, newest first */
+  int			history_fd;	/* Job history file */
+  off_t			history_size,	/* Size of job history file */
+			history_expired;/* Bytes of expired records in file */
   server_job_t		*processing_job;/* Current processing job */
+  cups_array_t		*processing_jobs;
+					/* All processing jobs */
   int			next_job_id;	/* Next job-id value */
   server_identify_t	identify_actions;
 					/* identify-actions value, if any */
   char			*identify_message;
 					/* Identify-Printer message value, if any */
-  int			num_resources,	/* Number of printer resources */
-			resources[SERVER_RESOURCES_MAX];
-					/* Printer resource IDs */
+  server_rset_t		resources;	/* Printer resource IDs */
 } server_printer_t;
 
 struct server_job_s			/**** Job data ****/
@@ -552,16 +785,25 @@ struct server_job_s			/**** Job data ****/
 			completed;	/* time-at-completed value */
   int			impressions,	/* job-impressions value */
 			impcompleted;	/* job-impressions-completed value */
+  int			doc_k_octets,	/* job-k-octets of current document */
+			doc_impressions;/* job-impressions of current document */
+  double		progress_time;	/* Time of last job-progress event */
+  unsigned		status_seq;	/* Status sequence counter */
   ipp_t			*attrs,		/* Job attributes */
 			*doc_attrs;	/* Document attributes */
+  ipp_uchar_t		*compact;	/* Encoded attributes of completed job */
+  size_t		compact_attrs,	/* Length of encoded job attributes */
+			compact_doc_attrs;
+					/* Length of encoded document attributes */
   int			cancel;		/* Non-zero when job canceled */
   char			*filename;	/* Print file name */
   int			fd;		/* Print file descriptor */
+  int			memfd;		/* Anonymous memory file, if any */
+  int			stream_fd,	/* Pipe to transform command, if streaming */
+			stream_in;	/* Transform end of stream pipe */
   int			transform_pid;	/* Transform process ID, if any */
   server_printer_t	*printer;	/* Printer */
-  int			num_resources,	/* Number of job resources */
-			resources[SERVER_RESOURCES_MAX];
-					/* Job resource IDs */
+  server_rset_t		resources;	/* Job resource IDs */
 };
 
 struct server_resource_s		/**** Resource data ****/
@@ -577,8 +819,31 @@ struct server_resource_s		/**** Resource data ****/
   int			use,		/* Use count */
 			fd,		/* Resource file descriptor */
 			cancel;		/* Cancel pending */
+  unsigned char		*data;		/* Cached file contents, if any */
+  size_t		datalen;	/* Length of cached file contents */
+  char			etag[64];	/* HTTP entity tag for file contents */
+  time_t		mtime;		/* Modification time of file contents */
+  ipp_t			*template_attrs;/* Parsed template attributes, if any */
 };
 
+typedef struct server_notify_s		/**** Shared event notification ****/
+{
+  int			refcount;	/* Number of references */
+  ipp_t			*attrs;		/* Common event attributes */
+} server_notify_t;
+
+typedef struct server_sevent_s		/**** Subscription event ****/
+{
+  int			sequence;	/* notify-sequence-number */
+  server_notify_t	*notify;	/* Shared event attributes */
+} server_sevent_t;
+
+typedef struct server_waiter_s		/**** Get-Notifications waiter ****/
+{
+  _cups_cond_t		cond;		/* Wakeup condition */
+  int			signaled;	/* Non-zero when events are available */
+} server_waiter_t;
+
 typedef struct server_subscription_s	/**** Subscription data ****/
 {
   int			id;		/* notify-subscription-id */
@@ -595,20 +860,45 @@ typedef struct server_subscription_s	/**** Subscription data ****/
   ipp_attribute_t	*userdata;	/* notify-user-data */
   int			lease;		/* notify-lease-duration */
   int			interval;	/* notify-time-interval */
+  int			progress_job;	/* job-id for last job-progress event */
+  double		progress_time;	/* Time of last job-progress event */
   time_t		expire;		/* Lease expiration time */
   int			first_sequence,	/* First notify-sequence-number in cache */
-			last_sequence;	/* Last notify-sequence-number used */
-  cups_array_t		*events;	/* Events (ipp_t *'s) */
+			last_sequence,	/* Last notify-sequence-number used */
+			max_events;	/* Size of event ring buffer */
+  server_sevent_t	*events;	/* Ring buffer of events, indexed by sequence number */
+  cups_array_t		*waiters;	/* Waiters (server_waiter_t *'s) */
   int			pending_delete;	/* Non-zero when the subscription is about to be deleted/canceled */
 } server_subscription_t;
 
+typedef struct server_limit_s server_limit_t;
+
 typedef struct server_client_s		/**** Client data ****/
 {
   int			number;		/* Client number */
   http_t		*http;		/* HTTP connection */
+  int			corked;		/* Are socket writes corked? */
+  int			busy,		/* Over the connection limit? */
+			active;		/* Counted as an active request? */
+  server_limit_t	*host_limit,	/* Limits for client address */
+			*user_limit;	/* Limits for requesting user */
   ipp_t			*request,	/* IPP request */
 			*response;	/* IPP response */
-  time_t		start;		/* Request start time */
+  ipp_uchar_t		*cached_attrs;	/* Pre-encoded attributes for response */
+  size_t		cached_length;	/* Length of pre-encoded attributes */
+  ipp_uchar_t		*encoded;	/* Encoded IPP response */
+  size_t		encoded_size,	/* Size of encoded response buffer */
+			encoded_length;	/* Length of encoded response */
+  char			*html;		/* Buffered web interface page */
+  size_t		html_size,	/* Size of page buffer */
+			html_length;	/* Length of buffered page */
+  time_t		start,		/* Request start time */
+			idle;		/* Time connection became idle */
+  double		phases[SERVER_PHASE_MAX];
+					/* End times of request phases */
+#ifdef HAVE_SSL
+  int			tls_checked;	/* Checked for HTTPS connection? */
+#endif /* HAVE_SSL */
   http_state_t		operation;	/* Request operation */
   ipp_op_t		operation_id;	/* IPP operation-id */
   char			uri[1024],	/* Request URI */
@@ -622,11 +912,16 @@ typedef struct server_client_s		/**** Client data ****/
   int			fetch_compression,
 					/* Compress file? */
 			fetch_file;	/* File to fetch */
+  size_t		fetch_length;	/* Length of file to fetch */
 } server_client_t;
 
+typedef void (*server_timer_cb_t)(void *data);
+					/**** Timer callback ****/
+
 typedef struct server_listener_s	/**** Listener data ****/
 {
   int			fd;		/* Listener socket */
+  http_addr_t		addr;		/* Listen address */
   char			host[256];	/* Hostname, if any */
   int			port;		/* Port number */
 } server_listener_t;
@@ -636,7 +931,9 @@ typedef struct server_listener_s	/**** Listener data ****/
  * Globals...
  */
 
-VAR int			Authentication	VALUE(0);
+VAR int			Authentication	VALUE(0),
+			AuthCacheLifetime VALUE(60),
+			AuthGroupCacheLifetime VALUE(60);
 VAR gid_t		AuthAdminGroup	VALUE((gid_t)-1),
 			AuthOperatorGroup VALUE((gid_t)-1),
 			AuthProxyGroup	VALUE((gid_t)-1);
@@ -664,10 +961,13 @@ VAR ipp_t		*SystemAttributes VALUE(NULL);
 VAR time_t		SystemStartTime,
 			SystemConfigChangeTime;
 VAR int			SystemConfigChanges VALUE(0);
+VAR unsigned		SystemWebGen	VALUE(0);
 VAR int			SystemNumSettings VALUE(0);
 VAR cups_option_t	*SystemSettings	VALUE(NULL);
 
+VAR int			AcceptWorkers	VALUE(0);
 VAR char		*BinDir		VALUE(NULL);
+VAR int			ClientWorkers	VALUE(0);
 VAR char		*ConfigDirectory VALUE(NULL);
 VAR char		*DataDirectory	VALUE(NULL);
 VAR int			DefaultPort	VALUE(0);
@@ -675,22 +975,39 @@ VAR server_printer_t	*DefaultPrinter	VALUE(NULL);
 VAR char		*DefaultSystemURI VALUE(NULL);
 VAR http_encryption_t	Encryption	VALUE(HTTP_ENCRYPTION_IF_REQUESTED);
 VAR cups_array_t	*FileDirectories VALUE(NULL);
+VAR int			JobHistory	VALUE(0);
+VAR int			JobPriorityAging VALUE(0);
+VAR int			JobProgressInterval VALUE(0);
+VAR server_scheduler_t	JobScheduler	VALUE(SERVER_SCHEDULER_PRIORITY);
+VAR int			JobWorkers	VALUE(0);
 VAR int			KeepFiles	VALUE(0);
 #ifdef HAVE_SSL
 VAR char		*KeychainPath	VALUE(NULL);
 #endif /* HAVE_SSL */
 VAR cups_array_t	*Listeners	VALUE(NULL);
+VAR int			LogAsync	VALUE(0);
 VAR char		*LogFile	VALUE(NULL);
 VAR server_loglevel_t	LogLevel	VALUE(SERVER_LOGLEVEL_ERROR);
-VAR int			MaxJobs		VALUE(100),
+VAR int			LogSlowRequests	VALUE(0);
+VAR int			MaxActiveRequests VALUE(0),
+			MaxClientsPerHost VALUE(0),
+			MaxJobs		VALUE(100),
                         MaxCompletedJobs VALUE(100),
+			MaxRequestsPerUser VALUE(0),
+                        MaxSubscriptionEvents VALUE(100),
                         NextPrinterId	VALUE(1);
+VAR server_rate_t	RateLimits[SERVER_OPCLASS_MAX];
 VAR cups_array_t	*Printers	VALUE(NULL);
 VAR _cups_rwlock_t	PrintersRWLock	VALUE(_CUPS_RWLOCK_INITIALIZER);
 VAR int			RelaxedConformance VALUE(0);
 VAR char		*ServerName	VALUE(NULL);
 VAR char		*SpoolDirectory	VALUE(NULL);
+VAR off_t		SpoolMemoryLimit VALUE(0);
+VAR server_spoolsync_t	SpoolSync	VALUE(SERVER_SPOOLSYNC_NONE);
 VAR char		*StateDirectory	VALUE(NULL);
+VAR int			StateSnapshots	VALUE(0);
+VAR off_t		TransformCacheSize VALUE(0);
+VAR int			TransformWorkers VALUE(0);
 
 VAR int			DNSSDEnabled	VALUE(1);
 #ifdef HAVE_DNSSD
@@ -708,7 +1025,6 @@ VAR cups_array_t	*ResourcesByPath VALUE(NULL);
 VAR int			NextResourceId 	VALUE(1);
 
 VAR _cups_mutex_t	NotificationMutex VALUE(_CUPS_MUTEX_INITIALIZER);
-VAR _cups_cond_t	NotificationCondition VALUE(_CUPS_COND_INITIALIZER);
 VAR _cups_rwlock_t	SubscriptionsRWLock VALUE(_CUPS_RWLOCK_INITIALIZER);
 VAR cups_array_t	*Subscriptions	VALUE(NULL);
 VAR int			NextSubscriptionId VALUE(1);
@@ -718,50 +1034,79 @@ VAR int			NextSubscriptionId VALUE(1);
  * Functions...
  */
 
+extern int		serverAdmitClient(server_client_t *client);
+extern int		serverAdmitRequest(server_client_t *client);
 extern void		serverAddEventNoLock(server_printer_t *printer, server_job_t *job, server_resource_t *res, server_event_t event, const char *message, ...) _CUPS_FORMAT(5, 6);
+extern int		serverAddJobHistoryNoLock(server_job_t *job);
 extern void		serverAddPrinter(server_printer_t *printer);
+extern void		serverAddTimer(time_t when, server_timer_cb_t cb, void *data);
 extern void		serverAddResourceFile(server_resource_t *res, const char *filename, const char *format);
+extern int		serverAddResourceId(server_rset_t *set, int id);
 extern void		serverAddStringsFile(server_printer_t *printer, const char *language, server_resource_t *resource);
 extern void		serverAllocatePrinterResource(server_printer_t *printer, server_resource_t *resource);
+extern server_device_t	*serverAssignJobNoLock(server_job_t *job);
+extern void		serverAssignJobsNoLock(server_printer_t *printer);
 extern http_status_t	serverAuthenticateClient(server_client_t *client);
 extern int		serverAuthorizeUser(server_client_t *client, const char *owner, gid_t group, const char *scope);
+extern void		serverClearAuthCache(const char *username);
 extern void		serverCheckJobs(server_printer_t *printer);
 extern void             serverCleanAllJobs(void);
 extern void		serverCleanJobs(server_printer_t *printer);
+extern void		serverClearResourceIds(server_rset_t *set);
+extern void		serverCleanJobHistoryNoLock(server_printer_t *printer);
+extern void		serverClearPrinterCacheNoLock(server_printer_t *printer);
+extern void		serverCloseJobHistory(server_printer_t *printer);
+extern int		serverCloseSpoolFile(int fd, const char *filename);
 extern void		serverCopyAttributes(ipp_t *to, ipp_t *from, cups_array_t *ra, cups_array_t *pa, ipp_tag_t group_tag, int quickcopy);
+extern void		serverCompleteJobNoLock(server_job_t *job, ipp_jstate_t state);
 extern void		serverCopyJobStateReasons(ipp_t *ipp, ipp_tag_t group_tag, server_job_t *job);
 extern void		serverCopyPrinterStateReasons(ipp_t *ipp, ipp_tag_t group_tag, server_printer_t *printer);
+extern void		serverCopySubscriptionEvent(ipp_t *ipp, server_subscription_t *sub, server_sevent_t *event);
 extern server_client_t	*serverCreateClient(int sock);
 extern server_device_t	*serverCreateDevice(server_client_t *client);
 extern server_device_t	*serverCreateDevicePinfo(server_pinfo_t *pinfo, const char *uuid);
 extern server_job_t	*serverCreateJob(server_client_t *client);
+extern int		serverCreateJobFile(server_job_t *job, const char *format, off_t length, char *fname, size_t fnamesize);
 extern void		serverCreateJobFilename(server_job_t *job, const char *format, char *fname, size_t fnamesize);
 extern int		serverCreateListeners(const char *host, int port);
-extern server_printer_t	*serverCreatePrinter(const char *resource, const char *name, const char *info, server_pinfo_t *pinfo, int dupe_pinfo);
+extern server_printer_t	*serverCreatePrinter(const char *resource, const char *name, const char *info, server_pinfo_t *pinfo, int dupe_pinfo, int register_dnssd);
 extern server_resource_t *serverCreateResource(const char *resource, const char *filename, const char *format, const char *name, const char *info, const char *type, const char *language);
 extern void		serverCreateResourceFilename(server_resource_t *res, const char *format, const char *prefix, char *fname, size_t fnamesize);
+extern char		*serverCreateSpoolDirectory(const char *parent, int id, char *buffer, size_t bufsize);
 extern server_subscription_t *serverCreateSubscription(server_client_t *client, int interval, int lease, const char *username, ipp_attribute_t *notify_charset, ipp_attribute_t *notify_natural_language, ipp_attribute_t *notify_events, ipp_attribute_t *notify_attributes, ipp_attribute_t *notify_user_data);
 extern int		serverCreateSystem(const char *directory);
 extern void		serverDeallocatePrinterResource(server_printer_t *printer, server_resource_t *resource);
 extern void		serverDeleteClient(server_client_t *client);
 extern void		serverDeleteDevice(server_device_t *device);
+extern void		serverDeleteHistoryJob(server_job_t *job);
 extern void		serverDeleteJob(server_job_t *job);
 extern void		serverDeletePrinter(server_printer_t *printer);
 extern void		serverDeleteResource(server_resource_t *res);
 extern void		serverDeleteSubscription(server_subscription_t *sub);
 extern void		serverDisablePrinter(server_printer_t *printer);
 extern void		serverEnablePrinter(server_printer_t *printer);
+extern size_t		serverEncodeResponse(server_client_t *client);
 extern server_device_t	*serverFindDevice(server_client_t *client);
+extern server_job_t	*serverFindHistoryJob(server_client_t *client, int job_id);
 extern server_job_t	*serverFindJob(server_client_t *client, int job_id);
 extern server_printer_t	*serverFindPrinter(const char *resource);
 extern server_resource_t *serverFindResourceById(int id);
 extern server_resource_t *serverFindResourceByPath(const char *resource);
 extern server_resource_t *serverFindResourceByFilename(const char *filename);
 extern server_subscription_t *serverFindSubscription(server_client_t *client, int sub_id);
+extern server_userjobs_t *serverFindUserJobs(server_printer_t *printer, const char *username);
+extern int		serverGetJobAttributes(server_job_t *job, ipp_t **attrs, ipp_t **doc_attrs);
 extern server_jreason_t	serverGetJobStateReasonsBits(ipp_attribute_t *attr);
+extern void		serverGetJobStatus(server_job_t *job, server_jstatus_t *status);
 extern server_event_t	serverGetNotifyEventsBits(ipp_attribute_t *attr);
 extern const char	*serverGetNotifySubscribedEvent(server_event_t event);
 extern server_preason_t	serverGetPrinterStateReasonsBits(ipp_attribute_t *attr);
+extern server_vcache_t	*serverGetPrinterValidationNoLock(server_printer_t *printer);
+extern ipp_t		*serverGetSystemAttributes(unsigned *epoch);
+extern const unsigned char *serverGetResourceData(server_resource_t *res, size_t *datalen, char *etag, size_t etagsize);
+extern ipp_t		*serverGetResourceTemplate(server_resource_t *res);
+extern double		serverGetTime(void);
+extern int		serverHasResourceId(server_rset_t *set, int id);
 extern int		serverHoldJob(server_job_t *job, ipp_attribute_t *hold_until);
 extern int		serverLoadAttributes(const char *filename, server_pinfo_t *pinfo);
 extern void		serverLog(server_loglevel_t level, const char *format, ...) _CUPS_FORMAT(2, 3);
@@ -770,15 +1115,33 @@ extern void		serverLogClient(server_loglevel_t level, server_client_t *client, c
 extern void		serverLogJob(server_loglevel_t level, server_job_t *job, const char *format, ...) _CUPS_FORMAT(3, 4);
 extern void		serverLogPrinter(server_loglevel_t level, server_printer_t *printer, const char *format, ...) _CUPS_FORMAT(3, 4);
 extern char		*serverMakeVCARD(const char *user, const char *name, const char *location, const char *email, const char *phone, char *buffer, size_t bufsize);
+extern void		serverMarkPrinterDeleted(server_printer_t *printer);
+extern void		serverMarkPrinterDirty(server_printer_t *printer);
+extern void		serverMetricsAdjust(server_metric_t metric, int delta);
+extern void		serverMetricsRequest(ipp_op_t op, double seconds);
+extern void		serverMetricsTransform(double seconds, server_usage_t *usage);
+extern void		serverOpenJobHistory(server_printer_t *printer);
 extern void		serverPausePrinter(server_printer_t *printer, int immediately);
 extern void		*serverProcessClient(server_client_t *client);
 extern int		serverProcessHTTP(server_client_t *client);
+extern void		serverPreallocateSpoolFile(int fd, off_t length);
+extern int		serverPreflightIPP(server_client_t *client);
 extern int		serverProcessIPP(server_client_t *client);
 extern void		*serverProcessJob(server_job_t *job);
+extern void		serverPublishPrinters(void);
+extern void		serverPublishSystem(void);
+extern server_job_t	*serverReadJobHistoryNoLock(server_printer_t *printer, server_hentry_t *entry);
 extern int		serverRegisterPrinter(server_printer_t *printer);
+extern int		serverRegisterPrinters(int num_printers, server_printer_t **printers);
+extern void		serverReleaseClient(server_client_t *client);
+extern void		serverReleaseDeviceJobNoLock(server_job_t *job);
 extern int		serverReleaseJob(server_job_t *job);
+extern void		serverReleaseRequest(server_client_t *client);
+extern void		serverReleaseSystemAttributes(unsigned epoch);
+extern int		serverRemoveResourceId(server_rset_t *set, int id);
 extern int		serverRespondHTTP(server_client_t *client, http_status_t code, const char *content_coding, const char *type, size_t length);
 extern void		serverRespondIPP(server_client_t *client, ipp_status_t status, const char *message, ...) _CUPS_FORMAT(3, 4);
+extern int		serverRespondMetrics(server_client_t *client);
 extern void		serverRespondUnsupported(server_client_t *client, ipp_attribute_t *attr);
 extern void		serverRestartPrinter(server_printer_t *printer);
 extern void		serverResumePrinter(server_printer_t *printer);
@@ -786,8 +1149,12 @@ extern void		serverRun(void);
 extern void		serverSaveSystem(void);
 extern void		serverSetResourceState(server_resource_t *resource, ipp_rstate_t state, const char *message, ...) _CUPS_FORMAT(3, 4);
 extern void		serverStopJob(server_job_t *job);
+extern void		serverStopPrinterJobs(server_printer_t *printer);
+extern int		serverStreamJob(server_job_t *job, const char *filename);
 extern char		*serverTimeString(time_t tv, char *buffer, size_t bufsize);
 extern int		serverTransformJob(server_client_t *client, server_job_t *job, const char *command, const char *format, server_transform_t mode);
 extern void		serverUnregisterPrinter(server_printer_t *printer);
 extern void		serverUpdateDeviceAttributesNoLock(server_printer_t *printer);
 extern void		serverUpdateDeviceStateNoLock(server_printer_t *printer);
+extern int		serverUpdatePrinterTXT(server_printer_t *printer);
+extern int		serverWaitSubscriptionEvents(ipp_attribute_t *sub_ids, ipp_attribute_t *seq_nums, double timeout);
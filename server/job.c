@@ -9,6 +9,76 @@
  */
 
 #include "ippserver.h"
+#ifdef HAVE_MEMFD_CREATE
+#  include <sys/mman.h>
+#endif /* HAVE_MEMFD_CREATE */
+
+
+/*
+ * Local constants...
+ */
+
+#define SERVER_CLEAN_BATCH	50	/* Maximum jobs to clean per lock */
+
+
+/*
+ * Local types...
+ */
+
+typedef struct server_jobref_s		/**** Job reference for timers ****/
+{
+  int		printer_id,		/* Printer ID */
+		job_id;			/* job-id */
+} server_jobref_t;
+
+typedef struct server_jobkey_s		/**** Job scheduling key ****/
+{
+  int		priority,		/* Aged job-priority */
+		impressions,		/* job-impressions */
+		k_octets,		/* job-k-octets */
+		running;		/* Processing jobs for the same user */
+  time_t	served;			/* Last time the user was served */
+} server_jobkey_t;
+
+typedef struct server_jobbuf_s		/**** Compact attribute buffer ****/
+{
+  ipp_uchar_t	*ptr,			/* Current position in buffer */
+		*end;			/* End of buffer */
+} server_jobbuf_t;
+
+
+/*
+ * Local globals...
+ */
+
+static _cups_mutex_t	job_mutex = _CUPS_MUTEX_INITIALIZER;
+					/* Mutex for job worker data */
+static _cups_cond_t	job_cond = _CUPS_COND_INITIALIZER;
+					/* Condition for queued jobs */
+static cups_array_t	*job_queue = NULL;
+					/* Jobs waiting for a worker */
+static int		job_num_workers = 0;
+					/* Number of job worker threads */
+
+
+/*
+ * Local functions...
+ */
+
+static void		compact_job(server_job_t *job);
+static int		compare_jobs(server_job_t *a, server_job_t *b);
+static int		compare_keys(server_jobkey_t *a, server_jobkey_t *b);
+static int		find_job_id(server_client_t *client, int job_id);
+static void		finish_job(server_job_t *job);
+static void		make_key(server_printer_t *printer, server_job_t *job, time_t curtime, server_jobkey_t *key);
+static ssize_t		read_buffer_cb(server_jobbuf_t *buf, ipp_uchar_t *buffer, size_t bytes);
+static void		release_held_job(server_jobref_t *ref);
+static int		release_printer(server_job_t *job);
+static void		*run_job(server_job_t *job);
+static void		*run_job_worker(void *data);
+static server_job_t	*select_job(server_printer_t *printer);
+static int		start_job(server_job_t *job);
+static ssize_t		write_buffer_cb(server_jobbuf_t *buf, ipp_uchar_t *buffer, size_t bytes);
 
 
 /*
@@ -19,18 +89,22 @@ void
 serverCheckJobs(server_printer_t *printer)	/* I - Printer */
 {
   server_job_t	*job;			/* Current job */
+  int		num_processing = cupsArrayCount(printer->processing_jobs),
+					/* Number of processing jobs */
+		max_processing = printer->pinfo.max_processing > 1 ? printer->pinfo.max_processing : 1;
+					/* Maximum number of processing jobs */
 
 
-  serverLogPrinter(SERVER_LOGLEVEL_DEBUG, printer, "Checking for new jobs to process.");
+  SERVER_LOG_PRINTER_DEBUG(printer, "Checking for new jobs to process.");
 
-  if (printer->processing_job)
+  if (num_processing >= max_processing || (num_processing > 0 && (printer->is_shutdown || printer->is_deleted || (printer->state_reasons & SERVER_PREASON_MOVING_TO_PAUSED))))
   {
-    serverLogPrinter(SERVER_LOGLEVEL_DEBUG, printer, "Printer is already processing job %d.", printer->processing_job->id);
+    SERVER_LOG_PRINTER_DEBUG(printer, "Printer is already processing job %d.", printer->processing_job->id);
     return;
   }
   else if (printer->state == IPP_PSTATE_STOPPED)
   {
-    serverLogPrinter(SERVER_LOGLEVEL_DEBUG, printer, "Printer is stopped.");
+    SERVER_LOG_PRINTER_DEBUG(printer, "Printer is stopped.");
     return;
   }
   else if (printer->is_shutdown)
@@ -38,14 +112,14 @@ serverCheckJobs(server_printer_t *printer)	/* I - Printer */
     _cupsRWLockWrite(&printer->rwlock);
 
     printer->state = IPP_PSTATE_STOPPED;
-    serverLogPrinter(SERVER_LOGLEVEL_DEBUG, printer, "Printer is now shutdown.");
+    SERVER_LOG_PRINTER_DEBUG(printer, "Printer is now shutdown.");
     serverAddEventNoLock(printer, NULL, NULL, SERVER_EVENT_PRINTER_STATE_CHANGED | SERVER_EVENT_PRINTER_SHUTDOWN, "Printer shutdown.");
     _cupsRWUnlock(&printer->rwlock);
     return;
   }
   else if (printer->is_deleted)
   {
-    serverLogPrinter(SERVER_LOGLEVEL_DEBUG, printer, "Printer is being deleted.");
+    SERVER_LOG_PRINTER_DEBUG(printer, "Printer is being deleted.");
     return;
   }
   else if (printer->state_reasons & SERVER_PREASON_MOVING_TO_PAUSED)
@@ -55,47 +129,61 @@ serverCheckJobs(server_printer_t *printer)	/* I - Printer */
     printer->state_reasons |= SERVER_PREASON_PAUSED;
     printer->state_reasons &= (server_preason_t)~SERVER_PREASON_MOVING_TO_PAUSED;
 
-    serverLogPrinter(SERVER_LOGLEVEL_DEBUG, printer, "Printer is now stopped.");
+    SERVER_LOG_PRINTER_DEBUG(printer, "Printer is now stopped.");
     serverAddEventNoLock(printer, NULL, NULL, SERVER_EVENT_PRINTER_STATE_CHANGED, "Printer is now stopped.");
     _cupsRWUnlock(&printer->rwlock);
     return;
   }
+  else if (printer->state_reasons & SERVER_PREASON_MEDIA_EMPTY)
+  {
+   /*
+    * Leave jobs pending until media is loaded, which checks for jobs
+    * again...
+    */
+
+    _cupsRWLockWrite(&printer->rwlock);
+    if (!(printer->state_reasons & SERVER_PREASON_MEDIA_NEEDED) && select_job(printer))
+    {
+      printer->state_reasons |= SERVER_PREASON_MEDIA_NEEDED;
+
+      SERVER_LOG_PRINTER_DEBUG(printer, "Printer needs media.");
+      serverAddEventNoLock(printer, NULL, NULL, SERVER_EVENT_PRINTER_STATE_CHANGED, "Printer needs media.");
+    }
+    _cupsRWUnlock(&printer->rwlock);
+    return;
+  }
 
   _cupsRWLockWrite(&printer->rwlock);
-  for (job = (server_job_t *)cupsArrayFirst(printer->active_jobs);
-       job;
-       job = (server_job_t *)cupsArrayNext(printer->active_jobs))
+
+  while (cupsArrayCount(printer->processing_jobs) < max_processing && (job = select_job(printer)) != NULL)
   {
-    if (job->state == IPP_JSTATE_HELD && job->hold_until > 0 && job->hold_until <= time(NULL))
-      serverReleaseJob(job);
+    SERVER_LOG_PRINTER_DEBUG(printer, "Starting job %d.", job->id);
 
-    if (job->state == IPP_JSTATE_PENDING || (job->state == IPP_JSTATE_STOPPED && !(job->state_reasons & SERVER_JREASON_JOB_FETCHABLE)))
-    {
-      serverLogPrinter(SERVER_LOGLEVEL_DEBUG, printer, "Starting job %d.", job->id);
+   /*
+    * Claim the printer now so the job cannot be started twice while it
+    * waits for a thread...
+    */
 
-      _cups_thread_t t = _cupsThreadCreate((_cups_thread_func_t)serverProcessJob, job);
+    cupsArrayAdd(printer->processing_jobs, job);
+    printer->processing_job = job;
 
-      if (t)
-      {
-        _cupsThreadDetach(t);
-      }
-      else
-      {
-        _cupsRWLockWrite(&job->rwlock);
+    if (!start_job(job))
+    {
+      release_printer(job);
 
-        job->state     = IPP_JSTATE_ABORTED;
-	job->completed = time(NULL);
+      _cupsRWLockWrite(&job->rwlock);
 
-        serverAddEventNoLock(printer, job, NULL, SERVER_EVENT_JOB_COMPLETED, "Job aborted because creation of processing thread failed.");
+      serverCompleteJobNoLock(job, IPP_JSTATE_ABORTED);
 
-        _cupsRWUnlock(&job->rwlock);
-      }
+      serverAddEventNoLock(printer, job, NULL, SERVER_EVENT_JOB_COMPLETED, "Job aborted because creation of processing thread failed.");
+
+      _cupsRWUnlock(&job->rwlock);
       break;
     }
   }
 
-  if (!job)
-    serverLogPrinter(SERVER_LOGLEVEL_DEBUG, printer, "No jobs to process at this time.");
+  if (cupsArrayCount(printer->processing_jobs) == num_processing)
+    SERVER_LOG_PRINTER_DEBUG(printer, "No jobs to process at this time.");
 
   _cupsRWUnlock(&printer->rwlock);
 }
@@ -110,23 +198,41 @@ serverCleanJobs(server_printer_t *printer)	/* I - Printer */
 {
   server_job_t	*job;			/* Current job */
   time_t	cleantime;		/* Clean time */
+  int		count;			/* Jobs cleaned in this batch */
 
 
-  serverLogPrinter(SERVER_LOGLEVEL_DEBUG, printer, "Cleaning jobs, %d completed jobs in memory...", cupsArrayCount(printer->completed_jobs));
+  SERVER_LOG_PRINTER_DEBUG(printer, "Cleaning jobs, %d completed jobs in memory...", cupsArrayCount(printer->completed_jobs));
+
+  if (printer->history)
+  {
+    _cupsRWLockWrite(&(printer->rwlock));
+    serverCleanJobHistoryNoLock(printer);
+    _cupsRWUnlock(&(printer->rwlock));
+  }
 
   if (cupsArrayCount(printer->completed_jobs) == 0)
     return;
 
   cleantime = time(NULL) - 60;
 
-  serverLogPrinter(SERVER_LOGLEVEL_DEBUG, printer, "Clean time is %ld.", (long)cleantime);
+  SERVER_LOG_PRINTER_DEBUG(printer, "Clean time is %ld.", (long)cleantime);
+
+ /*
+  * The completed_jobs array is sorted by completion time, so expired jobs
+  * are always at the front and we can stop at the first job that is still
+  * too new.  Jobs are removed in small batches so that the printer write
+  * lock is not held across a large sweep...
+  */
+
+  do
+  {
+    _cupsRWLockWrite(&(printer->rwlock));
 
-  _cupsRWLockWrite(&(printer->rwlock));
-  for (job = (server_job_t *)cupsArrayFirst(printer->completed_jobs);
-       job;
-       job = (server_job_t *)cupsArrayNext(printer->completed_jobs))
-    if (job->completed && job->completed < cleantime)
+    for (count = 0; count < SERVER_CLEAN_BATCH; count ++)
     {
+      if ((job = (server_job_t *)cupsArrayFirst(printer->completed_jobs)) == NULL || !job->completed || job->completed >= cleantime)
+        break;
+
      /*
       * Grab the write lock to make sure there are no readers of the job
       * object.  The printer write lock will prevent subsequent lookups of
@@ -136,15 +242,92 @@ serverCleanJobs(server_printer_t *printer)	/* I - Printer */
       _cupsRWLockWrite(&job->rwlock);
       _cupsRWUnlock(&job->rwlock);
 
-      serverLogJob(SERVER_LOGLEVEL_DEBUG, job, "Cleaning job #%d.", job->id);
+      SERVER_LOG_JOB_DEBUG(job, "Cleaning job #%d.", job->id);
       cupsArrayRemove(printer->completed_jobs, job);
       cupsArrayRemove(printer->jobs, job); /* Last since removing a job from here calls serverDeleteJob() */
     }
-    else if (job->completed)
-      serverLogJob(SERVER_LOGLEVEL_DEBUG, job, "Not cleaning job #%d - completed on %ld.", job->id, (long)job->completed);
-    else
-      break;
-  _cupsRWUnlock(&(printer->rwlock));
+
+    _cupsRWUnlock(&(printer->rwlock));
+  }
+  while (count == SERVER_CLEAN_BATCH);
+}
+
+
+/*
+ * 'serverCloseSpoolFile()' - Close a spool file using the "SpoolSync" policy.
+ *
+ * With "SpoolSync Close" the file data is written to disk before the file is
+ * closed.  "SpoolSync Job" also syncs the directory containing the file so
+ * that the spooled job survives a crash.
+ */
+
+int					/* O - 0 on success, -1 on error */
+serverCloseSpoolFile(
+    int        fd,			/* I - File descriptor */
+    const char *filename)		/* I - Filename */
+{
+  if (SpoolSync != SERVER_SPOOLSYNC_NONE && fsync(fd))
+  {
+    int error = errno;			/* Sync error */
+
+    close(fd);
+    errno = error;
+
+    return (-1);
+  }
+
+  if (close(fd))
+    return (-1);
+
+  if (SpoolSync == SERVER_SPOOLSYNC_JOB)
+  {
+    char	dirname[1024],		/* Directory name */
+		*ptr;			/* Pointer into directory name */
+    int		dirfd;			/* Directory file descriptor */
+
+    strlcpy(dirname, filename, sizeof(dirname));
+
+    if ((ptr = strrchr(dirname, '/')) != NULL)
+      *ptr = '\0';
+
+    if ((dirfd = open(dirname, O_RDONLY)) >= 0)
+    {
+      fsync(dirfd);
+      close(dirfd);
+    }
+  }
+
+  return (0);
+}
+
+
+/*
+ * 'serverCompleteJobNoLock()' - Move a job to the printer's completed jobs.
+ *
+ * The job and document attributes are compacted since they can no longer
+ * change - use serverGetJobAttributes() to access them.  The job is also
+ * added to the printer's job history, if enabled.
+ *
+ * Note: Caller MUST lock the printer and job objects for writing before using.
+ */
+
+void
+serverCompleteJobNoLock(
+    server_job_t *job,			/* I - Job */
+    ipp_jstate_t state)			/* I - New job-state value */
+{
+  SERVER_SEQ_BEGIN(job->status_seq);
+  job->state = state;
+  SERVER_SEQ_END(job->status_seq);
+
+  job->completed = time(NULL);
+
+  if (cupsArrayRemove(job->printer->active_jobs, job))
+    cupsArrayAdd(job->printer->completed_jobs, job);
+
+  serverReleaseDeviceJobNoLock(job);
+  compact_job(job);
+  serverAddJobHistoryNoLock(job);
 }
 
 
@@ -158,6 +341,7 @@ serverCopyJobStateReasons(
     ipp_tag_t    group_tag,		/* I - Group */
     server_job_t *job)			/* I - Printer */
 {
+  server_jstatus_t	status;		/* Job status */
   server_jreason_t	creasons;	/* Combined job-state-reasons */
   const char		*name;		/* Attribute name */
 
@@ -167,7 +351,9 @@ serverCopyJobStateReasons(
   else
     name = "job-state-reasons";
 
-  creasons = job->state_reasons | job->dev_state_reasons;
+  serverGetJobStatus(job, &status);
+
+  creasons = status.state_reasons;
 
   if (!creasons)
   {
@@ -202,6 +388,8 @@ serverCreateJob(
 {
   server_job_t		*job;		/* Job */
   ipp_attribute_t	*attr;		/* Job attribute */
+  const char		*username;	/* requesting-user-name value */
+  server_userjobs_t	*ujobs;		/* Jobs for user */
   char			uri[1024],	/* job-uri value */
 			uuid[64];	/* job-uuid value */
   server_listener_t	*lis = (server_listener_t *)cupsArrayFirst(Listeners);
@@ -230,6 +418,9 @@ serverCreateJob(
   job->attrs      = ippNew();
   job->state      = IPP_JSTATE_HELD;
   job->fd         = -1;
+  job->memfd      = -1;
+  job->stream_fd  = -1;
+  job->stream_in  = -1;
 
  /*
   * Copy all of the job attributes...
@@ -247,13 +438,19 @@ serverCreateJob(
     job->priority = 50;
 
   if (client->username[0])
-    job->username = client->username;
+    username = client->username;
   else if ((attr = ippFindAttribute(client->request, "requesting-user-name", IPP_TAG_NAME)) != NULL)
-    job->username = ippGetString(attr, 0, NULL);
+    username = ippGetString(attr, 0, NULL);
   else
-    job->username = "anonymous";
+    username = "anonymous";
+
+ /*
+  * Point at our own copy of the username since it is also used as the key
+  * for the per-user jobs index...
+  */
 
-  ippAddString(job->attrs, IPP_TAG_JOB, IPP_TAG_NAME, "job-originating-user-name", NULL, job->username);
+  attr          = ippAddString(job->attrs, IPP_TAG_JOB, IPP_TAG_NAME, "job-originating-user-name", NULL, username);
+  job->username = ippGetString(attr, 0, NULL);
 
   if (ippGetOperation(client->request) != IPP_OP_CREATE_JOB)
   {
@@ -293,12 +490,80 @@ serverCreateJob(
   cupsArrayAdd(client->printer->jobs, job);
   cupsArrayAdd(client->printer->active_jobs, job);
 
+  if ((ujobs = serverFindUserJobs(client->printer, job->username)) == NULL && (ujobs = calloc(1, sizeof(server_userjobs_t))) != NULL)
+  {
+    ujobs->username = strdup(job->username);
+    ujobs->jobs     = cupsArrayNew((cups_array_func_t)compare_jobs, NULL);
+
+    cupsArrayAdd(client->printer->user_jobs, ujobs);
+  }
+
+  if (ujobs)
+    cupsArrayAdd(ujobs->jobs, job);
+
   _cupsRWUnlock(&(client->printer->rwlock));
 
   return (job);
 }
 
 
+/*
+ * 'serverCreateJobFile()' - Create the spool file for a document in a job.
+ *
+ * Documents of up to "SpoolMemoryLimit" bytes are kept in anonymous memory
+ * unless the files are kept or the printer has a job history.  The filename
+ * is then a "/proc/PID/fd/N" path that the server and its transform commands
+ * can open for reading.  Otherwise the file is created in the spool directory
+ * and preallocated.
+ */
+
+int					/* O - File descriptor for writing or -1 on error */
+serverCreateJobFile(
+    server_job_t *job,			/* I - Job */
+    const char   *format,		/* I - Format or `NULL` */
+    off_t        length,		/* I - Expected length or 0 if unknown */
+    char         *fname,		/* I - Filename buffer */
+    size_t       fnamesize)		/* I - Size of filename buffer */
+{
+  int	fd;				/* File descriptor */
+
+
+#ifdef HAVE_MEMFD_CREATE
+  if (SpoolMemoryLimit > 0 && length > 0 && length <= SpoolMemoryLimit && !KeepFiles && !job->printer->history)
+  {
+    if (job->memfd < 0)
+    {
+      char	name[64];		/* Name for debugging */
+
+      snprintf(name, sizeof(name), "ippserver-job-%d", job->id);
+      job->memfd = memfd_create(name, MFD_CLOEXEC);
+    }
+
+    if (job->memfd >= 0 && !ftruncate(job->memfd, 0) && lseek(job->memfd, 0, SEEK_SET) == 0 && (fd = fcntl(job->memfd, F_DUPFD_CLOEXEC, 0)) >= 0)
+    {
+      snprintf(fname, fnamesize, "/proc/%d/fd/%d", (int)getpid(), job->memfd);
+      return (fd);
+    }
+
+    serverLogJob(SERVER_LOGLEVEL_ERROR, job, "Unable to spool document in memory: %s", strerror(errno));
+
+    if (job->memfd >= 0)
+    {
+      close(job->memfd);
+      job->memfd = -1;
+    }
+  }
+#endif /* HAVE_MEMFD_CREATE */
+
+  serverCreateJobFilename(job, format, fname, fnamesize);
+
+  if ((fd = open(fname, O_WRONLY | O_CREAT | O_TRUNC | O_BINARY, 0600)) >= 0)
+    serverPreallocateSpoolFile(fd, length);
+
+  return (fd);
+}
+
+
 /*
  * 'serverCreateJobFilename()' - Create the filename for a document in a job.
  */
@@ -310,7 +575,9 @@ void serverCreateJobFilename(
     size_t         fnamesize)		/* I - Size of filename buffer */
 {
   char			name[256],	/* "Safe" filename */
-			*nameptr;	/* Pointer into filename */
+			*nameptr,	/* Pointer into filename */
+			printerdir[1024],/* Printer spool directory */
+			sharddir[1024];	/* Shard directory */
   const char		*ext,		/* Filename extension */
 			*job_name;	/* job-name value */
   ipp_attribute_t	*job_name_attr;	/* job-name attribute */
@@ -374,10 +641,43 @@ void serverCreateJobFilename(
     ext = "prn";
 
  /*
-  * Create a filename with the job-id, job-name, and document-format (extension)...
+  * Create a filename with the job-id, job-name, and document-format (extension)
+  * in the shard directory for the job...
   */
 
-  snprintf(fname, fnamesize, "%s/%s/%d-%s.%s", SpoolDirectory, job->printer->name, job->id, name, ext);
+  snprintf(printerdir, sizeof(printerdir), "%s/%s", SpoolDirectory, job->printer->name);
+  serverCreateSpoolDirectory(printerdir, job->id, sharddir, sizeof(sharddir));
+
+  snprintf(fname, fnamesize, "%s/%d-%s.%s", sharddir, job->id, name, ext);
+}
+
+
+/*
+ * 'serverCreateSpoolDirectory()' - Create the shard directory for a job or
+ *                                  resource.
+ *
+ * Spool files are spread over 256 subdirectories of the parent directory,
+ * named using the low 8 bits of the job or resource ID in hex, so that no
+ * single directory gets too large.  The parent directory is created as
+ * needed.
+ */
+
+char *					/* O - Directory name */
+serverCreateSpoolDirectory(
+    const char *parent,			/* I - Parent directory */
+    int        id,			/* I - Job or resource ID */
+    char       *buffer,			/* I - Directory name buffer */
+    size_t     bufsize)			/* I - Size of directory name buffer */
+{
+  snprintf(buffer, bufsize, "%s/%02x", parent, id & 255);
+
+  if (mkdir(buffer, 0755) && errno == ENOENT)
+  {
+    if (!mkdir(parent, 0755) || errno == EEXIST)
+      mkdir(buffer, 0755);
+  }
+
+  return (buffer);
 }
 
 
@@ -389,27 +689,85 @@ void serverCreateJobFilename(
 void
 serverDeleteJob(server_job_t *job)		/* I - Job */
 {
-  serverLogJob(SERVER_LOGLEVEL_DEBUG, job, "Removing job #%d from history.", job->id);
+  server_userjobs_t	*ujobs;		/* Jobs for user */
+
+
+  SERVER_LOG_JOB_DEBUG(job, "Removing job #%d from history.", job->id);
+
+  SERVER_GEN_BUMP(job->printer->web_gen);
+  SERVER_GEN_BUMP(SystemWebGen);
+
+  if ((ujobs = serverFindUserJobs(job->printer, job->username)) != NULL)
+  {
+    cupsArrayRemove(ujobs->jobs, job);
+
+    if (cupsArrayCount(ujobs->jobs) == 0)
+      cupsArrayRemove(job->printer->user_jobs, ujobs);
+  }
 
   _cupsRWLockWrite(&job->rwlock);
 
   ippDelete(job->attrs);
   ippDelete(job->doc_attrs);
 
-  if (job->filename)
+  if (job->compact)
   {
-    if (!KeepFiles)
-      unlink(job->filename);
+   /*
+    * Release the strings that were retained when the job was compacted...
+    */
 
-    free(job->filename);
+    _cupsStrFree(job->name);
+    _cupsStrFree(job->username);
+    _cupsStrFree(job->format);
+
+    free(job->compact);
   }
 
+  if (job->memfd >= 0)
+    close(job->memfd);
+  else if (job->filename && !KeepFiles)
+    unlink(job->filename);
+
+  free(job->filename);
+
+  serverClearResourceIds(&job->resources);
+
   _cupsRWDeinit(&job->rwlock);
 
   free(job);
 }
 
 
+/*
+ * 'serverFindHistoryJob()' - Find a job in the job history.
+ *
+ * The returned job must be freed using serverDeleteHistoryJob().
+ */
+
+server_job_t *				/* O - Job or NULL */
+serverFindHistoryJob(
+    server_client_t *client,		/* I - Client */
+    int             job_id)		/* I - Job ID to find or 0 to lookup */
+{
+  server_printer_t	*printer = client->printer;
+					/* Printer */
+  server_hentry_t	key,		/* Search key */
+			*entry;		/* Matching entry, if any */
+  server_job_t		*job = NULL;	/* Matching job, if any */
+
+
+  if (!printer->history || (key.id = find_job_id(client, job_id)) <= 0)
+    return (NULL);
+
+  _cupsRWLockRead(&(printer->rwlock));
+  if ((entry = (server_hentry_t *)cupsArrayFind(printer->history, &key)) != NULL)
+    job = serverReadJobHistoryNoLock(printer, entry);
+  _cupsRWUnlock(&(printer->rwlock));
+
+  return (job);
+}
+
+
 /*
  * 'serverFindJob()' - Find a job specified in a request.
  */
@@ -419,42 +777,97 @@ serverFindJob(
     server_client_t *client,		/* I - Client */
     int             job_id)		/* I - Job ID to find or 0 to lookup */
 {
-  ipp_attribute_t	*attr;		/* job-id or job-uri attribute */
   server_job_t		key,		/* Job search key */
 			*job;		/* Matching job, if any */
 
 
-  if (job_id > 0)
+  if ((key.id = find_job_id(client, job_id)) <= 0)
+    return (NULL);
+
+  _cupsRWLockRead(&(client->printer->rwlock));
+  job = (server_job_t *)cupsArrayFind(client->printer->jobs, &key);
+  _cupsRWUnlock(&(client->printer->rwlock));
+
+  return (job);
+}
+
+
+/*
+ * 'serverFindUserJobs()' - Find the jobs for a user.
+ *
+ * Note: Caller MUST lock the printer object before using.
+ */
+
+server_userjobs_t *			/* O - Jobs for user or `NULL` if none */
+serverFindUserJobs(
+    server_printer_t *printer,		/* I - Printer */
+    const char       *username)		/* I - Username */
+{
+  server_userjobs_t	key;		/* Search key */
+
+
+  if (!username)
+    return (NULL);
+
+  key.username = (char *)username;
+
+  return ((server_userjobs_t *)cupsArrayFind(printer->user_jobs, &key));
+}
+
+
+/*
+ * 'serverGetJobAttributes()' - Get the job and document attributes of a job.
+ *
+ * Completed jobs only keep an encoded copy of their attributes, which is
+ * decoded into new messages that the caller must free with `ippDelete`.
+ * Otherwise the job's own messages are returned and must not be freed.
+ *
+ * Note: Caller MUST lock the printer object before using.
+ */
+
+int					/* O - 1 if the caller must free the attributes, 0 otherwise */
+serverGetJobAttributes(
+    server_job_t *job,			/* I - Job */
+    ipp_t        **attrs,		/* O - Job attributes */
+    ipp_t        **doc_attrs)		/* O - Document attributes or `NULL` */
+{
+  server_jobbuf_t	buf;		/* Read buffer */
+
+
+  if (!job->compact)
   {
-    key.id = job_id;
+    *attrs = job->attrs;
+
+    if (doc_attrs)
+      *doc_attrs = job->doc_attrs;
+
+    return (0);
   }
-  else if ((attr = ippFindAttribute(client->request, "job-uri", IPP_TAG_URI)) != NULL)
+
+  buf.ptr = job->compact;
+  buf.end = job->compact + job->compact_attrs;
+
+  *attrs = _ippNewArena();
+
+  if (ippReadIO(&buf, (ipp_iocb_t)read_buffer_cb, 1, NULL, *attrs) != IPP_STATE_DATA)
+    serverLogJob(SERVER_LOGLEVEL_ERROR, job, "Unable to decode job attributes: %s", cupsLastErrorString());
+
+  if (doc_attrs)
   {
-    const char	*uri = ippGetString(attr, 0, NULL);
-					/* job-uri value */
-    char	scheme[32],		/* URI scheme */
-		userpass[256],		/* username:password */
-		host[256],		/* Hostname/IP */
-		resource[1024];		/* Resource path */
-    int		port;			/* Port number */
+    if (job->compact_doc_attrs > 0)
+    {
+      buf.end += job->compact_doc_attrs;
 
-    if (httpSeparateURI(HTTP_URI_CODING_ALL, uri, scheme, sizeof(scheme), userpass, sizeof(userpass), host, sizeof(host), &port, resource, sizeof(resource)) >= HTTP_URI_STATUS_OK &&
-        !strncmp(resource, client->printer->resource, client->printer->resourcelen) &&
-        resource[client->printer->resourcelen] == '/')
-      key.id = atoi(resource + client->printer->resourcelen + 1);
+      *doc_attrs = _ippNewArena();
+
+      if (ippReadIO(&buf, (ipp_iocb_t)read_buffer_cb, 1, NULL, *doc_attrs) != IPP_STATE_DATA)
+        serverLogJob(SERVER_LOGLEVEL_ERROR, job, "Unable to decode document attributes: %s", cupsLastErrorString());
+    }
     else
-      return (NULL);
-  }
-  else if ((attr = ippFindAttribute(client->request, "job-id", IPP_TAG_INTEGER)) != NULL)
-  {
-    key.id = ippGetInteger(attr, 0);
+      *doc_attrs = NULL;
   }
 
-  _cupsRWLockRead(&(client->printer->rwlock));
-  job = (server_job_t *)cupsArrayFind(client->printer->jobs, &key);
-  _cupsRWUnlock(&(client->printer->rwlock));
-
-  return (job);
+  return (1);
 }
 
 
@@ -492,6 +905,35 @@ serverGetJobStateReasonsBits(
 }
 
 
+/*
+ * 'serverGetJobStatus()' - Get a consistent copy of the job status.
+ *
+ * The status is read without locking the job so that status queries never
+ * wait for or delay updates from the job processing threads.
+ */
+
+void
+serverGetJobStatus(
+    server_job_t     *job,		/* I - Job */
+    server_jstatus_t *status)		/* O - Job status */
+{
+  unsigned	seq;			/* Sequence number */
+
+
+  do
+  {
+    while ((seq = SERVER_SEQ_READ(job->status_seq)) & 1)
+      ;	/* Writer busy, try again */
+
+    status->state         = job->state;
+    status->state_reasons = job->state_reasons | job->dev_state_reasons;
+    status->impcompleted  = job->impcompleted;
+    status->cancel        = job->cancel;
+  }
+  while (SERVER_SEQ_RETRY(job->status_seq, seq));
+}
+
+
 /*
  * 'serverHoldJob()' - Hold a print job.
  */
@@ -513,6 +955,8 @@ serverHoldJob(
     return (0);
   }
 
+  SERVER_SEQ_BEGIN(job->status_seq);
+
   job->state = IPP_JSTATE_HELD;
 
   if (hold_until)
@@ -520,6 +964,8 @@ serverHoldJob(
   else
     job->state_reasons &= (server_jreason_t)~SERVER_JREASON_JOB_HOLD_UNTIL_SPECIFIED;
 
+  SERVER_SEQ_END(job->status_seq);
+
   if (ippGetValueTag(hold_until) == IPP_TAG_DATE)
   {
     job->hold_until = ippDateToTime(ippGetDate(hold_until, 0));
@@ -617,11 +1063,53 @@ serverHoldJob(
 
   _cupsRWUnlock(&job->rwlock);
 
-  return (1);
-}
+  if (job->hold_until > 0)
+  {
+   /*
+    * Release the job from the main loop when the hold expires...
+    */
 
+    server_jobref_t *ref;		/* Job reference for timer */
 
-/*
+    if ((ref = calloc(1, sizeof(server_jobref_t))) != NULL)
+    {
+      ref->printer_id = job->printer->id;
+      ref->job_id     = job->id;
+
+      serverAddTimer(job->hold_until, (server_timer_cb_t)release_held_job, ref);
+    }
+    else
+      serverLogJob(SERVER_LOGLEVEL_ERROR, job, "Unable to allocate memory for hold timer.");
+  }
+
+  return (1);
+}
+
+
+/*
+ * 'serverPreallocateSpoolFile()' - Reserve disk space for a spool file.
+ *
+ * The space is reserved without changing the file size, so a length that
+ * turns out to be wrong does no harm.
+ */
+
+void
+serverPreallocateSpoolFile(
+    int   fd,				/* I - File descriptor */
+    off_t length)			/* I - Expected length of file */
+{
+#ifdef HAVE_FALLOCATE
+  if (length > 0 && fallocate(fd, FALLOC_FL_KEEP_SIZE, 0, length))
+    SERVER_LOG_DEBUG("serverPreallocateSpoolFile: Unable to preallocate %ld bytes: %s", (long)length, strerror(errno));
+
+#else
+  (void)fd;
+  (void)length;
+#endif /* HAVE_FALLOCATE */
+}
+
+
+/*
  * 'serverProcessJob()' - Process a print job.
  */
 
@@ -630,28 +1118,20 @@ serverProcessJob(server_job_t *job)	/* I - Job */
 {
   _cupsRWLockWrite(&job->rwlock);
 
-  job->state                   = IPP_JSTATE_PROCESSING;
+  SERVER_SEQ_BEGIN(job->status_seq);
+  job->state = IPP_JSTATE_PROCESSING;
+  SERVER_SEQ_END(job->status_seq);
+
   job->printer->state          = IPP_PSTATE_PROCESSING;
   job->processing              = time(NULL);
   job->printer->processing_job = job;
 
+  SERVER_TRACE3(job__state, job->printer->id, job->id, job->state);
+
   serverAddEventNoLock(job->printer, job, NULL, SERVER_EVENT_JOB_STATE_CHANGED, "Job processing.");
 
   _cupsRWUnlock(&job->rwlock);
 
-  while (job->printer->state_reasons & SERVER_PREASON_MEDIA_EMPTY)
-  {
-    _cupsRWLockWrite(&job->printer->rwlock);
-    job->printer->state_reasons |= SERVER_PREASON_MEDIA_NEEDED;
-    _cupsRWUnlock(&job->printer->rwlock);
-
-    sleep(1);
-  }
-
-  _cupsRWLockWrite(&job->printer->rwlock);
-  job->printer->state_reasons &= (server_preason_t)~SERVER_PREASON_MEDIA_NEEDED;
-  _cupsRWUnlock(&job->printer->rwlock);
-
   if (job->printer->pinfo.command)
   {
    /*
@@ -668,8 +1148,16 @@ serverProcessJob(server_job_t *job)	/* I - Job */
 
     _cupsRWLockWrite(&job->rwlock);
 
+    SERVER_SEQ_BEGIN(job->status_seq);
     job->state         = IPP_JSTATE_STOPPED;
     job->state_reasons |= SERVER_JREASON_JOB_FETCHABLE;
+    SERVER_SEQ_END(job->status_seq);
+
+    SERVER_TRACE3(job__state, job->printer->id, job->id, job->state);
+
+    _cupsRWLockWrite(&job->printer->rwlock);
+    serverAssignJobNoLock(job);
+    _cupsRWUnlock(&job->printer->rwlock);
 
     serverAddEventNoLock(job->printer, job, NULL, SERVER_EVENT_JOB_STATE_CHANGED | SERVER_EVENT_JOB_FETCHABLE, "Job fetchable.");
 
@@ -678,22 +1166,359 @@ serverProcessJob(server_job_t *job)	/* I - Job */
   else
   {
    /*
-    * Sleep for a random amount of time to simulate job processing.
+    * Finish the job after a random amount of time to simulate job
+    * processing.  The job stays in the printer's processing jobs until then,
+    * so the timer can safely reference it without tying up this thread...
     */
 
-    sleep((unsigned)(1 + (CUPS_RAND() % 4)));
+    serverAddTimer(time(NULL) + 1 + (CUPS_RAND() % 4), (server_timer_cb_t)finish_job, job);
+    return (NULL);
+  }
+
+  finish_job(job);
+
+  return (NULL);
+}
+
+
+/*
+ * 'serverReleaseJob()' - Release a held print job.
+ */
+
+int					/* O - 1 on success, 0 on failure */
+serverReleaseJob(server_job_t *job)	/* I - Job to release */
+{
+  ipp_attribute_t	*attr;		/* Hold-until attribute */
+
+
+  if (job->state != IPP_JSTATE_HELD)
+    return (0);
+
+  _cupsRWLockWrite(&job->rwlock);
+
+  SERVER_SEQ_BEGIN(job->status_seq);
+  job->state         = IPP_JSTATE_PENDING;
+  job->state_reasons &= (server_jreason_t)~SERVER_JREASON_JOB_HOLD_UNTIL_SPECIFIED;
+  SERVER_SEQ_END(job->status_seq);
+
+  if ((attr = ippFindAttribute(job->attrs, "job-hold-until", IPP_TAG_ZERO)) != NULL)
+    ippDeleteAttribute(job->attrs, attr);
+
+  if ((attr = ippFindAttribute(job->attrs, "job-hold-until-time", IPP_TAG_ZERO)) != NULL)
+    ippDeleteAttribute(job->attrs, attr);
+
+  serverAddEventNoLock(job->printer, job, NULL, SERVER_EVENT_JOB_STATE_CHANGED, "Job released.");
+
+  _cupsRWUnlock(&job->rwlock);
+
+  return (1);
+}
+
+
+/*
+ * 'serverStreamJob()' - Start processing a job while its document is received.
+ *
+ * Streaming is only used when the printer has a command, the document format
+ * is listed in the printer's StreamFormats, and the job could be processed
+ * right away.  When 1 is returned the caller must copy the document data to
+ * "job->stream_fd" in addition to the spool file and close it at the end of
+ * the document.
+ */
+
+int					/* O - 1 if streaming, 0 otherwise */
+serverStreamJob(server_job_t *job,	/* I - Job */
+                const char   *filename)	/* I - Spool filename */
+{
+#ifdef _WIN32
+  (void)job;
+  (void)filename;
+
+  return (0);
+
+#else
+  server_printer_t	*printer = job->printer;
+					/* Printer */
+  server_job_t		*pjob;		/* Pending job */
+  const char		*ptr;		/* Pointer into stream formats */
+  size_t		formatlen;	/* Length of document format */
+  int			fds[2];		/* Stream pipe */
+
+
+  if (!printer->pinfo.command || !printer->pinfo.stream_formats || !job->format)
+    return (0);
+
+  formatlen = strlen(job->format);
+
+  for (ptr = printer->pinfo.stream_formats; ptr; ptr = strchr(ptr, ','))
+  {
+    if (*ptr == ',')
+      ptr ++;
+
+    if (!_cups_strncasecmp(ptr, job->format, formatlen) && (!ptr[formatlen] || ptr[formatlen] == ','))
+      break;
+  }
+
+  if (!ptr)
+    return (0);
+
+  _cupsRWLockWrite(&printer->rwlock);
+
+  if (cupsArrayCount(printer->processing_jobs) >= (printer->pinfo.max_processing > 1 ? printer->pinfo.max_processing : 1) || printer->state == IPP_PSTATE_STOPPED || printer->is_shutdown || printer->is_deleted || (printer->state_reasons & (SERVER_PREASON_MOVING_TO_PAUSED | SERVER_PREASON_HOLD_NEW_JOBS | SERVER_PREASON_MEDIA_EMPTY)) || job->state != IPP_JSTATE_HELD || (job->state_reasons & SERVER_JREASON_JOB_HOLD_UNTIL_SPECIFIED))
+  {
+    _cupsRWUnlock(&printer->rwlock);
+    return (0);
+  }
+
+  for (pjob = (server_job_t *)cupsArrayFirst(printer->active_jobs); pjob; pjob = (server_job_t *)cupsArrayNext(printer->active_jobs))
+  {
+    if (pjob != job && pjob->state == IPP_JSTATE_PENDING)
+      break;
+  }
+
+  if (pjob || pipe(fds))
+  {
+    _cupsRWUnlock(&printer->rwlock);
+    return (0);
   }
 
+ /*
+  * Don't let the transform command inherit the spooling end of the pipe, or
+  * it will never see the end of the document...
+  */
+
+  fcntl(fds[0], F_SETFD, FD_CLOEXEC);
+  fcntl(fds[1], F_SETFD, FD_CLOEXEC);
+#  ifdef F_SETNOSIGPIPE
+  fcntl(fds[1], F_SETNOSIGPIPE, 1);
+#  endif /* F_SETNOSIGPIPE */
+
   _cupsRWLockWrite(&job->rwlock);
 
+  job->filename  = strdup(filename);
+  job->stream_fd = fds[1];
+  job->stream_in = fds[0];
+
+  SERVER_SEQ_BEGIN(job->status_seq);
+  job->state = IPP_JSTATE_PENDING;
+  SERVER_SEQ_END(job->status_seq);
+
+  _cupsRWUnlock(&job->rwlock);
+
+  cupsArrayAdd(printer->processing_jobs, job);
+  printer->processing_job = job;
+
+  if (!start_job(job))
+  {
+    release_printer(job);
+
+    _cupsRWLockWrite(&job->rwlock);
+
+    close(job->stream_fd);
+    close(job->stream_in);
+
+    free(job->filename);
+
+    job->filename  = NULL;
+    job->stream_fd = -1;
+    job->stream_in = -1;
+
+    SERVER_SEQ_BEGIN(job->status_seq);
+    job->state = IPP_JSTATE_HELD;
+    SERVER_SEQ_END(job->status_seq);
+
+    _cupsRWUnlock(&job->rwlock);
+    _cupsRWUnlock(&printer->rwlock);
+
+    return (0);
+  }
+
+  _cupsRWUnlock(&printer->rwlock);
+
+  serverLogJob(SERVER_LOGLEVEL_INFO, job, "Streaming document data to \"%s\".", printer->pinfo.command);
+
+  return (1);
+#endif /* _WIN32 */
+}
+
+
+/*
+ * 'compact_job()' - Replace the attributes of a completed job with a compact
+ *                   IPP encoding.
+ *
+ * The encoded attributes need a fraction of the memory used by the
+ * attribute lists, which matters for printers that keep a long job history.
+ * Pointers into the job attributes are retained in the string pool first.
+ * If the attributes cannot be encoded they are kept as-is.
+ *
+ * Note: Caller MUST lock the job object for writing before using.
+ */
+
+static void
+compact_job(server_job_t *job)		/* I - Job */
+{
+  size_t		attrs_length,	/* Length of job attributes */
+			doc_length;	/* Length of document attributes */
+  ipp_uchar_t		*data;		/* Encoded attributes */
+  server_jobbuf_t	buf;		/* Write buffer */
+
+
+  if (job->compact || !job->attrs)
+    return;
+
+  attrs_length = ippLength(job->attrs);
+  doc_length   = job->doc_attrs ? ippLength(job->doc_attrs) : 0;
+
+  if ((data = malloc(attrs_length + doc_length)) == NULL)
+    return;
+
+  buf.ptr = data;
+  buf.end = data + attrs_length + doc_length;
+
+  if (ippWriteIO(&buf, (ipp_iocb_t)write_buffer_cb, 1, NULL, job->attrs) != IPP_STATE_DATA || (job->doc_attrs && ippWriteIO(&buf, (ipp_iocb_t)write_buffer_cb, 1, NULL, job->doc_attrs) != IPP_STATE_DATA))
+  {
+    SERVER_LOG_JOB_DEBUG(job, "Unable to compact job attributes.");
+
+    ippSetState(job->attrs, IPP_STATE_IDLE);
+    if (job->doc_attrs)
+      ippSetState(job->doc_attrs, IPP_STATE_IDLE);
+
+    free(data);
+    return;
+  }
+
+  job->name     = _cupsStrAlloc(job->name);
+  job->username = _cupsStrAlloc(job->username);
+  job->format   = _cupsStrAlloc(job->format);
+
+  job->compact           = data;
+  job->compact_attrs     = attrs_length;
+  job->compact_doc_attrs = doc_length;
+
+  ippDelete(job->attrs);
+  ippDelete(job->doc_attrs);
+
+  job->attrs     = NULL;
+  job->doc_attrs = NULL;
+
+  SERVER_LOG_JOB_DEBUG(job, "Compacted job attributes to %ld bytes.", (long)(attrs_length + doc_length));
+}
+
+
+/*
+ * 'compare_jobs()' - Compare two jobs, newest first.
+ */
+
+static int				/* O - Result of comparison */
+compare_jobs(server_job_t *a,		/* I - First job */
+             server_job_t *b)		/* I - Second job */
+{
+  return (b->id - a->id);
+}
+
+
+/*
+ * 'compare_keys()' - Compare the scheduling keys of two jobs.
+ *
+ * Jobs with a higher (aged) priority always go first.  Otherwise the
+ * JobScheduler policy picks the smaller job or the job of the user with the
+ * fewest processing jobs who was served least recently.
+ */
+
+static int				/* O - Result of comparison */
+compare_keys(server_jobkey_t *a,	/* I - First key */
+             server_jobkey_t *b)	/* I - Second key */
+{
+  int	diff;				/* Difference */
+
+
+  if ((diff = b->priority - a->priority) != 0)
+    return (diff);
+
+  switch (JobScheduler)
+  {
+    case SERVER_SCHEDULER_SIZE :
+        if (a->impressions <= 0 || b->impressions <= 0 || (diff = a->impressions - b->impressions) == 0)
+          diff = a->k_octets - b->k_octets;
+        break;
+
+    case SERVER_SCHEDULER_FAIRSHARE :
+        if ((diff = a->running - b->running) == 0)
+          diff = a->served < b->served ? -1 : a->served > b->served;
+        break;
+
+    default :
+        break;
+  }
+
+  return (diff);
+}
+
+
+/*
+ * 'find_job_id()' - Get the job-id specified in a request.
+ */
+
+static int					/* O - job-id or 0 if none */
+find_job_id(server_client_t *client,	/* I - Client */
+            int             job_id)	/* I - Job ID to find or 0 to lookup */
+{
+  ipp_attribute_t	*attr;		/* job-id or job-uri attribute */
+
+
+  if (job_id > 0)
+  {
+    return (job_id);
+  }
+  else if ((attr = ippFindAttribute(client->request, "job-uri", IPP_TAG_URI)) != NULL)
+  {
+    const char	*uri = ippGetString(attr, 0, NULL);
+					/* job-uri value */
+    char	resource[1024];		/* Resource path */
+
+    if (_httpSeparateResource(uri, resource, sizeof(resource)) >= HTTP_URI_STATUS_OK &&
+        !strncmp(resource, client->printer->resource, client->printer->resourcelen) &&
+        resource[client->printer->resourcelen] == '/')
+      return (atoi(resource + client->printer->resourcelen + 1));
+  }
+  else if ((attr = ippFindAttribute(client->request, "job-id", IPP_TAG_INTEGER)) != NULL)
+  {
+    return (ippGetInteger(attr, 0));
+  }
+
+  return (0);
+}
+
+
+/*
+ * 'finish_job()' - Finish processing a job.
+ */
+
+static void
+finish_job(server_job_t *job)		/* I - Job */
+{
+  server_printer_t	*printer = job->printer;
+					/* Printer */
+  int			remaining;	/* Remaining processing jobs */
+
+
+  _cupsRWLockWrite(&job->rwlock);
+
+  SERVER_SEQ_BEGIN(job->status_seq);
   if (job->cancel)
     job->state = IPP_JSTATE_CANCELED;
   else if (job->state == IPP_JSTATE_PROCESSING)
     job->state = IPP_JSTATE_COMPLETED;
+  SERVER_SEQ_END(job->status_seq);
+
+  SERVER_TRACE3(job__state, printer->id, job->id, job->state);
 
   _cupsRWLockWrite(&job->printer->rwlock);
 
-  if (job->printer->state_reasons & SERVER_PREASON_MOVING_TO_PAUSED)
+  if ((remaining = release_printer(job)) > 0)
+  {
+    SERVER_LOG_PRINTER_DEBUG(printer, "Printer is still processing %d job(s).", remaining);
+  }
+  else if (job->printer->state_reasons & SERVER_PREASON_MOVING_TO_PAUSED)
   {
     job->printer->state         = IPP_PSTATE_STOPPED;
     job->printer->state_reasons &= (server_preason_t)~SERVER_PREASON_MOVING_TO_PAUSED;
@@ -717,17 +1542,12 @@ serverProcessJob(server_job_t *job)	/* I - Job */
     }
   }
 
-  job->printer->processing_job = NULL;
-
   if (job->state >= IPP_JSTATE_CANCELED)
   {
-    job->completed = time(NULL);
+    serverCompleteJobNoLock(job, job->state);
 
     serverAddEventNoLock(job->printer, job, NULL, SERVER_EVENT_JOB_STATE_CHANGED | SERVER_EVENT_JOB_COMPLETED, job->state == IPP_JSTATE_COMPLETED ? "Job completed." : job->state == IPP_JSTATE_ABORTED ? "Job aborted." : "Job canceled.");
 
-    cupsArrayAdd(job->printer->completed_jobs, job);
-    cupsArrayRemove(job->printer->active_jobs, job);
-
     if (MaxCompletedJobs > 0)
     {
      /*
@@ -750,42 +1570,368 @@ serverProcessJob(server_job_t *job)	/* I - Job */
   _cupsRWUnlock(&job->printer->rwlock);
   _cupsRWUnlock(&job->rwlock);
 
-  if (job->printer->is_deleted)
-    serverDeletePrinter(job->printer);
-  else if (!job->printer->is_shutdown)
-    serverCheckJobs(job->printer);
+ /*
+  * The last job to finish deletes the printer...
+  */
+
+  if (printer->is_deleted)
+  {
+    if (!remaining)
+      serverDeletePrinter(printer);
+  }
+  else if (!printer->is_shutdown)
+    serverCheckJobs(printer);
+}
+
+
+/*
+ * 'make_key()' - Make the scheduling key for a job.
+ *
+ * The printer must be locked by the caller.
+ */
+
+static void
+make_key(server_printer_t *printer,	/* I - Printer */
+         server_job_t     *job,		/* I - Job */
+         time_t           curtime,	/* I - Current time */
+         server_jobkey_t  *key)		/* O - Scheduling key */
+{
+  server_job_t		*pjob;		/* Processing job */
+  server_userjobs_t	*ujobs;		/* Jobs for user */
+  ipp_attribute_t	*attr;		/* job-k-octets attribute */
+
+
+  memset(key, 0, sizeof(server_jobkey_t));
+
+  key->priority = job->priority;
+
+  if (JobPriorityAging > 0 && curtime > job->created)
+  {
+   /*
+    * Raise the priority by one for every JobPriorityAging seconds the job has
+    * waited so big or busy jobs are not starved...
+    */
+
+    key->priority += (int)((curtime - job->created) / JobPriorityAging);
+
+    if (key->priority > 100)
+      key->priority = 100;
+  }
+
+  if (JobScheduler == SERVER_SCHEDULER_SIZE)
+  {
+    key->impressions = job->impressions;
+
+    if ((attr = ippFindAttribute(job->attrs, "job-k-octets", IPP_TAG_INTEGER)) != NULL)
+      key->k_octets = ippGetInteger(attr, 0);
+  }
+  else if (JobScheduler == SERVER_SCHEDULER_FAIRSHARE && job->username)
+  {
+    if ((ujobs = serverFindUserJobs(printer, job->username)) != NULL)
+      key->served = ujobs->served;
+
+    for (pjob = (server_job_t *)cupsArrayFirst(printer->processing_jobs); pjob; pjob = (server_job_t *)cupsArrayNext(printer->processing_jobs))
+    {
+      if (pjob->username && !strcmp(pjob->username, job->username))
+        key->running ++;
+    }
+  }
+}
+
+
+/*
+ * 'read_buffer_cb()' - Read IPP data from a compact attribute buffer.
+ */
+
+static ssize_t				/* O - Number of bytes read */
+read_buffer_cb(server_jobbuf_t *buf,	/* I - Read buffer */
+               ipp_uchar_t     *buffer,	/* I - Data buffer */
+               size_t          bytes)	/* I - Number of bytes to read */
+{
+  size_t	count = (size_t)(buf->end - buf->ptr);
+					/* Bytes remaining */
+
+
+  if (bytes > count)
+    bytes = count;
+
+  memcpy(buffer, buf->ptr, bytes);
+  buf->ptr += bytes;
+
+  return ((ssize_t)bytes);
+}
+
+
+/*
+ * 'release_held_job()' - Release a job whose hold has expired.
+ *
+ * The timer holds the printer and job IDs rather than pointers since the job
+ * may be released, canceled, or deleted before the hold expires.
+ */
+
+static void
+release_held_job(server_jobref_t *ref)	/* I - Job reference */
+{
+  server_printer_t	*printer;	/* Printer */
+  server_job_t		key,		/* Search key */
+			*job;		/* Job */
+  int			released = 0;	/* Was the job released? */
+
+
+  _cupsRWLockRead(&PrintersRWLock);
+
+  for (printer = (server_printer_t *)cupsArrayFirst(Printers); printer; printer = (server_printer_t *)cupsArrayNext(Printers))
+  {
+    if (printer->id == ref->printer_id)
+      break;
+  }
+
+  if (printer)
+  {
+    key.id = ref->job_id;
+
+    _cupsRWLockWrite(&printer->rwlock);
+
+    if ((job = (server_job_t *)cupsArrayFind(printer->jobs, &key)) != NULL && job->state == IPP_JSTATE_HELD && job->hold_until > 0 && job->hold_until <= time(NULL))
+      released = serverReleaseJob(job);
+
+    _cupsRWUnlock(&printer->rwlock);
+
+    if (released && !printer->is_shutdown)
+      serverCheckJobs(printer);
+  }
+
+  _cupsRWUnlock(&PrintersRWLock);
+
+  free(ref);
+}
+
+
+/*
+ * 'release_printer()' - Remove a job from the printer's processing jobs.
+ *
+ * The printer must be locked by the caller.
+ */
+
+static int				/* O - Number of jobs still processing */
+release_printer(server_job_t *job)	/* I - Job */
+{
+  server_printer_t	*printer = job->printer;
+					/* Printer */
+
+
+  cupsArrayRemove(printer->processing_jobs, job);
+
+  if (printer->processing_job == job)
+    printer->processing_job = (server_job_t *)cupsArrayFirst(printer->processing_jobs);
+
+  return (cupsArrayCount(printer->processing_jobs));
+}
+
+
+/*
+ * 'run_job()' - Process a job on its own thread.
+ */
+
+static void *				/* O - Thread exit status */
+run_job(server_job_t *job)		/* I - Job */
+{
+  serverMetricsAdjust(SERVER_METRIC_THREADS, 1);
+  serverProcessJob(job);
+  serverMetricsAdjust(SERVER_METRIC_THREADS, -1);
 
   return (NULL);
 }
 
 
 /*
- * 'serverReleaseJob()' - Release a held print job.
+ * 'run_job_worker()' - Process queued jobs.
  */
 
-int					/* O - 1 on success, 0 on failure */
-serverReleaseJob(server_job_t *job)	/* I - Job to release */
+static void *				/* O - Thread exit status */
+run_job_worker(void *data)		/* I - Thread data (unused) */
 {
-  ipp_attribute_t	*attr;		/* Hold-until attribute */
+  server_job_t		*job;		/* Current job */
+  server_printer_t	*printer;	/* Printer for job */
+  int			remaining;	/* Remaining processing jobs */
 
 
-  if (job->state != IPP_JSTATE_HELD)
-    return (0);
+  (void)data;
 
-  _cupsRWLockWrite(&job->rwlock);
+  for (;;)
+  {
+    _cupsMutexLock(&job_mutex);
 
-  job->state         = IPP_JSTATE_PENDING;
-  job->state_reasons &= (server_jreason_t)~SERVER_JREASON_JOB_HOLD_UNTIL_SPECIFIED;
+    while ((job = (server_job_t *)cupsArrayFirst(job_queue)) == NULL)
+      _cupsCondWait(&job_cond, &job_mutex, 0.0);
 
-  if ((attr = ippFindAttribute(job->attrs, "job-hold-until", IPP_TAG_ZERO)) != NULL)
-    ippDeleteAttribute(job->attrs, attr);
+    cupsArrayRemove(job_queue, job);
 
-  if ((attr = ippFindAttribute(job->attrs, "job-hold-until-time", IPP_TAG_ZERO)) != NULL)
-    ippDeleteAttribute(job->attrs, attr);
+    _cupsMutexUnlock(&job_mutex);
 
-  serverAddEventNoLock(job->printer, job, NULL, SERVER_EVENT_JOB_STATE_CHANGED, "Job released.");
+    if (job->state == IPP_JSTATE_PENDING || job->state == IPP_JSTATE_STOPPED)
+    {
+      serverProcessJob(job);
+      continue;
+    }
+
+   /*
+    * The job was canceled while it was queued, release the printer...
+    */
+
+    printer = job->printer;
+
+    SERVER_LOG_JOB_DEBUG(job, "Job no longer pending, not processing.");
+
+    if (job->stream_in >= 0)
+    {
+      close(job->stream_in);
+      job->stream_in = -1;
+    }
+
+    _cupsRWLockWrite(&printer->rwlock);
+    remaining = release_printer(job);
+    _cupsRWUnlock(&printer->rwlock);
+
+    if (printer->is_deleted)
+    {
+      if (!remaining)
+        serverDeletePrinter(printer);
+    }
+    else if (!printer->is_shutdown)
+      serverCheckJobs(printer);
+  }
+
+  return (NULL);
+}
 
-  _cupsRWUnlock(&job->rwlock);
+
+/*
+ * 'select_job()' - Select the next job to process.
+ *
+ * The printer must be locked by the caller.
+ */
+
+static server_job_t *			/* O - Job or `NULL` if none */
+select_job(server_printer_t *printer)	/* I - Printer */
+{
+  server_job_t		*job,		/* Current job */
+			*best = NULL;	/* Best job */
+  server_jobkey_t	key,		/* Key for current job */
+			bestkey;	/* Key for best job */
+  time_t		curtime = time(NULL);
+					/* Current time */
+
+
+  memset(&bestkey, 0, sizeof(bestkey));
+
+  for (job = (server_job_t *)cupsArrayFirst(printer->active_jobs); job; job = (server_job_t *)cupsArrayNext(printer->active_jobs))
+  {
+    if ((job->state != IPP_JSTATE_PENDING && (job->state != IPP_JSTATE_STOPPED || (job->state_reasons & SERVER_JREASON_JOB_FETCHABLE))) || cupsArrayFind(printer->processing_jobs, job))
+      continue;
+
+    if (!best && JobScheduler == SERVER_SCHEDULER_PRIORITY && JobPriorityAging <= 0)
+    {
+     /*
+      * Active jobs are already sorted by priority...
+      */
+
+      return (job);
+    }
+
+    make_key(printer, job, curtime, &key);
+
+    if (!best || compare_keys(&key, &bestkey) < 0)
+    {
+      best    = job;
+      bestkey = key;
+    }
+  }
+
+  return (best);
+}
+
+
+/*
+ * 'start_job()' - Start processing a job on a worker thread.
+ *
+ * When JobWorkers is 0 each job gets its own thread, otherwise the job is
+ * queued for the (lazily created) pool of worker threads.
+ *
+ * The printer must be locked by the caller.
+ */
+
+static int				/* O - 1 on success, 0 on failure */
+start_job(server_job_t *job)		/* I - Job */
+{
+  _cups_thread_t	t;		/* Thread */
+  server_userjobs_t	*ujobs;		/* Jobs for user */
+
+
+ /*
+  * Remember when this user was last served for the fair-share scheduler...
+  */
+
+  if ((ujobs = serverFindUserJobs(job->printer, job->username)) != NULL)
+    ujobs->served = time(NULL);
+
+  if (JobWorkers > 0)
+  {
+    _cupsMutexLock(&job_mutex);
+
+    while (job_num_workers < JobWorkers)
+    {
+      if ((t = _cupsThreadCreate((_cups_thread_func_t)run_job_worker, NULL)) == 0)
+      {
+        serverLog(SERVER_LOGLEVEL_ERROR, "Unable to create job worker thread (%s)", strerror(errno));
+        break;
+      }
+
+      _cupsThreadDetach(t);
+      job_num_workers ++;
+      serverMetricsAdjust(SERVER_METRIC_THREADS, 1);
+    }
+
+    if (job_num_workers > 0)
+    {
+      if (!job_queue)
+        job_queue = cupsArrayNew(NULL, NULL);
+
+      cupsArrayAdd(job_queue, job);
+      _cupsCondBroadcast(&job_cond);
+
+      SERVER_LOG_JOB_DEBUG(job, "Queued job for processing, %d jobs waiting for %d workers.", cupsArrayCount(job_queue), job_num_workers);
+    }
+
+    _cupsMutexUnlock(&job_mutex);
+
+    if (job_num_workers > 0)
+      return (1);
+  }
+
+  if ((t = _cupsThreadCreate((_cups_thread_func_t)run_job, job)) == 0)
+    return (0);
+
+  _cupsThreadDetach(t);
 
   return (1);
 }
+
+
+/*
+ * 'write_buffer_cb()' - Write IPP data to a compact attribute buffer.
+ */
+
+static ssize_t				/* O - Number of bytes written */
+write_buffer_cb(server_jobbuf_t *buf,	/* I - Write buffer */
+                ipp_uchar_t     *buffer,/* I - Data to write */
+                size_t          bytes)	/* I - Number of bytes to write */
+{
+  if (bytes > (size_t)(buf->end - buf->ptr))
+    return (-1);
+
+  memcpy(buf->ptr, buffer, bytes);
+  buf->ptr += bytes;
+
+  return ((ssize_t)bytes);
+}
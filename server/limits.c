@@ -0,0 +1,393 @@
+/*
+ * Admission control for sample IPP server implementation.
+ *
+ * Copyright © 2014-2018 by the IEEE-ISTO Printer Working Group
+ * Copyright © 2010-2018 by Apple Inc.
+ *
+ * Licensed under Apache License v2.0.  See the file "LICENSE" for more
+ * information.
+ */
+
+#include "ippserver.h"
+
+
+/*
+ * Local constants...
+ */
+
+#define SERVER_LIMIT_IDLE	60.0	/* Seconds before an unused entry is discarded */
+
+
+/*
+ * Local types...
+ */
+
+struct server_limit_s			/**** Limit state for an address or user ****/
+{
+  char		*name;			/* Client address or username */
+  int		count;			/* Open connections or active requests */
+  double	updated;		/* Time tokens were last updated */
+  double	tokens[SERVER_OPCLASS_MAX];
+					/* Available tokens for each operation class */
+};
+
+
+/*
+ * Local globals...
+ */
+
+static int		limits_active = 0;
+					/* Number of active requests */
+static cups_array_t	*limits_hosts = NULL;
+					/* Limits for client addresses */
+static _cups_mutex_t	limits_mutex = _CUPS_MUTEX_INITIALIZER;
+					/* Mutex for limits */
+static cups_array_t	*limits_users = NULL;
+					/* Limits for users */
+
+
+/*
+ * Local functions...
+ */
+
+static int		compare_limits(server_limit_t *a, server_limit_t *b);
+static server_limit_t	*find_limit(cups_array_t **limits, const char *name, double curtime);
+static server_opclass_t	get_opclass(ipp_op_t op);
+static int		has_rate_limits(void);
+static void		release_limit(cups_array_t *limits, server_limit_t *limit);
+
+
+/*
+ * 'serverAdmitClient()' - Count a new client connection against the limits for
+ *                         its address.
+ *
+ * Clients over the "MaxClientsPerHost" limit are still accepted so that their
+ * requests can be answered with server-error-busy, but they are not counted
+ * and do not reference the address entry.
+ */
+
+int					/* O - 1 if admitted, 0 if over the limit */
+serverAdmitClient(
+    server_client_t *client)		/* I - Client */
+{
+  char	addrstr[256];			/* Client address */
+
+
+  if (MaxClientsPerHost <= 0 && !has_rate_limits())
+    return (1);
+
+  httpAddrString(httpGetAddress(client->http), addrstr, sizeof(addrstr));
+
+  _cupsMutexLock(&limits_mutex);
+
+  if ((client->host_limit = find_limit(&limits_hosts, addrstr, serverGetTime())) != NULL)
+  {
+    if (MaxClientsPerHost > 0 && client->host_limit->count >= MaxClientsPerHost)
+    {
+      client->busy       = 1;
+      client->host_limit = NULL;
+    }
+    else
+      client->host_limit->count ++;
+  }
+
+  _cupsMutexUnlock(&limits_mutex);
+
+  if (client->busy)
+    serverLogClient(SERVER_LOGLEVEL_INFO, client, "Too many connections from \"%s\".", addrstr);
+
+  return (!client->busy);
+}
+
+
+/*
+ * 'serverAdmitRequest()' - Count an IPP request against the request limits.
+ *
+ * When a limit is reached the client is sent a server-error-busy response.
+ * Calling this function again for the same request does nothing.
+ */
+
+int					/* O - 1 if admitted, 0 if busy */
+serverAdmitRequest(
+    server_client_t *client)		/* I - Client */
+{
+  const char		*username,	/* Username for request */
+			*message = NULL;/* Reason for rejection */
+  ipp_attribute_t	*attr;		/* requesting-user-name attribute */
+  server_opclass_t	opclass,	/* Operation class */
+			i;		/* Looping var */
+  server_limit_t	*limit;		/* Limit for address */
+  double		curtime;	/* Current time */
+
+
+  if (client->active)
+    return (1);
+
+  if (client->busy)
+  {
+    httpSetKeepAlive(client->http, HTTP_KEEPALIVE_OFF);
+    serverRespondIPP(client, IPP_STATUS_ERROR_BUSY, "Too many connections from this host.");
+    return (0);
+  }
+
+  if (client->username[0])
+    username = client->username;
+  else if ((attr = ippFindAttribute(client->request, "requesting-user-name", IPP_TAG_NAME)) != NULL)
+    username = ippGetString(attr, 0, NULL);
+  else
+    username = client->hostname;
+
+  opclass = get_opclass(client->operation_id);
+  curtime = serverGetTime();
+
+  _cupsMutexLock(&limits_mutex);
+
+  if ((limit = client->host_limit) != NULL)
+  {
+   /*
+    * Refill the token buckets for this address...
+    */
+
+    for (i = SERVER_OPCLASS_JOB; i < SERVER_OPCLASS_MAX; i ++)
+    {
+      if (RateLimits[i].rate <= 0.0)
+        continue;
+
+      limit->tokens[i] += (curtime - limit->updated) * RateLimits[i].rate;
+      if (limit->tokens[i] > RateLimits[i].burst)
+        limit->tokens[i] = RateLimits[i].burst;
+    }
+
+    limit->updated = curtime;
+  }
+
+  if (MaxActiveRequests > 0 && limits_active >= MaxActiveRequests)
+    message = "Too many active requests.";
+  else if (MaxRequestsPerUser > 0 && (client->user_limit = find_limit(&limits_users, username, curtime)) != NULL && client->user_limit->count >= MaxRequestsPerUser)
+    message = "Too many active requests for this user.";
+  else if (limit && RateLimits[opclass].rate > 0.0)
+  {
+    if (limit->tokens[opclass] < 1.0)
+      message = "Too many requests from this host.";
+    else
+      limit->tokens[opclass] -= 1.0;
+  }
+
+  if (message)
+  {
+    if (client->user_limit)
+    {
+      release_limit(limits_users, client->user_limit);
+      client->user_limit = NULL;
+    }
+  }
+  else
+  {
+    client->active = 1;
+    limits_active ++;
+
+    if (client->user_limit)
+      client->user_limit->count ++;
+  }
+
+  _cupsMutexUnlock(&limits_mutex);
+
+  if (message)
+  {
+    serverLogClient(SERVER_LOGLEVEL_INFO, client, "Rejecting %s request from \"%s\": %s", ippOpString(client->operation_id), username, message);
+    serverRespondIPP(client, IPP_STATUS_ERROR_BUSY, "%s", message);
+    return (0);
+  }
+
+  return (1);
+}
+
+
+/*
+ * 'serverReleaseClient()' - Release the connection limits for a client.
+ */
+
+void
+serverReleaseClient(
+    server_client_t *client)		/* I - Client */
+{
+  serverReleaseRequest(client);
+
+  if (!client->host_limit)
+    return;
+
+  _cupsMutexLock(&limits_mutex);
+
+  client->host_limit->count --;
+
+  release_limit(limits_hosts, client->host_limit);
+  client->host_limit = NULL;
+
+  _cupsMutexUnlock(&limits_mutex);
+}
+
+
+/*
+ * 'serverReleaseRequest()' - Release the request limits for a client.
+ */
+
+void
+serverReleaseRequest(
+    server_client_t *client)		/* I - Client */
+{
+  if (!client->active)
+    return;
+
+  _cupsMutexLock(&limits_mutex);
+
+  limits_active --;
+
+  if (client->user_limit)
+  {
+    client->user_limit->count --;
+
+    release_limit(limits_users, client->user_limit);
+    client->user_limit = NULL;
+  }
+
+  client->active = 0;
+
+  _cupsMutexUnlock(&limits_mutex);
+}
+
+
+/*
+ * 'compare_limits()' - Compare two limits by name.
+ */
+
+static int				/* O - Result of comparison */
+compare_limits(server_limit_t *a,	/* I - First limit */
+               server_limit_t *b)	/* I - Second limit */
+{
+  return (strcmp(a->name, b->name));
+}
+
+
+/*
+ * 'find_limit()' - Find or create a limit entry.
+ *
+ * Idle entries are discarded when a new entry is created.  The mutex must be
+ * held.
+ */
+
+static server_limit_t *			/* O - Limit or `NULL` on error */
+find_limit(cups_array_t **limits,	/* IO - Limits array */
+           const char   *name,		/* I  - Address or username */
+           double       curtime)	/* I  - Current time */
+{
+  server_limit_t	key,		/* Search key */
+			*limit;		/* Matching limit */
+  server_opclass_t	i;		/* Looping var */
+
+
+  if (!*limits)
+    *limits = cupsArrayNew((cups_array_func_t)compare_limits, NULL);
+
+  key.name = (char *)name;
+
+  if ((limit = (server_limit_t *)cupsArrayFind(*limits, &key)) != NULL)
+    return (limit);
+
+ /*
+  * Discard idle entries...
+  */
+
+  for (limit = (server_limit_t *)cupsArrayFirst(*limits); limit; limit = (server_limit_t *)cupsArrayNext(*limits))
+  {
+    if (limit->count <= 0 && (curtime - limit->updated) > SERVER_LIMIT_IDLE)
+    {
+      cupsArrayRemove(*limits, limit);
+      free(limit->name);
+      free(limit);
+    }
+  }
+
+ /*
+  * Create a new entry with full token buckets...
+  */
+
+  if ((limit = calloc(1, sizeof(server_limit_t))) == NULL)
+    return (NULL);
+
+  if ((limit->name = strdup(name)) == NULL)
+  {
+    free(limit);
+    return (NULL);
+  }
+
+  limit->updated = curtime;
+
+  for (i = SERVER_OPCLASS_JOB; i < SERVER_OPCLASS_MAX; i ++)
+    limit->tokens[i] = RateLimits[i].burst;
+
+  cupsArrayAdd(*limits, limit);
+
+  return (limit);
+}
+
+
+/*
+ * 'get_opclass()' - Get the rate limit class for an operation.
+ */
+
+static server_opclass_t			/* O - Operation class */
+get_opclass(ipp_op_t op)		/* I - operation-id */
+{
+  switch (op)
+  {
+    case IPP_OP_PRINT_JOB :
+    case IPP_OP_PRINT_URI :
+    case IPP_OP_CREATE_JOB :
+    case IPP_OP_SEND_DOCUMENT :
+    case IPP_OP_SEND_URI :
+        return (SERVER_OPCLASS_JOB);
+
+    default :
+        if (!strncmp(ippOpString(op), "Get-", 4))
+          return (SERVER_OPCLASS_QUERY);
+        else
+          return (SERVER_OPCLASS_OTHER);
+  }
+}
+
+
+/*
+ * 'has_rate_limits()' - Determine whether any rate limits are configured.
+ */
+
+static int				/* O - 1 if rate limited, 0 otherwise */
+has_rate_limits(void)
+{
+  server_opclass_t	i;		/* Looping var */
+
+
+  for (i = SERVER_OPCLASS_JOB; i < SERVER_OPCLASS_MAX; i ++)
+    if (RateLimits[i].rate > 0.0)
+      return (1);
+
+  return (0);
+}
+
+
+/*
+ * 'release_limit()' - Discard an unused limit entry that has no token state.
+ *
+ * The mutex must be held.
+ */
+
+static void
+release_limit(cups_array_t   *limits,	/* I - Limits array */
+              server_limit_t *limit)	/* I - Limit */
+{
+  if (limit->count > 0 || (limits == limits_hosts && has_rate_limits()))
+    return;
+
+  cupsArrayRemove(limits, limit);
+  free(limit->name);
+  free(limit);
+}
@@ -19,12 +19,30 @@
 static _cups_mutex_t	log_mutex = _CUPS_MUTEX_INITIALIZER;
 static int		log_fd = -1;
 
+#define SERVER_LOG_BUFSIZE	262144	/* Size of each async log buffer */
+
+static _cups_cond_t	log_cond = _CUPS_COND_INITIALIZER;
+					/* Condition to wake the log writer */
+static char		log_buffers[2][SERVER_LOG_BUFSIZE];
+					/* Async log buffers */
+static int		log_current = 0;/* Buffer currently being filled */
+static size_t		log_used = 0;	/* Bytes used in current buffer */
+static unsigned		log_dropped = 0;/* Number of dropped messages */
+static int		log_writer = 0;	/* Writer thread: 0 = none, 1 = running, -1 = failed */
+static time_t		log_time = 0;	/* Time of cached date string */
+static char		log_date[32];	/* Cached date string */
+
 
 /*
  * Local functions...
  */
 
-static void server_log_to_file(server_loglevel_t level, const char *format, va_list ap);
+static void	server_log_async(server_loglevel_t level, struct timeval *curtime, const char *format, va_list ap);
+static void	server_log_flush(void);
+static void	server_log_open(void);
+static void	server_log_to_file(server_loglevel_t level, const char *format, va_list ap);
+static void	*server_log_writer(void *data);
+static void	server_log_write(const char *buffer, size_t bytes);
 
 
 /*
@@ -65,16 +83,16 @@ serverLogAttributes(
   int			major, minor;	/* Version */
 
 
-  if (LogLevel < SERVER_LOGLEVEL_DEBUG)
+  if (!SERVER_LOG_DEBUG_ENABLED)
     return;
 
   major = ippGetVersion(ipp, &minor);
-  serverLogClient(SERVER_LOGLEVEL_DEBUG, client, "%s version=%d.%d", title, major, minor);
+  SERVER_LOG_CLIENT_DEBUG(client, "%s version=%d.%d", title, major, minor);
   if (type == 1)
-    serverLogClient(SERVER_LOGLEVEL_DEBUG, client, "%s operation-id=%s(%04x)", title, ippOpString(ippGetOperation(ipp)), ippGetOperation(ipp));
+    SERVER_LOG_CLIENT_DEBUG(client, "%s operation-id=%s(%04x)", title, ippOpString(ippGetOperation(ipp)), ippGetOperation(ipp));
   else if (type == 2)
-    serverLogClient(SERVER_LOGLEVEL_DEBUG, client, "%s status-code=%s(%04x)", title, ippErrorString(ippGetStatusCode(ipp)), ippGetStatusCode(ipp));
-  serverLogClient(SERVER_LOGLEVEL_DEBUG, client, "%s request-id=%d", title, ippGetRequestId(ipp));
+    SERVER_LOG_CLIENT_DEBUG(client, "%s status-code=%s(%04x)", title, ippErrorString(ippGetStatusCode(ipp)), ippGetStatusCode(ipp));
+  SERVER_LOG_CLIENT_DEBUG(client, "%s request-id=%d", title, ippGetRequestId(ipp));
 
   for (attr = ippFirstAttribute(ipp), group_tag = IPP_TAG_ZERO;
        attr;
@@ -84,13 +102,13 @@ serverLogAttributes(
     {
       group_tag = ippGetGroupTag(attr);
       if (group_tag != IPP_TAG_ZERO)
-        serverLogClient(SERVER_LOGLEVEL_DEBUG, client, "%s %s", title, ippTagString(group_tag));
+        SERVER_LOG_CLIENT_DEBUG(client, "%s %s", title, ippTagString(group_tag));
     }
 
     if (ippGetName(attr))
     {
       ippAttributeString(attr, buffer, sizeof(buffer));
-      serverLogClient(SERVER_LOGLEVEL_DEBUG, client, "%s %s (%s%s) %s", title, ippGetName(attr), ippGetCount(attr) > 1 ? "1setOf " : "", ippTagString(ippGetValueTag(attr)), buffer);
+      SERVER_LOG_CLIENT_DEBUG(client, "%s %s (%s%s) %s", title, ippGetName(attr), ippGetCount(attr) > 1 ? "1setOf " : "", ippTagString(ippGetValueTag(attr)), buffer);
     }
   }
 }
@@ -200,6 +218,165 @@ serverTimeString(time_t tv,		/* I - Time value */
 }
 
 
+/*
+ * 'server_log_async()' - Add a formatted message to the async log buffer.
+ */
+
+static void
+server_log_async(
+    server_loglevel_t level,		/* I - Log level */
+    struct timeval    *curtime,		/* I - Current time */
+    const char        *format,		/* I - Printf-style format string */
+    va_list           ap)		/* I - Pointer to additional arguments */
+{
+  char		prefix[256],		/* Line prefix */
+		message[8192];		/* Message buffer */
+  ssize_t	bytes;			/* Number of bytes in message */
+  size_t	prefixlen,		/* Length of prefix */
+		msglen;			/* Length of message */
+  struct tm	curdate;		/* Current date and time */
+  static const char * const pris[] =	/* Log priority strings */
+  {
+    "<63>",				/* Error message */
+    "<66>",				/* Informational message */
+    "<67>"				/* Debugging message */
+  };
+
+
+ /*
+  * Format the message outside the lock...
+  */
+
+  if ((bytes = _cups_safe_vsnprintf(message, sizeof(message) - 1, format, ap)) <= 0)
+    return;
+
+  if ((msglen = (size_t)bytes) > (sizeof(message) - 2))
+    msglen = sizeof(message) - 2;
+
+  if (message[msglen - 1] != '\n')
+    message[msglen ++] = '\n';
+
+  _cupsMutexLock(&log_mutex);
+
+  if (!log_writer)
+  {
+    _cups_thread_t	t;		/* Writer thread */
+
+    if ((t = _cupsThreadCreate((_cups_thread_func_t)server_log_writer, NULL)) == 0)
+    {
+      log_writer = -1;
+    }
+    else
+    {
+      _cupsThreadDetach(t);
+      atexit(server_log_flush);
+      log_writer = 1;
+    }
+  }
+
+  if (log_writer < 0)
+  {
+   /*
+    * No writer thread, write synchronously...
+    */
+
+    _cupsMutexUnlock(&log_mutex);
+
+    server_log_open();
+    server_log_write(message, msglen);
+    return;
+  }
+
+ /*
+  * Only reformat the date and time once a second...
+  */
+
+  if (curtime->tv_sec != log_time)
+  {
+#ifdef _WIN32
+    time_t tv_sec = (time_t)curtime->tv_sec;
+    gmtime_s(&tv_sec, &curdate);
+#else
+    gmtime_r(&curtime->tv_sec, &curdate);
+#endif /* _WIN32 */
+
+    snprintf(log_date, sizeof(log_date), "%04d-%02d-%02dT%02d:%02d:%02d", curdate.tm_year + 1900, curdate.tm_mon + 1, curdate.tm_mday, curdate.tm_hour, curdate.tm_min, curdate.tm_sec);
+    log_time = curtime->tv_sec;
+  }
+
+  if (LogFile)
+    snprintf(prefix, sizeof(prefix), "%s1 %s.%03dZ %s ippserver %d -  ", pris[level], log_date, (int)curtime->tv_usec / 1000, ServerName, getpid());
+  else
+    snprintf(prefix, sizeof(prefix), "%s.%03dZ  ", log_date, (int)curtime->tv_usec / 1000);
+
+  prefixlen = strlen(prefix);
+
+  if ((log_used + prefixlen + msglen) > SERVER_LOG_BUFSIZE)
+  {
+   /*
+    * Buffer is full, drop the message rather than blocking...
+    */
+
+    log_dropped ++;
+  }
+  else
+  {
+    memcpy(log_buffers[log_current] + log_used, prefix, prefixlen);
+    memcpy(log_buffers[log_current] + log_used + prefixlen, message, msglen);
+
+    log_used += prefixlen + msglen;
+
+    if (log_used >= (SERVER_LOG_BUFSIZE / 2))
+      _cupsCondBroadcast(&log_cond);
+  }
+
+  _cupsMutexUnlock(&log_mutex);
+}
+
+
+/*
+ * 'server_log_flush()' - Write any buffered log messages.
+ */
+
+static void
+server_log_flush(void)
+{
+  _cupsMutexLock(&log_mutex);
+
+  if (log_used > 0)
+  {
+    server_log_open();
+    server_log_write(log_buffers[log_current], log_used);
+    log_used = 0;
+  }
+
+  _cupsMutexUnlock(&log_mutex);
+}
+
+
+/*
+ * 'server_log_open()' - Open the log file as needed.
+ */
+
+static void
+server_log_open(void)
+{
+  if (log_fd >= 0)
+    return;
+
+  if (LogFile)
+  {
+    if ((log_fd = open(LogFile, O_CREAT | O_WRONLY | O_APPEND | O_CLOEXEC, 0644)) < 0)
+    {
+      fprintf(stderr, "Unable to open log file \"%s\": %s\n", LogFile, strerror(errno));
+      log_fd = 2;
+    }
+  }
+  else
+    log_fd = 2;
+}
+
+
 /*
  * 'server_log_to_file()' - Log a formatted message to a file.
  */
@@ -232,6 +409,12 @@ server_log_to_file(
   gmtime_r(&curtime.tv_sec, &curdate);
 #endif /* _WIN32 */
 
+  if (LogAsync)
+  {
+    server_log_async(level, &curtime, format, ap);
+    return;
+  }
+
   if (LogFile)
   {
    /*
@@ -263,22 +446,92 @@ server_log_to_file(
     if (log_fd < 0)
     {
       _cupsMutexLock(&log_mutex);
-      if (log_fd < 0)
-      {
-        if (LogFile)
-        {
-          if ((log_fd = open(LogFile, O_CREAT | O_WRONLY | O_APPEND | O_CLOEXEC, 0644)) < 0)
-          {
-            fprintf(stderr, "Unable to open log file \"%s\": %s\n", LogFile, strerror(errno));
-            log_fd = 2;
-          }
-        }
-        else
-          log_fd = 2;
-      }
+      server_log_open();
       _cupsMutexUnlock(&log_mutex);
     }
 
     write(log_fd, buffer, (size_t)(bufptr - buffer));
   }
 }
+
+
+/*
+ * 'server_log_write()' - Write a buffer to the log file.
+ */
+
+static void
+server_log_write(const char *buffer,	/* I - Buffer */
+                 size_t     bytes)	/* I - Number of bytes */
+{
+  ssize_t	written;		/* Bytes written */
+
+
+  while (bytes > 0)
+  {
+    if ((written = write(log_fd, buffer, bytes)) < 0)
+    {
+      if (errno == EINTR || errno == EAGAIN)
+        continue;
+
+      break;
+    }
+
+    buffer += written;
+    bytes  -= (size_t)written;
+  }
+}
+
+
+/*
+ * 'server_log_writer()' - Write buffered log messages in the background.
+ */
+
+static void *				/* O - Thread exit status */
+server_log_writer(void *data)		/* I - Thread data (unused) */
+{
+  char		*buffer;		/* Buffer to write */
+  size_t	bytes;			/* Bytes to write */
+  unsigned	dropped;		/* Number of dropped messages */
+
+
+  (void)data;
+
+  for (;;)
+  {
+   /*
+    * Wait for messages, then give them a moment to accumulate unless the
+    * buffer is already half full...
+    */
+
+    _cupsMutexLock(&log_mutex);
+
+    while (!log_used)
+      _cupsCondWait(&log_cond, &log_mutex, 1.0);
+
+    if (log_used < (SERVER_LOG_BUFSIZE / 2))
+      _cupsCondWait(&log_cond, &log_mutex, 0.1);
+
+   /*
+    * Swap buffers so that request threads can keep logging while we write...
+    */
+
+    buffer  = log_buffers[log_current];
+    bytes   = log_used;
+    dropped = log_dropped;
+
+    log_current = !log_current;
+    log_used    = 0;
+    log_dropped = 0;
+
+    server_log_open();
+
+    _cupsMutexUnlock(&log_mutex);
+
+    server_log_write(buffer, bytes);
+
+    if (dropped)
+      serverLog(SERVER_LOGLEVEL_ERROR, "Dropped %u log messages.", dropped);
+  }
+
+  return (NULL);
+}
@@ -303,7 +303,7 @@ main(int  argc,				/* I - Number of command-line args */
     if (!serverCreateSystem(NULL))
       return (1);
 
-    if ((printer = serverCreatePrinter("/ipp/print", name, name, &pinfo, 1)) == NULL)
+    if ((printer = serverCreatePrinter("/ipp/print", name, name, &pinfo, 1, 1)) == NULL)
       return (1);
 
     printer->state        = IPP_PSTATE_IDLE;
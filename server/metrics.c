@@ -0,0 +1,614 @@
+/*
+ * Metrics support for sample IPP server implementation.
+ *
+ * Copyright © 2014-2018 by the IEEE-ISTO Printer Working Group
+ * Copyright © 2010-2018 by Apple Inc.
+ *
+ * Licensed under Apache License v2.0.  See the file "LICENSE" for more
+ * information.
+ */
+
+#include "ippserver.h"
+#include <stdarg.h>
+
+
+/*
+ * Local constants...
+ */
+
+#define SERVER_METRICS_NUM_BUCKETS 12	/* Number of histogram buckets */
+
+
+/*
+ * Local types...
+ */
+
+typedef struct server_histogram_s	/**** Latency histogram ****/
+{
+  unsigned long	count;			/* Number of samples */
+  double	sum;			/* Sum of samples */
+  unsigned long	buckets[SERVER_METRICS_NUM_BUCKETS];
+					/* Samples in each bucket */
+} server_histogram_t;
+
+typedef struct server_opmetric_s	/**** Operation metrics ****/
+{
+  ipp_op_t		op;		/* operation-id */
+  server_histogram_t	latency;	/* Request latency */
+} server_opmetric_t;
+
+
+/*
+ * Local globals...
+ */
+
+static _cups_mutex_t	metrics_mutex = _CUPS_MUTEX_INITIALIZER;
+					/* Mutex for metrics */
+static cups_array_t	*metrics_ops = NULL;
+					/* Per-operation metrics */
+static server_histogram_t metrics_transform;
+					/* Transform durations */
+static server_usage_t	metrics_usage;	/* Total transform resource usage */
+static int		metrics_values[SERVER_METRIC_MAX];
+					/* Gauge values */
+static const double	metrics_buckets[SERVER_METRICS_NUM_BUCKETS] =
+{					/* Histogram bucket bounds in seconds */
+  0.001, 0.0025, 0.005, 0.01, 0.025, 0.05, 0.1, 0.25, 0.5, 1.0, 5.0, 10.0
+};
+
+
+/*
+ * Local functions...
+ */
+
+static void	add_sample(server_histogram_t *hist, double seconds);
+static int	compare_ops(server_opmetric_t *a, server_opmetric_t *b);
+static const char *escape_label(const char *s, char *buffer, size_t bufsize);
+static void	metrics_printf(server_client_t *client, const char *format, ...) _CUPS_FORMAT(2, 3);
+static void	write_histogram(server_client_t *client, const char *name, const char *labels, server_histogram_t *hist);
+static void	write_memory(server_client_t *client);
+
+
+/*
+ * 'serverGetTime()' - Return the current time in fractional seconds.
+ */
+
+double					/* O - Time in seconds */
+serverGetTime(void)
+{
+#ifdef _WIN32
+  struct _timeb curtime;		/* Current time */
+
+
+  _ftime(&curtime);
+
+  return ((double)curtime.time + 0.001 * curtime.millitm);
+
+#else
+  struct timeval curtime;		/* Current time */
+
+
+  gettimeofday(&curtime, NULL);
+
+  return ((double)curtime.tv_sec + 0.000001 * curtime.tv_usec);
+#endif /* _WIN32 */
+}
+
+
+/*
+ * 'serverMetricsAdjust()' - Adjust a gauge metric.
+ */
+
+void
+serverMetricsAdjust(
+    server_metric_t metric,		/* I - Metric */
+    int             delta)		/* I - Amount to add */
+{
+  _cupsMutexLock(&metrics_mutex);
+  metrics_values[metric] += delta;
+  _cupsMutexUnlock(&metrics_mutex);
+}
+
+
+/*
+ * 'serverMetricsRequest()' - Record the processing time of an IPP request.
+ */
+
+void
+serverMetricsRequest(ipp_op_t op,	/* I - operation-id */
+                     double   seconds)	/* I - Processing time in seconds */
+{
+  server_opmetric_t	key,		/* Search key */
+			*opm;		/* Operation metrics */
+
+
+  _cupsMutexLock(&metrics_mutex);
+
+  if (!metrics_ops)
+    metrics_ops = cupsArrayNew3((cups_array_func_t)compare_ops, NULL, NULL, 0, NULL, (cups_afree_func_t)free);
+
+  key.op = op;
+
+  if ((opm = (server_opmetric_t *)cupsArrayFind(metrics_ops, &key)) == NULL)
+  {
+    if ((opm = (server_opmetric_t *)calloc(1, sizeof(server_opmetric_t))) != NULL)
+    {
+      opm->op = op;
+      cupsArrayAdd(metrics_ops, opm);
+    }
+  }
+
+  if (opm)
+    add_sample(&opm->latency, seconds);
+
+  _cupsMutexUnlock(&metrics_mutex);
+}
+
+
+/*
+ * 'serverMetricsTransform()' - Record the duration and resource usage of a
+ *                              transform.
+ *
+ * The usage pointer is `NULL` when the transform process was not waited for
+ * directly, for example when a resident transform process was used.
+ */
+
+void
+serverMetricsTransform(
+    double         seconds,		/* I - Duration in seconds */
+    server_usage_t *usage)		/* I - Resource usage or `NULL` */
+{
+  _cupsMutexLock(&metrics_mutex);
+
+  add_sample(&metrics_transform, seconds);
+
+  if (usage)
+  {
+    metrics_usage.user_time   += usage->user_time;
+    metrics_usage.system_time += usage->system_time;
+    metrics_usage.in_blocks   += usage->in_blocks;
+    metrics_usage.out_blocks  += usage->out_blocks;
+
+    if (usage->max_rss > metrics_usage.max_rss)
+      metrics_usage.max_rss = usage->max_rss;
+  }
+
+  _cupsMutexUnlock(&metrics_mutex);
+}
+
+
+/*
+ * 'serverRespondMetrics()' - Send the current metrics in the Prometheus text
+ *                            exposition format.
+ */
+
+int					/* O - 1 on success, 0 on failure */
+serverRespondMetrics(
+    server_client_t *client)		/* I - Client */
+{
+  int			i,		/* Looping var */
+			num_ops;	/* Number of operations */
+  server_opmetric_t	*ops,		/* Copy of operation metrics */
+			*opm;		/* Current operation */
+  server_histogram_t	transform;	/* Copy of transform durations */
+  server_usage_t	usage;		/* Copy of transform resource usage */
+  int			values[SERVER_METRIC_MAX];
+					/* Copy of gauge values */
+  server_printer_t	*printer;	/* Current printer */
+  server_subscription_t	*sub;		/* Current subscription */
+  cups_array_iter_t	iter;		/* Subscription iterator */
+  int			num_subs,	/* Number of subscriptions */
+			num_events;	/* Number of retained events */
+  char			labels[1024],	/* Labels for metric */
+			name[256];	/* Escaped label value */
+
+
+  if (!serverRespondHTTP(client, HTTP_STATUS_OK, NULL, "text/plain; version=0.0.4; charset=utf-8", 0))
+    return (0);
+
+ /*
+  * Copy the counters so we don't hold the mutex while writing...
+  */
+
+  _cupsMutexLock(&metrics_mutex);
+
+  num_ops = cupsArrayCount(metrics_ops);
+
+  if (num_ops > 0 && (ops = (server_opmetric_t *)calloc((size_t)num_ops, sizeof(server_opmetric_t))) != NULL)
+  {
+    for (i = 0, opm = (server_opmetric_t *)cupsArrayFirst(metrics_ops); opm; i ++, opm = (server_opmetric_t *)cupsArrayNext(metrics_ops))
+      ops[i] = *opm;
+  }
+  else
+  {
+    num_ops = 0;
+    ops     = NULL;
+  }
+
+  transform = metrics_transform;
+  usage     = metrics_usage;
+  memcpy(values, metrics_values, sizeof(values));
+
+  _cupsMutexUnlock(&metrics_mutex);
+
+ /*
+  * Requests...
+  */
+
+  metrics_printf(client, "# HELP ippserver_request_duration_seconds IPP request processing time by operation.\n# TYPE ippserver_request_duration_seconds histogram\n");
+
+  for (i = 0, opm = ops; i < num_ops; i ++, opm ++)
+  {
+    snprintf(labels, sizeof(labels), "operation=\"%s\"", ippOpString(opm->op));
+    write_histogram(client, "ippserver_request_duration_seconds", labels, &opm->latency);
+  }
+
+  free(ops);
+
+ /*
+  * Transforms...
+  */
+
+  metrics_printf(client, "# HELP ippserver_transform_duration_seconds Document transform time.\n# TYPE ippserver_transform_duration_seconds histogram\n");
+  write_histogram(client, "ippserver_transform_duration_seconds", NULL, &transform);
+
+  metrics_printf(client, "# HELP ippserver_transform_cpu_seconds_total CPU time used by transform commands.\n# TYPE ippserver_transform_cpu_seconds_total counter\nippserver_transform_cpu_seconds_total{mode=\"user\"} %.6f\nippserver_transform_cpu_seconds_total{mode=\"system\"} %.6f\n", usage.user_time, usage.system_time);
+  metrics_printf(client, "# HELP ippserver_transform_blocks_total Block I/O operations by transform commands.\n# TYPE ippserver_transform_blocks_total counter\nippserver_transform_blocks_total{direction=\"in\"} %ld\nippserver_transform_blocks_total{direction=\"out\"} %ld\n", usage.in_blocks, usage.out_blocks);
+  metrics_printf(client, "# HELP ippserver_transform_max_rss_kilobytes Largest resident set size of a transform command.\n# TYPE ippserver_transform_max_rss_kilobytes gauge\nippserver_transform_max_rss_kilobytes %ld\n", usage.max_rss);
+
+ /*
+  * Clients and threads...
+  */
+
+  metrics_printf(client, "# HELP ippserver_clients Number of connected clients.\n# TYPE ippserver_clients gauge\nippserver_clients %d\n", values[SERVER_METRIC_CLIENTS]);
+  metrics_printf(client, "# HELP ippserver_threads Number of client and job processing threads.\n# TYPE ippserver_threads gauge\nippserver_threads %d\n", values[SERVER_METRIC_THREADS]);
+
+ /*
+  * Printer queues...
+  */
+
+  _cupsRWLockRead(&PrintersRWLock);
+
+  metrics_printf(client, "# HELP ippserver_printer_active_jobs Number of active jobs.\n# TYPE ippserver_printer_active_jobs gauge\n");
+
+  for (printer = (server_printer_t *)cupsArrayFirst(Printers); printer; printer = (server_printer_t *)cupsArrayNext(Printers))
+  {
+    _cupsRWLockRead(&printer->rwlock);
+    metrics_printf(client, "ippserver_printer_active_jobs{printer=\"%s\"} %d\n", escape_label(printer->name, name, sizeof(name)), cupsArrayCount(printer->active_jobs));
+    _cupsRWUnlock(&printer->rwlock);
+  }
+
+  metrics_printf(client, "# HELP ippserver_printer_completed_jobs Number of retained completed jobs.\n# TYPE ippserver_printer_completed_jobs gauge\n");
+
+  for (printer = (server_printer_t *)cupsArrayFirst(Printers); printer; printer = (server_printer_t *)cupsArrayNext(Printers))
+  {
+    _cupsRWLockRead(&printer->rwlock);
+    metrics_printf(client, "ippserver_printer_completed_jobs{printer=\"%s\"} %d\n", escape_label(printer->name, name, sizeof(name)), cupsArrayCount(printer->completed_jobs));
+    _cupsRWUnlock(&printer->rwlock);
+  }
+
+  _cupsRWUnlock(&PrintersRWLock);
+
+ /*
+  * Subscriptions...
+  */
+
+  _cupsRWLockRead(&SubscriptionsRWLock);
+
+  num_subs   = cupsArrayCount(Subscriptions);
+  num_events = 0;
+
+  cupsArrayIterInit(&iter, Subscriptions);
+
+  for (sub = (server_subscription_t *)cupsArrayIterNext(&iter); sub; sub = (server_subscription_t *)cupsArrayIterNext(&iter))
+  {
+    _cupsRWLockRead(&sub->rwlock);
+    num_events += sub->last_sequence - sub->first_sequence + 1;
+    _cupsRWUnlock(&sub->rwlock);
+  }
+
+  _cupsRWUnlock(&SubscriptionsRWLock);
+
+  metrics_printf(client, "# HELP ippserver_subscriptions Number of subscriptions.\n# TYPE ippserver_subscriptions gauge\nippserver_subscriptions %d\n", num_subs);
+  metrics_printf(client, "# HELP ippserver_subscription_events Number of events retained for subscriptions.\n# TYPE ippserver_subscription_events gauge\nippserver_subscription_events %d\n", num_events);
+
+ /*
+  * Memory...
+  */
+
+  write_memory(client);
+
+  httpWrite2(client->http, "", 0);
+  httpFlushWrite(client->http);
+
+  return (1);
+}
+
+
+/*
+ * 'add_sample()' - Add a sample to a histogram.
+ */
+
+static void
+add_sample(server_histogram_t *hist,	/* I - Histogram */
+           double             seconds)	/* I - Sample value */
+{
+  int	i;				/* Looping var */
+
+
+  hist->count ++;
+  hist->sum += seconds;
+
+  for (i = 0; i < SERVER_METRICS_NUM_BUCKETS; i ++)
+  {
+    if (seconds <= metrics_buckets[i])
+    {
+      hist->buckets[i] ++;
+      break;
+    }
+  }
+}
+
+
+/*
+ * 'compare_ops()' - Compare two operation metrics.
+ */
+
+static int				/* O - Result of comparison */
+compare_ops(server_opmetric_t *a,	/* I - First operation */
+            server_opmetric_t *b)	/* I - Second operation */
+{
+  return ((int)a->op - (int)b->op);
+}
+
+
+/*
+ * 'escape_label()' - Escape a string for use as a label value.
+ */
+
+static const char *			/* O - Escaped string */
+escape_label(const char *s,		/* I - String */
+             char       *buffer,	/* I - Buffer */
+             size_t     bufsize)	/* I - Size of buffer */
+{
+  char	*bufptr,			/* Pointer into buffer */
+	*bufend = buffer + bufsize - 2;	/* End of buffer */
+
+
+  for (bufptr = buffer; s && *s && bufptr < bufend; s ++)
+  {
+    if (*s == '\\' || *s == '\"')
+      *bufptr++ = '\\';
+    else if (*s == '\n')
+    {
+      *bufptr++ = '\\';
+      *bufptr++ = 'n';
+      continue;
+    }
+
+    *bufptr++ = *s;
+  }
+
+  *bufptr = '\0';
+
+  return (buffer);
+}
+
+
+/*
+ * 'metrics_printf()' - Send formatted text to the client.
+ */
+
+static void
+metrics_printf(server_client_t *client,	/* I - Client */
+               const char      *format,	/* I - Printf-style format string */
+	       ...)			/* I - Additional arguments as needed */
+{
+  va_list	ap;			/* Pointer to arguments */
+  char		buffer[1024];		/* Output buffer */
+  ssize_t	bytes;			/* Number of bytes */
+
+
+  va_start(ap, format);
+  bytes = vsnprintf(buffer, sizeof(buffer), format, ap);
+  va_end(ap);
+
+  if (bytes >= (ssize_t)sizeof(buffer))
+    bytes = (ssize_t)sizeof(buffer) - 1;
+
+  if (bytes > 0)
+    httpWrite2(client->http, buffer, (size_t)bytes);
+}
+
+
+/*
+ * 'write_histogram()' - Write a histogram metric.
+ */
+
+static void
+write_histogram(
+    server_client_t    *client,		/* I - Client */
+    const char         *name,		/* I - Metric name */
+    const char         *labels,		/* I - Labels or `NULL` */
+    server_histogram_t *hist)		/* I - Histogram */
+{
+  int		i;			/* Looping var */
+  unsigned long	count;			/* Cumulative count */
+  const char	*sep = labels ? "," : "";
+					/* Label separator */
+
+
+  if (!labels)
+    labels = "";
+
+  for (i = 0, count = 0; i < SERVER_METRICS_NUM_BUCKETS; i ++)
+  {
+    count += hist->buckets[i];
+    metrics_printf(client, "%s_bucket{%s%sle=\"%g\"} %lu\n", name, labels, sep, metrics_buckets[i], count);
+  }
+
+  metrics_printf(client, "%s_bucket{%s%sle=\"+Inf\"} %lu\n", name, labels, sep, hist->count);
+
+  if (*labels)
+  {
+    metrics_printf(client, "%s_sum{%s} %g\n", name, labels, hist->sum);
+    metrics_printf(client, "%s_count{%s} %lu\n", name, labels, hist->count);
+  }
+  else
+  {
+    metrics_printf(client, "%s_sum %g\n", name, hist->sum);
+    metrics_printf(client, "%s_count %lu\n", name, hist->count);
+  }
+}
+
+
+/*
+ * 'write_memory()' - Write the memory accounting metrics.
+ *
+ * Attribute sets are measured with _ippMemoryUsed().  Strings are shared
+ * through the string pool and are reported separately, and events shared by
+ * several subscriptions are divided between them.
+ */
+
+static void
+write_memory(server_client_t *client)	/* I - Client */
+{
+  server_printer_t	*printer;	/* Current printer */
+  server_device_t	*device;	/* Current output device */
+  server_pcache_t	*pc;		/* Current cached response */
+  server_job_t		*job;		/* Current job */
+  server_resource_t	*resource;	/* Current resource */
+  server_subscription_t	*sub;		/* Current subscription */
+  server_sevent_t	*sevent;	/* Current subscription event */
+  cups_array_iter_t	iter;		/* Subscription iterator */
+  int			seq;		/* Current sequence number */
+  size_t		attr_bytes,	/* Bytes for attributes */
+			cache_bytes,	/* Bytes for caches */
+			job_bytes,	/* Bytes for jobs */
+			num_strings,	/* Number of pooled strings */
+			pool_bytes,	/* Bytes allocated for string pool */
+			ref_bytes;	/* Bytes referenced from string pool */
+  double		event_bytes;	/* Bytes for subscription events */
+  char			name[256];	/* Escaped label value */
+
+
+ /*
+  * Printers...
+  */
+
+  _cupsRWLockRead(&PrintersRWLock);
+
+  metrics_printf(client, "# HELP ippserver_printer_memory_bytes Memory used by printer attributes, cached responses, and jobs.\n# TYPE ippserver_printer_memory_bytes gauge\n");
+
+  for (printer = (server_printer_t *)cupsArrayFirst(Printers); printer; printer = (server_printer_t *)cupsArrayNext(Printers))
+  {
+    _cupsRWLockRead(&printer->rwlock);
+
+    attr_bytes = _ippMemoryUsed(printer->pinfo.attrs) + _ippMemoryUsed(printer->dev_attrs);
+
+    for (device = (server_device_t *)cupsArrayFirst(printer->pinfo.devices); device; device = (server_device_t *)cupsArrayNext(printer->pinfo.devices))
+    {
+      _cupsRWLockRead(&device->rwlock);
+      attr_bytes += _ippMemoryUsed(device->attrs);
+      _cupsRWUnlock(&device->rwlock);
+    }
+
+    cache_bytes = printer->transform_envlen + printer->dnssd_txtlen;
+
+    _cupsMutexLock(&printer->cache_mutex);
+    for (pc = (server_pcache_t *)cupsArrayFirst(printer->cache); pc; pc = (server_pcache_t *)cupsArrayNext(printer->cache))
+      cache_bytes += sizeof(server_pcache_t) + strlen(pc->key) + 1 + pc->length;
+    _cupsMutexUnlock(&printer->cache_mutex);
+
+   /*
+    * Job attributes only change between the active and compact forms while
+    * the printer is locked for writing...
+    */
+
+    for (job_bytes = 0, job = (server_job_t *)cupsArrayFirst(printer->jobs); job; job = (server_job_t *)cupsArrayNext(printer->jobs))
+    {
+      if (job->compact)
+        job_bytes += job->compact_attrs + job->compact_doc_attrs;
+      else
+        job_bytes += _ippMemoryUsed(job->attrs) + _ippMemoryUsed(job->doc_attrs);
+    }
+
+    escape_label(printer->name, name, sizeof(name));
+
+    _cupsRWUnlock(&printer->rwlock);
+
+    metrics_printf(client, "ippserver_printer_memory_bytes{printer=\"%s\",type=\"attributes\"} %lu\nippserver_printer_memory_bytes{printer=\"%s\",type=\"cache\"} %lu\nippserver_printer_memory_bytes{printer=\"%s\",type=\"jobs\"} %lu\n", name, (unsigned long)attr_bytes, name, (unsigned long)cache_bytes, name, (unsigned long)job_bytes);
+  }
+
+  _cupsRWUnlock(&PrintersRWLock);
+
+ /*
+  * Resources...
+  */
+
+  attr_bytes  = 0;
+  cache_bytes = 0;
+
+  _cupsRWLockRead(&ResourcesRWLock);
+
+  for (resource = (server_resource_t *)cupsArrayFirst(ResourcesById); resource; resource = (server_resource_t *)cupsArrayNext(ResourcesById))
+  {
+    _cupsRWLockRead(&resource->rwlock);
+    attr_bytes  += _ippMemoryUsed(resource->attrs);
+    cache_bytes += resource->datalen + _ippMemoryUsed(resource->template_attrs);
+    _cupsRWUnlock(&resource->rwlock);
+  }
+
+  _cupsRWUnlock(&ResourcesRWLock);
+
+  metrics_printf(client, "# HELP ippserver_resource_memory_bytes Memory used by resource attributes and cached resource files.\n# TYPE ippserver_resource_memory_bytes gauge\nippserver_resource_memory_bytes{type=\"attributes\"} %lu\nippserver_resource_memory_bytes{type=\"cache\"} %lu\n", (unsigned long)attr_bytes, (unsigned long)cache_bytes);
+
+ /*
+  * Subscriptions...
+  */
+
+  attr_bytes  = 0;
+  event_bytes = 0.0;
+
+  _cupsRWLockRead(&SubscriptionsRWLock);
+
+  cupsArrayIterInit(&iter, Subscriptions);
+
+  for (sub = (server_subscription_t *)cupsArrayIterNext(&iter); sub; sub = (server_subscription_t *)cupsArrayIterNext(&iter))
+  {
+    _cupsRWLockRead(&sub->rwlock);
+
+    attr_bytes  += _ippMemoryUsed(sub->attrs);
+    event_bytes += (double)sub->max_events * sizeof(server_sevent_t);
+
+    for (seq = sub->first_sequence; seq <= sub->last_sequence; seq ++)
+    {
+      sevent = sub->events + seq % sub->max_events;
+
+      if (sevent->notify && sevent->notify->refcount > 0)
+        event_bytes += (double)(sizeof(server_notify_t) + _ippMemoryUsed(sevent->notify->attrs)) / sevent->notify->refcount;
+    }
+
+    _cupsRWUnlock(&sub->rwlock);
+  }
+
+  _cupsRWUnlock(&SubscriptionsRWLock);
+
+  metrics_printf(client, "# HELP ippserver_subscription_memory_bytes Memory used by subscription attributes and retained events.\n# TYPE ippserver_subscription_memory_bytes gauge\nippserver_subscription_memory_bytes{type=\"attributes\"} %lu\nippserver_subscription_memory_bytes{type=\"events\"} %.0f\n", (unsigned long)attr_bytes, event_bytes);
+
+ /*
+  * System attributes and the string pool...
+  */
+
+  _cupsRWLockRead(&SystemRWLock);
+  attr_bytes = _ippMemoryUsed(SystemAttributes) + _ippMemoryUsed(PrivacyAttributes);
+  _cupsRWUnlock(&SystemRWLock);
+
+  metrics_printf(client, "# HELP ippserver_system_memory_bytes Memory used by system attributes.\n# TYPE ippserver_system_memory_bytes gauge\nippserver_system_memory_bytes %lu\n", (unsigned long)attr_bytes);
+
+  num_strings = _cupsStrStatistics(&pool_bytes, &ref_bytes);
+
+  metrics_printf(client, "# HELP ippserver_string_pool_bytes Memory used by the shared string pool.\n# TYPE ippserver_string_pool_bytes gauge\nippserver_string_pool_bytes %lu\n", (unsigned long)pool_bytes);
+  metrics_printf(client, "# HELP ippserver_string_pool_saved_bytes Memory saved by sharing pooled strings.\n# TYPE ippserver_string_pool_saved_bytes gauge\nippserver_string_pool_saved_bytes %lu\n", (unsigned long)(ref_bytes > pool_bytes ? ref_bytes - pool_bytes : 0));
+  metrics_printf(client, "# HELP ippserver_string_pool_references Number of references to pooled strings.\n# TYPE ippserver_string_pool_references gauge\nippserver_string_pool_references %lu\n", (unsigned long)num_strings);
+}
@@ -11,22 +11,42 @@
 #include "ippserver.h"
 
 
+/*
+ * Local globals...
+ */
+
+static _cups_mutex_t	printer_id_mutex = _CUPS_MUTEX_INITIALIZER;
+					/* Mutex for NextPrinterId */
+
+
 /*
  * Local functions...
  */
 
+#if defined(HAVE_DNSSD) || defined(HAVE_AVAHI)
+static int		cache_txt(server_printer_t *printer, server_txt_t *txt);
+#endif /* HAVE_DNSSD || HAVE_AVAHI */
 static int		compare_active_jobs(server_job_t *a, server_job_t *b);
 static int		compare_completed_jobs(server_job_t *a, server_job_t *b);
 static int		compare_jobs(server_job_t *a, server_job_t *b);
+static int		compare_user_jobs(server_userjobs_t *a, server_userjobs_t *b);
 static ipp_t		*create_media_col(const char *media, const char *source, const char *type, int width, int length, int margins);
 static ipp_t		*create_media_size(int width, int length);
+#if defined(HAVE_DNSSD) || defined(HAVE_AVAHI)
+static int		create_txt(server_printer_t *printer, server_txt_t *txt);
+#endif /* HAVE_DNSSD || HAVE_AVAHI */
+static cups_array_t	*create_vset(ipp_attribute_t *attr);
+static void		delete_user_jobs(server_userjobs_t *ujobs);
+static void		delete_vcache(server_vcache_t *vcache);
 #ifdef HAVE_DNSSD
 static void DNSSD_API	dnssd_callback(DNSServiceRef sdRef, DNSServiceFlags flags, DNSServiceErrorType errorCode, const char *name, const char *regtype, const char *domain, server_printer_t *printer);
 #elif defined(HAVE_AVAHI)
 static void		dnssd_callback(AvahiEntryGroup *p, AvahiEntryGroupState state, void *context);
 #endif /* HAVE_DNSSD */
+static int		hash_vset_value(const char *value);
 #if defined(HAVE_DNSSD) || defined(HAVE_AVAHI)
 static void		register_geo(server_printer_t *printer);
+static int		register_printer(server_printer_t *printer);
 #endif /* HAVE_DNSSD || HAVE_AVAHI */
 
 
@@ -39,32 +59,17 @@ serverAllocatePrinterResource(
     server_printer_t  *printer,		/* I - Printer */
     server_resource_t *resource)	/* I - Resource to allocate */
 {
-  int	i;				/* Looping var */
-
-
  /*
-  * See if we need to add the resource...
+  * Add the resource to the list, if needed...
   */
 
-  if (printer->num_resources >= SERVER_RESOURCES_MAX)
+  if (!serverAddResourceId(&printer->resources, resource->id))
     return;
 
-  for (i = 0; i < printer->num_resources; i ++)
-  {
-    if (printer->resources[i] == resource->id)
-      return;
-  }
-
- /*
-  * Add the resource to the list...
-  */
-
   _cupsRWLockWrite(&resource->rwlock);
 
   resource->use ++;
 
-  printer->resources[printer->num_resources ++] = resource->id;
-
  /*
   * And then update any printer attributes/values based on the type of
   * resource...
@@ -95,6 +100,46 @@ serverAllocatePrinterResource(
 }
 
 
+/*
+ * 'serverClearPrinterCacheNoLock()' - Discard cached printer attributes.
+ *
+ * This also discards the cached transform environment and validation values,
+ * which are built from the printer and device attributes.
+ *
+ * Note: Caller MUST lock the printer object for writing before using.
+ */
+
+void
+serverClearPrinterCacheNoLock(
+    server_printer_t *printer)		/* I - Printer */
+{
+  server_pcache_t	*pc;		/* Current cache entry */
+
+
+  _cupsMutexLock(&printer->cache_mutex);
+
+  for (pc = (server_pcache_t *)cupsArrayFirst(printer->cache); pc; pc = (server_pcache_t *)cupsArrayNext(printer->cache))
+  {
+    cupsArrayRemove(printer->cache, pc);
+
+    free(pc->key);
+    free(pc->data);
+    free(pc);
+  }
+
+  free(printer->transform_env);
+
+  printer->transform_env    = NULL;
+  printer->transform_envlen = 0;
+  printer->transform_envc   = 0;
+
+  delete_vcache(printer->vcache);
+  printer->vcache = NULL;
+
+  _cupsMutexUnlock(&printer->cache_mutex);
+}
+
+
 /*
  * 'serverCopyPrinterStateReasons()' - Copy printer-state-reasons values.
  */
@@ -134,6 +179,9 @@ serverCopyPrinterStateReasons(
 /*
  * 'serverCreatePrinter()' - Create, register, and listen for connections to a
  *                           printer object.
+ *
+ * When "register_dnssd" is 0 the caller is responsible for calling
+ * @link serverRegisterPrinter@ once the printer has been created.
  */
 
 server_printer_t *			/* O - Printer */
@@ -142,13 +190,15 @@ serverCreatePrinter(
     const char     *name,		/* I - printer-name */
     const char     *info,		/* I - printer-info */
     server_pinfo_t *pinfo,		/* I - Printer information */
-    int            dupe_pinfo)		/* I - Duplicate printer info strings? */
+    int            dupe_pinfo,		/* I - Duplicate printer info strings? */
+    int            register_dnssd)	/* I - Register the printer with DNS-SD? */
 {
   int			i;		/* Looping var */
   server_printer_t	*printer;	/* Printer */
   cups_array_t		*existing;	/* Existing attributes cache */
   char			title[256];	/* Title for attributes */
   server_listener_t	*lis;		/* Current listener */
+  cups_array_iter_t	iter;		/* Listener iterator */
   cups_array_t		*uris;		/* Array of URIs */
   int			num_uris;	/* Number of URIs */
   int			is_print3d;	/* 3D printer? */
@@ -705,7 +755,7 @@ serverCreatePrinter(
   };
 
 
-  serverLog(SERVER_LOGLEVEL_DEBUG, "serverCreatePrinter(resource=\"%s\", name=\"%s\", pinfo=%p)", resource, name, (void *)pinfo);
+  SERVER_LOG_DEBUG("serverCreatePrinter(resource=\"%s\", name=\"%s\", pinfo=%p)", resource, name, (void *)pinfo);
 
   is_print3d = !strncmp(resource, "/ipp/print3d/", 13);
 
@@ -725,7 +775,9 @@ serverCreatePrinter(
   }
   else
   {
+    _cupsMutexLock(&printer_id_mutex);
     printer->id = NextPrinterId ++;
+    _cupsMutexUnlock(&printer_id_mutex);
 
     ippAddInteger(pinfo->attrs, IPP_TAG_PRINTER, IPP_TAG_INTEGER, "printer-id", printer->id);
   }
@@ -743,9 +795,14 @@ serverCreatePrinter(
   printer->jobs           = cupsArrayNew3((cups_array_func_t)compare_jobs, NULL, NULL, 0, NULL, (cups_afree_func_t)serverDeleteJob);
   printer->active_jobs    = cupsArrayNew((cups_array_func_t)compare_active_jobs, NULL);
   printer->completed_jobs = cupsArrayNew((cups_array_func_t)compare_completed_jobs, NULL);
+  printer->user_jobs      = cupsArrayNew3((cups_array_func_t)compare_user_jobs, NULL, NULL, 0, NULL, (cups_afree_func_t)delete_user_jobs);
+  printer->processing_jobs = cupsArrayNew(NULL, NULL);
   printer->next_job_id    = 1;
+  printer->history_fd     = -1;
   printer->pinfo          = *pinfo;
 
+  serverOpenJobHistory(printer);
+
   if (dupe_pinfo)
   {
     printer->pinfo.icon             = pinfo->icon ? strdup(pinfo->icon) : NULL;
@@ -756,13 +813,15 @@ serverCreatePrinter(
     printer->pinfo.command          = pinfo->command ? strdup(pinfo->command) : NULL;
     printer->pinfo.device_uri       = pinfo->device_uri ? strdup(pinfo->device_uri) : NULL;
     printer->pinfo.output_format    = pinfo->output_format ? strdup(pinfo->output_format) : NULL;
+    printer->pinfo.stream_formats   = pinfo->stream_formats ? strdup(pinfo->stream_formats) : NULL;
     printer->pinfo.devices          = cupsArrayDup(pinfo->devices);
     printer->pinfo.profiles         = cupsArrayDup(pinfo->profiles);
     printer->pinfo.strings          = cupsArrayDup(pinfo->strings);
   }
 
   uris = cupsArrayNew3((cups_array_func_t)strcmp, NULL, NULL, 0, (cups_acopy_func_t)strdup, (cups_afree_func_t)free);
-  for (lis = cupsArrayFirst(Listeners); lis; lis = cupsArrayNext(Listeners))
+  cupsArrayIterInit(&iter, Listeners);
+  for (lis = cupsArrayIterNext(&iter); lis; lis = cupsArrayIterNext(&iter))
   {
     httpAssembleURI(HTTP_URI_CODING_ALL, uri, sizeof(uri), SERVER_IPP_SCHEME, NULL, lis->host, lis->port, resource);
 
@@ -779,22 +838,23 @@ serverCreatePrinter(
   if (printer->pinfo.ppm == 0)
   {
     printer->pinfo.ppm = ippGetInteger(ippFindAttribute(printer->pinfo.attrs, "pages-per-minute", IPP_TAG_INTEGER), 0);
-    serverLog(SERVER_LOGLEVEL_DEBUG, "Using ppm=%d", printer->pinfo.ppm);
+    SERVER_LOG_DEBUG("Using ppm=%d", printer->pinfo.ppm);
   }
 
   if (printer->pinfo.ppm_color == 0)
   {
     printer->pinfo.ppm_color = ippGetInteger(ippFindAttribute(printer->pinfo.attrs, "pages-per-minute-color", IPP_TAG_INTEGER), 0);
-    serverLog(SERVER_LOGLEVEL_DEBUG, "Using ppm_color=%d", printer->pinfo.ppm_color);
+    SERVER_LOG_DEBUG("Using ppm_color=%d", printer->pinfo.ppm_color);
   }
 
   if ((attr = ippFindAttribute(printer->pinfo.attrs, "sides-supported", IPP_TAG_KEYWORD)) != NULL)
   {
     printer->pinfo.duplex = (char)ippContainsString(attr, "two-sided-long-edge");
-    serverLog(SERVER_LOGLEVEL_DEBUG, "Using duplex=%d", printer->pinfo.duplex);
+    SERVER_LOG_DEBUG("Using duplex=%d", printer->pinfo.duplex);
   }
 
   _cupsRWInit(&(printer->rwlock));
+  _cupsMutexInit(&(printer->cache_mutex));
 
  /*
   * Prepare values for the printer attributes...
@@ -828,8 +888,8 @@ serverCreatePrinter(
   httpAssembleURIf(HTTP_URI_CODING_ALL, supplyurl, sizeof(supplyurl), webscheme, NULL, lis->host, lis->port, "%s/supplies", resource);
 
   serverLogPrinter(SERVER_LOGLEVEL_INFO, printer, "printer-uri=\"%s\"", (char *)cupsArrayFirst(uris));
-  serverLogPrinter(SERVER_LOGLEVEL_DEBUG, printer, "printer-more-info=\"%s\"", adminurl);
-  serverLogPrinter(SERVER_LOGLEVEL_DEBUG, printer, "printer-supply-info-uri=\"%s\"", supplyurl);
+  SERVER_LOG_PRINTER_DEBUG(printer, "printer-more-info=\"%s\"", adminurl);
+  SERVER_LOG_PRINTER_DEBUG(printer, "printer-supply-info-uri=\"%s\"", supplyurl);
 
   if (printer->pinfo.document_formats)
   {
@@ -961,7 +1021,8 @@ serverCreatePrinter(
     ippAddInteger(printer->pinfo.attrs, IPP_TAG_PRINTER, IPP_TAG_INTEGER, "document-password-supported", 127);
 
   /* document-settable-attributes-supported */
-  ippAddStrings(printer->pinfo.attrs, IPP_TAG_PRINTER, IPP_CONST_TAG(IPP_TAG_KEYWORD), "document-settable-attributes-supported", (int)(sizeof(doc_settable_attributes_supported) / sizeof(doc_settable_attributes_supported[0])), NULL, doc_settable_attributes_supported);
+  if (!cupsArrayFind(existing, (void *)"document-settable-attributes-supported"))
+    ippAddStrings(printer->pinfo.attrs, IPP_TAG_PRINTER, IPP_CONST_TAG(IPP_TAG_KEYWORD), "document-settable-attributes-supported", (int)(sizeof(doc_settable_attributes_supported) / sizeof(doc_settable_attributes_supported[0])), NULL, doc_settable_attributes_supported);
 
   /* finishings-default */
   if (!is_print3d && !cupsArrayFind(existing, (void *)"finishings-default"))
@@ -1170,7 +1231,8 @@ serverCreatePrinter(
       ippAddStrings(printer->pinfo.attrs, IPP_TAG_PRINTER, IPP_CONST_TAG(IPP_TAG_KEYWORD), "media-col-supported", (int)(sizeof(media_col_supported) / sizeof(media_col_supported[0])), NULL, media_col_supported);
 
     /* multiple-document-handling-supported */
-    ippAddStrings(printer->pinfo.attrs, IPP_TAG_PRINTER, IPP_CONST_TAG(IPP_TAG_KEYWORD), "multiple-document-handling-supported", sizeof(multiple_document_handling) / sizeof(multiple_document_handling[0]), NULL, multiple_document_handling);
+    if (!cupsArrayFind(existing, (void *)"multiple-document-handling-supported"))
+      ippAddStrings(printer->pinfo.attrs, IPP_TAG_PRINTER, IPP_CONST_TAG(IPP_TAG_KEYWORD), "multiple-document-handling-supported", sizeof(multiple_document_handling) / sizeof(multiple_document_handling[0]), NULL, multiple_document_handling);
   }
 
   /* multiple-document-jobs-supported */
@@ -1261,7 +1323,8 @@ serverCreatePrinter(
       ippAddString(printer->pinfo.attrs, IPP_TAG_PRINTER, IPP_CONST_TAG(IPP_TAG_KEYWORD), "pdl-override-supported", NULL, "attempted");
 
     /* preferred-attributes-supported */
-    ippAddBoolean(printer->pinfo.attrs, IPP_TAG_PRINTER, "preferred-attributes-supported", 0);
+    if (!cupsArrayFind(existing, (void *)"preferred-attributes-supported"))
+      ippAddBoolean(printer->pinfo.attrs, IPP_TAG_PRINTER, "preferred-attributes-supported", 0);
 
     /* print-color-mode-default */
     if (!cupsArrayFind(existing, (void *)"print-color-mode-default"))
@@ -1439,7 +1502,7 @@ serverCreatePrinter(
       ippAddResolution(printer->pinfo.attrs, IPP_TAG_PRINTER, "printer-resolution-default", IPP_RES_PER_INCH, 600, 600);
 
     /* printer-resolution-supported */
-    if (!cupsArrayFind(existing, (void *)"printer-resolutions-supported"))
+    if (!cupsArrayFind(existing, (void *)"printer-resolution-supported"))
       ippAddResolution(printer->pinfo.attrs, IPP_TAG_PRINTER, "printer-resolution-supported", IPP_RES_PER_INCH, 600, 600);
   }
 
@@ -1631,7 +1694,7 @@ serverCreatePrinter(
   * Register the printer with Bonjour...
   */
 
-  if (!serverRegisterPrinter(printer))
+  if (register_dnssd && !serverRegisterPrinter(printer))
     goto bad_printer;
 
  /*
@@ -1661,30 +1724,13 @@ serverDeallocatePrinterResource(
     server_printer_t  *printer,		/* I - Printer */
     server_resource_t *resource)	/* I - Resource to allocate */
 {
-  int	i;				/* Looping var */
-
-
  /*
-  * See if we need to remove the resource...
+  * Remove the resource from the list, if needed...
   */
 
-  for (i = 0; i < printer->num_resources; i ++)
-  {
-    if (printer->resources[i] == resource->id)
-      break;
-  }
-
-  if (i >= printer->num_resources)
+  if (!serverRemoveResourceId(&printer->resources, resource->id))
     return;
 
- /*
-  * Remove the resource from the list...
-  */
-
-  printer->num_resources --;
-  if (i < printer->num_resources)
-    memmove(printer->resources + i, printer->resources + i + 1, (size_t)(printer->num_resources - i) * sizeof(int));
-
   _cupsRWLockWrite(&resource->rwlock);
 
   resource->use --;
@@ -1739,9 +1785,9 @@ serverDeletePrinter(
 
   serverUnregisterPrinter(printer);
 
-  for (i = 0; i < printer->num_resources; i ++)
+  for (i = 0; i < printer->resources.num_ids; i ++)
   {
-    server_resource_t *resource = serverFindResourceById(printer->resources[i]);
+    server_resource_t *resource = serverFindResourceById(printer->resources.ids[i]);
 
     if (resource)
     {
@@ -1751,12 +1797,16 @@ serverDeletePrinter(
     }
   }
 
+  serverClearResourceIds(&printer->resources);
+
   if (printer->default_uri)
     free(printer->default_uri);
   if (printer->resource)
     free(printer->resource);
   if (printer->dns_sd_name)
     free(printer->dns_sd_name);
+  if (printer->dnssd_txt)
+    free(printer->dnssd_txt);
   if (printer->name)
     free(printer->name);
   if (printer->pinfo.icon)
@@ -1765,6 +1815,8 @@ serverDeletePrinter(
     free(printer->pinfo.command);
   if (printer->pinfo.device_uri)
     free(printer->pinfo.device_uri);
+  if (printer->pinfo.stream_formats)
+    free(printer->pinfo.stream_formats);
 
   cupsArrayDelete(printer->pinfo.profiles);
   cupsArrayDelete(printer->pinfo.strings);
@@ -1778,9 +1830,16 @@ serverDeletePrinter(
   ippDelete(printer->pinfo.attrs);
   ippDelete(printer->dev_attrs);
 
+  serverClearPrinterCacheNoLock(printer);
+  cupsArrayDelete(printer->cache);
+
   cupsArrayDelete(printer->active_jobs);
   cupsArrayDelete(printer->completed_jobs);
+  cupsArrayDelete(printer->processing_jobs);
   cupsArrayDelete(printer->jobs);
+  cupsArrayDelete(printer->user_jobs);	/* Last since deleting jobs updates this */
+
+  serverCloseJobHistory(printer);
 
   if (printer->identify_message)
     free(printer->identify_message);
@@ -1861,6 +1920,67 @@ serverGetPrinterStateReasonsBits(
 }
 
 
+/*
+ * 'serverGetPrinterValidationNoLock()' - Get the precompiled validation values
+ *                                        for a printer.
+ *
+ * The "xxx-supported" values used to validate job template attributes are
+ * collected into hashed sets the first time they are needed and kept until
+ * the printer or device attributes change.
+ *
+ * Note: Caller MUST lock the printer object for reading or writing before
+ * using.
+ */
+
+server_vcache_t *			/* O - Validation values or @code NULL@ on error */
+serverGetPrinterValidationNoLock(
+    server_printer_t *printer)		/* I - Printer */
+{
+  server_vcache_t	*vcache;	/* Validation values */
+  ipp_attribute_t	*attr;		/* Supported attribute */
+  int			i,		/* Looping var */
+			count,		/* Number of values */
+			value;		/* Current value */
+
+
+  _cupsMutexLock(&printer->cache_mutex);
+
+  if ((vcache = printer->vcache) == NULL && (vcache = (server_vcache_t *)calloc(1, sizeof(server_vcache_t))) != NULL)
+  {
+    vcache->compression                = create_vset(ippFindAttribute(printer->pinfo.attrs, "compression-supported", IPP_TAG_KEYWORD));
+    vcache->document_format            = create_vset(ippFindAttribute(printer->pinfo.attrs, "document-format-supported", IPP_TAG_MIMETYPE));
+    vcache->job_hold_until             = create_vset(ippFindAttribute(printer->pinfo.attrs, "job-hold-until-supported", IPP_TAG_ZERO));
+    vcache->job_sheets                 = create_vset(ippFindAttribute(printer->pinfo.attrs, "job-sheets-supported", IPP_TAG_ZERO));
+    vcache->multiple_document_handling = create_vset(ippFindAttribute(printer->pinfo.attrs, "multiple-document-handling-supported", IPP_TAG_KEYWORD));
+
+    if ((attr = ippFindAttribute(printer->dev_attrs, "media-supported", IPP_TAG_KEYWORD)) == NULL)
+      attr = ippFindAttribute(printer->pinfo.attrs, "media-supported", IPP_TAG_KEYWORD);
+
+    vcache->media = create_vset(attr);
+
+    if ((attr = ippFindAttribute(printer->dev_attrs, "sides-supported", IPP_TAG_KEYWORD)) == NULL)
+      attr = ippFindAttribute(printer->pinfo.attrs, "sides-supported", IPP_TAG_KEYWORD);
+
+    vcache->sides = create_vset(attr);
+
+    attr  = ippFindAttribute(printer->pinfo.attrs, "orientation-requested-supported", IPP_TAG_ENUM);
+    count = ippGetCount(attr);
+
+    for (i = 0; i < count; i ++)
+    {
+      if ((value = ippGetInteger(attr, i)) >= 0 && value < 32)
+        vcache->orientation_requested |= 1U << value;
+    }
+
+    printer->vcache = vcache;
+  }
+
+  _cupsMutexUnlock(&printer->cache_mutex);
+
+  return (vcache);
+}
+
+
 /*
  * 'serverPausePrinter()' - Stop processing jobs for a printer.
  */
@@ -1884,7 +2004,7 @@ serverPausePrinter(
     else if (printer->state == IPP_PSTATE_PROCESSING)
     {
       if (immediately)
-	serverStopJob(printer->processing_job);
+	serverStopPrinterJobs(printer);
 
       printer->state_reasons |= SERVER_PREASON_MOVING_TO_PAUSED;
 
@@ -1903,475 +2023,323 @@ serverPausePrinter(
 int					/* O - 1 on success, 0 on error */
 serverRegisterPrinter(
     server_printer_t *printer)		/* I - Printer */
+{
+  return (serverRegisterPrinters(1, &printer));
+}
+
+
+/*
+ * 'serverRegisterPrinters()' - Register several printer objects via DNS-SD.
+ *
+ * All of the registrations are queued in a single pass over the DNS-SD
+ * connection.  Printers that cannot be registered are set to `NULL` in the
+ * array.
+ */
+
+int					/* O - Number of printers registered */
+serverRegisterPrinters(
+    int              num_printers,	/* I  - Number of printers */
+    server_printer_t **printers)	/* IO - Printers */
 {
 #if defined(HAVE_DNSSD) || defined(HAVE_AVAHI)
-  int			is_print3d;	/* 3D printer? */
-  server_txt_t		ipp_txt;	/* Bonjour IPP TXT record */
-  int			i,		/* Looping var */
-			count;		/* Number of values */
-  ipp_attribute_t	*color_supported,
-			*document_format_supported,
-			*printer_kind,
-			*printer_location,
-			*printer_make_and_model,
-			*printer_more_info,
-			*printer_uuid,
-			*sides_supported,
-			*urf_supported;	/* Printer attributes */
-  const char		*value;		/* Value string */
-  char			formats[252],	/* List of supported formats */
-			kind[251],	/* List of printer-kind values */
-			urf[252],	/* List of supported URF values */
-			*ptr;		/* Pointer into string */
-  server_listener_t	*lis = cupsArrayFirst(Listeners);
-					/* Listen socket */
-  char			regtype[256];	/* DNS-SD service type */
-#  ifdef HAVE_DNSSD
-  DNSServiceErrorType	error;		/* Error from Bonjour */
-#  endif /* HAVE_DNSSD */
+  int	i,				/* Looping var */
+	count = 0;			/* Number of printers registered */
 
 
   if (!DNSSDEnabled)
-    return (1);
+    return (num_printers);
 
-  is_print3d                = !strncmp(printer->resource, "/ipp/print3d/", 13);
-  color_supported           = ippFindAttribute(printer->pinfo.attrs, "color-supported", IPP_TAG_BOOLEAN);
-  document_format_supported = ippFindAttribute(printer->pinfo.attrs, "document-format-supported", IPP_TAG_MIMETYPE);
-  printer_kind              = ippFindAttribute(printer->pinfo.attrs, "printer-kind", IPP_TAG_KEYWORD);
-  printer_location          = ippFindAttribute(printer->pinfo.attrs, "printer-location", IPP_TAG_TEXT);
-  printer_make_and_model    = ippFindAttribute(printer->pinfo.attrs, "printer-make-and-model", IPP_TAG_TEXT);
-  printer_more_info         = ippFindAttribute(printer->pinfo.attrs, "printer-more-info", IPP_TAG_URI);
-  printer_uuid              = ippFindAttribute(printer->pinfo.attrs, "printer-uuid", IPP_TAG_URI);
-  sides_supported           = ippFindAttribute(printer->pinfo.attrs, "sides-supported", IPP_TAG_KEYWORD);
-  urf_supported             = ippFindAttribute(printer->pinfo.attrs, "urf-supported", IPP_TAG_KEYWORD);
+#  ifdef HAVE_AVAHI
+  avahi_threaded_poll_lock(DNSSDMaster);
+#  endif /* HAVE_AVAHI */
 
-  for (i = 0, count = ippGetCount(document_format_supported), ptr = formats; i < count; i ++)
+  for (i = 0; i < num_printers; i ++)
   {
-    value = ippGetString(document_format_supported, i, NULL);
-
-    if (!strcasecmp(value, "application/octet-stream"))
+    if (!printers[i])
       continue;
 
-    if (ptr > formats && ptr < (formats + sizeof(formats) - 1))
-      *ptr++ = ',';
+    if (register_printer(printers[i]))
+      count ++;
+    else
+      printers[i] = NULL;
+  }
 
-    strlcpy(ptr, value, sizeof(formats) - (size_t)(ptr - formats));
-    ptr += strlen(ptr);
+#  ifdef HAVE_AVAHI
+  avahi_threaded_poll_unlock(DNSSDMaster);
+#  endif /* HAVE_AVAHI */
 
-    if (ptr >= (formats + sizeof(formats) - 1))
-      break;
-  }
+  return (count);
 
-  kind[0] = '\0';
-  for (i = 0, count = ippGetCount(printer_kind), ptr = kind; i < count; i ++)
-  {
-    value = ippGetString(printer_kind, i, NULL);
+#else
+  (void)printers;
 
-    if (ptr > kind && ptr < (kind + sizeof(kind) - 1))
-      *ptr++ = ',';
+  return (num_printers);
+#endif /* HAVE_DNSSD || HAVE_AVAHI */
+}
 
-    strlcpy(ptr, value, sizeof(kind) - (size_t)(ptr - kind));
-    ptr += strlen(ptr);
 
-    if (ptr >= (kind + sizeof(kind) - 1))
-      break;
-  }
+/*
+ * 'serverRestartPrinter()' - Restart a printer.
+ */
 
-  urf[0] = '\0';
-  for (i = 0, count = ippGetCount(urf_supported), ptr = urf; i < count; i ++)
-  {
-    value = ippGetString(urf_supported, i, NULL);
+void
+serverRestartPrinter(
+    server_printer_t *printer)		/* I - Printer */
+{
+  server_event_t	event = SERVER_EVENT_NONE;
+					/* Notification event */
 
-    if (ptr > urf && ptr < (urf + sizeof(urf) - 1))
-      *ptr++ = ',';
 
-    strlcpy(ptr, value, sizeof(urf) - (size_t)(ptr - urf));
-    ptr += strlen(ptr);
+  _cupsRWLockWrite(&printer->rwlock);
 
-    if (ptr >= (urf + sizeof(urf) - 1))
-      break;
+  if (!printer->is_accepting)
+  {
+    printer->is_accepting = 1;
+    event                 = SERVER_EVENT_PRINTER_STATE_CHANGED | SERVER_EVENT_PRINTER_RESTARTED;
   }
-#endif /* HAVE_DNSSD || HAVE_AVAHI */
 
-#ifdef HAVE_DNSSD
- /*
-  * Build the TXT record for IPP...
-  */
+  if (printer->processing_job)
+  {
+    serverStopPrinterJobs(printer);
 
-  TXTRecordCreate(&ipp_txt, 1024, NULL);
-  TXTRecordSetValue(&ipp_txt, "rp", (uint8_t)strlen(printer->resource) - 1, printer->resource + 1);
-  if ((value = ippGetString(printer_make_and_model, 0, NULL)) != NULL)
-    TXTRecordSetValue(&ipp_txt, "ty", (uint8_t)strlen(value), value);
-  if ((value = ippGetString(printer_more_info, 0, NULL)) != NULL)
-    TXTRecordSetValue(&ipp_txt, "adminurl", (uint8_t)strlen(value), value);
-  if ((value = ippGetString(printer_location, 0, NULL)) != NULL)
-    TXTRecordSetValue(&ipp_txt, "note", (uint8_t)strlen(value), value);
-  TXTRecordSetValue(&ipp_txt, "pdl", (uint8_t)strlen(formats), formats);
-  if (kind[0])
-    TXTRecordSetValue(&ipp_txt, "kind", (uint8_t)strlen(kind), kind);
-  if ((value = ippGetString(printer_uuid, 0, NULL)) != NULL)
-    TXTRecordSetValue(&ipp_txt, "UUID", (uint8_t)strlen(value) - 9, value + 9);
-  if (!is_print3d)
+    printer->state_reasons |= SERVER_PREASON_PRINTER_RESTARTED;
+    event                  = SERVER_EVENT_PRINTER_STATE_CHANGED;
+  }
+  else if (printer->state == IPP_PSTATE_STOPPED)
   {
-    TXTRecordSetValue(&ipp_txt, "Color", 1, ippGetBoolean(color_supported, 0) ? "T" : "F");
-    TXTRecordSetValue(&ipp_txt, "Duplex", 1, ippGetCount(sides_supported) > 1 ? "T" : "F");
+    printer->state         = IPP_PSTATE_IDLE;
+    printer->state_reasons = SERVER_PREASON_PRINTER_RESTARTED;
+    event                  = SERVER_EVENT_PRINTER_STATE_CHANGED | SERVER_EVENT_PRINTER_RESTARTED;
   }
 
-#  ifdef HAVE_SSL
-  if (!is_print3d && Encryption != HTTP_ENCRYPTION_NEVER)
-    TXTRecordSetValue(&ipp_txt, "TLS", 3, "1.2");
-#  endif /* HAVE_SSL */
-  if (urf[0])
-    TXTRecordSetValue(&ipp_txt, "URF", (uint8_t)strlen(urf), urf);
-  TXTRecordSetValue(&ipp_txt, "txtvers", 1, "1");
-  TXTRecordSetValue(&ipp_txt, "qtotal", 1, "1");
+  if (event)
+    serverAddEventNoLock(printer, NULL, NULL, event, printer->state == IPP_PSTATE_IDLE ? "Printer restarted." : "Printer restarting.");
 
- /*
-  * Register the _printer._tcp (LPD) service type with a port number of 0 to
-  * defend our service name but not actually support LPD...
-  */
+  if (printer->state != IPP_PSTATE_PROCESSING)
+    printer->state_reasons &= (server_preason_t)~SERVER_PREASON_PRINTER_RESTARTED;
 
-  printer->printer_ref = DNSSDMaster;
+  _cupsRWUnlock(&printer->rwlock);
 
-  if ((error = DNSServiceRegister(&(printer->printer_ref), kDNSServiceFlagsShareConnection, 0 /* interfaceIndex */, printer->dns_sd_name, "_printer._tcp", NULL /* domain */, NULL /* host */, 0 /* port */, 0 /* txtLen */, NULL /* txtRecord */, (DNSServiceRegisterReply)dnssd_callback, printer)) != kDNSServiceErr_NoError)
-  {
-    serverLogPrinter(SERVER_LOGLEVEL_ERROR, printer, "Unable to register \"%s._printer._tcp\": %d", printer->dns_sd_name, error);
-    return (0);
-  }
+  if (printer->state == IPP_PSTATE_IDLE)
+    serverCheckJobs(printer);
+}
 
- /*
-  * Then register the corresponding IPP service types with the real port
-  * number to advertise our printer...
-  */
 
-  if (!is_print3d)
+/*
+ * 'serverResumePrinter()' - Start processing jobs for a printer.
+ */
+
+void
+serverResumePrinter(
+    server_printer_t *printer)		/* I - Printer */
+{
+  if (printer->state == IPP_PSTATE_STOPPED)
   {
-    printer->ipp_ref = DNSSDMaster;
+    _cupsRWLockWrite(&printer->rwlock);
 
-    if (DNSSDSubType && *DNSSDSubType)
-      snprintf(regtype, sizeof(regtype), SERVER_IPP_TYPE ",%s", DNSSDSubType);
-    else
-      strlcpy(regtype, SERVER_IPP_TYPE, sizeof(regtype));
+    printer->state         = IPP_PSTATE_IDLE;
+    printer->state_reasons &= (server_preason_t)~SERVER_PREASON_PAUSED;
 
-    if ((error = DNSServiceRegister(&(printer->ipp_ref), kDNSServiceFlagsShareConnection, 0 /* interfaceIndex */, printer->dns_sd_name, regtype, NULL /* domain */, NULL /* host */, htons(lis->port), TXTRecordGetLength(&ipp_txt), TXTRecordGetBytesPtr(&ipp_txt), (DNSServiceRegisterReply)dnssd_callback, printer)) != kDNSServiceErr_NoError)
-    {
-      serverLogPrinter(SERVER_LOGLEVEL_ERROR, printer, "Unable to register \"%s.%s\": %d", printer->dns_sd_name, regtype, error);
-      return (0);
-    }
+    serverAddEventNoLock(printer, NULL, NULL, SERVER_EVENT_PRINTER_STATE_CHANGED, "Starting printer.");
+
+    _cupsRWUnlock(&printer->rwlock);
+
+    serverCheckJobs(printer);
   }
+}
 
-#  ifdef HAVE_SSL
-  if (Encryption != HTTP_ENCRYPTION_NEVER)
-  {
-    printer->ipps_ref = DNSSDMaster;
 
-    if (is_print3d)
-    {
-      if (DNSSDSubType && *DNSSDSubType)
-	snprintf(regtype, sizeof(regtype), SERVER_IPPS_3D_TYPE ",%s", DNSSDSubType);
-      else
-	strlcpy(regtype, SERVER_IPPS_3D_TYPE, sizeof(regtype));
-    }
-    else if (DNSSDSubType && *DNSSDSubType)
-      snprintf(regtype, sizeof(regtype), SERVER_IPPS_TYPE ",%s", DNSSDSubType);
-    else
-      strlcpy(regtype, SERVER_IPPS_TYPE, sizeof(regtype));
-
-    if ((error = DNSServiceRegister(&(printer->ipps_ref), kDNSServiceFlagsShareConnection, 0 /* interfaceIndex */, printer->dns_sd_name, regtype, NULL /* domain */, NULL /* host */, htons(lis->port), TXTRecordGetLength(&ipp_txt), TXTRecordGetBytesPtr(&ipp_txt), (DNSServiceRegisterReply)dnssd_callback, printer)) != kDNSServiceErr_NoError)
-    {
-      serverLogPrinter(SERVER_LOGLEVEL_ERROR, printer, "Unable to register \"%s.%s\": %d", printer->dns_sd_name, regtype, error);
-      return (0);
-    }
-  }
-#  endif /* HAVE_SSL */
-
- /*
-  * Register the geolocation of the service...
-  */
-
-  register_geo(printer);
-
- /*
-  * Similarly, register the _http._tcp,_printer (HTTP) service type with the
-  * real port number to advertise our IPP printer...
-  */
+/*
+ * 'serverUnregisterPrinter()' - Unregister the DNS-SD services.
+ */
 
-  printer->http_ref = DNSSDMaster;
+void
+serverUnregisterPrinter(
+    server_printer_t *printer)		/* I - Printer */
+{
+  if (!DNSSDEnabled)
+    return;
 
-  if ((error = DNSServiceRegister(&(printer->http_ref), kDNSServiceFlagsShareConnection, 0 /* interfaceIndex */, printer->dns_sd_name, SERVER_WEB_TYPE ",_printer", NULL /* domain */, NULL /* host */, htons(lis->port), 0 /* txtLen */, NULL, /* txtRecord */ (DNSServiceRegisterReply)dnssd_callback, printer)) != kDNSServiceErr_NoError)
+#if HAVE_DNSSD
+  if (printer->geo_ref)
   {
-    serverLogPrinter(SERVER_LOGLEVEL_ERROR, printer, "Unable to register \"%s.%s\": %d", printer->dns_sd_name, SERVER_WEB_TYPE ",_printer", error);
-    return (0);
+    DNSServiceRemoveRecord(printer->printer_ref, printer->geo_ref, 0);
+    printer->geo_ref = NULL;
   }
-
-  TXTRecordDeallocate(&ipp_txt);
-
-#elif defined(HAVE_AVAHI)
- /*
-  * Create the TXT record...
-  */
-
-  ipp_txt = NULL;
-  ipp_txt = avahi_string_list_add_printf(ipp_txt, "rp=%s", printer->resource + 1);
-  if ((value = ippGetString(printer_make_and_model, 0, NULL)) != NULL)
-    ipp_txt = avahi_string_list_add_printf(ipp_txt, "ty=%s", value);
-  if ((value = ippGetString(printer_more_info, 0, NULL)) != NULL)
-    ipp_txt = avahi_string_list_add_printf(ipp_txt, "adminurl=%s", value);
-  if ((value = ippGetString(printer_location, 0, NULL)) != NULL)
-    ipp_txt = avahi_string_list_add_printf(ipp_txt, "note=%s", value);
-  ipp_txt = avahi_string_list_add_printf(ipp_txt, "pdl=%s", formats);
-  if ((value = ippGetString(printer_uuid, 0, NULL)) != NULL)
-    ipp_txt = avahi_string_list_add_printf(ipp_txt, "UUID=%s", value + 9);
-
-  if (!is_print3d)
+  if (printer->printer_ref)
   {
-    ipp_txt = avahi_string_list_add_printf(ipp_txt, "Color=%s", ippGetBoolean(color_supported, 0) ? "T" : "F");
-    ipp_txt = avahi_string_list_add_printf(ipp_txt, "Duplex=%s", ippGetCount(sides_supported) > 1 ? "T" : "F");
+    DNSServiceRefDeallocate(printer->printer_ref);
+    printer->printer_ref = NULL;
   }
-
-#  ifdef HAVE_SSL
-  if (!is_print3d && Encryption != HTTP_ENCRYPTION_NEVER)
-    ipp_txt = avahi_string_list_add_printf(ipp_txt, "TLS=1.2");
-#  endif /* HAVE_SSL */
-  if (urf[0])
-    ipp_txt = avahi_string_list_add_printf(ipp_txt, "URF=%s", urf);
-  ipp_txt = avahi_string_list_add_printf(ipp_txt, "txtvers=1");
-  ipp_txt = avahi_string_list_add_printf(ipp_txt, "qtotal=1");
-
- /*
-  * Register _printer._tcp (LPD) with port 0 to reserve the service name...
-  */
-
-  avahi_threaded_poll_lock(DNSSDMaster);
-
-  printer->dnssd_ref = avahi_entry_group_new(DNSSDClient, dnssd_callback, NULL);
-
-  avahi_entry_group_add_service_strlst(printer->dnssd_ref, AVAHI_IF_UNSPEC, AVAHI_PROTO_UNSPEC, 0, printer->dns_sd_name, "_printer._tcp", NULL, NULL, 0, NULL);
-
- /*
-  * Then register the IPP/IPPS services...
-  */
-
-  if (!is_print3d)
+  if (printer->ipp_ref)
   {
-    avahi_entry_group_add_service_strlst(printer->dnssd_ref, AVAHI_IF_UNSPEC, AVAHI_PROTO_UNSPEC, 0, printer->dns_sd_name, SERVER_IPP_TYPE, NULL, NULL, lis->port, ipp_txt);
-    if (DNSSDSubType && *DNSSDSubType)
-    {
-      char *temptypes = strdup(DNSSDSubType), *start, *end;
-
-      for (start = temptypes; *start; start = end)
-      {
-	if ((end = strchr(start, ',')) != NULL)
-	  *end++ = '\0';
-	else
-	  end = start + strlen(start);
-
-	snprintf(regtype, sizeof(regtype), "%s._sub." SERVER_IPP_TYPE, start);
-	avahi_entry_group_add_service_subtype(printer->dnssd_ref, AVAHI_IF_UNSPEC, AVAHI_PROTO_UNSPEC, 0, printer->dns_sd_name, SERVER_IPP_TYPE, NULL, regtype);
-      }
-
-      free(temptypes);
-    }
+    DNSServiceRefDeallocate(printer->ipp_ref);
+    printer->ipp_ref = NULL;
   }
-
 #  ifdef HAVE_SSL
-  if (Encryption != HTTP_ENCRYPTION_NEVER)
+  if (printer->ipps_ref)
   {
-    if (is_print3d)
-    {
-      avahi_entry_group_add_service_strlst(printer->dnssd_ref, AVAHI_IF_UNSPEC, AVAHI_PROTO_UNSPEC, 0, printer->dns_sd_name, SERVER_IPPS_3D_TYPE, NULL, NULL, lis->port, ipp_txt);
-      if (DNSSDSubType && *DNSSDSubType)
-      {
-	char *temptypes = strdup(DNSSDSubType), *start, *end;
-
-	for (start = temptypes; *start; start = end)
-	{
-	  if ((end = strchr(start, ',')) != NULL)
-	    *end++ = '\0';
-	  else
-	    end = start + strlen(start);
-
-	  snprintf(regtype, sizeof(regtype), "%s._sub." SERVER_IPPS_3D_TYPE, start);
-	  avahi_entry_group_add_service_subtype(printer->dnssd_ref, AVAHI_IF_UNSPEC, AVAHI_PROTO_UNSPEC, 0, printer->dns_sd_name, SERVER_IPPS_3D_TYPE, NULL, regtype);
-	}
-
-	free(temptypes);
-      }
-    }
-    else
-    {
-      avahi_entry_group_add_service_strlst(printer->dnssd_ref, AVAHI_IF_UNSPEC, AVAHI_PROTO_UNSPEC, 0, printer->dns_sd_name, SERVER_IPPS_TYPE, NULL, NULL, lis->port, ipp_txt);
-      if (DNSSDSubType && *DNSSDSubType)
-      {
-	char *temptypes = strdup(DNSSDSubType), *start, *end;
-
-	for (start = temptypes; *start; start = end)
-	{
-	  if ((end = strchr(start, ',')) != NULL)
-	    *end++ = '\0';
-	  else
-	    end = start + strlen(start);
-
-	  snprintf(regtype, sizeof(regtype), "%s._sub." SERVER_IPPS_TYPE, start);
-	  avahi_entry_group_add_service_subtype(printer->dnssd_ref, AVAHI_IF_UNSPEC, AVAHI_PROTO_UNSPEC, 0, printer->dns_sd_name, SERVER_IPPS_TYPE, NULL, regtype);
-	}
-
-	free(temptypes);
-      }
-    }
+    DNSServiceRefDeallocate(printer->ipps_ref);
+    printer->ipps_ref = NULL;
   }
 #  endif /* HAVE_SSL */
+  if (printer->http_ref)
+  {
+    DNSServiceRefDeallocate(printer->http_ref);
+    printer->http_ref = NULL;
+  }
 
- /*
-  * Register the geolocation of the service...
-  */
-
-  register_geo(printer);
-
- /*
-  * Finally _http.tcp (HTTP) for the web interface...
-  */
-
-  avahi_entry_group_add_service_strlst(printer->dnssd_ref, AVAHI_IF_UNSPEC, AVAHI_PROTO_UNSPEC, 0, printer->dns_sd_name, SERVER_WEB_TYPE, NULL, NULL, lis->port, NULL);
-  avahi_entry_group_add_service_subtype(printer->dnssd_ref, AVAHI_IF_UNSPEC, AVAHI_PROTO_UNSPEC, 0, printer->dns_sd_name, SERVER_WEB_TYPE, NULL, "_printer._sub." SERVER_WEB_TYPE);
+#elif defined(HAVE_AVAHI)
+  avahi_threaded_poll_lock(DNSSDMaster);
 
- /*
-  * Commit it...
-  */
+  if (printer->dnssd_ref)
+  {
+    avahi_entry_group_free(printer->dnssd_ref);
+    printer->dnssd_ref = NULL;
+  }
 
-  avahi_entry_group_commit(printer->dnssd_ref);
   avahi_threaded_poll_unlock(DNSSDMaster);
-
-  avahi_string_list_free(ipp_txt);
 #endif /* HAVE_DNSSD */
-
-  return (1);
 }
 
 
+
 /*
- * 'serverRestartPrinter()' - Restart a printer.
+ * 'serverUpdatePrinterTXT()' - Update the DNS-SD TXT record for a printer.
+ *
+ * The registered IPP and IPPS services are only updated when the contents of
+ * the TXT record have changed.
  */
 
-void
-serverRestartPrinter(
+int					/* O - 1 on success, 0 on error */
+serverUpdatePrinterTXT(
     server_printer_t *printer)		/* I - Printer */
 {
-  server_event_t	event = SERVER_EVENT_NONE;
-					/* Notification event */
+#if defined(HAVE_DNSSD) || defined(HAVE_AVAHI)
+  int			is_print3d;	/* 3D printer? */
+  server_txt_t		ipp_txt;	/* Bonjour IPP TXT record */
+  int			status = 1;	/* Return status */
+#  ifdef HAVE_DNSSD
+  DNSServiceErrorType	error;		/* Error from Bonjour */
+#  elif defined(HAVE_AVAHI)
+  int			error;		/* Error from Avahi */
+#  endif /* HAVE_DNSSD */
 
 
-  _cupsRWLockWrite(&printer->rwlock);
+  if (!DNSSDEnabled)
+    return (1);
 
-  if (!printer->is_accepting)
+  is_print3d = create_txt(printer, &ipp_txt);
+
+  if (!cache_txt(printer, &ipp_txt))
   {
-    printer->is_accepting = 1;
-    event                 = SERVER_EVENT_PRINTER_STATE_CHANGED | SERVER_EVENT_PRINTER_RESTARTED;
+#  ifdef HAVE_DNSSD
+    TXTRecordDeallocate(&ipp_txt);
+#  else
+    avahi_string_list_free(ipp_txt);
+#  endif /* HAVE_DNSSD */
+
+    return (1);
   }
 
-  if (printer->processing_job)
+  SERVER_LOG_PRINTER_DEBUG(printer, "Updating DNS-SD TXT record.");
+
+#  ifdef HAVE_DNSSD
+  if (printer->ipp_ref && (error = DNSServiceUpdateRecord(printer->ipp_ref, NULL, 0, TXTRecordGetLength(&ipp_txt), TXTRecordGetBytesPtr(&ipp_txt), 0)) != kDNSServiceErr_NoError)
   {
-    serverStopJob(printer->processing_job);
+    serverLogPrinter(SERVER_LOGLEVEL_ERROR, printer, "Unable to update \"%s.%s\" TXT record: %d", printer->dns_sd_name, SERVER_IPP_TYPE, error);
+    status = 0;
+  }
 
-    printer->state_reasons |= SERVER_PREASON_PRINTER_RESTARTED;
-    event                  = SERVER_EVENT_PRINTER_STATE_CHANGED;
+#    ifdef HAVE_SSL
+  if (printer->ipps_ref && (error = DNSServiceUpdateRecord(printer->ipps_ref, NULL, 0, TXTRecordGetLength(&ipp_txt), TXTRecordGetBytesPtr(&ipp_txt), 0)) != kDNSServiceErr_NoError)
+  {
+    serverLogPrinter(SERVER_LOGLEVEL_ERROR, printer, "Unable to update \"%s.%s\" TXT record: %d", printer->dns_sd_name, is_print3d ? SERVER_IPPS_3D_TYPE : SERVER_IPPS_TYPE, error);
+    status = 0;
   }
-  else if (printer->state == IPP_PSTATE_STOPPED)
+#    endif /* HAVE_SSL */
+
+  TXTRecordDeallocate(&ipp_txt);
+
+#  elif defined(HAVE_AVAHI)
+  avahi_threaded_poll_lock(DNSSDMaster);
+
+  if (printer->dnssd_ref)
   {
-    printer->state         = IPP_PSTATE_IDLE;
-    printer->state_reasons = SERVER_PREASON_PRINTER_RESTARTED;
-    event                  = SERVER_EVENT_PRINTER_STATE_CHANGED | SERVER_EVENT_PRINTER_RESTARTED;
+    if (!is_print3d && (error = avahi_entry_group_update_service_txt_strlst(printer->dnssd_ref, AVAHI_IF_UNSPEC, AVAHI_PROTO_UNSPEC, 0, printer->dns_sd_name, SERVER_IPP_TYPE, NULL, ipp_txt)) < 0)
+    {
+      serverLogPrinter(SERVER_LOGLEVEL_ERROR, printer, "Unable to update \"%s.%s\" TXT record: %s", printer->dns_sd_name, SERVER_IPP_TYPE, avahi_strerror(error));
+      status = 0;
+    }
+
+#    ifdef HAVE_SSL
+    if (Encryption != HTTP_ENCRYPTION_NEVER && (error = avahi_entry_group_update_service_txt_strlst(printer->dnssd_ref, AVAHI_IF_UNSPEC, AVAHI_PROTO_UNSPEC, 0, printer->dns_sd_name, is_print3d ? SERVER_IPPS_3D_TYPE : SERVER_IPPS_TYPE, NULL, ipp_txt)) < 0)
+    {
+      serverLogPrinter(SERVER_LOGLEVEL_ERROR, printer, "Unable to update \"%s.%s\" TXT record: %s", printer->dns_sd_name, is_print3d ? SERVER_IPPS_3D_TYPE : SERVER_IPPS_TYPE, avahi_strerror(error));
+      status = 0;
+    }
+#    endif /* HAVE_SSL */
   }
 
-  if (event)
-    serverAddEventNoLock(printer, NULL, NULL, event, printer->state == IPP_PSTATE_IDLE ? "Printer restarted." : "Printer restarting.");
+  avahi_threaded_poll_unlock(DNSSDMaster);
 
-  if (printer->state != IPP_PSTATE_PROCESSING)
-    printer->state_reasons &= (server_preason_t)~SERVER_PREASON_PRINTER_RESTARTED;
+  avahi_string_list_free(ipp_txt);
+#  endif /* HAVE_DNSSD */
 
-  _cupsRWUnlock(&printer->rwlock);
+  return (status);
 
-  if (printer->state == IPP_PSTATE_IDLE)
-    serverCheckJobs(printer);
-}
+#else
+  (void)printer;
 
+  return (1);
+#endif /* HAVE_DNSSD || HAVE_AVAHI */
+}
 
+#if defined(HAVE_DNSSD) || defined(HAVE_AVAHI)
 /*
- * 'serverResumePrinter()' - Start processing jobs for a printer.
+ * 'cache_txt()' - Cache the encoded IPP TXT record for a printer.
  */
 
-void
-serverResumePrinter(
-    server_printer_t *printer)		/* I - Printer */
+static int				/* O - 1 if the TXT record changed, 0 otherwise */
+cache_txt(server_printer_t *printer,	/* I - Printer */
+          server_txt_t     *txt)	/* I - TXT record */
 {
-  if (printer->state == IPP_PSTATE_STOPPED)
-  {
-    _cupsRWLockWrite(&printer->rwlock);
+  unsigned char	*data;			/* Encoded TXT record */
+  size_t	datalen;		/* Length of encoded TXT record */
 
-    printer->state         = IPP_PSTATE_IDLE;
-    printer->state_reasons &= (server_preason_t)~SERVER_PREASON_PAUSED;
 
-    serverAddEventNoLock(printer, NULL, NULL, SERVER_EVENT_PRINTER_STATE_CHANGED, "Starting printer.");
+#  ifdef HAVE_DNSSD
+  datalen = TXTRecordGetLength(txt);
 
-    _cupsRWUnlock(&printer->rwlock);
+  if ((data = malloc(datalen > 0 ? datalen : 1)) == NULL)
+    return (1);
 
-    serverCheckJobs(printer);
-  }
-}
+  memcpy(data, TXTRecordGetBytesPtr(txt), datalen);
 
+#  else
+  datalen = avahi_string_list_serialize(*txt, NULL, 0);
 
-/*
- * 'serverUnregisterPrinter()' - Unregister the DNS-SD services.
- */
+  if ((data = malloc(datalen > 0 ? datalen : 1)) == NULL)
+    return (1);
 
-void
-serverUnregisterPrinter(
-    server_printer_t *printer)		/* I - Printer */
-{
-  if (!DNSSDEnabled)
-    return;
+  avahi_string_list_serialize(*txt, data, datalen);
+#  endif /* HAVE_DNSSD */
 
-#if HAVE_DNSSD
-  if (printer->geo_ref)
-  {
-    DNSServiceRemoveRecord(printer->printer_ref, printer->geo_ref, 0);
-    printer->geo_ref = NULL;
-  }
-  if (printer->printer_ref)
-  {
-    DNSServiceRefDeallocate(printer->printer_ref);
-    printer->printer_ref = NULL;
-  }
-  if (printer->ipp_ref)
-  {
-    DNSServiceRefDeallocate(printer->ipp_ref);
-    printer->ipp_ref = NULL;
-  }
-#  ifdef HAVE_SSL
-  if (printer->ipps_ref)
+  if (printer->dnssd_txt && printer->dnssd_txtlen == datalen && !memcmp(printer->dnssd_txt, data, datalen))
   {
-    DNSServiceRefDeallocate(printer->ipps_ref);
-    printer->ipps_ref = NULL;
-  }
-#  endif /* HAVE_SSL */
-  if (printer->http_ref)
-  {
-    DNSServiceRefDeallocate(printer->http_ref);
-    printer->http_ref = NULL;
+    free(data);
+    return (0);
   }
 
-#elif defined(HAVE_AVAHI)
-  avahi_threaded_poll_lock(DNSSDMaster);
+  if (printer->dnssd_txt)
+    free(printer->dnssd_txt);
 
-  if (printer->dnssd_ref)
-  {
-    avahi_entry_group_free(printer->dnssd_ref);
-    printer->dnssd_ref = NULL;
-  }
+  printer->dnssd_txt    = data;
+  printer->dnssd_txtlen = datalen;
 
-  avahi_threaded_poll_unlock(DNSSDMaster);
-#endif /* HAVE_DNSSD */
+  return (1);
 }
+#endif /* HAVE_DNSSD || HAVE_AVAHI */
 
 
 /*
@@ -2422,6 +2390,18 @@ compare_jobs(server_job_t *a,		/* I - First job */
 }
 
 
+/*
+ * 'compare_user_jobs()' - Compare the jobs for two users.
+ */
+
+static int				/* O - Result of comparison */
+compare_user_jobs(server_userjobs_t *a,	/* I - First user */
+                  server_userjobs_t *b)	/* I - Second user */
+{
+  return (_cups_strcasecmp(a->username, b->username));
+}
+
+
 /*
  * 'create_media_col()' - Create a media-col value.
  */
@@ -2449,46 +2429,264 @@ create_media_col(const char *media,	/* I - Media name */
   else
     snprintf(media_key, sizeof(media_key), "%s%s", media, margins == 0 ? "_borderless" : "");
 
-  ippAddString(media_col, IPP_TAG_PRINTER, IPP_TAG_KEYWORD, "media-key", NULL,
-               media_key);
-  ippAddCollection(media_col, IPP_TAG_PRINTER, "media-size", media_size);
-  ippAddString(media_col, IPP_TAG_PRINTER, IPP_TAG_KEYWORD, "media-size-name", NULL, media);
-  ippAddInteger(media_col, IPP_TAG_PRINTER, IPP_TAG_INTEGER,
-                "media-bottom-margin", margins);
-  ippAddInteger(media_col, IPP_TAG_PRINTER, IPP_TAG_INTEGER,
-                "media-left-margin", margins);
-  ippAddInteger(media_col, IPP_TAG_PRINTER, IPP_TAG_INTEGER,
-                "media-right-margin", margins);
-  ippAddInteger(media_col, IPP_TAG_PRINTER, IPP_TAG_INTEGER,
-                "media-top-margin", margins);
-  if (source)
-    ippAddString(media_col, IPP_TAG_PRINTER, IPP_TAG_KEYWORD, "media-source", NULL, source);
-  if (type)
-    ippAddString(media_col, IPP_TAG_PRINTER, IPP_TAG_KEYWORD, "media-type", NULL, type);
+  ippAddString(media_col, IPP_TAG_PRINTER, IPP_TAG_KEYWORD, "media-key", NULL,
+               media_key);
+  ippAddCollection(media_col, IPP_TAG_PRINTER, "media-size", media_size);
+  ippAddString(media_col, IPP_TAG_PRINTER, IPP_TAG_KEYWORD, "media-size-name", NULL, media);
+  ippAddInteger(media_col, IPP_TAG_PRINTER, IPP_TAG_INTEGER,
+                "media-bottom-margin", margins);
+  ippAddInteger(media_col, IPP_TAG_PRINTER, IPP_TAG_INTEGER,
+                "media-left-margin", margins);
+  ippAddInteger(media_col, IPP_TAG_PRINTER, IPP_TAG_INTEGER,
+                "media-right-margin", margins);
+  ippAddInteger(media_col, IPP_TAG_PRINTER, IPP_TAG_INTEGER,
+                "media-top-margin", margins);
+  if (source)
+    ippAddString(media_col, IPP_TAG_PRINTER, IPP_TAG_KEYWORD, "media-source", NULL, source);
+  if (type)
+    ippAddString(media_col, IPP_TAG_PRINTER, IPP_TAG_KEYWORD, "media-type", NULL, type);
+
+  ippDelete(media_size);
+
+  return (media_col);
+}
+
+
+/*
+ * 'create_media_size()' - Create a media-size value.
+ */
+
+static ipp_t *				/* O - media-col collection */
+create_media_size(int width,		/* I - x-dimension in 2540ths */
+		  int length)		/* I - y-dimension in 2540ths */
+{
+  ipp_t	*media_size = ippNew();		/* media-size value */
+
+
+  ippAddInteger(media_size, IPP_TAG_PRINTER, IPP_TAG_INTEGER, "x-dimension",
+                width);
+  ippAddInteger(media_size, IPP_TAG_PRINTER, IPP_TAG_INTEGER, "y-dimension",
+                length);
+
+  return (media_size);
+}
+
+
+#if defined(HAVE_DNSSD) || defined(HAVE_AVAHI)
+/*
+ * 'create_txt()' - Create the IPP TXT record for a printer.
+ */
+
+static int				/* O - 1 for a 3D printer, 0 otherwise */
+create_txt(server_printer_t *printer,	/* I - Printer */
+           server_txt_t     *txt)	/* O - TXT record */
+{
+  int			is_print3d;	/* 3D printer? */
+  int			i,		/* Looping var */
+			count;		/* Number of values */
+  ipp_attribute_t	*color_supported,
+			*document_format_supported,
+			*printer_kind,
+			*printer_location,
+			*printer_make_and_model,
+			*printer_more_info,
+			*printer_uuid,
+			*sides_supported,
+			*urf_supported;	/* Printer attributes */
+  const char		*value;		/* Value string */
+  char			formats[252],	/* List of supported formats */
+			kind[251],	/* List of printer-kind values */
+			urf[252],	/* List of supported URF values */
+			*ptr;		/* Pointer into string */
+
+
+
+  is_print3d                = !strncmp(printer->resource, "/ipp/print3d/", 13);
+  color_supported           = ippFindAttribute(printer->pinfo.attrs, "color-supported", IPP_TAG_BOOLEAN);
+  document_format_supported = ippFindAttribute(printer->pinfo.attrs, "document-format-supported", IPP_TAG_MIMETYPE);
+  printer_kind              = ippFindAttribute(printer->pinfo.attrs, "printer-kind", IPP_TAG_KEYWORD);
+  printer_location          = ippFindAttribute(printer->pinfo.attrs, "printer-location", IPP_TAG_TEXT);
+  printer_make_and_model    = ippFindAttribute(printer->pinfo.attrs, "printer-make-and-model", IPP_TAG_TEXT);
+  printer_more_info         = ippFindAttribute(printer->pinfo.attrs, "printer-more-info", IPP_TAG_URI);
+  printer_uuid              = ippFindAttribute(printer->pinfo.attrs, "printer-uuid", IPP_TAG_URI);
+  sides_supported           = ippFindAttribute(printer->pinfo.attrs, "sides-supported", IPP_TAG_KEYWORD);
+  urf_supported             = ippFindAttribute(printer->pinfo.attrs, "urf-supported", IPP_TAG_KEYWORD);
+
+  for (i = 0, count = ippGetCount(document_format_supported), ptr = formats; i < count; i ++)
+  {
+    value = ippGetString(document_format_supported, i, NULL);
+
+    if (!strcasecmp(value, "application/octet-stream"))
+      continue;
+
+    if (ptr > formats && ptr < (formats + sizeof(formats) - 1))
+      *ptr++ = ',';
+
+    strlcpy(ptr, value, sizeof(formats) - (size_t)(ptr - formats));
+    ptr += strlen(ptr);
+
+    if (ptr >= (formats + sizeof(formats) - 1))
+      break;
+  }
+
+  kind[0] = '\0';
+  for (i = 0, count = ippGetCount(printer_kind), ptr = kind; i < count; i ++)
+  {
+    value = ippGetString(printer_kind, i, NULL);
+
+    if (ptr > kind && ptr < (kind + sizeof(kind) - 1))
+      *ptr++ = ',';
+
+    strlcpy(ptr, value, sizeof(kind) - (size_t)(ptr - kind));
+    ptr += strlen(ptr);
+
+    if (ptr >= (kind + sizeof(kind) - 1))
+      break;
+  }
+
+  urf[0] = '\0';
+  for (i = 0, count = ippGetCount(urf_supported), ptr = urf; i < count; i ++)
+  {
+    value = ippGetString(urf_supported, i, NULL);
+
+    if (ptr > urf && ptr < (urf + sizeof(urf) - 1))
+      *ptr++ = ',';
+
+    strlcpy(ptr, value, sizeof(urf) - (size_t)(ptr - urf));
+    ptr += strlen(ptr);
+
+    if (ptr >= (urf + sizeof(urf) - 1))
+      break;
+  }
+#  ifdef HAVE_DNSSD
+  TXTRecordCreate(txt, 1024, NULL);
+  TXTRecordSetValue(txt, "rp", (uint8_t)strlen(printer->resource) - 1, printer->resource + 1);
+  if ((value = ippGetString(printer_make_and_model, 0, NULL)) != NULL)
+    TXTRecordSetValue(txt, "ty", (uint8_t)strlen(value), value);
+  if ((value = ippGetString(printer_more_info, 0, NULL)) != NULL)
+    TXTRecordSetValue(txt, "adminurl", (uint8_t)strlen(value), value);
+  if ((value = ippGetString(printer_location, 0, NULL)) != NULL)
+    TXTRecordSetValue(txt, "note", (uint8_t)strlen(value), value);
+  TXTRecordSetValue(txt, "pdl", (uint8_t)strlen(formats), formats);
+  if (kind[0])
+    TXTRecordSetValue(txt, "kind", (uint8_t)strlen(kind), kind);
+  if ((value = ippGetString(printer_uuid, 0, NULL)) != NULL)
+    TXTRecordSetValue(txt, "UUID", (uint8_t)strlen(value) - 9, value + 9);
+  if (!is_print3d)
+  {
+    TXTRecordSetValue(txt, "Color", 1, ippGetBoolean(color_supported, 0) ? "T" : "F");
+    TXTRecordSetValue(txt, "Duplex", 1, ippGetCount(sides_supported) > 1 ? "T" : "F");
+  }
+
+#    ifdef HAVE_SSL
+  if (!is_print3d && Encryption != HTTP_ENCRYPTION_NEVER)
+    TXTRecordSetValue(txt, "TLS", 3, "1.2");
+#    endif /* HAVE_SSL */
+  if (urf[0])
+    TXTRecordSetValue(txt, "URF", (uint8_t)strlen(urf), urf);
+  TXTRecordSetValue(txt, "txtvers", 1, "1");
+  TXTRecordSetValue(txt, "qtotal", 1, "1");
+
+#  elif defined(HAVE_AVAHI)
+  *txt = NULL;
+  *txt = avahi_string_list_add_printf(*txt, "rp=%s", printer->resource + 1);
+  if ((value = ippGetString(printer_make_and_model, 0, NULL)) != NULL)
+    *txt = avahi_string_list_add_printf(*txt, "ty=%s", value);
+  if ((value = ippGetString(printer_more_info, 0, NULL)) != NULL)
+    *txt = avahi_string_list_add_printf(*txt, "adminurl=%s", value);
+  if ((value = ippGetString(printer_location, 0, NULL)) != NULL)
+    *txt = avahi_string_list_add_printf(*txt, "note=%s", value);
+  *txt = avahi_string_list_add_printf(*txt, "pdl=%s", formats);
+  if ((value = ippGetString(printer_uuid, 0, NULL)) != NULL)
+    *txt = avahi_string_list_add_printf(*txt, "UUID=%s", value + 9);
+
+  if (!is_print3d)
+  {
+    *txt = avahi_string_list_add_printf(*txt, "Color=%s", ippGetBoolean(color_supported, 0) ? "T" : "F");
+    *txt = avahi_string_list_add_printf(*txt, "Duplex=%s", ippGetCount(sides_supported) > 1 ? "T" : "F");
+  }
+
+#    ifdef HAVE_SSL
+  if (!is_print3d && Encryption != HTTP_ENCRYPTION_NEVER)
+    *txt = avahi_string_list_add_printf(*txt, "TLS=1.2");
+#    endif /* HAVE_SSL */
+  if (urf[0])
+    *txt = avahi_string_list_add_printf(*txt, "URF=%s", urf);
+  *txt = avahi_string_list_add_printf(*txt, "txtvers=1");
+  *txt = avahi_string_list_add_printf(*txt, "qtotal=1");
+#  endif /* HAVE_DNSSD */
+
+  return (is_print3d);
+}
+#endif /* HAVE_DNSSD || HAVE_AVAHI */
+
+
+/*
+ * 'create_vset()' - Create a hashed set of supported string values.
+ *
+ * Values are compared without regard to case, like ippContainsString.
+ * @code NULL@ is returned when there is no attribute so that callers can
+ * tell a missing attribute from one without any matching values.
+ */
+
+static cups_array_t *			/* O - Set of values or @code NULL@ */
+create_vset(ipp_attribute_t *attr)	/* I - Supported attribute */
+{
+  cups_array_t	*vset;			/* Set of values */
+  int		i,			/* Looping var */
+		count;			/* Number of values */
+  const char	*value;			/* Current value */
+
+
+  if (!attr)
+    return (NULL);
 
-  ippDelete(media_size);
+  if ((vset = _cupsArrayNewHash((cups_array_func_t)_cups_strcasecmp, NULL, (cups_ahash_func_t)hash_vset_value, (cups_acopy_func_t)_cupsStrAlloc, (cups_afree_func_t)_cupsStrFree)) == NULL)
+    return (NULL);
 
-  return (media_col);
+  for (i = 0, count = ippGetCount(attr); i < count; i ++)
+  {
+    if ((value = ippGetString(attr, i, NULL)) != NULL && !cupsArrayFind(vset, (void *)value))
+      cupsArrayAdd(vset, (void *)value);
+  }
+
+  return (vset);
 }
 
 
 /*
- * 'create_media_size()' - Create a media-size value.
+ * 'delete_user_jobs()' - Free the jobs for a user.
  */
 
-static ipp_t *				/* O - media-col collection */
-create_media_size(int width,		/* I - x-dimension in 2540ths */
-		  int length)		/* I - y-dimension in 2540ths */
+static void
+delete_user_jobs(
+    server_userjobs_t *ujobs)		/* I - Jobs for user */
 {
-  ipp_t	*media_size = ippNew();		/* media-size value */
+  cupsArrayDelete(ujobs->jobs);
+  free(ujobs->username);
+  free(ujobs);
+}
 
 
-  ippAddInteger(media_size, IPP_TAG_PRINTER, IPP_TAG_INTEGER, "x-dimension",
-                width);
-  ippAddInteger(media_size, IPP_TAG_PRINTER, IPP_TAG_INTEGER, "y-dimension",
-                length);
+/*
+ * 'delete_vcache()' - Free precompiled validation values.
+ */
 
-  return (media_size);
+static void
+delete_vcache(server_vcache_t *vcache)	/* I - Validation values */
+{
+  if (!vcache)
+    return;
+
+  cupsArrayDelete(vcache->compression);
+  cupsArrayDelete(vcache->document_format);
+  cupsArrayDelete(vcache->job_hold_until);
+  cupsArrayDelete(vcache->job_sheets);
+  cupsArrayDelete(vcache->media);
+  cupsArrayDelete(vcache->multiple_document_handling);
+  cupsArrayDelete(vcache->sides);
+
+  free(vcache);
 }
 
 
@@ -2546,6 +2744,22 @@ dnssd_callback(
 #endif /* HAVE_DNSSD */
 
 
+/*
+ * 'hash_vset_value()' - Compute the FNV-1a hash of a lowercased string.
+ */
+
+static int				/* O - Hash value */
+hash_vset_value(const char *value)	/* I - String value */
+{
+  unsigned	hash;			/* Hash value */
+
+
+  for (hash = 2166136261U; *value; value ++)
+    hash = (hash ^ (unsigned)_cups_tolower(*value & 255)) * 16777619U;
+
+  return ((int)hash);
+}
+
 #if defined(HAVE_DNSSD) || defined(HAVE_AVAHI)
 /*
  * 'register_geo()' - Register (or update) a printer's geo-location via Bonjour.
@@ -2668,3 +2882,219 @@ register_geo(server_printer_t *printer)	/* I - Printer */
   }
 }
 #endif /* HAVE_DNSSD || HAVE_AVAHI */
+
+
+#if defined(HAVE_DNSSD) || defined(HAVE_AVAHI)
+/*
+ * 'register_printer()' - Register the DNS-SD services for a printer.
+ *
+ * When using Avahi the threaded poll lock must be held.
+ */
+
+static int				/* O - 1 on success, 0 on error */
+register_printer(
+    server_printer_t *printer)		/* I - Printer */
+{
+  int			is_print3d;	/* 3D printer? */
+  server_txt_t		ipp_txt;	/* Bonjour IPP TXT record */
+  server_listener_t	*lis = cupsArrayFirst(Listeners);
+					/* Listen socket */
+  char			regtype[256];	/* DNS-SD service type */
+#  ifdef HAVE_DNSSD
+  DNSServiceErrorType	error;		/* Error from Bonjour */
+#  endif /* HAVE_DNSSD */
+
+
+  is_print3d = create_txt(printer, &ipp_txt);
+
+  cache_txt(printer, &ipp_txt);
+
+#  ifdef HAVE_DNSSD
+ /*
+  * Register the _printer._tcp (LPD) service type with a port number of 0 to
+  * defend our service name but not actually support LPD...
+  */
+
+  printer->printer_ref = DNSSDMaster;
+
+  if ((error = DNSServiceRegister(&(printer->printer_ref), kDNSServiceFlagsShareConnection, 0 /* interfaceIndex */, printer->dns_sd_name, "_printer._tcp", NULL /* domain */, NULL /* host */, 0 /* port */, 0 /* txtLen */, NULL /* txtRecord */, (DNSServiceRegisterReply)dnssd_callback, printer)) != kDNSServiceErr_NoError)
+  {
+    serverLogPrinter(SERVER_LOGLEVEL_ERROR, printer, "Unable to register \"%s._printer._tcp\": %d", printer->dns_sd_name, error);
+    return (0);
+  }
+
+ /*
+  * Then register the corresponding IPP service types with the real port
+  * number to advertise our printer...
+  */
+
+  if (!is_print3d)
+  {
+    printer->ipp_ref = DNSSDMaster;
+
+    if (DNSSDSubType && *DNSSDSubType)
+      snprintf(regtype, sizeof(regtype), SERVER_IPP_TYPE ",%s", DNSSDSubType);
+    else
+      strlcpy(regtype, SERVER_IPP_TYPE, sizeof(regtype));
+
+    if ((error = DNSServiceRegister(&(printer->ipp_ref), kDNSServiceFlagsShareConnection, 0 /* interfaceIndex */, printer->dns_sd_name, regtype, NULL /* domain */, NULL /* host */, htons(lis->port), TXTRecordGetLength(&ipp_txt), TXTRecordGetBytesPtr(&ipp_txt), (DNSServiceRegisterReply)dnssd_callback, printer)) != kDNSServiceErr_NoError)
+    {
+      serverLogPrinter(SERVER_LOGLEVEL_ERROR, printer, "Unable to register \"%s.%s\": %d", printer->dns_sd_name, regtype, error);
+      return (0);
+    }
+  }
+
+#    ifdef HAVE_SSL
+  if (Encryption != HTTP_ENCRYPTION_NEVER)
+  {
+    printer->ipps_ref = DNSSDMaster;
+
+    if (is_print3d)
+    {
+      if (DNSSDSubType && *DNSSDSubType)
+	snprintf(regtype, sizeof(regtype), SERVER_IPPS_3D_TYPE ",%s", DNSSDSubType);
+      else
+	strlcpy(regtype, SERVER_IPPS_3D_TYPE, sizeof(regtype));
+    }
+    else if (DNSSDSubType && *DNSSDSubType)
+      snprintf(regtype, sizeof(regtype), SERVER_IPPS_TYPE ",%s", DNSSDSubType);
+    else
+      strlcpy(regtype, SERVER_IPPS_TYPE, sizeof(regtype));
+
+    if ((error = DNSServiceRegister(&(printer->ipps_ref), kDNSServiceFlagsShareConnection, 0 /* interfaceIndex */, printer->dns_sd_name, regtype, NULL /* domain */, NULL /* host */, htons(lis->port), TXTRecordGetLength(&ipp_txt), TXTRecordGetBytesPtr(&ipp_txt), (DNSServiceRegisterReply)dnssd_callback, printer)) != kDNSServiceErr_NoError)
+    {
+      serverLogPrinter(SERVER_LOGLEVEL_ERROR, printer, "Unable to register \"%s.%s\": %d", printer->dns_sd_name, regtype, error);
+      return (0);
+    }
+  }
+#    endif /* HAVE_SSL */
+
+ /*
+  * Register the geolocation of the service...
+  */
+
+  register_geo(printer);
+
+ /*
+  * Similarly, register the _http._tcp,_printer (HTTP) service type with the
+  * real port number to advertise our IPP printer...
+  */
+
+  printer->http_ref = DNSSDMaster;
+
+  if ((error = DNSServiceRegister(&(printer->http_ref), kDNSServiceFlagsShareConnection, 0 /* interfaceIndex */, printer->dns_sd_name, SERVER_WEB_TYPE ",_printer", NULL /* domain */, NULL /* host */, htons(lis->port), 0 /* txtLen */, NULL, /* txtRecord */ (DNSServiceRegisterReply)dnssd_callback, printer)) != kDNSServiceErr_NoError)
+  {
+    serverLogPrinter(SERVER_LOGLEVEL_ERROR, printer, "Unable to register \"%s.%s\": %d", printer->dns_sd_name, SERVER_WEB_TYPE ",_printer", error);
+    return (0);
+  }
+
+  TXTRecordDeallocate(&ipp_txt);
+
+#  elif defined(HAVE_AVAHI)
+ /*
+  * Register _printer._tcp (LPD) with port 0 to reserve the service name...
+  */
+
+  printer->dnssd_ref = avahi_entry_group_new(DNSSDClient, dnssd_callback, NULL);
+
+  avahi_entry_group_add_service_strlst(printer->dnssd_ref, AVAHI_IF_UNSPEC, AVAHI_PROTO_UNSPEC, 0, printer->dns_sd_name, "_printer._tcp", NULL, NULL, 0, NULL);
+
+ /*
+  * Then register the IPP/IPPS services...
+  */
+
+  if (!is_print3d)
+  {
+    avahi_entry_group_add_service_strlst(printer->dnssd_ref, AVAHI_IF_UNSPEC, AVAHI_PROTO_UNSPEC, 0, printer->dns_sd_name, SERVER_IPP_TYPE, NULL, NULL, lis->port, ipp_txt);
+    if (DNSSDSubType && *DNSSDSubType)
+    {
+      char *temptypes = strdup(DNSSDSubType), *start, *end;
+
+      for (start = temptypes; *start; start = end)
+      {
+	if ((end = strchr(start, ',')) != NULL)
+	  *end++ = '\0';
+	else
+	  end = start + strlen(start);
+
+	snprintf(regtype, sizeof(regtype), "%s._sub." SERVER_IPP_TYPE, start);
+	avahi_entry_group_add_service_subtype(printer->dnssd_ref, AVAHI_IF_UNSPEC, AVAHI_PROTO_UNSPEC, 0, printer->dns_sd_name, SERVER_IPP_TYPE, NULL, regtype);
+      }
+
+      free(temptypes);
+    }
+  }
+
+#    ifdef HAVE_SSL
+  if (Encryption != HTTP_ENCRYPTION_NEVER)
+  {
+    if (is_print3d)
+    {
+      avahi_entry_group_add_service_strlst(printer->dnssd_ref, AVAHI_IF_UNSPEC, AVAHI_PROTO_UNSPEC, 0, printer->dns_sd_name, SERVER_IPPS_3D_TYPE, NULL, NULL, lis->port, ipp_txt);
+      if (DNSSDSubType && *DNSSDSubType)
+      {
+	char *temptypes = strdup(DNSSDSubType), *start, *end;
+
+	for (start = temptypes; *start; start = end)
+	{
+	  if ((end = strchr(start, ',')) != NULL)
+	    *end++ = '\0';
+	  else
+	    end = start + strlen(start);
+
+	  snprintf(regtype, sizeof(regtype), "%s._sub." SERVER_IPPS_3D_TYPE, start);
+	  avahi_entry_group_add_service_subtype(printer->dnssd_ref, AVAHI_IF_UNSPEC, AVAHI_PROTO_UNSPEC, 0, printer->dns_sd_name, SERVER_IPPS_3D_TYPE, NULL, regtype);
+	}
+
+	free(temptypes);
+      }
+    }
+    else
+    {
+      avahi_entry_group_add_service_strlst(printer->dnssd_ref, AVAHI_IF_UNSPEC, AVAHI_PROTO_UNSPEC, 0, printer->dns_sd_name, SERVER_IPPS_TYPE, NULL, NULL, lis->port, ipp_txt);
+      if (DNSSDSubType && *DNSSDSubType)
+      {
+	char *temptypes = strdup(DNSSDSubType), *start, *end;
+
+	for (start = temptypes; *start; start = end)
+	{
+	  if ((end = strchr(start, ',')) != NULL)
+	    *end++ = '\0';
+	  else
+	    end = start + strlen(start);
+
+	  snprintf(regtype, sizeof(regtype), "%s._sub." SERVER_IPPS_TYPE, start);
+	  avahi_entry_group_add_service_subtype(printer->dnssd_ref, AVAHI_IF_UNSPEC, AVAHI_PROTO_UNSPEC, 0, printer->dns_sd_name, SERVER_IPPS_TYPE, NULL, regtype);
+	}
+
+	free(temptypes);
+      }
+    }
+  }
+#    endif /* HAVE_SSL */
+
+ /*
+  * Register the geolocation of the service...
+  */
+
+  register_geo(printer);
+
+ /*
+  * Finally _http.tcp (HTTP) for the web interface...
+  */
+
+  avahi_entry_group_add_service_strlst(printer->dnssd_ref, AVAHI_IF_UNSPEC, AVAHI_PROTO_UNSPEC, 0, printer->dns_sd_name, SERVER_WEB_TYPE, NULL, NULL, lis->port, NULL);
+  avahi_entry_group_add_service_subtype(printer->dnssd_ref, AVAHI_IF_UNSPEC, AVAHI_PROTO_UNSPEC, 0, printer->dns_sd_name, SERVER_WEB_TYPE, NULL, "_printer._sub." SERVER_WEB_TYPE);
+
+ /*
+  * Commit it...
+  */
+
+  avahi_entry_group_commit(printer->dnssd_ref);
+
+  avahi_string_list_free(ipp_txt);
+#  endif /* HAVE_DNSSD */
+
+  return (1);
+}
+#endif /* HAVE_DNSSD || HAVE_AVAHI */
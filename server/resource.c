@@ -9,6 +9,9 @@
  */
 
 #include "ippserver.h"
+#ifndef _WIN32
+#  include <sys/mman.h>
+#endif /* !_WIN32 */
 
 
 /*
@@ -18,6 +21,10 @@
 static int	compare_filenames(server_resource_t *a, server_resource_t *b);
 static int	compare_ids(server_resource_t *a, server_resource_t *b);
 static int	compare_resources(server_resource_t *a, server_resource_t *b);
+static int	hash_filename(server_resource_t *res);
+static int	hash_resource(server_resource_t *res);
+static void	load_data(server_resource_t *res);
+static void	rset_rehash(server_rset_t *set);
 
 
 /*
@@ -40,7 +47,9 @@ serverAddResourceFile(
 
   res->filename = strdup(filename);
   res->format   = strdup(format);
-  res->state    = IPP_RSTATE_AVAILABLE;
+
+  if (res->state == IPP_RSTATE_PENDING)
+    res->state = IPP_RSTATE_AVAILABLE;
 
   _cupsRWLockWrite(&ResourcesRWLock);
 
@@ -73,12 +82,81 @@ serverAddResourceFile(
   else
     ippAddInteger(res->attrs, IPP_TAG_RESOURCE, IPP_TAG_INTEGER, "resource-k-octets", 0);
 
-  serverAddEventNoLock(NULL, NULL, res, SERVER_EVENT_RESOURCE_STATE_CHANGED, "Resource %d now available.", res->id);
+  if (res->state == IPP_RSTATE_AVAILABLE)
+    serverAddEventNoLock(NULL, NULL, res, SERVER_EVENT_RESOURCE_STATE_CHANGED, "Resource %d now available.", res->id);
 
   _cupsRWUnlock(&res->rwlock);
 }
 
 
+/*
+ * 'serverAddResourceId()' - Add an ID to a set of resource IDs.
+ */
+
+int					/* O - 1 if added, 0 if already present or on error */
+serverAddResourceId(
+    server_rset_t *set,			/* I - Set of resource IDs */
+    int           id)			/* I - Resource ID */
+{
+  unsigned	i;			/* Hash table index */
+
+
+  if (id <= 0 || serverHasResourceId(set, id))
+    return (0);
+
+  if (set->num_ids >= set->alloc_ids)
+  {
+    int	alloc_ids,			/* New allocation */
+	*ids;				/* New IDs */
+
+    alloc_ids = set->alloc_ids ? 2 * set->alloc_ids : 4;
+
+    if ((ids = realloc(set->ids, (size_t)alloc_ids * sizeof(int))) == NULL)
+      return (0);
+
+    set->alloc_ids = alloc_ids;
+    set->ids       = ids;
+  }
+
+  set->ids[set->num_ids ++] = id;
+
+  if (set->num_ids <= SERVER_RSET_LINEAR)
+    return (1);
+
+  if (!set->table || (unsigned)set->num_ids > set->mask / 2)
+  {
+   /*
+    * Grow the hash table to keep it at most half full...
+    */
+
+    rset_rehash(set);
+  }
+  else
+  {
+    for (i = ((unsigned)id * 2654435761U) & set->mask; set->table[i]; i = (i + 1) & set->mask);
+
+    set->table[i] = id;
+  }
+
+  return (1);
+}
+
+
+/*
+ * 'serverClearResourceIds()' - Free the memory used by a set of resource IDs.
+ */
+
+void
+serverClearResourceIds(
+    server_rset_t *set)			/* I - Set of resource IDs */
+{
+  free(set->ids);
+  free(set->table);
+
+  memset(set, 0, sizeof(server_rset_t));
+}
+
+
 /*
  * 'serverCreateResourceFilename()' - Create a filename for a resource.
  */
@@ -259,11 +337,11 @@ serverCreateResource(
   ippAddOutOfBand(res->attrs, IPP_TAG_RESOURCE, IPP_TAG_NOVALUE, "time-at-canceled");
 
   if (!ResourcesByFilename)
-    ResourcesByFilename = cupsArrayNew((cups_array_func_t)compare_filenames, NULL);
+    ResourcesByFilename = _cupsArrayNewHash((cups_array_func_t)compare_filenames, NULL, (cups_ahash_func_t)hash_filename, NULL, NULL);
   if (!ResourcesById)
     ResourcesById = cupsArrayNew((cups_array_func_t)compare_ids, NULL);
   if (!ResourcesByPath)
-    ResourcesByPath = cupsArrayNew((cups_array_func_t)compare_resources, NULL);
+    ResourcesByPath = _cupsArrayNewHash((cups_array_func_t)compare_resources, NULL, (cups_ahash_func_t)hash_resource, NULL, NULL);
 
   cupsArrayAdd(ResourcesById, res);
   if (res->resource)
@@ -300,6 +378,16 @@ serverDeleteResource(
   _cupsRWLockWrite(&res->rwlock);
 
   ippDelete(res->attrs);
+  ippDelete(res->template_attrs);
+
+  if (res->datalen > 0)
+  {
+#ifdef _WIN32
+    free(res->data);
+#else
+    munmap(res->data, res->datalen);
+#endif /* _WIN32 */
+  }
 
   free(res->filename);
   free(res->format);
@@ -380,6 +468,180 @@ serverFindResourceByPath(
 }
 
 
+/*
+ * 'serverGetResourceData()' - Get the contents of a resource file.
+ *
+ * The file is loaded into memory on first use and stays there until the
+ * resource is deleted, since resource files never change once they have been
+ * added.
+ */
+
+const unsigned char *			/* O - Resource data or `NULL` on error */
+serverGetResourceData(
+    server_resource_t *res,		/* I - Resource */
+    size_t            *datalen,		/* O - Length of data */
+    char              *etag,		/* I - ETag buffer */
+    size_t            etagsize)		/* I - Size of ETag buffer */
+{
+  const unsigned char	*data;		/* Resource data */
+
+
+  _cupsRWLockRead(&res->rwlock);
+
+  if (!res->data)
+  {
+    _cupsRWUnlock(&res->rwlock);
+    _cupsRWLockWrite(&res->rwlock);
+
+    if (!res->data)
+      load_data(res);
+  }
+
+  data     = res->data;
+  *datalen = res->datalen;
+
+  strlcpy(etag, res->etag, etagsize);
+
+  _cupsRWUnlock(&res->rwlock);
+
+  return (data);
+}
+
+
+/*
+ * 'serverGetResourceTemplate()' - Get the attributes from a template resource.
+ *
+ * The template file is parsed on first use and the attributes are kept until
+ * the resource is deleted.  The returned attributes are shared and must not be
+ * modified.
+ */
+
+ipp_t *					/* O - Template attributes or `NULL` on error */
+serverGetResourceTemplate(
+    server_resource_t *res)		/* I - Resource */
+{
+  ipp_t		*attrs;			/* Template attributes */
+  int		fd;			/* Template file */
+
+
+  _cupsRWLockRead(&res->rwlock);
+
+  if ((attrs = res->template_attrs) == NULL)
+  {
+    _cupsRWUnlock(&res->rwlock);
+    _cupsRWLockWrite(&res->rwlock);
+
+    if ((attrs = res->template_attrs) == NULL && res->filename)
+    {
+      if ((fd = open(res->filename, O_RDONLY | O_BINARY)) < 0)
+      {
+        serverLog(SERVER_LOGLEVEL_ERROR, "Unable to open resource %d file \"%s\": %s", res->id, res->filename, strerror(errno));
+      }
+      else
+      {
+        attrs = ippNew();
+
+	if (ippReadFile(fd, attrs) != IPP_STATE_DATA)
+	{
+	  serverLog(SERVER_LOGLEVEL_ERROR, "Unable to read resource %d file \"%s\": %s", res->id, res->filename, cupsLastErrorString());
+	  ippDelete(attrs);
+	  attrs = NULL;
+	}
+
+	close(fd);
+
+	res->template_attrs = attrs;
+      }
+    }
+  }
+
+  _cupsRWUnlock(&res->rwlock);
+
+  return (attrs);
+}
+
+
+/*
+ * 'serverHasResourceId()' - Determine whether a set contains a resource ID.
+ */
+
+int					/* O - 1 if present, 0 otherwise */
+serverHasResourceId(
+    server_rset_t *set,			/* I - Set of resource IDs */
+    int           id)			/* I - Resource ID */
+{
+  int		i;			/* Looping var */
+  unsigned	j;			/* Hash table index */
+
+
+  if (!set->table)
+  {
+   /*
+    * Small sets are searched linearly...
+    */
+
+    for (i = 0; i < set->num_ids; i ++)
+    {
+      if (set->ids[i] == id)
+        return (1);
+    }
+
+    return (0);
+  }
+
+  for (j = ((unsigned)id * 2654435761U) & set->mask; set->table[j]; j = (j + 1) & set->mask)
+  {
+    if (set->table[j] == id)
+      return (1);
+  }
+
+  return (0);
+}
+
+
+/*
+ * 'serverRemoveResourceId()' - Remove an ID from a set of resource IDs.
+ *
+ * The remaining IDs stay in order of allocation and the hash table, if any, is
+ * rebuilt.
+ */
+
+int					/* O - 1 if removed, 0 if not present */
+serverRemoveResourceId(
+    server_rset_t *set,			/* I - Set of resource IDs */
+    int           id)			/* I - Resource ID */
+{
+  int	i;				/* Looping var */
+
+
+  if (!serverHasResourceId(set, id))
+    return (0);
+
+  for (i = 0; i < set->num_ids; i ++)
+  {
+    if (set->ids[i] == id)
+      break;
+  }
+
+  set->num_ids --;
+  if (i < set->num_ids)
+    memmove(set->ids + i, set->ids + i + 1, (size_t)(set->num_ids - i) * sizeof(int));
+
+  if (set->num_ids > SERVER_RSET_LINEAR)
+  {
+    rset_rehash(set);
+  }
+  else
+  {
+    free(set->table);
+    set->table = NULL;
+    set->mask  = 0;
+  }
+
+  return (1);
+}
+
+
 /*
  * 'serverSetResourceState()' - Set the state of a resource.
  */
@@ -470,3 +732,121 @@ compare_resources(
 {
   return (strcmp(a->resource, b->resource));
 }
+
+
+/*
+ * 'hash_filename()' - Hash a resource filename.
+ */
+
+static int				/* O - Hash value */
+hash_filename(server_resource_t *res)	/* I - Resource */
+{
+  return ((int)_cupsStrHash(res->filename));
+}
+
+
+/*
+ * 'hash_resource()' - Hash a resource path.
+ */
+
+static int				/* O - Hash value */
+hash_resource(server_resource_t *res)	/* I - Resource */
+{
+  return ((int)_cupsStrHash(res->resource));
+}
+
+
+/*
+ * 'load_data()' - Load the contents of a resource file into memory.
+ *
+ * The resource must be locked for writing.
+ */
+
+static void
+load_data(server_resource_t *res)	/* I - Resource */
+{
+  int		fd;			/* Resource file */
+  struct stat	fileinfo;		/* Resource file information */
+  unsigned char	*data;			/* Resource data */
+  static unsigned char empty[1] = "";	/* Data for empty files */
+
+
+  if (!res->filename || (fd = open(res->filename, O_RDONLY | O_BINARY)) < 0)
+    return;
+
+  if (fstat(fd, &fileinfo))
+  {
+    close(fd);
+    return;
+  }
+
+  if (fileinfo.st_size == 0)
+  {
+    data = empty;
+  }
+  else
+  {
+#ifdef _WIN32
+    if ((data = malloc((size_t)fileinfo.st_size)) != NULL && read(fd, data, (unsigned)fileinfo.st_size) != (int)fileinfo.st_size)
+    {
+      free(data);
+      data = NULL;
+    }
+
+#else
+    if ((data = mmap(NULL, (size_t)fileinfo.st_size, PROT_READ, MAP_PRIVATE, fd, 0)) == MAP_FAILED)
+      data = NULL;
+#endif /* _WIN32 */
+  }
+
+  close(fd);
+
+  if (!data)
+  {
+    serverLog(SERVER_LOGLEVEL_ERROR, "Unable to load resource %d file \"%s\": %s", res->id, res->filename, strerror(errno));
+    return;
+  }
+
+  res->data    = data;
+  res->datalen = (size_t)fileinfo.st_size;
+  res->mtime   = fileinfo.st_mtime;
+
+  snprintf(res->etag, sizeof(res->etag), "\"%d-%lx-%lx\"", res->id, (unsigned long)fileinfo.st_size, (unsigned long)fileinfo.st_mtime);
+}
+
+
+/*
+ * 'rset_rehash()' - Rebuild the hash table for a set of resource IDs.
+ *
+ * The table is sized to be at most a quarter full.  If it cannot be allocated
+ * the set falls back to linear searches.
+ */
+
+static void
+rset_rehash(server_rset_t *set)		/* I - Set of resource IDs */
+{
+  int		i;			/* Looping var */
+  unsigned	j,			/* Hash table index */
+		mask;			/* Size of hash table - 1 */
+
+
+  free(set->table);
+
+  for (mask = 1; mask < 4 * (unsigned)set->num_ids; mask <<= 1);
+  mask --;
+
+  if ((set->table = calloc((size_t)mask + 1, sizeof(int))) == NULL)
+  {
+    set->mask = 0;
+    return;
+  }
+
+  set->mask = mask;
+
+  for (i = 0; i < set->num_ids; i ++)
+  {
+    for (j = ((unsigned)set->ids[i] * 2654435761U) & mask; set->table[j]; j = (j + 1) & mask);
+
+    set->table[j] = set->ids[i];
+  }
+}
@@ -11,16 +11,54 @@
 #include "ippserver.h"
 
 
+/*
+ * Local types...
+ */
+
+typedef struct server_subindex_s	/**** Subscription index entry ****/
+{
+  server_printer_t	*printer;	/* Printer, if any */
+  server_job_t		*job;		/* Job, if any */
+  server_resource_t	*resource;	/* Resource, if any */
+  server_event_t	mask;		/* Events for all subscriptions */
+  cups_array_t		*subs;		/* Subscriptions */
+} server_subindex_t;
+
+
+/*
+ * Local globals...
+ */
+
+static cups_array_t	*subscription_index = NULL;
+					/* Subscriptions by printer/job/resource */
+static _cups_mutex_t	notify_mutex = _CUPS_MUTEX_INITIALIZER;
+					/* Mutex for notification references */
+
+
 /*
  * Local functions...
  */
 
+static int	compare_subindex(server_subindex_t *a, server_subindex_t *b);
 static int	compare_subscriptions(server_subscription_t *a, server_subscription_t *b);
+static server_notify_t *create_notify(server_printer_t *printer, server_job_t *job, server_resource_t *res, server_event_t event, const char *text, int printer_attrs);
+static void	release_notify(server_notify_t *notify);
+static void	wake_waiters(server_subscription_t *sub);
 
 
 /*
  * 'serverAddEventNoLock()' - Add an event to a subscription.
  *
+ * The subscription index is used to find the subscriptions for the printer,
+ * job, and resource.  The common event attributes are built once and shared
+ * by all subscriptions, with the per-subscription attributes added by
+ * serverCopySubscriptionEvent().
+ *
+ * Job progress events that are not combined with other events are coalesced:
+ * at most one is reported per job every "JobProgressInterval" seconds, and
+ * each subscription receives at most one per job every notify-time-interval
+ * seconds.
+ *
  * Note: Printer, job, resource, and subscription objects are not locked.
  */
 
@@ -33,13 +71,45 @@ serverAddEventNoLock(
     const char        *message,		/* I - Printf-style notify-text message */
     ...)				/* I - Additional printf arguments */
 {
+  int			i,		/* Looping var */
+			j,		/* Looping var */
+			count,		/* Number of subscriptions */
+			num_added = 0;	/* Number of events added */
+  server_subindex_t	key,		/* Search key */
+			*idx;		/* Index entry */
   server_subscription_t *sub;		/* Current subscription */
-  ipp_t			*n;		/* Notify event attributes */
-  ipp_attribute_t	*attr;		/* Event attribute */
+  server_notify_t	*notify[2] = { NULL, NULL };
+					/* Shared event attributes */
+  server_sevent_t	*sevent;	/* Subscription event */
+  int			printer_attrs;	/* Include printer attributes? */
+  double		curtime = 0.0;	/* Current time for job progress events */
   char			text[1024];	/* notify-text value */
   va_list		ap;		/* Argument pointer */
 
 
+ /*
+  * Invalidate any cached web interface pages...
+  */
+
+  if (printer)
+    SERVER_GEN_BUMP(printer->web_gen);
+
+  SERVER_GEN_BUMP(SystemWebGen);
+
+  if (job && event == SERVER_EVENT_JOB_PROGRESS)
+  {
+   /*
+    * Drop job progress events that arrive too soon after the last one...
+    */
+
+    curtime = serverGetTime();
+
+    if (JobProgressInterval > 0 && (curtime - job->progress_time) < JobProgressInterval)
+      return;
+
+    job->progress_time = curtime;
+  }
+
   if (message)
   {
     va_start(ap, message);
@@ -49,78 +119,132 @@ serverAddEventNoLock(
   else
     text[0] = '\0';
 
-  serverLog(SERVER_LOGLEVEL_DEBUG, "serverAddEventNoLock(printer=%p(%s), job=%p(%d), event=0x%x, message=\"%s\")", (void *)printer, printer ? printer->name : "(null)", (void *)job, job ? job->id : -1, event, text);
+  SERVER_LOG_DEBUG("serverAddEventNoLock(printer=%p(%s), job=%p(%d), event=0x%x, message=\"%s\")", (void *)printer, printer ? printer->name : "(null)", (void *)job, job ? job->id : -1, event, text);
+
+  SERVER_TRACE2(event__start, printer ? printer->id : 0, event);
 
   _cupsRWLockRead(&SubscriptionsRWLock);
 
-  for (sub = (server_subscription_t *)cupsArrayFirst(Subscriptions); sub; sub = (server_subscription_t *)cupsArrayNext(Subscriptions))
+ /*
+  * Look up the subscriptions for every combination of the system/printer,
+  * job, and resource...
+  */
+
+  for (i = 0; i < 8; i ++)
   {
-    serverLog(SERVER_LOGLEVEL_DEBUG, "serverAddEvent: sub->id=%d, sub->mask=0x%x, sub->job=%p(%d)", sub->id, sub->mask, (void *)sub->job, sub->job ? sub->job->id : -1);
+    if (((i & 1) && !printer) || ((i & 2) && !job) || ((i & 4) && !res))
+      continue;
+
+    key.printer  = (i & 1) ? printer : NULL;
+    key.job      = (i & 2) ? job : NULL;
+    key.resource = (i & 4) ? res : NULL;
 
-    if (sub->mask & event && (!sub->job || job == sub->job) && (!sub->printer || printer == sub->printer) && (!sub->resource || res == sub->resource))
+    if ((idx = (server_subindex_t *)cupsArrayFind(subscription_index, &key)) == NULL || !(idx->mask & event))
+      continue;
+
+    for (j = 0, count = cupsArrayCount(idx->subs); j < count; j ++)
     {
+      sub = (server_subscription_t *)cupsArrayIndex(idx->subs, j);
+
+      if (!(sub->mask & event))
+        continue;
+
+      if (curtime > 0.0 && sub->interval > 0 && sub->progress_job == job->id && (curtime - sub->progress_time) < sub->interval)
+        continue;
+
+     /*
+      * Job subscriptions don't get the printer status attributes...
+      */
+
+      printer_attrs = !sub->job && printer && (event & SERVER_EVENT_PRINTER_ALL);
+
+      if (!notify[printer_attrs] && (notify[printer_attrs] = create_notify(printer, job, res, event, text, printer_attrs)) == NULL)
+        continue;
+
+      _cupsMutexLock(&notify_mutex);
+      notify[printer_attrs]->refcount ++;
+      _cupsMutexUnlock(&notify_mutex);
+
       _cupsRWLockWrite(&sub->rwlock);
 
-      n = ippNew();
-      ippAddString(n, IPP_TAG_EVENT_NOTIFICATION, IPP_TAG_CHARSET, "notify-charset", NULL, sub->charset);
-      ippAddString(n, IPP_TAG_EVENT_NOTIFICATION, IPP_TAG_LANGUAGE, "notify-natural-language", NULL, sub->language);
-      if (printer)
-	ippAddString(n, IPP_TAG_EVENT_NOTIFICATION, IPP_TAG_URI, "notify-printer-uri", NULL, printer->default_uri);
-      else
-	ippAddString(n, IPP_TAG_EVENT_NOTIFICATION, IPP_TAG_URI, "notify-system-uri", NULL, DefaultSystemURI);
-
-      if (job)
-	ippAddInteger(n, IPP_TAG_EVENT_NOTIFICATION, IPP_TAG_INTEGER, "notify-job-id", job->id);
-      if (res)
-	ippAddInteger(n, IPP_TAG_EVENT_NOTIFICATION, IPP_TAG_INTEGER, "notify-resource-id", res->id);
-      ippAddInteger(n, IPP_TAG_EVENT_NOTIFICATION, IPP_TAG_INTEGER, "notify-subscription-id", sub->id);
-      ippAddString(n, IPP_TAG_EVENT_NOTIFICATION, IPP_TAG_URI, "notify-subscription-uuid", NULL, sub->uuid);
-      ippAddInteger(n, IPP_TAG_EVENT_NOTIFICATION, IPP_TAG_INTEGER, "notify-sequence-number", ++ sub->last_sequence);
-      ippAddString(n, IPP_TAG_EVENT_NOTIFICATION, IPP_TAG_KEYWORD, "notify-subscribed-event", NULL, serverGetNotifySubscribedEvent(event));
-      ippAddString(n, IPP_TAG_EVENT_NOTIFICATION, IPP_TAG_TEXT, "notify-text", NULL, text);
-      if (sub->userdata)
-      {
-        attr = ippCopyAttribute(n, sub->userdata, 0);
-        ippSetGroupTag(n, &attr, IPP_TAG_EVENT_NOTIFICATION);
-      }
-      if (job && (event & SERVER_EVENT_JOB_ALL))
-      {
-	ippAddInteger(n, IPP_TAG_EVENT_NOTIFICATION, IPP_TAG_ENUM, "job-state", job->state);
-	serverCopyJobStateReasons(n, IPP_TAG_EVENT_NOTIFICATION, job);
-	if (event == SERVER_EVENT_JOB_CREATED)
-	{
-	  ippAddString(n, IPP_TAG_EVENT_NOTIFICATION, IPP_TAG_NAME, "job-name", NULL, job->name);
-	  ippAddString(n, IPP_TAG_EVENT_NOTIFICATION, IPP_TAG_NAME, "job-originating-user-name", NULL, job->username);
-	}
-      }
-      if (!sub->job && printer && (event & SERVER_EVENT_PRINTER_ALL))
+     /*
+      * Store the event in the ring buffer slot for its sequence number,
+      * replacing the oldest event when the buffer is full...
+      */
+
+      sub->last_sequence ++;
+
+      sevent = sub->events + sub->last_sequence % sub->max_events;
+
+      if (sevent->notify)
       {
-	ippAddBoolean(n, IPP_TAG_EVENT_NOTIFICATION, "printer-is-accepting-jobs", printer->is_accepting);
-	ippAddInteger(n, IPP_TAG_EVENT_NOTIFICATION, IPP_TAG_ENUM, "printer-state", printer->state);
-	serverCopyPrinterStateReasons(n, IPP_TAG_EVENT_NOTIFICATION, printer);
+        release_notify(sevent->notify);
+        sub->first_sequence ++;
       }
-      if (printer)
-	ippAddInteger(n, IPP_TAG_EVENT_NOTIFICATION, IPP_TAG_INTEGER, "printer-up-time", (int)(time(NULL) - printer->start_time));
-      else
-	ippAddInteger(n, IPP_TAG_EVENT_NOTIFICATION, IPP_TAG_INTEGER, "system-up-time", (int)(time(NULL) - SystemStartTime));
 
-      cupsArrayAdd(sub->events, n);
-      if (cupsArrayCount(sub->events) > 100)
+      sevent->sequence = sub->last_sequence;
+      sevent->notify   = notify[printer_attrs];
+
+      if (curtime > 0.0)
       {
-        n = (ipp_t *)cupsArrayFirst(sub->events);
-	cupsArrayRemove(sub->events, n);
-	ippDelete(n);
-	sub->first_sequence ++;
+        sub->progress_job  = job->id;
+        sub->progress_time = curtime;
       }
 
       _cupsRWUnlock(&sub->rwlock);
 
-      serverLog(SERVER_LOGLEVEL_DEBUG, "Broadcasting new event.");
-      _cupsCondBroadcast(&NotificationCondition);
+      if (sub->waiters)
+      {
+        _cupsMutexLock(&NotificationMutex);
+        wake_waiters(sub);
+        _cupsMutexUnlock(&NotificationMutex);
+      }
+
+      num_added ++;
     }
   }
 
   _cupsRWUnlock(&SubscriptionsRWLock);
+
+  release_notify(notify[0]);
+  release_notify(notify[1]);
+
+  SERVER_TRACE3(event__end, printer ? printer->id : 0, event, num_added);
+
+  if (num_added > 0)
+    SERVER_LOG_DEBUG("Added new event to %d subscriptions.", num_added);
+}
+
+
+/*
+ * 'serverCopySubscriptionEvent()' - Copy an event notification for a
+ *                                   subscription.
+ *
+ * Note: The subscription object must be locked by the caller.
+ */
+
+void
+serverCopySubscriptionEvent(
+    ipp_t                 *ipp,		/* I - IPP message */
+    server_subscription_t *sub,		/* I - Subscription */
+    server_sevent_t       *sevent)	/* I - Subscription event */
+{
+  ipp_attribute_t	*attr;		/* Event attribute */
+
+
+  ippAddString(ipp, IPP_TAG_EVENT_NOTIFICATION, IPP_TAG_CHARSET, "notify-charset", NULL, sub->charset);
+  ippAddString(ipp, IPP_TAG_EVENT_NOTIFICATION, IPP_TAG_LANGUAGE, "notify-natural-language", NULL, sub->language);
+  ippAddInteger(ipp, IPP_TAG_EVENT_NOTIFICATION, IPP_TAG_INTEGER, "notify-subscription-id", sub->id);
+  ippAddString(ipp, IPP_TAG_EVENT_NOTIFICATION, IPP_TAG_URI, "notify-subscription-uuid", NULL, sub->uuid);
+  ippAddInteger(ipp, IPP_TAG_EVENT_NOTIFICATION, IPP_TAG_INTEGER, "notify-sequence-number", sevent->sequence);
+
+  ippCopyAttributes(ipp, sevent->notify->attrs, 0, NULL, NULL);
+
+  if (sub->userdata)
+  {
+    attr = ippCopyAttribute(ipp, sub->userdata, 0);
+    ippSetGroupTag(ipp, &attr, IPP_TAG_EVENT_NOTIFICATION);
+  }
 }
 
 
@@ -146,6 +270,8 @@ serverCreateSubscription(
   server_listener_t *lis = (server_listener_t *)cupsArrayFirst(Listeners);
 					/* First listener */
   server_subscription_t	*sub;		/* Subscription */
+  server_subindex_t	key,		/* Index search key */
+			*idx;		/* Index entry */
   ipp_attribute_t	*attr;		/* Subscription attribute */
   char			uuid[64];	/* notify-subscription-uuid value */
 
@@ -171,7 +297,7 @@ serverCreateSubscription(
   sub->lease    = lease;
   sub->attrs    = ippNew();
 
-  serverLog(SERVER_LOGLEVEL_DEBUG, "serverCreateSubscription: notify-subscription-id=%d, printer=%p(%s)", sub->id, (void *)client->printer, client->printer ? client->printer->name : "(null)");
+  SERVER_LOG_DEBUG("serverCreateSubscription: notify-subscription-id=%d, printer=%p(%s)", sub->id, (void *)client->printer, client->printer ? client->printer->name : "(null)");
 
   if (lease)
     sub->expire = time(NULL) + sub->lease;
@@ -219,13 +345,13 @@ serverCreateSubscription(
 
     ippCopyAttribute(sub->attrs, notify_events, 0);
 
-    serverLog(SERVER_LOGLEVEL_DEBUG, "serverCreateSubscription: notify-events has %d values.", ippGetCount(notify_events));
+    SERVER_LOG_DEBUG("serverCreateSubscription: notify-events has %d values.", ippGetCount(notify_events));
 
     for (i = 0, mask = SERVER_EVENT_DOCUMENT_COMPLETED; i < (int)(sizeof(server_events) / sizeof(server_events[0])); i ++, mask *= 2)
     {
       if (ippContainsString(notify_events, server_events[i]))
       {
-	serverLog(SERVER_LOGLEVEL_DEBUG, "serverCreateSubscription: Adding 0x%x (%s) to mask bits.", mask, server_events[i]);
+	SERVER_LOG_DEBUG("serverCreateSubscription: Adding 0x%x (%s) to mask bits.", mask, server_events[i]);
 	sub->mask |= mask;
       }
     }
@@ -236,7 +362,7 @@ serverCreateSubscription(
     sub->mask = SERVER_EVENT_DEFAULT;
   }
 
-  serverLog(SERVER_LOGLEVEL_DEBUG, "serverCreateSubscription: sub->mask=0x%x", sub->mask);
+  SERVER_LOG_DEBUG("serverCreateSubscription: sub->mask=0x%x", sub->mask);
 
   ippAddString(sub->attrs, IPP_TAG_SUBSCRIPTION, IPP_CONST_TAG(IPP_TAG_KEYWORD), "notify-pull-method", NULL, "ippget");
 
@@ -246,13 +372,52 @@ serverCreateSubscription(
   if (notify_user_data)
     sub->userdata = ippCopyAttribute(sub->attrs, notify_user_data, 0);
 
-  sub->events = cupsArrayNew3(NULL, NULL, NULL, 0, NULL, (cups_afree_func_t)ippDelete);
+  sub->max_events     = MaxSubscriptionEvents > 0 ? MaxSubscriptionEvents : 100;
+  sub->first_sequence = 1;
+
+  if ((sub->events = calloc((size_t)sub->max_events, sizeof(server_sevent_t))) == NULL)
+  {
+    perror("Unable to allocate memory for subscription events");
+
+    ippDelete(sub->attrs);
+    _cupsRWDeinit(&sub->rwlock);
+    free(sub);
+
+    _cupsRWUnlock(&SubscriptionsRWLock);
+
+    return (NULL);
+  }
 
   if (!Subscriptions)
     Subscriptions = cupsArrayNew((cups_array_func_t)compare_subscriptions, NULL);
 
   cupsArrayAdd(Subscriptions, sub);
 
+ /*
+  * Add the subscription to the index...
+  */
+
+  if (!subscription_index)
+    subscription_index = cupsArrayNew((cups_array_func_t)compare_subindex, NULL);
+
+  key.printer  = sub->printer;
+  key.job      = sub->job;
+  key.resource = sub->resource;
+
+  if ((idx = (server_subindex_t *)cupsArrayFind(subscription_index, &key)) == NULL && (idx = calloc(1, sizeof(server_subindex_t))) != NULL)
+  {
+    *idx      = key;
+    idx->subs = cupsArrayNew((cups_array_func_t)compare_subscriptions, NULL);
+
+    cupsArrayAdd(subscription_index, idx);
+  }
+
+  if (idx)
+  {
+    idx->mask |= sub->mask;
+    cupsArrayAdd(idx->subs, sub);
+  }
+
   _cupsRWUnlock(&SubscriptionsRWLock);
 
   return (sub);
@@ -261,21 +426,62 @@ serverCreateSubscription(
 
 /*
  * 'serverDeleteSubscription()' - Delete a subscription.
+ *
+ * Note: The caller must hold a write lock on SubscriptionsRWLock.
  */
 
 void
 serverDeleteSubscription(
     server_subscription_t *sub)		/* I - Subscription */
 {
+  server_subindex_t	key,		/* Index search key */
+			*idx;		/* Index entry */
+  server_subscription_t	*isub;		/* Indexed subscription */
+  int			i;		/* Looping var */
+
+
   sub->pending_delete = 1;
 
-  serverLog(SERVER_LOGLEVEL_DEBUG, "Broadcasting deleted subscription.");
-  _cupsCondBroadcast(&NotificationCondition);
+ /*
+  * Remove the subscription from the index...
+  */
+
+  key.printer  = sub->printer;
+  key.job      = sub->job;
+  key.resource = sub->resource;
+
+  if ((idx = (server_subindex_t *)cupsArrayFind(subscription_index, &key)) != NULL)
+  {
+    cupsArrayRemove(idx->subs, sub);
+
+    if (cupsArrayCount(idx->subs) == 0)
+    {
+      cupsArrayRemove(subscription_index, idx);
+      cupsArrayDelete(idx->subs);
+      free(idx);
+    }
+    else
+    {
+      for (idx->mask = SERVER_EVENT_NONE, isub = (server_subscription_t *)cupsArrayFirst(idx->subs); isub; isub = (server_subscription_t *)cupsArrayNext(idx->subs))
+        idx->mask |= isub->mask;
+    }
+  }
+
+  SERVER_LOG_DEBUG("Waking waiters for deleted subscription.");
+
+  _cupsMutexLock(&NotificationMutex);
+  wake_waiters(sub);
+  cupsArrayDelete(sub->waiters);
+  sub->waiters = NULL;
+  _cupsMutexUnlock(&NotificationMutex);
 
   _cupsRWLockWrite(&sub->rwlock);
 
   ippDelete(sub->attrs);
-  cupsArrayDelete(sub->events);
+  for (i = 0; i < sub->max_events; i ++)
+    release_notify(sub->events[i].notify);
+
+  free(sub->events);
 
   _cupsRWDeinit(&sub->rwlock);
 
@@ -298,7 +504,7 @@ serverFindSubscription(
 			*sub;		/* Matching subscription */
 
 
-  serverLogClient(SERVER_LOGLEVEL_DEBUG, client, "serverFindSubscription: sub_id=%d, printer=%p(%s)", sub_id, (void *)client->printer, client->printer ? client->printer->name : "(null)");
+  SERVER_LOG_CLIENT_DEBUG(client, "serverFindSubscription: sub_id=%d, printer=%p(%s)", sub_id, (void *)client->printer, client->printer ? client->printer->name : "(null)");
 
   if (sub_id > 0)
     key.id = sub_id;
@@ -311,7 +517,7 @@ serverFindSubscription(
   sub = (server_subscription_t *)cupsArrayFind(Subscriptions, &key);
   _cupsRWUnlock(&SubscriptionsRWLock);
 
-  serverLogClient(SERVER_LOGLEVEL_DEBUG, client, "serverFindSubscription: sub=%p", (void *)sub);
+  SERVER_LOG_CLIENT_DEBUG(client, "serverFindSubscription: sub=%p", (void *)sub);
 
   return (sub);
 }
@@ -371,6 +577,116 @@ serverGetNotifySubscribedEvent(
 }
 
 
+/*
+ * 'serverWaitSubscriptionEvents()' - Wait for new events in one or more
+ *                                    subscriptions.
+ *
+ * Only events added to the listed subscriptions (or their deletion) wake the
+ * caller, so waiting clients are not woken for unrelated events.
+ */
+
+int					/* O - 1 if events are available, 0 on timeout */
+serverWaitSubscriptionEvents(
+    ipp_attribute_t *sub_ids,		/* I - notify-subscription-ids */
+    ipp_attribute_t *seq_nums,		/* I - notify-sequence-numbers, if any */
+    double          timeout)		/* I - Timeout in seconds */
+{
+  int			i,		/* Looping var */
+			count,		/* Number of subscriptions */
+			seq_num;	/* Requested sequence number */
+  server_subscription_t	key,		/* Search key */
+			*sub;		/* Current subscription */
+  server_waiter_t	waiter;		/* Waiter for this client */
+  time_t		curtime,	/* Current time */
+			endtime;	/* End time */
+
+
+  waiter.signaled = 0;
+  _cupsCondInit(&waiter.cond);
+
+  count   = ippGetCount(sub_ids);
+  endtime = time(NULL) + (time_t)timeout;
+
+ /*
+  * Register with each subscription, checking for events that were added
+  * since the caller last looked...
+  */
+
+  _cupsRWLockRead(&SubscriptionsRWLock);
+  _cupsMutexLock(&NotificationMutex);
+
+  for (i = 0; i < count; i ++)
+  {
+    key.id = ippGetInteger(sub_ids, i);
+
+    if ((sub = (server_subscription_t *)cupsArrayFind(Subscriptions, &key)) == NULL)
+      continue;
+
+    _cupsRWLockRead(&sub->rwlock);
+
+    if ((seq_num = ippGetInteger(seq_nums, i)) < sub->first_sequence)
+      seq_num = sub->first_sequence;
+
+    if (sub->pending_delete || seq_num <= sub->last_sequence)
+      waiter.signaled = 1;
+
+    _cupsRWUnlock(&sub->rwlock);
+
+    if (!sub->waiters)
+      sub->waiters = cupsArrayNew(NULL, NULL);
+
+    cupsArrayAdd(sub->waiters, &waiter);
+  }
+
+  _cupsRWUnlock(&SubscriptionsRWLock);
+
+  while (!waiter.signaled && (curtime = time(NULL)) < endtime)
+    _cupsCondWait(&waiter.cond, &NotificationMutex, (double)(endtime - curtime));
+
+  _cupsMutexUnlock(&NotificationMutex);
+
+ /*
+  * Unregister from the subscriptions that still exist...
+  */
+
+  _cupsRWLockRead(&SubscriptionsRWLock);
+  _cupsMutexLock(&NotificationMutex);
+
+  for (i = 0; i < count; i ++)
+  {
+    key.id = ippGetInteger(sub_ids, i);
+
+    if ((sub = (server_subscription_t *)cupsArrayFind(Subscriptions, &key)) != NULL)
+      cupsArrayRemove(sub->waiters, &waiter);
+  }
+
+  _cupsMutexUnlock(&NotificationMutex);
+  _cupsRWUnlock(&SubscriptionsRWLock);
+
+  return (waiter.signaled);
+}
+
+
+/*
+ * 'compare_subindex()' - Compare two subscription index entries.
+ */
+
+static int				/* O - Result of comparison */
+compare_subindex(
+    server_subindex_t *a,		/* I - First index entry */
+    server_subindex_t *b)		/* I - Second index entry */
+{
+  if (a->printer != b->printer)
+    return ((uintptr_t)a->printer < (uintptr_t)b->printer ? -1 : 1);
+  else if (a->job != b->job)
+    return ((uintptr_t)a->job < (uintptr_t)b->job ? -1 : 1);
+  else if (a->resource != b->resource)
+    return ((uintptr_t)a->resource < (uintptr_t)b->resource ? -1 : 1);
+  else
+    return (0);
+}
+
+
 /*
  * 'compare_subscriptions()' - Compare two subscriptions.
  */
@@ -382,3 +698,107 @@ compare_subscriptions(
 {
   return (b->id - a->id);
 }
+
+
+/*
+ * 'create_notify()' - Create the shared attributes for an event.
+ */
+
+static server_notify_t *		/* O - Event attributes or `NULL` on error */
+create_notify(
+    server_printer_t  *printer,		/* I - Printer, if any */
+    server_job_t      *job,		/* I - Job, if any */
+    server_resource_t *res,		/* I - Resource, if any */
+    server_event_t    event,		/* I - Event */
+    const char        *text,		/* I - notify-text value */
+    int               printer_attrs)	/* I - Include printer status attributes? */
+{
+  server_notify_t	*notify;	/* Event attributes */
+  ipp_t			*n;		/* Notify event attributes */
+
+
+  if ((notify = calloc(1, sizeof(server_notify_t))) == NULL)
+    return (NULL);
+
+  notify->refcount = 1;
+  notify->attrs    = n = ippNew();
+
+  if (printer)
+    ippAddString(n, IPP_TAG_EVENT_NOTIFICATION, IPP_TAG_URI, "notify-printer-uri", NULL, printer->default_uri);
+  else
+    ippAddString(n, IPP_TAG_EVENT_NOTIFICATION, IPP_TAG_URI, "notify-system-uri", NULL, DefaultSystemURI);
+
+  if (job)
+    ippAddInteger(n, IPP_TAG_EVENT_NOTIFICATION, IPP_TAG_INTEGER, "notify-job-id", job->id);
+  if (res)
+    ippAddInteger(n, IPP_TAG_EVENT_NOTIFICATION, IPP_TAG_INTEGER, "notify-resource-id", res->id);
+  ippAddString(n, IPP_TAG_EVENT_NOTIFICATION, IPP_TAG_KEYWORD, "notify-subscribed-event", NULL, serverGetNotifySubscribedEvent(event));
+  ippAddString(n, IPP_TAG_EVENT_NOTIFICATION, IPP_TAG_TEXT, "notify-text", NULL, text);
+  if (job && (event & SERVER_EVENT_JOB_ALL))
+  {
+    ippAddInteger(n, IPP_TAG_EVENT_NOTIFICATION, IPP_TAG_ENUM, "job-state", job->state);
+    serverCopyJobStateReasons(n, IPP_TAG_EVENT_NOTIFICATION, job);
+    if (event == SERVER_EVENT_JOB_CREATED)
+    {
+      ippAddString(n, IPP_TAG_EVENT_NOTIFICATION, IPP_TAG_NAME, "job-name", NULL, job->name);
+      ippAddString(n, IPP_TAG_EVENT_NOTIFICATION, IPP_TAG_NAME, "job-originating-user-name", NULL, job->username);
+    }
+  }
+  if (printer_attrs)
+  {
+    ippAddBoolean(n, IPP_TAG_EVENT_NOTIFICATION, "printer-is-accepting-jobs", printer->is_accepting);
+    ippAddInteger(n, IPP_TAG_EVENT_NOTIFICATION, IPP_TAG_ENUM, "printer-state", printer->state);
+    serverCopyPrinterStateReasons(n, IPP_TAG_EVENT_NOTIFICATION, printer);
+  }
+  if (printer)
+    ippAddInteger(n, IPP_TAG_EVENT_NOTIFICATION, IPP_TAG_INTEGER, "printer-up-time", (int)(time(NULL) - printer->start_time));
+  else
+    ippAddInteger(n, IPP_TAG_EVENT_NOTIFICATION, IPP_TAG_INTEGER, "system-up-time", (int)(time(NULL) - SystemStartTime));
+
+  return (notify);
+}
+
+
+/*
+ * 'release_notify()' - Release a reference to shared event attributes.
+ */
+
+static void
+release_notify(server_notify_t *notify)	/* I - Event attributes */
+{
+  int	refcount;			/* New reference count */
+
+
+  if (!notify)
+    return;
+
+  _cupsMutexLock(&notify_mutex);
+  refcount = -- notify->refcount;
+  _cupsMutexUnlock(&notify_mutex);
+
+  if (refcount == 0)
+  {
+    ippDelete(notify->attrs);
+    free(notify);
+  }
+}
+
+
+/*
+ * 'wake_waiters()' - Wake the clients waiting for events in a subscription.
+ *
+ * Note: The caller must hold NotificationMutex.
+ */
+
+static void
+wake_waiters(server_subscription_t *sub)/* I - Subscription */
+{
+  server_waiter_t	*waiter;	/* Current waiter */
+
+
+  for (waiter = (server_waiter_t *)cupsArrayFirst(sub->waiters); waiter; waiter = (server_waiter_t *)cupsArrayNext(sub->waiters))
+  {
+    waiter->signaled = 1;
+    _cupsCondBroadcast(&waiter->cond);
+  }
+}
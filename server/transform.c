@@ -9,25 +9,101 @@
  */
 
 #include "ippserver.h"
+#include <cups/dir.h>
 
 #ifdef _WIN32
 #  include <sys/timeb.h>
 #else
 #  include <signal.h>
 #  include <spawn.h>
+#  include <sys/resource.h>
 #endif /* _WIN32 */
 
 
+/*
+ * Constants...
+ */
+
+#define SERVER_RELAY_SIZE	1048576	/* Size of output relay buffer */
+
+#ifdef MSG_NOSIGNAL
+#  define SERVER_WORKER_FLAGS	MSG_NOSIGNAL
+#else
+#  define SERVER_WORKER_FLAGS	0
+#endif /* MSG_NOSIGNAL */
+
+
+#ifndef _WIN32
+/*
+ * Local types...
+ */
+
+typedef struct server_worker_s		/**** Resident transform process ****/
+{
+  char		*command;		/* Command path, NULL if slot is unused */
+  int		fd,			/* Control socket */
+		pid,			/* Process ID */
+		busy;			/* Running a job? */
+} server_worker_t;
+
+typedef struct server_relay_s		/**** Transform output relay ****/
+{
+  _cups_mutex_t	mutex;			/* Mutex for buffer */
+  _cups_cond_t	cond;			/* Condition for buffer changes */
+  _cups_thread_t thread;		/* Writer thread */
+  http_t	*http;			/* Client connection */
+  unsigned char	*buffer;		/* Ring buffer, NULL to write directly */
+  int		cache_fd,		/* Cache file or -1 */
+		cache_error;		/* Cache write error? */
+  size_t	start,			/* Start of data in buffer */
+		used,			/* Bytes in buffer */
+		total;			/* Total bytes relayed */
+  int		eof,			/* Transform output done? */
+		error;			/* Write error? */
+} server_relay_t;
+
+
+/*
+ * Local globals...
+ */
+
+static _cups_mutex_t	WorkersMutex = _CUPS_MUTEX_INITIALIZER;
+					/* Mutex for worker pool */
+static server_worker_t	*Workers = NULL;/* Worker pool */
+#endif /* !_WIN32 */
+
+
 /*
  * Local functions...
  */
 
+static void	add_job_usage(server_job_t *job, server_usage_t *usage);
 #ifdef _WIN32
 static int	asprintf(char **s, const char *format, ...);
+#else
+static int	cache_append(unsigned char **dataptr, unsigned char *dataend, const char *s);
+static int	cache_compare(cups_dentry_t *a, cups_dentry_t *b, void *data);
+static int	cache_lookup(server_job_t *job, const char *command, const char *format, const char *envdata, int envcached, char *filename, size_t filesize);
+static int	cache_message(int fd, const char *line);
+static int	cache_replay(server_client_t *client, server_job_t *job, const char *format, server_transform_t mode, const char *filename);
+static void	cache_trim(const char *filename);
 #endif /* _WIN32 */
-static void	process_attr_message(server_job_t *job, char *message, server_transform_t mode);
+static char	*copy_printer_env(server_printer_t *printer, int *envc);
+#ifndef _WIN32
+static server_worker_t *get_worker(const char *command);
+#endif /* !_WIN32 */
+static char	*make_env_attr(ipp_attribute_t *attr, char *buffer, size_t bufsize);
+static void	process_attr_messages(server_job_t *job, int num_options, cups_option_t *options, server_transform_t mode);
 static void	process_state_message(server_job_t *job, char *message);
-static double	time_seconds(void);
+#ifndef _WIN32
+static int	relay_full(server_relay_t *relay);
+static void	*relay_output(server_relay_t *relay);
+static ssize_t	relay_read(server_relay_t *relay, int fd, int block);
+static void	release_worker(server_worker_t *worker, int ok);
+static int	send_worker_job(server_worker_t *worker, const char *filename, char **envp, int infd, int outfd, int errfd);
+static void	set_limits(server_printer_t *printer, int pid);
+static int	wait_worker_job(server_worker_t *worker);
+#endif /* !_WIN32 */
 
 
 /*
@@ -42,8 +118,10 @@ serverStopJob(server_job_t *job)	/* I - Job to stop */
 
   _cupsRWLockWrite(&job->rwlock);
 
+  SERVER_SEQ_BEGIN(job->status_seq);
   job->state         = IPP_JSTATE_STOPPED;
   job->state_reasons |= SERVER_JREASON_JOB_STOPPED;
+  SERVER_SEQ_END(job->status_seq);
 
 #ifndef _WIN32 /* TODO: Figure out a way to kill a spawned process on Windows */
   if (job->transform_pid)
@@ -55,6 +133,24 @@ serverStopJob(server_job_t *job)	/* I - Job to stop */
 }
 
 
+/*
+ * 'serverStopPrinterJobs()' - Stop all processing jobs for a printer.
+ *
+ * The printer must be locked by the caller.
+ */
+
+void
+serverStopPrinterJobs(
+    server_printer_t *printer)		/* I - Printer */
+{
+  server_job_t	*job;			/* Current job */
+
+
+  for (job = (server_job_t *)cupsArrayFirst(printer->processing_jobs); job; job = (server_job_t *)cupsArrayNext(printer->processing_jobs))
+    serverStopJob(job);
+}
+
+
 /*
  * 'serverTransformJob()' - Generate printer-ready document data for a Job.
  */
@@ -72,9 +168,14 @@ serverTransformJob(
                 status = 0;		/* Exit status */
   double	start,			/* Start time */
                 end;			/* End time */
+  server_usage_t usage,			/* Resource usage of command */
+		*usagep = NULL;		/* Resource usage, if known */
   char		*myargv[3],		/* Command-line arguments */
-		*myenvp[400];		/* Environment variables */
-  int		myenvc;			/* Number of environment variables */
+		**myenvp = NULL,	/* Environment variables */
+		*envdata = NULL;	/* Cached environment strings */
+  int		myenvc = 0,		/* Number of environment variables */
+		envcached = 0,		/* Number of cached environment variables */
+		envalloc;		/* Allocated environment variables */
   ipp_attribute_t *attr;		/* Job attribute */
   char		val[1280],		/* IPP_NAME=value */
                 *valptr,		/* Pointer into string */
@@ -85,13 +186,29 @@ serverTransformJob(
 		mystderr[2] = {-1, -1};	/* Pipe for stderr */
   struct pollfd	polldata[2];		/* Poll data */
   int		pollcount,		/* Number of pipes to poll */
+		pollnfds,		/* Number of pipes polled this time */
                 pollret;                /* Return value from poll() */
-  char		data[32768],		/* Data from stdout */
-		line[2048],		/* Line from stderr */
+  char		line[2048],		/* Line from stderr */
                 *ptr,			/* Pointer into line */
                 *endptr;		/* End of line */
   ssize_t	bytes;			/* Bytes read */
-  size_t	total = 0;		/* Total bytes read */
+  int		reads,			/* Number of stderr reads this cycle */
+		num_attrs = 0;		/* Number of pending ATTR: updates */
+  cups_option_t	*attrs = NULL;		/* Pending ATTR: updates */
+  server_relay_t relay;			/* Output relay to client */
+  int		stream_in = -1;		/* Streamed document data, if any */
+  server_worker_t *worker;		/* Resident transform process, if any */
+  char		outfile[1024],		/* Output file */
+		cachefile[1024],	/* Cached output file */
+		cachetemp[1024],	/* Temporary cache file */
+		statefile[1024],	/* Cached STATE: and ATTR: messages */
+		statetemp[1024];	/* Temporary messages file */
+  int		cache_fd = -1,		/* Cache file being written */
+		state_fd = -1,		/* Messages file being written */
+		state_error = 0;	/* Messages write error? */
+#  ifdef HAVE_WAIT4
+  struct rusage	rusage;			/* Resource usage from wait4() */
+#  endif /* HAVE_WAIT4 */
 #endif /* !_WIN32 */
 
 
@@ -101,189 +218,162 @@ serverTransformJob(
     command = fullcommand;
   }
 
-  serverLogJob(SERVER_LOGLEVEL_DEBUG, job, "Running command \"%s %s\".", command, job->filename);
-  start = time_seconds();
+#ifndef _WIN32
+  if (mode == SERVER_TRANSFORM_COMMAND && job->stream_in >= 0)
+  {
+   /*
+    * Document data is streamed to the command's standard input...
+    */
+
+    stream_in      = job->stream_in;
+    job->stream_in = -1;
+  }
+#endif /* !_WIN32 */
+
+  start = serverGetTime();
 
  /*
   * Setup the command-line arguments...
   */
 
   myargv[0] = (char *)command;
+#ifndef _WIN32
+  myargv[1] = stream_in >= 0 ? "-" : job->filename;
+#else
   myargv[1] = job->filename;
+#endif /* !_WIN32 */
   myargv[2] = NULL;
 
+  SERVER_LOG_JOB_DEBUG(job, "Running command \"%s %s\".", command, myargv[1]);
+
  /*
-  * Copy the current environment, then add environment variables for every
-  * Job attribute and select Printer attributes...
+  * Start with the cached process and printer environment, then add
+  * environment variables for the document format and every Job attribute...
   */
 
-  for (myenvc = 0; environ[myenvc] && myenvc < (int)(sizeof(myenvp) / sizeof(myenvp[0]) - 1); myenvc ++)
-    myenvp[myenvc] = strdup(environ[myenvc]);
+  if ((envdata = copy_printer_env(job->printer, &envcached)) == NULL)
+  {
+    serverLogJob(SERVER_LOGLEVEL_ERROR, job, "Unable to create transform environment.");
+    goto transform_failure;
+  }
+
+  envalloc = envcached + 3;
 
-  if (myenvc > (int)(sizeof(myenvp) / sizeof(myenvp[0]) - 32))
+  for (attr = ippFirstAttribute(job->doc_attrs); attr; attr = ippNextAttribute(job->doc_attrs))
+    envalloc ++;
+  for (attr = ippFirstAttribute(job->attrs); attr; attr = ippNextAttribute(job->attrs))
+    envalloc ++;
+
+  if ((myenvp = calloc((size_t)envalloc, sizeof(char *))) == NULL)
   {
-    serverLogJob(SERVER_LOGLEVEL_ERROR, job, "Too many environment variables to transform job.");
+    serverLogJob(SERVER_LOGLEVEL_ERROR, job, "Unable to create transform environment.");
     goto transform_failure;
   }
 
-  if (asprintf(myenvp + myenvc, "CONTENT_TYPE=%s", job->format) > 0)
-    myenvc ++;
+  for (valptr = envdata; myenvc < envcached; valptr += strlen(valptr) + 1)
+    myenvp[myenvc ++] = valptr;
 
-  if (job->printer->pinfo.device_uri && asprintf(myenvp + myenvc, "DEVICE_URI=%s", job->printer->pinfo.device_uri) > 0)
+  if (asprintf(myenvp + myenvc, "CONTENT_TYPE=%s", job->format) > 0)
     myenvc ++;
 
   if (format && asprintf(myenvp + myenvc, "OUTPUT_TYPE=%s", format) > 0)
     myenvc ++;
 
-  for (attr = ippFirstAttribute(job->printer->dev_attrs); attr && myenvc < (int)(sizeof(myenvp) / sizeof(myenvp[0]) - 1); attr = ippNextAttribute(job->printer->dev_attrs))
+  for (attr = ippFirstAttribute(job->doc_attrs); attr; attr = ippNextAttribute(job->doc_attrs))
   {
    /*
-    * Convert "attribute-name-default" to "IPP_ATTRIBUTE_NAME_DEFAULT=" and
-    * "pwg-xxx" to "IPP_PWG_XXX=", then add the value(s) from the attribute.
+    * Convert "attribute-name" to "IPP_ATTRIBUTE_NAME=" and then add the
+    * value(s) from the attribute.
     */
 
-    const char	*name = ippGetName(attr),
-					/* Attribute name */
-		*suffix = strstr(name, "-default");
-					/* Suffix on attribute name */
-
-    if (strncmp(name, "pwg-", 4) && (!suffix || suffix[8]))
-      continue;
-
-    valptr = val;
-    *valptr++ = 'I';
-    *valptr++ = 'P';
-    *valptr++ = 'P';
-    *valptr++ = '_';
-    while (*name && valptr < (val + sizeof(val) - 2))
-    {
-      if (*name == '-')
-	*valptr++ = '_';
-      else
-	*valptr++ = (char)toupper(*name & 255);
-
-      name ++;
-    }
-    *valptr++ = '=';
-    ippAttributeString(attr, valptr, sizeof(val) - (size_t)(valptr - val));
-
-    myenvp[myenvc++] = strdup(val);
+    if (ippGetName(attr))
+      myenvp[myenvc++] = strdup(make_env_attr(attr, val, sizeof(val)));
   }
 
-  for (attr = ippFirstAttribute(job->printer->pinfo.attrs); attr && myenvc < (int)(sizeof(myenvp) / sizeof(myenvp[0]) - 1); attr = ippNextAttribute(job->printer->pinfo.attrs))
+  for (attr = ippFirstAttribute(job->attrs); attr; attr = ippNextAttribute(job->attrs))
   {
    /*
-    * Convert "attribute-name-default" to "IPP_ATTRIBUTE_NAME_DEFAULT=" and
-    * "pwg-xxx" to "IPP_PWG_XXX=", then add the value(s) from the attribute.
+    * Convert "attribute-name" to "IPP_ATTRIBUTE_NAME=" and then add the
+    * value(s) from the attribute.
     */
 
-    const char	*name = ippGetName(attr),
-					/* Attribute name */
-		*suffix = strstr(name, "-default");
-					/* Suffix on attribute name */
-
-    if (strncmp(name, "pwg-", 4) && (!suffix || suffix[8]))
+    const char *name = ippGetName(attr);
+    if (!name)
       continue;
 
-    if (ippFindAttribute(job->printer->dev_attrs, name, IPP_TAG_ZERO))
-      continue;				/* Skip attributes we already have */
-
-    valptr = val;
-    *valptr++ = 'I';
-    *valptr++ = 'P';
-    *valptr++ = 'P';
-    *valptr++ = '_';
-    while (*name && valptr < (val + sizeof(val) - 2))
-    {
-      if (*name == '-')
-	*valptr++ = '_';
-      else
-	*valptr++ = (char)toupper(*name & 255);
-
-      name ++;
-    }
-    *valptr++ = '=';
-    ippAttributeString(attr, valptr, sizeof(val) - (size_t)(valptr - val));
+    if (ippFindAttribute(job->doc_attrs, name, IPP_TAG_ZERO))
+      continue;
 
-    myenvp[myenvc++] = strdup(val);
+    myenvp[myenvc++] = strdup(make_env_attr(attr, val, sizeof(val)));
   }
+  myenvp[myenvc] = NULL;
 
-  if (LogLevel == SERVER_LOGLEVEL_INFO)
-    myenvp[myenvc ++] = strdup("SERVER_LOGLEVEL=info");
-  else if (LogLevel == SERVER_LOGLEVEL_DEBUG)
-    myenvp[myenvc ++] = strdup("SERVER_LOGLEVEL=debug");
-  else
-    myenvp[myenvc ++] = strdup("SERVER_LOGLEVEL=error");
+  SERVER_LOG_JOB_DEBUG(job, "Transform environment:");
+  for (i = 0; i < myenvc; i ++)
+    SERVER_LOG_JOB_DEBUG(job, "%s", myenvp[i]);
 
-  for (attr = ippFirstAttribute(job->doc_attrs); attr && myenvc < (int)(sizeof(myenvp) / sizeof(myenvp[0]) - 1); attr = ippNextAttribute(job->doc_attrs))
-  {
-   /*
-    * Convert "attribute-name" to "IPP_ATTRIBUTE_NAME=" and then add the
-    * value(s) from the attribute.
-    */
+#ifndef _WIN32
+ /*
+  * See if we already have the output for this document and these settings...
+  */
 
-    const char *name = ippGetName(attr);
-    if (!name)
-      continue;
+  cachefile[0] = '\0';
 
-    valptr = val;
-    *valptr++ = 'I';
-    *valptr++ = 'P';
-    *valptr++ = 'P';
-    *valptr++ = '_';
-    while (*name && valptr < (val + sizeof(val) - 2))
+  if (TransformCacheSize > 0 && mode != SERVER_TRANSFORM_COMMAND && stream_in < 0 && cache_lookup(job, command, format, envdata, envcached, cachefile, sizeof(cachefile)))
+  {
+    if ((status = cache_replay(client, job, format, mode, cachefile)) != 0)
     {
-      if (*name == '-')
-        *valptr++ = '_';
+      if (status > 0)
+      {
+        serverLogJob(SERVER_LOGLEVEL_INFO, job, "Using cached transform output \"%s\".", cachefile);
+        status = 0;
+      }
       else
-        *valptr++ = (char)toupper(*name & 255);
+        serverLogJob(SERVER_LOGLEVEL_ERROR, job, "Unable to send cached transform output \"%s\".", cachefile);
 
-      name ++;
-    }
-    *valptr++ = '=';
-    ippAttributeString(attr, valptr, sizeof(val) - (size_t)(valptr - val));
+      while (myenvc > envcached)
+	free(myenvp[-- myenvc]);
 
-    myenvp[myenvc++] = strdup(val);
-  }
+      free(myenvp);
+      free(envdata);
+
+      return (status);
+    }
 
-  for (attr = ippFirstAttribute(job->attrs); attr && myenvc < (int)(sizeof(myenvp) / sizeof(myenvp[0]) - 1); attr = ippNextAttribute(job->attrs))
-  {
    /*
-    * Convert "attribute-name" to "IPP_ATTRIBUTE_NAME=" and then add the
-    * value(s) from the attribute.
+    * Save the STATE: and ATTR: messages so they can be replayed with the
+    * output...
     */
 
-    const char *name = ippGetName(attr);
-    if (!name)
-      continue;
+    snprintf(statefile, sizeof(statefile), "%s-state", cachefile);
+    snprintf(statetemp, sizeof(statetemp), "%s.XXXXXX", statefile);
 
-    if (ippFindAttribute(job->doc_attrs, name, IPP_TAG_ZERO))
-      continue;
+    if ((state_fd = mkstemp(statetemp)) < 0)
+      cachefile[0] = '\0';
+    else
+      fcntl(state_fd, F_SETFD, FD_CLOEXEC);
 
-    valptr = val;
-    *valptr++ = 'I';
-    *valptr++ = 'P';
-    *valptr++ = 'P';
-    *valptr++ = '_';
-    while (*name && valptr < (val + sizeof(val) - 2))
+    if (cachefile[0] && mode == SERVER_TRANSFORM_TO_CLIENT)
     {
-      if (*name == '-')
-        *valptr++ = '_';
-      else
-        *valptr++ = (char)toupper(*name & 255);
+     /*
+      * Save a copy of the output as it is sent to the client...
+      */
 
-      name ++;
-    }
-    *valptr++ = '=';
-    ippAttributeString(attr, valptr, sizeof(val) - (size_t)(valptr - val));
+      snprintf(cachetemp, sizeof(cachetemp), "%s.XXXXXX", cachefile);
 
-    myenvp[myenvc++] = strdup(val);
-  }
-  myenvp[myenvc] = NULL;
+      if ((cache_fd = mkstemp(cachetemp)) < 0)
+      {
+	cachefile[0] = '\0';
 
-  serverLogJob(SERVER_LOGLEVEL_DEBUG, job, "Transform environment:");
-  for (i = 0; i < myenvc; i ++)
-    serverLogJob(SERVER_LOGLEVEL_DEBUG, job, "%s", myenvp[i]);
+	close(state_fd);
+	unlink(statetemp);
+	state_fd = -1;
+      }
+      else
+	fcntl(cache_fd, F_SETFD, FD_CLOEXEC);
+    }
+  }
+#endif /* !_WIN32 */
 
  /*
   * Now run the program...
@@ -300,6 +390,15 @@ serverTransformJob(
       serverLogJob(SERVER_LOGLEVEL_ERROR, job, "Unable to create pipe for stdout: %s", strerror(errno));
       goto transform_failure;
     }
+
+#  ifdef F_SETPIPE_SZ
+   /*
+    * Use a larger pipe so the transform isn't throttled by the default 64k
+    * pipe buffer (errors are ignored since this is just an optimization)...
+    */
+
+    fcntl(mystdout[1], F_SETPIPE_SZ, SERVER_RELAY_SIZE);
+#  endif /* F_SETPIPE_SZ */
   }
   else
   {
@@ -307,8 +406,8 @@ serverTransformJob(
 
     if (mode == SERVER_TRANSFORM_TO_FILE)
     {
-      serverCreateJobFilename(job, format, line, sizeof(line));
-      mystdout[1] = open(line, O_WRONLY | O_CREAT | O_TRUNC | O_EXCL | O_BINARY, 0666);
+      serverCreateJobFilename(job, format, outfile, sizeof(outfile));
+      mystdout[1] = open(outfile, O_WRONLY | O_CREAT | O_TRUNC | O_EXCL | O_BINARY, 0666);
     }
     else
       mystdout[1] = open("/dev/null", O_WRONLY | O_BINARY);
@@ -326,40 +425,63 @@ serverTransformJob(
     goto transform_failure;
   }
 
-  posix_spawn_file_actions_init(&actions);
-  posix_spawn_file_actions_addopen(&actions, 0, "/dev/null", O_RDONLY | O_BINARY, 0);
-  if (mystdout[1] < 0)
-    posix_spawn_file_actions_addopen(&actions, 1, "/dev/null", O_WRONLY | O_BINARY, 0);
-  else
-    posix_spawn_file_actions_adddup2(&actions, mystdout[1], 1);
+  if ((worker = get_worker(command)) != NULL && (pid = send_worker_job(worker, myargv[1], myenvp, stream_in, mystdout[1], mystderr[1])) < 0)
+  {
+   /*
+    * Worker is gone, run the command instead...
+    */
 
-  if (mystderr[1] < 0)
-    posix_spawn_file_actions_addopen(&actions, 2, "/dev/null", O_WRONLY | O_BINARY, 0);
-  else
-    posix_spawn_file_actions_adddup2(&actions, mystderr[1], 2);
+    release_worker(worker, 0);
+    worker = NULL;
+  }
 
-  if (posix_spawn(&pid, command, &actions, NULL, myargv, myenvp))
+  if (!worker)
   {
-    serverLogJob(SERVER_LOGLEVEL_ERROR, job, "Unable to start job processing command: %s", strerror(errno));
+    posix_spawn_file_actions_init(&actions);
+    if (stream_in < 0)
+      posix_spawn_file_actions_addopen(&actions, 0, "/dev/null", O_RDONLY | O_BINARY, 0);
+    else
+      posix_spawn_file_actions_adddup2(&actions, stream_in, 0);
+    if (mystdout[1] < 0)
+      posix_spawn_file_actions_addopen(&actions, 1, "/dev/null", O_WRONLY | O_BINARY, 0);
+    else
+      posix_spawn_file_actions_adddup2(&actions, mystdout[1], 1);
+
+    if (mystderr[1] < 0)
+      posix_spawn_file_actions_addopen(&actions, 2, "/dev/null", O_WRONLY | O_BINARY, 0);
+    else
+      posix_spawn_file_actions_adddup2(&actions, mystderr[1], 2);
+
+    if (posix_spawn(&pid, command, &actions, NULL, myargv, myenvp))
+    {
+      serverLogJob(SERVER_LOGLEVEL_ERROR, job, "Unable to start job processing command: %s", strerror(errno));
+
+      posix_spawn_file_actions_destroy(&actions);
+
+      goto transform_failure;
+    }
 
     posix_spawn_file_actions_destroy(&actions);
 
-    goto transform_failure;
+    set_limits(job->printer, pid);
   }
 
   job->transform_pid = pid;
 
-  serverLogJob(SERVER_LOGLEVEL_DEBUG, job, "Started job processing command, pid=%d", pid);
+  SERVER_TRACE2(transform__start, job->id, pid);
+
+  SERVER_LOG_JOB_DEBUG(job, "Started job processing command, pid=%d%s", pid, worker ? " (resident)" : "");
 
  /*
   * Free memory used for command...
   */
 
-  posix_spawn_file_actions_destroy(&actions);
-
-  while (myenvc > 0)
+  while (myenvc > envcached)
     free(myenvp[-- myenvc]);
 
+  free(myenvp);
+  free(envdata);
+
  /*
   * Read from the stdout and stderr pipes until EOF...
   */
@@ -367,6 +489,9 @@ serverTransformJob(
   close(mystdout[1]);
   close(mystderr[1]);
 
+  if (stream_in >= 0)
+    close(stream_in);
+
   endptr = line;
 
   pollcount = 0;
@@ -379,14 +504,59 @@ serverTransformJob(
     polldata[pollcount].fd     = mystdout[0];
     polldata[pollcount].events = POLLIN;
     pollcount ++;
+
+   /*
+    * Copy stdout to the client from a separate thread so that a slow client
+    * doesn't hold up the STATE: and ATTR: messages on stderr...
+    */
+
+    memset(&relay, 0, sizeof(relay));
+    _cupsMutexInit(&relay.mutex);
+    _cupsCondInit(&relay.cond);
+    relay.http     = client->http;
+    relay.cache_fd = cache_fd;
+
+    if ((relay.buffer = malloc(SERVER_RELAY_SIZE)) != NULL && (relay.thread = _cupsThreadCreate((_cups_thread_func_t)relay_output, &relay)) == 0)
+    {
+      free(relay.buffer);
+      relay.buffer = NULL;
+    }
+
+    if (!relay.buffer)
+      serverLogJob(SERVER_LOGLEVEL_INFO, job, "Unable to start output relay, writing directly to client.");
   }
 
-  while ((pollret = poll(polldata, (nfds_t)pollcount, -1)) > 0)
+  for (;;)
   {
+    if (pollcount > 1 && relay_full(&relay))
+    {
+     /*
+      * Only check stderr until the client catches up...
+      */
+
+      pollnfds            = 1;
+      polldata[1].revents = 0;
+    }
+    else
+      pollnfds = pollcount;
+
+    if ((pollret = poll(polldata, (nfds_t)pollnfds, pollnfds < pollcount ? 10 : -1)) < 0)
+      break;
+    else if (pollret == 0)
+      continue;
+
     if (polldata[0].revents & POLLIN)
     {
-      if ((bytes = read(mystderr[0], endptr, sizeof(line) - (size_t)(endptr - line) - 1)) > 0)
+     /*
+      * Drain the messages that are waiting on stderr so that the attribute
+      * updates from them are applied together...
+      */
+
+      for (reads = 0; reads < 16; reads ++)
       {
+	if ((bytes = read(mystderr[0], endptr, sizeof(line) - (size_t)(endptr - line) - 1)) <= 0)
+	  break;
+
 	endptr += bytes;
 	*endptr = '\0';
 
@@ -397,21 +567,39 @@ serverTransformJob(
 	  if (!strncmp(line, "STATE:", 6))
 	  {
 	   /*
-	    * Process printer-state-reasons keywords.
+	    * Process printer-state-reasons keywords, applying any earlier
+	    * attribute updates first...
 	    */
 
+	    if (num_attrs > 0)
+	    {
+	      process_attr_messages(job, num_attrs, attrs, mode);
+	      cupsFreeOptions(num_attrs, attrs);
+	      num_attrs = 0;
+	      attrs     = NULL;
+	    }
+
+	    if (state_fd >= 0 && !state_error && !cache_message(state_fd, line))
+	      state_error = 1;
+
 	    process_state_message(job, line);
 	  }
 	  else if (!strncmp(line, "ATTR:", 5))
 	  {
 	   /*
-	    * Process job/printer attribute update.
+	    * Collect job/printer attribute updates, later values replacing
+	    * earlier ones...
 	    */
 
-	    process_attr_message(job, line, mode);
+	    SERVER_LOG_JOB_DEBUG(job, "%s", line);
+
+	    if (state_fd >= 0 && !state_error && !cache_message(state_fd, line))
+	      state_error = 1;
+
+	    num_attrs = cupsParseOptions(line + 5, num_attrs, &attrs);
 	  }
 	  else
-	    serverLogJob(SERVER_LOGLEVEL_DEBUG, job, "%s: %s", command, line);
+	    SERVER_LOG_JOB_DEBUG(job, "%s: %s", command, line);
 
 	  bytes = ptr - line;
 	  if (ptr < endptr)
@@ -419,16 +607,24 @@ serverTransformJob(
 	  endptr -= bytes;
 	  *endptr = '\0';
 	}
+
+	if (poll(polldata, 1, 0) <= 0 || !(polldata[0].revents & POLLIN))
+	  break;
       }
-    }
-    else if (pollcount > 1 && polldata[1].revents & POLLIN)
-    {
-      if ((bytes = read(mystdout[0], data, sizeof(data))) > 0)
+
+      if (num_attrs > 0)
       {
-	httpWrite2(client->http, data, (size_t)bytes);
-	total += (size_t)bytes;
+	process_attr_messages(job, num_attrs, attrs, mode);
+	cupsFreeOptions(num_attrs, attrs);
+	num_attrs = 0;
+	attrs     = NULL;
       }
     }
+    else if (pollnfds > 1 && polldata[1].revents & (POLLIN | POLLHUP))
+    {
+      if (relay_read(&relay, mystdout[0], 0) == 0)
+        pollcount = 1;			/* End of output */
+    }
 
     if (polldata[0].revents & POLLHUP)
       break;
@@ -436,9 +632,26 @@ serverTransformJob(
 
   if (mystdout[0] >= 0)
   {
+   /*
+    * Copy any remaining output and wait for the client to get all of it...
+    */
+
+    while ((bytes = relay_read(&relay, mystdout[0], 1)) > 0 || (bytes < 0 && errno == EINTR));
+
+    if (relay.buffer)
+    {
+      _cupsMutexLock(&relay.mutex);
+      relay.eof = 1;
+      _cupsCondBroadcast(&relay.cond);
+      _cupsMutexUnlock(&relay.mutex);
+
+      _cupsThreadWait(relay.thread);
+      free(relay.buffer);
+    }
+
     close(mystdout[0]);
 
-    serverLogJob(SERVER_LOGLEVEL_DEBUG, job, "Total transformed output is %ld bytes.", (long)total);
+    SERVER_LOG_JOB_DEBUG(job, "Total transformed output is %ld bytes.", (long)relay.total);
   }
 
   close(mystderr[0]);
@@ -449,34 +662,105 @@ serverTransformJob(
     * Write the final output that wasn't terminated by a newline...
     */
 
-    serverLogJob(SERVER_LOGLEVEL_DEBUG, job, "%s: %s", command, line);
+    SERVER_LOG_JOB_DEBUG(job, "%s: %s", command, line);
   }
 
  /*
   * Wait for child to complete...
   */
 
-#  ifdef HAVE_WAITPID
-  while (waitpid(pid, &status, 0) < 0);
+  if (worker)
+  {
+    if ((status = wait_worker_job(worker)) < 0)
+      serverLogJob(SERVER_LOGLEVEL_ERROR, job, "Lost connection to resident transform process.");
+  }
+  else
+  {
+#  ifdef HAVE_WAIT4
+    while (wait4(pid, &status, 0, &rusage) < 0);
+
+    usage.user_time   = rusage.ru_utime.tv_sec + 0.000001 * rusage.ru_utime.tv_usec;
+    usage.system_time = rusage.ru_stime.tv_sec + 0.000001 * rusage.ru_stime.tv_usec;
+#    ifdef __APPLE__
+    usage.max_rss     = rusage.ru_maxrss / 1024;
+#    else
+    usage.max_rss     = rusage.ru_maxrss;
+#    endif /* __APPLE__ */
+    usage.in_blocks   = rusage.ru_inblock;
+    usage.out_blocks  = rusage.ru_oublock;
+    usagep            = &usage;
+
+#  elif defined(HAVE_WAITPID)
+    while (waitpid(pid, &status, 0) < 0);
 #  else
-  while (wait(&status) < 0);
-#  endif /* HAVE_WAITPID */
+    while (wait(&status) < 0);
+#  endif /* HAVE_WAIT4 */
+  }
 
   job->transform_pid = 0;
+
+  SERVER_TRACE3(transform__end, job->id, pid, status);
+
+  if (cachefile[0])
+  {
+   /*
+    * Add the messages and then the output to the cache, so that cached output
+    * always has its messages...
+    */
+
+    int ok = !status && !job->cancel && !state_error;
+					/* Add to the cache? */
+
+    close(state_fd);
+
+    if (!ok || rename(statetemp, statefile))
+    {
+      unlink(statetemp);
+      ok = 0;
+    }
+
+    if (cache_fd >= 0)
+    {
+      close(cache_fd);
+
+      if (!ok || relay.cache_error || rename(cachetemp, cachefile))
+      {
+        unlink(cachetemp);
+        ok = 0;
+      }
+    }
+    else if (ok && link(outfile, cachefile))
+      ok = 0;
+
+    if (ok)
+      cache_trim(cachefile);
+    else
+      unlink(statefile);
+  }
 #endif /* _WIN32 */
 
-  end = time_seconds();
-  serverLogJob(SERVER_LOGLEVEL_DEBUG, job, "Total transform time is %.3f seconds.", end - start);
+  end = serverGetTime();
+  serverMetricsTransform(end - start, usagep);
+  SERVER_LOG_JOB_DEBUG(job, "Total transform time is %.3f seconds.", end - start);
+
+  if (usagep)
+  {
+    SERVER_LOG_JOB_DEBUG(job, "Transform used %.3f user and %.3f system CPU seconds, %ld kilobytes of memory, %ld input blocks, and %ld output blocks.", usage.user_time, usage.system_time, usage.max_rss, usage.in_blocks, usage.out_blocks);
+
+    add_job_usage(job, usagep);
+  }
 
 #ifdef _WIN32
   if (status)
     serverLogJob(SERVER_LOGLEVEL_ERROR, job, "Transform command exited with status %d.", status);
 
 #else
-  if (status)
+  if (status > 0)
   {
     if (WIFEXITED(status))
       serverLogJob(SERVER_LOGLEVEL_ERROR, job, "Transform command exited with status %d.", WEXITSTATUS(status));
+    else if (WIFSIGNALED(status) && WTERMSIG(status) == SIGXCPU)
+      serverLogJob(SERVER_LOGLEVEL_ERROR, job, "Transform command exceeded the CPU time limit.");
     else if (WIFSIGNALED(status) && WTERMSIG(status) != SIGTERM)
       serverLogJob(SERVER_LOGLEVEL_ERROR, job, "Transform command crashed on signal %d.", WTERMSIG(status));
   }
@@ -500,15 +784,79 @@ serverTransformJob(
     close(mystderr[0]);
   if (mystderr[1] >= 0)
     close(mystderr[1]);
+
+  if (stream_in >= 0)
+    close(stream_in);
+
+  if (cache_fd >= 0)
+  {
+    close(cache_fd);
+    unlink(cachetemp);
+  }
+
+  if (state_fd >= 0)
+  {
+    close(state_fd);
+    unlink(statetemp);
+  }
 #endif /* !_WIN32 */
 
-  while (myenvc > 0)
+  while (myenvc > envcached)
     free(myenvp[-- myenvc]);
 
+  free(myenvp);
+  free(envdata);
+
   return (-1);
 }
 
 
+/*
+ * 'add_job_usage()' - Add the resource usage of a transform to a job.
+ *
+ * The CPU times and block counts are totals for all of the transforms run for
+ * the job, while the memory value is the largest seen.
+ */
+
+static void
+add_job_usage(server_job_t   *job,	/* I - Job */
+              server_usage_t *usage)	/* I - Resource usage */
+{
+  int			i;		/* Looping var */
+  ipp_attribute_t	*attr;		/* Usage attribute */
+  static const char * const names[] =	/* Usage attributes */
+  {
+    "ippserver-transform-user-time",
+    "ippserver-transform-system-time",
+    "ippserver-transform-max-rss",
+    "ippserver-transform-input-blocks",
+    "ippserver-transform-output-blocks"
+  };
+  int			values[5];	/* Usage values */
+
+
+  values[0] = (int)(1000.0 * usage->user_time);
+  values[1] = (int)(1000.0 * usage->system_time);
+  values[2] = (int)usage->max_rss;
+  values[3] = (int)usage->in_blocks;
+  values[4] = (int)usage->out_blocks;
+
+  _cupsRWLockWrite(&job->rwlock);
+
+  for (i = 0; i < 5; i ++)
+  {
+    if ((attr = ippFindAttribute(job->attrs, names[i], IPP_TAG_INTEGER)) == NULL)
+      ippAddInteger(job->attrs, IPP_TAG_JOB, IPP_TAG_INTEGER, names[i], values[i]);
+    else if (i != 2)
+      ippSetInteger(job->attrs, &attr, 0, ippGetInteger(attr, 0) + values[i]);
+    else if (values[i] > ippGetInteger(attr, 0))
+      ippSetInteger(job->attrs, &attr, 0, values[i]);
+  }
+
+  _cupsRWUnlock(&job->rwlock);
+}
+
+
 #ifdef _WIN32
 /*
  * 'asprintf()' - Format and allocate a string.
@@ -537,41 +885,697 @@ asprintf(char       **s,		/* O - Allocated string or `NULL` on error */
 }
 #endif /* _WIN32 */
 
-
+#ifndef _WIN32
 /*
- * 'process_attr_message()' - Process an ATTR: message from a command.
+ * 'cache_append()' - Append a nul-terminated string to the data to hash.
  */
 
-static void
-process_attr_message(
-    server_job_t       *job,		/* I - Job */
-    char               *message,	/* I - Message */
-    server_transform_t mode)		/* I - Transform mode */
+static int				/* O - 1 on success, 0 if there is no room */
+cache_append(unsigned char **dataptr,	/* IO - Pointer into data */
+             unsigned char *dataend,	/* I  - End of data */
+             const char    *s)		/* I  - String */
 {
+  size_t	len = strlen(s) + 1;	/* Length of string */
+
+
+  if (len > (size_t)(dataend - *dataptr))
+    return (0);
+
+  memcpy(*dataptr, s, len);
+  *dataptr += len;
+
+  return (1);
+}
+
+
+/*
+ * 'cache_compare()' - Compare two cache files by the time they were last used.
+ */
+
+static int				/* O - Result of comparison */
+cache_compare(cups_dentry_t *a,		/* I - First file */
+              cups_dentry_t *b,		/* I - Second file */
+              void          *data)	/* I - Callback data (unused) */
+{
+  (void)data;
+
+  if (a->fileinfo.st_mtime < b->fileinfo.st_mtime)
+    return (-1);
+  else if (a->fileinfo.st_mtime > b->fileinfo.st_mtime)
+    return (1);
+  else
+    return (strcmp(a->filename, b->filename));
+}
+
+
+/*
+ * 'cache_lookup()' - Get the cache filename for a transform.
+ *
+ * The filename is the SHA2-256 hash of the document data, the transform
+ * command, the input and output formats, the printer's "IPP_xxx" environment
+ * strings, and the job template attributes of the job.  The file may or may not
+ * exist.
+ */
+
+static int				/* O - 1 on success, 0 on error */
+cache_lookup(
+    server_job_t *job,			/* I - Job */
+    const char   *command,		/* I - Transform command */
+    const char   *format,		/* I - Output format */
+    const char   *envdata,		/* I - Cached printer environment */
+    int          envcached,		/* I - Number of printer environment strings */
+    char         *filename,		/* I - Filename buffer */
+    size_t       filesize)		/* I - Size of filename buffer */
+{
+  int		fd;			/* Document file */
+  unsigned char	*data,			/* Data to hash */
+		*dataptr,		/* Pointer into data */
+		*dataend,		/* End of data */
+		hash[32];		/* SHA2-256 hash */
+  ssize_t	bytes;			/* Bytes read */
+  ipp_attribute_t *supported,		/* job-creation-attributes-supported */
+		*attr;			/* Job attribute */
+  const char	*name;			/* Attribute name */
+  char		val[1280],		/* IPP_NAME=value */
+		key[65];		/* Hex hash string */
   int		i,			/* Looping var */
-		num_options = 0;	/* Number of name=value pairs */
-  cups_option_t	*options = NULL,	/* name=value pairs from message */
-		*option;		/* Current option */
-  ipp_attribute_t *attr;		/* Current attribute */
+		ok;			/* Do the settings fit? */
+
+
+  if ((supported = ippFindAttribute(job->printer->pinfo.attrs, "job-creation-attributes-supported", IPP_TAG_KEYWORD)) == NULL && (supported = ippFindAttribute(job->printer->dev_attrs, "job-creation-attributes-supported", IPP_TAG_KEYWORD)) == NULL)
+    return (0);				/* Don't know which attributes matter */
+
+  if (!job->filename || (data = malloc(sizeof(hash) + SERVER_RELAY_SIZE)) == NULL)
+    return (0);
+
+  if ((fd = open(job->filename, O_RDONLY | O_BINARY)) < 0)
+  {
+    free(data);
+    return (0);
+  }
+
+ /*
+  * Hash the document as a chain of blocks, each hash covering the previous
+  * hash and the next block of data...
+  */
+
+  memset(hash, 0, sizeof(hash));
+
+  while ((bytes = read(fd, data + sizeof(hash), SERVER_RELAY_SIZE)) > 0)
+  {
+    memcpy(data, hash, sizeof(hash));
+    cupsHashData("sha2-256", data, sizeof(hash) + (size_t)bytes, hash, sizeof(hash));
+  }
+
+  close(fd);
+
+  if (bytes < 0)
+  {
+    free(data);
+    return (0);
+  }
+
+ /*
+  * Then add the settings that affect the output...
+  */
+
+  memcpy(data, hash, sizeof(hash));
+  dataptr = data + sizeof(hash);
+  dataend = data + sizeof(hash) + SERVER_RELAY_SIZE;
+
+  ok = cache_append(&dataptr, dataend, command) && cache_append(&dataptr, dataend, job->format) && cache_append(&dataptr, dataend, format ? format : "");
+
+  for (i = 0; ok && i < envcached; i ++, envdata += strlen(envdata) + 1)
+  {
+    if (!strncmp(envdata, "IPP_", 4))	/* Skip process environment */
+      ok = cache_append(&dataptr, dataend, envdata);
+  }
+
+  for (attr = ippFirstAttribute(job->attrs); ok && attr; attr = ippNextAttribute(job->attrs))
+  {
+    if ((name = ippGetName(attr)) != NULL && ippContainsString(supported, name))
+      ok = cache_append(&dataptr, dataend, make_env_attr(attr, val, sizeof(val)));
+  }
+
+  for (attr = ippFirstAttribute(job->doc_attrs); ok && attr; attr = ippNextAttribute(job->doc_attrs))
+  {
+    if ((name = ippGetName(attr)) != NULL && ippContainsString(supported, name))
+      ok = cache_append(&dataptr, dataend, make_env_attr(attr, val, sizeof(val)));
+  }
+
+  if (!ok)
+  {
+   /*
+    * Settings don't fit, don't cache...
+    */
+
+    free(data);
+    return (0);
+  }
+
+  cupsHashData("sha2-256", data, (size_t)(dataptr - data), hash, sizeof(hash));
+  free(data);
+
+ /*
+  * Make sure the cache directory exists...
+  */
+
+  snprintf(filename, filesize, "%s/cache", SpoolDirectory);
+
+  if (mkdir(filename, 0700) && errno != EEXIST)
+  {
+    serverLogJob(SERVER_LOGLEVEL_ERROR, job, "Unable to create transform cache directory \"%s\": %s", filename, strerror(errno));
+    return (0);
+  }
+
+  snprintf(filename, filesize, "%s/cache/%s", SpoolDirectory, cupsHashString(hash, sizeof(hash), key, sizeof(key)));
+
+  return (1);
+}
+
+
+/*
+ * 'cache_message()' - Save a STATE: or ATTR: message for the cache.
+ */
+
+static int				/* O - 1 on success, 0 on error */
+cache_message(int        fd,		/* I - Messages file */
+              const char *line)		/* I - Message line */
+{
+  size_t	len = strlen(line);	/* Length of line */
+
+
+  return (write(fd, line, len) == (ssize_t)len && write(fd, "\n", 1) == 1);
+}
+
+
+/*
+ * 'cache_replay()' - Send cached transform output.
+ *
+ * The STATE: and ATTR: messages from the transform are applied to the job
+ * before the output is sent.
+ */
+
+static int				/* O - 1 if cached output was sent, 0 if not cached, -1 on error */
+cache_replay(
+    server_client_t    *client,		/* I - Client connection (if any) */
+    server_job_t       *job,		/* I - Job */
+    const char         *format,		/* I - Output format */
+    server_transform_t mode,		/* I - Transform mode */
+    const char         *filename)	/* I - Cache file */
+{
+  int		fd,			/* Cache file */
+		outfd = -1;		/* Output file */
+  cups_file_t	*fp;			/* Messages file */
+  char		outfile[1024],		/* Output filename */
+		statefile[1024],	/* Messages filename */
+		buffer[32768];		/* Copy buffer */
+  ssize_t	bytes;			/* Bytes read */
+  int		num_attrs = 0;		/* Number of pending ATTR: updates */
+  cups_option_t	*attrs = NULL;		/* Pending ATTR: updates */
+
+
+  snprintf(statefile, sizeof(statefile), "%s-state", filename);
+
+  if ((fd = open(filename, O_RDONLY | O_BINARY)) < 0)
+    return (0);
+
+  if ((fp = cupsFileOpen(statefile, "r")) == NULL)
+  {
+    close(fd);
+    return (0);
+  }
+
+  if (mode == SERVER_TRANSFORM_TO_FILE)
+  {
+    serverCreateJobFilename(job, format, outfile, sizeof(outfile));
+
+    if ((outfd = open(outfile, O_WRONLY | O_CREAT | O_TRUNC | O_EXCL | O_BINARY, 0666)) < 0)
+    {
+      cupsFileClose(fp);
+      close(fd);
+      return (0);
+    }
+  }
+
+ /*
+  * Apply the messages, the same way as when the transform was run...
+  */
+
+  while (cupsFileGets(fp, buffer, sizeof(buffer)))
+  {
+    if (!strncmp(buffer, "STATE:", 6))
+    {
+      if (num_attrs > 0)
+      {
+	process_attr_messages(job, num_attrs, attrs, mode);
+	cupsFreeOptions(num_attrs, attrs);
+	num_attrs = 0;
+	attrs     = NULL;
+      }
+
+      process_state_message(job, buffer);
+    }
+    else if (!strncmp(buffer, "ATTR:", 5))
+      num_attrs = cupsParseOptions(buffer + 5, num_attrs, &attrs);
+  }
+
+  cupsFileClose(fp);
+
+  if (num_attrs > 0)
+  {
+    process_attr_messages(job, num_attrs, attrs, mode);
+    cupsFreeOptions(num_attrs, attrs);
+  }
+
+ /*
+  * Then send the output...
+  */
+
+  while ((bytes = read(fd, buffer, sizeof(buffer))) > 0)
+  {
+    if (outfd >= 0)
+    {
+      if (write(outfd, buffer, (size_t)bytes) != bytes)
+        break;
+    }
+    else if (httpWrite2(client->http, buffer, (size_t)bytes) < 0)
+      break;
+  }
+
+  close(fd);
+
+  if (outfd >= 0 && close(outfd))
+    bytes = -1;
+
+  if (bytes != 0)
+    return (-1);
+
+ /*
+  * Update the modification time, which tracks when the file was last used...
+  */
+
+  utimes(filename, NULL);
+
+  return (1);
+}
+
+
+/*
+ * 'cache_trim()' - Remove the least recently used files from the cache.
+ */
+
+static void
+cache_trim(const char *filename)	/* I - File that was added */
+{
+  char		directory[1024],	/* Cache directory */
+		*ptr,			/* Pointer into directory */
+		path[1024];		/* Path of file to remove */
+  cups_dir_t	*dir;			/* Directory */
+  cups_dentry_t	*dent;			/* Directory entry */
+  cups_array_t	*files;			/* Cache files, oldest first */
+  off_t		total = 0;		/* Total size of cache */
+  static _cups_mutex_t mutex = _CUPS_MUTEX_INITIALIZER;
+					/* Mutex for trimming */
+
+
+  strlcpy(directory, filename, sizeof(directory));
+  if ((ptr = strrchr(directory, '/')) != NULL)
+    *ptr = '\0';
+
+  _cupsMutexLock(&mutex);
+
+  if ((dir = cupsDirOpen(directory)) == NULL)
+  {
+    _cupsMutexUnlock(&mutex);
+    return;
+  }
+
+  files = cupsArrayNew3((cups_array_func_t)cache_compare, NULL, NULL, 0, NULL, (cups_afree_func_t)free);
+
+  while ((dent = cupsDirRead(dir)) != NULL)
+  {
+    cups_dentry_t *copy;		/* Copy of entry */
+
+    if (strchr(dent->filename, '.') || strchr(dent->filename, '-') || !S_ISREG(dent->fileinfo.st_mode))
+      continue;				/* Skip temporary and messages files */
+
+    if ((copy = malloc(sizeof(cups_dentry_t))) != NULL)
+    {
+      memcpy(copy, dent, sizeof(cups_dentry_t));
+      cupsArrayAdd(files, copy);
+      total += copy->fileinfo.st_size;
+    }
+  }
+
+  cupsDirClose(dir);
+
+  for (dent = (cups_dentry_t *)cupsArrayFirst(files); dent && total > TransformCacheSize; dent = (cups_dentry_t *)cupsArrayNext(files))
+  {
+    snprintf(path, sizeof(path), "%s/%s", directory, dent->filename);
+
+    if (!unlink(path))
+    {
+      SERVER_LOG_DEBUG("Removed transform cache file \"%s\".", path);
+      total -= dent->fileinfo.st_size;
+
+      strlcat(path, "-state", sizeof(path));
+      unlink(path);
+    }
+  }
+
+  cupsArrayDelete(files);
+
+  _cupsMutexUnlock(&mutex);
+}
+#endif /* !_WIN32 */
+
+
+/*
+ * 'copy_printer_env()' - Copy the cached environment for a printer.
+ *
+ * The environment starts with the process environment, followed by the device
+ * URI, printer and device "pwg-xxx" and "xxx-default" attributes, the transform
+ * cache settings, and the log level.  The strings are built the first time they are needed and remain
+ * cached until the printer attributes change.
+ */
+
+static char *				/* O - Environment strings or `NULL` on error */
+copy_printer_env(
+    server_printer_t *printer,		/* I - Printer */
+    int              *envc)		/* O - Number of environment strings */
+{
+  char		*data = NULL;		/* Copy of environment strings */
+
+
+  _cupsMutexLock(&printer->cache_mutex);
+
+  if (!printer->transform_env)
+  {
+    int			i;		/* Looping var */
+    cups_array_t	*env;		/* Environment strings */
+    ipp_attribute_t	*attr;		/* Printer attribute */
+    char		val[1280],	/* IPP_NAME=value */
+			*envptr,	/* Pointer into environment string */
+			*envend;	/* End of environment strings */
+    size_t		envlen;		/* Length of environment strings */
+
+    env = cupsArrayNew3(NULL, NULL, NULL, 0, (cups_acopy_func_t)strdup, (cups_afree_func_t)free);
+
+    for (i = 0; environ[i]; i ++)
+      cupsArrayAdd(env, environ[i]);
+
+    if (printer->pinfo.device_uri)
+    {
+      snprintf(val, sizeof(val), "DEVICE_URI=%s", printer->pinfo.device_uri);
+      cupsArrayAdd(env, val);
+    }
+
+    for (attr = ippFirstAttribute(printer->dev_attrs); attr; attr = ippNextAttribute(printer->dev_attrs))
+    {
+     /*
+      * Convert "attribute-name-default" to "IPP_ATTRIBUTE_NAME_DEFAULT=" and
+      * "pwg-xxx" to "IPP_PWG_XXX=", then add the value(s) from the attribute.
+      */
+
+      const char	*name = ippGetName(attr),
+					/* Attribute name */
+			*suffix = strstr(name, "-default");
+					/* Suffix on attribute name */
+
+      if (strncmp(name, "pwg-", 4) && (!suffix || suffix[8]))
+	continue;
+
+      cupsArrayAdd(env, make_env_attr(attr, val, sizeof(val)));
+    }
+
+    for (attr = ippFirstAttribute(printer->pinfo.attrs); attr; attr = ippNextAttribute(printer->pinfo.attrs))
+    {
+     /*
+      * Convert "attribute-name-default" to "IPP_ATTRIBUTE_NAME_DEFAULT=" and
+      * "pwg-xxx" to "IPP_PWG_XXX=", then add the value(s) from the attribute.
+      */
+
+      const char	*name = ippGetName(attr),
+					/* Attribute name */
+			*suffix = strstr(name, "-default");
+					/* Suffix on attribute name */
+
+      if (strncmp(name, "pwg-", 4) && (!suffix || suffix[8]))
+	continue;
+
+      if (ippFindAttribute(printer->dev_attrs, name, IPP_TAG_ZERO))
+	continue;			/* Skip attributes we already have */
+
+      cupsArrayAdd(env, make_env_attr(attr, val, sizeof(val)));
+    }
+
+    if (TransformCacheSize > 0)
+    {
+     /*
+      * Let commands share the transform cache...
+      */
+
+      snprintf(val, sizeof(val), "SERVER_CACHEDIR=%s/cache", SpoolDirectory);
+      cupsArrayAdd(env, val);
+
+      snprintf(val, sizeof(val), "SERVER_CACHESIZE=%lld", (long long)TransformCacheSize);
+      cupsArrayAdd(env, val);
+    }
+
+    if (LogLevel == SERVER_LOGLEVEL_INFO)
+      cupsArrayAdd(env, "SERVER_LOGLEVEL=info");
+    else if (LogLevel == SERVER_LOGLEVEL_DEBUG)
+      cupsArrayAdd(env, "SERVER_LOGLEVEL=debug");
+    else
+      cupsArrayAdd(env, "SERVER_LOGLEVEL=error");
+
+   /*
+    * Save the strings as a single block...
+    */
+
+    for (envlen = 0, envptr = (char *)cupsArrayFirst(env); envptr; envptr = (char *)cupsArrayNext(env))
+      envlen += strlen(envptr) + 1;
+
+    if ((printer->transform_env = malloc(envlen)) != NULL)
+    {
+      size_t	len;			/* Length of string */
+
+      for (envptr = (char *)cupsArrayFirst(env), envend = printer->transform_env; envptr; envptr = (char *)cupsArrayNext(env), envend += len)
+      {
+        len = strlen(envptr) + 1;
+	memcpy(envend, envptr, len);
+      }
+
+      printer->transform_envlen = envlen;
+      printer->transform_envc   = cupsArrayCount(env);
+    }
+
+    cupsArrayDelete(env);
+  }
+
+  if (printer->transform_env && (data = malloc(printer->transform_envlen)) != NULL)
+  {
+    memcpy(data, printer->transform_env, printer->transform_envlen);
+    *envc = printer->transform_envc;
+  }
+
+  _cupsMutexUnlock(&printer->cache_mutex);
+
+  return (data);
+}
+
+
+#ifndef _WIN32
+/*
+ * 'get_worker()' - Get an idle resident transform process for a command.
+ *
+ * Only ipptransform supports running as a resident process.  A new process is
+ * started when there is no idle process for the command and the pool has room
+ * for it.  `NULL` is returned when the command should be run normally.
+ */
+
+static server_worker_t *		/* O - Worker or `NULL` */
+get_worker(const char *command)		/* I - Command to run */
+{
+  int		i;			/* Looping var */
+  server_worker_t *worker,		/* Current worker */
+		*unused = NULL;		/* Unused worker slot */
+  const char	*base;			/* Base name of command */
+  int		sv[2];			/* Control socket pair */
+  int		pid;			/* Process ID */
+  char		*myargv[3];		/* Command-line arguments */
+  posix_spawn_file_actions_t actions;	/* Spawn file actions */
+
+
+  if (TransformWorkers <= 0)
+    return (NULL);
+
+  if ((base = strrchr(command, '/')) != NULL)
+    base ++;
+  else
+    base = command;
+
+  if (strcmp(base, "ipptransform"))
+    return (NULL);
+
+  _cupsMutexLock(&WorkersMutex);
 
+  if (!Workers && (Workers = calloc((size_t)TransformWorkers, sizeof(server_worker_t))) == NULL)
+  {
+    _cupsMutexUnlock(&WorkersMutex);
+    return (NULL);
+  }
+
+  for (i = TransformWorkers, worker = Workers; i > 0; i --, worker ++)
+  {
+    if (!worker->command)
+    {
+      if (!unused)
+        unused = worker;
+    }
+    else if (!worker->busy && !strcmp(worker->command, command))
+    {
+      worker->busy = 1;
+
+      _cupsMutexUnlock(&WorkersMutex);
+      return (worker);
+    }
+  }
+
+  if (!unused)
+  {
+   /*
+    * All workers are busy...
+    */
+
+    _cupsMutexUnlock(&WorkersMutex);
+    return (NULL);
+  }
 
  /*
-  * Grab attributes from the message line...
+  * Start a new worker with the control socket on its stdin...
   */
 
-  serverLogJob(SERVER_LOGLEVEL_DEBUG, job, "%s", message);
+  if (socketpair(AF_UNIX, SOCK_STREAM, 0, sv))
+  {
+    serverLog(SERVER_LOGLEVEL_ERROR, "Unable to create transform worker socket: %s", strerror(errno));
+    _cupsMutexUnlock(&WorkersMutex);
+    return (NULL);
+  }
+
+  fcntl(sv[0], F_SETFD, FD_CLOEXEC);
+#  ifdef SO_NOSIGPIPE
+  i = 1;
+  setsockopt(sv[0], SOL_SOCKET, SO_NOSIGPIPE, &i, sizeof(i));
+#  endif /* SO_NOSIGPIPE */
+
+  myargv[0] = (char *)command;
+  myargv[1] = "--worker";
+  myargv[2] = NULL;
+
+  posix_spawn_file_actions_init(&actions);
+  posix_spawn_file_actions_adddup2(&actions, sv[1], 0);
+  posix_spawn_file_actions_addopen(&actions, 1, "/dev/null", O_WRONLY | O_BINARY, 0);
+
+  if (posix_spawn(&pid, command, &actions, NULL, myargv, environ))
+  {
+    serverLog(SERVER_LOGLEVEL_ERROR, "Unable to start transform worker \"%s\": %s", command, strerror(errno));
+
+    posix_spawn_file_actions_destroy(&actions);
+    close(sv[0]);
+    close(sv[1]);
+
+    _cupsMutexUnlock(&WorkersMutex);
+    return (NULL);
+  }
+
+  posix_spawn_file_actions_destroy(&actions);
+  close(sv[1]);
+
+  serverLog(SERVER_LOGLEVEL_INFO, "Started transform worker \"%s\", pid=%d", command, pid);
+
+  unused->command = strdup(command);
+  unused->fd      = sv[0];
+  unused->pid     = pid;
+  unused->busy    = 1;
+
+  _cupsMutexUnlock(&WorkersMutex);
+
+  return (unused);
+}
+#endif /* !_WIN32 */
+
+
+/*
+ * 'make_env_attr()' - Make an "IPP_NAME=value" environment string.
+ */
+
+static char *				/* O - Environment string */
+make_env_attr(ipp_attribute_t *attr,	/* I - Attribute */
+              char            *buffer,	/* I - String buffer */
+              size_t          bufsize)	/* I - Size of string buffer */
+{
+  const char	*name = ippGetName(attr);
+					/* Attribute name */
+  char		*bufptr = buffer,	/* Pointer into buffer */
+		*bufend = buffer + bufsize - 2;
+					/* End of buffer */
+
+
+  *bufptr++ = 'I';
+  *bufptr++ = 'P';
+  *bufptr++ = 'P';
+  *bufptr++ = '_';
+  while (*name && bufptr < bufend)
+  {
+    if (*name == '-')
+      *bufptr++ = '_';
+    else
+      *bufptr++ = (char)toupper(*name & 255);
+
+    name ++;
+  }
+  *bufptr++ = '=';
+  ippAttributeString(attr, bufptr, bufsize - (size_t)(bufptr - buffer));
+
+  return (buffer);
+}
+
 
-  num_options = cupsParseOptions(message + 5, num_options, &options);
 
-  serverLogJob(SERVER_LOGLEVEL_DEBUG, job, "num_options=%d", num_options);
+/*
+ * 'process_attr_messages()' - Apply the updates from ATTR: messages.
+ *
+ * The messages read in one poll cycle are merged into a single array of
+ * name=value pairs so that the job and printer objects are each locked once
+ * and at most one event of each kind is generated.
+ */
+
+static void
+process_attr_messages(
+    server_job_t       *job,		/* I - Job */
+    int                num_options,	/* I - Number of name=value pairs */
+    cups_option_t      *options,	/* I - name=value pairs from messages */
+    server_transform_t mode)		/* I - Transform mode */
+{
+  int		i;			/* Looping var */
+  cups_option_t	*option;		/* Current option */
+  ipp_attribute_t *attr;		/* Current attribute */
+  int		job_locked = 0,		/* Is the job locked? */
+		progress = 0;		/* Did the job make progress? */
+  server_printer_t *printer = NULL;	/* Locked printer, if any */
+
+
+  SERVER_LOG_JOB_DEBUG(job, "num_options=%d", num_options);
 
  /*
-  * Loop through the options and record them in the printer or job objects...
+  * Loop through the options and record them in the job object...
   */
 
   for (i = num_options, option = options; i > 0; i --, option ++)
   {
-    serverLogJob(SERVER_LOGLEVEL_DEBUG, job, "options[%d].name=\"%s\", .value=\"%s\"", num_options - i, option->name, option->value);
+    SERVER_LOG_JOB_DEBUG(job, "options[%d].name=\"%s\", .value=\"%s\"", num_options - i, option->name, option->value);
 
     if (!strcmp(option->name, "job-impressions"))
     {
@@ -579,13 +1583,15 @@ process_attr_message(
       * Update job-impressions attribute...
       */
 
-      serverLogJob(SERVER_LOGLEVEL_DEBUG, job, "Setting Job Status attribute \"%s\" to \"%s\".", option->name, option->value);
+      SERVER_LOG_JOB_DEBUG(job, "Setting Job Status attribute \"%s\" to \"%s\".", option->name, option->value);
 
-      _cupsRWLockWrite(&job->rwlock);
+      if (!job_locked)
+      {
+        _cupsRWLockWrite(&job->rwlock);
+        job_locked = 1;
+      }
 
       job->impressions = atoi(option->value);
-
-      _cupsRWUnlock(&job->rwlock);
     }
     else if (mode == SERVER_TRANSFORM_COMMAND && !strcmp(option->name, "job-impressions-completed"))
     {
@@ -593,13 +1599,19 @@ process_attr_message(
       * Update job-impressions-completed attribute...
       */
 
-      serverLogJob(SERVER_LOGLEVEL_DEBUG, job, "Setting Job Status attribute \"%s\" to \"%s\".", option->name, option->value);
+      SERVER_LOG_JOB_DEBUG(job, "Setting Job Status attribute \"%s\" to \"%s\".", option->name, option->value);
 
-      _cupsRWLockWrite(&job->rwlock);
+      if (!job_locked)
+      {
+        _cupsRWLockWrite(&job->rwlock);
+        job_locked = 1;
+      }
 
+      SERVER_SEQ_BEGIN(job->status_seq);
       job->impcompleted = atoi(option->value);
+      SERVER_SEQ_END(job->status_seq);
 
-      _cupsRWUnlock(&job->rwlock);
+      progress = 1;
     }
     else if (!strcmp(option->name, "job-impressions-col") || !strcmp(option->name, "job-media-sheets") || !strcmp(option->name, "job-media-sheets-col") ||
         (mode == SERVER_TRANSFORM_COMMAND && (!strcmp(option->name, "job-impressions-completed-col") || !strcmp(option->name, "job-media-sheets-completed") || !strcmp(option->name, "job-media-sheets-completed-col"))))
@@ -608,45 +1620,72 @@ process_attr_message(
       * Update Job Status attribute...
       */
 
-      serverLogJob(SERVER_LOGLEVEL_DEBUG, job, "Setting Job Status attribute \"%s\" to \"%s\".", option->name, option->value);
+      SERVER_LOG_JOB_DEBUG(job, "Setting Job Status attribute \"%s\" to \"%s\".", option->name, option->value);
 
-      _cupsRWLockWrite(&job->rwlock);
+      if (!job_locked)
+      {
+        _cupsRWLockWrite(&job->rwlock);
+        job_locked = 1;
+      }
 
       if ((attr = ippFindAttribute(job->attrs, option->name, IPP_TAG_ZERO)) != NULL)
         ippDeleteAttribute(job->attrs, attr);
 
       cupsEncodeOption(job->attrs, IPP_TAG_JOB, option->name, option->value);
 
-      _cupsRWUnlock(&job->rwlock);
+      if (strstr(option->name, "-completed"))
+        progress = 1;
     }
-    else if (!strncmp(option->name, "marker-", 7) || !strcmp(option->name, "printer-alert") || !strcmp(option->name, "printer-supply") || !strcmp(option->name, "printer-supply-description"))
+  }
+
+  if (job_locked)
+    _cupsRWUnlock(&job->rwlock);
+
+ /*
+  * Then record the printer attributes...
+  */
+
+  for (i = num_options, option = options; i > 0; i --, option ++)
+  {
+    if (!strncmp(option->name, "marker-", 7) || !strcmp(option->name, "printer-alert") || !strcmp(option->name, "printer-supply") || !strcmp(option->name, "printer-supply-description"))
     {
      /*
       * Update Printer Status attribute...
       */
 
-      serverLogPrinter(SERVER_LOGLEVEL_DEBUG, job->printer, "Setting Printer Status attribute \"%s\" to \"%s\".", option->name, option->value);
-
-      _cupsRWLockWrite(&job->printer->rwlock);
+      SERVER_LOG_PRINTER_DEBUG(job->printer, "Setting Printer Status attribute \"%s\" to \"%s\".", option->name, option->value);
 
-      if ((attr = ippFindAttribute(job->printer->pinfo.attrs, option->name, IPP_TAG_ZERO)) != NULL)
-        ippDeleteAttribute(job->printer->pinfo.attrs, attr);
+      if (!printer)
+      {
+        printer = job->printer;
+        _cupsRWLockWrite(&printer->rwlock);
+      }
 
-      cupsEncodeOption(job->printer->pinfo.attrs, IPP_TAG_PRINTER, option->name, option->value);
+      if ((attr = ippFindAttribute(printer->pinfo.attrs, option->name, IPP_TAG_ZERO)) != NULL)
+        ippDeleteAttribute(printer->pinfo.attrs, attr);
 
-      _cupsRWUnlock(&job->printer->rwlock);
+      cupsEncodeOption(printer->pinfo.attrs, IPP_TAG_PRINTER, option->name, option->value);
     }
-    else
+    else if (strncmp(option->name, "job-", 4))
     {
      /*
       * Something else that isn't currently supported...
       */
 
-      serverLogJob(SERVER_LOGLEVEL_DEBUG, job, "Ignoring attribute \"%s\" with value \"%s\".", option->name, option->value);
+      SERVER_LOG_JOB_DEBUG(job, "Ignoring attribute \"%s\" with value \"%s\".", option->name, option->value);
     }
   }
 
-  cupsFreeOptions(num_options, options);
+  if (printer)
+  {
+    serverClearPrinterCacheNoLock(printer);
+    _cupsRWUnlock(&printer->rwlock);
+
+    serverAddEventNoLock(printer, NULL, NULL, SERVER_EVENT_PRINTER_CONFIG_CHANGED, NULL);
+  }
+
+  if (progress)
+    serverAddEventNoLock(job->printer, job, NULL, SERVER_EVENT_JOB_PROGRESS, NULL);
 }
 
 
@@ -751,32 +1790,377 @@ process_state_message(
       break;
   }
 
-  job->state_reasons          = jreasons;
+  SERVER_SEQ_BEGIN(job->status_seq);
+  job->state_reasons = jreasons;
+  SERVER_SEQ_END(job->status_seq);
+
   job->printer->state_reasons = preasons;
 }
 
 
+#ifndef _WIN32
 /*
- * 'time_seconds()' - Return the current time in fractional seconds.
+ * 'relay_full()' - Determine whether the output relay buffer is full.
  */
 
-static double				/* O - Time in seconds */
-time_seconds(void)
+static int				/* O - 1 if full, 0 otherwise */
+relay_full(server_relay_t *relay)	/* I - Output relay */
 {
-#ifdef _WIN32
-  struct _timeb curtime;		/* Current time */
+  int	full;				/* Is the buffer full? */
 
 
-  _ftime(&curtime);
+  if (!relay->buffer)
+    return (0);
 
-  return ((double)curtime.time + 0.001 * curtime.millitm);
+  _cupsMutexLock(&relay->mutex);
+  full = relay->used == SERVER_RELAY_SIZE;
+  _cupsMutexUnlock(&relay->mutex);
+
+  return (full);
+}
+
+
+/*
+ * 'relay_output()' - Write buffered transform output to the client.
+ */
+
+static void *				/* O - Thread exit status */
+relay_output(server_relay_t *relay)	/* I - Output relay */
+{
+  size_t	bytes;			/* Bytes to write */
+
+
+  _cupsMutexLock(&relay->mutex);
+
+  for (;;)
+  {
+    while (!relay->used && !relay->eof)
+      _cupsCondWait(&relay->cond, &relay->mutex, 0.0);
+
+    if (!relay->used)
+      break;
+
+    if ((bytes = SERVER_RELAY_SIZE - relay->start) > relay->used)
+      bytes = relay->used;
+
+    _cupsMutexUnlock(&relay->mutex);
+
+   /*
+    * Keep draining the buffer after a write error so the transform can
+    * finish...
+    */
+
+    if (!relay->error && httpWrite2(relay->http, (char *)relay->buffer + relay->start, bytes) < 0)
+      relay->error = 1;
+
+    if (relay->cache_fd >= 0 && !relay->cache_error && write(relay->cache_fd, relay->buffer + relay->start, bytes) != (ssize_t)bytes)
+      relay->cache_error = 1;
+
+    _cupsMutexLock(&relay->mutex);
+
+    relay->start = (relay->start + bytes) % SERVER_RELAY_SIZE;
+    relay->used  -= bytes;
+    relay->total += bytes;
+
+    _cupsCondBroadcast(&relay->cond);
+  }
+
+  _cupsMutexUnlock(&relay->mutex);
+
+  return (NULL);
+}
+
+
+/*
+ * 'relay_read()' - Read transform output into the relay buffer.
+ *
+ * When "block" is 1, wait for the client to make room in a full buffer.
+ * Otherwise the caller must have checked that the buffer is not full.
+ */
+
+static ssize_t				/* O - Bytes read, 0 on EOF, -1 on error */
+relay_read(server_relay_t *relay,	/* I - Output relay */
+	   int            fd,		/* I - File to read from */
+	   int            block)	/* I - Wait for room in the buffer? */
+{
+  size_t	end,			/* End of data in buffer */
+		count;			/* Bytes to read */
+  ssize_t	bytes;			/* Bytes read */
+
+
+  if (!relay->buffer)
+  {
+   /*
+    * No relay thread, write directly to the client...
+    */
+
+    char	data[32768];		/* Data from transform */
+
+    if ((bytes = read(fd, data, sizeof(data))) > 0)
+    {
+      httpWrite2(relay->http, data, (size_t)bytes);
+      relay->total += (size_t)bytes;
+
+      if (relay->cache_fd >= 0 && !relay->cache_error && write(relay->cache_fd, data, (size_t)bytes) != bytes)
+        relay->cache_error = 1;
+    }
+
+    return (bytes);
+  }
+
+  _cupsMutexLock(&relay->mutex);
+
+  while (block && relay->used == SERVER_RELAY_SIZE)
+    _cupsCondWait(&relay->cond, &relay->mutex, 0.0);
+
+  end   = (relay->start + relay->used) % SERVER_RELAY_SIZE;
+  count = SERVER_RELAY_SIZE - relay->used;
+
+  if (end + count > SERVER_RELAY_SIZE)
+    count = SERVER_RELAY_SIZE - end;
+
+  _cupsMutexUnlock(&relay->mutex);
+
+ /*
+  * Only this thread adds data, so the free space can't shrink while we read
+  * into it...
+  */
+
+  if ((bytes = read(fd, relay->buffer + end, count)) > 0)
+  {
+    _cupsMutexLock(&relay->mutex);
+    relay->used += (size_t)bytes;
+    _cupsCondBroadcast(&relay->cond);
+    _cupsMutexUnlock(&relay->mutex);
+  }
+
+  return (bytes);
+}
+
+
+/*
+ * 'release_worker()' - Return a resident transform process to the pool.
+ *
+ * When "ok" is 0 the process is stopped and its slot freed.
+ */
+
+static void
+release_worker(
+    server_worker_t *worker,		/* I - Worker */
+    int             ok)			/* I - 1 if the worker can be reused, 0 otherwise */
+{
+  _cupsMutexLock(&WorkersMutex);
+
+  if (!ok)
+  {
+    serverLog(SERVER_LOGLEVEL_INFO, "Stopping transform worker \"%s\", pid=%d", worker->command, worker->pid);
+
+    close(worker->fd);
+    kill(worker->pid, SIGTERM);
+    while (waitpid(worker->pid, NULL, 0) < 0 && errno == EINTR);
+
+    free(worker->command);
+
+    worker->command = NULL;
+    worker->fd      = -1;
+    worker->pid     = 0;
+  }
+
+  worker->busy = 0;
+
+  _cupsMutexUnlock(&WorkersMutex);
+}
+
+
+/*
+ * 'send_worker_job()' - Send a job to a resident transform process.
+ *
+ * The request is the length of the filename and environment strings, sent
+ * with the job's stdin, stdout, and stderr file descriptors, followed by the
+ * nul-terminated strings.  The worker replies with the process ID for the job.
+ */
+
+static int				/* O - Process ID or -1 on error */
+send_worker_job(
+    server_worker_t *worker,		/* I - Worker */
+    const char      *filename,		/* I - Filename or "-" for stdin */
+    char            **envp,		/* I - Environment variables */
+    int             infd,		/* I - File descriptor for stdin or -1 */
+    int             outfd,		/* I - File descriptor for stdout or -1 */
+    int             errfd)		/* I - File descriptor for stderr or -1 */
+{
+  int		i;			/* Looping var */
+  unsigned	length;			/* Length of request strings */
+  char		*request,		/* Request strings */
+		*ptr;			/* Pointer into request */
+  size_t	len;			/* Length of string */
+  int		fds[3];			/* File descriptors for job */
+  int		nullfd = -1;		/* /dev/null */
+  char		buffer[CMSG_SPACE(sizeof(fds))];
+					/* Control message buffer */
+  struct msghdr	msg;			/* Request message */
+  struct iovec	iov;			/* Request length */
+  struct cmsghdr *cmsg;			/* File descriptors in message */
+  ssize_t	bytes;			/* Bytes sent/received */
+  int		pid = -1;		/* Process ID */
+
+
+ /*
+  * Build the request strings...
+  */
+
+  for (length = (unsigned)strlen(filename) + 1, i = 0; envp[i]; i ++)
+    length += (unsigned)strlen(envp[i]) + 1;
+
+  if ((request = malloc(length)) == NULL)
+    return (-1);
+
+  len = strlen(filename) + 1;
+  memcpy(request, filename, len);
+
+  for (ptr = request + len, i = 0; envp[i]; i ++, ptr += len)
+  {
+    len = strlen(envp[i]) + 1;
+    memcpy(ptr, envp[i], len);
+  }
+
+ /*
+  * Send the request with the file descriptors for the job...
+  */
+
+  fds[0] = infd;
+  fds[1] = outfd;
+  fds[2] = errfd;
+
+  for (i = 0; i < 3; i ++)
+  {
+    if (fds[i] < 0)
+    {
+      if (nullfd < 0 && (nullfd = open("/dev/null", O_RDWR | O_BINARY)) < 0)
+        goto done;
+
+      fds[i] = nullfd;
+    }
+  }
+
+  memset(&msg, 0, sizeof(msg));
+  memset(buffer, 0, sizeof(buffer));
+
+  iov.iov_base       = &length;
+  iov.iov_len        = sizeof(length);
+  msg.msg_iov        = &iov;
+  msg.msg_iovlen     = 1;
+  msg.msg_control    = buffer;
+  msg.msg_controllen = sizeof(buffer);
+
+  cmsg             = CMSG_FIRSTHDR(&msg);
+  cmsg->cmsg_level = SOL_SOCKET;
+  cmsg->cmsg_type  = SCM_RIGHTS;
+  cmsg->cmsg_len   = CMSG_LEN(sizeof(fds));
+  memcpy(CMSG_DATA(cmsg), fds, sizeof(fds));
+
+  while ((bytes = sendmsg(worker->fd, &msg, SERVER_WORKER_FLAGS)) < 0 && errno == EINTR);
+
+  if (bytes != (ssize_t)sizeof(length))
+    goto done;
+
+  for (ptr = request; ptr < (request + length); ptr += bytes)
+  {
+    if ((bytes = send(worker->fd, ptr, (size_t)(request + length - ptr), SERVER_WORKER_FLAGS)) < 0)
+    {
+      if (errno != EINTR)
+        goto done;
+
+      bytes = 0;
+    }
+  }
+
+ /*
+  * Get the process ID...
+  */
+
+  while ((bytes = recv(worker->fd, &pid, sizeof(pid), MSG_WAITALL)) < 0 && errno == EINTR);
+
+  if (bytes != (ssize_t)sizeof(pid))
+    pid = -1;
+
+  done:
+
+  if (nullfd >= 0)
+    close(nullfd);
+
+  free(request);
+
+  return (pid);
+}
+
+
+/*
+ * 'set_limits()' - Apply the printer's resource limits to a transform process.
+ *
+ * The limits are applied right after the process is spawned, which is soon
+ * enough to stop runaway documents.  The CPU limit sends SIGXCPU and then
+ * SIGKILL 5 seconds later.  Resident transform processes are not limited.
+ */
+
+static void
+set_limits(server_printer_t *printer,	/* I - Printer */
+           int              pid)	/* I - Process ID */
+{
+#ifdef HAVE_PRLIMIT
+  struct rlimit	limit;			/* Resource limit */
+
+
+  if (printer->pinfo.cpu_limit > 0)
+  {
+    limit.rlim_cur = (rlim_t)printer->pinfo.cpu_limit;
+    limit.rlim_max = (rlim_t)printer->pinfo.cpu_limit + 5;
+
+    if (prlimit(pid, RLIMIT_CPU, &limit, NULL))
+      serverLogPrinter(SERVER_LOGLEVEL_ERROR, printer, "Unable to set CPU limit for transform process %d: %s", pid, strerror(errno));
+  }
+
+  if (printer->pinfo.memory_limit > 0)
+  {
+    limit.rlim_cur = limit.rlim_max = (rlim_t)printer->pinfo.memory_limit;
+
+    if (prlimit(pid, RLIMIT_AS, &limit, NULL))
+      serverLogPrinter(SERVER_LOGLEVEL_ERROR, printer, "Unable to set memory limit for transform process %d: %s", pid, strerror(errno));
+  }
 
 #else
-  struct timeval curtime;		/* Current time */
+  (void)pid;
 
+  if (printer->pinfo.cpu_limit > 0 || printer->pinfo.memory_limit > 0)
+    SERVER_LOG_PRINTER_DEBUG(printer, "Transform resource limits are not supported on this platform.");
+#endif /* HAVE_PRLIMIT */
+}
 
-  gettimeofday(&curtime, NULL);
 
-  return ((double)curtime.tv_sec + 0.000001 * curtime.tv_usec);
-#endif /* _WIN32 */
+/*
+ * 'wait_worker_job()' - Wait for a resident transform process to finish a job.
+ *
+ * The worker is returned to the pool, or stopped if the connection is lost.
+ */
+
+static int				/* O - Wait status or -1 on error */
+wait_worker_job(
+    server_worker_t *worker)		/* I - Worker */
+{
+  int		status;			/* Wait status */
+  ssize_t	bytes;			/* Bytes received */
+
+
+  while ((bytes = recv(worker->fd, &status, sizeof(status), MSG_WAITALL)) < 0 && errno == EINTR);
+
+  if (bytes != (ssize_t)sizeof(status))
+  {
+    release_worker(worker, 0);
+    return (-1);
+  }
+
+  release_worker(worker, 1);
+
+  return (status);
 }
+#endif /* !_WIN32 */
@@ -0,0 +1,124 @@
+#!/bin/sh
+#
+# Throughput benchmark script for ippserver.
+#
+# Copyright © 2018 by The Printer Working Group.
+#
+# Licensed under Apache License v2.0.  See the file "LICENSE" for more
+# information.
+#
+# Usage:
+#
+#   test/bench-server.sh [scenario ...]
+#
+# Scenarios:
+#
+#   small-office   2 printers, 4 clients, mostly status queries
+#   print-shop     10 printers, 16 clients, mostly Print-Job requests
+#   proxy-heavy    25 printers, 32 clients, mostly Get-Jobs and
+#                  Get-Notifications polling
+#
+# The default is to run all scenarios.  Each scenario generates a
+# configuration directory with N copies of the IPP Everywhere PDF printer,
+# starts ippserver on it, drives it with cups/benchipp, and writes CSV
+# results to the standard output with the scenario name as the first column.
+#
+# Environment variables:
+#
+#   BENCH_DURATION   Seconds per scenario (default 10)
+#   BENCH_FILE       File to print (default examples/document-letter.pdf)
+#   BENCH_PORT       Port for ippserver (default 8700)
+#
+
+# Verify we have been run from the correct location...
+if test ! -d test; then
+        echo "Usage: test/bench-server.sh [scenario ...]"
+        exit 1
+fi
+
+if test ! -x server/ippserver -o ! -x cups/benchipp; then
+        echo "You must build ippserver and cups/benchipp before running this script."
+        exit 1
+fi
+
+duration="${BENCH_DURATION:-10}"
+file="${BENCH_FILE:-examples/document-letter.pdf}"
+port="${BENCH_PORT:-8700}"
+tmpdir="${TMPDIR:-/tmp}/bench-server$$"
+
+if test $# = 0; then
+        set small-office print-shop proxy-heavy
+fi
+
+trap 'test -n "$pid" && kill $pid 2>/dev/null; rm -rf "$tmpdir"' EXIT INT TERM
+
+echo "scenario,operation,requests,errors,requests-per-second,p50-ms,p90-ms,p99-ms,max-ms,peak-rss-kb,peak-threads"
+
+for scenario in "$@"; do
+        case "$scenario" in
+                small-office)
+                        printers=2
+                        clients=4
+                        mix="get-printer-attributes=6,print-job=2,get-jobs=2"
+                        ;;
+                print-shop)
+                        printers=10
+                        clients=16
+                        mix="get-printer-attributes=2,print-job=6,get-jobs=2"
+                        ;;
+                proxy-heavy)
+                        printers=25
+                        clients=32
+                        mix="get-printer-attributes=1,print-job=1,get-jobs=4,get-notifications=4"
+                        ;;
+                *)
+                        echo "Unknown scenario \"$scenario\"." >&2
+                        exit 1
+                        ;;
+        esac
+
+        # Generate the configuration directory...
+        rm -rf "$tmpdir"
+        mkdir -p "$tmpdir/conf/print" "$tmpdir/spool"
+
+        cat >"$tmpdir/conf/system.conf" <<EOF
+Listen localhost:$port
+LogFile $tmpdir/server.log
+LogLevel error
+KeepFiles No
+MaxCompletedJobs 100
+MaxJobs 0
+SpoolDir $tmpdir/spool
+EOF
+
+        uris=""
+        i=1
+        while test $i -le $printers; do
+                sed -e "s/deadbeef-0000-1111-2222-000000000002/deadbeef-0000-1111-2222-$(printf %012d $i)/" \
+                    -e '/^ICON/d' test/print/ipp-everywhere-pdf.conf >"$tmpdir/conf/print/bench$i.conf"
+                uris="$uris ipp://localhost:$port/ipp/print/bench$i"
+                i=`expr $i + 1`
+        done
+
+        # Start the server and wait for it to listen...
+        server/ippserver -C "$tmpdir/conf" --no-dns-sd >"$tmpdir/server.out" 2>&1 &
+        pid=$!
+
+        tries=0
+        while ! cups/benchipp -d 0.1 -c 1 -m get-printer-attributes=1 ipp://localhost:$port/ipp/print/bench1 >/dev/null 2>&1; do
+                tries=`expr $tries + 1`
+                if test $tries -ge 50; then
+                        echo "ippserver did not start for \"$scenario\":" >&2
+                        cat "$tmpdir/server.out" >&2
+                        exit 1
+                fi
+                sleep 0.2
+        done
+
+        # Run the clients...
+        cups/benchipp -c $clients -d $duration -f "$file" -m "$mix" -p $pid $uris | tail -n +2 | sed -e "s/^/$scenario,/"
+
+        kill $pid
+        wait $pid 2>/dev/null
+        pid=""
+done
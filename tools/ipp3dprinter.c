@@ -139,12 +139,6 @@ typedef void *ipp3d_srv_t;		/* Service reference */
 typedef void *ipp3d_txt_t;		/* TXT record */
 #endif /* HAVE_DNSSD */
 
-typedef struct ipp3d_filter_s		/**** Attribute filter ****/
-{
-  cups_array_t		*ra;		/* Requested attributes */
-  ipp_tag_t		group_tag;	/* Group to copy */
-} ipp3d_filter_t;
-
 typedef struct ipp3d_job_s ipp3d_job_t;
 
 typedef struct ipp3d_printer_s		/**** Printer data ****/
@@ -223,11 +217,9 @@ typedef struct ipp3d_client_s		/**** Client data ****/
 
 static void		clean_jobs(ipp3d_printer_t *printer);
 static int		compare_jobs(ipp3d_job_t *a, ipp3d_job_t *b);
-static void		copy_attributes(ipp_t *to, ipp_t *from, cups_array_t *ra, ipp_tag_t group_tag, int quickcopy);
 static void		copy_job_attributes(ipp3d_client_t *client, ipp3d_job_t *job, cups_array_t *ra);
 static ipp3d_client_t	*create_client(ipp3d_printer_t *printer, int sock);
 static ipp3d_job_t	*create_job(ipp3d_client_t *client);
-static int		create_job_file(ipp3d_job_t *job, char *fname, size_t fnamesize, const char *dir, const char *ext);
 static int		create_listener(const char *name, int port, int family);
 static ipp3d_printer_t	*create_printer(const char *servername, int serverport, const char *name, const char *location, const char *icon, cups_array_t *docformats, const char *subtypes, const char *directory, const char *command, const char *device_uri, ipp_t *attrs);
 static void		debug_attributes(const char *title, ipp_t *ipp, int response);
@@ -241,7 +233,6 @@ static void		dnssd_callback(AvahiEntryGroup *p, AvahiEntryGroupState state, void
 static void		dnssd_client_cb(AvahiClient *c, AvahiClientState state, void *userdata);
 #endif /* HAVE_DNSSD */
 static void		dnssd_init(void);
-static int		filter_cb(ipp3d_filter_t *filter, ipp_t *dst, ipp_attribute_t *attr);
 static ipp3d_job_t	*find_job(ipp3d_client_t *client);
 static void		finish_document_data(ipp3d_client_t *client, ipp3d_job_t *job);
 static void		finish_document_uri(ipp3d_client_t *client, ipp3d_job_t *job);
@@ -627,27 +618,6 @@ compare_jobs(ipp3d_job_t *a,		/* I - First job */
 }
 
 
-/*
- * 'copy_attributes()' - Copy attributes from one request to another.
- */
-
-static void
-copy_attributes(ipp_t        *to,	/* I - Destination request */
-	        ipp_t        *from,	/* I - Source request */
-	        cups_array_t *ra,	/* I - Requested attributes */
-	        ipp_tag_t    group_tag,	/* I - Group to copy */
-	        int          quickcopy)	/* I - Do a quick copy? */
-{
-  ipp3d_filter_t	filter;			/* Filter data */
-
-
-  filter.ra        = ra;
-  filter.group_tag = group_tag;
-
-  ippCopyAttributes(to, from, quickcopy, (ipp_copycb_t)filter_cb, &filter);
-}
-
-
 /*
  * 'copy_job_attrs()' - Copy job attributes to the response.
  */
@@ -658,7 +628,7 @@ copy_job_attributes(
     ipp3d_job_t    *job,			/* I - Job */
     cups_array_t  *ra)			/* I - requested-attributes */
 {
-  copy_attributes(client->response, job->attrs, ra, IPP_TAG_JOB, 0);
+  _ippServerCopyAttributes(client->response, job->attrs, ra, NULL, IPP_TAG_JOB, 0);
 
   if (!ra || cupsArrayFind(ra, "date-time-at-completed"))
   {
@@ -898,7 +868,7 @@ create_job(ipp3d_client_t *client)	/* I - Client */
   * Copy all of the job attributes...
   */
 
-  copy_attributes(job->attrs, client->request, NULL, IPP_TAG_JOB, 0);
+  _ippServerCopyAttributes(job->attrs, client->request, NULL, NULL, IPP_TAG_JOB, 0);
 
  /*
   * Get the requesting-user-name, document format, and priority...
@@ -955,81 +925,6 @@ create_job(ipp3d_client_t *client)	/* I - Client */
 }
 
 
-/*
- * 'create_job_file()' - Create a file for the document in a job.
- */
-
-static int				/* O - File descriptor or -1 on error */
-create_job_file(
-    ipp3d_job_t     *job,		/* I - Job */
-    char             *fname,		/* I - Filename buffer */
-    size_t           fnamesize,		/* I - Size of filename buffer */
-    const char       *directory,	/* I - Directory to store in */
-    const char       *ext)		/* I - Extension (`NULL` for default) */
-{
-  char			name[256],	/* "Safe" filename */
-			*nameptr;	/* Pointer into filename */
-  const char		*job_name;	/* job-name value */
-
-
- /*
-  * Make a name from the job-name attribute...
-  */
-
-  if ((job_name = ippGetString(ippFindAttribute(job->attrs, "job-name", IPP_TAG_NAME), 0, NULL)) == NULL)
-    job_name = "untitled";
-
-  for (nameptr = name; *job_name && nameptr < (name + sizeof(name) - 1); job_name ++)
-  {
-    if (isalnum(*job_name & 255) || *job_name == '-')
-    {
-      *nameptr++ = (char)tolower(*job_name & 255);
-    }
-    else
-    {
-      *nameptr++ = '_';
-
-      while (job_name[1] && !isalnum(job_name[1] & 255) && job_name[1] != '-')
-        job_name ++;
-    }
-  }
-
-  *nameptr = '\0';
-
- /*
-  * Figure out the extension...
-  */
-
-  if (!ext)
-  {
-    if (!strcasecmp(job->format, "image/jpeg"))
-      ext = "jpg";
-    else if (!strcasecmp(job->format, "image/png"))
-      ext = "png";
-    else if (!strcasecmp(job->format, "image/pwg-raster"))
-      ext = "pwg";
-    else if (!strcasecmp(job->format, "image/urf"))
-      ext = "urf";
-    else if (!strcasecmp(job->format, "application/pdf"))
-      ext = "pdf";
-    else if (!strcasecmp(job->format, "application/postscript"))
-      ext = "ps";
-    else if (!strcasecmp(job->format, "application/vnd.hp-pcl"))
-      ext = "pcl";
-    else
-      ext = "dat";
-  }
-
- /*
-  * Create a filename with the job-id, job-name, and document-format (extension)...
-  */
-
-  snprintf(fname, fnamesize, "%s/%d-%s.%s", directory, job->id, name, ext);
-
-  return (open(fname, O_WRONLY | O_CREAT | O_TRUNC, 0666));
-}
-
-
 /*
  * 'create_listener()' - Create a listener socket.
  */
@@ -1907,33 +1802,6 @@ dnssd_init(void)
 }
 
 
-/*
- * 'filter_cb()' - Filter printer attributes based on the requested array.
- */
-
-static int				/* O - 1 to copy, 0 to ignore */
-filter_cb(ipp3d_filter_t   *filter,	/* I - Filter parameters */
-          ipp_t           *dst,		/* I - Destination (unused) */
-	  ipp_attribute_t *attr)	/* I - Source attribute */
-{
- /*
-  * Filter attributes as needed...
-  */
-
-#ifndef _WIN32 /* Avoid MS compiler bug */
-  (void)dst;
-#endif /* !_WIN32 */
-
-  ipp_tag_t group = ippGetGroupTag(attr);
-  const char *name = ippGetName(attr);
-
-  if ((filter->group_tag != IPP_TAG_ZERO && group != filter->group_tag && group != IPP_TAG_ZERO) || !name || (!strcmp(name, "media-col-database") && !cupsArrayFind(filter->ra, (void *)name)))
-    return (0);
-
-  return (!filter->ra || cupsArrayFind(filter->ra, (void *)name) != NULL);
-}
-
-
 /*
  * 'find_job()' - Find a job specified in a request.
  */
@@ -1989,7 +1857,7 @@ finish_document_data(
   * TODO: Update code to support piping large raster data to the print command.
   */
 
-  if ((job->fd = create_job_file(job, filename, sizeof(filename), client->printer->directory, NULL)) < 0)
+  if ((job->fd = _ippServerCreateJobFile(job->id, job->attrs, job->format, filename, sizeof(filename), client->printer->directory, NULL)) < 0)
   {
     respond_ipp(client, IPP_STATUS_ERROR_INTERNAL, "Unable to create print file: %s", strerror(errno));
 
@@ -2202,7 +2070,7 @@ finish_document_uri(
   * Create a file for the request data...
   */
 
-  if ((job->fd = create_job_file(job, filename, sizeof(filename), client->printer->directory, NULL)) < 0)
+  if ((job->fd = _ippServerCreateJobFile(job->id, job->attrs, job->format, filename, sizeof(filename), client->printer->directory, NULL)) < 0)
   {
     _cupsRWUnlock(&(client->printer->rwlock));
 
@@ -3121,7 +2989,7 @@ ipp_get_printer_attributes(
 
   _cupsRWLockRead(&(printer->rwlock));
 
-  copy_attributes(client->response, printer->attrs, ra, IPP_TAG_ZERO,
+  _ippServerCopyAttributes(client->response, printer->attrs, ra, NULL, IPP_TAG_ZERO,
 		  IPP_TAG_CUPS_CONST);
 
   if (!ra || cupsArrayFind(ra, "printer-config-change-date-time"))
@@ -3298,7 +3166,7 @@ ipp_send_document(
 
   _cupsRWLockWrite(&(client->printer->rwlock));
 
-  copy_attributes(job->attrs, client->request, NULL, IPP_TAG_JOB, 0);
+  _ippServerCopyAttributes(job->attrs, client->request, NULL, NULL, IPP_TAG_JOB, 0);
 
   if ((attr = ippFindAttribute(job->attrs, "document-format-detected", IPP_TAG_MIMETYPE)) != NULL)
     job->format = ippGetString(attr, 0, NULL);
@@ -3389,7 +3257,7 @@ ipp_send_uri(ipp3d_client_t *client)	/* I - Client */
 
   _cupsRWLockWrite(&(client->printer->rwlock));
 
-  copy_attributes(job->attrs, client->request, NULL, IPP_TAG_JOB, 0);
+  _ippServerCopyAttributes(job->attrs, client->request, NULL, NULL, IPP_TAG_JOB, 0);
 
   if ((attr = ippFindAttribute(job->attrs, "document-format-detected", IPP_TAG_MIMETYPE)) != NULL)
     job->format = ippGetString(attr, 0, NULL);
@@ -4538,7 +4406,7 @@ process_job(ipp3d_job_t *job)		/* I - Job */
         }
         else if (S_ISDIR(fileinfo.st_mode))
         {
-          if ((mystdout = create_job_file(job, line, sizeof(line), resource, "prn")) >= 0)
+          if ((mystdout = _ippServerCreateJobFile(job->id, job->attrs, job->format, line, sizeof(line), resource, "prn")) >= 0)
 	    fprintf(stderr, "[Job %d] Saving print command output to \"%s\".\n", job->id, line);
           else
             fprintf(stderr, "[Job %d] Unable to create \"%s\": %s\n", job->id, line, strerror(errno));
@@ -4574,7 +4442,7 @@ process_job(ipp3d_job_t *job)		/* I - Job */
         fprintf(stderr, "[Job %d] Unsupported device URI scheme \"%s\".\n", job->id, scheme);
       }
     }
-    else if ((mystdout = create_job_file(job, line, sizeof(line), job->printer->directory, "prn")) >= 0)
+    else if ((mystdout = _ippServerCreateJobFile(job->id, job->attrs, job->format, line, sizeof(line), job->printer->directory, "prn")) >= 0)
     {
       fprintf(stderr, "[Job %d] Saving print command output to \"%s\".\n", job->id, line);
     }
@@ -5848,310 +5716,19 @@ static int				/* O - 1 if valid, 0 if not */
 valid_job_attributes(
     ipp3d_client_t *client)		/* I - Client */
 {
-  int			i,		/* Looping var */
-			count,		/* Number of values */
-			valid = 1;	/* Valid attributes? */
-  ipp_attribute_t	*attr,		/* Current attribute */
-			*supported;	/* xxx-supported attribute */
+  int	valid;				/* Valid attributes? */
 
 
  /*
-  * Check operation attributes...
+  * Check operation and job template attributes...
   */
 
   valid = valid_doc_attributes(client);
 
- /*
-  * Check the various job template attributes...
-  */
-
-  if ((attr = ippFindAttribute(client->request, "copies", IPP_TAG_ZERO)) != NULL)
-  {
-    if (ippGetCount(attr) != 1 || ippGetValueTag(attr) != IPP_TAG_INTEGER ||
-        ippGetInteger(attr, 0) < 1 || ippGetInteger(attr, 0) > 999)
-    {
-      respond_unsupported(client, attr);
-      valid = 0;
-    }
-  }
-
-  if ((attr = ippFindAttribute(client->request, "ipp-attribute-fidelity", IPP_TAG_ZERO)) != NULL)
-  {
-    if (ippGetCount(attr) != 1 || ippGetValueTag(attr) != IPP_TAG_BOOLEAN)
-    {
-      respond_unsupported(client, attr);
-      valid = 0;
-    }
-  }
-
-  if ((attr = ippFindAttribute(client->request, "job-hold-until", IPP_TAG_ZERO)) != NULL)
-  {
-    if (ippGetCount(attr) != 1 ||
-        (ippGetValueTag(attr) != IPP_TAG_NAME &&
-	 ippGetValueTag(attr) != IPP_TAG_NAMELANG &&
-	 ippGetValueTag(attr) != IPP_TAG_KEYWORD) ||
-	strcmp(ippGetString(attr, 0, NULL), "no-hold"))
-    {
-      respond_unsupported(client, attr);
-      valid = 0;
-    }
-  }
-
-  if ((attr = ippFindAttribute(client->request, "job-impressions", IPP_TAG_ZERO)) != NULL)
+  if (!_ippServerValidJobAttributes(client->request, client->printer->attrs, client->response))
   {
-    if (ippGetCount(attr) != 1 || ippGetValueTag(attr) != IPP_TAG_INTEGER || ippGetInteger(attr, 0) < 0)
-    {
-      respond_unsupported(client, attr);
-      valid = 0;
-    }
-  }
-
-  if ((attr = ippFindAttribute(client->request, "job-name", IPP_TAG_ZERO)) != NULL)
-  {
-    if (ippGetCount(attr) != 1 ||
-        (ippGetValueTag(attr) != IPP_TAG_NAME &&
-	 ippGetValueTag(attr) != IPP_TAG_NAMELANG))
-    {
-      respond_unsupported(client, attr);
-      valid = 0;
-    }
-
-    ippSetGroupTag(client->request, &attr, IPP_TAG_JOB);
-  }
-  else
-    ippAddString(client->request, IPP_TAG_JOB, IPP_TAG_NAME, "job-name", NULL, "Untitled");
-
-  if ((attr = ippFindAttribute(client->request, "job-priority", IPP_TAG_ZERO)) != NULL)
-  {
-    if (ippGetCount(attr) != 1 || ippGetValueTag(attr) != IPP_TAG_INTEGER ||
-        ippGetInteger(attr, 0) < 1 || ippGetInteger(attr, 0) > 100)
-    {
-      respond_unsupported(client, attr);
-      valid = 0;
-    }
-  }
-
-  if ((attr = ippFindAttribute(client->request, "job-sheets", IPP_TAG_ZERO)) != NULL)
-  {
-    if (ippGetCount(attr) != 1 ||
-        (ippGetValueTag(attr) != IPP_TAG_NAME &&
-	 ippGetValueTag(attr) != IPP_TAG_NAMELANG &&
-	 ippGetValueTag(attr) != IPP_TAG_KEYWORD) ||
-	strcmp(ippGetString(attr, 0, NULL), "none"))
-    {
-      respond_unsupported(client, attr);
-      valid = 0;
-    }
-  }
-
-  if ((attr = ippFindAttribute(client->request, "media", IPP_TAG_ZERO)) != NULL)
-  {
-    if (ippGetCount(attr) != 1 ||
-        (ippGetValueTag(attr) != IPP_TAG_NAME &&
-	 ippGetValueTag(attr) != IPP_TAG_NAMELANG &&
-	 ippGetValueTag(attr) != IPP_TAG_KEYWORD))
-    {
-      respond_unsupported(client, attr);
-      valid = 0;
-    }
-    else
-    {
-      supported = ippFindAttribute(client->printer->attrs, "media-supported", IPP_TAG_KEYWORD);
-
-      if (!ippContainsString(supported, ippGetString(attr, 0, NULL)))
-      {
-	respond_unsupported(client, attr);
-	valid = 0;
-      }
-    }
-  }
-
-  if ((attr = ippFindAttribute(client->request, "media-col", IPP_TAG_ZERO)) != NULL)
-  {
-    ipp_t		*col,		/* media-col collection */
-			*size;		/* media-size collection */
-    ipp_attribute_t	*member,	/* Member attribute */
-			*x_dim,		/* x-dimension */
-			*y_dim;		/* y-dimension */
-    int			x_value,	/* y-dimension value */
-			y_value;	/* x-dimension value */
-
-    if (ippGetCount(attr) != 1 ||
-        ippGetValueTag(attr) != IPP_TAG_BEGIN_COLLECTION)
-    {
-      respond_unsupported(client, attr);
-      valid = 0;
-    }
-
-    col = ippGetCollection(attr, 0);
-
-    if ((member = ippFindAttribute(col, "media-size-name", IPP_TAG_ZERO)) != NULL)
-    {
-      if (ippGetCount(member) != 1 ||
-	  (ippGetValueTag(member) != IPP_TAG_NAME &&
-	   ippGetValueTag(member) != IPP_TAG_NAMELANG &&
-	   ippGetValueTag(member) != IPP_TAG_KEYWORD))
-      {
-	respond_unsupported(client, attr);
-	valid = 0;
-      }
-      else
-      {
-	supported = ippFindAttribute(client->printer->attrs, "media-supported", IPP_TAG_KEYWORD);
-
-	if (!ippContainsString(supported, ippGetString(member, 0, NULL)))
-	{
-	  respond_unsupported(client, attr);
-	  valid = 0;
-	}
-      }
-    }
-    else if ((member = ippFindAttribute(col, "media-size", IPP_TAG_BEGIN_COLLECTION)) != NULL)
-    {
-      if (ippGetCount(member) != 1)
-      {
-	respond_unsupported(client, attr);
-	valid = 0;
-      }
-      else
-      {
-	size = ippGetCollection(member, 0);
-
-	if ((x_dim = ippFindAttribute(size, "x-dimension", IPP_TAG_INTEGER)) == NULL || ippGetCount(x_dim) != 1 ||
-	    (y_dim = ippFindAttribute(size, "y-dimension", IPP_TAG_INTEGER)) == NULL || ippGetCount(y_dim) != 1)
-	{
-	  respond_unsupported(client, attr);
-	  valid = 0;
-	}
-	else
-	{
-	  x_value   = ippGetInteger(x_dim, 0);
-	  y_value   = ippGetInteger(y_dim, 0);
-	  supported = ippFindAttribute(client->printer->attrs, "media-size-supported", IPP_TAG_BEGIN_COLLECTION);
-	  count     = ippGetCount(supported);
-
-	  for (i = 0; i < count ; i ++)
-	  {
-	    size  = ippGetCollection(supported, i);
-	    x_dim = ippFindAttribute(size, "x-dimension", IPP_TAG_ZERO);
-	    y_dim = ippFindAttribute(size, "y-dimension", IPP_TAG_ZERO);
-
-	    if (ippContainsInteger(x_dim, x_value) && ippContainsInteger(y_dim, y_value))
-	      break;
-	  }
-
-	  if (i >= count)
-	  {
-	    respond_unsupported(client, attr);
-	    valid = 0;
-	  }
-	}
-      }
-    }
-  }
-
-  if ((attr = ippFindAttribute(client->request, "multiple-document-handling", IPP_TAG_ZERO)) != NULL)
-  {
-    if (ippGetCount(attr) != 1 || ippGetValueTag(attr) != IPP_TAG_KEYWORD ||
-        (strcmp(ippGetString(attr, 0, NULL),
-		"separate-documents-uncollated-copies") &&
-	 strcmp(ippGetString(attr, 0, NULL),
-		"separate-documents-collated-copies")))
-    {
-      respond_unsupported(client, attr);
-      valid = 0;
-    }
-  }
-
-  if ((attr = ippFindAttribute(client->request, "orientation-requested", IPP_TAG_ZERO)) != NULL)
-  {
-    if (ippGetCount(attr) != 1 || ippGetValueTag(attr) != IPP_TAG_ENUM ||
-        ippGetInteger(attr, 0) < IPP_ORIENT_PORTRAIT ||
-        ippGetInteger(attr, 0) > IPP_ORIENT_REVERSE_PORTRAIT)
-    {
-      respond_unsupported(client, attr);
-      valid = 0;
-    }
-  }
-
-  if ((attr = ippFindAttribute(client->request, "page-ranges", IPP_TAG_ZERO)) != NULL)
-  {
-    if (ippGetValueTag(attr) != IPP_TAG_RANGE)
-    {
-      respond_unsupported(client, attr);
-      valid = 0;
-    }
-  }
-
-  if ((attr = ippFindAttribute(client->request, "print-quality", IPP_TAG_ZERO)) != NULL)
-  {
-    if (ippGetCount(attr) != 1 || ippGetValueTag(attr) != IPP_TAG_ENUM ||
-        ippGetInteger(attr, 0) < IPP_QUALITY_DRAFT ||
-        ippGetInteger(attr, 0) > IPP_QUALITY_HIGH)
-    {
-      respond_unsupported(client, attr);
-      valid = 0;
-    }
-  }
-
-  if ((attr = ippFindAttribute(client->request, "printer-resolution", IPP_TAG_ZERO)) != NULL)
-  {
-    supported = ippFindAttribute(client->printer->attrs, "printer-resolution-supported", IPP_TAG_RESOLUTION);
-
-    if (ippGetCount(attr) != 1 || ippGetValueTag(attr) != IPP_TAG_RESOLUTION ||
-        !supported)
-    {
-      respond_unsupported(client, attr);
-      valid = 0;
-    }
-    else
-    {
-      int	xdpi,			/* Horizontal resolution for job template attribute */
-		ydpi,			/* Vertical resolution for job template attribute */
-		sydpi;			/* Vertical resolution for supported value */
-      ipp_res_t	units,			/* Units for job template attribute */
-		sunits;			/* Units for supported value */
-
-      xdpi  = ippGetResolution(attr, 0, &ydpi, &units);
-      count = ippGetCount(supported);
-
-      for (i = 0; i < count; i ++)
-      {
-        if (xdpi == ippGetResolution(supported, i, &sydpi, &sunits) && ydpi == sydpi && units == sunits)
-          break;
-      }
-
-      if (i >= count)
-      {
-	respond_unsupported(client, attr);
-	valid = 0;
-      }
-    }
-  }
-
-  if ((attr = ippFindAttribute(client->request, "sides", IPP_TAG_ZERO)) != NULL)
-  {
-    const char *sides = ippGetString(attr, 0, NULL);
-					/* "sides" value... */
-
-    if (ippGetCount(attr) != 1 || ippGetValueTag(attr) != IPP_TAG_KEYWORD)
-    {
-      respond_unsupported(client, attr);
-      valid = 0;
-    }
-    else if ((supported = ippFindAttribute(client->printer->attrs, "sides-supported", IPP_TAG_KEYWORD)) != NULL)
-    {
-      if (!ippContainsString(supported, sides))
-      {
-	respond_unsupported(client, attr);
-	valid = 0;
-      }
-    }
-    else if (strcmp(sides, "one-sided"))
-    {
-      respond_unsupported(client, attr);
-      valid = 0;
-    }
+    fprintf(stderr, "%s %s %s (%s)\n", client->hostname, ippOpString(client->operation_id), ippErrorString(ippGetStatusCode(client->response)), ippGetString(ippFindAttribute(client->response, "status-message", IPP_TAG_TEXT), 0, NULL));
+    valid = 0;
   }
 
   return (valid);
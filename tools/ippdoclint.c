@@ -10,7 +10,13 @@
 #include <config.h>
 #include <stdio.h>
 #include <limits.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/time.h>
+#include <sys/wait.h>
 #include <cups/cups.h>
+#include <cups/dir.h>
 #include <cups/raster.h>
 #include <cups/string-private.h>
 
@@ -32,12 +38,39 @@ typedef struct lint_counters_s		/**** Page/Sheet/Etc. Counters ****/
 	monochrome;			/* Number of monochrome pages/sheets/impressions */
 } lint_counters_t;
 
+typedef enum lint_format_e		/**** Batch summary format ****/
+{
+  LINT_FORMAT_CSV,			/* Comma-separated values */
+  LINT_FORMAT_JSON			/* JSON object */
+} lint_format_t;
+
+typedef struct lint_result_s		/**** Batch result for one file ****/
+{
+  int			status,		/* 1 if the file is valid, 0 otherwise */
+			errors,		/* Number of errors found */
+			warnings;	/* Number of warnings found */
+  lint_counters_t	impressions,	/* Number of impressions */
+			impressions_two_sided,
+					/* Number of two-sided impressions */
+			pages,		/* Number of input pages */
+			sheets;		/* Number of media sheets */
+  double		elapsed;	/* Time to check file in seconds */
+} lint_result_t;
+
+typedef struct lint_worker_s		/**** Batch worker process ****/
+{
+  pid_t			pid;		/* Process ID or 0 if idle */
+  int			fd;		/* Pipe for result */
+  int			index;		/* Index of file being checked */
+} lint_worker_t;
+
 
 /*
  * Local globals...
  */
 
 static int		Errors = 0;		/* Number of errors found */
+static int		Fast = 0;		/* Only check headers and structure? */
 static lint_counters_t	Impressions = { 0, 0, 0 },
 						/* Number of impressions */
 			ImpressionsTwoSided = { 0, 0, 0 },
@@ -52,13 +85,21 @@ static int		Warnings = 0;		/* Number of warnings found */
  * Local functions...
  */
 
+static void	add_files(cups_array_t *files, const char *path, const char *content_type);
+static void	close_document(cups_file_t *fp);
+static const char *get_content_type(const char *filename);
+static int	lint_batch(cups_array_t *files, const char *content_type, int num_options, cups_option_t *options, int jobs, lint_format_t format);
+static int	lint_document(const char *filename, const char *content_type, int num_options, cups_option_t *options);
 static int	lint_jpeg(const char *filename, int num_options, cups_option_t *options);
 static int	lint_pdf(const char *filename, int num_options, cups_option_t *options);
 static int	lint_raster(const char *filename, const char *content_type);
 static int	load_env_options(cups_option_t **options);
+static cups_file_t *open_document(const char *filename);
 static int	read_apple_raster_header(cups_file_t *fp, cups_page_header2_t *header);
 static int	read_pwg_raster_header(cups_file_t *fp, unsigned syncword, cups_page_header2_t *header);
 static int	read_raster_image(cups_file_t *fp, cups_page_header2_t *header, unsigned page);
+static void	put_json_string(const char *s);
+static int	spool_document(char *tempfile, size_t tempsize);
 static void	usage(int status) _CUPS_NORETURN;
 
 
@@ -76,6 +117,13 @@ main(int  argc,				/* I - Number of command-line arguments */
 		*filename;		/* File to check */
   int		num_options;		/* Number of options */
   cups_option_t	*options;		/* Options */
+  cups_array_t	*files;			/* Files to check */
+  int		batch = 0,		/* Batch mode? */
+		jobs = 0,		/* Number of batch workers */
+		status;			/* Status of check */
+  lint_format_t	format = LINT_FORMAT_CSV;
+					/* Batch summary format */
+  struct stat	fileinfo;		/* File information */
 
 
  /*
@@ -83,7 +131,7 @@ main(int  argc,				/* I - Number of command-line arguments */
   */
 
   content_type = getenv("CONTENT_TYPE");
-  filename     = NULL;
+  files        = cupsArrayNew3(NULL, NULL, NULL, 0, (cups_acopy_func_t)strdup, (cups_afree_func_t)free);
   num_options  = load_env_options(&options);
 
   if ((opt = getenv("SERVER_LOGLEVEL")) != NULL)
@@ -94,14 +142,27 @@ main(int  argc,				/* I - Number of command-line arguments */
       Verbosity = 1;
   }
 
+  if ((opt = getenv("IPPDOCLINT_FAST")) != NULL && atoi(opt) > 0)
+    Fast = 1;
+
   for (i = 1; i < argc; i ++)
   {
     if (!strncmp(argv[i], "--", 2))
     {
-      if (!strcmp(argv[i], "--help"))
+      if (!strcmp(argv[i], "--csv"))
+      {
+        batch  = 1;
+        format = LINT_FORMAT_CSV;
+      }
+      else if (!strcmp(argv[i], "--help"))
       {
         usage(0);
       }
+      else if (!strcmp(argv[i], "--json"))
+      {
+        batch  = 1;
+        format = LINT_FORMAT_JSON;
+      }
       else if (!strcmp(argv[i], "--version"))
       {
         puts(CUPS_SVERSION);
@@ -112,12 +173,16 @@ main(int  argc,				/* I - Number of command-line arguments */
 	usage(1);
       }
     }
-    else if (argv[i][0] == '-')
+    else if (argv[i][0] == '-' && argv[i][1])
     {
       for (opt = argv[i] + 1; *opt; opt ++)
       {
         switch (*opt)
 	{
+	  case 'f' : /* Only check headers and structure... */
+	      Fast = 1;
+	      break;
+
 	  case 'i' :
 	      i ++;
 	      if (i >= argc)
@@ -126,6 +191,14 @@ main(int  argc,				/* I - Number of command-line arguments */
 	      content_type = argv[i];
 	      break;
 
+	  case 'j' : /* Number of batch workers */
+	      i ++;
+	      if (i >= argc || (jobs = atoi(argv[i])) < 1)
+	        usage(1);
+
+	      batch = 1;
+	      break;
+
 	  case 'o' :
 	      i ++;
 	      if (i >= argc)
@@ -145,59 +218,50 @@ main(int  argc,				/* I - Number of command-line arguments */
 	}
       }
     }
-    else if (!filename)
-      filename = argv[i];
     else
-      usage(1);
+    {
+      if (cupsArrayCount(files) > 0 || (strcmp(argv[i], "-") && !stat(argv[i], &fileinfo) && S_ISDIR(fileinfo.st_mode)))
+        batch = 1;
+
+      cupsArrayAdd(files, argv[i]);
+    }
   }
 
  /*
   * Check that we have everything we need...
   */
 
-  if (!filename)
+  if ((filename = (const char *)cupsArrayFirst(files)) == NULL)
     usage(1);
 
-  if (!content_type)
+  if (batch)
   {
-    if ((opt = strrchr(filename, '.')) != NULL)
-    {
-      if (!strcmp(opt, ".pdf"))
-        content_type = "application/pdf";
-      else if (!strcmp(opt, ".jpg") || !strcmp(opt, ".jpeg"))
-        content_type = "image/jpeg";
-      else if (!strcmp(opt, ".pwg"))
-        content_type = "image/pwg-raster";
-      else if (!strcmp(opt, ".urf"))
-        content_type = "image/urf";
-    }
-  }
+   /*
+    * Check many files in parallel...
+    */
 
-  if (!content_type)
-  {
-    fprintf(stderr, "ERROR: Unknown format for \"%s\", please specify with '-i' option.\n", filename);
-    usage(1);
-  }
-  else if (!strcmp(content_type, "image/jpeg"))
-  {
-    if (!lint_jpeg(filename, num_options, options))
-      return (1);
-  }
-  else if (!strcmp(content_type, "application/pdf"))
-  {
-    if (!lint_pdf(filename, num_options, options))
-      return (1);
-  }
-  else if (!strcmp(content_type, "image/pwg-raster") || !strcmp(content_type, "image/urf"))
-  {
-    if (!lint_raster(filename, content_type))
-      return (1);
+    cups_array_t	*batch_files;	/* Expanded list of files */
+
+    batch_files = cupsArrayNew3(NULL, NULL, NULL, 0, (cups_acopy_func_t)strdup, (cups_afree_func_t)free);
+
+    for (; filename; filename = (const char *)cupsArrayNext(files))
+      add_files(batch_files, filename, content_type);
+
+    if (jobs < 1 && (jobs = (int)sysconf(_SC_NPROCESSORS_ONLN)) < 1)
+      jobs = 1;
+
+    status = lint_batch(batch_files, content_type, num_options, options, jobs, format);
+
+    cupsArrayDelete(batch_files);
+    cupsArrayDelete(files);
+
+    return (status ? 0 : 1);
   }
-  else
-  {
-    fprintf(stderr, "ERROR: Unsupported format \"%s\" for \"%s\".\n", content_type, filename);
+
+  if ((status = lint_document(filename, content_type, num_options, options)) < 0)
     usage(1);
-  }
+  else if (!status)
+    return (1);
 
  /*
   * Write ATTR lines for the following Job attributes:
@@ -238,6 +302,406 @@ main(int  argc,				/* I - Number of command-line arguments */
 }
 
 
+/*
+ * 'add_files()' - Add a file or the supported files in a directory.
+ *
+ * Directories are searched recursively in sorted order so that summaries can
+ * be compared from run to run.
+ */
+
+static void
+add_files(cups_array_t *files,		/* I - Files to check */
+          const char   *path,		/* I - File or directory */
+          const char   *content_type)	/* I - Content type or `NULL` to guess */
+{
+  cups_dir_t	*dir;			/* Directory */
+  cups_dentry_t	*dent;			/* Directory entry */
+  cups_array_t	*names;			/* Sorted directory entries */
+  const char	*name;			/* Current entry */
+  char		filename[1024];		/* Path of current entry */
+  struct stat	fileinfo;		/* File information */
+
+
+  if (!strcmp(path, "-") || stat(path, &fileinfo) || !S_ISDIR(fileinfo.st_mode))
+  {
+    cupsArrayAdd(files, (void *)path);
+    return;
+  }
+
+  if ((dir = cupsDirOpen(path)) == NULL)
+  {
+    fprintf(stderr, "ERROR: Unable to open directory \"%s\": %s\n", path, strerror(errno));
+    return;
+  }
+
+  names = cupsArrayNew3((cups_array_func_t)strcmp, NULL, NULL, 0, (cups_acopy_func_t)strdup, (cups_afree_func_t)free);
+
+  while ((dent = cupsDirRead(dir)) != NULL)
+  {
+    if (dent->filename[0] != '.' && (S_ISDIR(dent->fileinfo.st_mode) || content_type || get_content_type(dent->filename)))
+      cupsArrayAdd(names, dent->filename);
+  }
+
+  cupsDirClose(dir);
+
+  for (name = (const char *)cupsArrayFirst(names); name; name = (const char *)cupsArrayNext(names))
+  {
+    snprintf(filename, sizeof(filename), "%s/%s", path, name);
+    add_files(files, filename, content_type);
+  }
+
+  cupsArrayDelete(names);
+}
+
+
+/*
+ * 'close_document()' - Close a document file.
+ *
+ * When the document is read from the standard input, any remaining data is
+ * read and discarded so that the sender does not see a broken pipe.
+ */
+
+static void
+close_document(cups_file_t *fp)		/* I - File to close */
+{
+  char	buffer[65536];			/* Discard buffer */
+
+
+  if (fp == cupsFileStdin())
+  {
+    while (cupsFileRead(fp, buffer, sizeof(buffer)) > 0);
+  }
+  else
+    cupsFileClose(fp);
+}
+
+
+/*
+ * 'get_content_type()' - Guess the content type from a filename extension.
+ */
+
+static const char *			/* O - Content type or `NULL` if unknown */
+get_content_type(const char *filename)	/* I - Filename */
+{
+  const char	*ext;			/* Filename extension */
+
+
+  if ((ext = strrchr(filename, '.')) != NULL)
+  {
+    if (!strcmp(ext, ".pdf"))
+      return ("application/pdf");
+    else if (!strcmp(ext, ".jpg") || !strcmp(ext, ".jpeg"))
+      return ("image/jpeg");
+    else if (!strcmp(ext, ".pwg"))
+      return ("image/pwg-raster");
+    else if (!strcmp(ext, ".urf"))
+      return ("image/urf");
+  }
+
+  return (NULL);
+}
+
+
+/*
+ * 'lint_batch()' - Check many files on a pool of worker processes.
+ *
+ * Each file is checked in a child process so that the global counters and any
+ * PDF library state start out fresh.  The results are sent back over a pipe and
+ * a summary is written to the standard output in the order the files were
+ * listed.
+ */
+
+static int				/* O - 1 if all files are valid, 0 otherwise */
+lint_batch(
+    cups_array_t  *files,		/* I - Files to check */
+    const char    *content_type,	/* I - Content type or `NULL` to guess */
+    int           num_options,		/* I - Number of options */
+    cups_option_t *options,		/* I - Options */
+    int           jobs,			/* I - Number of worker processes */
+    lint_format_t format)		/* I - Summary format */
+{
+  int			i,		/* Looping var */
+			count,		/* Number of files */
+			next,		/* Next file to check */
+			running,	/* Number of running workers */
+			failed = 0;	/* Number of invalid files */
+  lint_result_t		*results,	/* Results for each file */
+			*result;	/* Current result */
+  lint_worker_t		*workers,	/* Worker processes */
+			*worker;	/* Current worker */
+  const char		*filename,	/* Current file */
+			*type;		/* Content type of current file */
+  struct timeval	start,		/* Start time */
+			end;		/* End time */
+  pid_t			pid;		/* Finished worker */
+  int			fds[2],		/* Result pipe */
+			status;		/* Exit status of worker */
+
+
+  if ((count = cupsArrayCount(files)) == 0)
+  {
+    fputs("ERROR: No files to check.\n", stderr);
+    return (0);
+  }
+
+  if (jobs > count)
+    jobs = count;
+
+  results = calloc((size_t)count, sizeof(lint_result_t));
+  workers = calloc((size_t)jobs, sizeof(lint_worker_t));
+
+  if (!results || !workers)
+  {
+    fputs("ERROR: Unable to allocate memory for batch results.\n", stderr);
+    free(results);
+    free(workers);
+    return (0);
+  }
+
+  gettimeofday(&start, NULL);
+
+  for (next = 0, running = 0; next < count || running > 0;)
+  {
+   /*
+    * Start workers for the next files...
+    */
+
+    for (i = 0, worker = workers; i < jobs && next < count; i ++, worker ++)
+    {
+      if (worker->pid)
+        continue;
+
+      if (pipe(fds))
+      {
+        fprintf(stderr, "ERROR: Unable to create pipe: %s\n", strerror(errno));
+        break;
+      }
+
+      filename = (const char *)cupsArrayIndex(files, next);
+
+      if ((pid = fork()) == 0)
+      {
+       /*
+        * Child comes here...
+        */
+
+	lint_result_t	cresult;	/* Result for this file */
+	struct timeval	cstart,		/* Start time */
+			cend;		/* End time */
+	int		fd;		/* /dev/null */
+
+        close(fds[0]);
+
+        if (!Verbosity && (fd = open("/dev/null", O_WRONLY)) >= 0)
+        {
+          dup2(fd, 2);
+          close(fd);
+        }
+
+        gettimeofday(&cstart, NULL);
+
+        memset(&cresult, 0, sizeof(cresult));
+        cresult.status = lint_document(filename, content_type, num_options, options) > 0;
+
+        gettimeofday(&cend, NULL);
+
+        cresult.errors                = Errors ? Errors : !cresult.status;
+        cresult.warnings              = Warnings;
+        cresult.impressions           = Impressions;
+        cresult.impressions_two_sided = ImpressionsTwoSided;
+        cresult.pages                 = Pages;
+        cresult.sheets.blank          = Impressions.blank + (ImpressionsTwoSided.blank + 1) / 2;
+        cresult.sheets.full_color     = Impressions.full_color + (ImpressionsTwoSided.full_color + 1) / 2;
+        cresult.sheets.monochrome     = Impressions.monochrome + (ImpressionsTwoSided.monochrome + 1) / 2;
+        cresult.elapsed               = (cend.tv_sec - cstart.tv_sec) + 0.000001 * (cend.tv_usec - cstart.tv_usec);
+
+        if (write(fds[1], &cresult, sizeof(cresult)) < 0)
+          _exit(1);
+
+        _exit(0);
+      }
+      else if (pid < 0)
+      {
+        fprintf(stderr, "ERROR: Unable to start worker: %s\n", strerror(errno));
+        close(fds[0]);
+        close(fds[1]);
+        break;
+      }
+
+      close(fds[1]);
+
+      worker->pid   = pid;
+      worker->fd    = fds[0];
+      worker->index = next ++;
+      running ++;
+    }
+
+    if (running == 0)
+    {
+     /*
+      * Unable to start any workers...
+      */
+
+      break;
+    }
+
+   /*
+    * Wait for a worker to finish...
+    */
+
+    while ((pid = wait(&status)) < 0 && errno == EINTR);
+
+    if (pid < 0)
+      break;
+
+    for (i = 0, worker = workers; i < jobs; i ++, worker ++)
+    {
+      if (worker->pid == pid)
+        break;
+    }
+
+    if (i >= jobs)
+      continue;
+
+    result = results + worker->index;
+
+    if (read(worker->fd, result, sizeof(lint_result_t)) != (ssize_t)sizeof(lint_result_t))
+    {
+     /*
+      * Worker crashed or was killed before reporting...
+      */
+
+      memset(result, 0, sizeof(lint_result_t));
+      result->errors = 1;
+    }
+
+    close(worker->fd);
+
+    worker->pid = 0;
+    worker->fd  = -1;
+    running --;
+  }
+
+  gettimeofday(&end, NULL);
+
+ /*
+  * Write the summary...
+  */
+
+  if (format == LINT_FORMAT_JSON)
+    puts("{\n  \"files\": [");
+  else
+    puts("filename,content-type,status,errors,warnings,pages,full-color-pages,monochrome-pages,impressions,two-sided-impressions,sheets,seconds");
+
+  for (i = 0, result = results; i < count; i ++, result ++)
+  {
+    const char *ptr;			/* Pointer into filename */
+
+    filename = (const char *)cupsArrayIndex(files, i);
+
+    if ((type = content_type) == NULL && (type = get_content_type(filename)) == NULL)
+      type = "";
+
+    if (i >= next)
+      result->errors = 1;		/* Never checked */
+
+    if (!result->status)
+      failed ++;
+
+    if (format == LINT_FORMAT_JSON)
+    {
+      fputs("    { \"filename\": ", stdout);
+      put_json_string(filename);
+      fputs(", \"content-type\": ", stdout);
+      put_json_string(type);
+      printf(", \"status\": \"%s\", \"errors\": %d, \"warnings\": %d, \"pages\": %d, \"full-color-pages\": %d, \"monochrome-pages\": %d, \"impressions\": %d, \"two-sided-impressions\": %d, \"sheets\": %d, \"seconds\": %.6f }%s\n", result->status ? "pass" : "fail", result->errors, result->warnings, result->pages.full_color + result->pages.monochrome, result->pages.full_color, result->pages.monochrome, result->impressions.blank + result->impressions.full_color + result->impressions.monochrome, result->impressions_two_sided.blank + result->impressions_two_sided.full_color + result->impressions_two_sided.monochrome, result->sheets.blank + result->sheets.full_color + result->sheets.monochrome, result->elapsed, (i + 1) < count ? "," : "");
+    }
+    else
+    {
+      putchar('\"');
+      for (ptr = filename; *ptr; ptr ++)
+      {
+        if (*ptr == '\"')
+          putchar('\"');
+        putchar(*ptr);
+      }
+      putchar('\"');
+
+      printf(",%s,%s,%d,%d,%d,%d,%d,%d,%d,%d,%.6f\n", type, result->status ? "pass" : "fail", result->errors, result->warnings, result->pages.full_color + result->pages.monochrome, result->pages.full_color, result->pages.monochrome, result->impressions.blank + result->impressions.full_color + result->impressions.monochrome, result->impressions_two_sided.blank + result->impressions_two_sided.full_color + result->impressions_two_sided.monochrome, result->sheets.blank + result->sheets.full_color + result->sheets.monochrome, result->elapsed);
+    }
+  }
+
+  if (format == LINT_FORMAT_JSON)
+    printf("  ],\n  \"count\": %d,\n  \"failed\": %d,\n  \"jobs\": %d,\n  \"seconds\": %.6f\n}\n", count, failed, jobs, (end.tv_sec - start.tv_sec) + 0.000001 * (end.tv_usec - start.tv_usec));
+
+  if (Verbosity)
+    fprintf(stderr, "INFO: Checked %d files (%d failed) in %.3f seconds using %d workers.\n", count, failed, (end.tv_sec - start.tv_sec) + 0.000001 * (end.tv_usec - start.tv_usec), jobs);
+
+  free(results);
+  free(workers);
+
+  return (failed == 0);
+}
+
+
+/*
+ * 'lint_document()' - Check a single document.
+ */
+
+static int				/* O - 1 on success, 0 on failure, -1 if unsupported */
+lint_document(
+    const char    *filename,		/* I - File to check or "-" for stdin */
+    const char    *content_type,	/* I - Content type or `NULL` to guess */
+    int           num_options,		/* I - Number of options */
+    cups_option_t *options)		/* I - Options */
+{
+  int		status;			/* Status of check */
+  char		tempfile[1024] = "";	/* Spooled copy of standard input */
+
+
+  if (!content_type && (content_type = get_content_type(filename)) == NULL)
+  {
+    fprintf(stderr, "ERROR: Unknown format for \"%s\", please specify with '-i' option.\n", filename);
+    return (-1);
+  }
+  else if (!strcmp(content_type, "image/jpeg"))
+  {
+    return (lint_jpeg(filename, num_options, options));
+  }
+  else if (!strcmp(content_type, "application/pdf"))
+  {
+   /*
+    * PDF needs random access, so copy a streamed document to a temporary file
+    * first...
+    */
+
+    if (!strcmp(filename, "-"))
+    {
+      if (!spool_document(tempfile, sizeof(tempfile)))
+        return (0);
+
+      filename = tempfile;
+    }
+
+    status = lint_pdf(filename, num_options, options);
+
+    if (tempfile[0])
+      unlink(tempfile);
+
+    return (status);
+  }
+  else if (!strcmp(content_type, "image/pwg-raster") || !strcmp(content_type, "image/urf"))
+  {
+    return (lint_raster(filename, content_type));
+  }
+  else
+  {
+    fprintf(stderr, "ERROR: Unsupported format \"%s\" for \"%s\".\n", content_type, filename);
+    return (-1);
+  }
+}
+
+
 /*
  * 'lint_jpeg()' - Check a JPEG file.
  */
@@ -265,23 +729,20 @@ lint_jpeg(const char    *filename,	/* I - File to check */
 
   color_mode = cupsGetOption("print-color-mode", num_options, options);
 
-  if ((fp = cupsFileOpen(filename, "rb")) == NULL)
-  {
-    fprintf(stderr, "ERROR: Unable to open \"%s\": %s\n", filename, cupsLastErrorString());
+  if ((fp = open_document(filename)) == NULL)
     return (0);
-  }
 
   if ((bytes = cupsFileRead(fp, (char *)buffer, sizeof(buffer))) < 3)
   {
     fputs("ERROR: Unable to read JPEG file.\n", stderr);
-    cupsFileClose(fp);
+    close_document(fp);
     return (0);
   }
 
   if (memcmp(buffer, "\377\330\377", 3))
   {
     fputs("ERROR: Bad JPEG file.\n", stderr);
-    cupsFileClose(fp);
+    close_document(fp);
     return (0);
   }
 
@@ -307,7 +768,7 @@ lint_jpeg(const char    *filename,	/* I - File to check */
 	if ((bytes = cupsFileRead(fp, (char *)buffer, sizeof(buffer))) <= 0)
 	{
 	  fputs("ERROR: Short JPEG file.\n", stderr);
-	  cupsFileClose(fp);
+	  close_document(fp);
 	  return (0);
 	}
 
@@ -333,7 +794,7 @@ lint_jpeg(const char    *filename,	/* I - File to check */
 	if ((bytes = cupsFileRead(fp, (char *)bufend, sizeof(buffer) - (size_t)bytes)) <= 0)
 	{
 	  fputs("ERROR: Short JPEG file.\n", stderr);
-	  cupsFileClose(fp);
+	  close_document(fp);
 	  return (0);
 	}
 
@@ -380,7 +841,7 @@ lint_jpeg(const char    *filename,	/* I - File to check */
 	if ((bytes = cupsFileRead(fp, (char *)buffer, sizeof(buffer))) <= 0)
 	{
 	  fputs("ERROR: Short JPEG file.\n", stderr);
-	  cupsFileClose(fp);
+	  close_document(fp);
 	  return (0);
 	}
 
@@ -395,6 +856,8 @@ lint_jpeg(const char    *filename,	/* I - File to check */
     }
   }
 
+  close_document(fp);
+
   return (1);
 }
 
@@ -652,11 +1115,8 @@ lint_raster(const char *filename,	/* I - File to check */
 
   (void)content_type;
 
-  if ((fp = cupsFileOpen(filename, "rb")) == NULL)
-  {
-    fprintf(stderr, "ERROR: Unable to open \"%s\": %s\n", filename, cupsLastErrorString());
+  if ((fp = open_document(filename)) == NULL)
     return (0);
-  }
 
   if (!_cups_strcasecmp(content_type, "image/pwg-raster"))
   {
@@ -716,7 +1176,7 @@ lint_raster(const char *filename,	/* I - File to check */
     }
   }
 
-  cupsFileClose(fp);
+  close_document(fp);
 
   return (Errors == 0);
 }
@@ -788,6 +1248,54 @@ load_env_options(
 }
 
 
+/*
+ * 'open_document()' - Open a document file, or the standard input for "-".
+ */
+
+static cups_file_t *			/* O - File or `NULL` on error */
+open_document(const char *filename)	/* I - File to open */
+{
+  cups_file_t	*fp;			/* File pointer */
+
+
+  if (!strcmp(filename, "-"))
+    fp = cupsFileStdin();
+  else
+    fp = cupsFileOpen(filename, "rb");
+
+  if (!fp)
+    fprintf(stderr, "ERROR: Unable to open \"%s\": %s\n", filename, cupsLastErrorString());
+
+  return (fp);
+}
+
+
+/*
+ * 'put_json_string()' - Write a JSON string to the standard output.
+ */
+
+static void
+put_json_string(const char *s)		/* I - String */
+{
+  putchar('\"');
+
+  for (; *s; s ++)
+  {
+    if (*s == '\"' || *s == '\\')
+    {
+      putchar('\\');
+      putchar(*s);
+    }
+    else if ((*s & 255) < ' ')
+      printf("\\u%04x", *s);
+    else
+      putchar(*s);
+  }
+
+  putchar('\"');
+}
+
+
 /*
  * 'read_apple_raster_header()' - Read a page header from an Apple raster file.
  */
@@ -1505,6 +2013,9 @@ read_raster_image(
       * Check for blank/color...
       */
 
+      if (Fast)
+        continue;
+
       if (blank && (buffer[0] != white || memcmp(buffer, buffer + 1, bytes - 1)))
         blank = 0;
 
@@ -1572,6 +2083,16 @@ read_raster_image(
     }
   }
 
+  if (Fast)
+  {
+   /*
+    * Pixels were not checked, so classify the page using its color space...
+    */
+
+    blank = 0;
+    color = header->cupsNumColors > 1;
+  }
+
   fprintf(stderr, "DEBUG: %s-sided %s\n", header->Duplex ? "two" : "one", blank ? "blank" : color ? "full-color" : "monochrome");
 
   if (header->Duplex)
@@ -1604,6 +2125,44 @@ read_raster_image(
 }
 
 
+/*
+ * 'spool_document()' - Copy the standard input to a temporary file.
+ */
+
+static int				/* O - 1 on success, 0 on error */
+spool_document(char   *tempfile,	/* I - Temporary filename buffer */
+               size_t tempsize)		/* I - Size of filename buffer */
+{
+  cups_file_t	*fp;			/* Temporary file */
+  char		buffer[65536];		/* Copy buffer */
+  ssize_t	bytes;			/* Bytes read */
+
+
+  if ((fp = cupsTempFile2(tempfile, (int)tempsize)) == NULL)
+  {
+    fprintf(stderr, "ERROR: Unable to create temporary file: %s\n", cupsLastErrorString());
+    tempfile[0] = '\0';
+    return (0);
+  }
+
+  while ((bytes = cupsFileRead(cupsFileStdin(), buffer, sizeof(buffer))) > 0)
+  {
+    if (cupsFileWrite(fp, buffer, (size_t)bytes) < 0)
+    {
+      fprintf(stderr, "ERROR: Unable to write temporary file: %s\n", strerror(errno));
+      cupsFileClose(fp);
+      unlink(tempfile);
+      tempfile[0] = '\0';
+      return (0);
+    }
+  }
+
+  cupsFileClose(fp);
+
+  return (1);
+}
+
+
 /*
  * 'usage()' - Show program usage.
  */
@@ -1611,11 +2170,16 @@ read_raster_image(
 static void
 usage(int status)			/* I - Exit status */
 {
-  puts("Usage: ippdoclint [options] filename");
+  puts("Usage: ippdoclint [options] filename|-");
+  puts("       ippdoclint [options] --csv|--json filename|directory ...");
   puts("Options:");
+  puts("  --csv               Write a CSV summary (batch mode).");
   puts("  --help              Show program usage.");
+  puts("  --json              Write a JSON summary (batch mode).");
   puts("  --version           Show program version.");
+  puts("  -f                  Only check headers and structure (fast).");
   puts("  -i content-type     Set MIME media type for file.");
+  puts("  -j jobs             Check files on this many processes (batch mode).");
   puts("  -o name=value       Set print options.");
   puts("  -v                  Be verbose.");
 
@@ -21,6 +21,8 @@
 
 #include <cups/cups-private.h>
 #include <cups/debug-private.h>
+#include <cups/dir.h>
+#include <cups/raster.h>
 #if !CUPS_LITE
 #  include <cups/ppd-private.h>
 #endif /* !CUPS_LITE */
@@ -45,6 +47,12 @@ extern char **environ;
 #  include <poll.h>
 #endif /* _WIN32 */
 
+#ifdef HAVE_EPOLL
+#  include <sys/epoll.h>
+#elif defined(HAVE_KQUEUE)
+#  include <sys/event.h>
+#endif /* HAVE_EPOLL */
+
 #ifdef HAVE_DNSSD
 #  include <dns_sd.h>
 #elif defined(HAVE_AVAHI)
@@ -171,12 +179,6 @@ typedef struct ippeve_authdata_s	/* Authentication data */
 } ippeve_authdata_t;
 #endif /* HAVE_LIBPAM */
 
-typedef struct ippeve_filter_s		/**** Attribute filter ****/
-{
-  cups_array_t		*ra;		/* Requested attributes */
-  ipp_tag_t		group_tag;	/* Group to copy */
-} ippeve_filter_t;
-
 typedef struct ippeve_job_s ippeve_job_t;
 
 typedef struct ippeve_printer_s		/**** Printer data ****/
@@ -205,7 +207,8 @@ typedef struct ippeve_printer_s		/**** Printer data ****/
 #if !CUPS_LITE
 			*ppdfile,	/* PPD file (if any) */
 #endif /* !CUPS_LITE */
-			*command;	/* Command to run with job file */
+			*command,	/* Command to run with job file */
+			*resource;	/* Resource path for IPP requests */
   int			port;		/* Port */
   int			web_forms;	/* Enable web interface forms? */
   size_t		urilen;		/* Length of printer URI */
@@ -261,6 +264,8 @@ typedef struct ippeve_client_s		/**** Client data ****/
 					/* Authenticated username, if any */
   ippeve_printer_t	*printer;	/* Printer */
   ippeve_job_t		*job;		/* Current job, if any */
+  int			started;	/* Has the first request been seen? */
+  time_t		idle;		/* Time connection became idle */
 } ippeve_client_t;
 
 
@@ -270,16 +275,17 @@ typedef struct ippeve_client_s		/**** Client data ****/
 
 static http_status_t	authenticate_request(ippeve_client_t *client);
 static void		clean_jobs(ippeve_printer_t *printer);
+#if defined(HAVE_EPOLL) || defined(HAVE_KQUEUE)
+static int		compare_clients(ippeve_client_t *a, ippeve_client_t *b);
+#endif /* HAVE_EPOLL || HAVE_KQUEUE */
 static int		compare_jobs(ippeve_job_t *a, ippeve_job_t *b);
-static void		copy_attributes(ipp_t *to, ipp_t *from, cups_array_t *ra, ipp_tag_t group_tag, int quickcopy);
 static void		copy_job_attributes(ippeve_client_t *client, ippeve_job_t *job, cups_array_t *ra);
 static ippeve_client_t	*create_client(ippeve_printer_t *printer, int sock);
 static ippeve_job_t	*create_job(ippeve_client_t *client);
-static int		create_job_file(ippeve_job_t *job, char *fname, size_t fnamesize, const char *dir, const char *ext);
 static int		create_listener(const char *name, int port, int family);
 static ipp_t		*create_media_col(const char *media, const char *source, const char *type, int width, int length, int bottom, int left, int right, int top);
 static ipp_t		*create_media_size(int width, int length);
-static ippeve_printer_t	*create_printer(const char *servername, int serverport, const char *name, const char *location, const char *icons, const char *strings, cups_array_t *docformats, const char *subtypes, const char *directory, const char *command, const char *device_uri, const char *output_format, ipp_t *attrs);
+static ippeve_printer_t	*create_printer(const char *servername, int serverport, const char *name, const char *resource, const char *location, const char *icons, const char *strings, cups_array_t *docformats, const char *subtypes, const char *directory, const char *command, const char *device_uri, const char *output_format, ipp_t *attrs);
 static void		debug_attributes(const char *title, ipp_t *ipp, int response);
 static void		delete_client(ippeve_client_t *client);
 static void		delete_job(ippeve_job_t *job);
@@ -291,8 +297,8 @@ static void		dnssd_callback(AvahiEntryGroup *p, AvahiEntryGroupState state, void
 static void		dnssd_client_cb(AvahiClient *c, AvahiClientState state, void *userdata);
 #endif /* HAVE_DNSSD */
 static void		dnssd_init(void);
-static int		filter_cb(ippeve_filter_t *filter, ipp_t *dst, ipp_attribute_t *attr);
 static ippeve_job_t	*find_job(ippeve_client_t *client);
+static ippeve_printer_t	*find_printer(const char *resource, int is_job);
 static void		finish_document_data(ippeve_client_t *client, ippeve_job_t *job);
 static void		finish_document_uri(ippeve_client_t *client, ippeve_job_t *job);
 static void		html_escape(ippeve_client_t *client, const char *s, size_t slen);
@@ -317,6 +323,9 @@ static ipp_t		*load_legacy_attributes(const char *make, const char *model, int p
 #if !CUPS_LITE
 static ipp_t		*load_ppd_attributes(const char *ppdfile, cups_array_t *docformats);
 #endif /* !CUPS_LITE */
+#ifdef HAVE_SSL
+static int		negotiate_tls(ippeve_client_t *client);
+#endif /* HAVE_SSL */
 #if HAVE_LIBPAM
 static int		pam_func(int, const struct pam_message **, struct pam_response **, void *);
 #endif /* HAVE_LIBPAM */
@@ -331,14 +340,26 @@ static int		register_printer(ippeve_printer_t *printer);
 static int		respond_http(ippeve_client_t *client, http_status_t code, const char *content_coding, const char *type, size_t length);
 static void		respond_ipp(ippeve_client_t *client, ipp_status_t status, const char *message, ...) _CUPS_FORMAT(3, 4);
 static void		respond_unsupported(ippeve_client_t *client, ipp_attribute_t *attr);
+#if defined(HAVE_EPOLL) || defined(HAVE_KQUEUE)
+static void		*run_client_events(void *data);
+static void		*run_client_worker(void *data);
+#endif /* HAVE_EPOLL || HAVE_KQUEUE */
+static void		*run_job_worker(void *data);
 static void		run_printer(ippeve_printer_t *printer);
 static int		show_media(ippeve_client_t *client);
 static int		show_status(ippeve_client_t *client);
 static int		show_supplies(ippeve_client_t *client);
+static void		sink_job(ippeve_job_t *job);
+static void		sink_wait(struct timeval *start, double delay);
+static int		start_job(ippeve_job_t *job);
+static int		start_workers(void);
 static char		*time_string(time_t tv, char *buffer, size_t bufsize);
 static void		usage(int status) _CUPS_NORETURN;
 static int		valid_doc_attributes(ippeve_client_t *client);
 static int		valid_job_attributes(ippeve_client_t *client);
+#if defined(HAVE_EPOLL) || defined(HAVE_KQUEUE)
+static void		watch_client(ippeve_client_t *client);
+#endif /* HAVE_EPOLL || HAVE_KQUEUE */
 
 
 /*
@@ -352,6 +373,33 @@ static AvahiThreadedPoll *DNSSDMaster = NULL;
 static AvahiClient	*DNSSDClient = NULL;
 #endif /* HAVE_DNSSD */
 
+static int		ClientWorkers = 0,
+					/* Number of client worker threads */
+			JobWorkers = 0;	/* Number of job worker threads */
+#if defined(HAVE_EPOLL) || defined(HAVE_KQUEUE)
+static int		ClientEvents = -1;
+					/* epoll/kqueue descriptor for idle clients */
+static _cups_mutex_t	ClientMutex = _CUPS_MUTEX_INITIALIZER;
+					/* Mutex for client queues */
+static _cups_cond_t	ClientCond = _CUPS_COND_INITIALIZER;
+					/* Condition for ready clients */
+static cups_array_t	*ClientIdle = NULL,
+					/* Idle (keep-alive) clients */
+			*ClientReady = NULL;
+					/* Clients with a pending request */
+#endif /* HAVE_EPOLL || HAVE_KQUEUE */
+static _cups_mutex_t	JobMutex = _CUPS_MUTEX_INITIALIZER;
+					/* Mutex for job queue */
+static _cups_cond_t	JobCond = _CUPS_COND_INITIALIZER;
+					/* Condition for queued jobs */
+static cups_array_t	*JobQueue = NULL;
+					/* Jobs waiting for a job worker */
+static int		NumPrinters = 0;/* Number of printers */
+static int		SinkPPM = -1,	/* Built-in sink speed or -1 to sleep */
+			SinkColorPPM = 0;
+					/* Built-in sink color speed */
+static ippeve_printer_t	**Printers = NULL;
+					/* Printers, the first owns the listeners */
 static int		KeepFiles = 0,	/* Keep spooled job files? */
 			MaxVersion = 20,/* Maximum IPP version (20 = 2.0, 11 = 1.1, etc.) */
 			Verbosity = 0;	/* Verbosity level */
@@ -384,6 +432,7 @@ main(int  argc,				/* I - Number of command-line args */
 #if !CUPS_LITE
 		*ppdfile = NULL,	/* PPD file */
 #endif /* !CUPS_LITE */
+		*printers = NULL,	/* Directory of additional printers */
 		*strings = NULL,	/* Strings file */
 		*subtypes = "_print";	/* DNS-SD service subtype */
   int		legacy = 0,		/* Legacy mode? */
@@ -405,10 +454,22 @@ main(int  argc,				/* I - Number of command-line args */
 
   for (i = 1; i < argc; i ++)
   {
-    if (!strcmp(argv[i], "--help"))
+    if (!strcmp(argv[i], "--client-workers"))
+    {
+      i ++;
+      if (i >= argc || (ClientWorkers = atoi(argv[i])) < 1)
+        usage(1);
+    }
+    else if (!strcmp(argv[i], "--help"))
     {
       usage(0);
     }
+    else if (!strcmp(argv[i], "--job-workers"))
+    {
+      i ++;
+      if (i >= argc || (JobWorkers = atoi(argv[i])) < 1)
+        usage(1);
+    }
     else if (!strcmp(argv[i], "--no-web-forms"))
     {
       web_forms = 0;
@@ -421,6 +482,20 @@ main(int  argc,				/* I - Number of command-line args */
 
       PAMService = argv[i];
     }
+    else if (!strcmp(argv[i], "--printers"))
+    {
+      i ++;
+      if (i >= argc)
+        usage(1);
+
+      printers = argv[i];
+    }
+    else if (!strcmp(argv[i], "--sink"))
+    {
+      i ++;
+      if (i >= argc || !isdigit(argv[i][0] & 255) || sscanf(argv[i], "%d,%d", &SinkPPM, &SinkColorPPM) < 1 || SinkColorPPM < 0)
+        usage(1);
+    }
     else if (!strcmp(argv[i], "--version"))
     {
       puts(CUPS_SVERSION);
@@ -724,7 +799,7 @@ main(int  argc,				/* I - Number of command-line args */
   else
     attrs = load_legacy_attributes(make, model, ppm, ppm_color, duplex, docformats);
 
-  if ((printer = create_printer(servername, serverport, name, location, icon, strings, docformats, subtypes, directory, command, device_uri, output_format, attrs)) == NULL)
+  if ((printer = create_printer(servername, serverport, name, "/ipp/print", location, icon, strings, docformats, subtypes, directory, command, device_uri, output_format, attrs)) == NULL)
     return (1);
 
   printer->web_forms = web_forms;
@@ -734,21 +809,85 @@ main(int  argc,				/* I - Number of command-line args */
     printer->ppdfile = strdup(ppdfile);
 #endif /* !CUPS_LITE */
 
+  if (printers)
+  {
+   /*
+    * Create additional printers from the "NAME.conf" ippserver attribute files
+    * in the directory.  They share the listeners, worker threads, and DNS-SD
+    * connection with the first printer and use the resource path
+    * "/ipp/print/NAME"...
+    */
+
+    cups_dir_t		*dir;		/* Printer directory */
+    cups_dentry_t	*dent;		/* Directory entry */
+    char		*ext,		/* Extension on filename */
+			pname[256],	/* Printer name */
+			filename[1024],	/* Attribute filename */
+			resource[1024],	/* Resource path */
+			pdirectory[1024];
+					/* Spool directory for printer */
+    ippeve_printer_t	*hosted;	/* Additional printer */
+
+    if ((dir = cupsDirOpen(printers)) == NULL)
+    {
+      _cupsLangPrintf(stderr, _("Unable to open printer directory \"%s\": %s"), printers, strerror(errno));
+      return (1);
+    }
+
+    while ((dent = cupsDirRead(dir)) != NULL)
+    {
+      if ((ext = strrchr(dent->filename, '.')) == NULL || strcmp(ext, ".conf") || ext == dent->filename || (size_t)(ext - dent->filename) >= sizeof(pname))
+        continue;
+
+      strlcpy(pname, dent->filename, (size_t)(ext - dent->filename) + 1);
+
+      snprintf(filename, sizeof(filename), "%s/%s", printers, dent->filename);
+      snprintf(resource, sizeof(resource), "/ipp/print/%s", pname);
+      snprintf(pdirectory, sizeof(pdirectory), "%s/%s", directory, pname);
+
+      if (mkdir(pdirectory, 0755) && errno != EEXIST)
+      {
+	_cupsLangPrintf(stderr, _("Unable to create spool directory \"%s\": %s"), pdirectory, strerror(errno));
+	return (1);
+      }
+
+      if ((attrs = load_ippserver_attributes(servername, serverport, filename, docformats)) == NULL)
+      {
+        _cupsLangPrintf(stderr, _("Unable to load printer attributes from \"%s\"."), filename);
+        return (1);
+      }
+
+      if ((hosted = create_printer(servername, serverport, pname, resource, location, icon, strings, docformats, subtypes, pdirectory, command, device_uri, output_format, attrs)) == NULL)
+        return (1);
+
+      hosted->web_forms = web_forms;
+
+      if (Verbosity)
+        _cupsLangPrintf(stderr, _("Added printer \"%s\" at \"%s\"."), pname, resource);
+    }
+
+    cupsDirClose(dir);
+  }
+
 #ifdef HAVE_SSL
   cupsSetServerCredentials(keypath, printer->hostname, 1);
 #endif /* HAVE_SSL */
 
  /*
-  * Run the print service...
+  * Start any worker threads and run the print service...
   */
 
+  if (!start_workers())
+    return (1);
+
   run_printer(printer);
 
  /*
-  * Destroy the printer and exit...
+  * Destroy the printers and exit...
   */
 
-  delete_printer(printer);
+  for (i = 0; i < NumPrinters; i ++)
+    delete_printer(Printers[i]);
 
   return (0);
 }
@@ -884,36 +1023,34 @@ clean_jobs(ippeve_printer_t *printer)	/* I - Printer */
 }
 
 
+#if defined(HAVE_EPOLL) || defined(HAVE_KQUEUE)
 /*
- * 'compare_jobs()' - Compare two jobs.
+ * 'compare_clients()' - Compare two clients.
  */
 
 static int				/* O - Result of comparison */
-compare_jobs(ippeve_job_t *a,		/* I - First job */
-             ippeve_job_t *b)		/* I - Second job */
+compare_clients(ippeve_client_t *a,	/* I - First client */
+                ippeve_client_t *b)	/* I - Second client */
 {
-  return (b->id - a->id);
+  if (a < b)
+    return (-1);
+  else if (a > b)
+    return (1);
+  else
+    return (0);
 }
+#endif /* HAVE_EPOLL || HAVE_KQUEUE */
 
 
 /*
- * 'copy_attributes()' - Copy attributes from one request to another.
+ * 'compare_jobs()' - Compare two jobs.
  */
 
-static void
-copy_attributes(ipp_t        *to,	/* I - Destination request */
-	        ipp_t        *from,	/* I - Source request */
-	        cups_array_t *ra,	/* I - Requested attributes */
-	        ipp_tag_t    group_tag,	/* I - Group to copy */
-	        int          quickcopy)	/* I - Do a quick copy? */
+static int				/* O - Result of comparison */
+compare_jobs(ippeve_job_t *a,		/* I - First job */
+             ippeve_job_t *b)		/* I - Second job */
 {
-  ippeve_filter_t	filter;			/* Filter data */
-
-
-  filter.ra        = ra;
-  filter.group_tag = group_tag;
-
-  ippCopyAttributes(to, from, quickcopy, (ipp_copycb_t)filter_cb, &filter);
+  return (b->id - a->id);
 }
 
 
@@ -927,7 +1064,7 @@ copy_job_attributes(
     ippeve_job_t    *job,			/* I - Job */
     cups_array_t  *ra)			/* I - requested-attributes */
 {
-  copy_attributes(client->response, job->attrs, ra, IPP_TAG_JOB, 0);
+  _ippServerCopyAttributes(client->response, job->attrs, ra, NULL, IPP_TAG_JOB, 0);
 
   if (!ra || cupsArrayFind(ra, "date-time-at-completed"))
   {
@@ -1167,7 +1304,7 @@ create_job(ippeve_client_t *client)	/* I - Client */
   * Copy all of the job attributes...
   */
 
-  copy_attributes(job->attrs, client->request, NULL, IPP_TAG_JOB, 0);
+  _ippServerCopyAttributes(job->attrs, client->request, NULL, NULL, IPP_TAG_JOB, 0);
 
  /*
   * Get the requesting-user-name, document format, and priority...
@@ -1205,7 +1342,7 @@ create_job(ippeve_client_t *client)	/* I - Client */
   if ((attr = ippFindAttribute(client->request, "printer-uri", IPP_TAG_URI)) != NULL)
     snprintf(uri, sizeof(uri), "%s/%d", ippGetString(attr, 0, NULL), job->id);
   else
-    httpAssembleURIf(HTTP_URI_CODING_ALL, uri, sizeof(uri), "ipp", NULL, client->printer->hostname, client->printer->port, "/ipp/print/%d", job->id);
+    httpAssembleURIf(HTTP_URI_CODING_ALL, uri, sizeof(uri), "ipp", NULL, client->printer->hostname, client->printer->port, "%s/%d", client->printer->resource, job->id);
 
   httpAssembleUUID(client->printer->hostname, client->printer->port, client->printer->name, job->id, uuid, sizeof(uuid));
 
@@ -1221,7 +1358,7 @@ create_job(ippeve_client_t *client)	/* I - Client */
   {
     char printer_uri[1024];		/* job-printer-uri value */
 
-    httpAssembleURI(HTTP_URI_CODING_ALL, printer_uri, sizeof(printer_uri), "ipp", NULL, client->printer->hostname, client->printer->port, "/ipp/print");
+    httpAssembleURI(HTTP_URI_CODING_ALL, printer_uri, sizeof(printer_uri), "ipp", NULL, client->printer->hostname, client->printer->port, client->printer->resource);
     ippAddString(job->attrs, IPP_TAG_JOB, IPP_TAG_URI, "job-printer-uri", NULL, printer_uri);
   }
 
@@ -1236,81 +1373,6 @@ create_job(ippeve_client_t *client)	/* I - Client */
 }
 
 
-/*
- * 'create_job_file()' - Create a file for the document in a job.
- */
-
-static int				/* O - File descriptor or -1 on error */
-create_job_file(
-    ippeve_job_t     *job,		/* I - Job */
-    char             *fname,		/* I - Filename buffer */
-    size_t           fnamesize,		/* I - Size of filename buffer */
-    const char       *directory,	/* I - Directory to store in */
-    const char       *ext)		/* I - Extension (`NULL` for default) */
-{
-  char			name[256],	/* "Safe" filename */
-			*nameptr;	/* Pointer into filename */
-  const char		*job_name;	/* job-name value */
-
-
- /*
-  * Make a name from the job-name attribute...
-  */
-
-  if ((job_name = ippGetString(ippFindAttribute(job->attrs, "job-name", IPP_TAG_NAME), 0, NULL)) == NULL)
-    job_name = "untitled";
-
-  for (nameptr = name; *job_name && nameptr < (name + sizeof(name) - 1); job_name ++)
-  {
-    if (isalnum(*job_name & 255) || *job_name == '-')
-    {
-      *nameptr++ = (char)tolower(*job_name & 255);
-    }
-    else
-    {
-      *nameptr++ = '_';
-
-      while (job_name[1] && !isalnum(job_name[1] & 255) && job_name[1] != '-')
-        job_name ++;
-    }
-  }
-
-  *nameptr = '\0';
-
- /*
-  * Figure out the extension...
-  */
-
-  if (!ext)
-  {
-    if (!strcasecmp(job->format, "image/jpeg"))
-      ext = "jpg";
-    else if (!strcasecmp(job->format, "image/png"))
-      ext = "png";
-    else if (!strcasecmp(job->format, "image/pwg-raster"))
-      ext = "pwg";
-    else if (!strcasecmp(job->format, "image/urf"))
-      ext = "urf";
-    else if (!strcasecmp(job->format, "application/pdf"))
-      ext = "pdf";
-    else if (!strcasecmp(job->format, "application/postscript"))
-      ext = "ps";
-    else if (!strcasecmp(job->format, "application/vnd.hp-pcl"))
-      ext = "pcl";
-    else
-      ext = "dat";
-  }
-
- /*
-  * Create a filename with the job-id, job-name, and document-format (extension)...
-  */
-
-  snprintf(fname, fnamesize, "%s/%d-%s.%s", directory, job->id, name, ext);
-
-  return (open(fname, O_WRONLY | O_CREAT | O_TRUNC, 0666));
-}
-
-
 /*
  * 'create_listener()' - Create a listener socket.
  */
@@ -1421,6 +1483,7 @@ create_printer(
     const char   *servername,		/* I - Server hostname (NULL for default) */
     int          serverport,		/* I - Server port */
     const char   *name,			/* I - printer-name */
+    const char   *resource,		/* I - Resource path for IPP requests */
     const char   *location,		/* I - printer-location */
     const char   *icons,		/* I - printer-icons */
     const char   *strings,		/* I - printer-strings-uri */
@@ -1665,6 +1728,7 @@ create_printer(
   printer->ipv4           = -1;
   printer->ipv6           = -1;
   printer->name           = strdup(name);
+  printer->resource       = strdup(resource);
   printer->dnssd_name     = strdup(name);
   printer->dnssd_subtypes = subtypes ? strdup(subtypes) : NULL;
   printer->command        = command ? strdup(command) : NULL;
@@ -1726,19 +1790,22 @@ create_printer(
   _cupsRWInit(&(printer->rwlock));
 
  /*
-  * Create the listener sockets...
+  * Create the listener sockets, which are shared by any additional printers...
   */
 
-  if ((printer->ipv4 = create_listener(servername, printer->port, AF_INET)) < 0)
+  if (!NumPrinters)
   {
-    perror("Unable to create IPv4 listener");
-    goto bad_printer;
-  }
+    if ((printer->ipv4 = create_listener(servername, printer->port, AF_INET)) < 0)
+    {
+      perror("Unable to create IPv4 listener");
+      goto bad_printer;
+    }
 
-  if ((printer->ipv6 = create_listener(servername, printer->port, AF_INET6)) < 0)
-  {
-    perror("Unable to create IPv6 listener");
-    goto bad_printer;
+    if ((printer->ipv6 = create_listener(servername, printer->port, AF_INET6)) < 0)
+    {
+      perror("Unable to create IPv6 listener");
+      goto bad_printer;
+    }
   }
 
  /*
@@ -1752,9 +1819,9 @@ create_printer(
   if (Verbosity)
   {
 #ifdef HAVE_SSL
-    fprintf(stderr, "printer-uri-supported=\"ipp://%s:%d/ipp/print\",\"ipps://%s:%d/ipp/print\"\n", printer->hostname, printer->port, printer->hostname, printer->port);
+    fprintf(stderr, "printer-uri-supported=\"ipp://%s:%d%s\",\"ipps://%s:%d%s\"\n", printer->hostname, printer->port, printer->resource, printer->hostname, printer->port, printer->resource);
 #else
-    fprintf(stderr, "printer-uri-supported=\"ipp://%s:%d/ipp/print\"\n", printer->hostname, printer->port);
+    fprintf(stderr, "printer-uri-supported=\"ipp://%s:%d%s\"\n", printer->hostname, printer->port, printer->resource);
 #endif /* HAVE_SSL */
     fprintf(stderr, "printer-uuid=\"%s\"\n", uuid);
   }
@@ -1974,9 +2041,17 @@ create_printer(
     goto bad_printer;
 
  /*
-  * Return it!
+  * Add it to the list of printers and return it!
   */
 
+  if ((Printers = realloc(Printers, (size_t)(NumPrinters + 1) * sizeof(ippeve_printer_t *))) == NULL)
+  {
+    _cupsLangPrintError(NULL, _("Unable to allocate memory for printer"));
+    goto bad_printer;
+  }
+
+  Printers[NumPrinters ++] = printer;
+
   return (printer);
 
 
@@ -2142,6 +2217,8 @@ delete_printer(ippeve_printer_t *printer)	/* I - Printer */
     free(printer->strings);
   if (printer->command)
     free(printer->command);
+  if (printer->resource)
+    free(printer->resource);
   if (printer->device_uri)
     free(printer->device_uri);
 #if !CUPS_LITE
@@ -2284,33 +2361,6 @@ dnssd_init(void)
 }
 
 
-/*
- * 'filter_cb()' - Filter printer attributes based on the requested array.
- */
-
-static int				/* O - 1 to copy, 0 to ignore */
-filter_cb(ippeve_filter_t   *filter,	/* I - Filter parameters */
-          ipp_t           *dst,		/* I - Destination (unused) */
-	  ipp_attribute_t *attr)	/* I - Source attribute */
-{
- /*
-  * Filter attributes as needed...
-  */
-
-#ifndef _WIN32 /* Avoid MS compiler bug */
-  (void)dst;
-#endif /* !_WIN32 */
-
-  ipp_tag_t group = ippGetGroupTag(attr);
-  const char *name = ippGetName(attr);
-
-  if ((filter->group_tag != IPP_TAG_ZERO && group != filter->group_tag && group != IPP_TAG_ZERO) || !name || (!strcmp(name, "media-col-database") && !cupsArrayFind(filter->ra, (void *)name)))
-    return (0);
-
-  return (!filter->ra || cupsArrayFind(filter->ra, (void *)name) != NULL);
-}
-
-
 /*
  * 'find_job()' - Find a job specified in a request.
  */
@@ -2346,6 +2396,38 @@ find_job(ippeve_client_t *client)		/* I - Client */
 }
 
 
+/*
+ * 'find_printer()' - Find the printer for a printer or job resource path.
+ *
+ * For job resources the trailing "/job-id" component is ignored.
+ */
+
+static ippeve_printer_t *		/* O - Printer or `NULL` */
+find_printer(const char *resource,	/* I - Resource path */
+             int        is_job)		/* I - Resource is for a job? */
+{
+  int		i;			/* Looping var */
+  size_t	len;			/* Length to compare */
+  const char	*ptr;			/* Last slash in resource */
+
+
+  if (!is_job)
+    len = strlen(resource);
+  else if ((ptr = strrchr(resource, '/')) != NULL && ptr > resource)
+    len = (size_t)(ptr - resource);
+  else
+    return (NULL);
+
+  for (i = 0; i < NumPrinters; i ++)
+  {
+    if (!strncmp(resource, Printers[i]->resource, len) && !Printers[i]->resource[len])
+      return (Printers[i]);
+  }
+
+  return (NULL);
+}
+
+
 /*
  * 'finish_document()' - Finish receiving a document file and start processing.
  */
@@ -2359,7 +2441,6 @@ finish_document_data(
 			buffer[4096];	/* Copy buffer */
   ssize_t		bytes;		/* Bytes read */
   cups_array_t		*ra;		/* Attributes to send in response */
-  _cups_thread_t        t;              /* Thread */
 
 
  /*
@@ -2368,7 +2449,7 @@ finish_document_data(
   * TODO: Update code to support piping large raster data to the print command.
   */
 
-  if ((job->fd = create_job_file(job, filename, sizeof(filename), client->printer->directory, NULL)) < 0)
+  if ((job->fd = _ippServerCreateJobFile(job->id, job->attrs, job->format, filename, sizeof(filename), client->printer->directory, NULL)) < 0)
   {
     respond_ipp(client, IPP_STATUS_ERROR_INTERNAL, "Unable to create print file: %s", strerror(errno));
 
@@ -2432,13 +2513,7 @@ finish_document_data(
   * Process the job...
   */
 
-  t = _cupsThreadCreate((_cups_thread_func_t)process_job, job);
-
-  if (t)
-  {
-    _cupsThreadDetach(t);
-  }
-  else
+  if (!start_job(job))
   {
     respond_ipp(client, IPP_STATUS_ERROR_INTERNAL, "Unable to process job.");
     goto abort_job;
@@ -2581,7 +2656,7 @@ finish_document_uri(
   * Create a file for the request data...
   */
 
-  if ((job->fd = create_job_file(job, filename, sizeof(filename), client->printer->directory, NULL)) < 0)
+  if ((job->fd = _ippServerCreateJobFile(job->id, job->attrs, job->format, filename, sizeof(filename), client->printer->directory, NULL)) < 0)
   {
     _cupsRWUnlock(&(client->printer->rwlock));
 
@@ -3548,7 +3623,7 @@ ipp_get_printer_attributes(
 
   _cupsRWLockRead(&(printer->rwlock));
 
-  copy_attributes(client->response, printer->attrs, ra, IPP_TAG_ZERO,
+  _ippServerCopyAttributes(client->response, printer->attrs, ra, NULL, IPP_TAG_ZERO,
 		  IPP_TAG_CUPS_CONST);
 
   if (!ra || cupsArrayFind(ra, "printer-config-change-date-time"))
@@ -3652,11 +3727,11 @@ ipp_get_printer_attributes(
     const char	*values[2];		/* Values for attribute */
     int		num_values = 0;		/* Number of values */
 
-    httpAssembleURI(HTTP_URI_CODING_ALL, uris[0], sizeof(uris[0]), "ipp", NULL, client->host_field, client->host_port, "/ipp/print");
+    httpAssembleURI(HTTP_URI_CODING_ALL, uris[0], sizeof(uris[0]), "ipp", NULL, client->host_field, client->host_port, client->printer->resource);
     values[num_values ++] = uris[0];
 
 #ifdef HAVE_SSL
-    httpAssembleURI(HTTP_URI_CODING_ALL, uris[1], sizeof(uris[1]), "ipps", NULL, client->host_field, client->host_port, "/ipp/print");
+    httpAssembleURI(HTTP_URI_CODING_ALL, uris[1], sizeof(uris[1]), "ipps", NULL, client->host_field, client->host_port, client->printer->resource);
     values[num_values ++] = uris[1];
 #endif /* HAVE_SSL */
 
@@ -3880,7 +3955,7 @@ ipp_send_document(
 
   _cupsRWLockWrite(&(client->printer->rwlock));
 
-  copy_attributes(job->attrs, client->request, NULL, IPP_TAG_JOB, 0);
+  _ippServerCopyAttributes(job->attrs, client->request, NULL, NULL, IPP_TAG_JOB, 0);
 
   if ((attr = ippFindAttribute(job->attrs, "document-format-detected", IPP_TAG_MIMETYPE)) != NULL)
     job->format = ippGetString(attr, 0, NULL);
@@ -3971,7 +4046,7 @@ ipp_send_uri(ippeve_client_t *client)	/* I - Client */
 
   _cupsRWLockWrite(&(client->printer->rwlock));
 
-  copy_attributes(job->attrs, client->request, NULL, IPP_TAG_JOB, 0);
+  _ippServerCopyAttributes(job->attrs, client->request, NULL, NULL, IPP_TAG_JOB, 0);
 
   if ((attr = ippFindAttribute(job->attrs, "document-format-detected", IPP_TAG_MIMETYPE)) != NULL)
     job->format = ippGetString(attr, 0, NULL);
@@ -5553,6 +5628,35 @@ load_ppd_attributes(
 #endif /* !CUPS_LITE */
 
 
+#ifdef HAVE_SSL
+/*
+ * 'negotiate_tls()' - Start a TLS session if the client sent a handshake.
+ */
+
+static int				/* O - 1 on success, 0 on failure */
+negotiate_tls(ippeve_client_t *client)	/* I - Client */
+{
+  char buf[1];				/* First byte from client */
+
+
+  if (recv(httpGetFd(client->http), buf, 1, MSG_PEEK) == 1 && (!buf[0] || !strchr("DGHOPT", buf[0])))
+  {
+    fprintf(stderr, "%s Starting HTTPS session.\n", client->hostname);
+
+    if (httpEncryption(client->http, HTTP_ENCRYPTION_ALWAYS))
+    {
+      fprintf(stderr, "%s Unable to encrypt connection: %s\n", client->hostname, cupsLastErrorString());
+      return (0);
+    }
+
+    fprintf(stderr, "%s Connection now encrypted.\n", client->hostname);
+  }
+
+  return (1);
+}
+#endif /* HAVE_SSL */
+
+
 #if HAVE_LIBPAM
 /*
  * 'pam_func()' - PAM conversation function.
@@ -5743,35 +5847,15 @@ process_client(ippeve_client_t *client)	/* I - Client */
   * Loop until we are out of requests or timeout (30 seconds)...
   */
 
-#ifdef HAVE_SSL
-  int first_time = 1;			/* First time request? */
-#endif /* HAVE_SSL */
-
   while (httpWait(client->http, 30000))
   {
 #ifdef HAVE_SSL
-    if (first_time)
+    if (!client->started)
     {
-     /*
-      * See if we need to negotiate a TLS connection...
-      */
-
-      char buf[1];			/* First byte from client */
-
-      if (recv(httpGetFd(client->http), buf, 1, MSG_PEEK) == 1 && (!buf[0] || !strchr("DGHOPT", buf[0])))
-      {
-        fprintf(stderr, "%s Starting HTTPS session.\n", client->hostname);
-
-	if (httpEncryption(client->http, HTTP_ENCRYPTION_ALWAYS))
-	{
-	  fprintf(stderr, "%s Unable to encrypt connection: %s\n", client->hostname, cupsLastErrorString());
-	  break;
-        }
-
-        fprintf(stderr, "%s Connection now encrypted.\n", client->hostname);
-      }
+      client->started = 1;
 
-      first_time = 0;
+      if (!negotiate_tls(client))
+        break;
     }
 #endif /* HAVE_SSL */
 
@@ -5900,6 +5984,7 @@ process_http(ippeve_client_t *client)	/* I - Client connection */
 
   client->start     = time(NULL);
   client->operation = httpGetState(client->http);
+  client->printer   = Printers[0];
 
  /*
   * Parse incoming parameters until the status changes...
@@ -6268,6 +6353,7 @@ process_ipp(ippeve_client_t *client)	/* I - Client */
   int			major, minor;	/* Version number */
   const char		*name;		/* Name of attribute */
   http_status_t		status;		/* Authentication status */
+  ippeve_printer_t	*printer;	/* Target printer */
 
 
   debug_attributes("Request", client->request, 1);
@@ -6412,11 +6498,9 @@ process_ipp(ippeve_client_t *client)	/* I - Client */
                             resource, sizeof(resource)) < HTTP_URI_STATUS_OK)
 	  respond_ipp(client, IPP_STATUS_ERROR_ATTRIBUTES_OR_VALUES,
 	              "Bad %s value '%s'.", name, ippGetString(uri, 0, NULL));
-        else if ((!strcmp(name, "job-uri") &&
-                  strncmp(resource, "/ipp/print/", 11)) ||
-                 (!strcmp(name, "printer-uri") &&
-                  strcmp(resource, "/ipp/print") &&
-                  (strcmp(resource, "/") || ippGetOperation(client->request) != IPP_OP_GET_PRINTER_ATTRIBUTES)))
+        else if ((printer = find_printer(resource, !strcmp(name, "job-uri"))) == NULL &&
+                 (strcmp(name, "printer-uri") || strcmp(resource, "/") ||
+                  ippGetOperation(client->request) != IPP_OP_GET_PRINTER_ATTRIBUTES))
 	  respond_ipp(client, IPP_STATUS_ERROR_NOT_FOUND, "%s %s not found.",
 		      name, ippGetString(uri, 0, NULL));
 	else if (client->operation_id != IPP_OP_GET_PRINTER_ATTRIBUTES && (status = authenticate_request(client)) != HTTP_STATUS_CONTINUE)
@@ -6427,6 +6511,13 @@ process_ipp(ippeve_client_t *client)	/* I - Client */
         }
         else
 	{
+	 /*
+	  * Route the request to the target printer...
+	  */
+
+	  if (printer)
+	    client->printer = printer;
+
 	 /*
 	  * Handle HTTP Expect...
 	  */
@@ -6746,7 +6837,7 @@ process_job(ippeve_job_t *job)		/* I - Job */
         }
         else if (S_ISDIR(fileinfo.st_mode))
         {
-          if ((mystdout = create_job_file(job, line, sizeof(line), resource, "prn")) >= 0)
+          if ((mystdout = _ippServerCreateJobFile(job->id, job->attrs, job->format, line, sizeof(line), resource, "prn")) >= 0)
 	    fprintf(stderr, "[Job %d] Saving print command output to \"%s\".\n", job->id, line);
           else
             fprintf(stderr, "[Job %d] Unable to create \"%s\": %s\n", job->id, line, strerror(errno));
@@ -6782,7 +6873,7 @@ process_job(ippeve_job_t *job)		/* I - Job */
         fprintf(stderr, "[Job %d] Unsupported device URI scheme \"%s\".\n", job->id, scheme);
       }
     }
-    else if ((mystdout = create_job_file(job, line, sizeof(line), job->printer->directory, "prn")) >= 0)
+    else if ((mystdout = _ippServerCreateJobFile(job->id, job->attrs, job->format, line, sizeof(line), job->printer->directory, "prn")) >= 0)
     {
       fprintf(stderr, "[Job %d] Saving print command output to \"%s\".\n", job->id, line);
     }
@@ -6968,6 +7059,14 @@ process_job(ippeve_job_t *job)		/* I - Job */
 
     fprintf(stderr, "[Job %d] Processing time was %.3f seconds.\n", job->id, end.tv_sec - start.tv_sec + 0.000001 * (end.tv_usec - start.tv_usec));
   }
+  else if (SinkPPM >= 0)
+  {
+   /*
+    * Consume the job file in-process...
+    */
+
+    sink_job(job);
+  }
   else
   {
    /*
@@ -7188,7 +7287,7 @@ register_printer(
   */
 
   TXTRecordCreate(&ipp_txt, 1024, NULL);
-  TXTRecordSetValue(&ipp_txt, "rp", 9, "ipp/print");
+  TXTRecordSetValue(&ipp_txt, "rp", (uint8_t)strlen(printer->resource + 1), printer->resource + 1);
   if ((value = ippGetString(printer_make_and_model, 0, NULL)) != NULL)
     TXTRecordSetValue(&ipp_txt, "ty", (uint8_t)strlen(value), value);
   TXTRecordSetValue(&ipp_txt, "adminurl", (uint8_t)strlen(adminurl), adminurl);
@@ -7295,7 +7394,7 @@ register_printer(
   */
 
   ipp_txt = NULL;
-  ipp_txt = avahi_string_list_add_printf(ipp_txt, "rp=ipp/print");
+  ipp_txt = avahi_string_list_add_printf(ipp_txt, "rp=%s", printer->resource + 1);
   if ((value = ippGetString(printer_make_and_model, 0, NULL)) != NULL)
     ipp_txt = avahi_string_list_add_printf(ipp_txt, "ty=%s", value);
   ipp_txt = avahi_string_list_add_printf(ipp_txt, "adminurl=%s", adminurl);
@@ -7561,103 +7660,309 @@ respond_unsupported(
 }
 
 
+#if defined(HAVE_EPOLL) || defined(HAVE_KQUEUE)
 /*
- * 'run_printer()' - Run the printer service.
+ * 'run_client_events()' - Wait for requests on idle client connections.
+ *
+ * Clients with a pending request are moved to the ready queue for the worker
+ * threads, and clients that stay idle for 30 seconds are closed.
  */
 
-static void
-run_printer(ippeve_printer_t *printer)	/* I - Printer */
+static void *				/* O - Thread exit status */
+run_client_events(void *data)		/* I - Thread data (unused) */
 {
-  int			num_fds;	/* Number of file descriptors */
-  struct pollfd		polldata[3];	/* poll() data */
-  int			timeout;	/* Timeout for poll() */
-  ippeve_client_t	*client;	/* New client */
-
-
- /*
-  * Setup poll() data for the DNS-SD service socket and IPv4/6 listeners...
-  */
-
-  polldata[0].fd     = printer->ipv4;
-  polldata[0].events = POLLIN;
-
-  polldata[1].fd     = printer->ipv6;
-  polldata[1].events = POLLIN;
+  int			i,		/* Looping var */
+			nevents;	/* Number of events */
+  ippeve_client_t	*client;	/* Current client */
+  cups_array_t		*expired;	/* Expired clients */
+  time_t		curtime;	/* Current time */
+#  ifdef HAVE_EPOLL
+  struct epoll_event	events[64];	/* Events */
+#  else
+  struct kevent		event,		/* Delete event */
+			events[64];	/* Events */
+  struct timespec	timeout;	/* Timeout */
+#  endif /* HAVE_EPOLL */
 
-  num_fds = 2;
 
-#ifdef HAVE_DNSSD
-  polldata[num_fds   ].fd     = DNSServiceRefSockFD(DNSSDMaster);
-  polldata[num_fds ++].events = POLLIN;
-#endif /* HAVE_DNSSD */
+  (void)data;
 
- /*
-  * Loop until we are killed or have a hard error...
-  */
+  expired = cupsArrayNew(NULL, NULL);
 
   for (;;)
   {
-    if (poll(polldata, (nfds_t)num_fds, 1000) < 0 && errno != EINTR)
+#  ifdef HAVE_EPOLL
+    nevents = epoll_wait(ClientEvents, events, (int)(sizeof(events) / sizeof(events[0])), 1000);
+#  else
+    timeout.tv_sec  = 1;
+    timeout.tv_nsec = 0;
+
+    nevents = kevent(ClientEvents, NULL, 0, events, (int)(sizeof(events) / sizeof(events[0])), &timeout);
+#  endif /* HAVE_EPOLL */
+
+    if (nevents < 0 && errno != EINTR)
     {
-      perror("poll() failed");
+      perror("Client event loop failed");
       break;
     }
 
-    if (polldata[0].revents & POLLIN)
+    _cupsMutexLock(&ClientMutex);
+
+    for (i = 0; i < nevents; i ++)
     {
-      if ((client = create_client(printer, printer->ipv4)) != NULL)
-      {
-        _cups_thread_t t = _cupsThreadCreate((_cups_thread_func_t)process_client, client);
+#  ifdef HAVE_EPOLL
+      client = (ippeve_client_t *)events[i].data.ptr;
+#  else
+      client = (ippeve_client_t *)events[i].udata;
+#  endif /* HAVE_EPOLL */
 
-        if (t)
-        {
-          _cupsThreadDetach(t);
-        }
-        else
-	{
-	  perror("Unable to create client thread");
-	  delete_client(client);
-	}
-      }
+      cupsArrayRemove(ClientIdle, client);
+      cupsArrayAdd(ClientReady, client);
     }
 
-    if (polldata[1].revents & POLLIN)
+    if (nevents > 0)
+      _cupsCondBroadcast(&ClientCond);
+
+    curtime = time(NULL);
+
+    for (client = (ippeve_client_t *)cupsArrayFirst(ClientIdle); client; client = (ippeve_client_t *)cupsArrayNext(ClientIdle))
     {
-      if ((client = create_client(printer, printer->ipv6)) != NULL)
+      if ((curtime - client->idle) >= 30)
       {
-        _cups_thread_t t = _cupsThreadCreate((_cups_thread_func_t)process_client, client);
+	cupsArrayRemove(ClientIdle, client);
+	cupsArrayAdd(expired, client);
 
-        if (t)
-        {
-          _cupsThreadDetach(t);
-        }
-        else
-	{
-	  perror("Unable to create client thread");
-	  delete_client(client);
-	}
+#  ifdef HAVE_EPOLL
+	epoll_ctl(ClientEvents, EPOLL_CTL_DEL, httpGetFd(client->http), NULL);
+#  else
+	EV_SET(&event, httpGetFd(client->http), EVFILT_READ, EV_DELETE, 0, 0, client);
+	kevent(ClientEvents, &event, 1, NULL, 0, NULL);
+#  endif /* HAVE_EPOLL */
       }
     }
 
+    _cupsMutexUnlock(&ClientMutex);
+
    /*
-    * Process DNS-SD messages...
+    * Close expired clients outside the lock...
     */
 
-#ifdef HAVE_DNSSD
-    if (polldata[2].revents & POLLIN)
+    for (client = (ippeve_client_t *)cupsArrayFirst(expired); client; client = (ippeve_client_t *)cupsArrayNext(expired))
+      delete_client(client);
+
+    cupsArrayClear(expired);
+  }
+
+  cupsArrayDelete(expired);
+
+  return (NULL);
+}
+
+
+/*
+ * 'run_client_worker()' - Process requests from ready clients.
+ */
+
+static void *				/* O - Thread exit status */
+run_client_worker(void *data)		/* I - Thread data (unused) */
+{
+  ippeve_client_t	*client;	/* Current client */
+  int			keep_alive;	/* Keep the connection open? */
+
+
+  (void)data;
+
+  for (;;)
+  {
+    _cupsMutexLock(&ClientMutex);
+
+    while ((client = (ippeve_client_t *)cupsArrayFirst(ClientReady)) == NULL)
+      _cupsCondWait(&ClientCond, &ClientMutex, 0.0);
+
+    cupsArrayRemove(ClientReady, client);
+
+    _cupsMutexUnlock(&ClientMutex);
+
+#  ifdef HAVE_SSL
+    if (!client->started)
+    {
+      client->started = 1;
+
+      if (!negotiate_tls(client))
+      {
+        delete_client(client);
+        continue;
+      }
+    }
+#  endif /* HAVE_SSL */
+
+   /*
+    * Process requests until the client has no more buffered input, then return
+    * the connection to the idle set...
+    */
+
+    do
+    {
+      keep_alive = process_http(client);
+    }
+    while (keep_alive && httpWait(client->http, 0));
+
+    if (keep_alive)
+      watch_client(client);
+    else
+      delete_client(client);
+  }
+
+  return (NULL);
+}
+#endif /* HAVE_EPOLL || HAVE_KQUEUE */
+
+
+/*
+ * 'run_job_worker()' - Process queued jobs.
+ */
+
+static void *				/* O - Thread exit status */
+run_job_worker(void *data)		/* I - Thread data (unused) */
+{
+  ippeve_job_t	*job;			/* Current job */
+
+
+  (void)data;
+
+  for (;;)
+  {
+    _cupsMutexLock(&JobMutex);
+
+    while ((job = (ippeve_job_t *)cupsArrayFirst(JobQueue)) == NULL)
+      _cupsCondWait(&JobCond, &JobMutex, 0.0);
+
+    cupsArrayRemove(JobQueue, job);
+
+    _cupsMutexUnlock(&JobMutex);
+
+    process_job(job);
+  }
+
+  return (NULL);
+}
+
+
+/*
+ * 'run_printer()' - Run the printer service.
+ */
+
+static void
+run_printer(ippeve_printer_t *printer)	/* I - Printer */
+{
+  int			i,		/* Looping var */
+			num_fds;	/* Number of file descriptors */
+  struct pollfd		polldata[3];	/* poll() data */
+  int			timeout;	/* Timeout for poll() */
+  ippeve_client_t	*client;	/* New client */
+
+
+ /*
+  * Setup poll() data for the DNS-SD service socket and IPv4/6 listeners...
+  */
+
+  polldata[0].fd     = printer->ipv4;
+  polldata[0].events = POLLIN;
+
+  polldata[1].fd     = printer->ipv6;
+  polldata[1].events = POLLIN;
+
+  num_fds = 2;
+
+#ifdef HAVE_DNSSD
+  polldata[num_fds   ].fd     = DNSServiceRefSockFD(DNSSDMaster);
+  polldata[num_fds ++].events = POLLIN;
+#endif /* HAVE_DNSSD */
+
+ /*
+  * Loop until we are killed or have a hard error...
+  */
+
+  for (;;)
+  {
+    if (poll(polldata, (nfds_t)num_fds, 1000) < 0 && errno != EINTR)
+    {
+      perror("poll() failed");
+      break;
+    }
+
+    if (polldata[0].revents & POLLIN)
+    {
+      if ((client = create_client(printer, printer->ipv4)) != NULL)
+      {
+#if defined(HAVE_EPOLL) || defined(HAVE_KQUEUE)
+        if (ClientEvents >= 0)
+          watch_client(client);
+        else
+#endif /* HAVE_EPOLL || HAVE_KQUEUE */
+        {
+          _cups_thread_t t = _cupsThreadCreate((_cups_thread_func_t)process_client, client);
+
+          if (t)
+          {
+            _cupsThreadDetach(t);
+          }
+          else
+	  {
+	    perror("Unable to create client thread");
+	    delete_client(client);
+	  }
+        }
+      }
+    }
+
+    if (polldata[1].revents & POLLIN)
+    {
+      if ((client = create_client(printer, printer->ipv6)) != NULL)
+      {
+#if defined(HAVE_EPOLL) || defined(HAVE_KQUEUE)
+        if (ClientEvents >= 0)
+          watch_client(client);
+        else
+#endif /* HAVE_EPOLL || HAVE_KQUEUE */
+        {
+          _cups_thread_t t = _cupsThreadCreate((_cups_thread_func_t)process_client, client);
+
+          if (t)
+          {
+            _cupsThreadDetach(t);
+          }
+          else
+	  {
+	    perror("Unable to create client thread");
+	    delete_client(client);
+	  }
+        }
+      }
+    }
+
+   /*
+    * Process DNS-SD messages...
+    */
+
+#ifdef HAVE_DNSSD
+    if (polldata[2].revents & POLLIN)
       DNSServiceProcessResult(DNSSDMaster);
 #endif /* HAVE_DNSSD */
 
+    for (i = 0; i < NumPrinters; i ++)
+    {
 #if defined(HAVE_DNSSD) || defined(HAVE_AVAHI)
-    if (printer->dnssd_collision)
-      register_printer(printer);
+      if (Printers[i]->dnssd_collision)
+        register_printer(Printers[i]);
 #endif /* HAVE_DNSSD || HAVE_AVAHI */
 
-   /*
-    * Clean out old jobs...
-    */
+     /*
+      * Clean out old jobs...
+      */
 
-    clean_jobs(printer);
+      clean_jobs(Printers[i]);
+    }
   }
 }
 
@@ -8270,6 +8575,275 @@ show_supplies(
 }
 
 
+/*
+ * 'sink_job()' - Read and discard a job file at the simulated print speed.
+ *
+ * PWG and Apple raster files are decoded with the raster stream API, PDF
+ * pages are counted from their page objects, and all other files are read
+ * as a single page.  Pages are paced using the "--sink" pages-per-minute
+ * rates, with 0 meaning as fast as possible.
+ */
+
+static void
+sink_job(ippeve_job_t *job)		/* I - Job */
+{
+  int			fd;		/* Job file */
+  int			pages = 0;	/* Pages consumed */
+  double		delay = 0.0;	/* Page delay from start */
+  struct timeval	start,		/* Start time */
+			curtime;	/* Current time */
+
+
+  if ((fd = open(job->filename, O_RDONLY)) < 0)
+  {
+    fprintf(stderr, "[Job %d] Unable to open \"%s\": %s\n", job->id, job->filename, strerror(errno));
+    job->state = IPP_JSTATE_ABORTED;
+    return;
+  }
+
+  fprintf(stderr, "[Job %d] Consuming \"%s\" with the built-in sink.\n", job->id, job->filename);
+  gettimeofday(&start, NULL);
+
+  if (!strcmp(job->format, "image/pwg-raster") || !strcmp(job->format, "image/urf"))
+  {
+   /*
+    * Decode every line of every page...
+    */
+
+    cups_raster_t	*ras;		/* Raster stream */
+    cups_page_header2_t	header;		/* Page header */
+    unsigned char	*line = NULL;	/* Line buffer */
+    unsigned		y;		/* Current line */
+
+    if ((ras = cupsRasterOpen(fd, CUPS_RASTER_READ)) == NULL)
+    {
+      fprintf(stderr, "[Job %d] Unable to read raster data.\n", job->id);
+      job->state = IPP_JSTATE_ABORTED;
+    }
+    else
+    {
+      while (!job->cancel && cupsRasterReadHeader2(ras, &header))
+      {
+        if (header.cupsBytesPerLine == 0 || (line = realloc(line, header.cupsBytesPerLine)) == NULL)
+        {
+          job->state = IPP_JSTATE_ABORTED;
+          break;
+	}
+
+	for (y = 0; y < header.cupsHeight; y ++)
+	{
+	  if (cupsRasterReadPixels(ras, line, header.cupsBytesPerLine) != header.cupsBytesPerLine)
+	    break;
+	}
+
+        if (y < header.cupsHeight)
+        {
+	  fprintf(stderr, "[Job %d] Early end of raster data on page %d.\n", job->id, pages + 1);
+          job->state = IPP_JSTATE_ABORTED;
+          break;
+        }
+
+        job->impcompleted = ++ pages;
+
+        if (header.cupsNumColors > 1 && SinkColorPPM > 0)
+          delay += 60.0 / SinkColorPPM;
+        else if (SinkPPM > 0)
+          delay += 60.0 / SinkPPM;
+
+        sink_wait(&start, delay);
+      }
+
+      free(line);
+      cupsRasterClose(ras);
+    }
+  }
+  else
+  {
+   /*
+    * Read the file, counting PDF page objects ("/Type /Page" but not
+    * "/Type /Pages")...
+    */
+
+    unsigned char	buffer[65536],	/* Read buffer */
+			*bufptr,	/* Pointer into buffer */
+			*bufend;	/* End of buffer */
+    ssize_t		bytes;		/* Bytes read */
+    int			is_pdf = !strcmp(job->format, "application/pdf");
+					/* Count PDF pages? */
+    static const char	pattern[] = "/Type/Page";
+					/* PDF page object pattern */
+    size_t		matched = 0;	/* Number of pattern chars matched */
+
+    while (!job->cancel && (bytes = read(fd, buffer, sizeof(buffer))) > 0)
+    {
+      if (!is_pdf)
+        continue;
+
+      for (bufptr = buffer, bufend = buffer + bytes; bufptr < bufend; bufptr ++)
+      {
+        if (matched == sizeof(pattern) - 1)
+        {
+          if (*bufptr != 's')
+            pages ++;
+
+          matched = 0;
+        }
+
+        if (*bufptr == (unsigned char)pattern[matched])
+          matched ++;
+        else if (matched != 5 || !isspace(*bufptr))
+          matched = *bufptr == '/';	/* Whitespace is allowed after /Type */
+      }
+    }
+
+    if (matched == sizeof(pattern) - 1)
+      pages ++;
+
+    if (pages < 1)
+      pages = 1;
+
+    job->impcompleted = pages;
+
+    if (SinkPPM > 0 && !job->cancel)
+      sink_wait(&start, 60.0 * pages / SinkPPM);
+  }
+
+  close(fd);
+
+  gettimeofday(&curtime, NULL);
+  fprintf(stderr, "[Job %d] Consumed %d page(s) in %.3f seconds.\n", job->id, pages, curtime.tv_sec - start.tv_sec + 0.000001 * (curtime.tv_usec - start.tv_usec));
+}
+
+
+/*
+ * 'sink_wait()' - Wait until the given number of seconds after the start time.
+ */
+
+static void
+sink_wait(struct timeval *start,	/* I - Start time */
+          double         delay)		/* I - Seconds after start */
+{
+  struct timeval	curtime;	/* Current time */
+  double		remaining;	/* Remaining seconds */
+  struct timespec	ts;		/* Time to sleep */
+
+
+  gettimeofday(&curtime, NULL);
+
+  if ((remaining = delay - (curtime.tv_sec - start->tv_sec + 0.000001 * (curtime.tv_usec - start->tv_usec))) <= 0.0)
+    return;
+
+  ts.tv_sec  = (time_t)remaining;
+  ts.tv_nsec = (long)(1000000000.0 * (remaining - ts.tv_sec));
+
+  nanosleep(&ts, NULL);
+}
+
+
+/*
+ * 'start_job()' - Start processing a job.
+ *
+ * Jobs are queued for the job worker threads when "--job-workers" is used,
+ * otherwise each job gets its own thread.
+ */
+
+static int				/* O - 1 on success, 0 on failure */
+start_job(ippeve_job_t *job)		/* I - Job */
+{
+  _cups_thread_t	t;		/* Thread */
+
+
+  if (JobWorkers > 0)
+  {
+    _cupsMutexLock(&JobMutex);
+    cupsArrayAdd(JobQueue, job);
+    _cupsCondBroadcast(&JobCond);
+    _cupsMutexUnlock(&JobMutex);
+
+    return (1);
+  }
+
+  if ((t = _cupsThreadCreate((_cups_thread_func_t)process_job, job)) == 0)
+    return (0);
+
+  _cupsThreadDetach(t);
+
+  return (1);
+}
+
+
+/*
+ * 'start_workers()' - Start the client event loop and worker threads.
+ */
+
+static int				/* O - 1 on success, 0 on failure */
+start_workers(void)
+{
+  int			i;		/* Looping var */
+  _cups_thread_t	t;		/* Thread */
+
+
+  if (JobWorkers > 0)
+  {
+    JobQueue = cupsArrayNew(NULL, NULL);
+
+    for (i = 0; i < JobWorkers; i ++)
+    {
+      if ((t = _cupsThreadCreate((_cups_thread_func_t)run_job_worker, NULL)) == 0)
+      {
+        perror("Unable to create job worker thread");
+        return (0);
+      }
+
+      _cupsThreadDetach(t);
+    }
+  }
+
+  if (ClientWorkers > 0)
+  {
+#if defined(HAVE_EPOLL) || defined(HAVE_KQUEUE)
+#  ifdef HAVE_EPOLL
+    if ((ClientEvents = epoll_create(1024)) < 0)
+#  else
+    if ((ClientEvents = kqueue()) < 0)
+#  endif /* HAVE_EPOLL */
+    {
+      perror("Unable to create client event descriptor");
+      return (0);
+    }
+
+    ClientIdle  = cupsArrayNew((cups_array_func_t)compare_clients, NULL);
+    ClientReady = cupsArrayNew(NULL, NULL);
+
+    for (i = 0; i < ClientWorkers; i ++)
+    {
+      if ((t = _cupsThreadCreate((_cups_thread_func_t)run_client_worker, NULL)) == 0)
+      {
+        perror("Unable to create client worker thread");
+        return (0);
+      }
+
+      _cupsThreadDetach(t);
+    }
+
+    if ((t = _cupsThreadCreate((_cups_thread_func_t)run_client_events, NULL)) == 0)
+    {
+      perror("Unable to create client event thread");
+      return (0);
+    }
+
+    _cupsThreadDetach(t);
+
+#else
+    fputs("ippeveprinter: \"--client-workers\" requires epoll or kqueue support.\n", stderr);
+    return (0);
+#endif /* HAVE_EPOLL || HAVE_KQUEUE */
+  }
+
+  return (1);
+}
+
+
 /*
  * 'time_string()' - Return the local time in hours, minutes, and seconds.
  */
@@ -8298,9 +8872,13 @@ usage(int status)			/* O - Exit status */
 {
   _cupsLangPuts(stdout, _("Usage: ippeveprinter [options] \"name\""));
   _cupsLangPuts(stdout, _("Options:"));
+  _cupsLangPuts(stdout, _("--client-workers NUM    Process keep-alive clients with NUM threads"));
   _cupsLangPuts(stdout, _("--help                  Show program help"));
+  _cupsLangPuts(stdout, _("--job-workers NUM       Process jobs with NUM persistent threads"));
   _cupsLangPuts(stdout, _("--no-web-forms          Disable web forms for media and supplies"));
   _cupsLangPuts(stdout, _("--pam-service service   Use the named PAM service"));
+  _cupsLangPuts(stdout, _("--printers directory    Add printers from NAME.conf attribute files"));
+  _cupsLangPuts(stdout, _("--sink ppm[,color-ppm]  Consume jobs in-process at the given speed"));
   _cupsLangPuts(stdout, _("--version               Show program version"));
   _cupsLangPuts(stdout, _("-2                      Set 2-sided printing support (default=1-sided)"));
   _cupsLangPuts(stdout, _("-A                      Enable authentication"));
@@ -8488,311 +9066,75 @@ static int				/* O - 1 if valid, 0 if not */
 valid_job_attributes(
     ippeve_client_t *client)		/* I - Client */
 {
-  int			i,		/* Looping var */
-			count,		/* Number of values */
-			valid = 1;	/* Valid attributes? */
-  ipp_attribute_t	*attr,		/* Current attribute */
-			*supported;	/* xxx-supported attribute */
+  int	valid;				/* Valid attributes? */
 
 
  /*
-  * Check operation attributes...
+  * Check operation and job template attributes...
   */
 
   valid = valid_doc_attributes(client);
 
- /*
-  * Check the various job template attributes...
-  */
-
-  if ((attr = ippFindAttribute(client->request, "copies", IPP_TAG_ZERO)) != NULL)
-  {
-    if (ippGetCount(attr) != 1 || ippGetValueTag(attr) != IPP_TAG_INTEGER ||
-        ippGetInteger(attr, 0) < 1 || ippGetInteger(attr, 0) > 999)
-    {
-      respond_unsupported(client, attr);
-      valid = 0;
-    }
-  }
-
-  if ((attr = ippFindAttribute(client->request, "ipp-attribute-fidelity", IPP_TAG_ZERO)) != NULL)
+  if (!_ippServerValidJobAttributes(client->request, client->printer->attrs, client->response))
   {
-    if (ippGetCount(attr) != 1 || ippGetValueTag(attr) != IPP_TAG_BOOLEAN)
-    {
-      respond_unsupported(client, attr);
-      valid = 0;
-    }
-  }
-
-  if ((attr = ippFindAttribute(client->request, "job-hold-until", IPP_TAG_ZERO)) != NULL)
-  {
-    if (ippGetCount(attr) != 1 ||
-        (ippGetValueTag(attr) != IPP_TAG_NAME &&
-	 ippGetValueTag(attr) != IPP_TAG_NAMELANG &&
-	 ippGetValueTag(attr) != IPP_TAG_KEYWORD) ||
-	strcmp(ippGetString(attr, 0, NULL), "no-hold"))
-    {
-      respond_unsupported(client, attr);
-      valid = 0;
-    }
-  }
-
-  if ((attr = ippFindAttribute(client->request, "job-impressions", IPP_TAG_ZERO)) != NULL)
-  {
-    if (ippGetCount(attr) != 1 || ippGetValueTag(attr) != IPP_TAG_INTEGER || ippGetInteger(attr, 0) < 0)
-    {
-      respond_unsupported(client, attr);
-      valid = 0;
-    }
-  }
-
-  if ((attr = ippFindAttribute(client->request, "job-name", IPP_TAG_ZERO)) != NULL)
-  {
-    if (ippGetCount(attr) != 1 ||
-        (ippGetValueTag(attr) != IPP_TAG_NAME &&
-	 ippGetValueTag(attr) != IPP_TAG_NAMELANG))
-    {
-      respond_unsupported(client, attr);
-      valid = 0;
-    }
-
-    ippSetGroupTag(client->request, &attr, IPP_TAG_JOB);
-  }
-  else
-    ippAddString(client->request, IPP_TAG_JOB, IPP_TAG_NAME, "job-name", NULL, "Untitled");
-
-  if ((attr = ippFindAttribute(client->request, "job-priority", IPP_TAG_ZERO)) != NULL)
-  {
-    if (ippGetCount(attr) != 1 || ippGetValueTag(attr) != IPP_TAG_INTEGER ||
-        ippGetInteger(attr, 0) < 1 || ippGetInteger(attr, 0) > 100)
-    {
-      respond_unsupported(client, attr);
-      valid = 0;
-    }
-  }
-
-  if ((attr = ippFindAttribute(client->request, "job-sheets", IPP_TAG_ZERO)) != NULL)
-  {
-    if (ippGetCount(attr) != 1 ||
-        (ippGetValueTag(attr) != IPP_TAG_NAME &&
-	 ippGetValueTag(attr) != IPP_TAG_NAMELANG &&
-	 ippGetValueTag(attr) != IPP_TAG_KEYWORD) ||
-	strcmp(ippGetString(attr, 0, NULL), "none"))
-    {
-      respond_unsupported(client, attr);
-      valid = 0;
-    }
-  }
-
-  if ((attr = ippFindAttribute(client->request, "media", IPP_TAG_ZERO)) != NULL)
-  {
-    if (ippGetCount(attr) != 1 ||
-        (ippGetValueTag(attr) != IPP_TAG_NAME &&
-	 ippGetValueTag(attr) != IPP_TAG_NAMELANG &&
-	 ippGetValueTag(attr) != IPP_TAG_KEYWORD))
-    {
-      respond_unsupported(client, attr);
-      valid = 0;
-    }
-    else
-    {
-      supported = ippFindAttribute(client->printer->attrs, "media-supported", IPP_TAG_KEYWORD);
-
-      if (!ippContainsString(supported, ippGetString(attr, 0, NULL)))
-      {
-	respond_unsupported(client, attr);
-	valid = 0;
-      }
-    }
+    fprintf(stderr, "%s %s %s (%s)\n", client->hostname, ippOpString(client->operation_id), ippErrorString(ippGetStatusCode(client->response)), ippGetString(ippFindAttribute(client->response, "status-message", IPP_TAG_TEXT), 0, NULL));
+    valid = 0;
   }
 
-  if ((attr = ippFindAttribute(client->request, "media-col", IPP_TAG_ZERO)) != NULL)
-  {
-    ipp_t		*col,		/* media-col collection */
-			*size;		/* media-size collection */
-    ipp_attribute_t	*member,	/* Member attribute */
-			*x_dim,		/* x-dimension */
-			*y_dim;		/* y-dimension */
-    int			x_value,	/* y-dimension value */
-			y_value;	/* x-dimension value */
-
-    if (ippGetCount(attr) != 1 ||
-        ippGetValueTag(attr) != IPP_TAG_BEGIN_COLLECTION)
-    {
-      respond_unsupported(client, attr);
-      valid = 0;
-    }
-
-    col = ippGetCollection(attr, 0);
-
-    if ((member = ippFindAttribute(col, "media-size-name", IPP_TAG_ZERO)) != NULL)
-    {
-      if (ippGetCount(member) != 1 ||
-	  (ippGetValueTag(member) != IPP_TAG_NAME &&
-	   ippGetValueTag(member) != IPP_TAG_NAMELANG &&
-	   ippGetValueTag(member) != IPP_TAG_KEYWORD))
-      {
-	respond_unsupported(client, attr);
-	valid = 0;
-      }
-      else
-      {
-	supported = ippFindAttribute(client->printer->attrs, "media-supported", IPP_TAG_KEYWORD);
+  return (valid);
+}
 
-	if (!ippContainsString(supported, ippGetString(member, 0, NULL)))
-	{
-	  respond_unsupported(client, attr);
-	  valid = 0;
-	}
-      }
-    }
-    else if ((member = ippFindAttribute(col, "media-size", IPP_TAG_BEGIN_COLLECTION)) != NULL)
-    {
-      if (ippGetCount(member) != 1)
-      {
-	respond_unsupported(client, attr);
-	valid = 0;
-      }
-      else
-      {
-	size = ippGetCollection(member, 0);
 
-	if ((x_dim = ippFindAttribute(size, "x-dimension", IPP_TAG_INTEGER)) == NULL || ippGetCount(x_dim) != 1 ||
-	    (y_dim = ippFindAttribute(size, "y-dimension", IPP_TAG_INTEGER)) == NULL || ippGetCount(y_dim) != 1)
-	{
-	  respond_unsupported(client, attr);
-	  valid = 0;
-	}
-	else
-	{
-	  x_value   = ippGetInteger(x_dim, 0);
-	  y_value   = ippGetInteger(y_dim, 0);
-	  supported = ippFindAttribute(client->printer->attrs, "media-size-supported", IPP_TAG_BEGIN_COLLECTION);
-	  count     = ippGetCount(supported);
+#if defined(HAVE_EPOLL) || defined(HAVE_KQUEUE)
+/*
+ * 'watch_client()' - Add a client to the idle set and wait for its next request.
+ */
 
-	  for (i = 0; i < count ; i ++)
-	  {
-	    size  = ippGetCollection(supported, i);
-	    x_dim = ippFindAttribute(size, "x-dimension", IPP_TAG_ZERO);
-	    y_dim = ippFindAttribute(size, "y-dimension", IPP_TAG_ZERO);
+static void
+watch_client(ippeve_client_t *client)	/* I - Client */
+{
+  int	fd = httpGetFd(client->http);	/* Client socket */
+  int	status;				/* Status of epoll/kqueue call */
+#  ifdef HAVE_EPOLL
+  struct epoll_event	event;		/* Event */
+#  else
+  struct kevent		event;		/* Event */
+#  endif /* HAVE_EPOLL */
 
-	    if (ippContainsInteger(x_dim, x_value) && ippContainsInteger(y_dim, y_value))
-	      break;
-	  }
 
-	  if (i >= count)
-	  {
-	    respond_unsupported(client, attr);
-	    valid = 0;
-	  }
-	}
-      }
-    }
-  }
+  client->idle = time(NULL);
 
-  if ((attr = ippFindAttribute(client->request, "multiple-document-handling", IPP_TAG_ZERO)) != NULL)
-  {
-    if (ippGetCount(attr) != 1 || ippGetValueTag(attr) != IPP_TAG_KEYWORD ||
-        (strcmp(ippGetString(attr, 0, NULL),
-		"separate-documents-uncollated-copies") &&
-	 strcmp(ippGetString(attr, 0, NULL),
-		"separate-documents-collated-copies")))
-    {
-      respond_unsupported(client, attr);
-      valid = 0;
-    }
-  }
-
-  if ((attr = ippFindAttribute(client->request, "orientation-requested", IPP_TAG_ZERO)) != NULL)
-  {
-    if (ippGetCount(attr) != 1 || ippGetValueTag(attr) != IPP_TAG_ENUM ||
-        ippGetInteger(attr, 0) < IPP_ORIENT_PORTRAIT ||
-        ippGetInteger(attr, 0) > IPP_ORIENT_REVERSE_PORTRAIT)
-    {
-      respond_unsupported(client, attr);
-      valid = 0;
-    }
-  }
+ /*
+  * Add the client to the idle set before arming the descriptor so that the
+  * event thread always finds it there...
+  */
 
-  if ((attr = ippFindAttribute(client->request, "page-ranges", IPP_TAG_ZERO)) != NULL)
-  {
-    if (ippGetValueTag(attr) != IPP_TAG_RANGE)
-    {
-      respond_unsupported(client, attr);
-      valid = 0;
-    }
-  }
+  _cupsMutexLock(&ClientMutex);
 
-  if ((attr = ippFindAttribute(client->request, "print-quality", IPP_TAG_ZERO)) != NULL)
-  {
-    if (ippGetCount(attr) != 1 || ippGetValueTag(attr) != IPP_TAG_ENUM ||
-        ippGetInteger(attr, 0) < IPP_QUALITY_DRAFT ||
-        ippGetInteger(attr, 0) > IPP_QUALITY_HIGH)
-    {
-      respond_unsupported(client, attr);
-      valid = 0;
-    }
-  }
+  cupsArrayAdd(ClientIdle, client);
 
-  if ((attr = ippFindAttribute(client->request, "printer-resolution", IPP_TAG_ZERO)) != NULL)
-  {
-    supported = ippFindAttribute(client->printer->attrs, "printer-resolution-supported", IPP_TAG_RESOLUTION);
+#  ifdef HAVE_EPOLL
+  memset(&event, 0, sizeof(event));
+  event.events   = EPOLLIN | EPOLLONESHOT;
+  event.data.ptr = client;
 
-    if (ippGetCount(attr) != 1 || ippGetValueTag(attr) != IPP_TAG_RESOLUTION ||
-        !supported)
-    {
-      respond_unsupported(client, attr);
-      valid = 0;
-    }
-    else
-    {
-      int	xdpi,			/* Horizontal resolution for job template attribute */
-		ydpi,			/* Vertical resolution for job template attribute */
-		sydpi;			/* Vertical resolution for supported value */
-      ipp_res_t	units,			/* Units for job template attribute */
-		sunits;			/* Units for supported value */
+  if ((status = epoll_ctl(ClientEvents, EPOLL_CTL_MOD, fd, &event)) < 0 && errno == ENOENT)
+    status = epoll_ctl(ClientEvents, EPOLL_CTL_ADD, fd, &event);
+#  else
+  EV_SET(&event, fd, EVFILT_READ, EV_ADD | EV_ENABLE | EV_DISPATCH, 0, 0, client);
 
-      xdpi  = ippGetResolution(attr, 0, &ydpi, &units);
-      count = ippGetCount(supported);
+  status = kevent(ClientEvents, &event, 1, NULL, 0, NULL);
+#  endif /* HAVE_EPOLL */
 
-      for (i = 0; i < count; i ++)
-      {
-        if (xdpi == ippGetResolution(supported, i, &sydpi, &sunits) && ydpi == sydpi && units == sunits)
-          break;
-      }
+  if (status < 0)
+    cupsArrayRemove(ClientIdle, client);
 
-      if (i >= count)
-      {
-	respond_unsupported(client, attr);
-	valid = 0;
-      }
-    }
-  }
+  _cupsMutexUnlock(&ClientMutex);
 
-  if ((attr = ippFindAttribute(client->request, "sides", IPP_TAG_ZERO)) != NULL)
+  if (status < 0)
   {
-    const char *sides = ippGetString(attr, 0, NULL);
-					/* "sides" value... */
-
-    if (ippGetCount(attr) != 1 || ippGetValueTag(attr) != IPP_TAG_KEYWORD)
-    {
-      respond_unsupported(client, attr);
-      valid = 0;
-    }
-    else if ((supported = ippFindAttribute(client->printer->attrs, "sides-supported", IPP_TAG_KEYWORD)) != NULL)
-    {
-      if (!ippContainsString(supported, sides))
-      {
-	respond_unsupported(client, attr);
-	valid = 0;
-      }
-    }
-    else if (strcmp(sides, "one-sided"))
-    {
-      respond_unsupported(client, attr);
-      valid = 0;
-    }
+    fprintf(stderr, "%s Unable to watch client connection: %s\n", client->hostname, strerror(errno));
+    delete_client(client);
   }
-
-  return (valid);
 }
+#endif /* HAVE_EPOLL || HAVE_KQUEUE */
@@ -16,6 +16,7 @@
 
 #define _CUPS_NO_DEPRECATED
 #include <cups/cups-private.h>
+#include <sys/stat.h>
 #ifdef _WIN32
 #  include <process.h>
 #  include <sys/timeb.h>
@@ -117,8 +118,17 @@ typedef struct ippfind_srv_s		/* Service information */
 		is_local,		/* Is a local service? */
 		is_processed,		/* Did we process the service? */
 		is_resolved;		/* Got the resolve data? */
+  time_t	cached;			/* Time the service was cached, 0 if live */
 } ippfind_srv_t;
 
+typedef struct ippfind_browse_s		/* Cached browse information */
+{
+  char		*regtype,		/* Registration type */
+		*domain;		/* Domain name, "" for any */
+  time_t	time;			/* Time of browse */
+  int		is_live;		/* Browsed during this run? */
+} ippfind_browse_t;
+
 
 /*
  * Local globals...
@@ -137,7 +147,29 @@ static int	address_family = AF_UNSPEC;
 					/* Address family for LIST */
 static int	bonjour_error = 0;	/* Error browsing/resolving? */
 static double	bonjour_timeout = 1.0;	/* Timeout in seconds */
+static cups_array_t *cache_browses = NULL;
+					/* Cached browses */
+static char	cache_file[1024] = "";	/* Discovery cache file */
+static cups_array_t *cache_services = NULL;
+					/* Cached services */
+static int	cache_ttl = 0;		/* Discovery cache lifetime in seconds */
 static int	ipp_version = 20;	/* IPP version for LIST */
+static int	max_probes = 1,		/* Maximum concurrent probes */
+		max_resolves = 50;	/* Maximum concurrent resolves */
+static double	probe_timeout = 30.0;	/* Probe timeout in seconds */
+
+static ippfind_expr_t *probe_expressions = NULL;
+					/* Expressions for probe threads */
+static cups_array_t *probe_queue = NULL;/* Services waiting to be probed */
+static _cups_mutex_t probe_mutex = _CUPS_MUTEX_INITIALIZER;
+					/* Mutex for probe queue */
+static _cups_cond_t probe_cond = _CUPS_COND_INITIALIZER;
+					/* Condition for probe queue changes */
+static int	num_probe_threads = 0;	/* Number of probe threads */
+static _cups_thread_t *probe_threads = NULL;
+					/* Probe threads */
+static int	probe_finished = 0,	/* No more services to probe? */
+		probe_matched = 0;	/* Did any service match? */
 
 
 /*
@@ -162,18 +194,24 @@ static void		client_callback(AvahiClient *client,
 					void *context);
 #endif /* HAVE_AVAHI */
 
+static int		cache_match(ippfind_srv_t *service, const char *regtype, const char *domain);
+static int		cache_search(cups_array_t *services, const char *name, const char *regtype, const char *domain);
 static int		compare_services(ippfind_srv_t *a, ippfind_srv_t *b);
 static const char	*dnssd_error_string(int error);
 static int		eval_expr(ippfind_srv_t *service,
 			          ippfind_expr_t *expressions);
 static int		exec_program(ippfind_srv_t *service, int num_args,
 			             char **args);
+static int		finish_probes(void);
 static ippfind_srv_t	*get_service(cups_array_t *services, const char *serviceName, const char *regtype, const char *replyDomain) _CUPS_NONNULL(1,2,3,4);
 static double		get_time(void);
 static int		list_service(ippfind_srv_t *service);
 static ippfind_expr_t	*new_expr(ippfind_op_t op, int invert,
 			          const char *value, const char *regex,
 			          char **args);
+static void		*probe_thread(void *data);
+static void		queue_probe(ippfind_srv_t *service);
+static void		read_cache(void);
 #ifdef HAVE_DNSSD
 static void DNSSD_API	resolve_callback(DNSServiceRef sdRef, DNSServiceFlags flags, uint32_t interfaceIndex, DNSServiceErrorType errorCode, const char *fullName, const char *hostTarget, uint16_t port, uint16_t txtLen, const unsigned char *txtRecord, void *context) _CUPS_NONNULL(1,5,6,9, 10);
 #elif defined(HAVE_AVAHI)
@@ -197,6 +235,9 @@ static void		resolve_callback(AvahiServiceResolver *res,
 static void		set_service_uri(ippfind_srv_t *service);
 static void		show_usage(void) _CUPS_NORETURN;
 static void		show_version(void) _CUPS_NORETURN;
+static int		start_dnssd(void);
+static int		start_probes(ippfind_expr_t *expressions);
+static void		write_cache(cups_array_t *services);
 
 
 /*
@@ -226,7 +267,8 @@ main(int  argc,				/* I - Number of command-line args */
   ippfind_op_t		logic = IPPFIND_OP_AND;
 					/* Logic for next expression */
   int			invert = 0;	/* Invert expression? */
-  int			err;		/* DNS-SD error */
+  int			err,		/* DNS-SD error */
+			started = 0;	/* Started DNS-SD? */
 #ifdef HAVE_DNSSD
   fd_set		sinput;		/* Input set for select() */
   struct timeval	stimeout;	/* Timeout for select() */
@@ -306,6 +348,30 @@ main(int  argc,				/* I - Number of command-line args */
 
 	  temp = NULL;
         }
+        else if (!strcmp(argv[i], "--cache"))
+        {
+          i ++;
+          if (i >= argc || (cache_ttl = atoi(argv[i])) < 1)
+          {
+            _cupsLangPrintf(stderr,
+                            _("ippfind: Missing or bad number after %s."),
+                            "--cache");
+            show_usage();
+          }
+        }
+        else if (!strcmp(argv[i], "--concurrency"))
+        {
+          i ++;
+          if (i >= argc || (max_probes = atoi(argv[i])) < 1 || max_probes > 1000)
+          {
+            _cupsLangPrintf(stderr,
+                            _("ippfind: Missing or bad number after %s."),
+                            "--concurrency");
+            show_usage();
+          }
+
+          max_resolves = max_probes;
+        }
         else if (!strcmp(argv[i], "--domain"))
         {
           i ++;
@@ -553,6 +619,17 @@ main(int  argc,				/* I - Number of command-line args */
 
           have_output = 1;
         }
+        else if (!strcmp(argv[i], "--probe-timeout"))
+        {
+          i ++;
+          if (i >= argc || (probe_timeout = atof(argv[i])) <= 0.0)
+          {
+            _cupsLangPrintf(stderr,
+                            _("ippfind: Missing or bad timeout after %s."),
+                            "--probe-timeout");
+            show_usage();
+          }
+        }
         else if (!strcmp(argv[i], "--quiet"))
         {
           if ((temp = new_expr(IPPFIND_OP_QUIET, invert, NULL, NULL,
@@ -1126,36 +1203,15 @@ main(int  argc,				/* I - Number of command-line args */
   }
 
  /*
-  * Start up browsing/resolving...
+  * Load the discovery cache as needed...
   */
 
-#ifdef HAVE_DNSSD
-  if ((err = DNSServiceCreateConnection(&dnssd_ref)) != kDNSServiceErr_NoError)
-  {
-    _cupsLangPrintf(stderr, _("ippfind: Unable to use Bonjour: %s"),
-                    dnssd_error_string(err));
-    return (IPPFIND_EXIT_BONJOUR);
-  }
-
-#elif defined(HAVE_AVAHI)
-  if ((avahi_poll = avahi_simple_poll_new()) == NULL)
-  {
-    _cupsLangPrintf(stderr, _("ippfind: Unable to use Bonjour: %s"),
-                    strerror(errno));
-    return (IPPFIND_EXIT_BONJOUR);
-  }
-
-  avahi_simple_poll_set_func(avahi_poll, poll_callback, NULL);
+  if (cache_ttl > 0)
+    read_cache();
 
-  avahi_client = avahi_client_new(avahi_simple_poll_get(avahi_poll),
-			          0, client_callback, avahi_poll, &err);
-  if (!avahi_client)
-  {
-    _cupsLangPrintf(stderr, _("ippfind: Unable to use Bonjour: %s"),
-                    dnssd_error_string(err));
-    return (IPPFIND_EXIT_BONJOUR);
-  }
-#endif /* HAVE_DNSSD */
+ /*
+  * Start up browsing/resolving...
+  */
 
   for (search = (const char *)cupsArrayFirst(searches);
        search;
@@ -1216,15 +1272,31 @@ main(int  argc,				/* I - Number of command-line args */
     if (!*domain)
       domain = NULL;
 
+    if (name && !domain)
+      domain = "local.";
+
+    if (cache_ttl > 0 && cache_search(services, name, regtype, domain))
+    {
+      if (getenv("IPPFIND_DEBUG"))
+        fprintf(stderr, "Using cached results for name=\"%s\", regtype=\"%s\", domain=\"%s\"\n", name ? name : "", regtype, domain ? domain : "");
+
+      continue;
+    }
+
+    if (!started)
+    {
+      if (!start_dnssd())
+        return (IPPFIND_EXIT_BONJOUR);
+
+      started = 1;
+    }
+
     if (name)
     {
      /*
       * Resolve the given service instance name, regtype, and domain...
       */
 
-      if (!domain)
-        domain = "local.";
-
       service = get_service(services, name, regtype, domain);
 
       if (getenv("IPPFIND_DEBUG"))
@@ -1306,12 +1378,15 @@ main(int  argc,				/* I - Number of command-line args */
   * Process browse/resolve requests...
   */
 
+  if (max_probes > 1 && !start_probes(expressions))
+    return (IPPFIND_EXIT_MEMORY);
+
   if (bonjour_timeout > 1.0)
     endtime = get_time() + bonjour_timeout;
   else
     endtime = get_time() + 300.0;
 
-  while (get_time() < endtime)
+  while (started && get_time() < endtime)
   {
     int		process = 0;		/* Process services? */
 
@@ -1368,10 +1443,11 @@ main(int  argc,				/* I - Number of command-line args */
     }
 #endif /* HAVE_DNSSD */
 
-    if (process)
+    if (process || probe_threads)
     {
      /*
-      * Process any services that we have found...
+      * Process any services that we have found - the probe threads do the
+      * slow part, so don't wait for DNS-SD to go quiet when using them...
       */
 
       int	active = 0,		/* Number of active resolves */
@@ -1391,10 +1467,11 @@ main(int  argc,				/* I - Number of command-line args */
         if (!service->ref && !service->is_resolved)
         {
          /*
-          * Found a service, now resolve it (but limit to 50 active resolves...)
+          * Found a service, now resolve it (but limit the number of active
+          * resolves...)
           */
 
-          if (active < 50)
+          if (active < max_resolves)
           {
 #ifdef HAVE_DNSSD
 	    service->ref = dnssd_ref;
@@ -1448,7 +1525,9 @@ main(int  argc,				/* I - Number of command-line args */
 	    service->ref = NULL;
 	  }
 
-          if (eval_expr(service, expressions))
+          if (probe_threads)
+            queue_probe(service);
+          else if (eval_expr(service, expressions))
             status = IPPFIND_EXIT_TRUE;
 
           service->is_processed = 1;
@@ -1461,11 +1540,36 @@ main(int  argc,				/* I - Number of command-line args */
       * If we have processed all services we have discovered, then we are done.
       */
 
-      if (processed == cupsArrayCount(services) && bonjour_timeout <= 1.0)
+      if (process && processed == cupsArrayCount(services) && bonjour_timeout <= 1.0)
         break;
     }
   }
 
+  for (service = (ippfind_srv_t *)cupsArrayFirst(services);
+       service;
+       service = (ippfind_srv_t *)cupsArrayNext(services))
+  {
+   /*
+    * Process any cached services that were not handled by the loop above...
+    */
+
+    if (service->cached && !service->is_processed)
+    {
+      if (probe_threads)
+	queue_probe(service);
+      else if (eval_expr(service, expressions))
+	status = IPPFIND_EXIT_TRUE;
+
+      service->is_processed = 1;
+    }
+  }
+
+  if (probe_threads && finish_probes())
+    status = IPPFIND_EXIT_TRUE;
+
+  if (cache_ttl > 0 && started && !bonjour_error)
+    write_cache(services);
+
   if (bonjour_error)
     return (IPPFIND_EXIT_BONJOUR);
   else
@@ -1546,6 +1650,140 @@ browse_local_callback(
 #endif /* HAVE_DNSSD */
 
 
+/*
+ * 'cache_match()' - Check whether a cached service matches a browse.
+ */
+
+static int				/* O - 1 on match, 0 otherwise */
+cache_match(ippfind_srv_t *service,	/* I - Service */
+            const char    *regtype,	/* I - Registration type */
+            const char    *domain)	/* I - Domain name or NULL for any */
+{
+  size_t	len = strlen(regtype);	/* Length of registration type */
+
+
+ /*
+  * DNS-SD reports "_ipp._tcp." for a browse of "_ipp._tcp"...
+  */
+
+  if (strncmp(service->regtype, regtype, len) || (service->regtype[len] && strcmp(service->regtype + len, ".")))
+    return (0);
+
+  return (!domain || !_cups_strcasecmp(service->domain, domain));
+}
+
+
+/*
+ * 'cache_search()' - Use cached results for a browse or resolve.
+ *
+ * Browses of subtypes are never cached since the cache does not record which
+ * subtypes a service has.  A browse that is not answered from the cache is
+ * recorded so that write_cache() can replace its old results.
+ */
+
+static int				/* O - 1 if cached, 0 if not */
+cache_search(cups_array_t *services,	/* I - Services array */
+             const char   *name,	/* I - Service name or NULL for browse */
+             const char   *regtype,	/* I - Registration type */
+             const char   *domain)	/* I - Domain name or NULL for any */
+{
+  ippfind_srv_t		*cached,	/* Cached service */
+			*service;	/* Existing service */
+  ippfind_browse_t	*browse;	/* Cached browse */
+  time_t		curtime = time(NULL);
+					/* Current time */
+  int			is_cached = 0;	/* Are the results cached? */
+
+
+  if (name)
+  {
+   /*
+    * Look for a fresh copy of the named service...
+    */
+
+    for (cached = (ippfind_srv_t *)cupsArrayFirst(cache_services);
+         cached;
+         cached = (ippfind_srv_t *)cupsArrayNext(cache_services))
+    {
+      if (!_cups_strcasecmp(cached->name, name) && cache_match(cached, regtype, domain) && (curtime - cached->cached) <= cache_ttl)
+      {
+        is_cached = 1;
+        break;
+      }
+    }
+  }
+  else if (!strchr(regtype, ','))
+  {
+   /*
+    * Look for a fresh browse of the same type and domain...
+    */
+
+    for (browse = (ippfind_browse_t *)cupsArrayFirst(cache_browses);
+         browse;
+         browse = (ippfind_browse_t *)cupsArrayNext(cache_browses))
+    {
+      if (!strcmp(browse->regtype, regtype) && !_cups_strcasecmp(browse->domain, domain ? domain : ""))
+        break;
+    }
+
+    if (browse && !browse->is_live && (curtime - browse->time) <= cache_ttl)
+    {
+      is_cached = 1;
+    }
+    else
+    {
+     /*
+      * Record the live browse...
+      */
+
+      if (!browse && (browse = calloc(1, sizeof(ippfind_browse_t))) != NULL)
+      {
+        browse->regtype = strdup(regtype);
+        browse->domain  = strdup(domain ? domain : "");
+
+        cupsArrayAdd(cache_browses, browse);
+      }
+
+      if (browse)
+      {
+        browse->time    = curtime;
+        browse->is_live = 1;
+      }
+    }
+  }
+
+  if (!is_cached)
+    return (0);
+
+ /*
+  * Add the matching cached services...
+  */
+
+  for (cached = (ippfind_srv_t *)cupsArrayFirst(cache_services);
+       cached;
+       cached = (ippfind_srv_t *)cupsArrayNext(cache_services))
+  {
+    if ((name && _cups_strcasecmp(cached->name, name)) || !cache_match(cached, regtype, domain))
+      continue;
+
+    for (service = (ippfind_srv_t *)cupsArrayFind(services, cached);
+         service;
+         service = (ippfind_srv_t *)cupsArrayNext(services))
+    {
+      if (_cups_strcasecmp(service->name, cached->name) || !strcmp(service->regtype, cached->regtype))
+        break;
+    }
+
+    if (service && !_cups_strcasecmp(service->name, cached->name))
+      continue;				/* Already have this service */
+
+    cupsArrayAdd(services, cached);
+  }
+
+  return (1);
+}
+
+
 #ifdef HAVE_AVAHI
 /*
  * 'browse_callback()' - Browse devices.
@@ -2096,7 +2334,7 @@ exec_program(ippfind_srv_t *service,	/* I - Service */
     * Wait for it to complete...
     */
 
-    while (wait(&status) != pid)
+    while (waitpid(pid, &status, 0) < 0 && errno == EINTR)
       ;
   }
 #endif /* _WIN32 */
@@ -2131,6 +2369,36 @@ exec_program(ippfind_srv_t *service,	/* I - Service */
 }
 
 
+/*
+ * 'finish_probes()' - Wait for the queued probes to finish and stop the probe
+ *                     threads.
+ */
+
+static int				/* O - 1 if any service matched, 0 otherwise */
+finish_probes(void)
+{
+  int	i;				/* Looping var */
+
+
+  _cupsMutexLock(&probe_mutex);
+  probe_finished = 1;
+  _cupsCondBroadcast(&probe_cond);
+  _cupsMutexUnlock(&probe_mutex);
+
+  for (i = 0; i < num_probe_threads; i ++)
+    _cupsThreadWait(probe_threads[i]);
+
+  free(probe_threads);
+  probe_threads     = NULL;
+  num_probe_threads = 0;
+
+  cupsArrayDelete(probe_queue);
+  probe_queue = NULL;
+
+  return (probe_matched);
+}
+
+
 /*
  * 'get_service()' - Create or update a device.
  */
@@ -2269,7 +2537,7 @@ list_service(ippfind_srv_t *service)	/* I - Service */
 			!strncmp(service->regtype, "_ipps._tcp", 10) ?
 			    HTTP_ENCRYPTION_ALWAYS :
 			    HTTP_ENCRYPTION_IF_REQUESTED,
-			1, 30000, NULL);
+			1, (int)(probe_timeout * 1000.0), NULL);
 
     httpAddrFreeList(addrlist);
 
@@ -2279,6 +2547,8 @@ list_service(ippfind_srv_t *service)	/* I - Service */
       return (0);
     }
 
+    httpSetTimeout(http, probe_timeout, NULL, NULL);
+
    /*
     * Get the current printer state...
     */
@@ -2312,6 +2582,8 @@ list_service(ippfind_srv_t *service)	/* I - Service */
     if (cupsLastError() > IPP_STATUS_OK_EVENTS_COMPLETE)
     {
       _cupsLangPrintf(stdout, "%s: unavailable", service->uri);
+      ippDelete(response);
+      httpClose(http);
       return (0);
     }
 
@@ -2368,7 +2640,7 @@ list_service(ippfind_srv_t *service)	/* I - Service */
 			!strncmp(service->regtype, "_ipps._tcp", 10) ?
 			    HTTP_ENCRYPTION_ALWAYS :
 			    HTTP_ENCRYPTION_IF_REQUESTED,
-			1, 30000, NULL);
+			1, (int)(probe_timeout * 1000.0), NULL);
 
     httpAddrFreeList(addrlist);
 
@@ -2378,9 +2650,12 @@ list_service(ippfind_srv_t *service)	/* I - Service */
       return (0);
     }
 
+    httpSetTimeout(http, probe_timeout, NULL, NULL);
+
     if (httpGet(http, service->resource))
     {
       _cupsLangPrintf(stdout, "%s unavailable", service->uri);
+      httpClose(http);
       return (0);
     }
 
@@ -2410,7 +2685,7 @@ list_service(ippfind_srv_t *service)	/* I - Service */
     int	sock;				/* Socket */
 
 
-    if (!httpAddrConnect(addrlist, &sock))
+    if (!httpAddrConnect2(addrlist, &sock, (int)(probe_timeout * 1000.0), NULL))
     {
       _cupsLangPrintf(stdout, "%s unavailable", service->uri);
       httpAddrFreeList(addrlist);
@@ -2541,6 +2816,156 @@ poll_callback(
 #endif /* HAVE_AVAHI */
 
 
+/*
+ * 'probe_thread()' - Evaluate the expressions for queued services.
+ */
+
+static void *				/* O - Thread exit status */
+probe_thread(void *data)		/* I - Thread data (unused) */
+{
+  ippfind_srv_t	*service;		/* Current service */
+  int		result;			/* Result of evaluation */
+
+
+  (void)data;
+
+  _cupsMutexLock(&probe_mutex);
+
+  for (;;)
+  {
+    if ((service = (ippfind_srv_t *)cupsArrayFirst(probe_queue)) != NULL)
+    {
+     /*
+      * Evaluate the next service without holding the lock so that other
+      * threads can probe their services at the same time...
+      */
+
+      cupsArrayRemove(probe_queue, service);
+      _cupsMutexUnlock(&probe_mutex);
+
+      result = eval_expr(service, probe_expressions);
+
+      _cupsMutexLock(&probe_mutex);
+
+      if (result)
+        probe_matched = 1;
+    }
+    else if (probe_finished)
+      break;
+    else
+      _cupsCondWait(&probe_cond, &probe_mutex, 0.0);
+  }
+
+  _cupsMutexUnlock(&probe_mutex);
+
+  return (NULL);
+}
+
+
+/*
+ * 'queue_probe()' - Queue a service for the probe threads.
+ */
+
+static void
+queue_probe(ippfind_srv_t *service)	/* I - Service */
+{
+  _cupsMutexLock(&probe_mutex);
+  cupsArrayAdd(probe_queue, service);
+  _cupsCondBroadcast(&probe_cond);
+  _cupsMutexUnlock(&probe_mutex);
+}
+
+
+/*
+ * 'read_cache()' - Read the discovery cache.
+ *
+ * Each line in the cache is a tab-separated list of fields:
+ *
+ *   Browse time regtype domain
+ *   Service time name regtype domain host port is-local [key=value ...]
+ */
+
+static void
+read_cache(void)
+{
+  cups_file_t	*fp;			/* Cache file */
+  char		line[8192],		/* Line from file */
+		*ptr,			/* Pointer into line */
+		*fields[256],		/* Fields from line */
+		*value;			/* TXT value */
+  int		i,			/* Looping var */
+		num_fields;		/* Number of fields */
+  ippfind_browse_t *browse;		/* Cached browse */
+  ippfind_srv_t	*service;		/* Cached service */
+  _cups_globals_t *cg = _cupsGlobals();	/* Global data */
+
+
+  cache_browses  = cupsArrayNew(NULL, NULL);
+  cache_services = cupsArrayNew((cups_array_func_t)compare_services, NULL);
+
+  if (!cg->home)
+  {
+    cache_ttl = 0;
+    return;
+  }
+
+  snprintf(cache_file, sizeof(cache_file), "%s/.cups/ippfind-cache", cg->home);
+
+  if ((fp = cupsFileOpen(cache_file, "r")) == NULL)
+    return;
+
+  while (cupsFileGets(fp, line, sizeof(line)))
+  {
+    for (num_fields = 0, ptr = line; ptr && num_fields < (int)(sizeof(fields) / sizeof(fields[0])); num_fields ++)
+    {
+      fields[num_fields] = ptr;
+
+      if ((ptr = strchr(ptr, '\t')) != NULL)
+        *ptr++ = '\0';
+    }
+
+    if (num_fields == 4 && !strcmp(fields[0], "Browse"))
+    {
+      if ((browse = calloc(1, sizeof(ippfind_browse_t))) == NULL)
+        break;
+
+      browse->time    = (time_t)strtol(fields[1], NULL, 10);
+      browse->regtype = strdup(fields[2]);
+      browse->domain  = strdup(fields[3]);
+
+      cupsArrayAdd(cache_browses, browse);
+    }
+    else if (num_fields >= 8 && !strcmp(fields[0], "Service"))
+    {
+      service = get_service(cache_services, fields[2], fields[3], fields[4]);
+
+      if (service->is_resolved)
+        continue;			/* Duplicate */
+
+      service->cached      = (time_t)strtol(fields[1], NULL, 10);
+      service->host        = strdup(fields[5]);
+      service->port        = atoi(fields[6]);
+      service->is_local    = atoi(fields[7]);
+      service->is_resolved = 1;
+
+      for (i = 8; i < num_fields; i ++)
+      {
+        if ((value = strchr(fields[i], '=')) == NULL)
+          continue;
+
+        *value++ = '\0';
+
+        service->num_txt = cupsAddOption(fields[i], value, service->num_txt, &(service->txt));
+      }
+
+      set_service_uri(service);
+    }
+  }
+
+  cupsFileClose(fp);
+}
+
+
 /*
  * 'resolve_callback()' - Process resolve data.
  */
@@ -2778,6 +3203,9 @@ show_usage(void)
   _cupsLangPuts(stderr, _("-6                      Connect using IPv6"));
   _cupsLangPuts(stderr, _("-T seconds              Set the browse timeout in seconds"));
   _cupsLangPuts(stderr, _("-V version              Set default IPP version"));
+  _cupsLangPuts(stderr, _("--cache seconds         Use cached results that are up to seconds old"));
+  _cupsLangPuts(stderr, _("--concurrency number    Resolve and probe up to number services at once"));
+  _cupsLangPuts(stderr, _("--probe-timeout seconds Set the per-service probe timeout in seconds"));
   _cupsLangPuts(stderr, _("--version               Show program version"));
   _cupsLangPuts(stderr, _("Expressions:"));
   _cupsLangPuts(stderr, _("-P number[-number]      Match port to number or range"));
@@ -2856,3 +3284,179 @@ show_version(void)
 
   exit(IPPFIND_EXIT_TRUE);
 }
+
+
+/*
+ * 'start_dnssd()' - Start DNS-SD browsing/resolving.
+ */
+
+static int				/* O - 1 on success, 0 on failure */
+start_dnssd(void)
+{
+  int	err;				/* DNS-SD error */
+
+
+#ifdef HAVE_DNSSD
+  if ((err = DNSServiceCreateConnection(&dnssd_ref)) != kDNSServiceErr_NoError)
+  {
+    _cupsLangPrintf(stderr, _("ippfind: Unable to use Bonjour: %s"),
+                    dnssd_error_string(err));
+    return (0);
+  }
+
+#elif defined(HAVE_AVAHI)
+  if ((avahi_poll = avahi_simple_poll_new()) == NULL)
+  {
+    _cupsLangPrintf(stderr, _("ippfind: Unable to use Bonjour: %s"),
+                    strerror(errno));
+    return (0);
+  }
+
+  avahi_simple_poll_set_func(avahi_poll, poll_callback, NULL);
+
+  avahi_client = avahi_client_new(avahi_simple_poll_get(avahi_poll),
+			          0, client_callback, avahi_poll, &err);
+  if (!avahi_client)
+  {
+    _cupsLangPrintf(stderr, _("ippfind: Unable to use Bonjour: %s"),
+                    dnssd_error_string(err));
+    return (0);
+  }
+#endif /* HAVE_DNSSD */
+
+  return (1);
+}
+
+
+/*
+ * 'start_probes()' - Start the probe threads.
+ */
+
+static int				/* O - 1 on success, 0 on failure */
+start_probes(
+    ippfind_expr_t *expressions)	/* I - Expressions */
+{
+  probe_expressions = expressions;
+
+  if ((probe_queue = cupsArrayNew(NULL, NULL)) == NULL || (probe_threads = (_cups_thread_t *)calloc((size_t)max_probes, sizeof(_cups_thread_t))) == NULL)
+    return (0);
+
+  while (num_probe_threads < max_probes)
+  {
+    if ((probe_threads[num_probe_threads] = _cupsThreadCreate(probe_thread, NULL)) == 0)
+      break;
+
+    num_probe_threads ++;
+  }
+
+  return (num_probe_threads > 0);
+}
+
+
+/*
+ * 'write_cache()' - Write the discovery cache.
+ *
+ * Services found by this run replace anything cached for the same browses,
+ * while fresh results for other browses and resolves are kept.
+ */
+
+static void
+write_cache(cups_array_t *services)	/* I - Services array */
+{
+  int			i, j;		/* Looping vars */
+  cups_file_t		*fp;		/* Cache file */
+  char			tempfile[1040],	/* Temporary cache file */
+			*ptr;		/* Pointer into filename */
+  cups_array_t		*arrays[2];	/* Arrays to write */
+  ippfind_browse_t	*browse;	/* Current browse */
+  ippfind_srv_t		*service,	/* Current service */
+			*current;	/* Service in this run */
+  time_t		curtime = time(NULL);
+					/* Current time */
+
+
+  if (!cache_file[0])
+    return;
+
+ /*
+  * Create the ~/.cups directory as needed...
+  */
+
+  strlcpy(tempfile, cache_file, sizeof(tempfile));
+  if ((ptr = strrchr(tempfile, '/')) != NULL)
+  {
+    *ptr = '\0';
+
+    if (access(tempfile, 0))
+      mkdir(tempfile, 0700);
+  }
+
+  snprintf(tempfile, sizeof(tempfile), "%s.%d", cache_file, (int)getpid());
+
+  if ((fp = cupsFileOpen(tempfile, "w")) == NULL)
+    return;
+
+  for (browse = (ippfind_browse_t *)cupsArrayFirst(cache_browses);
+       browse;
+       browse = (ippfind_browse_t *)cupsArrayNext(cache_browses))
+  {
+    if (browse->is_live || (curtime - browse->time) <= cache_ttl)
+      cupsFilePrintf(fp, "Browse\t%ld\t%s\t%s\n", (long)browse->time, browse->regtype, browse->domain);
+  }
+
+  arrays[0] = services;
+  arrays[1] = cache_services;
+
+  for (i = 0; i < 2; i ++)
+  {
+    for (service = (ippfind_srv_t *)cupsArrayFirst(arrays[i]);
+         service;
+         service = (ippfind_srv_t *)cupsArrayNext(arrays[i]))
+    {
+      if (!service->is_resolved || strpbrk(service->name, "\t\r\n") || strpbrk(service->host, "\t\r\n"))
+        continue;
+
+      if (i)
+      {
+       /*
+        * Only keep old services that are fresh, not part of this run, and not
+        * covered by a browse that was done in this run...
+        */
+
+        if ((curtime - service->cached) > cache_ttl)
+          continue;
+
+        for (current = (ippfind_srv_t *)cupsArrayFind(services, service);
+             current;
+             current = (ippfind_srv_t *)cupsArrayNext(services))
+          if (_cups_strcasecmp(current->name, service->name) || !strcmp(current->regtype, service->regtype))
+            break;
+
+        if (current && !_cups_strcasecmp(current->name, service->name))
+          continue;
+
+        for (browse = (ippfind_browse_t *)cupsArrayFirst(cache_browses);
+             browse;
+             browse = (ippfind_browse_t *)cupsArrayNext(cache_browses))
+          if (browse->is_live && cache_match(service, browse->regtype, browse->domain[0] ? browse->domain : NULL))
+            break;
+
+        if (browse)
+          continue;
+      }
+
+      cupsFilePrintf(fp, "Service\t%ld\t%s\t%s\t%s\t%s\t%d\t%d", (long)(service->cached ? service->cached : curtime), service->name, service->regtype, service->domain, service->host, service->port, service->is_local);
+
+      for (j = 0; j < service->num_txt; j ++)
+      {
+        if (!strpbrk(service->txt[j].name, "\t\r\n=") && !strpbrk(service->txt[j].value, "\t\r\n"))
+          cupsFilePrintf(fp, "\t%s=%s", service->txt[j].name, service->txt[j].value);
+      }
+
+      cupsFilePutChar(fp, '\n');
+    }
+  }
+
+  if (cupsFileClose(fp) || rename(tempfile, cache_file))
+    unlink(tempfile);
+}
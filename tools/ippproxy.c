@@ -11,6 +11,8 @@
 #include <config.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <ctype.h>
+#include <errno.h>
 #include <signal.h>
 #include <unistd.h>
 #include <fcntl.h>
@@ -18,12 +20,42 @@
 #include <cups/thread-private.h>
 
 
+/*
+ * Local constants...
+ */
+
+#define PROXY_STREAM_CHUNKS	16	/* Number of buffered document chunks */
+#define PROXY_STREAM_SIZE	16384	/* Size of each document chunk */
+
+
 /*
  * Local types...
  */
 
+typedef struct proxy_printer_s		/* Proxied output device */
+{
+  int		number;			/* Printer number for log messages */
+  const char	*printer_uri,		/* Infrastructure Printer URI */
+		*device_uri,		/* Output device URI */
+		*outformat;		/* Desired output format (NULL for auto) */
+  char		device_uuid[45];	/* Output device UUID */
+  http_t	*http;			/* Connection for events */
+  char		resource[1024];		/* Resource path */
+  int		subscription_id;	/* Event subscription ID */
+  _cups_thread_t thread;		/* Event processing thread */
+  cups_array_t	*jobs;			/* Local jobs */
+  _cups_cond_t	jobs_cond;		/* Condition variable to signal changes */
+  _cups_mutex_t	jobs_mutex;		/* Mutex for condition variable */
+  _cups_rwlock_t jobs_rwlock;		/* Read/write lock for jobs array */
+  int		fetch_next,		/* Next job allowed to fetch */
+		num_fetches;		/* Number of jobs claimed by workers */
+  int		registered;		/* Have we sent the attributes before? */
+  unsigned char	(*digests)[32];		/* SHA-256 of values last sent to the Infrastructure Printer */
+} proxy_printer_t;
+
 typedef struct proxy_info_s		/* Proxy thread information */
 {
+  proxy_printer_t *printer;		/* Proxied output device */
   int		done;			/* Non-zero when done */
   http_t	*http;			/* Connection to Infrastructure Printer */
   char		resource[256];		/* Resource path */
@@ -32,30 +64,59 @@ typedef struct proxy_info_s		/* Proxy thread information */
 		*device_uuid,		/* Output device UUID */
 		*outformat;		/* Desired output format (NULL for auto) */
   ipp_t		*device_attrs;		/* Output device attributes */
+  http_t	*device_http;		/* Kept-alive connection to IPP device */
 } proxy_info_t;
 
 typedef struct proxy_job_s		/* Proxy job information */
 {
+  proxy_printer_t *printer;		/* Proxied output device */
   ipp_jstate_t	local_job_state;	/* Local job-state value */
   int		local_job_id,		/* Local job-id value */
 		remote_job_id,		/* Remote job-id value */
 		remote_job_state;	/* Remote job-state value */
+  int		busy,			/* Being processed by a worker? */
+		fetch_number;		/* Order for Fetch-Job/Acknowledge-Job */
+  int		impressions_completed;	/* Local job-impressions-completed value */
+  int		job_pending,		/* Job status update pending? */
+		doc_pending,		/* Document status update pending? */
+		doc_number;		/* Document number for pending update */
+  ipp_dstate_t	doc_state;		/* Document state for pending update */
+  ipp_jstate_t	sent_job_state;		/* Last output-device-job-state sent */
+  int		sent_impressions;	/* Last job-impressions-completed sent */
+  time_t	status_time;		/* Time of last status update */
 } proxy_job_t;
 
+typedef struct proxy_stream_s		/* Document data stream */
+{
+  http_t	*http;			/* Connection to Infrastructure Printer */
+  _cups_thread_t thread;		/* Fetch thread */
+  _cups_mutex_t	mutex;			/* Mutex for stream state */
+  _cups_cond_t	cond;			/* Condition variable for stream state */
+  int		done,			/* Non-zero to stop fetching */
+		eof,			/* Non-zero at end of document */
+		holding;		/* Non-zero while a chunk is being written */
+  int		head,			/* First chunk to write */
+		count;			/* Number of chunks buffered */
+  size_t	total;			/* Total bytes fetched */
+  ssize_t	lengths[PROXY_STREAM_CHUNKS];
+					/* Length of each chunk */
+  char		chunks[PROXY_STREAM_CHUNKS][PROXY_STREAM_SIZE];
+					/* Document data */
+} proxy_stream_t;
+
 
 /*
  * Local globals...
  */
 
-static cups_array_t	*jobs;		/* Local jobs */
-static _cups_cond_t	jobs_cond = _CUPS_COND_INITIALIZER;
-					/* Condition variable to signal changes */
-static _cups_mutex_t	jobs_mutex = _CUPS_MUTEX_INITIALIZER;
-					/* Mutex for condition variable */
-static _cups_rwlock_t	jobs_rwlock = _CUPS_RWLOCK_INITIALIZER;
-					/* Read/write lock for jobs array */
+static int		num_printers = 0;/* Number of proxied output devices */
+static int		num_workers = 1;/* Number of job workers */
 static char		*password = NULL;
 					/* Password, if any */
+static char		*username = NULL;
+					/* Username, if any */
+static int		update_interval = 1;
+					/* Minimum seconds between status updates */
 
 static const char * const printer_attrs[] =
 		{			/* Printer attributes we care about */
@@ -102,23 +163,32 @@ static int	verbosity = 0;
  */
 
 static void	acknowledge_identify_printer(http_t *http, const char *printer_uri, const char *resource, const char *device_uuid);
-static int	attrs_are_equal(ipp_attribute_t *a, ipp_attribute_t *b);
+static int	check_connection(http_t *http);
 static int	compare_jobs(proxy_job_t *a, proxy_job_t *b);
+static int	compare_strings(const char **a, const char **b);
 static ipp_t	*create_media_col(const char *media, const char *source, const char *type, int width, int length, int margins);
 static ipp_t	*create_media_size(int width, int length);
-static void	deregister_printer(http_t *http, const char *printer_uri, const char *resource, int subscription_id, const char *device_uuid);
-static proxy_job_t *find_job(int remote_job_id);
+static void	deregister_printer(proxy_printer_t *printer);
+static void	digest_attr(ipp_attribute_t *attr, unsigned char *digest);
+static void	*fetch_stream(proxy_stream_t *stream);
+static proxy_job_t *find_job(proxy_printer_t *printer, int remote_job_id);
+static void	finish_fetch(proxy_printer_t *printer);
+static void	flush_status(proxy_info_t *info, proxy_job_t *pjob, int force);
 static ipp_t	*get_device_attrs(const char *device_uri);
 static void	make_uuid(const char *device_uri, char *uuid, size_t uuidsize);
 static const char *password_cb(const char *prompt, http_t *http, const char *method, const char *resource, void *user_data);
 static void	plogf(proxy_job_t *pjob, const char *message, ...);
 static void	*proxy_jobs(proxy_info_t *info);
-static int	register_printer(http_t *http, const char *printer_uri, const char *resource, const char *device_uri, const char *device_uuid);
+static ssize_t	read_stream(proxy_stream_t *stream, char **data);
+static int	register_printer(proxy_printer_t *printer);
 static void	run_job(proxy_info_t *info, proxy_job_t *pjob);
-static void	run_printer(http_t *http, const char *printer_uri, const char *resource, int subscription_id, const char *device_uri, const char *device_uuid, const char *outformat);
+static void	*run_printer(proxy_printer_t *printer);
 static void	send_document(proxy_info_t *info, proxy_job_t *pjob, ipp_t *job_attrs, ipp_t *doc_attrs, int doc_number);
 static void	sighandler(int sig);
-static int	update_device_attrs(http_t *http, const char *printer_uri, const char *resource, const char *device_uuid, ipp_t *old_attrs, ipp_t *new_attrs);
+static void	start_fetch(proxy_printer_t *printer, proxy_job_t *pjob);
+static proxy_stream_t *start_stream(http_t *http);
+static size_t	stop_stream(proxy_stream_t *stream);
+static int	update_device_attrs(proxy_printer_t *printer, ipp_t *new_attrs);
 static void	update_document_status(proxy_info_t *info, proxy_job_t *pjob, int doc_number, ipp_dstate_t doc_state);
 static void	update_job_status(proxy_info_t *info, proxy_job_t *pjob);
 static void	usage(int status) _CUPS_NORETURN;
@@ -133,17 +203,26 @@ main(int  argc,				/* I - Number of command-line arguments */
      char *argv[])			/* I - Command-line arguments */
 {
   int		i;			/* Looping var */
-  char		*opt,			/* Current option */
-		*device_uri = NULL,	/* Device URI */
-		*printer_uri = NULL;	/* Infrastructure printer URI */
+  char		*opt;			/* Current option */
+  int		num_devices = 0,	/* Number of device URIs */
+		num_registered = 0;	/* Number of registered printers */
+  proxy_printer_t *printers,		/* Proxied output devices */
+		*printer;		/* Current output device */
   cups_dest_t	*dest;			/* Destination for printer URI */
-  http_t	*http;			/* Connection to printer */
-  char		resource[1024];		/* Resource path */
-  int		subscription_id;	/* Event subscription ID */
-  char		device_uuid[45];	/* Device UUID URN */
   const char	*outformat = NULL;	/* Output format */
 
 
+ /*
+  * Allocate enough printers for every device and printer URI on the command
+  * line...
+  */
+
+  if ((printers = calloc((size_t)argc, sizeof(proxy_printer_t))) == NULL)
+  {
+    perror("ippproxy: Unable to allocate memory");
+    return (1);
+  }
+
  /*
   * Parse command-line...
   */
@@ -186,7 +265,37 @@ main(int  argc,				/* I - Number of command-line arguments */
 	        usage(1);
 	      }
 
-	      device_uri = argv[i];
+	      printers[num_devices ++].device_uri = argv[i];
+	      break;
+
+	  case 'i' : /* -i interval */
+	      i ++;
+	      if (i >= argc || !isdigit(argv[i][0] & 255))
+	      {
+	        fputs("ippproxy: Missing update interval after '-i' option.\n", stderr);
+		usage(1);
+	      }
+
+	      if ((update_interval = atoi(argv[i])) > 3600)
+	      {
+	        fputs("ippproxy: Update interval must be between 0 and 3600 seconds.\n", stderr);
+		usage(1);
+	      }
+	      break;
+
+	  case 'j' : /* -j workers */
+	      i ++;
+	      if (i >= argc || !isdigit(argv[i][0] & 255))
+	      {
+	        fputs("ippproxy: Missing number of workers after '-j' option.\n", stderr);
+		usage(1);
+	      }
+
+	      if ((num_workers = atoi(argv[i])) < 1 || num_workers > 100)
+	      {
+	        fputs("ippproxy: Number of workers must be between 1 and 100.\n", stderr);
+		usage(1);
+	      }
 	      break;
 
           case 'm' : /* -m mime/type */
@@ -219,7 +328,8 @@ main(int  argc,				/* I - Number of command-line arguments */
 		usage(1);
 	      }
 
-	      cupsSetUser(argv[i]);
+	      username = argv[i];
+	      cupsSetUser(username);
 	      break;
 
           case 'v' : /* Be verbose */
@@ -233,73 +343,123 @@ main(int  argc,				/* I - Number of command-line arguments */
 	}
       }
     }
-    else if (printer_uri)
-    {
-      fprintf(stderr, "ippproxy: Unexpected option '%s'.\n", argv[i]);
-      usage(1);
-    }
     else
-      printer_uri = argv[i];
+      printers[num_printers ++].printer_uri = argv[i];
   }
 
-  if (!printer_uri)
+  if (!num_printers)
     usage(1);
 
-  if (!device_uri)
+  if (!num_devices)
   {
     fputs("ippproxy: Must specify '-d device-uri'.\n", stderr);
     usage(1);
   }
 
+  if (num_devices != num_printers)
+  {
+    fputs("ippproxy: Must specify one '-d device-uri' for each printer URI.\n", stderr);
+    usage(1);
+  }
+
   if (!password)
     password = getenv("IPPPROXY_PASSWORD");
 
+  if (username)
+    cupsSetUser(username);
+
   if (password)
     cupsSetPasswordCB2(password_cb, password);
 
-  make_uuid(device_uri, device_uuid, sizeof(device_uuid));
-
  /*
-  * Connect to the infrastructure printer...
+  * Connect to the infrastructure printers and register the output devices...
   */
 
-  dest = cupsGetDestWithURI("infra", printer_uri);
-
-  if (verbosity)
-    plogf(NULL, "Main thread connecting to '%s'.", printer_uri);
+  signal(SIGHUP, sighandler);
+  signal(SIGINT, sighandler);
+  signal(SIGTERM, sighandler);
 
-  while ((http = cupsConnectDest(dest, CUPS_DEST_FLAGS_DEVICE, 30000, NULL, resource, sizeof(resource), NULL, NULL)) == NULL)
+  for (i = 0, printer = printers; i < num_printers; i ++, printer ++)
   {
-    int interval = 1 + (CUPS_RAND() % 30);
+    printer->number    = i + 1;
+    printer->outformat = outformat;
+    printer->jobs      = cupsArrayNew3((cups_array_func_t)compare_jobs, NULL, NULL, 0, NULL, (cups_afree_func_t)free);
+    printer->digests   = calloc(sizeof(printer_attrs) / sizeof(printer_attrs[0]), sizeof(printer->digests[0]));
+
+    if (!printer->jobs || !printer->digests)
+    {
+      plogf(NULL, "Unable to allocate memory for '%s'.", printer->device_uri);
+      return (1);
+    }
+
+    _cupsCondInit(&printer->jobs_cond);
+    _cupsMutexInit(&printer->jobs_mutex);
+    _cupsRWInit(&printer->jobs_rwlock);
+
+    make_uuid(printer->device_uri, printer->device_uuid, sizeof(printer->device_uuid));
+
+    dest = cupsGetDestWithURI("infra", printer->printer_uri);
+
+    if (verbosity)
+      plogf(NULL, "Main thread connecting to '%s'.", printer->printer_uri);
+
+    while ((printer->http = cupsConnectDest(dest, CUPS_DEST_FLAGS_DEVICE, 30000, NULL, printer->resource, sizeof(printer->resource), NULL, NULL)) == NULL)
+    {
+      int interval = 1 + (CUPS_RAND() % 30);
 					/* Retry interval */
 
-    plogf(NULL, "'%s' is not responding, retrying in %d seconds.", printer_uri, interval);
-    sleep((unsigned)interval);
+      plogf(NULL, "'%s' is not responding, retrying in %d seconds.", printer->printer_uri, interval);
+      sleep((unsigned)interval);
+    }
+
+    if (verbosity)
+      plogf(NULL, "Connected to '%s'.", printer->printer_uri);
+
+    cupsFreeDests(1, dest);
+
+    if ((printer->subscription_id = register_printer(printer)) == 0)
+    {
+      httpClose(printer->http);
+      printer->http = NULL;
+      continue;
+    }
+
+   /*
+    * Each output device gets its own event thread and job workers...
+    */
+
+    if ((printer->thread = _cupsThreadCreate((_cups_thread_func_t)run_printer, printer)) == 0)
+    {
+      plogf(NULL, "Unable to start event thread for '%s'.", printer->device_uri);
+      deregister_printer(printer);
+      httpClose(printer->http);
+      printer->http = NULL;
+      continue;
+    }
+
+    num_registered ++;
   }
 
-  if (verbosity)
-    plogf(NULL, "Connected to '%s'.", printer_uri);
+  if (!num_registered)
+    return (1);
 
-  cupsFreeDests(1, dest);
+  if (verbosity && num_printers > 1)
+    plogf(NULL, "Proxying %d of %d output devices.", num_registered, num_printers);
 
  /*
-  * Register the printer and wait for jobs to process...
+  * Wait for the event threads to stop and then deregister...
   */
 
-  signal(SIGHUP, sighandler);
-  signal(SIGINT, sighandler);
-  signal(SIGTERM, sighandler);
-
-  if ((subscription_id = register_printer(http, printer_uri, resource, device_uri, device_uuid)) == 0)
+  for (i = 0, printer = printers; i < num_printers; i ++, printer ++)
   {
-    httpClose(http);
-    return (1);
-  }
+    if (!printer->http)
+      continue;
 
-  run_printer(http, printer_uri, resource, subscription_id, device_uri, device_uuid, outformat);
+    _cupsThreadWait(printer->thread);
 
-  deregister_printer(http, printer_uri, resource, subscription_id, device_uuid);
-  httpClose(http);
+    deregister_printer(printer);
+    httpClose(printer->http);
+  }
 
   return (0);
 }
@@ -343,73 +503,19 @@ acknowledge_identify_printer(
 
 
 /*
- * 'attrs_are_equal()' - Compare two attributes for equality.
+ * 'check_connection()' - Make sure a kept-alive connection is still usable.
+ *
+ * An idle connection that has data to read has been closed by the peer, so it
+ * is reconnected before the next request rather than failing the request.
  */
 
-static int				/* O - 1 if equal, 0 otherwise */
-attrs_are_equal(ipp_attribute_t *a,	/* I - First attribute */
-                ipp_attribute_t *b)	/* I - Second attribute */
+static int				/* O - 1 if usable, 0 otherwise */
+check_connection(http_t *http)		/* I - Connection */
 {
-  int		i,			/* Looping var */
-		count;			/* Number of values */
-  ipp_tag_t	tag;			/* Type of value */
-
-
- /*
-  * Check that both 'a' and 'b' point to something first...
-  */
-
-  if ((a != NULL) != (b != NULL))
-    return (0);
-
-  if (a == NULL && b == NULL)
+  if (httpGetFd(http) >= 0 && !httpWait(http, 0))
     return (1);
 
- /*
-  * Check that 'a' and 'b' are of the same type with the same number
-  * of values...
-  */
-
-  if ((tag = ippGetValueTag(a)) != ippGetValueTag(b))
-    return (0);
-
-  if ((count = ippGetCount(a)) != ippGetCount(b))
-    return (0);
-
- /*
-  * Compare values...
-  */
-
-  switch (tag)
-  {
-    case IPP_TAG_INTEGER :
-    case IPP_TAG_ENUM :
-        for (i = 0; i < count; i ++)
-	  if (ippGetInteger(a, i) != ippGetInteger(b, i))
-	    return (0);
-	break;
-
-    case IPP_TAG_BOOLEAN :
-        for (i = 0; i < count; i ++)
-	  if (ippGetBoolean(a, i) != ippGetBoolean(b, i))
-	    return (0);
-	break;
-
-    case IPP_TAG_KEYWORD :
-        for (i = 0; i < count; i ++)
-	  if (strcmp(ippGetString(a, i, NULL), ippGetString(b, i, NULL)))
-	    return (0);
-	break;
-
-    default :
-        return (0);
-  }
-
- /*
-  * If we get this far we must be the same...
-  */
-
-  return (1);
+  return (!httpReconnect2(http, 30000, NULL));
 }
 
 
@@ -425,6 +531,18 @@ compare_jobs(proxy_job_t *a,		/* I - First job */
 }
 
 
+/*
+ * 'compare_strings()' - Compare two strings for bsearch().
+ */
+
+static int				/* O - Result of comparison */
+compare_strings(const char **a,		/* I - First string */
+                const char **b)		/* I - Second string */
+{
+  return (strcmp(*a, *b));
+}
+
+
 /*
  * 'create_media_col()' - Create a media-col value.
  */
@@ -501,11 +619,7 @@ create_media_size(int width,		/* I - x-dimension in 2540ths */
 
 static void
 deregister_printer(
-    http_t     *http,			/* I - Connection to printer */
-    const char *printer_uri,		/* I - Printer URI */
-    const char *resource,		/* I - Resource path */
-    int        subscription_id,		/* I - Subscription ID */
-    const char *device_uuid)		/* I - Device UUID */
+    proxy_printer_t *printer)		/* I - Proxied output device */
 {
   ipp_t	*request;			/* IPP request */
 
@@ -515,22 +629,110 @@ deregister_printer(
   */
 
   request = ippNewRequest(IPP_OP_DEREGISTER_OUTPUT_DEVICE);
-  ippAddString(request, IPP_TAG_OPERATION, IPP_TAG_URI, "printer-uri", NULL, printer_uri);
-  ippAddString(request, IPP_TAG_OPERATION, IPP_TAG_URI, "output-device-uuid", NULL, device_uuid);
+  ippAddString(request, IPP_TAG_OPERATION, IPP_TAG_URI, "printer-uri", NULL, printer->printer_uri);
+  ippAddString(request, IPP_TAG_OPERATION, IPP_TAG_URI, "output-device-uuid", NULL, printer->device_uuid);
   ippAddString(request, IPP_TAG_OPERATION, IPP_TAG_NAME, "requesting-user-name", NULL, cupsUser());
 
-  ippDelete(cupsDoRequest(http, request, resource));
+  ippDelete(cupsDoRequest(printer->http, request, printer->resource));
 
  /*
   * Then cancel the subscription we are using...
   */
 
   request = ippNewRequest(IPP_OP_CANCEL_SUBSCRIPTION);
-  ippAddString(request, IPP_TAG_OPERATION, IPP_TAG_URI, "printer-uri", NULL, printer_uri);
-  ippAddInteger(request, IPP_TAG_OPERATION, IPP_TAG_INTEGER, "notify-subscription-id", subscription_id);
+  ippAddString(request, IPP_TAG_OPERATION, IPP_TAG_URI, "printer-uri", NULL, printer->printer_uri);
+  ippAddInteger(request, IPP_TAG_OPERATION, IPP_TAG_INTEGER, "notify-subscription-id", printer->subscription_id);
   ippAddString(request, IPP_TAG_OPERATION, IPP_TAG_NAME, "requesting-user-name", NULL, cupsUser());
 
-  ippDelete(cupsDoRequest(http, request, resource));
+  ippDelete(cupsDoRequest(printer->http, request, printer->resource));
+}
+
+
+/*
+ * 'digest_attr()' - Compute a SHA-256 digest of an attribute's values.
+ */
+
+static void
+digest_attr(ipp_attribute_t *attr,	/* I - Attribute */
+            unsigned char   *digest)	/* O - 32-byte digest */
+{
+  char		buffer[8192],		/* String buffer */
+		*bufptr = buffer;	/* Pointer to string */
+  size_t	bufsize;		/* Length of string */
+
+
+ /*
+  * Hash the value tag along with the string form of the values so that a
+  * change of syntax also counts as a change...
+  */
+
+  bufsize = ippAttributeString(attr, NULL, 0) + 32;
+
+  if (bufsize > sizeof(buffer) && (bufptr = malloc(bufsize)) == NULL)
+  {
+    memset(digest, 0, 32);
+    return;
+  }
+
+  snprintf(bufptr, bufsize, "%s:", ippTagString(ippGetValueTag(attr)));
+  ippAttributeString(attr, bufptr + strlen(bufptr), bufsize - strlen(bufptr));
+
+  cupsHashData("sha-256", bufptr, strlen(bufptr), digest, 32);
+
+  if (bufptr != buffer)
+    free(bufptr);
+}
+
+
+/*
+ * 'fetch_stream()' - Read document data from the Infrastructure Printer.
+ *
+ * Data is read into a bounded ring of chunks so that the device is fed while
+ * the rest of the document is still being downloaded.
+ */
+
+static void *				/* O - Thread exit status */
+fetch_stream(proxy_stream_t *stream)	/* I - Document stream */
+{
+  int		chunk;			/* Chunk to fill */
+  ssize_t	bytes;			/* Bytes read */
+
+
+  _cupsMutexLock(&stream->mutex);
+
+  while (!stream->done)
+  {
+    while (stream->count >= PROXY_STREAM_CHUNKS && !stream->done)
+      _cupsCondWait(&stream->cond, &stream->mutex, 0.0);
+
+    if (stream->done)
+      break;
+
+    chunk = (stream->head + stream->count) % PROXY_STREAM_CHUNKS;
+
+    _cupsMutexUnlock(&stream->mutex);
+
+    bytes = cupsReadResponseData(stream->http, stream->chunks[chunk], sizeof(stream->chunks[chunk]));
+
+    _cupsMutexLock(&stream->mutex);
+
+    if (bytes <= 0)
+    {
+      stream->eof = 1;
+      _cupsCondBroadcast(&stream->cond);
+      break;
+    }
+
+    stream->lengths[chunk] = bytes;
+    stream->count ++;
+    stream->total += (size_t)bytes;
+
+    _cupsCondBroadcast(&stream->cond);
+  }
+
+  _cupsMutexUnlock(&stream->mutex);
+
+  return (NULL);
 }
 
 
@@ -539,7 +741,8 @@ deregister_printer(
  */
 
 static proxy_job_t *			/* O - Proxy job or @code NULL@ if not found */
-find_job(int remote_job_id)		/* I - Remote job ID */
+find_job(proxy_printer_t *printer,	/* I - Proxied output device */
+         int             remote_job_id)	/* I - Remote job ID */
 {
   proxy_job_t	key,			/* Search key */
 		*match;			/* Matching job, if any */
@@ -547,14 +750,95 @@ find_job(int remote_job_id)		/* I - Remote job ID */
 
   key.remote_job_id = remote_job_id;
 
-  _cupsRWLockRead(&jobs_rwlock);
-  match = (proxy_job_t *)cupsArrayFind(jobs, &key);
-  _cupsRWUnlock(&jobs_rwlock);
+  _cupsRWLockRead(&printer->jobs_rwlock);
+  match = (proxy_job_t *)cupsArrayFind(printer->jobs, &key);
+  _cupsRWUnlock(&printer->jobs_rwlock);
 
   return (match);
 }
 
 
+/*
+ * 'finish_fetch()' - Let the next job be fetched and acknowledged.
+ */
+
+static void
+finish_fetch(proxy_printer_t *printer)	/* I - Proxied output device */
+{
+  _cupsMutexLock(&printer->jobs_mutex);
+  printer->fetch_next ++;
+  _cupsCondBroadcast(&printer->jobs_cond);
+  _cupsMutexUnlock(&printer->jobs_mutex);
+}
+
+
+/*
+ * 'flush_status()' - Send pending job and document status updates.
+ *
+ * Updates are coalesced so that at most one status request is sent for a job
+ * every "update_interval" seconds.  Terminal states are forced out right away.
+ */
+
+static void
+flush_status(proxy_info_t *info,	/* I - Proxy info */
+             proxy_job_t  *pjob,	/* I - Proxy job */
+             int          force)	/* I - Send now regardless of interval? */
+{
+  ipp_t		*request;		/* IPP request */
+  time_t	curtime = time(NULL);	/* Current time */
+
+
+  if (!pjob->job_pending && !pjob->doc_pending)
+    return;
+
+  if (!force && update_interval > 0 && (curtime - pjob->status_time) < update_interval)
+    return;
+
+  if (pjob->doc_pending)
+  {
+    request = ippNewRequest(IPP_OP_UPDATE_DOCUMENT_STATUS);
+    ippAddString(request, IPP_TAG_OPERATION, IPP_TAG_URI, "printer-uri", NULL, info->printer_uri);
+    ippAddInteger(request, IPP_TAG_OPERATION, IPP_TAG_INTEGER, "job-id", pjob->remote_job_id);
+    ippAddInteger(request, IPP_TAG_OPERATION, IPP_TAG_INTEGER, "document-number", pjob->doc_number);
+    ippAddString(request, IPP_TAG_OPERATION, IPP_TAG_URI, "output-device-uuid", NULL, info->device_uuid);
+    ippAddString(request, IPP_TAG_OPERATION, IPP_TAG_NAME, "requesting-user-name", NULL, cupsUser());
+
+    ippAddInteger(request, IPP_TAG_JOB, IPP_TAG_ENUM, "output-device-document-state", pjob->doc_state);
+
+    ippDelete(cupsDoRequest(info->http, request, info->resource));
+
+    if (cupsLastError() >= IPP_STATUS_REDIRECTION_OTHER_SITE)
+      plogf(pjob, "Unable to update the state for document #%d: %s", pjob->doc_number, cupsLastErrorString());
+
+    pjob->doc_pending = 0;
+  }
+
+  if (pjob->job_pending)
+  {
+    request = ippNewRequest(IPP_OP_UPDATE_JOB_STATUS);
+    ippAddString(request, IPP_TAG_OPERATION, IPP_TAG_URI, "printer-uri", NULL, info->printer_uri);
+    ippAddInteger(request, IPP_TAG_OPERATION, IPP_TAG_INTEGER, "job-id", pjob->remote_job_id);
+    ippAddString(request, IPP_TAG_OPERATION, IPP_TAG_URI, "output-device-uuid", NULL, info->device_uuid);
+    ippAddString(request, IPP_TAG_OPERATION, IPP_TAG_NAME, "requesting-user-name", NULL, cupsUser());
+
+    ippAddInteger(request, IPP_TAG_JOB, IPP_TAG_ENUM, "output-device-job-state", pjob->local_job_state);
+    if (pjob->impressions_completed != pjob->sent_impressions)
+      ippAddInteger(request, IPP_TAG_JOB, IPP_TAG_INTEGER, "job-impressions-completed", pjob->impressions_completed);
+
+    ippDelete(cupsDoRequest(info->http, request, info->resource));
+
+    if (cupsLastError() >= IPP_STATUS_REDIRECTION_OTHER_SITE)
+      plogf(pjob, "Unable to update the job state: %s", cupsLastErrorString());
+
+    pjob->job_pending      = 0;
+    pjob->sent_job_state   = pjob->local_job_state;
+    pjob->sent_impressions = pjob->impressions_completed;
+  }
+
+  pjob->status_time = curtime;
+}
+
+
 /*
  * 'get_device_attrs()' - Get current attributes for a device.
  */
@@ -891,7 +1175,9 @@ plogf(proxy_job_t *pjob,			/* I - Proxy job, if any */
   gettimeofday(&curtime, NULL);
   gmtime_r(&curtime.tv_sec, &curdate);
 
-  if (pjob)
+  if (pjob && pjob->printer && num_printers > 1)
+    snprintf(temp, sizeof(temp), "%04d-%02d-%02dT%02d:%02d:%02d.%03dZ  [Printer %d Job %d] %s\n", curdate.tm_year + 1900, curdate.tm_mon + 1, curdate.tm_mday, curdate.tm_hour, curdate.tm_min, curdate.tm_sec, (int)curtime.tv_usec / 1000, pjob->printer->number, pjob->remote_job_id, message);
+  else if (pjob)
     snprintf(temp, sizeof(temp), "%04d-%02d-%02dT%02d:%02d:%02d.%03dZ  [Job %d] %s\n", curdate.tm_year + 1900, curdate.tm_mon + 1, curdate.tm_mday, curdate.tm_hour, curdate.tm_min, curdate.tm_sec, (int)curtime.tv_usec / 1000, pjob->remote_job_id, message);
   else
     snprintf(temp, sizeof(temp), "%04d-%02d-%02dT%02d:%02d:%02d.%03dZ  %s\n", curdate.tm_year + 1900, curdate.tm_mon + 1, curdate.tm_mday, curdate.tm_hour, curdate.tm_min, curdate.tm_sec, (int)curtime.tv_usec / 1000, message);
@@ -909,6 +1195,8 @@ plogf(proxy_job_t *pjob,			/* I - Proxy job, if any */
 static void *				/* O - Thread exit status */
 proxy_jobs(proxy_info_t *info)		/* I - Printer and device info */
 {
+  proxy_printer_t *printer = info->printer;
+					/* Proxied output device */
   cups_dest_t	*dest;			/* Destination for printer URI */
   proxy_job_t	*pjob;			/* Current job */
 //  ipp_t		*new_attrs;		/* New device attributes */
@@ -921,6 +1209,9 @@ proxy_jobs(proxy_info_t *info)		/* I - Printer and device info */
   if (verbosity)
     plogf(NULL, "Job processing thread starting.");
 
+  if (username)
+    cupsSetUser(username);
+
   if (password)
     cupsSetPasswordCB2(password_cb, password);
 
@@ -929,7 +1220,7 @@ proxy_jobs(proxy_info_t *info)		/* I - Printer and device info */
   if (verbosity)
     plogf(NULL, "Connecting to '%s'.", info->printer_uri);
 
-  while ((info->http = cupsConnectDest(dest, CUPS_DEST_FLAGS_DEVICE, 30000, NULL, info->resource, sizeof(info->resource), NULL, NULL)) == NULL)
+  while (!info->done && (info->http = cupsConnectDest(dest, CUPS_DEST_FLAGS_DEVICE, 30000, NULL, info->resource, sizeof(info->resource), NULL, NULL)) == NULL)
   {
     int interval = 1 + (CUPS_RAND() % 30);
 					/* Retry interval */
@@ -943,7 +1234,7 @@ proxy_jobs(proxy_info_t *info)		/* I - Printer and device info */
   if (verbosity)
     plogf(NULL, "Connected to '%s'.", info->printer_uri);
 
-  _cupsMutexLock(&jobs_mutex);
+  _cupsMutexLock(&printer->jobs_mutex);
 
   while (!info->done)
   {
@@ -954,21 +1245,31 @@ proxy_jobs(proxy_info_t *info)		/* I - Printer and device info */
     if (verbosity)
       plogf(NULL, "Checking for queued jobs.");
 
-    _cupsRWLockRead(&jobs_rwlock);
-    for (pjob = (proxy_job_t *)cupsArrayFirst(jobs); pjob; pjob = (proxy_job_t *)cupsArrayNext(jobs))
+    _cupsRWLockRead(&printer->jobs_rwlock);
+    for (pjob = (proxy_job_t *)cupsArrayFirst(printer->jobs); pjob; pjob = (proxy_job_t *)cupsArrayNext(printer->jobs))
     {
-      if (pjob->local_job_state == IPP_JSTATE_PENDING && pjob->remote_job_state < IPP_JSTATE_CANCELED)
+      if (pjob->local_job_state == IPP_JSTATE_PENDING && !pjob->busy && pjob->remote_job_state < IPP_JSTATE_CANCELED)
         break;
     }
-    _cupsRWUnlock(&jobs_rwlock);
+    _cupsRWUnlock(&printer->jobs_rwlock);
 
     if (pjob)
     {
      /*
-      * Process this job...
+      * Claim this job and process it without holding the mutex so that other
+      * workers can process jobs at the same time...
       */
 
+      pjob->busy         = 1;
+      pjob->fetch_number = printer->num_fetches ++;
+
+      _cupsMutexUnlock(&printer->jobs_mutex);
+
       run_job(info, pjob);
+
+      _cupsMutexLock(&printer->jobs_mutex);
+
+      pjob->busy = 0;
     }
     else
     {
@@ -977,38 +1278,76 @@ proxy_jobs(proxy_info_t *info)		/* I - Printer and device info */
       * jobs...
       */
 
-      _cupsRWLockWrite(&jobs_rwlock);
-      for (pjob = (proxy_job_t *)cupsArrayFirst(jobs); pjob; pjob = (proxy_job_t *)cupsArrayNext(jobs))
+      _cupsRWLockWrite(&printer->jobs_rwlock);
+      for (pjob = (proxy_job_t *)cupsArrayFirst(printer->jobs); pjob; pjob = (proxy_job_t *)cupsArrayNext(printer->jobs))
       {
-	if (pjob->remote_job_state >= IPP_JSTATE_CANCELED)
-	  cupsArrayRemove(jobs, pjob);
+	if (pjob->remote_job_state >= IPP_JSTATE_CANCELED && !pjob->busy)
+	  cupsArrayRemove(printer->jobs, pjob);
       }
-      _cupsRWUnlock(&jobs_rwlock);
+      _cupsRWUnlock(&printer->jobs_rwlock);
 
       if (verbosity)
         plogf(NULL, "Waiting for jobs.");
 
-      _cupsCondWait(&jobs_cond, &jobs_mutex, 15.0);
+      _cupsCondWait(&printer->jobs_cond, &printer->jobs_mutex, 15.0);
     }
   }
 
-  _cupsMutexUnlock(&jobs_mutex);
+  _cupsMutexUnlock(&printer->jobs_mutex);
 
   return (NULL);
 }
 
 
+/*
+ * 'read_stream()' - Get the next chunk of document data.
+ *
+ * The previous chunk is released back to the fetch thread on each call.
+ */
+
+static ssize_t				/* O - Number of bytes or 0 at end */
+read_stream(proxy_stream_t *stream,	/* I - Document stream */
+            char           **data)	/* O - Document data */
+{
+  ssize_t	bytes = 0;		/* Bytes available */
+
+
+  _cupsMutexLock(&stream->mutex);
+
+  if (stream->holding)
+  {
+    stream->head     = (stream->head + 1) % PROXY_STREAM_CHUNKS;
+    stream->count --;
+    stream->holding = 0;
+
+    _cupsCondBroadcast(&stream->cond);
+  }
+
+  while (!stream->count && !stream->eof)
+    _cupsCondWait(&stream->cond, &stream->mutex, 0.0);
+
+  if (stream->count)
+  {
+    *data           = stream->chunks[stream->head];
+    bytes           = stream->lengths[stream->head];
+    stream->holding = 1;
+  }
+  else
+    *data = NULL;
+
+  _cupsMutexUnlock(&stream->mutex);
+
+  return (bytes);
+}
+
+
 /*
  * 'register_printer()' - Register the printer (output device) with the Infrastructure Printer.
  */
 
 static int				/* O - Subscription ID */
 register_printer(
-    http_t     *http,			/* I - Connection to printer */
-    const char *printer_uri,		/* I - Printer URI */
-    const char *resource,		/* I - Resource path */
-    const char *device_uri,		/* I - Device URI, if any */
-    const char *device_uuid)		/* I - Device UUID */
+    proxy_printer_t *printer)		/* I - Proxied output device */
 {
   ipp_t		*request,		/* IPP request */
 		*response;		/* IPP response */
@@ -1026,26 +1365,23 @@ register_printer(
   };
 
 
-  (void)device_uri;
-  (void)device_uuid;
-
  /*
   * Create a printer subscription to monitor for events...
   */
 
   request = ippNewRequest(IPP_OP_CREATE_PRINTER_SUBSCRIPTION);
-  ippAddString(request, IPP_TAG_OPERATION, IPP_TAG_URI, "printer-uri", NULL, printer_uri);
+  ippAddString(request, IPP_TAG_OPERATION, IPP_TAG_URI, "printer-uri", NULL, printer->printer_uri);
   ippAddString(request, IPP_TAG_OPERATION, IPP_TAG_NAME, "requesting-user-name", NULL, cupsUser());
 
   ippAddString(request, IPP_TAG_SUBSCRIPTION, IPP_TAG_KEYWORD, "notify-pull-method", NULL, "ippget");
   ippAddStrings(request, IPP_TAG_SUBSCRIPTION, IPP_TAG_KEYWORD, "notify-events", (int)(sizeof(events) / sizeof(events[0])), NULL, events);
   ippAddInteger(request, IPP_TAG_SUBSCRIPTION, IPP_TAG_INTEGER, "notify-lease-duration", 0);
 
-  response = cupsDoRequest(http, request, resource);
+  response = cupsDoRequest(printer->http, request, printer->resource);
 
   if (cupsLastError() != IPP_STATUS_OK)
   {
-    plogf(NULL, "Unable to monitor events on '%s': %s", printer_uri, cupsLastErrorString());
+    plogf(NULL, "Unable to monitor events on '%s': %s", printer->printer_uri, cupsLastErrorString());
     return (0);
   }
 
@@ -1058,7 +1394,7 @@ register_printer(
   }
   else
   {
-    plogf(NULL, "Unable to monitor events on '%s': No notify-subscription-id returned.", printer_uri);
+    plogf(NULL, "Unable to monitor events on '%s': No notify-subscription-id returned.", printer->printer_uri);
   }
 
   ippDelete(response);
@@ -1112,7 +1448,9 @@ run_job(proxy_info_t *info,		/* I - Proxy information */
   ippAddString(request, IPP_TAG_OPERATION, IPP_TAG_URI, "output-device-uuid", NULL, info->device_uuid);
   ippAddString(request, IPP_TAG_OPERATION, IPP_TAG_NAME, "requesting-user-name", NULL, cupsUser());
 
-  httpReconnect(info->http);
+  check_connection(info->http);
+
+  start_fetch(info->printer, pjob);
 
   job_attrs = cupsDoRequest(info->http, request, info->resource);
 
@@ -1122,6 +1460,8 @@ run_job(proxy_info_t *info,		/* I - Proxy information */
     * Cannot proxy this job...
     */
 
+    finish_fetch(info->printer);
+
     if (cupsLastError() == IPP_STATUS_ERROR_NOT_FETCHABLE)
     {
       plogf(pjob, "Job already fetched by another printer.");
@@ -1143,10 +1483,13 @@ run_job(proxy_info_t *info,		/* I - Proxy information */
 
   ippDelete(cupsDoRequest(info->http, request, info->resource));
 
+  finish_fetch(info->printer);
+
   if (cupsLastError() >= IPP_STATUS_REDIRECTION_OTHER_SITE)
   {
     plogf(pjob, "Unable to acknowledge job: %s", cupsLastErrorString());
     pjob->local_job_state = IPP_JSTATE_ABORTED;
+    ippDelete(job_attrs);
     return;
   }
 
@@ -1217,6 +1560,13 @@ run_job(proxy_info_t *info,		/* I - Proxy information */
     ippDelete(cupsDoRequest(info->http, request, info->resource));
   }
 
+ /*
+  * Report the final state of the job...
+  */
+
+  if (pjob->local_job_state == IPP_JSTATE_PROCESSING)
+    pjob->local_job_state = pjob->remote_job_state >= IPP_JSTATE_ABORTED ? IPP_JSTATE_CANCELED : IPP_JSTATE_COMPLETED;
+
  /*
   * Update the job state and return...
   */
@@ -1233,16 +1583,12 @@ run_job(proxy_info_t *info,		/* I - Proxy information */
  * 'run_printer()' - Run the printer until no work remains.
  */
 
-static void
+static void *				/* O - Thread exit status */
 run_printer(
-    http_t     *http,			/* I - Connection to printer */
-    const char *printer_uri,		/* I - Printer URI */
-    const char *resource,		/* I - Resource path */
-    int        subscription_id,		/* I - Subscription ID */
-    const char *device_uri,		/* I - Device URI, if any */
-    const char *device_uuid,		/* I - Device UUID */
-    const char *outformat)		/* I - Output format */
+    proxy_printer_t *printer)		/* I - Proxied output device */
 {
+  http_t		*http = printer->http;
+					/* Connection to printer */
   ipp_t			*device_attrs,	/* Device attributes */
 			*request,	/* IPP request */
 			*response;	/* IPP response */
@@ -1253,48 +1599,71 @@ run_printer(
   ipp_jstate_t		job_state;	/* Job state, if any */
   int			seq_number = 1;	/* Current event sequence number */
   int			get_interval;	/* How long to sleep */
-  proxy_info_t		info;		/* Information for proxy thread */
-  _cups_thread_t	jobs_thread;	/* Job proxy processing thread */
+  int			num_events;	/* Number of events received */
+  time_t		poll_time,	/* Time of last Get-Notifications request */
+			next_time;	/* Time of next Get-Notifications request */
+  int			i;		/* Looping var */
+  int			active;		/* Is the output device registered? */
+  proxy_info_t		*infos;		/* Information for proxy threads */
+  _cups_thread_t	*jobs_threads;	/* Job proxy processing threads */
 
 
  /*
   * Query the printer...
   */
 
-  device_attrs = get_device_attrs(device_uri);
+  if (username)
+    cupsSetUser(username);
+
+  if (password)
+    cupsSetPasswordCB2(password_cb, password);
+
+  device_attrs = get_device_attrs(printer->device_uri);
+
+  if ((infos = calloc((size_t)num_workers, sizeof(proxy_info_t))) == NULL || (jobs_threads = calloc((size_t)num_workers, sizeof(_cups_thread_t))) == NULL)
+  {
+    plogf(NULL, "Unable to allocate memory for %d job workers.", num_workers);
+    free(infos);
+    return (NULL);
+  }
 
  /*
-  * Initialize the local jobs array...
+  * Start the job workers, each with its own connection to the Infrastructure
+  * Printer and copy of the device attributes...
   */
 
-  jobs = cupsArrayNew3((cups_array_func_t)compare_jobs, NULL, NULL, 0, NULL, (cups_afree_func_t)free);
+  for (i = 0; i < num_workers; i ++)
+  {
+    infos[i].printer      = printer;
+    infos[i].printer_uri  = printer->printer_uri;
+    infos[i].device_uri   = printer->device_uri;
+    infos[i].device_uuid  = printer->device_uuid;
+    infos[i].device_attrs = ippNew();
+    infos[i].outformat    = printer->outformat;
 
-  memset(&info, 0, sizeof(info));
+    ippCopyAttributes(infos[i].device_attrs, device_attrs, 0, NULL, NULL);
 
-  info.printer_uri  = printer_uri;
-  info.device_uri   = device_uri;
-  info.device_uuid  = device_uuid;
-  info.device_attrs = device_attrs;
-  info.outformat    = outformat;
+    jobs_threads[i] = _cupsThreadCreate((_cups_thread_func_t)proxy_jobs, infos + i);
+  }
 
-  jobs_thread = _cupsThreadCreate((_cups_thread_func_t)proxy_jobs, &info);
+  if (verbosity && num_workers > 1)
+    plogf(NULL, "Started %d job workers.", num_workers);
 
  /*
   * Register the output device...
   */
 
-  if (!update_device_attrs(http, printer_uri, resource, device_uuid, NULL, device_attrs))
-    return;
+  active = update_device_attrs(printer, device_attrs);
 
-  while (!stop_running)
+  while (!stop_running && active)
   {
    /*
     * See if we have any work to do...
     */
 
     request = ippNewRequest(IPP_OP_GET_NOTIFICATIONS);
-    ippAddString(request, IPP_TAG_OPERATION, IPP_TAG_URI, "printer-uri", NULL, printer_uri);
-    ippAddInteger(request, IPP_TAG_OPERATION, IPP_TAG_INTEGER, "notify-subscription-ids", subscription_id);
+    ippAddString(request, IPP_TAG_OPERATION, IPP_TAG_URI, "printer-uri", NULL, printer->printer_uri);
+    ippAddInteger(request, IPP_TAG_OPERATION, IPP_TAG_INTEGER, "notify-subscription-ids", printer->subscription_id);
     ippAddInteger(request, IPP_TAG_OPERATION, IPP_TAG_INTEGER, "notify-sequence-numbers", seq_number);
     ippAddString(request, IPP_TAG_OPERATION, IPP_TAG_NAME, "requesting-user-name", NULL, cupsUser());
     ippAddBoolean(request, IPP_TAG_OPERATION, "notify-wait", 1);
@@ -1302,7 +1671,8 @@ run_printer(
     if (verbosity)
       plogf(NULL, "Sending Get-Notifications request.");
 
-    response = cupsDoRequest(http, request, resource);
+    poll_time = time(NULL);
+    response  = cupsDoRequest(http, request, printer->resource);
 
     if (verbosity)
       plogf(NULL, "Get-Notifications response: %s", ippErrorString(cupsLastError()));
@@ -1312,14 +1682,19 @@ run_printer(
     else
       get_interval = 30;
 
+    if (get_interval <= 0 || get_interval >= 3600)
+      get_interval = 30;
+
     if (verbosity)
       plogf(NULL, "notify-get-interval=%d", get_interval);
 
-    for (attr = ippFirstAttribute(response); attr; attr = ippNextAttribute(response))
+    for (attr = ippFirstAttribute(response), num_events = 0; attr; attr = ippNextAttribute(response))
     {
       if (ippGetGroupTag(attr) != IPP_TAG_EVENT_NOTIFICATION || !ippGetName(attr))
         continue;
 
+      num_events ++;
+
       event     = NULL;
       job_id    = 0;
       job_state = IPP_JSTATE_PENDING;
@@ -1340,7 +1715,7 @@ run_printer(
 	    seq_number = new_seq + 1;
 	}
 	else if (!strcmp(name, "printer-state-reasons") && ippContainsString(attr, "identify-printer-requested"))
-	  acknowledge_identify_printer(http, printer_uri, resource, device_uuid);
+	  acknowledge_identify_printer(http, printer->printer_uri, printer->resource, printer->device_uuid);
 
         attr = ippNextAttribute(response);
       }
@@ -1353,7 +1728,7 @@ run_printer(
 	  * Queue up new job...
 	  */
 
-          proxy_job_t *pjob = find_job(job_id);
+          proxy_job_t *pjob = find_job(printer, job_id);
 
 	  if (!pjob)
 	  {
@@ -1367,17 +1742,18 @@ run_printer(
               * Add job and then let the proxy thread know we added something...
               */
 
+              pjob->printer          = printer;
               pjob->remote_job_id    = job_id;
               pjob->remote_job_state = job_state;
               pjob->local_job_state  = IPP_JSTATE_PENDING;
 
 	      plogf(pjob, "Job is now fetchable, queuing up.", pjob);
 
-              _cupsRWLockWrite(&jobs_rwlock);
-              cupsArrayAdd(jobs, pjob);
-              _cupsRWUnlock(&jobs_rwlock);
+              _cupsRWLockWrite(&printer->jobs_rwlock);
+              cupsArrayAdd(printer->jobs, pjob);
+              _cupsRWUnlock(&printer->jobs_rwlock);
 
-	      _cupsCondBroadcast(&jobs_cond);
+	      _cupsCondBroadcast(&printer->jobs_cond);
 	    }
 	    else
 	    {
@@ -1393,7 +1769,7 @@ run_printer(
 	  * that and stop printing locally.
 	  */
 
-	  proxy_job_t *pjob = find_job(job_id);
+	  proxy_job_t *pjob = find_job(printer, job_id);
 
           if (pjob)
           {
@@ -1401,31 +1777,63 @@ run_printer(
 
 	    plogf(pjob, "Updated remote job-state to '%s'.", ippEnumString("job-state", job_state));
 
-	    _cupsCondBroadcast(&jobs_cond);
+	    _cupsCondBroadcast(&printer->jobs_cond);
 	  }
 	}
       }
     }
 
    /*
-    * Pause before our next poll of the Infrastructure Printer...
+    * Poll again right away if we got events, since the Infrastructure Printer
+    * holds the next notify-wait request until something happens.  Otherwise
+    * wait until notify-get-interval seconds after the last request, which
+    * has already elapsed if the printer waited for events.  The connection
+    * is only reset after an error...
     */
 
-    if (get_interval > 0 && get_interval < 3600)
+    if (cupsLastError() >= IPP_STATUS_REDIRECTION_OTHER_SITE)
+    {
+      ippDelete(response);
+
       sleep((unsigned)get_interval);
-    else
-      sleep(30);
+      httpReconnect(http);
+      continue;
+    }
+
+    ippDelete(response);
 
-    httpReconnect(http);
+    if (num_events > 0)
+      continue;
+
+    next_time = poll_time + get_interval;
+
+    while (!stop_running && time(NULL) < next_time)
+      sleep((unsigned)(next_time - time(NULL)));
   }
 
  /*
-  * Stop the job proxy thread...
+  * Stop the job proxy threads...
   */
 
-  _cupsCondBroadcast(&jobs_cond);
-  _cupsThreadCancel(jobs_thread);
-  _cupsThreadWait(jobs_thread);
+  _cupsMutexLock(&printer->jobs_mutex);
+  for (i = 0; i < num_workers; i ++)
+    infos[i].done = 1;
+  _cupsCondBroadcast(&printer->jobs_cond);
+  _cupsMutexUnlock(&printer->jobs_mutex);
+
+  for (i = 0; i < num_workers; i ++)
+  {
+    _cupsThreadWait(jobs_threads[i]);
+    ippDelete(infos[i].device_attrs);
+    httpClose(infos[i].device_http);
+    httpClose(infos[i].http);
+  }
+
+  free(infos);
+  free(jobs_threads);
+  ippDelete(device_attrs);
+
+  return (NULL);
 }
 
 
@@ -1450,7 +1858,9 @@ send_document(proxy_info_t *info,	/* I - Proxy information */
   const char	*doc_compression;	/* Document compression, if any */
   size_t	doc_total = 0;		/* Total bytes read */
   ssize_t	doc_bytes;		/* Bytes read/written */
-  char		doc_buffer[16384];	/* Copy buffer */
+  char		*doc_data;		/* Document data */
+  proxy_stream_t *stream;		/* Document stream */
+  char		doc_buffer[16384];	/* Attribute buffer */
 
 
   if ((doc_compression = ippGetString(ippFindAttribute(doc_attrs, "compression", IPP_TAG_KEYWORD), 0, NULL)) != NULL && !strcmp(doc_compression, "none"))
@@ -1495,21 +1905,38 @@ send_document(proxy_info_t *info,	/* I - Proxy information */
     if (doc_compression)
       httpSetField(info->http, HTTP_FIELD_CONTENT_ENCODING, doc_compression);
 
-    while ((doc_bytes = cupsReadResponseData(info->http, doc_buffer, sizeof(doc_buffer))) > 0)
+    if ((stream = start_stream(info->http)) == NULL)
     {
-      char	*doc_ptr = doc_buffer,	/* Pointer into buffer */
-		*doc_end = doc_buffer + doc_bytes;
-					/* End of buffer */
+      plogf(pjob, "Unable to start document stream.");
+      pjob->local_job_state = IPP_JSTATE_ABORTED;
+      close(sock);
+      return;
+    }
 
-      doc_total += (size_t)doc_bytes;
+    while ((doc_bytes = read_stream(stream, &doc_data)) > 0)
+    {
+      char	*doc_ptr = doc_data,	/* Pointer into buffer */
+		*doc_end = doc_data + doc_bytes;
+					/* End of buffer */
 
       while (doc_ptr < doc_end)
       {
         if ((doc_bytes = write(sock, doc_ptr, (size_t)(doc_end - doc_ptr))) > 0)
           doc_ptr += doc_bytes;
+        else if (doc_bytes < 0 && errno != EINTR && errno != EAGAIN)
+          break;
+      }
+
+      if (doc_ptr < doc_end)
+      {
+        plogf(pjob, "Unable to write to '%s': %s", info->device_uri, strerror(errno));
+        pjob->local_job_state = IPP_JSTATE_ABORTED;
+        break;
       }
     }
 
+    doc_total = stop_stream(stream);
+
     close(sock);
 
     plogf(pjob, "Local job created, %ld bytes.", (long)doc_total);
@@ -1525,6 +1952,13 @@ send_document(proxy_info_t *info,	/* I - Proxy information */
     int			create_job = 0;	/* Support for Create-Job/Send-Document? */
     const char		*doc_format;	/* Document format */
     ipp_jstate_t	job_state;	/* Current job-state value */
+    int			impressions = pjob->impressions_completed;
+					/* Impressions from previous documents */
+    static const char * const jattrs[] =/* Job attributes we are interested in */
+    {
+      "job-impressions-completed",
+      "job-state"
+    };
     static const char * const pattrs[] =/* Printer attributes we are interested in */
     {
       "compression-supported",
@@ -1566,18 +2000,31 @@ send_document(proxy_info_t *info,	/* I - Proxy information */
     else
       encryption = HTTP_ENCRYPTION_IF_REQUESTED;
 
-    if (verbosity)
-      plogf(pjob, "Connecting to '%s'.", info->device_uri);
-
-    if ((http = httpConnect2(host, port, list, AF_UNSPEC, encryption, 1, 30000, NULL)) == NULL)
+    if ((http = info->device_http) != NULL && !check_connection(http))
     {
-      plogf(pjob, "Unable to connect to '%s': %s\n", info->device_uri, cupsLastErrorString());
-      pjob->local_job_state = IPP_JSTATE_ABORTED;
-      return;
+      httpClose(http);
+      http = info->device_http = NULL;
     }
 
-    if (verbosity)
-      plogf(pjob, "Connected to '%s'.", info->device_uri);
+    if (!http)
+    {
+      if (verbosity)
+	plogf(pjob, "Connecting to '%s'.", info->device_uri);
+
+      if ((http = httpConnect2(host, port, list, AF_UNSPEC, encryption, 1, 30000, NULL)) == NULL)
+      {
+	plogf(pjob, "Unable to connect to '%s': %s\n", info->device_uri, cupsLastErrorString());
+	pjob->local_job_state = IPP_JSTATE_ABORTED;
+	return;
+      }
+
+      if (verbosity)
+	plogf(pjob, "Connected to '%s'.", info->device_uri);
+
+      info->device_http = http;
+    }
+    else if (verbosity)
+      plogf(pjob, "Reusing connection to '%s'.", info->device_uri);
 
    /*
     * See if it supports Create-Job + Send-Document...
@@ -1596,6 +2043,7 @@ send_document(proxy_info_t *info,	/* I - Proxy information */
       pjob->local_job_state = IPP_JSTATE_ABORTED;
       ippDelete(response);
       httpClose(http);
+      info->device_http = NULL;
       return;
     }
 
@@ -1670,6 +2118,7 @@ send_document(proxy_info_t *info,	/* I - Proxy information */
 	plogf(pjob, "Unable to create local job: %s", cupsLastErrorString());
 	pjob->local_job_state = IPP_JSTATE_ABORTED;
 	httpClose(http);
+	info->device_http = NULL;
 	return;
       }
 
@@ -1703,17 +2152,27 @@ send_document(proxy_info_t *info,	/* I - Proxy information */
       }
     }
 
+    if ((stream = start_stream(info->http)) == NULL)
+    {
+      plogf(pjob, "Unable to start document stream.");
+      pjob->local_job_state = IPP_JSTATE_ABORTED;
+      ippDelete(request);
+      httpClose(http);
+      info->device_http = NULL;
+      return;
+    }
+
     if (cupsSendRequest(http, request, resource, 0) == HTTP_STATUS_CONTINUE)
     {
-      while ((doc_bytes = cupsReadResponseData(info->http, doc_buffer, sizeof(doc_buffer))) > 0)
+      while ((doc_bytes = read_stream(stream, &doc_data)) > 0)
       {
-	doc_total += (size_t)doc_bytes;
-
-        if (cupsWriteRequestData(http, doc_buffer, (size_t)doc_bytes) != HTTP_STATUS_CONTINUE)
+        if (cupsWriteRequestData(http, doc_data, (size_t)doc_bytes) != HTTP_STATUS_CONTINUE)
           break;
       }
     }
 
+    doc_total = stop_stream(stream);
+
     response = cupsGetResponse(http, resource);
 
     if (!pjob->local_job_id)
@@ -1728,6 +2187,7 @@ send_document(proxy_info_t *info,	/* I - Proxy information */
       plogf(pjob, "Unable to create local job: %s", cupsLastErrorString());
       pjob->local_job_state = IPP_JSTATE_ABORTED;
       httpClose(http);
+      info->device_http = NULL;
       return;
     }
 
@@ -1739,7 +2199,7 @@ send_document(proxy_info_t *info,	/* I - Proxy information */
       ippAddString(request, IPP_TAG_OPERATION, IPP_TAG_URI, "printer-uri", NULL, info->device_uri);
       ippAddInteger(request, IPP_TAG_OPERATION, IPP_TAG_INTEGER, "job-id", pjob->local_job_id);
       ippAddString(request, IPP_TAG_OPERATION, IPP_TAG_NAME, "requesting-user-name", NULL, cupsUser());
-      ippAddString(request, IPP_TAG_OPERATION, IPP_TAG_KEYWORD, "requested-attributes", NULL, "job-state");
+      ippAddStrings(request, IPP_TAG_OPERATION, IPP_TAG_KEYWORD, "requested-attributes", (int)(sizeof(jattrs) / sizeof(jattrs[0])), NULL, jattrs);
 
       response = cupsDoRequest(http, request, resource);
 
@@ -1748,7 +2208,20 @@ send_document(proxy_info_t *info,	/* I - Proxy information */
       else
         job_state = (ipp_jstate_t)ippGetInteger(ippFindAttribute(response, "job-state", IPP_TAG_ENUM), 0);
 
+      if ((attr = ippFindAttribute(response, "job-impressions-completed", IPP_TAG_INTEGER)) != NULL)
+      {
+       /*
+        * Report progress, coalesced by update_job_status()...
+	*/
+
+        pjob->impressions_completed = impressions + ippGetInteger(attr, 0);
+        update_job_status(info, pjob);
+      }
+
       ippDelete(response);
+
+      if (job_state < IPP_JSTATE_CANCELED)
+        sleep(1);
     }
 
     if (pjob->remote_job_state == IPP_JSTATE_CANCELED)
@@ -1772,7 +2245,6 @@ send_document(proxy_info_t *info,	/* I - Proxy information */
       pjob->local_job_state = IPP_JSTATE_CANCELED;
     }
 
-    httpClose(http);
   }
 
   update_document_status(info, pjob, doc_number, IPP_DSTATE_COMPLETED);
@@ -1792,24 +2264,95 @@ sighandler(int sig)			/* I - Signal */
 }
 
 
+/*
+ * 'start_fetch()' - Wait for this job's turn to be fetched and acknowledged.
+ *
+ * Jobs are fetched and acknowledged in the order they were claimed by the
+ * job workers so that the Infrastructure Printer sees the same order as with
+ * a single worker, while documents are still printed concurrently.
+ */
+
+static void
+start_fetch(proxy_printer_t *printer,	/* I - Proxied output device */
+            proxy_job_t     *pjob)	/* I - Proxy job */
+{
+  _cupsMutexLock(&printer->jobs_mutex);
+  while (printer->fetch_next != pjob->fetch_number)
+    _cupsCondWait(&printer->jobs_cond, &printer->jobs_mutex, 1.0);
+  _cupsMutexUnlock(&printer->jobs_mutex);
+}
+
+/*
+ * 'start_stream()' - Start streaming document data from the Infrastructure Printer.
+ */
+
+static proxy_stream_t *			/* O - Document stream or `NULL` on error */
+start_stream(http_t *http)		/* I - Connection to Infrastructure Printer */
+{
+  proxy_stream_t	*stream;	/* Document stream */
+
+
+  if ((stream = calloc(1, sizeof(proxy_stream_t))) == NULL)
+    return (NULL);
+
+  stream->http = http;
+
+  _cupsMutexInit(&stream->mutex);
+  _cupsCondInit(&stream->cond);
+
+  if ((stream->thread = _cupsThreadCreate((_cups_thread_func_t)fetch_stream, stream)) == 0)
+  {
+    free(stream);
+    return (NULL);
+  }
+
+  return (stream);
+}
+
+
+/*
+ * 'stop_stream()' - Stop streaming document data and free memory.
+ */
+
+static size_t				/* O - Total bytes fetched */
+stop_stream(proxy_stream_t *stream)	/* I - Document stream */
+{
+  size_t	total;			/* Total bytes fetched */
+
+
+  _cupsMutexLock(&stream->mutex);
+  stream->done = 1;
+  _cupsCondBroadcast(&stream->cond);
+  _cupsMutexUnlock(&stream->mutex);
+
+  _cupsThreadWait(stream->thread);
+
+  total = stream->total;
+
+  free(stream);
+
+  return (total);
+}
+
+
+
 /*
  * 'update_device_attrs()' - Update device attributes on the server.
  */
 
 static int				/* O - 1 on success, 0 on failure */
 update_device_attrs(
-    http_t     *http,			/* I - Connection to server */
-    const char *printer_uri,		/* I - Printer URI */
-    const char *resource,		/* I - Resource path */
-    const char *device_uuid,		/* I - Device UUID */
-    ipp_t      *old_attrs,		/* I - Old attributes */
-    ipp_t      *new_attrs)		/* I - New attributes */
+    proxy_printer_t *printer,		/* I - Proxied output device */
+    ipp_t           *new_attrs)		/* I - New attributes */
 {
   int			i,		/* Looping var */
-			result;		/* Result of comparison */
+			num_changed = 0;/* Number of changed attributes */
   ipp_t			*request;	/* IPP request */
   ipp_attribute_t	*attr;		/* New attribute */
-  const char		*name;		/* New attribute name */
+  const char		*name,		/* New attribute name */
+			**match;	/* Matching printer attribute */
+  unsigned char		digests[sizeof(printer_attrs) / sizeof(printer_attrs[0])][32];
+					/* Digests of new values */
 
 
  /*
@@ -1817,42 +2360,64 @@ update_device_attrs(
   */
 
   request = ippNewRequest(IPP_OP_UPDATE_OUTPUT_DEVICE_ATTRIBUTES);
-  ippAddString(request, IPP_TAG_OPERATION, IPP_TAG_URI, "printer-uri", NULL, printer_uri);
-  ippAddString(request, IPP_TAG_OPERATION, IPP_TAG_URI, "output-device-uuid", NULL, device_uuid);
+  ippAddString(request, IPP_TAG_OPERATION, IPP_TAG_URI, "printer-uri", NULL, printer->printer_uri);
+  ippAddString(request, IPP_TAG_OPERATION, IPP_TAG_URI, "output-device-uuid", NULL, printer->device_uuid);
   ippAddString(request, IPP_TAG_OPERATION, IPP_TAG_NAME, "requesting-user-name", NULL, cupsUser());
 
+  memcpy(digests, printer->digests, sizeof(digests));
+
   for (attr = ippFirstAttribute(new_attrs); attr; attr = ippNextAttribute(new_attrs))
   {
    /*
-    * Add any attributes that have changed...
+    * Add any attributes we care about whose digest has changed...
     */
 
     if (ippGetGroupTag(attr) != IPP_TAG_PRINTER || (name = ippGetName(attr)) == NULL)
       continue;
 
-    for (i = 0, result = 1; i < (int)(sizeof(printer_attrs) / sizeof(printer_attrs[0])) && result > 0; i ++)
-    {
-      if ((result = strcmp(name, printer_attrs[i])) == 0)
-      {
-       /*
-        * This is an attribute we care about...
-	*/
+    if ((match = (const char **)bsearch(&name, printer_attrs, sizeof(printer_attrs) / sizeof(printer_attrs[0]), sizeof(printer_attrs[0]), (int (*)(const void *, const void *))compare_strings)) == NULL)
+      continue;
 
-        if (!attrs_are_equal(ippFindAttribute(old_attrs, name, ippGetValueTag(attr)), attr))
-	  ippCopyAttribute(request, attr, 1);
-      }
+    i = (int)(match - printer_attrs);
+
+    digest_attr(attr, digests[i]);
+
+    if (!printer->registered || memcmp(digests[i], printer->digests[i], sizeof(digests[i])))
+    {
+      ippCopyAttribute(request, attr, 1);
+      num_changed ++;
     }
   }
 
-  httpReconnect(http);
-  ippDelete(cupsDoRequest(http, request, resource));
+  if (printer->registered && !num_changed)
+  {
+   /*
+    * Nothing to send...
+    */
+
+    ippDelete(request);
+    return (1);
+  }
+
+  check_connection(printer->http);
+  ippDelete(cupsDoRequest(printer->http, request, printer->resource));
 
   if (cupsLastError() != IPP_STATUS_OK)
   {
-    plogf(NULL, "Unable to update the output device with '%s': %s", printer_uri, cupsLastErrorString());
+    plogf(NULL, "Unable to update the output device with '%s': %s", printer->printer_uri, cupsLastErrorString());
     return (0);
   }
 
+  if (verbosity)
+    plogf(NULL, "Sent %d changed output device attributes.", num_changed);
+
+ /*
+  * Only remember the new digests once the Infrastructure Printer has them...
+  */
+
+  memcpy(printer->digests, digests, sizeof(digests));
+  printer->registered = 1;
+
   return (1);
 }
 
@@ -1868,22 +2433,18 @@ update_document_status(
     int          doc_number,		/* I - Document number */
     ipp_dstate_t doc_state)		/* I - New document-state value */
 {
-  ipp_t	*request;			/* IPP request */
-
-
-  request = ippNewRequest(IPP_OP_UPDATE_DOCUMENT_STATUS);
-  ippAddString(request, IPP_TAG_OPERATION, IPP_TAG_URI, "printer-uri", NULL, info->printer_uri);
-  ippAddInteger(request, IPP_TAG_OPERATION, IPP_TAG_INTEGER, "job-id", pjob->remote_job_id);
-  ippAddInteger(request, IPP_TAG_OPERATION, IPP_TAG_INTEGER, "document-number", doc_number);
-  ippAddString(request, IPP_TAG_OPERATION, IPP_TAG_URI, "output-device-uuid", NULL, info->device_uuid);
-  ippAddString(request, IPP_TAG_OPERATION, IPP_TAG_NAME, "requesting-user-name", NULL, cupsUser());
+ /*
+  * Send any pending update for a different document first...
+  */
 
-  ippAddInteger(request, IPP_TAG_JOB, IPP_TAG_ENUM, "output-device-document-state", doc_state);
+  if (pjob->doc_pending && pjob->doc_number != doc_number)
+    flush_status(info, pjob, 1);
 
-  ippDelete(cupsDoRequest(info->http, request, info->resource));
+  pjob->doc_pending = 1;
+  pjob->doc_number  = doc_number;
+  pjob->doc_state   = doc_state;
 
-  if (cupsLastError() >= IPP_STATUS_REDIRECTION_OTHER_SITE)
-    plogf(pjob, "Unable to update the state for document #%d: %s", doc_number, cupsLastErrorString());
+  flush_status(info, pjob, doc_state >= IPP_DSTATE_CANCELED);
 }
 
 
@@ -1895,21 +2456,12 @@ static void
 update_job_status(proxy_info_t *info,	/* I - Proxy info */
                   proxy_job_t  *pjob)	/* I - Proxy job */
 {
-  ipp_t	*request;			/* IPP request */
-
-
-  request = ippNewRequest(IPP_OP_UPDATE_JOB_STATUS);
-  ippAddString(request, IPP_TAG_OPERATION, IPP_TAG_URI, "printer-uri", NULL, info->printer_uri);
-  ippAddInteger(request, IPP_TAG_OPERATION, IPP_TAG_INTEGER, "job-id", pjob->remote_job_id);
-  ippAddString(request, IPP_TAG_OPERATION, IPP_TAG_URI, "output-device-uuid", NULL, info->device_uuid);
-  ippAddString(request, IPP_TAG_OPERATION, IPP_TAG_NAME, "requesting-user-name", NULL, cupsUser());
-
-  ippAddInteger(request, IPP_TAG_JOB, IPP_TAG_ENUM, "output-device-job-state", pjob->local_job_state);
+  if (pjob->local_job_state == pjob->sent_job_state && pjob->impressions_completed == pjob->sent_impressions && !pjob->job_pending)
+    return;
 
-  ippDelete(cupsDoRequest(info->http, request, info->resource));
+  pjob->job_pending = 1;
 
-  if (cupsLastError() >= IPP_STATUS_REDIRECTION_OTHER_SITE)
-    plogf(pjob, "Unable to update the job state: %s", cupsLastErrorString());
+  flush_status(info, pjob, pjob->local_job_state >= IPP_JSTATE_CANCELED);
 }
 
 
@@ -1920,9 +2472,11 @@ update_job_status(proxy_info_t *info,	/* I - Proxy info */
 static void
 usage(int status)			/* O - Exit status */
 {
-  puts("Usage: ippproxy [options] printer-uri");
+  puts("Usage: ippproxy [options] printer-uri [... printer-uri]");
   puts("Options:");
-  puts("  -d device-uri   Specify local printer device URI.");
+  puts("  -d device-uri   Specify local printer device URI (once per printer-uri).");
+  puts("  -i seconds      Minimum time between job status updates (default 1).");
+  puts("  -j workers      Number of jobs to process at the same time (default 1).");
   puts("  -m mime/type    Specify the desired print format.");
   puts("  -p password     Password for authentication.");
   puts("                  (Also IPPPROXY_PASSWORD environment variable)");
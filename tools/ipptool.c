@@ -97,6 +97,22 @@ typedef struct _cups_status_s		/**** Status info ****/
 		repeat_no_match;	/* Repeat the test when it matches */
 } _cups_status_t;
 
+typedef struct _cups_exchange_s		/**** Request/response exchange ****/
+{
+  ipp_t		*request,		/* IPP request */
+		*response;		/* IPP response */
+  http_status_t	status;			/* HTTP status */
+  int		pass;			/* Was the request delivered? */
+  http_version_t version;		/* HTTP version of response */
+  ipp_status_t	ipp_status;		/* IPP status (cupsLastError) */
+  char		message[1024];		/* Status message (cupsLastErrorString) */
+  double	send_time,		/* Time to send request */
+		first_time,		/* Time to first byte of response */
+		total_time;		/* Time to receive response */
+  size_t	bytes_sent,		/* IPP message and document bytes sent */
+		bytes_received;		/* IPP message bytes received */
+} _cups_exchange_t;
+
 typedef struct _cups_testdata_s		/**** Test Data ****/
 {
   /* Global Options */
@@ -106,7 +122,9 @@ typedef struct _cups_testdata_s		/**** Test Data ****/
   int		stop_after_include_error;
 					/* Stop after include errors? */
   double	timeout;		/* Timeout for connection */
-  int		validate_headers,	/* Validate HTTP headers in response? */
+  int		parallel,		/* Parallel connections for pipelined tests */
+		timing,			/* Show timing statistics? */
+		validate_headers,	/* Validate HTTP headers in response? */
                 verbosity;		/* Show all attributes? */
 
   /* Test Defaults */
@@ -116,6 +134,9 @@ typedef struct _cups_testdata_s		/**** Test Data ****/
 
   /* Global State */
   http_t	*http;			/* HTTP connection to printer/server */
+  struct _cups_pipeline_s *pipeline;	/* Pipelined tests, if any */
+  cups_array_t	*regexes;		/* Compiled regular expressions */
+  cups_array_t	*stats;			/* Load statistics, if any */
   cups_file_t	*outfile;		/* Output file */
   int		show_header,		/* Show the test header? */
 		xml_header;		/* 1 if XML plist header was written */
@@ -129,6 +150,7 @@ typedef struct _cups_testdata_s		/**** Test Data ****/
   cups_array_t	*errors;		/* Errors array */
   int		prev_pass,		/* Result of previous test */
 		skip_previous;		/* Skip on previous test failure? */
+  _cups_exchange_t *exchange;		/* Pipelined exchange, if any */
   char		compression[16];	/* COMPRESSION value */
   useconds_t	delay;                  /* Initial delay */
   int		num_displayed;		/* Number of displayed attributes */
@@ -154,6 +176,89 @@ typedef struct _cups_testdata_s		/**** Test Data ****/
   int		version;		/* IPP version number to use */
 } _cups_testdata_t;
 
+typedef struct _cups_load_s		/**** Load generator settings ****/
+{
+  int		clients;		/* Number of concurrent clients */
+  double	rate,			/* Target test file runs per second per client */
+		duration;		/* Seconds to run, 0 for no limit */
+  int		open_loop,		/* Start runs on a fixed schedule? */
+		repeat;			/* Runs per client, 0 for no limit */
+  const char	*testfile;		/* Test file to run */
+  double	start;			/* Start time */
+} _cups_load_t;
+
+typedef struct _cups_client_s		/**** Load generator client ****/
+{
+  _cups_load_t	*load;			/* Load generator settings */
+  int		number;			/* Client number */
+  _cups_thread_t thread;		/* Client thread */
+  _ipp_vars_t	vars;			/* Client variables */
+  _cups_testdata_t data;		/* Client test data */
+  int		runs,			/* Number of test file runs */
+		failed;			/* Number of failed test file runs */
+} _cups_client_t;
+
+typedef enum _cups_pipestate_e		/**** Pipelined test state ****/
+{
+  _CUPS_PIPESTATE_QUEUED,		/* Waiting for a connection */
+  _CUPS_PIPESTATE_SENDING,		/* Request being sent */
+  _CUPS_PIPESTATE_DONE			/* Response received */
+} _cups_pipestate_t;
+
+typedef struct _cups_pipetest_s		/**** Pipelined test ****/
+{
+  _cups_testdata_t data;		/* Test data */
+  _cups_exchange_t exchange;		/* Request/response exchange */
+  _cups_pipestate_t state;		/* Current state */
+} _cups_pipetest_t;
+
+typedef struct _cups_pipeline_s _cups_pipeline_t;
+
+typedef struct _cups_worker_s		/**** Pipeline connection ****/
+{
+  _cups_pipeline_t *pipeline;		/* Pipeline */
+  http_t	*http;			/* HTTP connection */
+  _cups_thread_t thread;		/* Connection thread */
+} _cups_worker_t;
+
+struct _cups_pipeline_s			/**** Pipelined test queue ****/
+{
+  _ipp_vars_t	*vars;			/* Variables */
+  int		num_workers;		/* Number of connections */
+  _cups_worker_t *workers;		/* Connections */
+  _cups_mutex_t	mutex;			/* Mutex for queue */
+  _cups_cond_t	cond;			/* Condition for queue changes */
+  cups_array_t	*tests;			/* Queued tests, in file order */
+  int		shutdown,		/* Stop the connection threads? */
+		stopped;		/* Stop checking tests? */
+};
+
+typedef struct _cups_regex_s		/**** Compiled regular expression ****/
+{
+  char		*pattern;		/* Regular expression string */
+  regex_t	re;			/* Compiled regular expression */
+} _cups_regex_t;
+
+typedef struct _cups_scount_s		/**** Status code count ****/
+{
+  ipp_status_t	status;			/* IPP status code */
+  int		count;			/* Number of responses */
+} _cups_scount_t;
+
+typedef struct _cups_stats_s		/**** Statistics for an operation or test ****/
+{
+  ipp_op_t	op;			/* Operation code, 0 for test file runs */
+  char		*name;			/* Test name, NULL for operations */
+  int		errors;			/* Number of failures */
+  size_t	num_samples,		/* Number of latency samples */
+		alloc_samples;		/* Allocated latency samples */
+  double	*samples;		/* Latency samples in seconds */
+  size_t	bytes_sent,		/* Bytes sent */
+		bytes_received;		/* Bytes received */
+  int		num_statuses;		/* Number of status codes */
+  _cups_scount_t statuses[16];		/* Responses for each status code */
+} _cups_stats_t;
+
 
 /*
  * Globals...
@@ -166,30 +271,54 @@ static int	Cancel = 0;		/* Cancel test? */
  * Local functions...
  */
 
+static void	add_stat(cups_array_t *stats, ipp_op_t op, const char *name, double latency, int error, ipp_status_t status, size_t bytes_sent, size_t bytes_received);
+static void	add_stat_error(cups_array_t *stats, ipp_op_t op, const char *name);
+static void	add_status(_cups_stats_t *stat, ipp_status_t status, int count);
 static void	add_stringf(cups_array_t *a, const char *s, ...) _CUPS_FORMAT(2, 3);
+static int	can_pipeline(_cups_testdata_t *data, ipp_t *request);
+static int	compare_doubles(const double *a, const double *b);
+static int	compare_regexes(_cups_regex_t *a, _cups_regex_t *b);
+static int	compare_stats(_cups_stats_t *a, _cups_stats_t *b);
 static int      compare_uris(const char *a, const char *b);
+static http_t	*connect_printer(_ipp_vars_t *vars, _cups_testdata_t *data);
 static void	copy_hex_string(char *buffer, unsigned char *data, int datalen, size_t bufsize);
+static int	do_load(const char *testfile, _ipp_vars_t *vars, _cups_testdata_t *data, _cups_load_t *load);
 static int	do_test(_ipp_file_t *f, _ipp_vars_t *vars, _cups_testdata_t *data);
 static int	do_tests(const char *testfile, _ipp_vars_t *vars, _cups_testdata_t *data);
 static int	error_cb(_ipp_file_t *f, _cups_testdata_t *data, const char *error);
 static int      expect_matches(_cups_expect_t *expect, ipp_tag_t value_tag);
+static int	flush_pipeline(_ipp_vars_t *vars, _cups_testdata_t *data, int max_tests);
+static void	free_regex(_cups_regex_t *regex);
+static void	free_stats(_cups_stats_t *stat);
+static void	free_test(_cups_testdata_t *data);
 static char	*get_filename(const char *testfile, char *dst, const char *src, size_t dstsize);
+static double	get_percentile(_cups_stats_t *stat, double pct);
+static regex_t	*get_regex(_cups_testdata_t *data, const char *pattern);
 static const char *get_string(ipp_attribute_t *attr, int element, int flags, char *buffer, size_t bufsize);
+static double	get_time(void);
 static void	init_data(_cups_testdata_t *data);
 static char	*iso_date(const ipp_uchar_t *date);
+static void	*load_client(_cups_client_t *client);
 static void	pause_message(const char *message);
+static void	*pipeline_worker(_cups_worker_t *worker);
 static void	print_attr(cups_file_t *outfile, _cups_output_t output, ipp_attribute_t *attr, ipp_tag_t *group);
 static void	print_csv(_cups_testdata_t *data, ipp_t *ipp, ipp_attribute_t *attr, int num_displayed, char **displayed, size_t *widths);
 static void	print_fatal_error(_cups_testdata_t *data, const char *s, ...) _CUPS_FORMAT(2, 3);
 static void	print_ippserver_attr(_cups_testdata_t *data, ipp_attribute_t *attr, int indent);
 static void	print_ippserver_string(_cups_testdata_t *data, const char *s, size_t len);
 static void	print_line(_cups_testdata_t *data, ipp_t *ipp, ipp_attribute_t *attr, int num_displayed, char **displayed, size_t *widths);
+static void	print_load_report(cups_array_t *stats, _cups_load_t *load, int runs, int failed, double elapsed);
+static void	print_timing(cups_file_t *outfile, _cups_output_t output, cups_array_t *stats);
 static void	print_xml_header(_cups_testdata_t *data);
 static void	print_xml_string(cups_file_t *outfile, const char *element, const char *s);
 static void	print_xml_trailer(_cups_testdata_t *data, int success, const char *message);
+static int	queue_test(_ipp_file_t *f, _ipp_vars_t *vars, _cups_testdata_t *data);
+static void	send_request(_cups_testdata_t *data, http_t *http, _cups_exchange_t *exchange);
 #ifndef _WIN32
 static void	sigterm_handler(int sig);
 #endif /* _WIN32 */
+static int	start_pipeline(_ipp_vars_t *vars, _cups_testdata_t *data);
+static void	stop_pipeline(_cups_testdata_t *data);
 static int	timeout_cb(http_t *http, void *user_data);
 static int	token_cb(_ipp_file_t *f, _ipp_vars_t *vars, _cups_testdata_t *data, const char *token);
 static void	usage(void) _CUPS_NORETURN;
@@ -218,6 +347,7 @@ main(int  argc,				/* I - Number of command-line args */
   int			interval,	/* Test interval in microseconds */
 			repeat;		/* Repeat count */
   _cups_testdata_t	data;		/* Test data */
+  _cups_load_t		load;		/* Load generator settings */
   _ipp_vars_t		vars;		/* Variables */
   _cups_globals_t	*cg = _cupsGlobals();
 					/* Global data */
@@ -240,6 +370,10 @@ main(int  argc,				/* I - Number of command-line args */
 
   init_data(&data);
 
+  data.stats = cupsArrayNew3((cups_array_func_t)compare_stats, NULL, NULL, 0, NULL, (cups_afree_func_t)free_stats);
+
+  memset(&load, 0, sizeof(load));
+
   _ippVarsInit(&vars, NULL, (_ipp_ferror_cb_t)error_cb, (_ipp_ftoken_cb_t)token_cb);
 
   _ippVarsSet(&vars, "date-start", iso_date(ippTimeToDate(time(NULL))));
@@ -257,7 +391,29 @@ main(int  argc,				/* I - Number of command-line args */
 
   for (i = 1; i < argc; i ++)
   {
-    if (!strcmp(argv[i], "--help"))
+    if (!strcmp(argv[i], "--cache"))
+    {
+      i ++;
+
+      if (i >= argc)
+      {
+	_cupsLangPuts(stderr, _("ipptool: Missing directory for \"--cache\"."));
+	usage();
+      }
+
+      vars.cachedir = argv[i];
+    }
+    else if (!strcmp(argv[i], "--duration"))
+    {
+      i ++;
+
+      if (i >= argc || (load.duration = _cupsStrScand(argv[i], NULL, localeconv())) <= 0.0)
+      {
+	_cupsLangPuts(stderr, _("ipptool: Missing or bad seconds for \"--duration\"."));
+	usage();
+      }
+    }
+    else if (!strcmp(argv[i], "--help"))
     {
       usage();
     }
@@ -282,10 +438,48 @@ main(int  argc,				/* I - Number of command-line args */
 
       data.output = _CUPS_OUTPUT_IPPSERVER;
     }
+    else if (!strcmp(argv[i], "--load"))
+    {
+      i ++;
+
+      if (i >= argc || (load.clients = atoi(argv[i])) < 1 || load.clients > 1000)
+      {
+	_cupsLangPuts(stderr, _("ipptool: Missing or bad number of clients for \"--load\"."));
+	usage();
+      }
+    }
+    else if (!strcmp(argv[i], "--open-loop"))
+    {
+      load.open_loop = 1;
+    }
+    else if (!strcmp(argv[i], "--parallel"))
+    {
+      i ++;
+
+      if (i >= argc || (data.parallel = atoi(argv[i])) < 1 || data.parallel > 100)
+      {
+	_cupsLangPuts(stderr, _("ipptool: Missing or bad number of connections for \"--parallel\"."));
+	usage();
+      }
+    }
+    else if (!strcmp(argv[i], "--rate"))
+    {
+      i ++;
+
+      if (i >= argc || (load.rate = _cupsStrScand(argv[i], NULL, localeconv())) <= 0.0)
+      {
+	_cupsLangPuts(stderr, _("ipptool: Missing or bad runs per second for \"--rate\"."));
+	usage();
+      }
+    }
     else if (!strcmp(argv[i], "--stop-after-include-error"))
     {
       data.stop_after_include_error = 1;
     }
+    else if (!strcmp(argv[i], "--timing"))
+    {
+      data.timing = 1;
+    }
     else if (!strcmp(argv[i], "--version"))
     {
       puts(CUPS_SVERSION);
@@ -347,12 +541,6 @@ main(int  argc,				/* I - Number of command-line args */
               }
 
 	      data.output = _CUPS_OUTPUT_PLIST;
-
-              if (interval || repeat)
-	      {
-	        _cupsLangPuts(stderr, _("ipptool: \"-i\" and \"-n\" are incompatible with \"-P\" and \"-X\"."));
-		usage();
-	      }
               break;
 
 	  case 'S' : /* Encrypt with SSL */
@@ -418,12 +606,6 @@ main(int  argc,				/* I - Number of command-line args */
 
           case 'X' : /* Produce XML output */
 	      data.output = _CUPS_OUTPUT_PLIST;
-
-              if (interval || repeat)
-	      {
-	        _cupsLangPuts(stderr, _("ipptool: \"-i\" and \"-n\" are incompatible with \"-P\" and \"-X\"."));
-		usage();
-	      }
 	      break;
 
           case 'c' : /* CSV output */
@@ -561,11 +743,13 @@ main(int  argc,				/* I - Number of command-line args */
 		  _cupsLangPuts(stderr, _("ipptool: Invalid seconds for \"-i\"."));
 		  usage();
 		}
+
+		data.timing = 1;
               }
 
-              if ((data.output == _CUPS_OUTPUT_PLIST || data.output == _CUPS_OUTPUT_IPPSERVER) && interval)
+              if (data.output == _CUPS_OUTPUT_IPPSERVER && interval)
 	      {
-	        _cupsLangPuts(stderr, _("ipptool: \"-i\" and \"-n\" are incompatible with \"--ippserver\", \"-P\", and \"-X\"."));
+	        _cupsLangPuts(stderr, _("ipptool: \"-i\" and \"-n\" are incompatible with \"--ippserver\"."));
 		usage();
 	      }
 	      break;
@@ -583,11 +767,14 @@ main(int  argc,				/* I - Number of command-line args */
 		usage();
               }
 	      else
-		repeat = atoi(argv[i]);
+	      {
+		repeat      = atoi(argv[i]);
+		data.timing = 1;
+	      }
 
-              if ((data.output == _CUPS_OUTPUT_PLIST || data.output == _CUPS_OUTPUT_IPPSERVER) && repeat)
+              if (data.output == _CUPS_OUTPUT_IPPSERVER && repeat)
 	      {
-	        _cupsLangPuts(stderr, _("ipptool: \"-i\" and \"-n\" are incompatible with \"--ippserver\", \"-P\", and \"-X\"."));
+	        _cupsLangPuts(stderr, _("ipptool: \"-i\" and \"-n\" are incompatible with \"--ippserver\"."));
 		usage();
 	      }
 	      break;
@@ -668,7 +855,13 @@ main(int  argc,				/* I - Number of command-line args */
       else
         testfile = argv[i];
 
-      if (!do_tests(testfile, &vars, &data))
+      if (data.output == _CUPS_OUTPUT_PLIST && interval && !repeat)
+      {
+        _cupsLangPuts(stderr, _("ipptool: \"-i\" requires \"-n\" with \"-P\" and \"-X\"."));
+        usage();
+      }
+
+      if (!load.clients && !do_tests(testfile, &vars, &data))
         status = 1;
     }
   }
@@ -676,40 +869,79 @@ main(int  argc,				/* I - Number of command-line args */
   if (!vars.uri || !testfile)
     usage();
 
+  if (load.clients > 0)
+  {
+   /*
+    * Run the last test file from multiple clients...
+    */
+
+    if (interval || data.output == _CUPS_OUTPUT_PLIST || data.output == _CUPS_OUTPUT_IPPSERVER)
+    {
+      _cupsLangPuts(stderr, _("ipptool: \"--load\" is incompatible with \"-i\", \"--ippserver\", \"-P\", and \"-X\"."));
+      usage();
+    }
+
+    if (data.parallel > 0)
+    {
+      _cupsLangPuts(stderr, _("ipptool: \"--load\" is incompatible with \"--parallel\"."));
+      usage();
+    }
+
+    if (load.open_loop && load.rate <= 0.0)
+    {
+      _cupsLangPuts(stderr, _("ipptool: \"--open-loop\" requires \"--rate\"."));
+      usage();
+    }
+
+    load.repeat = repeat;
+
+    if (!do_load(testfile, &vars, &data, &load))
+      status = 1;
+  }
+
  /*
-  * Loop if the interval is set...
+  * Repeat the last test file as needed...
   */
 
-  if (data.output == _CUPS_OUTPUT_PLIST)
-    print_xml_trailer(&data, !status, NULL);
-  else if (interval > 0 && repeat > 0)
+  if (repeat > 0 && !load.clients)
   {
-    while (repeat > 1)
+    while (repeat > 1 && !Cancel)
     {
-      usleep((useconds_t)interval);
-      do_tests(testfile, &vars, &data);
+      if (interval > 0)
+        usleep((useconds_t)interval);
+
+      if (!do_tests(testfile, &vars, &data))
+        status = 1;
+
       repeat --;
     }
   }
   else if (interval > 0)
   {
-    for (;;)
+    while (!Cancel)
     {
       usleep((useconds_t)interval);
       do_tests(testfile, &vars, &data);
     }
   }
 
-  if ((data.output == _CUPS_OUTPUT_TEST || (data.output == _CUPS_OUTPUT_PLIST && data.outfile)) && data.test_count > 1)
+  if (data.output == _CUPS_OUTPUT_PLIST)
+    print_xml_trailer(&data, !status, NULL);
+
+  if ((data.output == _CUPS_OUTPUT_TEST || (data.output == _CUPS_OUTPUT_PLIST && data.outfile != cupsFileStdout())) && data.test_count > 1)
   {
    /*
     * Show a summary report if there were multiple tests...
     */
 
     cupsFilePrintf(cupsFileStdout(), "\nSummary: %d tests, %d passed, %d failed, %d skipped\nScore: %d%%\n", data.test_count, data.pass_count, data.fail_count, data.skip_count, 100 * (data.pass_count + data.skip_count) / data.test_count);
+
+    if (data.timing)
+      print_timing(cupsFileStdout(), _CUPS_OUTPUT_TEST, data.stats);
   }
 
   cupsFileClose(data.outfile);
+  cupsArrayDelete(data.regexes);
 
 /*
   * Exit...
@@ -719,6 +951,130 @@ main(int  argc,				/* I - Number of command-line args */
 }
 
 
+/*
+ * 'add_stat()' - Add a latency sample for an operation or test.
+ */
+
+static void
+add_stat(cups_array_t *stats,		/* I - Statistics array */
+         ipp_op_t     op,		/* I - Operation code, 0 for test file runs */
+         const char   *name,		/* I - Test name or `NULL` for the operation */
+         double       latency,		/* I - Latency in seconds */
+         int          error,		/* I - 1 if the request failed, 0 otherwise */
+         ipp_status_t status,		/* I - IPP status code or `IPP_STATUS_CUPS_INVALID` for none */
+         size_t       bytes_sent,	/* I - Bytes sent */
+         size_t       bytes_received)	/* I - Bytes received */
+{
+  _cups_stats_t	key,			/* Search key */
+		*stat;			/* Operation statistics */
+
+
+  key.op   = op;
+  key.name = (char *)name;
+
+  if ((stat = (_cups_stats_t *)cupsArrayFind(stats, &key)) == NULL)
+  {
+    if ((stat = (_cups_stats_t *)calloc(1, sizeof(_cups_stats_t))) == NULL)
+      return;
+
+    stat->op = op;
+
+    if (name && (stat->name = strdup(name)) == NULL)
+    {
+      free(stat);
+      return;
+    }
+
+    cupsArrayAdd(stats, stat);
+  }
+
+  stat->bytes_sent     += bytes_sent;
+  stat->bytes_received += bytes_received;
+
+  if (status != IPP_STATUS_CUPS_INVALID)
+    add_status(stat, status, 1);
+
+  if (stat->num_samples >= stat->alloc_samples)
+  {
+    size_t	alloc_samples = stat->alloc_samples ? 2 * stat->alloc_samples : 1024;
+					/* New allocation */
+    double	*samples;		/* New samples array */
+
+    if ((samples = (double *)realloc(stat->samples, alloc_samples * sizeof(double))) == NULL)
+      return;
+
+    stat->samples       = samples;
+    stat->alloc_samples = alloc_samples;
+  }
+
+  stat->samples[stat->num_samples ++] = latency;
+
+  if (error)
+    stat->errors ++;
+}
+
+
+/*
+ * 'add_stat_error()' - Count a failed test for an operation and test.
+ */
+
+static void
+add_stat_error(cups_array_t *stats,	/* I - Statistics array */
+               ipp_op_t     op,		/* I - Operation code */
+               const char   *name)	/* I - Test name */
+{
+  _cups_stats_t	key,			/* Search key */
+		*stat;			/* Operation statistics */
+
+
+  key.op   = op;
+  key.name = NULL;
+
+  if ((stat = (_cups_stats_t *)cupsArrayFind(stats, &key)) != NULL)
+    stat->errors ++;
+
+  key.name = (char *)name;
+
+  if ((stat = (_cups_stats_t *)cupsArrayFind(stats, &key)) != NULL)
+    stat->errors ++;
+}
+
+
+/*
+ * 'add_status()' - Count responses with a status code.
+ *
+ * Status codes beyond the first 16 seen for an operation or test are not
+ * counted.
+ */
+
+static void
+add_status(_cups_stats_t *stat,		/* I - Statistics */
+           ipp_status_t  status,	/* I - IPP status code */
+           int           count)		/* I - Number of responses */
+{
+  int			i;		/* Looping var */
+  _cups_scount_t	*scount;	/* Current status code count */
+
+
+  for (i = stat->num_statuses, scount = stat->statuses; i > 0; i --, scount ++)
+  {
+    if (scount->status == status)
+    {
+      scount->count += count;
+      return;
+    }
+  }
+
+  if (stat->num_statuses < (int)(sizeof(stat->statuses) / sizeof(stat->statuses[0])))
+  {
+    scount->status = status;
+    scount->count  = count;
+
+    stat->num_statuses ++;
+  }
+}
+
+
 /*
  * 'add_stringf()' - Add a formatted string to an array.
  */
@@ -755,6 +1111,106 @@ add_stringf(cups_array_t *a,		/* I - Array */
 }
 
 
+/*
+ * 'can_pipeline()' - Determine whether a test can be sent ahead of the tests
+ *                    before it.
+ *
+ * Only read-only printer and system queries whose results don't change any
+ * variables or the flow of the test file are pipelined, so sending them early
+ * on another connection cannot change what any other test sees.
+ */
+
+static int				/* O - 1 if the test can be pipelined, 0 otherwise */
+can_pipeline(_cups_testdata_t *data,	/* I - Test data */
+             ipp_t            *request)	/* I - IPP request */
+{
+  int		i;			/* Looping var */
+  _cups_expect_t *expect;		/* Current expected attribute */
+  _cups_status_t *status;		/* Current status */
+
+
+  switch (ippGetOperation(request))
+  {
+    case IPP_OP_GET_PRINTER_ATTRIBUTES :
+    case IPP_OP_GET_PRINTER_SUPPORTED_VALUES :
+    case IPP_OP_GET_PRINTERS :
+    case IPP_OP_GET_SYSTEM_ATTRIBUTES :
+    case IPP_OP_GET_SYSTEM_SUPPORTED_VALUES :
+    case IPP_OP_VALIDATE_DOCUMENT :
+    case IPP_OP_VALIDATE_JOB :
+        break;
+
+    default :
+        return (0);
+  }
+
+  if (data->skip_test || data->skip_previous || data->pause[0] || data->delay > 0 || data->validate_headers)
+    return (0);
+
+  for (i = data->num_statuses, status = data->statuses; i > 0; i --, status ++)
+  {
+    if (status->define_match || status->define_no_match || status->define_value || status->repeat_match || status->repeat_no_match)
+      return (0);
+  }
+
+  for (i = data->num_expects, expect = data->expects; i > 0; i --, expect ++)
+  {
+    if (expect->define_match || expect->define_no_match || expect->define_value || expect->repeat_match || expect->repeat_no_match)
+      return (0);
+  }
+
+  return (1);
+}
+
+
+/*
+ * 'compare_doubles()' - Compare two latency samples.
+ */
+
+static int				/* O - Result of comparison */
+compare_doubles(const double *a,	/* I - First sample */
+                const double *b)	/* I - Second sample */
+{
+  if (*a < *b)
+    return (-1);
+  else if (*a > *b)
+    return (1);
+  else
+    return (0);
+}
+
+
+/*
+ * 'compare_regexes()' - Compare the patterns of two regular expressions.
+ */
+
+static int				/* O - Result of comparison */
+compare_regexes(_cups_regex_t *a,	/* I - First regular expression */
+                _cups_regex_t *b)	/* I - Second regular expression */
+{
+  return (strcmp(a->pattern, b->pattern));
+}
+
+
+/*
+ * 'compare_stats()' - Compare the operation codes and test names of two
+ *                     statistics.
+ */
+
+static int				/* O - Result of comparison */
+compare_stats(_cups_stats_t *a,		/* I - First statistics */
+              _cups_stats_t *b)		/* I - Second statistics */
+{
+  int	result;				/* Result of comparison */
+
+
+  if ((result = (int)a->op - (int)b->op) == 0)
+    result = strcmp(a->name ? a->name : "", b->name ? b->name : "");
+
+  return (result);
+}
+
+
 /*
  * 'compare_uris()' - Compare two URIs...
  */
@@ -820,6 +1276,42 @@ compare_uris(const char *a,             /* I - First URI */
 }
 
 
+/*
+ * 'connect_printer()' - Connect to the printer/server.
+ */
+
+static http_t *				/* O - HTTP connection or `NULL` on error */
+connect_printer(_ipp_vars_t      *vars,	/* I - Variables */
+                _cups_testdata_t *data)	/* I - Test data */
+{
+  http_t		*http;		/* HTTP connection */
+  http_encryption_t	encryption;	/* Encryption mode */
+
+
+  if (!_cups_strcasecmp(vars->scheme, "https") || !_cups_strcasecmp(vars->scheme, "ipps"))
+    encryption = HTTP_ENCRYPTION_ALWAYS;
+  else
+    encryption = data->encryption;
+
+  if ((http = httpConnect2(vars->host, vars->port, NULL, data->family, encryption, 1, 30000, NULL)) == NULL)
+  {
+    print_fatal_error(data, "Unable to connect to \"%s\" on port %d - %s", vars->host, vars->port, cupsLastErrorString());
+    return (NULL);
+  }
+
+#ifdef HAVE_LIBZ
+  httpSetDefaultField(http, HTTP_FIELD_ACCEPT_ENCODING, "deflate, gzip, identity");
+#else
+  httpSetDefaultField(http, HTTP_FIELD_ACCEPT_ENCODING, "identity");
+#endif /* HAVE_LIBZ */
+
+  if (data->timeout > 0.0)
+    httpSetTimeout(http, data->timeout, timeout_cb, NULL);
+
+  return (http);
+}
+
+
 /*
  * 'copy_hex_string()' - Copy an octetString to a C string and encode as hex if
  *                       needed.
@@ -841,45 +1333,188 @@ copy_hex_string(char          *buffer,	/* I - String buffer */
 					/* Hex digits */
 
 
- /*
-  * First see if there are any non-ASCII bytes in the octetString...
-  */
+ /*
+  * First see if there are any non-ASCII bytes in the octetString...
+  */
+
+  for (dataptr = data; dataptr < dataend; dataptr ++)
+    if (*dataptr < 0x20 || *dataptr >= 0x7f)
+      break;
+
+  if (dataptr < dataend)
+  {
+   /*
+    * Yes, encode as hex...
+    */
+
+    *buffer = '<';
+
+    for (bufptr = buffer + 1, dataptr = data; bufptr < bufend && dataptr < dataend; dataptr ++)
+    {
+      *bufptr++ = hexdigits[*dataptr >> 4];
+      *bufptr++ = hexdigits[*dataptr & 15];
+    }
+
+    if (bufptr < bufend)
+      *bufptr++ = '>';
+
+    *bufptr = '\0';
+  }
+  else
+  {
+   /*
+    * No, copy as a string...
+    */
+
+    if ((size_t)datalen > bufsize)
+      datalen = (int)bufsize - 1;
+
+    memcpy(buffer, data, (size_t)datalen);
+    buffer[datalen] = '\0';
+  }
+}
+
+
+/*
+ * 'do_load()' - Run a test file in a loop from concurrent clients and report
+ *               the request rate and latencies.
+ */
+
+static int				/* O - 1 on success, 0 on failure */
+do_load(const char       *testfile,	/* I - Test file to use */
+        _ipp_vars_t      *vars,		/* I - Variables */
+        _cups_testdata_t *data,		/* I - Test data */
+        _cups_load_t     *load)		/* I - Load generator settings */
+{
+  int		i, j,			/* Looping vars */
+		runs = 0,		/* Total test file runs */
+		failed = 0;		/* Total failed test file runs */
+  size_t	count;			/* Number of samples to merge */
+  double	elapsed,		/* Elapsed time */
+		*samples;		/* Merged samples */
+  _cups_client_t *clients,		/* Load generator clients */
+		*client;		/* Current client */
+  cups_array_t	*stats;			/* Merged statistics */
+  _cups_stats_t	*cstat,			/* Client statistics */
+		*stat;			/* Merged statistics */
+
+
+  if ((clients = (_cups_client_t *)calloc((size_t)load->clients, sizeof(_cups_client_t))) == NULL)
+  {
+    print_fatal_error(data, "Unable to allocate memory for %d clients.", load->clients);
+    return (0);
+  }
+
+  load->testfile = testfile;
+  load->start    = get_time();
+
+ /*
+  * Start each client with its own copy of the variables and test data so
+  * that they can run without sharing any state...
+  */
+
+  for (i = 0, client = clients; i < load->clients; i ++, client ++)
+  {
+    client->load   = load;
+    client->number = i;
+
+    _ippVarsInit(&client->vars, NULL, (_ipp_ferror_cb_t)error_cb, (_ipp_ftoken_cb_t)token_cb);
+    _ippVarsSet(&client->vars, "uri", vars->uri);
+    strlcpy(client->vars.username, vars->username, sizeof(client->vars.username));
+    client->vars.password = vars->password;
+
+    for (j = 0; j < vars->num_vars; j ++)
+      _ippVarsSet(&client->vars, vars->vars[j].name, vars->vars[j].value);
+
+    init_data(&client->data);
+
+    client->data.encryption               = data->encryption;
+    client->data.family                   = data->family;
+    client->data.output                   = _CUPS_OUTPUT_QUIET;
+    client->data.stop_after_include_error = data->stop_after_include_error;
+    client->data.timeout                  = data->timeout;
+    client->data.validate_headers         = data->validate_headers;
+    client->data.def_ignore_errors        = data->def_ignore_errors;
+    client->data.def_transfer             = data->def_transfer;
+    client->data.def_version              = data->def_version;
+    client->data.stats                    = cupsArrayNew3((cups_array_func_t)compare_stats, NULL, NULL, 0, NULL, (cups_afree_func_t)free_stats);
+
+    if ((client->thread = _cupsThreadCreate((_cups_thread_func_t)load_client, client)) == 0)
+    {
+      print_fatal_error(data, "Unable to start client %d.", i + 1);
+      Cancel = 1;
+      break;
+    }
+  }
+
+ /*
+  * Wait for the clients to finish and merge their statistics...
+  */
+
+  stats = cupsArrayNew3((cups_array_func_t)compare_stats, NULL, NULL, 0, NULL, (cups_afree_func_t)free_stats);
+
+  for (i = 0, client = clients; i < load->clients; i ++, client ++)
+  {
+    if (client->thread)
+      _cupsThreadWait(client->thread);
+
+    runs   += client->runs;
+    failed += client->failed;
+
+    for (cstat = (_cups_stats_t *)cupsArrayFirst(client->data.stats); cstat; cstat = (_cups_stats_t *)cupsArrayNext(client->data.stats))
+    {
+      if ((stat = (_cups_stats_t *)cupsArrayFind(stats, cstat)) == NULL)
+      {
+        if ((stat = (_cups_stats_t *)calloc(1, sizeof(_cups_stats_t))) == NULL)
+          continue;
+
+        stat->op = cstat->op;
+
+        if (cstat->name && (stat->name = strdup(cstat->name)) == NULL)
+        {
+          free(stat);
+          continue;
+        }
 
-  for (dataptr = data; dataptr < dataend; dataptr ++)
-    if (*dataptr < 0x20 || *dataptr >= 0x7f)
-      break;
+        cupsArrayAdd(stats, stat);
+      }
 
-  if (dataptr < dataend)
-  {
-   /*
-    * Yes, encode as hex...
-    */
+      stat->bytes_sent     += cstat->bytes_sent;
+      stat->bytes_received += cstat->bytes_received;
 
-    *buffer = '<';
+      for (j = 0; j < cstat->num_statuses; j ++)
+        add_status(stat, cstat->statuses[j].status, cstat->statuses[j].count);
 
-    for (bufptr = buffer + 1, dataptr = data; bufptr < bufend && dataptr < dataend; dataptr ++)
-    {
-      *bufptr++ = hexdigits[*dataptr >> 4];
-      *bufptr++ = hexdigits[*dataptr & 15];
-    }
+      count = stat->num_samples + cstat->num_samples;
 
-    if (bufptr < bufend)
-      *bufptr++ = '>';
+      if (count > stat->alloc_samples)
+      {
+        if ((samples = (double *)realloc(stat->samples, count * sizeof(double))) == NULL)
+          continue;
 
-    *bufptr = '\0';
-  }
-  else
-  {
-   /*
-    * No, copy as a string...
-    */
+        stat->samples       = samples;
+        stat->alloc_samples = count;
+      }
 
-    if ((size_t)datalen > bufsize)
-      datalen = (int)bufsize - 1;
+      memcpy(stat->samples + stat->num_samples, cstat->samples, cstat->num_samples * sizeof(double));
+      stat->num_samples = count;
+      stat->errors      += cstat->errors;
+    }
 
-    memcpy(buffer, data, (size_t)datalen);
-    buffer[datalen] = '\0';
+    cupsArrayDelete(client->data.stats);
+    cupsArrayDelete(client->data.errors);
+    cupsArrayDelete(client->data.regexes);
+    _ippVarsDeinit(&client->vars);
   }
+
+  elapsed = get_time() - load->start;
+
+  print_load_report(stats, load, runs, failed, elapsed);
+
+  cupsArrayDelete(stats);
+  free(clients);
+
+  return (runs > 0 && !failed);
 }
 
 
@@ -900,18 +1535,20 @@ do_test(_ipp_file_t      *f,		/* I - IPP data file */
   _cups_expect_t *expect;		/* Current expected attribute */
   ipp_t		*request,		/* IPP request */
 		*response;		/* IPP response */
-  size_t	length;			/* Length of IPP request */
-  http_status_t	status;			/* HTTP status */
   cups_array_t	*a;			/* Duplicate attribute array */
   ipp_tag_t	group;			/* Current group */
   ipp_attribute_t *attrptr,		/* Attribute pointer */
 		*found;			/* Found attribute */
   char		temp[1024];		/* Temporary string */
-  cups_file_t	*reqfile;		/* File to send */
-  ssize_t	bytes;			/* Bytes read/written */
   char		buffer[131072];		/* Copy buffer */
   size_t	widths[200];		/* Width of columns */
   const char	*error;			/* Current error */
+  _cups_exchange_t *exchange,		/* Request/response exchange */
+		local_exchange;		/* Exchange for this connection */
+  double	send_time = 0.0,	/* Time to send request */
+		first_time = 0.0,	/* Time to first byte of response */
+		total_time = 0.0;	/* Time to receive response */
+  ipp_op_t	stat_op = (ipp_op_t)0;	/* Operation in statistics, if any */
 
 
   if (Cancel)
@@ -933,8 +1570,16 @@ do_test(_ipp_file_t      *f,		/* I - IPP data file */
   * Take over control of the attributes in the request...
   */
 
-  request  = f->attrs;
-  f->attrs = NULL;
+  if (data->exchange)
+  {
+    request                 = data->exchange->request;
+    data->exchange->request = NULL;
+  }
+  else
+  {
+    request  = f->attrs;
+    f->attrs = NULL;
+  }
 
  /*
   * Submit the IPP request...
@@ -1027,135 +1672,44 @@ do_test(_ipp_file_t      *f,		/* I - IPP data file */
     data->delay = data->repeat_interval;
     repeat_count ++;
 
-    status = HTTP_STATUS_OK;
+    repeat_test = 0;
 
-    if (data->transfer == _CUPS_TRANSFER_CHUNKED || (data->transfer == _CUPS_TRANSFER_AUTO && data->file[0]))
+    if (data->exchange)
     {
      /*
-      * Send request using chunking - a 0 length means "chunk".
+      * Use the response that a pipeline connection already received...
       */
 
-      length = 0;
+      exchange       = data->exchange;
+      data->exchange = NULL;
+
+      _cupsSetError(exchange->ipp_status, exchange->message[0] ? exchange->message : NULL, 0);
     }
     else
     {
-     /*
-      * Send request using content length...
-      */
-
-      length = ippLength(request);
-
-      if (data->file[0] && (reqfile = cupsFileOpen(data->file, "r")) != NULL)
-      {
-       /*
-	* Read the file to get the uncompressed file size...
-	*/
-
-	while ((bytes = cupsFileRead(reqfile, buffer, sizeof(buffer))) > 0)
-	  length += (size_t)bytes;
+      exchange          = &local_exchange;
+      exchange->request = request;
 
-	cupsFileClose(reqfile);
-      }
+      send_request(data, data->http, exchange);
     }
 
-   /*
-    * Send the request...
-    */
-
-    data->prev_pass = 1;
-    repeat_test     = 0;
-    response        = NULL;
+    response           = exchange->response;
+    exchange->response = NULL;
+    data->prev_pass    = exchange->pass;
+    send_time          = exchange->send_time;
+    first_time         = exchange->first_time;
+    total_time         = exchange->total_time;
 
-    if (status != HTTP_STATUS_ERROR)
+    if (data->stats && !Cancel)
     {
-      while (!response && !Cancel && data->prev_pass)
-      {
-	status = cupsSendRequest(data->http, request, data->resource, length);
-
-#ifdef HAVE_LIBZ
-	if (data->compression[0])
-	  httpSetField(data->http, HTTP_FIELD_CONTENT_ENCODING, data->compression);
-#endif /* HAVE_LIBZ */
-
-	if (!Cancel && status == HTTP_STATUS_CONTINUE && ippGetState(request) == IPP_DATA && data->file[0])
-	{
-	  if ((reqfile = cupsFileOpen(data->file, "r")) != NULL)
-	  {
-	    while (!Cancel && (bytes = cupsFileRead(reqfile, buffer, sizeof(buffer))) > 0)
-	    {
-	      if ((status = cupsWriteRequestData(data->http, buffer, (size_t)bytes)) != HTTP_STATUS_CONTINUE)
-		break;
-            }
-
-	    cupsFileClose(reqfile);
-	  }
-	  else
-	  {
-	    snprintf(buffer, sizeof(buffer), "%s: %s", data->file, strerror(errno));
-	    _cupsSetError(IPP_INTERNAL_ERROR, buffer, 0);
-
-	    status = HTTP_STATUS_ERROR;
-	  }
-	}
-
-       /*
-	* Get the server's response...
-	*/
-
-	if (!Cancel && status != HTTP_STATUS_ERROR)
-	{
-	  response = cupsGetResponse(data->http, data->resource);
-	  status   = httpGetStatus(data->http);
-	}
-
-	if (!Cancel && status == HTTP_STATUS_ERROR && httpError(data->http) != EINVAL &&
-#ifdef _WIN32
-	    httpError(data->http) != WSAETIMEDOUT)
-#else
-	    httpError(data->http) != ETIMEDOUT)
-#endif /* _WIN32 */
-	{
-	  if (httpReconnect2(data->http, 30000, NULL))
-	    data->prev_pass = 0;
-	}
-	else if (status == HTTP_STATUS_ERROR || status == HTTP_STATUS_CUPS_AUTHORIZATION_CANCELED)
-	{
-	  data->prev_pass = 0;
-	  break;
-	}
-	else if (status != HTTP_STATUS_OK)
-	{
-	  httpFlush(data->http);
-
-	  if (status == HTTP_STATUS_UNAUTHORIZED)
-	    continue;
-
-	  break;
-	}
-      }
-    }
+     /*
+      * Failures are counted once the test result is known...
+      */
 
-    if (!Cancel && status == HTTP_STATUS_ERROR && httpError(data->http) != EINVAL &&
-#ifdef _WIN32
-	httpError(data->http) != WSAETIMEDOUT)
-#else
-	httpError(data->http) != ETIMEDOUT)
-#endif /* _WIN32 */
-    {
-      if (httpReconnect2(data->http, 30000, NULL))
-	data->prev_pass = 0;
-    }
-    else if (status == HTTP_STATUS_ERROR)
-    {
-      if (!Cancel)
-	httpReconnect2(data->http, 30000, NULL);
+      stat_op = ippGetOperation(request);
 
-      data->prev_pass = 0;
-    }
-    else if (status != HTTP_STATUS_OK)
-    {
-      httpFlush(data->http);
-      data->prev_pass = 0;
+      add_stat(data->stats, stat_op, NULL, total_time, 0, cupsLastError(), exchange->bytes_sent, exchange->bytes_received);
+      add_stat(data->stats, stat_op, data->name, total_time, 0, cupsLastError(), exchange->bytes_sent, exchange->bytes_received);
     }
 
    /*
@@ -1164,9 +1718,9 @@ do_test(_ipp_file_t      *f,		/* I - IPP data file */
 
     cupsArrayClear(data->errors);
 
-    if (httpGetVersion(data->http) != HTTP_1_1)
+    if (exchange->version != HTTP_1_1)
     {
-      int version = (int)httpGetVersion(data->http);
+      int version = (int)exchange->version;
 
       add_stringf(data->errors, "Bad HTTP version (%d.%d)", version / 100, version % 100);
     }
@@ -1696,12 +2250,24 @@ do_test(_ipp_file_t      *f,		/* I - IPP data file */
   else
     data->fail_count ++;
 
+  if (!data->prev_pass && stat_op)
+    add_stat_error(data->stats, stat_op, data->name);
+
   if (data->output == _CUPS_OUTPUT_PLIST)
   {
     cupsFilePuts(data->outfile, "<key>Successful</key>\n");
     cupsFilePuts(data->outfile, data->prev_pass ? "<true />\n" : "<false />\n");
     cupsFilePuts(data->outfile, "<key>StatusCode</key>\n");
     print_xml_string(data->outfile, "string", ippErrorString(cupsLastError()));
+    if (data->timing)
+    {
+      cupsFilePuts(data->outfile, "<key>Timing</key>\n");
+      cupsFilePuts(data->outfile, "<dict>\n");
+      cupsFilePrintf(data->outfile, "<key>SendTime</key>\n<real>%.6f</real>\n", send_time);
+      cupsFilePrintf(data->outfile, "<key>FirstByteTime</key>\n<real>%.6f</real>\n", first_time);
+      cupsFilePrintf(data->outfile, "<key>TotalTime</key>\n<real>%.6f</real>\n", total_time);
+      cupsFilePuts(data->outfile, "</dict>\n");
+    }
     cupsFilePuts(data->outfile, "<key>ResponseAttributes</key>\n");
     cupsFilePuts(data->outfile, "<array>\n");
     cupsFilePuts(data->outfile, "<dict>\n");
@@ -1730,6 +2296,8 @@ do_test(_ipp_file_t      *f,		/* I - IPP data file */
     if (!data->prev_pass || (data->verbosity && response))
     {
       cupsFilePrintf(cupsFileStdout(), "        RECEIVED: %lu bytes in response\n", (unsigned long)ippLength(response));
+      if (data->timing)
+        cupsFilePrintf(cupsFileStdout(), "        TIMING: send %.3fms, first byte %.3fms, total %.3fms\n", 1000.0 * send_time, 1000.0 * first_time, 1000.0 * total_time);
       cupsFilePrintf(cupsFileStdout(), "        status-code = %s (%s)\n", ippErrorString(cupsLastError()), cupsLastErrorString());
 
       if (data->verbosity && response)
@@ -1834,44 +2402,7 @@ do_test(_ipp_file_t      *f,		/* I - IPP data file */
   ippDelete(response);
   response = NULL;
 
-  for (i = 0; i < data->num_statuses; i ++)
-  {
-    if (data->statuses[i].if_defined)
-      free(data->statuses[i].if_defined);
-    if (data->statuses[i].if_not_defined)
-      free(data->statuses[i].if_not_defined);
-    if (data->statuses[i].define_match)
-      free(data->statuses[i].define_match);
-    if (data->statuses[i].define_no_match)
-      free(data->statuses[i].define_no_match);
-  }
-  data->num_statuses = 0;
-
-  for (i = data->num_expects, expect = data->expects; i > 0; i --, expect ++)
-  {
-    free(expect->name);
-    if (expect->of_type)
-      free(expect->of_type);
-    if (expect->same_count_as)
-      free(expect->same_count_as);
-    if (expect->if_defined)
-      free(expect->if_defined);
-    if (expect->if_not_defined)
-      free(expect->if_not_defined);
-    if (expect->with_value)
-      free(expect->with_value);
-    if (expect->define_match)
-      free(expect->define_match);
-    if (expect->define_no_match)
-      free(expect->define_no_match);
-    if (expect->define_value)
-      free(expect->define_value);
-  }
-  data->num_expects = 0;
-
-  for (i = 0; i < data->num_displayed; i ++)
-    free(data->displayed[i]);
-  data->num_displayed = 0;
+  free_test(data);
 
   return (data->ignore_errors || data->prev_pass);
 }
@@ -1886,39 +2417,37 @@ do_tests(const char       *testfile,	/* I - Test file to use */
          _ipp_vars_t      *vars,	/* I - Variables */
          _cups_testdata_t *data)	/* I - Test data */
 {
-  http_encryption_t encryption;		/* Encryption mode */
-
-
  /*
   * Connect to the printer/server...
   */
 
-  if (!_cups_strcasecmp(vars->scheme, "https") || !_cups_strcasecmp(vars->scheme, "ipps"))
-    encryption = HTTP_ENCRYPTION_ALWAYS;
-  else
-    encryption = data->encryption;
+  if ((data->http = connect_printer(vars, data)) == NULL)
+    return (0);
 
-  if ((data->http = httpConnect2(vars->host, vars->port, NULL, data->family, encryption, 1, 30000, NULL)) == NULL)
+  if (data->parallel > 0 && !start_pipeline(vars, data))
   {
-    print_fatal_error(data, "Unable to connect to \"%s\" on port %d - %s", vars->host, vars->port, cupsLastErrorString());
+    httpClose(data->http);
+    data->http = NULL;
+
     return (0);
   }
 
-#ifdef HAVE_LIBZ
-  httpSetDefaultField(data->http, HTTP_FIELD_ACCEPT_ENCODING, "deflate, gzip, identity");
-#else
-  httpSetDefaultField(data->http, HTTP_FIELD_ACCEPT_ENCODING, "identity");
-#endif /* HAVE_LIBZ */
-
-  if (data->timeout > 0.0)
-    httpSetTimeout(data->http, data->timeout, timeout_cb, NULL);
-
  /*
   * Run tests...
   */
 
   _ippFileParse(vars, testfile, (void *)data);
 
+ /*
+  * Check any pipelined tests that are still queued...
+  */
+
+  if (data->pipeline)
+  {
+    flush_pipeline(vars, data, 0);
+    stop_pipeline(data);
+  }
+
  /*
   * Close connection and return...
   */
@@ -1989,24 +2518,181 @@ expect_matches(
     * Support some meta-types to make it easier to write the test file.
     */
 
-    if (!strcmp(of_type, "text"))
-      match = value_tag == IPP_TAG_TEXTLANG || value_tag == IPP_TAG_TEXT;
-    else if (!strcmp(of_type, "name"))
-      match = value_tag == IPP_TAG_NAMELANG || value_tag == IPP_TAG_NAME;
-    else if (!strcmp(of_type, "collection"))
-      match = value_tag == IPP_TAG_BEGIN_COLLECTION;
-    else
-      match = value_tag == ippTagValue(of_type);
+    if (!strcmp(of_type, "text"))
+      match = value_tag == IPP_TAG_TEXTLANG || value_tag == IPP_TAG_TEXT;
+    else if (!strcmp(of_type, "name"))
+      match = value_tag == IPP_TAG_NAMELANG || value_tag == IPP_TAG_NAME;
+    else if (!strcmp(of_type, "collection"))
+      match = value_tag == IPP_TAG_BEGIN_COLLECTION;
+    else
+      match = value_tag == ippTagValue(of_type);
+
+   /*
+    * Restore the separator if we have one...
+    */
+
+    if (sep)
+      *next++ = sep;
+  }
+
+  return (match);
+}
+
+
+/*
+ * 'flush_pipeline()' - Check pipelined tests in order until no more than the
+ *                      given number are queued.
+ */
+
+static int				/* O - 1 to continue, 0 to stop */
+flush_pipeline(_ipp_vars_t      *vars,	/* I - IPP variables */
+               _cups_testdata_t *data,	/* I - Test data */
+               int              max_tests)
+					/* I - Maximum tests to leave queued */
+{
+  _cups_pipeline_t *pipeline = data->pipeline;
+					/* Pipeline */
+  _cups_pipetest_t *test;		/* Current test */
+
+
+  while (!Cancel && cupsArrayCount(pipeline->tests) > max_tests)
+  {
+   /*
+    * Wait for the oldest test to get its response...
+    */
+
+    _cupsMutexLock(&pipeline->mutex);
+
+    test = (_cups_pipetest_t *)cupsArrayFirst(pipeline->tests);
+
+    while (!Cancel && test->state != _CUPS_PIPESTATE_DONE)
+      _cupsCondWait(&pipeline->cond, &pipeline->mutex, 1.0);
+
+    if (Cancel)
+    {
+      _cupsMutexUnlock(&pipeline->mutex);
+      break;
+    }
+
+    cupsArrayRemove(pipeline->tests, test);
+
+    _cupsMutexUnlock(&pipeline->mutex);
+
+   /*
+    * Then check it with the current totals, unless an earlier test has
+    * stopped the test file...
+    */
+
+    if (!pipeline->stopped)
+    {
+      test->data.pass       = data->pass;
+      test->data.prev_pass  = data->prev_pass;
+      test->data.test_count = data->test_count;
+      test->data.pass_count = data->pass_count;
+      test->data.fail_count = data->fail_count;
+      test->data.skip_count = data->skip_count;
+      test->data.xml_header = data->xml_header;
+      test->data.exchange   = &test->exchange;
+
+      if (!do_test(NULL, vars, &test->data))
+        pipeline->stopped = 1;
+
+      data->pass       = test->data.pass;
+      data->prev_pass  = test->data.prev_pass;
+      data->test_count = test->data.test_count;
+      data->pass_count = test->data.pass_count;
+      data->fail_count = test->data.fail_count;
+      data->skip_count = test->data.skip_count;
+      data->xml_header = test->data.xml_header;
+    }
+    else
+      free_test(&test->data);
+
+    ippDelete(test->exchange.request);
+    ippDelete(test->exchange.response);
+    free(test);
+  }
+
+  return (!Cancel && !pipeline->stopped);
+}
+
+
+/*
+ * 'free_regex()' - Free a compiled regular expression.
+ */
+
+static void
+free_regex(_cups_regex_t *regex)	/* I - Regular expression */
+{
+  regfree(&regex->re);
+  free(regex->pattern);
+  free(regex);
+}
+
+
+/*
+ * 'free_stats()' - Free load statistics for an operation.
+ */
+
+static void
+free_stats(_cups_stats_t *stat)		/* I - Statistics */
+{
+  free(stat->name);
+  free(stat->samples);
+  free(stat);
+}
+
+
+/*
+ * 'free_test()' - Free the expected attributes, statuses, and displayed
+ *                 attributes of a test.
+ */
+
+static void
+free_test(_cups_testdata_t *data)	/* I - Test data */
+{
+  int		i;			/* Looping var */
+  _cups_expect_t *expect;		/* Current expected attribute */
+
 
-   /*
-    * Restore the separator if we have one...
-    */
+  for (i = 0; i < data->num_statuses; i ++)
+  {
+    if (data->statuses[i].if_defined)
+      free(data->statuses[i].if_defined);
+    if (data->statuses[i].if_not_defined)
+      free(data->statuses[i].if_not_defined);
+    if (data->statuses[i].define_match)
+      free(data->statuses[i].define_match);
+    if (data->statuses[i].define_no_match)
+      free(data->statuses[i].define_no_match);
+  }
+  data->num_statuses = 0;
 
-    if (sep)
-      *next++ = sep;
+  for (i = data->num_expects, expect = data->expects; i > 0; i --, expect ++)
+  {
+    free(expect->name);
+    if (expect->of_type)
+      free(expect->of_type);
+    if (expect->same_count_as)
+      free(expect->same_count_as);
+    if (expect->if_defined)
+      free(expect->if_defined);
+    if (expect->if_not_defined)
+      free(expect->if_not_defined);
+    if (expect->with_value)
+      free(expect->with_value);
+    if (expect->define_match)
+      free(expect->define_match);
+    if (expect->define_no_match)
+      free(expect->define_no_match);
+    if (expect->define_value)
+      free(expect->define_value);
   }
+  data->num_expects = 0;
 
-  return (match);
+  for (i = 0; i < data->num_displayed; i ++)
+    free(data->displayed[i]);
+  data->num_displayed = 0;
 }
 
 
@@ -2082,6 +2768,82 @@ get_filename(const char *testfile,	/* I - Current test file */
 }
 
 
+/*
+ * 'get_percentile()' - Return a latency percentile from sorted samples.
+ */
+
+static double				/* O - Latency in seconds */
+get_percentile(_cups_stats_t *stat,	/* I - Operation statistics (sorted) */
+               double        pct)	/* I - Percentile from 0.0 to 1.0 */
+{
+  size_t	rank;			/* Sample rank */
+
+
+  if (!stat->num_samples)
+    return (0.0);
+
+ /*
+  * Use the nearest-rank percentile...
+  */
+
+  rank = (size_t)(pct * (double)stat->num_samples);
+  if ((double)rank < pct * (double)stat->num_samples)
+    rank ++;
+  if (rank > 0)
+    rank --;
+  if (rank >= stat->num_samples)
+    rank = stat->num_samples - 1;
+
+  return (stat->samples[rank]);
+}
+
+
+/*
+ * 'get_regex()' - Get a compiled regular expression.
+ *
+ * Regular expressions are compiled once and kept for the rest of the run, so
+ * repeated tests, included files, and test file repeats do not compile them
+ * again.
+ */
+
+static regex_t *			/* O - Regular expression or `NULL` on error */
+get_regex(_cups_testdata_t *data,	/* I - Test data */
+          const char       *pattern)	/* I - Regular expression string */
+{
+  _cups_regex_t	key,			/* Search key */
+		*regex;			/* Matching regular expression */
+  int		err;			/* regcomp() error */
+  char		message[256];		/* Error message */
+
+
+  key.pattern = (char *)pattern;
+
+  if ((regex = (_cups_regex_t *)cupsArrayFind(data->regexes, &key)) != NULL)
+    return (&regex->re);
+
+  if ((regex = calloc(1, sizeof(_cups_regex_t))) == NULL || (regex->pattern = strdup(pattern)) == NULL)
+  {
+    free(regex);
+    print_fatal_error(data, "Unable to compile WITH-VALUE regular expression \"%s\" - %s", pattern, strerror(errno));
+    return (NULL);
+  }
+
+  if ((err = regcomp(&regex->re, pattern, REG_EXTENDED | REG_NOSUB)) != 0)
+  {
+    regerror(err, &regex->re, message, sizeof(message));
+    print_fatal_error(data, "Unable to compile WITH-VALUE regular expression \"%s\" - %s", pattern, message);
+
+    free(regex->pattern);
+    free(regex);
+    return (NULL);
+  }
+
+  cupsArrayAdd(data->regexes, regex);
+
+  return (&regex->re);
+}
+
+
 /*
  * 'get_string()' - Get a pointer to a string value or the portion of interest.
  */
@@ -2160,6 +2922,22 @@ get_string(ipp_attribute_t *attr,	/* I - IPP attribute */
 }
 
 
+/*
+ * 'get_time()' - Return the current time in seconds.
+ */
+
+static double				/* O - Current time */
+get_time(void)
+{
+  struct timeval curtime;		/* Current time */
+
+
+  gettimeofday(&curtime, NULL);
+
+  return ((double)curtime.tv_sec + 0.000001 * (double)curtime.tv_usec);
+}
+
+
 /*
  * 'init_data()' - Initialize test data.
  */
@@ -2177,6 +2955,7 @@ init_data(_cups_testdata_t *data)	/* I - Data */
   data->errors       = cupsArrayNew3(NULL, NULL, NULL, 0, (cups_acopy_func_t)strdup, (cups_afree_func_t)free);
   data->pass         = 1;
   data->prev_pass    = 1;
+  data->regexes      = cupsArrayNew3((cups_array_func_t)compare_regexes, NULL, NULL, 0, NULL, (cups_afree_func_t)free_regex);
   data->request_id   = (CUPS_RAND() % 1000) * 137 + 1;
   data->show_header  = 1;
 }
@@ -2206,6 +2985,87 @@ iso_date(const ipp_uchar_t *date)	/* I - IPP (RFC 1903) date/time value */
 }
 
 
+/*
+ * 'load_client()' - Run the test file in a loop for one load generator client.
+ */
+
+static void *				/* O - Thread exit status */
+load_client(_cups_client_t *client)	/* I - Load generator client */
+{
+  _cups_load_t	*load = client->load;	/* Load generator settings */
+  _cups_testdata_t *data = &client->data;
+					/* Client test data */
+  double	interval,		/* Time between runs */
+		next,			/* Scheduled start of next run */
+		now,			/* Current time */
+		start;			/* Start of current run */
+
+
+  if (client->vars.username[0] && client->vars.password)
+    cupsSetPasswordCB2(_ippVarsPasswordCB, &client->vars);
+
+  if ((data->http = connect_printer(&client->vars, data)) == NULL)
+  {
+    client->failed ++;
+    return (NULL);
+  }
+
+ /*
+  * Spread the clients' first runs over one interval so the arrivals don't
+  * all line up...
+  */
+
+  interval = load->rate > 0.0 ? 1.0 / load->rate : 0.0;
+  next     = load->start + interval * client->number / load->clients;
+
+  while (!Cancel && (load->repeat <= 0 || client->runs < load->repeat))
+  {
+    now = get_time();
+
+    if (load->duration > 0.0 && (now - load->start) >= load->duration)
+      break;
+
+    if (next > now)
+    {
+      usleep((useconds_t)((next - now) * 1000000.0));
+      continue;
+    }
+
+   /*
+    * In open-loop mode runs are started on a fixed schedule and measured from
+    * their scheduled time, so a slow server shows up as latency instead of a
+    * lower arrival rate...
+    */
+
+    start = load->open_loop ? next : now;
+
+    data->pass      = 1;
+    data->prev_pass = 1;
+
+    _ippFileParse(&client->vars, load->testfile, data);
+
+    if (Cancel)
+      break;
+
+    client->runs ++;
+    if (!data->pass)
+      client->failed ++;
+
+    add_stat(data->stats, (ipp_op_t)0, NULL, get_time() - start, !data->pass, IPP_STATUS_CUPS_INVALID, 0, 0);
+
+    if (load->open_loop)
+      next += interval;
+    else
+      next = now + interval;
+  }
+
+  httpClose(data->http);
+  data->http = NULL;
+
+  return (NULL);
+}
+
+
 /*
  * 'pause_message()' - Display the message and pause until the user presses a key.
  */
@@ -2305,6 +3165,56 @@ pause_message(const char *message)	/* I - Message */
 }
 
 
+/*
+ * 'pipeline_worker()' - Send queued tests over one pipeline connection.
+ */
+
+static void *				/* O - Thread exit status */
+pipeline_worker(_cups_worker_t *worker)	/* I - Pipeline connection */
+{
+  _cups_pipeline_t *pipeline = worker->pipeline;
+					/* Pipeline */
+  _cups_pipetest_t *test;		/* Current test */
+
+
+  if (pipeline->vars->username[0] && pipeline->vars->password)
+    cupsSetPasswordCB2(_ippVarsPasswordCB, pipeline->vars);
+
+  _cupsMutexLock(&pipeline->mutex);
+
+  while (!pipeline->shutdown && !Cancel)
+  {
+    for (test = (_cups_pipetest_t *)cupsArrayFirst(pipeline->tests); test; test = (_cups_pipetest_t *)cupsArrayNext(pipeline->tests))
+    {
+      if (test->state == _CUPS_PIPESTATE_QUEUED)
+        break;
+    }
+
+    if (!test)
+    {
+      _cupsCondWait(&pipeline->cond, &pipeline->mutex, 1.0);
+      continue;
+    }
+
+    test->state = _CUPS_PIPESTATE_SENDING;
+
+    _cupsMutexUnlock(&pipeline->mutex);
+
+    send_request(&test->data, worker->http, &test->exchange);
+
+    _cupsMutexLock(&pipeline->mutex);
+
+    test->state = _CUPS_PIPESTATE_DONE;
+
+    _cupsCondBroadcast(&pipeline->cond);
+  }
+
+  _cupsMutexUnlock(&pipeline->mutex);
+
+  return (NULL);
+}
+
+
 /*
  * 'print_attr()' - Print an attribute on the screen.
  */
@@ -2764,50 +3674,280 @@ print_line(
   {
     for (i = 0; i < num_displayed; i ++)
     {
-      if (i)
-        cupsFilePutChar(cupsFileStdout(), ' ');
+      if (i)
+        cupsFilePutChar(cupsFileStdout(), ' ');
+
+      buffer[0] = '\0';
+
+      for (current = attr; current; current = ippNextAttribute(ipp))
+      {
+        if (!ippGetName(current))
+          break;
+        else if (!strcmp(ippGetName(current), displayed[i]))
+        {
+          ippAttributeString(current, buffer, maxlength);
+          break;
+        }
+      }
+
+      cupsFilePrintf(data->outfile, "%*s", (int)-widths[i], buffer);
+    }
+    cupsFilePutChar(cupsFileStdout(), '\n');
+  }
+  else
+  {
+    for (i = 0; i < num_displayed; i ++)
+    {
+      if (i)
+        cupsFilePutChar(cupsFileStdout(), ' ');
+
+      cupsFilePrintf(data->outfile, "%*s", (int)-widths[i], displayed[i]);
+    }
+    cupsFilePutChar(cupsFileStdout(), '\n');
+
+    for (i = 0; i < num_displayed; i ++)
+    {
+      if (i)
+	cupsFilePutChar(cupsFileStdout(), ' ');
+
+      memset(buffer, '-', widths[i]);
+      buffer[widths[i]] = '\0';
+      cupsFilePuts(data->outfile, buffer);
+    }
+    cupsFilePutChar(cupsFileStdout(), '\n');
+  }
+
+  free(buffer);
+}
+
+
+/*
+ * 'print_load_report()' - Print the request rate and latencies for each
+ *                         operation.
+ */
+
+static void
+print_load_report(
+    cups_array_t *stats,		/* I - Merged statistics */
+    _cups_load_t *load,			/* I - Load generator settings */
+    int          runs,			/* I - Number of test file runs */
+    int          failed,		/* I - Number of failed test file runs */
+    double       elapsed)		/* I - Elapsed time in seconds */
+{
+  int		requests = 0,		/* Total number of requests */
+		errors = 0;		/* Total number of failed requests */
+  _cups_stats_t	*stat;			/* Operation statistics */
+  cups_file_t	*outfile = cupsFileStdout();
+					/* Output file */
+
+
+  if (elapsed <= 0.0)
+    elapsed = 0.001;
+
+  for (stat = (_cups_stats_t *)cupsArrayFirst(stats); stat; stat = (_cups_stats_t *)cupsArrayNext(stats))
+  {
+    if (stat->op && !stat->name)
+    {
+      requests += (int)stat->num_samples;
+      errors   += stat->errors;
+    }
+  }
+
+  cupsFilePrintf(outfile, "Load: %d clients, %s, %.3f seconds\n", load->clients, load->open_loop ? "open-loop" : "closed-loop", elapsed);
+  cupsFilePrintf(outfile, "Runs: %d (%d failed), %.1f runs/sec\n", runs, failed, runs / elapsed);
+  cupsFilePrintf(outfile, "Requests: %d (%d failed), %.1f requests/sec\n\n", requests, errors, requests / elapsed);
+  cupsFilePrintf(outfile, "%-32s %8s %8s %10s %10s %10s %10s %10s\n", "OPERATION", "REQUESTS", "ERRORS", "REQ/SEC", "P50 MS", "P90 MS", "P99 MS", "MAX MS");
+
+  for (stat = (_cups_stats_t *)cupsArrayFirst(stats); stat; stat = (_cups_stats_t *)cupsArrayNext(stats))
+  {
+    if (!stat->num_samples || stat->name)
+      continue;
+
+    qsort(stat->samples, stat->num_samples, sizeof(double), (int (*)(const void *, const void *))compare_doubles);
+
+    cupsFilePrintf(outfile, "%-32s %8d %8d %10.1f %10.3f %10.3f %10.3f %10.3f\n", stat->op ? ippOpString(stat->op) : "(test file)", (int)stat->num_samples, stat->errors, stat->num_samples / elapsed, 1000.0 * get_percentile(stat, 0.5), 1000.0 * get_percentile(stat, 0.9), 1000.0 * get_percentile(stat, 0.99), 1000.0 * get_percentile(stat, 1.0));
+  }
+
+  cupsFileFlush(outfile);
+}
+
+
+/*
+ * 'print_timing()' - Print a latency histogram for each operation and the
+ *                    latency, status code, and transfer statistics for each
+ *                    test.
+ */
+
+static void
+print_timing(cups_file_t    *outfile,	/* I - Output file */
+             _cups_output_t output,	/* I - Output mode */
+             cups_array_t   *stats)	/* I - Request statistics */
+{
+  int		i,			/* Looping var */
+		first,			/* First non-empty bucket */
+		last,			/* Last non-empty bucket */
+		maxcount,		/* Largest bucket */
+		counts[13],		/* Histogram bucket counts */
+		num_tests = 0;		/* Number of test statistics */
+  size_t	j;			/* Looping var */
+  double	total;			/* Total latency */
+  _cups_stats_t	*stat;			/* Operation statistics */
+  static const double limits[12] =	/* Histogram bucket limits in seconds */
+  {
+    0.001, 0.002, 0.005, 0.01, 0.02, 0.05, 0.1, 0.2, 0.5, 1.0, 2.0, 5.0
+  };
+  static const char * const labels[13] =/* Histogram bucket labels */
+  {
+    "<1ms", "<2ms", "<5ms", "<10ms", "<20ms", "<50ms", "<100ms", "<200ms", "<500ms", "<1s", "<2s", "<5s", ">=5s"
+  };
+
+
+  if (output == _CUPS_OUTPUT_PLIST)
+  {
+    cupsFilePuts(outfile, "<dict>\n");
+    cupsFilePuts(outfile, "<key>Limits</key>\n");
+    cupsFilePuts(outfile, "<array>\n");
+    for (i = 0; i < 12; i ++)
+      cupsFilePrintf(outfile, "<real>%g</real>\n", limits[i]);
+    cupsFilePuts(outfile, "</array>\n");
+    cupsFilePuts(outfile, "<key>Operations</key>\n");
+    cupsFilePuts(outfile, "<array>\n");
+  }
+  else
+    cupsFilePuts(outfile, "\nTiming:\n");
+
+  for (stat = (_cups_stats_t *)cupsArrayFirst(stats); stat; stat = (_cups_stats_t *)cupsArrayNext(stats))
+  {
+    if (!stat->num_samples)
+      continue;
+
+    qsort(stat->samples, stat->num_samples, sizeof(double), (int (*)(const void *, const void *))compare_doubles);
+
+    if (stat->name)
+    {
+      num_tests ++;
+      continue;
+    }
+
+    memset(counts, 0, sizeof(counts));
+
+    for (j = 0, i = 0; j < stat->num_samples; j ++)
+    {
+      while (i < 12 && stat->samples[j] >= limits[i])
+        i ++;
+
+      counts[i] ++;
+    }
+
+    if (output == _CUPS_OUTPUT_PLIST)
+    {
+      cupsFilePuts(outfile, "<dict>\n");
+      cupsFilePuts(outfile, "<key>Operation</key>\n");
+      print_xml_string(outfile, "string", ippOpString(stat->op));
+      cupsFilePrintf(outfile, "<key>Count</key>\n<integer>%d</integer>\n", (int)stat->num_samples);
+      cupsFilePrintf(outfile, "<key>Errors</key>\n<integer>%d</integer>\n", stat->errors);
+      cupsFilePrintf(outfile, "<key>P50</key>\n<real>%.6f</real>\n", get_percentile(stat, 0.5));
+      cupsFilePrintf(outfile, "<key>P90</key>\n<real>%.6f</real>\n", get_percentile(stat, 0.9));
+      cupsFilePrintf(outfile, "<key>P99</key>\n<real>%.6f</real>\n", get_percentile(stat, 0.99));
+      cupsFilePrintf(outfile, "<key>Max</key>\n<real>%.6f</real>\n", get_percentile(stat, 1.0));
+      cupsFilePuts(outfile, "<key>Histogram</key>\n");
+      cupsFilePuts(outfile, "<array>\n");
+      for (i = 0; i < 13; i ++)
+        cupsFilePrintf(outfile, "<integer>%d</integer>\n", counts[i]);
+      cupsFilePuts(outfile, "</array>\n");
+      cupsFilePuts(outfile, "</dict>\n");
+      continue;
+    }
 
-      buffer[0] = '\0';
+    cupsFilePrintf(outfile, "    %s: %d requests, %d failed, p50 %.3fms, p90 %.3fms, p99 %.3fms, max %.3fms\n", ippOpString(stat->op), (int)stat->num_samples, stat->errors, 1000.0 * get_percentile(stat, 0.5), 1000.0 * get_percentile(stat, 0.9), 1000.0 * get_percentile(stat, 0.99), 1000.0 * get_percentile(stat, 1.0));
 
-      for (current = attr; current; current = ippNextAttribute(ipp))
+    for (i = 0, first = -1, last = -1, maxcount = 0; i < 13; i ++)
+    {
+      if (counts[i])
       {
-        if (!ippGetName(current))
-          break;
-        else if (!strcmp(ippGetName(current), displayed[i]))
-        {
-          ippAttributeString(current, buffer, maxlength);
-          break;
-        }
+        if (first < 0)
+          first = i;
+
+        last = i;
+
+        if (counts[i] > maxcount)
+          maxcount = counts[i];
       }
+    }
 
-      cupsFilePrintf(data->outfile, "%*s", (int)-widths[i], buffer);
+    for (i = first; i >= 0 && i <= last; i ++)
+    {
+      int	bar = (40 * counts[i] + maxcount - 1) / maxcount;
+					/* Length of histogram bar */
+
+      cupsFilePrintf(outfile, "        %-6s %8d %.*s\n", labels[i], counts[i], bar, "########################################");
     }
-    cupsFilePutChar(cupsFileStdout(), '\n');
   }
-  else
+
+  if (output == _CUPS_OUTPUT_PLIST)
   {
-    for (i = 0; i < num_displayed; i ++)
-    {
-      if (i)
-        cupsFilePutChar(cupsFileStdout(), ' ');
+    cupsFilePuts(outfile, "</array>\n");
+    cupsFilePuts(outfile, "<key>Tests</key>\n");
+    cupsFilePuts(outfile, "<array>\n");
+  }
+  else if (num_tests > 0)
+    cupsFilePuts(outfile, "\nTests:\n");
 
-      cupsFilePrintf(data->outfile, "%*s", (int)-widths[i], displayed[i]);
-    }
-    cupsFilePutChar(cupsFileStdout(), '\n');
+ /*
+  * Show the statistics for each test, which have already been sorted above...
+  */
 
-    for (i = 0; i < num_displayed; i ++)
-    {
-      if (i)
-	cupsFilePutChar(cupsFileStdout(), ' ');
+  for (stat = (_cups_stats_t *)cupsArrayFirst(stats); stat; stat = (_cups_stats_t *)cupsArrayNext(stats))
+  {
+    if (!stat->num_samples || !stat->name)
+      continue;
 
-      memset(buffer, '-', widths[i]);
-      buffer[widths[i]] = '\0';
-      cupsFilePuts(data->outfile, buffer);
+    for (j = 0, total = 0.0; j < stat->num_samples; j ++)
+      total += stat->samples[j];
+
+    if (output == _CUPS_OUTPUT_PLIST)
+    {
+      cupsFilePuts(outfile, "<dict>\n");
+      cupsFilePuts(outfile, "<key>Name</key>\n");
+      print_xml_string(outfile, "string", stat->name);
+      cupsFilePuts(outfile, "<key>Operation</key>\n");
+      print_xml_string(outfile, "string", ippOpString(stat->op));
+      cupsFilePrintf(outfile, "<key>Count</key>\n<integer>%d</integer>\n", (int)stat->num_samples);
+      cupsFilePrintf(outfile, "<key>Errors</key>\n<integer>%d</integer>\n", stat->errors);
+      cupsFilePrintf(outfile, "<key>Min</key>\n<real>%.6f</real>\n", stat->samples[0]);
+      cupsFilePrintf(outfile, "<key>Average</key>\n<real>%.6f</real>\n", total / stat->num_samples);
+      cupsFilePrintf(outfile, "<key>P50</key>\n<real>%.6f</real>\n", get_percentile(stat, 0.5));
+      cupsFilePrintf(outfile, "<key>P90</key>\n<real>%.6f</real>\n", get_percentile(stat, 0.9));
+      cupsFilePrintf(outfile, "<key>P99</key>\n<real>%.6f</real>\n", get_percentile(stat, 0.99));
+      cupsFilePrintf(outfile, "<key>Max</key>\n<real>%.6f</real>\n", get_percentile(stat, 1.0));
+      cupsFilePrintf(outfile, "<key>BytesSent</key>\n<integer>" CUPS_LLFMT "</integer>\n", CUPS_LLCAST stat->bytes_sent);
+      cupsFilePrintf(outfile, "<key>BytesReceived</key>\n<integer>" CUPS_LLFMT "</integer>\n", CUPS_LLCAST stat->bytes_received);
+      cupsFilePuts(outfile, "<key>StatusCodes</key>\n");
+      cupsFilePuts(outfile, "<dict>\n");
+      for (i = 0; i < stat->num_statuses; i ++)
+      {
+        cupsFilePuts(outfile, "<key>");
+        print_xml_string(outfile, NULL, ippErrorString(stat->statuses[i].status));
+        cupsFilePrintf(outfile, "</key>\n<integer>%d</integer>\n", stat->statuses[i].count);
+      }
+      cupsFilePuts(outfile, "</dict>\n");
+      cupsFilePuts(outfile, "</dict>\n");
+      continue;
     }
-    cupsFilePutChar(cupsFileStdout(), '\n');
+
+    cupsFilePrintf(outfile, "    %s (%s): %d requests, %d failed, min %.3fms, avg %.3fms, p50 %.3fms, p90 %.3fms, p99 %.3fms, max %.3fms\n", stat->name, ippOpString(stat->op), (int)stat->num_samples, stat->errors, 1000.0 * stat->samples[0], 1000.0 * total / stat->num_samples, 1000.0 * get_percentile(stat, 0.5), 1000.0 * get_percentile(stat, 0.9), 1000.0 * get_percentile(stat, 0.99), 1000.0 * get_percentile(stat, 1.0));
+
+    for (i = 0; i < stat->num_statuses; i ++)
+      cupsFilePrintf(outfile, "        %s: %d (%.1f%%)\n", ippErrorString(stat->statuses[i].status), stat->statuses[i].count, 100.0 * stat->statuses[i].count / stat->num_samples);
+
+    cupsFilePrintf(outfile, "        " CUPS_LLFMT " bytes sent, " CUPS_LLFMT " bytes received, %.1f KB/sec\n", CUPS_LLCAST stat->bytes_sent, CUPS_LLCAST stat->bytes_received, total > 0.0 ? (stat->bytes_sent + stat->bytes_received) / total / 1024.0 : 0.0);
   }
 
-  free(buffer);
+  if (output == _CUPS_OUTPUT_PLIST)
+  {
+    cupsFilePuts(outfile, "</array>\n");
+    cupsFilePuts(outfile, "</dict>\n");
+  }
 }
 
 
@@ -2945,6 +4085,11 @@ print_xml_trailer(
     cupsFilePuts(data->outfile, "</array>\n");
     cupsFilePuts(data->outfile, "<key>Successful</key>\n");
     cupsFilePuts(data->outfile, success ? "<true />\n" : "<false />\n");
+    if (data->timing && cupsArrayCount(data->stats) > 0)
+    {
+      cupsFilePuts(data->outfile, "<key>Timing</key>\n");
+      print_timing(data->outfile, _CUPS_OUTPUT_PLIST, data->stats);
+    }
     if (message)
     {
       cupsFilePuts(data->outfile, "<key>ErrorMessage</key>\n");
@@ -2958,6 +4103,258 @@ print_xml_trailer(
 }
 
 
+/*
+ * 'queue_test()' - Queue a test for a pipeline connection or do it now.
+ */
+
+static int				/* O - 1 to continue, 0 to stop */
+queue_test(_ipp_file_t      *f,		/* I - IPP data file */
+           _ipp_vars_t      *vars,	/* I - IPP variables */
+           _cups_testdata_t *data)	/* I - Test data */
+{
+  _cups_pipeline_t *pipeline = data->pipeline;
+					/* Pipeline */
+  _cups_pipetest_t *test;		/* New test */
+
+
+  if (Cancel || !can_pipeline(data, f->attrs) || (test = (_cups_pipetest_t *)calloc(1, sizeof(_cups_pipetest_t))) == NULL)
+  {
+   /*
+    * Check everything that is queued and then do this test on the main
+    * connection...
+    */
+
+    if (!flush_pipeline(vars, data, 0))
+    {
+      free_test(data);
+      return (0);
+    }
+
+    return (do_test(f, vars, data));
+  }
+
+ /*
+  * The queued test takes over the request, expected attributes, statuses, and
+  * displayed attributes...
+  */
+
+  memcpy(&test->data, data, sizeof(test->data));
+
+  test->exchange.request = f->attrs;
+  f->attrs               = NULL;
+
+  ippSetVersion(test->exchange.request, data->version / 10, data->version % 10);
+  ippSetRequestId(test->exchange.request, data->request_id);
+
+  data->num_statuses  = 0;
+  data->num_expects   = 0;
+  data->num_displayed = 0;
+
+  _cupsMutexLock(&pipeline->mutex);
+  cupsArrayAdd(pipeline->tests, test);
+  _cupsCondBroadcast(&pipeline->cond);
+  _cupsMutexUnlock(&pipeline->mutex);
+
+ /*
+  * Keep a few tests queued for each connection...
+  */
+
+  return (flush_pipeline(vars, data, 4 * pipeline->num_workers));
+}
+
+
+/*
+ * 'send_request()' - Send a test's request and get the response.
+ */
+
+static void
+send_request(
+    _cups_testdata_t *data,		/* I - Test data */
+    http_t           *http,		/* I - HTTP connection */
+    _cups_exchange_t *exchange)		/* I - Request/response exchange */
+{
+  ipp_t		*request = exchange->request;
+					/* IPP request */
+  ipp_t		*response = NULL;	/* IPP response */
+  size_t	length,			/* Length of IPP request */
+		sent = 0;		/* Bytes sent */
+  http_status_t	status = HTTP_STATUS_OK;/* HTTP status */
+  cups_file_t	*reqfile;		/* File to send */
+  ssize_t	bytes;			/* Bytes read/written */
+  char		buffer[131072];		/* Copy buffer */
+  double	start,			/* Start time of request */
+		send_time = 0.0,	/* Time to send request */
+		first_time = 0.0;	/* Time to first byte of response */
+  const char	*message;		/* Status message */
+
+
+  if (data->transfer == _CUPS_TRANSFER_CHUNKED || (data->transfer == _CUPS_TRANSFER_AUTO && data->file[0]))
+  {
+   /*
+    * Send request using chunking - a 0 length means "chunk".
+    */
+
+    length = 0;
+  }
+  else
+  {
+   /*
+    * Send request using content length...
+    */
+
+    length = ippLength(request);
+
+    if (data->file[0] && (reqfile = cupsFileOpen(data->file, "r")) != NULL)
+    {
+     /*
+      * Read the file to get the uncompressed file size...
+      */
+
+      while ((bytes = cupsFileRead(reqfile, buffer, sizeof(buffer))) > 0)
+	length += (size_t)bytes;
+
+      cupsFileClose(reqfile);
+    }
+  }
+
+ /*
+  * Send the request...
+  */
+
+  exchange->pass = 1;
+  start          = get_time();
+
+  while (!response && !Cancel && exchange->pass)
+  {
+    start      = get_time();
+    send_time  = 0.0;
+    first_time = 0.0;
+    sent       = ippLength(request);
+    status     = cupsSendRequest(http, request, data->resource, length);
+
+#ifdef HAVE_LIBZ
+    if (data->compression[0])
+      httpSetField(http, HTTP_FIELD_CONTENT_ENCODING, data->compression);
+#endif /* HAVE_LIBZ */
+
+    if (!Cancel && status == HTTP_STATUS_CONTINUE && ippGetState(request) == IPP_DATA && data->file[0])
+    {
+      if ((reqfile = cupsFileOpen(data->file, "r")) != NULL)
+      {
+	while (!Cancel && (bytes = cupsFileRead(reqfile, buffer, sizeof(buffer))) > 0)
+	{
+	  if ((status = cupsWriteRequestData(http, buffer, (size_t)bytes)) != HTTP_STATUS_CONTINUE)
+	    break;
+
+	  sent += (size_t)bytes;
+	}
+
+	cupsFileClose(reqfile);
+      }
+      else
+      {
+	snprintf(buffer, sizeof(buffer), "%s: %s", data->file, strerror(errno));
+	_cupsSetError(IPP_INTERNAL_ERROR, buffer, 0);
+
+	status = HTTP_STATUS_ERROR;
+      }
+    }
+
+   /*
+    * Get the server's response...
+    */
+
+    if (!Cancel && status != HTTP_STATUS_ERROR)
+    {
+     /*
+      * Finish a chunked request ourselves so that the send and first byte
+      * times don't include the server's processing time...
+      */
+
+      if (http->data_encoding == HTTP_ENCODING_CHUNKED)
+	httpWrite2(http, "", 0);
+
+      send_time = get_time() - start;
+
+      httpWait(http, data->timeout > 0.0 ? (int)(data->timeout * 1000.0) : 60000);
+      first_time = get_time() - start;
+
+      response = cupsGetResponse(http, data->resource);
+      status   = httpGetStatus(http);
+    }
+
+    if (!Cancel && status == HTTP_STATUS_ERROR && httpError(http) != EINVAL &&
+#ifdef _WIN32
+	httpError(http) != WSAETIMEDOUT)
+#else
+	httpError(http) != ETIMEDOUT)
+#endif /* _WIN32 */
+    {
+      if (httpReconnect2(http, 30000, NULL))
+	exchange->pass = 0;
+    }
+    else if (status == HTTP_STATUS_ERROR || status == HTTP_STATUS_CUPS_AUTHORIZATION_CANCELED)
+    {
+      exchange->pass = 0;
+      break;
+    }
+    else if (status != HTTP_STATUS_OK)
+    {
+      httpFlush(http);
+
+      if (status == HTTP_STATUS_UNAUTHORIZED)
+	continue;
+
+      break;
+    }
+  }
+
+  if (!Cancel && status == HTTP_STATUS_ERROR && httpError(http) != EINVAL &&
+#ifdef _WIN32
+      httpError(http) != WSAETIMEDOUT)
+#else
+      httpError(http) != ETIMEDOUT)
+#endif /* _WIN32 */
+  {
+    if (httpReconnect2(http, 30000, NULL))
+      exchange->pass = 0;
+  }
+  else if (status == HTTP_STATUS_ERROR)
+  {
+    if (!Cancel)
+      httpReconnect2(http, 30000, NULL);
+
+    exchange->pass = 0;
+  }
+  else if (status != HTTP_STATUS_OK)
+  {
+    httpFlush(http);
+    exchange->pass = 0;
+  }
+
+ /*
+  * Save the results so they can be checked later, possibly by another
+  * thread...
+  */
+
+  exchange->response   = response;
+  exchange->status     = status;
+  exchange->version    = httpGetVersion(http);
+  exchange->ipp_status = cupsLastError();
+  exchange->send_time  = send_time;
+  exchange->first_time = first_time;
+  exchange->total_time = get_time() - start;
+
+  exchange->bytes_sent     = sent;
+  exchange->bytes_received = response ? ippLength(response) : 0;
+
+  if ((message = cupsLastErrorString()) != NULL)
+    strlcpy(exchange->message, message, sizeof(exchange->message));
+  else
+    exchange->message[0] = '\0';
+}
+
+
 #ifndef _WIN32
 /*
  * 'sigterm_handler()' - Handle SIGINT and SIGTERM.
@@ -2976,6 +4373,104 @@ sigterm_handler(int sig)		/* I - Signal number (unused) */
 #endif /* !_WIN32 */
 
 
+/*
+ * 'start_pipeline()' - Open the pipeline connections.
+ */
+
+static int				/* O - 1 on success, 0 on failure */
+start_pipeline(_ipp_vars_t      *vars,	/* I - IPP variables */
+               _cups_testdata_t *data)	/* I - Test data */
+{
+  int		i;			/* Looping var */
+  _cups_pipeline_t *pipeline;		/* Pipeline */
+  _cups_worker_t *worker;		/* Current connection */
+
+
+  if ((pipeline = (_cups_pipeline_t *)calloc(1, sizeof(_cups_pipeline_t))) == NULL || (pipeline->workers = (_cups_worker_t *)calloc((size_t)data->parallel, sizeof(_cups_worker_t))) == NULL)
+  {
+    print_fatal_error(data, "Unable to allocate memory for %d connections.", data->parallel);
+    free(pipeline);
+    return (0);
+  }
+
+  pipeline->vars  = vars;
+  pipeline->tests = cupsArrayNew(NULL, NULL);
+
+  _cupsMutexInit(&pipeline->mutex);
+  _cupsCondInit(&pipeline->cond);
+
+  data->pipeline = pipeline;
+
+  for (i = 0, worker = pipeline->workers; i < data->parallel; i ++, worker ++)
+  {
+    worker->pipeline = pipeline;
+
+    if ((worker->http = connect_printer(vars, data)) == NULL)
+      break;
+
+    if ((worker->thread = _cupsThreadCreate((_cups_thread_func_t)pipeline_worker, worker)) == 0)
+    {
+      print_fatal_error(data, "Unable to start connection %d.", i + 1);
+      httpClose(worker->http);
+      worker->http = NULL;
+      break;
+    }
+
+    pipeline->num_workers ++;
+  }
+
+  if (i < data->parallel)
+  {
+    stop_pipeline(data);
+    return (0);
+  }
+
+  return (1);
+}
+
+
+/*
+ * 'stop_pipeline()' - Close the pipeline connections and free any tests that
+ *                     are still queued.
+ */
+
+static void
+stop_pipeline(_cups_testdata_t *data)	/* I - Test data */
+{
+  int		i;			/* Looping var */
+  _cups_pipeline_t *pipeline = data->pipeline;
+					/* Pipeline */
+  _cups_worker_t *worker;		/* Current connection */
+  _cups_pipetest_t *test;		/* Current test */
+
+
+  _cupsMutexLock(&pipeline->mutex);
+  pipeline->shutdown = 1;
+  _cupsCondBroadcast(&pipeline->cond);
+  _cupsMutexUnlock(&pipeline->mutex);
+
+  for (i = pipeline->num_workers, worker = pipeline->workers; i > 0; i --, worker ++)
+  {
+    _cupsThreadWait(worker->thread);
+    httpClose(worker->http);
+  }
+
+  for (test = (_cups_pipetest_t *)cupsArrayFirst(pipeline->tests); test; test = (_cups_pipetest_t *)cupsArrayNext(pipeline->tests))
+  {
+    free_test(&test->data);
+    ippDelete(test->exchange.request);
+    ippDelete(test->exchange.response);
+    free(test);
+  }
+
+  cupsArrayDelete(pipeline->tests);
+  free(pipeline->workers);
+  free(pipeline);
+
+  data->pipeline = NULL;
+}
+
+
 /*
  * 'timeout_cb()' - Handle HTTP timeouts.
  */
@@ -3077,7 +4572,10 @@ token_cb(_ipp_file_t      *f,		/* I - IPP file data */
 
     if (!strcmp(token, "}"))
     {
-      return (do_test(f, vars, data));
+      if (data->pipeline)
+        return (queue_test(f, vars, data));
+      else
+        return (do_test(f, vars, data));
     }
     else if (!strcmp(token, "COMPRESSION"))
     {
@@ -3816,7 +5314,7 @@ token_cb(_ipp_file_t      *f,		/* I - IPP file data */
 	     !_cups_strcasecmp(token, "WITH-SCHEME") ||
 	     !_cups_strcasecmp(token, "WITH-VALUE"))
     {
-      off_t	lastpos;		/* Last file position */
+      const char	*lastptr;	/* Last file position */
       int	lastline;		/* Last line number */
 
       if (data->last_expect)
@@ -3847,7 +5345,7 @@ token_cb(_ipp_file_t      *f,		/* I - IPP file data */
 
       for (;;)
       {
-        lastpos  = cupsFileTell(f->fp);
+        lastptr  = f->bufptr;
         lastline = f->linenum;
         ptr      += strlen(ptr);
 
@@ -3871,7 +5369,7 @@ token_cb(_ipp_file_t      *f,		/* I - IPP file data */
           * Not another value, stop here...
           */
 
-          cupsFileSeek(f->fp, lastpos);
+          f->bufptr  = lastptr;
           f->linenum = lastline;
           *ptr = '\0';
           break;
@@ -3982,6 +5480,14 @@ token_cb(_ipp_file_t      *f,		/* I - IPP file data */
   }
   else
   {
+   /*
+    * Directives outside of a test can change variables or produce output, so
+    * check any pipelined tests first...
+    */
+
+    if (data->pipeline && strcmp(token, "{") && !flush_pipeline(vars, data, 0))
+      return (0);
+
    /*
     * Scan for the start of a test (open brace)...
     */
@@ -4334,9 +5840,16 @@ usage(void)
 {
   _cupsLangPuts(stderr, _("Usage: ipptool [options] URI filename [ ... filenameN ]"));
   _cupsLangPuts(stderr, _("Options:"));
+  _cupsLangPuts(stderr, _("--cache directory       Cache compiled test files in directory"));
+  _cupsLangPuts(stderr, _("--duration seconds      Stop load after the given number of seconds"));
   _cupsLangPuts(stderr, _("--ippserver filename    Produce ippserver attribute file"));
+  _cupsLangPuts(stderr, _("--load clients          Run the last file in a loop from concurrent clients"));
+  _cupsLangPuts(stderr, _("--open-loop             Start load runs on a fixed schedule"));
+  _cupsLangPuts(stderr, _("--parallel connections  Pipeline independent tests over parallel connections"));
+  _cupsLangPuts(stderr, _("--rate runs             Target load runs per second for each client"));
   _cupsLangPuts(stderr, _("--stop-after-include-error\n"
                           "                        Stop tests after a failed INCLUDE"));
+  _cupsLangPuts(stderr, _("--timing                Show timing statistics"));
   _cupsLangPuts(stderr, _("--version               Show version"));
   _cupsLangPuts(stderr, _("-4                      Connect using IPv4"));
   _cupsLangPuts(stderr, _("-6                      Connect using IPv6"));
@@ -4670,15 +6183,10 @@ with_value(_cups_testdata_t *data,	/* I - Test data */
 	  * Value is an extended, case-sensitive POSIX regular expression...
 	  */
 
-	  regex_t	re;		/* Regular expression */
-
-          if ((i = regcomp(&re, value, REG_EXTENDED | REG_NOSUB)) != 0)
-	  {
-            regerror(i, &re, temp, sizeof(temp));
+	  regex_t	*re;		/* Regular expression */
 
-	    print_fatal_error(data, "Unable to compile WITH-VALUE regular expression \"%s\" - %s", value, temp);
+          if ((re = get_regex(data, value)) == NULL)
 	    return (0);
-	  }
 
          /*
 	  * See if ALL of the values match the given regular expression.
@@ -4686,7 +6194,7 @@ with_value(_cups_testdata_t *data,	/* I - Test data */
 
 	  for (i = 0; i < count; i ++)
 	  {
-	    if (!regexec(&re, get_string(attr, i, flags, temp, sizeof(temp)),
+	    if (!regexec(re, get_string(attr, i, flags, temp, sizeof(temp)),
 	                 0, NULL, 0))
 	    {
 	      if (!matchbuf[0])
@@ -4705,7 +6213,6 @@ with_value(_cups_testdata_t *data,	/* I - Test data */
 	    }
 	  }
 
-	  regfree(&re);
 	}
 	else if (ippGetValueTag(attr) == IPP_TAG_URI && !(flags & (_CUPS_WITH_SCHEME | _CUPS_WITH_HOSTNAME | _CUPS_WITH_RESOURCE)))
 	{
@@ -4815,15 +6322,10 @@ with_value(_cups_testdata_t *data,	/* I - Test data */
 
 	  void		*adata;		/* Pointer to octetString data */
 	  int		adatalen;	/* Length of octetString */
-	  regex_t	re;		/* Regular expression */
+	  regex_t	*re;		/* Regular expression */
 
-          if ((i = regcomp(&re, value, REG_EXTENDED | REG_NOSUB)) != 0)
-	  {
-            regerror(i, &re, temp, sizeof(temp));
-
-	    print_fatal_error(data, "Unable to compile WITH-VALUE regular expression \"%s\" - %s", value, temp);
+          if ((re = get_regex(data, value)) == NULL)
 	    return (0);
-	  }
 
          /*
 	  * See if ALL of the values match the given regular expression.
@@ -4839,7 +6341,7 @@ with_value(_cups_testdata_t *data,	/* I - Test data */
             memcpy(temp, adata, (size_t)adatalen);
             temp[adatalen] = '\0';
 
-	    if (!regexec(&re, temp, 0, NULL, 0))
+	    if (!regexec(re, temp, 0, NULL, 0))
 	    {
 	      if (!matchbuf[0])
 		strlcpy(matchbuf, temp, matchlen);
@@ -4857,8 +6359,6 @@ with_value(_cups_testdata_t *data,	/* I - Test data */
 	    }
 	  }
 
-	  regfree(&re);
-
 	  if (!match && errors)
 	  {
 	    for (i = 0; i < count; i ++)
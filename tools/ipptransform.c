@@ -30,13 +30,24 @@ static inline fz_matrix make_matrix(float a, float b, float c, float d, float e,
 #endif /* HAVE_COREGRAPHICS */
 
 #include "dither.h"
+#ifdef __APPLE__
+#  include <sys/sysctl.h>
+#endif /* __APPLE__ */
+#ifndef _WIN32
+#  include <fcntl.h>
+#  include <sys/resource.h>
+#  include <sys/wait.h>
+#endif /* !_WIN32 */
 
 
 /*
  * Constants...
  */
 
+#define XFORM_CACHE_SIZE	1048576
 #define XFORM_MAX_RASTER	16777216
+#define XFORM_MAX_THREADS	64
+#define XFORM_MIN_BAND_HEIGHT	64
 
 #define XFORM_RED_MASK		0x000000ff
 #define XFORM_GREEN_MASK	0x0000ff00
@@ -97,6 +108,10 @@ struct xform_raster_s
   size_t		out_length;	/* Output buffer size */
   unsigned char		*out_buffer;	/* Output (bit) buffer */
   unsigned char		*comp_buffer;	/* Compression buffer */
+  unsigned char		*delta_buffer;	/* Delta row compression buffer */
+  unsigned char		*seed_buffer;	/* Seed row for delta row compression */
+  int			out_mode;	/* Current compression mode */
+  unsigned char		*blank_buffer;	/* Blank line for raster output */
 
   unsigned char		dither[64][64];	/* Dither array */
 
@@ -105,21 +120,74 @@ struct xform_raster_s
   void			(*end_page)(xform_raster_t *, unsigned, xform_write_cb_t, void *);
   void			(*start_job)(xform_raster_t *, xform_write_cb_t, void *);
   void			(*start_page)(xform_raster_t *, unsigned, xform_write_cb_t, void *);
+  void			(*write_blanks)(xform_raster_t *, unsigned, unsigned, xform_write_cb_t, void *);
   void			(*write_line)(xform_raster_t *, unsigned, const unsigned char *, xform_write_cb_t, void *);
 };
 
+typedef struct xform_stats_s		/**** Benchmark stage times ****/
+{
+  double		render,		/* Rendering bands */
+			convert,	/* Converting lines to the output color space */
+			dither,		/* Dithering lines to 1-bit */
+			compress,	/* Compressing lines */
+			write;		/* Writing output */
+  size_t		bytes;		/* Bytes of output */
+} xform_stats_t;
+
+#ifdef HAVE_MUPDF
+typedef struct xform_band_s		/**** Band rendering thread ****/
+{
+  _cups_mutex_t		mutex;		/* Mutex for state */
+  _cups_cond_t		cond;		/* Condition for state changes */
+  int			state;		/* Band state (XFORM_BAND_xxx) */
+  _cups_thread_t	thread;		/* Rendering thread */
+  fz_context		*context;	/* Cloned MuPDF context */
+  fz_pixmap		*pixmap;	/* Pixmap for band */
+  fz_device		*device;	/* Device for rendering */
+  fz_display_list	*list;		/* Display list for page */
+  fz_matrix		transform;	/* Transform for band */
+  unsigned		page,		/* Page number */
+			starty,		/* First line of band */
+			endy;		/* Last line of band + 1 */
+  int			first,		/* Start the page before writing? */
+			last,		/* End the page after writing? */
+			blank;		/* Is the band blank? */
+} xform_band_t;
+
+enum
+{
+  XFORM_BAND_IDLE,			/* Waiting for a band */
+  XFORM_BAND_RENDER,			/* Band needs to be rendered */
+  XFORM_BAND_DONE,			/* Band has been rendered */
+  XFORM_BAND_QUIT			/* Thread should exit */
+};
+#endif /* HAVE_MUPDF */
+
 
 /*
  * Local globals...
  */
 
 static int	Verbosity = 0;		/* Log level */
+static unsigned	BandHeight = 0;		/* Band height or 0 for adaptive */
+static unsigned	Threads = 1;		/* Number of rendering threads */
+static xform_stats_t *Stats = NULL;	/* Stage times for --benchmark */
+#ifdef HAVE_MUPDF
+static fz_context *XformContext = NULL;	/* Context loaded by xform_worker() */
+#  ifdef HAVE_FZ_CMM_ENGINE_LCMS
+static fz_colorspace *XformAdobeRGB = NULL;
+					/* AdobeRGB colorspace for XformContext */
+#  endif /* HAVE_FZ_CMM_ENGINE_LCMS */
+static _cups_mutex_t XformLocks[FZ_LOCK_MAX];
+					/* Locks for MuPDF contexts */
+#endif /* HAVE_MUPDF */
 
 
 /*
  * Local functions...
  */
 
+static unsigned char *dither_line(xform_raster_t *ras, unsigned y, const unsigned char *line, int black);
 #ifdef HAVE_MUPDF
 static void	invert_gray(unsigned char *row, size_t num_pixels);
 #endif /* HAVE_MUPDF */
@@ -129,23 +197,55 @@ static void	*monitor_ipp(const char *device_uri);
 static void	pack_rgba(unsigned char *row, size_t num_pixels);
 static void	pack_rgba16(unsigned char *row, size_t num_pixels);
 #endif /* HAVE_COREGRAPHICS */
+static size_t	pcl_compress_delta(const unsigned char *line, const unsigned char *seed, size_t length, unsigned char *comp);
+static size_t	pcl_compress_packbits(const unsigned char *line, size_t length, unsigned char *comp);
 static void	pcl_end_job(xform_raster_t *ras, xform_write_cb_t cb, void *ctx);
 static void	pcl_end_page(xform_raster_t *ras, unsigned page, xform_write_cb_t cb, void *ctx);
 static void	pcl_init(xform_raster_t *ras);
 static void	pcl_printf(xform_write_cb_t cb, void *ctx, const char *format, ...) _CUPS_FORMAT(3, 4);
 static void	pcl_start_job(xform_raster_t *ras, xform_write_cb_t cb, void *ctx);
 static void	pcl_start_page(xform_raster_t *ras, unsigned page, xform_write_cb_t cb, void *ctx);
+static void	pcl_write_blanks(xform_raster_t *ras, unsigned y, unsigned count, xform_write_cb_t cb, void *ctx);
 static void	pcl_write_line(xform_raster_t *ras, unsigned y, const unsigned char *line, xform_write_cb_t cb, void *ctx);
 static void	raster_end_job(xform_raster_t *ras, xform_write_cb_t cb, void *ctx);
 static void	raster_end_page(xform_raster_t *ras, unsigned page, xform_write_cb_t cb, void *ctx);
 static void	raster_init(xform_raster_t *ras);
 static void	raster_start_job(xform_raster_t *ras, xform_write_cb_t cb, void *ctx);
 static void	raster_start_page(xform_raster_t *ras, unsigned page, xform_write_cb_t cb, void *ctx);
+static void	raster_write_blanks(xform_raster_t *ras, unsigned y, unsigned count, xform_write_cb_t cb, void *ctx);
 static void	raster_write_line(xform_raster_t *ras, unsigned y, const unsigned char *line, xform_write_cb_t cb, void *ctx);
 static void	usage(int status) _CUPS_NORETURN;
+static ssize_t	write_bench(void *ctx, const unsigned char *buffer, size_t bytes);
 static ssize_t	write_fd(int *fd, const unsigned char *buffer, size_t bytes);
+static ssize_t	write_null(void *ctx, const unsigned char *buffer, size_t bytes);
+#ifdef HAVE_FZ_CMM_ENGINE_LCMS
+static fz_colorspace *xform_adobe_rgb(fz_context *context);
+#endif /* HAVE_FZ_CMM_ENGINE_LCMS */
+#ifdef HAVE_MUPDF
+static void	*xform_band_thread(xform_band_t *band);
+static void	xform_band_write(xform_raster_t *ras, fz_context *context, xform_band_t *band, size_t band_size, unsigned *impressions, unsigned *media_sheets, xform_write_cb_t cb, void *ctx);
+#endif /* HAVE_MUPDF */
+static unsigned	xform_band_height(xform_raster_t *ras, size_t band_size, unsigned num_threads);
+static int	xform_benchmark(const char *outformat, const char *resolutions, const char *sheet_back, const char *types, int num_options, cups_option_t *options);
+static int	xform_benchmark_run(const char *outformat, const char *resolution, const char *type, const char *content, const char *sheet_back, int num_options, cups_option_t *options);
+static size_t	xform_cache_size(void);
+#ifdef HAVE_MUPDF
+static fz_rect	xform_content_box(fz_context *context, fz_page *page, fz_display_list *list);
+#endif /* HAVE_MUPDF */
 int	xform_document(const char *filename, const char *informat, const char *outformat, const char *resolutions, const char *sheet_back, const char *types, int num_options, cups_option_t *options, xform_write_cb_t cb, struct renderer renderer, void *ctx);
+#ifdef HAVE_MUPDF
+static int	xform_is_blank(const unsigned char *buffer, size_t length, unsigned char white);
+static int	xform_is_outside(fz_rect content, fz_matrix transform, unsigned width, unsigned height);
+static void	xform_lock(void *user, int lock);
+#endif /* HAVE_MUPDF */
 static int	xform_setup(xform_raster_t *ras, const char *outformat, const char *resolutions, const char *types, const char *sheet_back, int color, unsigned pages, int num_options, cups_option_t *options);
+static double	xform_time(void);
+#ifdef HAVE_MUPDF
+static void	xform_unlock(void *user, int lock);
+#endif /* HAVE_MUPDF */
+#ifndef _WIN32
+static int	xform_worker(const char *command);
+#endif /* !_WIN32 */
 
 
 /*
@@ -174,9 +274,21 @@ main(int  argc,				/* I - Number of command-line args */
   xform_write_cb_t write_cb = (xform_write_cb_t)write_fd;
 					/* Write callback */
   int		status = 0;		/* Exit status */
+  int		benchmark = 0;		/* Benchmark band heights? */
   _cups_thread_t monitor = 0;		/* Monitoring thread ID */
 
 
+#ifndef _WIN32
+  if (argc == 2 && !strcmp(argv[1], "--worker"))
+  {
+   /*
+    * Run jobs for ippserver...
+    */
+
+    return (xform_worker(argv[0]));
+  }
+#endif /* !_WIN32 */
+
  /*
   * Process the command-line...
   */
@@ -197,11 +309,29 @@ main(int  argc,				/* I - Number of command-line args */
       Verbosity = 1;
   }
 
+  if ((opt = getenv("IPPTRANSFORM_BAND_HEIGHT")) != NULL && atoi(opt) > 0)
+    BandHeight = (unsigned)atoi(opt);
+
   for (i = 1; i < argc; i ++)
   {
     if (!strncmp(argv[i], "--", 2))
     {
-      if (!strcmp(argv[i], "--help"))
+      if (!strcmp(argv[i], "--band-height"))
+      {
+        i ++;
+        if (i >= argc || atoi(argv[i]) < 1)
+        {
+          fputs("ERROR: Missing or bad number of lines after '--band-height'.\n", stderr);
+          usage(1);
+        }
+
+        BandHeight = (unsigned)atoi(argv[i]);
+      }
+      else if (!strcmp(argv[i], "--benchmark"))
+      {
+        benchmark = 1;
+      }
+      else if (!strcmp(argv[i], "--help"))
       {
         usage(0);
       }
@@ -329,6 +459,16 @@ main(int  argc,				/* I - Number of command-line args */
     }
   }
 
+  if (benchmark)
+  {
+   /*
+    * Time the raster conversion for each output format, type, and
+    * resolution...
+    */
+
+    return (xform_benchmark(output_type, resolutions, sheet_back ? sheet_back : "normal", types, num_options, options));
+  }
+
  /*
   * Check that we have everything we need...
   */
@@ -590,6 +730,70 @@ main(int  argc,				/* I - Number of command-line args */
 }
 
 
+/*
+ * 'dither_line()' - Dither a line of 8-bit grayscale pixels to 1-bit.
+ *
+ * Pixels are thresholded 8 at a time to form each output byte.  When "black"
+ * is non-zero a set bit means black, otherwise a set bit means white.
+ */
+
+static unsigned char *			/* O - End of output buffer */
+dither_line(xform_raster_t      *ras,	/* I - Raster information */
+            unsigned            y,	/* I - Line number */
+            const unsigned char *line,	/* I - Pixels on line */
+            int                 black)	/* I - 1 if set bits are black */
+{
+  unsigned		x;		/* Column number */
+  unsigned char		dither[128],	/* Two copies of the dither row */
+			invert,		/* Bits to invert */
+			byte,		/* Current byte */
+			bit,		/* Current bit */
+			*outptr;	/* Pointer into output buffer */
+  const unsigned char	*d;		/* Dither values for current byte */
+  double		start = Stats ? xform_time() : 0.0;
+					/* Start time for benchmark */
+
+
+ /*
+  * Repeat the dither row so that 8 consecutive values can always be read
+  * without wrapping...
+  */
+
+  y &= 63;
+  memcpy(dither, ras->dither[y], 64);
+  memcpy(dither + 64, ras->dither[y], 64);
+
+  invert = black ? 255 : 0;
+
+  for (x = ras->left, outptr = ras->out_buffer; (x + 8) <= ras->right; x += 8, line += 8)
+  {
+    d = dither + (x & 63);
+
+    *outptr++ = (unsigned char)(invert ^ (((line[0] > d[0]) << 7) | ((line[1] > d[1]) << 6) | ((line[2] > d[2]) << 5) | ((line[3] > d[3]) << 4) | ((line[4] > d[4]) << 3) | ((line[5] > d[5]) << 2) | ((line[6] > d[6]) << 1) | (line[7] > d[7])));
+  }
+
+  if (x < ras->right)
+  {
+   /*
+    * Dither the remaining pixels...
+    */
+
+    for (bit = 128, byte = 0, d = dither + (x & 63); x < ras->right; x ++, line ++, d ++, bit >>= 1)
+    {
+      if ((*line > *d) != black)
+        byte |= bit;
+    }
+
+    *outptr++ = byte;
+  }
+
+  if (Stats)
+    Stats->dither += xform_time() - start;
+
+  return (outptr);
+}
+
+
 /*
  * 'invert_gray()' - Invert grayscale to black.
  */
@@ -881,6 +1085,153 @@ pack_rgba16(unsigned char *row,		/* I - Row of pixels to pack */
 #endif /* HAVE_COREGRAPHICS */
 
 
+/*
+ * 'pcl_compress_delta()' - Compress a line using delta row (mode 3)
+ *                          compression.
+ *
+ * Each command replaces up to 8 bytes of the seed row, so a line that matches
+ * the seed row compresses to nothing.  The compression buffer must hold at
+ * least "2 * length + 2" bytes.
+ */
+
+static size_t				/* O - Length of compressed data */
+pcl_compress_delta(
+    const unsigned char *line,		/* I - Line to compress */
+    const unsigned char *seed,		/* I - Seed (previous) row */
+    size_t              length,		/* I - Length of line */
+    unsigned char       *comp)		/* I - Compression buffer */
+{
+  size_t	i,			/* Current byte */
+		start,			/* Start of changed bytes */
+		last = 0,		/* End of last replaced bytes */
+		offset;			/* Offset from last replaced bytes */
+  unsigned char	*compptr = comp;	/* Pointer into compression buffer */
+
+
+  for (i = 0; i < length;)
+  {
+    if (line[i] == seed[i])
+    {
+      i ++;
+      continue;
+    }
+
+   /*
+    * Replace up to 8 changed bytes...
+    */
+
+    for (start = i; i < length && (i - start) < 8 && line[i] != seed[i]; i ++);
+
+    offset = start - last;
+
+    if (offset < 31)
+    {
+      *compptr++ = (unsigned char)(((i - start - 1) << 5) | offset);
+    }
+    else
+    {
+     /*
+      * Offsets of 31 or more continue in the following bytes...
+      */
+
+      *compptr++ = (unsigned char)(((i - start - 1) << 5) | 31);
+
+      for (offset -= 31; offset >= 255; offset -= 255)
+        *compptr++ = 255;
+
+      *compptr++ = (unsigned char)offset;
+    }
+
+    memcpy(compptr, line + start, i - start);
+    compptr += i - start;
+    last    = i;
+  }
+
+  return ((size_t)(compptr - comp));
+}
+
+
+/*
+ * 'pcl_compress_packbits()' - Compress a line using PackBits (mode 2)
+ *                             compression.
+ *
+ * The compression buffer must hold at least "2 * length + 2" bytes.
+ */
+
+static size_t				/* O - Length of compressed data */
+pcl_compress_packbits(
+    const unsigned char *line,		/* I - Line to compress */
+    size_t              length,		/* I - Length of line */
+    unsigned char       *comp)		/* I - Compression buffer */
+{
+  const unsigned char	*lineptr = line,/* Pointer into line */
+			*lineend = line + length,
+					/* End of line */
+			*start;		/* Start of sequence */
+  unsigned char		*compptr = comp;/* Pointer into compression buffer */
+  unsigned		count;		/* Count of bytes for output */
+
+
+  while (lineptr < lineend)
+  {
+    if ((lineptr + 1) >= lineend)
+    {
+     /*
+      * Single byte on the end...
+      */
+
+      *compptr++ = 0x00;
+      *compptr++ = *lineptr++;
+    }
+    else if (lineptr[0] == lineptr[1])
+    {
+     /*
+      * Repeated sequence...
+      */
+
+      lineptr ++;
+      count = 2;
+
+      while (lineptr < (lineend - 1) &&
+	     lineptr[0] == lineptr[1] &&
+	     count < 127)
+      {
+	lineptr ++;
+	count ++;
+      }
+
+      *compptr++ = (unsigned char)(257 - count);
+      *compptr++ = *lineptr++;
+    }
+    else
+    {
+     /*
+      * Non-repeated sequence...
+      */
+
+      start = lineptr;
+      lineptr ++;
+      count = 1;
+
+      while (lineptr < (lineend - 1) &&
+	     lineptr[0] != lineptr[1] &&
+	     count < 127)
+      {
+	lineptr ++;
+	count ++;
+      }
+
+      *compptr++ = (unsigned char)(count - 1);
+
+      memcpy(compptr, start, count);
+      compptr += count;
+    }
+  }
+
+  return ((size_t)(compptr - comp));
+}
+
+
 /*
  * 'pcl_end_job()' - End a PCL "job".
  */
@@ -924,11 +1275,20 @@ pcl_end_page(xform_raster_t   *ras,	/* I - Raster information */
     (*cb)(ctx, (const unsigned char *)"\014", 1);
 
  /*
-  * Free the output buffer...
+  * Free the output and compression buffers...
   */
 
   free(ras->out_buffer);
   ras->out_buffer = NULL;
+
+  free(ras->comp_buffer);
+  ras->comp_buffer = NULL;
+
+  free(ras->delta_buffer);
+  ras->delta_buffer = NULL;
+
+  free(ras->seed_buffer);
+  ras->seed_buffer = NULL;
 }
 
 
@@ -939,11 +1299,12 @@ pcl_end_page(xform_raster_t   *ras,	/* I - Raster information */
 static void
 pcl_init(xform_raster_t *ras)		/* I - Raster information */
 {
-  ras->end_job    = pcl_end_job;
-  ras->end_page   = pcl_end_page;
-  ras->start_job  = pcl_start_job;
-  ras->start_page = pcl_start_page;
-  ras->write_line = pcl_write_line;
+  ras->end_job      = pcl_end_job;
+  ras->end_page     = pcl_end_page;
+  ras->start_job    = pcl_start_job;
+  ras->start_page   = pcl_start_page;
+  ras->write_blanks = pcl_write_blanks;
+  ras->write_line   = pcl_write_line;
 }
 
 
@@ -1114,18 +1475,45 @@ pcl_start_page(xform_raster_t   *ras,	/* I - Raster information */
   pcl_printf(cb, ctx, "\033*r1A");	/* Start graphics */
 
  /*
-  * Allocate the output buffer...
+  * Allocate the output buffers - the seed row starts out blank...
   */
 
-  ras->out_blanks  = 0;
-  ras->out_length  = (ras->right - ras->left + 7) / 8;
-  ras->out_buffer  = malloc(ras->out_length);
-  ras->comp_buffer = malloc(2 * ras->out_length + 2);
+  ras->out_blanks   = 0;
+  ras->out_mode     = 2;
+  ras->out_length   = (ras->right - ras->left + 7) / 8;
+  ras->out_buffer   = malloc(ras->out_length);
+  ras->comp_buffer  = malloc(2 * ras->out_length + 2);
+  ras->delta_buffer = malloc(2 * ras->out_length + 2);
+  ras->seed_buffer  = calloc(1, ras->out_length);
+}
+
+
+/*
+ * 'pcl_write_blanks()' - Skip blank lines of raster data.
+ */
+
+static void
+pcl_write_blanks(
+    xform_raster_t   *ras,		/* I - Raster information */
+    unsigned         y,			/* I - First line number */
+    unsigned         count,		/* I - Number of lines */
+    xform_write_cb_t cb,		/* I - Write callback */
+    void             *ctx)		/* I - Write context */
+{
+  (void)y;
+  (void)cb;
+  (void)ctx;
+
+  ras->out_blanks += count;
 }
 
 
 /*
  * 'pcl_write_line()' - Write a line of raster data.
+ *
+ * Each line is sent using PackBits (mode 2) or delta row (mode 3)
+ * compression, whichever is smaller including the cost of switching modes.
+ * Lines without any dots are skipped, which also clears the seed row.
  */
 
 static void
@@ -1136,15 +1524,13 @@ pcl_write_line(
     xform_write_cb_t    cb,		/* I - Write callback */
     void                *ctx)		/* I - Write context */
 {
-  unsigned	x;			/* Column number */
-  unsigned char	bit,			/* Current bit */
-		byte,			/* Current byte */
-		*outptr,		/* Pointer into output buffer */
-		*outend,		/* End of output buffer */
-		*start,			/* Start of sequence */
-		*compptr;		/* Pointer into compression buffer */
-  unsigned	count;			/* Count of bytes for output */
-  const unsigned char	*ditherline;	/* Pointer into dither table */
+  unsigned char	*outend,		/* End of output buffer */
+		*comp;			/* Compressed data to send */
+  size_t	length,			/* Length of dithered line */
+		pack_length,		/* Length of PackBits data */
+		delta_length;		/* Length of delta row data */
+  int		mode;			/* Compression mode for line */
+  double	comptime;		/* Start time for benchmark */
 
 
   if (line[0] == 255 && !memcmp(line, line + 1, ras->right - ras->left - 1))
@@ -1161,107 +1547,74 @@ pcl_write_line(
   * Dither the line into the output buffer...
   */
 
-  y &= 63;
-  ditherline = ras->dither[y];
+  outend = dither_line(ras, y, line, 1);
+  length = (size_t)(outend - ras->out_buffer);
 
-  for (x = ras->left, bit = 128, byte = 0, outptr = ras->out_buffer; x < ras->right; x ++, line ++)
+  if (!ras->out_buffer[0] && (length < 2 || !memcmp(ras->out_buffer, ras->out_buffer + 1, length - 1)))
   {
-    if (*line <= ditherline[x & 63])
-      byte |= bit;
+   /*
+    * Skip line that is too light to get any dots...
+    */
 
-    if (bit == 1)
-    {
-      *outptr++ = byte;
-      byte      = 0;
-      bit       = 128;
-    }
-    else
-      bit >>= 1;
+    ras->out_blanks ++;
+    return;
   }
 
-  if (bit != 128)
-    *outptr++ = byte;
-
- /*
-  * Apply compression...
-  */
-
-  compptr = ras->comp_buffer;
-  outend  = outptr;
-  outptr  = ras->out_buffer;
-
-  while (outptr < outend)
+  if (ras->out_blanks > 0)
   {
-    if ((outptr + 1) >= outend)
-    {
-     /*
-      * Single byte on the end...
-      */
+   /*
+    * Skip blank lines first, which also zeroes the seed row...
+    */
 
-      *compptr++ = 0x00;
-      *compptr++ = *outptr++;
-    }
-    else if (outptr[0] == outptr[1])
-    {
-     /*
-      * Repeated sequence...
-      */
+    pcl_printf(cb, ctx, "\033*b%dY", ras->out_blanks);
+    ras->out_blanks = 0;
 
-      outptr ++;
-      count = 2;
+    memset(ras->seed_buffer, 0, ras->out_length);
+  }
 
-      while (outptr < (outend - 1) &&
-	     outptr[0] == outptr[1] &&
-	     count < 127)
-      {
-	outptr ++;
-	count ++;
-      }
+ /*
+  * Apply compression...
+  */
 
-      *compptr++ = (unsigned char)(257 - count);
-      *compptr++ = *outptr++;
-    }
-    else
-    {
-     /*
-      * Non-repeated sequence...
-      */
+  comptime     = Stats ? xform_time() : 0.0;
+  pack_length  = pcl_compress_packbits(ras->out_buffer, length, ras->comp_buffer);
+  delta_length = pcl_compress_delta(ras->out_buffer, ras->seed_buffer, length, ras->delta_buffer);
 
-      start = outptr;
-      outptr ++;
-      count = 1;
+ /*
+  * Changing modes costs 5 bytes ("<ESC>*b#M")...
+  */
 
-      while (outptr < (outend - 1) &&
-	     outptr[0] != outptr[1] &&
-	     count < 127)
-      {
-	outptr ++;
-	count ++;
-      }
+  if ((delta_length + (ras->out_mode == 3 ? 0 : 5)) < (pack_length + (ras->out_mode == 2 ? 0 : 5)))
+  {
+    mode   = 3;
+    comp   = ras->delta_buffer;
+    length = delta_length;
+  }
+  else
+  {
+    mode   = 2;
+    comp   = ras->comp_buffer;
+    length = pack_length;
+  }
 
-      *compptr++ = (unsigned char)(count - 1);
+  memcpy(ras->seed_buffer, ras->out_buffer, ras->out_length);
 
-      memcpy(compptr, start, count);
-      compptr += count;
-    }
-  }
+  if (Stats)
+    Stats->compress += xform_time() - comptime;
 
  /*
   * Output the line...
   */
 
-  if (ras->out_blanks > 0)
+  if (mode != ras->out_mode)
   {
-   /*
-    * Skip blank lines first...
-    */
-
-    pcl_printf(cb, ctx, "\033*b%dY", ras->out_blanks);
-    ras->out_blanks = 0;
+    pcl_printf(cb, ctx, "\033*b%dM", mode);
+    ras->out_mode = mode;
   }
 
-  pcl_printf(cb, ctx, "\033*b%dW", (int)(compptr - ras->comp_buffer));
-  (*cb)(ctx, ras->comp_buffer, (size_t)(compptr - ras->comp_buffer));
+  pcl_printf(cb, ctx, "\033*b%dW", (int)length);
+  if (length > 0)
+    (*cb)(ctx, comp, length);
 }
 
 
@@ -1278,6 +1631,9 @@ raster_end_job(xform_raster_t   *ras,	/* I - Raster information */
   (void)ctx;
 
   cupsRasterClose(ras->ras);
+
+  free(ras->blank_buffer);
+  ras->blank_buffer = NULL;
 }
 
 
@@ -1310,11 +1666,12 @@ raster_end_page(xform_raster_t   *ras,	/* I - Raster information */
 static void
 raster_init(xform_raster_t *ras)	/* I - Raster information */
 {
-  ras->end_job    = raster_end_job;
-  ras->end_page   = raster_end_page;
-  ras->start_job  = raster_start_job;
-  ras->start_page = raster_start_page;
-  ras->write_line = raster_write_line;
+  ras->end_job      = raster_end_job;
+  ras->end_page     = raster_end_page;
+  ras->start_job    = raster_start_job;
+  ras->start_page   = raster_start_page;
+  ras->write_blanks = raster_write_blanks;
+  ras->write_line   = raster_write_line;
 }
 
 
@@ -1363,77 +1720,98 @@ raster_start_page(xform_raster_t   *ras,/* I - Raster information */
 
 
 /*
- * 'raster_write_line()' - Write a line of raster data.
+ * 'raster_write_blanks()' - Write blank lines of raster data.
+ *
+ * The raster stream compresses repeated lines, so blank lines cost little
+ * more than their line counts.
  */
 
 static void
-raster_write_line(
-    xform_raster_t      *ras,		/* I - Raster information */
-    unsigned            y,		/* I - Line number */
-    const unsigned char *line,		/* I - Pixels on line */
-    xform_write_cb_t    cb,		/* I - Write callback */
-    void                *ctx)		/* I - Write context */
+raster_write_blanks(
+    xform_raster_t   *ras,		/* I - Raster information */
+    unsigned         y,			/* I - First line number */
+    unsigned         count,		/* I - Number of lines */
+    xform_write_cb_t cb,		/* I - Write callback */
+    void             *ctx)		/* I - Write context */
 {
+  double	start = 0.0,		/* Start time for benchmark */
+		written = 0.0;		/* Write time before lines */
+
+
+  (void)y;
   (void)cb;
   (void)ctx;
 
-  if (ras->header.cupsBitsPerPixel == 1)
+  if (!ras->blank_buffer)
   {
    /*
-    * Dither the line into the output buffer...
+    * White is 0 for black and CMYK output and 255 for everything else...
     */
 
-    unsigned		x;		/* Column number */
-    unsigned char	bit,		/* Current bit */
-			byte,		/* Current byte */
-			*outptr;	/* Pointer into output buffer */
-    const unsigned char	*ditherline;	/* Pointer into dither table */
+    if ((ras->blank_buffer = malloc(ras->header.cupsBytesPerLine)) == NULL)
+      return;
 
-    y &= 63;
-    ditherline = ras->dither[y];
+    memset(ras->blank_buffer, (ras->header.cupsColorSpace == CUPS_CSPACE_K || ras->header.cupsColorSpace == CUPS_CSPACE_CMYK) ? 0 : 255, ras->header.cupsBytesPerLine);
+  }
 
-    if (ras->header.cupsColorSpace == CUPS_CSPACE_SW)
-    {
-      for (x = ras->left, bit = 128, byte = 0, outptr = ras->out_buffer; x < ras->right; x ++, line ++)
-      {
-	if (*line > ditherline[x & 63])
-	  byte |= bit;
+  if (Stats)
+  {
+    start = xform_time();
+    written = Stats->write;
+  }
 
-	if (bit == 1)
-	{
-	  *outptr++ = byte;
-	  byte      = 0;
-	  bit       = 128;
-	}
-	else
-	  bit >>= 1;
-      }
-    }
-    else
-    {
-      for (x = ras->left, bit = 128, byte = 0, outptr = ras->out_buffer; x < ras->right; x ++, line ++)
-      {
-	if (*line <= ditherline[x & 63])
-	  byte |= bit;
+  for (; count > 0; count --)
+    cupsRasterWritePixels(ras->ras, ras->blank_buffer, ras->header.cupsBytesPerLine);
 
-	if (bit == 1)
-	{
-	  *outptr++ = byte;
-	  byte      = 0;
-	  bit       = 128;
-	}
-	else
-	  bit >>= 1;
-      }
-    }
+  if (Stats)
+    Stats->compress += xform_time() - start - (Stats->write - written);
+}
+
+
+/*
+ * 'raster_write_line()' - Write a line of raster data.
+ */
+
+static void
+raster_write_line(
+    xform_raster_t      *ras,		/* I - Raster information */
+    unsigned            y,		/* I - Line number */
+    const unsigned char *line,		/* I - Pixels on line */
+    xform_write_cb_t    cb,		/* I - Write callback */
+    void                *ctx)		/* I - Write context */
+{
+  double	start = 0.0,		/* Start time for benchmark */
+		written = 0.0;		/* Write time before line */
+
+
+  (void)cb;
+  (void)ctx;
 
-    if (bit != 128)
-      *outptr++ = byte;
+  if (ras->header.cupsBitsPerPixel == 1)
+  {
+   /*
+    * Dither the line into the output buffer...
+    */
 
-    cupsRasterWritePixels(ras->ras, ras->out_buffer, ras->header.cupsBytesPerLine);
+    dither_line(ras, y, line, ras->header.cupsColorSpace != CUPS_CSPACE_SW);
+    line = ras->out_buffer;
   }
-  else
-    cupsRasterWritePixels(ras->ras, (unsigned char *)line, ras->header.cupsBytesPerLine);
+
+ /*
+  * Compress and write the line, leaving the (nested) write time out of the
+  * compression time...
+  */
+
+  if (Stats)
+  {
+    start = xform_time();
+    written = Stats->write;
+  }
+
+  cupsRasterWritePixels(ras->ras, (unsigned char *)line, ras->header.cupsBytesPerLine);
+
+  if (Stats)
+    Stats->compress += xform_time() - start - (Stats->write - written);
 }
 
 
@@ -1444,8 +1822,11 @@ raster_write_line(
 static void
 usage(int status)			/* I - Exit status */
 {
-  puts("Usage: ipptransform [options] filename\n");
+  puts("Usage: ipptransform [options] filename");
+  puts("       ipptransform --benchmark [options]\n");
   puts("Options:");
+  puts("  --band-height N");
+  puts("  --benchmark");
   puts("  --help");
   puts("  -d device-uri");
   puts("  -f output-filename");
@@ -1473,6 +1854,29 @@ usage(int status)			/* I - Exit status */
 }
 
 
+/*
+ * 'write_bench()' - Discard output while timing it for --benchmark.
+ */
+
+static ssize_t				/* O - Number of bytes "written" */
+write_bench(void                *ctx,	/* I - Stage times */
+            const unsigned char *buffer,/* I - Buffer (unused) */
+            size_t              bytes)	/* I - Number of bytes */
+{
+  xform_stats_t	*stats = (xform_stats_t *)ctx;
+					/* Stage times */
+  double	start = xform_time();	/* Start time */
+
+
+  write_null(NULL, buffer, bytes);
+
+  stats->bytes += bytes;
+  stats->write += xform_time() - start;
+
+  return ((ssize_t)bytes);
+}
+
+
 /*
  * 'write_fd()' - Write to a file/socket.
  */
@@ -1505,6 +1909,353 @@ write_fd(int                 *fd,	/* I - File descriptor */
 }
 
 
+/*
+ * 'write_null()' - Discard output.
+ */
+
+static ssize_t				/* O - Number of bytes "written" */
+write_null(void                *ctx,	/* I - Context (unused) */
+           const unsigned char *buffer,	/* I - Buffer (unused) */
+           size_t              bytes)	/* I - Number of bytes */
+{
+  (void)ctx;
+  (void)buffer;
+
+  return ((ssize_t)bytes);
+}
+
+
+
+/*
+ * 'xform_band_height()' - Choose the height of a band.
+ *
+ * Bands are sized to fit in the per-core cache so that the lines are still
+ * cached when they are converted and written, but are never larger than the
+ * raster memory limit.  The IPPTRANSFORM_BAND_HEIGHT environment variable or
+ * "--band-height" option sets a fixed band height instead.
+ */
+
+static unsigned				/* O - Band height in lines */
+xform_band_height(
+    xform_raster_t *ras,		/* I - Raster information */
+    size_t         band_size,		/* I - Size of band line */
+    unsigned       num_threads)		/* I - Number of rendering threads */
+{
+  size_t	max_raster;		/* Maximum raster memory to use */
+  const char	*max_raster_env;	/* IPPTRANSFORM_MAX_RASTER env var */
+  unsigned	band_height,		/* Band height */
+		max_height;		/* Maximum band height */
+
+
+  max_raster     = XFORM_MAX_RASTER;
+  max_raster_env = getenv("IPPTRANSFORM_MAX_RASTER");
+  if (max_raster_env && strtol(max_raster_env, NULL, 10) > 0)
+    max_raster = (size_t)strtol(max_raster_env, NULL, 10);
+
+  if (num_threads > 1)
+    max_raster /= num_threads;
+
+  if ((max_height = (unsigned)(max_raster / band_size)) < 1)
+    max_height = 1;
+
+  if ((band_height = BandHeight) == 0)
+  {
+    if ((band_height = (unsigned)(xform_cache_size() / band_size)) < XFORM_MIN_BAND_HEIGHT)
+      band_height = XFORM_MIN_BAND_HEIGHT;
+  }
+
+  if (band_height > max_height)
+    band_height = max_height;
+  if (band_height > ras->header.cupsHeight)
+    band_height = ras->header.cupsHeight;
+
+  return (band_height);
+}
+
+
+/*
+ * 'xform_benchmark()' - Time the conversion of synthetic pages.
+ *
+ * Each combination of output format, type, resolution, and content is timed
+ * and reported as CSV on the standard output so that results can be compared
+ * between hosts and releases.  Page content is synthesized in the band buffer
+ * since the document renderers are supplied by the application, and the
+ * output is discarded.
+ */
+
+static int				/* O - Exit status */
+xform_benchmark(
+    const char    *outformat,		/* I - Output format (MIME media type) or `NULL` for all */
+    const char    *resolutions,		/* I - Resolutions or `NULL` for defaults */
+    const char    *sheet_back,		/* I - Back side transform */
+    const char    *types,		/* I - Types or `NULL` for defaults */
+    int           num_options,		/* I - Number of options */
+    cups_option_t *options)		/* I - Options */
+{
+  int		status = 0;		/* Exit status */
+  cups_array_t	*formats,		/* Output formats */
+		*res_array,		/* Resolutions */
+		*type_array;		/* Types */
+  const char	*format,		/* Current output format */
+		*resolution,		/* Current resolution */
+		*type;			/* Current type */
+  unsigned	i;			/* Looping var */
+  static const char * const contents[] =/* Synthetic content */
+  {
+    "text",
+    "photo"
+  };
+
+
+  formats   = _cupsArrayNewStrings(outformat ? outformat : "image/pwg-raster,image/urf,application/vnd.hp-pcl", ',');
+  res_array = _cupsArrayNewStrings(resolutions ? resolutions : "300dpi,600dpi", ',');
+
+  puts("format,type,resolution,content,band-height,pages,pages-per-second,render-ms,convert-ms,dither-ms,compress-ms,write-ms,output-kb,peak-rss-kb");
+
+  for (format = (const char *)cupsArrayFirst(formats); format; format = (const char *)cupsArrayNext(formats))
+  {
+   /*
+    * PCL output is always dithered from 8-bit grayscale, while raster output
+    * covers the bi-level, grayscale, and color paths...
+    */
+
+    if (types)
+      type_array = _cupsArrayNewStrings(types, ',');
+    else if (!strcmp(format, "application/vnd.hp-pcl"))
+      type_array = _cupsArrayNewStrings("sgray_8", ',');
+    else
+      type_array = _cupsArrayNewStrings("black_1,sgray_8,srgb_8,cmyk_8", ',');
+
+    for (type = (const char *)cupsArrayFirst(type_array); type; type = (const char *)cupsArrayNext(type_array))
+    {
+      for (resolution = (const char *)cupsArrayFirst(res_array); resolution; resolution = (const char *)cupsArrayNext(res_array))
+      {
+        for (i = 0; i < (sizeof(contents) / sizeof(contents[0])); i ++)
+        {
+          if (xform_benchmark_run(format, resolution, type, contents[i], sheet_back, num_options, options))
+            status = 1;
+        }
+      }
+    }
+
+    cupsArrayDelete(type_array);
+  }
+
+  cupsArrayDelete(formats);
+  cupsArrayDelete(res_array);
+
+  return (status);
+}
+
+
+/*
+ * 'xform_benchmark_run()' - Time the conversion of one combination.
+ *
+ * "Text" content is mostly blank lines with short runs of black, which
+ * favors the blank line and run-length paths, while "photo" content is a
+ * continuous gradient with noise that defeats compression.
+ */
+
+static int				/* O - 0 on success, 1 on error */
+xform_benchmark_run(
+    const char    *outformat,		/* I - Output format (MIME media type) */
+    const char    *resolution,		/* I - Resolution */
+    const char    *type,		/* I - Type */
+    const char    *content,		/* I - Content ("text" or "photo") */
+    const char    *sheet_back,		/* I - Back side transform */
+    int           num_options,		/* I - Number of options */
+    cups_option_t *options)		/* I - Options */
+{
+  xform_raster_t	ras;		/* Raster info */
+  xform_stats_t		stats;		/* Stage times */
+  size_t		band_size;	/* Size of band line */
+  unsigned		page,		/* Current page */
+			pages = 5,	/* Number of pages per test */
+			y,		/* Current line */
+			band_starty = 0,/* Start line of band */
+			band_endy = 0;	/* End line of band */
+  unsigned char		*band,		/* Band buffer */
+			*lineptr;	/* Pointer to current line */
+  int			photo = !strcmp(content, "photo");
+					/* Photo content? */
+  unsigned		seed = 1;	/* Noise generator state */
+  double		start,		/* Start time */
+			stage,		/* Start time of stage */
+			elapsed;	/* Elapsed time */
+  long			peak_rss = 0;	/* Peak resident set size in kilobytes */
+#ifndef _WIN32
+  struct rusage		usage;		/* Resource usage */
+#endif /* !_WIN32 */
+
+
+  if (xform_setup(&ras, outformat, resolution, sheet_back, type, 1, pages, num_options, options))
+    return (1);
+
+ /*
+  * Use the same band layout as the renderers: 1 byte per pixel for gray,
+  * RGBX for 8-bit RGB, RGBX16 for 16-bit RGB, and CMYK...
+  */
+
+  if (ras.header.cupsBitsPerPixel <= 8)
+    ras.band_bpp = 1;
+#ifdef HAVE_COREGRAPHICS
+  else if (ras.header.cupsBitsPerPixel == 48)
+    ras.band_bpp = 8;
+  else
+    ras.band_bpp = 4;
+#else
+  else
+    ras.band_bpp = ras.header.cupsBitsPerPixel / 8;
+#endif /* HAVE_COREGRAPHICS */
+
+  band_size       = (size_t)ras.header.cupsWidth * ras.band_bpp;
+  ras.band_height = xform_band_height(&ras, band_size, 1);
+
+  if ((band = malloc(ras.band_height * band_size)) == NULL)
+  {
+    fprintf(stderr, "ERROR: Unable to allocate %u line band.\n", ras.band_height);
+    return (1);
+  }
+
+  memset(&stats, 0, sizeof(stats));
+  Stats = &stats;
+  start = xform_time();
+
+  (*(ras.start_job))(&ras, (xform_write_cb_t)write_bench, &stats);
+
+  for (page = 1; page <= pages; page ++)
+  {
+    (*(ras.start_page))(&ras, page, (xform_write_cb_t)write_bench, &stats);
+
+    for (y = ras.top, band_endy = 0; y < ras.bottom; y ++)
+    {
+      if (y >= band_endy)
+      {
+       /*
+	* "Render" the next band...
+	*/
+
+	unsigned	by;		/* Line in band */
+	size_t		x;		/* Column */
+	unsigned char	*ptr;		/* Pointer into line */
+
+	stage       = xform_time();
+	band_starty = y;
+	band_endy   = y + ras.band_height;
+	if (band_endy > ras.bottom)
+	  band_endy = ras.bottom;
+
+	if (photo)
+	{
+	  for (by = band_starty, ptr = band; by < band_endy; by ++)
+	  {
+	    for (x = 0; x < band_size; x ++)
+	    {
+	      seed   = seed * 1103515245 + 12345;
+	      *ptr++ = (unsigned char)(((x / ras.band_bpp) * 255 / ras.header.cupsWidth + by * 255 / ras.header.cupsHeight) / 2 + ((seed >> 16) & 15));
+	    }
+	  }
+	}
+	else
+	{
+	  memset(band, 255, (band_endy - band_starty) * band_size);
+
+	  for (by = band_starty; by < band_endy; by ++)
+	  {
+	    if ((by % 100) < 60)
+	    {
+	      ptr = band + (by - band_starty) * band_size;
+
+	      for (x = (by * 7) % 60; x < band_size; x += 60)
+		memset(ptr + x, 0, x + 12 < band_size ? 12 : band_size - x);
+	    }
+	  }
+	}
+
+	stats.render += xform_time() - stage;
+      }
+
+     /*
+      * Prepare and write a line...
+      */
+
+      lineptr = band + (y - band_starty) * band_size + ras.left * ras.band_bpp;
+      stage   = xform_time();
+
+#ifdef HAVE_COREGRAPHICS
+      if (ras.header.cupsBitsPerPixel == 24)
+	pack_rgba(lineptr, ras.right - ras.left);
+      else if (ras.header.cupsBitsPerPixel == 48)
+	pack_rgba16(lineptr, ras.right - ras.left);
+#elif defined(HAVE_MUPDF)
+      if (ras.header.cupsColorSpace == CUPS_CSPACE_K && ras.header.cupsBitsPerPixel >= 8)
+	invert_gray(lineptr, ras.right - ras.left);
+#endif /* HAVE_COREGRAPHICS */
+
+      stats.convert += xform_time() - stage;
+
+      (*(ras.write_line))(&ras, y, lineptr, (xform_write_cb_t)write_bench, &stats);
+    }
+
+    (*(ras.end_page))(&ras, page, (xform_write_cb_t)write_bench, &stats);
+  }
+
+  (*(ras.end_job))(&ras, (xform_write_cb_t)write_bench, &stats);
+
+  elapsed = xform_time() - start;
+  Stats   = NULL;
+
+  free(band);
+
+#ifndef _WIN32
+  if (!getrusage(RUSAGE_SELF, &usage))
+  {
+#  ifdef __APPLE__
+    peak_rss = usage.ru_maxrss / 1024;	/* Bytes on macOS */
+#  else
+    peak_rss = usage.ru_maxrss;		/* Kilobytes on Linux */
+#  endif /* __APPLE__ */
+  }
+#endif /* !_WIN32 */
+
+  printf("%s,%s,%s,%s,%u,%u,%.2f,%.3f,%.3f,%.3f,%.3f,%.3f,%.1f,%ld\n", outformat, type, resolution, content, ras.band_height, pages, pages / elapsed, 1000.0 * stats.render / pages, 1000.0 * stats.convert / pages, 1000.0 * stats.dither / pages, 1000.0 * stats.compress / pages, 1000.0 * stats.write / pages, stats.bytes / 1024.0 / pages, peak_rss);
+
+  return (0);
+}
+
+
+/*
+ * 'xform_cache_size()' - Get the size of the per-core cache.
+ */
+
+static size_t				/* O - Cache size in bytes */
+xform_cache_size(void)
+{
+  static size_t	cache_size = 0;		/* Cached value */
+
+
+  if (!cache_size)
+  {
+#ifdef __APPLE__
+    uint64_t	value = 0;		/* sysctl value */
+    size_t	length = sizeof(value);	/* Length of value */
+
+    if (!sysctlbyname("hw.l2cachesize", &value, &length, NULL, 0) && value > 0)
+      cache_size = (size_t)value;
+#elif defined(_SC_LEVEL2_CACHE_SIZE)
+    long	value;			/* sysconf value */
+
+    if ((value = sysconf(_SC_LEVEL2_CACHE_SIZE)) > 0)
+      cache_size = (size_t)value;
+#endif /* __APPLE__ */
+
+    if (!cache_size)
+      cache_size = XFORM_CACHE_SIZE;
+  }
+
+  return (cache_size);
+}
+
 
 #ifdef HAVE_COREGRAPHICS
 
@@ -1527,11 +2278,11 @@ xform_document(
     void             *ctx)		/* I - Write context */
 {
   CFURLRef		url;		/* CFURL object for PDF filename */
-  CGImageSourceRef	src;		/* Image reader */
+  CGImageSourceRef	src = NULL;	/* Image reader */
+  CFDictionaryRef	props;		/* Image properties */
+  CFNumberRef		number;		/* Image property value */
   CGImageRef		image = NULL;	/* Image */
   xform_raster_t	ras;		/* Raster info */
-  size_t		max_raster;	/* Maximum raster memory to use */
-  const char		*max_raster_env;/* IPPTRANSFORM_MAX_RASTER env var */
   size_t		bpc;		/* Bits per color */
   CGColorSpaceRef	cs;		/* Quartz color space */
   CGContextRef		context;	/* Quartz bitmap context */
@@ -1547,8 +2298,9 @@ xform_document(
   unsigned		first = 1,	/* First page of range */
 			last = 1;	/* Last page of range */
   const char		*print_scaling;	/* print-scaling option */
-  size_t		image_width,	/* Image width */
-			image_height;	/* Image height */
+  size_t		image_width = 0,/* Image width */
+			image_height = 0;/* Image height */
+  long			image_size;	/* Decoded image size */
   int			image_rotation;	/* Image rotation */
   double		image_xscale,	/* Image scaling */
 			image_yscale;
@@ -1556,7 +2308,7 @@ xform_document(
   unsigned		page;		/* Current page */
   unsigned		media_sheets = 0,
 			impressions = 0;/* Page/sheet counters */
-  void *renderingContext; /* instance of pdf renderer */
+  void *renderingContext = NULL; /* instance of pdf renderer */
 
  /*
   * Open the file...
@@ -1625,7 +2377,25 @@ xform_document(
       return (1);
     }
 
-    if ((image = CGImageSourceCreateImageAtIndex(src, 0, NULL)) == NULL)
+   /*
+    * Get the image dimensions without decoding the image - the image is
+    * decoded once the page size and resolution are known...
+    */
+
+    if ((props = CGImageSourceCopyPropertiesAtIndex(src, 0, NULL)) != NULL)
+    {
+      long	value;			/* Property value */
+
+      if ((number = (CFNumberRef)CFDictionaryGetValue(props, kCGImagePropertyPixelWidth)) != NULL && CFNumberGetValue(number, kCFNumberLongType, &value) && value > 0)
+        image_width = (size_t)value;
+
+      if ((number = (CFNumberRef)CFDictionaryGetValue(props, kCGImagePropertyPixelHeight)) != NULL && CFNumberGetValue(number, kCFNumberLongType, &value) && value > 0)
+        image_height = (size_t)value;
+
+      CFRelease(props);
+    }
+
+    if (!image_width || !image_height)
     {
       CFRelease(src);
       CFRelease(url);
@@ -1634,7 +2404,6 @@ xform_document(
       return (1);
     }
 
-    CFRelease(src);
     CFRelease(url);
 
     pages = 1;
@@ -1646,8 +2415,8 @@ xform_document(
 
   if (xform_setup(&ras, outformat, resolutions, sheet_back, types, color, pages, num_options, options))
   {
-    if (image)
-      CFRelease(image);
+    if (src)
+      CFRelease(src);
 
     return (1);
   }
@@ -1697,16 +2466,8 @@ xform_document(
     bpc          = 16;
   }
 
-  max_raster     = XFORM_MAX_RASTER;
-  max_raster_env = getenv("IPPTRANSFORM_MAX_RASTER");
-  if (max_raster_env && strtol(max_raster_env, NULL, 10) > 0)
-    max_raster = (size_t)strtol(max_raster_env, NULL, 10);
-
-  band_size = ras.header.cupsWidth * ras.band_bpp;
-  if ((ras.band_height = (unsigned)(max_raster / band_size)) < 1)
-    ras.band_height = 1;
-  else if (ras.band_height > ras.header.cupsHeight)
-    ras.band_height = ras.header.cupsHeight;
+  band_size       = ras.header.cupsWidth * ras.band_bpp;
+  ras.band_height = xform_band_height(&ras, band_size, 1);
 
   ras.band_buffer = malloc(ras.band_height * band_size);
   context         = CGBitmapContextCreate(ras.band_buffer, ras.header.cupsWidth, ras.band_height, bpc, band_size, cs, info);
@@ -1885,17 +2646,11 @@ xform_document(
 	* Duplex printing, add a blank back side image...
 	*/
 
-	unsigned	y;		/* Current line */
-
 	if (Verbosity > 1)
 	  fprintf(stderr, "DEBUG: Printing blank page %u for duplex.\n", pages + 1);
 
-	memset(ras.band_buffer, 255, ras.header.cupsBytesPerLine);
-
 	(*(ras.start_page))(&ras, page, cb, ctx);
-
-	for (y = ras.top; y < ras.bottom; y ++)
-	  (*(ras.write_line))(&ras, y, ras.band_buffer, cb, ctx);
+	(*(ras.write_blanks))(&ras, ras.top, ras.bottom - ras.top, cb, ctx);
 
 	(*(ras.end_page))(&ras, page, cb, ctx);
 
@@ -1916,9 +2671,6 @@ xform_document(
     * Render copies of the image...
     */
 
-    image_width  = CGImageGetWidth(image);
-    image_height = CGImageGetHeight(image);
-
     if ((image_height < image_width && ras.header.cupsWidth < ras.header.cupsHeight) ||
 	 (image_width < image_height && ras.header.cupsHeight < ras.header.cupsWidth))
     {
@@ -1995,6 +2747,58 @@ xform_document(
       transform = CGAffineTransformMake(image_xscale, 0, 0, image_yscale, 0.5 * (ras.header.cupsPageSize[0] - image_xscale * image_width), 0.5 * (ras.header.cupsPageSize[1] - image_yscale * image_height));
     }
 
+   /*
+    * Decode the image at the size it will be printed, which lets ImageIO
+    * downscale JPEG images while decoding them - a phone photo printed on a
+    * small card needs a fraction of the memory and time of a full decode.
+    * The image is still drawn into a rectangle of the original dimensions so
+    * the transform above does not change...
+    */
+
+    image_size = (long)((image_width > image_height ? image_width : image_height) * image_xscale * (ras.header.HWResolution[0] > ras.header.HWResolution[1] ? ras.header.HWResolution[0] : ras.header.HWResolution[1]) / 72.0) + 1;
+
+    if ((size_t)image_size < image_width || (size_t)image_size < image_height)
+    {
+      CFNumberRef	max_size = CFNumberCreate(kCFAllocatorDefault, kCFNumberLongType, &image_size);
+					/* Maximum decoded size */
+      const void	*keys[3] =	/* Thumbnail option keys */
+      {
+	kCGImageSourceCreateThumbnailFromImageAlways,
+	kCGImageSourceCreateThumbnailWithTransform,
+	kCGImageSourceThumbnailMaxPixelSize
+      },
+			*values[3] =	/* Thumbnail option values */
+      {
+	kCFBooleanTrue,
+	kCFBooleanFalse,
+	max_size
+      };
+      CFDictionaryRef	thumb_options = CFDictionaryCreate(kCFAllocatorDefault, keys, values, 3, &kCFTypeDictionaryKeyCallBacks, &kCFTypeDictionaryValueCallBacks);
+					/* Thumbnail options */
+
+      if (Verbosity > 1)
+	fprintf(stderr, "DEBUG: Decoding image at %ld pixels.\n", image_size);
+
+      image = CGImageSourceCreateThumbnailAtIndex(src, 0, thumb_options);
+
+      CFRelease(thumb_options);
+      CFRelease(max_size);
+    }
+
+    if (!image && (image = CGImageSourceCreateImageAtIndex(src, 0, NULL)) == NULL)
+    {
+      fputs("ERROR: Unable to create CFImageRef for file.\n", stderr);
+
+      CFRelease(src);
+      CGContextRelease(context);
+      free(ras.band_buffer);
+      ras.band_buffer = NULL;
+
+      return (1);
+    }
+
+    CFRelease(src);
+
    /*
     * Draw all of the copies...
     */
@@ -2090,6 +2894,243 @@ xform_document(
 
 
 #else
+#  ifdef HAVE_FZ_CMM_ENGINE_LCMS
+/*
+ * 'xform_adobe_rgb()' - Get the AdobeRGB (1998) colorspace for a context.
+ *
+ * The resident worker's context keeps the colorspace for all of its jobs,
+ * which are forked after the profile is loaded.  MuPDF caches the color links
+ * it builds from a colorspace in the context store, so reusing the same
+ * colorspace also reuses the links for each source colorspace and rendering
+ * intent.
+ */
+
+static fz_colorspace *			/* O - AdobeRGB colorspace */
+xform_adobe_rgb(fz_context *context)	/* I - MuPDF context */
+{
+  fz_colorspace	*adobe_cs = NULL;	/* AdobeRGB colorspace */
+
+
+  if (XformAdobeRGB && context == XformContext)
+    return (XformAdobeRGB);
+
+  fz_set_cmm_engine(context, &fz_cmm_engine_lcms);
+
+#    if FZ_VERSION_MAJOR > 1 || FZ_VERSION_MINOR > 14
+#      define ADOBE_COLORSPACE	FZ_COLORSPACE_RGB
+#    else
+#      define ADOBE_COLORSPACE	"AdobeRGB1998"
+#    endif /* FZ_VERSION_MAJOR > 1 || FZ_VERSION_MINOR > 14 */
+
+  fz_try(context)
+  {
+#    ifdef __APPLE__
+    adobe_cs = fz_new_icc_colorspace_from_file(context, ADOBE_COLORSPACE, "/System/Library/ColorSync/Profiles/AdobeRGB1998.icc");
+#    else
+    adobe_cs = fz_new_icc_colorspace_from_file(context, ADOBE_COLORSPACE, "/usr/share/color/icc/colord/AdobeRGB1998.icc");
+#    endif /* __APPLE__ */
+  }
+  fz_catch(context)
+  {
+    fprintf(stderr, "DEBUG: Unable to load AdobeRGB profile: %s\n", fz_caught_message(context));
+  }
+
+  if (!adobe_cs)
+  {
+   /*
+    * Fall back on the "device RGB" colorspace, which is sRGB for MuPDF...
+    */
+
+    return (fz_device_rgb(context));
+  }
+
+  if (context == XformContext)
+    XformAdobeRGB = adobe_cs;
+
+  return (adobe_cs);
+}
+#  endif /* HAVE_FZ_CMM_ENGINE_LCMS */
+
+
+/*
+ * 'xform_band_thread()' - Render bands of a page.
+ */
+
+static void *				/* O - Thread exit status */
+xform_band_thread(xform_band_t *band)	/* I - Band information */
+{
+  _cupsMutexLock(&band->mutex);
+
+  for (;;)
+  {
+    while (band->state == XFORM_BAND_IDLE || band->state == XFORM_BAND_DONE)
+      _cupsCondWait(&band->cond, &band->mutex, 0.0);
+
+    if (band->state == XFORM_BAND_QUIT)
+      break;
+
+    _cupsMutexUnlock(&band->mutex);
+
+    if (!band->blank)
+    {
+     /*
+      * Render bands that are not outside the content of the page...
+      */
+
+      fz_try(band->context)
+      {
+        fz_clear_pixmap_with_value(band->context, band->pixmap, 0xff);
+
+#  if FZ_VERSION_MAJOR > 1 || FZ_VERSION_MINOR > 14
+        fz_run_display_list(band->context, band->list, band->device, band->transform, fz_infinite_rect, NULL);
+#  else
+        fz_run_display_list(band->context, band->list, band->device, &band->transform, &fz_infinite_rect, NULL);
+#  endif /* FZ_VERSION_MAJOR > 1 || FZ_VERSION_MINOR > 14 */
+      }
+      fz_catch(band->context)
+      {
+        fprintf(stderr, "ERROR: Unable to render lines %u to %u: %s\n", band->starty, band->endy - 1, fz_caught_message(band->context));
+      }
+    }
+
+    _cupsMutexLock(&band->mutex);
+    band->state = XFORM_BAND_DONE;
+    _cupsCondBroadcast(&band->cond);
+  }
+
+  _cupsMutexUnlock(&band->mutex);
+
+  return (NULL);
+}
+
+
+/*
+ * 'xform_band_write()' - Wait for a band to be rendered and write it.
+ */
+
+static void
+xform_band_write(
+    xform_raster_t   *ras,		/* I - Raster information */
+    fz_context       *context,		/* I - MuPDF context */
+    xform_band_t     *band,		/* I - Band to write */
+    size_t           band_size,		/* I - Size of band line */
+    unsigned         *impressions,	/* IO - Impression counter */
+    unsigned         *media_sheets,	/* IO - Media sheet counter */
+    xform_write_cb_t cb,		/* I - Write callback */
+    void             *ctx)		/* I - Write context */
+{
+  unsigned	y;			/* Current line */
+  unsigned char	*lineptr;		/* Pointer to line */
+
+
+  if (band->first)
+    (*(ras->start_page))(ras, band->page, cb, ctx);
+
+  _cupsMutexLock(&band->mutex);
+  while (band->state != XFORM_BAND_DONE)
+    _cupsCondWait(&band->cond, &band->mutex, 0.0);
+  band->state = XFORM_BAND_IDLE;
+  _cupsMutexUnlock(&band->mutex);
+
+  if (Verbosity > 1)
+    fprintf(stderr, "DEBUG: Writing page %u band from %u to %u.\n", band->page, band->starty, band->endy);
+
+  if (band->blank || xform_is_blank(band->pixmap->samples, (band->endy - band->starty) * band_size, ras->band_bpp == 4 ? 0 : 255))
+  {
+   /*
+    * Skip the per-pixel work for blank bands...
+    */
+
+    (*(ras->write_blanks))(ras, band->starty, band->endy - band->starty, cb, ctx);
+  }
+  else
+  {
+    for (y = band->starty; y < band->endy; y ++)
+    {
+      lineptr = band->pixmap->samples + (y - band->starty) * band_size + ras->left * ras->band_bpp;
+
+      if (ras->header.cupsColorSpace == CUPS_CSPACE_K && ras->header.cupsBitsPerPixel >= 8)
+	invert_gray(lineptr, ras->right - ras->left);
+
+      (*(ras->write_line))(ras, y, lineptr, cb, ctx);
+    }
+  }
+
+  if (band->last)
+  {
+    fz_drop_display_list(context, band->list);
+
+    (*(ras->end_page))(ras, band->page, cb, ctx);
+
+    (*impressions) ++;
+    fprintf(stderr, "ATTR: job-impressions-completed=%u\n", *impressions);
+    if (!ras->header.Duplex || !(band->page & 1))
+    {
+      (*media_sheets) ++;
+      fprintf(stderr, "ATTR: job-media-sheets-completed=%u\n", *media_sheets);
+    }
+  }
+
+  band->list = NULL;
+}
+
+
+/*
+ * 'xform_content_box()' - Get the bounding box of the marks on a page.
+ *
+ * The box is empty for a blank page and infinite if it cannot be determined,
+ * and includes a one point margin for anti-aliased edges.
+ */
+
+static fz_rect				/* O - Content box in page coordinates */
+xform_content_box(
+    fz_context      *context,		/* I - MuPDF context */
+    fz_page         *page,		/* I - Page or `NULL` */
+    fz_display_list *list)		/* I - Display list or `NULL` */
+{
+  fz_rect	box = fz_empty_rect;	/* Content box */
+  fz_device	*device = NULL;		/* Bounding box device */
+
+
+  fz_try(context)
+  {
+    device = fz_new_bbox_device(context, &box);
+
+#  if FZ_VERSION_MAJOR > 1 || FZ_VERSION_MINOR > 14
+    if (list)
+      fz_run_display_list(context, list, device, fz_identity, fz_infinite_rect, NULL);
+    else
+      fz_run_page(context, page, device, fz_identity, NULL);
+#  else
+    if (list)
+      fz_run_display_list(context, list, device, &fz_identity, &fz_infinite_rect, NULL);
+    else
+      fz_run_page(context, page, device, &fz_identity, NULL);
+#  endif /* FZ_VERSION_MAJOR > 1 || FZ_VERSION_MINOR > 14 */
+
+    fz_close_device(context, device);
+  }
+  fz_always(context)
+  {
+    fz_drop_device(context, device);
+  }
+  fz_catch(context)
+  {
+    box = fz_infinite_rect;
+  }
+
+  if (box.x0 < box.x1 && box.y0 < box.y1)
+  {
+    box.x0 -= 1.0f;
+    box.y0 -= 1.0f;
+    box.x1 += 1.0f;
+    box.y1 += 1.0f;
+  }
+
+  return (box);
+}
+
+
 /*
  * 'xform_document()' - Transform a file for printing.
  */
@@ -2114,8 +3155,6 @@ xform_document(
   fz_device		*device;	/* Device for rendering */
   fz_colorspace		*cs;		/* Quartz color space */
   xform_raster_t	ras;		/* Raster info */
-  size_t		max_raster;	/* Maximum raster memory to use */
-  const char		*max_raster_env;/* IPPTRANSFORM_MAX_RASTER env var */
   unsigned		pages = 1;	/* Number of pages */
   int			color = 1;	/* Color PDF? */
   const char		*page_ranges;	/* "page-ranges" option */
@@ -2127,24 +3166,65 @@ xform_document(
 			impressions = 0;/* Page/sheet counters */
   size_t		band_size;	/* Size of band line */
   double		xscale, yscale;	/* Scaling factor */
-  fz_rect		image_box;	/* Bounding box of content */
+  fz_rect		image_box,	/* Bounding box of content */
+			content_box;	/* Bounding box of marks on page */
   fz_matrix	 	base_transform,	/* Base transform */
 			image_transform,/* Transform for content ("page image") */
 			transform,	/* Transform for page */
-			back_transform;	/* Transform for back side */
+			back_transform,	/* Transform for back side */
+			band_transform;	/* Transform from page to band pixels */
+  int			band_blank;	/* Is the current band blank? */
+  unsigned char		white;		/* Value of white pixels */
+  fz_locks_context	locks;		/* Locks for multi-threaded rendering */
+  unsigned		num_bands = 0,	/* Number of band threads */
+			next_band = 0,	/* Next band to render */
+			write_band = 0;	/* Next band to write */
+  xform_band_t		*bands = NULL,	/* Band threads */
+			*band;		/* Current band thread */
 
 
  /*
   * Open the PDF file...
   */
 
-  if ((context = fz_new_context(NULL, NULL, FZ_STORE_UNLIMITED)) == NULL)
+  if (Threads > 1)
+    num_bands = Threads > XFORM_MAX_THREADS ? XFORM_MAX_THREADS : Threads;
+
+  if (XformContext)
   {
-    fputs("ERROR: Unable to create context.\n", stderr);
-    return (1);
+   /*
+    * Use the context that was loaded by xform_worker(), which already has
+    * locks and the document handlers...
+    */
+
+    context = XformContext;
   }
+  else
+  {
+    if (num_bands > 1)
+    {
+     /*
+      * Render bands on multiple threads, which requires MuPDF locking...
+      */
+
+      unsigned	i;			/* Looping var */
+
+      for (i = 0; i < FZ_LOCK_MAX; i ++)
+	_cupsMutexInit(XformLocks + i);
+
+      locks.user   = NULL;
+      locks.lock   = xform_lock;
+      locks.unlock = xform_unlock;
+    }
+
+    if ((context = fz_new_context(NULL, num_bands > 1 ? &locks : NULL, FZ_STORE_UNLIMITED)) == NULL)
+    {
+      fputs("ERROR: Unable to create context.\n", stderr);
+      return (1);
+    }
 
-  fz_register_document_handlers(context);
+    fz_register_document_handlers(context);
+  }
 
   fz_try(context) document = fz_open_document(context, filename);
   fz_catch(context)
@@ -2232,8 +3312,6 @@ xform_document(
 #ifdef HAVE_FZ_CMM_ENGINE_LCMS
     if (ras.header.cupsColorSpace == CUPS_CSPACE_ADOBERGB)
     {
-      fz_set_cmm_engine(context, &fz_cmm_engine_lcms);
-
 # if 0 /* MuPDF crashes - known bug */
      /*
       * Create a calibrated colorspace using the AdobeRGB (1998) values.
@@ -2249,17 +3327,7 @@ xform_document(
       cs = fz_new_cal_colorspace(context, "AdobeRGB", wp_val, bp_val, gamma_val, matrix_val);
 #  endif // 0
 
-#  if FZ_VERSION_MAJOR > 1 || FZ_VERSION_MINOR > 14
-#    define ADOBE_COLORSPACE	FZ_COLORSPACE_RGB
-#  else
-#    define ADOBE_COLORSPACE	"AdobeRGB1998"
-#  endif /* FZ_VERSION_MAJOR > 1 || FZ_VERSION_MINOR > 14 */
-
-#  ifdef __APPLE__
-      cs = fz_new_icc_colorspace_from_file(context, ADOBE_COLORSPACE, "/System/Library/ColorSync/Profiles/AdobeRGB1998.icc");
-#  else
-      cs = fz_new_icc_colorspace_from_file(context, ADOBE_COLORSPACE, "/usr/share/color/icc/colord/AdobeRGB1998.icc");
-#  endif /* __APPLE__ */
+      cs = xform_adobe_rgb(context);
     }
     else
 #endif /* HAVE_FZ_CMM_ENGINE_LCMS */
@@ -2281,18 +3349,12 @@ xform_document(
     cs           = fz_device_cmyk(context);
   }
 
-  max_raster     = XFORM_MAX_RASTER;
-  max_raster_env = getenv("IPPTRANSFORM_MAX_RASTER");
-  if (max_raster_env && strtol(max_raster_env, NULL, 10) > 0)
-    max_raster = (size_t)strtol(max_raster_env, NULL, 10);
-
   band_size = (size_t)ras.header.cupsWidth * ras.band_bpp;
   fprintf(stderr, "DEBUG: ras.header.cupsWidth=%u, ras.band_bpp=%u, band_size=%ld\n", ras.header.cupsWidth, ras.band_bpp, (long)band_size);
 
-  if ((ras.band_height = (unsigned)(max_raster / band_size)) < 1)
-    ras.band_height = 1;
-  else if (ras.band_height > ras.header.cupsHeight)
-    ras.band_height = ras.header.cupsHeight;
+  white = ras.band_bpp == 4 ? 0 : 255;
+
+  ras.band_height = xform_band_height(&ras, band_size, num_bands);
 
 #  if HAVE_FZ_NEW_PIXMAP_5_ARG
   pixmap = fz_new_pixmap(context, cs, (int)ras.header.cupsWidth, (int)ras.band_height, 0);
@@ -2339,6 +3401,68 @@ xform_document(
   fz_set_aa_level(context, 0);
   fz_enable_device_hints(context, device, FZ_DONT_INTERPOLATE_IMAGES);
 
+  if (num_bands > 1 && (bands = calloc(num_bands, sizeof(xform_band_t))) != NULL)
+  {
+   /*
+    * Start the band threads, each with its own context, pixmap, and device...
+    */
+
+    unsigned	i;			/* Looping var */
+
+    for (i = 0, band = bands; i < num_bands; i ++, band ++)
+    {
+      if ((band->context = fz_clone_context(context)) == NULL)
+        break;
+
+      fz_set_aa_level(band->context, 0);
+
+#  if HAVE_FZ_NEW_PIXMAP_5_ARG
+      band->pixmap = fz_new_pixmap(band->context, cs, (int)ras.header.cupsWidth, (int)ras.band_height, 0);
+#  else
+      band->pixmap = fz_new_pixmap(band->context, cs, (int)ras.header.cupsWidth, (int)ras.band_height, NULL, 0);
+      band->pixmap->flags &= ~FZ_PIXMAP_FLAG_INTERPOLATE;
+#  endif /* HAVE_FZ_NEW_PIXMAP_5_ARG */
+
+      band->pixmap->xres = (int)ras.header.HWResolution[0];
+      band->pixmap->yres = (int)ras.header.HWResolution[1];
+
+#  if FZ_VERSION_MAJOR > 1 || FZ_VERSION_MINOR > 14
+      band->device = fz_new_draw_device(band->context, base_transform, band->pixmap);
+#  else
+      band->device = fz_new_draw_device(band->context, &base_transform, band->pixmap);
+#  endif /* FZ_VERSION_MAJOR > 1 || FZ_VERSION_MINOR > 14 */
+
+      fz_enable_device_hints(band->context, band->device, FZ_DONT_INTERPOLATE_IMAGES);
+
+      _cupsMutexInit(&band->mutex);
+      _cupsCondInit(&band->cond);
+
+      band->state = XFORM_BAND_IDLE;
+
+      if ((band->thread = _cupsThreadCreate((_cups_thread_func_t)xform_band_thread, band)) == 0)
+      {
+        fz_drop_device(band->context, band->device);
+        fz_drop_pixmap(band->context, band->pixmap);
+        fz_drop_context(band->context);
+        break;
+      }
+    }
+
+    num_bands = i;
+
+    if (Verbosity)
+      fprintf(stderr, "DEBUG: Rendering bands using %u threads.\n", num_bands);
+  }
+  else if (num_bands > 1)
+  {
+   /*
+    * Unable to allocate the band threads, render on this thread...
+    */
+
+    fputs("DEBUG: Unable to allocate band threads, rendering on one thread.\n", stderr);
+    num_bands = 0;
+  }
+
  /*
   * Setup the back page transform, if any...
   */
@@ -2482,6 +3606,89 @@ xform_document(
       if (Verbosity > 1)
         fprintf(stderr, "DEBUG: Printing copy %d/%d, page %d/%d, image_transform=[%g %g %g %g %g %g]\n", copy + 1, ras.copies, page, pages, image_transform.a, image_transform.b, image_transform.c, image_transform.d, image_transform.e, image_transform.f);
 
+      if (num_bands > 1)
+      {
+       /*
+	* Queue the bands of this page for the band threads.  Bands are
+	* written in order as threads become available, so the following
+	* pages are rendered while this one is written...
+	*/
+
+        fz_display_list	*list;		/* Display list for page */
+        fz_matrix	page_transform;	/* Transform for page */
+
+        list        = fz_new_display_list_from_page(context, pdf_page);
+        content_box = xform_content_box(context, NULL, list);
+        fz_drop_page(context, pdf_page);
+
+        page_transform = image_transform;
+
+        if (!(page & 1) && ras.header.Duplex)
+        {
+#  if FZ_VERSION_MAJOR > 1 || FZ_VERSION_MINOR > 14
+	  page_transform = fz_concat(back_transform, image_transform);
+#  else
+	  fz_concat(&page_transform, &back_transform, &image_transform);
+#  endif /* FZ_VERSION_MAJOR > 1 || FZ_VERSION_MINOR > 14 */
+        }
+
+        if (!next_band)
+        {
+         /*
+	  * Start the first page now to get the imageable area...
+	  */
+
+          (*(ras.start_page))(&ras, page, cb, ctx);
+        }
+
+        for (y = ras.top; y < ras.bottom; y += ras.band_height)
+        {
+          if ((next_band - write_band) >= num_bands)
+          {
+            xform_band_write(&ras, context, bands + (write_band % num_bands), band_size, &impressions, &media_sheets, cb, ctx);
+            write_band ++;
+          }
+
+          band = bands + (next_band % num_bands);
+
+          transform = page_transform;
+
+#  if FZ_VERSION_MAJOR > 1 || FZ_VERSION_MINOR > 14
+	  transform = fz_pre_translate(transform, 0.0, -1.0 * y / yscale);
+#  else
+	  fz_pre_translate(&transform, 0.0, -1.0 * y / yscale);
+#  endif /* FZ_VERSION_MAJOR > 1 || FZ_VERSION_MINOR > 14 */
+
+          _cupsMutexLock(&band->mutex);
+
+          band->list      = list;
+          band->transform = transform;
+          band->page      = page;
+          band->starty    = y;
+          band->endy      = y + ras.band_height;
+          if (band->endy > ras.bottom)
+            band->endy = ras.bottom;
+          band->first     = y == ras.top && next_band > 0;
+          band->last      = band->endy == ras.bottom;
+#  if FZ_VERSION_MAJOR > 1 || FZ_VERSION_MINOR > 14
+          band->blank     = xform_is_outside(content_box, fz_concat(transform, base_transform), ras.header.cupsWidth, band->endy - band->starty);
+#  else
+          fz_concat(&band_transform, &transform, &base_transform);
+          band->blank     = xform_is_outside(content_box, band_transform, ras.header.cupsWidth, band->endy - band->starty);
+#  endif /* FZ_VERSION_MAJOR > 1 || FZ_VERSION_MINOR > 14 */
+
+          band->state = XFORM_BAND_RENDER;
+          _cupsCondBroadcast(&band->cond);
+          _cupsMutexUnlock(&band->mutex);
+
+          next_band ++;
+        }
+
+        continue;
+      }
+
+      content_box = xform_content_box(context, pdf_page, NULL);
+
       (*(ras.start_page))(&ras, page, cb, ctx);
 
       for (y = ras.top; y < ras.bottom; y ++)
@@ -2500,9 +3707,6 @@ xform_document(
 	  if (Verbosity > 1)
 	    fprintf(stderr, "DEBUG: Drawing band from %u to %u.\n", band_starty, band_endy);
 
-          fz_clear_pixmap_with_value(context, pixmap, 0xff);
-          fputs("DEBUG: Band cleared...\n", stderr);
-
           transform = fz_identity;
 
 #  if FZ_VERSION_MAJOR > 1 || FZ_VERSION_MINOR > 14
@@ -2525,12 +3729,41 @@ xform_document(
           fprintf(stderr, "DEBUG: Page transform=[%g %g %g %g %g %g]\n", transform.a, transform.b, transform.c, transform.d, transform.e, transform.f);
 
 #  if FZ_VERSION_MAJOR > 1 || FZ_VERSION_MINOR > 14
-          fz_run_page(context, pdf_page, device, transform, NULL);
+          band_transform = fz_concat(transform, base_transform);
+#  else
+          fz_concat(&band_transform, &transform, &base_transform);
+#  endif /* FZ_VERSION_MAJOR > 1 || FZ_VERSION_MINOR > 14 */
+
+          if ((band_blank = xform_is_outside(content_box, band_transform, ras.header.cupsWidth, band_endy - band_starty)) == 0)
+          {
+            fz_clear_pixmap_with_value(context, pixmap, 0xff);
+            fputs("DEBUG: Band cleared...\n", stderr);
+
+#  if FZ_VERSION_MAJOR > 1 || FZ_VERSION_MINOR > 14
+            fz_run_page(context, pdf_page, device, transform, NULL);
 #  else
-          fz_run_page(context, pdf_page, device, &transform, NULL);
+            fz_run_page(context, pdf_page, device, &transform, NULL);
 #  endif /* FZ_VERSION_MAJOR > 1 || FZ_VERSION_MINOR > 14 */
 
-          fputs("DEBUG: Band rendered...\n", stderr);
+            fputs("DEBUG: Band rendered...\n", stderr);
+
+            band_blank = xform_is_blank(pixmap->samples, (band_endy - band_starty) * band_size, white);
+          }
+
+          if (band_blank)
+          {
+           /*
+            * Skip the per-pixel work for blank bands...
+            */
+
+            if (Verbosity > 1)
+              fprintf(stderr, "DEBUG: Band from %u to %u is blank.\n", band_starty, band_endy);
+
+            (*(ras.write_blanks))(&ras, band_starty, band_endy - band_starty, cb, ctx);
+
+            y = band_endy - 1;
+            continue;
+          }
 	}
 
        /*
@@ -2562,17 +3795,14 @@ xform_document(
       * Duplex printing, add a blank back side image...
       */
 
-      unsigned		y;		/* Current line */
+      for (; write_band < next_band; write_band ++)
+        xform_band_write(&ras, context, bands + (write_band % num_bands), band_size, &impressions, &media_sheets, cb, ctx);
 
       if (Verbosity > 1)
         fprintf(stderr, "DEBUG: Printing blank page %u for duplex.\n", pages + 1);
 
-      memset(pixmap->samples, ras.header.cupsBitsPerPixel == 32 ? 0 : 255, ras.header.cupsBytesPerLine);
-
       (*(ras.start_page))(&ras, page, cb, ctx);
-
-      for (y = ras.top; y < ras.bottom; y ++)
-	(*(ras.write_line))(&ras, y, pixmap->samples, cb, ctx);
+      (*(ras.write_blanks))(&ras, ras.top, ras.bottom - ras.top, cb, ctx);
 
       (*(ras.end_page))(&ras, page, cb, ctx);
 
@@ -2586,12 +3816,40 @@ xform_document(
     }
   }
 
+  for (; write_band < next_band; write_band ++)
+    xform_band_write(&ras, context, bands + (write_band % num_bands), band_size, &impressions, &media_sheets, cb, ctx);
+
   (*(ras.end_job))(&ras, cb, ctx);
 
  /*
   * Clean up...
   */
 
+  if (bands)
+  {
+   /*
+    * Stop the band threads...
+    */
+
+    unsigned	i;			/* Looping var */
+
+    for (i = 0, band = bands; i < num_bands; i ++, band ++)
+    {
+      _cupsMutexLock(&band->mutex);
+      band->state = XFORM_BAND_QUIT;
+      _cupsCondBroadcast(&band->cond);
+      _cupsMutexUnlock(&band->mutex);
+
+      _cupsThreadWait(band->thread);
+
+      fz_drop_device(band->context, band->device);
+      fz_drop_pixmap(band->context, band->pixmap);
+      fz_drop_context(band->context);
+    }
+
+    free(bands);
+  }
+
   fz_drop_device(context, device);
   fz_drop_pixmap(context, pixmap);
   fz_drop_document(context, document);
@@ -2602,6 +3860,76 @@ xform_document(
 #endif /* HAVE_COREGRAPHICS */
 
 
+#ifdef HAVE_MUPDF
+/*
+ * 'xform_is_blank()' - Determine whether a band only contains white pixels.
+ *
+ * Comparing the buffer with itself offset by one byte lets memcmp() use its
+ * vectorized loop to check that all bytes are equal.
+ */
+
+static int				/* O - 1 if blank, 0 otherwise */
+xform_is_blank(
+    const unsigned char *buffer,	/* I - Band pixels */
+    size_t              length,		/* I - Length of band */
+    unsigned char       white)		/* I - Value of white pixels */
+{
+  return (length == 0 || (buffer[0] == white && (length == 1 || !memcmp(buffer, buffer + 1, length - 1))));
+}
+
+
+/*
+ * 'xform_is_outside()' - Determine whether a band is outside the content of a
+ *                        page.
+ *
+ * The band is mapped back to page coordinates using the inverse of its
+ * transform, so it works with any scaling, rotation, or back side transform.
+ */
+
+static int				/* O - 1 if outside, 0 otherwise */
+xform_is_outside(
+    fz_rect   content,			/* I - Content box in page coordinates */
+    fz_matrix transform,		/* I - Transform from page to band pixels */
+    unsigned  width,			/* I - Width of band in pixels */
+    unsigned  height)			/* I - Height of band in pixels */
+{
+  fz_matrix	inverse;		/* Transform from band pixels to page */
+  fz_rect	band;			/* Band in page coordinates */
+
+
+  band.x0 = 0.0f;
+  band.y0 = 0.0f;
+  band.x1 = (float)width;
+  band.y1 = (float)height;
+
+#  if FZ_VERSION_MAJOR > 1 || FZ_VERSION_MINOR > 14
+  inverse = fz_invert_matrix(transform);
+  band    = fz_intersect_rect(fz_transform_rect(band, inverse), content);
+#  else
+  fz_invert_matrix(&inverse, &transform);
+  fz_transform_rect(&band, &inverse);
+  fz_intersect_rect(&band, &content);
+#  endif /* FZ_VERSION_MAJOR > 1 || FZ_VERSION_MINOR > 14 */
+
+  return (band.x0 >= band.x1 || band.y0 >= band.y1);
+}
+
+
+/*
+ * 'xform_lock()' - Lock a MuPDF context mutex.
+ */
+
+static void
+xform_lock(void *user,			/* I - User data (unused) */
+           int  lock)			/* I - Lock number */
+{
+  (void)user;
+
+  _cupsMutexLock(XformLocks + lock);
+}
+#endif /* HAVE_MUPDF */
+
+
 /*
  * 'xform_setup()' - Setup a raster context for printing.
  */
@@ -2977,3 +4305,237 @@ xform_setup(xform_raster_t *ras,	/* I - Raster information */
 
   return (0);
 }
+
+
+/*
+ * 'xform_time()' - Get the current time in seconds.
+ */
+
+static double				/* O - Time in seconds */
+xform_time(void)
+{
+  struct timeval	curtime;	/* Current time */
+
+
+  gettimeofday(&curtime, NULL);
+
+  return (curtime.tv_sec + 0.000001 * curtime.tv_usec);
+}
+
+
+#ifdef HAVE_MUPDF
+/*
+ * 'xform_unlock()' - Unlock a MuPDF context mutex.
+ */
+
+static void
+xform_unlock(void *user,		/* I - User data (unused) */
+             int  lock)			/* I - Lock number */
+{
+  (void)user;
+
+  _cupsMutexUnlock(XformLocks + lock);
+}
+#endif /* HAVE_MUPDF */
+
+
+#ifndef _WIN32
+/*
+ * 'xform_worker()' - Run jobs for ippserver without starting a new program.
+ *
+ * The worker loads its resources once and then reads requests from the
+ * control socket on stdin.  Each request is an unsigned length sent with
+ * three file descriptors (stdin, stdout, and stderr for the job), followed by
+ * the nul-terminated filename and environment strings.  Each job runs in a
+ * forked copy of the worker so that it cannot disturb later jobs, and the
+ * worker replies with the process ID followed by the wait status.
+ */
+
+static int				/* O - Exit status */
+xform_worker(const char *command)	/* I - Command name */
+{
+  int		control;		/* Control socket */
+  unsigned	length;			/* Length of request strings */
+  char		*request,		/* Request strings */
+		*ptr,			/* Pointer into request */
+		*end,			/* End of request */
+		*myargv[3],		/* Job command-line arguments */
+		*myenvp[1024];		/* Job environment variables */
+  int		myenvc;			/* Number of environment variables */
+  int		fds[3];			/* Job stdin, stdout, and stderr */
+  char		buffer[CMSG_SPACE(sizeof(fds))];
+					/* Control message buffer */
+  struct msghdr	msg;			/* Request message */
+  struct iovec	iov;			/* Request length */
+  struct cmsghdr *cmsg;			/* File descriptors in message */
+  ssize_t	bytes;			/* Bytes read */
+  size_t	total;			/* Total bytes read */
+  int		i,			/* Looping var */
+		fdmax,			/* Maximum file descriptor */
+		pid,			/* Job process ID */
+		status;			/* Job wait status */
+#ifdef HAVE_MUPDF
+  static fz_locks_context locks = { NULL, xform_lock, xform_unlock };
+					/* Locks for multi-threaded rendering */
+#endif /* HAVE_MUPDF */
+
+
+ /*
+  * Move the control socket off of stdin...
+  */
+
+  if ((control = dup(0)) < 0)
+  {
+    fprintf(stderr, "ERROR: Unable to access control socket: %s\n", strerror(errno));
+    return (1);
+  }
+
+  close(0);
+  open("/dev/null", O_RDONLY);
+
+ /*
+  * Close anything else inherited from ippserver, such as listening sockets
+  * and the pipes of other jobs...
+  */
+
+  if ((fdmax = (int)sysconf(_SC_OPEN_MAX)) < 0 || fdmax > 65536)
+    fdmax = 65536;
+
+  for (i = 3; i < fdmax; i ++)
+  {
+    if (i != control)
+      close(i);
+  }
+
+#ifdef HAVE_MUPDF
+ /*
+  * Load the MuPDF context, color profiles, and document handlers once.  The
+  * context always has locks so that jobs can use band threads...
+  */
+
+  for (i = 0; i < FZ_LOCK_MAX; i ++)
+    _cupsMutexInit(XformLocks + i);
+
+  if ((XformContext = fz_new_context(NULL, &locks, FZ_STORE_UNLIMITED)) == NULL)
+  {
+    fputs("ERROR: Unable to create context.\n", stderr);
+    close(control);
+    return (1);
+  }
+
+  fz_register_document_handlers(XformContext);
+
+#  ifdef HAVE_FZ_CMM_ENGINE_LCMS
+  xform_adobe_rgb(XformContext);
+#  endif /* HAVE_FZ_CMM_ENGINE_LCMS */
+#endif /* HAVE_MUPDF */
+
+ /*
+  * Process requests until ippserver closes the control socket...
+  */
+
+  for (;;)
+  {
+    memset(&msg, 0, sizeof(msg));
+
+    iov.iov_base       = &length;
+    iov.iov_len        = sizeof(length);
+    msg.msg_iov        = &iov;
+    msg.msg_iovlen     = 1;
+    msg.msg_control    = buffer;
+    msg.msg_controllen = sizeof(buffer);
+
+    if ((bytes = recvmsg(control, &msg, 0)) < 0 && errno == EINTR)
+      continue;
+    else if (bytes <= 0)
+      break;
+
+    if (bytes != (ssize_t)sizeof(length) || (cmsg = CMSG_FIRSTHDR(&msg)) == NULL || cmsg->cmsg_level != SOL_SOCKET || cmsg->cmsg_type != SCM_RIGHTS || cmsg->cmsg_len != CMSG_LEN(sizeof(fds)) || length == 0 || length > 1048576)
+    {
+      fputs("ERROR: Bad worker request.\n", stderr);
+      break;
+    }
+
+    memcpy(fds, CMSG_DATA(cmsg), sizeof(fds));
+
+    if ((request = malloc(length + 1)) == NULL)
+    {
+      fprintf(stderr, "ERROR: Unable to allocate worker request: %s\n", strerror(errno));
+      break;
+    }
+
+    for (total = 0; total < length; total += (size_t)bytes)
+    {
+      if ((bytes = read(control, request + total, length - total)) < 0 && errno == EINTR)
+        bytes = 0;
+      else if (bytes <= 0)
+        break;
+    }
+
+    if (total < length)
+    {
+      free(request);
+      break;
+    }
+
+   /*
+    * Split the request into the filename and environment...
+    */
+
+    request[length] = '\0';
+    end             = request + length;
+
+    myargv[0] = (char *)command;
+    myargv[1] = request;
+    myargv[2] = NULL;
+
+    for (ptr = request + strlen(request) + 1, myenvc = 0; ptr < end && myenvc < (int)(sizeof(myenvp) / sizeof(myenvp[0]) - 1); ptr += strlen(ptr) + 1)
+      myenvp[myenvc ++] = ptr;
+
+    myenvp[myenvc] = NULL;
+
+   /*
+    * Run the job in a copy of this process...
+    */
+
+    if ((pid = fork()) == 0)
+    {
+      close(control);
+
+      for (i = 0; i < 3; i ++)
+      {
+        dup2(fds[i], i);
+        if (fds[i] > 2)
+          close(fds[i]);
+      }
+
+      environ = myenvp;
+
+      exit(main(2, myargv));
+    }
+
+    for (i = 0; i < 3; i ++)
+      close(fds[i]);
+
+    free(request);
+
+    if (pid < 0)
+      fprintf(stderr, "ERROR: Unable to start job process: %s\n", strerror(errno));
+
+    if (write(control, &pid, sizeof(pid)) != (ssize_t)sizeof(pid))
+      break;
+
+    if (pid < 0)
+      continue;
+
+    while (waitpid(pid, &status, 0) < 0 && errno == EINTR);
+
+    if (write(control, &status, sizeof(status)) != (ssize_t)sizeof(status))
+      break;
+  }
+
+  close(control);
+
+  return (0);
+}
+#endif /* !_WIN32 */
@@ -9,6 +9,7 @@
 
 #include <config.h>
 #include <cups/cups.h>
+#include <cups/dir.h>
 #include <cups/array-private.h>
 #include <cups/string-private.h>
 #include <cups/thread-private.h>
@@ -41,6 +42,7 @@ struct termios2 {
 #ifndef _WIN32
 #  include <spawn.h>
 #  include <poll.h>
+#  include <sys/time.h>
 #  include <sys/wait.h>
 #endif /* !_WIN32 */
 
@@ -49,11 +51,14 @@ struct termios2 {
  * Local types...
  */
 
-typedef struct gcode_buffer_s		/**** Buffer for G-code status lines ****/
+typedef struct gcode_buffer_s		/**** Buffer for G-code I/O ****/
 {
-  char	buffer[8192],			/* Buffer */
+  char	buffer[8192],			/* Buffer for status lines */
 	*bufptr;			/* Pointer info buffer */
   size_t bytes;				/* Bytes in buffer */
+  int	is_device;			/* Output acknowledged by a printer? */
+  char	output[65536];			/* Buffer for unacknowledged output */
+  size_t outbytes;			/* Bytes in output buffer */
 } gcode_buffer_t;
 
 
@@ -68,7 +73,13 @@ static int	Verbosity = 0;		/* Log level */
  * Local functions...
  */
 
+#ifndef _WIN32
+static int	cache_compare(cups_dentry_t *a, cups_dentry_t *b);
+static int	cache_lookup(const char * const *argv, int argc, const char *outformat, const char *filename, char *cachefile, size_t cachesize);
+static void	cache_trim(const char *cachefile);
+#endif /* !_WIN32 */
 static int	gcode_fill(gcode_buffer_t *buf, int device_fd, int wait_secs);
+static int	gcode_flush(gcode_buffer_t *buf, int device_fd);
 static char	*gcode_gets(gcode_buffer_t *buf);
 static int	gcode_puts(gcode_buffer_t *buf, int device_fd, char *line, int linenum);
 static int	load_env_options(cups_option_t **options);
@@ -219,6 +230,13 @@ main(int  argc,				/* I - Number of command-line args */
     usage(1);
   }
 
+ /*
+  * Initialize the G-code buffer...
+  */
+
+  memset(&buffer, 0, sizeof(buffer));
+  buffer.bufptr = buffer.buffer;
+
  /*
   * If the device URI is specified, open the connection...
   */
@@ -234,12 +252,10 @@ main(int  argc,				/* I - Number of command-line args */
     fd = open_device(device_uri);
 
    /*
-    * Initialize the G-code response buffer and wait for the printer to send
-    * us its firmware information, etc.
+    * Wait for the printer to send us its firmware information, etc.
     */
 
-    memset(&buffer, 0, sizeof(buffer));
-    buffer.bufptr = buffer.buffer;
+    buffer.is_device = 1;
 
     while (gcode_fill(&buffer, fd, 15))
     {
@@ -256,7 +272,11 @@ main(int  argc,				/* I - Number of command-line args */
 
   status = xform_document(filename, output_type, num_options, options, &buffer, fd);
 
-  gcode_puts(&buffer, fd, "", 1);
+  if (gcode_flush(&buffer, fd) < 0)
+  {
+    perror("ERROR: Unable to write print data");
+    status = 1;
+  }
 
   if (fd != 1)
     close(fd);
@@ -265,6 +285,178 @@ main(int  argc,				/* I - Number of command-line args */
 }
 
 
+#ifndef _WIN32
+/*
+ * 'cache_compare()' - Compare two cache files by last use, oldest first.
+ */
+
+static int				/* O - Result of comparison */
+cache_compare(cups_dentry_t *a,		/* I - First file */
+              cups_dentry_t *b)		/* I - Second file */
+{
+  if (a->fileinfo.st_mtime < b->fileinfo.st_mtime)
+    return (-1);
+  else if (a->fileinfo.st_mtime > b->fileinfo.st_mtime)
+    return (1);
+  else
+    return (strcmp(a->filename, b->filename));
+}
+
+
+/*
+ * 'cache_lookup()' - Get the cache filename for the sliced G-code.
+ *
+ * The cache is enabled by the "SERVER_CACHEDIR" and "SERVER_CACHESIZE"
+ * environment variables.  The filename is the SHA2-256 hash of the model
+ * file, the output format, and the CuraEngine arguments, which hold all of
+ * the job settings that affect slicing.  The file may or may not exist.
+ */
+
+static int				/* O - 1 on success, 0 if not cached */
+cache_lookup(
+    const char * const *argv,		/* I - CuraEngine arguments */
+    int                argc,		/* I - Number of arguments to hash */
+    const char         *outformat,	/* I - Output format */
+    const char         *filename,	/* I - Model file */
+    char               *cachefile,	/* I - Cache filename buffer */
+    size_t             cachesize)	/* I - Size of cache filename buffer */
+{
+  const char	*cachedir,		/* Cache directory */
+		*cachemax;		/* Maximum size of cache */
+  int		i,			/* Looping var */
+		fd;			/* Model file */
+  unsigned char	data[65536 + 32],	/* Data to hash */
+		*dataptr,		/* Pointer into data */
+		hash[32];		/* SHA2-256 hash */
+  ssize_t	bytes;			/* Bytes read */
+  size_t	len;			/* Length of string */
+  char		key[65];		/* Hex hash string */
+
+
+  if ((cachedir = getenv("SERVER_CACHEDIR")) == NULL || (cachemax = getenv("SERVER_CACHESIZE")) == NULL || strtoll(cachemax, NULL, 10) <= 0)
+    return (0);
+
+  if ((fd = open(filename, O_RDONLY)) < 0)
+    return (0);
+
+ /*
+  * Hash the model as a chain of blocks, each hash covering the previous hash
+  * and the next block of data...
+  */
+
+  memset(hash, 0, sizeof(hash));
+
+  while ((bytes = read(fd, data + sizeof(hash), sizeof(data) - sizeof(hash))) > 0)
+  {
+    memcpy(data, hash, sizeof(hash));
+    cupsHashData("sha2-256", data, sizeof(hash) + (size_t)bytes, hash, sizeof(hash));
+  }
+
+  close(fd);
+
+  if (bytes < 0)
+    return (0);
+
+ /*
+  * Then add the output format and slicer arguments, with nul separators...
+  */
+
+  memcpy(data, hash, sizeof(hash));
+  dataptr = data + sizeof(hash);
+
+  for (i = -1; i < argc; i ++)
+  {
+    const char *arg = i < 0 ? outformat : argv[i];
+					/* Current string */
+
+    if ((len = strlen(arg) + 1) > (sizeof(data) - (size_t)(dataptr - data)))
+      return (0);			/* Settings don't fit, don't cache */
+
+    memcpy(dataptr, arg, len);
+    dataptr += len;
+  }
+
+  cupsHashData("sha2-256", data, (size_t)(dataptr - data), hash, sizeof(hash));
+
+ /*
+  * Make sure the cache directory exists...
+  */
+
+  if (mkdir(cachedir, 0700) && errno != EEXIST)
+  {
+    fprintf(stderr, "DEBUG: Unable to create cache directory \"%s\": %s\n", cachedir, strerror(errno));
+    return (0);
+  }
+
+  snprintf(cachefile, cachesize, "%s/%s", cachedir, cupsHashString(hash, sizeof(hash), key, sizeof(key)));
+
+  return (1);
+}
+
+
+/*
+ * 'cache_trim()' - Remove the least recently used files from the cache.
+ */
+
+static void
+cache_trim(const char *cachefile)	/* I - File that was added */
+{
+  char		directory[1024],	/* Cache directory */
+		*ptr,			/* Pointer into directory */
+		path[1024];		/* Path of file to remove */
+  const char	*cachemax;		/* Maximum size of cache */
+  off_t		maxsize,		/* Maximum size of cache */
+		total = 0;		/* Total size of cache */
+  cups_dir_t	*dir;			/* Directory */
+  cups_dentry_t	*dent;			/* Directory entry */
+  cups_array_t	*files;			/* Cache files, oldest first */
+
+
+  if ((cachemax = getenv("SERVER_CACHESIZE")) == NULL || (maxsize = (off_t)strtoll(cachemax, NULL, 10)) <= 0)
+    return;
+
+  strlcpy(directory, cachefile, sizeof(directory));
+  if ((ptr = strrchr(directory, '/')) != NULL)
+    *ptr = '\0';
+
+  if ((dir = cupsDirOpen(directory)) == NULL)
+    return;
+
+  files = cupsArrayNew3((cups_array_func_t)cache_compare, NULL, NULL, 0, NULL, (cups_afree_func_t)free);
+
+  while ((dent = cupsDirRead(dir)) != NULL)
+  {
+    cups_dentry_t *copy;		/* Copy of entry */
+
+    if (strchr(dent->filename, '.') || !S_ISREG(dent->fileinfo.st_mode))
+      continue;				/* Skip temporary files */
+
+    if ((copy = malloc(sizeof(cups_dentry_t))) != NULL)
+    {
+      memcpy(copy, dent, sizeof(cups_dentry_t));
+      cupsArrayAdd(files, copy);
+      total += copy->fileinfo.st_size;
+    }
+  }
+
+  cupsDirClose(dir);
+
+  for (dent = (cups_dentry_t *)cupsArrayFirst(files); dent && total > maxsize; dent = (cups_dentry_t *)cupsArrayNext(files))
+  {
+    snprintf(path, sizeof(path), "%s/%s", directory, dent->filename);
+
+    if (!unlink(path))
+    {
+      fprintf(stderr, "DEBUG: Removed cached G-code file \"%s\".\n", path);
+      total -= dent->fileinfo.st_size;
+    }
+  }
+
+  cupsArrayDelete(files);
+}
+#endif /* !_WIN32 */
+
+
 /*
  * 'gcode_fill()' - Fill the G-code buffer with more data...
  */
@@ -332,6 +524,39 @@ gcode_fill(gcode_buffer_t *buf,		/* I - Buffer */
 }
 
 
+/*
+ * 'gcode_flush()' - Write any buffered G-code output.
+ */
+
+static int				/* O - 0 on success, -1 on error */
+gcode_flush(gcode_buffer_t *buf,	/* I - G-code buffer */
+            int            device_fd)	/* I - Output file */
+{
+  char		*ptr;			/* Pointer into output buffer */
+  ssize_t	bytes;			/* Bytes written */
+
+
+  for (ptr = buf->output; buf->outbytes > 0;)
+  {
+    if ((bytes = write(device_fd, ptr, buf->outbytes)) < 0)
+    {
+      if (errno != EAGAIN && errno != EINTR)
+      {
+        buf->outbytes = 0;
+	return (-1);
+      }
+    }
+    else
+    {
+      buf->outbytes -= (size_t)bytes;
+      ptr           += bytes;
+    }
+  }
+
+  return (0);
+}
+
+
 /*
  * 'gcode_gets()' - Get a line from the G-code buffer.
  */
@@ -373,7 +598,8 @@ gcode_puts(gcode_buffer_t *buf,		/* I - G-code buffer */
   char		buffer[8192],		/* Output buffer */
         	*ptr;			/* Pointer into line/buffer */
   unsigned char	checksum;		/* XOR checksum */
-  size_t	len;			/* Length of output buffer remaining */
+  size_t	linelen,		/* Length of output line */
+		len;			/* Length of output buffer remaining */
   ssize_t	bytes;			/* Bytes written */
   int		ok = 0;			/* Line written OK? */
 
@@ -401,8 +627,28 @@ gcode_puts(gcode_buffer_t *buf,		/* I - G-code buffer */
   for (ptr = buffer, checksum = 0; *ptr; ptr ++)
     checksum ^= (unsigned char)*ptr;
 
-  snprintf(buffer, sizeof(buffer), "N%d %s*%d\n", linenum ++, line, checksum);
-  fprintf(stderr, "DEBUG: >%s", buffer);
+  linelen = (size_t)snprintf(buffer, sizeof(buffer), "N%d %s*%d\n", linenum ++, line, checksum);
+  if (linelen >= sizeof(buffer))
+    linelen = sizeof(buffer) - 1;
+
+  if (Verbosity > 1)
+    fprintf(stderr, "DEBUG: >%s", buffer);
+
+  if (!buf->is_device)
+  {
+   /*
+    * Nothing will acknowledge the line, so just add it to the output buffer
+    * and write the buffer when it fills up...
+    */
+
+    if ((buf->outbytes + linelen) > sizeof(buf->output) && gcode_flush(buf, device_fd) < 0)
+      return (-1);
+
+    memcpy(buf->output + buf->outbytes, buffer, linelen);
+    buf->outbytes += linelen;
+
+    return (linenum);
+  }
 
  /*
   * Finally, write the line to the output device and wait for an OK...
@@ -412,7 +658,7 @@ gcode_puts(gcode_buffer_t *buf,		/* I - G-code buffer */
   {
     char *resp;				/* Response from printer */
 
-    for (ptr = buffer, len = strlen(buffer); len > 0;)
+    for (ptr = buffer, len = linelen; len > 0;)
     {
       if ((bytes = write(device_fd, ptr, len)) < 0)
       {
@@ -691,7 +937,10 @@ xform_document(
   int		mystdout[2] = {-1, -1};	/* Pipe for stdout */
   struct pollfd	polldata[2];		/* Poll data */
   int		pollcount;		/* Number of pipes to poll */
-  char		data[32768],		/* Data from stdout */
+  char		cachefile[1024] = "",	/* Cached G-code file */
+		cachetemp[1024];	/* Temporary cache file */
+  int		cache_fd = -1;		/* Cache file being written */
+  char		data[65536],		/* Data from stdout */
 		*dataptr,		/* Pointer to end of data */
                 *ptr,			/* Pointer into data */
 		*end;			/* End of data */
@@ -996,6 +1245,51 @@ xform_document(
     fprintf(stderr, " %s", myargv[i]);
   fputs("\n", stderr);
 
+ /*
+  * See if we have already sliced this model with these settings...
+  */
+
+  if (cache_lookup(myargv, myargc - 1, outformat, filename, cachefile, sizeof(cachefile)))
+  {
+    cups_file_t	*fp;			/* Cached G-code */
+
+    if ((fp = cupsFileOpen(cachefile, "r")) != NULL)
+    {
+      fprintf(stderr, "DEBUG: Using cached G-code \"%s\".\n", cachefile);
+
+      while (cupsFileGets(fp, data, sizeof(data)))
+      {
+	if ((linenum = gcode_puts(buf, device_fd, data, linenum)) < 0)
+	{
+	  perror("ERROR: Unable to write print data");
+	  break;
+	}
+      }
+
+      cupsFileClose(fp);
+
+     /*
+      * Update the modification time, which tracks when the file was last
+      * used...
+      */
+
+      utimes(cachefile, NULL);
+
+      return (linenum < 0);
+    }
+
+   /*
+    * Save a copy of the G-code as it is sent...
+    */
+
+    snprintf(cachetemp, sizeof(cachetemp), "%s.XXXXXX", cachefile);
+
+    if ((cache_fd = mkstemp(cachetemp)) < 0)
+      cachefile[0] = '\0';
+    else
+      fcntl(cache_fd, F_SETFD, FD_CLOEXEC);
+  }
+
   if (pipe(mystdout))
   {
     fprintf(stderr, "ERROR: Unable to create pipe for stdout: %s\n", strerror(errno));
@@ -1037,7 +1331,7 @@ xform_document(
   polldata[pollcount].events = POLLIN;
   pollcount ++;
 
-  polldata[pollcount].fd     = device_fd;
+  polldata[pollcount].fd     = buf->is_device ? device_fd : -1;
   polldata[pollcount].events = POLLIN;
   pollcount ++;
 
@@ -1058,14 +1352,29 @@ xform_document(
       }
     }
 
-    if (polldata[0].revents & POLLIN)
+    if (polldata[0].revents & (POLLIN | POLLHUP | POLLERR))
     {
      /*
       * Read G-code...
       */
 
-      if ((bytes = read(mystdout[0], dataptr, sizeof(data) - (size_t)(dataptr - data + 1))) > 0)
+      if ((bytes = read(mystdout[0], dataptr, sizeof(data) - (size_t)(dataptr - data + 1))) == 0 || (bytes < 0 && errno != EINTR && errno != EAGAIN))
+      {
+       /*
+        * End of G-code...
+        */
+
+        break;
+      }
+      else if (bytes > 0)
       {
+        if (cache_fd >= 0 && write(cache_fd, dataptr, (size_t)bytes) != bytes)
+        {
+          close(cache_fd);
+          unlink(cachetemp);
+          cache_fd = -1;
+        }
+
         dataptr += bytes;
 	*dataptr = '\0';
 
@@ -1094,6 +1403,17 @@ xform_document(
 	  if (dataptr > data)
 	    memmove(data, end, (size_t)(dataptr - data));
 	}
+
+       /*
+	* Send what we have so far so the output keeps streaming while
+	* CuraEngine is still slicing...
+	*/
+
+	if (gcode_flush(buf, device_fd) < 0)
+	{
+	  perror("ERROR: Unable to write print data");
+	  break;
+	}
       }
     }
   }
@@ -1110,6 +1430,20 @@ xform_document(
   while (wait(&status) < 0);
 #  endif /* HAVE_WAITPID */
 
+  if (cache_fd >= 0)
+  {
+   /*
+    * Keep the G-code if CuraEngine was successful, otherwise discard it...
+    */
+
+    close(cache_fd);
+
+    if (!status && !rename(cachetemp, cachefile))
+      cache_trim(cachefile);
+    else
+      unlink(cachetemp);
+  }
+
   return (status);
 #endif /* _WIN32 */
 }
@@ -145,6 +145,34 @@ typedef unsigned long useconds_t;
 /* #undef HAVE_POSIX_SPAWN */
 
 
+/*
+ * Do we have splice?
+ */
+
+/* #undef HAVE_SPLICE */
+
+
+/*
+ * Do we have fallocate?
+ */
+
+/* #undef HAVE_FALLOCATE */
+
+
+/*
+ * Do we have memfd_create?
+ */
+
+/* #undef HAVE_MEMFD_CREATE */
+
+
+/*
+ * Do we have prlimit?
+ */
+
+/* #undef HAVE_PRLIMIT */
+
+
 /*
  * Do we have ZLIB?
  */
@@ -237,6 +265,7 @@ typedef unsigned long useconds_t;
 
 /* #undef HAVE_WAITPID */
 /* #undef HAVE_WAIT3 */
+/* #undef HAVE_WAIT4 */
 
 
 /*
@@ -424,6 +453,20 @@ typedef unsigned long useconds_t;
 /* #undef HAVE_SYS_UCRED_H */
 
 
+/*
+ * Do we have <sys/sendfile.h>?
+ */
+
+/* #undef HAVE_SYS_SENDFILE_H */
+
+
+/*
+ * Do we have <sys/sdt.h> for static tracepoints?
+ */
+
+/* #undef HAVE_SYS_SDT_H */
+
+
 /*
  * Do we have removefile()?
  */
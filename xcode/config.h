@@ -55,6 +55,34 @@
 #define HAVE_POSIX_SPAWN 1
 
 
+/*
+ * Do we have splice?
+ */
+
+/* #undef HAVE_SPLICE */
+
+
+/*
+ * Do we have fallocate?
+ */
+
+/* #undef HAVE_FALLOCATE */
+
+
+/*
+ * Do we have memfd_create?
+ */
+
+/* #undef HAVE_MEMFD_CREATE */
+
+
+/*
+ * Do we have prlimit?
+ */
+
+/* #undef HAVE_PRLIMIT */
+
+
 /*
  * Do we have ZLIB?
  */
@@ -146,6 +174,7 @@
 
 #define HAVE_WAITPID 1
 #define HAVE_WAIT3 1
+#define HAVE_WAIT4 1
 
 
 /*
@@ -333,6 +362,20 @@
 #define HAVE_SYS_UCRED_H 1
 
 
+/*
+ * Do we have <sys/sendfile.h>?
+ */
+
+/* #undef HAVE_SYS_SENDFILE_H */
+
+
+/*
+ * Do we have <sys/sdt.h> for static tracepoints?
+ */
+
+/* #undef HAVE_SYS_SDT_H */
+
+
 /*
  * Do we have removefile()?
  */